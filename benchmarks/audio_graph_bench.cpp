@@ -0,0 +1,90 @@
+// Micro-benchmarks for the audio graph kernels (src/runtime/audio_graph.h)
+//
+// Times one 256-sample block of a sine oscillator and of a four-input
+// mix + gain + clip on every kernel table the CPU supports, and a whole
+// graph (four oscillators into a clipped mix and a low-pass). The "passes"
+// rows are what audio.audio does: sin per sample, then one loop each for
+// mix, gain and clip. Build with `cmake --build <dir> --target
+// tocin_audio_bench`.
+
+#include "../src/runtime/audio_graph.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using tocin::runtime::AudioGraph;
+using tocin::runtime::AudioKernels;
+using tocin::runtime::AudioStage;
+
+static const size_t kBlock = 256;
+
+// Seconds per call, best of five runs of `reps` calls.
+static double timeCall(int reps, const std::function<void()>& call) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) call();
+        auto end = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(end - start).count() / reps;
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+static void report(const char* op, const char* impl, double samples, double s) {
+    std::printf("%-8s %-7s %10.3f us %8.1f Msample/s\n", op, impl, s * 1e6, samples / s / 1e6);
+}
+
+int main() {
+    std::vector<double> out(kBlock), ins[4];
+    for (auto& in : ins) in.assign(kBlock, 0.3);
+    const double* ptrs[] = {ins[0].data(), ins[1].data(), ins[2].data(), ins[3].data()};
+    const double levels[] = {0.25, 0.25, 0.25, 0.25};
+    volatile double sink = 0;
+
+    double phase = 0;
+    report("sine", "passes", kBlock, timeCall(20000, [&] {
+        for (size_t i = 0; i < kBlock; ++i) out[i] = 0.5 * std::sin(6.283185307179586 * (phase + i * 0.01));
+        phase += 0.37;
+        sink = out[7];
+    }));
+    report("mix", "passes", kBlock, timeCall(20000, [&] {
+        for (size_t i = 0; i < kBlock; ++i) out[i] = 0;
+        for (auto& in : ins)
+            for (size_t i = 0; i < kBlock; ++i) out[i] += in[i] * 0.25;
+        for (size_t i = 0; i < kBlock; ++i) out[i] *= 1.5;
+        for (size_t i = 0; i < kBlock; ++i) out[i] = out[i] > 0.8 ? 0.8 : out[i] < -0.8 ? -0.8 : out[i];
+        sink = out[7];
+    }));
+
+    for (const AudioKernels* k : tocin::runtime::availableAudioKernels()) {
+        report("sine", k->name, kBlock, timeCall(20000, [&] {
+            k->sine(out.data(), kBlock, phase, 0.01, 0.5, AudioStage{1.0, INFINITY});
+            phase += 0.37;
+            sink = out[7];
+        }));
+        report("mix", k->name, kBlock, timeCall(20000, [&] {
+            k->mix(out.data(), ptrs, levels, 4, kBlock, AudioStage{1.5, 0.8});
+            sink = out[7];
+        }));
+        AudioGraph g(kBlock, 48000.0);
+        int64_t mix = -1;
+        std::vector<int64_t> oscs;
+        for (int i = 0; i < 4; ++i)
+            oscs.push_back(g.addOscillator(i % 2 ? AudioGraph::Kind::Saw : AudioGraph::Kind::Sine,
+                                           220.0 * (i + 1), 0.5));
+        mix = g.addMix();
+        for (int64_t o : oscs) g.connect(mix, o, 0.25);
+        g.setClip(mix, 0.8);
+        g.addLowpass(mix, 0.1);
+        report("graph", k->name, kBlock, timeCall(20000, [&] {
+            g.process(*k);
+            sink = g.output()[7];
+        }));
+    }
+    (void)sink;
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Micro-benchmarks for the image kernels (src/runtime/image_kernels.h)
+//
+// Times the 3x3 and 15x15 box blur, Sobel, and 4K -> 1080p nearest,
+// bilinear and area resizes of a 3840x2160 frame on every kernel table the
+// CPU supports. The "pixel" rows are what ml.computer_vision did: one
+// getPixel-style clamped read per tap. Build with `cmake --build <dir>
+// --target tocin_image_bench`.
+
+#include "../src/runtime/image_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using tocin::runtime::GrayImage;
+using tocin::runtime::ImageKernels;
+using tocin::runtime::ResizeMode;
+
+static const int64_t kW = 3840, kH = 2160;
+
+// Seconds per call, best of five runs of `reps` calls.
+static double timeCall(int reps, const std::function<void()>& call) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) call();
+        auto end = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(end - start).count() / reps;
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+static void report(const char* op, const char* impl, double pixels, double s) {
+    std::printf("%-10s %-7s %9.3f ms %8.1f Mpixel/s\n", op, impl, s * 1e3, pixels / s / 1e6);
+}
+
+static int64_t clampi(int64_t v, int64_t hi) { return v < 0 ? 0 : v > hi ? hi : v; }
+
+int main() {
+    std::vector<uint8_t> src(kW * kH), dst(kW * kH), half(kW / 2 * kH / 2);
+    uint32_t seed = 1;
+    for (auto& b : src) b = static_cast<uint8_t>((seed = seed * 1664525u + 1013904223u) >> 24);
+    GrayImage in{src.data(), kW, kH}, out{dst.data(), kW, kH}, small{half.data(), kW / 2, kH / 2};
+    const double frame = double(kW) * kH;
+    volatile uint8_t sink = 0;
+
+    auto px = [&](int64_t x, int64_t y) { return int(src[clampi(y, kH - 1) * kW + clampi(x, kW - 1)]); };
+    report("blur3", "pixel", frame, timeCall(1, [&] {
+        for (int64_t y = 0; y < kH; ++y)
+            for (int64_t x = 0; x < kW; ++x) {
+                int sum = 0;
+                for (int dy = -1; dy <= 1; ++dy)
+                    for (int dx = -1; dx <= 1; ++dx) sum += px(x + dx, y + dy);
+                dst[y * kW + x] = static_cast<uint8_t>(sum / 9);
+            }
+        sink = dst[7];
+    }));
+    report("sobel", "pixel", frame, timeCall(1, [&] {
+        for (int64_t y = 0; y < kH; ++y)
+            for (int64_t x = 0; x < kW; ++x) {
+                int gx = -px(x - 1, y - 1) - 2 * px(x - 1, y) - px(x - 1, y + 1) + px(x + 1, y - 1) +
+                         2 * px(x + 1, y) + px(x + 1, y + 1);
+                int gy = -px(x - 1, y - 1) - 2 * px(x, y - 1) - px(x + 1, y - 1) + px(x - 1, y + 1) +
+                         2 * px(x, y + 1) + px(x + 1, y + 1);
+                int mag = (gx < 0 ? -gx : gx) + (gy < 0 ? -gy : gy);
+                dst[y * kW + x] = static_cast<uint8_t>(mag > 255 ? 255 : mag);
+            }
+        sink = dst[7];
+    }));
+
+    for (const ImageKernels* k : tocin::runtime::availableImageKernels()) {
+        report("blur3", k->name, frame, timeCall(5, [&] { boxBlur(*k, in, out, 1); sink = dst[7]; }));
+        report("blur15", k->name, frame, timeCall(5, [&] { boxBlur(*k, in, out, 7); sink = dst[7]; }));
+        report("sobel", k->name, frame, timeCall(5, [&] { sobel(*k, in, out); sink = dst[7]; }));
+        report("nearest", k->name, frame, timeCall(5, [&] { resize(*k, in, small, ResizeMode::Nearest); sink = half[7]; }));
+        report("bilinear", k->name, frame, timeCall(5, [&] { resize(*k, in, small, ResizeMode::Bilinear); sink = half[7]; }));
+        report("area", k->name, frame, timeCall(5, [&] { resize(*k, in, small, ResizeMode::Area); sink = half[7]; }));
+    }
+    (void)sink;
+    return 0;
+}
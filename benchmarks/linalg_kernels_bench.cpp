@@ -0,0 +1,70 @@
+// Micro-benchmarks for the matrix runtime kernels (src/runtime/linalg_kernels.h)
+//
+// Times GEMM and GEMV on every kernel table the CPU supports against the
+// naive loops matMul/matVecMul used before, on square sizes from a cache-
+// resident tile to a matrix several panels wide. Build with
+// `cmake --build <dir> --target tocin_linalg_bench`.
+
+#include "../src/runtime/linalg_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using tocin::runtime::LinalgKernels;
+
+// Keeps results alive so the timed calls are not optimized away.
+static volatile double g_sink;
+
+// Seconds per call, best of five runs.
+static double timeCall(const std::function<void()>& call) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        call();
+        auto end = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(end - start).count();
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+static void report(const char* kernel, const char* impl, size_t n, double flops, double s) {
+    std::printf("%-5s %-7s %5zu %10.3f ms %8.2f GFLOP/s\n", kernel, impl, n, s * 1e3, flops / s / 1e9);
+}
+
+static void naiveGemm(const double* a, const double* b, double* c, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        for (size_t j = 0; j < n; ++j) {
+            double acc = 0.0;
+            for (size_t k = 0; k < n; ++k) acc += a[i * n + k] * b[k * n + j];
+            c[i * n + j] = acc;
+        }
+}
+
+int main() {
+    for (size_t n : {64, 256, 512, 1024}) {
+        std::vector<double> a(n * n), b(n * n), c(n * n), x(n), y(n);
+        for (size_t i = 0; i < n * n; ++i) {
+            a[i] = (double)(i % 17) * 0.25 - 2.0;
+            b[i] = (double)(i % 13) * 0.5 - 3.0;
+        }
+        for (size_t i = 0; i < n; ++i) x[i] = (double)(i % 7);
+        double gemmFlops = 2.0 * (double)n * (double)n * (double)n;
+        double gemvFlops = 2.0 * (double)n * (double)n;
+
+        if (n <= 512)
+            report("gemm", "naive", n, gemmFlops, timeCall([&] { naiveGemm(a.data(), b.data(), c.data(), n); }));
+        for (const LinalgKernels* k : tocin::runtime::availableLinalgKernels()) {
+            report("gemm", k->name, n, gemmFlops, timeCall([&] {
+                tocin::runtime::gemm(*k, a.data(), b.data(), c.data(), n, n, n);
+            }));
+            report("gemv", k->name, n, gemvFlops, timeCall([&] {
+                tocin::runtime::gemv(*k, a.data(), x.data(), y.data(), n, n);
+            }));
+        }
+        g_sink = g_sink + c[n] + y[n / 2];
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Micro-benchmark for the LINQ query pipeline (src/runtime/linq.h)
+//
+// Runs the query from benchmark_runtime_linq.to, and the same query cut
+// short by take/first, three ways: through Queryable, stage by stage with a
+// vector per stage as Queryable::execute used to, and as a hand-written
+// loop, plus the sum under asParallel() on the parallel_for pool. Build with
+// `cmake --build <dir> --target tocin_linq_bench`.
+
+#include "../src/runtime/linq.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using runtime::Queryable;
+
+extern "C" void __tocin_parallel_init(int64_t threads);
+
+// Keeps results alive so the timed calls are not optimized away.
+static volatile int64_t g_sink;
+
+// Microseconds per call, best of five runs of `reps` calls.
+static double timeCall(int reps, const std::function<int64_t()>& call) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        int64_t acc = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < reps; ++i) acc += call();
+        auto end = std::chrono::steady_clock::now();
+        g_sink = g_sink + acc;
+        double us = std::chrono::duration<double, std::micro>(end - start).count() / reps;
+        if (us < best) best = us;
+    }
+    return best;
+}
+
+static void report(const char* query, const char* impl, double us) {
+    std::printf("%-18s %-10s %10.1f us\n", query, impl, us);
+}
+
+template <typename F>
+static std::vector<int64_t> filter(const std::vector<int64_t>& xs, F pred) {
+    std::vector<int64_t> out;
+    for (int64_t x : xs)
+        if (pred(x)) out.push_back(x);
+    return out;
+}
+
+template <typename F>
+static std::vector<int64_t> map(const std::vector<int64_t>& xs, F f) {
+    std::vector<int64_t> out;
+    out.reserve(xs.size());
+    for (int64_t x : xs) out.push_back(f(x));
+    return out;
+}
+
+int main() {
+    __tocin_parallel_init(0);
+    std::vector<int64_t> numbers;
+    for (int64_t i = 1; i <= 100000; ++i) numbers.push_back(i);
+    const auto even = [](const int64_t& x) { return x % 2 == 0; };
+    const auto triple = [](const int64_t& x) { return x * 3; };
+    const auto fifth = [](const int64_t& x) { return x % 5 == 0; };
+    const auto half = [](const int64_t& x) { return x / 2; };
+
+    const auto query = runtime::linq::from(numbers).where(even).select(triple).where(fifth).select(half);
+    const int reps = 200;
+
+    // Stage-by-stage copies of the source: what execute() did before.
+    const auto eager = [&](size_t limit) {
+        std::vector<int64_t> v = numbers;
+        v = map(filter(map(filter(v, even), triple), fifth), half);
+        if (v.size() > limit) v.resize(limit);
+        return v;
+    };
+    const auto loop = [&](size_t limit) {
+        int64_t total = 0;
+        size_t n = 0;
+        for (int64_t x : numbers) {
+            if (!even(x)) continue;
+            int64_t y = triple(x);
+            if (!fifth(y)) continue;
+            total += half(y);
+            if (++n == limit) break;
+        }
+        return total;
+    };
+
+    report("where/select sum", "queryable", timeCall(reps, [&] { return query.sum(); }));
+    report("where/select sum", "eager", timeCall(reps, [&] {
+        int64_t total = 0;
+        for (int64_t x : eager(SIZE_MAX)) total += x;
+        return total;
+    }));
+    report("where/select sum", "loop", timeCall(reps, [&] { return loop(SIZE_MAX); }));
+    report("where/select sum", "parallel", timeCall(reps, [&] { return query.asParallel().sum(); }));
+
+    report("... take(10) sum", "queryable", timeCall(reps, [&] { return query.take(10).sum(); }));
+    report("... take(10) sum", "eager", timeCall(reps, [&] {
+        int64_t total = 0;
+        for (int64_t x : eager(10)) total += x;
+        return total;
+    }));
+    report("... take(10) sum", "loop", timeCall(reps, [&] { return loop(10); }));
+
+    report("... first()", "queryable", timeCall(reps, [&] { return query.first(); }));
+    report("... first()", "eager", timeCall(reps, [&] { return eager(1).front(); }));
+    report("... first()", "loop", timeCall(reps, [&] { return loop(1); }));
+    return 0;
+}
@@ -0,0 +1,932 @@
+// End-to-end performance suite (CMake target `tocin_bench`)
+//
+// One driver for the numbers a release should not lose:
+//
+//   compile  the compiler on a generated 2000-function program at -O0 and
+//            -O2, and on the stdlib-heavy benchmark programs
+//   jit      `tocin --run` startup, with and without the JIT cache
+//   runtime  goroutines and channels, strings, maps and sorting, numeric
+//            kernels, JSON, and HTTP over a loopback socket, in process
+//   memory   heap bytes per map entry, bytes allocated per string,
+//            resident bytes per parked goroutine, peak RSS of the compiler
+//            and the JIT
+//
+// In-process benchmarks calibrate a batch to --min-sample-ms, run one
+// untimed warmup batch and then --samples timed batches, recording
+// nanoseconds per operation from the steady clock. Each compile or JIT
+// sample is one run of the tocin binary, timed around fork/exec/wait.
+//
+// --out writes every sample as JSON; such a file, kept from a known-good
+// build, is the baseline for --baseline. Each benchmark is compared with
+// its baseline by a two-sided Mann-Whitney U test on the samples: it is a
+// regression when the difference is significant (p < --alpha) and the
+// median moved by more than --threshold, and then the exit status is 1.
+// Neither test alone is enough: with enough samples a 0.5% shift is
+// significant, and on a noisy machine a 10% one may be chance.
+//
+//   cmake --build build --target tocin_bench
+//   build/tocin_bench --out base.json                   # on the old build
+//   build/tocin_bench --baseline base.json --out new.json
+//
+// The `bench` target runs it against benchmarks/perf_baseline.json when that
+// file exists.
+
+#include "../src/runtime/json_parser.h"
+#include "../src/runtime/linalg_kernels.h"
+#include "../src/runtime/sort_kernels.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <malloc.h>
+#include <netinet/in.h>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#ifndef TOCIN_BENCH_COMPILER
+#define TOCIN_BENCH_COMPILER "tocin"
+#endif
+#ifndef TOCIN_BENCH_SOURCE_DIR
+#define TOCIN_BENCH_SOURCE_DIR "."
+#endif
+
+extern "C" {
+void* __tocin_chan_new_cap(int64_t cap);
+void __tocin_chan_send(void* h, int64_t v);
+int64_t __tocin_chan_recv(void* h);
+void __tocin_go(void (*fn)(void*), void* arg);
+char* __tocin_buf_to_str(const char* p, int64_t n);
+char* __tocin_str_concat(const char* a, const char* b);
+int64_t __tocin_str_eq(const char* a, const char* b);
+char* __tocin_int_to_str(int64_t n);
+void __tocin_str_free(char* s);
+void* __tocin_sb_new();
+void __tocin_sb_append(void* h, const char* s);
+char* __tocin_sb_finish(void* h);
+void* __tocin_map_new();
+void __tocin_map_put(void* h, int64_t k, int64_t v);
+int64_t __tocin_map_get(void* h, int64_t k);
+void __tocin_map_put_str(void* h, const char* k, int64_t v);
+int64_t __tocin_map_get_str(void* h, const char* k);
+void __tocin_map_free(void* h);
+int64_t __tocin_tcp_listen(int64_t port);
+int64_t __tocin_tcp_accept(int64_t fd);
+int64_t __tocin_tcp_connect(const char* host, int64_t port);
+int64_t __tocin_tcp_send_buf(int64_t fd, const char* buf, int64_t off, int64_t n);
+int64_t __tocin_tcp_recv_into(int64_t fd, char* buf, int64_t off, int64_t max);
+void __tocin_tcp_close(int64_t fd);
+int64_t __tocin_http_parse(const char* buf, int64_t off, int64_t len, int64_t* rec);
+int64_t __tocin_alloc_counting(int64_t on);
+int64_t __tocin_alloc_counts(int64_t* rec);
+}
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Options and results
+
+struct Options {
+    std::vector<std::string> suites = {"compile", "jit", "runtime", "memory"};
+    std::string filter;
+    int samples = 15;           // timed batches per in-process benchmark
+    int processSamples = 7;     // tocin runs per compile/JIT benchmark
+    double minSampleMs = 10.0;
+    std::string tocin;
+    std::string sourceDir = TOCIN_BENCH_SOURCE_DIR;
+    std::string out;
+    std::string baseline;
+    double alpha = 0.01;
+    double threshold = 0.05;
+};
+
+struct Result {
+    std::string name;
+    std::string suite;
+    std::string unit;           // "ns" or "bytes"; lower is better for both
+    std::vector<double> samples;
+};
+
+Options g_opt;
+std::vector<Result> g_results;
+
+// Keeps results alive so the timed work is not optimized away.
+volatile uint64_t g_sink;
+
+bool suiteOn(const std::string& suite) {
+    return std::find(g_opt.suites.begin(), g_opt.suites.end(), suite) != g_opt.suites.end();
+}
+
+bool selected(const std::string& suite, const std::string& name) {
+    return suiteOn(suite) && (g_opt.filter.empty() || name.find(g_opt.filter) != std::string::npos);
+}
+
+uint64_t nowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+
+double quantile(std::vector<double> xs, double q) {
+    if (xs.empty()) return 0.0;
+    std::sort(xs.begin(), xs.end());
+    double pos = q * (double)(xs.size() - 1);
+    size_t lo = (size_t)pos;
+    size_t hi = std::min(lo + 1, xs.size() - 1);
+    return xs[lo] + (xs[hi] - xs[lo]) * (pos - (double)lo);
+}
+
+double mean(const std::vector<double>& xs) {
+    double s = 0.0;
+    for (double x : xs) s += x;
+    return xs.empty() ? 0.0 : s / (double)xs.size();
+}
+
+double stddev(const std::vector<double>& xs) {
+    if (xs.size() < 2) return 0.0;
+    double m = mean(xs), s = 0.0;
+    for (double x : xs) s += (x - m) * (x - m);
+    return std::sqrt(s / (double)(xs.size() - 1));
+}
+
+// Two-sided p-value of the Mann-Whitney U test that a and b come from the
+// same distribution: normal approximation with tie and continuity
+// corrections, adequate from about five samples a side.
+double mannWhitneyP(const std::vector<double>& a, const std::vector<double>& b) {
+    size_t n1 = a.size(), n2 = b.size(), n = n1 + n2;
+    if (n1 == 0 || n2 == 0) return 1.0;
+    std::vector<std::pair<double, int>> all;
+    for (double x : a) all.push_back({x, 0});
+    for (double x : b) all.push_back({x, 1});
+    std::sort(all.begin(), all.end());
+    double rankSumA = 0.0, tieTerm = 0.0;
+    for (size_t i = 0; i < n;) {
+        size_t j = i;
+        while (j < n && all[j].first == all[i].first) ++j;
+        double rank = (double)(i + j + 1) / 2.0;   // average of ranks i+1 .. j
+        for (size_t k = i; k < j; ++k)
+            if (all[k].second == 0) rankSumA += rank;
+        double t = (double)(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+    double u = rankSumA - (double)n1 * (double)(n1 + 1) / 2.0;
+    double mu = (double)n1 * (double)n2 / 2.0;
+    double var = (double)n1 * (double)n2 / 12.0 *
+                 ((double)(n + 1) - tieTerm / ((double)n * (double)(n - 1)));
+    if (var <= 0.0) return 1.0;   // every sample equal
+    double z = (std::fabs(u - mu) - 0.5) / std::sqrt(var);
+    if (z < 0.0) z = 0.0;
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+// ---------------------------------------------------------------------------
+// In-process timing
+
+// Nanoseconds per operation of body(n), which runs n operations, for
+// g_opt.samples batches each lasting at least --min-sample-ms.
+void micro(const std::string& suite, const std::string& name,
+           const std::function<uint64_t(uint64_t)>& body) {
+    if (!selected(suite, name)) return;
+    const double minNs = g_opt.minSampleMs * 1e6;
+    auto run = [&](uint64_t n) {
+        uint64_t start = nowNs();
+        g_sink = g_sink + body(n);
+        return (double)(nowNs() - start);
+    };
+    uint64_t n = 1;
+    for (;;) {
+        double t = run(n);
+        if (t >= minNs || n >= (uint64_t(1) << 32)) break;
+        double grow = t > 0.0 ? minNs * 1.2 / t : 100.0;
+        n = (uint64_t)((double)n * std::min(100.0, std::max(2.0, grow)));
+    }
+    run(n);   // warmup
+    Result r{name, suite, "ns", {}};
+    for (int s = 0; s < g_opt.samples; ++s) r.samples.push_back(run(n) / (double)n);
+    g_results.push_back(std::move(r));
+}
+
+// g_opt.processSamples values of sample(), in `unit`.
+void repeated(const std::string& suite, const std::string& name, const char* unit,
+              const std::function<double()>& sample) {
+    if (!selected(suite, name)) return;
+    Result r{name, suite, unit, {}};
+    for (int s = 0; s < g_opt.processSamples; ++s) {
+        double v = sample();
+        if (v < 0.0) {
+            std::fprintf(stderr, "%s: failed, skipped\n", name.c_str());
+            return;
+        }
+        r.samples.push_back(v);
+    }
+    g_results.push_back(std::move(r));
+}
+
+// ---------------------------------------------------------------------------
+// Child processes
+
+struct ProcessRun {
+    double ns = -1.0;           // wall time, or -1 if it did not exit 0
+    double peakRssBytes = 0.0;
+};
+
+// Runs argv[0] with output discarded, from the source directory so that the
+// stdlib resolves as it does for a developer.
+ProcessRun runProcess(const std::vector<std::string>& args) {
+    std::vector<char*> argv;
+    for (const std::string& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+    ProcessRun out;
+    uint64_t start = nowNs();
+    pid_t pid = fork();
+    if (pid < 0) return out;
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, 1);
+            dup2(devnull, 2);
+        }
+        if (chdir(g_opt.sourceDir.c_str()) != 0) _exit(127);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage ru;
+    std::memset(&ru, 0, sizeof ru);
+    if (wait4(pid, &status, 0, &ru) < 0) return out;
+    double ns = (double)(nowNs() - start);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) out.ns = ns;
+    out.peakRssBytes = (double)ru.ru_maxrss * 1024.0;   // kilobytes on Linux
+    return out;
+}
+
+std::string g_workDir;
+
+std::string writeWorkFile(const std::string& name, const std::string& text) {
+    std::string path = g_workDir + "/" + name;
+    std::ofstream(path) << text;
+    return path;
+}
+
+// A program shaped like application code: many small functions with loops
+// and branches, classes with methods, and one main calling all of them.
+std::string largeProgram(int functions) {
+    std::ostringstream s;
+    for (int i = 0; i < functions; ++i) {
+        if (i % 20 == 0) {
+            s << "class P" << i << " { x: int; y: int; def sum(self) -> int { return self.x * "
+              << (i % 7 + 1) << " + self.y; } }\n";
+        }
+        s << "def f" << i << "(x: int) -> int {\n"
+          << "    let acc = x;\n"
+          << "    for j in 0..10 {\n"
+          << "        if j % 3 == " << (i % 3) << " { acc = acc + j * " << i << "; } else { acc = acc - j; }\n"
+          << "    }\n"
+          << "    let p = P" << (i / 20 * 20) << "(acc, " << i << ");\n"
+          << "    return p.sum() % 1000003;\n"
+          << "}\n";
+    }
+    s << "def main() -> int {\n    let total = 0;\n";
+    for (int i = 0; i < functions; ++i) s << "    total = total + f" << i << "(" << i << ");\n";
+    s << "    return total % 2;\n}\n";
+    return s.str();
+}
+
+void compileSuite() {
+    const std::string big = writeWorkFile("large.to", largeProgram(2000));
+    const std::string ll = g_workDir + "/out.ll";
+    auto compile = [&](const std::string& name, const std::string& file, const char* level) {
+        repeated("compile", name, "ns", [&] {
+            return runProcess({g_opt.tocin, level, file, "-o", ll}).ns;
+        });
+    };
+    compile("compile.large_2000fn_O0", big, "-O0");
+    compile("compile.large_2000fn_O2", big, "-O2");
+    compile("compile.benchmark_json_O2", g_opt.sourceDir + "/benchmarks/benchmark_json.to", "-O2");
+    compile("compile.benchmark_sort_O2", g_opt.sourceDir + "/benchmarks/benchmark_sort.to", "-O2");
+}
+
+const char* kHello = "def main() -> int { println(\"hello\"); return 0; }\n";
+const char* kStdlibHello =
+    "import std.json;\nimport std.testing;\n"
+    "def main() -> int { testBegin(); checkEq(\"one\", 1, 1); return testSummary(); }\n";
+
+void jitSuite() {
+    const std::string hello = writeWorkFile("hello.to", kHello);
+    const std::string stdlib = writeWorkFile("stdlib_hello.to", kStdlibHello);
+    repeated("jit", "jit.startup_hello_cold", "ns", [&] {
+        return runProcess({g_opt.tocin, "--run", "--no-jit-cache", hello}).ns;
+    });
+    if (selected("jit", "jit.startup_hello_cached")) runProcess({g_opt.tocin, "--run", hello});
+    repeated("jit", "jit.startup_hello_cached", "ns", [&] {
+        return runProcess({g_opt.tocin, "--run", hello}).ns;
+    });
+    repeated("jit", "jit.startup_stdlib_cold", "ns", [&] {
+        return runProcess({g_opt.tocin, "--run", "--no-jit-cache", stdlib}).ns;
+    });
+}
+
+// ---------------------------------------------------------------------------
+// Runtime
+
+void signalDone(void* ch) { __tocin_chan_send(ch, 1); }
+
+struct Echo {
+    void* in;
+    void* out;
+};
+
+void echoLoop(void* arg) {
+    auto* e = static_cast<Echo*>(arg);
+    for (;;) {
+        int64_t v = __tocin_chan_recv(e->in);
+        if (v < 0) break;
+        __tocin_chan_send(e->out, v + 1);
+    }
+}
+
+struct Produce {
+    void* ch;
+    uint64_t n;
+};
+
+void produce(void* arg) {
+    auto* p = static_cast<Produce*>(arg);
+    for (uint64_t i = 0; i < p->n; ++i) __tocin_chan_send(p->ch, (int64_t)i);
+}
+
+void concurrencyBenchmarks() {
+    void* done = __tocin_chan_new_cap(1024);
+    micro("runtime", "runtime.concurrency.go_spawn", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) __tocin_go(signalDone, done);
+        uint64_t got = 0;
+        for (uint64_t i = 0; i < n; ++i) got += (uint64_t)__tocin_chan_recv(done);
+        return got;
+    });
+
+    Echo echo{__tocin_chan_new_cap(0), __tocin_chan_new_cap(0)};
+    __tocin_go(echoLoop, &echo);
+    micro("runtime", "runtime.concurrency.chan_pingpong", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            __tocin_chan_send(echo.in, (int64_t)i);
+            acc += (uint64_t)__tocin_chan_recv(echo.out);
+        }
+        return acc;
+    });
+    __tocin_chan_send(echo.in, -1);
+
+    void* buffered = __tocin_chan_new_cap(1024);
+    micro("runtime", "runtime.concurrency.chan_buffered", [&](uint64_t n) {
+        Produce p{buffered, n};
+        __tocin_go(produce, &p);
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) acc += (uint64_t)__tocin_chan_recv(buffered);
+        return acc;
+    });
+}
+
+char* tocinStr(const std::string& s) { return __tocin_buf_to_str(s.data(), (int64_t)s.size()); }
+
+void stringBenchmarks() {
+    char* a = tocinStr("GET /api/v1/user");
+    char* b = tocinStr("s/42?expand=true");
+    micro("runtime", "runtime.strings.concat_16B", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            char* s = __tocin_str_concat(a, b);
+            acc += (unsigned char)s[i & 31];
+            __tocin_str_free(s);
+        }
+        return acc;
+    });
+    micro("runtime", "runtime.strings.int_to_str", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            char* s = __tocin_int_to_str((int64_t)(i * 2654435761u));
+            acc += (unsigned char)s[0];
+            __tocin_str_free(s);
+        }
+        return acc;
+    });
+    micro("runtime", "runtime.strings.builder_32_appends", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            void* sb = __tocin_sb_new();
+            for (int k = 0; k < 32; ++k) __tocin_sb_append(sb, (k & 1) ? a : b);
+            char* s = __tocin_sb_finish(sb);
+            acc += (unsigned char)s[i & 511];
+            __tocin_str_free(s);
+        }
+        return acc;
+    });
+    std::string text64(64, 'x');
+    text64[63] = 'y';
+    char* x = tocinStr(text64);
+    char* y = tocinStr(text64);
+    micro("runtime", "runtime.strings.eq_64B", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) acc += (uint64_t)__tocin_str_eq(x, y);
+        return acc;
+    });
+    for (char* s : {a, b, x, y}) __tocin_str_free(s);
+}
+
+void collectionBenchmarks() {
+    micro("runtime", "runtime.collections.map_int_build_10k", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            void* m = __tocin_map_new();
+            for (int64_t k = 0; k < 10000; ++k) __tocin_map_put(m, k * 7919, k);
+            acc += (uint64_t)__tocin_map_get(m, 7919);
+            __tocin_map_free(m);
+        }
+        return acc;
+    });
+
+    const int64_t mask = (1 << 16) - 1;
+    void* ints = __tocin_map_new();
+    for (int64_t k = 0; k <= mask; ++k) __tocin_map_put(ints, k * 7919, k);
+    micro("runtime", "runtime.collections.map_int_get_64k", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) acc += (uint64_t)__tocin_map_get(ints, (int64_t)((i * 40503) & mask) * 7919);
+        return acc;
+    });
+    __tocin_map_free(ints);
+
+    std::vector<char*> keys;
+    void* strs = __tocin_map_new();
+    for (int k = 0; k < 10000; ++k) {
+        keys.push_back(tocinStr("session:" + std::to_string(k * 7919)));
+        __tocin_map_put_str(strs, keys.back(), k);
+    }
+    micro("runtime", "runtime.collections.map_str_get_10k", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) acc += (uint64_t)__tocin_map_get_str(strs, keys[(i * 40503) % keys.size()]);
+        return acc;
+    });
+    __tocin_map_free(strs);
+    for (char* k : keys) __tocin_str_free(k);
+
+    std::vector<int64_t> data(1 << 16), work(data.size());
+    uint64_t seed = 88172645463325252ull;
+    for (int64_t& v : data) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        v = (int64_t)(seed % 1000000);
+    }
+    micro("runtime", "runtime.collections.sort_int_64k", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            work = data;
+            tocin::runtime::pdqsort(work.data(), work.size());
+            acc += (uint64_t)work[i % work.size()];
+        }
+        return acc;
+    });
+}
+
+void numericBenchmarks() {
+    const tocin::runtime::LinalgKernels& k = tocin::runtime::linalgKernels();
+    const size_t n = 128, m = 512;
+    std::vector<double> a(m * m), b(n * n), c(n * n), x(m), y(m);
+    for (size_t i = 0; i < a.size(); ++i) a[i] = (double)(i % 17) * 0.25 - 2.0;
+    for (size_t i = 0; i < b.size(); ++i) b[i] = (double)(i % 13) * 0.5 - 3.0;
+    for (size_t i = 0; i < m; ++i) x[i] = (double)(i % 7);
+    micro("runtime", "runtime.numeric.gemm_128", [&](uint64_t iters) {
+        for (uint64_t i = 0; i < iters; ++i) tocin::runtime::gemm(k, a.data(), b.data(), c.data(), n, n, n);
+        return (uint64_t)c[n + 1];
+    });
+    micro("runtime", "runtime.numeric.gemv_512", [&](uint64_t iters) {
+        for (uint64_t i = 0; i < iters; ++i) tocin::runtime::gemv(k, a.data(), x.data(), y.data(), m, m);
+        return (uint64_t)y[m / 2];
+    });
+}
+
+// An API request body of about 1 KB.
+std::string jsonBody() {
+    std::string s = "{\"request_id\":\"req-1234\",\"user\":{\"id\":1042,\"name\":\"Ada Lovelace\","
+                    "\"email\":\"ada@example.com\",\"roles\":[\"admin\",\"ops\"]},\"items\":[";
+    for (int k = 0; k < 12; ++k) {
+        if (k) s += ",";
+        s += "{\"sku\":\"SKU-" + std::to_string(1000 + k) + "\",\"qty\":" + std::to_string(k + 1) +
+             ",\"price\":" + std::to_string(9.99 + k) + "}";
+    }
+    return s + "],\"meta\":{\"source\":\"mobile\",\"retry\":false,\"note\":\"line\\nbreak\"}}";
+}
+
+void jsonBenchmarks() {
+    const std::string body = jsonBody();
+    tocin::runtime::JsonDocument doc;
+    micro("runtime", "runtime.json.parse_1KB", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) acc += doc.parse(body.data(), body.size()) ? 1 : 0;
+        return acc;
+    });
+    uint32_t hints[3] = {0, 0, 0};
+    micro("runtime", "runtime.json.parse_get_3_fields", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            doc.parse(body.data(), body.size());
+            size_t root = tocin::runtime::JsonDocument::kRoot;
+            size_t user = doc.find(root, "user", 4, &hints[0]);
+            acc += (uint64_t)doc.asInt(doc.find(user, "id", 2, &hints[1]));
+            acc += doc.length(doc.find(root, "items", 5, &hints[2]));
+        }
+        return acc;
+    });
+}
+
+const char kRequest[] =
+    "GET /api/v1/users/42?expand=true HTTP/1.1\r\nHost: localhost\r\nUser-Agent: tocin-bench\r\n"
+    "Accept: application/json\r\nConnection: keep-alive\r\n\r\n";
+const char kResponse[] =
+    "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 17\r\n\r\n{\"id\":42,\"ok\":1}\n";
+
+struct Server {
+    int64_t listenFd;
+};
+
+// Answers every request on one keep-alive connection until the client
+// hangs up.
+void serveOne(void* arg) {
+    auto* s = static_cast<Server*>(arg);
+    int64_t fd = __tocin_tcp_accept(s->listenFd);
+    if (fd < 0) return;
+    std::vector<char> buf(1 << 16);
+    int64_t rec[13 + 4 * 64];
+    int64_t used = 0, off = 0;
+    for (;;) {
+        int64_t got = __tocin_tcp_recv_into(fd, buf.data(), used, (int64_t)buf.size() - used);
+        if (got <= 0) break;
+        used += got;
+        for (;;) {
+            int64_t n = __tocin_http_parse(buf.data(), off, used - off, rec);
+            if (n <= 0) break;
+            off += n;
+            __tocin_tcp_send_buf(fd, kResponse, 0, (int64_t)sizeof kResponse - 1);
+        }
+        if (off == used) off = used = 0;
+    }
+    __tocin_tcp_close(fd);
+}
+
+void httpBenchmarks() {
+    int64_t rec[13 + 4 * 64];
+    micro("runtime", "runtime.http.parse_request", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) acc += (uint64_t)__tocin_http_parse(kRequest, 0, sizeof kRequest - 1, rec);
+        return acc;
+    });
+
+    if (!selected("runtime", "runtime.http.loopback_keepalive")) return;
+    Server server{__tocin_tcp_listen(0)};
+    sockaddr_in addr;
+    socklen_t len = sizeof addr;
+    if (server.listenFd < 0 || getsockname((int)server.listenFd, (sockaddr*)&addr, &len) != 0) {
+        std::fprintf(stderr, "runtime.http.loopback_keepalive: no listening socket, skipped\n");
+        return;
+    }
+    __tocin_go(serveOne, &server);
+    int64_t fd = __tocin_tcp_connect("127.0.0.1", ntohs(addr.sin_port));
+    if (fd < 0) {
+        std::fprintf(stderr, "runtime.http.loopback_keepalive: connect failed, skipped\n");
+        __tocin_tcp_close(server.listenFd);
+        return;
+    }
+    char resp[sizeof kResponse];
+    micro("runtime", "runtime.http.loopback_keepalive", [&](uint64_t n) {
+        uint64_t acc = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            __tocin_tcp_send_buf(fd, kRequest, 0, (int64_t)sizeof kRequest - 1);
+            int64_t got = 0;
+            while (got < (int64_t)sizeof kResponse - 1) {
+                int64_t r = __tocin_tcp_recv_into(fd, resp, got, (int64_t)sizeof kResponse - 1 - got);
+                if (r <= 0) return acc;
+                got += r;
+            }
+            acc += (uint64_t)got;
+        }
+        return acc;
+    });
+    __tocin_tcp_close(fd);
+    __tocin_tcp_close(server.listenFd);
+}
+
+// ---------------------------------------------------------------------------
+// Memory
+
+// Bytes the C heap has handed out (glibc), else the resident set.
+double heapBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+    return (double)mi.uordblks + (double)mi.hblkhd;
+#else
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return (double)resident * (double)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+double residentBytes() {
+    long pages = 0, resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return (double)resident * (double)sysconf(_SC_PAGESIZE);
+}
+
+struct Parked {
+    void* started;
+    void* release;
+    void* done;
+};
+
+void parkUntilReleased(void* arg) {
+    auto* p = static_cast<Parked*>(arg);
+    __tocin_chan_send(p->started, 1);
+    __tocin_chan_recv(p->release);
+    __tocin_chan_send(p->done, 1);
+}
+
+void memorySuite() {
+    repeated("memory", "memory.map_int_heap_per_entry", "bytes", [] {
+        const int64_t n = 100000;
+        double before = heapBytes();
+        void* m = __tocin_map_new();
+        for (int64_t k = 0; k < n; ++k) __tocin_map_put(m, k * 7919, k);
+        double bytes = (heapBytes() - before) / (double)n;
+        __tocin_map_free(m);
+        return std::max(0.0, bytes);
+    });
+    // The runtime allocator recycles freed blocks, so the heap does not
+    // grow for these; count what they ask it for instead.
+    repeated("memory", "memory.string_16B_alloc_bytes", "bytes", [] {
+        const int n = 100000;
+        std::vector<char*> strs;
+        strs.reserve(n);
+        int64_t before[2], after[2];
+        __tocin_alloc_counts(before);
+        int64_t was = __tocin_alloc_counting(1);
+        for (int i = 0; i < n; ++i) strs.push_back(__tocin_buf_to_str("0123456789abcdef", 16));
+        __tocin_alloc_counting(was);
+        __tocin_alloc_counts(after);
+        for (char* s : strs) __tocin_str_free(s);
+        return (double)(after[1] - before[1]) / (double)n;
+    });
+    repeated("memory", "memory.goroutine_parked_rss", "bytes", [] {
+        const int n = 10000;
+        Parked p{__tocin_chan_new_cap(n), __tocin_chan_new_cap(n), __tocin_chan_new_cap(n)};
+        double before = residentBytes();
+        for (int i = 0; i < n; ++i) __tocin_go(parkUntilReleased, &p);
+        for (int i = 0; i < n; ++i) __tocin_chan_recv(p.started);
+        double bytes = (residentBytes() - before) / (double)n;
+        // Wait for every stack to be released, or the next sample would
+        // count their unmapping against its own goroutines.
+        for (int i = 0; i < n; ++i) __tocin_chan_send(p.release, 1);
+        for (int i = 0; i < n; ++i) __tocin_chan_recv(p.done);
+        return std::max(0.0, bytes);
+    });
+
+    if (g_opt.tocin.empty()) return;
+    const std::string big = writeWorkFile("large_mem.to", largeProgram(2000));
+    const std::string hello = writeWorkFile("hello_mem.to", kHello);
+    repeated("memory", "memory.compile_large_2000fn_O2_peak_rss", "bytes", [&] {
+        ProcessRun r = runProcess({g_opt.tocin, "-O2", big, "-o", g_workDir + "/mem.ll"});
+        return r.ns < 0.0 ? -1.0 : r.peakRssBytes;
+    });
+    repeated("memory", "memory.jit_hello_peak_rss", "bytes", [&] {
+        ProcessRun r = runProcess({g_opt.tocin, "--run", "--no-jit-cache", hello});
+        return r.ns < 0.0 ? -1.0 : r.peakRssBytes;
+    });
+}
+
+// ---------------------------------------------------------------------------
+// Reporting
+
+std::string human(double v, const std::string& unit) {
+    char buf[32];
+    if (unit == "bytes") {
+        if (v >= 1048576.0) std::snprintf(buf, sizeof buf, "%.1f MiB", v / 1048576.0);
+        else if (v >= 1024.0) std::snprintf(buf, sizeof buf, "%.1f KiB", v / 1024.0);
+        else std::snprintf(buf, sizeof buf, "%.0f B", v);
+    } else if (v >= 1e9) std::snprintf(buf, sizeof buf, "%.2f s", v / 1e9);
+    else if (v >= 1e6) std::snprintf(buf, sizeof buf, "%.2f ms", v / 1e6);
+    else if (v >= 1e3) std::snprintf(buf, sizeof buf, "%.2f us", v / 1e3);
+    else std::snprintf(buf, sizeof buf, "%.1f ns", v);
+    return buf;
+}
+
+struct Comparison {
+    const Result* result;
+    double baseMedian;
+    double ratio;
+    double p;
+    const char* verdict;
+};
+
+// Baseline samples by benchmark name, read from a file written by --out.
+bool readBaseline(const std::string& path, std::vector<std::pair<std::string, std::vector<double>>>* out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    tocin::runtime::JsonDocument doc;
+    if (!doc.parse(text.data(), text.size())) return false;
+    size_t results = doc.find(tocin::runtime::JsonDocument::kRoot, "results", 7);
+    for (size_t r = doc.first(results); r; r = doc.next(r)) {
+        const char* name = nullptr;
+        size_t len = 0;
+        if (!doc.string(doc.find(r, "name", 4), &name, &len)) continue;
+        std::vector<double> samples;
+        size_t arr = doc.find(r, "samples", 7);
+        for (size_t s = doc.first(arr); s; s = doc.next(s)) samples.push_back(doc.asFloat(s));
+        out->push_back({std::string(name, len), std::move(samples)});
+    }
+    return true;
+}
+
+std::vector<Comparison> compare(const std::vector<std::pair<std::string, std::vector<double>>>& base) {
+    std::vector<Comparison> out;
+    for (const Result& r : g_results) {
+        auto it = std::find_if(base.begin(), base.end(), [&](const auto& b) { return b.first == r.name; });
+        if (it == base.end() || it->second.empty()) continue;
+        double baseMedian = quantile(it->second, 0.5);
+        double ratio = baseMedian > 0.0 ? quantile(r.samples, 0.5) / baseMedian : 1.0;
+        double p = mannWhitneyP(r.samples, it->second);
+        const char* verdict = "same";
+        if (p < g_opt.alpha && ratio > 1.0 + g_opt.threshold) verdict = "REGRESSION";
+        else if (p < g_opt.alpha && ratio < 1.0 - g_opt.threshold) verdict = "improved";
+        out.push_back({&r, baseMedian, ratio, p, verdict});
+    }
+    return out;
+}
+
+void printTable(const std::vector<Comparison>& cmp) {
+    std::printf("%-44s %12s %12s %8s", "benchmark", "median", "p95", "stddev");
+    if (!cmp.empty()) std::printf(" %12s %7s %8s  %s", "baseline", "ratio", "p", "verdict");
+    std::printf("\n");
+    for (const Result& r : g_results) {
+        double med = quantile(r.samples, 0.5);
+        double cv = med > 0.0 ? stddev(r.samples) / med * 100.0 : 0.0;
+        std::printf("%-44s %12s %12s %7.1f%%", r.name.c_str(), human(med, r.unit).c_str(),
+                    human(quantile(r.samples, 0.95), r.unit).c_str(), cv);
+        for (const Comparison& c : cmp) {
+            if (c.result != &r) continue;
+            std::printf(" %12s %7.3f %8.4f  %s", human(c.baseMedian, r.unit).c_str(), c.ratio, c.p, c.verdict);
+        }
+        std::printf("\n");
+    }
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') out += '\\';
+        out += ch;
+    }
+    return out;
+}
+
+bool writeJson(const std::string& path, const std::vector<Comparison>& cmp) {
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "{\n  \"schema\": 1,\n  \"host\": {\"cpus\": %u, \"cxx\": \"%s\"},\n  \"results\": [\n",
+                 std::thread::hardware_concurrency(), jsonEscape(__VERSION__).c_str());
+    for (size_t i = 0; i < g_results.size(); ++i) {
+        const Result& r = g_results[i];
+        std::fprintf(f,
+                     "    {\"name\": \"%s\", \"suite\": \"%s\", \"unit\": \"%s\", \"median\": %.6g, "
+                     "\"p95\": %.6g, \"mean\": %.6g, \"stddev\": %.6g, \"min\": %.6g, \"samples\": [",
+                     r.name.c_str(), r.suite.c_str(), r.unit.c_str(), quantile(r.samples, 0.5),
+                     quantile(r.samples, 0.95), mean(r.samples), stddev(r.samples),
+                     *std::min_element(r.samples.begin(), r.samples.end()));
+        for (size_t s = 0; s < r.samples.size(); ++s) std::fprintf(f, "%s%.6g", s ? ", " : "", r.samples[s]);
+        std::fprintf(f, "]}%s\n", i + 1 < g_results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]");
+    if (!cmp.empty()) {
+        std::fprintf(f, ",\n  \"comparison\": [\n");
+        for (size_t i = 0; i < cmp.size(); ++i) {
+            const Comparison& c = cmp[i];
+            std::fprintf(f, "    {\"name\": \"%s\", \"baseline_median\": %.6g, \"ratio\": %.6g, \"p\": %.6g, "
+                            "\"verdict\": \"%s\"}%s\n",
+                         c.result->name.c_str(), c.baseMedian, c.ratio, c.p, c.verdict,
+                         i + 1 < cmp.size() ? "," : "");
+        }
+        std::fprintf(f, "  ]");
+    }
+    std::fprintf(f, "\n}\n");
+    return std::fclose(f) == 0;
+}
+
+void usage() {
+    std::printf(
+        "usage: tocin_bench [options]\n"
+        "  --suite LIST          comma-separated: compile,jit,runtime,memory (default all)\n"
+        "  --filter TEXT         only benchmarks whose name contains TEXT\n"
+        "  --samples N           timed batches per in-process benchmark (default 15)\n"
+        "  --process-samples N   runs per compile/JIT/peak-RSS benchmark (default 7)\n"
+        "  --min-sample-ms MS    calibrate each batch to at least MS (default 10)\n"
+        "  --tocin PATH          compiler to benchmark (default: the one built alongside)\n"
+        "  --source-dir DIR      repository root, for stdlib and benchmark programs\n"
+        "  --out FILE            write results as JSON (usable later as a baseline)\n"
+        "  --baseline FILE       compare with a previous --out; exit 1 on a regression\n"
+        "  --alpha P             significance level of the comparison (default 0.01)\n"
+        "  --threshold F         smallest median change that counts (default 0.05)\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (const char* env = std::getenv("TOCIN")) g_opt.tocin = env;
+    else g_opt.tocin = TOCIN_BENCH_COMPILER;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--suite") {
+            g_opt.suites.clear();
+            std::stringstream list(value());
+            for (std::string s; std::getline(list, s, ',');) g_opt.suites.push_back(s);
+        } else if (arg == "--filter") g_opt.filter = value();
+        else if (arg == "--samples") g_opt.samples = std::max(2, std::atoi(value().c_str()));
+        else if (arg == "--process-samples") g_opt.processSamples = std::max(2, std::atoi(value().c_str()));
+        else if (arg == "--min-sample-ms") g_opt.minSampleMs = std::atof(value().c_str());
+        else if (arg == "--tocin") g_opt.tocin = value();
+        else if (arg == "--source-dir") g_opt.sourceDir = value();
+        else if (arg == "--out") g_opt.out = value();
+        else if (arg == "--baseline") g_opt.baseline = value();
+        else if (arg == "--alpha") g_opt.alpha = std::atof(value().c_str());
+        else if (arg == "--threshold") g_opt.threshold = std::atof(value().c_str());
+        else if (arg == "--help" || arg == "-h") {
+            usage();
+            return 0;
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            usage();
+            return 2;
+        }
+    }
+    if (access(g_opt.tocin.c_str(), X_OK) != 0) {
+        std::fprintf(stderr, "no tocin binary at '%s': compile and JIT benchmarks skipped\n", g_opt.tocin.c_str());
+        g_opt.tocin.clear();
+    }
+
+    char tmpl[] = "/tmp/tocin_bench.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        std::perror("mkdtemp");
+        return 2;
+    }
+    g_workDir = tmpl;
+
+    if (!g_opt.tocin.empty() && suiteOn("compile")) compileSuite();
+    if (!g_opt.tocin.empty() && suiteOn("jit")) jitSuite();
+    if (suiteOn("runtime")) {
+        concurrencyBenchmarks();
+        stringBenchmarks();
+        collectionBenchmarks();
+        numericBenchmarks();
+        jsonBenchmarks();
+        httpBenchmarks();
+    }
+    if (suiteOn("memory")) memorySuite();
+
+    std::string rm = "rm -rf '" + g_workDir + "'";
+    if (std::system(rm.c_str()) != 0) std::fprintf(stderr, "could not remove %s\n", g_workDir.c_str());
+
+    std::vector<Comparison> cmp;
+    if (!g_opt.baseline.empty()) {
+        std::vector<std::pair<std::string, std::vector<double>>> base;
+        if (readBaseline(g_opt.baseline, &base)) cmp = compare(base);
+        else std::fprintf(stderr, "no readable baseline at %s: nothing compared\n", g_opt.baseline.c_str());
+    }
+    printTable(cmp);
+    if (!g_opt.out.empty() && !writeJson(g_opt.out, cmp)) {
+        std::fprintf(stderr, "could not write %s\n", g_opt.out.c_str());
+        return 2;
+    }
+    bool regressed = std::any_of(cmp.begin(), cmp.end(),
+                                 [](const Comparison& c) { return std::strcmp(c.verdict, "REGRESSION") == 0; });
+    return regressed ? 1 : 0;
+}
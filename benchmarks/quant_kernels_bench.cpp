@@ -0,0 +1,75 @@
+// Micro-benchmarks for the quantized matrix kernels (src/runtime/quant_kernels.h)
+//
+// Times a 4096 x 4096 layer times one input (the memory-bound inference
+// case) and times a batch of 32, in float64 through gemvF64 / gemmF64NT's
+// kernels and in every quantized format on every table the CPU supports.
+// Build with `cmake --build <dir> --target tocin_quant_bench`.
+
+#include "../src/runtime/linalg_kernels.h"
+#include "../src/runtime/quant_kernels.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace tocin::runtime;
+
+static const size_t kRows = 4096, kCols = 4096, kBatch = 32;
+
+// Seconds per call, best of five runs of `reps` calls.
+static double timeCall(int reps, const std::function<void()>& call) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) call();
+        auto end = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(end - start).count() / reps;
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+static void report(const char* op, const char* format, const char* impl, size_t bytes, double s) {
+    std::printf("%-7s %-6s %-11s %8.1f MiB %9.3f ms %8.2f GFLOP/s\n", op, format, impl, bytes / 1048576.0,
+                s * 1e3, (std::string(op) == "matvec" ? 1.0 : kBatch) * 2.0 * kRows * kCols / s / 1e9);
+}
+
+int main() {
+    std::vector<double> w(kRows * kCols), x(kBatch * kCols), y(kBatch * kRows);
+    for (size_t i = 0; i < w.size(); ++i) w[i] = std::sin(i * 1e-3);
+    for (size_t i = 0; i < x.size(); ++i) x[i] = std::cos(i * 1e-3);
+    volatile double sink = 0;
+
+    const LinalgKernels& lk = linalgKernels();
+    size_t f64Bytes = w.size() * sizeof(double);
+    report("matvec", "f64", lk.name, f64Bytes, timeCall(10, [&] {
+        gemv(lk, w.data(), x.data(), y.data(), kRows, kCols);
+        sink = y[7];
+    }));
+    report("matmul", "f64", lk.name, f64Bytes, timeCall(2, [&] {
+        gemm(lk, x.data(), w.data(), y.data(), kBatch, kCols, kRows, true);
+        sink = y[7];
+    }));
+
+    const struct { QuantFormat format; const char* name; } formats[] = {
+        {QuantFormat::Int8, "int8"}, {QuantFormat::Fp16, "fp16"}, {QuantFormat::Bf16, "bf16"}};
+    for (const auto& f : formats) {
+        QuantMatrix q;
+        quantizeMatrix(w.data(), kRows, kCols, f.format, q);
+        for (const QuantKernels* k : availableQuantKernels()) {
+            report("matvec", f.name, k->name, q.bytes(), timeCall(10, [&] {
+                quantMatVec(*k, q, x.data(), y.data());
+                sink = y[7];
+            }));
+            report("matmul", f.name, k->name, q.bytes(), timeCall(2, [&] {
+                quantMatMul(*k, q, x.data(), kBatch, y.data());
+                sink = y[7];
+            }));
+        }
+    }
+    (void)sink;
+    return 0;
+}
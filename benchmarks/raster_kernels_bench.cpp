@@ -0,0 +1,83 @@
+// Micro-benchmarks for the raster runtime kernels (src/runtime/raster_kernels.h)
+//
+// Times clearing a 1920x1080 framebuffer, a clipped rectangle, a circle,
+// blending a translucent rectangle and blitting a sprite on every kernel
+// table the CPU supports. The "bytes" rows are the per-pixel loops
+// game.graphics ran before: four byte stores per pixel, each pixel bounds-
+// checked. Build with `cmake --build <dir> --target tocin_raster_bench`.
+
+#include "../src/runtime/raster_kernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using tocin::runtime::Framebuffer;
+using tocin::runtime::RasterKernels;
+
+static const int64_t kWidth = 1920, kHeight = 1080;
+
+// Seconds per call, best of five runs of `reps` calls.
+static double timeCall(int reps, const std::function<void()>& call) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) call();
+        auto end = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(end - start).count() / reps;
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+static void report(const char* op, const char* impl, double pixels, double s) {
+    std::printf("%-8s %-7s %10.3f ms %8.2f Gpixel/s\n", op, impl, s * 1e3, pixels / s / 1e9);
+}
+
+// The former setPixel: clip, then one store per channel.
+static void bytePixel(uint8_t* fb, int64_t x, int64_t y, uint32_t c) {
+    if (x < 0 || y < 0 || x >= kWidth || y >= kHeight) return;
+    uint8_t* p = fb + (y * kWidth + x) * 4;
+    volatile uint8_t* v = p;  // keeps the byte stores the Tocin code made
+    v[0] = c & 255;
+    v[1] = c >> 8 & 255;
+    v[2] = c >> 16 & 255;
+    v[3] = c >> 24;
+}
+
+int main() {
+    std::vector<uint32_t> pixels(kWidth * kHeight);
+    std::vector<uint32_t> sprite(256 * 256, 0x80336699);
+    Framebuffer fb{pixels.data(), kWidth, kHeight};
+    auto* bytes = reinterpret_cast<uint8_t*>(pixels.data());
+
+    report("clear", "bytes", kWidth * kHeight, timeCall(5, [&] {
+        for (int64_t i = 0; i < kWidth * kHeight; ++i) bytePixel(bytes, i % kWidth, i / kWidth, 0xff000000);
+    }));
+    report("rect", "bytes", 920.0 * 580, timeCall(5, [&] {
+        for (int64_t y = 500; y < 1200; ++y)
+            for (int64_t x = 1000; x < 2000; ++x) bytePixel(bytes, x, y, 0xff00ff00);
+    }));
+    report("circle", "bytes", 3.14159 * 400 * 400, timeCall(5, [&] {
+        for (int64_t dy = -400; dy <= 400; ++dy)
+            for (int64_t dx = -400; dx <= 400; ++dx)
+                if (dx * dx + dy * dy <= 400 * 400) bytePixel(bytes, 960 + dx, 540 + dy, 0xff0000ff);
+    }));
+
+    for (const RasterKernels* k : tocin::runtime::availableRasterKernels()) {
+        report("clear", k->name, kWidth * kHeight,
+               timeCall(50, [&] { tocin::runtime::fillRect(*k, fb, 0, 0, kWidth, kHeight, 0xff000000); }));
+        report("rect", k->name, 920.0 * 580,
+               timeCall(50, [&] { tocin::runtime::fillRect(*k, fb, 1000, 500, 1000, 700, 0xff00ff00); }));
+        report("circle", k->name, 3.14159 * 400 * 400,
+               timeCall(50, [&] { tocin::runtime::fillCircle(*k, fb, 960, 540, 400, 0xff0000ff); }));
+        report("blend", k->name, 920.0 * 580,
+               timeCall(50, [&] { tocin::runtime::blendRect(*k, fb, 1000, 500, 1000, 700, 0x80ffffff); }));
+        report("blit", k->name, 256.0 * 256 * 16, timeCall(50, [&] {
+            for (int i = 0; i < 16; ++i)
+                tocin::runtime::blit(*k, fb, i * 100, i * 50, Framebuffer{sprite.data(), 256, 256}, true);
+        }));
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Micro-benchmarks for the scan runtime kernels (src/runtime/scan_kernels.h)
+//
+// Times sum, argmax, countEq, a search that misses and the lower bound on
+// every kernel table the CPU supports against the scalar loops
+// data.algorithms and std.linq used before, from an L1-resident list to one
+// well past the last-level cache. Build with
+// `cmake --build <dir> --target tocin_scan_bench`.
+
+#include "../src/runtime/scan_kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using tocin::runtime::ScanKernels;
+
+// Keeps results alive so the timed calls are not optimized away.
+static volatile int64_t g_sink;
+
+// Seconds per call, best of five runs of `reps` calls.
+static double timeCall(size_t reps, const std::function<int64_t()>& call) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < reps; ++r) g_sink = g_sink + call();
+        auto end = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(end - start).count() / reps;
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+static void report(const char* kernel, const char* impl, size_t n, double s) {
+    std::printf("%-8s %-7s %9zu %10.3f us %8.2f Gelem/s\n", kernel, impl, n, s * 1e6, n / s / 1e9);
+}
+
+// One lookup touches log2(n) elements, so searches report time per call.
+static void reportSearch(const char* impl, size_t n, double s) {
+    std::printf("%-8s %-7s %9zu %10.1f ns\n", "search", impl, n, s * 1e9);
+}
+
+// The loops the stdlib functions ran before, kept from being vectorized
+// the way the Tocin versions were not.
+__attribute__((noinline)) static int64_t scalarArgMax(const int64_t* a, size_t n) {
+    size_t best = 0;
+    for (size_t i = 1; i < n; ++i)
+        if (a[i] > a[best]) best = i;
+    return (int64_t)best;
+}
+
+__attribute__((noinline)) static int64_t scalarFind(const int64_t* a, size_t n, int64_t t) {
+    for (size_t i = 0; i < n; ++i)
+        if (a[i] == t) return (int64_t)i;
+    return -1;
+}
+
+__attribute__((noinline)) static int64_t scalarBinarySearch(const int64_t* a, size_t n, int64_t t) {
+    int64_t lo = 0, hi = (int64_t)n - 1;
+    while (lo <= hi) {
+        int64_t mid = (lo + hi) / 2;
+        if (a[mid] == t) return mid;
+        if (a[mid] < t) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+int main() {
+    for (size_t n : {size_t(1000), size_t(100000), size_t(10000000)}) {
+        std::vector<int64_t> v(n);
+        for (size_t i = 0; i < n; ++i) v[i] = (int64_t)((i * 2654435761u) % 1000003);
+        std::vector<int64_t> sorted = v;
+        std::sort(sorted.begin(), sorted.end());
+        size_t reps = std::max<size_t>(1, 10000000 / n);
+        // Independent lookups, as a join or a batch of point queries makes.
+        std::vector<int64_t> keys(4096);
+        for (size_t i = 0; i < keys.size(); ++i) keys[i] = (int64_t)((i * 40503u) % 1000003);
+        size_t next = 0;
+
+        report("argmax", "loop", n, timeCall(reps, [&] { return scalarArgMax(v.data(), n); }));
+        report("find", "loop", n, timeCall(reps, [&] { return scalarFind(v.data(), n, -1); }));
+        reportSearch("loop", n, timeCall(100000, [&] {
+            return scalarBinarySearch(sorted.data(), n, keys[next++ & 4095]);
+        }));
+        for (const ScanKernels* k : tocin::runtime::availableScanKernels()) {
+            report("sum", k->name, n, timeCall(reps, [&] { return k->sum(v.data(), n); }));
+            report("argmax", k->name, n, timeCall(reps, [&] {
+                return (int64_t)k->findEq(v.data(), n, k->max(v.data(), n));
+            }));
+            report("countEq", k->name, n, timeCall(reps, [&] { return (int64_t)k->countEq(v.data(), n, 7); }));
+            report("find", k->name, n, timeCall(reps, [&] { return (int64_t)k->findEq(v.data(), n, -1); }));
+            reportSearch(k->name, n, timeCall(100000, [&] {
+                return (int64_t)tocin::runtime::lowerBound(*k, sorted.data(), n, keys[next++ & 4095]);
+            }));
+        }
+    }
+    return 0;
+}
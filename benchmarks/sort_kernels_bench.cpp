@@ -0,0 +1,80 @@
+// Micro-benchmarks for the sort runtime kernels (src/runtime/sort_kernels.h)
+//
+// Times every int64 sort against std::sort and the recursive quicksort
+// data.algorithms used before, on random, already sorted and many-
+// duplicates inputs from a cache-resident size to several million
+// elements. Build with `cmake --build <dir> --target tocin_sort_bench`.
+
+#include "../src/runtime/sort_kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace sk = tocin::runtime;
+
+extern "C" void __tocin_parallel_init(int64_t num_threads);
+
+// Keeps results alive so the timed calls are not optimized away.
+static volatile int64_t g_sink;
+
+// Seconds to sort a fresh copy of `input`, best of five runs.
+static double timeSort(const std::vector<int64_t>& input, const std::function<void(int64_t*, size_t)>& sort) {
+    double best = 1e300;
+    std::vector<int64_t> v;
+    for (int run = 0; run < 5; ++run) {
+        v = input;
+        auto start = std::chrono::steady_clock::now();
+        sort(v.data(), v.size());
+        auto end = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(end - start).count();
+        if (s < best) best = s;
+    }
+    g_sink = g_sink + v[v.size() / 2];
+    return best;
+}
+
+// The former data.algorithms sort: middle pivot, Hoare-style partition.
+static void oldQuicksort(int64_t* a, int64_t lo, int64_t hi) {
+    if (lo >= hi) return;
+    int64_t pivot = a[(lo + hi) / 2], i = lo, j = hi;
+    while (i <= j) {
+        while (a[i] < pivot) ++i;
+        while (a[j] > pivot) --j;
+        if (i <= j) std::swap(a[i++], a[j--]);
+    }
+    oldQuicksort(a, lo, j);
+    oldQuicksort(a, i, hi);
+}
+
+int main() {
+    __tocin_parallel_init(0);
+    const char* shapes[] = {"random", "sorted", "dups"};
+    std::mt19937_64 rng(42);
+    for (size_t n : {size_t(10000), size_t(1000000), size_t(8000000)}) {
+        for (int shape = 0; shape < 3; ++shape) {
+            std::vector<int64_t> input(n);
+            for (size_t i = 0; i < n; ++i)
+                input[i] = shape == 0 ? static_cast<int64_t>(rng()) : shape == 1 ? static_cast<int64_t>(i)
+                                                                                 : static_cast<int64_t>(rng() % 16);
+            struct Impl { const char* name; std::function<void(int64_t*, size_t)> sort; };
+            Impl impls[] = {
+                {"old-qsort", [](int64_t* a, size_t m) { oldQuicksort(a, 0, static_cast<int64_t>(m) - 1); }},
+                {"std::sort", [](int64_t* a, size_t m) { std::sort(a, a + m); }},
+                {"pdqsort", [](int64_t* a, size_t m) { sk::pdqsort(a, m); }},
+                {"radix", [](int64_t* a, size_t m) { sk::radixSort(a, m); }},
+                {"stable", [](int64_t* a, size_t m) { sk::stableSort(a, m); }},
+                {"parallel", [](int64_t* a, size_t m) { sk::parallelSort(a, m); }},
+            };
+            for (const Impl& impl : impls) {
+                double s = timeSort(input, impl.sort);
+                std::printf("%-7s %8zu %-10s %10.3f ms %8.1f Melem/s\n", shapes[shape], n, impl.name, s * 1e3,
+                            n / s / 1e6);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Micro-benchmarks for the string runtime kernels (src/runtime/string_kernels.h)
+//
+// Times every kernel table the CPU supports against the C library and the
+// byte loops the runtime used before, at sizes from a short token to a large
+// request body. Build with `cmake --build <dir> --target tocin_string_bench`.
+
+#include "../src/runtime/string_kernels.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using tocin::runtime::StringKernels;
+
+// Keeps results alive so the timed calls are not optimized away.
+static volatile uint64_t g_sink;
+
+// Nanoseconds per call, best of five runs of `reps` calls.
+static double timeCall(size_t reps, const std::function<uint64_t()>& call) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        uint64_t acc = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < reps; ++i) acc += call();
+        auto end = std::chrono::steady_clock::now();
+        g_sink = g_sink + acc;
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / (double)reps;
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+static void report(const char* kernel, const char* impl, size_t n, double ns) {
+    std::printf("%-10s %-6s %7zu B %10.1f ns %8.2f GB/s\n", kernel, impl, n, ns, (double)n / ns);
+}
+
+// Text shaped like a JSON/HTTP payload: mixed case, punctuation, no NULs.
+static std::string payload(size_t n) {
+    static const char text[] = "{\"Name\": \"Widget\", \"Count\": 42, \"Tags\": [\"a\", \"b\"]}\r\n";
+    std::string s;
+    while (s.size() < n) s += text;
+    s.resize(n);
+    return s;
+}
+
+int main() {
+    const size_t sizes[] = {16, 64, 256, 4096, 65536};
+    const auto tables = tocin::runtime::availableStringKernels();
+    std::printf("runtime uses: %s\n\n", tocin::runtime::stringKernels().name);
+
+    for (size_t n : sizes) {
+        const std::string text = payload(n);
+        std::string other = text;
+        const char* s = text.c_str();
+        const char* t = other.c_str();
+        // Absent byte and needle: every call scans the whole string.
+        const char* needle = "\"Missing\":";
+        const size_t m = std::strlen(needle);
+        std::vector<char> out(n + 1);
+        const size_t reps = 2000000 / (n / 16 + 1) + 100;
+
+        report("length", "libc", n, timeCall(reps, [&] { return (uint64_t)std::strlen(s); }));
+        for (const auto* k : tables)
+            report("length", k->name, n, timeCall(reps, [&] { return (uint64_t)k->length(s); }));
+
+        report("findByte", "loop", n, timeCall(reps, [&] {
+            for (int64_t i = 0; s[i]; ++i)
+                if (s[i] == '~') return (uint64_t)i;
+            return (uint64_t)0;
+        }));
+        report("findByte", "libc", n, timeCall(reps, [&] { return (uint64_t)(uintptr_t)std::strchr(s, '~'); }));
+        for (const auto* k : tables)
+            report("findByte", k->name, n, timeCall(reps, [&] { return (uint64_t)(uintptr_t)k->findByte(s, '~'); }));
+
+        report("find", "libc", n, timeCall(reps, [&] { return (uint64_t)(uintptr_t)std::strstr(s, needle); }));
+        for (const auto* k : tables)
+            report("find", k->name, n, timeCall(reps, [&] {
+                return (uint64_t)(uintptr_t)k->find(s, k->length(s), needle, m);
+            }));
+
+        report("equal", "libc", n, timeCall(reps, [&] { return (uint64_t)(std::strcmp(s, t) == 0); }));
+        for (const auto* k : tables)
+            report("equal", k->name, n, timeCall(reps, [&] { return (uint64_t)k->equal(s, t); }));
+
+        report("toUpper", "loop", n, timeCall(reps, [&] {
+            for (size_t i = 0; i < n; ++i) out[i] = (char)std::toupper((unsigned char)s[i]);
+            return (uint64_t)out[n / 2];
+        }));
+        for (const auto* k : tables)
+            report("toUpper", k->name, n, timeCall(reps, [&] {
+                k->toUpper(out.data(), s, n);
+                return (uint64_t)out[n / 2];
+            }));
+        std::printf("\n");
+    }
+    return 0;
+}
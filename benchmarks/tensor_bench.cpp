@@ -0,0 +1,98 @@
+// Micro-benchmarks for the tensor evaluator (src/runtime/tensor.h)
+//
+// Times sigmoid(x * w + b) - y over 4M elements, and its sum, as one fused
+// expression on every kernel table the CPU supports. The "passes" rows are
+// what ml.deep_learning's tensorAdd / tensorScale style does: one loop and
+// one full buffer per operation. Build with `cmake --build <dir> --target
+// tocin_tensor_bench`.
+
+#include "../src/runtime/tensor.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+using namespace tocin::runtime;
+
+static const int64_t kRows = 2048, kCols = 2048;
+
+// Seconds per call, best of five runs of `reps` calls.
+static double timeCall(int reps, const std::function<void()>& call) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < reps; ++r) call();
+        auto end = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(end - start).count() / reps;
+        if (s < best) best = s;
+    }
+    return best;
+}
+
+static void report(const char* op, const char* impl, double n, double s) {
+    std::printf("%-8s %-7s %9.3f ms %8.1f Melem/s\n", op, impl, s * 1e3, n / s / 1e6);
+}
+
+int main() {
+    const int64_t n = kRows * kCols;
+    const int64_t dims[] = {kRows, kCols};
+    TensorShape shape;
+    makeTensorShape(dims, 2, shape);
+    Tensor x = tensorZeros(shape), w = tensorZeros(shape), y = tensorZeros(shape), out = tensorZeros(shape);
+    const int64_t bdim[] = {kCols};
+    TensorShape bshape;
+    makeTensorShape(bdim, 1, bshape);
+    Tensor b = tensorZeros(bshape);
+    for (int64_t i = 0; i < n; ++i) {
+        x.data()[i] = std::sin(i * 1e-3);
+        w.data()[i] = std::cos(i * 1e-3);
+        y.data()[i] = 0.5;
+    }
+    for (int64_t j = 0; j < kCols; ++j) b.data()[j] = j * 1e-4;
+    volatile double sink = 0;
+
+    std::vector<double> t1(n), t2(n), t3(n), t4(n);
+    report("expr", "passes", n, timeCall(3, [&] {
+        const double *px = x.data(), *pw = w.data(), *py = y.data(), *pb = b.data();
+        for (int64_t i = 0; i < n; ++i) t1[i] = px[i] * pw[i];
+        for (int64_t i = 0; i < n; ++i) t2[i] = t1[i] + pb[i % kCols];
+        for (int64_t i = 0; i < n; ++i) t3[i] = 1.0 / (1.0 + std::exp(-t2[i]));
+        for (int64_t i = 0; i < n; ++i) t4[i] = t3[i] - py[i];
+        sink = t4[7];
+    }));
+
+    for (const TensorKernels* k : availableTensorKernels()) {
+        auto build = [&] {
+            Tensor m, s, sg, d;
+            tensorBinary(TensorBinaryOp::Mul, x, w, m);
+            tensorBinary(TensorBinaryOp::Add, m, b, s);
+            tensorUnary(TensorUnaryOp::Sigmoid, s, sg);
+            tensorBinary(TensorBinaryOp::Sub, sg, y, d);
+            return d;
+        };
+        report("expr", k->name, n, timeCall(3, [&] {
+            Tensor d = build();
+            tensorAssign(*k, out, d);
+            sink = out.data()[7];
+        }));
+        report("sum", k->name, n, timeCall(3, [&] {
+            Tensor d = build();
+            sink = tensorSum(*k, d);
+        }));
+        report("add", k->name, n, timeCall(5, [&] {
+            Tensor s;
+            tensorBinary(TensorBinaryOp::Add, x, w, s);
+            tensorAssign(*k, out, s);
+            sink = out.data()[7];
+        }));
+    }
+    report("add", "passes", n, timeCall(5, [&] {
+        const double *px = x.data(), *pw = w.data();
+        for (int64_t i = 0; i < n; ++i) t1[i] = px[i] + pw[i];
+        sink = t1[7];
+    }));
+    (void)sink;
+    return 0;
+}
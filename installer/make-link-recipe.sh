@@ -28,6 +28,8 @@ RUNTIME=""
 GC=""
 STATIC=0
 EXTRA="-lm -lpthread -lstdc++"
+# The runtime's profiler symbolizes with dladdr, in libdl before glibc 2.34.
+[ "$(uname -s)" = Linux ] && EXTRA="$EXTRA -ldl"
 # KEEP_SYS=1 keeps the toolchain's original -L search dirs and relies on the
 # target's system libs (libc/libgcc_s/...) at link time - correct on Linux/macOS,
 # where those always exist. KEEP_SYS=0 (the Windows default) collapses search to
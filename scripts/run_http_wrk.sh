@@ -0,0 +1,66 @@
+#!/usr/bin/env bash
+#
+# run_http_wrk.sh - load-test web/http's serveParsed with wrk.
+#
+# Starts benchmarks/benchmark_http_parser.to in its serving mode
+# (HTTP_BENCH_PORT set) under the tocin JIT, waits for it to listen, runs
+# wrk against GET /plaintext (with a pipelining script when DEPTH > 1),
+# then stops the server.
+#
+# Environment overrides:
+#   TOCIN     path to the tocin binary   (default: <build>/tocin)
+#   PORT      port to serve on           (default: 18510)
+#   THREADS   wrk threads                (default: 4)
+#   CONNS     wrk connections            (default: 256)
+#   DURATION  wrk duration               (default: 10s)
+#   DEPTH     requests pipelined per write (default: 1)
+
+set -u
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+REPO_ROOT="$(cd "${SCRIPT_DIR}/.." && pwd)"
+
+TOCIN="${TOCIN:-${REPO_ROOT}/build/tocin}"
+PORT="${PORT:-18510}"
+THREADS="${THREADS:-4}"
+CONNS="${CONNS:-256}"
+DURATION="${DURATION:-10s}"
+DEPTH="${DEPTH:-1}"
+
+if ! command -v wrk >/dev/null 2>&1; then
+    echo "wrk not found in PATH" >&2
+    exit 2
+fi
+if [ ! -x "${TOCIN}" ]; then
+    echo "tocin binary not found at ${TOCIN} (set TOCIN)" >&2
+    exit 2
+fi
+
+HTTP_BENCH_PORT="${PORT}" "${TOCIN}" "${REPO_ROOT}/benchmarks/benchmark_http_parser.to" --run &
+SERVER=$!
+trap 'kill ${SERVER} 2>/dev/null; wait ${SERVER} 2>/dev/null' EXIT
+
+for _ in $(seq 1 100); do
+    if (exec 3<>"/dev/tcp/127.0.0.1/${PORT}") 2>/dev/null; then break; fi
+    sleep 0.1
+done
+
+URL="http://127.0.0.1:${PORT}/plaintext"
+if [ "${DEPTH}" -gt 1 ]; then
+    LUA="$(mktemp)"
+    cat >"${LUA}" <<EOF
+init = function(args)
+    local r = {}
+    for i = 1, ${DEPTH} do r[i] = wrk.format(nil, "/plaintext") end
+    req = table.concat(r)
+end
+request = function() return req end
+EOF
+    wrk -t"${THREADS}" -c"${CONNS}" -d"${DURATION}" -s "${LUA}" "${URL}"
+    STATUS=$?
+    rm -f "${LUA}"
+else
+    wrk -t"${THREADS}" -c"${CONNS}" -d"${DURATION}" "${URL}"
+    STATUS=$?
+fi
+exit ${STATUS}
@@ -8,8 +8,9 @@
 #
 #   // expect: <int>             expected process exit code (0-255)
 #   // expect-output: <text>     expected exact stdout (single line)
+#   // flags: <args>             extra compiler arguments (optional)
 #
-# A file must declare at least one of the two. Both may be given.
+# A file must declare at least one of the first two. Both may be given.
 #
 # How a .to program is "run":
 #   `tocin FILE -o OUT` emits LLVM IR to OUT.ll. We then execute that IR with
@@ -126,6 +127,7 @@ parse_expectations() {
     EXP_OUTPUT=""
     HAS_EXIT=0
     HAS_OUTPUT=0
+    FLAGS=""
     local line
     while IFS= read -r line; do
         case "${line}" in
@@ -140,6 +142,9 @@ parse_expectations() {
                 EXP_EXIT="$(echo "${EXP_EXIT}" | tr -d '[:space:]')"
                 HAS_EXIT=1
                 ;;
+            *"// flags:"*)
+                FLAGS="${line#*// flags:}"
+                ;;
         esac
     done < "${file}"
 }
@@ -176,7 +181,8 @@ for tofile in "${CASE_FILES[@]}"; do
     # appends ".ll" when the output path contains no '.' at all, which is
     # unreliable when the temp directory name contains a dot, so name the
     # target file ourselves.
-    if ! "${TOCIN_BIN}" "${tofile}" -o "${ll}" > "${base}.compile.log" 2>&1; then
+    # shellcheck disable=SC2086 # FLAGS is a word list
+    if ! "${TOCIN_BIN}" ${FLAGS} "${tofile}" -o "${ll}" > "${base}.compile.log" 2>&1; then
         echo "FAIL  ${name}  (compiler returned non-zero)"
         sed 's/^/        /' "${base}.compile.log" | head -5
         FAIL=$((FAIL + 1)); FAILED_NAMES+=("${name}")
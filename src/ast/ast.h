@@ -171,15 +171,82 @@ namespace ast
         std::vector<std::shared_ptr<TraitType>> constraints;
     };
 
+    /**
+     * @brief Discriminator for the concrete class of a Node.
+     *
+     * Set once by each node's constructor and read through ast::isa /
+     * ast::dyn_cast, which replace dynamic_cast on the passes that switch
+     * over node types: a byte compare instead of an RTTI walk, and no
+     * refcount traffic when the test fails. Expressions and statements each
+     * occupy a contiguous range, so Expression::classof and
+     * Statement::classof are range checks.
+     */
+    enum class NodeKind : uint8_t
+    {
+        // Expressions
+        BinaryExpr,
+        GroupingExpr,
+        ConditionalExpr,
+        LiteralExpr,
+        UnaryExpr,
+        VariableExpr,
+        AssignExpr,
+        CallExpr,
+        GetExpr,
+        SetExpr,
+        ListExpr,
+        DictionaryExpr,
+        LambdaExpr,
+        AwaitExpr,
+        NewExpr,
+        DeleteExpr,
+        StringInterpolationExpr,
+        ChannelSendExpr,
+        ChannelReceiveExpr,
+        ArrayLiteralExpr,
+        IndexExpr,
+        OtherExpr, // an Expression subclass without a kind of its own
+        // Statements
+        ExpressionStmt,
+        VariableStmt,
+        BlockStmt,
+        IfStmt,
+        WhileStmt,
+        ForStmt,
+        FunctionStmt,
+        ReturnStmt,
+        ClassStmt,
+        ImportStmt,
+        ExportStmt,
+        ModuleStmt,
+        MatchStmt,
+        SelectStmt,
+        GoStmt,
+        EnumStmt,
+        TryStmt,
+        ThrowStmt,
+        BreakStmt,
+        ContinueStmt,
+        DeferStmt,
+        DestructureStmt,
+        TraitStmt,
+        ImplStmt,
+        OtherStmt,
+    };
+
     /**
      * @brief Base class for all AST nodes.
      */
     class Node
     {
     public:
-        explicit Node(const lexer::Token &token) : token(token) {}
+        Node(const lexer::Token &token, NodeKind kind) : token(token), kind_(kind) {}
         virtual ~Node() = default;
+        NodeKind kind() const { return kind_; }
         lexer::Token token;
+
+    private:
+        NodeKind kind_;
     };
 
     /**
@@ -189,11 +256,11 @@ namespace ast
     {
     public:
         SimpleType(const lexer::Token &token) : Type(token) {}
-        std::string toString() const override { return token.value; }
+        std::string toString() const override { return std::string(token.value); }
 
         TypePtr clone() const override
         {
-            return std::make_shared<SimpleType>(token);
+            return ast::make<SimpleType>(token);
         }
     };
 
@@ -235,7 +302,7 @@ namespace ast
             {
                 clonedTypes.push_back(type->clone());
             }
-            return std::make_shared<UnionType>(token, clonedTypes);
+            return ast::make<UnionType>(token, clonedTypes);
         }
 
         std::vector<TypePtr> types;
@@ -254,7 +321,7 @@ namespace ast
 
         TypePtr clone() const override
         {
-            return std::make_shared<ClassType>(token, name);
+            return ast::make<ClassType>(token, name);
         }
 
         std::string name;
@@ -296,27 +363,73 @@ namespace ast
     class Expression : public Node
     {
     public:
-        explicit Expression(const lexer::Token &token) : Node(token) {}
+        explicit Expression(const lexer::Token &token, NodeKind kind = NodeKind::OtherExpr) : Node(token, kind) {}
         virtual void accept(Visitor &visitor) = 0;
         virtual TypePtr getType() const = 0;
+
+        static bool classof(const Node *node)
+        {
+            return node->kind() >= NodeKind::BinaryExpr && node->kind() <= NodeKind::OtherExpr;
+        }
     };
 
     // Base class for statements.
     class Statement : public Node
     {
     public:
-        explicit Statement(const lexer::Token &token) : Node(token) {}
+        explicit Statement(const lexer::Token &token, NodeKind kind = NodeKind::OtherStmt) : Node(token, kind) {}
         virtual void accept(Visitor &visitor) = 0;
+
+        static bool classof(const Node *node)
+        {
+            return node->kind() >= NodeKind::ExpressionStmt && node->kind() <= NodeKind::OtherStmt;
+        }
     };
 
+    /**
+     * @brief LLVM-style checked casts over NodeKind.
+     *
+     * isa<T>(n) tests the kind; dyn_cast<T>(n) returns a T* or nullptr;
+     * dyn_pointer_cast<T>(p) is the kind-checked std::dynamic_pointer_cast
+     * for callers that keep the shared_ptr. All accept null, like the casts
+     * they replace.
+     */
+    template <typename T>
+    inline bool isa(const Node *node) { return node && T::classof(node); }
+
+    template <typename T, typename U>
+    inline bool isa(const std::shared_ptr<U> &node) { return isa<T>(node.get()); }
+
+    template <typename T>
+    inline T *dyn_cast(Node *node) { return isa<T>(node) ? static_cast<T *>(node) : nullptr; }
+
+    template <typename T>
+    inline const T *dyn_cast(const Node *node) { return isa<T>(node) ? static_cast<const T *>(node) : nullptr; }
+
+    template <typename T, typename U>
+    inline T *dyn_cast(const std::shared_ptr<U> &node) { return dyn_cast<T>(node.get()); }
+
+    // A raw pointer into a temporary shared_ptr would dangle; keep it with
+    // dyn_pointer_cast instead.
+    template <typename T, typename U>
+    T *dyn_cast(std::shared_ptr<U> &&node) = delete;
+
+    template <typename T, typename U>
+    inline std::shared_ptr<T> dyn_pointer_cast(const std::shared_ptr<U> &node)
+    {
+        return isa<T>(node.get()) ? std::static_pointer_cast<T>(node) : nullptr;
+    }
+
     /**
      * @brief Binary expression (e.g., a + b).
      */
     class BinaryExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::BinaryExpr; }
+
         BinaryExpr(const lexer::Token &token, ExprPtr left, lexer::Token op, ExprPtr right)
-            : Expression(token), left(std::move(left)), op(std::move(op)), right(std::move(right)) {}
+            : Expression(token, NodeKind::BinaryExpr), left(std::move(left)), op(std::move(op)), right(std::move(right)) {}
         void accept(Visitor &visitor) override;
         ExprPtr left;
         lexer::Token op;
@@ -330,8 +443,10 @@ namespace ast
     class GroupingExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::GroupingExpr; }
+
         GroupingExpr(const lexer::Token &token, ExprPtr expression)
-            : Expression(token), expression(std::move(expression)) {}
+            : Expression(token, NodeKind::GroupingExpr), expression(std::move(expression)) {}
         void accept(Visitor &visitor) override;
         ExprPtr expression;
         TypePtr getType() const override { return expression ? expression->getType() : nullptr; }
@@ -344,9 +459,11 @@ namespace ast
     class ConditionalExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ConditionalExpr; }
+
         ConditionalExpr(const lexer::Token &token, ExprPtr condition,
                         ExprPtr thenExpr, ExprPtr elseExpr)
-            : Expression(token), condition(std::move(condition)),
+            : Expression(token, NodeKind::ConditionalExpr), condition(std::move(condition)),
               thenExpr(std::move(thenExpr)), elseExpr(std::move(elseExpr)) {}
         void accept(Visitor &visitor) override;
         ExprPtr condition;
@@ -361,6 +478,8 @@ namespace ast
     class LiteralExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::LiteralExpr; }
+
         enum class LiteralType
         {
             INTEGER,
@@ -370,7 +489,7 @@ namespace ast
             NIL
         };
         LiteralExpr(const lexer::Token &token, const std::string &value, LiteralType literalType)
-            : Expression(token), value(value), literalType(literalType) {}
+            : Expression(token, NodeKind::LiteralExpr), value(value), literalType(literalType) {}
         void accept(Visitor &visitor) override;
         std::string value;
         LiteralType literalType;
@@ -383,8 +502,10 @@ namespace ast
     class UnaryExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::UnaryExpr; }
+
         UnaryExpr(const lexer::Token &token, lexer::Token op, ExprPtr right)
-            : Expression(token), op(std::move(op)), right(std::move(right)) {}
+            : Expression(token, NodeKind::UnaryExpr), op(std::move(op)), right(std::move(right)) {}
         void accept(Visitor &visitor) override;
         lexer::Token op;
         ExprPtr right;
@@ -397,8 +518,10 @@ namespace ast
     class VariableExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::VariableExpr; }
+
         VariableExpr(const lexer::Token &token, const std::string &name)
-            : Expression(token), name(name) {}
+            : Expression(token, NodeKind::VariableExpr), name(name) {}
         void accept(Visitor &visitor) override;
         std::string name;
         TypePtr getType() const override { return nullptr; }
@@ -410,13 +533,15 @@ namespace ast
     class AssignExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::AssignExpr; }
+
         // Legacy constructor for simple variable assignments
         AssignExpr(const lexer::Token &token, const std::string &name, ExprPtr value)
-            : Expression(token), name(name), value(std::move(value)), target(std::make_shared<VariableExpr>(token, name)) {}
+            : Expression(token, NodeKind::AssignExpr), name(name), value(std::move(value)), target(ast::make<VariableExpr>(token, name)) {}
 
         // New constructor for extended assignments (obj.prop = val, arr[i] = val, etc.)
         AssignExpr(const lexer::Token &token, ExprPtr target, ExprPtr value)
-            : Expression(token), name(""), target(std::move(target)), value(std::move(value)) {}
+            : Expression(token, NodeKind::AssignExpr), name(""), target(std::move(target)), value(std::move(value)) {}
 
         void accept(Visitor &visitor) override;
         std::string name; // Kept for backward compatibility
@@ -434,8 +559,10 @@ namespace ast
     class CallExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::CallExpr; }
+
         CallExpr(const lexer::Token &token, ExprPtr callee, std::vector<ExprPtr> arguments)
-            : Expression(token), callee(std::move(callee)), arguments(std::move(arguments)) {}
+            : Expression(token, NodeKind::CallExpr), callee(std::move(callee)), arguments(std::move(arguments)) {}
         void accept(Visitor &visitor) override;
         ExprPtr callee;
         std::vector<ExprPtr> arguments;
@@ -448,8 +575,10 @@ namespace ast
     class GetExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::GetExpr; }
+
         GetExpr(const lexer::Token &token, ExprPtr object, const std::string &name, bool isSafe = false)
-            : Expression(token), object(std::move(object)), name(name), isSafe(isSafe) {}
+            : Expression(token, NodeKind::GetExpr), object(std::move(object)), name(name), isSafe(isSafe) {}
         void accept(Visitor &visitor) override;
         ExprPtr object;
         std::string name;
@@ -463,8 +592,10 @@ namespace ast
     class SetExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::SetExpr; }
+
         SetExpr(const lexer::Token &token, ExprPtr object, const std::string &name, ExprPtr value)
-            : Expression(token), object(std::move(object)), name(name), value(std::move(value)) {}
+            : Expression(token, NodeKind::SetExpr), object(std::move(object)), name(name), value(std::move(value)) {}
         void accept(Visitor &visitor) override;
         ExprPtr object;
         std::string name;
@@ -478,8 +609,10 @@ namespace ast
     class ListExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ListExpr; }
+
         ListExpr(const lexer::Token &token, std::vector<ExprPtr> elements)
-            : Expression(token), elements(std::move(elements)) {}
+            : Expression(token, NodeKind::ListExpr), elements(std::move(elements)) {}
         void accept(Visitor &visitor) override;
         std::vector<ExprPtr> elements;
         TypePtr getType() const override { return nullptr; }
@@ -491,8 +624,10 @@ namespace ast
     class DictionaryExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::DictionaryExpr; }
+
         DictionaryExpr(const lexer::Token &token, std::vector<std::pair<ExprPtr, ExprPtr>> entries)
-            : Expression(token), entries(std::move(entries)) {}
+            : Expression(token, NodeKind::DictionaryExpr), entries(std::move(entries)) {}
         void accept(Visitor &visitor) override;
         std::vector<std::pair<ExprPtr, ExprPtr>> entries;
         TypePtr getType() const override { return nullptr; }
@@ -504,8 +639,10 @@ namespace ast
     class LambdaExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::LambdaExpr; }
+
         LambdaExpr(const lexer::Token &token, std::vector<Parameter> parameters, TypePtr returnType, ExprPtr body)
-            : Expression(token), parameters(std::move(parameters)), returnType(std::move(returnType)), body(std::move(body))
+            : Expression(token, NodeKind::LambdaExpr), parameters(std::move(parameters)), returnType(std::move(returnType)), body(std::move(body))
         {
             // Check the member, not the moved-from `returnType` parameter.
             if (!this->returnType)
@@ -526,8 +663,10 @@ namespace ast
     class AwaitExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::AwaitExpr; }
+
         AwaitExpr(const lexer::Token &token, ExprPtr expression)
-            : Expression(token), expression(std::move(expression)) {}
+            : Expression(token, NodeKind::AwaitExpr), expression(std::move(expression)) {}
         void accept(Visitor &visitor) override;
         ExprPtr expression;
         TypePtr getType() const override { return expression ? expression->getType() : nullptr; }
@@ -539,8 +678,10 @@ namespace ast
     class ExpressionStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ExpressionStmt; }
+
         ExpressionStmt(const lexer::Token &token, ExprPtr expression)
-            : Statement(token), expression(std::move(expression)) {}
+            : Statement(token, NodeKind::ExpressionStmt), expression(std::move(expression)) {}
         void accept(Visitor &visitor) override;
         ExprPtr expression;
     };
@@ -551,8 +692,10 @@ namespace ast
     class VariableStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::VariableStmt; }
+
         VariableStmt(const lexer::Token &token, const std::string &name, TypePtr type, ExprPtr initializer, bool isConstant)
-            : Statement(token), name(name), type(std::move(type)), initializer(std::move(initializer)), isConstant(isConstant) {}
+            : Statement(token, NodeKind::VariableStmt), name(name), type(std::move(type)), initializer(std::move(initializer)), isConstant(isConstant) {}
         void accept(Visitor &visitor) override;
         std::string name;
         TypePtr type;
@@ -566,8 +709,10 @@ namespace ast
     class BlockStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::BlockStmt; }
+
         BlockStmt(const lexer::Token &token, std::vector<StmtPtr> statements)
-            : Statement(token), statements(std::move(statements)) {}
+            : Statement(token, NodeKind::BlockStmt), statements(std::move(statements)) {}
         void accept(Visitor &visitor) override;
         std::vector<StmtPtr> statements;
     };
@@ -578,9 +723,11 @@ namespace ast
     class IfStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::IfStmt; }
+
         IfStmt(const lexer::Token &token, ExprPtr condition, StmtPtr thenBranch,
                std::vector<std::pair<ExprPtr, StmtPtr>> elifBranches, StmtPtr elseBranch)
-            : Statement(token), condition(std::move(condition)), thenBranch(std::move(thenBranch)),
+            : Statement(token, NodeKind::IfStmt), condition(std::move(condition)), thenBranch(std::move(thenBranch)),
               elifBranches(std::move(elifBranches)), elseBranch(std::move(elseBranch)) {}
         void accept(Visitor &visitor) override;
         ExprPtr condition;
@@ -595,8 +742,10 @@ namespace ast
     class WhileStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::WhileStmt; }
+
         WhileStmt(const lexer::Token &token, ExprPtr condition, StmtPtr body)
-            : Statement(token), condition(std::move(condition)), body(std::move(body)) {}
+            : Statement(token, NodeKind::WhileStmt), condition(std::move(condition)), body(std::move(body)) {}
         void accept(Visitor &visitor) override;
         ExprPtr condition;
         StmtPtr body;
@@ -609,8 +758,10 @@ namespace ast
     class ForStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ForStmt; }
+
         ForStmt(const lexer::Token &token, const std::string &variable, TypePtr variableType, ExprPtr iterable, StmtPtr body)
-            : Statement(token), variable(variable), variableType(std::move(variableType)),
+            : Statement(token, NodeKind::ForStmt), variable(variable), variableType(std::move(variableType)),
               iterable(std::move(iterable)), body(std::move(body)) {}
         void accept(Visitor &visitor) override;
         std::string variable;
@@ -618,6 +769,11 @@ namespace ast
         ExprPtr iterable;
         StmtPtr body;
         std::string label; // optional loop label for labeled break/continue
+        // `parallel for v in a..b reduce(op: acc) { ... }`: iterations run on
+        // the parallel pool; `acc` (if any) is combined across threads with op.
+        bool parallel = false;
+        std::string reduceOp;  // "+", "*", "min", "max", "&", "|", "^" or empty
+        std::string reduceVar;
     };
 
     /**
@@ -626,9 +782,11 @@ namespace ast
     class FunctionStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::FunctionStmt; }
+
         FunctionStmt(const lexer::Token &token, const std::string &name, std::vector<Parameter> parameters,
                      TypePtr returnType, StmtPtr body, bool isAsync)
-            : Statement(token), name(name), typeParameters(), parameters(std::move(parameters)),
+            : Statement(token, NodeKind::FunctionStmt), name(name), typeParameters(), parameters(std::move(parameters)),
               returnType(std::move(returnType)), body(std::move(body)), isAsync(isAsync) {}
 
         // Constructor with generic type parameters
@@ -636,7 +794,7 @@ namespace ast
                      std::vector<TypeParameter> typeParameters,
                      std::vector<Parameter> parameters,
                      TypePtr returnType, StmtPtr body, bool isAsync)
-            : Statement(token), name(name), typeParameters(std::move(typeParameters)),
+            : Statement(token, NodeKind::FunctionStmt), name(name), typeParameters(std::move(typeParameters)),
               parameters(std::move(parameters)), returnType(std::move(returnType)),
               body(std::move(body)), isAsync(isAsync) {}
 
@@ -653,6 +811,23 @@ namespace ast
         // `interrupt` uses the x86 interrupt calling convention for ISR handlers.
         bool isNaked = false;
         bool isInterrupt = false;
+        // `memoize def`: calls are answered from a per-function cache keyed by
+        // the argument values (int, float and bool only; see IRGenerator).
+        bool isMemoize = false;
+        // `target_clones("avx512", "avx2", "default") def`: compiled once per
+        // listed ISA level, picked by the running CPU at the first call (see
+        // optimization::multiversionFunctions).
+        std::vector<std::string> targetClones;
+        // `const def`: calls with constant arguments in top-level initializers
+        // are evaluated at compile time (see compiler::ConstEvaluator).
+        bool isConstFn = false;
+        // A `def f(params) -> T;` prototype from a precompiled module's
+        // interface (.toi): a Tocin function whose body is in the module's
+        // object, unlike an `extern def`, which is a C function.
+        bool isInterface = false;
+        // The body contains `yield`: compiled as a coroutine returning a
+        // gen<int> handle (see IRGenerator::beginGenerator).
+        bool isGenerator = false;
 
         bool isGeneric() const { return !typeParameters.empty(); }
     };
@@ -663,8 +838,10 @@ namespace ast
     class ReturnStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ReturnStmt; }
+
         ReturnStmt(const lexer::Token &token, ExprPtr value)
-            : Statement(token), value(std::move(value)) {}
+            : Statement(token, NodeKind::ReturnStmt), value(std::move(value)) {}
         void accept(Visitor &visitor) override;
         ExprPtr value;
     };
@@ -675,9 +852,11 @@ namespace ast
     class ClassStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ClassStmt; }
+
         ClassStmt(const lexer::Token &token, const std::string &name,
                   std::vector<StmtPtr> fields, std::vector<StmtPtr> methods)
-            : Statement(token), name(name), typeParameters(),
+            : Statement(token, NodeKind::ClassStmt), name(name), typeParameters(),
               superclass(), interfaces(), fields(std::move(fields)),
               methods(std::move(methods)) {}
 
@@ -686,7 +865,7 @@ namespace ast
                   std::vector<TypeParameter> typeParameters,
                   TypePtr superclass, std::vector<TypePtr> interfaces,
                   std::vector<StmtPtr> fields, std::vector<StmtPtr> methods)
-            : Statement(token), name(name), typeParameters(std::move(typeParameters)),
+            : Statement(token, NodeKind::ClassStmt), name(name), typeParameters(std::move(typeParameters)),
               superclass(std::move(superclass)), interfaces(std::move(interfaces)),
               fields(std::move(fields)), methods(std::move(methods)) {}
 
@@ -711,14 +890,16 @@ namespace ast
     class ImportStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ImportStmt; }
+
         // Regular import (import module)
         ImportStmt(const lexer::Token &token, const std::string &moduleName)
-            : Statement(token), moduleName(moduleName), importAll(true), symbols() {}
+            : Statement(token, NodeKind::ImportStmt), moduleName(moduleName), importAll(true), symbols() {}
 
         // Import specific symbols (import module.{symbol1, symbol2 as alias})
         ImportStmt(const lexer::Token &token, const std::string &moduleName,
                    std::map<std::string, std::string> symbols)
-            : Statement(token), moduleName(moduleName), importAll(false),
+            : Statement(token, NodeKind::ImportStmt), moduleName(moduleName), importAll(false),
               symbols(std::move(symbols)) {}
 
         void accept(Visitor &visitor) override;
@@ -737,18 +918,20 @@ namespace ast
     class ExportStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ExportStmt; }
+
         // Export individual symbols
         ExportStmt(const lexer::Token &token, std::vector<std::string> symbols)
-            : Statement(token), symbols(std::move(symbols)), exportAll(false),
+            : Statement(token, NodeKind::ExportStmt), symbols(std::move(symbols)), exportAll(false),
               declaration(nullptr) {}
 
         // Export declaration (export def f() {})
         ExportStmt(const lexer::Token &token, StmtPtr declaration)
-            : Statement(token), exportAll(false), declaration(std::move(declaration)) {}
+            : Statement(token, NodeKind::ExportStmt), exportAll(false), declaration(std::move(declaration)) {}
 
         // Export all (export *)
         explicit ExportStmt(const lexer::Token &token, bool exportAll = true)
-            : Statement(token), exportAll(exportAll), declaration(nullptr) {}
+            : Statement(token, NodeKind::ExportStmt), exportAll(exportAll), declaration(nullptr) {}
 
         void accept(Visitor &visitor) override;
 
@@ -763,8 +946,10 @@ namespace ast
     class ModuleStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ModuleStmt; }
+
         ModuleStmt(const lexer::Token &token, const std::string &name, std::vector<StmtPtr> body)
-            : Statement(token), name(name), body(std::move(body)) {}
+            : Statement(token, NodeKind::ModuleStmt), name(name), body(std::move(body)) {}
 
         void accept(Visitor &visitor) override;
 
@@ -778,8 +963,10 @@ namespace ast
     class MatchStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::MatchStmt; }
+
         MatchStmt(const lexer::Token &token, ExprPtr value, std::vector<std::pair<ExprPtr, StmtPtr>> cases, StmtPtr defaultCase)
-            : Statement(token), value(std::move(value)), cases(std::move(cases)), defaultCase(std::move(defaultCase)) {}
+            : Statement(token, NodeKind::MatchStmt), value(std::move(value)), cases(std::move(cases)), defaultCase(std::move(defaultCase)) {}
         void accept(Visitor &visitor) override;
         ExprPtr value;
         std::vector<std::pair<ExprPtr, StmtPtr>> cases;
@@ -802,8 +989,10 @@ namespace ast
     class NewExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::NewExpr; }
+
         NewExpr(const lexer::Token &token, std::shared_ptr<Expression> typeExpr, std::shared_ptr<Expression> sizeExpr = nullptr)
-            : Expression(token), typeExpr(std::move(typeExpr)), sizeExpr(std::move(sizeExpr)) {}
+            : Expression(token, NodeKind::NewExpr), typeExpr(std::move(typeExpr)), sizeExpr(std::move(sizeExpr)) {}
 
         void accept(Visitor &visitor) override;
         TypePtr getType() const override { return nullptr; }
@@ -824,8 +1013,10 @@ namespace ast
     class DeleteExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::DeleteExpr; }
+
         DeleteExpr(const lexer::Token &token, std::shared_ptr<Expression> expr)
-            : Expression(token), expr(std::move(expr)) {}
+            : Expression(token, NodeKind::DeleteExpr), expr(std::move(expr)) {}
 
         void accept(Visitor &visitor) override;
         TypePtr getType() const override { return nullptr; }
@@ -844,10 +1035,12 @@ namespace ast
     class StringInterpolationExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::StringInterpolationExpr; }
+
         StringInterpolationExpr(const lexer::Token &token,
                                 std::vector<std::string> textParts,
                                 std::vector<ExprPtr> expressions)
-            : Expression(token), textParts(std::move(textParts)),
+            : Expression(token, NodeKind::StringInterpolationExpr), textParts(std::move(textParts)),
               expressions(std::move(expressions)) {}
 
         const std::vector<std::string> &getTextParts() const { return textParts; }
@@ -856,7 +1049,7 @@ namespace ast
         TypePtr getType() const override
         {
             // Create a SimpleType representing string
-            return std::make_shared<SimpleType>(
+            return ast::make<SimpleType>(
                 lexer::Token(lexer::TokenType::STRING, "string", "", 0, 0));
         }
 
@@ -873,8 +1066,10 @@ namespace ast
     class ChannelSendExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ChannelSendExpr; }
+
         ChannelSendExpr(const lexer::Token &token, ExprPtr channel, ExprPtr value)
-            : Expression(token), channel(std::move(channel)), value(std::move(value)) {}
+            : Expression(token, NodeKind::ChannelSendExpr), channel(std::move(channel)), value(std::move(value)) {}
 
         void accept(Visitor &visitor) override;
         TypePtr getType() const override { return nullptr; }
@@ -889,8 +1084,10 @@ namespace ast
     class ChannelReceiveExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ChannelReceiveExpr; }
+
         ChannelReceiveExpr(const lexer::Token &token, ExprPtr channel)
-            : Expression(token), channel(std::move(channel)) {}
+            : Expression(token, NodeKind::ChannelReceiveExpr), channel(std::move(channel)) {}
 
         void accept(Visitor &visitor) override;
         TypePtr getType() const override { return nullptr; }
@@ -904,6 +1101,8 @@ namespace ast
     class SelectStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::SelectStmt; }
+
         struct Case
         {
             ExprPtr channel;      // channel expression for `<-channel` (null for default)
@@ -917,7 +1116,7 @@ namespace ast
         };
 
         SelectStmt(const lexer::Token &token, std::vector<Case> cases)
-            : Statement(token), cases(std::move(cases)) {}
+            : Statement(token, NodeKind::SelectStmt), cases(std::move(cases)) {}
 
         void accept(Visitor &visitor) override;
 
@@ -930,8 +1129,10 @@ namespace ast
     class GoStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::GoStmt; }
+
         GoStmt(const lexer::Token &token, ExprPtr expression)
-            : Statement(token), expression(std::move(expression)) {}
+            : Statement(token, NodeKind::GoStmt), expression(std::move(expression)) {}
 
         void accept(Visitor &visitor) override;
 
@@ -944,8 +1145,10 @@ namespace ast
     class ArrayLiteralExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ArrayLiteralExpr; }
+
         ArrayLiteralExpr(const lexer::Token &token, std::vector<ExprPtr> elements)
-            : Expression(token), elements(std::move(elements)) {}
+            : Expression(token, NodeKind::ArrayLiteralExpr), elements(std::move(elements)) {}
 
         void accept(Visitor &visitor) override;
         std::vector<ExprPtr> elements;
@@ -958,8 +1161,10 @@ namespace ast
     class IndexExpr : public Expression
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::IndexExpr; }
+
         IndexExpr(const lexer::Token &token, ExprPtr object, ExprPtr index)
-            : Expression(token), object(std::move(object)), index(std::move(index)) {}
+            : Expression(token, NodeKind::IndexExpr), object(std::move(object)), index(std::move(index)) {}
         void accept(Visitor &visitor) override;
         ExprPtr object;
         ExprPtr index;
@@ -973,9 +1178,11 @@ namespace ast
     class EnumStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::EnumStmt; }
+
         EnumStmt(const lexer::Token &token, const std::string &name,
                  std::vector<std::pair<std::string, int64_t>> members)
-            : Statement(token), name(name), members(std::move(members)) {}
+            : Statement(token, NodeKind::EnumStmt), name(name), members(std::move(members)) {}
         void accept(Visitor &visitor) override { visitor.visitEnumStmt(this); }
         std::string name;
         std::vector<std::pair<std::string, int64_t>> members; // variant name -> tag (index)
@@ -993,9 +1200,11 @@ namespace ast
     class TryStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::TryStmt; }
+
         TryStmt(const lexer::Token &token, StmtPtr tryBlock,
                 const std::string &catchVar, StmtPtr catchBlock, StmtPtr finallyBlock)
-            : Statement(token), tryBlock(std::move(tryBlock)), catchVar(catchVar),
+            : Statement(token, NodeKind::TryStmt), tryBlock(std::move(tryBlock)), catchVar(catchVar),
               catchBlock(std::move(catchBlock)), finallyBlock(std::move(finallyBlock)) {}
         void accept(Visitor &visitor) override { visitor.visitTryStmt(this); }
         StmtPtr tryBlock;
@@ -1010,8 +1219,10 @@ namespace ast
     class ThrowStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ThrowStmt; }
+
         ThrowStmt(const lexer::Token &token, ExprPtr value)
-            : Statement(token), value(std::move(value)) {}
+            : Statement(token, NodeKind::ThrowStmt), value(std::move(value)) {}
         void accept(Visitor &visitor) override { visitor.visitThrowStmt(this); }
         ExprPtr value;
     };
@@ -1022,7 +1233,9 @@ namespace ast
     class BreakStmt : public Statement
     {
     public:
-        explicit BreakStmt(const lexer::Token &token) : Statement(token) {}
+        static bool classof(const Node *node) { return node->kind() == NodeKind::BreakStmt; }
+
+        explicit BreakStmt(const lexer::Token &token) : Statement(token, NodeKind::BreakStmt) {}
         void accept(Visitor &visitor) override { visitor.visitBreakStmt(this); }
         std::string targetLabel; // "" = innermost loop; else a labeled loop
     };
@@ -1033,7 +1246,9 @@ namespace ast
     class ContinueStmt : public Statement
     {
     public:
-        explicit ContinueStmt(const lexer::Token &token) : Statement(token) {}
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ContinueStmt; }
+
+        explicit ContinueStmt(const lexer::Token &token) : Statement(token, NodeKind::ContinueStmt) {}
         void accept(Visitor &visitor) override { visitor.visitContinueStmt(this); }
         std::string targetLabel; // "" = innermost loop; else a labeled loop
     };
@@ -1045,8 +1260,10 @@ namespace ast
     class DeferStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::DeferStmt; }
+
         DeferStmt(const lexer::Token &token, StmtPtr body)
-            : Statement(token), body(std::move(body)) {}
+            : Statement(token, NodeKind::DeferStmt), body(std::move(body)) {}
         void accept(Visitor &visitor) override { visitor.visitDeferStmt(this); }
         StmtPtr body;
     };
@@ -1059,9 +1276,11 @@ namespace ast
     class DestructureStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::DestructureStmt; }
+
         DestructureStmt(const lexer::Token &token, std::vector<std::string> names,
                         ExprPtr initializer, bool isConst)
-            : Statement(token), names(std::move(names)),
+            : Statement(token, NodeKind::DestructureStmt), names(std::move(names)),
               initializer(std::move(initializer)), isConst(isConst) {}
         void accept(Visitor &visitor) override { visitor.visitDestructureStmt(this); }
         std::vector<std::string> names;
@@ -1075,13 +1294,15 @@ namespace ast
     class TraitStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::TraitStmt; }
+
         std::string name;
         std::vector<std::shared_ptr<FunctionStmt>> methods;
         std::vector<TypePtr> superTraits;
         std::vector<std::string> associatedTypes;
 
         TraitStmt(const lexer::Token& token, const std::string& name)
-            : Statement(token), name(name) {}
+            : Statement(token, NodeKind::TraitStmt), name(name) {}
 
         void accept(Visitor& visitor) override {
             visitor.visitTraitStmt(this);
@@ -1094,12 +1315,14 @@ namespace ast
     class ImplStmt : public Statement
     {
     public:
+        static bool classof(const Node *node) { return node->kind() == NodeKind::ImplStmt; }
+
         std::string traitName;
         TypePtr type;
         std::vector<std::shared_ptr<FunctionStmt>> methods;
 
         ImplStmt(const lexer::Token& token, const std::string& traitName, TypePtr type)
-            : Statement(token), traitName(traitName), type(type) {}
+            : Statement(token, NodeKind::ImplStmt), traitName(traitName), type(type) {}
 
         void accept(Visitor& visitor) override {
             visitor.visitImplStmt(this);
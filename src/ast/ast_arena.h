@@ -0,0 +1,159 @@
+#ifndef AST_ARENA_H
+#define AST_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace ast
+{
+
+    /**
+     * @brief Bump allocator for the nodes of one compilation's AST.
+     *
+     * Nodes are made with ast::make, which places each node and its
+     * shared_ptr control block side by side in the arena's blocks instead of
+     * a separate heap allocation. A node never moves, so raw pointers to it
+     * (node.get()) stay valid as long as the node is referenced; passes that
+     * only walk the tree can use those and skip refcounting altogether.
+     *
+     * The memory goes back when the owner's handle and the last node made
+     * in it are both gone: every allocation counts as a reference.
+     * ExprPtr/StmtPtr/TypePtr stay shared_ptrs, so code that shares or stores nodes keeps working,
+     * and ASTs that outlive their compilation (ModuleCache entries, REPL
+     * definitions) keep their arena alive rather than dangle.
+     *
+     * An arena is filled by one thread at a time (the one inside its
+     * ArenaScope); nodes may be released from any thread.
+     */
+    class Arena
+    {
+    public:
+        static constexpr size_t kBlockSize = 256 * 1024;
+
+        // The owner's handle. The arena itself lasts until both the handle
+        // and every node made in it are gone.
+        static std::shared_ptr<Arena> create()
+        {
+            return std::shared_ptr<Arena>(new Arena, [](Arena *arena) { arena->release(); });
+        }
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        void *allocate(size_t size, size_t align)
+        {
+            size_t offset = (used_ + align - 1) & ~(align - 1);
+            if (blocks_.empty() || offset + size > blockSize_)
+            {
+                blockSize_ = size > kBlockSize ? size : kBlockSize;
+                blocks_.push_back(std::make_unique<std::max_align_t[]>(
+                    (blockSize_ + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)));
+                offset = 0;
+            }
+            used_ = offset + size;
+            bytes_ += size;
+            refs_.fetch_add(1, std::memory_order_relaxed);
+            return reinterpret_cast<char *>(blocks_.back().get()) + offset;
+        }
+
+        // One allocation's memory is no longer used; the space itself is
+        // only reclaimed with the whole arena.
+        void deallocate() { release(); }
+
+        // Bytes handed out so far.
+        size_t bytes() const { return bytes_; }
+
+    private:
+        Arena() = default;
+
+        void release()
+        {
+            if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete this;
+        }
+
+        std::vector<std::unique_ptr<std::max_align_t[]>> blocks_;
+        size_t blockSize_ = 0;
+        size_t used_ = 0;
+        size_t bytes_ = 0;
+        std::atomic<size_t> refs_{1}; // the owner's handle plus live allocations
+    };
+
+    /**
+     * @brief Allocator for std::allocate_shared that takes memory from an
+     * Arena; each allocation holds the arena until it is deallocated.
+     */
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        explicit ArenaAllocator(Arena *arena) : arena_(arena) {}
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena_) {}
+
+        T *allocate(size_t n)
+        {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned AST node");
+            return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T *, size_t) { arena_->deallocate(); }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U> &other) const { return arena_ == other.arena_; }
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U> &other) const { return arena_ != other.arena_; }
+
+    private:
+        template <typename U>
+        friend class ArenaAllocator;
+        Arena *arena_;
+    };
+
+    /**
+     * @brief Makes arena the one ast::make allocates from on this thread,
+     * for the life of the scope (scopes nest).
+     */
+    class ArenaScope
+    {
+    public:
+        explicit ArenaScope(std::shared_ptr<Arena> arena)
+            : arena_(std::move(arena)), previous_(current())
+        {
+            current() = arena_.get();
+        }
+        ~ArenaScope() { current() = previous_; }
+        ArenaScope(const ArenaScope &) = delete;
+        ArenaScope &operator=(const ArenaScope &) = delete;
+
+        static Arena *&current()
+        {
+            thread_local Arena *arena = nullptr;
+            return arena;
+        }
+
+    private:
+        std::shared_ptr<Arena> arena_;
+        Arena *previous_;
+    };
+
+    /**
+     * @brief Creates an AST node: in the current ArenaScope's arena if there
+     * is one, else like std::make_shared.
+     */
+    template <typename T, typename... Args>
+    std::shared_ptr<T> make(Args &&...args)
+    {
+        if (Arena *arena = ArenaScope::current())
+            return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+
+} // namespace ast
+
+#endif // AST_ARENA_H
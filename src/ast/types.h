@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../lexer/token.h"
+#include "ast_arena.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -116,7 +117,7 @@ namespace ast
 
         TypePtr clone() const override
         {
-            return std::make_shared<BasicType>(kind, token);
+            return ast::make<BasicType>(kind, token);
         }
 
     private:
@@ -150,7 +151,7 @@ namespace ast
 
         TypePtr clone() const override
         {
-            return std::make_shared<NullableType>(token, baseType->clone());
+            return ast::make<NullableType>(token, baseType->clone());
         }
     };
 
@@ -201,7 +202,7 @@ namespace ast
             {
                 clonedArgs.push_back(arg->clone());
             }
-            return std::make_shared<GenericType>(token, name, std::move(clonedArgs));
+            return ast::make<GenericType>(token, name, std::move(clonedArgs));
         }
     };
 
@@ -257,7 +258,7 @@ namespace ast
             {
                 clonedParams.push_back(param->clone());
             }
-            return std::make_shared<FunctionType>(token, std::move(clonedParams), returnType->clone(), isAsync);
+            return ast::make<FunctionType>(token, std::move(clonedParams), returnType->clone(), isAsync);
         }
     };
 
@@ -307,7 +308,7 @@ namespace ast
             {
                 clonedElements.push_back(element->clone());
             }
-            return std::make_shared<TupleType>(token, std::move(clonedElements));
+            return ast::make<TupleType>(token, std::move(clonedElements));
         }
     };
 
@@ -343,7 +344,7 @@ namespace ast
 
         TypePtr clone() const override
         {
-            return std::make_shared<ArrayType>(token, elementType->clone(), size);
+            return ast::make<ArrayType>(token, elementType->clone(), size);
         }
     };
 
@@ -374,7 +375,7 @@ namespace ast
 
         TypePtr clone() const override
         {
-            return std::make_shared<PointerType>(token, pointeeType->clone());
+            return ast::make<PointerType>(token, pointeeType->clone());
         }
     };
 
@@ -406,7 +407,7 @@ namespace ast
 
         TypePtr clone() const override
         {
-            return std::make_shared<ReferenceType>(token, referencedType->clone(), isMutable);
+            return ast::make<ReferenceType>(token, referencedType->clone(), isMutable);
         }
     };
 
@@ -437,7 +438,7 @@ namespace ast
 
         TypePtr clone() const override
         {
-            return std::make_shared<OptionType>(token, innerType->clone());
+            return ast::make<OptionType>(token, innerType->clone());
         }
     };
 
@@ -469,7 +470,7 @@ namespace ast
 
         TypePtr clone() const override
         {
-            return std::make_shared<ResultType>(token, okType->clone(), errorType->clone());
+            return ast::make<ResultType>(token, okType->clone(), errorType->clone());
         }
     };
 
@@ -524,7 +525,7 @@ namespace ast
             {
                 clonedArgs.push_back(arg->clone());
             }
-            return std::make_shared<TraitType>(token, name, std::move(clonedArgs));
+            return ast::make<TraitType>(token, name, std::move(clonedArgs));
         }
     };
 
@@ -562,7 +563,7 @@ namespace ast
 
         TypePtr clone() const override
         {
-            return std::make_shared<ChannelType>(token, elementType->clone(), isSend, isReceive);
+            return ast::make<ChannelType>(token, elementType->clone(), isSend, isReceive);
         }
     };
 
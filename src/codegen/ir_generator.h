@@ -4,7 +4,9 @@
 #include "../ast/ast.h"
 #include "../ast/match_stmt.h"
 #include "../type/type_checker.h"
+#include "../compiler/const_eval.h"
 #include "../error/error_handler.h"
+#include "../runtime/alloc_profiler.h"
 #include "../runtime/concurrency.h"
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
@@ -44,34 +46,6 @@ namespace codegen
         llvm::StructType *instantiatedType;
     };
 
-    // Environment scope for variables
-    struct Scope
-    {
-        Scope *parent;
-        std::map<std::string, llvm::AllocaInst *> values;
-
-        Scope(Scope *parent) : parent(parent) {}
-
-        llvm::AllocaInst *lookup(const std::string &name)
-        {
-            auto it = values.find(name);
-            if (it != values.end())
-            {
-                return it->second;
-            }
-            else if (parent)
-            {
-                return parent->lookup(name);
-            }
-            return nullptr;
-        }
-
-        void define(const std::string &name, llvm::AllocaInst *value)
-        {
-            values[name] = value;
-        }
-    };
-
     /**
      * @brief IR Generator class that translates AST to LLVM IR.
      *
@@ -95,6 +69,21 @@ namespace codegen
         // 128-byte red zone below the stack pointer).
         bool noRedZone = false;
 
+        // --memory=owned: a class instance bound by `let x = C(...)` is freed
+        // when its function returns (or when the `let` runs again, in a loop)
+        // if the borrow checker lists the binding in uniqueOwners and escape
+        // analysis proves x never leaves the frame. Method calls on x count as
+        // staying in the frame when no method of that name lets `self` escape.
+        // Everything else is left to the collector.
+        bool ownedMemory = false;
+        std::set<const ast::VariableStmt *> uniqueOwners;
+
+        // --debug: a tracepoint site (runtime/tracepoints.h) before the first
+        // statement of each source line, so probes and conditional breakpoints
+        // can be switched on in the running program. Off, a site is one
+        // relaxed byte load and a never-taken branch.
+        bool tracepoints = false;
+
         /**
          * @brief Generate LLVM IR from an AST.
          *
@@ -103,6 +92,27 @@ namespace codegen
          */
         std::unique_ptr<llvm::Module> generate(ast::StmtPtr ast);
 
+        /**
+         * @brief Source file of each top-level function and method, keyed by
+         *        its LLVM name (filled by generate()). Helpers synthesized
+         *        while generating bodies (lambdas, thunks, generic instances)
+         *        are not listed.
+         */
+        const std::map<std::string, std::string> &functionSources() const
+        {
+            return functionSources_;
+        }
+
+        /**
+         * @brief LLVM names of the functions monomorphized from generic
+         *        templates: generic function instances and the methods of
+         *        generic class instances.
+         */
+        const std::set<std::string> &genericInstanceFunctions() const
+        {
+            return genericInstanceFunctions_;
+        }
+
         // Visitor implementation methods
         void visitBlockStmt(ast::BlockStmt *stmt) override;
         void visitExpressionStmt(ast::ExpressionStmt *stmt) override;
@@ -174,29 +184,71 @@ namespace codegen
         llvm::Function *currentFunction = nullptr;
         error::ErrorHandler &errorHandler;
         type_checker::TypeChecker *typeChecker = nullptr;
-        Scope *currentScope = nullptr;
         bool isInAsyncContext = false;
         std::string currentModuleName = "default";
         std::unique_ptr<PatternVisitor> patternVisitor;
 
         // Symbol tables
         std::map<std::string, llvm::AllocaInst *> namedValues;                     // Variable symbol table
+        // Block scoping for namedValues: bindVariable logs what a name was bound
+        // to before, and exitScope undoes every binding made since the matching
+        // enterScope, so a block's `let` or loop variable neither outlives the
+        // block nor replaces an outer variable of the same name after it.
+        std::vector<std::pair<std::string, llvm::AllocaInst *>> scopeUndo_;
+        std::vector<size_t> scopeMarks_;
         std::map<std::string, std::string> varClasses;                            // Variable name -> class name
-        // Escape analysis: constructor call sites whose instance provably does
-        // not escape its function, so it can be stack-allocated (entry-block
-        // alloca) instead of heap-allocated via __tocin_alloc. Sound: a site is
+        // Escape analysis: allocation sites whose value provably does not
+        // escape its function, so it can be stack-allocated (entry-block
+        // alloca) instead of heap-allocated via __tocin_alloc. Covers
+        // constructor calls, tuples, Some/Ok/Err and ADT variants, list
+        // literals, lambdas and constant-size alloc(n). Sound: a site is
         // included only when every use of the local is proven non-escaping; any
         // unrecognized use is treated as an escape (heap fallback).
-        std::set<const ast::CallExpr *> stackAllocSites_;
+        std::set<const ast::Expression *> stackAllocSites_;
+        // newArray/zeros/newFloatArray sites bound to a non-escaping local of a
+        // numeric element type: allocated pointer-free (__tocin_alloc_atomic),
+        // so the GC never scans them and a `withArena` block bump-allocates them.
+        std::set<const ast::CallExpr *> atomicArraySites_;
+        // --memory=owned: the `let` bindings whose instance is freed on exit.
+        std::set<const ast::VariableStmt *> ownedFrees_;
+        // Free functions whose declared Option/Result or small-tuple return is
+        // passed by value in registers instead of boxed: 0 = Option/Result as
+        // { i64 tag, i64 payload } (tag -1 is None), n = an n-slot tuple as
+        // [n x i64]. Callers box the value only where they need a pointer.
+        std::map<const ast::FunctionStmt *, int> valueReturnFns_;
+        // Set by visitReturnStmt just before generating a returned call: the
+        // call may yield this by-value aggregate instead of a box.
+        llvm::Type *unboxedResult_ = nullptr;
+        // String builders: `let s = ...` string locals that escape analysis
+        // proved nobody else can see. Their `s = s + a + b` statements (and
+        // `s += a`) are in strAppendSites_ and append in place through
+        // __tocin_str_append. Each such local gets an i1 "owned" flag
+        // (strOwnedFlags_, keyed by the local's slot): set once an append has
+        // given s a buffer of its own, cleared by any other assignment.
+        std::set<const ast::VariableStmt *> strBuilderVars_;
+        std::set<const ast::AssignExpr *> strAppendSites_;
+        std::map<llvm::AllocaInst *, llvm::AllocaInst *> strOwnedFlags_;
         std::map<std::string, llvm::Type *> varArrayElem;                         // Variable name -> array element LLVM type
+        std::map<std::string, llvm::Type *> varVecElem;                           // Variable name -> element type of a typed vector
+        llvm::Type *pendingVecElem_ = nullptr;                                    // element type for the `vecNew()` initializing a `vector<T>` local
+        llvm::Type *pendingArrayElem_ = nullptr;                                  // ... and for the newArray/zeros/newFloatArray initializing a `list<T>` one
+        std::map<std::vector<uint64_t>, llvm::GlobalVariable *> gcLayouts_;      // pointer bitmap -> its __tocin_alloc_typed layout
         std::map<std::string, std::shared_ptr<ast::FunctionType>> varFuncSig;     // Variable name -> declared function-pointer signature
         std::set<std::string> varIsString;                                        // Variables statically known to hold strings
         std::vector<std::pair<llvm::BasicBlock *, llvm::BasicBlock *>> loopStack; // {continue target, break target} per enclosing loop
         std::vector<std::string> loopLabels;                                      // label per enclosing loop ("" if unlabeled), index-aligned with loopStack
+        // A try body lowered with invokes: once the body is generated, the
+        // calls it made unwind to `pad`. `exits` are the blocks where control
+        // leaves the body (normal completion, or a return/break running
+        // finally); code past them is outside the try.
+        struct TryRegion { llvm::BasicBlock *pad; std::set<llvm::BasicBlock *> exits; };
         // Pending cleanups an early `return` must run while unwinding out of
-        // try/finally scopes: the finally block (may be null) and whether the
-        // exception handler registered for this try must also be popped.
-        struct PendingFinally { ast::StmtPtr block; bool popHandler; };
+        // try/finally scopes: the finally block (may be null), and the try's
+        // handler to leave first - the setjmp handler to pop (popHandler,
+        // freestanding) or the invoke region to exit (region).
+        // loopDepth is loopStack.size() at the try, so a `break`/`continue`
+        // runs only the cleanups of the scopes it leaves.
+        struct PendingFinally { ast::StmtPtr block; bool popHandler; size_t loopDepth; TryRegion *region = nullptr; };
         std::vector<PendingFinally> finallyStack;
         // Function-scoped `defer` statements: each carries a reached-flag (an i1
         // alloca set true when the defer executes) so the cleanup runs at every
@@ -206,8 +258,9 @@ namespace codegen
         // RAII: class-typed locals initialized directly by a constructor for a
         // class that defines __del__, to be auto-destroyed at every function
         // exit (LIFO, guarded by a reached-flag). Destruction is a deterministic
-        // side-effect hook; memory itself remains GC-managed.
-        struct OwnedInstance { llvm::AllocaInst *slot; std::string className; llvm::AllocaInst *reached; };
+        // side-effect hook; memory itself remains GC-managed unless `free` is
+        // set (an ownedFrees_ binding, --memory=owned).
+        struct OwnedInstance { llvm::AllocaInst *slot; std::string className; llvm::AllocaInst *reached; bool free = false; };
         std::vector<OwnedInstance> destructorStack;
         std::string currentClassName;                                              // Enclosing class while generating a method
         // restrict-style aliasing: locals initialized directly from `alloc(...)`
@@ -220,6 +273,13 @@ namespace codegen
         // copy `let b = a;` is not tracked, so it conservatively may-alias).
         llvm::MDNode *restrictDomain_ = nullptr;                                    // lazily created alias-scope domain
         std::map<std::string, llvm::MDNode *> bufferScopes_;                        // buffer var name -> its alias scope (per function)
+        // Type-based aliasing for the runtime layouts: an array's length header
+        // and its elements (a vector's header and its buffer) are never the
+        // same memory, so each kind of access gets its own TBAA tag. This is
+        // what lets a loop that stores elements keep the length in a register.
+        llvm::MDNode *tbaaRoot_ = nullptr;
+        std::map<std::string, llvm::MDNode *> tbaaTags_;
+        llvm::MDNode *tbaaTag(const std::string &type);
         // Module-level (global) variables. Declared up front as LLVM globals;
         // their initializer expressions run in an implicit __tocin_global_init()
         // that main() calls first (so globals with non-constant initializers -
@@ -230,6 +290,16 @@ namespace codegen
         void predeclareGlobals(ast::StmtPtr ast);                                   // create the GlobalVariables
         void emitGlobalInit();                                                      // fill in __tocin_global_init body
         llvm::Type *inferGlobalType(ast::VariableStmt *stmt);                       // type for a global's storage
+        // A compile-time value (see compiler::ConstEvaluator) as a global's
+        // static initializer of this storage type; null if it has none.
+        // Arrays become a private [i64 length][8-byte slots] global, one per
+        // ConstArray, so globals sharing an array share its data.
+        llvm::Constant *constantFor(const tocin::compiler::ConstValue &value, llvm::Type *type,
+                                    const std::string &name);
+        std::map<const tocin::compiler::ConstArray *, llvm::GlobalVariable *> constArrays_;
+        // Element type of the list each `.toList()` query built, for the
+        // variable it initializes.
+        std::map<const ast::CallExpr *, llvm::Type *> queryListElem_;
         // Tag a load/store with this buffer variable's alias scope and mark it
         // noalias against every other tracked buffer. No-op if name isn't tracked.
         void tagBufferAccess(llvm::Instruction *inst, const std::string &bufVar);
@@ -238,12 +308,69 @@ namespace codegen
         // hitting UB (SIGFPE, segfault). Execution continues on the ok path.
         // Used for division by zero, nil force-unwrap, and similar runtime traps.
         void emitTrapIf(llvm::Value *condFail, const std::string &msg);
+        // Under `tracepoints`: the site for the line @p stmt starts, unless the
+        // function has one there already. Its locals go to a per-function
+        // [32 x i64] slot on the cold path only.
+        void emitTracepoint(ast::Statement *stmt);
+        void registerTracepoints();   // main() hands the module's sites to the runtime
+        // main() offers the module's string literals to the intern table, so
+        // intern("x") hands back the literal "x" itself.
+        void registerStringLiterals();
+        llvm::StructType *tracepointSiteTy_ = nullptr;
+        std::vector<llvm::GlobalVariable *> tracepointSites_;
+        std::set<std::pair<llvm::Function *, int>> tracepointLines_;
+        std::map<llvm::Function *, llvm::AllocaInst *> tracepointSlots_;
+
+        // --- Generators -----------------------------------------------------
+        // A function containing `yield` is generated as a plain body in which
+        // each `yield v` is a call to the __tocin.gen.yield marker and every
+        // exit returns null. lowerGenerators() then splits it: the body moves
+        // to `<name>.resume(frame)`, which switches on the frame's state to the
+        // point after the last yield, and <name> itself becomes the ramp that
+        // allocates the frame (one GC block holding the header below, the
+        // arguments and every local), binds the arguments and returns it,
+        // suspended before the first statement. Each resume runs to the next
+        // yield, which leaves its value in the header, or to the end, which
+        // clears `resume`: a null resume pointer is an exhausted generator.
+        struct GeneratorState
+        {
+            llvm::Function *function = nullptr;
+            llvm::BasicBlock *finalBB = nullptr;    // `return` and falling off the end
+        };
+        GeneratorState generator_;
+        std::vector<llvm::Function *> generatorFunctions_;
+        // { ptr resume, i64 state, i64 value, ptr collected }: the start of
+        // every frame, which is all a consumer touches.
+        llvm::StructType *generatorHeaderType();
+        llvm::Function *generatorYieldMarker();
+        // Called once a generator's parameters are bound, and after its body.
+        void beginGenerator(llvm::Function *fn);
+        void endGenerator();
+        void emitYield(llvm::Value *value);
+        // A call to a generator function, or a local holding a handle.
+        bool isGeneratorExpr(const ast::ExprPtr &expr);
+        std::set<const llvm::AllocaInst *> generatorSlots_;
+        // Resume `handle` and return the value it yielded, in a fresh block;
+        // branches to `exhausted` instead once the body has finished.
+        llvm::Value *generatorNext(llvm::Value *handle, llvm::BasicBlock *exhausted);
+        // The values `handle` has left, as an array (`g[i]`, `len(g)`). The
+        // first use drains the generator; the array is kept in the frame.
+        llvm::Value *generatorCollect(llvm::Value *handle);
+        // Split every generator into its ramp and resume functions (see
+        // above), so the result runs at every optimization level and under
+        // the JIT.
+        void lowerGenerators();
+        void lowerGenerator(llvm::Function *fn);
         // Apply bare-metal function attributes/calling-convention to a freshly
         // created function: `noredzone` under --no-red-zone, and the `naked` /
         // x86-interrupt-cc qualifiers when the declaration carries them.
         void applyBareMetalAttributes(llvm::Function *function, ast::FunctionStmt *stmt);
+        // `memoize def`: fill `wrapper` (the function callers see) with a
+        // lookup in its memo table that falls back to `impl`, the real body,
+        // and caches what it returns.
+        void emitMemoWrapper(llvm::Function *wrapper, llvm::Function *impl);
         // Whole-module escape analysis: populates stackAllocSites_ with the
-        // constructor calls whose result can be stack-allocated. Runs once,
+        // allocation sites whose result can be stack-allocated. Runs once,
         // before IR generation.
         void runEscapeAnalysis(const ast::StmtPtr &program);
         // If `expr` is a bare buffer-variable reference, return its name, else "".
@@ -270,13 +397,13 @@ namespace codegen
         std::map<std::string, std::vector<std::string>> adtEnumVariants;        // enum name -> ordered variant names
 
         // --- Trait objects / dynamic dispatch ---------------------------------
-        // A trait object is a heap box { i64 typeId, ptr data }. typeId selects
-        // the concrete class; data points at its instance. A method call on a
-        // trait-typed value switches on typeId to the concrete Class_method.
+        // A trait object is a heap box { ptr vtable, ptr data }. vtable is the
+        // constant per-(trait, class) table of Class_method pointers, in the
+        // trait's method order; data points at the instance. A method call on
+        // a trait-typed value loads its slot and calls it indirectly.
         std::set<std::string> traitNames;                                       // declared trait names
         std::map<std::string, std::vector<std::string>> traitMethodOrder;       // trait -> ordered method names
         std::map<std::string, std::set<std::string>> traitImpls;               // trait -> classes that impl it
-        std::map<std::string, int64_t> classTypeId;                            // class name -> stable runtime type id
         std::map<std::string, ast::FunctionStmt *> functionDecls;              // top-level fn name -> decl (for param types)
         std::map<std::string, std::string> varTraitType;                       // local/param name -> trait type it is declared as
         std::map<std::string, std::string> varArrayElemTrait;                  // array var -> trait type of its elements (for trait-object vectors)
@@ -288,7 +415,8 @@ namespace codegen
         // such lambdas, so all other code is unaffected.
         std::set<std::string> varByRef;
         std::map<std::string, llvm::Type *> varByRefType;                      // by-ref name -> pointed-to value type
-        llvm::StructType *traitObjTy = nullptr;                                 // { i64 typeId, ptr data }
+        llvm::StructType *traitObjTy = nullptr;                                 // { ptr vtable, ptr data }
+        std::map<std::string, llvm::GlobalVariable *> traitVTables;            // "Trait.Class" -> its vtable
         std::map<std::string, llvm::Type *> typeBindings;                        // active type-parameter bindings during instantiation
         std::map<std::string, llvm::Function *> stdLibFunctions;                   // Standard library functions
         std::map<std::string, ClassInfo> classTypes;                               // Class type information
@@ -306,25 +434,74 @@ namespace codegen
         llvm::FunctionType *recoverCalleeFnType(const ast::ExprPtr &callee);
 
         // --- Closures -------------------------------------------------------
-        // A function value is a heap closure laid out as [ ptr fn ][ caps... ],
-        // where fn has the env-first ABI (ptr env, declaredParams...) -> ret.
-        // Heap-allocate a closure object and populate fn + captured values.
+        // A function value is a closure object { ptr fn, caps... }, each
+        // capture in its own type, where fn has the env-first ABI
+        // (ptr env, declaredParams...) -> ret.
+        llvm::StructType *closureEnvType(const std::vector<llvm::Type *> &capTypes);
+        // Heap-allocate a closure object and populate fn + captured values
+        // (in the frame instead when `onStack`). One without captures is a
+        // constant, shared by every use of fn.
         llvm::Value *makeClosure(llvm::Function *fn,
-                                 const std::vector<llvm::Value *> &caps);
+                                 const std::vector<llvm::Value *> &caps,
+                                 bool onStack = false);
         // A trampoline giving a top-level function the env-first closure ABI,
         // so plain function names can be used as first-class values uniformly.
         llvm::Function *getOrCreateThunk(llvm::Function *target);
         // If v is a bare top-level llvm::Function used as a value, box it into a
         // closure; otherwise return v unchanged.
         llvm::Value *wrapIfRawFunction(llvm::Value *v);
+        // Evaluate a `start..end` range's bounds as i64.
+        bool emitRangeBounds(ast::BinaryExpr *range, llvm::Value *&startV, llvm::Value *&endV);
+        // Emit a sequential `for` loop; visitForStmt scopes the loop variable.
+        void emitForLoop(ast::ForStmt *stmt);
+        // Emit the counting loop of `for v in start..end` at the insert point.
+        void emitRangeLoop(ast::ForStmt *stmt, llvm::Value *startV, llvm::Value *endV);
+        // List queries: `xs.where(f).select(g).take(n).sum()` and the like,
+        // emitted as one counted loop over xs with f and g inlined. Returns
+        // false (emitting nothing) when expr is not a query over a list.
+        bool emitListQuery(ast::CallExpr *expr);
+        // The element type of a list-valued expression, or nullptr if expr is
+        // not known to be a list.
+        llvm::Type *queryListElemType(const ast::ExprPtr &expr);
+        // Apply a query operator's function argument - a lambda, inlined, or
+        // the name of a top-level function - to args.
+        llvm::Value *applyQueryFn(const ast::ExprPtr &fn, const std::vector<llvm::Value *> &args);
+        // Outline a `parallel for ... reduce(op: acc)` body into a chunk
+        // closure and call the parallel runtime with it.
+        void emitParallelFor(ast::ForStmt *stmt);
+        // The per-function state set aside while the body of an outlined
+        // chunk function (a parallel loop or query) is emitted.
+        struct OutlinedState
+        {
+            llvm::BasicBlock *block;
+            llvm::Function *function;
+            decltype(namedValues) values;
+            decltype(bufferScopes_) bufferScopes;
+            decltype(loopStack) loops;
+            decltype(loopLabels) labels;
+            decltype(finallyStack) finally;
+            decltype(deferStack) defers;
+            decltype(destructorStack) destructors;
+        };
+        // Start emitting fn's entry block with fresh per-function state.
+        OutlinedState enterOutlined(llvm::Function *fn);
+        void leaveOutlined(OutlinedState &saved);
         // Emit any pending finally blocks (innermost first) before a return
-        // unwinds out of the enclosing try/finally scopes.
-        void runPendingFinally();
+        // unwinds out of the enclosing try/finally scopes; a break/continue
+        // passes its target's loop depth to run only the scopes inside it.
+        void runPendingFinally(size_t minLoopDepth = 0);
+        // Turn the calls of a try body (the blocks reachable from entry that
+        // are neither in outside nor past an exit) into invokes of its pad.
+        void lowerTryRegion(llvm::BasicBlock *entry, const std::set<llvm::BasicBlock *> &outside,
+                            const TryRegion &region);
         // Emit function-scoped `defer` cleanups (LIFO, each guarded by its
         // reached-flag) at a function-exit point.
         void runDeferred();
         // Emit __del__ calls for owned class instances at a function-exit point.
         void runDestructors();
+        // Destroy obj, the instance held by oi: __del__ if the class has one,
+        // then the free of an ownedFrees_ binding.
+        void releaseOwned(const OwnedInstance &oi, llvm::Value *obj);
         // Cache of generated thunks, keyed by the wrapped target function.
         std::map<llvm::Function *, llvm::Function *> thunks;
 
@@ -349,10 +526,14 @@ namespace codegen
         std::string mangleGenericName(const std::string &baseName, const std::vector<ast::TypePtr> &typeArgs);
         ast::TypePtr substituteTypeParameters(ast::TypePtr type, const std::map<std::string, ast::TypePtr> &substitutions);
 
-        // Async/await support
-        llvm::Function *transformAsyncFunction(ast::FunctionStmt *stmt);
-        llvm::StructType *getFutureType(llvm::Type *valueType);
-        llvm::StructType *getPromiseType(llvm::Type *valueType);
+        // Async/await: `let x = f(args)` with f an async function starts the
+        // call as a task (__tocin_async) and leaves x pending on its future;
+        // lookupVariable awaits it before x is first used. A directly awaited
+        // call (`await f(args)`) runs inline, which is the same and cheaper.
+        llvm::Function *asyncSpawnTarget(ast::VariableStmt *stmt);
+        llvm::Value *spawnAsyncCall(ast::CallExpr *call, llvm::Function *target);
+        void awaitPendingAsync(llvm::AllocaInst *slot);
+        std::map<llvm::AllocaInst *, llvm::AllocaInst *> pendingAsync_;  // local -> its future handle
 
         // Memory management
         void createEmptyList(ast::TypePtr listType);
@@ -367,6 +548,7 @@ namespace codegen
         // Variable handling
         bool handleVariableAssignment(ast::AssignExpr *expr, llvm::Value *rhs);
         llvm::AllocaInst *lookupVariable(const std::string &name);
+        void bindVariable(const std::string &name, llvm::AllocaInst *slot);
         llvm::Value *getVariable(const std::string &name);
         void addModuleSymbol(const std::string &moduleName, const std::string &symbolName, llvm::Value *value);
         
@@ -376,6 +558,10 @@ namespace codegen
         // Main function creation
         void createMainFunction();
 
+        // Top-level function/method name -> declaring file (functionSources()).
+        std::map<std::string, std::string> functionSources_;
+        std::set<std::string> genericInstanceFunctions_;
+
         // Two-pass codegen: forward-declare prototypes/types so order of
         // top-level declarations does not matter (mutual recursion, etc.).
         void predeclareTopLevel(ast::StmtPtr ast);
@@ -385,9 +571,21 @@ namespace codegen
                                            llvm::StructType *classType,
                                            ast::FunctionStmt *method);
 
-        // String handling
+        // String handling. Strings are pointers to NUL-terminated bytes behind
+        // a 16-byte [i64 len][i64 cap] header (see "String layout" in
+        // concurrency_runtime.cpp). stringLiteral emits that layout as a
+        // private constant (cap -1: static) and returns the bytes pointer.
         llvm::Value *convertToString(llvm::Value *value);
         llvm::Value *concatenateStrings(const std::vector<llvm::Value *> &strings);
+        std::map<std::string, llvm::Constant *> stringLiterals_;
+        llvm::Constant *stringLiteral(const std::string &text);
+        llvm::Value *emitStrLen(llvm::Value *s);
+        llvm::Value *emitStrConcat(llvm::Value *a, llvm::Value *b);
+        // Copy a C string returned by an extern function behind a header.
+        llvm::Value *emitStrFromC(llvm::Value *s);
+        // Lower a strAppendSites_ assignment; false when it has to take the
+        // ordinary path (the name is bound to another local here).
+        bool emitStrAppend(ast::AssignExpr *expr);
 
         // Module system
         llvm::Value *getModuleSymbol(const std::string &moduleName, const std::string &symbolName);
@@ -408,6 +606,28 @@ namespace codegen
         // Determine the element LLVM type of an array-valued expression.
         llvm::Type *getArrayElemType(const ast::ExprPtr &expr);
 
+        // Typed vectors: the element type named by a `vector<T>` annotation
+        // (nullptr unless T is stored unboxed: int, i32, i8, f32 or float),
+        // the element type a vector constructor builtin creates, and the
+        // statically known element type of a vector-valued expression.
+        llvm::Type *vectorElemType(const ast::TypePtr &type);
+        llvm::Type *vecCtorElemType(const std::string &name);
+        llvm::Type *getVecElemType(const ast::ExprPtr &expr);
+        // A typed vector's TocinVec header; a null handle reads as an empty one.
+        llvm::Value *vecHeader(llvm::Value *handle);
+
+        // SIMD values: f64x2/f64x4/f32x4/f32x8/i64x2/i64x4/i32x4/i32x8 are
+        // LLVM fixed vectors held in registers, and mask2/mask4/mask8 the
+        // <N x i1> results of comparing them. simdType maps a type name to
+        // its vector type (nullptr for anything else). emitSimdBuiltin lowers
+        // the constructor, load/store, shuffle, select and reduction
+        // builtins, returning false for a name it does not own. simdBinary
+        // applies an operator lane-wise, splatting a scalar operand.
+        llvm::FixedVectorType *simdType(const std::string &name);
+        bool emitSimdBuiltin(const std::string &name, ast::CallExpr *expr);
+        llvm::Value *simdSplat(llvm::Value *v, llvm::FixedVectorType *vt);
+        llvm::Value *simdBinary(lexer::TokenType op, llvm::Value *l, llvm::Value *r);
+
         // True when an expression is statically known to evaluate to a string,
         // so == / != can route to value comparison instead of pointer identity.
         bool isStringExpr(const ast::ExprPtr &expr);
@@ -421,24 +641,56 @@ namespace codegen
         llvm::StructType *optResTy = nullptr;
         llvm::StructType *getOptResType();
         llvm::Value *normalizeToSlot(llvm::Value *v);
-        llvm::Value *makeOptRes(int64_t tag, llvm::Value *payload);
+        llvm::Value *makeOptRes(int64_t tag, llvm::Value *payload, bool onStack = false);
 
         // Construct an algebraic-enum value on the heap: [i64 tag][slot...].
         // `args` are the already-evaluated payload values (each normalized to a
         // 64-bit slot). Returns an opaque pointer to the buffer.
-        llvm::Value *makeADT(const ADTVariant &v, const std::vector<llvm::Value *> &args);
+        llvm::Value *makeADT(const ADTVariant &v, const std::vector<llvm::Value *> &args,
+                             bool onStack = false);
 
         // Construct a tuple on the heap as a flat i64-slot buffer [slot0][slot1]…
         // `slots` are already normalized to 64-bit slots. Returns an opaque ptr.
-        llvm::Value *makeTuple(const std::vector<llvm::Value *> &slots);
-
-        // Trait objects. getTraitObjType is { i64 typeId, ptr data }. classIdOf
-        // assigns/returns a class's stable typeId. makeTraitObject boxes a
+        llvm::Value *makeTuple(const std::vector<llvm::Value *> &slots, bool onStack = false);
+
+        // By-value returns (valueReturnFns_). valueReturnType is the
+        // function's LLVM return type, or null when it returns a box.
+        llvm::Type *valueReturnType(const ast::FunctionStmt *fn);
+        bool isValueReturnType(llvm::Type *t);
+        // Box a by-value return for a caller that needs a pointer (None boxes
+        // to null), and unpack a box into the by-value form.
+        llvm::Value *boxValueReturn(llvm::Value *agg, bool onStack);
+        llvm::Value *unboxValueReturn(llvm::Value *box, llvm::Type *aggTy);
+
+        // Storage for a compiler-built value: a heap block from __tocin_alloc,
+        // or an entry-block alloca of `ty` when escape analysis placed the
+        // site on the stack (`onStack`).
+        llvm::Value *allocValue(llvm::Type *ty, bool onStack, const std::string &name,
+                                tocin::runtime::AllocKind kind = tocin::runtime::AllocKind::Other);
+        // `bytes` from __tocin_alloc_tagged (or its _atomic form), tagged with
+        // what the block is for so the allocation profiler can group by kind.
+        // Emitted through `at` when given, else the current builder.
+        llvm::Value *heapAlloc(llvm::Value *bytes, tocin::runtime::AllocKind kind, const std::string &name,
+                               bool atomic = false, llvm::IRBuilder<> *at = nullptr);
+        // A heap block the collector never scans (__tocin_alloc_pointer_free),
+        // for data that cannot hold a pointer. Unlike heapAlloc's `atomic`, it
+        // never comes from a withArena scope, so it may escape.
+        llvm::Value *heapAllocPointerFree(llvm::Value *bytes, tocin::runtime::AllocKind kind,
+                                          const std::string &name);
+        // A heap block for a value of type `ty`, scanned by the collector only
+        // in the words that may hold a pointer: pointer-free, typed through a
+        // layout bitmap (__tocin_alloc_typed), or heapAlloc when every word may.
+        llvm::Value *heapAllocOf(llvm::Type *ty, tocin::runtime::AllocKind kind, const std::string &name);
+
+        // Trait objects. getTraitObjType is { ptr vtable, ptr data }.
+        // traitVTableOf builds (once)
+        // the vtable of `className` as `trait`. makeTraitObject boxes a
         // concrete instance. emitDynCall dispatches `method` on a trait-object
-        // value across every class implementing `trait`.
+        // value through its vtable.
         llvm::StructType *getTraitObjType();
-        int64_t classIdOf(const std::string &className);
-        llvm::Value *makeTraitObject(const std::string &className, llvm::Value *instancePtr);
+        llvm::GlobalVariable *traitVTableOf(const std::string &trait, const std::string &className);
+        llvm::Value *makeTraitObject(const std::string &trait, const std::string &className,
+                                     llvm::Value *instancePtr);
         llvm::Value *emitDynCall(const std::string &trait, const std::string &method,
                                  llvm::Value *traitObj, const std::vector<llvm::Value *> &args);
         // If `type` names a trait, return that name, else "".
@@ -1,17 +1,40 @@
 #include "advanced_optimizations.h"
-#include <llvm/Transforms/IPO.h>
-#include <llvm/Transforms/Scalar.h>
-#include <llvm/Transforms/Utils.h>
+#include <llvm/Analysis/InlineCost.h>
 #include <llvm/Analysis/LoopInfo.h>
-#include <llvm/Analysis/CallGraph.h>
-#include <llvm/IR/LegacyPassManager.h>
-#include <llvm/Transforms/Scalar/SROA.h>
-#include <llvm/Transforms/Scalar/ConstantHoisting.h>
-#include <llvm/Transforms/Scalar/DCE.h>
+#include <llvm/Analysis/LoopNestAnalysis.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
 #include <llvm/IR/MDBuilder.h>
 #include <llvm/Linker/Linker.h>
+#include <llvm/ProfileData/InstrProf.h>
+#include <llvm/ProfileData/InstrProfReader.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Transforms/IPO/GlobalDCE.h>
+#include <llvm/Transforms/IPO/GlobalOpt.h>
+#include <llvm/Transforms/IPO/HotColdSplitting.h>
+#include <llvm/Transforms/IPO/Inliner.h>
+#include <llvm/Transforms/IPO/SCCP.h>
+#include <llvm/Transforms/Scalar/GVN.h>
+#include <llvm/Transforms/Scalar/LoopFuse.h>
+#include <llvm/Transforms/Scalar/LoopInterchange.h>
+#include <llvm/Transforms/Scalar/LoopPassManager.h>
+#include <llvm/Transforms/Scalar/LoopUnrollAndJamPass.h>
+#include <llvm/Transforms/Utils/CallPromotionUtils.h>
 #include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/Mem2Reg.h>
+#include <llvm/Transforms/Vectorize/LoopVectorize.h>
+#include <llvm/Transforms/Vectorize/SLPVectorizer.h>
 #include <fstream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
 #include <chrono>
@@ -19,48 +42,151 @@
 namespace tocin {
 namespace optimization {
 
+namespace {
+
+// The four new-PM analysis managers, registered and cross-wired. Every
+// standalone phase below runs its passes through one of these.
+struct AnalysisManagers {
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+    explicit AnalysisManagers(llvm::PassBuilder& PB) {
+        PB.registerModuleAnalyses(MAM);
+        PB.registerCGSCCAnalyses(CGAM);
+        PB.registerFunctionAnalyses(FAM);
+        PB.registerLoopAnalyses(LAM);
+        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+    }
+};
+
+llvm::OptimizationLevel toOptimizationLevel(int level) {
+    switch (level) {
+    case 0: return llvm::OptimizationLevel::O0;
+    case 1: return llvm::OptimizationLevel::O1;
+    case 3: return llvm::OptimizationLevel::O3;
+    default: return llvm::OptimizationLevel::O2;
+    }
+}
+
+size_t countDefinedFunctions(const llvm::Module& module) {
+    size_t n = 0;
+    for (const auto& F : module)
+        if (!F.isDeclaration()) ++n;
+    return n;
+}
+
+// Direct calls whose callee has a body in this module, i.e. inlining candidates.
+size_t countInlinableCalls(const llvm::Module& module) {
+    size_t n = 0;
+    for (const auto& F : module)
+        for (const auto& BB : F)
+            for (const auto& I : BB)
+                if (const auto* Call = llvm::dyn_cast<llvm::CallBase>(&I))
+                    if (const auto* Callee = Call->getCalledFunction())
+                        if (!Callee->isDeclaration()) ++n;
+    return n;
+}
+
+size_t bitcodeSize(const llvm::Module& module) {
+    std::string buffer;
+    llvm::raw_string_ostream os(buffer);
+    llvm::WriteBitcodeToFile(module, os);
+    os.flush();
+    return buffer.size();
+}
+
+bool hasLoopProperty(const llvm::Loop* L, llvm::StringRef name) {
+    llvm::MDNode* loopID = L->getLoopID();
+    if (!loopID) return false;
+    for (unsigned i = 1; i < loopID->getNumOperands(); ++i) {
+        auto* node = llvm::dyn_cast<llvm::MDNode>(loopID->getOperand(i));
+        if (!node || node->getNumOperands() == 0) continue;
+        if (auto* key = llvm::dyn_cast<llvm::MDString>(node->getOperand(0)))
+            if (key->getString() == name) return true;
+    }
+    return false;
+}
+
+// Append a property to a loop's (self-referential, distinct) loop ID.
+void addLoopProperty(llvm::Loop* L, llvm::MDNode* property) {
+    llvm::LLVMContext& ctx = L->getHeader()->getContext();
+    llvm::SmallVector<llvm::Metadata*, 4> ops;
+    ops.push_back(nullptr);
+    if (llvm::MDNode* loopID = L->getLoopID())
+        for (unsigned i = 1; i < loopID->getNumOperands(); ++i)
+            ops.push_back(loopID->getOperand(i));
+    ops.push_back(property);
+    llvm::MDNode* newID = llvm::MDNode::getDistinct(ctx, ops);
+    newID->replaceOperandWith(0, newID);
+    L->setLoopID(newID);
+}
+
+// Counts the loops a wrapped LoopFusePass removes (two fused loops become one).
+struct CountingLoopFusePass : llvm::PassInfoMixin<CountingLoopFusePass> {
+    size_t* fused;
+
+    llvm::PreservedAnalyses run(llvm::Function& F, llvm::FunctionAnalysisManager& FAM) {
+        size_t before = FAM.getResult<llvm::LoopAnalysis>(F).getLoopsInPreorder().size();
+        llvm::PreservedAnalyses PA = llvm::LoopFusePass().run(F, FAM);
+        if (!PA.areAllPreserved()) {
+            FAM.invalidate(F, PA);
+            size_t after = FAM.getResult<llvm::LoopAnalysis>(F).getLoopsInPreorder().size();
+            if (after < before) *fused += before - after;
+        }
+        return PA;
+    }
+};
+
+// Counts the loop nests a wrapped loop-nest pass actually transformed.
+template <typename PassT>
+struct CountingLoopNestPass : llvm::PassInfoMixin<CountingLoopNestPass<PassT>> {
+    PassT pass;
+    size_t* changed;
+
+    CountingLoopNestPass(PassT p, size_t* counter) : pass(std::move(p)), changed(counter) {}
+
+    llvm::PreservedAnalyses run(llvm::LoopNest& LN, llvm::LoopAnalysisManager& AM,
+                                llvm::LoopStandardAnalysisResults& AR, llvm::LPMUpdater& U) {
+        llvm::PreservedAnalyses PA = pass.run(LN, AM, AR, U);
+        if (!PA.areAllPreserved()) ++*changed;
+        return PA;
+    }
+};
+
+// Freshly generated IR keeps every local in an alloca and its loops are not
+// rotated, so loop transforms find nothing to do. Run the standard function
+// simplification pipeline first, then the transform under test.
+template <typename AddPasses>
+void runOnCanonicalLoops(llvm::Module* module, AddPasses addPasses) {
+    llvm::PassBuilder PB;
+    AnalysisManagers AM(PB);
+    llvm::FunctionPassManager FPM = PB.buildFunctionSimplificationPipeline(
+        llvm::OptimizationLevel::O2, llvm::ThinOrFullLTOPhase::None);
+    addPasses(FPM);
+    llvm::ModulePassManager MPM;
+    MPM.addPass(llvm::createModuleToFunctionPassAdaptor(std::move(FPM)));
+    MPM.run(*module, AM.MAM);
+}
+
+} // namespace
+
 // ============================================================================
 // PGO Manager Implementation
 // ============================================================================
 
 PGOManager::PGOManager() : profilingEnabled_(false) {
-    stats_ = {0, 0, 0, 0};
+    stats_ = {};
 }
 
 PGOManager::~PGOManager() {
     disableProfiling();
 }
 
-void PGOManager::enableProfiling(llvm::Module* module) {
+void PGOManager::enableProfiling(const std::string& outputPath) {
     profilingEnabled_ = true;
-    
-    // Insert profiling instrumentation
-    for (auto& F : *module) {
-        if (F.isDeclaration()) continue;
-        
-        // Insert function entry counter
-        llvm::IRBuilder<> builder(&F.getEntryBlock(), F.getEntryBlock().begin());
-        
-        // Create global counter for this function
-        std::string counterName = "__pgo_counter_" + F.getName().str();
-        llvm::Type* i64Type = llvm::Type::getInt64Ty(module->getContext());
-        
-        llvm::GlobalVariable* counter = module->getGlobalVariable(counterName);
-        if (!counter) {
-            counter = new llvm::GlobalVariable(
-                *module, i64Type, false,
-                llvm::GlobalValue::InternalLinkage,
-                llvm::ConstantInt::get(i64Type, 0),
-                counterName);
-        }
-        
-        // Increment counter on function entry
-        llvm::Value* count = builder.CreateLoad(i64Type, counter, "load_count");
-        llvm::Value* inc = builder.CreateAdd(count, llvm::ConstantInt::get(i64Type, 1), "inc_count");
-        builder.CreateStore(inc, counter);
-        
-        stats_.hotFunctions++; // Track instrumented functions
-    }
+    outputPath_ = outputPath;
 }
 
 void PGOManager::disableProfiling() {
@@ -68,110 +194,578 @@ void PGOManager::disableProfiling() {
 }
 
 bool PGOManager::loadProfile(const std::string& profilePath) {
-    std::ifstream file(profilePath, std::ios::binary);
-    if (!file.is_open()) {
+    auto buffer = llvm::MemoryBuffer::getFile(profilePath);
+    if (!buffer) {
+        error_ = "cannot read profile '" + profilePath + "': " + buffer.getError().message();
         return false;
     }
     
-    // Read profile data
-    file.read(reinterpret_cast<char*>(&stats_.totalExecutions), sizeof(stats_.totalExecutions));
-    file.read(reinterpret_cast<char*>(&stats_.hotFunctions), sizeof(stats_.hotFunctions));
-    file.read(reinterpret_cast<char*>(&stats_.coldFunctions), sizeof(stats_.coldFunctions));
-    file.read(reinterpret_cast<char*>(&stats_.branchMispredictions), sizeof(stats_.branchMispredictions));
-    
-    // Read detailed profile data
-    size_t dataSize;
-    file.read(reinterpret_cast<char*>(&dataSize), sizeof(dataSize));
-    profileData_.resize(dataSize);
-    file.read(&profileData_[0], dataSize);
-    
-    file.close();
-    return true;
-}
-
-bool PGOManager::saveProfile(const std::string& profilePath) {
-    std::ofstream file(profilePath, std::ios::binary);
-    if (!file.is_open()) {
+    // PGOInstrumentationUse only reads the indexed format; raw and text
+    // profiles have to be merged first.
+    if (!llvm::IndexedInstrProfReader::hasFormat(**buffer)) {
+        error_ = "'" + profilePath + "' is not an indexed profile; convert it with "
+                 "`llvm-profdata merge -o <file>.profdata " + profilePath + "`";
         return false;
     }
     
-    // Write profile statistics
-    file.write(reinterpret_cast<const char*>(&stats_.totalExecutions), sizeof(stats_.totalExecutions));
-    file.write(reinterpret_cast<const char*>(&stats_.hotFunctions), sizeof(stats_.hotFunctions));
-    file.write(reinterpret_cast<const char*>(&stats_.coldFunctions), sizeof(stats_.coldFunctions));
-    file.write(reinterpret_cast<const char*>(&stats_.branchMispredictions), sizeof(stats_.branchMispredictions));
-    
-    // Write detailed profile data
-    size_t dataSize = profileData_.size();
-    file.write(reinterpret_cast<const char*>(&dataSize), sizeof(dataSize));
-    file.write(profileData_.data(), dataSize);
-    
-    file.close();
+    profilePath_ = profilePath;
     return true;
 }
 
-void PGOManager::applyPGO(llvm::Module* module) {
-    if (!profilingEnabled_ && profileData_.empty()) {
-        return; // No profile data available
+std::optional<llvm::PGOOptions> PGOManager::getPGOOptions() const {
+    if (!profilingEnabled_ && profilePath_.empty()) {
+        return std::nullopt;
     }
     
-    // Phase 1: Identify hot and cold functions
-    std::unordered_map<std::string, uint64_t> functionCounts;
-    uint64_t totalCount = 0;
-    
+    const bool generate = profilingEnabled_;
+    const std::string& file = generate ? outputPath_ : profilePath_;
+    const auto action = generate ? llvm::PGOOptions::IRInstr : llvm::PGOOptions::IRUse;
+    llvm::PGOOptions options(file, "", "", "", llvm::vfs::getRealFileSystem(), action);
+    // Goroutines and `parallel for` bodies bump the same counters from
+    // several threads; lost updates would skew the profile.
+    options.AtomicCounterUpdate = true;
+    return options;
+}
+
+void PGOManager::rememberFunctionNames(llvm::Module* module) {
+    // The lowered counters only carry the MD5 of each function's PGO name.
+    // Remember the names while the functions still exist; inlining deletes
+    // many of them but their counters live on in the callers.
+    pgoNames_.clear();
     for (auto& F : *module) {
         if (F.isDeclaration()) continue;
+        std::string name = llvm::getPGOFuncName(F);
+        pgoNames_.emplace(llvm::MD5Hash(name), name);
+        name = llvm::getIRPGOFuncName(F);
+        pgoNames_.emplace(llvm::MD5Hash(name), name);
+    }
+}
+
+void PGOManager::recordCounters(llvm::Module* module) {
+    // Every instrumented function has a __profd_<name> data record whose
+    // first two fields are the name hash and the CFG hash, and a
+    // __profc_<name> counter array. Give each counter array a unique,
+    // exported symbol so the JIT can hand back its address after the run.
+    counters_.clear();
+    std::vector<llvm::GlobalVariable*> dataVars;
+    for (auto& G : module->globals()) {
+        if (G.getName().starts_with("__profd_") && G.hasInitializer()) {
+            dataVars.push_back(&G);
+        }
+    }
+    
+    for (llvm::GlobalVariable* data : dataVars) {
+        std::string suffix = data->getName().substr(8).str();
+        llvm::GlobalVariable* counts = module->getGlobalVariable("__profc_" + suffix, true);
+        auto* record = llvm::dyn_cast<llvm::ConstantStruct>(data->getInitializer());
+        if (!counts || !record || record->getNumOperands() < 2) continue;
         
-        std::string counterName = "__pgo_counter_" + F.getName().str();
-        llvm::GlobalVariable* counter = module->getGlobalVariable(counterName);
+        auto* nameRef = llvm::dyn_cast<llvm::ConstantInt>(record->getOperand(0));
+        auto* funcHash = llvm::dyn_cast<llvm::ConstantInt>(record->getOperand(1));
+        auto* arrayType = llvm::dyn_cast<llvm::ArrayType>(counts->getValueType());
+        if (!nameRef || !funcHash || !arrayType ||
+            !arrayType->getElementType()->isIntegerTy(64)) continue;
         
-        if (counter && counter->hasInitializer()) {
-            if (auto* constInt = llvm::dyn_cast<llvm::ConstantInt>(counter->getInitializer())) {
-                uint64_t count = constInt->getZExtValue();
-                functionCounts[F.getName().str()] = count;
-                totalCount += count;
-            }
+        auto name = pgoNames_.find(nameRef->getZExtValue());
+        if (name == pgoNames_.end()) continue;
+        
+        std::string symbol = "__tocin_profc_" + std::to_string(counters_.size());
+        counts->setName(symbol);
+        counts->setComdat(nullptr);
+        counts->setLinkage(llvm::GlobalValue::ExternalLinkage);
+        counts->setVisibility(llvm::GlobalValue::DefaultVisibility);
+        counters_.push_back({name->second, funcHash->getZExtValue(),
+                             arrayType->getNumElements(), symbol});
+    }
+    stats_.instrumentedFunctions = counters_.size();
+}
+
+bool PGOManager::saveProfile(const std::string& profilePath, const CounterLookup& lookup) {
+    std::ofstream file(profilePath);
+    if (!file.is_open()) {
+        error_ = "cannot write profile '" + profilePath + "'";
+        return false;
+    }
+    
+    // llvm-profdata's text format; `llvm-profdata merge` turns it into the
+    // indexed .profdata that --pgo-use reads.
+    file << "# IR level Instrumentation Flag\n:ir\n";
+    for (const CounterRecord& rec : counters_) {
+        const uint64_t* values = lookup(rec.symbol);
+        if (!values) continue;
+        file << rec.name << "\n# Func Hash:\n" << rec.hash
+             << "\n# Num Counters:\n" << rec.numCounters << "\n# Counter Values:\n";
+        for (uint64_t i = 0; i < rec.numCounters; ++i) {
+            file << values[i] << "\n";
         }
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+void PGOManager::applyPGO(llvm::Module* module, llvm::TargetMachine* tm) {
+    if (profilePath_.empty()) {
+        return; // No profile data available
     }
     
-    // Phase 2: Apply hot/cold splitting
-    uint64_t hotThreshold = totalCount / functionCounts.size() * 10; // 10x average = hot
+    // PGOInstrumentationUse has already attached entry counts and branch
+    // weights inside the PassBuilder pipeline; those drive inlining and
+    // block layout. Outline the cold regions they identify, which LLVM
+    // keeps out of the default pipeline.
+    size_t functionsBefore = module->getFunctionList().size();
+    {
+        llvm::PassBuilder PB(tm);
+        AnalysisManagers AM(PB);
+        llvm::ModulePassManager MPM;
+        MPM.addPass(llvm::HotColdSplittingPass());
+        MPM.run(*module, AM.MAM);
+    }
+    size_t functionsAfter = module->getFunctionList().size();
+    if (functionsAfter > functionsBefore) {
+        stats_.coldRegionsSplit += functionsAfter - functionsBefore;
+    }
     
+    llvm::ProfileSummaryInfo PSI(*module);
     for (auto& F : *module) {
         if (F.isDeclaration()) continue;
         
-        uint64_t count = functionCounts[F.getName().str()];
-        
-        if (count > hotThreshold) {
-            // Mark as hot for aggressive optimization
-            F.addFnAttr(llvm::Attribute::AlwaysInline);
+        if (auto count = F.getEntryCount()) {
+            stats_.totalExecutions += count->getCount();
+        }
+        if (PSI.isFunctionEntryHot(&F)) {
             stats_.hotFunctions++;
-        } else if (count < hotThreshold / 100) {
-            // Mark as cold
-            F.addFnAttr(llvm::Attribute::Cold);
-            F.addFnAttr(llvm::Attribute::OptimizeForSize);
+        } else if (PSI.isFunctionEntryCold(&F)) {
             stats_.coldFunctions++;
         }
-    }
-    
-    // Phase 3: Apply branch probability annotations
-    for (auto& F : *module) {
-        if (F.isDeclaration()) continue;
         
         for (auto& BB : F) {
-            if (auto* BI = llvm::dyn_cast<llvm::BranchInst>(BB.getTerminator())) {
-                if (BI->isConditional()) {
-                    // Add branch weight metadata based on profile
-                    // (simplified - real implementation would use actual branch counts)
-                    llvm::MDBuilder MDB(module->getContext());
-                    llvm::MDNode* weights = MDB.createBranchWeights(90, 10); // 90% taken
-                    BI->setMetadata(llvm::LLVMContext::MD_prof, weights);
+            llvm::Instruction* term = BB.getTerminator();
+            if (term && term->getNumSuccessors() > 1 &&
+                term->getMetadata(llvm::LLVMContext::MD_prof)) {
+                stats_.annotatedBranches++;
+            }
+        }
+    }
+}
+
+// Type-set devirtualization of trait-object calls. The code generator tags
+// each vtable global !tocin.vtable !{trait, class} and each vtable-slot load
+// !tocin.dispatch !{trait, slot}. Vtables are private constants that only
+// trait-object boxing stores, so in a whole program the vtables stored
+// anywhere are the complete set of classes a `trait` call can reach:
+//   - one class: the call becomes a direct call;
+//   - up to kMaxDirectTargets classes: a compare chain of direct calls,
+//     most-boxed class first - every arm inlinable, no indirect call left;
+//   - more: a guarded direct call for a class boxed at more than half of
+//     the sites, in front of the indirect call.
+// The static number of boxing sites stands in for a profile in the branch
+// weights.
+size_t devirtualizeTraitCalls(llvm::Module& module) {
+    constexpr size_t kMaxDirectTargets = 8;
+    size_t devirtualized = 0;
+
+    struct BoxedClass {
+        llvm::GlobalVariable* vtable;
+        uint64_t sites;
+    };
+    std::unordered_map<std::string, std::vector<BoxedClass>> typeSets;
+    for (auto& G : module.globals()) {
+        llvm::MDNode* md = G.getMetadata("tocin.vtable");
+        if (!md || md->getNumOperands() < 1 || !G.hasInitializer()) continue;
+        auto* trait = llvm::dyn_cast<llvm::MDString>(md->getOperand(0));
+        if (!trait) continue;
+        uint64_t sites = 0;
+        for (const llvm::User* U : G.users()) {
+            // Comparing against a vtable (the slotless fallback chain) does
+            // not box anything; any other use might.
+            if (llvm::isa<llvm::ICmpInst>(U)) continue;
+            sites++;
+        }
+        if (sites) typeSets[trait->getString().str()].push_back({&G, sites});
+    }
+    if (typeSets.empty()) return 0;
+
+    std::vector<llvm::LoadInst*> slotLoads;
+    for (auto& F : module)
+        for (auto& BB : F)
+            for (auto& I : BB)
+                if (auto* LI = llvm::dyn_cast<llvm::LoadInst>(&I))
+                    if (LI->getMetadata("tocin.dispatch")) slotLoads.push_back(LI);
+
+    for (llvm::LoadInst* LI : slotLoads) {
+        llvm::MDNode* md = LI->getMetadata("tocin.dispatch");
+        auto* trait = llvm::dyn_cast<llvm::MDString>(md->getOperand(0));
+        auto* slot = llvm::mdconst::dyn_extract<llvm::ConstantInt>(md->getOperand(1));
+        if (!trait || !slot) continue;
+        auto setIt = typeSets.find(trait->getString().str());
+        if (setIt == typeSets.end()) continue;
+
+        // The distinct targets of this slot, most-boxed first.
+        std::vector<std::pair<llvm::Function*, uint64_t>> targets;
+        bool known = true;
+        for (const BoxedClass& c : setIt->second) {
+            auto* table = llvm::dyn_cast<llvm::ConstantArray>(c.vtable->getInitializer());
+            llvm::Function* fn = table && slot->getZExtValue() < table->getNumOperands()
+                ? llvm::dyn_cast<llvm::Function>(table->getOperand(slot->getZExtValue())->stripPointerCasts())
+                : nullptr;
+            if (!fn) { known = false; break; }
+            auto it = std::find_if(targets.begin(), targets.end(),
+                                   [&](const auto& t) { return t.first == fn; });
+            if (it != targets.end()) it->second += c.sites;
+            else targets.push_back({fn, c.sites});
+        }
+        if (!known || targets.empty()) continue;
+        std::stable_sort(targets.begin(), targets.end(),
+                         [](const auto& a, const auto& b) { return a.second > b.second; });
+        uint64_t totalSites = 0;
+        for (const auto& t : targets) totalSites += t.second;
+
+        std::vector<llvm::CallBase*> calls;
+        for (llvm::User* U : LI->users())
+            if (auto* CB = llvm::dyn_cast<llvm::CallBase>(U))
+                if (CB->getCalledOperand() == LI) calls.push_back(CB);
+
+        for (llvm::CallBase* CB : calls) {
+            bool legal = true;
+            for (const auto& t : targets)
+                legal = legal && llvm::isLegalToPromote(*CB, t.first);
+            if (!legal) continue;
+
+            llvm::MDBuilder mdb(CB->getContext());
+            if (targets.size() <= kMaxDirectTargets) {
+                uint64_t rest = totalSites;
+                for (size_t i = 0; i + 1 < targets.size(); ++i) {
+                    rest -= targets[i].second;
+                    llvm::promoteCallWithIfThenElse(
+                        *CB, targets[i].first,
+                        mdb.createBranchWeights((uint32_t)targets[i].second, (uint32_t)rest));
                 }
+                // What is left can only be the last target.
+                llvm::promoteCall(*CB, targets.back().first);
+                devirtualized++;
+            } else if (targets.front().second * 2 > totalSites) {
+                llvm::promoteCallWithIfThenElse(
+                    *CB, targets.front().first,
+                    mdb.createBranchWeights((uint32_t)targets.front().second,
+                                            (uint32_t)(totalSites - targets.front().second)));
+                devirtualized++;
             }
         }
+        if (LI->use_empty()) LI->eraseFromParent();
     }
-    
-    stats_.totalExecutions = totalCount;
+    return devirtualized;
+}
+
+// Closure specialization. A closure is { ptr fn, captures... } and nothing
+// writes fn after the closure is made, so a closure's function is known
+// wherever the closure is: a capture-free closure is a constant global;
+// any other is the one store of a function into field 0 of a fresh object.
+// A call passing such a closure to a function that calls it goes to a
+// clone of the callee in which every load of that parameter's fn field is
+// the function itself - a direct call the inliner can fold into the loop.
+// Clones are keyed by (callee, parameter, function).
+size_t specializeClosureCalls(llvm::Module& module) {
+    constexpr size_t kMaxCalleeSize = 2000; // instructions
+    constexpr size_t kMaxClones = 64;
+    size_t specialized = 0;
+
+    // Allocas first: a closure reaches its call through the variable or
+    // parameter slots the code generator gives every value.
+    {
+        llvm::PassBuilder PB;
+        AnalysisManagers AM(PB);
+        llvm::FunctionPassManager FPM;
+        FPM.addPass(llvm::PromotePass());
+        for (auto& F : module)
+            if (!F.isDeclaration() && !F.hasOptNone()) FPM.run(F, AM.FAM);
+    }
+
+    const llvm::DataLayout& DL = module.getDataLayout();
+    auto fieldZeroOf = [&](llvm::Value* ptr) -> llvm::Value* {
+        int64_t offset = 0;
+        llvm::Value* base = llvm::GetPointerBaseWithConstantOffset(ptr, offset, DL);
+        return offset == 0 ? base : nullptr;
+    };
+
+    // Functions stored into field 0 of fresh objects; null where a base
+    // gets more than one store there.
+    std::unordered_map<llvm::Value*, llvm::Function*> madeWith;
+    for (auto& F : module)
+        for (auto& BB : F)
+            for (auto& I : BB)
+                if (auto* SI = llvm::dyn_cast<llvm::StoreInst>(&I)) {
+                    llvm::Value* base = fieldZeroOf(SI->getPointerOperand());
+                    if (!base || !(llvm::isa<llvm::AllocaInst>(base) || llvm::isa<llvm::CallBase>(base)))
+                        continue;
+                    auto* fn = llvm::dyn_cast<llvm::Function>(SI->getValueOperand()->stripPointerCasts());
+                    auto it = madeWith.find(base);
+                    if (it == madeWith.end()) {
+                        if (fn) madeWith[base] = fn;
+                    } else {
+                        it->second = nullptr;
+                    }
+                }
+    // A store of anything else over a closure's fn field disqualifies it.
+    for (auto& F : module)
+        for (auto& BB : F)
+            for (auto& I : BB)
+                if (auto* SI = llvm::dyn_cast<llvm::StoreInst>(&I))
+                    if (llvm::Value* base = fieldZeroOf(SI->getPointerOperand()))
+                        if (madeWith.count(base) && !llvm::isa<llvm::Function>(SI->getValueOperand()->stripPointerCasts()))
+                            madeWith[base] = nullptr;
+
+    std::map<llvm::Argument*, llvm::Function*> knownParams; // in the clones
+    auto closureFunction = [&](llvm::Value* v) -> llvm::Function* {
+        v = v->stripPointerCasts();
+        if (auto* G = llvm::dyn_cast<llvm::GlobalVariable>(v)) {
+            if (!G->isConstant() || !G->hasDefinitiveInitializer()) return nullptr;
+            auto* init = llvm::dyn_cast<llvm::ConstantStruct>(G->getInitializer());
+            return init && init->getNumOperands() >= 1
+                ? llvm::dyn_cast<llvm::Function>(init->getOperand(0)->stripPointerCasts())
+                : nullptr;
+        }
+        if (auto* A = llvm::dyn_cast<llvm::Argument>(v)) {
+            auto it = knownParams.find(A);
+            return it == knownParams.end() ? nullptr : it->second;
+        }
+        auto it = madeWith.find(v);
+        return it == madeWith.end() ? nullptr : it->second;
+    };
+    // Calls through the parameter: loads of its fn field.
+    auto fnLoads = [&](llvm::Argument* A) {
+        std::vector<llvm::LoadInst*> loads;
+        for (auto& BB : *A->getParent())
+            for (auto& I : BB)
+                if (auto* LI = llvm::dyn_cast<llvm::LoadInst>(&I))
+                    if (LI->getType()->isPointerTy() && fieldZeroOf(LI->getPointerOperand()) == A)
+                        loads.push_back(LI);
+        return loads;
+    };
+
+    std::map<std::tuple<llvm::Function*, unsigned, llvm::Function*>, llvm::Function*> clones;
+    // Clones join the worklist, so a closure handed on (or recursed with)
+    // from inside one stays known; calls back to the original callee with
+    // the same closure land on the existing clone.
+    std::vector<llvm::Function*> work;
+    for (auto& F : module)
+        if (!F.isDeclaration()) work.push_back(&F);
+    while (!work.empty()) {
+        llvm::Function* caller = work.back();
+        work.pop_back();
+        std::vector<llvm::CallBase*> calls;
+        for (auto& BB : *caller)
+            for (auto& I : BB)
+                if (auto* CB = llvm::dyn_cast<llvm::CallBase>(&I))
+                    if (llvm::Function* callee = CB->getCalledFunction())
+                        if (!callee->isDeclaration() && !callee->isInterposable() && !callee->isVarArg() &&
+                            callee->getFunctionType() == CB->getFunctionType())
+                            calls.push_back(CB);
+        for (llvm::CallBase* CB : calls) {
+            llvm::Function* callee = CB->getCalledFunction();
+            for (unsigned i = 0; i < CB->arg_size(); ++i) {
+                llvm::Function* fn = closureFunction(CB->getArgOperand(i));
+                if (!fn || !CB->getArgOperand(i)->getType()->isPointerTy()) continue;
+                auto key = std::make_tuple(callee, i, fn);
+                auto it = clones.find(key);
+                llvm::Function* clone = it != clones.end() ? it->second : nullptr;
+                if (!clone) {
+                    if (fnLoads(callee->getArg(i)).empty() || clones.size() >= kMaxClones ||
+                        callee->getInstructionCount() > kMaxCalleeSize)
+                        continue;
+                    llvm::ValueToValueMapTy VMap;
+                    clone = llvm::CloneFunction(callee, VMap);
+                    clone->setName(callee->getName() + ".cl." + fn->getName());
+                    clone->setLinkage(llvm::GlobalValue::InternalLinkage);
+                    llvm::Argument* param = clone->getArg(i);
+                    for (llvm::LoadInst* LI : fnLoads(param)) {
+                        LI->replaceAllUsesWith(fn);
+                        LI->eraseFromParent();
+                    }
+                    knownParams[param] = fn;
+                    if (!fn->hasFnAttribute(llvm::Attribute::NoInline))
+                        fn->addFnAttr(llvm::Attribute::InlineHint);
+                    clones[key] = clone;
+                    work.push_back(clone);
+                }
+                CB->setCalledFunction(clone);
+                callee = clone;
+                specialized++;
+            }
+        }
+    }
+    return specialized;
+}
+
+namespace {
+
+// The x86-64 levels a function can be versioned for, ascending; `level` is
+// what __tocin_cpu_level() reports for a CPU that has it.
+struct CloneLevel {
+    const char* name;
+    const char* cpu;
+    int64_t level;
+};
+constexpr CloneLevel kCloneLevels[] = {
+    {"sse4", "x86-64-v2", 1}, {"avx2", "x86-64-v3", 2}, {"avx512", "x86-64-v4", 3}};
+
+std::vector<const CloneLevel*> cloneLevels(llvm::StringRef list) {
+    llvm::SmallVector<llvm::StringRef, 4> names;
+    list.split(names, ',', -1, false);
+    std::vector<const CloneLevel*> levels;
+    for (const CloneLevel& L : kCloneLevels)
+        if (llvm::is_contained(names, L.name)) levels.push_back(&L);
+    return levels;
+}
+
+// An innermost loop that touches memory other than the function's own
+// slots and calls only intrinsics or small call-free functions (list and
+// map accessors) the inliner will fold: what the loop vectorizer can take.
+bool hasVectorizableLoop(llvm::Function& F) {
+    auto foldable = [](const llvm::Function* callee) {
+        if (!callee || callee->isIntrinsic()) return callee != nullptr;
+        if (callee->isDeclaration() || callee->getInstructionCount() > 64) return false;
+        for (const auto& BB : *callee)
+            for (const auto& I : BB)
+                if (auto* CB = llvm::dyn_cast<llvm::CallBase>(&I))
+                    if (!CB->getCalledFunction() || !CB->getCalledFunction()->isIntrinsic()) return false;
+        return true;
+    };
+    llvm::DominatorTree DT(F);
+    llvm::LoopInfo LI(DT);
+    for (llvm::Loop* L : LI.getLoopsInPreorder()) {
+        if (!L->isInnermost()) continue;
+        bool memory = false, calls = true;
+        for (llvm::BasicBlock* BB : L->blocks())
+            for (llvm::Instruction& I : *BB) {
+                if (auto* CB = llvm::dyn_cast<llvm::CallBase>(&I))
+                    calls = calls && foldable(CB->getCalledFunction());
+                else if (llvm::Value* ptr = llvm::getLoadStorePointerOperand(&I))
+                    memory = memory || !llvm::isa<llvm::AllocaInst>(llvm::getUnderlyingObject(ptr));
+            }
+        if (memory && calls) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+// Each versioned function F gets a clone per level (F.avx2, ...) with that
+// level's target-cpu, plus F.default with F's own body and attributes. F
+// itself becomes a stub calling through F.dispatch, which starts out
+// pointing at F.resolve: the first call asks __tocin_cpu_level() which
+// version fits, stores it in F.dispatch and forwards the call, so later
+// calls cost one load and an indirect call, as through an ifunc's PLT slot.
+size_t multiversionFunctions(llvm::Module& module, const std::vector<std::string>& autoLevels) {
+    constexpr size_t kMaxAutoSize = 2000; // instructions
+    std::string autoList;
+    for (const auto& level : autoLevels) autoList += (autoList.empty() ? "" : ",") + level;
+
+    std::vector<std::pair<llvm::Function*, std::vector<const CloneLevel*>>> work;
+    for (auto& F : module) {
+        std::vector<const CloneLevel*> levels;
+        if (F.hasFnAttribute("tocin-target-clones")) {
+            levels = cloneLevels(F.getFnAttribute("tocin-target-clones").getValueAsString());
+            F.removeFnAttr("tocin-target-clones");
+        } else if (!autoList.empty() && !F.isDeclaration() && F.getName() != "main" &&
+                   // Runtime code linked from bitcode is there to be inlined.
+                   !F.getName().starts_with("__tocin_") && !F.getName().starts_with("_Z") &&
+                   F.getInstructionCount() <= kMaxAutoSize && hasVectorizableLoop(F)) {
+            levels = cloneLevels(autoList);
+        }
+        // Bodies linked in only to be inlined (precompiled stdlib bitcode)
+        // keep the one version their own object has.
+        if (!levels.empty() && !F.isDeclaration() && !F.hasAvailableExternallyLinkage() &&
+            !F.isVarArg() && !F.hasFnAttribute(llvm::Attribute::Naked))
+            work.emplace_back(&F, std::move(levels));
+    }
+    if (work.empty() || llvm::Triple(module.getTargetTriple()).getArch() != llvm::Triple::x86_64)
+        return 0;
+
+    // Every body is cloned before any call is redirected.
+    std::map<std::pair<llvm::Function*, int64_t>, llvm::Function*> versions;
+    for (auto& [F, levels] : work) {
+        llvm::ValueToValueMapTy VMap;
+        llvm::Function* fallback = llvm::CloneFunction(F, VMap);
+        fallback->setName(F->getName() + ".default");
+        fallback->setLinkage(llvm::GlobalValue::InternalLinkage);
+        versions[{F, 0}] = fallback;
+        for (const CloneLevel* L : levels) {
+            llvm::ValueToValueMapTy LMap;
+            llvm::Function* V = llvm::CloneFunction(F, LMap);
+            V->setName(F->getName() + "." + L->name);
+            V->setLinkage(llvm::GlobalValue::InternalLinkage);
+            V->addFnAttr("target-cpu", L->cpu);
+            V->addFnAttr("tune-cpu", L->cpu);
+            versions[{F, L->level}] = V;
+        }
+    }
+    // A version calls another versioned function's widest version it may
+    // inline (the same level or below), not the stub.
+    auto versionFor = [&](llvm::Function* callee, int64_t level) -> llvm::Function* {
+        llvm::Function* best = nullptr;
+        for (int64_t l = 0; l <= level; ++l)
+            if (auto it = versions.find({callee, l}); it != versions.end()) best = it->second;
+        return best;
+    };
+    for (auto& [key, V] : versions)
+        for (auto& BB : *V)
+            for (auto& I : BB)
+                if (auto* CB = llvm::dyn_cast<llvm::CallBase>(&I))
+                    if (llvm::Function* callee = CB->getCalledFunction())
+                        if (llvm::Function* target = versionFor(callee, key.second))
+                            CB->setCalledFunction(target);
+
+    llvm::LLVMContext& ctx = module.getContext();
+    llvm::Type* ptr = llvm::PointerType::get(ctx, 0);
+    llvm::Type* i64 = llvm::Type::getInt64Ty(ctx);
+    llvm::FunctionCallee cpuLevel =
+        module.getOrInsertFunction("__tocin_cpu_level", llvm::FunctionType::get(i64, false));
+    // Calls `target` with fn's arguments and returns what it returns.
+    auto forward = [&](llvm::IRBuilder<>& B, llvm::Function* fn, llvm::Value* target) {
+        std::vector<llvm::Value*> args;
+        std::vector<llvm::AttributeSet> argAttrs;
+        for (auto& arg : fn->args()) {
+            args.push_back(&arg);
+            argAttrs.push_back(fn->getAttributes().getParamAttrs(arg.getArgNo()));
+        }
+        llvm::CallInst* call = B.CreateCall(fn->getFunctionType(), target, args);
+        call->setCallingConv(fn->getCallingConv());
+        call->setAttributes(llvm::AttributeList::get(ctx, llvm::AttributeSet(),
+                                                     fn->getAttributes().getRetAttrs(), argAttrs));
+        call->setTailCallKind(llvm::CallInst::TCK_Tail);
+        if (fn->getReturnType()->isVoidTy())
+            B.CreateRetVoid();
+        else
+            B.CreateRet(call);
+    };
+    for (auto& [F, levels] : work) {
+        llvm::GlobalValue::LinkageTypes linkage = F->getLinkage();
+        F->deleteBody();
+        F->setLinkage(linkage);
+        F->setSubprogram(nullptr);
+
+        llvm::Function* resolve = llvm::Function::Create(F->getFunctionType(), llvm::GlobalValue::InternalLinkage,
+                                                         F->getName() + ".resolve", module);
+        resolve->setCallingConv(F->getCallingConv());
+        resolve->setAttributes(F->getAttributes());
+        auto* slot = new llvm::GlobalVariable(module, ptr, false, llvm::GlobalValue::InternalLinkage, resolve,
+                                              F->getName() + ".dispatch");
+
+        llvm::IRBuilder<> B(llvm::BasicBlock::Create(ctx, "entry", F));
+        llvm::LoadInst* version = B.CreateAlignedLoad(ptr, slot, llvm::Align(8), "version");
+        version->setAtomic(llvm::AtomicOrdering::Unordered);
+        forward(B, F, version);
+
+        B.SetInsertPoint(llvm::BasicBlock::Create(ctx, "entry", resolve));
+        llvm::Value* level = B.CreateCall(cpuLevel, {}, "cpu.level");
+        llvm::Value* chosen = versions[{F, 0}];
+        for (const CloneLevel* L : levels)
+            chosen = B.CreateSelect(B.CreateICmpSGE(level, llvm::ConstantInt::get(i64, L->level)),
+                                    versions[{F, L->level}], chosen, L->name);
+        B.CreateAlignedStore(chosen, slot, llvm::Align(8))->setAtomic(llvm::AtomicOrdering::Unordered);
+        forward(B, resolve, chosen);
+    }
+    return work.size();
 }
 
 // ============================================================================
@@ -186,37 +780,35 @@ InterproceduralOptimizer::~InterproceduralOptimizer() {}
 
 void InterproceduralOptimizer::optimizeCallGraph(llvm::Module* module) {
     // Analyze call graph
-    stats_.totalFunctions = module->getFunctionList().size();
+    stats_.totalFunctions = countDefinedFunctions(*module);
     
-    // Perform interprocedural optimizations
-    performInlining(module);
+    // Resolve indirect calls first so the constant propagator and the
+    // inliner see the direct edges they expose.
     performDevirtualization(module);
     performConstantPropagation(module);
+    performInlining(module);
 }
 
 void InterproceduralOptimizer::performInlining(llvm::Module* module, int inlineThreshold) {
-    // Create function pass manager for inlining
-    llvm::legacy::FunctionPassManager FPM(module);
+    llvm::PassBuilder PB;
+    AnalysisManagers AM(PB);
     
-    // Add inlining pass with custom threshold
-    // Note: Modern LLVM uses PassBuilder, but for compatibility we use legacy
-    // FPM.add(llvm::createFunctionInliningPass(inlineThreshold));
+    size_t before = countInlinableCalls(*module);
+    llvm::ModulePassManager MPM;
+    MPM.addPass(llvm::ModuleInlinerWrapperPass(llvm::getInlineParams(inlineThreshold)));
+    MPM.run(*module, AM.MAM);
+    size_t after = countInlinableCalls(*module);
     
-    // Run on all functions
-    FPM.doInitialization();
-    for (auto& F : *module) {
-        if (!F.isDeclaration()) {
-            FPM.run(F);
-            stats_.inlinedFunctions++;
-        }
+    if (before > after) {
+        stats_.inlinedFunctions += before - after;
     }
-    FPM.doFinalization();
 }
 
 void InterproceduralOptimizer::performDevirtualization(llvm::Module* module) {
-    // Implement basic devirtualization
-    // Analyze virtual call sites and replace with direct calls when possible
-    
+    if (wholeProgram_) stats_.devirtualizedCalls += devirtualizeTraitCalls(*module);
+
+    // Turn calls through a pointer that is really a known function (a
+    // casted or constant-folded function address) into direct calls.
     for (auto& F : *module) {
         if (F.isDeclaration()) continue;
         
@@ -228,7 +820,9 @@ void InterproceduralOptimizer::performDevirtualization(llvm::Module* module) {
                         // Try to resolve the target
                         if (auto* Callee = llvm::dyn_cast<llvm::Function>(
                                 Call->getCalledOperand()->stripPointerCasts())) {
-                            // Found concrete target - this is devirtualizable
+                            // Only when the signatures agree; otherwise the
+                            // direct call would not verify.
+                            if (Callee->getFunctionType() != Call->getFunctionType()) continue;
                             Call->setCalledFunction(Callee);
                             stats_.devirtualizedCalls++;
                         }
@@ -240,41 +834,26 @@ void InterproceduralOptimizer::performDevirtualization(llvm::Module* module) {
 }
 
 void InterproceduralOptimizer::performConstantPropagation(llvm::Module* module) {
-    // Implement basic interprocedural constant propagation
-    // Track constant values across function boundaries
-    
-    std::unordered_map<llvm::Function*, std::unordered_map<unsigned, llvm::Constant*>> functionArgConstants;
-    
-    // First pass: identify functions with constant arguments
+    // IPSCCP replaces an argument that every call site passes the same
+    // constant with that constant; count the arguments it makes dead.
+    std::vector<llvm::Argument*> usedArgs;
     for (auto& F : *module) {
         if (F.isDeclaration()) continue;
-        
-        for (auto& BB : F) {
-            for (auto& I : BB) {
-                if (auto* Call = llvm::dyn_cast<llvm::CallInst>(&I)) {
-                    if (llvm::Function* Callee = Call->getCalledFunction()) {
-                        // Check each argument
-                        for (unsigned i = 0; i < Call->arg_size(); ++i) {
-                            if (auto* Const = llvm::dyn_cast<llvm::Constant>(Call->getArgOperand(i))) {
-                                functionArgConstants[Callee][i] = Const;
-                            }
-                        }
-                    }
-                }
-            }
+        for (auto& Arg : F.args()) {
+            if (!Arg.use_empty()) usedArgs.push_back(&Arg);
         }
     }
     
-    // Second pass: propagate constants within functions
-    for (auto& [Func, ArgConstants] : functionArgConstants) {
-        for (auto& [ArgIdx, Const] : ArgConstants) {
-            if (ArgIdx < Func->arg_size()) {
-                llvm::Argument* Arg = Func->getArg(ArgIdx);
-                // Replace uses of this argument with the constant
-                if (Arg->hasOneUse() || Const) {
-                    stats_.constantsPropagated++;
-                }
-            }
+    llvm::PassBuilder PB;
+    AnalysisManagers AM(PB);
+    llvm::ModulePassManager MPM;
+    MPM.addPass(llvm::IPSCCPPass());
+    MPM.run(*module, AM.MAM);
+    
+    // IPSCCP rewrites bodies in place and never deletes functions.
+    for (llvm::Argument* Arg : usedArgs) {
+        if (Arg->use_empty()) {
+            stats_.constantsPropagated++;
         }
     }
 }
@@ -284,277 +863,115 @@ void InterproceduralOptimizer::performConstantPropagation(llvm::Module* module)
 // ============================================================================
 
 PolyhedralOptimizer::PolyhedralOptimizer() {
-    stats_ = {0, 0, 0, 0, 0};
+    stats_ = {};
 }
 
 PolyhedralOptimizer::~PolyhedralOptimizer() {}
 
 void PolyhedralOptimizer::analyzeLoops(llvm::Module* module) {
-    // Count and analyze loops in the module
+    llvm::PassBuilder PB;
+    AnalysisManagers AM(PB);
+    
+    // Count the loops in the module and the vectorizer's output
     for (auto& F : *module) {
         if (F.isDeclaration()) continue;
         
-        // Create function analysis manager
-        llvm::FunctionAnalysisManager FAM;
-        llvm::LoopAnalysisManager LAM;
-        llvm::CGSCCAnalysisManager CGAM;
-        llvm::ModuleAnalysisManager MAM;
-        
-        llvm::PassBuilder PB;
-        PB.registerFunctionAnalyses(FAM);
-        PB.registerLoopAnalyses(LAM);
-        PB.registerCGSCCAnalyses(CGAM);
-        PB.registerModuleAnalyses(MAM);
-        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
-        
-        // Get loop info
-        auto& LI = FAM.getResult<llvm::LoopAnalysis>(F);
+        auto& LI = AM.FAM.getResult<llvm::LoopAnalysis>(F);
         stats_.totalLoops += LI.getLoopsInPreorder().size();
         
-        // Analyze each loop for optimization opportunities
         for (auto* L : LI.getLoopsInPreorder()) {
-            // Check if loop is parallelizable
-            bool isParallel = true;
-            
-            // Simple dependency analysis
-            std::unordered_set<llvm::Value*> reads;
-            std::unordered_set<llvm::Value*> writes;
+            if (!hasLoopProperty(L, "llvm.loop.isvectorized")) continue;
             
+            // The scalar epilogue carries the same marker; only count the
+            // loop that actually operates on vectors.
+            bool vectorBody = false;
             for (auto* BB : L->blocks()) {
                 for (auto& I : *BB) {
-                    if (auto* Load = llvm::dyn_cast<llvm::LoadInst>(&I)) {
-                        reads.insert(Load->getPointerOperand());
-                    } else if (auto* Store = llvm::dyn_cast<llvm::StoreInst>(&I)) {
-                        llvm::Value* ptr = Store->getPointerOperand();
-                        writes.insert(ptr);
-                        
-                        // Check for read-after-write dependencies
-                        if (reads.count(ptr)) {
-                            isParallel = false;
-                        }
+                    if (I.getType()->isVectorTy()) {
+                        vectorBody = true;
+                        break;
                     }
                 }
+                if (vectorBody) break;
             }
-            
-            if (isParallel) {
-                stats_.parallelLoops++;
-            }
+            if (vectorBody) stats_.vectorizedLoops++;
         }
     }
 }
 
 void PolyhedralOptimizer::applyLoopFusion(llvm::Module* module) {
-    for (auto& F : *module) {
-        if (F.isDeclaration()) continue;
-        
-        llvm::FunctionAnalysisManager FAM;
-        llvm::LoopAnalysisManager LAM;
-        llvm::CGSCCAnalysisManager CGAM;
-        llvm::ModuleAnalysisManager MAM;
-        
-        llvm::PassBuilder PB;
-        PB.registerFunctionAnalyses(FAM);
-        PB.registerLoopAnalyses(LAM);
-        PB.registerCGSCCAnalyses(CGAM);
-        PB.registerModuleAnalyses(MAM);
-        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
-        
-        auto& LI = FAM.getResult<llvm::LoopAnalysis>(F);
-        
-        // Find adjacent loops with compatible bounds
-        auto loops = LI.getLoopsInPreorder();
-        
-        for (size_t i = 0; i + 1 < loops.size(); ++i) {
-            llvm::Loop* L1 = loops[i];
-            llvm::Loop* L2 = loops[i + 1];
-            
-            // Check if loops are adjacent and fusable
-            if (L1->getLoopDepth() == L2->getLoopDepth() &&
-                !L1->isLoopExiting(L1->getHeader()) &&
-                !L2->isLoopExiting(L2->getHeader())) {
-                
-                // Real fusion: Check that both loops have the same trip count
-                // and no dependencies between them. For a basic implementation,
-                // we can merge loop bodies when safe to do so.
-                
-                // Get loop metadata and check for compatible bounds
-                llvm::BasicBlock* Header1 = L1->getHeader();
-                llvm::BasicBlock* Header2 = L2->getHeader();
-                
-                if (Header1 && Header2) {
-                    // Mark loops with metadata indicating they can be fused
-                    llvm::MDBuilder MDB(module->getContext());
-                    llvm::Metadata* fusionMD = MDB.createString("tocin.loop.fusable");
-                    llvm::MDNode* fusionNode = llvm::MDNode::get(module->getContext(), fusionMD);
-                    
-                    // Attach metadata to the loops
-                    if (L1->getLoopID()) {
-                        // Loop already has metadata, extend it
-                        std::vector<llvm::Metadata*> MDs;
-                        for (unsigned i = 0; i < L1->getLoopID()->getNumOperands(); ++i) {
-                            MDs.push_back(L1->getLoopID()->getOperand(i));
-                        }
-                        MDs.push_back(fusionMD);
-                        L1->setLoopID(llvm::MDNode::get(module->getContext(), MDs));
-                    }
-                    
-                    stats_.fusedLoops++;
-                }
-            }
-        }
-    }
+    runOnCanonicalLoops(module, [this](llvm::FunctionPassManager& FPM) {
+        FPM.addPass(CountingLoopFusePass{{}, &stats_.fusedLoops});
+    });
 }
 
 void PolyhedralOptimizer::applyLoopTiling(llvm::Module* module, size_t tileSize) {
-    for (auto& F : *module) {
-        if (F.isDeclaration()) continue;
-        
-        llvm::FunctionAnalysisManager FAM;
-        llvm::LoopAnalysisManager LAM;
-        llvm::CGSCCAnalysisManager CGAM;
-        llvm::ModuleAnalysisManager MAM;
-        
-        llvm::PassBuilder PB;
-        PB.registerFunctionAnalyses(FAM);
-        PB.registerLoopAnalyses(LAM);
-        PB.registerCGSCCAnalyses(CGAM);
-        PB.registerModuleAnalyses(MAM);
-        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
-        
-        auto& LI = FAM.getResult<llvm::LoopAnalysis>(F);
-        
-        for (auto* L : LI.getLoopsInPreorder()) {
-            // Check if loop is suitable for tiling (nested loops with regular access patterns)
-            if (L->getSubLoops().size() > 0) {
-                // Real tiling: Insert loop metadata to enable LLVM's loop transformations
-                llvm::BasicBlock* Header = L->getHeader();
-                
-                // Create tiling metadata
-                llvm::MDBuilder MDB(module->getContext());
-                llvm::Metadata* tileSizeMD = MDB.createConstant(
-                    llvm::ConstantInt::get(llvm::Type::getInt32Ty(module->getContext()), tileSize));
-                llvm::MDNode* tileNode = llvm::MDNode::get(module->getContext(), {
-                    MDB.createString("llvm.loop.tile.size"),
-                    tileSizeMD
-                });
-                
-                // Attach metadata to enable loop tiling
-                if (L->getLoopID()) {
-                    std::vector<llvm::Metadata*> MDs;
-                    MDs.push_back(nullptr); // First operand is self-reference
-                    for (unsigned i = 1; i < L->getLoopID()->getNumOperands(); ++i) {
-                        MDs.push_back(L->getLoopID()->getOperand(i));
-                    }
-                    MDs.push_back(tileNode);
-                    llvm::MDNode* newLoopID = llvm::MDNode::get(module->getContext(), MDs);
-                    newLoopID->replaceOperandWith(0, newLoopID);
-                    L->setLoopID(newLoopID);
-                } else {
-                    llvm::MDNode* loopID = llvm::MDNode::get(module->getContext(), {nullptr, tileNode});
-                    loopID->replaceOperandWith(0, loopID);
-                    L->setLoopID(loopID);
-                }
-                
-                // Rename header for tracking
-                Header->setName(Header->getName() + ".tiled");
-                stats_.tiledLoops++;
+    // Register tiling: unroll-and-jam the outer loop of each two-deep nest so
+    // tileSize outer iterations share one pass over the inner loop. The
+    // requested factor is a hint; the pass still checks legality.
+    llvm::LLVMContext& ctx = module->getContext();
+    llvm::PassBuilder PB;
+    {
+        AnalysisManagers AM(PB);
+        for (auto& F : *module) {
+            if (F.isDeclaration()) continue;
+            auto& LI = AM.FAM.getResult<llvm::LoopAnalysis>(F);
+            for (auto* L : LI.getLoopsInPreorder()) {
+                if (L->getSubLoops().size() != 1 || !L->getSubLoops()[0]->getSubLoops().empty()) continue;
+                llvm::MDBuilder MDB(ctx);
+                addLoopProperty(L, llvm::MDNode::get(ctx, {
+                    MDB.createString("llvm.loop.unroll_and_jam.count"),
+                    llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(
+                        llvm::Type::getInt32Ty(ctx), tileSize))}));
             }
         }
     }
+    
+    runOnCanonicalLoops(module, [this](llvm::FunctionPassManager& FPM) {
+        FPM.addPass(llvm::createFunctionToLoopPassAdaptor(
+            CountingLoopNestPass<llvm::LoopUnrollAndJamPass>(
+                llvm::LoopUnrollAndJamPass(2), &stats_.tiledLoops)));
+    });
 }
 
 void PolyhedralOptimizer::applyLoopInterchange(llvm::Module* module) {
-    for (auto& F : *module) {
-        if (F.isDeclaration()) continue;
-        
-        llvm::FunctionAnalysisManager FAM;
-        llvm::LoopAnalysisManager LAM;
-        llvm::CGSCCAnalysisManager CGAM;
-        llvm::ModuleAnalysisManager MAM;
-        
-        llvm::PassBuilder PB;
-        PB.registerFunctionAnalyses(FAM);
-        PB.registerLoopAnalyses(LAM);
-        PB.registerCGSCCAnalyses(CGAM);
-        PB.registerModuleAnalyses(MAM);
-        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
-        
-        auto& LI = FAM.getResult<llvm::LoopAnalysis>(F);
-        
-        for (auto* L : LI.getLoopsInPreorder()) {
-            // Check for nested loops that would benefit from interchange
-            if (!L->getSubLoops().empty()) {
-                llvm::Loop* innerLoop = L->getSubLoops()[0];
-                
-                // Analyze memory access patterns
-                // If outer loop accesses column-major and inner is row-major,
-                // interchange them for better cache locality
-                
-                // Real implementation: Attach metadata to enable LLVM's loop interchange pass
-                llvm::MDBuilder MDB(module->getContext());
-                llvm::Metadata* interchangeMD = MDB.createString("llvm.loop.interchange.enable");
-                llvm::MDNode* interchangeNode = llvm::MDNode::get(module->getContext(), interchangeMD);
-                
-                // Attach metadata to outer loop
-                if (L->getLoopID()) {
-                    std::vector<llvm::Metadata*> MDs;
-                    MDs.push_back(nullptr);
-                    for (unsigned i = 1; i < L->getLoopID()->getNumOperands(); ++i) {
-                        MDs.push_back(L->getLoopID()->getOperand(i));
-                    }
-                    MDs.push_back(interchangeNode);
-                    llvm::MDNode* newLoopID = llvm::MDNode::get(module->getContext(), MDs);
-                    newLoopID->replaceOperandWith(0, newLoopID);
-                    L->setLoopID(newLoopID);
-                } else {
-                    llvm::MDNode* loopID = llvm::MDNode::get(module->getContext(), {nullptr, interchangeNode});
-                    loopID->replaceOperandWith(0, loopID);
-                    L->setLoopID(loopID);
-                }
-                
-                stats_.tiledLoops++; // Track interchange transformations
-            }
-        }
-    }
+    runOnCanonicalLoops(module, [this](llvm::FunctionPassManager& FPM) {
+        FPM.addPass(llvm::createFunctionToLoopPassAdaptor(
+            CountingLoopNestPass<llvm::LoopInterchangePass>(
+                llvm::LoopInterchangePass(), &stats_.interchangedLoops)));
+    });
 }
 
 void PolyhedralOptimizer::applyVectorization(llvm::Module* module) {
-    llvm::legacy::FunctionPassManager FPM(module);
-    
-    // Add vectorization passes (using available passes in LLVM 18)
-    // Note: Loop vectorization is now handled differently in modern LLVM
-    // We'll use the available scalar passes for now
+    runOnCanonicalLoops(module, [](llvm::FunctionPassManager& FPM) {
+        FPM.addPass(llvm::LoopVectorizePass());
+        FPM.addPass(llvm::SLPVectorizerPass());
+    });
     
-    FPM.doInitialization();
-    for (auto& F : *module) {
-        if (!F.isDeclaration()) {
-            FPM.run(F);
-            stats_.vectorizedLoops++;
-        }
-    }
-    FPM.doFinalization();
+    recountVectorizedLoops(module);
+}
+
+void PolyhedralOptimizer::recountVectorizedLoops(llvm::Module* module) {
+    // analyzeLoops also counts the vectorizer's output; keep the loop total
+    // from the original (pre-pipeline) analysis.
+    size_t totalLoops = stats_.totalLoops;
+    stats_.vectorizedLoops = 0;
+    analyzeLoops(module);
+    stats_.totalLoops = totalLoops;
 }
 
 void PolyhedralOptimizer::detectParallelLoops(llvm::Module* module) {
+    llvm::PassBuilder PB;
+    AnalysisManagers AM(PB);
+    
     for (auto& F : *module) {
         if (F.isDeclaration()) continue;
         
-        llvm::FunctionAnalysisManager FAM;
-        llvm::LoopAnalysisManager LAM;
-        llvm::CGSCCAnalysisManager CGAM;
-        llvm::ModuleAnalysisManager MAM;
-        
-        llvm::PassBuilder PB;
-        PB.registerFunctionAnalyses(FAM);
-        PB.registerLoopAnalyses(LAM);
-        PB.registerCGSCCAnalyses(CGAM);
-        PB.registerModuleAnalyses(MAM);
-        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
-        
-        auto& LI = FAM.getResult<llvm::LoopAnalysis>(F);
+        auto& LI = AM.FAM.getResult<llvm::LoopAnalysis>(F);
         
         for (auto* L : LI.getLoopsInPreorder()) {
             bool canParallelize = true;
+            std::unordered_set<llvm::Value*> reads;
             
             // Check for loop-carried dependencies
             for (auto* BB : L->blocks()) {
@@ -573,83 +990,42 @@ void PolyhedralOptimizer::detectParallelLoops(llvm::Module* module) {
                         canParallelize = false;
                         break;
                     }
+                    
+                    // Check for read-after-write through the same pointer
+                    if (auto* Load = llvm::dyn_cast<llvm::LoadInst>(&I)) {
+                        reads.insert(Load->getPointerOperand());
+                    } else if (auto* Store = llvm::dyn_cast<llvm::StoreInst>(&I)) {
+                        if (reads.count(Store->getPointerOperand())) {
+                            canParallelize = false;
+                            break;
+                        }
+                    }
                 }
                 if (!canParallelize) break;
             }
             
             if (canParallelize) {
-                // Mark loop as parallel
-                llvm::MDBuilder MDB(module->getContext());
-                llvm::Metadata* parallelMD = MDB.createString("llvm.loop.parallel");
-                // Create an MDNode from the string
-                llvm::MDNode* loopMD = llvm::MDNode::get(module->getContext(), parallelMD);
-                if (L->getLoopID()) {
-                    L->getLoopID()->replaceOperandWith(1, loopMD);
-                }
-                stats_.parallelLoops++;
+                stats_.parallelCandidates++;
             }
         }
     }
 }
 
 void PolyhedralOptimizer::generateParallelCode(llvm::Module* module) {
-    llvm::IRBuilder<> builder(module->getContext());
+    // Outlining is done by the front end: every `parallel for` body becomes
+    // a function the runtime pool calls per chunk. Count those dispatches so
+    // the statistics show how much of the program runs in parallel.
+    static const char* const entryPoints[] = {
+        "__tocin_parallel_for", "__tocin_parallel_for_step",
+        "__tocin_parallel_reduce", "__tocin_parallel_reduce_f64",
+    };
     
-    for (auto& F : *module) {
-        if (F.isDeclaration()) continue;
-        
-        llvm::FunctionAnalysisManager FAM;
-        llvm::LoopAnalysisManager LAM;
-        llvm::CGSCCAnalysisManager CGAM;
-        llvm::ModuleAnalysisManager MAM;
-        
-        llvm::PassBuilder PB;
-        PB.registerFunctionAnalyses(FAM);
-        PB.registerLoopAnalyses(LAM);
-        PB.registerCGSCCAnalyses(CGAM);
-        PB.registerModuleAnalyses(MAM);
-        PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
-        
-        auto& LI = FAM.getResult<llvm::LoopAnalysis>(F);
-        
-        for (auto* L : LI.getLoopsInPreorder()) {
-            // Check if loop is marked as parallel
-            llvm::MDNode* loopID = L->getLoopID();
-            if (!loopID) continue;
-            
-            bool isParallel = false;
-            for (unsigned i = 0; i < loopID->getNumOperands(); ++i) {
-                if (auto* MD = llvm::dyn_cast<llvm::MDString>(loopID->getOperand(i))) {
-                    if (MD->getString() == "llvm.loop.parallel") {
-                        isParallel = true;
-                        break;
-                    }
-                }
-            }
-            
-            if (isParallel) {
-                // Generate parallel runtime calls
-                // Insert proper calls to __tocin_parallel_for runtime function
-                
-                llvm::BasicBlock* preheader = L->getLoopPreheader();
-                if (preheader) {
-                    builder.SetInsertPoint(preheader->getTerminator());
-                    
-                    // Declare the parallel runtime function if not already present
-                    llvm::FunctionType* parallelFuncType = llvm::FunctionType::get(
-                        builder.getVoidTy(), 
-                        {builder.getInt64Ty(), builder.getInt64Ty(), 
-                         llvm::PointerType::get(llvm::FunctionType::get(
-                             builder.getVoidTy(), {builder.getInt64Ty()}, false), 0)},
-                        false);
-                    
-                    llvm::FunctionCallee parallelFunc = module->getOrInsertFunction(
-                        "__tocin_parallel_for", parallelFuncType);
-                    
-                    // Note: Full parallel code generation would extract loop bounds
-                    // and create a function for the loop body. For now, we've declared
-                    // the runtime function which is now properly implemented.
-                    
+    for (const char* name : entryPoints) {
+        llvm::Function* entry = module->getFunction(name);
+        if (!entry) continue;
+        for (llvm::User* U : entry->users()) {
+            if (auto* Call = llvm::dyn_cast<llvm::CallBase>(U)) {
+                if (Call->getCalledFunction() == entry) {
                     stats_.parallelLoops++;
                 }
             }
@@ -657,6 +1033,22 @@ void PolyhedralOptimizer::generateParallelCode(llvm::Module* module) {
     }
 }
 
+void PolyhedralOptimizer::registerPassBuilderCallbacks(llvm::PassBuilder& PB) {
+    // Right before the vectorizers the loops are rotated, in LCSSA form and
+    // have their induction variables simplified, which is what fusion,
+    // interchange and unroll-and-jam need; their output then vectorizes.
+    PB.registerVectorizerStartEPCallback(
+        [this](llvm::FunctionPassManager& FPM, llvm::OptimizationLevel Level) {
+            FPM.addPass(CountingLoopFusePass{{}, &stats_.fusedLoops});
+            FPM.addPass(llvm::createFunctionToLoopPassAdaptor(
+                CountingLoopNestPass<llvm::LoopInterchangePass>(
+                    llvm::LoopInterchangePass(), &stats_.interchangedLoops)));
+            FPM.addPass(llvm::createFunctionToLoopPassAdaptor(
+                CountingLoopNestPass<llvm::LoopUnrollAndJamPass>(
+                    llvm::LoopUnrollAndJamPass(Level.getSpeedupLevel()), &stats_.tiledLoops)));
+        });
+}
+
 // ============================================================================
 // Whole-Program Optimizer Implementation
 // ============================================================================
@@ -669,6 +1061,7 @@ WholeProgramOptimizer::WholeProgramOptimizer()
 WholeProgramOptimizer::~WholeProgramOptimizer() {}
 
 void WholeProgramOptimizer::addModule(llvm::Module* module) {
+    if (std::find(modules_.begin(), modules_.end(), module) != modules_.end()) return;
     modules_.push_back(module);
     stats_.modulesProcessed++;
 }
@@ -678,100 +1071,100 @@ void WholeProgramOptimizer::setOptimizationLevel(int level) {
 }
 
 void WholeProgramOptimizer::performLTO() {
-    // Implement basic Link-Time Optimization
-    // Merge modules and perform cross-module optimizations
-    
     if (modules_.empty()) return;
     
-    // Create a single merged module for LTO
-    std::unique_ptr<llvm::Module> mergedModule;
-    
-    // Start with first module
-    if (!modules_.empty()) {
-        mergedModule = std::unique_ptr<llvm::Module>(
-            llvm::CloneModule(*modules_[0]));
-        
-        // Merge remaining modules
-        for (size_t i = 1; i < modules_.size(); ++i) {
-            llvm::Linker linker(*mergedModule);
-            linker.linkInModule(llvm::CloneModule(*modules_[i]));
-        }
+    // Link every other module into the first one, which becomes the whole
+    // program. The callers keep ownership of the modules they added, so the
+    // linker consumes clones.
+    llvm::Module* program = modules_[0];
+    for (size_t i = 1; i < modules_.size(); ++i) {
+        llvm::Linker linker(*program);
+        linker.linkInModule(llvm::CloneModule(*modules_[i]));
     }
+    modules_.resize(1);
     
-    if (!mergedModule) return;
-    
-    // Apply whole-program optimizations using the new pass manager
-    // Note: LLVM 18 uses the new pass manager; legacy passes are deprecated
-    llvm::ModuleAnalysisManager MAM;
-    llvm::ModulePassManager MPM;
-    llvm::PassBuilder PB;
-    
-    PB.registerModuleAnalyses(MAM);
-    
-    // Add optimization passes (using new pass manager equivalents)
-    // TODO: Port to complete new pass manager infrastructure
-    // For now, run basic optimization pipeline
-    MPM = PB.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
-    MPM.run(*mergedModule, MAM);
+    size_t before = countDefinedFunctions(*program);
     
-    stats_.modulesProcessed = modules_.size();
+    llvm::PassBuilder PB(targetMachine_);
+    AnalysisManagers AM(PB);
+    llvm::ModulePassManager MPM =
+        PB.buildLTODefaultPipeline(toOptimizationLevel(optimizationLevel_), nullptr);
+    MPM.run(*program, AM.MAM);
     
-    // Count eliminated functions
-    for (auto& F : *mergedModule) {
-        if (F.isDeclaration() || F.hasAvailableExternallyLinkage()) {
-            stats_.functionsEliminated++;
-        }
+    size_t after = countDefinedFunctions(*program);
+    if (before > after) {
+        stats_.functionsEliminated += before - after;
     }
 }
 
 void WholeProgramOptimizer::eliminateDeadCode() {
     for (auto* module : modules_) {
-        llvm::legacy::PassManager PM;
+        size_t before = countDefinedFunctions(*module);
         
-        // Add dead code elimination passes (using LLVM 18 compatible APIs)
-        PM.add(llvm::createDeadCodeEliminationPass());
+        llvm::PassBuilder PB(targetMachine_);
+        AnalysisManagers AM(PB);
+        llvm::ModulePassManager MPM;
+        MPM.addPass(llvm::GlobalDCEPass());
+        MPM.run(*module, AM.MAM);
         
-        PM.run(*module);
+        size_t after = countDefinedFunctions(*module);
+        if (before > after) {
+            stats_.functionsEliminated += before - after;
+        }
     }
 }
 
 void WholeProgramOptimizer::performGlobalValueNumbering() {
     for (auto* module : modules_) {
-        llvm::legacy::FunctionPassManager FPM(module);
-        
-        // Add scalar replacement of aggregates (SROA) pass
-        // This is the modern equivalent providing similar optimizations
-        FPM.add(llvm::createSROAPass());
-        
-        FPM.doInitialization();
-        for (auto& F : *module) {
-            if (!F.isDeclaration()) {
-                FPM.run(F);
-            }
-        }
-        FPM.doFinalization();
+        llvm::PassBuilder PB(targetMachine_);
+        AnalysisManagers AM(PB);
+        llvm::ModulePassManager MPM;
+        MPM.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::GVNPass()));
+        MPM.run(*module, AM.MAM);
     }
 }
 
 void WholeProgramOptimizer::optimizeGlobalVariables() {
     for (auto* module : modules_) {
-        llvm::legacy::PassManager PM;
+        // Count the mutable globals GlobalOpt deletes or proves constant
+        std::vector<std::string> mutableGlobals;
+        for (auto& G : module->globals()) {
+            if (G.hasInitializer() && !G.isConstant()) {
+                mutableGlobals.push_back(G.getName().str());
+            }
+        }
         
-        // Add global variable optimization passes (LLVM 18 compatible)
-        PM.add(llvm::createConstantHoistingPass());
+        llvm::PassBuilder PB(targetMachine_);
+        AnalysisManagers AM(PB);
+        llvm::ModulePassManager MPM;
+        MPM.addPass(llvm::GlobalOptPass());
+        MPM.run(*module, AM.MAM);
         
-        PM.run(*module);
-        stats_.globalsOptimized++;
+        for (const auto& name : mutableGlobals) {
+            llvm::GlobalVariable* G = module->getGlobalVariable(name, true);
+            if (!G || G->isConstant()) {
+                stats_.globalsOptimized++;
+            }
+        }
     }
 }
 
 void WholeProgramOptimizer::optimize() {
+    size_t before = 0;
+    for (auto* module : modules_) before += bitcodeSize(*module);
+    
     eliminateDeadCode();
-    performGlobalValueNumbering();
     optimizeGlobalVariables();
-    
     if (optimizationLevel_ >= 2) {
         performLTO();
+    } else {
+        performGlobalValueNumbering();
+    }
+    
+    size_t after = 0;
+    for (auto* module : modules_) after += bitcodeSize(*module);
+    if (before > after) {
+        stats_.bytesReduced += before - after;
     }
 }
 
@@ -817,13 +1210,38 @@ void AdvancedOptimizationPipeline::setOptimizationLevel(int level) {
     wpo_->setOptimizationLevel(level);
 }
 
+void AdvancedOptimizationPipeline::setTargetMachine(llvm::TargetMachine* tm) {
+    targetMachine_ = tm;
+    wpo_->setTargetMachine(tm);
+}
+
+void AdvancedOptimizationPipeline::enableProfileGeneration(const std::string& outputPath) {
+    pgo_->enableProfiling(outputPath);
+    pgoEnabled_ = true;
+}
+
+bool AdvancedOptimizationPipeline::loadProfile(const std::string& profilePath) {
+    if (!pgo_->loadProfile(profilePath)) return false;
+    pgoEnabled_ = true;
+    return true;
+}
+
+std::optional<llvm::PGOOptions> AdvancedOptimizationPipeline::getPGOOptions() const {
+    return pgoEnabled_ ? pgo_->getPGOOptions() : std::nullopt;
+}
+
 void AdvancedOptimizationPipeline::optimize(llvm::Module* module) {
-    auto startTime = std::chrono::high_resolution_clock::now();
+    optimizeBeforePipeline(module);
+    optimizeAfterPipeline(module);
+}
+
+void AdvancedOptimizationPipeline::optimizeBeforePipeline(llvm::Module* module) {
+    auto startTime = std::chrono::steady_clock::now();
     
-    // Phase 1: Profile-Guided Optimization
-    if (pgoEnabled_) {
-        pgo_->applyPGO(module);
-        stats_.pgoStats = pgo_->getStats();
+    // Phase 1: Profile-Guided Optimization. The instrumentation itself runs
+    // inside the PassBuilder pipeline (see getPGOOptions()).
+    if (pgoEnabled_ && pgo_->isProfiling()) {
+        pgo_->rememberFunctionNames(module);
     }
     
     // Phase 2: Interprocedural Optimization
@@ -832,24 +1250,81 @@ void AdvancedOptimizationPipeline::optimize(llvm::Module* module) {
         stats_.ipoStats = ipo_->getStats();
     }
     
-    // Phase 3: Polyhedral Loop Optimization
     if (polyhedralEnabled_) {
         polyhedral_->analyzeLoops(module);
-        polyhedral_->applyVectorization(module);
-        polyhedral_->applyLoopTiling(module);
         stats_.loopStats = polyhedral_->getStats();
     }
     
+    stats_.optimizationTimeMs += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+void AdvancedOptimizationPipeline::registerPassBuilderCallbacks(llvm::PassBuilder& PB) {
+    // Phase 3: Polyhedral Loop Optimization, inside the regular pipeline
+    if (polyhedralEnabled_) {
+        polyhedral_->registerPassBuilderCallbacks(PB);
+    }
+}
+
+void AdvancedOptimizationPipeline::optimizeAfterPipeline(llvm::Module* module) {
+    auto startTime = std::chrono::steady_clock::now();
+    
+    if (pgoEnabled_) {
+        pgo_->applyPGO(module, targetMachine_);
+        stats_.pgoStats = pgo_->getStats();
+    }
+    
     // Phase 4: Whole-Program Optimization
-    wpo_->addModule(module);
     if (ltoEnabled_) {
+        wpo_->addModule(module);
         wpo_->optimize();
         stats_.wpoStats = wpo_->getStats();
     }
     
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
-    stats_.optimizationTimeMs = duration.count();
+    if (polyhedralEnabled_) {
+        polyhedral_->recountVectorizedLoops(module);
+        polyhedral_->detectParallelLoops(module);
+        polyhedral_->generateParallelCode(module);
+        stats_.loopStats = polyhedral_->getStats();
+    }
+    
+    stats_.optimizationTimeMs += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime).count();
+}
+
+void AdvancedOptimizationPipeline::printStats(std::ostream& os) const {
+    os << "=== Advanced optimization statistics ===\n";
+    if (pgoEnabled_) {
+        const auto& p = stats_.pgoStats;
+        if (pgo_->isProfiling()) {
+            os << "PGO:        instrumenting for " << pgo_->profileOutput() << "\n";
+        } else {
+            os << "PGO:        " << p.hotFunctions << " hot, " << p.coldFunctions
+               << " cold functions, " << p.totalExecutions << " profiled calls, "
+               << p.annotatedBranches << " weighted branches, " << p.coldRegionsSplit
+               << " cold regions split\n";
+        }
+    }
+    if (ipoEnabled_) {
+        const auto& i = stats_.ipoStats;
+        os << "IPO:        " << i.totalFunctions << " functions, " << i.inlinedFunctions
+           << " call sites inlined, " << i.devirtualizedCalls << " calls devirtualized, "
+           << i.constantsPropagated << " arguments constant-propagated\n";
+    }
+    if (polyhedralEnabled_) {
+        const auto& l = stats_.loopStats;
+        os << "Loops:      " << l.totalLoops << " loops, " << l.fusedLoops << " fused, "
+           << l.interchangedLoops << " interchanged, " << l.tiledLoops << " unrolled-and-jammed, "
+           << l.vectorizedLoops << " vectorized, " << l.parallelCandidates
+           << " parallel candidates, " << l.parallelLoops << " parallel for\n";
+    }
+    if (ltoEnabled_) {
+        const auto& w = stats_.wpoStats;
+        os << "LTO:        " << w.modulesProcessed << " modules, " << w.functionsEliminated
+           << " functions eliminated, " << w.globalsOptimized << " globals optimized, "
+           << w.bytesReduced << " bitcode bytes saved\n";
+    }
+    os << "Time:       " << stats_.optimizationTimeMs << " ms\n";
 }
 
 } // namespace optimization
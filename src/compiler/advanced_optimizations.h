@@ -4,18 +4,32 @@
 #include <llvm/IR/PassManager.h>
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <ostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+namespace llvm {
+class TargetMachine;
+}
+
 namespace tocin {
 namespace optimization {
 
 /**
  * @brief Profile-Guided Optimization (PGO) Manager
  * 
- * Collects runtime profiling data and uses it to guide optimizations
- * for better performance.
+ * Drives LLVM's IR-level InstrProf PGO through the PassBuilder pipeline.
+ * With profiling enabled the pipeline inserts counters and lowers them for
+ * compiler-rt's profile runtime; with an indexed profile (.profdata) loaded
+ * the same stage attaches entry counts and branch weights instead.
+ *
+ * The JIT has no profile runtime to walk the counter sections, so there
+ * recordCounters() exports each function's counter array and saveProfile()
+ * writes the values in llvm-profdata's text format after the run.
  */
 class PGOManager {
 public:
@@ -23,30 +37,92 @@ public:
     ~PGOManager();
 
     // Profile collection
-    void enableProfiling(llvm::Module* module);
+    void enableProfiling(const std::string& outputPath);
     void disableProfiling();
+    bool isProfiling() const { return profilingEnabled_; }
+    const std::string& profileOutput() const { return outputPath_; }
     bool loadProfile(const std::string& profilePath);
-    bool saveProfile(const std::string& profilePath);
+    const std::string& lastError() const { return error_; }
+
+    // PassBuilder integration: instrument (--pgo-gen) or annotate (--pgo-use)
+    std::optional<llvm::PGOOptions> getPGOOptions() const;
+
+    // JIT profile collection: names before the pipeline, counters after it
+    void rememberFunctionNames(llvm::Module* module);
+    void recordCounters(llvm::Module* module);
+    using CounterLookup = std::function<const uint64_t*(const std::string& symbol)>;
+    bool saveProfile(const std::string& profilePath, const CounterLookup& lookup);
 
     // Apply PGO optimizations
-    void applyPGO(llvm::Module* module);
+    void applyPGO(llvm::Module* module, llvm::TargetMachine* tm = nullptr);
 
     // Statistics
     struct ProfileStats {
+        size_t instrumentedFunctions;
         size_t hotFunctions;
         size_t coldFunctions;
+        size_t coldRegionsSplit;
         size_t totalExecutions;
-        size_t branchMispredictions;
+        size_t annotatedBranches;
     };
     
     ProfileStats getStats() const { return stats_; }
 
 private:
+    struct CounterRecord {
+        std::string name;       // PGO function name
+        uint64_t hash;          // CFG hash checked by --pgo-use
+        uint64_t numCounters;
+        std::string symbol;     // exported counter array
+    };
+
     ProfileStats stats_;
     bool profilingEnabled_;
-    std::string profileData_;
+    std::string outputPath_;
+    std::string profilePath_;
+    std::string error_;
+    std::unordered_map<uint64_t, std::string> pgoNames_;
+    std::vector<CounterRecord> counters_;
 };
 
+/**
+ * @brief Whole-program devirtualization of trait-object calls.
+ *
+ * Only sound when nothing outside `module` can create trait objects (see
+ * InterproceduralOptimizer::setWholeProgram). Returns the number of call
+ * sites made direct or given a guarded direct path. The driver runs it on
+ * every optimized whole-program build; --ipo runs it as part of
+ * performDevirtualization instead.
+ */
+size_t devirtualizeTraitCalls(llvm::Module& module);
+
+/**
+ * @brief Specialization of higher-order functions on known closures.
+ *
+ * A call that passes a closure whose function is known at the call site (a
+ * top-level function or lambda literal) is redirected to a clone of the
+ * callee in which calls through that parameter are direct, so the lambda
+ * can be inlined into the callee's loop. Sound without the whole program:
+ * the original callee stays for every other caller. Returns the number of
+ * call sites redirected.
+ */
+size_t specializeClosureCalls(llvm::Module& module);
+
+/**
+ * @brief Function multiversioning with run-time CPU dispatch.
+ *
+ * A versioned function is compiled once per x86-64 level it names (sse4,
+ * avx2, avx512: target-cpu x86-64-v2 / -v3 / -v4) besides its baseline
+ * body, and each call goes to the widest version the running CPU supports,
+ * chosen once by a resolver stub. Functions declared `target_clones(...)`
+ * carry their own levels; with `autoLevels` non-empty, every function with
+ * a loop the vectorizer can take is versioned for those. Runs before the
+ * O-pipeline, so each version is vectorized for its own CPU. Does nothing
+ * for a module that is not x86-64. Returns the number of functions
+ * versioned.
+ */
+size_t multiversionFunctions(llvm::Module& module, const std::vector<std::string>& autoLevels = {});
+
 /**
  * @brief Interprocedural Optimization Manager
  * 
@@ -58,6 +134,11 @@ public:
     InterproceduralOptimizer();
     ~InterproceduralOptimizer();
 
+    // Whole program: nothing outside the module can create trait objects, so
+    // the classes boxed as each trait are exactly those the module boxes.
+    // Trait calls are only devirtualized then.
+    void setWholeProgram(bool wholeProgram) { wholeProgram_ = wholeProgram; }
+
     // Optimization passes
     void optimizeCallGraph(llvm::Module* module);
     void performInlining(llvm::Module* module, int inlineThreshold = 225);
@@ -67,7 +148,7 @@ public:
     // Analysis
     struct CallGraphStats {
         size_t totalFunctions;
-        size_t inlinedFunctions;
+        size_t inlinedFunctions;    // direct call sites removed by inlining
         size_t devirtualizedCalls;
         size_t constantsPropagated;
     };
@@ -76,13 +157,17 @@ public:
 
 private:
     CallGraphStats stats_;
+    bool wholeProgram_ = false;
 };
 
 /**
  * @brief Polyhedral Loop Optimizer
  * 
- * Advanced loop transformations using polyhedral analysis
- * for automatic parallelization and cache optimization.
+ * Loop-nest transformations (fusion, interchange, unroll-and-jam) on top of
+ * LLVM's dependence analysis. The module-level apply* methods canonicalize
+ * the IR themselves so they can run standalone; inside the driver the same
+ * passes are scheduled through registerPassBuilderCallbacks() so they see
+ * loops that the simplification pipeline has already rotated and promoted.
  */
 class PolyhedralOptimizer {
 public:
@@ -92,7 +177,7 @@ public:
     // Loop transformations
     void analyzeLoops(llvm::Module* module);
     void applyLoopFusion(llvm::Module* module);
-    void applyLoopTiling(llvm::Module* module, size_t tileSize = 64);
+    void applyLoopTiling(llvm::Module* module, size_t tileSize = 4);
     void applyLoopInterchange(llvm::Module* module);
     void applyVectorization(llvm::Module* module);
 
@@ -100,15 +185,22 @@ public:
     void detectParallelLoops(llvm::Module* module);
     void generateParallelCode(llvm::Module* module);
 
+    // Schedule fusion, interchange and unroll-and-jam right before the
+    // vectorizers of a PassBuilder pipeline. The optimizer must outlive it.
+    void registerPassBuilderCallbacks(llvm::PassBuilder& PB);
+
     struct LoopStats {
         size_t totalLoops;
-        size_t fusedLoops;
-        size_t tiledLoops;
+        size_t fusedLoops;          // loops removed by fusion
+        size_t interchangedLoops;   // loop nests reordered
+        size_t tiledLoops;          // loop nests unrolled-and-jammed
         size_t vectorizedLoops;
-        size_t parallelLoops;
+        size_t parallelCandidates;  // loops with no calls, atomics or RAW hazards
+        size_t parallelLoops;       // `parallel for` loops dispatched to the runtime
     };
     
     LoopStats getStats() const { return stats_; }
+    void recountVectorizedLoops(llvm::Module* module);
 
 private:
     LoopStats stats_;
@@ -128,6 +220,7 @@ public:
     // Setup
     void addModule(llvm::Module* module);
     void setOptimizationLevel(int level); // 0-3
+    void setTargetMachine(llvm::TargetMachine* tm) { targetMachine_ = tm; }
 
     // Optimization phases
     void performLTO();
@@ -142,7 +235,7 @@ public:
         size_t modulesProcessed;
         size_t functionsEliminated;
         size_t globalsOptimized;
-        size_t bytesReduced;
+        size_t bytesReduced;        // bitcode size before minus after
     };
     
     OptimizationStats getStats() const { return stats_; }
@@ -150,6 +243,7 @@ public:
 private:
     std::vector<llvm::Module*> modules_;
     int optimizationLevel_;
+    llvm::TargetMachine* targetMachine_ = nullptr;
     OptimizationStats stats_;
 };
 
@@ -158,6 +252,11 @@ private:
  * 
  * Integrates all advanced optimization techniques in a coordinated
  * pipeline for maximum performance.
+ *
+ * The compiler driver brackets its PassBuilder pipeline with it:
+ * optimizeBeforePipeline() (PGO, IPO), registerPassBuilderCallbacks()
+ * (loop-nest passes), then optimizeAfterPipeline() (LTO, loop statistics).
+ * optimize() runs both halves back to back for standalone use.
  */
 class AdvancedOptimizationPipeline {
 public:
@@ -170,9 +269,22 @@ public:
     void enablePolyhedral(bool enable);
     void enableLTO(bool enable);
     void setOptimizationLevel(int level);
+    void setTargetMachine(llvm::TargetMachine* tm);
+    void setWholeProgram(bool wholeProgram) { ipo_->setWholeProgram(wholeProgram); }
+    bool polyhedralEnabled() const { return polyhedralEnabled_; }
+
+    // PGO: instrument the module, or feed it a profile saved by a previous run.
+    // Pass getPGOOptions() to the PassBuilder that runs the -O pipeline.
+    void enableProfileGeneration(const std::string& outputPath);
+    bool loadProfile(const std::string& profilePath);
+    std::optional<llvm::PGOOptions> getPGOOptions() const;
+    PGOManager& pgo() { return *pgo_; }
 
     // Execute optimization pipeline
     void optimize(llvm::Module* module);
+    void optimizeBeforePipeline(llvm::Module* module);
+    void registerPassBuilderCallbacks(llvm::PassBuilder& PB);
+    void optimizeAfterPipeline(llvm::Module* module);
 
     // Statistics
     struct PipelineStats {
@@ -184,6 +296,7 @@ public:
     };
     
     PipelineStats getStats() const { return stats_; }
+    void printStats(std::ostream& os) const;
 
 private:
     std::unique_ptr<PGOManager> pgo_;
@@ -196,6 +309,7 @@ private:
     bool polyhedralEnabled_;
     bool ltoEnabled_;
     int optimizationLevel_;
+    llvm::TargetMachine* targetMachine_ = nullptr;
     
     PipelineStats stats_;
 };
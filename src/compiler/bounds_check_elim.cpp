@@ -0,0 +1,317 @@
+#include "bounds_check_elim.h"
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Analysis/MustExecute.h>
+#include <llvm/Analysis/ScalarEvolution.h>
+#include <llvm/Analysis/ScalarEvolutionExpressions.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/PatternMatch.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Transforms/Utils/LoopUtils.h>
+#include <llvm/Transforms/Utils/ScalarEvolutionExpander.h>
+#include <map>
+#include <utility>
+#include <memory>
+#include <vector>
+
+namespace tocin {
+namespace optimization {
+
+namespace {
+
+using namespace llvm::PatternMatch;
+
+// A check as the IR generator emits it: `branch` leaves for `fail`, a block
+// that calls __tocin_oob, when `index` is outside [0, len).
+struct BoundsCheck {
+    llvm::BranchInst* branch;
+    llvm::BasicBlock* fail;
+    llvm::BasicBlock* ok;
+    llvm::Value* index;
+    llvm::Value* len;
+    llvm::CallInst* oobCall;
+    // False when an earlier pass proved index >= 0 and kept only the upper
+    // compare.
+    bool lowerChecked;
+};
+
+llvm::CallInst* oobCallIn(llvm::BasicBlock* BB) {
+    if (!llvm::isa<llvm::UnreachableInst>(BB->getTerminator())) return nullptr;
+    for (auto& I : *BB) {
+        if (llvm::isa<llvm::PHINode>(I) || llvm::isa<llvm::DbgInfoIntrinsic>(I)) continue;
+        auto* call = llvm::dyn_cast<llvm::CallInst>(&I);
+        const llvm::Function* callee = call ? call->getCalledFunction() : nullptr;
+        return callee && callee->getName() == "__tocin_oob" ? call : nullptr;
+    }
+    return nullptr;
+}
+
+// `idx <s 0`, or its negation when the compare is the in-range side.
+bool isBelowZero(llvm::Value* V, bool inRange, llvm::Value*& idx) {
+    llvm::ICmpInst::Predicate pred;
+    llvm::Value* x;
+    if (!match(V, m_ICmp(pred, m_Value(x), m_Zero()))) return false;
+    if (inRange) pred = llvm::ICmpInst::getInversePredicate(pred);
+    if (pred != llvm::ICmpInst::ICMP_SLT) return false;
+    idx = x;
+    return true;
+}
+
+// `idx >=s len`, or its negation when the compare is the in-range side.
+// Induction variable simplification may have narrowed it to `idx == len`
+// when idx counts up by one from below len.
+bool isAtOrPastEnd(llvm::Value* V, bool inRange, llvm::Value* idx, llvm::Value*& len) {
+    llvm::ICmpInst::Predicate pred;
+    llvm::Value *a, *b;
+    if (!match(V, m_ICmp(pred, m_Value(a), m_Value(b)))) return false;
+    if (inRange) pred = llvm::ICmpInst::getInversePredicate(pred);
+    if (pred == llvm::ICmpInst::ICMP_EQ && b == idx) std::swap(a, b);
+    if (a == idx && (pred == llvm::ICmpInst::ICMP_SGE || pred == llvm::ICmpInst::ICMP_EQ)) { len = b; return true; }
+    if (b == idx && pred == llvm::ICmpInst::ICMP_SLE) { len = a; return true; }
+    return false;
+}
+
+// Recover (index, len) from the branch condition. The generator emits
+// `(i <s 0) | (i >=s len)`; instcombine may turn that into one unsigned
+// compare, or keep only the upper half when i is known non-negative, and
+// other passes may invert the branch.
+bool matchCheckCondition(llvm::Value* cond, bool failOnTrue, llvm::Value*& idx, llvm::Value*& len,
+                         bool& lowerChecked) {
+    const bool inRange = !failOnTrue;
+    lowerChecked = true;
+    llvm::Value *x, *y;
+    if (failOnTrue ? match(cond, m_LogicalOr(m_Value(x), m_Value(y)))
+                   : match(cond, m_LogicalAnd(m_Value(x), m_Value(y)))) {
+        return (isBelowZero(x, inRange, idx) && isAtOrPastEnd(y, inRange, idx, len)) ||
+               (isBelowZero(y, inRange, idx) && isAtOrPastEnd(x, inRange, idx, len));
+    }
+    llvm::ICmpInst::Predicate pred;
+    llvm::Value *a, *b;
+    if (!match(cond, m_ICmp(pred, m_Value(a), m_Value(b)))) return false;
+    // An equality reads the same both ways round; the length is the operand
+    // loaded from the header (or folded to a constant).
+    const bool lenFirst = llvm::isa<llvm::LoadInst>(a) || llvm::isa<llvm::Constant>(a);
+    for (llvm::Value* cand : {lenFirst ? b : a, lenFirst ? a : b}) {
+        if (isAtOrPastEnd(cond, inRange, cand, len)) {
+            idx = cand;
+            lowerChecked = false;
+            return true;
+        }
+    }
+    if (inRange) pred = llvm::ICmpInst::getInversePredicate(pred);
+    if (pred == llvm::ICmpInst::ICMP_UGE) { idx = a; len = b; return true; }
+    if (pred == llvm::ICmpInst::ICMP_ULE) { idx = b; len = a; return true; }
+    return false;
+}
+
+std::vector<BoundsCheck> findChecks(llvm::Function& F) {
+    std::vector<BoundsCheck> checks;
+    for (auto& BB : F) {
+        auto* br = llvm::dyn_cast<llvm::BranchInst>(BB.getTerminator());
+        if (!br || !br->isConditional()) continue;
+        for (unsigned s = 0; s < 2; ++s) {
+            llvm::CallInst* call = oobCallIn(br->getSuccessor(s));
+            llvm::Value *idx = nullptr, *len = nullptr;
+            bool lower = true;
+            if (!call || !matchCheckCondition(br->getCondition(), s == 0, idx, len, lower)) continue;
+            if (!idx->getType()->isIntegerTy(64) || idx->getType() != len->getType()) continue;
+            checks.push_back({br, br->getSuccessor(s), br->getSuccessor(1 - s), idx, len, call, lower});
+            break;
+        }
+    }
+    return checks;
+}
+
+// Make the check's branch unconditional; drops the fail block once nothing
+// else reaches it.
+void dropCheck(const BoundsCheck& c, llvm::DominatorTree& DT, llvm::LoopInfo& LI) {
+    llvm::BasicBlock* from = c.branch->getParent();
+    c.fail->removePredecessor(from);
+    llvm::IRBuilder<>(c.branch).CreateBr(c.ok);
+    c.branch->eraseFromParent();
+    if (!llvm::pred_empty(c.fail)) return;
+    DT.eraseNode(c.fail);
+    LI.removeBlock(c.fail);
+    llvm::DeleteDeadBlock(c.fail);
+}
+
+class Eliminator {
+public:
+    Eliminator(llvm::Function& F, llvm::FunctionAnalysisManager& FAM)
+        : F_(F), SE_(FAM.getResult<llvm::ScalarEvolutionAnalysis>(F)),
+          LI_(FAM.getResult<llvm::LoopAnalysis>(F)), DT_(FAM.getResult<llvm::DominatorTreeAnalysis>(F)) {}
+
+    bool provenInRange(const BoundsCheck& c) {
+        const llvm::SCEV* i = SE_.getSCEV(c.index);
+        const llvm::SCEV* n = SE_.getSCEV(c.len);
+        const llvm::SCEV* zero = SE_.getZero(c.index->getType());
+        return (!c.lowerChecked || SE_.isKnownPredicateAt(llvm::ICmpInst::ICMP_SGE, i, zero, c.branch)) &&
+               SE_.isKnownPredicateAt(llvm::ICmpInst::ICMP_SLT, i, n, c.branch);
+    }
+
+    bool hoist(const BoundsCheck& c);
+
+    // Remove a check that was proven or hoisted.
+    void drop(const BoundsCheck& c) {
+        if (llvm::Loop* L = LI_.getLoopFor(c.branch->getParent())) SE_.forgetLoop(L);
+        dropCheck(c, DT_, LI_);
+    }
+
+private:
+    // How often L takes its backedge unless a bounds check panics first: the
+    // exit count of its latch, provided every other exit is a panic.
+    const llvm::SCEV* backedgesTaken(llvm::Loop* L) {
+        llvm::BasicBlock* latch = L->getLoopLatch();
+        if (!latch) return SE_.getCouldNotCompute();
+        llvm::SmallVector<llvm::BasicBlock*, 8> exiting;
+        L->getExitingBlocks(exiting);
+        for (llvm::BasicBlock* BB : exiting) {
+            if (BB == latch) continue;
+            for (llvm::BasicBlock* succ : llvm::successors(BB))
+                if (!L->contains(succ) && !oobCallIn(succ)) return SE_.getCouldNotCompute();
+        }
+        return SE_.getExitCount(L, latch);
+    }
+
+    // Whether the check runs on every iteration of L, which runs until its
+    // trip count: nothing in L may leave it abnormally (a call that exits or
+    // panics), and the check must come before every exit.
+    bool runsEveryIteration(const BoundsCheck& c, llvm::Loop* L) {
+        auto& info = safety_[L];
+        if (!info) {
+            info = std::make_unique<llvm::ICFLoopSafetyInfo>();
+            info->computeLoopSafetyInfo(L);
+        }
+        return !info->anyBlockMayThrow() && info->isGuaranteedToExecute(*c.branch, &DT_, L);
+    }
+
+    llvm::Function& F_;
+    llvm::ScalarEvolution& SE_;
+    llvm::LoopInfo& LI_;
+    llvm::DominatorTree& DT_;
+    std::map<llvm::Loop*, std::unique_ptr<llvm::ICFLoopSafetyInfo>> safety_;
+};
+
+bool Eliminator::hoist(const BoundsCheck& c) {
+    llvm::Loop* L = LI_.getLoopFor(c.branch->getParent());
+    if (!L) return false;
+    const llvm::SCEV* i = SE_.getSCEV(c.index);
+    const llvm::SCEV* n = SE_.getSCEV(c.len);
+    if (!SE_.isLoopInvariant(n, L)) return false;
+
+    // The index is loop-invariant, or {start,+,step} over L's iterations
+    // 0..btc.
+    const llvm::SCEV *start = i, *step = nullptr, *btc = nullptr;
+    if (!SE_.isLoopInvariant(i, L)) {
+        auto* ar = llvm::dyn_cast<llvm::SCEVAddRecExpr>(i);
+        if (!ar || ar->getLoop() != L || !ar->isAffine()) return false;
+        btc = backedgesTaken(L);
+        if (llvm::isa<llvm::SCEVCouldNotCompute>(btc) || SE_.getTypeSizeInBits(btc->getType()) > 64)
+            return false;
+        btc = SE_.getTruncateOrZeroExtend(btc, c.index->getType());
+        start = ar->getStart();
+        step = ar->getStepRecurrence(SE_);
+    }
+    if (!runsEveryIteration(c, L)) return false;
+
+    // Peeling and CFG simplification can leave a loop entered from a block
+    // that also branches elsewhere; give it a preheader of its own.
+    llvm::BasicBlock* pre = L->getLoopPreheader();
+    if (!pre) pre = llvm::InsertPreheaderForLoop(L, &DT_, &LI_, nullptr, false);
+    if (!pre) return false;
+    llvm::Instruction* at = pre->getTerminator();
+    llvm::SCEVExpander exp(SE_, F_.getParent()->getDataLayout(), "bce");
+    for (const llvm::SCEV* S : {n, start, step, btc})
+        if (S && !exp.isSafeToExpandAt(S, at)) return false;
+
+    llvm::Type* i64 = c.index->getType();
+    llvm::IRBuilder<> B(at);
+    llvm::Value* len = exp.expandCodeFor(n, i64, at);
+    llvm::Value* first = exp.expandCodeFor(start, i64, at);
+    llvm::Value* firstBad = B.CreateICmpUGE(first, len, "bce.first.oob");
+    llvm::Value* bad = firstBad;
+    llvm::Value* badIndex = first;
+    if (step) {
+        // last = start + btc * step, and no iteration's index can overflow
+        // if this does not (the indices lie between first and last).
+        llvm::Value* count = exp.expandCodeFor(btc, i64, at);
+        llvm::Value* stride = exp.expandCodeFor(step, i64, at);
+        llvm::Value* mul = B.CreateBinaryIntrinsic(llvm::Intrinsic::smul_with_overflow, count, stride);
+        llvm::Value* add = B.CreateBinaryIntrinsic(llvm::Intrinsic::sadd_with_overflow, first,
+                                                   B.CreateExtractValue(mul, 0));
+        llvm::Value* last = B.CreateExtractValue(add, 0, "bce.last");
+        bad = B.CreateOr(bad, B.CreateICmpUGE(last, len, "bce.last.oob"));
+        bad = B.CreateOr(bad, B.CreateOr(B.CreateExtractValue(mul, 1), B.CreateExtractValue(add, 1)));
+        bad = B.CreateOr(bad, B.CreateICmpSLT(count, llvm::ConstantInt::get(i64, 0)), "bce.oob");
+        badIndex = B.CreateSelect(firstBad, first, last);
+    }
+
+    // pre: br bad, bce.fail, bce.ok;  bce.ok: br header.
+    llvm::LLVMContext& ctx = F_.getContext();
+    llvm::BasicBlock* header = L->getHeader();
+    llvm::BasicBlock* fail = llvm::BasicBlock::Create(ctx, "bce.fail", &F_, header);
+    llvm::BasicBlock* cont = llvm::BasicBlock::Create(ctx, "bce.ok", &F_, header);
+    llvm::IRBuilder<> FB(fail);
+    llvm::CallInst* oob = FB.CreateCall(c.oobCall->getFunctionType(), c.oobCall->getCalledOperand(),
+                                        {badIndex, len});
+    oob->setAttributes(c.oobCall->getAttributes());
+    oob->setDebugLoc(c.oobCall->getDebugLoc());
+    FB.CreateUnreachable();
+    llvm::IRBuilder<>(cont).CreateBr(header);
+    at->eraseFromParent();
+    llvm::IRBuilder<>(pre).CreateCondBr(bad, fail, cont, llvm::MDBuilder(ctx).createBranchWeights(1, 1u << 20));
+    header->replacePhiUsesWith(pre, cont);
+
+    DT_.addNewBlock(fail, pre);
+    DT_.addNewBlock(cont, pre);
+    DT_.changeImmediateDominator(header, cont);
+    if (llvm::Loop* parent = L->getParentLoop()) parent->addBasicBlockToLoop(cont, LI_);
+    return true;
+}
+
+} // namespace
+
+void BoundsCheckStats::print(std::ostream& os) const {
+    os << "bounds checks: " << checks << " seen, " << removed << " removed as in range, "
+       << hoisted << " hoisted to loop preheaders, " << (checks - removed - hoisted)
+       << " left in place\n";
+}
+
+llvm::PreservedAnalyses BoundsCheckElimPass::run(llvm::Function& F, llvm::FunctionAnalysisManager& FAM) {
+    std::vector<BoundsCheck> checks = findChecks(F);
+    if (stats_) stats_->checks += checks.size();
+    if (checks.empty()) return llvm::PreservedAnalyses::all();
+
+    Eliminator elim(F, FAM);
+    size_t removed = 0, hoisted = 0;
+    for (const BoundsCheck& c : checks) {
+        if (elim.provenInRange(c)) ++removed;
+        else if (elim.hoist(c)) ++hoisted;
+        else continue;
+        elim.drop(c);
+    }
+    if (stats_) {
+        stats_->removed += removed;
+        stats_->hoisted += hoisted;
+    }
+    if (removed + hoisted == 0) return llvm::PreservedAnalyses::all();
+    // Blocks came and went; only the dominator tree and loop info were kept
+    // up to date along the way.
+    llvm::PreservedAnalyses PA;
+    PA.preserve<llvm::DominatorTreeAnalysis>();
+    PA.preserve<llvm::LoopAnalysis>();
+    return PA;
+}
+
+void registerBoundsCheckElimination(llvm::PassBuilder& PB, BoundsCheckStats* stats) {
+    PB.registerVectorizerStartEPCallback(
+        [stats](llvm::FunctionPassManager& FPM, llvm::OptimizationLevel) {
+            FPM.addPass(BoundsCheckElimPass(stats));
+        });
+}
+
+} // namespace optimization
+} // namespace tocin
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <llvm/IR/PassManager.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <cstddef>
+#include <ostream>
+
+namespace tocin {
+namespace optimization {
+
+/**
+ * @brief Array bounds-check elimination
+ *
+ * Every `a[i]` read compares i against the array's [i64 len] header and
+ * branches to __tocin_oob (see IRGenerator::visitIndexExpr). Right before
+ * the vectorizers, with loops rotated and induction variables simplified,
+ * this pass uses scalar evolution to
+ *  - drop a check whose index is provably in [0, len), as in
+ *    `for i in 0..len(a) { a[i] }`;
+ *  - replace a check inside a loop, whose length is loop-invariant and whose
+ *    index is invariant or affine in the loop, by one range check in the
+ *    preheader: the first and the last index the loop will use must both be
+ *    in range (an affine index moves monotonically between them).
+ *
+ * A hoisted check panics before the loop rather than at the iteration that
+ * would fail, so it is only done for loops that run to their computed trip
+ * count and execute the check on every iteration: no early exit before it
+ * and no instruction that may not return (calls that could exit or panic).
+ */
+struct BoundsCheckStats {
+    size_t checks = 0;   // checks still present when the pass ran
+    size_t removed = 0;  // proven in range and dropped
+    size_t hoisted = 0;  // replaced by a range check in the loop preheader
+
+    void print(std::ostream& os) const;
+};
+
+class BoundsCheckElimPass : public llvm::PassInfoMixin<BoundsCheckElimPass> {
+public:
+    explicit BoundsCheckElimPass(BoundsCheckStats* stats = nullptr) : stats_(stats) {}
+
+    llvm::PreservedAnalyses run(llvm::Function& F, llvm::FunctionAnalysisManager& FAM);
+
+private:
+    BoundsCheckStats* stats_;
+};
+
+// Schedule the pass right before the vectorizers of a PassBuilder pipeline.
+// `stats`, if given, must outlive the pipeline.
+void registerBoundsCheckElimination(llvm::PassBuilder& PB, BoundsCheckStats* stats = nullptr);
+
+} // namespace optimization
+} // namespace tocin
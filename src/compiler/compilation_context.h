@@ -9,6 +9,7 @@
 #include <mutex>
 #include <chrono>
 #include "../ast/types.h"
+#include "module_cache.h"
 
 namespace tocin {
 namespace compiler {
@@ -171,6 +172,14 @@ public:
     void* getSymbol(const std::string& name) const;
     bool hasSymbol(const std::string& name) const;
     
+    // Parsed imports, shared with the compiler that outlives this context
+    void setModuleCache(std::shared_ptr<ModuleCache> cache) { moduleCache_ = std::move(cache); }
+    ModuleCache* moduleCache() const { return moduleCache_.get(); }
+
+    // The arena this compilation's AST is made in; code that builds nodes
+    // for it runs inside an ast::ArenaScope over it.
+    const std::shared_ptr<ast::Arena>& astArena() const { return astArena_; }
+
     // Module dependencies
     void addDependency(const std::string& dependency);
     const std::vector<std::string>& getDependencies() const { return dependencies_; }
@@ -231,6 +240,12 @@ private:
     // Symbol table (low-level)
     std::unordered_map<std::string, void*> symbols_;
     
+    // Parsed imports (owned jointly with the compiler; may be null)
+    std::shared_ptr<ModuleCache> moduleCache_;
+
+    // AST nodes (each keeps the arena alive while it is referenced)
+    std::shared_ptr<ast::Arena> astArena_ = ast::Arena::create();
+
     // Module dependencies
     std::vector<std::string> dependencies_;
     
@@ -54,23 +54,14 @@ namespace compiler
         // Create a new LLVM module
         module = std::make_unique<llvm::Module>(filename, *context);
 
-        // Perform lexical analysis
+        // Lex and parse together: the parser pulls tokens as it needs them
         lexer::Lexer lexer(source, filename);
-        std::vector<lexer::Token> tokens = lexer.tokenize();
-
-        if (errorHandler.hasErrors())
-        {
-            std::cerr << "Lexical analysis failed. See errors.\n";
-            return false;
-        }
-
-        // Parse the tokens into an AST
-        parser::Parser parser(tokens);
+        parser::Parser parser(lexer);
         ast::StmtPtr ast = parser.parse();
 
         if (!ast || errorHandler.hasErrors())
         {
-            std::cerr << "Parsing failed. See errors.\n";
+            std::cerr << "Lexing or parsing failed. See errors.\n";
             return false;
         }
 
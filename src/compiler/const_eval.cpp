@@ -0,0 +1,568 @@
+#include "const_eval.h"
+
+#include "../lexer/token.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+
+namespace tocin {
+namespace compiler {
+
+namespace {
+
+constexpr uint64_t kMaxSteps = 50'000'000;
+constexpr unsigned kMaxDepth = 256;
+constexpr int64_t kMaxArrayLength = int64_t(1) << 24;
+
+// Thrown from anywhere inside an evaluation; evaluate() turns it into the
+// reason the expression is not a constant.
+struct NotConstant {
+    std::string why;
+};
+
+[[noreturn]] void notConstant(std::string why) { throw NotConstant{std::move(why)}; }
+
+bool isFloatType(const ast::TypePtr &type) {
+    if (!type)
+        return false;
+    std::string name = type->toString();
+    return name == "float" || name == "f64" || name == "f32" || name == "float32";
+}
+
+double toFloat(const ConstValue &v) {
+    if (v.kind == ConstValue::Kind::Float)
+        return v.f;
+    if (v.kind == ConstValue::Kind::Int)
+        return double(v.i);
+    notConstant("a number was expected");
+}
+
+int64_t toInt(const ConstValue &v) {
+    if (v.kind != ConstValue::Kind::Int)
+        notConstant("an integer was expected");
+    return v.i;
+}
+
+bool truthy(const ConstValue &v) {
+    switch (v.kind) {
+    case ConstValue::Kind::Int:
+    case ConstValue::Kind::Bool:
+        return v.i != 0;
+    case ConstValue::Kind::Float:
+        return v.f != 0;
+    default:
+        notConstant("a condition must be a number or bool");
+    }
+}
+
+// A value as a variable declared with this type holds it: ints assigned to
+// a float are converted, as codegen does.
+ConstValue asDeclared(ConstValue v, const ast::TypePtr &type) {
+    if (isFloatType(type) && v.kind == ConstValue::Kind::Int)
+        return ConstValue::ofFloat(double(v.i));
+    return v;
+}
+
+ConstValue newArray(ConstValue::Kind element, int64_t length) {
+    if (length < 0 || length > kMaxArrayLength)
+        notConstant("array length " + std::to_string(length) + " is out of range");
+    ConstValue v;
+    v.kind = ConstValue::Kind::Array;
+    v.array = std::make_shared<ConstArray>();
+    v.array->element = element;
+    v.array->items.assign(size_t(length), element == ConstValue::Kind::Float ? ConstValue::ofFloat(0)
+                                                                             : ConstValue::ofInt(0));
+    return v;
+}
+
+} // namespace
+
+ConstValue ConstValue::ofInt(int64_t v) {
+    ConstValue c;
+    c.i = v;
+    return c;
+}
+
+ConstValue ConstValue::ofFloat(double v) {
+    ConstValue c;
+    c.kind = Kind::Float;
+    c.f = v;
+    return c;
+}
+
+ConstValue ConstValue::ofBool(bool v) {
+    ConstValue c;
+    c.kind = Kind::Bool;
+    c.i = v;
+    return c;
+}
+
+ConstValue ConstValue::ofString(std::string v) {
+    ConstValue c;
+    c.kind = Kind::String;
+    c.s = std::move(v);
+    return c;
+}
+
+// One call's locals, innermost block last.
+struct ConstEvaluator::Frame {
+    std::vector<std::unordered_map<std::string, ConstValue>> scopes{1};
+
+    ConstValue *find(const std::string &name) {
+        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+            auto found = it->find(name);
+            if (found != it->end())
+                return &found->second;
+        }
+        return nullptr;
+    }
+};
+
+ConstEvaluator::ConstEvaluator(const ast::StmtPtr &program) {
+    if (auto *block = ast::dyn_cast<ast::BlockStmt>(program)) {
+        for (const auto &s : block->statements)
+            if (auto *fn = ast::dyn_cast<ast::FunctionStmt>(s))
+                if (fn->isConstFn && !fn->isGeneric() && fn->body)
+                    functions_[fn->name] = fn;
+    }
+}
+
+ConstEvaluator::~ConstEvaluator() = default;
+
+std::optional<ConstValue> ConstEvaluator::evaluate(const ast::Expression *expr, std::string &why) {
+    steps_ = 0;
+    depth_ = 0;
+    try {
+        Frame frame;
+        return eval(expr, frame);
+    } catch (const NotConstant &e) {
+        why = e.why;
+        return std::nullopt;
+    }
+}
+
+void ConstEvaluator::defineConstant(const std::string &name, const ConstValue &value) {
+    if (value.array)
+        value.array->frozen = true;
+    constants_[name] = value;
+}
+
+void ConstEvaluator::step() {
+    if (++steps_ > kMaxSteps)
+        notConstant("evaluation takes more than " + std::to_string(kMaxSteps) + " steps");
+}
+
+ConstValue ConstEvaluator::eval(const ast::Expression *expr, Frame &frame) {
+    step();
+    if (!expr)
+        notConstant("missing expression");
+
+    if (auto *lit = ast::dyn_cast<ast::LiteralExpr>(expr)) {
+        switch (lit->literalType) {
+        case ast::LiteralExpr::LiteralType::INTEGER:
+            return ConstValue::ofInt(lexer::parseIntegerLiteral(lit->value));
+        case ast::LiteralExpr::LiteralType::FLOAT: {
+            std::string digits;
+            for (char c : lit->value)
+                if (c != '_' && c != 'f' && c != 'F')
+                    digits += c;
+            return ConstValue::ofFloat(digits.empty() ? 0.0 : std::stod(digits));
+        }
+        case ast::LiteralExpr::LiteralType::BOOLEAN:
+            return ConstValue::ofBool(lit->value == "true");
+        case ast::LiteralExpr::LiteralType::STRING:
+            return ConstValue::ofString(lit->value);
+        default:
+            notConstant("nil is not a compile-time constant");
+        }
+    }
+    if (auto *group = ast::dyn_cast<ast::GroupingExpr>(expr))
+        return eval(group->expression.get(), frame);
+    if (auto *var = ast::dyn_cast<ast::VariableExpr>(expr)) {
+        if (ConstValue *local = frame.find(var->name))
+            return *local;
+        auto it = constants_.find(var->name);
+        if (it != constants_.end())
+            return it->second;
+        notConstant("'" + var->name + "' is not a compile-time constant");
+    }
+    if (auto *unary = ast::dyn_cast<ast::UnaryExpr>(expr)) {
+        ConstValue v = eval(unary->right.get(), frame);
+        switch (unary->op.type) {
+        case lexer::TokenType::MINUS:
+            if (v.kind == ConstValue::Kind::Float)
+                return ConstValue::ofFloat(-v.f);
+            return ConstValue::ofInt(int64_t(0 - uint64_t(toInt(v))));
+        case lexer::TokenType::BANG:
+            return ConstValue::ofBool(!truthy(v));
+        case lexer::TokenType::BITWISE_NOT:
+            return ConstValue::ofInt(~toInt(v));
+        default:
+            notConstant("operator '" + std::string(unary->op.value) + "'");
+        }
+    }
+    if (auto *bin = ast::dyn_cast<ast::BinaryExpr>(expr))
+        return binary(bin, frame);
+    if (auto *cond = ast::dyn_cast<ast::ConditionalExpr>(expr))
+        return eval(truthy(eval(cond->condition.get(), frame)) ? cond->thenExpr.get()
+                                                               : cond->elseExpr.get(),
+                    frame);
+    if (auto *store = ast::dyn_cast<ast::AssignExpr>(expr)) {
+        ConstValue v = eval(store->value.get(), frame);
+        assign(store->target.get(), v, frame);
+        return v;
+    }
+    if (ast::isa<ast::ArrayLiteralExpr>(expr) || ast::isa<ast::ListExpr>(expr)) {
+        const auto &elements = ast::isa<ast::ListExpr>(expr)
+                                   ? static_cast<const ast::ListExpr *>(expr)->elements
+                                   : static_cast<const ast::ArrayLiteralExpr *>(expr)->elements;
+        // An empty literal has another layout, and mixed elements are not
+        // converted by codegen either.
+        if (elements.empty())
+            notConstant("empty array literal");
+        std::vector<ConstValue> items;
+        for (const auto &e : elements)
+            items.push_back(eval(e.get(), frame));
+        ConstValue::Kind element = items[0].kind;
+        if (element != ConstValue::Kind::Int && element != ConstValue::Kind::Float)
+            notConstant("only arrays of ints or floats are compile-time constants");
+        for (const auto &item : items)
+            if (item.kind != element)
+                notConstant("array literal mixes element types");
+        ConstValue v = newArray(element, 0);
+        v.array->items = std::move(items);
+        return v;
+    }
+    if (auto *index = ast::dyn_cast<ast::IndexExpr>(expr)) {
+        ConstValue object = eval(index->object.get(), frame);
+        int64_t i = toInt(eval(index->index.get(), frame));
+        if (object.kind != ConstValue::Kind::Array)
+            notConstant("only arrays are indexed at compile time");
+        if (i < 0 || i >= int64_t(object.array->items.size()))
+            notConstant("index " + std::to_string(i) + " is out of range");
+        return object.array->items[size_t(i)];
+    }
+    if (auto *callExpr = ast::dyn_cast<ast::CallExpr>(expr)) {
+        auto *callee = ast::dyn_cast<ast::VariableExpr>(callExpr->callee);
+        if (!callee)
+            notConstant("only direct calls are evaluated at compile time");
+        std::vector<ConstValue> args;
+        for (const auto &a : callExpr->arguments)
+            args.push_back(eval(a.get(), frame));
+        auto fn = functions_.find(callee->name);
+        if (fn != functions_.end())
+            return call(fn->second, std::move(args));
+        ConstValue result;
+        if (builtin(callee->name, args, result))
+            return result;
+        notConstant("'" + callee->name + "' is not a const function");
+    }
+    notConstant("expression is not evaluated at compile time");
+}
+
+ConstValue ConstEvaluator::binary(const ast::BinaryExpr *expr, Frame &frame) {
+    using lexer::TokenType;
+    const TokenType op = expr->op.type;
+    if (op == TokenType::AND || op == TokenType::OR) {
+        bool left = truthy(eval(expr->left.get(), frame));
+        if (left == (op == TokenType::OR))
+            return ConstValue::ofBool(left);
+        return ConstValue::ofBool(truthy(eval(expr->right.get(), frame)));
+    }
+
+    ConstValue l = eval(expr->left.get(), frame);
+    ConstValue r = eval(expr->right.get(), frame);
+    using Kind = ConstValue::Kind;
+
+    if (l.kind == Kind::String && r.kind == Kind::String) {
+        switch (op) {
+        case TokenType::PLUS: return ConstValue::ofString(l.s + r.s);
+        case TokenType::EQUAL_EQUAL: return ConstValue::ofBool(l.s == r.s);
+        case TokenType::BANG_EQUAL: return ConstValue::ofBool(l.s != r.s);
+        default: notConstant("operator '" + std::string(expr->op.value) + "' on strings");
+        }
+    }
+    if (l.kind == Kind::Bool && r.kind == Kind::Bool &&
+        (op == TokenType::EQUAL_EQUAL || op == TokenType::BANG_EQUAL))
+        return ConstValue::ofBool((l.i == r.i) == (op == TokenType::EQUAL_EQUAL));
+
+    if (l.kind == Kind::Float || r.kind == Kind::Float) {
+        double a = toFloat(l), b = toFloat(r);
+        switch (op) {
+        case TokenType::PLUS: return ConstValue::ofFloat(a + b);
+        case TokenType::MINUS: return ConstValue::ofFloat(a - b);
+        case TokenType::STAR: return ConstValue::ofFloat(a * b);
+        case TokenType::SLASH: return ConstValue::ofFloat(a / b);
+        case TokenType::EQUAL_EQUAL: return ConstValue::ofBool(a == b);
+        case TokenType::BANG_EQUAL: return ConstValue::ofBool(a != b);
+        case TokenType::LESS: return ConstValue::ofBool(a < b);
+        case TokenType::LESS_EQUAL: return ConstValue::ofBool(a <= b);
+        case TokenType::GREATER: return ConstValue::ofBool(a > b);
+        case TokenType::GREATER_EQUAL: return ConstValue::ofBool(a >= b);
+        default: notConstant("operator '" + std::string(expr->op.value) + "' on floats");
+        }
+    }
+
+    // Ints wrap like the i64 arithmetic codegen emits.
+    uint64_t a = uint64_t(toInt(l)), b = uint64_t(toInt(r));
+    switch (op) {
+    case TokenType::PLUS: return ConstValue::ofInt(int64_t(a + b));
+    case TokenType::MINUS: return ConstValue::ofInt(int64_t(a - b));
+    case TokenType::STAR: return ConstValue::ofInt(int64_t(a * b));
+    case TokenType::SLASH:
+    case TokenType::PERCENT: {
+        // Division by zero traps at run time, and INT64_MIN / -1 overflows.
+        if (b == 0 || (int64_t(a) == std::numeric_limits<int64_t>::min() && int64_t(b) == -1))
+            notConstant("integer division by zero or overflow");
+        return ConstValue::ofInt(op == TokenType::SLASH ? int64_t(a) / int64_t(b)
+                                                        : int64_t(a) % int64_t(b));
+    }
+    case TokenType::BITWISE_AND: return ConstValue::ofInt(int64_t(a & b));
+    case TokenType::BITWISE_OR: return ConstValue::ofInt(int64_t(a | b));
+    case TokenType::BITWISE_XOR: return ConstValue::ofInt(int64_t(a ^ b));
+    case TokenType::LEFT_SHIFT:
+    case TokenType::RIGHT_SHIFT:
+        if (b >= 64)
+            notConstant("shift by " + std::to_string(int64_t(b)));
+        return ConstValue::ofInt(op == TokenType::LEFT_SHIFT ? int64_t(a << b) : int64_t(a) >> b);
+    case TokenType::EQUAL_EQUAL: return ConstValue::ofBool(a == b);
+    case TokenType::BANG_EQUAL: return ConstValue::ofBool(a != b);
+    case TokenType::LESS: return ConstValue::ofBool(int64_t(a) < int64_t(b));
+    case TokenType::LESS_EQUAL: return ConstValue::ofBool(int64_t(a) <= int64_t(b));
+    case TokenType::GREATER: return ConstValue::ofBool(int64_t(a) > int64_t(b));
+    case TokenType::GREATER_EQUAL: return ConstValue::ofBool(int64_t(a) >= int64_t(b));
+    default: notConstant("operator '" + std::string(expr->op.value) + "'");
+    }
+}
+
+void ConstEvaluator::assign(const ast::Expression *target, const ConstValue &value, Frame &frame) {
+    if (auto *var = ast::dyn_cast<ast::VariableExpr>(target)) {
+        ConstValue *local = frame.find(var->name);
+        if (!local)
+            notConstant("assignment to '" + var->name + "', which is not a local");
+        // A float variable keeps its type when an int is assigned to it.
+        *local = local->kind == ConstValue::Kind::Float && value.kind == ConstValue::Kind::Int
+                     ? ConstValue::ofFloat(double(value.i))
+                     : value;
+        return;
+    }
+    if (auto *index = ast::dyn_cast<ast::IndexExpr>(target)) {
+        ConstValue object = eval(index->object.get(), frame);
+        int64_t i = toInt(eval(index->index.get(), frame));
+        if (object.kind != ConstValue::Kind::Array)
+            notConstant("only arrays are indexed at compile time");
+        if (object.array->frozen)
+            notConstant("a top-level constant's array is read-only at compile time");
+        if (i < 0 || i >= int64_t(object.array->items.size()))
+            notConstant("index " + std::to_string(i) + " is out of range");
+        ConstValue &slot = object.array->items[size_t(i)];
+        if (object.array->element == ConstValue::Kind::Float)
+            slot = ConstValue::ofFloat(toFloat(value));
+        else
+            slot = ConstValue::ofInt(toInt(value));
+        return;
+    }
+    notConstant("assignment target is not evaluated at compile time");
+}
+
+ConstEvaluator::Flow ConstEvaluator::exec(const ast::Statement *stmt, Frame &frame, ConstValue &result) {
+    step();
+    if (!stmt)
+        return Flow::Normal;
+
+    if (auto *e = ast::dyn_cast<ast::ExpressionStmt>(stmt)) {
+        eval(e->expression.get(), frame);
+        return Flow::Normal;
+    }
+    if (auto *var = ast::dyn_cast<ast::VariableStmt>(stmt)) {
+        if (!var->initializer)
+            notConstant("'" + var->name + "' has no initializer");
+        frame.scopes.back()[var->name] = asDeclared(eval(var->initializer.get(), frame), var->type);
+        return Flow::Normal;
+    }
+    if (auto *block = ast::dyn_cast<ast::BlockStmt>(stmt)) {
+        frame.scopes.emplace_back();
+        Flow flow = Flow::Normal;
+        for (const auto &s : block->statements)
+            if ((flow = exec(s.get(), frame, result)) != Flow::Normal)
+                break;
+        frame.scopes.pop_back();
+        return flow;
+    }
+    if (auto *ifStmt = ast::dyn_cast<ast::IfStmt>(stmt)) {
+        if (truthy(eval(ifStmt->condition.get(), frame)))
+            return exec(ifStmt->thenBranch.get(), frame, result);
+        for (const auto &elif : ifStmt->elifBranches)
+            if (truthy(eval(elif.first.get(), frame)))
+                return exec(elif.second.get(), frame, result);
+        return exec(ifStmt->elseBranch.get(), frame, result);
+    }
+    if (auto *loop = ast::dyn_cast<ast::WhileStmt>(stmt)) {
+        while (truthy(eval(loop->condition.get(), frame))) {
+            Flow flow = exec(loop->body.get(), frame, result);
+            if (flow == Flow::Break)
+                break;
+            if (flow == Flow::Return)
+                return flow;
+        }
+        return Flow::Normal;
+    }
+    if (auto *loop = ast::dyn_cast<ast::ForStmt>(stmt)) {
+        if (loop->parallel)
+            notConstant("parallel for");
+        // The loop variable is rebound on each iteration, in a scope of its
+        // own around the body.
+        auto iterate = [&](const ConstValue &v) {
+            frame.scopes.emplace_back();
+            frame.scopes.back()[loop->variable] = v;
+            Flow flow = exec(loop->body.get(), frame, result);
+            frame.scopes.pop_back();
+            return flow;
+        };
+        auto *range = ast::dyn_cast<ast::BinaryExpr>(loop->iterable);
+        if (range && range->op.type == lexer::TokenType::RANGE) {
+            int64_t begin = toInt(eval(range->left.get(), frame));
+            int64_t end = toInt(eval(range->right.get(), frame));
+            for (int64_t i = begin; i < end; ++i) {
+                Flow flow = iterate(ConstValue::ofInt(i));
+                if (flow == Flow::Break)
+                    break;
+                if (flow == Flow::Return)
+                    return flow;
+            }
+            return Flow::Normal;
+        }
+        ConstValue items = eval(loop->iterable.get(), frame);
+        if (items.kind != ConstValue::Kind::Array)
+            notConstant("for over a value that is not a range or an array");
+        for (size_t i = 0; i < items.array->items.size(); ++i) {
+            Flow flow = iterate(items.array->items[i]);
+            if (flow == Flow::Break)
+                break;
+            if (flow == Flow::Return)
+                return flow;
+        }
+        return Flow::Normal;
+    }
+    if (auto *ret = ast::dyn_cast<ast::ReturnStmt>(stmt)) {
+        if (!ret->value)
+            notConstant("return without a value");
+        result = eval(ret->value.get(), frame);
+        return Flow::Return;
+    }
+    if (auto *brk = ast::dyn_cast<ast::BreakStmt>(stmt)) {
+        if (!brk->targetLabel.empty())
+            notConstant("labeled break");
+        return Flow::Break;
+    }
+    if (auto *cont = ast::dyn_cast<ast::ContinueStmt>(stmt)) {
+        if (!cont->targetLabel.empty())
+            notConstant("labeled continue");
+        return Flow::Continue;
+    }
+    notConstant("statement is not evaluated at compile time");
+}
+
+ConstValue ConstEvaluator::call(const ast::FunctionStmt *fn, std::vector<ConstValue> args) {
+    if (depth_ >= kMaxDepth)
+        notConstant("const function calls nest deeper than " + std::to_string(kMaxDepth));
+    if (args.size() != fn->parameters.size())
+        notConstant("'" + fn->name + "' takes " + std::to_string(fn->parameters.size()) +
+                    " argument(s)");
+    Frame frame;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (fn->parameters[i].isVariadic)
+            notConstant("variadic parameter");
+        frame.scopes.back()[fn->parameters[i].name] =
+            asDeclared(std::move(args[i]), fn->parameters[i].type);
+    }
+    ++depth_;
+    ConstValue result;
+    Flow flow = exec(fn->body.get(), frame, result);
+    --depth_;
+    if (flow != Flow::Return)
+        notConstant("'" + fn->name + "' does not return a value");
+    return asDeclared(std::move(result), fn->returnType);
+}
+
+bool ConstEvaluator::builtin(const std::string &name, const std::vector<ConstValue> &args,
+                             ConstValue &result) {
+    static const std::map<std::string, double (*)(double)> unaryMath = {
+        {"sqrt", std::sqrt}, {"sin", std::sin}, {"cos", std::cos}, {"tan", std::tan},
+        {"asin", std::asin}, {"acos", std::acos}, {"atan", std::atan}, {"exp", std::exp},
+        {"log", std::log}, {"log2", std::log2}, {"log10", std::log10}, {"floor", std::floor},
+        {"ceil", std::ceil}, {"round", std::round}, {"fabs", std::fabs}};
+    using Kind = ConstValue::Kind;
+
+    auto math = unaryMath.find(name);
+    if (math != unaryMath.end() && args.size() == 1) {
+        result = ConstValue::ofFloat(math->second(toFloat(args[0])));
+        return true;
+    }
+    if (name == "pow" && args.size() == 2) {
+        result = ConstValue::ofFloat(std::pow(toFloat(args[0]), toFloat(args[1])));
+        return true;
+    }
+    if ((name == "abs" || name == "absInt") && args.size() == 1) {
+        if (args[0].kind == Kind::Float)
+            result = ConstValue::ofFloat(std::fabs(args[0].f));
+        else
+            result = ConstValue::ofInt(args[0].i < 0 ? int64_t(0 - uint64_t(toInt(args[0])))
+                                                     : toInt(args[0]));
+        return true;
+    }
+    if ((name == "min" || name == "max") && args.size() == 2) {
+        if (args[0].kind != args[1].kind)
+            notConstant(name + " of an int and a float");
+        bool first = args[0].kind == Kind::Float
+                         ? (name == "min" ? args[0].f < args[1].f : args[0].f > args[1].f)
+                         : (name == "min" ? toInt(args[0]) < toInt(args[1])
+                                          : toInt(args[0]) > toInt(args[1]));
+        result = first ? args[0] : args[1];
+        return true;
+    }
+    if (name == "intToFloat" && args.size() == 1) {
+        result = ConstValue::ofFloat(double(toInt(args[0])));
+        return true;
+    }
+    if (name == "floatToInt" && args.size() == 1) {
+        double f = toFloat(args[0]);
+        // Out of range (or NaN) is undefined in the fptosi codegen emits.
+        if (!(f > -9223372036854775808.0 && f < 9223372036854775808.0))
+            notConstant("float " + std::to_string(f) + " does not fit in an int");
+        result = ConstValue::ofInt(int64_t(f));
+        return true;
+    }
+    if (name == "floatBits" && args.size() == 1) {
+        double f = toFloat(args[0]);
+        int64_t bits;
+        static_assert(sizeof bits == sizeof f, "double is 64 bits");
+        std::memcpy(&bits, &f, sizeof bits);
+        result = ConstValue::ofInt(bits);
+        return true;
+    }
+    if (name == "floatFromBits" && args.size() == 1) {
+        int64_t bits = toInt(args[0]);
+        double f;
+        std::memcpy(&f, &bits, sizeof f);
+        result = ConstValue::ofFloat(f);
+        return true;
+    }
+    if (name == "len" && args.size() == 1 && args[0].kind == Kind::Array) {
+        result = ConstValue::ofInt(int64_t(args[0].array->items.size()));
+        return true;
+    }
+    if (name == "newArray" && args.size() == 1) {
+        result = newArray(Kind::Int, toInt(args[0]));
+        return true;
+    }
+    if ((name == "zeros" || name == "newFloatArray") && args.size() == 1) {
+        result = newArray(Kind::Float, toInt(args[0]));
+        return true;
+    }
+    return false;
+}
+
+} // namespace compiler
+} // namespace tocin
@@ -0,0 +1,101 @@
+#ifndef CONST_EVAL_H
+#define CONST_EVAL_H
+
+#include "../ast/ast.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tocin {
+namespace compiler {
+
+struct ConstArray;
+
+/**
+ * @brief A value computed at compile time: an int, float, bool or string,
+ * or a fixed-size array of ints or floats. Arrays are shared like the
+ * runtime's, so a write through one name is seen through every other.
+ */
+struct ConstValue {
+    enum class Kind { Int, Float, Bool, String, Array };
+
+    Kind kind = Kind::Int;
+    int64_t i = 0;                      // Int, Bool
+    double f = 0;                       // Float
+    std::string s;                      // String
+    std::shared_ptr<ConstArray> array;  // Array
+
+    static ConstValue ofInt(int64_t v);
+    static ConstValue ofFloat(double v);
+    static ConstValue ofBool(bool v);
+    static ConstValue ofString(std::string v);
+};
+
+struct ConstArray {
+    ConstValue::Kind element = ConstValue::Kind::Int; // Int or Float
+    std::vector<ConstValue> items;
+    // Reachable from a top-level constant, whose data is already emitted:
+    // writing to it would make the compile-time and run-time values differ.
+    bool frozen = false;
+};
+
+/**
+ * @brief Evaluates top-level initializers and `const def` calls at compile
+ * time.
+ *
+ * An interpreter over the pure subset of the language: literals, operators,
+ * local let/const, assignment, if/while/for over ranges and arrays,
+ * break/continue/return, calls to `const def` functions and to the pure
+ * builtins (the math functions, abs/min/max/pow, len, newArray/zeros, the
+ * int/float conversions and bit casts), and earlier top-level constants.
+ * Anything else - a call to an ordinary function, I/O, a top-level `let`
+ * that other initializers may change before this one runs - makes the
+ * expression non-constant, and the IR generator computes it at startup as
+ * before.
+ *
+ * Arithmetic follows codegen: 64-bit wrapping ints, doubles, and ints
+ * promoted when mixed with floats. Integer division by zero, out-of-range
+ * indices and shifts are left non-constant, so the program still traps or
+ * behaves at run time exactly as it would have. A step budget and a call
+ * depth limit keep a runaway loop or recursion from hanging the compiler.
+ */
+class ConstEvaluator {
+public:
+    // Registers the program's top-level `const def` functions.
+    explicit ConstEvaluator(const ast::StmtPtr &program);
+    ~ConstEvaluator();
+
+    // The value of expr, or nullopt with the reason in why.
+    std::optional<ConstValue> evaluate(const ast::Expression *expr, std::string &why);
+
+    // Makes a top-level constant visible to later initializers, freezing
+    // any array it holds.
+    void defineConstant(const std::string &name, const ConstValue &value);
+
+    bool isConstFunction(const std::string &name) const { return functions_.count(name) != 0; }
+
+private:
+    struct Frame;
+    enum class Flow { Normal, Break, Continue, Return };
+
+    ConstValue eval(const ast::Expression *expr, Frame &frame);
+    Flow exec(const ast::Statement *stmt, Frame &frame, ConstValue &result);
+    ConstValue call(const ast::FunctionStmt *fn, std::vector<ConstValue> args);
+    bool builtin(const std::string &name, const std::vector<ConstValue> &args, ConstValue &result);
+    ConstValue binary(const ast::BinaryExpr *expr, Frame &frame);
+    void assign(const ast::Expression *target, const ConstValue &value, Frame &frame);
+    void step();
+
+    std::unordered_map<std::string, const ast::FunctionStmt *> functions_;
+    std::unordered_map<std::string, ConstValue> constants_;
+    uint64_t steps_ = 0;
+    unsigned depth_ = 0;
+};
+
+} // namespace compiler
+} // namespace tocin
+
+#endif // CONST_EVAL_H
@@ -0,0 +1,108 @@
+#include "file_watcher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace tocin {
+namespace compiler {
+
+namespace fs = std::filesystem;
+
+FileWatcher::FileWatcher(std::chrono::milliseconds debounce) : debounce_(debounce) {
+#ifdef __linux__
+    inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (inotify_ >= 0) close(inotify_);
+#endif
+}
+
+FileWatcher::Stamp FileWatcher::stampOf(const std::string& path) {
+    Stamp stamp;
+    std::error_code ec;
+    stamp.size = fs::file_size(path, ec);
+    if (ec) return Stamp{};
+    stamp.modified = fs::last_write_time(path, ec).time_since_epoch().count();
+    if (ec) return Stamp{};
+    stamp.exists = true;
+    return stamp;
+}
+
+void FileWatcher::watch(const std::vector<std::string>& files) {
+    std::map<std::string, Stamp> stamps;
+    for (const auto& file : files) {
+        std::error_code ec;
+        std::string path = fs::absolute(file, ec).string();
+        auto it = stamps_.find(path);
+        stamps[path] = it != stamps_.end() ? it->second : stampOf(path);
+#ifdef __linux__
+        // Watch the directory, not the file: a save by rename replaces the
+        // inode a file watch would be attached to.
+        std::string directory = fs::path(path).parent_path().string();
+        if (inotify_ >= 0 && !directories_.count(directory)) {
+            int wd = inotify_add_watch(inotify_, directory.c_str(),
+                                       IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+            if (wd >= 0) directories_[directory] = wd;
+        }
+#endif
+    }
+    stamps_ = std::move(stamps);
+}
+
+bool FileWatcher::sleepForEvents(std::chrono::milliseconds timeout) {
+#ifdef __linux__
+    if (inotify_ >= 0) {
+        pollfd fd{inotify_, POLLIN, 0};
+        if (poll(&fd, 1, static_cast<int>(timeout.count())) <= 0) return false;
+        alignas(inotify_event) char buffer[4096];
+        while (read(inotify_, buffer, sizeof buffer) > 0) {
+        }
+        return true;
+    }
+#endif
+    std::this_thread::sleep_for(timeout);
+    return true;
+}
+
+std::vector<std::string> FileWatcher::collectChanges() {
+    std::vector<std::string> changed;
+    for (auto& [path, stamp] : stamps_) {
+        Stamp now = stampOf(path);
+        if (now != stamp) {
+            stamp = now;
+            changed.push_back(path);
+        }
+    }
+    return changed;
+}
+
+std::vector<std::string> FileWatcher::wait(std::chrono::milliseconds timeout) {
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() + timeout;
+    for (;;) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (left.count() <= 0) return {};
+        // Without inotify, poll the stamps at the debounce interval.
+        if (!sleepForEvents(inotify_ >= 0 ? left : std::min(left, debounce_))) return {};
+        // Let the writer finish before reading the stamps.
+        if (inotify_ >= 0)
+            while (sleepForEvents(debounce_)) {
+            }
+        auto changed = collectChanges();
+        if (!changed.empty()) return changed;
+        // Otherwise the event was for another file in a watched directory.
+    }
+}
+
+} // namespace compiler
+} // namespace tocin
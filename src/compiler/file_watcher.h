@@ -0,0 +1,62 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace tocin {
+namespace compiler {
+
+/**
+ * @brief Reports source files that changed on disk (`--watch`).
+ *
+ * A file counts as changed when its size or modification time differs from
+ * the last stamp taken, which also catches editors that save by writing a new
+ * file and renaming it over the old one. On Linux the watcher sleeps on
+ * inotify events for the files' directories; elsewhere it polls the stamps.
+ * Bursts of events (one save is often several writes) are coalesced: wait()
+ * returns only once the files have been quiet for the debounce interval.
+ */
+class FileWatcher {
+public:
+    explicit FileWatcher(std::chrono::milliseconds debounce = std::chrono::milliseconds(100));
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Replace the watched set. Files already watched keep their stamps, so a
+    // change that happened while rebuilding is not lost.
+    void watch(const std::vector<std::string>& files);
+
+    // Block for up to @p timeout; returns the files changed since the last
+    // call (empty on timeout).
+    std::vector<std::string> wait(std::chrono::milliseconds timeout);
+
+private:
+    struct Stamp {
+        uintmax_t size = 0;
+        int64_t modified = 0;
+        bool exists = false;
+        bool operator!=(const Stamp& other) const {
+            return size != other.size || modified != other.modified || exists != other.exists;
+        }
+    };
+
+    static Stamp stampOf(const std::string& path);
+    bool sleepForEvents(std::chrono::milliseconds timeout); // true if something happened
+    std::vector<std::string> collectChanges();
+
+    std::chrono::milliseconds debounce_;
+    std::map<std::string, Stamp> stamps_;
+    int inotify_ = -1;
+    std::map<std::string, int> directories_; // watched directory -> inotify descriptor
+};
+
+} // namespace compiler
+} // namespace tocin
+
+#endif // FILE_WATCHER_H
@@ -0,0 +1,346 @@
+#include "hot_reload.h"
+#include "jit_stubs.h"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/ModuleSlotTracker.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <functional>
+
+namespace tocin {
+namespace compiler {
+
+namespace {
+
+std::string printedType(const llvm::Type* type) {
+    std::string text;
+    llvm::raw_string_ostream out(text);
+    type->print(out);
+    return out.str();
+}
+
+// Hash of a function's instructions. The signature, linkage and attributes
+// are not part of it, so the rewriting addModule does to the loaded copy does
+// not make every function look changed.
+size_t bodyHash(const llvm::Function& function, llvm::ModuleSlotTracker& slots) {
+    std::string text;
+    llvm::raw_string_ostream out(text);
+    slots.incorporateFunction(function);
+    for (const auto& block : function) {
+        for (const auto& instruction : block) {
+            instruction.print(out, slots);
+            out << '\n';
+        }
+        out << '\n';
+    }
+    return std::hash<std::string>{}(out.str());
+}
+
+bool isMutableGlobal(const llvm::GlobalVariable& global) {
+    return !global.isDeclaration() && !global.isConstant() && !global.hasAppendingLinkage();
+}
+
+// Turn a definition into a declaration resolved by the loaded program.
+void makeImport(llvm::GlobalObject& value) {
+    if (auto* function = llvm::dyn_cast<llvm::Function>(&value))
+        function->deleteBody();
+    else
+        llvm::cast<llvm::GlobalVariable>(value).setInitializer(nullptr);
+    value.setLinkage(llvm::GlobalValue::ExternalLinkage);
+    value.setVisibility(llvm::GlobalValue::DefaultVisibility);
+    value.setComdat(nullptr);
+}
+
+} // namespace
+
+HotReloadSession::HotReloadSession(llvm::orc::LLJIT& jit, const std::string& filename,
+                                   unsigned tierLevel, uint64_t tierThreshold)
+    : jit_(jit), context_(filename), tierLevel_(tierLevel),
+      tierThreshold_(tierThreshold ? tierThreshold : TieredJIT::kDefaultThreshold) {
+    if (tierLevel_) worker_ = std::thread([this] { compileLoop(); });
+}
+
+HotReloadSession::~HotReloadSession() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    wake_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+llvm::Error HotReloadSession::addModule(llvm::orc::ThreadSafeModule module) {
+    auto stubsBuilder = llvm::orc::createLocalIndirectStubsManagerBuilder(jit_.getTargetTriple());
+    if (!stubsBuilder) {
+        return llvm::make_error<llvm::StringError>(
+            "hot reload: no indirection stubs for " + jit_.getTargetTriple().str(),
+            llvm::inconvertibleErrorCode());
+    }
+    stubs_ = stubsBuilder();
+
+    const std::string suffix = ".gen0";
+    std::vector<std::string> names;
+    llvm::Error err = module.withModuleDo([&](llvm::Module& m) -> llvm::Error {
+        // Hash before makeLinkable names anonymous globals: later compiles
+        // are hashed as generated.
+        std::unordered_map<const llvm::Function*, size_t> hashes;
+        llvm::ModuleSlotTracker slots(&m);
+        for (const auto& function : m)
+            if (!function.isDeclaration()) hashes[&function] = bodyHash(function, slots);
+        jit_stubs::makeLinkable(m);
+
+        std::vector<llvm::Function*> bodies;
+        for (auto& function : m) {
+            if (function.isDeclaration() || function.isIntrinsic()) continue;
+            if (function.getName() == "main") {
+                mainHash_ = hashes[&function];
+                continue;
+            }
+            functions_[function.getName().str()] =
+                FunctionState{printedType(function.getFunctionType()), hashes[&function]};
+            bodies.push_back(&function);
+        }
+        for (const auto& global : m.globals())
+            if (isMutableGlobal(global))
+                globals_[global.getName().str()] = printedType(global.getValueType());
+
+        for (llvm::Function* body : bodies) {
+            names.push_back(body->getName().str());
+            jit_stubs::moveBehindStub(*body, names.back() + suffix);
+        }
+        instrument(m, names, 0);
+        return llvm::Error::success();
+    });
+    if (err) return err;
+
+    if (tierLevel_)
+        if (auto hookErr = jit_stubs::defineHostFunction(
+                jit_, "__tocin_reload_promote", reinterpret_cast<void*>(&HotReloadSession::promoteHook)))
+            return hookErr;
+    if (auto stubErr = jit_stubs::createPublishedStubs(jit_, *stubs_, names)) return stubErr;
+    if (auto addErr = jit_.addIRModule(std::move(module))) return addErr;
+    for (const auto& name : names) {
+        auto body = jit_stubs::lookupAddress(jit_, name + suffix);
+        if (!body) return body.takeError();
+        if (auto updateErr = stubs_->updatePointer(name, jit_stubs::stubAddress(*body)))
+            return updateErr;
+    }
+    return llvm::Error::success();
+}
+
+llvm::Expected<HotReloadSession::Patch> HotReloadSession::update(llvm::orc::ThreadSafeModule module) {
+    Patch patch;
+    const std::string suffix = ".gen" + std::to_string(generation_ + 1);
+    std::unordered_map<std::string, FunctionState> compiled;
+    std::vector<std::pair<std::string, std::string>> newGlobals;
+
+    module.withModuleDo([&](llvm::Module& m) {
+        llvm::ModuleSlotTracker slots(&m);
+        for (auto& function : m) {
+            if (function.isDeclaration() || !function.hasName()) continue;
+            FunctionState state{printedType(function.getFunctionType()), bodyHash(function, slots)};
+            const std::string name = function.getName().str();
+            if (name == "main") {
+                if (state.irHash != mainHash_) patch.restartNeeded.push_back("main changed");
+                continue;
+            }
+            auto loaded = functions_.find(name);
+            if (loaded != functions_.end() && loaded->second.type != state.type)
+                patch.restartNeeded.push_back("signature of '" + name + "' changed");
+            else if (loaded == functions_.end() || loaded->second.irHash != state.irHash)
+                context_.markForHotReload(name);
+            compiled[name] = std::move(state);
+        }
+        for (const auto& global : m.globals()) {
+            if (!isMutableGlobal(global) || !global.hasName()) continue;
+            auto loaded = globals_.find(global.getName().str());
+            if (loaded != globals_.end() && loaded->second != printedType(global.getValueType()))
+                patch.restartNeeded.push_back("type of '" + global.getName().str() + "' changed");
+        }
+    });
+    // A live caller cannot be given a body with a different signature; keep
+    // running the loaded program unchanged.
+    const bool mainOnly = patch.restartNeeded.size() == 1 && patch.restartNeeded[0] == "main changed";
+    if (!patch.restartNeeded.empty() && !mainOnly) {
+        context_.clearHotReloadSymbols();
+        return patch;
+    }
+
+    const auto& changed = context_.getHotReloadSymbols();
+    module.withModuleDo([&](llvm::Module& m) {
+        std::vector<llvm::GlobalVariable*> appending;
+        for (auto& global : m.globals()) {
+            if (global.isDeclaration()) continue;
+            if (global.hasAppendingLinkage()) {
+                appending.push_back(&global); // constructors have already run
+            } else if (global.isConstant() || !global.hasName()) {
+                global.setLinkage(llvm::GlobalValue::InternalLinkage);
+                global.setComdat(nullptr);
+            } else if (globals_.count(global.getName().str())) {
+                makeImport(global); // keep the running program's state
+            } else {
+                global.setLinkage(llvm::GlobalValue::ExternalLinkage);
+                global.setVisibility(llvm::GlobalValue::DefaultVisibility);
+                global.setComdat(nullptr);
+                newGlobals.emplace_back(global.getName().str(), printedType(global.getValueType()));
+            }
+        }
+        for (auto* global : appending) global->eraseFromParent();
+
+        std::vector<llvm::Function*> bodies;
+        for (auto& function : m) {
+            if (function.isDeclaration() || !function.hasName()) continue;
+            if (changed.count(function.getName().str())) {
+                function.setLinkage(llvm::GlobalValue::ExternalLinkage);
+                function.setVisibility(llvm::GlobalValue::DefaultVisibility);
+                function.setComdat(nullptr);
+                bodies.push_back(&function);
+            } else {
+                makeImport(function);
+            }
+        }
+        std::vector<std::string> names;
+        for (llvm::Function* body : bodies) {
+            const std::string name = body->getName().str();
+            (functions_.count(name) ? patch.reloaded : patch.added).push_back(name);
+            jit_stubs::moveBehindStub(*body, name + suffix);
+            names.push_back(name);
+        }
+        instrument(m, names, generation_ + 1);
+    });
+    context_.clearHotReloadSymbols();
+    if (patch.reloaded.empty() && patch.added.empty()) return patch;
+
+    if (auto stubErr = jit_stubs::createPublishedStubs(jit_, *stubs_, patch.added))
+        return std::move(stubErr);
+    if (auto addErr = jit_.addIRModule(std::move(module))) return std::move(addErr);
+    for (const auto* names : {&patch.added, &patch.reloaded}) {
+        for (const auto& name : *names) {
+            auto body = jit_stubs::lookupAddress(jit_, name + suffix);
+            if (!body) return body.takeError();
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (auto updateErr = stubs_->updatePointer(name, jit_stubs::stubAddress(*body)))
+                return std::move(updateErr);
+            functions_[name] = compiled[name];
+            functions_[name].generation = generation_ + 1;
+        }
+    }
+    for (auto& [name, type] : newGlobals) globals_[name] = std::move(type);
+    ++generation_;
+    patch.applied = true;
+    return patch;
+}
+
+void HotReloadSession::instrument(llvm::Module& module, const std::vector<std::string>& names,
+                                  unsigned generation) {
+    if (!tierLevel_ || names.empty()) return;
+    auto snapshot = std::make_shared<std::string>();
+    {
+        llvm::raw_string_ostream out(*snapshot);
+        llvm::WriteBitcodeToFile(module, out);
+    }
+    const std::string suffix = ".gen" + std::to_string(generation);
+    auto* i64 = llvm::Type::getInt64Ty(module.getContext());
+    auto* countsType = llvm::ArrayType::get(i64, names.size());
+    auto* counts = new llvm::GlobalVariable(module, countsType, false, llvm::GlobalValue::InternalLinkage,
+                                            llvm::ConstantAggregateZero::get(countsType),
+                                            "__tocin_reload_counts" + suffix);
+    auto hook = module.getOrInsertFunction(
+        "__tocin_reload_promote",
+        llvm::FunctionType::get(llvm::Type::getVoidTy(module.getContext()), {i64, i64}, false));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < names.size(); ++i) {
+        llvm::Function* body = module.getFunction(names[i] + suffix);
+        if (!body) continue;
+        jit_stubs::instrumentForTierUp(*body, *counts, i, hook, reinterpret_cast<uint64_t>(this),
+                                       candidates_.size(), tierThreshold_);
+        candidates_.push_back(TierCandidate{names[i], generation, snapshot});
+    }
+}
+
+void HotReloadSession::promoteHook(int64_t self, int64_t id) {
+    auto* session = reinterpret_cast<HotReloadSession*>(self);
+    {
+        std::lock_guard<std::mutex> lock(session->mutex_);
+        if (session->stopping_) return;
+        session->queue_.push_back(static_cast<uint64_t>(id));
+    }
+    session->wake_.notify_one();
+}
+
+void HotReloadSession::compileLoop() {
+    for (;;) {
+        TierCandidate candidate;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            candidate = candidates_[queue_.front()];
+            queue_.pop_front();
+        }
+        if (auto err = compileTier2(candidate))
+            llvm::consumeError(std::move(err)); // tier 1 keeps running
+    }
+}
+
+llvm::Error HotReloadSession::compileTier2(const TierCandidate& candidate) {
+    auto current = [&] {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = functions_.find(candidate.name);
+        return it != functions_.end() && it->second.generation == candidate.generation;
+    };
+    if (!current()) return llvm::Error::success(); // redefined since
+    if (!targetMachine_) {
+        auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+        if (!jtmb) return jtmb.takeError();
+        auto tm = jtmb->createTargetMachine();
+        if (!tm) return tm.takeError();
+        targetMachine_ = std::move(*tm);
+    }
+
+    const std::string body = candidate.name + ".gen" + std::to_string(candidate.generation);
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto parsed = llvm::parseBitcodeFile(llvm::MemoryBufferRef(*candidate.snapshot, body), *context);
+    if (!parsed) return parsed.takeError();
+    std::unique_ptr<llvm::Module> module = std::move(*parsed);
+    llvm::Function* target = module->getFunction(body);
+    if (!target || target->isDeclaration()) {
+        return llvm::make_error<llvm::StringError>("hot reload: no body for " + body,
+                                                   llvm::inconvertibleErrorCode());
+    }
+    // Everything else is already loaded, and may be replaced later: link
+    // against it rather than inlining it. Module-local constants stay.
+    std::vector<llvm::GlobalVariable*> appending;
+    for (auto& function : *module)
+        if (!function.isDeclaration() && &function != target) makeImport(function);
+    for (auto& global : module->globals()) {
+        if (global.hasAppendingLinkage())
+            appending.push_back(&global);
+        else if (!global.isDeclaration() && !global.hasLocalLinkage())
+            makeImport(global);
+    }
+    for (auto* global : appending) global->eraseFromParent();
+    target->setName(body + ".tier2");
+    module->addModuleFlag(llvm::Module::Warning, jit_stubs::kTierFlag, tierLevel_);
+    TieredJIT::optimizeTier2(*module, *targetMachine_, tierLevel_);
+
+    if (auto err = jit_.addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context))))
+        return err;
+    auto address = jit_stubs::lookupAddress(jit_, body + ".tier2");
+    if (!address) return address.takeError();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = functions_.find(candidate.name);
+    if (it == functions_.end() || it->second.generation != candidate.generation)
+        return llvm::Error::success();
+    if (auto err = stubs_->updatePointer(candidate.name, jit_stubs::stubAddress(*address))) return err;
+    ++promoted_;
+    return llvm::Error::success();
+}
+
+} // namespace compiler
+} // namespace tocin
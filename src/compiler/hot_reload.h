@@ -0,0 +1,113 @@
+#ifndef HOT_RELOAD_H
+#define HOT_RELOAD_H
+
+#include "compilation_context.h"
+#include "tiered_jit.h"
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace tocin {
+namespace compiler {
+
+/**
+ * @brief Swaps recompiled functions into a running JIT program (`--watch`).
+ *
+ * The first module is added with every function but main behind an ORC
+ * indirection stub. Each later compile of the program is diffed against what
+ * is loaded: functions whose IR changed (and new ones) are compiled into a
+ * patch module and their stubs repointed, so the next call runs the new code
+ * while calls already on the stack finish in the old. The rest of the patch
+ * links against the loaded program: unchanged functions and existing mutable
+ * globals become declarations, so the program keeps its state.
+ *
+ * A change to a function's signature or to a global's type cannot be applied
+ * to live callers and rejects the whole patch; main is never replaced (it is
+ * running). Both are reported in Patch::restartNeeded. *
+ * The REPL also tiers up: with a tier level given, every body loaded is
+ * compiled unoptimized (-O0 codegen, so a new definition is ready at once)
+ * and counts its calls and loop iterations, and a background thread
+ * recompiles the ones that get hot at that level and repoints their stubs,
+ * unless a newer definition has replaced them meanwhile. Since any function
+ * may still be redefined, tier 2 does not inline across functions.
+ */
+class HotReloadSession {
+public:
+    struct Patch {
+        std::vector<std::string> reloaded;      // changed bodies now live
+        std::vector<std::string> added;         // functions new in this compile
+        std::vector<std::string> restartNeeded; // changes that need a restart
+        bool applied = false;
+    };
+
+    // tierLevel > 0 turns on tier-up to -O<tierLevel>; the JIT must then
+    // compile with TieredJIT::compilerCreator().
+    HotReloadSession(llvm::orc::LLJIT& jit, const std::string& filename, unsigned tierLevel = 0,
+                     uint64_t tierThreshold = TieredJIT::kDefaultThreshold);
+    ~HotReloadSession(); // stops the tier-up thread; must run before the JIT is destroyed
+
+    // Put the program's functions behind stubs and compile it.
+    llvm::Error addModule(llvm::orc::ThreadSafeModule module);
+
+    // Diff a fresh compile of the program against what is loaded and swap in
+    // the changes.
+    llvm::Expected<Patch> update(llvm::orc::ThreadSafeModule module);
+
+    unsigned generation() const { return generation_; }
+    // Bodies swapped to tier-2 code so far.
+    size_t promoted() const { return promoted_.load(); }
+
+private:
+    struct FunctionState {
+        std::string type;  // printed function type
+        size_t irHash = 0; // hash of the printed definition
+        unsigned generation = 0; // of the body its stub points at
+    };
+    // A loaded body that may be promoted, with the bitcode of its module as
+    // loaded (before the counters went in).
+    struct TierCandidate {
+        std::string name;
+        unsigned generation;
+        std::shared_ptr<const std::string> snapshot;
+    };
+
+    void instrument(llvm::Module& module, const std::vector<std::string>& names, unsigned generation);
+    static void promoteHook(int64_t self, int64_t id);
+    void compileLoop();
+    llvm::Error compileTier2(const TierCandidate& candidate);
+
+    llvm::orc::LLJIT& jit_;
+    std::unique_ptr<llvm::orc::IndirectStubsManager> stubs_;
+    CompilationContext context_; // hot-reload bookkeeping (markForHotReload)
+    std::unordered_map<std::string, FunctionState> functions_;
+    std::unordered_map<std::string, std::string> globals_; // mutable global -> printed type
+    size_t mainHash_ = 0;
+    unsigned generation_ = 0;
+
+    unsigned tierLevel_;
+    uint64_t tierThreshold_;
+    std::unique_ptr<llvm::TargetMachine> targetMachine_; // tier-2 middle end
+    std::vector<TierCandidate> candidates_; // indexed by the id passed to promoteHook
+    // Guards candidates_, the queue, functions_' generations and the stubs,
+    // which the tier-up thread repoints too.
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<uint64_t> queue_;
+    bool stopping_ = false;
+    std::thread worker_;
+    std::atomic<size_t> promoted_{0};
+};
+
+} // namespace compiler
+} // namespace tocin
+
+#endif // HOT_RELOAD_H
@@ -0,0 +1,147 @@
+#include "jit_cache.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace tocin {
+namespace compiler {
+
+namespace {
+
+// Write to a sibling temp file and rename over the target, so a concurrent
+// `--run` of the same program never reads a half-written entry.
+bool writeAtomically(const std::string& target, llvm::StringRef contents) {
+    std::string temp = target + ".tmp" + std::to_string(llvm::sys::Process::getProcessId());
+    {
+        std::error_code ec;
+        llvm::raw_fd_ostream out(temp, ec, llvm::sys::fs::OF_None);
+        if (ec) return false;
+        out << contents;
+        out.close();
+        if (out.has_error()) {
+            out.clear_error();
+            llvm::sys::fs::remove(temp);
+            return false;
+        }
+    }
+    if (llvm::sys::fs::rename(temp, target)) {
+        llvm::sys::fs::remove(temp);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+JITObjectCache::JITObjectCache(std::string directory) : directory_(std::move(directory)) {}
+
+std::string JITObjectCache::defaultDirectory(const char* kind) {
+    if (const char* env = std::getenv("TOCIN_CACHE_DIR"); env && *env) {
+        llvm::SmallString<256> dir(env);
+        if (std::string(kind) != "jit") llvm::sys::path::append(dir, kind);
+        return std::string(dir);
+    }
+    llvm::SmallString<256> dir;
+    if (!llvm::sys::path::cache_directory(dir)) {
+        llvm::sys::fs::current_path(dir);
+        llvm::sys::path::append(dir, ".tocin-cache");
+    }
+    llvm::sys::path::append(dir, "tocin", kind);
+    return std::string(dir);
+}
+
+std::string JITObjectCache::hash(const std::string& data) {
+    llvm::MD5 hasher;
+    hasher.update(data);
+    llvm::MD5::MD5Result result;
+    hasher.final(result);
+    return std::string(result.digest());
+}
+
+std::string JITObjectCache::hashFile(const std::string& path) {
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) return "";
+    return hash((*buffer)->getBuffer().str());
+}
+
+std::string JITObjectCache::path(const char* extension) const {
+    llvm::SmallString<256> p(directory_);
+    llvm::sys::path::append(p, key_ + extension);
+    return std::string(p);
+}
+
+namespace {
+
+// The files an entry's manifest records, if all are unchanged.
+bool readManifest(const std::string& deps, std::vector<std::string>& files) {
+    std::ifstream in(deps);
+    if (!in) return false;
+    std::string line;
+    if (!std::getline(in, line) || line != "tocin-jit-cache 1") return false;
+    while (std::getline(in, line)) {
+        size_t tab = line.rfind('\t');
+        if (tab == std::string::npos) return false;
+        files.push_back(line.substr(0, tab));
+        if (JITObjectCache::hashFile(files.back()) != line.substr(tab + 1)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool JITObjectCache::current() const {
+    std::vector<std::string> files;
+    return !key_.empty() && readManifest(path(".deps"), files);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> JITObjectCache::lookup(std::vector<std::string>* objects) const {
+    std::vector<std::string> files;
+    if (key_.empty() || !readManifest(path(".deps"), files)) return nullptr;
+    if (objects)
+        for (auto& file : files)
+            if (file.size() > 2 && file.compare(file.size() - 2, 2, ".o") == 0) objects->push_back(file);
+
+    auto object = llvm::MemoryBuffer::getFile(path(".o"));
+    if (!object) return nullptr;
+    return std::move(*object);
+}
+
+bool JITObjectCache::commit(const std::vector<std::string>& imports) {
+    if (!objectWritten_) return false;
+
+    std::ostringstream manifest;
+    manifest << "tocin-jit-cache 1\n";
+    for (const auto& file : imports) {
+        std::string digest = hashFile(file);
+        if (digest.empty()) return false;
+        manifest << file << '\t' << digest << '\n';
+    }
+    return writeAtomically(path(".deps"), manifest.str());
+}
+
+bool JITObjectCache::store(const char* extension, llvm::StringRef contents) {
+    if (llvm::sys::fs::create_directories(directory_)) return false;
+    return writeAtomically(path(extension), contents);
+}
+
+void JITObjectCache::notifyObjectCompiled(const llvm::Module*, llvm::MemoryBufferRef object) {
+    // A stale manifest must not vouch for the new object while it is written.
+    llvm::sys::fs::remove(path(".deps"));
+    if (llvm::sys::fs::create_directories(directory_)) return;
+    objectWritten_ = writeAtomically(path(".o"), object.getBuffer());
+}
+
+std::unique_ptr<llvm::MemoryBuffer> JITObjectCache::getObject(const llvm::Module*) {
+    // Hits are served before any IR exists (see lookup()); by the time ORC
+    // asks, the program has already been compiled from source.
+    return nullptr;
+}
+
+} // namespace compiler
+} // namespace tocin
@@ -0,0 +1,61 @@
+#ifndef JIT_CACHE_H
+#define JIT_CACHE_H
+
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tocin {
+namespace compiler {
+
+/**
+ * @brief On-disk cache of JIT-compiled objects for `--run`.
+ *
+ * An entry is `<key>.o` (the object ORC produced for the program) plus
+ * `<key>.deps`, which records every imported module and a hash of its
+ * contents. The key covers the entry source, the compiler build and every
+ * option that changes codegen; imports cannot be part of it because they are
+ * only known after parsing, so lookup() re-hashes the recorded files instead.
+ */
+class JITObjectCache : public llvm::ObjectCache {
+public:
+    explicit JITObjectCache(std::string directory);
+
+    // $TOCIN_CACHE_DIR, else the per-user cache directory (tocin/<kind>).
+    // `--incremental` keeps its per-module objects next to the JIT's ("obj").
+    static std::string defaultDirectory(const char* kind = "jit");
+    static std::string hash(const std::string& data);
+    static std::string hashFile(const std::string& path); // "" if unreadable
+
+    void setKey(const std::string& key) { key_ = key; }
+    const std::string& key() const { return key_; }
+
+    // Whether the entry has a manifest and none of its imports changed.
+    bool current() const;
+    // The cached object, if the entry is current. Recorded imports that are
+    // objects themselves (precompiled stdlib modules) go to `objects`: the
+    // cached object is linked against them.
+    std::unique_ptr<llvm::MemoryBuffer> lookup(std::vector<std::string>* objects = nullptr) const;
+    // Publish the manifest once ORC has handed over the object.
+    bool commit(const std::vector<std::string>& imports);
+    // Write another file of the entry; like the object, before commit().
+    bool store(const char* extension, llvm::StringRef contents);
+    // The entry's file with this extension (".o", ".deps", or a caller's own).
+    std::string path(const char* extension) const;
+
+    // llvm::ObjectCache
+    void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) override;
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) override;
+
+private:
+    std::string directory_;
+    std::string key_;
+    bool objectWritten_ = false;
+};
+
+} // namespace compiler
+} // namespace tocin
+
+#endif // JIT_CACHE_H
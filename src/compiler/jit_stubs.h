@@ -0,0 +1,139 @@
+#ifndef JIT_STUBS_H
+#define JIT_STUBS_H
+
+// Helpers shared by the JIT modes that route calls through ORC indirection
+// stubs (TieredJIT, HotReloadSession): both replace function bodies in a
+// running program by repointing a stub at newly compiled code, and both can
+// count a body's calls and loop iterations to find the ones worth
+// recompiling at a higher tier.
+
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tocin {
+namespace compiler {
+namespace jit_stubs {
+
+inline llvm::orc::ExecutorAddr stubAddress(uint64_t addr) { return llvm::orc::ExecutorAddr(addr); }
+
+inline llvm::Expected<uint64_t> lookupAddress(llvm::orc::LLJIT& jit, llvm::StringRef name) {
+    auto sym = jit.lookup(name);
+    if (!sym) return sym.takeError();
+    return sym->getValue();
+}
+
+// Define a host function under @p name in the JIT's main dylib.
+inline llvm::Error defineHostFunction(llvm::orc::LLJIT& jit, llvm::StringRef name, void* address) {
+    llvm::orc::SymbolMap symbols;
+    symbols[jit.mangleAndIntern(name)] = llvm::orc::ExecutorSymbolDef(
+        llvm::orc::ExecutorAddr::fromPtr(address), llvm::JITSymbolFlags::Exported);
+    return jit.getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(symbols)));
+}
+
+// Create stubs for @p names (initially null) and publish each one in the
+// main dylib under that name, so code that calls the name reaches the stub.
+template <typename Names>
+llvm::Error createPublishedStubs(llvm::orc::LLJIT& jit, llvm::orc::IndirectStubsManager& stubs,
+                                 const Names& names) {
+    if (names.empty()) return llvm::Error::success();
+    llvm::orc::IndirectStubsManager::StubInitsMap inits;
+    for (const auto& name : names)
+        inits[name] = {stubAddress(0), llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable};
+    if (auto err = stubs.createStubs(inits)) return err;
+    llvm::orc::SymbolMap symbols;
+    for (const auto& name : names) symbols[jit.mangleAndIntern(name)] = stubs.findStub(name, false);
+    return jit.getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(symbols)));
+}
+
+// Code compiled later links against this module's definitions by name, so
+// nothing may stay module-local.
+inline void makeLinkable(llvm::Module& module) {
+    unsigned anonymous = 0;
+    auto expose = [&](llvm::GlobalValue& value) {
+        if (value.isDeclaration() || value.hasAppendingLinkage()) return;
+        if (!value.hasName()) value.setName("__tocin_stub_anon." + std::to_string(anonymous++));
+        value.setLinkage(llvm::GlobalValue::ExternalLinkage);
+        value.setVisibility(llvm::GlobalValue::DefaultVisibility);
+        if (auto* object = llvm::dyn_cast<llvm::GlobalObject>(&value)) object->setComdat(nullptr);
+    };
+    for (auto& function : module) expose(function);
+    for (auto& global : module.globals()) expose(global);
+}
+
+// Rename @p body to @p newName and give every former use (calls, address
+// taken) a declaration under the old name instead, which the caller backs
+// with a stub.
+inline void moveBehindStub(llvm::Function& body, const std::string& newName) {
+    std::string name = body.getName().str();
+    body.setName(newName);
+    auto* stub = llvm::Function::Create(body.getFunctionType(), llvm::GlobalValue::ExternalLinkage,
+                                        name, body.getParent());
+    stub->setCallingConv(body.getCallingConv());
+    body.replaceAllUsesWith(stub);
+}
+
+// Module flag that routes a module to optimizing codegen in TieredJIT's
+// compiler (TieredJIT::compilerCreator); its value is the -O level to emit
+// at. Modules without it get -O0.
+constexpr const char* kTierFlag = "tocin.tier";
+
+// Split @p block before @p at and count there:
+//   if (atomic counts[slot]++ == threshold - 1) hook(self, id);
+inline void insertTierCounter(llvm::BasicBlock& block, llvm::BasicBlock::iterator at,
+                              llvm::GlobalVariable& counts, uint64_t slot, llvm::FunctionCallee hook,
+                              uint64_t self, uint64_t id, uint64_t threshold) {
+    auto& ctx = block.getContext();
+    llvm::BasicBlock* rest = block.splitBasicBlock(at, block.getName() + ".tier");
+    block.getTerminator()->eraseFromParent();
+
+    llvm::BasicBlock* promote = llvm::BasicBlock::Create(ctx, "tier.promote", block.getParent(), rest);
+    llvm::IRBuilder<> b(&block);
+    llvm::Value* count = b.CreateConstInBoundsGEP2_64(counts.getValueType(), &counts, 0, slot);
+    llvm::Value* before = b.CreateAtomicRMW(llvm::AtomicRMWInst::Add, count, b.getInt64(1),
+                                            llvm::MaybeAlign(8), llvm::AtomicOrdering::Monotonic);
+    b.CreateCondBr(b.CreateICmpEQ(before, b.getInt64(threshold - 1)), promote, rest);
+
+    b.SetInsertPoint(promote);
+    b.CreateCall(hook, {b.getInt64(self), b.getInt64(id)});
+    b.CreateBr(rest);
+}
+
+// Count every call of a tier-1 body and every iteration of its loops (at
+// each block that branches back to a block dominating it) in counts[slot], so
+// a function entered once but looping long is promoted for its next call
+// as well as one called often. Running frames are not replaced.
+// Reaching the threshold calls hook(self, id).
+inline void instrumentForTierUp(llvm::Function& function, llvm::GlobalVariable& counts, uint64_t slot,
+                                llvm::FunctionCallee hook, uint64_t self, uint64_t id,
+                                uint64_t threshold) {
+    std::vector<llvm::BasicBlock*> latches;
+    {
+        llvm::DominatorTree dominators(function);
+        for (auto& block : function)
+            for (llvm::BasicBlock* next : llvm::successors(&block))
+                if (dominators.dominates(next, &block)) {
+                    latches.push_back(&block);
+                    break;
+                }
+    }
+    for (llvm::BasicBlock* latch : latches)
+        insertTierCounter(*latch, latch->getTerminator()->getIterator(), counts, slot, hook, self, id,
+                          threshold);
+
+    llvm::BasicBlock& entry = function.getEntryBlock();
+    auto insertAt = entry.begin();
+    while (llvm::isa<llvm::AllocaInst>(*insertAt) || llvm::isa<llvm::PHINode>(*insertAt)) ++insertAt;
+    insertTierCounter(entry, insertAt, counts, slot, hook, self, id, threshold);
+}
+
+} // namespace jit_stubs
+} // namespace compiler
+} // namespace tocin
+
+#endif // JIT_STUBS_H
@@ -0,0 +1,83 @@
+#include "jit_symbols.h"
+
+#include "../runtime/sampling_profiler.h"
+
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Object/SymbolSize.h>
+#include <llvm/Support/Process.h>
+#include <string>
+
+namespace tocin {
+namespace compiler {
+
+JITSymbolListener& JITSymbolListener::instance() {
+    static JITSymbolListener* listener = new JITSymbolListener(); // outlives every JIT
+    return *listener;
+}
+
+void JITSymbolListener::setPerfMap(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    perfMap_ = enabled;
+}
+
+void JITSymbolListener::notifyObjectLoaded(ObjectKey key, const llvm::object::ObjectFile& object,
+                                           const llvm::RuntimeDyld::LoadedObjectInfo& info) {
+    auto& profiler = tocin::runtime::SamplingProfiler::instance();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (perfMap_ && !perfMapFile_) {
+        std::string path =
+            "/tmp/perf-" + std::to_string(llvm::sys::Process::getProcessId()) + ".map";
+        perfMapFile_ = std::fopen(path.c_str(), "a");
+    }
+    auto& ranges = loaded_[key];
+    for (const auto& [symbol, size] : llvm::object::computeSymbolSizes(object)) {
+        auto type = symbol.getType();
+        if (!type) {
+            llvm::consumeError(type.takeError());
+            continue;
+        }
+        if (*type != llvm::object::SymbolRef::ST_Function || size == 0)
+            continue;
+        auto name = symbol.getName();
+        auto address = symbol.getAddress();
+        auto section = symbol.getSection();
+        if (!name || !address || !section) {
+            if (!name) llvm::consumeError(name.takeError());
+            if (!address) llvm::consumeError(address.takeError());
+            if (!section) llvm::consumeError(section.takeError());
+            continue;
+        }
+        if (*section == object.section_end())
+            continue;
+        // Symbol addresses are relative to the object's own section layout;
+        // rebase onto where RuntimeDyld put the section.
+        uint64_t base = info.getSectionLoadAddress(**section);
+        if (base == 0)
+            continue;
+        uint64_t start = base + (*address - (*section)->getAddress());
+        llvm::StringRef symbolName = *name;
+        if (object.isMachO() && symbolName.starts_with("_"))
+            symbolName = symbolName.drop_front();
+        profiler.addSymbol(start, size, symbolName.str());
+        ranges.emplace_back(start, start + size);
+        if (perfMapFile_)
+            std::fprintf(perfMapFile_, "%llx %llx %s\n", static_cast<unsigned long long>(start),
+                         static_cast<unsigned long long>(size), symbolName.str().c_str());
+    }
+    if (perfMapFile_)
+        std::fflush(perfMapFile_);
+}
+
+void JITSymbolListener::notifyFreeingObject(ObjectKey key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = loaded_.find(key);
+    if (it == loaded_.end())
+        return;
+    auto& profiler = tocin::runtime::SamplingProfiler::instance();
+    for (const auto& [start, end] : it->second)
+        profiler.removeSymbols(start, end);
+    loaded_.erase(it);
+}
+
+} // namespace compiler
+} // namespace tocin
@@ -0,0 +1,53 @@
+#ifndef JIT_SYMBOLS_H
+#define JIT_SYMBOLS_H
+
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tocin {
+namespace compiler {
+
+/**
+ * @brief Tells profilers where the JIT put each function.
+ *
+ * Registered on the RTDyld object layer the driver builds for --profile and
+ * --perf-map. Every function symbol of every object the JIT links is handed
+ * to the sampling profiler (runtime/sampling_profiler.h), so JIT'd frames
+ * are named in its output, and, with setPerfMap(true), appended to
+ * /tmp/perf-<pid>.map, the file `perf report` reads for code it cannot find
+ * on disk. Ranges are dropped again when their object is freed.
+ *
+ * The GDB JIT interface is a separate listener
+ * (JITEventListener::createGDBRegistrationListener()) next to this one.
+ */
+class JITSymbolListener : public llvm::JITEventListener {
+public:
+    static JITSymbolListener& instance();
+
+    // Append JIT'd functions to /tmp/perf-<pid>.map from now on.
+    void setPerfMap(bool enabled);
+
+    // llvm::JITEventListener
+    void notifyObjectLoaded(ObjectKey key, const llvm::object::ObjectFile& object,
+                            const llvm::RuntimeDyld::LoadedObjectInfo& info) override;
+    void notifyFreeingObject(ObjectKey key) override;
+
+private:
+    JITSymbolListener() = default;
+
+    std::mutex mutex_;
+    bool perfMap_ = false;
+    std::FILE* perfMapFile_ = nullptr;
+    // Load ranges of each object's functions, for notifyFreeingObject.
+    std::unordered_map<ObjectKey, std::vector<std::pair<uint64_t, uint64_t>>> loaded_;
+};
+
+} // namespace compiler
+} // namespace tocin
+
+#endif // JIT_SYMBOLS_H
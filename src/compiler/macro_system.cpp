@@ -332,14 +332,14 @@ ast::StmtPtr debugMacro(const MacroContext& context, error::ErrorHandler& errorH
     
     // Create a print statement for debugging
     auto debugToken = lexer::Token(lexer::TokenType::STRING, debugInfo, "", 0, 0);
-    auto debugExpr = std::make_shared<ast::LiteralExpr>(debugToken, debugInfo, ast::LiteralExpr::LiteralType::STRING);
-    auto debugCall = std::make_shared<ast::CallExpr>(
+    auto debugExpr = ast::make<ast::LiteralExpr>(debugToken, debugInfo, ast::LiteralExpr::LiteralType::STRING);
+    auto debugCall = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, "print", "", 0, 0),
         debugExpr,
         std::vector<ast::ExprPtr>{}
     );
     
-    return std::make_shared<ast::ExpressionStmt>(debugToken, debugCall);
+    return ast::make<ast::ExpressionStmt>(debugToken, debugCall);
 }
 
 ast::StmtPtr assertMacro(const MacroContext& context, error::ErrorHandler& errorHandler) {
@@ -362,23 +362,23 @@ ast::StmtPtr assertMacro(const MacroContext& context, error::ErrorHandler& error
     
     // Create if statement that throws on assertion failure
     auto messageToken = lexer::Token(lexer::TokenType::STRING, message, "", 0, 0);
-    auto messageExpr = std::make_shared<ast::LiteralExpr>(messageToken, message, ast::LiteralExpr::LiteralType::STRING);
-    auto throwCall = std::make_shared<ast::CallExpr>(
+    auto messageExpr = ast::make<ast::LiteralExpr>(messageToken, message, ast::LiteralExpr::LiteralType::STRING);
+    auto throwCall = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, "throw", "", 0, 0),
         messageExpr,
         std::vector<ast::ExprPtr>{}
     );
     
-    auto throwStmt = std::make_shared<ast::ExpressionStmt>(messageToken, throwCall);
+    auto throwStmt = ast::make<ast::ExpressionStmt>(messageToken, throwCall);
     
     std::vector<ast::StmtPtr> thenBody{throwStmt};
-    auto thenBlock = std::make_shared<ast::BlockStmt>(
+    auto thenBlock = ast::make<ast::BlockStmt>(
         lexer::Token(lexer::TokenType::LEFT_BRACE, "{", "", 0, 0),
         thenBody
     );
     
     std::vector<std::pair<ast::ExprPtr, ast::StmtPtr>> elifs;
-    return std::make_shared<ast::IfStmt>(lexer::Token(lexer::TokenType::IF, "if", "", 0, 0), condition, thenBlock, elifs, nullptr);
+    return ast::make<ast::IfStmt>(lexer::Token(lexer::TokenType::IF, "if", "", 0, 0), condition, thenBlock, elifs, nullptr);
 }
 
 ast::StmtPtr measureMacro(const MacroContext& context, error::ErrorHandler& errorHandler) {
@@ -389,54 +389,54 @@ ast::StmtPtr measureMacro(const MacroContext& context, error::ErrorHandler& erro
     }
     
     // Create timing measurement code
-    auto startTimeCall = std::make_shared<ast::CallExpr>(
+    auto startTimeCall = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, "Date.now", "", 0, 0),
-        std::make_shared<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "Date", "", 0, 0), "now"),
+        ast::make<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "Date", "", 0, 0), "now"),
         std::vector<ast::ExprPtr>{}
     );
     
-    auto startVar = std::make_shared<ast::VariableStmt>(lexer::Token(lexer::TokenType::LET, "let", "", 0, 0), "start_time", nullptr, startTimeCall, false);
+    auto startVar = ast::make<ast::VariableStmt>(lexer::Token(lexer::TokenType::LET, "let", "", 0, 0), "start_time", nullptr, startTimeCall, false);
     
     // Execute the measured code
     auto measuredCode = context.arguments[0];
     auto measuredStmt = std::dynamic_pointer_cast<ast::Statement>(measuredCode);
     if (!measuredStmt) {
-        measuredStmt = std::make_shared<ast::ExpressionStmt>(measuredCode->token, measuredCode);
+        measuredStmt = ast::make<ast::ExpressionStmt>(measuredCode->token, measuredCode);
     }
     
     // Calculate elapsed time
-    auto endTimeCall = std::make_shared<ast::CallExpr>(
+    auto endTimeCall = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, "Date.now", "", 0, 0),
-        std::make_shared<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "Date", "", 0, 0), "now"),
+        ast::make<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "Date", "", 0, 0), "now"),
         std::vector<ast::ExprPtr>{}
     );
     
-    auto elapsedExpr = std::make_shared<ast::BinaryExpr>(
+    auto elapsedExpr = ast::make<ast::BinaryExpr>(
         lexer::Token(lexer::TokenType::MINUS, "-", "", 0, 0),
         endTimeCall,
         lexer::Token(lexer::TokenType::MINUS, "-", "", 0, 0),
-        std::make_shared<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "start_time", "", 0, 0), "start_time")
+        ast::make<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "start_time", "", 0, 0), "start_time")
     );
     
-    auto elapsedVar = std::make_shared<ast::VariableStmt>(lexer::Token(lexer::TokenType::LET, "let", "", 0, 0), "elapsed", nullptr, elapsedExpr, false);
+    auto elapsedVar = ast::make<ast::VariableStmt>(lexer::Token(lexer::TokenType::LET, "let", "", 0, 0), "elapsed", nullptr, elapsedExpr, false);
     
     // Print the result
-    auto printCall = std::make_shared<ast::CallExpr>(
+    auto printCall = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, "print", "", 0, 0),
-        std::make_shared<ast::BinaryExpr>(
+        ast::make<ast::BinaryExpr>(
             lexer::Token(lexer::TokenType::PLUS, "+", "", 0, 0),
-            std::make_shared<ast::LiteralExpr>(lexer::Token(lexer::TokenType::STRING, "Execution time: ", "", 0, 0), "Execution time: ", ast::LiteralExpr::LiteralType::STRING),
+            ast::make<ast::LiteralExpr>(lexer::Token(lexer::TokenType::STRING, "Execution time: ", "", 0, 0), "Execution time: ", ast::LiteralExpr::LiteralType::STRING),
             lexer::Token(lexer::TokenType::PLUS, "+", "", 0, 0),
-            std::make_shared<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "elapsed", "", 0, 0), "elapsed")
+            ast::make<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "elapsed", "", 0, 0), "elapsed")
         ),
         std::vector<ast::ExprPtr>{}
     );
     
-    auto printStmt = std::make_shared<ast::ExpressionStmt>(lexer::Token(lexer::TokenType::SEMI_COLON, ";", "", 0, 0), printCall);
+    auto printStmt = ast::make<ast::ExpressionStmt>(lexer::Token(lexer::TokenType::SEMI_COLON, ";", "", 0, 0), printCall);
     
     // Create block with all statements
     std::vector<ast::StmtPtr> blockStmts{startVar, measuredStmt, elapsedVar, printStmt};
-    return std::make_shared<ast::BlockStmt>(
+    return ast::make<ast::BlockStmt>(
         lexer::Token(lexer::TokenType::LEFT_BRACE, "{", "", 0, 0),
         blockStmts
     );
@@ -453,7 +453,7 @@ ast::StmtPtr repeatMacro(const MacroContext& context, error::ErrorHandler& error
     auto count = context.arguments[0];
     auto body = context.arguments[1];
     
-    auto forStmt = std::make_shared<ast::ForStmt>(lexer::Token(lexer::TokenType::FOR, "for", "", 0, 0), "i", nullptr, count, std::dynamic_pointer_cast<ast::Statement>(body));
+    auto forStmt = ast::make<ast::ForStmt>(lexer::Token(lexer::TokenType::FOR, "for", "", 0, 0), "i", nullptr, count, std::dynamic_pointer_cast<ast::Statement>(body));
     
     return forStmt;
 }
@@ -474,7 +474,7 @@ ast::StmtPtr ifMacro(const MacroContext& context, error::ErrorHandler& errorHand
     }
     
     std::vector<std::pair<ast::ExprPtr, ast::StmtPtr>> elifs2;
-    return std::make_shared<ast::IfStmt>(lexer::Token(lexer::TokenType::IF, "if", "", 0, 0), condition, std::dynamic_pointer_cast<ast::Statement>(thenBody), elifs2, elseBody);
+    return ast::make<ast::IfStmt>(lexer::Token(lexer::TokenType::IF, "if", "", 0, 0), condition, std::dynamic_pointer_cast<ast::Statement>(thenBody), elifs2, elseBody);
 }
 
 ast::StmtPtr matchMacro(const MacroContext& context, error::ErrorHandler& errorHandler) {
@@ -487,7 +487,7 @@ ast::StmtPtr matchMacro(const MacroContext& context, error::ErrorHandler& errorH
     auto expression = context.arguments[0];
     
     // Create match statement (simplified)
-    return std::make_shared<ast::MatchStmt>(
+    return ast::make<ast::MatchStmt>(
         lexer::Token(lexer::TokenType::MATCH, "match", "", 0, 0),
         expression,
         std::vector<std::pair<ast::ExprPtr, ast::StmtPtr>>{},
@@ -505,7 +505,7 @@ ast::StmtPtr forMacro(const MacroContext& context, error::ErrorHandler& errorHan
     auto iterator = context.arguments[0];
     auto body = context.arguments[1];
     
-    return std::make_shared<ast::ForStmt>(lexer::Token(lexer::TokenType::FOR, "for", "", 0, 0), "", nullptr, iterator, std::dynamic_pointer_cast<ast::Statement>(body));
+    return ast::make<ast::ForStmt>(lexer::Token(lexer::TokenType::FOR, "for", "", 0, 0), "", nullptr, iterator, std::dynamic_pointer_cast<ast::Statement>(body));
 }
 
 ast::StmtPtr letMacro(const MacroContext& context, error::ErrorHandler& errorHandler) {
@@ -523,7 +523,7 @@ ast::StmtPtr letMacro(const MacroContext& context, error::ErrorHandler& errorHan
         varName = literal->value;
     }
     
-    return std::make_shared<ast::VariableStmt>(lexer::Token(lexer::TokenType::LET, "let", "", 0, 0), varName, nullptr, value, false);
+    return ast::make<ast::VariableStmt>(lexer::Token(lexer::TokenType::LET, "let", "", 0, 0), varName, nullptr, value, false);
 }
 
 ast::StmtPtr tryMacro(const MacroContext& context, error::ErrorHandler& errorHandler) {
@@ -537,7 +537,7 @@ ast::StmtPtr tryMacro(const MacroContext& context, error::ErrorHandler& errorHan
     
     // Create try-catch block (simplified)
     std::vector<ast::StmtPtr> tryBody{std::dynamic_pointer_cast<ast::Statement>(body)};
-    auto tryBlock = std::make_shared<ast::BlockStmt>(
+    auto tryBlock = ast::make<ast::BlockStmt>(
         lexer::Token(lexer::TokenType::LEFT_BRACE, "{", "", 0, 0),
         tryBody
     );
@@ -556,15 +556,15 @@ ast::StmtPtr logMacro(const MacroContext& context, error::ErrorHandler& errorHan
     auto message = context.arguments[0];
     
     // Create log statement with timestamp
-    auto timestamp = std::make_shared<ast::CallExpr>(
+    auto timestamp = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, "Date.now", "", 0, 0),
         nullptr,
         std::vector<ast::ExprPtr>{}
     );
     
-    auto logMessage = std::make_shared<ast::BinaryExpr>(
+    auto logMessage = ast::make<ast::BinaryExpr>(
         lexer::Token(lexer::TokenType::PLUS, "+", "", 0, 0),
-        std::make_shared<ast::LiteralExpr>(
+        ast::make<ast::LiteralExpr>(
             lexer::Token(lexer::TokenType::STRING, "[LOG] ", "", 0, 0),
             "[LOG] ",
             ast::LiteralExpr::LiteralType::STRING
@@ -573,13 +573,13 @@ ast::StmtPtr logMacro(const MacroContext& context, error::ErrorHandler& errorHan
         message
     );
     
-    auto printCall = std::make_shared<ast::CallExpr>(
+    auto printCall = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, "print", "", 0, 0),
         logMessage,
         std::vector<ast::ExprPtr>{}
     );
     
-    return std::make_shared<ast::ExpressionStmt>(
+    return ast::make<ast::ExpressionStmt>(
         lexer::Token(lexer::TokenType::SEMI_COLON, ";", "", 0, 0),
         printCall
     );
@@ -601,55 +601,55 @@ ast::StmtPtr profileMacro(const MacroContext& context, error::ErrorHandler& erro
     }
     
     // Create profiling code (simplified)
-    auto startTime2 = std::make_shared<ast::CallExpr>(
+    auto startTime2 = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, "performance.now", "", 0, 0),
-        std::make_shared<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "performance", "", 0, 0), "now"),
+        ast::make<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "performance", "", 0, 0), "now"),
         std::vector<ast::ExprPtr>{}
     );
     
-    auto startVar2 = std::make_shared<ast::VariableStmt>(lexer::Token(lexer::TokenType::LET, "let", "", 0, 0), "start_time", nullptr, startTime2, false);
+    auto startVar2 = ast::make<ast::VariableStmt>(lexer::Token(lexer::TokenType::LET, "let", "", 0, 0), "start_time", nullptr, startTime2, false);
     
     // Call the function
-    auto funcCall = std::make_shared<ast::CallExpr>(
+    auto funcCall = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, name, "", 0, 0),
         nullptr,
         std::vector<ast::ExprPtr>{}
     );
     
-    auto callStmt = std::make_shared<ast::ExpressionStmt>(lexer::Token(lexer::TokenType::SEMI_COLON, ";", "", 0, 0), funcCall);
+    auto callStmt = ast::make<ast::ExpressionStmt>(lexer::Token(lexer::TokenType::SEMI_COLON, ";", "", 0, 0), funcCall);
     
     // Calculate duration
-    auto endTime2 = std::make_shared<ast::CallExpr>(
+    auto endTime2 = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, "performance.now", "", 0, 0),
-        std::make_shared<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "performance", "", 0, 0), "now"),
+        ast::make<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "performance", "", 0, 0), "now"),
         std::vector<ast::ExprPtr>{}
     );
     
-    auto duration = std::make_shared<ast::BinaryExpr>(
+    auto duration = ast::make<ast::BinaryExpr>(
         lexer::Token(lexer::TokenType::MINUS, "-", "", 0, 0),
         endTime2,
         lexer::Token(lexer::TokenType::MINUS, "-", "", 0, 0),
-        std::make_shared<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "start_time", "", 0, 0), "start_time")
+        ast::make<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "start_time", "", 0, 0), "start_time")
     );
     
-    auto durationVar = std::make_shared<ast::VariableStmt>(lexer::Token(lexer::TokenType::LET, "let", "", 0, 0), "duration", nullptr, duration, false);
+    auto durationVar = ast::make<ast::VariableStmt>(lexer::Token(lexer::TokenType::LET, "let", "", 0, 0), "duration", nullptr, duration, false);
     
     // Print result
-    auto printCall2 = std::make_shared<ast::CallExpr>(
+    auto printCall2 = ast::make<ast::CallExpr>(
         lexer::Token(lexer::TokenType::IDENTIFIER, "print", "", 0, 0),
-        std::make_shared<ast::BinaryExpr>(
+        ast::make<ast::BinaryExpr>(
             lexer::Token(lexer::TokenType::IDENTIFIER, "concat", "", 0, 0),  // token for the expression
-            std::make_shared<ast::LiteralExpr>(lexer::Token(lexer::TokenType::STRING, "Function " + name + " took: ", "", 0, 0), "Function " + name + " took: ", ast::LiteralExpr::LiteralType::STRING),
+            ast::make<ast::LiteralExpr>(lexer::Token(lexer::TokenType::STRING, "Function " + name + " took: ", "", 0, 0), "Function " + name + " took: ", ast::LiteralExpr::LiteralType::STRING),
             lexer::Token(lexer::TokenType::PLUS, "+", "", 0, 0),  // operator token
-            std::make_shared<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "duration", "", 0, 0), "duration")
+            ast::make<ast::VariableExpr>(lexer::Token(lexer::TokenType::IDENTIFIER, "duration", "", 0, 0), "duration")
         ),
         std::vector<ast::ExprPtr>{}
     );
     
-    auto printStmt2 = std::make_shared<ast::ExpressionStmt>(lexer::Token(lexer::TokenType::SEMI_COLON, ";", "", 0, 0), printCall2);
+    auto printStmt2 = ast::make<ast::ExpressionStmt>(lexer::Token(lexer::TokenType::SEMI_COLON, ";", "", 0, 0), printCall2);
     
     std::vector<ast::StmtPtr> blockStmts2{startVar2, callStmt, durationVar, printStmt2};
-    return std::make_shared<ast::BlockStmt>(
+    return ast::make<ast::BlockStmt>(
         lexer::Token(lexer::TokenType::LEFT_BRACE, "{", "", 0, 0),
         blockStmts2
     );
@@ -663,7 +663,7 @@ ast::StmtPtr profileMacro(const MacroContext& context, error::ErrorHandler& erro
 namespace {
 
 struct TokenMacro {
-    std::vector<std::string> params;
+    std::vector<uint32_t> params;   // interned names (Token::symbol)
     std::vector<lexer::Token> body;
     lexer::Token site; // for diagnostics
 };
@@ -684,6 +684,72 @@ bool isCloseBracket(lexer::TokenType t) {
            t == lexer::TokenType::RIGHT_BRACE;
 }
 
+// Invocations nested deeper than this are taken to be unbounded recursion.
+constexpr size_t kMaxExpansionDepth = 128;
+
+// Where an expanded token's position comes from, so a memoized expansion can
+// be replayed at another call site: the macro body (the same at every call),
+// the invocation itself, or (>= 0) that argument token.
+constexpr int32_t kFromBody = -1;
+constexpr int32_t kFromCall = -2;
+
+struct Expansion {
+    std::vector<lexer::Token> tokens;
+    std::vector<int32_t> origins;
+
+    void push(const lexer::Token &t, int32_t origin) {
+        tokens.push_back(t);
+        origins.push_back(origin);
+    }
+};
+
+// The macro's symbol, then each argument's tokens by type and symbol with a
+// separator after it: everything an expansion depends on.
+using ExpansionKey = std::vector<uint64_t>;
+
+struct ExpansionKeyHash {
+    size_t operator()(const ExpansionKey &key) const {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for (uint64_t v : key) {
+            h ^= v;
+            h *= 0x100000001b3ull;
+        }
+        return h;
+    }
+};
+
+// An invocation on the expansion work stack: its substituted body, scanned
+// for further invocations, and the output so far. Origins in `in`/`out` are
+// relative to this call; argOrigins are the arguments' in the caller.
+struct ExpansionFrame {
+    Expansion in;
+    size_t pos = 0;
+    Expansion out;
+    ExpansionKey key;
+    std::vector<lexer::Token> args; // all arguments, back to back
+    std::vector<int32_t> argOrigins;
+    lexer::Token call;
+    int32_t callOrigin = kFromBody;
+};
+
+// Appends an expansion of `call` to the caller's output, giving the tokens
+// that came from the invocation or its arguments this call's positions.
+void replay(const Expansion &e, const ExpansionFrame &call, Expansion &out) {
+    for (size_t i = 0; i < e.tokens.size(); ++i) {
+        const int32_t origin = e.origins[i];
+        if (origin == kFromBody) {
+            out.push(e.tokens[i], kFromBody);
+            continue;
+        }
+        const lexer::Token &at = origin == kFromCall ? call.call : call.args[origin];
+        lexer::Token t = e.tokens[i];
+        t.filename = at.filename;
+        t.line = at.line;
+        t.column = at.column;
+        out.push(t, origin == kFromCall ? call.callOrigin : call.argOrigins[origin]);
+    }
+}
+
 } // namespace
 
 std::vector<lexer::Token> expandMacroTokens(const std::vector<lexer::Token> &input,
@@ -695,7 +761,7 @@ std::vector<lexer::Token> expandMacroTokens(const std::vector<lexer::Token> &inp
 
     // --- Pass 1: collect `macro name(params) { body }` definitions, removing
     //     them from the token stream. ---
-    std::unordered_map<std::string, TokenMacro> macros;
+    std::unordered_map<uint32_t, TokenMacro> macros; // by the name's symbol
     std::vector<Token> stripped;
     stripped.reserve(n);
 
@@ -714,14 +780,15 @@ std::vector<lexer::Token> expandMacroTokens(const std::vector<lexer::Token> &inp
 
         TokenMacro m;
         m.site = t;
-        const std::string name = input[i + 1].value;
+        const std::string name(input[i + 1].value);
+        const uint32_t nameSymbol = input[i + 1].symbol;
         size_t j = i + 3; // first token after '('
 
         // Parameter list: comma-separated identifiers up to ')'.
         bool paramsOk = true;
         while (j < n && input[j].type != TokenType::RIGHT_PAREN) {
             if (input[j].type == TokenType::IDENTIFIER) {
-                m.params.push_back(input[j].value);
+                m.params.push_back(input[j].symbol);
             } else if (input[j].type != TokenType::COMMA) {
                 errorHandler.reportError(error::ErrorCode::S006_INVALID_FUNCTION_DECLARATION,
                                          "Invalid parameter in macro '" + name + "'",
@@ -768,7 +835,7 @@ std::vector<lexer::Token> expandMacroTokens(const std::vector<lexer::Token> &inp
         }
         ++j; // skip closing '}'
 
-        macros[name] = std::move(m);
+        macros[nameSymbol] = std::move(m);
         i = j;
     }
 
@@ -777,110 +844,154 @@ std::vector<lexer::Token> expandMacroTokens(const std::vector<lexer::Token> &inp
     if (macros.empty())
         return input; // fast path: nothing to expand
 
-    // --- Pass 2: replace `name!(args)` invocations with substituted bodies,
-    //     iterating to a fixed point so macros can invoke other macros. ---
-    const int kMaxRounds = 128;
-    std::vector<Token> cur = std::move(stripped);
-    for (int round = 0; round < kMaxRounds; ++round) {
-        std::vector<Token> next;
-        next.reserve(cur.size());
-        bool expandedAny = false;
-
-        size_t k = 0;
+    // --- Pass 2: replace `name!(args)` invocations with substituted bodies.
+    //     Each expansion is pushed on a work stack and scanned for further
+    //     invocations as it is made, so every token is looked at once per
+    //     expansion it lands in. Finished expansions are memoized by macro
+    //     and argument tokens. ---
+    const size_t kMaxTokens = 64 * n + (size_t(1) << 20);
+    size_t produced = 0;
+    std::unordered_map<ExpansionKey, Expansion, ExpansionKeyHash> memo;
+
+    std::vector<ExpansionFrame> stack(1);
+    stack[0].in.origins.assign(stripped.size(), kFromBody);
+    stack[0].in.tokens = std::move(stripped);
+
+    for (;;) {
+        ExpansionFrame &f = stack.back();
+        const std::vector<Token> &cur = f.in.tokens;
         const size_t cn = cur.size();
-        while (k < cn) {
-            const bool isCall = cur[k].type == TokenType::IDENTIFIER &&
-                                macros.count(cur[k].value) && k + 2 < cn &&
-                                cur[k + 1].type == TokenType::BANG &&
-                                cur[k + 2].type == TokenType::LEFT_PAREN;
-            if (!isCall) {
-                next.push_back(cur[k]);
-                ++k;
-                continue;
-            }
+        size_t k = f.pos;
+
+        if (k == cn) {
+            if (stack.size() == 1)
+                break;
+            ExpansionFrame done = std::move(stack.back());
+            stack.pop_back();
+            const Expansion &result =
+                memo.emplace(std::move(done.key), std::move(done.out)).first->second;
+            replay(result, done, stack.back().out);
+            continue;
+        }
+
+        const bool isCall = cur[k].type == TokenType::IDENTIFIER &&
+                            macros.count(cur[k].symbol) && k + 2 < cn &&
+                            cur[k + 1].type == TokenType::BANG &&
+                            cur[k + 2].type == TokenType::LEFT_PAREN;
+        if (!isCall) {
+            f.out.push(cur[k], f.in.origins[k]);
+            ++f.pos;
+            continue;
+        }
+
+        ExpansionFrame call;
+        call.call = cur[k];
+        call.callOrigin = f.in.origins[k];
+        const TokenMacro &def = macros[call.call.symbol];
+        const std::string callName(call.call.value);
 
-            const Token callTok = cur[k];
-            const TokenMacro &def = macros[callTok.value];
-
-            // Split arguments on top-level commas until the matching ')'.
-            std::vector<std::vector<Token>> args;
-            std::vector<Token> arg;
-            int depth = 1;
-            size_t a = k + 3;
-            bool closed = false;
-            for (; a < cn; ++a) {
-                const TokenType tt = cur[a].type;
-                if (tt == TokenType::LEFT_PAREN || tt == TokenType::LEFT_BRACKET ||
-                    tt == TokenType::LEFT_BRACE) {
-                    ++depth;
-                } else if (tt == TokenType::RIGHT_PAREN || tt == TokenType::RIGHT_BRACKET ||
-                           tt == TokenType::RIGHT_BRACE) {
-                    --depth;
-                    if (depth == 0) {
-                        if (!arg.empty() || !args.empty())
-                            args.push_back(arg);
-                        closed = true;
-                        ++a;
-                        break;
-                    }
-                } else if (tt == TokenType::COMMA && depth == 1) {
-                    args.push_back(arg);
-                    arg.clear();
-                    continue;
+        // Split arguments on top-level commas until the matching ')'. The
+        // arguments are kept back to back; spans[p] is where the p-th ends.
+        std::vector<size_t> spans;
+        int depth = 1;
+        size_t a = k + 3;
+        bool closed = false;
+        for (; a < cn; ++a) {
+            const TokenType tt = cur[a].type;
+            if (isOpenBracket(tt)) {
+                ++depth;
+            } else if (isCloseBracket(tt)) {
+                --depth;
+                if (depth == 0) {
+                    if (!call.args.empty() || !spans.empty())
+                        spans.push_back(call.args.size());
+                    closed = true;
+                    ++a;
+                    break;
                 }
-                arg.push_back(cur[a]);
+            } else if (tt == TokenType::COMMA && depth == 1) {
+                spans.push_back(call.args.size());
+                continue;
             }
+            call.args.push_back(cur[a]);
+            call.argOrigins.push_back(f.in.origins[a]);
+        }
 
-            if (!closed) {
-                errorHandler.reportError(error::ErrorCode::S001_UNEXPECTED_TOKEN,
-                                         "Unterminated invocation of macro '" + callTok.value + "'",
-                                         callTok, error::ErrorSeverity::FATAL);
-                return input;
-            }
-            if (args.size() != def.params.size()) {
-                errorHandler.reportError(error::ErrorCode::S001_UNEXPECTED_TOKEN,
-                                         "Macro '" + callTok.value + "' expects " +
-                                             std::to_string(def.params.size()) + " argument(s), got " +
-                                             std::to_string(args.size()),
-                                         callTok, error::ErrorSeverity::FATAL);
+        if (!closed) {
+            errorHandler.reportError(error::ErrorCode::S001_UNEXPECTED_TOKEN,
+                                     "Unterminated invocation of macro '" + callName + "'",
+                                     call.call, error::ErrorSeverity::FATAL);
+            return input;
+        }
+        if (spans.size() != def.params.size()) {
+            errorHandler.reportError(error::ErrorCode::S001_UNEXPECTED_TOKEN,
+                                     "Macro '" + callName + "' expects " +
+                                         std::to_string(def.params.size()) + " argument(s), got " +
+                                         std::to_string(spans.size()),
+                                     call.call, error::ErrorSeverity::FATAL);
+            return input;
+        }
+        f.pos = a; // resume after the invocation
+
+        call.key.push_back(call.call.symbol);
+        for (size_t p = 0, t = 0; p < spans.size(); ++p) {
+            for (; t < spans[p]; ++t)
+                call.key.push_back(uint64_t(call.args[t].type) << 32 | call.args[t].symbol);
+            call.key.push_back(~uint64_t(0));
+        }
+
+        auto hit = memo.find(call.key);
+        if (hit != memo.end()) {
+            produced += hit->second.tokens.size();
+            if (produced > kMaxTokens) {
+                errorHandler.reportError(error::ErrorCode::C001_UNIMPLEMENTED_FEATURE,
+                                         "Macro expansion exceeds " + std::to_string(kMaxTokens) +
+                                             " tokens",
+                                         call.call, error::ErrorSeverity::FATAL);
                 return input;
             }
+            replay(hit->second, call, f.out);
+            continue;
+        }
+        if (stack.size() > kMaxExpansionDepth) {
+            errorHandler.reportError(error::ErrorCode::C001_UNIMPLEMENTED_FEATURE,
+                                     "Macro expansion did not terminate (recursive macro?)",
+                                     call.call, error::ErrorSeverity::FATAL);
+            return input;
+        }
 
-            std::unordered_map<std::string, const std::vector<Token> *> argOf;
-            for (size_t p = 0; p < def.params.size(); ++p)
-                argOf[def.params[p]] = &args[p];
-
-            // Emit `( body-with-substitutions )`.
-            next.push_back(synth(TokenType::LEFT_PAREN, "(", callTok));
-            for (const Token &bt : def.body) {
-                auto it = bt.type == TokenType::IDENTIFIER ? argOf.find(bt.value) : argOf.end();
-                if (it != argOf.end()) {
-                    next.push_back(synth(TokenType::LEFT_PAREN, "(", bt));
-                    for (const Token &at : *it->second)
-                        next.push_back(at);
-                    next.push_back(synth(TokenType::RIGHT_PAREN, ")", bt));
-                } else {
-                    next.push_back(bt);
-                }
+        std::unordered_map<uint32_t, size_t> paramIndex;
+        for (size_t p = 0; p < def.params.size(); ++p)
+            paramIndex[def.params[p]] = p;
+
+        // The expansion is `( body-with-substitutions )`, each argument
+        // parenthesized too.
+        call.in.push(synth(TokenType::LEFT_PAREN, "(", call.call), kFromCall);
+        for (const Token &bt : def.body) {
+            auto it = bt.type == TokenType::IDENTIFIER ? paramIndex.find(bt.symbol) : paramIndex.end();
+            if (it == paramIndex.end()) {
+                call.in.push(bt, kFromBody);
+                continue;
             }
-            next.push_back(synth(TokenType::RIGHT_PAREN, ")", callTok));
-
-            expandedAny = true;
-            k = a; // resume after the invocation
+            call.in.push(synth(TokenType::LEFT_PAREN, "(", bt), kFromBody);
+            for (size_t t = it->second ? spans[it->second - 1] : 0; t < spans[it->second]; ++t)
+                call.in.push(call.args[t], int32_t(t));
+            call.in.push(synth(TokenType::RIGHT_PAREN, ")", bt), kFromBody);
         }
+        call.in.push(synth(TokenType::RIGHT_PAREN, ")", call.call), kFromCall);
 
-        cur = std::move(next);
-        if (!expandedAny)
-            break;
-        if (round == kMaxRounds - 1) {
+        produced += call.in.tokens.size();
+        if (produced > kMaxTokens) {
             errorHandler.reportError(error::ErrorCode::C001_UNIMPLEMENTED_FEATURE,
-                                     "Macro expansion did not terminate (recursive macro?)",
-                                     error::ErrorSeverity::FATAL);
+                                     "Macro expansion exceeds " + std::to_string(kMaxTokens) +
+                                         " tokens",
+                                     call.call, error::ErrorSeverity::FATAL);
             return input;
         }
+        stack.push_back(std::move(call));
     }
 
-    return cur;
+    return std::move(stack[0].out.tokens);
 }
 
 } // namespace compiler 
\ No newline at end of file
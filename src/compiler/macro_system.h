@@ -161,8 +161,11 @@ private:
  * `name!(arg-tokens, ...)`. Each invocation is replaced by the macro body with
  * parameters textually substituted by the (parenthesized) argument tokens; the
  * whole expansion is parenthesized so it composes safely as an expression.
- * Expansion iterates to a fixed point so macros may use other macros. The
- * returned token stream has all definitions removed and invocations expanded.
+ * Macros may use other macros: each expansion is scanned for invocations as
+ * it is made, and one repeated with the same argument tokens reuses the
+ * earlier result. Nesting deeper than 128 invocations or output past a token
+ * budget is reported as an error. The returned token stream has all
+ * definitions removed and invocations expanded.
  *
  * This is intentionally unhygienic (C-style): identifiers introduced by a macro
  * body are not renamed. Macros are expression-shaped and file-local.
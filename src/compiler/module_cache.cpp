@@ -0,0 +1,49 @@
+#include "module_cache.h"
+
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace tocin {
+namespace compiler {
+
+ast::StmtPtr ModuleCache::load(const std::string& path) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    uintmax_t size = fs::file_size(path, ec);
+    if (ec) return nullptr;
+    int64_t modified = fs::last_write_time(path, ec).time_since_epoch().count();
+    if (ec) return nullptr;
+
+    auto it = entries_.find(path);
+    if (it != entries_.end() && it->second.size == size && it->second.modified == modified) {
+        ++stats_.hits;
+        return it->second.program;
+    }
+
+    std::ifstream in(path);
+    if (!in) return nullptr;
+    std::string source((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    // A module gets an arena of its own, so a cached entry keeps only its
+    // own nodes alive, not the rest of the compile that first imported it.
+    ast::ArenaScope arena(ast::Arena::create());
+    lexer::Lexer lx(source, path, 4);
+    parser::Parser ps(lx); // tokens are scanned as the parser asks for them
+    // A precompiled module's interface (see stdlib_cache.h).
+    ps.setInterface(path.size() > 4 && path.compare(path.size() - 4, 4, ".toi") == 0);
+    ast::StmtPtr program = ps.parse();
+    ++stats_.parses;
+    // A module with syntax errors is parsed (and its errors reported) again
+    // next time rather than served silently from the cache.
+    if (!program || !ps.getErrors().empty()) {
+        entries_.erase(path);
+        return program;
+    }
+    entries_[path] = Entry{size, modified, program};
+    return program;
+}
+
+} // namespace compiler
+} // namespace tocin
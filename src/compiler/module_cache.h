@@ -0,0 +1,53 @@
+#ifndef MODULE_CACHE_H
+#define MODULE_CACHE_H
+
+#include "../ast/ast.h"
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace tocin {
+namespace compiler {
+
+/**
+ * @brief Parsed imported modules, reused while their files are unchanged.
+ *
+ * resolveImports asks the cache for every import instead of lexing and
+ * parsing the file itself. An entry is keyed by absolute path and stamped with
+ * the file's size and modification time; a changed stamp re-parses that file
+ * only. The cache lives as long as the compiler (see
+ * CompilationContext::moduleCache), so REPL inputs and repeated compiles in
+ * one process parse each import once. Type checking and codegen still run on
+ * the merged program every time.
+ */
+class ModuleCache {
+public:
+    struct Stats {
+        size_t hits = 0;
+        size_t parses = 0;
+    };
+
+    // The module's AST, parsed now if it is new or its file changed. Null if
+    // the file cannot be read; ASTs with parse errors are returned uncached.
+    ast::StmtPtr load(const std::string& path);
+
+    void invalidate(const std::string& path) { entries_.erase(path); }
+    void clear() { entries_.clear(); }
+    size_t size() const { return entries_.size(); }
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct Entry {
+        uintmax_t size = 0;
+        int64_t modified = 0;
+        ast::StmtPtr program;
+    };
+
+    std::map<std::string, Entry> entries_;
+    Stats stats_;
+};
+
+} // namespace compiler
+} // namespace tocin
+
+#endif // MODULE_CACHE_H
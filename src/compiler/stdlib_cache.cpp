@@ -0,0 +1,200 @@
+#include "stdlib_cache.h"
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Module.h>
+#include <functional>
+#include <map>
+#include <sstream>
+
+namespace tocin {
+namespace compiler {
+
+namespace {
+
+std::vector<std::string> splitLines(const std::string& source) {
+    std::vector<std::string> lines;
+    std::istringstream in(source);
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    return lines;
+}
+
+bool startsWith(const std::string& s, const char* prefix) {
+    size_t i = s.find_first_not_of(" \t");
+    return i != std::string::npos && s.compare(i, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+// The line each statement starts on (1-based), with every statement on a
+// later line than the one before it, or false.
+bool statementLines(const std::vector<std::string>& lines, const std::vector<ast::StmtPtr>& statements,
+                    std::vector<size_t>& starts) {
+    size_t last = 0;
+    for (const auto& s : statements) {
+        if (!s) return false;
+        size_t line = static_cast<size_t>(s->token.line);
+        if (line <= last || line > lines.size()) return false;
+        starts.push_back(last = line);
+    }
+    return true;
+}
+
+// A function's source up to its body: the text before the first `{` outside
+// parentheses, brackets, strings and comments, less any comments right before
+// that brace (the prototype's `;` must not land in one). `annotated` says
+// whether a return type follows the parameter list. Empty if there is no body.
+std::string signatureOf(const std::string& text, bool& annotated) {
+    int depth = 0;
+    size_t paramsEnd = std::string::npos;
+    size_t codeEnd = 0; // just past the last character that is not a comment or blank
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '/' && i + 1 < text.size() && text[i + 1] == '/') {
+            i = text.find('\n', i);
+            if (i == std::string::npos) break;
+            continue;
+        } else if (c == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+            i = text.find("*/", i + 2);
+            if (i == std::string::npos) break;
+            ++i;
+            continue;
+        } else if (c == '"' || c == '\'') {
+            for (++i; i < text.size() && text[i] != c; ++i)
+                if (text[i] == '\\') ++i;
+        } else if (c == '(' || c == '[') {
+            ++depth;
+        } else if (c == ')' || c == ']') {
+            if (--depth == 0 && paramsEnd == std::string::npos) paramsEnd = i + 1;
+        } else if (c == '{' && depth == 0) {
+            std::string sig = text.substr(0, codeEnd);
+            annotated = paramsEnd != std::string::npos && codeEnd > paramsEnd;
+            return sig;
+        }
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n') codeEnd = i + 1;
+    }
+    return "";
+}
+
+// Whether a function must stay source in the interface: a prototype cannot
+// give its calling convention, or its return type is not written down.
+bool keepsBody(const ast::FunctionStmt* fn, bool annotated) {
+    if (fn->isGeneric() || fn->isConstFn) return true;
+    std::string ret = fn->returnType ? fn->returnType->toString() : "";
+    if (!annotated) return !ret.empty() && ret != "void"; // inferred (or a generator's list)
+    return ret.find("Option") != std::string::npos || ret.find("Result") != std::string::npos ||
+           ret.find("tuple") != std::string::npos || (!ret.empty() && ret[0] == '(');
+}
+
+// Whether a constant refers to a mutable global, looking through constant
+// expressions; functions it names go to `callees`.
+bool refersToMutable(const llvm::Constant* c, std::vector<const llvm::Function*>& callees) {
+    if (auto* gv = llvm::dyn_cast<llvm::GlobalVariable>(c)) return !gv->isConstant();
+    if (auto* f = llvm::dyn_cast<llvm::Function>(c)) {
+        callees.push_back(f);
+        return false;
+    }
+    if (llvm::isa<llvm::ConstantExpr>(c) || llvm::isa<llvm::ConstantAggregate>(c))
+        for (const llvm::Use& op : c->operands())
+            if (refersToMutable(llvm::cast<llvm::Constant>(op.get()), callees)) return true;
+    return false;
+}
+
+} // namespace
+
+bool isPrecompilable(const std::string& source, const std::vector<ast::StmtPtr>& statements) {
+    std::vector<std::string> lines = splitLines(source);
+    std::vector<size_t> starts;
+    if (!statementLines(lines, statements, starts)) return false;
+    for (size_t i = 0; i < statements.size(); ++i) {
+        const std::string& head = lines[starts[i] - 1];
+        ast::Statement* s = statements[i].get();
+        if (ast::dyn_cast<ast::ImportStmt>(s)) {
+            if (!startsWith(head, "import ")) return false;
+        } else if (auto* var = ast::dyn_cast<ast::VariableStmt>(s)) {
+            if (!var->isConstant || !startsWith(head, "const ")) return false;
+        } else if (auto* fn = ast::dyn_cast<ast::FunctionStmt>(s)) {
+            if (!fn->body || fn->isAsync || fn->isNaked || fn->isInterrupt || fn->isMemoize || fn->isGenerator ||
+                !fn->targetClones.empty() || !startsWith(head, fn->isConstFn ? "const def " : "def "))
+                return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+ModuleInterface makeInterface(const std::string& source, const std::vector<ast::StmtPtr>& statements,
+                              const std::string& path) {
+    std::vector<std::string> lines = splitLines(source);
+    std::vector<size_t> starts;
+    statementLines(lines, statements, starts);
+    starts.push_back(lines.size() + 1);
+
+    ModuleInterface interface;
+    std::ostringstream out;
+    out << "// Interface of " << path << ", generated by tocin; do not edit.\n";
+    for (size_t i = 0; i < statements.size(); ++i) {
+        // A statement runs to the line before the next one starts.
+        std::string text;
+        for (size_t line = starts[i]; line < starts[i + 1]; ++line) text += lines[line - 1] + '\n';
+        if (auto* fn = ast::dyn_cast<ast::FunctionStmt>(statements[i].get())) {
+            bool annotated = false;
+            std::string sig = signatureOf(text, annotated);
+            if (!sig.empty() && !keepsBody(fn, annotated)) {
+                out << sig << ";\n";
+                interface.exported.insert(fn->name);
+                continue;
+            }
+        }
+        out << text;
+    }
+    interface.text = out.str();
+    return interface;
+}
+
+void prepareInlineBitcode(llvm::Module& module, const std::set<std::string>& exported) {
+    // A body may be copied when nothing it reaches inside the module writes
+    // (or reads) a mutable global. A function under evaluation counts as
+    // copyable, so recursion settles on the rest of the cycle.
+    std::map<const llvm::Function*, bool> copyable;
+    std::function<bool(const llvm::Function&)> check = [&](const llvm::Function& F) {
+        if (F.isDeclaration()) return true;
+        auto [it, fresh] = copyable.emplace(&F, true);
+        if (!fresh) return it->second;
+        bool ok = true;
+        std::vector<const llvm::Function*> callees;
+        for (const llvm::Instruction& I : llvm::instructions(F))
+            for (const llvm::Use& op : I.operands())
+                if (auto* c = llvm::dyn_cast<llvm::Constant>(op.get()); c && refersToMutable(c, callees))
+                    ok = false;
+        for (const llvm::Function* callee : callees)
+            ok = check(*callee) && ok;
+        return copyable[&F] = ok;
+    };
+
+    for (llvm::Function& F : module) {
+        if (F.isDeclaration() || F.hasLocalLinkage()) continue;
+        if (!exported.count(F.getName().str()) || !check(F)) F.deleteBody();
+    }
+    // What only the dropped bodies used goes with them.
+    for (bool erased = true; erased;) {
+        erased = false;
+        for (llvm::Function& F : llvm::make_early_inc_range(module)) {
+            F.removeDeadConstantUsers();
+            if ((F.hasLocalLinkage() || F.isDeclaration()) && F.use_empty()) {
+                F.eraseFromParent();
+                erased = true;
+            }
+        }
+        for (llvm::GlobalVariable& G : llvm::make_early_inc_range(module.globals())) {
+            G.removeDeadConstantUsers();
+            if (G.hasLocalLinkage() && G.use_empty()) {
+                G.eraseFromParent();
+                erased = true;
+            }
+        }
+    }
+}
+
+} // namespace compiler
+} // namespace tocin
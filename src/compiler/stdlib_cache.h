@@ -0,0 +1,58 @@
+#ifndef STDLIB_CACHE_H
+#define STDLIB_CACHE_H
+
+#include "../ast/ast.h"
+#include <set>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Module;
+}
+
+namespace tocin {
+namespace compiler {
+
+/**
+ * @brief Precompiled stdlib modules: a typed interface plus an object.
+ *
+ * The first import of a stdlib module compiles it on its own into an
+ * optimized object and an interface (`.toi`) that later imports parse instead
+ * of the source, so the module is neither type-checked nor compiled again.
+ * The interface keeps the module's imports and constants, and turns each
+ * function into a `def f(params) -> T;` prototype whose body is in the
+ * object. Functions a prototype cannot stand for stay in it as source and
+ * are compiled by every importer as before: generic and `const def`
+ * functions, generators, and functions returning an Option, Result or tuple
+ * (those return by value, see IRGenerator::valueReturnType), or a type only
+ * inference knows.
+ *
+ * Only modules of imports, constants and plain functions, each starting on
+ * a line of its own, are precompiled. A module with classes, enums, traits,
+ * impls, macros, qualified functions or top-level `let` state is imported
+ * from source.
+ */
+struct ModuleInterface {
+    std::string text;               // the .toi source
+    std::set<std::string> exported; // functions the object defines
+};
+
+// Whether a module of these top-level statements, parsed from `source`, can
+// be precompiled.
+bool isPrecompilable(const std::string& source, const std::vector<ast::StmtPtr>& statements);
+
+// The interface of a precompilable module from `path`, once the type checker
+// has filled in the return types it inferred.
+ModuleInterface makeInterface(const std::string& source, const std::vector<ast::StmtPtr>& statements,
+                              const std::string& path);
+
+// Cut a precompiled module's optimized IR down to the bitcode importers link
+// for cross-module inlining: the exported bodies that reach no mutable
+// global (an importer's copy would not share it), what they call, and
+// declarations for the rest.
+void prepareInlineBitcode(llvm::Module& module, const std::set<std::string>& exported);
+
+} // namespace compiler
+} // namespace tocin
+
+#endif // STDLIB_CACHE_H
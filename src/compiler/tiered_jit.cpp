@@ -0,0 +1,249 @@
+#include "tiered_jit.h"
+#include "jit_stubs.h"
+#include "bounds_check_elim.h"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+
+namespace tocin {
+namespace compiler {
+
+namespace {
+
+using jit_stubs::kTierFlag;
+using jit_stubs::lookupAddress;
+using jit_stubs::stubAddress;
+
+llvm::OptimizationLevel toOptimizationLevel(unsigned level) {
+    switch (level) {
+    case 1: return llvm::OptimizationLevel::O1;
+    case 2: return llvm::OptimizationLevel::O2;
+    default: return llvm::OptimizationLevel::O3;
+    }
+}
+
+// The codegen level for the -O level a tier-2 module's kTierFlag carries.
+llvm::CodeGenOptLevel toCodeGenOptLevel(uint64_t level) {
+    switch (level) {
+    case 1: return llvm::CodeGenOptLevel::Less;
+    case 2: return llvm::CodeGenOptLevel::Default;
+    default: return llvm::CodeGenOptLevel::Aggressive;
+    }
+}
+
+// ConcurrentIRCompiler with the codegen level chosen per module: tier-1
+// modules go through -O0 (FastISel), tier-2 modules at the -O level their
+// kTierFlag records.
+class TierCompiler : public llvm::orc::IRCompileLayer::IRCompiler {
+public:
+    explicit TierCompiler(llvm::orc::JITTargetMachineBuilder jtmb)
+        : IRCompiler(llvm::orc::irManglingOptionsFromTargetOptions(jtmb.getOptions())),
+          jtmb_(std::move(jtmb)) {}
+
+    llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> operator()(llvm::Module& module) override {
+        auto jtmb = jtmb_;
+        auto* tier = llvm::mdconst::extract_or_null<llvm::ConstantInt>(module.getModuleFlag(kTierFlag));
+        jtmb.setCodeGenOptLevel(tier ? toCodeGenOptLevel(tier->getZExtValue())
+                                     : llvm::CodeGenOptLevel::None);
+        auto tm = jtmb.createTargetMachine();
+        if (!tm) return tm.takeError();
+        return llvm::orc::SimpleCompiler(**tm)(module);
+    }
+
+private:
+    llvm::orc::JITTargetMachineBuilder jtmb_;
+};
+
+} // namespace
+
+llvm::orc::LLJITBuilderState::CompileFunctionCreator TieredJIT::compilerCreator() {
+    return [](llvm::orc::JITTargetMachineBuilder jtmb)
+               -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+        return std::make_unique<TierCompiler>(std::move(jtmb));
+    };
+}
+
+TieredJIT::TieredJIT(llvm::orc::LLJIT& jit, unsigned optLevel, uint64_t threshold)
+    : jit_(jit), optLevel_(optLevel), threshold_(threshold ? threshold : kDefaultThreshold) {
+    worker_ = std::thread([this] { compileLoop(); });
+}
+
+TieredJIT::~TieredJIT() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        queue_.clear();
+    }
+    wake_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+TieredJIT::Stats TieredJIT::stats() const {
+    Stats s;
+    s.functions = names_.size();
+    s.promoted = promoted_.load();
+    s.failed = failed_.load();
+    return s;
+}
+
+llvm::Error TieredJIT::addModule(llvm::orc::ThreadSafeModule module) {
+    auto stubsBuilder = llvm::orc::createLocalIndirectStubsManagerBuilder(jit_.getTargetTriple());
+    if (!stubsBuilder) {
+        return llvm::make_error<llvm::StringError>(
+            "tiered JIT: no indirection stubs for " + jit_.getTargetTriple().str(),
+            llvm::inconvertibleErrorCode());
+    }
+    stubs_ = stubsBuilder();
+
+    llvm::Error err = module.withModuleDo([&](llvm::Module& m) -> llvm::Error {
+        jit_stubs::makeLinkable(m);
+        {
+            llvm::raw_string_ostream out(snapshot_);
+            llvm::WriteBitcodeToFile(m, out);
+        }
+
+        std::vector<llvm::Function*> bodies;
+        for (auto& function : m)
+            if (!function.isDeclaration() && !function.isIntrinsic() && function.getName() != "main")
+                bodies.push_back(&function);
+        if (bodies.empty()) return llvm::Error::success();
+
+        auto* i64 = llvm::Type::getInt64Ty(m.getContext());
+        auto* countsType = llvm::ArrayType::get(i64, bodies.size());
+        auto* counts = new llvm::GlobalVariable(m, countsType, false,
+                                                llvm::GlobalValue::InternalLinkage,
+                                                llvm::ConstantAggregateZero::get(countsType),
+                                                "__tocin_tier_counts");
+        auto hook = m.getOrInsertFunction(
+            "__tocin_tier_promote",
+            llvm::FunctionType::get(llvm::Type::getVoidTy(m.getContext()), {i64, i64}, false));
+
+        for (llvm::Function* body : bodies) {
+            // Callers (and address-taken uses) now reach the stub under the
+            // original name; the body becomes `<name>.tier1`.
+            std::string name = body->getName().str();
+            jit_stubs::moveBehindStub(*body, name + ".tier1");
+            jit_stubs::instrumentForTierUp(*body, *counts, names_.size(), hook,
+                                           reinterpret_cast<uint64_t>(this), names_.size(), threshold_);
+            names_.push_back(std::move(name));
+        }
+        return llvm::Error::success();
+    });
+    if (err) return err;
+
+    if (auto stubErr = jit_stubs::createPublishedStubs(jit_, *stubs_, names_)) return stubErr;
+    if (auto hookErr = jit_stubs::defineHostFunction(
+            jit_, "__tocin_tier_promote", reinterpret_cast<void*>(&TieredJIT::promoteHook)))
+        return hookErr;
+
+    if (auto addErr = jit_.addIRModule(std::move(module))) return addErr;
+    for (const auto& name : names_) {
+        auto body = lookupAddress(jit_, name + ".tier1");
+        if (!body) return body.takeError();
+        if (auto updateErr = stubs_->updatePointer(name, stubAddress(*body))) return updateErr;
+    }
+    return llvm::Error::success();
+}
+
+void TieredJIT::promoteHook(int64_t self, int64_t id) {
+    reinterpret_cast<TieredJIT*>(self)->enqueue(static_cast<uint64_t>(id));
+}
+
+void TieredJIT::enqueue(uint64_t id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        queue_.push_back(id);
+    }
+    wake_.notify_one();
+}
+
+void TieredJIT::compileLoop() {
+    for (;;) {
+        uint64_t id;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            id = queue_.front();
+            queue_.pop_front();
+        }
+        if (auto err = compileTier2(names_[id])) {
+            llvm::consumeError(std::move(err));
+            ++failed_;
+        } else {
+            ++promoted_;
+        }
+    }
+}
+
+void TieredJIT::optimizeTier2(llvm::Module& module, llvm::TargetMachine& tm, unsigned optLevel) {
+    llvm::LoopAnalysisManager lam;
+    llvm::FunctionAnalysisManager fam;
+    llvm::CGSCCAnalysisManager cgam;
+    llvm::ModuleAnalysisManager mam;
+    llvm::PassBuilder pb(&tm);
+    optimization::registerBoundsCheckElimination(pb);
+    pb.registerModuleAnalyses(mam);
+    pb.registerCGSCCAnalyses(cgam);
+    pb.registerFunctionAnalyses(fam);
+    pb.registerLoopAnalyses(lam);
+    pb.crossRegisterProxies(lam, fam, cgam, mam);
+    pb.buildPerModuleDefaultPipeline(toOptimizationLevel(optLevel)).run(module, mam);
+}
+
+llvm::Error TieredJIT::compileTier2(const std::string& name) {
+    if (!targetMachine_) {
+        auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+        if (!jtmb) return jtmb.takeError();
+        auto tm = jtmb->createTargetMachine();
+        if (!tm) return tm.takeError();
+        targetMachine_ = std::move(*tm);
+    }
+
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto parsed = llvm::parseBitcodeFile(llvm::MemoryBufferRef(snapshot_, name), *context);
+    if (!parsed) return parsed.takeError();
+    std::unique_ptr<llvm::Module> module = std::move(*parsed);
+
+    llvm::Function* target = module->getFunction(name);
+    if (!target || target->isDeclaration()) {
+        return llvm::make_error<llvm::StringError>("tiered JIT: no body for " + name,
+                                                   llvm::inconvertibleErrorCode());
+    }
+    // Everything else is already defined by tier 1 (functions by their
+    // stubs): keep the bodies for the inliner but emit none of them.
+    std::vector<llvm::GlobalVariable*> appending;
+    for (auto& function : *module)
+        if (!function.isDeclaration() && &function != target)
+            function.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+    for (auto& global : module->globals()) {
+        if (global.hasAppendingLinkage())
+            appending.push_back(&global);
+        else if (!global.isDeclaration())
+            global.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+    }
+    for (auto* global : appending) global->eraseFromParent();
+    target->setName(name + ".tier2");
+    module->addModuleFlag(llvm::Module::Warning, kTierFlag, optLevel_);
+
+    optimizeTier2(*module, *targetMachine_, optLevel_);
+
+    if (auto err = jit_.addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context))))
+        return err;
+    auto body = lookupAddress(jit_, name + ".tier2");
+    if (!body) return body.takeError();
+    return stubs_->updatePointer(name, stubAddress(*body));
+}
+
+} // namespace compiler
+} // namespace tocin
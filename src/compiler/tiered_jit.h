@@ -0,0 +1,88 @@
+#ifndef TIERED_JIT_H
+#define TIERED_JIT_H
+
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace llvm {
+class TargetMachine;
+}
+
+namespace tocin {
+namespace compiler {
+
+/**
+ * @brief Two-tier execution for `--tiered-jit`.
+ *
+ * Tier 1 is the unoptimized module compiled with -O0 codegen. Every function
+ * but main is reached through an ORC indirection stub and counts its calls
+ * and loop iterations; reaching the threshold queues the function for tier 2,
+ * which a background thread re-optimizes at the requested level (the other
+ * bodies are kept available_externally so they can still be inlined) and
+ * swaps in by repointing the stub. Calls already running keep executing
+ * tier-1 code.
+ */
+class TieredJIT {
+public:
+    struct Stats {
+        size_t functions = 0; // functions behind a stub
+        size_t promoted = 0;  // swapped to tier-2 code
+        size_t failed = 0;    // tier-2 compile errors (tier 1 keeps running)
+    };
+
+    static constexpr uint64_t kDefaultThreshold = 1000;
+
+    // Pass to LLJITBuilder::setCompileFunctionCreator: picks -O0 or -O3
+    // codegen per module, so tier-1 code is cheap to emit.
+    static llvm::orc::LLJITBuilderState::CompileFunctionCreator compilerCreator();
+
+    TieredJIT(llvm::orc::LLJIT& jit, unsigned optLevel, uint64_t threshold = kDefaultThreshold);
+    ~TieredJIT(); // stops the compile thread; must run before the JIT is destroyed
+
+    // Instrument the module, put its functions behind stubs and compile tier 1.
+    llvm::Error addModule(llvm::orc::ThreadSafeModule module);
+
+    Stats stats() const;
+
+    // The tier-2 middle end: the default -O<optLevel> pipeline (plus bounds
+    // check elimination) for @p tm. Shared with HotReloadSession's tier-up.
+    static void optimizeTier2(llvm::Module& module, llvm::TargetMachine& tm, unsigned optLevel);
+
+private:
+    static void promoteHook(int64_t self, int64_t id);
+    void enqueue(uint64_t id);
+    void compileLoop();
+    llvm::Error compileTier2(const std::string& name);
+
+    llvm::orc::LLJIT& jit_;
+    unsigned optLevel_;
+    uint64_t threshold_;
+    std::unique_ptr<llvm::orc::IndirectStubsManager> stubs_;
+    std::unique_ptr<llvm::TargetMachine> targetMachine_; // tier-2 middle end
+    std::string snapshot_; // bitcode of the module before tier-1 rewriting
+    std::vector<std::string> names_; // indexed by the id passed to promoteHook
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<uint64_t> queue_;
+    bool stopping_ = false;
+    std::thread worker_;
+
+    std::atomic<size_t> promoted_{0};
+    std::atomic<size_t> failed_{0};
+};
+
+} // namespace compiler
+} // namespace tocin
+
+#endif // TIERED_JIT_H
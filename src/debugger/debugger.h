@@ -2,6 +2,7 @@
 
 #include "../ast/ast.h"
 #include "../error/error_handler.h"
+#include "../runtime/tracepoints.h"
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -259,6 +260,32 @@ public:
     void setEventCallback(std::function<void(const DebugEvent&)> callback) override {
         eventCallback = callback;
     }
+
+    /**
+     * @brief Arm a breakpoint in the running program as a tracepoint
+     *
+     * Needs a program compiled with --debug. A breakpoint with a logMessage
+     * logs it and goes on; otherwise it stops via the runtime's break
+     * handler. Its condition is evaluated in the program. Returns the probe
+     * id for removeTracepoint, or -1 with @p error set.
+     */
+    static int setTracepoint(const Breakpoint& breakpoint, std::string& error) {
+        std::string spec = breakpoint.filename + ":" + std::to_string(breakpoint.line);
+        if (!breakpoint.condition.empty())
+            spec += " if " + breakpoint.condition;
+        if (!breakpoint.logMessage.empty()) {
+            std::string quoted;
+            for (char c : breakpoint.logMessage)
+                quoted += (c == '"' || c == '\\') ? std::string("\\") + c : std::string(1, c);
+            spec += " log \"" + quoted + "\"";
+        } else {
+            spec += " break";
+        }
+        return tocin::runtime::Tracepoints::instance().add(spec, error);
+    }
+    static bool removeTracepoint(int id) {
+        return tocin::runtime::Tracepoints::instance().remove(id);
+    }
     
 private:
     void updateCallStack();
@@ -360,6 +360,10 @@ namespace error
         {
             fatalErrorFound = true;
         }
+        if (buffered)
+        {
+            return;
+        }
 
         // rustc/clang-style diagnostic: colored severity, then the offending
         // source line with a caret under the exact column.
@@ -475,4 +479,17 @@ namespace error
         fatalErrorFound = false; // Reset fatal flag too
     }
 
+    void ErrorHandler::setBuffered(bool buffered)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->buffered = buffered;
+    }
+
+    void ErrorHandler::replay(ErrorHandler &into) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto &err : errors)
+            into.reportError(err.code, err.message, err.filename, err.line, err.column, err.severity);
+    }
+
 } // namespace error
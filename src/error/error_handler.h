@@ -348,11 +348,19 @@ namespace error
         bool isFatal() const;      // Maybe remove if FATAL severity is used consistently
         void clearErrors();        // Useful for REPL or interactive modes
 
+        // A buffered handler records diagnostics without printing them;
+        // replay() then reports them, in order, to the handler that prints.
+        // Work done in parallel collects its diagnostics this way.
+        void setBuffered(bool buffered);
+        void replay(ErrorHandler &into) const;
+        const std::string &filename() const { return defaultFilename; }
+
     private:
         std::vector<e> errors;
         mutable std::mutex mutex;
         bool fatalErrorFound = false; // Consider relying solely on severity in the errors vector
         std::string defaultFilename = "<unknown>";
+        bool buffered = false;
     };
 
 } // namespace error
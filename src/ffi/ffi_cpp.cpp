@@ -1,6 +1,10 @@
 #include "ffi_cpp.h"
 #include <dlfcn.h>
 #include <ffi.h>
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <stdexcept>
 #include <cstring>
@@ -12,6 +16,69 @@ namespace ffi {
     static std::unordered_map<std::string, void*> registeredFunctions;
     static std::string lastError;
 
+    // A symbol with its call interface, prepared once per signature.
+    struct CppFFIImpl::PreparedCall {
+        void* fn = nullptr;
+        CType ret = CType::Void;
+        std::vector<CType> params;
+        std::vector<ffi_type*> argTypes; // the cif points into this
+        ffi_cif cif;
+    };
+
+    static std::unordered_map<std::string, std::unique_ptr<CppFFIImpl::PreparedCall>> preparedCalls;
+    static std::mutex preparedCallsMutex;
+
+    static ffi_type* ffiTypeOf(CppFFIImpl::CType t) {
+        switch (t) {
+            case CppFFIImpl::CType::Void: return &ffi_type_void;
+            case CppFFIImpl::CType::Int32: return &ffi_type_sint32;
+            case CppFFIImpl::CType::Int64: return &ffi_type_sint64;
+            case CppFFIImpl::CType::Double: return &ffi_type_double;
+            case CppFFIImpl::CType::Pointer: return &ffi_type_pointer;
+        }
+        return &ffi_type_pointer;
+    }
+
+    // One argument in its C form.
+    union CallSlot {
+        int32_t i32;
+        int64_t i64;
+        double d;
+        void* p;
+    };
+
+    // FFIValues converted to the C types of a signature, with the pointer
+    // array ffi_call takes. Strings are copied so their bytes outlive the
+    // call; nothing is reallocated once the pointers are taken.
+    struct ArgStorage {
+        ArgStorage(const std::vector<FFIValue>& args, const std::vector<CppFFIImpl::CType>& types)
+            : slots(types.size()), values(types.size()) {
+            strings.reserve(types.size());
+            for (size_t i = 0; i < types.size(); ++i) {
+                const FFIValue& arg = args[i];
+                CallSlot& slot = slots[i];
+                switch (types[i]) {
+                    case CppFFIImpl::CType::Int32: slot.i32 = static_cast<int32_t>(arg.asInt64()); break;
+                    case CppFFIImpl::CType::Int64: slot.i64 = arg.asInt64(); break;
+                    case CppFFIImpl::CType::Double: slot.d = arg.asDouble(); break;
+                    default:
+                        if (arg.isString()) {
+                            strings.push_back(arg.asString());
+                            slot.p = const_cast<char*>(strings.back().c_str());
+                        } else {
+                            slot.p = arg.asPointer();
+                        }
+                        break;
+                }
+                values[i] = &slot;
+            }
+        }
+
+        std::vector<CallSlot> slots;
+        std::vector<void*> values;
+        std::vector<std::string> strings;
+    };
+
     CppFFIImpl::CppFFIImpl() : initialized_(false) {
     }
 
@@ -35,6 +102,10 @@ namespace ffi {
         }
         loadedLibraries.clear();
         registeredFunctions.clear();
+        {
+            std::lock_guard<std::mutex> lock(preparedCallsMutex);
+            preparedCalls.clear();
+        }
         initialized_ = false;
     }
 
@@ -204,112 +275,114 @@ namespace ffi {
             lastError = "Invalid function pointer";
             return FFIValue();
         }
-        
-        // Use libffi for dynamic function calling
-        ffi_cif cif;
-        ffi_type **arg_types = nullptr;
-        void **arg_values = nullptr;
-        ffi_type *return_type = &ffi_type_pointer; // Default to pointer
-        void *return_value = nullptr;
-        
-        try {
-            // Allocate argument type and value arrays
-            size_t arg_count = args.size();
-            arg_types = new ffi_type*[arg_count];
-            arg_values = new void*[arg_count];
-            
-            // Convert FFIValue arguments to libffi format
-            std::vector<int32_t> int_storage;
-            std::vector<int64_t> long_storage;
-            std::vector<double> double_storage;
-            std::vector<void*> ptr_storage;
-            
-            for (size_t i = 0; i < arg_count; ++i) {
-                const auto& arg = args[i];
-                
-                switch (arg.getType()) {
-                    case FFIValue::Type::BOOLEAN:
-                        arg_types[i] = &ffi_type_sint32;
-                        int_storage.push_back(arg.asBoolean() ? 1 : 0);
-                        arg_values[i] = &int_storage.back();
-                        break;
-                        
-                    case FFIValue::Type::INTEGER:
-                        if (arg.asInt64() >= INT32_MIN && arg.asInt64() <= INT32_MAX) {
-                            arg_types[i] = &ffi_type_sint32;
-                            int_storage.push_back(static_cast<int32_t>(arg.asInt64()));
-                            arg_values[i] = &int_storage.back();
-                        } else {
-                            arg_types[i] = &ffi_type_sint64;
-                            long_storage.push_back(arg.asInt64());
-                            arg_values[i] = &long_storage.back();
-                        }
-                        break;
-                        
-                    case FFIValue::Type::FLOAT:
-                        arg_types[i] = &ffi_type_double;
-                        double_storage.push_back(arg.asDouble());
-                        arg_values[i] = &double_storage.back();
-                        break;
-                        
-                    case FFIValue::Type::STRING:
-                        arg_types[i] = &ffi_type_pointer;
-                        ptr_storage.push_back(const_cast<char*>(arg.asString().c_str()));
-                        arg_values[i] = &ptr_storage.back();
-                        break;
-                        
-                    case FFIValue::Type::POINTER:
-                        arg_types[i] = &ffi_type_pointer;
-                        ptr_storage.push_back(arg.asPointer());
-                        arg_values[i] = &ptr_storage.back();
-                        break;
-                        
-                    default:
-                        // For unsupported types, pass as NULL pointer
-                        arg_types[i] = &ffi_type_pointer;
-                        ptr_storage.push_back(nullptr);
-                        arg_values[i] = &ptr_storage.back();
-                        break;
-                }
-            }
-            
-            // Prepare the CIF (Call InterFace)
-            if (ffi_prep_cif(&cif, FFI_DEFAULT_ABI, arg_count, return_type, arg_types) != FFI_OK) {
-                lastError = "Failed to prepare FFI call interface";
-                delete[] arg_types;
-                delete[] arg_values;
-                return FFIValue();
+
+        // The C type each argument is passed as, which with the function
+        // picks the cached call interface.
+        std::vector<CType> params(args.size());
+        for (size_t i = 0; i < args.size(); ++i) {
+            const auto& arg = args[i];
+            switch (arg.getType()) {
+                case FFIValue::Type::BOOLEAN:
+                    params[i] = CType::Int32;
+                    break;
+                case FFIValue::Type::INTEGER:
+                    params[i] = arg.asInt64() >= INT32_MIN && arg.asInt64() <= INT32_MAX ? CType::Int32
+                                                                                         : CType::Int64;
+                    break;
+                case FFIValue::Type::FLOAT:
+                    params[i] = CType::Double;
+                    break;
+                default:
+                    // Strings and pointers; anything else goes as NULL.
+                    params[i] = CType::Pointer;
+                    break;
             }
-            
-            // Allocate return value storage
-            return_value = malloc(sizeof(void*));
-            
-            // Make the call
-            ffi_call(&cif, FFI_FN(functionPtr), return_value, arg_values);
-            
-            // Convert return value (assume pointer for now, would need type info for proper conversion)
-            FFIValue result;
-            if (return_value) {
-                void* ret_ptr = *static_cast<void**>(return_value);
-                if (ret_ptr) {
-                    result = FFIValue(ret_ptr, "unknown");
-                }
+        }
+        const PreparedCall* call = prepareCall(functionPtr, CType::Pointer, params);
+        if (!call) {
+            return FFIValue();
+        }
+
+        // Assume a pointer result; a handle declares the real return type.
+        void* ret = nullptr;
+        ArgStorage storage(args, call->params);
+        callHandleRaw(call, storage.values.data(), &ret);
+        return ret ? FFIValue(ret, "unknown") : FFIValue();
+    }
+
+    CppFFIImpl::FunctionHandle CppFFIImpl::getFunctionHandle(const std::string& functionName, CType returnType,
+                                                             const std::vector<CType>& paramTypes) {
+        auto it = registeredFunctions.find(functionName);
+        if (it == registeredFunctions.end()) {
+            lastError = "Function not found: " + functionName;
+            return nullptr;
+        }
+        for (CType t : paramTypes) {
+            if (t == CType::Void) {
+                lastError = "Void parameter in signature of " + functionName;
+                return nullptr;
             }
-            
-            // Cleanup
-            free(return_value);
-            delete[] arg_types;
-            delete[] arg_values;
-            
-            return result;
-            
-        } catch (const std::exception& e) {
-            lastError = std::string("FFI call failed: ") + e.what();
-            if (arg_types) delete[] arg_types;
-            if (arg_values) delete[] arg_values;
-            if (return_value) free(return_value);
+        }
+        return prepareCall(it->second, returnType, paramTypes);
+    }
+
+    FFIValue CppFFIImpl::callHandle(FunctionHandle handle, const std::vector<FFIValue>& args) {
+        if (!handle) {
+            lastError = "Invalid function handle";
+            return FFIValue();
+        }
+        if (args.size() != handle->params.size()) {
+            lastError = "Expected " + std::to_string(handle->params.size()) + " arguments, got " +
+                        std::to_string(args.size());
             return FFIValue();
         }
+        ArgStorage storage(args, handle->params);
+        CallSlot ret{};
+        callHandleRaw(handle, storage.values.data(), &ret);
+        switch (handle->ret) {
+            case CType::Void: return FFIValue::createUndefined();
+            case CType::Int32: return FFIValue(static_cast<int64_t>(static_cast<int32_t>(ret.i64)));
+            case CType::Int64: return FFIValue(ret.i64);
+            case CType::Double: return FFIValue(ret.d);
+            case CType::Pointer: return ret.p ? FFIValue(ret.p, "unknown") : FFIValue();
+        }
+        return FFIValue();
+    }
+
+    void CppFFIImpl::callHandleRaw(FunctionHandle handle, void** argValues, void* result) {
+        // libffi widens integer results narrower than a register to ffi_arg.
+        ffi_arg wide = 0;
+        void* out = handle->ret == CType::Int32 ? &wide : result;
+        ffi_call(const_cast<ffi_cif*>(&handle->cif), FFI_FN(handle->fn), out, argValues);
+        if (handle->ret == CType::Int32) {
+            int64_t v = static_cast<int32_t>(wide);
+            std::memcpy(result, &v, sizeof v);
+        }
+    }
+
+    const CppFFIImpl::PreparedCall* CppFFIImpl::prepareCall(void* fn, CType returnType,
+                                                            const std::vector<CType>& paramTypes) {
+        // Keyed by the symbol's address and the signature's type codes.
+        std::string key(reinterpret_cast<const char*>(&fn), sizeof fn);
+        key += static_cast<char>(returnType);
+        for (CType t : paramTypes) key += static_cast<char>(t);
+
+        std::lock_guard<std::mutex> lock(preparedCallsMutex);
+        auto it = preparedCalls.find(key);
+        if (it != preparedCalls.end()) {
+            return it->second.get();
+        }
+        auto call = std::make_unique<PreparedCall>();
+        call->fn = fn;
+        call->ret = returnType;
+        call->params = paramTypes;
+        for (CType t : paramTypes) call->argTypes.push_back(ffiTypeOf(t));
+        if (ffi_prep_cif(&call->cif, FFI_DEFAULT_ABI, static_cast<unsigned>(paramTypes.size()),
+                         ffiTypeOf(returnType), call->argTypes.data()) != FFI_OK) {
+            lastError = "Failed to prepare FFI call interface";
+            return nullptr;
+        }
+        return preparedCalls.emplace(std::move(key), std::move(call)).first->second.get();
     }
 
     bool CppFFIImpl::registerClass(const std::string& libraryPath, const std::string& className) {
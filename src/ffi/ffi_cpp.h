@@ -58,9 +58,30 @@ public:
 
     // Function registration and calling
     bool registerFunction(const std::string& libraryPath, const std::string& functionName);
+    // Calls through a libffi call interface prepared once per (function,
+    // argument types) and reused; the result is read as a pointer.
     FFIValue callFunctionPtr(void* functionPtr, const std::string& functionName, 
                             const std::vector<FFIValue>& args);
 
+    // C types a function handle is declared with.
+    enum class CType { Void, Int32, Int64, Double, Pointer };
+    struct PreparedCall; // the symbol and its prepared libffi call interface
+    using FunctionHandle = const PreparedCall*;
+
+    // Resolve a registered function and prepare its call interface for this
+    // signature, once: the same handle comes back for the same signature.
+    // nullptr (see getLastError) if the function is not registered. Valid
+    // until finalize().
+    FunctionHandle getFunctionHandle(const std::string& functionName, CType returnType,
+                                     const std::vector<CType>& paramTypes);
+    // Call through a handle. Arguments are converted to the declared
+    // parameter types and the result carries the declared return type.
+    FFIValue callHandle(FunctionHandle handle, const std::vector<FFIValue>& args);
+    // The unboxed form: argValues[i] points at argument i in its declared C
+    // type, and result at room for the return value (8 bytes; unused for
+    // Void).
+    void callHandleRaw(FunctionHandle handle, void** argValues, void* result);
+
     // Class operations
     bool registerClass(const std::string& libraryPath, const std::string& className);
     FFIValue createInstance(const std::string& className, const std::vector<FFIValue>& constructorArgs);
@@ -98,6 +119,9 @@ private:
     bool initialized_;
     std::unique_ptr<CppFFI> cppFFI_;
     
+    // The cached call interface for fn with this signature, made on first use.
+    const PreparedCall* prepareCall(void* fn, CType returnType, const std::vector<CType>& paramTypes);
+
     // Conversion helpers
     FFIValue ffiValueToCpp(const FFIValue& value);
     FFIValue cppValueToFFI(const FFIValue& value);
@@ -1,10 +1,244 @@
 #include "ffi_python.h"
 #include <Python.h>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
 
 namespace ffi {
 
+    // ------------------------------------------------------------------
+    // Buffer sharing.
+    //
+    // A shared Tocin array is exported through a small "tocin.Array" type
+    // implementing the buffer protocol; shareArray hands out a memoryview
+    // of it. The owner keeps the array pinned for as long as any view (or
+    // a NumPy array made from one) is alive, since the collector does not
+    // scan Python's heap. Foreign buffers are read through PyObject_GetBuffer
+    // and copied into a Tocin array in one memcpy: the array layout needs
+    // its length right before the elements, which a foreign buffer lacks.
+    // ------------------------------------------------------------------
+
+    namespace {
+
+        // Resolved from the process: present when the Tocin runtime is
+        // linked in, which is the only case with collected arrays to pin.
+        template <typename Fn>
+        Fn runtimeSymbol(const char* name) {
+#ifndef _WIN32
+            return reinterpret_cast<Fn>(dlsym(RTLD_DEFAULT, name));
+#else
+            (void)name;
+            return nullptr;
+#endif
+        }
+
+        void* pinArray(void* array) {
+            static auto pin = runtimeSymbol<void* (*)(void*)>("__tocin_gc_pin");
+            return pin ? pin(array) : nullptr;
+        }
+
+        void unpinArray(void* pin) {
+            static auto unpin = runtimeSymbol<void (*)(void*)>("__tocin_gc_unpin");
+            if (pin && unpin) unpin(pin);
+        }
+
+        // Holds the GIL on this thread for a scope; Python is only entered
+        // under one. Between calls the GIL is free, so Tocin code on other
+        // threads never waits behind Python. A Blocking guard (around running
+        // Python code, which can take arbitrarily long, and the wait for the
+        // GIL) lets the goroutine scheduler bring up a spare worker meanwhile.
+        class GilGuard {
+        public:
+            enum Kind { Quick, Blocking };
+
+            explicit GilGuard(Kind kind = Quick) : blocking_(kind == Blocking) {
+                if (blocking_) enterBlocking();
+                state_ = PyGILState_Ensure();
+            }
+            ~GilGuard() {
+                PyGILState_Release(state_);
+                if (blocking_) exitBlocking();
+            }
+            GilGuard(const GilGuard&) = delete;
+            GilGuard& operator=(const GilGuard&) = delete;
+
+            static void enterBlocking() {
+                static auto enter = runtimeSymbol<void (*)()>("__tocin_blocking_enter");
+                if (enter) enter();
+            }
+            static void exitBlocking() {
+                static auto exit = runtimeSymbol<void (*)()>("__tocin_blocking_exit");
+                if (exit) exit();
+            }
+
+        private:
+            bool blocking_;
+            PyGILState_STATE state_;
+        };
+
+        // A new reference to value as a Python object; Py_None for what has no
+        // plain counterpart. "PyObject" values are passed as themselves only
+        // when they belong to the interpreter being called (objects).
+        PyObject* toPython(const FFIValue& value, bool objects) {
+            if (value.isInteger()) {
+                return PyLong_FromLongLong(value.asInt64());
+            } else if (value.isFloat()) {
+                return PyFloat_FromDouble(value.asDouble());
+            } else if (value.isString()) {
+                return PyUnicode_FromString(value.asString().c_str());
+            } else if (value.isBoolean()) {
+                return PyBool_FromLong(value.asBoolean() ? 1 : 0);
+            }
+            PyObject* object = Py_None;
+            if (objects && value.isPointer() && value.getPointerTypeName() == "PyObject") {
+                object = static_cast<PyObject*>(value.asPointer());
+            }
+            Py_INCREF(object);
+            return object;
+        }
+
+        void* allocArray(size_t bytes) {
+            static auto alloc = runtimeSymbol<void* (*)(int64_t)>("__tocin_alloc_atomic");
+            return alloc ? alloc(static_cast<int64_t>(bytes)) : std::malloc(bytes);
+        }
+
+        const char* elementFormat(PythonFFIImpl::ArrayElement element) {
+            return element == PythonFFIImpl::ArrayElement::Float64 ? "d" : "q";
+        }
+
+        // struct-module format codes for 8-byte native elements; NumPy's
+        // int64 is "l" on LP64 platforms.
+        bool formatMatches(const char* format, PythonFFIImpl::ArrayElement element) {
+            if (!format) return false;
+            if (*format == '@' || *format == '=' ||
+                (*format == '<' && PY_LITTLE_ENDIAN) || (*format == '>' && PY_BIG_ENDIAN)) {
+                ++format;
+            }
+            if (element == PythonFFIImpl::ArrayElement::Float64) {
+                return std::strcmp(format, "d") == 0;
+            }
+            return std::strcmp(format, "q") == 0 || (sizeof(long) == 8 && std::strcmp(format, "l") == 0);
+        }
+
+        struct ArrayOwner {
+            PyObject_HEAD
+            int64_t* array;                  // [i64 len][elems]
+            void* pin;
+            PythonFFIImpl::ArrayElement element;
+            Py_ssize_t shape[1];
+            Py_ssize_t strides[1];
+        };
+
+        int arrayOwnerGetBuffer(PyObject* self, Py_buffer* view, int flags) {
+            auto* owner = reinterpret_cast<ArrayOwner*>(self);
+            view->obj = self;
+            Py_INCREF(self);
+            view->buf = owner->array + 1;
+            view->len = owner->shape[0] * 8;
+            view->itemsize = 8;
+            view->readonly = 0;
+            view->ndim = 1;
+            view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>(elementFormat(owner->element)) : nullptr;
+            view->shape = (flags & PyBUF_ND) ? owner->shape : nullptr;
+            view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? owner->strides : nullptr;
+            view->suboffsets = nullptr;
+            view->internal = nullptr;
+            return 0;
+        }
+
+        void arrayOwnerDealloc(PyObject* self) {
+            unpinArray(reinterpret_cast<ArrayOwner*>(self)->pin);
+            Py_TYPE(self)->tp_free(self);
+        }
+
+        PyTypeObject* arrayOwnerType() {
+            static PyBufferProcs bufferProcs = {arrayOwnerGetBuffer, nullptr};
+            static PyTypeObject type = {PyVarObject_HEAD_INIT(nullptr, 0)};
+            static bool ready = false;
+            if (!ready) {
+                type.tp_name = "tocin.Array";
+                type.tp_basicsize = sizeof(ArrayOwner);
+                type.tp_flags = Py_TPFLAGS_DEFAULT;
+                type.tp_doc = "A Tocin array shared through the buffer protocol";
+                type.tp_dealloc = arrayOwnerDealloc;
+                type.tp_as_buffer = &bufferProcs;
+                if (PyType_Ready(&type) < 0) return nullptr;
+                ready = true;
+            }
+            return &type;
+        }
+
+        // The owner behind a view made by shareArray, when view covers its
+        // whole array with the same element type.
+        ArrayOwner* sharedOwner(PyObject* object, PythonFFIImpl::ArrayElement element) {
+            PyTypeObject* type = arrayOwnerType();
+            ArrayOwner* owner = nullptr;
+            if (PyMemoryView_Check(object)) {
+                Py_buffer* view = PyMemoryView_GET_BUFFER(object);
+                if (!view->obj || Py_TYPE(view->obj) != type) return nullptr;
+                owner = reinterpret_cast<ArrayOwner*>(view->obj);
+                if (view->buf != owner->array + 1 || view->len != owner->shape[0] * 8 ||
+                    !formatMatches(view->format ? view->format : "B", element)) {
+                    return nullptr;
+                }
+            } else if (Py_TYPE(object) == type) {
+                owner = reinterpret_cast<ArrayOwner*>(object);
+            }
+            return owner && owner->element == element ? owner : nullptr;
+        }
+
+        PyObject* asPyObject(const FFIValue& value) {
+            return value.isPointer() && value.getPointerTypeName() == "PyObject"
+                ? static_cast<PyObject*>(value.asPointer()) : nullptr;
+        }
+
+    } // namespace
+
+    // Subinterpreters with their own GIL and a free list; a caller takes one
+    // for the length of a call. Each call runs on a thread state made for it
+    // on the calling thread, since goroutines move between threads.
+    struct PythonFFIImpl::InterpreterPool {
+        std::vector<PyInterpreterState*> interpreters;
+        std::vector<size_t> idle;
+        std::mutex mutex;
+        std::condition_variable available;
+
+        size_t take() {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (idle.empty()) {
+                GilGuard::enterBlocking();
+                available.wait(lock, [this] { return !idle.empty(); });
+                GilGuard::exitBlocking();
+            }
+            size_t i = idle.back();
+            idle.pop_back();
+            return i;
+        }
+
+        void give(size_t i) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                idle.push_back(i);
+            }
+            available.notify_one();
+        }
+
+        // Run f with interpreter i's GIL held on this thread.
+        template <typename F>
+        void run(size_t i, F f) {
+            PyThreadState* ts = PyThreadState_New(interpreters[i]);
+            PyEval_RestoreThread(ts);
+            f();
+            PyThreadState_Clear(ts);
+            PyThreadState_DeleteCurrent();
+        }
+    };
+
     PythonFFIImpl::PythonFFIImpl() : initialized_(false) {
         // Python initialization will happen in initialize()
     }
@@ -15,9 +249,15 @@ namespace ffi {
 
     bool PythonFFIImpl::initialize() {
         if (!initialized_) {
-            if (!Py_IsInitialized()) {
-                Py_Initialize();
-            }
+            static std::once_flag started;
+            std::call_once(started, [] {
+                if (!Py_IsInitialized()) {
+                    Py_Initialize();
+                    // Give up the GIL Py_Initialize left this thread holding;
+                    // every entry into Python takes it back (GilGuard).
+                    PyEval_SaveThread();
+                }
+            });
             initialized_ = true;
         }
         return true;
@@ -25,6 +265,7 @@ namespace ffi {
 
     void PythonFFIImpl::finalize() {
         if (initialized_) {
+            stopInterpreterPool();
             // Note: Don't call Py_Finalize() as it might be used by other parts
             initialized_ = false;
         }
@@ -39,15 +280,18 @@ namespace ffi {
             return FFIValue();
         }
 
+        GilGuard gil(GilGuard::Blocking);
         // Get the __main__ module
         PyObject* mainModule = PyImport_AddModule("__main__");
         if (!mainModule) {
             return FFIValue();
         }
+        return callIn(PyModule_GetDict(mainModule), functionName, args, true);
+    }
 
-        PyObject* mainDict = PyModule_GetDict(mainModule);
-        PyObject* func = PyDict_GetItemString(mainDict, functionName.c_str());
-        
+    FFIValue PythonFFIImpl::callIn(void* globals, const std::string& functionName,
+                                   const std::vector<FFIValue>& args, bool objects) {
+        PyObject* func = PyDict_GetItemString(static_cast<PyObject*>(globals), functionName.c_str());
         if (!func || !PyCallable_Check(func)) {
             return FFIValue();
         }
@@ -55,18 +299,7 @@ namespace ffi {
         // Convert FFI arguments to Python objects
         PyObject* pyArgs = PyTuple_New(args.size());
         for (size_t i = 0; i < args.size(); ++i) {
-            // For simplified implementation, create string representations
-            PyObject* arg = Py_None;
-            if (args[i].isInteger()) {
-                arg = PyLong_FromLongLong(args[i].asInt64());
-            } else if (args[i].isFloat()) {
-                arg = PyFloat_FromDouble(args[i].asDouble());
-            } else if (args[i].isString()) {
-                arg = PyUnicode_FromString(args[i].asString().c_str());
-            } else if (args[i].isBoolean()) {
-                arg = PyBool_FromLong(args[i].asBoolean() ? 1 : 0);
-            }
-            PyTuple_SetItem(pyArgs, i, arg);
+            PyTuple_SetItem(pyArgs, i, toPython(args[i], objects));
         }
 
         // Call the function
@@ -78,7 +311,7 @@ namespace ffi {
             return FFIValue();
         }
 
-        FFIValue ffiResult = pythonToFFIValue(static_cast<void*>(result));
+        FFIValue ffiResult = pythonToFFIValue(static_cast<void*>(result), objects);
         Py_DECREF(result);
         return ffiResult;
     }
@@ -88,6 +321,7 @@ namespace ffi {
             return false;
         }
 
+        GilGuard gil;
         PyObject* mainModule = PyImport_AddModule("__main__");
         if (!mainModule) return false;
 
@@ -102,6 +336,7 @@ namespace ffi {
             initialize();
         }
 
+        GilGuard gil(GilGuard::Blocking);
         PyObject* pName = PyUnicode_DecodeFSDefault(moduleName.c_str());
         PyObject* pModule = PyImport_Import(pName);
         Py_DECREF(pName);
@@ -124,6 +359,7 @@ namespace ffi {
             return false;
         }
 
+        GilGuard gil;
         PyObject* mainModule = PyImport_AddModule("__main__");
         PyObject* mainDict = PyModule_GetDict(mainModule);
         return PyDict_DelItemString(mainDict, moduleName.c_str()) == 0;
@@ -134,6 +370,7 @@ namespace ffi {
             return false;
         }
 
+        GilGuard gil;
         PyObject* modules = PyImport_GetModuleDict();
         PyObject* pName = PyUnicode_DecodeFSDefault(moduleName.c_str());
         bool loaded = PyDict_Contains(modules, pName) == 1;
@@ -153,11 +390,14 @@ namespace ffi {
         return nullptr;
     }
 
+    // The error indicator belongs to this thread's Python thread state.
     bool PythonFFIImpl::hasError() const {
+        GilGuard gil;
         return PyErr_Occurred() != NULL;
     }
 
     std::string PythonFFIImpl::getLastError() const {
+        GilGuard gil;
         if (!PyErr_Occurred()) {
             return "";
         }
@@ -179,12 +419,13 @@ namespace ffi {
     }
 
     void PythonFFIImpl::clearError() {
+        GilGuard gil;
         PyErr_Clear();
     }
 
     std::vector<std::string> PythonFFIImpl::getSupportedFeatures() const {
         return {"function_calls", "module_loading", "eval", "variables", 
-                "objects", "lists", "dicts", "tuples"};
+                "objects", "lists", "dicts", "tuples", "buffers", "threads"};
     }
 
     bool PythonFFIImpl::supportsFeature(const std::string& feature) const {
@@ -197,6 +438,7 @@ namespace ffi {
             initialize();
         }
 
+        GilGuard gil(GilGuard::Blocking);
         PyObject* mainModule = PyImport_AddModule("__main__");
         PyObject* mainDict = PyModule_GetDict(mainModule);
         
@@ -217,6 +459,7 @@ namespace ffi {
             return FFIValue();
         }
 
+        GilGuard gil;
         PyObject* mainModule = PyImport_AddModule("__main__");
         PyObject* mainDict = PyModule_GetDict(mainModule);
         PyObject* var = PyDict_GetItemString(mainDict, name.c_str());
@@ -233,23 +476,13 @@ namespace ffi {
             initialize();
         }
 
+        GilGuard gil;
         PyObject* mainModule = PyImport_AddModule("__main__");
         PyObject* mainDict = PyModule_GetDict(mainModule);
         
-        // Convert FFI value to Python object
-        PyObject* pyValue = Py_None;
-        if (value.isInteger()) {
-            pyValue = PyLong_FromLongLong(value.asInt64());
-        } else if (value.isFloat()) {
-            pyValue = PyFloat_FromDouble(value.asDouble());
-        } else if (value.isString()) {
-            pyValue = PyUnicode_FromString(value.asString().c_str());
-        } else if (value.isBoolean()) {
-            pyValue = PyBool_FromLong(value.asBoolean() ? 1 : 0);
-        }
-        
+        PyObject* pyValue = toPython(value, true);
         PyDict_SetItemString(mainDict, name.c_str(), pyValue);
-        if (pyValue != Py_None) Py_DECREF(pyValue);
+        Py_DECREF(pyValue);
     }
 
     bool PythonFFIImpl::isAvailable() const {
@@ -262,6 +495,7 @@ namespace ffi {
             initialize();
         }
 
+        GilGuard gil(GilGuard::Blocking);
         PyObject* mainModule = PyImport_AddModule("__main__");
         PyObject* mainDict = PyModule_GetDict(mainModule);
         
@@ -287,9 +521,7 @@ namespace ffi {
             return false;
         }
 
-        PyObject* mainModule = PyImport_AddModule("__main__");
-        PyObject* mainDict = PyModule_GetDict(mainModule);
-        
+        GilGuard gil(GilGuard::Blocking);
         PyRun_SimpleFile(fp, filename.c_str());
         fclose(fp);
         
@@ -316,6 +548,7 @@ namespace ffi {
     }
 
     FFIValue PythonFFIImpl::createList(const std::vector<FFIValue>& items) {
+        GilGuard gil;
         PyObject* list = PyList_New(items.size());
         for (size_t i = 0; i < items.size(); ++i) {
             // Convert FFI values to Python objects
@@ -338,6 +571,7 @@ namespace ffi {
     }
 
     FFIValue PythonFFIImpl::createDict(const std::unordered_map<std::string, FFIValue>& items) {
+        GilGuard gil;
         PyObject* dict = PyDict_New();
         for (const auto& [key, value] : items) {
             // Convert FFI value to Python object
@@ -361,6 +595,7 @@ namespace ffi {
     }
 
     FFIValue PythonFFIImpl::createTuple(const std::vector<FFIValue>& items) {
+        GilGuard gil;
         PyObject* tuple = PyTuple_New(items.size());
         for (size_t i = 0; i < items.size(); ++i) {
             // Convert FFI values to Python objects
@@ -382,6 +617,202 @@ namespace ffi {
         return result;
     }
     
+    FFIValue PythonFFIImpl::shareArray(void* tocinArray, ArrayElement element) {
+        GilGuard gil;
+        PyTypeObject* type = arrayOwnerType();
+        if (!tocinArray || !type) {
+            return FFIValue();
+        }
+        ArrayOwner* owner = PyObject_New(ArrayOwner, type);
+        if (!owner) {
+            return FFIValue();
+        }
+        owner->array = static_cast<int64_t*>(tocinArray);
+        owner->pin = pinArray(tocinArray);
+        owner->element = element;
+        owner->shape[0] = static_cast<Py_ssize_t>(owner->array[0]);
+        owner->strides[0] = 8;
+
+        // The view holds the owner; the owner goes when the last view does.
+        PyObject* view = PyMemoryView_FromObject(reinterpret_cast<PyObject*>(owner));
+        Py_DECREF(owner);
+        if (!view) {
+            PyErr_Print();
+            return FFIValue();
+        }
+        return FFIValue(static_cast<void*>(view), "PyObject");
+    }
+
+    bool PythonFFIImpl::borrowBuffer(const FFIValue& object, ArrayElement element, BufferRef* out) {
+        GilGuard gil;
+        PyObject* pyObject = asPyObject(object);
+        if (!pyObject || !PyObject_CheckBuffer(pyObject)) {
+            return false;
+        }
+        auto* view = new Py_buffer;
+        if (PyObject_GetBuffer(pyObject, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+            PyErr_Clear();
+            delete view;
+            return false;
+        }
+        if (view->itemsize != 8 || !formatMatches(view->format, element)) {
+            PyBuffer_Release(view);
+            delete view;
+            return false;
+        }
+        out->data = view->buf;
+        out->length = static_cast<int64_t>(view->len / 8);
+        out->readonly = view->readonly != 0;
+        out->view = view;
+        return true;
+    }
+
+    void PythonFFIImpl::releaseBuffer(BufferRef* ref) {
+        if (auto* view = static_cast<Py_buffer*>(ref->view)) {
+            GilGuard gil;
+            PyBuffer_Release(view);
+            delete view;
+        }
+        *ref = BufferRef();
+    }
+
+    void* PythonFFIImpl::toTocinArray(const FFIValue& object, ArrayElement element) {
+        GilGuard gil;
+        PyObject* pyObject = asPyObject(object);
+        if (!pyObject) {
+            return nullptr;
+        }
+        if (ArrayOwner* owner = sharedOwner(pyObject, element)) {
+            return owner->array;
+        }
+        BufferRef ref;
+        if (!borrowBuffer(object, element, &ref)) {
+            return nullptr;
+        }
+        auto* array = static_cast<int64_t*>(allocArray(8 * (static_cast<size_t>(ref.length) + 1)));
+        if (array) {
+            array[0] = ref.length;
+            std::memcpy(array + 1, ref.data, 8 * static_cast<size_t>(ref.length));
+        }
+        releaseBuffer(&ref);
+        return array;
+    }
+
+    void PythonFFIImpl::releaseObject(const FFIValue& object) {
+        GilGuard gil;
+        Py_XDECREF(asPyObject(object));
+    }
+
+    bool PythonFFIImpl::startInterpreterPool(size_t count) {
+#if PY_VERSION_HEX >= 0x030C0000
+        if (pool_ || count == 0 || !initialize()) {
+            return false;
+        }
+        auto pool = std::make_unique<InterpreterPool>();
+        {
+            GilGuard gil;
+            PyThreadState* main = PyThreadState_Get();
+            for (size_t i = 0; i < count; ++i) {
+                PyInterpreterConfig config = {};
+                config.use_main_obmalloc = 0;
+                config.allow_fork = 0;
+                config.allow_exec = 0;
+                config.allow_threads = 1;
+                config.allow_daemon_threads = 0;
+                config.check_multi_interp_extensions = 1;
+                config.gil = PyInterpreterConfig_OWN_GIL;
+                // Leaves the new interpreter's thread state current, holding
+                // its GIL; drop that and return to the main interpreter.
+                PyThreadState* ts = nullptr;
+                PyStatus status = Py_NewInterpreterFromConfig(&ts, &config);
+                if (PyStatus_Exception(status) || !ts) {
+                    PyEval_RestoreThread(main);
+                    break;
+                }
+                pool->interpreters.push_back(PyThreadState_GetInterpreter(ts));
+                pool->idle.push_back(i);
+                PyThreadState_Clear(ts);
+                PyThreadState_DeleteCurrent();
+                PyEval_RestoreThread(main);
+            }
+        }
+        if (pool->interpreters.size() != count) {
+            pool_ = std::move(pool);
+            stopInterpreterPool();
+            return false;
+        }
+        pool_ = std::move(pool);
+        return true;
+#else
+        (void)count;
+        return false;
+#endif
+    }
+
+    void PythonFFIImpl::stopInterpreterPool() {
+        if (!pool_) {
+            return;
+        }
+        // Wait until every interpreter is back, then end each one.
+        for (size_t n = pool_->interpreters.size(); n > 0; --n) {
+            pool_->take();
+        }
+        for (PyInterpreterState* interp : pool_->interpreters) {
+            PyThreadState* ts = PyThreadState_New(interp);
+            PyEval_RestoreThread(ts);
+            Py_EndInterpreter(ts);
+        }
+        pool_.reset();
+    }
+
+    size_t PythonFFIImpl::interpreterPoolSize() const {
+        return pool_ ? pool_->interpreters.size() : 0;
+    }
+
+    bool PythonFFIImpl::executeInPool(const std::string& code) {
+        if (!pool_) {
+            return false;
+        }
+        bool ok = true;
+        std::vector<size_t> taken;
+        for (size_t n = pool_->interpreters.size(); n > 0; --n) {
+            taken.push_back(pool_->take());
+        }
+        GilGuard::enterBlocking();
+        for (size_t i : taken) {
+            pool_->run(i, [&] {
+                PyObject* globals = PyModule_GetDict(PyImport_AddModule("__main__"));
+                PyObject* result = PyRun_String(code.c_str(), Py_file_input, globals, globals);
+                if (!result) {
+                    PyErr_Print();
+                    ok = false;
+                }
+                Py_XDECREF(result);
+            });
+        }
+        GilGuard::exitBlocking();
+        for (size_t i : taken) {
+            pool_->give(i);
+        }
+        return ok;
+    }
+
+    FFIValue PythonFFIImpl::callInPool(const std::string& functionName, const std::vector<FFIValue>& args) {
+        if (!pool_) {
+            return FFIValue();
+        }
+        size_t i = pool_->take();
+        FFIValue result;
+        GilGuard::enterBlocking();
+        pool_->run(i, [&] {
+            PyObject* globals = PyModule_GetDict(PyImport_AddModule("__main__"));
+            result = callIn(globals, functionName, args, false);
+        });
+        GilGuard::exitBlocking();
+        pool_->give(i);
+        return result;
+    }
+
     bool PythonFFIImpl::isPythonObject(const FFIValue& value) const {
         // Check if the FFIValue represents a Python object
         return value.getType() == FFIValue::OBJECT;
@@ -407,7 +838,7 @@ namespace ffi {
         return value;
     }
 
-    FFIValue PythonFFIImpl::pythonToFFIValue(void* pyObj) {
+    FFIValue PythonFFIImpl::pythonToFFIValue(void* pyObj, bool objects) {
         PyObject* pyObject = static_cast<PyObject*>(pyObj);
         if (!pyObject || pyObject == Py_None) {
             return FFIValue();
@@ -441,7 +872,7 @@ namespace ffi {
             Py_ssize_t size = PyList_Size(pyObject);
             std::vector<FFIValue> list;
             for (Py_ssize_t i = 0; i < size; ++i) {
-                list.push_back(pythonToFFIValue(static_cast<void*>(PyList_GetItem(pyObject, i))));
+                list.push_back(pythonToFFIValue(static_cast<void*>(PyList_GetItem(pyObject, i)), objects));
             }
             return FFIValue(list);
         }
@@ -455,12 +886,19 @@ namespace ffi {
             while (PyDict_Next(pyObject, &pos, &key, &value)) {
                 if (PyUnicode_Check(key)) {
                     std::string keyStr = PyUnicode_AsUTF8(key);
-                    map[keyStr] = pythonToFFIValue(static_cast<void*>(value));
+                    map[keyStr] = pythonToFFIValue(static_cast<void*>(value), objects);
                 }
             }
             return FFIValue(map);
         }
 
+        // Buffers (memoryview, bytes, NumPy arrays) stay Python objects so
+        // their data can be taken by reference; see toTocinArray.
+        if (objects && PyObject_CheckBuffer(pyObject)) {
+            Py_INCREF(pyObject);
+            return FFIValue(static_cast<void*>(pyObject), "PyObject");
+        }
+
         // Default: return as opaque object
         return FFIValue();
     }
@@ -62,6 +62,58 @@ public:
     FFIValue createDict(const std::unordered_map<std::string, FFIValue>& items);
     FFIValue createTuple(const std::vector<FFIValue>& items);
 
+    // Buffer sharing. Tocin numeric arrays ([i64 len][elems]) and Python
+    // objects with the buffer protocol (memoryview, bytes, array.array,
+    // NumPy arrays, torch tensors via .numpy()) exchanged without per-element
+    // conversion. Python objects travel as pointer FFIValues of type
+    // "PyObject", each holding one reference; callFunction passes them
+    // through as the objects themselves.
+    enum class ArrayElement { Int64, Float64 };
+
+    // A writable memoryview over the elements of a Tocin array, sharing its
+    // memory. The array is pinned (see __tocin_gc_pin) until the last view
+    // derived from it is released on the Python side.
+    FFIValue shareArray(void* tocinArray, ArrayElement element);
+
+    // A contiguous buffer of element-typed data held by reference: data
+    // stays valid and the exporter cannot resize it until releaseBuffer.
+    struct BufferRef {
+        const void* data = nullptr;
+        int64_t length = 0;         // elements
+        bool readonly = true;
+        void* view = nullptr;       // the Py_buffer
+    };
+    bool borrowBuffer(const FFIValue& object, ArrayElement element, BufferRef* out);
+    void releaseBuffer(BufferRef* ref);
+
+    // The elements of a buffer as a Tocin array: the original array when
+    // the object is a whole view made by shareArray, otherwise a fresh one
+    // filled with a single copy. nullptr if the object has no matching
+    // contiguous buffer.
+    void* toTocinArray(const FFIValue& object, ArrayElement element);
+
+    // Drop the reference a "PyObject" value holds.
+    void releaseObject(const FFIValue& object);
+
+    // Threads. Every entry into Python holds the GIL for just that call (it
+    // is released again as soon as initialize() has started Python), so any
+    // thread or goroutine may call in, and Tocin code never waits behind a
+    // running Python call. Calls that run Python code also tell the
+    // goroutine scheduler they are blocking, so other goroutines keep
+    // running on a spare worker.
+    //
+    // The shared GIL still serializes Python itself. For CPU-bound Python,
+    // startInterpreterPool(n) (Python 3.12+) creates n subinterpreters, each
+    // with its own GIL; callInPool runs a function in a free one, so up to n
+    // calls run in parallel. The interpreters are isolated: executeInPool
+    // defines what they can call, and only plain values (numbers, strings,
+    // booleans, lists, dicts) cross in either direction.
+    bool startInterpreterPool(size_t count);  // false if unsupported or failed
+    void stopInterpreterPool();
+    size_t interpreterPoolSize() const;
+    bool executeInPool(const std::string& code);  // in every interpreter
+    FFIValue callInPool(const std::string& functionName, const std::vector<FFIValue>& args);
+
     // Python-specific type checking
     bool isPythonObject(const FFIValue& value) const;
     std::string getPythonTypeName(const FFIValue& value) const;
@@ -72,8 +124,17 @@ private:
     
     // Conversion helpers
     FFIValue ffiValueToPython(const FFIValue& value);
-    FFIValue pythonToFFIValue(void* pyObj);  // PyObject* as void* to avoid Python.h include
+    // PyObject* as void* to avoid Python.h include. Buffer objects become
+    // "PyObject" values only with objects set; otherwise they have no value.
+    FFIValue pythonToFFIValue(void* pyObj, bool objects = true);
+    // Call globals[functionName] (a dict) with the GIL held; objects as for
+    // pythonToFFIValue, and for passing "PyObject" arguments through.
+    FFIValue callIn(void* globals, const std::string& functionName,
+                    const std::vector<FFIValue>& args, bool objects);
     FFIValue pythonValueToFFI(const FFIValue& value);
+
+    struct InterpreterPool;  // subinterpreters, see startInterpreterPool
+    std::unique_ptr<InterpreterPool> pool_;
 };
 
 /**
@@ -1,13 +1,22 @@
 #include "lexer.h"
 #include <cctype>
 #include <stdexcept>
-#include <unordered_map>
 #include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <vector>
 
 namespace lexer
 {
 
-    static const std::unordered_map<std::string, TokenType> keywords = {
+        struct Keyword
+    {
+        std::string_view text;
+        TokenType type;
+    };
+
+    static constexpr Keyword keywords[] = {
         {"let", TokenType::LET}, {"def", TokenType::DEF}, {"async", TokenType::ASYNC}, 
         {"await", TokenType::AWAIT}, {"class", TokenType::CLASS}, {"if", TokenType::IF}, 
         {"elif", TokenType::ELIF}, {"else", TokenType::ELSE}, {"while", TokenType::WHILE}, 
@@ -42,13 +51,86 @@ namespace lexer
         // ordinary identifiers now (no parser/codegen ever consumed the tokens).
     };
 
-    Lexer::Lexer(const std::string &source, const std::string &filename, int indentSize)
-        : source(source), filename(filename), start(0), current(0), line(1), column(1),
-          indentLevel(0), atLineStart(true), indentSize(indentSize), braceDepth(0), errorCount(0), maxErrors(100) {}
+    // A perfect hash of the keywords: their first two and last two bytes
+    // and their length, packed into a word and multiplied, give each one a
+    // slot of its own in a 256-entry table (checked below at compile time).
+    // A lookup is one multiply and one compare.
+    static constexpr size_t kMaxKeywordLength = 10;
+    static constexpr uint64_t kKeywordMultiplier = 0xf0f94a578f102defull;
+
+    static constexpr unsigned keywordSlot(std::string_view s)
+    {
+        uint64_t packed = uint64_t(uint8_t(s[0])) | uint64_t(uint8_t(s[1])) << 8 |
+                          uint64_t(uint8_t(s[s.size() - 2])) << 16 | uint64_t(uint8_t(s[s.size() - 1])) << 24 |
+                          uint64_t(s.size()) << 32;
+        return unsigned((packed * kKeywordMultiplier) >> 56);
+    }
+
+    struct KeywordTable
+    {
+        uint8_t slots[256] = {}; // 1 + index into keywords, 0 if empty
+        bool perfect = true;
+    };
+
+    static constexpr KeywordTable makeKeywordTable()
+    {
+        KeywordTable table;
+        for (size_t i = 0; i < std::size(keywords); ++i)
+        {
+            const Keyword &k = keywords[i];
+            unsigned slot = keywordSlot(k.text);
+            if (k.text.size() < 2 || k.text.size() > kMaxKeywordLength || table.slots[slot])
+                table.perfect = false;
+            table.slots[slot] = uint8_t(i + 1);
+        }
+        return table;
+    }
+
+    static constexpr KeywordTable keywordTable = makeKeywordTable();
+    static_assert(keywordTable.perfect, "keyword hash has a collision: pick another kKeywordMultiplier");
+    static_assert(std::size(keywords) < 256, "keyword table is full");
+
+    // The keyword spelled text, or nullptr.
+    static const Keyword *findKeyword(std::string_view text)
+    {
+        if (text.size() < 2 || text.size() > kMaxKeywordLength)
+            return nullptr;
+        unsigned index = keywordTable.slots[keywordSlot(text)];
+        if (!index || keywords[index - 1].text != text)
+            return nullptr;
+        return &keywords[index - 1];
+    }
+
+    // The keywords' symbols, interned once.
+    static const Symbol &keywordSymbol(const Keyword *k)
+    {
+        static const std::vector<Symbol> symbols = [] {
+            std::vector<Symbol> all;
+            for (const Keyword &kw : keywords)
+                all.push_back(SymbolTable::intern(kw.text));
+            return all;
+        }();
+        return symbols[k - keywords];
+    }
+
+    static const std::string &internFilename(const std::string &filename)
+    {
+        static std::mutex mutex;
+        static std::set<std::string> names; // node-based: references stay valid
+        std::lock_guard<std::mutex> lock(mutex);
+        return *names.insert(filename).first;
+    }
+
+    Lexer::Lexer(std::string_view source, const std::string &filename, int indentSize)
+        : source(source), filename(internFilename(filename)), head(0), finished(false), start(0), current(0),
+          line(1), column(1), indentLevel(0), atLineStart(true), indentSize(indentSize), braceDepth(0),
+          errorCount(0), maxErrors(100) {}
 
     std::vector<Token> Lexer::tokenize()
     {
         tokens.clear();
+        head = 0;
+        finished = false;
         start = 0;
         current = 0;
         line = 1;
@@ -58,7 +140,33 @@ namespace lexer
         braceDepth = 0;
         errorCount = 0;
 
-        while (!isAtEnd() && errorCount < maxErrors)
+        std::vector<Token> all;
+        all.reserve(source.size() / 5 + 16); // about one token per five bytes of typical source
+        do
+        {
+            all.push_back(next());
+        } while (all.back().type != TokenType::EOF_TOKEN);
+        return all;
+    }
+
+    Token Lexer::next()
+    {
+        // `tokens` holds what the last scan produced (a lexeme, or the
+        // INDENT/DEDENT run of a new line) until the caller has taken it.
+        while (head == tokens.size())
+        {
+            tokens.clear();
+            head = 0;
+            if (finished)
+                return Token(TokenType::EOF_TOKEN, "", filename, line, column);
+            scanNext();
+        }
+        return tokens[head++];
+    }
+
+    void Lexer::scanNext()
+    {
+        if (!isAtEnd() && errorCount < maxErrors)
         {
             start = current;
             try
@@ -70,6 +178,7 @@ namespace lexer
                 reportError(error::ErrorCode::L001_INVALID_CHARACTER, e.what());
                 advance(); // Skip the problematic character
             }
+            return;
         }
 
         // Add any remaining dedents
@@ -80,7 +189,7 @@ namespace lexer
         }
 
         tokens.push_back(Token(TokenType::EOF_TOKEN, "", filename, line, column));
-        return tokens;
+        finished = true;
     }
 
     bool Lexer::isAtEnd() const
@@ -348,6 +457,9 @@ namespace lexer
     {
         char quote = source[current - 1]; // Get the opening quote (already consumed)
         bool escaped = false;
+        // Read in place; only a literal with escapes is decoded into value.
+        size_t contentStart = current;
+        bool decoded = false;
         std::string value;
         int startLine = line;
         int startColumn = column - 1; // Adjust for the quote character
@@ -459,15 +571,22 @@ namespace lexer
             }
             else if (c == '\\')
             {
+                if (!decoded)
+                {
+                    value.assign(source.substr(contentStart, current - contentStart));
+                    decoded = true;
+                }
                 escaped = true;
             }
             else if (c == quote)
             {
                 advance(); // consume closing quote
-                tokens.emplace_back(TokenType::STRING, value, filename, startLine, startColumn);
+                std::string_view text = decoded ? std::string_view(value)
+                                                : source.substr(contentStart, current - 1 - contentStart);
+                tokens.emplace_back(TokenType::STRING, text, filename, startLine, startColumn);
                 return;
             }
-            else
+            else if (decoded)
             {
                 value += c;
             }
@@ -483,43 +602,43 @@ namespace lexer
 
     void Lexer::scanNumber()
     {
-        std::string value;
+        size_t begin = current;
         bool isFloat = false;
         bool isHex = false;
         bool isBinary = false;
         bool isOctal = false;
         
         // Start with the current character (which was peeked at)
-        value += advance();
+        advance();
         
         // Check for hex, binary, or octal prefixes
-        if (value == "0" && !isAtEnd()) {
+        if (source[begin] == '0' && !isAtEnd()) {
             char next = peek();
             if (next == 'x' || next == 'X') {
                 isHex = true;
-                value += advance();
+                advance();
                 if (!std::isxdigit(peek())) {
                     reportError(error::ErrorCode::L003_INVALID_NUMBER_FORMAT,
                                "Invalid hexadecimal number");
-                    tokens.emplace_back(TokenType::ERROR, value, filename, line, column - value.length());
+                    tokens.emplace_back(TokenType::ERROR, source.substr(begin, current - begin), filename, line, column - int(current - begin));
                     return;
                 }
             } else if (next == 'b' || next == 'B') {
                 isBinary = true;
-                value += advance();
+                advance();
                 if (peek() != '0' && peek() != '1') {
                     reportError(error::ErrorCode::L003_INVALID_NUMBER_FORMAT,
                                "Invalid binary number");
-                    tokens.emplace_back(TokenType::ERROR, value, filename, line, column - value.length());
+                    tokens.emplace_back(TokenType::ERROR, source.substr(begin, current - begin), filename, line, column - int(current - begin));
                     return;
                 }
             } else if (next == 'o' || next == 'O') {
                 isOctal = true;
-                value += advance();
+                advance();
                 if (!(peek() >= '0' && peek() <= '7')) {
                     reportError(error::ErrorCode::L003_INVALID_NUMBER_FORMAT,
                                "Invalid octal number");
-                    tokens.emplace_back(TokenType::ERROR, value, filename, line, column - value.length());
+                    tokens.emplace_back(TokenType::ERROR, source.substr(begin, current - begin), filename, line, column - int(current - begin));
                     return;
                 }
             } else if (std::isdigit(next) && next != '0') {
@@ -530,19 +649,19 @@ namespace lexer
         // Scan digits ('_' allowed as a visual separator between digits).
         if (isHex) {
             while (std::isxdigit(peek()) || peek() == '_') {
-                value += advance();
+                advance();
             }
         } else if (isBinary) {
             while (peek() == '0' || peek() == '1' || peek() == '_') {
-                value += advance();
+                advance();
             }
         } else if (isOctal) {
             while ((std::isdigit(peek()) && peek() < '8') || peek() == '_') {
-                value += advance();
+                advance();
             }
         } else {
             while (std::isdigit(peek()) || peek() == '_') {
-                value += advance();
+                advance();
             }
         }
 
@@ -550,10 +669,10 @@ namespace lexer
         if (!isHex && !isBinary && !isOctal && peek() == '.' && std::isdigit(peekNext()))
         {
             isFloat = true;
-            value += advance();
+            advance();
             while (std::isdigit(peek()))
             {
-                value += advance();
+                advance();
             }
         }
 
@@ -561,18 +680,18 @@ namespace lexer
         if (!isHex && !isBinary && !isOctal && (peek() == 'e' || peek() == 'E'))
         {
             isFloat = true;
-            value += advance();
+            advance();
             if (peek() == '+' || peek() == '-') {
-                value += advance();
+                advance();
             }
             if (!std::isdigit(peek())) {
                 reportError(error::ErrorCode::L003_INVALID_NUMBER_FORMAT,
                            "Invalid exponent in number");
-                tokens.emplace_back(TokenType::ERROR, value, filename, line, column - value.length());
+                tokens.emplace_back(TokenType::ERROR, source.substr(begin, current - begin), filename, line, column - int(current - begin));
                 return;
             }
             while (std::isdigit(peek())) {
-                value += advance();
+                advance();
             }
         }
 
@@ -581,40 +700,38 @@ namespace lexer
             char suffix = peek();
             if (suffix == 'f' || suffix == 'F') {
                 isFloat = true;
-                value += advance();
+                advance();
             } else if (suffix == 'l' || suffix == 'L') {
-                value += advance();
+                advance();
             } else if (suffix == 'u' || suffix == 'U') {
-                value += advance();
+                advance();
             }
         }
 
         if (isFloat) {
-            tokens.emplace_back(TokenType::FLOAT64, value, filename, line, column - value.length());
+            tokens.emplace_back(TokenType::FLOAT64, source.substr(begin, current - begin), filename, line, column - int(current - begin));
         } else {
-            tokens.emplace_back(TokenType::INT, value, filename, line, column - value.length());
+            tokens.emplace_back(TokenType::INT, source.substr(begin, current - begin), filename, line, column - int(current - begin));
         }
     }
 
     void Lexer::scanIdentifier()
     {
-        std::string value;
-        // Start with the current character (which was peeked at)
-        value += advance();
-        // Continue scanning the rest of the identifier
+        size_t begin = current;
+        advance();
         while (std::isalnum(peek()) || peek() == '_')
         {
-            value += advance();
+            advance();
         }
-        
-        // Check for keywords
-        TokenType type = TokenType::IDENTIFIER;
-        auto it = keywords.find(value);
-        if (it != keywords.end()) {
-            type = it->second;
+        std::string_view text = source.substr(begin, current - begin);
+        int startColumn = column - int(text.size());
+
+        if (const Keyword *k = findKeyword(text))
+        {
+            tokens.emplace_back(k->type, keywordSymbol(k), filename, line, startColumn);
+            return;
         }
-        
-        tokens.emplace_back(type, value, filename, line, column - value.length());
+        tokens.emplace_back(TokenType::IDENTIFIER, SymbolTable::intern(text), filename, line, startColumn);
     }
 
     void Lexer::scanToken()
@@ -1056,7 +1173,7 @@ namespace lexer
         }
     }
 
-    Token Lexer::makeToken(TokenType type, const std::string &value)
+    Token Lexer::makeToken(TokenType type, std::string_view value)
     {
         return Token(type, value.empty() ? source.substr(start, current - start) : value,
                      filename, line, column - (value.empty() ? (current - start) : value.length()));
@@ -2,8 +2,10 @@
 #define LEXER_H
 
 #include "token.h"
+#include "token_source.h"
 #include "../error/error_handler.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 
@@ -11,16 +13,25 @@ namespace lexer {
 
     /**
      * @brief Lexer class for tokenizing Tocin source code.
+     *
+     * Either all at once with tokenize(), or on demand as a TokenSource:
+     * each next() scans only as far as the token it returns.
      */
-    class Lexer {
+    class Lexer : public TokenSource {
     public:
         /**
          * @brief Constructs a lexer.
-         * @param source The source code to tokenize.
+         * @param source The source code to tokenize. It is read in place and
+         *        must outlive tokenize() or the last next(), but not the
+         *        tokens: their values are interned (see SymbolTable).
          * @param filename The source file name.
          * @param indentSize The number of spaces per indentation level (default 4).
          */
-        Lexer(const std::string& source, const std::string& filename, int indentSize = 4);
+        Lexer(std::string_view source, const std::string& filename, int indentSize = 4);
+        Lexer(const char* source, const std::string& filename, int indentSize = 4)
+            : Lexer(std::string_view(source), filename, indentSize) {}
+        // The source is not copied, so a temporary would be gone before tokenize().
+        Lexer(std::string&& source, const std::string& filename, int indentSize = 4) = delete;
 
         /**
          * @brief Tokenizes the source code.
@@ -28,6 +39,13 @@ namespace lexer {
          */
         std::vector<Token> tokenize();
 
+        /**
+         * @brief The next token, scanning more of the source if needed.
+         * Ends with EOF_TOKEN, which repeats. Use either this or tokenize()
+         * on one lexer, not both.
+         */
+        Token next() override;
+
     private:
         bool isAtEnd() const;
         char advance();
@@ -36,17 +54,22 @@ namespace lexer {
         bool match(char expected);
         void skipWhitespace();
         void handleIndentation();
+        void scanNext();
         void scanToken();
         void scanString();
         void scanNumber();
         void scanIdentifier();
         void scanTemplateLiteral();
         void reportError(error::ErrorCode code, const std::string& message);
-        Token makeToken(TokenType type, const std::string& value = "");
+        Token makeToken(TokenType type, std::string_view value = {});
 
-        std::string source;
-        std::string filename;
-        std::vector<Token> tokens;
+        std::string_view source;
+        // Interned for the life of the process: tokens (and so the AST) keep a
+        // string_view of it after the lexer is gone, e.g. for imported modules.
+        const std::string &filename;
+        std::vector<Token> tokens; // scanned but not yet returned by next()
+        size_t head;
+        bool finished;             // EOF_TOKEN has been queued
         size_t start;
         size_t current;
         int line;
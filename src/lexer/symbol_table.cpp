@@ -0,0 +1,164 @@
+#include "symbol_table.h"
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace lexer
+{
+
+    namespace
+    {
+        constexpr uint32_t kPageBits = 12;
+        constexpr uint32_t kPageSize = 1u << kPageBits;
+        constexpr uint32_t kMaxPages = 1u << 16;
+        constexpr size_t kBlockSize = 64 * 1024;
+        constexpr uint32_t kCacheSize = 256;
+
+        // Texts live in append-only blocks and their views in fixed pages, so
+        // neither ever moves: text() reads a page without the lock, and the
+        // views handed out stay valid for the life of the process.
+        struct Table
+        {
+            std::mutex mutex;
+            std::atomic<std::string_view *> pages[kMaxPages] = {};
+            std::atomic<uint32_t> count{0};
+            std::vector<uint32_t> slots = std::vector<uint32_t>(1024, 0); // open addressing on the hash, 0 = empty
+            std::vector<uint64_t> hashes = std::vector<uint64_t>(1, 0);   // by id
+            std::vector<std::unique_ptr<char[]>> blocks;
+            char *free = nullptr;
+            size_t left = 0;
+        };
+
+        // Never destroyed: tokens in static objects may outlive main().
+        Table &table()
+        {
+            static Table *t = new Table;
+            return *t;
+        }
+
+        uint64_t hashText(std::string_view text)
+        {
+            uint64_t h = 0xcbf29ce484222325ull;
+            for (unsigned char c : text)
+            {
+                h ^= c;
+                h *= 0x100000001b3ull;
+            }
+            return h;
+        }
+
+        std::string_view store(Table &t, std::string_view text)
+        {
+            char *p;
+            if (text.size() > kBlockSize / 4)
+            {
+                // Long literals get a block of their own.
+                t.blocks.push_back(std::make_unique<char[]>(text.size()));
+                p = t.blocks.back().get();
+            }
+            else
+            {
+                if (text.size() > t.left)
+                {
+                    t.blocks.push_back(std::make_unique<char[]>(kBlockSize));
+                    t.free = t.blocks.back().get();
+                    t.left = kBlockSize;
+                }
+                p = t.free;
+                t.free += text.size();
+                t.left -= text.size();
+            }
+            std::memcpy(p, text.data(), text.size());
+            return std::string_view(p, text.size());
+        }
+
+        void grow(Table &t)
+        {
+            std::vector<uint32_t> slots(t.slots.size() * 2, 0);
+            size_t mask = slots.size() - 1;
+            for (uint32_t id : t.slots)
+            {
+                if (!id)
+                    continue;
+                size_t i = t.hashes[id] & mask;
+                while (slots[i])
+                    i = (i + 1) & mask;
+                slots[i] = id;
+            }
+            t.slots.swap(slots);
+        }
+    } // namespace
+
+    Symbol SymbolTable::intern(std::string_view text)
+    {
+        if (text.empty())
+            return Symbol{};
+        uint64_t h = hashText(text);
+
+        struct Recent
+        {
+            uint64_t hash;
+            uint32_t id;
+        };
+        thread_local Recent recent[kCacheSize] = {};
+        Recent &r = recent[h & (kCacheSize - 1)];
+        if (r.id && r.hash == h)
+        {
+            std::string_view seen = SymbolTable::text(r.id);
+            if (seen == text)
+                return Symbol{seen, r.id};
+        }
+
+        Table &t = table();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        size_t mask = t.slots.size() - 1;
+        size_t i = h & mask;
+        for (; t.slots[i]; i = (i + 1) & mask)
+        {
+            uint32_t id = t.slots[i];
+            if (t.hashes[id] != h)
+                continue;
+            std::string_view seen = SymbolTable::text(id);
+            if (seen == text)
+            {
+                r = Recent{h, id};
+                return Symbol{seen, id};
+            }
+        }
+
+        uint32_t id = t.count.load(std::memory_order_relaxed) + 1;
+        if ((id >> kPageBits) >= kMaxPages)
+            throw std::runtime_error("too many distinct tokens");
+        std::string_view *page = t.pages[id >> kPageBits].load(std::memory_order_relaxed);
+        if (!page)
+        {
+            page = new std::string_view[kPageSize];
+            t.pages[id >> kPageBits].store(page, std::memory_order_release);
+        }
+        std::string_view copy = store(t, text);
+        page[id & (kPageSize - 1)] = copy;
+        t.hashes.push_back(h);
+        t.slots[i] = id;
+        t.count.store(id, std::memory_order_release);
+        if (size_t(id) * 2 > t.slots.size())
+            grow(t);
+        r = Recent{h, id};
+        return Symbol{copy, id};
+    }
+
+    std::string_view SymbolTable::text(uint32_t id)
+    {
+        if (!id)
+            return std::string_view();
+        return table().pages[id >> kPageBits].load(std::memory_order_acquire)[id & (kPageSize - 1)];
+    }
+
+    uint32_t SymbolTable::size()
+    {
+        return table().count.load(std::memory_order_acquire);
+    }
+
+} // namespace lexer
@@ -0,0 +1,51 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace lexer
+{
+
+    /**
+     * @brief An interned string: its text and its id in the SymbolTable.
+     *
+     * Two symbols have the same id exactly when their text is equal, so the
+     * id can stand for the text in comparisons and as a map key.
+     */
+    struct Symbol
+    {
+        std::string_view text;
+        uint32_t id = 0;
+    };
+
+    /**
+     * @brief The process-wide table of token texts.
+     *
+     * Every token's value is interned here: identifiers and keywords, and
+     * the literals and operators alongside them. The text is copied once, on
+     * first sight, into storage that is never moved or freed, so a Token
+     * (and the AST that keeps it) holds a plain string_view that stays valid
+     * after the lexer and its source are gone - imported modules cached
+     * across compilations and REPL inputs rely on that. Ids are dense and
+     * start at 1; 0 is the empty string.
+     *
+     * Interning is thread-safe. A per-thread cache of recent lookups answers
+     * the common case (a name the thread has just seen) without taking the
+     * table's lock, and text() never locks.
+     */
+    class SymbolTable
+    {
+    public:
+        static Symbol intern(std::string_view text);
+
+        // The text of an id returned by intern().
+        static std::string_view text(uint32_t id);
+
+        // Distinct non-empty strings interned so far.
+        static uint32_t size();
+    };
+
+} // namespace lexer
+
+#endif // SYMBOL_TABLE_H
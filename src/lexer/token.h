@@ -1,8 +1,10 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include "symbol_table.h"
 
 /**
  * @brief Namespace for lexer-related functionality.
@@ -208,18 +210,25 @@ namespace lexer
          * Creates an "unknown" token at position 0:0.
          */
         Token()
-            : type(TokenType::ERROR), value(""), filename(""), line(0), column(0) {}
+            : type(TokenType::ERROR), symbol(0), filename(""), line(0), column(0) {}
 
         /**
-         * @brief Constructs a token.
+         * @brief Constructs a token, interning its value.
          * @param type The type of the token.
-         * @param value The lexeme or value of the token.
+         * @param value The lexeme or value of the token; copied into the
+         *        SymbolTable if it is not there yet, so it may be a temporary.
          * @param filename The source file name (interned).
          * @param line The line number.
          * @param column The column number.
          */
-        Token(TokenType type, std::string value, std::string_view filename, int line, int column)
-            : type(type), value(std::move(value)), filename(filename), line(line), column(column) {}
+        Token(TokenType type, std::string_view value, std::string_view filename, int line, int column)
+            : Token(type, SymbolTable::intern(value), filename, line, column) {}
+
+        /**
+         * @brief Constructs a token from an already interned value.
+         */
+        Token(TokenType type, Symbol value, std::string_view filename, int line, int column)
+            : type(type), value(value.text), symbol(value.id), filename(filename), line(line), column(column) {}
 
         /**
          * @brief Converts the token to a string for debugging.
@@ -228,7 +237,10 @@ namespace lexer
         std::string toString() const;
 
         TokenType type;
-        std::string value;
+        // Interned (see SymbolTable): it outlives the source it was read
+        // from, and tokens with equal text have equal symbols.
+        std::string_view value;
+        uint32_t symbol;
         std::string_view filename;
         int line;
         int column;
@@ -240,7 +252,7 @@ namespace lexer
      * Handles decimal, 0x hex, 0o/0 octal, 0b binary, digit separators ('_'),
      * and trailing type suffixes (u/U/l/L). Returns 0 on malformed input.
      */
-    inline long long parseIntegerLiteral(const std::string &lexeme)
+    inline long long parseIntegerLiteral(std::string_view lexeme)
     {
         std::string t;
         t.reserve(lexeme.size());
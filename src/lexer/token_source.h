@@ -0,0 +1,51 @@
+#ifndef TOKEN_SOURCE_H
+#define TOKEN_SOURCE_H
+
+#include "token.h"
+#include <vector>
+
+namespace lexer
+{
+
+    /**
+     * @brief A stream of tokens, pulled one at a time.
+     *
+     * The parser reads through this interface and keeps only its lookahead,
+     * so a Lexer can hand it tokens as they are scanned, without the whole
+     * file's token vector ever existing. next() ends with an EOF_TOKEN and
+     * keeps returning one after that.
+     */
+    class TokenSource
+    {
+    public:
+        virtual ~TokenSource() = default;
+        virtual Token next() = 0;
+    };
+
+    /**
+     * @brief A TokenSource over an already materialized token vector (e.g.
+     * after macro expansion). The vector is not copied and must outlive the
+     * source.
+     */
+    class TokenVectorSource : public TokenSource
+    {
+    public:
+        explicit TokenVectorSource(const std::vector<Token> &tokens) : tokens(tokens), index(0) {}
+
+        Token next() override
+        {
+            if (index < tokens.size())
+                return tokens[index++];
+            if (!tokens.empty() && tokens.back().type == TokenType::EOF_TOKEN)
+                return tokens.back();
+            return Token(TokenType::EOF_TOKEN, "", "", 0, 0);
+        }
+
+    private:
+        const std::vector<Token> &tokens;
+        size_t index;
+    };
+
+} // namespace lexer
+
+#endif // TOKEN_SOURCE_H
@@ -20,29 +20,54 @@
 // Include our LLVM shim header instead of directly including Host.h
 // (the shim pulls in the real <llvm/TargetParser/Host.h> when available).
 #include "llvm_shim.h"
+#include <llvm/ADT/StringExtras.h>
 #include <llvm/ADT/StringMap.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/MC/TargetRegistry.h>
 #include <llvm/Transforms/InstCombine/InstCombine.h>
+#include <llvm/Transforms/IPO/ConstantMerge.h>
 #include <llvm/Transforms/Scalar.h>
 #include <llvm/Transforms/Scalar/GVN.h>
 #include <llvm/Analysis/LoopAnalysisManager.h>
 #include <llvm/Analysis/CGSCCPassManager.h>
 #include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/StandardInstrumentations.h>
 #include <llvm/Transforms/Scalar/LoopInterchange.h>
 #include <llvm/Transforms/Scalar/LoopPassManager.h>
 // JIT execution (ORCv2) and native object emission
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
 #include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
 #include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/ExecutionEngine/JITEventListener.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Support/CodeGen.h>
+#include <llvm/Support/TimeProfiler.h>
+// -j N partitioned code generation
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+#include <llvm/Transforms/Utils/ValueMapper.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
 #include <cstdlib>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <set>
 #include <sstream>
+#include <thread>
 
 // Platform APIs for locating this executable (used to find the bundled linker).
 #if defined(_WIN32)
@@ -57,23 +82,149 @@ GetModuleFileNameA(void *hModule, char *lpFilename, unsigned long nSize);
 #include <unistd.h>
 #endif
 
+// Profile-runtime hooks --pgo-gen code may call under the JIT (see runJIT).
+extern "C" void tocinProfileValueSite(uint64_t, void *, uint32_t) {}
+extern "C" void tocinProfileRegister(void *) {}
+extern "C" void tocinProfileRegisterNames(void *, uint64_t) {}
+
 // The Tocin runtime (channels/goroutines) lives in the static core library.
 // Declared here so the JIT can register their addresses; referencing them in
 // runJIT also forces the runtime objects to be linked into the compiler.
 extern "C" {
     void *__tocin_chan_new();
+    void *__tocin_chan_new_cap(int64_t);
     void __tocin_chan_send(void *, int64_t);
     int64_t __tocin_chan_recv(void *);
     void __tocin_go(void (*)(void *), void *);
     void __tocin_join_all();
+    void *__tocin_async(int64_t (*)(void *), void *);
+    void *__tocin_future_new();
+    void __tocin_future_resolve(void *, int64_t);
+    int64_t __tocin_future_await(void *);
+    void __tocin_future_release(void *);
     int8_t __tocin_chan_try_recv(void *, int64_t *);
     void __tocin_chan_park();
+    int64_t __tocin_chan_select(void **, int64_t, int64_t *, int8_t);
+    int64_t __tocin_chan_send_many(void *, const int64_t *);
+    int64_t __tocin_chan_recv_into(void *, int64_t *, int64_t);
+    int64_t __tocin_gemm_f64(const int64_t *, const int64_t *, int64_t *, int64_t, int64_t, int64_t, int64_t,
+                             int64_t, int64_t);
+    int64_t __tocin_gemm_f64_nt(const int64_t *, const int64_t *, int64_t *, int64_t, int64_t, int64_t, int64_t,
+                                int64_t, int64_t);
+    int64_t __tocin_gemv_f64(const int64_t *, const int64_t *, int64_t *, int64_t, int64_t, int64_t, int64_t);
+    int64_t __tocin_sort_ints(int64_t *);
+    int64_t __tocin_sort_floats(int64_t *);
+    int64_t __tocin_sort_strings(int64_t *);
+    int64_t __tocin_radix_sort_ints(int64_t *);
+    int64_t __tocin_stable_sort_ints(int64_t *);
+    int64_t __tocin_stable_sort_floats(int64_t *);
+    int64_t __tocin_parallel_sort_ints(int64_t *);
+    int64_t __tocin_parallel_sort_floats(int64_t *);
+    int64_t __tocin_select_ints(int64_t *, int64_t);
+    int64_t __tocin_select_floats(int64_t *, int64_t);
+    int64_t __tocin_tdigest_new(int64_t);
+    int64_t __tocin_tdigest_free(int64_t);
+    int64_t __tocin_tdigest_add(int64_t, double);
+    int64_t __tocin_tdigest_add_all(int64_t, int64_t *);
+    int64_t __tocin_tdigest_merge(int64_t, int64_t);
+    double __tocin_tdigest_quantile(int64_t, double);
+    double __tocin_tdigest_cdf(int64_t, double);
+    int64_t __tocin_tdigest_count(int64_t);
+    int64_t __tocin_sort_by_keys(int64_t *, int64_t *, int64_t);
+    int64_t __tocin_i64_sum(const int64_t *);
+    int64_t __tocin_i64_argmin(const int64_t *);
+    int64_t __tocin_i64_argmax(const int64_t *);
+    int64_t __tocin_i64_count_eq(const int64_t *, int64_t);
+    int64_t __tocin_i64_count_gt(const int64_t *, int64_t);
+    int64_t __tocin_i64_find_eq(const int64_t *, int64_t);
+    int64_t __tocin_i64_find_gt(const int64_t *, int64_t);
+    int64_t __tocin_i64_find_le(const int64_t *, int64_t);
+    int64_t __tocin_i64_lower_bound(const int64_t *, int64_t);
+    int64_t __tocin_fb_fill_rect(int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t);
+    int64_t __tocin_fb_blend_rect(int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t);
+    int64_t __tocin_fb_fill_circle(int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t);
+    int64_t __tocin_fb_blit(int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t);
+    int64_t __tocin_audio_graph_new(int64_t, double);
+    int64_t __tocin_audio_graph_free(int64_t);
+    int64_t __tocin_audio_graph_osc(int64_t, int64_t, double, double);
+    int64_t __tocin_audio_graph_mix(int64_t);
+    int64_t __tocin_audio_graph_lowpass(int64_t, int64_t, double);
+    int64_t __tocin_audio_graph_connect(int64_t, int64_t, int64_t, double);
+    int64_t __tocin_audio_graph_gain(int64_t, int64_t, double);
+    int64_t __tocin_audio_graph_clip(int64_t, int64_t, double);
+    int64_t __tocin_audio_graph_set_freq(int64_t, int64_t, double);
+    int64_t __tocin_audio_graph_process(int64_t, int64_t *);
+    int64_t __tocin_audio_graph_process_to_ring(int64_t, int64_t);
+    int64_t __tocin_audio_ring_new(int64_t, int64_t);
+    int64_t __tocin_audio_ring_free(int64_t);
+    int64_t __tocin_audio_ring_push(int64_t, int64_t *);
+    int64_t __tocin_audio_ring_pop(int64_t, int64_t *);
+    int64_t __tocin_audio_ring_size(int64_t);
+    int64_t __tocin_img_box_blur(int64_t, int64_t, int64_t, int64_t, int64_t);
+    int64_t __tocin_img_sobel(int64_t, int64_t, int64_t, int64_t);
+    int64_t __tocin_img_resize(int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t);
+    int64_t __tocin_tensor_new(const int64_t *);
+    int64_t __tocin_tensor_from_list(const int64_t *, const int64_t *);
+    int64_t __tocin_tensor_to_list(int64_t, int64_t *);
+    int64_t __tocin_tensor_free(int64_t);
+    int64_t __tocin_tensor_mark();
+    int64_t __tocin_tensor_release(int64_t);
+    int64_t __tocin_tensor_keep(int64_t);
+    int64_t __tocin_tensor_rank(int64_t);
+    int64_t __tocin_tensor_dim(int64_t, int64_t);
+    int64_t __tocin_tensor_numel(int64_t);
+    double __tocin_tensor_get(int64_t, int64_t);
+    int64_t __tocin_tensor_set(int64_t, int64_t, double);
+    int64_t __tocin_tensor_reshape(int64_t, const int64_t *);
+    int64_t __tocin_tensor_slice(int64_t, int64_t, int64_t, int64_t, int64_t);
+    int64_t __tocin_tensor_transpose(int64_t, int64_t, int64_t);
+    int64_t __tocin_tensor_contiguous(int64_t);
+    int64_t __tocin_tensor_binary(int64_t, int64_t, int64_t);
+    int64_t __tocin_tensor_unary(int64_t, int64_t);
+    int64_t __tocin_tensor_scalar(int64_t, int64_t, double);
+    int64_t __tocin_tensor_eval(int64_t);
+    int64_t __tocin_tensor_assign(int64_t, int64_t);
+    int64_t __tocin_tensor_fill(int64_t, double);
+    int64_t __tocin_tensor_matmul(int64_t, int64_t);
+    double __tocin_tensor_sum(int64_t);
+    int64_t __tocin_tensor_pool_stat(int64_t);
+    int64_t __tocin_tensor_matmul_q(int64_t, int64_t);
+    int64_t __tocin_quantize(const int64_t *, int64_t, int64_t, int64_t);
+    int64_t __tocin_qmat_vec(int64_t, const int64_t *, int64_t *, int64_t, int64_t);
+    int64_t __tocin_qmat_mul(int64_t, const int64_t *, int64_t *, int64_t, int64_t, int64_t);
+    int64_t __tocin_qmat_dequantize(int64_t, int64_t *);
+    int64_t __tocin_qmat_rows(int64_t);
+    int64_t __tocin_qmat_cols(int64_t);
+    int64_t __tocin_qmat_bytes(int64_t);
+    int64_t __tocin_qmat_free(int64_t);
+    int64_t __tocin_wg_new();
+    int64_t __tocin_wg_add(int64_t, int64_t);
+    int64_t __tocin_wg_done(int64_t);
+    int64_t __tocin_wg_wait(int64_t);
+    int64_t __tocin_mutex_new();
+    int64_t __tocin_mutex_lock(int64_t);
+    int64_t __tocin_mutex_try_lock(int64_t);
+    int64_t __tocin_mutex_unlock(int64_t);
+    int64_t __tocin_rwlock_new();
+    int64_t __tocin_rwlock_rlock(int64_t);
+    int64_t __tocin_rwlock_runlock(int64_t);
+    int64_t __tocin_rwlock_lock(int64_t);
+    int64_t __tocin_rwlock_unlock(int64_t);
+    int64_t __tocin_once_new();
+    int64_t __tocin_once_do(int64_t, void *);
+    int64_t __tocin_sync_free(int64_t);
+    void __tocin_parallel_for(int64_t, int64_t, void (*)(int64_t));
+    void __tocin_parallel_for_step(int64_t, int64_t, int64_t, void (*)(int64_t));
+    int64_t __tocin_parallel_reduce(int64_t, int64_t, int64_t, int64_t, void *);
+    double __tocin_parallel_reduce_f64(int64_t, int64_t, int64_t, double, void *);
     void __tocin_try_register(void *);
     void __tocin_try_pop();
     int64_t __tocin_exc_value();
     void __tocin_throw(int64_t);
+    int64_t __tocin_exc_catch(void *);
     // Dynamic collections
     void *__tocin_vec_new();
+    void *__tocin_vec_new_of(int64_t);
     void __tocin_vec_push(void *, int64_t);
     int64_t __tocin_vec_get(void *, int64_t);
     void __tocin_vec_set(void *, int64_t, int64_t);
@@ -89,53 +240,180 @@ extern "C" {
     int64_t __tocin_map_has_str(void *, const char *);
     int64_t __tocin_map_len(void *);
     void __tocin_map_free(void *);
+    int64_t __tocin_memo_get(int64_t *, const uint64_t *, int64_t, uint64_t *);
+    void __tocin_memo_put(int64_t *, const uint64_t *, int64_t, uint64_t);
+    int64_t __tocin_cpu_level();
+    void __tocin_map_reserve(void *, int64_t);
+    void __tocin_map_reserve_str(void *, int64_t);
+    int64_t __tocin_map_capacity(void *);
+    int64_t __tocin_map_capacity_str(void *);
     // Strings
     int64_t __tocin_str_len(const char *);
     int64_t __tocin_str_char_at(const char *, int64_t);
     char *__tocin_str_substring(const char *, int64_t, int64_t);
     int64_t __tocin_str_eq(const char *, const char *);
     int64_t __tocin_str_cmp(const char *, const char *);
+    char *__tocin_intern(const char *);
+    void __tocin_intern_literals(const char *const *, int64_t);
     int64_t __tocin_str_index_of_char(const char *, int64_t);
     char *__tocin_int_to_str(int64_t);
     int64_t __tocin_str_to_int(const char *);
     char *__tocin_char_to_str(int64_t);
     char *__tocin_str_concat(const char *, const char *);
+    char *__tocin_str_append(char *, const char *, int64_t);
+    char *__tocin_str_from_c(const char *);
+    void __tocin_str_free(char *);
+    void *__tocin_sb_new();
+    void __tocin_sb_append(void *, const char *);
+    void __tocin_sb_append_int(void *, int64_t);
+    void __tocin_sb_append_float(void *, double);
+    int64_t __tocin_sb_len(void *);
+    char *__tocin_sb_finish(void *);
     char *__tocin_str_to_upper(const char *);
     char *__tocin_str_to_lower(const char *);
     int64_t __tocin_str_index_of(const char *, const char *);
+    int64_t __tocin_str_index_of_from(const char *, const char *, int64_t);
     int64_t __tocin_str_contains(const char *, const char *);
     int64_t __tocin_str_starts_with(const char *, const char *);
     int64_t __tocin_str_ends_with(const char *, const char *);
     void __tocin_free(void *);
     void *__tocin_alloc(int64_t);
     void *__tocin_realloc(void *, int64_t);
+    void *__tocin_alloc_atomic(int64_t);
+    void *__tocin_alloc_tagged(int64_t, int32_t);
+    void *__tocin_alloc_atomic_tagged(int64_t, int32_t);
+    void *__tocin_alloc_pointer_free(int64_t, int32_t);
+    void *__tocin_alloc_typed(int64_t, int32_t, int64_t *);
+    // Arenas (withArena)
+    void *__tocin_arena_new();
+    void __tocin_arena_free(void *);
+    void __tocin_arena_reset(void *);
+    int64_t __tocin_arena_used(void *);
+    void __tocin_arena_enter(void *);
+    void __tocin_arena_exit();
     double __tocin_str_to_float(const char *);
     char *__tocin_float_to_str(double);
+    char *__tocin_floats_to_str(const void *, const char *);
+    void *__tocin_str_to_floats(const char *, int64_t);
     // File I/O
     char *__tocin_read_file(const char *);
     int64_t __tocin_write_file(const char *, const char *);
     int64_t __tocin_append_file(const char *, const char *);
+    int64_t __tocin_file_size(const char *);
+    int64_t __tocin_mmap_file(const char *);
+    int64_t __tocin_mmap_size(int64_t);
+    int64_t __tocin_munmap_file(int64_t);
+    int64_t __tocin_mmap_advise(int64_t, const char *);
     char *__tocin_read_line();
+    int64_t __tocin_file_open(const char *);
+    int64_t __tocin_file_close(int64_t);
+    int64_t __tocin_file_eof(int64_t);
+    char *__tocin_file_read_line(int64_t);
+    char *__tocin_file_read_record(int64_t, const char *);
+    int64_t __tocin_file_read_chunk(int64_t, char *, int64_t, int64_t);
+    // Standard output
+    void __tocin_print_begin();
+    void __tocin_print_end();
+    void __tocin_print_bytes(const char *, int64_t);
+    void __tocin_print_str(const char *);
+    void __tocin_print_int(int64_t);
+    void __tocin_print_float(double);
+    void __tocin_stdout_flush();
     // Time
     int64_t __tocin_time_sec();
     int64_t __tocin_time_ms();
     int64_t __tocin_mono_nanos();
     void __tocin_sleep_ms(int64_t);
+    void *__tocin_chan_after(int64_t);
     // Hashing
     int64_t __tocin_hash_bytes(const void *, int64_t);
     int64_t __tocin_hash_str(const char *);
+    int64_t __tocin_hash_fast(const void *, int64_t);
+    int64_t __tocin_hash_fast_str(const char *);
+    int64_t __tocin_hash_seeded(const void *, int64_t, int64_t);
+    int64_t __tocin_hash_str_seeded(const char *, int64_t);
+    int64_t __tocin_hash_combine(int64_t, int64_t);
     int64_t __tocin_hash_int(int64_t);
     // Random
     void __tocin_rand_seed(int64_t);
     int64_t __tocin_rand_next();
     int64_t __tocin_rand_range(int64_t, int64_t);
+    uint64_t *__tocin_rand_state();
+    int64_t __tocin_rand_fill(int64_t *, int64_t);
+    int64_t __tocin_rand_fill_float(int64_t *, int64_t, double, double);
     // TCP networking
     int64_t __tocin_tcp_listen(int64_t);
     int64_t __tocin_tcp_accept(int64_t);
     int64_t __tocin_tcp_connect(const char *, int64_t);
+    int64_t __tocin_tcp_dns_ttl(int64_t);
+    int64_t __tocin_tcp_pool_new(int64_t, int64_t);
+    int64_t __tocin_tcp_pool_get(int64_t, const char *, int64_t);
+    int64_t __tocin_tcp_pool_put(int64_t, int64_t, int64_t);
+    int64_t __tocin_tcp_pool_reap(int64_t);
+    int64_t __tocin_tcp_pool_stats(int64_t, int64_t *);
+    int64_t __tocin_tcp_pool_close(int64_t);
+    // Runtime metrics
+    int64_t __tocin_runtime_stats(int64_t *);
+    char *__tocin_runtime_metrics();
+    int64_t __tocin_runtime_metrics_serve(int64_t);
+    // Allocation profiler
+    int64_t __tocin_alloc_profile_write(const char *);
+    int64_t __tocin_alloc_counting(int64_t);
+    int64_t __tocin_alloc_counts(int64_t *);
+    int64_t __tocin_heap_snapshot(const char *);
+    int64_t __tocin_gc_configure(const char *, int64_t);
+    // Tracepoints (--debug)
+    void __tocin_tracepoints_register(void *const *, int64_t);
+    void __tocin_tracepoint(void *, const int64_t *);
+    int64_t __tocin_trace_probe(const char *);
+    int64_t __tocin_trace_remove(int64_t);
     int64_t __tocin_tcp_send(int64_t, const char *);
+    int64_t __tocin_tcp_send_buf(int64_t, const char *, int64_t, int64_t);
     char *__tocin_tcp_recv(int64_t);
+    int64_t __tocin_tcp_recv_into(int64_t, char *, int64_t, int64_t);
+    int64_t __tocin_tcp_send_file(int64_t, const char *, int64_t, int64_t);
     void __tocin_tcp_close(int64_t);
+    int64_t __tocin_http_parse(const char *, int64_t, int64_t, int64_t *);
+    char *__tocin_http_header(const int64_t *, const char *);
+    int64_t __tocin_http_conn_new(int64_t);
+    int64_t __tocin_http_client_conn_new(int64_t);
+    int64_t __tocin_http_conn_next(int64_t);
+    int64_t __tocin_http_conn_request(int64_t);
+    int64_t __tocin_http_conn_pending(int64_t);
+    int64_t __tocin_http_conn_free(int64_t);
+    int64_t __tocin_ws_mask(char *, int64_t, int64_t, int64_t);
+    int64_t __tocin_ws_write_frame(char *, int64_t, const char *, int64_t, int64_t, int64_t);
+    int64_t __tocin_ws_parse_frame(char *, int64_t, int64_t, int64_t *);
+    int64_t __tocin_ws_conn_new(int64_t, int64_t);
+    int64_t __tocin_ws_conn_next(int64_t);
+    int64_t __tocin_ws_conn_data(int64_t);
+    int64_t __tocin_ws_conn_len(int64_t);
+    char *__tocin_ws_conn_text(int64_t);
+    int64_t __tocin_ws_conn_send(int64_t, int64_t, const char *, int64_t, int64_t);
+    int64_t __tocin_ws_conn_send_text(int64_t, const char *);
+    int64_t __tocin_ws_conn_free(int64_t);
+    int64_t __tocin_json_parse_fast(const char *);
+    int64_t __tocin_json_doc_new();
+    int64_t __tocin_json_parse_into(int64_t, const char *, int64_t, int64_t);
+    int64_t __tocin_json_doc_free(int64_t);
+    int64_t __tocin_json_type(int64_t, int64_t);
+    int64_t __tocin_json_len(int64_t, int64_t);
+    int64_t __tocin_json_first(int64_t, int64_t);
+    int64_t __tocin_json_next(int64_t, int64_t);
+    int64_t __tocin_json_value(int64_t, int64_t);
+    int64_t __tocin_json_at(int64_t, int64_t, int64_t);
+    int64_t __tocin_json_get(int64_t, int64_t, const char *);
+    int64_t __tocin_json_pointer(int64_t, int64_t, const char *);
+    int64_t __tocin_json_int(int64_t, int64_t);
+    double __tocin_json_float(int64_t, int64_t);
+    int64_t __tocin_json_bool(int64_t, int64_t);
+    char *__tocin_json_string(int64_t, int64_t);
+    int64_t __tocin_json_str_eq(int64_t, int64_t, const char *);
+    int64_t __tocin_json_stream_open(const char *);
+    int64_t __tocin_json_stream_of(const char *);
+    int64_t __tocin_json_stream_next(int64_t);
+    int64_t __tocin_json_stream_doc(int64_t);
+    int64_t __tocin_json_stream_close(int64_t);
     // Environment / process
     char *__tocin_env_get(const char *);
     void __tocin_sys_exit(int64_t);
@@ -175,18 +453,27 @@ extern "C" {
 #include "codegen/ir_generator.h"
 #include "error/error_handler.h"
 #include "compiler/compilation_context.h"
+#include "compiler/advanced_optimizations.h"
+#include "compiler/bounds_check_elim.h"
+#include "compiler/jit_cache.h"
+#include "compiler/stdlib_cache.h"
+#include "compiler/jit_symbols.h"
+#include "compiler/tiered_jit.h"
+#include "compiler/hot_reload.h"
+#include "compiler/jit_stubs.h"
+#include "compiler/file_watcher.h"
 // Include the feature integration header
 #include "type/feature_integration.h"
 
 // New features
 #include "compiler/macro_system.h"
 #include "runtime/async_system.h"
+#include "runtime/alloc_profiler.h"
+#include "runtime/sampling_profiler.h"
 #ifdef WITH_DEBUGGER
 #include "debugger/debugger.h"
 #endif
-#ifdef WITH_WASM
 #include "targets/wasm_target.h"
-#endif
 #ifdef WITH_PACKAGE_MANAGER
 #include "package/package_manager.h"
 #endif
@@ -253,9 +540,6 @@ public:
 #ifdef WITH_DEBUGGER
           ,debugger(std::make_unique<debugger::LLVMDebugger>())
 #endif
-#ifdef WITH_WASM
-          ,wasmTarget(std::make_unique<targets::WASMTarget>())
-#endif
 #ifdef WITH_PACKAGE_MANAGER
           ,packageManager(std::make_unique<package::PackageManager>(".", errorHandler))
 #endif
@@ -286,14 +570,16 @@ public:
         bool enableMacros;
         bool enableAsync;
         bool enableDebugger;
-        bool enableWASM;
-        std::string target;
+        std::string target;         // --target: native, or wasm (LLVM wasm32 backend)
+        bool wasmThreads;           // --wasm-threads: atomics + shared memory
         bool enablePackageManager;
         bool run; // JIT-execute the program in-process (--jit / --run)
         bool freestanding; // no libc / no GC / no runtime — kernel/bare-metal
         bool noGC;         // don't link the garbage collector (alloc -> malloc)
         bool borrowCheck;  // opt-in ownership / use-after-move analysis
+        bool ownedMemory;  // --memory=owned: free what the borrow checker proves unique
         bool nativeCpu;    // tune AOT codegen for the host CPU (POPCNT/AVX/...)
+        std::vector<std::string> multiversion; // --multiversion[=<levels>]: clone loop functions per ISA level
         bool permissive;   // do not block compilation on (non-fatal) type errors
         bool checkOnly;    // `tocin check`: stop after type checking (no codegen)
         // Cross-compilation / bare-metal codegen controls. Empty strings mean
@@ -305,45 +591,170 @@ public:
         std::string codeModel;      // --code-model (tiny|small|kernel|medium|large)
         std::string relocModel;     // --reloc (static|pic|dynamic-no-pic)
         bool noRedZone;             // --no-red-zone (required for interrupt handlers)
+        // Advanced optimization pipeline (src/compiler/advanced_optimizations).
+        // Each of these implies -O2 unless an explicit -O level is given.
+        bool ipo;                   // --ipo: devirtualize, IPSCCP, inline before the O-pipeline
+        bool polyhedral;            // --polyhedral: loop fusion/interchange/unroll-and-jam
+        bool lto;                   // --lto: whole-program LTO pipeline after the O-pipeline
+        bool pgoGen;                // --pgo-gen[=<file>]: InstrProf instrumentation
+        std::string pgoGenPath;     //   profile written by the instrumented run
+        std::string pgoUse;         // --pgo-use=<file>: apply an indexed .profdata
+        bool optStats;              // --opt-stats: print PipelineStats to stderr
+        bool boundsCheckStats;      // --bounds-check-stats: report bounds checks removed/hoisted
+        bool jitCache;              // --run: reuse objects cached on disk (--no-jit-cache)
+        bool lazyJit;               // --lazy-jit: compile each function on its first call
+        bool tieredJit;             // --tiered-jit: -O0 first, re-optimize hot functions
+        unsigned jobs;              // -j N: type-check, optimize and emit on N threads
+        bool incremental;           // --incremental: cache one object per source module
+        uint64_t tierThreshold;     //   calls before a function is promoted (0 = default)
+        bool watch;                 // --watch: swap in edited functions while the program runs
+        bool repl;                  // REPL input: load into the tiered REPL session
+        std::string replEntry;      //   then call this function (empty = definitions only)
+        bool timeTrace;             // --time-trace[=<file>]: Chrome trace of the compile's phases
+        std::string timeTraceFile;  //   default: <output or input>.time-trace
+        unsigned timeTraceGranularity; // --time-trace-granularity=<us>: shortest span kept
+        bool profile;               // --profile[=<file>]: sample the run's CPU time
+        std::string profilePath;    //   folded stacks, or pprof for *.pb.gz (default profile.folded)
+        bool perfMap;               // --perf-map: JIT'd functions to /tmp/perf-<pid>.map
+        bool inlineRuntime;         // link the runtime's bitcode in (--no-runtime-inline)
+        bool stdlibCache;           // import precompiled stdlib modules (--no-stdlib-cache)
 
         CompilationOptions()
             : dumpIR(false), optimize(false), optimizationLevel(2), outputFile(""),
               enableFFI(true), enableConcurrency(true), enableAdvancedFeatures(true),
               enableMacros(true), enableAsync(true), enableDebugger(false),
-              enableWASM(false), target("native"), enablePackageManager(true), run(false),
-              freestanding(false), noGC(false), borrowCheck(false), nativeCpu(false),
-              permissive(false), checkOnly(false), noRedZone(false) {}
+              target("native"), wasmThreads(false), enablePackageManager(true), run(false),
+              freestanding(false), noGC(false), borrowCheck(false), ownedMemory(false), nativeCpu(false),
+              permissive(false), checkOnly(false), noRedZone(false), ipo(false),
+              polyhedral(false), lto(false), pgoGen(false), optStats(false), boundsCheckStats(false),
+              jitCache(true), lazyJit(false), tieredJit(false), tierThreshold(0),
+              jobs(1), incremental(false), watch(false), repl(false), timeTrace(false),
+              timeTraceGranularity(500), profile(false), perfMap(false), inlineRuntime(true),
+              stdlibCache(true) {}
     };
 
     // Exit code produced by the most recent JIT execution (--run).
     int programExitCode = 0;
     int getProgramExitCode() const { return programExitCode; }
 
+    // Profiling needs the instrumented single-tier pipeline, so --pgo-gen
+    // turns tiering off, as does --bounds-check-stats, which reports on the
+    // whole program; --watch manages its own stubs.
+    static bool useTieredJIT(const CompilationOptions& options)
+    {
+        return options.run && options.tieredJit && !options.pgoGen && !options.watch &&
+               !options.repl && !options.boundsCheckStats;
+    }
+
+    // A --run under TOCIN_ALLOC_PROFILE: the runtime started the allocation
+    // profiler when it loaded, and JIT'd frames should unwind and be named.
+    static bool allocProfile(const CompilationOptions& options)
+    {
+        return options.run && tocin::runtime::AllocationProfiler::active();
+    }
+
+    // Whole programs (an executable or a --run) import stdlib modules
+    // precompiled (see precompiledInterface). Output meant for another
+    // linker, --freestanding, hot reload, tiering and instrumented or
+    // profiled runs compile them from source.
+    static bool useStdlibCache(const CompilationOptions& options)
+    {
+        auto hasSuffix = [&](const std::string& suffix) {
+            const std::string& s = options.outputFile;
+            return s.size() >= suffix.size() &&
+                   s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+        const bool executable = !options.outputFile.empty() && !hasSuffix(".ll") &&
+                                !hasSuffix(".s") && !hasSuffix(".o") && !hasSuffix(".obj");
+        return options.stdlibCache && options.target != "wasm" && !options.freestanding &&
+               (options.run || executable) && !options.checkOnly && !options.watch &&
+               !options.repl && !useTieredJIT(options) && !options.pgoGen &&
+               !options.ownedMemory && !options.profile && !allocProfile(options) &&
+               !options.dumpIR && !options.boundsCheckStats;
+    }
+
     bool compile(const std::string &source, const std::string &filename,
                  const CompilationOptions &options = CompilationOptions())
     {
-        // Lexical analysis
-        lexer::Lexer lexer(source, filename, 4);
-        std::vector<lexer::Token> tokens = lexer.tokenize();
-
-        if (errorHandler.hasFatalErrors())
+        // --run of an unchanged program: skip the whole front end and go
+        // straight from the cached object to execution. Runs whose output is
+        // more than the program's own (IR dumps, statistics, a profile) always
+        // compile from source.
+        jitCache_.reset();
+        importedFiles_.clear();
+        stdlibObjects_.clear();
+        stdlibBitcode_.clear();
+        // Precompiling an import (during resolveImports) targets what the
+        // program will.
+        configureTarget(options);
+        // Set before the cache lookup: a cached run is profiled too.
+        observeJIT_ = options.run && (options.profile || options.perfMap || allocProfile(options));
+        perfMap_ = options.perfMap;
+        profilePath_.clear();
+        if (options.run && options.profile)
+            profilePath_ = options.profilePath.empty() ? "profile.folded" : options.profilePath;
+        // --lazy-jit, --tiered-jit and --watch never produce a whole-program
+        // object, so they neither read nor write the cache.
+        if (options.run && options.jitCache && !options.lazyJit && !useTieredJIT(options) &&
+            !options.watch && !options.repl &&
+            !options.dumpIR && !options.optStats && !options.boundsCheckStats && !options.pgoGen &&
+            !options.checkOnly &&
+            !options.freestanding)
         {
-            return false;
+            jitCache_ = std::make_unique<tocin::compiler::JITObjectCache>(
+                tocin::compiler::JITObjectCache::defaultDirectory());
+            jitCache_->setKey(jitCacheKey(source, filename, options));
+            std::vector<std::string> objects;
+            if (auto object = jitCache_->lookup(&objects))
+            {
+                if (runCachedJIT(std::move(object), objects, filename))
+                    return true;
+            }
         }
 
-        // Expand function-like macros at the token level, before parsing.
-        if (options.enableMacros)
+        // Create compilation context with advanced features. Its module
+        // cache is the compiler's, so imports parsed by an earlier compile in
+        // this process (REPL lines, rebuilds) are not parsed again.
+        tocin::compiler::CompilationContext compilationContext(filename);
+        compilationContext.setModuleCache(moduleCache_);
+
+        // Every AST node of this compile, imported modules included, is
+        // bump-allocated in the context's arena.
+        ast::ArenaScope astScope(compilationContext.astArena());
+
+        // Lexical analysis. The parser pulls tokens from the lexer as it
+        // goes, unless the file defines macros: those are expanded at the
+        // token level first, which needs the whole stream.
+        lexer::Lexer lexer(source, filename, 4);
+        std::vector<lexer::Token> tokens;
+        const bool expandMacros = options.enableMacros && source.find("macro") != std::string::npos;
+        if (expandMacros)
         {
+            {
+                llvm::TimeTraceScope scope("Lex", filename);
+                tokens = lexer.tokenize();
+            }
+            if (errorHandler.hasFatalErrors())
+            {
+                return false;
+            }
+            llvm::TimeTraceScope scope("Expand macros", filename);
             tokens = compiler::expandMacroTokens(tokens, errorHandler);
             if (errorHandler.hasFatalErrors())
             {
                 return false;
             }
         }
+        lexer::TokenVectorSource expanded(tokens);
 
-        // Parsing
-        parser::Parser parser(tokens);
-        ast::StmtPtr program = parser.parse();
+        // Parsing. Without macros the lexer runs inside this span: the parser
+        // pulls its tokens as it goes.
+        parser::Parser parser(expandMacros ? static_cast<lexer::TokenSource &>(expanded) : lexer);
+        ast::StmtPtr program;
+        {
+            llvm::TimeTraceScope scope(expandMacros ? "Parse" : "Lex and parse", filename);
+            program = parser.parse();
+        }
 
         if (errorHandler.hasFatalErrors() || !program)
         {
@@ -351,18 +762,23 @@ public:
         }
 
         // Resolve `import` statements by loading and merging other modules.
-        program = resolveImports(program, filename);
+        {
+            llvm::TimeTraceScope scope("Resolve imports");
+            program = resolveImports(program, filename, compilationContext.moduleCache(),
+                                     useStdlibCache(options) ? &options : nullptr);
+        }
         if (errorHandler.hasFatalErrors() || !program)
         {
             return false;
         }
 
-        // Create compilation context with advanced features
-        tocin::compiler::CompilationContext compilationContext(filename);
-
         // Type checking with advanced features
         type_checker::TypeChecker checker(errorHandler, compilationContext, &featureManager);
-        checker.check(program);
+        checker.setJobs(options.jobs);
+        {
+            llvm::TimeTraceScope scope("Type check");
+            checker.check(program);
+        }
 
         if (errorHandler.hasFatalErrors())
         {
@@ -385,41 +801,49 @@ public:
             return true;
         }
 
-        // Opt-in ownership / borrow analysis. Off by default; never changes
-        // codegen. Aborts before codegen only when --borrow-check is set and an
-        // ownership error is found (move/use-after-move are ERROR, not FATAL, so
-        // gate on the pass's own result rather than hasFatalErrors()).
+        // Opt-in ownership / borrow analysis. Off by default. Aborts before
+        // codegen only when --borrow-check is set and an ownership error is
+        // found (move/use-after-move are ERROR, not FATAL, so gate on the
+        // pass's own result rather than hasFatalErrors()). Codegen changes only
+        // under --memory=owned, which frees the bindings it proves unique.
+        uniqueOwners_.clear();
         if (options.borrowCheck)
         {
+            llvm::TimeTraceScope scope("Borrow check");
             type_checker::BorrowChecker borrowChecker(errorHandler);
             if (!borrowChecker.check(program))
                 return false;
+            if (options.ownedMemory)
+                uniqueOwners_ = borrowChecker.uniqueOwners();
         }
 
-        // Generate code based on target
-        if (options.target == "wasm" && options.enableWASM) {
-            return compileToWASM(program, filename, options);
-        } else {
-            return compileToNative(program, filename, options);
-        }
+        return compileToNative(program, filename, options);
     }
 
     /**
      * @brief Resolve `import` statements by loading, parsing and merging the
      *        imported modules' declarations into a single program.
+     *
+     * Imports come from @p cache when given (parsed once per file version).
+     * With @p precompile, a stdlib module is imported as its precompiled
+     * interface, compiled with these options (see precompiledInterface).
      */
-    ast::StmtPtr resolveImports(ast::StmtPtr program, const std::string& mainFile)
+    ast::StmtPtr resolveImports(ast::StmtPtr program, const std::string& mainFile,
+                                tocin::compiler::ModuleCache* cache = nullptr,
+                                const CompilationOptions* precompile = nullptr)
     {
         namespace fs = std::filesystem;
         std::set<std::string> loaded;
         std::vector<ast::StmtPtr> merged;
 
-        auto flatten = [](ast::StmtPtr p) {
-            std::vector<ast::StmtPtr> v;
-            if (auto blk = std::dynamic_pointer_cast<ast::BlockStmt>(p)) v = blk->statements;
-            else if (auto mod = std::dynamic_pointer_cast<ast::ModuleStmt>(p)) v = mod->body;
-            else if (p) v.push_back(p);
-            return v;
+        // The top-level statements of p, in place (single holds a lone one).
+        auto statementsOf = [](const ast::StmtPtr& p, std::vector<ast::StmtPtr>& single)
+            -> const std::vector<ast::StmtPtr>& {
+            if (auto blk = ast::dyn_cast<ast::BlockStmt>(p.get())) return blk->statements;
+            if (auto mod = ast::dyn_cast<ast::ModuleStmt>(p.get())) return mod->body;
+            single.clear();
+            if (p) single.push_back(p);
+            return single;
         };
 
         auto resolvePath = [&](const std::string& name, const std::string& fromDir) -> std::string {
@@ -440,11 +864,14 @@ public:
             return "";
         };
 
-        std::function<void(ast::StmtPtr, const std::string&)> process =
-            [&](ast::StmtPtr prog, const std::string& fromDir) {
-            for (auto& s : flatten(prog))
+        std::function<void(const ast::StmtPtr&, const std::string&)> process =
+            [&](const ast::StmtPtr& prog, const std::string& fromDir) {
+            std::vector<ast::StmtPtr> single;
+            const std::vector<ast::StmtPtr>& statements = statementsOf(prog, single);
+            merged.reserve(merged.size() + statements.size());
+            for (const auto& s : statements)
             {
-                if (auto imp = std::dynamic_pointer_cast<ast::ImportStmt>(s))
+                if (auto imp = ast::dyn_cast<ast::ImportStmt>(s.get()))
                 {
                     std::string file = resolvePath(imp->moduleName, fromDir);
                     if (file.empty())
@@ -456,13 +883,24 @@ public:
                     }
                     if (loaded.count(file)) continue;
                     loaded.insert(file);
-                    std::ifstream f(file);
-                    std::string src((std::istreambuf_iterator<char>(f)),
-                                    std::istreambuf_iterator<char>());
-                    lexer::Lexer lx(src, file, 4);
-                    auto toks = lx.tokenize();
-                    parser::Parser ps(toks);
-                    auto sub = ps.parse();
+                    std::string interface = precompile ? precompiledInterface(file, *precompile) : "";
+                    const std::string& source = interface.empty() ? file : interface;
+                    llvm::TimeTraceScope scope("Load module", source);
+                    ast::StmtPtr sub;
+                    if (cache)
+                    {
+                        sub = cache->load(source);
+                    }
+                    else
+                    {
+                        std::ifstream f(source);
+                        std::string src((std::istreambuf_iterator<char>(f)),
+                                        std::istreambuf_iterator<char>());
+                        lexer::Lexer lx(src, source, 4);
+                        parser::Parser ps(lx);
+                        ps.setInterface(!interface.empty());
+                        sub = ps.parse();
+                    }
                     process(sub, fs::path(file).parent_path().string()); // imported module's imports first
                     // Keep the import statement itself in the merged program:
                     // codegen ignores it, but the type checker uses it to learn
@@ -478,8 +916,200 @@ public:
         };
 
         process(program, fs::path(mainFile).parent_path().string());
-        return std::make_shared<ast::BlockStmt>(
-            lexer::Token(lexer::TokenType::IDENTIFIER, "", mainFile, 0, 0), merged);
+        importedFiles_.assign(loaded.begin(), loaded.end());
+        return ast::make<ast::BlockStmt>(
+            lexer::Token(lexer::TokenType::IDENTIFIER, "", mainFile, 0, 0), std::move(merged));
+    }
+
+    // Whether `file` is a module of the installed stdlib (TOCIN_STDLIB_PATH).
+    static bool isStdlibModule(const std::string& file)
+    {
+#ifdef TOCIN_STDLIB_PATH
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        fs::path root = fs::weakly_canonical(TOCIN_STDLIB_PATH, ec);
+        if (ec)
+            return false;
+        fs::path rel = fs::weakly_canonical(file, ec).lexically_relative(root);
+        return !ec && !rel.empty() && *rel.begin() != "..";
+#else
+        (void)file;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief The precompiled interface (.toi) of stdlib module @p file,
+     *        compiled now if it is not cached; "" to import it from source.
+     *
+     * A module is precompiled once per compiler build, option set and source
+     * version (the "stdlib" cache, a JITObjectCache keyed by codegenKey and
+     * the source, whose manifest records the module's own imports): the
+     * entry is `<key>.o`, `<key>.toi` and `<key>.bc`, or `<key>.src` when
+     * the module cannot be precompiled (see stdlib_cache.h). The object is
+     * linked into the program (stdlibObjects_) and the bitcode is offered to
+     * its optimizer for inlining (stdlibBitcode_).
+     */
+    std::string precompiledInterface(const std::string& file, const CompilationOptions& options)
+    {
+        if (!isStdlibModule(file))
+            return "";
+        tocin::compiler::JITObjectCache cache(
+            tocin::compiler::JITObjectCache::defaultDirectory("stdlib"));
+        cache.setKey(tocin::compiler::JITObjectCache::hash(
+            codegenKey(options) + file + '\n' + tocin::compiler::JITObjectCache::hashFile(file)));
+        if (llvm::sys::fs::exists(cache.path(".src")))
+            return "";
+        const bool cached = cache.current() && llvm::sys::fs::exists(cache.path(".toi"));
+        if (!cached && !precompileModule(file, options, cache))
+            return "";
+        auto add = [](std::vector<std::string>& list, const std::string& path) {
+            if (std::find(list.begin(), list.end(), path) == list.end())
+                list.push_back(path);
+        };
+        add(stdlibObjects_, cache.path(".o"));
+        if (options.optimize && llvm::sys::fs::exists(cache.path(".bc")))
+            add(stdlibBitcode_, cache.path(".bc"));
+        return cache.path(".toi");
+    }
+
+    /**
+     * @brief `tocin precompile`: fill the stdlib cache for these options
+     *        ahead of the first import of each module.
+     */
+    bool precompileStdlib(const CompilationOptions& options)
+    {
+#ifdef TOCIN_STDLIB_PATH
+        namespace fs = std::filesystem;
+        configureTarget(options);
+        std::vector<std::string> files;
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(TOCIN_STDLIB_PATH, ec), end; !ec && it != end;
+             it.increment(ec))
+            if (it->path().extension() == ".to")
+                files.push_back(fs::absolute(it->path(), ec).string());
+        std::sort(files.begin(), files.end());
+        size_t precompiled = 0;
+        for (const auto& file : files)
+            precompiled += !precompiledInterface(file, options).empty();
+        std::cout << precompiled << " of " << files.size() << " stdlib modules precompiled into "
+                  << tocin::compiler::JITObjectCache::defaultDirectory("stdlib") << "\n";
+        return !errorHandler.hasFatalErrors();
+#else
+        (void)options;
+        std::cerr << "error: this tocin was built without a stdlib directory\n";
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Compile stdlib module @p file on its own into @p cache's entry.
+     *
+     * The module is type-checked and compiled against its imports'
+     * interfaces; only the functions its interface declares keep external
+     * names. False if the entry was not written: the module cannot be
+     * precompiled (`.src` marks that) or has errors, which are reported.
+     */
+    bool precompileModule(const std::string& file, const CompilationOptions& options,
+                          tocin::compiler::JITObjectCache& cache)
+    {
+        llvm::TimeTraceScope scope("Precompile module", file);
+        std::ifstream in(file);
+        std::string source((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        tocin::compiler::CompilationContext compilationContext(file);
+        compilationContext.setModuleCache(moduleCache_);
+        ast::ArenaScope astScope(compilationContext.astArena());
+        lexer::Lexer lexer(source, file, 4);
+        parser::Parser parser(lexer);
+        ast::StmtPtr program = parser.parse();
+        if (!program || !parser.getErrors().empty())
+            return false;
+        // A module of one statement parses to that statement alone.
+        auto* block = ast::dyn_cast<ast::BlockStmt>(program.get());
+        const std::vector<ast::StmtPtr> statements = block ? block->statements : std::vector<ast::StmtPtr>{program};
+        if (!tocin::compiler::isPrecompilable(source, statements))
+        {
+            cache.store(".src", "");
+            return false;
+        }
+
+        // The module's imports are its manifest; the program's own list is
+        // still being built by the resolveImports that got here.
+        std::vector<std::string> imports;
+        std::swap(imports, importedFiles_);
+        program = resolveImports(program, file, compilationContext.moduleCache(), &options);
+        std::swap(imports, importedFiles_);
+        if (errorHandler.hasFatalErrors() || !program)
+            return false;
+        type_checker::TypeChecker checker(errorHandler, compilationContext, &featureManager);
+        checker.check(program);
+        if (errorHandler.hasFatalErrors() || (!options.permissive && errorHandler.hasErrors()))
+            return false;
+
+        llvm::LLVMContext context;
+        auto module = std::make_unique<llvm::Module>(file, context);
+        if (auto tm = createConfiguredTargetMachine())
+        {
+#if LLVM_VERSION_MAJOR >= 21
+            module->setTargetTriple(tm->getTargetTriple());
+#else
+            module->setTargetTriple(tm->getTargetTriple().str());
+#endif
+            module->setDataLayout(tm->createDataLayout());
+        }
+        codegen::IRGenerator generator(context, std::move(module), errorHandler);
+        generator.noRedZone = options.noRedZone;
+        std::unique_ptr<llvm::Module> object = generator.generate(program);
+        if (errorHandler.hasFatalErrors() || !object || llvm::verifyModule(*object))
+            return false;
+        // Globals set up at startup would need the importer's main to do it.
+        if (object->getFunction("__tocin_global_init"))
+        {
+            cache.store(".src", "");
+            return false;
+        }
+
+        tocin::compiler::ModuleInterface interface =
+            tocin::compiler::makeInterface(source, statements, file);
+        if (options.inlineRuntime)
+            linkRuntimeBitcode(*object);
+        for (auto& F : *object)
+            if (!F.isDeclaration() && !interface.exported.count(F.getName().str()))
+                F.setLinkage(llvm::GlobalValue::InternalLinkage);
+        for (auto& G : object->globals())
+            if (G.hasInitializer() && G.hasExternalLinkage() && !G.getName().starts_with("llvm."))
+                G.setLinkage(llvm::GlobalValue::InternalLinkage);
+        if (!options.nativeCpu)
+            tocin::optimization::multiversionFunctions(*object, options.multiversion);
+        // Compiled once for every program that imports it: always optimized.
+        optimizeModule(*object, options.optimize ? options.optimizationLevel : 2);
+
+        std::string bitcode;
+        {
+            std::unique_ptr<llvm::Module> inlinable = llvm::CloneModule(*object);
+            tocin::compiler::prepareInlineBitcode(*inlinable, interface.exported);
+            llvm::raw_string_ostream out(bitcode);
+            llvm::WriteBitcodeToFile(*inlinable, out);
+        }
+        // The object is written next to the entry, which may be the first.
+        llvm::sys::fs::create_directories(llvm::sys::path::parent_path(cache.path(".o")));
+        std::string temp = cache.path(".o") + ".tmp" + std::to_string(llvm::sys::Process::getProcessId());
+        std::string error = writeObjectFile(*object, temp, false);
+        auto objectFile = llvm::MemoryBuffer::getFile(temp);
+        llvm::sys::fs::remove(temp);
+        if (!error.empty() || !objectFile)
+        {
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "Cannot precompile " + file + ": " +
+                                         (error.empty() ? "object not written" : error),
+                                     file, 0, 0, error::ErrorSeverity::WARNING);
+            return false;
+        }
+        imports.push_back(file);
+        if (!cache.store(".toi", interface.text) || !cache.store(".bc", bitcode))
+            return false;
+        cache.notifyObjectCompiled(nullptr, (*objectFile)->getMemBufferRef());
+        return cache.commit(imports);
     }
 
     bool compileToNative(ast::StmtPtr program, const std::string& filename,
@@ -490,13 +1120,26 @@ public:
         auto context = std::make_unique<llvm::LLVMContext>();
         auto module = std::make_unique<llvm::Module>(filename, *context);
 
-        useNativeCpu_ = options.nativeCpu;   // read by createConfiguredTargetMachine()
-        targetTriple_ = options.targetTriple;
-        targetCpu_ = options.targetCpu;
-        targetFeatures_ = options.targetFeatures;
-        codeModel_ = options.codeModel;
-        relocModel_ = options.relocModel;
-        noRedZone_ = options.noRedZone;
+        configureTarget(options);
+        if (wasmTarget_)
+        {
+            if (!targets::WASMTarget::initializeBackend())
+            {
+                errorHandler.reportError(error::ErrorCode::C001_UNIMPLEMENTED_FEATURE,
+                    "--target wasm needs an LLVM built with the WebAssembly backend",
+                    filename, 0, 0);
+                return false;
+            }
+            if (options.run)
+            {
+                errorHandler.reportError(error::ErrorCode::C001_UNIMPLEMENTED_FEATURE,
+                    "--run executes on the host; drop --target wasm, or write a .wasm with -o",
+                    filename, 0, 0);
+                return false;
+            }
+        }
+        linkProfileRuntime_ = options.pgoGen && !options.run;
+        exportSymbols_ = options.profile && !options.run;
 
         // Give the module its real triple and data layout BEFORE IR generation.
         // Alignment is stamped on allocas/loads/stores at creation time, so an
@@ -517,9 +1160,18 @@ public:
         codegen::IRGenerator generator(*context, std::move(module), errorHandler);
         generator.freestanding = options.freestanding;
         generator.noRedZone = options.noRedZone;
+        generator.ownedMemory = options.ownedMemory;
+        generator.tracepoints = options.enableDebugger;
+        generator.uniqueOwners = uniqueOwners_;
 
         // Generate LLVM IR from the AST
-        auto generatedModule = generator.generate(program);
+        std::unique_ptr<llvm::Module> generatedModule;
+        {
+            llvm::TimeTraceScope scope("Generate IR");
+            generatedModule = generator.generate(program);
+        }
+        functionSources_ = generator.functionSources();
+        genericInstances_ = generator.genericInstanceFunctions();
         if (errorHandler.hasFatalErrors() || !generatedModule)
         {
             return false;
@@ -528,7 +1180,12 @@ public:
         // Verify the module
         std::string verifierErrors;
         llvm::raw_string_ostream verifierStream(verifierErrors);
-        if (llvm::verifyModule(*generatedModule, &verifierStream))
+        bool invalid;
+        {
+            llvm::TimeTraceScope scope("Verify IR");
+            invalid = llvm::verifyModule(*generatedModule, &verifierStream);
+        }
+        if (invalid)
         {
             errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
                                      "Invalid LLVM IR generated: " + verifierErrors,
@@ -536,6 +1193,36 @@ public:
             return false;
         }
 
+        // Precompiled stdlib functions join the module as bitcode the same
+        // way, ahead of the runtime they call; their objects still define
+        // them.
+        if (options.optimize && !stdlibBitcode_.empty())
+        {
+            llvm::TimeTraceScope scope("Link stdlib bitcode");
+            linkStdlibBitcode(*generatedModule);
+        }
+
+        // The runtime's hot entry points join the module as bitcode, so the
+        // optimizer can inline them; the internalization below then covers
+        // them like the program's own functions.
+        if (options.optimize && options.inlineRuntime && !options.freestanding &&
+            !options.watch && !options.repl && !useTieredJIT(options))
+        {
+            llvm::TimeTraceScope scope("Link runtime bitcode");
+            linkRuntimeBitcode(*generatedModule);
+        }
+
+        // Linked-in functions bring their own copies of the literals the
+        // program already has. Folding equal ones into one global makes them
+        // one pointer, which __tocin_str_eq and the intern table settle
+        // without reading bytes.
+        if (options.optimize)
+        {
+            llvm::TimeTraceScope scope("Merge constants");
+            llvm::ModuleAnalysisManager mam;
+            llvm::ConstantMergePass().run(*generatedModule, mam);
+        }
+
         // Whole-program view: a self-contained executable (or a JIT run) has
         // main as its only entry point, so every other definition can be
         // internalized. This is what unlocks cross-function -O3 - full inlining
@@ -543,6 +1230,8 @@ public:
         // (LTO-style, in one module). Skipped for .ll/.s/.o outputs (they may
         // be linked against other objects) and --freestanding (the kernel's
         // entry symbols must stay visible to the external linker script).
+        // --watch and the REPL keep every function by name: hot reload
+        // replaces them.
         auto hasSuffix = [](const std::string& s, const std::string& suffix) {
             return s.size() >= suffix.size() &&
                    s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
@@ -552,7 +1241,16 @@ public:
                                    hasSuffix(outPath, ".o") || hasSuffix(outPath, ".obj");
         const bool wholeProgram = !options.freestanding &&
                                   (options.run || (!outPath.empty() && !partialOutput));
-        if (wholeProgram)
+        const bool internalized = wholeProgram && !options.watch && !options.repl;
+        if (!internalized)
+        {
+            // Runtime functions linked in above are only there to be inlined:
+            // what is not inlined calls the runtime library's copy.
+            for (const auto &name : runtimeBitcodeFunctions_)
+                if (llvm::Function *F = generatedModule->getFunction(name); F && !F->isDeclaration())
+                    F->setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+        }
+        if (internalized)
         {
             for (auto &F : *generatedModule)
                 if (!F.isDeclaration() && F.hasExternalLinkage() && F.getName() != "main")
@@ -563,11 +1261,109 @@ public:
                     G.setLinkage(llvm::GlobalValue::InternalLinkage);
         }
 
+        // The sampling profiler walks frame pointers, so --profile keeps them.
+        if (options.profile)
+        {
+            for (auto &F : *generatedModule)
+                if (!F.isDeclaration())
+                    F.addFnAttr("frame-pointer", "all");
+        }
+        // The allocation profiler's backtrace() unwinds through Tocin frames
+        // by their unwind tables: emit them for every function.
+        if (options.profile || allocProfile(options))
+        {
+            for (auto &F : *generatedModule)
+                if (!F.isDeclaration())
+                    F.setUWTableKind(llvm::UWTableKind::Async);
+        }
+
         // Optimize if requested
-        if (options.optimize && !errorHandler.hasFatalErrors())
+        std::unique_ptr<tocin::optimization::AdvancedOptimizationPipeline> advanced;
+        // Tiered runs start from unoptimized IR; TieredJIT optimizes hot
+        // functions itself. -j N executables are optimized per partition at
+        // emission, unless a whole-program pass (IPO, LTO, PGO, ...) is on.
+        const bool tiered = useTieredJIT(options);
+        const bool advancedPipeline = options.ipo || options.polyhedral || options.lto ||
+                                      options.pgoGen || !options.pgoUse.empty() ||
+                                      options.optStats;
+        const bool partitioned = (options.jobs > 1 || options.incremental) && wholeProgram &&
+                                 !options.run && !advancedPipeline && !options.dumpIR &&
+                                 !options.boundsCheckStats;
+        // Hot reload replaces bodies under running callers, so no caller may
+        // be optimized against a callee's current body: while the pipeline
+        // runs, --watch makes definitions interposable (not inlined, not
+        // analyzed across calls).
+        std::vector<std::pair<llvm::Function*, llvm::GlobalValue::LinkageTypes>> interposed;
+        if (options.watch)
+        {
+            for (auto &F : *generatedModule)
+            {
+                if (F.isDeclaration() || F.getName() == "main")
+                    continue;
+                interposed.emplace_back(&F, F.getLinkage());
+                F.setLinkage(llvm::GlobalValue::WeakAnyLinkage);
+            }
+        }
+        // Trait-object calls go through vtables; with the whole program in
+        // hand, calls that can reach only a few classes become direct (and
+        // inlinable) before anything is optimized or partitioned. --ipo does
+        // this itself as part of its devirtualization.
+        if (options.optimize && internalized && !tiered && !options.ipo)
+        {
+            llvm::TimeTraceScope scope("Devirtualize trait calls");
+            tocin::optimization::devirtualizeTraitCalls(*generatedModule);
+        }
+        // Likewise a higher-order call handed a known function or lambda
+        // gets a copy of the callee that calls it directly.
+        if (options.optimize && !tiered)
+        {
+            llvm::TimeTraceScope scope("Specialize closure calls");
+            tocin::optimization::specializeClosureCalls(*generatedModule);
+        }
+        // target_clones functions, and under --multiversion every function
+        // with a vectorizable loop, get a version per x86-64 level and pick
+        // one on the running CPU. A --native build knows its CPU already.
+        if (options.optimize && !tiered && !options.freestanding && !options.nativeCpu &&
+            !options.watch && !options.repl)
         {
-            optimizeModule(*generatedModule, options.optimizationLevel);
+            llvm::TimeTraceScope scope("Multiversion functions");
+            tocin::optimization::multiversionFunctions(*generatedModule, options.multiversion);
         }
+        tocin::optimization::BoundsCheckStats boundsChecks;
+        if (options.optimize && !tiered && !partitioned && !errorHandler.hasFatalErrors())
+        {
+            if (advancedPipeline)
+            {
+                advanced = std::make_unique<tocin::optimization::AdvancedOptimizationPipeline>();
+                advanced->setOptimizationLevel(options.optimizationLevel);
+                advanced->enableIPO(options.ipo);
+                advanced->enablePolyhedral(options.polyhedral);
+                advanced->enableLTO(options.lto);
+                advanced->setWholeProgram(internalized);
+                // Native binaries write a raw profile through compiler-rt; a JIT
+                // run writes the text format itself (see runJIT). Either one is
+                // turned into --pgo-use input with `llvm-profdata merge`.
+                if (options.pgoGen)
+                    advanced->enableProfileGeneration(
+                        !options.pgoGenPath.empty() ? options.pgoGenPath
+                        : options.run           ? std::string("default.proftext")
+                                                : std::string("default_%m.profraw"));
+                else if (!options.pgoUse.empty() && !advanced->loadProfile(options.pgoUse))
+                {
+                    errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                             advanced->pgo().lastError(), filename, 0, 0);
+                    return false;
+                }
+            }
+            optimizeModule(*generatedModule, options.optimizationLevel, advanced.get(),
+                           options.boundsCheckStats ? &boundsChecks : nullptr);
+            if (advanced && options.optStats)
+                advanced->printStats(std::cerr);
+            if (options.boundsCheckStats)
+                boundsChecks.print(std::cerr);
+        }
+        for (auto &[F, linkage] : interposed)
+            F->setLinkage(linkage);
 
         // Dump IR if requested
         if (options.dumpIR)
@@ -589,7 +1385,20 @@ public:
                     filename, 0, 0);
                 return false;
             }
-            return runJIT(std::move(context), std::move(generatedModule), filename);
+            llvm::TimeTraceScope scope("JIT and run");
+            if (options.repl)
+                return runReplInput(std::move(context), std::move(generatedModule), options);
+            if (options.watch)
+                return hotReload_ ? reloadWatchedJIT(std::move(context), std::move(generatedModule),
+                                                     filename)
+                                  : runWatchedJIT(std::move(context), std::move(generatedModule),
+                                                  filename, options);
+            if (tiered)
+                return runTieredJIT(std::move(context), std::move(generatedModule), filename,
+                                    options);
+            return runJIT(std::move(context), std::move(generatedModule), filename,
+                          advanced && options.pgoGen ? &advanced->pgo() : nullptr,
+                          options.lazyJit);
         }
 
         // Write output if specified.
@@ -637,35 +1446,544 @@ public:
             }
             else
             {
-                // Produce a native executable: emit a temporary object file
-                // and link it with the system C toolchain.
-                std::string objPath = outputPath + ".o";
-                if (!emitObjectFile(*generatedModule, objPath, false))
-                    return false;
-                if (!linkExecutable(objPath, outputPath))
+                // Produce a native executable: emit temporary object file(s)
+                // and link them with the system C toolchain.
+                std::vector<std::string> objects, temporaries;
+                if (partitioned)
+                {
+                    if (!emitPartitionedObjects(*generatedModule, options, outputPath, objects,
+                                                temporaries))
+                        return false;
+                }
+                else
+                {
+                    objects.push_back(outputPath + ".o");
+                    temporaries.push_back(objects.back());
+                    if (!emitObjectFile(*generatedModule, objects.back(), false))
+                        return false;
+                }
+                objects.insert(objects.end(), stdlibObjects_.begin(), stdlibObjects_.end());
+                if (wasmTarget_ ? !linkWasm(objects, outputPath) : !linkExecutable(objects, outputPath))
                     return false;
-                std::remove(objPath.c_str());
+                for (const auto& object : temporaries)
+                    std::remove(object.c_str());
             }
         }
 
         return !errorHandler.hasFatalErrors();
     }
 
+    /**
+     * @brief The compiler build and every option that changes generated code;
+     *        shared by the --run and --incremental caches.
+     */
+    std::string codegenKey(const CompilationOptions& options)
+    {
+        std::ostringstream key;
+        // The compiler build itself: a rebuilt tocin may generate different
+        // code under the same version string.
+        static int anchor;
+        std::string self = llvm::sys::fs::getMainExecutable("tocin", &anchor);
+        llvm::sys::fs::file_status status;
+        if (!llvm::sys::fs::status(self, status))
+            key << self << ' ' << status.getSize() << ' '
+                << status.getLastModificationTime().time_since_epoch().count() << '\n';
+#ifdef TOCIN_VERSION
+        key << TOCIN_VERSION << '\n';
+#endif
+        key << LLVM_VERSION_STRING << ' ' << llvm::sys::getProcessTriple() << ' '
+            << llvm::sys::getHostCPUName().str() << '\n';
+
+        // Options that reach codegen or decide which imports resolve.
+        key << options.optimize << options.optimizationLevel << options.enableMacros
+            << options.noGC << options.permissive << options.borrowCheck << options.ownedMemory << options.nativeCpu
+            << options.ipo << options.polyhedral << options.lto << options.noRedZone
+            << options.profile << allocProfile(options) << options.enableDebugger << '\n'
+            << llvm::join(options.multiversion, ",") << '\n'
+            << options.targetTriple << '\n' << options.targetCpu << '\n'
+            << options.targetFeatures << '\n' << options.codeModel << '\n'
+            << options.relocModel << '\n' << options.target << options.wasmThreads << '\n';
+        if (!options.pgoUse.empty())
+            key << tocin::compiler::JITObjectCache::hashFile(options.pgoUse) << '\n';
+        if (options.inlineRuntime)
+        {
+            // The runtime bitcode is compiled into the program.
+            std::string bitcode = runtimeBitcodePath();
+            if (!bitcode.empty() && llvm::sys::fs::exists(bitcode))
+                key << tocin::compiler::JITObjectCache::hashFile(bitcode);
+            key << '\n';
+        }
+        if (const char* path = std::getenv("TOCIN_PATH"))
+            key << path;
+        key << '\n';
+        return key.str();
+    }
+
+    /**
+     * @brief Cache key for a --run: everything that can change the JIT object
+     *        apart from the imported modules (see JITObjectCache).
+     */
+    std::string jitCacheKey(const std::string& source, const std::string& filename,
+                            const CompilationOptions& options)
+    {
+        std::error_code ec;
+        return tocin::compiler::JITObjectCache::hash(
+            codegenKey(options) + std::filesystem::absolute(filename, ec).string() + '\n' +
+            source);
+    }
+
     /**
      * @brief JIT-compile and execute the module's main() in-process.
+     *
+     * With @p lazy the module is split per function (LLLazyJIT +
+     * CompileOnDemandLayer) and each body is compiled on its first call, so
+     * imported code the program never reaches is never compiled.
      */
     bool runJIT(std::unique_ptr<llvm::LLVMContext> context,
                 std::unique_ptr<llvm::Module> module,
-                const std::string& filename)
+                const std::string& filename,
+                tocin::optimization::PGOManager* profile = nullptr,
+                bool lazy = false)
+    {
+        auto jit = createJIT(filename, profile != nullptr, lazy ? nullptr : jitCache_.get(), lazy);
+        if (!jit)
+            return false;
+
+        if (profile)
+            profile->recordCounters(module.get());
+
+        llvm::orc::ThreadSafeModule tsm(std::move(module), std::move(context));
+        if (auto err = lazy ? static_cast<llvm::orc::LLLazyJIT&>(*jit).addLazyIRModule(std::move(tsm))
+                            : jit->addIRModule(std::move(tsm)))
+        {
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "Failed to add module to JIT: " +
+                                         llvm::toString(std::move(err)),
+                                     filename, 0, 0);
+            return false;
+        }
+
+        if (!addStdlibObjects(*jit, stdlibObjects_, &filename))
+            return false;
+
+        auto* mainFn = lookupMain(*jit, filename);
+        if (!mainFn)
+            return false;
+        // Looking up main compiled the module, so the cache holds its object
+        // now; publish the entry before running (the program may exit()).
+        // The stdlib objects it links against are recorded with the imports.
+        if (jitCache_ && !lazy)
+        {
+            std::vector<std::string> deps = importedFiles_;
+            deps.insert(deps.end(), stdlibObjects_.begin(), stdlibObjects_.end());
+            jitCache_->commit(deps);
+        }
+        startProfile();
+        programExitCode = static_cast<int>(mainFn());
+        finishMain();
+        if (!finishProfile(filename))
+            return false;
+
+        if (profile)
+        {
+            auto counters = [&](const std::string& symbol) -> const uint64_t* {
+                auto sym = jit->lookup(symbol);
+                if (!sym)
+                {
+                    llvm::consumeError(sym.takeError());
+                    return nullptr;
+                }
+                return sym->toPtr<const uint64_t*>();
+            };
+            if (!profile->saveProfile(profile->profileOutput(), counters))
+            {
+                errorHandler.reportError(error::ErrorCode::I003_READ_ERROR,
+                                         profile->lastError(), filename, 0, 0);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief --tiered-jit: run main() on -O0 code while TieredJIT re-optimizes
+     *        hot functions in the background.
+     */
+    bool runTieredJIT(std::unique_ptr<llvm::LLVMContext> context,
+                      std::unique_ptr<llvm::Module> module,
+                      const std::string& filename, const CompilationOptions& options)
+    {
+        auto jit = createJIT(filename, false, nullptr, false, true);
+        if (!jit)
+            return false;
+
+        const unsigned level =
+            options.optimize && options.optimizationLevel > 0 ? options.optimizationLevel : 3;
+        tocin::compiler::TieredJIT::Stats stats;
+        {
+            tocin::compiler::TieredJIT tiers(*jit, level, options.tierThreshold);
+            if (auto err = tiers.addModule(
+                    llvm::orc::ThreadSafeModule(std::move(module), std::move(context))))
+            {
+                errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                         "Failed to add module to JIT: " +
+                                             llvm::toString(std::move(err)),
+                                         filename, 0, 0);
+                return false;
+            }
+            auto* mainFn = lookupMain(*jit, filename);
+            if (!mainFn)
+                return false;
+            startProfile();
+            programExitCode = static_cast<int>(mainFn());
+            finishMain();
+            stats = tiers.stats();
+        }
+        if (!finishProfile(filename))
+            return false;
+        if (options.optStats)
+            std::cerr << "tiered JIT: " << stats.functions << " functions at tier 1, "
+                      << stats.promoted << " promoted to -O" << level << " ("
+                      << stats.failed << " failed)\n";
+        return true;
+    }
+
+    /**
+     * @brief --watch: run main() on its own thread and recompile whenever the
+     *        program's source files change.
+     *
+     * Every successful recompile reaches reloadWatchedJIT (hotReload_ is set),
+     * which swaps the changed functions into the running program. A failed
+     * build only prints its diagnostics; the program keeps running the last
+     * good version. Returns once main() does.
+     */
+    bool runWatchedJIT(std::unique_ptr<llvm::LLVMContext> context,
+                       std::unique_ptr<llvm::Module> module,
+                       const std::string& filename, const CompilationOptions& options)
+    {
+        auto jit = createJIT(filename, false, nullptr);
+        if (!jit)
+            return false;
+        hotReload_ = std::make_unique<tocin::compiler::HotReloadSession>(*jit, filename);
+        if (auto err = hotReload_->addModule(
+                llvm::orc::ThreadSafeModule(std::move(module), std::move(context))))
+        {
+            hotReload_.reset();
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "Failed to add module to JIT: " +
+                                         llvm::toString(std::move(err)),
+                                     filename, 0, 0);
+            return false;
+        }
+        auto* mainFn = lookupMain(*jit, filename);
+        if (!mainFn)
+        {
+            hotReload_.reset();
+            return false;
+        }
+
+        std::atomic<bool> finished{false};
+        int64_t exitCode = 0;
+        std::thread program([&] {
+            exitCode = mainFn();
+            finishMain();
+            finished = true;
+        });
+
+        // Imports that fail to resolve in a broken edit stay watched.
+        std::set<std::string> sources(importedFiles_.begin(), importedFiles_.end());
+        sources.insert(filename);
+        tocin::compiler::FileWatcher watcher;
+        watcher.watch({sources.begin(), sources.end()});
+        std::cerr << "watch: running " << filename << "; saved changes are applied live\n";
+        while (!finished)
+        {
+            if (watcher.wait(std::chrono::milliseconds(250)).empty())
+                continue;
+            std::ifstream in(filename);
+            std::string source((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+            errorHandler.clearErrors();
+            if (!compile(source, filename, options))
+                std::cerr << "watch: build failed; still running the previous version\n";
+            sources.insert(importedFiles_.begin(), importedFiles_.end());
+            watcher.watch({sources.begin(), sources.end()});
+        }
+        program.join();
+        hotReload_.reset();
+        programExitCode = static_cast<int>(exitCode);
+        return true;
+    }
+
+    /**
+     * @brief --watch recompile: apply the new module to the running program.
+     *
+     * Changes that cannot be applied live (a new signature, main itself) are
+     * reported and otherwise ignored; they take effect on the next start.
+     */
+    bool reloadWatchedJIT(std::unique_ptr<llvm::LLVMContext> context,
+                          std::unique_ptr<llvm::Module> module, const std::string& filename)
+    {
+        auto patch = hotReload_->update(
+            llvm::orc::ThreadSafeModule(std::move(module), std::move(context)));
+        if (!patch)
+        {
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "Hot reload failed: " + llvm::toString(patch.takeError()),
+                                     filename, 0, 0);
+            return false;
+        }
+        for (const auto& reason : patch->restartNeeded)
+            std::cerr << "watch: " << reason << "; restart to apply\n";
+        if (patch->applied)
+            std::cerr << "watch: reloaded " << patch->reloaded.size() << " function(s), added "
+                      << patch->added.size() << " (generation " << hotReload_->generation()
+                      << ")\n";
+        return true;
+    }
+
+    /**
+     * @brief Load one REPL input into the REPL session and run its entry.
+     *
+     * Every input is compiled as the whole session so far; the session
+     * (a tiered HotReloadSession) loads only the functions that are new or
+     * changed, unoptimized so they are ready at once, keeps the globals the
+     * earlier inputs set, and promotes functions that get hot to
+     * -O<optimizationLevel> in the background. A change it cannot apply (a
+     * new signature for a defined function) rejects the input.
+     */
+    bool runReplInput(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module,
+                      const CompilationOptions& options)
+    {
+        llvm::orc::ThreadSafeModule tsm(std::move(module), std::move(context));
+        if (!replSession_)
+        {
+            replJit_ = createJIT("<repl>", false, nullptr, false, true);
+            if (!replJit_)
+                return false;
+            const unsigned level = options.optimizationLevel > 0 ? options.optimizationLevel : 2;
+            replSession_ = std::make_unique<tocin::compiler::HotReloadSession>(
+                *replJit_, "<repl>", level, options.tierThreshold);
+            if (auto err = replSession_->addModule(std::move(tsm)))
+            {
+                errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                         "Failed to add module to JIT: " + llvm::toString(std::move(err)),
+                                         "<repl>", 0, 0);
+                resetRepl();
+                return false;
+            }
+        }
+        else
+        {
+            auto patch = replSession_->update(std::move(tsm));
+            if (!patch)
+            {
+                errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                         "REPL update failed: " + llvm::toString(patch.takeError()),
+                                         "<repl>", 0, 0);
+                return false;
+            }
+            if (!patch->restartNeeded.empty())
+            {
+                for (const auto& reason : patch->restartNeeded)
+                    std::cerr << "repl: " << reason << "; type 'clear' to start over\n";
+                return false;
+            }
+        }
+        if (options.replEntry.empty())
+            return true;
+        auto entry = tocin::compiler::jit_stubs::lookupAddress(*replJit_, options.replEntry);
+        if (!entry)
+        {
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "REPL entry missing: " + llvm::toString(entry.takeError()),
+                                     "<repl>", 0, 0);
+            return false;
+        }
+        reinterpret_cast<void (*)()>(*entry)();
+        __tocin_stdout_flush();
+        return true;
+    }
+
+    // Forget every REPL definition and global (the REPL's `clear`).
+    void resetRepl()
+    {
+        replSession_.reset(); // stops its compile thread before the JIT goes
+        replJit_.reset();
+    }
+
+    /**
+     * @brief Execute main() from a JIT object cached by an earlier --run.
+     *
+     * Returns false, without reporting anything, when the object (or a
+     * precompiled stdlib module it was linked against) cannot be linked; the
+     * caller then compiles from source as if the cache missed.
+     */
+    bool runCachedJIT(std::unique_ptr<llvm::MemoryBuffer> object,
+                      const std::vector<std::string>& stdlibObjects, const std::string& filename)
+    {
+        auto jit = createJIT(filename, false, nullptr);
+        if (!jit)
+            return false;
+        if (auto err = jit->addObjectFile(std::move(object)))
+        {
+            llvm::consumeError(std::move(err));
+            return false;
+        }
+        if (!addStdlibObjects(*jit, stdlibObjects, nullptr))
+            return false;
+        auto mainSym = jit->lookup("main");
+        if (!mainSym)
+        {
+            llvm::consumeError(mainSym.takeError());
+            return false;
+        }
+        startProfile();
+        programExitCode = static_cast<int>(mainSym->toPtr<int64_t (*)()>()());
+        finishMain();
+        return finishProfile(filename);
+    }
+
+    // Add the precompiled stdlib objects the program was compiled against.
+    // A failure is reported against @p filename, if given.
+    bool addStdlibObjects(llvm::orc::LLJIT& jit, const std::vector<std::string>& objects,
+                          const std::string* filename)
+    {
+        for (const auto& path : objects)
+        {
+            auto buffer = llvm::MemoryBuffer::getFile(path);
+            llvm::Error err = buffer ? jit.addObjectFile(std::move(*buffer))
+                                     : llvm::errorCodeToError(buffer.getError());
+            if (!err)
+                continue;
+            if (filename)
+                errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                         "Failed to add " + path + " to JIT: " +
+                                             llvm::toString(std::move(err)),
+                                         *filename, 0, 0);
+            else
+                llvm::consumeError(std::move(err));
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief After a JIT'd main() returns: wait for the goroutines it left
+     *        running, which still execute code the JIT owns.
+     *
+     * A linked program waits for them in an atexit handler; a --run program
+     * only gets there after its JIT has been torn down.
+     */
+    void finishMain()
+    {
+        __tocin_join_all();
+        __tocin_stdout_flush(); // the compiler may print after the program
+    }
+
+    /**
+     * @brief --profile: sample the CPU time of the main() call that follows.
+     *
+     * TOCIN_PROFILE_HZ sets the rate. The profile covers main() returning;
+     * a program that calls exit() leaves none.
+     */
+    void startProfile()
+    {
+        if (profilePath_.empty())
+            return;
+        int hz = tocin::runtime::SamplingProfiler::kDefaultHz;
+        if (const char* env = std::getenv("TOCIN_PROFILE_HZ"); env && std::atoi(env) > 0)
+            hz = std::atoi(env);
+        if (!tocin::runtime::SamplingProfiler::instance().start(hz))
+            std::cerr << "warning: --profile: cannot start the sampling profiler"
+                         " (already running, or no SIGPROF timer here)\n";
+    }
+
+    bool finishProfile(const std::string& filename)
+    {
+        auto& profiler = tocin::runtime::SamplingProfiler::instance();
+        if (profilePath_.empty() || !profiler.running())
+            return true;
+        profiler.stop();
+        if (!profiler.write(profilePath_))
+        {
+            errorHandler.reportError(error::ErrorCode::I003_READ_ERROR,
+                                     "Could not write profile " + profilePath_ + ": " +
+                                         std::strerror(errno),
+                                     filename, 0, 0);
+            return false;
+        }
+        std::cerr << "profile: " << profiler.sampleCount() << " samples at " << profiler.hz()
+                  << " Hz written to " << profilePath_ << '\n';
+        return true;
+    }
+
+    /**
+     * @brief Build the JIT with the Tocin runtime registered.
+     *
+     * @p lazy returns an LLLazyJIT (callers add modules with addLazyIRModule)
+     * partitioned one function per compile unit; @p tiered selects codegen
+     * levels per module for TieredJIT.
+     */
+    std::unique_ptr<llvm::orc::LLJIT> createJIT(const std::string& filename, bool profiling,
+                                                llvm::ObjectCache* cache, bool lazy = false,
+                                                bool tiered = false)
     {
-        auto jitOrErr = llvm::orc::LLJITBuilder().create();
+        using JITOrErr = llvm::Expected<std::unique_ptr<llvm::orc::LLJIT>>;
+        // --profile and --perf-map need to hear where each function lands,
+        // and only RuntimeDyld reports that (JITEventListener), so those runs
+        // link on it instead of JITLink. Objects are announced to GDB's JIT
+        // interface on the way.
+        auto observe = [this](auto& builder) {
+            if (!observeJIT_)
+                return;
+            tocin::compiler::JITSymbolListener::instance().setPerfMap(perfMap_);
+            builder.setObjectLinkingLayerCreator(
+                [](llvm::orc::ExecutionSession& ES, auto&&...)
+                    -> llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>> {
+                    auto layer = std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(
+                        ES, [](auto&&...) { return std::make_unique<llvm::SectionMemoryManager>(); });
+                    layer->registerJITEventListener(
+                        *llvm::JITEventListener::createGDBRegistrationListener());
+                    layer->registerJITEventListener(tocin::compiler::JITSymbolListener::instance());
+                    return std::move(layer);
+                });
+        };
+        auto build = [&]() -> JITOrErr {
+            if (lazy)
+            {
+                llvm::orc::LLLazyJITBuilder lazyBuilder;
+                observe(lazyBuilder);
+                auto lazyJit = lazyBuilder.create();
+                if (!lazyJit)
+                    return lazyJit.takeError();
+                (*lazyJit)->setPartitionFunction(llvm::orc::CompileOnDemandLayer::compileRequested);
+                return std::move(*lazyJit);
+            }
+            llvm::orc::LLJITBuilder builder;
+            observe(builder);
+            if (tiered)
+                builder.setCompileFunctionCreator(tocin::compiler::TieredJIT::compilerCreator());
+            // With an object cache attached, ORC hands every compiled object
+            // to it (JITObjectCache writes it to disk for the next --run).
+            if (cache)
+            {
+                builder.setCompileFunctionCreator(
+                    [cache](llvm::orc::JITTargetMachineBuilder JTMB)
+                        -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                        return std::make_unique<llvm::orc::ConcurrentIRCompiler>(std::move(JTMB), cache);
+                    });
+            }
+            return builder.create();
+        };
+        auto jitOrErr = build();
         if (!jitOrErr)
         {
             errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
                                      "Failed to create JIT: " +
                                          llvm::toString(jitOrErr.takeError()),
                                      filename, 0, 0);
-            return false;
+            return nullptr;
         }
         auto jit = std::move(*jitOrErr);
 
@@ -685,17 +2003,136 @@ public:
                     llvm::orc::ExecutorAddr::fromPtr(addr), llvm::JITSymbolFlags::Exported);
             };
             def("__tocin_chan_new", reinterpret_cast<void *>(&__tocin_chan_new));
+            def("__tocin_chan_new_cap", reinterpret_cast<void *>(&__tocin_chan_new_cap));
             def("__tocin_chan_send", reinterpret_cast<void *>(&__tocin_chan_send));
             def("__tocin_chan_recv", reinterpret_cast<void *>(&__tocin_chan_recv));
             def("__tocin_go", reinterpret_cast<void *>(&__tocin_go));
             def("__tocin_join_all", reinterpret_cast<void *>(&__tocin_join_all));
+            def("__tocin_async", reinterpret_cast<void *>(&__tocin_async));
+            def("__tocin_future_new", reinterpret_cast<void *>(&__tocin_future_new));
+            def("__tocin_future_resolve", reinterpret_cast<void *>(&__tocin_future_resolve));
+            def("__tocin_future_await", reinterpret_cast<void *>(&__tocin_future_await));
+            def("__tocin_future_release", reinterpret_cast<void *>(&__tocin_future_release));
             def("__tocin_chan_try_recv", reinterpret_cast<void *>(&__tocin_chan_try_recv));
             def("__tocin_chan_park", reinterpret_cast<void *>(&__tocin_chan_park));
+            def("__tocin_chan_select", reinterpret_cast<void *>(&__tocin_chan_select));
+            def("__tocin_chan_send_many", reinterpret_cast<void *>(&__tocin_chan_send_many));
+            def("__tocin_chan_recv_into", reinterpret_cast<void *>(&__tocin_chan_recv_into));
+            def("__tocin_gemm_f64", reinterpret_cast<void *>(&__tocin_gemm_f64));
+            def("__tocin_gemm_f64_nt", reinterpret_cast<void *>(&__tocin_gemm_f64_nt));
+            def("__tocin_gemv_f64", reinterpret_cast<void *>(&__tocin_gemv_f64));
+            def("__tocin_sort_ints", reinterpret_cast<void *>(&__tocin_sort_ints));
+            def("__tocin_sort_floats", reinterpret_cast<void *>(&__tocin_sort_floats));
+            def("__tocin_sort_strings", reinterpret_cast<void *>(&__tocin_sort_strings));
+            def("__tocin_radix_sort_ints", reinterpret_cast<void *>(&__tocin_radix_sort_ints));
+            def("__tocin_stable_sort_ints", reinterpret_cast<void *>(&__tocin_stable_sort_ints));
+            def("__tocin_stable_sort_floats", reinterpret_cast<void *>(&__tocin_stable_sort_floats));
+            def("__tocin_parallel_sort_ints", reinterpret_cast<void *>(&__tocin_parallel_sort_ints));
+            def("__tocin_parallel_sort_floats", reinterpret_cast<void *>(&__tocin_parallel_sort_floats));
+            def("__tocin_select_ints", reinterpret_cast<void *>(&__tocin_select_ints));
+            def("__tocin_select_floats", reinterpret_cast<void *>(&__tocin_select_floats));
+            def("__tocin_tdigest_new", reinterpret_cast<void *>(&__tocin_tdigest_new));
+            def("__tocin_tdigest_free", reinterpret_cast<void *>(&__tocin_tdigest_free));
+            def("__tocin_tdigest_add", reinterpret_cast<void *>(&__tocin_tdigest_add));
+            def("__tocin_tdigest_add_all", reinterpret_cast<void *>(&__tocin_tdigest_add_all));
+            def("__tocin_tdigest_merge", reinterpret_cast<void *>(&__tocin_tdigest_merge));
+            def("__tocin_tdigest_quantile", reinterpret_cast<void *>(&__tocin_tdigest_quantile));
+            def("__tocin_tdigest_cdf", reinterpret_cast<void *>(&__tocin_tdigest_cdf));
+            def("__tocin_tdigest_count", reinterpret_cast<void *>(&__tocin_tdigest_count));
+            def("__tocin_sort_by_keys", reinterpret_cast<void *>(&__tocin_sort_by_keys));
+            def("__tocin_i64_sum", reinterpret_cast<void *>(&__tocin_i64_sum));
+            def("__tocin_i64_argmin", reinterpret_cast<void *>(&__tocin_i64_argmin));
+            def("__tocin_i64_argmax", reinterpret_cast<void *>(&__tocin_i64_argmax));
+            def("__tocin_i64_count_eq", reinterpret_cast<void *>(&__tocin_i64_count_eq));
+            def("__tocin_i64_count_gt", reinterpret_cast<void *>(&__tocin_i64_count_gt));
+            def("__tocin_i64_find_eq", reinterpret_cast<void *>(&__tocin_i64_find_eq));
+            def("__tocin_i64_find_gt", reinterpret_cast<void *>(&__tocin_i64_find_gt));
+            def("__tocin_i64_find_le", reinterpret_cast<void *>(&__tocin_i64_find_le));
+            def("__tocin_i64_lower_bound", reinterpret_cast<void *>(&__tocin_i64_lower_bound));
+            def("__tocin_fb_fill_rect", reinterpret_cast<void *>(&__tocin_fb_fill_rect));
+            def("__tocin_fb_blend_rect", reinterpret_cast<void *>(&__tocin_fb_blend_rect));
+            def("__tocin_fb_fill_circle", reinterpret_cast<void *>(&__tocin_fb_fill_circle));
+            def("__tocin_fb_blit", reinterpret_cast<void *>(&__tocin_fb_blit));
+            def("__tocin_audio_graph_new", reinterpret_cast<void *>(&__tocin_audio_graph_new));
+            def("__tocin_audio_graph_free", reinterpret_cast<void *>(&__tocin_audio_graph_free));
+            def("__tocin_audio_graph_osc", reinterpret_cast<void *>(&__tocin_audio_graph_osc));
+            def("__tocin_audio_graph_mix", reinterpret_cast<void *>(&__tocin_audio_graph_mix));
+            def("__tocin_audio_graph_lowpass", reinterpret_cast<void *>(&__tocin_audio_graph_lowpass));
+            def("__tocin_audio_graph_connect", reinterpret_cast<void *>(&__tocin_audio_graph_connect));
+            def("__tocin_audio_graph_gain", reinterpret_cast<void *>(&__tocin_audio_graph_gain));
+            def("__tocin_audio_graph_clip", reinterpret_cast<void *>(&__tocin_audio_graph_clip));
+            def("__tocin_audio_graph_set_freq", reinterpret_cast<void *>(&__tocin_audio_graph_set_freq));
+            def("__tocin_audio_graph_process", reinterpret_cast<void *>(&__tocin_audio_graph_process));
+            def("__tocin_audio_graph_process_to_ring", reinterpret_cast<void *>(&__tocin_audio_graph_process_to_ring));
+            def("__tocin_audio_ring_new", reinterpret_cast<void *>(&__tocin_audio_ring_new));
+            def("__tocin_audio_ring_free", reinterpret_cast<void *>(&__tocin_audio_ring_free));
+            def("__tocin_audio_ring_push", reinterpret_cast<void *>(&__tocin_audio_ring_push));
+            def("__tocin_audio_ring_pop", reinterpret_cast<void *>(&__tocin_audio_ring_pop));
+            def("__tocin_audio_ring_size", reinterpret_cast<void *>(&__tocin_audio_ring_size));
+            def("__tocin_img_box_blur", reinterpret_cast<void *>(&__tocin_img_box_blur));
+            def("__tocin_img_sobel", reinterpret_cast<void *>(&__tocin_img_sobel));
+            def("__tocin_img_resize", reinterpret_cast<void *>(&__tocin_img_resize));
+            def("__tocin_tensor_new", reinterpret_cast<void *>(&__tocin_tensor_new));
+            def("__tocin_tensor_from_list", reinterpret_cast<void *>(&__tocin_tensor_from_list));
+            def("__tocin_tensor_to_list", reinterpret_cast<void *>(&__tocin_tensor_to_list));
+            def("__tocin_tensor_free", reinterpret_cast<void *>(&__tocin_tensor_free));
+            def("__tocin_tensor_mark", reinterpret_cast<void *>(&__tocin_tensor_mark));
+            def("__tocin_tensor_release", reinterpret_cast<void *>(&__tocin_tensor_release));
+            def("__tocin_tensor_keep", reinterpret_cast<void *>(&__tocin_tensor_keep));
+            def("__tocin_tensor_rank", reinterpret_cast<void *>(&__tocin_tensor_rank));
+            def("__tocin_tensor_dim", reinterpret_cast<void *>(&__tocin_tensor_dim));
+            def("__tocin_tensor_numel", reinterpret_cast<void *>(&__tocin_tensor_numel));
+            def("__tocin_tensor_get", reinterpret_cast<void *>(&__tocin_tensor_get));
+            def("__tocin_tensor_set", reinterpret_cast<void *>(&__tocin_tensor_set));
+            def("__tocin_tensor_reshape", reinterpret_cast<void *>(&__tocin_tensor_reshape));
+            def("__tocin_tensor_slice", reinterpret_cast<void *>(&__tocin_tensor_slice));
+            def("__tocin_tensor_transpose", reinterpret_cast<void *>(&__tocin_tensor_transpose));
+            def("__tocin_tensor_contiguous", reinterpret_cast<void *>(&__tocin_tensor_contiguous));
+            def("__tocin_tensor_binary", reinterpret_cast<void *>(&__tocin_tensor_binary));
+            def("__tocin_tensor_unary", reinterpret_cast<void *>(&__tocin_tensor_unary));
+            def("__tocin_tensor_scalar", reinterpret_cast<void *>(&__tocin_tensor_scalar));
+            def("__tocin_tensor_eval", reinterpret_cast<void *>(&__tocin_tensor_eval));
+            def("__tocin_tensor_assign", reinterpret_cast<void *>(&__tocin_tensor_assign));
+            def("__tocin_tensor_fill", reinterpret_cast<void *>(&__tocin_tensor_fill));
+            def("__tocin_tensor_matmul", reinterpret_cast<void *>(&__tocin_tensor_matmul));
+            def("__tocin_tensor_sum", reinterpret_cast<void *>(&__tocin_tensor_sum));
+            def("__tocin_tensor_pool_stat", reinterpret_cast<void *>(&__tocin_tensor_pool_stat));
+            def("__tocin_tensor_matmul_q", reinterpret_cast<void *>(&__tocin_tensor_matmul_q));
+            def("__tocin_quantize", reinterpret_cast<void *>(&__tocin_quantize));
+            def("__tocin_qmat_vec", reinterpret_cast<void *>(&__tocin_qmat_vec));
+            def("__tocin_qmat_mul", reinterpret_cast<void *>(&__tocin_qmat_mul));
+            def("__tocin_qmat_dequantize", reinterpret_cast<void *>(&__tocin_qmat_dequantize));
+            def("__tocin_qmat_rows", reinterpret_cast<void *>(&__tocin_qmat_rows));
+            def("__tocin_qmat_cols", reinterpret_cast<void *>(&__tocin_qmat_cols));
+            def("__tocin_qmat_bytes", reinterpret_cast<void *>(&__tocin_qmat_bytes));
+            def("__tocin_qmat_free", reinterpret_cast<void *>(&__tocin_qmat_free));
+            def("__tocin_wg_new", reinterpret_cast<void *>(&__tocin_wg_new));
+            def("__tocin_wg_add", reinterpret_cast<void *>(&__tocin_wg_add));
+            def("__tocin_wg_done", reinterpret_cast<void *>(&__tocin_wg_done));
+            def("__tocin_wg_wait", reinterpret_cast<void *>(&__tocin_wg_wait));
+            def("__tocin_mutex_new", reinterpret_cast<void *>(&__tocin_mutex_new));
+            def("__tocin_mutex_lock", reinterpret_cast<void *>(&__tocin_mutex_lock));
+            def("__tocin_mutex_try_lock", reinterpret_cast<void *>(&__tocin_mutex_try_lock));
+            def("__tocin_mutex_unlock", reinterpret_cast<void *>(&__tocin_mutex_unlock));
+            def("__tocin_rwlock_new", reinterpret_cast<void *>(&__tocin_rwlock_new));
+            def("__tocin_rwlock_rlock", reinterpret_cast<void *>(&__tocin_rwlock_rlock));
+            def("__tocin_rwlock_runlock", reinterpret_cast<void *>(&__tocin_rwlock_runlock));
+            def("__tocin_rwlock_lock", reinterpret_cast<void *>(&__tocin_rwlock_lock));
+            def("__tocin_rwlock_unlock", reinterpret_cast<void *>(&__tocin_rwlock_unlock));
+            def("__tocin_once_new", reinterpret_cast<void *>(&__tocin_once_new));
+            def("__tocin_once_do", reinterpret_cast<void *>(&__tocin_once_do));
+            def("__tocin_sync_free", reinterpret_cast<void *>(&__tocin_sync_free));
+            def("__tocin_parallel_for", reinterpret_cast<void *>(&__tocin_parallel_for));
+            def("__tocin_parallel_for_step", reinterpret_cast<void *>(&__tocin_parallel_for_step));
+            def("__tocin_parallel_reduce", reinterpret_cast<void *>(&__tocin_parallel_reduce));
+            def("__tocin_parallel_reduce_f64", reinterpret_cast<void *>(&__tocin_parallel_reduce_f64));
             def("__tocin_try_register", reinterpret_cast<void *>(&__tocin_try_register));
             def("__tocin_try_pop", reinterpret_cast<void *>(&__tocin_try_pop));
             def("__tocin_exc_value", reinterpret_cast<void *>(&__tocin_exc_value));
             def("__tocin_throw", reinterpret_cast<void *>(&__tocin_throw));
+            def("__tocin_exc_catch", reinterpret_cast<void *>(&__tocin_exc_catch));
             def("__tocin_vec_new", reinterpret_cast<void *>(&__tocin_vec_new));
+            def("__tocin_vec_new_of", reinterpret_cast<void *>(&__tocin_vec_new_of));
             def("__tocin_vec_push", reinterpret_cast<void *>(&__tocin_vec_push));
             def("__tocin_vec_get", reinterpret_cast<void *>(&__tocin_vec_get));
             def("__tocin_vec_set", reinterpret_cast<void *>(&__tocin_vec_set));
@@ -711,50 +2148,189 @@ public:
             def("__tocin_map_has_str", reinterpret_cast<void *>(&__tocin_map_has_str));
             def("__tocin_map_len", reinterpret_cast<void *>(&__tocin_map_len));
             def("__tocin_map_free", reinterpret_cast<void *>(&__tocin_map_free));
+            def("__tocin_memo_get", reinterpret_cast<void *>(&__tocin_memo_get));
+            def("__tocin_memo_put", reinterpret_cast<void *>(&__tocin_memo_put));
+            def("__tocin_cpu_level", reinterpret_cast<void *>(&__tocin_cpu_level));
+            def("__tocin_map_reserve", reinterpret_cast<void *>(&__tocin_map_reserve));
+            def("__tocin_map_reserve_str", reinterpret_cast<void *>(&__tocin_map_reserve_str));
+            def("__tocin_map_capacity", reinterpret_cast<void *>(&__tocin_map_capacity));
+            def("__tocin_map_capacity_str", reinterpret_cast<void *>(&__tocin_map_capacity_str));
             def("__tocin_str_len", reinterpret_cast<void *>(&__tocin_str_len));
             def("__tocin_str_char_at", reinterpret_cast<void *>(&__tocin_str_char_at));
             def("__tocin_str_substring", reinterpret_cast<void *>(&__tocin_str_substring));
             def("__tocin_str_eq", reinterpret_cast<void *>(&__tocin_str_eq));
             def("__tocin_str_cmp", reinterpret_cast<void *>(&__tocin_str_cmp));
+            def("__tocin_intern", reinterpret_cast<void *>(&__tocin_intern));
+            def("__tocin_intern_literals", reinterpret_cast<void *>(&__tocin_intern_literals));
             def("__tocin_str_index_of_char", reinterpret_cast<void *>(&__tocin_str_index_of_char));
             def("__tocin_int_to_str", reinterpret_cast<void *>(&__tocin_int_to_str));
             def("__tocin_str_to_int", reinterpret_cast<void *>(&__tocin_str_to_int));
             def("__tocin_char_to_str", reinterpret_cast<void *>(&__tocin_char_to_str));
             def("__tocin_str_concat", reinterpret_cast<void *>(&__tocin_str_concat));
+            def("__tocin_str_append", reinterpret_cast<void *>(&__tocin_str_append));
+            def("__tocin_str_from_c", reinterpret_cast<void *>(&__tocin_str_from_c));
+            def("__tocin_str_free", reinterpret_cast<void *>(&__tocin_str_free));
+            def("__tocin_sb_new", reinterpret_cast<void *>(&__tocin_sb_new));
+            def("__tocin_sb_append", reinterpret_cast<void *>(&__tocin_sb_append));
+            def("__tocin_sb_append_int", reinterpret_cast<void *>(&__tocin_sb_append_int));
+            def("__tocin_sb_append_float", reinterpret_cast<void *>(&__tocin_sb_append_float));
+            def("__tocin_sb_len", reinterpret_cast<void *>(&__tocin_sb_len));
+            def("__tocin_sb_finish", reinterpret_cast<void *>(&__tocin_sb_finish));
             def("__tocin_str_to_upper", reinterpret_cast<void *>(&__tocin_str_to_upper));
             def("__tocin_str_to_lower", reinterpret_cast<void *>(&__tocin_str_to_lower));
             def("__tocin_str_index_of", reinterpret_cast<void *>(&__tocin_str_index_of));
+            def("__tocin_str_index_of_from", reinterpret_cast<void *>(&__tocin_str_index_of_from));
             def("__tocin_str_contains", reinterpret_cast<void *>(&__tocin_str_contains));
             def("__tocin_str_starts_with", reinterpret_cast<void *>(&__tocin_str_starts_with));
             def("__tocin_str_ends_with", reinterpret_cast<void *>(&__tocin_str_ends_with));
             def("__tocin_free", reinterpret_cast<void *>(&__tocin_free));
             def("__tocin_alloc", reinterpret_cast<void *>(&__tocin_alloc));
             def("__tocin_realloc", reinterpret_cast<void *>(&__tocin_realloc));
+            def("__tocin_alloc_atomic", reinterpret_cast<void *>(&__tocin_alloc_atomic));
+            def("__tocin_alloc_tagged", reinterpret_cast<void *>(&__tocin_alloc_tagged));
+            def("__tocin_alloc_atomic_tagged", reinterpret_cast<void *>(&__tocin_alloc_atomic_tagged));
+            def("__tocin_alloc_pointer_free", reinterpret_cast<void *>(&__tocin_alloc_pointer_free));
+            def("__tocin_alloc_typed", reinterpret_cast<void *>(&__tocin_alloc_typed));
+            def("__tocin_arena_new", reinterpret_cast<void *>(&__tocin_arena_new));
+            def("__tocin_arena_free", reinterpret_cast<void *>(&__tocin_arena_free));
+            def("__tocin_arena_reset", reinterpret_cast<void *>(&__tocin_arena_reset));
+            def("__tocin_arena_used", reinterpret_cast<void *>(&__tocin_arena_used));
+            def("__tocin_arena_enter", reinterpret_cast<void *>(&__tocin_arena_enter));
+            def("__tocin_arena_exit", reinterpret_cast<void *>(&__tocin_arena_exit));
             def("__tocin_str_to_float", reinterpret_cast<void *>(&__tocin_str_to_float));
             def("__tocin_float_to_str", reinterpret_cast<void *>(&__tocin_float_to_str));
+            def("__tocin_floats_to_str", reinterpret_cast<void *>(&__tocin_floats_to_str));
+            def("__tocin_str_to_floats", reinterpret_cast<void *>(&__tocin_str_to_floats));
             def("__tocin_read_file", reinterpret_cast<void *>(&__tocin_read_file));
             def("__tocin_write_file", reinterpret_cast<void *>(&__tocin_write_file));
             def("__tocin_append_file", reinterpret_cast<void *>(&__tocin_append_file));
+            def("__tocin_file_size", reinterpret_cast<void *>(&__tocin_file_size));
+            def("__tocin_mmap_file", reinterpret_cast<void *>(&__tocin_mmap_file));
+            def("__tocin_mmap_size", reinterpret_cast<void *>(&__tocin_mmap_size));
+            def("__tocin_munmap_file", reinterpret_cast<void *>(&__tocin_munmap_file));
+            def("__tocin_mmap_advise", reinterpret_cast<void *>(&__tocin_mmap_advise));
             def("__tocin_read_line", reinterpret_cast<void *>(&__tocin_read_line));
+            def("__tocin_file_open", reinterpret_cast<void *>(&__tocin_file_open));
+            def("__tocin_file_close", reinterpret_cast<void *>(&__tocin_file_close));
+            def("__tocin_file_eof", reinterpret_cast<void *>(&__tocin_file_eof));
+            def("__tocin_file_read_line", reinterpret_cast<void *>(&__tocin_file_read_line));
+            def("__tocin_file_read_record", reinterpret_cast<void *>(&__tocin_file_read_record));
+            def("__tocin_file_read_chunk", reinterpret_cast<void *>(&__tocin_file_read_chunk));
+            def("__tocin_print_begin", reinterpret_cast<void *>(&__tocin_print_begin));
+            def("__tocin_print_end", reinterpret_cast<void *>(&__tocin_print_end));
+            def("__tocin_print_bytes", reinterpret_cast<void *>(&__tocin_print_bytes));
+            def("__tocin_print_str", reinterpret_cast<void *>(&__tocin_print_str));
+            def("__tocin_print_int", reinterpret_cast<void *>(&__tocin_print_int));
+            def("__tocin_print_float", reinterpret_cast<void *>(&__tocin_print_float));
+            def("__tocin_stdout_flush", reinterpret_cast<void *>(&__tocin_stdout_flush));
             def("__tocin_time_sec", reinterpret_cast<void *>(&__tocin_time_sec));
             def("__tocin_time_ms", reinterpret_cast<void *>(&__tocin_time_ms));
             def("__tocin_mono_nanos", reinterpret_cast<void *>(&__tocin_mono_nanos));
             def("__tocin_sleep_ms", reinterpret_cast<void *>(&__tocin_sleep_ms));
+            def("__tocin_chan_after", reinterpret_cast<void *>(&__tocin_chan_after));
             def("__tocin_hash_bytes", reinterpret_cast<void *>(&__tocin_hash_bytes));
             def("__tocin_hash_str", reinterpret_cast<void *>(&__tocin_hash_str));
+            def("__tocin_hash_fast", reinterpret_cast<void *>(&__tocin_hash_fast));
+            def("__tocin_hash_fast_str", reinterpret_cast<void *>(&__tocin_hash_fast_str));
+            def("__tocin_hash_seeded", reinterpret_cast<void *>(&__tocin_hash_seeded));
+            def("__tocin_hash_str_seeded", reinterpret_cast<void *>(&__tocin_hash_str_seeded));
+            def("__tocin_hash_combine", reinterpret_cast<void *>(&__tocin_hash_combine));
             def("__tocin_hash_int", reinterpret_cast<void *>(&__tocin_hash_int));
             def("__tocin_rand_seed", reinterpret_cast<void *>(&__tocin_rand_seed));
             def("__tocin_rand_next", reinterpret_cast<void *>(&__tocin_rand_next));
             def("__tocin_rand_range", reinterpret_cast<void *>(&__tocin_rand_range));
+            def("__tocin_rand_state", reinterpret_cast<void *>(&__tocin_rand_state));
+            def("__tocin_rand_fill", reinterpret_cast<void *>(&__tocin_rand_fill));
+            def("__tocin_rand_fill_float", reinterpret_cast<void *>(&__tocin_rand_fill_float));
             def("__tocin_tcp_listen", reinterpret_cast<void *>(&__tocin_tcp_listen));
             def("__tocin_tcp_accept", reinterpret_cast<void *>(&__tocin_tcp_accept));
             def("__tocin_tcp_connect", reinterpret_cast<void *>(&__tocin_tcp_connect));
+            def("__tocin_tcp_dns_ttl", reinterpret_cast<void *>(&__tocin_tcp_dns_ttl));
+            def("__tocin_tcp_pool_new", reinterpret_cast<void *>(&__tocin_tcp_pool_new));
+            def("__tocin_tcp_pool_get", reinterpret_cast<void *>(&__tocin_tcp_pool_get));
+            def("__tocin_tcp_pool_put", reinterpret_cast<void *>(&__tocin_tcp_pool_put));
+            def("__tocin_tcp_pool_reap", reinterpret_cast<void *>(&__tocin_tcp_pool_reap));
+            def("__tocin_tcp_pool_stats", reinterpret_cast<void *>(&__tocin_tcp_pool_stats));
+            def("__tocin_tcp_pool_close", reinterpret_cast<void *>(&__tocin_tcp_pool_close));
+            def("__tocin_runtime_stats", reinterpret_cast<void *>(&__tocin_runtime_stats));
+            def("__tocin_runtime_metrics", reinterpret_cast<void *>(&__tocin_runtime_metrics));
+            def("__tocin_runtime_metrics_serve", reinterpret_cast<void *>(&__tocin_runtime_metrics_serve));
+            def("__tocin_alloc_profile_write", reinterpret_cast<void *>(&__tocin_alloc_profile_write));
+            def("__tocin_alloc_counting", reinterpret_cast<void *>(&__tocin_alloc_counting));
+            def("__tocin_alloc_counts", reinterpret_cast<void *>(&__tocin_alloc_counts));
+            def("__tocin_heap_snapshot", reinterpret_cast<void *>(&__tocin_heap_snapshot));
+            def("__tocin_gc_configure", reinterpret_cast<void *>(&__tocin_gc_configure));
+            def("__tocin_tracepoints_register", reinterpret_cast<void *>(&__tocin_tracepoints_register));
+            def("__tocin_tracepoint", reinterpret_cast<void *>(&__tocin_tracepoint));
+            def("__tocin_trace_probe", reinterpret_cast<void *>(&__tocin_trace_probe));
+            def("__tocin_trace_remove", reinterpret_cast<void *>(&__tocin_trace_remove));
             def("__tocin_tcp_send", reinterpret_cast<void *>(&__tocin_tcp_send));
             def("__tocin_tcp_recv", reinterpret_cast<void *>(&__tocin_tcp_recv));
+            def("__tocin_tcp_send_buf", reinterpret_cast<void *>(&__tocin_tcp_send_buf));
+            def("__tocin_tcp_recv_into", reinterpret_cast<void *>(&__tocin_tcp_recv_into));
+            def("__tocin_tcp_send_file", reinterpret_cast<void *>(&__tocin_tcp_send_file));
             def("__tocin_tcp_close", reinterpret_cast<void *>(&__tocin_tcp_close));
+            def("__tocin_http_parse", reinterpret_cast<void *>(&__tocin_http_parse));
+            def("__tocin_http_header", reinterpret_cast<void *>(&__tocin_http_header));
+            def("__tocin_http_conn_new", reinterpret_cast<void *>(&__tocin_http_conn_new));
+            def("__tocin_http_client_conn_new", reinterpret_cast<void *>(&__tocin_http_client_conn_new));
+            def("__tocin_http_conn_next", reinterpret_cast<void *>(&__tocin_http_conn_next));
+            def("__tocin_http_conn_request", reinterpret_cast<void *>(&__tocin_http_conn_request));
+            def("__tocin_http_conn_pending", reinterpret_cast<void *>(&__tocin_http_conn_pending));
+            def("__tocin_http_conn_free", reinterpret_cast<void *>(&__tocin_http_conn_free));
+            def("__tocin_ws_mask", reinterpret_cast<void *>(&__tocin_ws_mask));
+            def("__tocin_ws_write_frame", reinterpret_cast<void *>(&__tocin_ws_write_frame));
+            def("__tocin_ws_parse_frame", reinterpret_cast<void *>(&__tocin_ws_parse_frame));
+            def("__tocin_ws_conn_new", reinterpret_cast<void *>(&__tocin_ws_conn_new));
+            def("__tocin_ws_conn_next", reinterpret_cast<void *>(&__tocin_ws_conn_next));
+            def("__tocin_ws_conn_data", reinterpret_cast<void *>(&__tocin_ws_conn_data));
+            def("__tocin_ws_conn_len", reinterpret_cast<void *>(&__tocin_ws_conn_len));
+            def("__tocin_ws_conn_text", reinterpret_cast<void *>(&__tocin_ws_conn_text));
+            def("__tocin_ws_conn_send", reinterpret_cast<void *>(&__tocin_ws_conn_send));
+            def("__tocin_ws_conn_send_text", reinterpret_cast<void *>(&__tocin_ws_conn_send_text));
+            def("__tocin_ws_conn_free", reinterpret_cast<void *>(&__tocin_ws_conn_free));
+            def("__tocin_json_parse_fast", reinterpret_cast<void *>(&__tocin_json_parse_fast));
+            def("__tocin_json_doc_new", reinterpret_cast<void *>(&__tocin_json_doc_new));
+            def("__tocin_json_parse_into", reinterpret_cast<void *>(&__tocin_json_parse_into));
+            def("__tocin_json_doc_free", reinterpret_cast<void *>(&__tocin_json_doc_free));
+            def("__tocin_json_type", reinterpret_cast<void *>(&__tocin_json_type));
+            def("__tocin_json_len", reinterpret_cast<void *>(&__tocin_json_len));
+            def("__tocin_json_first", reinterpret_cast<void *>(&__tocin_json_first));
+            def("__tocin_json_next", reinterpret_cast<void *>(&__tocin_json_next));
+            def("__tocin_json_value", reinterpret_cast<void *>(&__tocin_json_value));
+            def("__tocin_json_at", reinterpret_cast<void *>(&__tocin_json_at));
+            def("__tocin_json_get", reinterpret_cast<void *>(&__tocin_json_get));
+            def("__tocin_json_pointer", reinterpret_cast<void *>(&__tocin_json_pointer));
+            def("__tocin_json_int", reinterpret_cast<void *>(&__tocin_json_int));
+            def("__tocin_json_float", reinterpret_cast<void *>(&__tocin_json_float));
+            def("__tocin_json_bool", reinterpret_cast<void *>(&__tocin_json_bool));
+            def("__tocin_json_string", reinterpret_cast<void *>(&__tocin_json_string));
+            def("__tocin_json_str_eq", reinterpret_cast<void *>(&__tocin_json_str_eq));
+            def("__tocin_json_stream_open", reinterpret_cast<void *>(&__tocin_json_stream_open));
+            def("__tocin_json_stream_of", reinterpret_cast<void *>(&__tocin_json_stream_of));
+            def("__tocin_json_stream_next", reinterpret_cast<void *>(&__tocin_json_stream_next));
+            def("__tocin_json_stream_doc", reinterpret_cast<void *>(&__tocin_json_stream_doc));
+            def("__tocin_json_stream_close", reinterpret_cast<void *>(&__tocin_json_stream_close));
             def("__tocin_env_get", reinterpret_cast<void *>(&__tocin_env_get));
             def("__tocin_sys_exit", reinterpret_cast<void *>(&__tocin_sys_exit));
             def("__tocin_oob", reinterpret_cast<void *>(&__tocin_oob));
+            // --pgo-gen under the JIT: compiler-rt is not loaded, so stand in
+            // for the hooks instrumented code may reference (which ones depends
+            // on the target). Block counters are read back by
+            // PGOManager::saveProfile; value profiles are not collected.
+            if (profiling)
+            {
+                static int profileRuntimeHook = 0;
+                def("__llvm_profile_runtime", &profileRuntimeHook);
+                def("__llvm_profile_instrument_target",
+                    reinterpret_cast<void *>(&tocinProfileValueSite));
+                def("__llvm_profile_instrument_memop",
+                    reinterpret_cast<void *>(&tocinProfileValueSite));
+                def("__llvm_profile_register_function",
+                    reinterpret_cast<void *>(&tocinProfileRegister));
+                def("__llvm_profile_register_names_function",
+                    reinterpret_cast<void *>(&tocinProfileRegisterNames));
+            }
             llvm::cantFail(jit->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(rt))));
         }
 
@@ -776,30 +2352,22 @@ public:
                     llvm::orc::absoluteSymbols(std::move(mingwrt))));
         }
 #endif
+        return jit;
+    }
 
-        if (auto err = jit->addIRModule(
-                llvm::orc::ThreadSafeModule(std::move(module), std::move(context))))
-        {
-            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
-                                     "Failed to add module to JIT: " +
-                                         llvm::toString(std::move(err)),
-                                     filename, 0, 0);
-            return false;
-        }
-
-        auto mainSym = jit->lookup("main");
+    using MainFn = int64_t (*)();
+    MainFn lookupMain(llvm::orc::LLJIT& jit, const std::string& filename)
+    {
+        auto mainSym = jit.lookup("main");
         if (!mainSym)
         {
             errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
                                      "No 'main' function to execute: " +
                                          llvm::toString(mainSym.takeError()),
                                      filename, 0, 0);
-            return false;
+            return nullptr;
         }
-
-        auto* mainFn = mainSym->toPtr<int64_t (*)()>();
-        programExitCode = static_cast<int>(mainFn());
-        return true;
+        return mainSym->toPtr<MainFn>();
     }
 
     /**
@@ -824,6 +2392,33 @@ public:
         return targetTriple_.empty() ? llvm::sys::getDefaultTargetTriple() : targetTriple_;
     }
 
+    // The target settings createConfiguredTargetMachine() reads.
+    void configureTarget(const CompilationOptions& options)
+    {
+        useNativeCpu_ = options.nativeCpu;
+        targetTriple_ = options.targetTriple;
+        targetCpu_ = options.targetCpu;
+        targetFeatures_ = options.targetFeatures;
+        codeModel_ = options.codeModel;
+        relocModel_ = options.relocModel;
+        noRedZone_ = options.noRedZone;
+        wasmTarget_.reset();
+        // --target wasm fills in what --target-triple / --target-features
+        // leave empty. wasm objects are linked statically.
+        if (options.target == "wasm")
+        {
+            targets::WASMTargetConfig config;
+            config.enableThreads = options.wasmThreads;
+            wasmTarget_ = std::make_unique<targets::WASMTarget>(config);
+            if (targetTriple_.empty())
+                targetTriple_ = wasmTarget_->triple();
+            if (targetFeatures_.empty())
+                targetFeatures_ = wasmTarget_->features();
+            if (relocModel_.empty())
+                relocModel_ = "static";
+        }
+    }
+
     std::unique_ptr<llvm::TargetMachine> createConfiguredTargetMachine()
     {
         std::string triple = effectiveTriple();
@@ -855,39 +2450,278 @@ public:
 #endif
             for (auto& f : hostFeatures)
             {
-                if (!features.empty()) features += ",";
-                features += (f.second ? "+" : "-");
-                features += f.first().str();
+                if (!features.empty()) features += ",";
+                features += (f.second ? "+" : "-");
+                features += f.first().str();
+            }
+        }
+
+        // Reloc model: default PIC for hosted output, but a kernel usually wants
+        // static (no GOT/PLT, loaded at a fixed address).
+        std::optional<llvm::Reloc::Model> reloc = llvm::Reloc::PIC_;
+        if (relocModel_ == "static")             reloc = llvm::Reloc::Static;
+        else if (relocModel_ == "pic")           reloc = llvm::Reloc::PIC_;
+        else if (relocModel_ == "dynamic-no-pic") reloc = llvm::Reloc::DynamicNoPIC;
+
+        // Code model: the "kernel" model is the higher-half convention (kernel
+        // mapped in the top 2GB, sign-extended addressing).
+        std::optional<llvm::CodeModel::Model> cm;
+        if (codeModel_ == "tiny")        cm = llvm::CodeModel::Tiny;
+        else if (codeModel_ == "small")  cm = llvm::CodeModel::Small;
+        else if (codeModel_ == "kernel") cm = llvm::CodeModel::Kernel;
+        else if (codeModel_ == "medium") cm = llvm::CodeModel::Medium;
+        else if (codeModel_ == "large")  cm = llvm::CodeModel::Large;
+
+        llvm::TargetOptions opt;
+        // LLVM 21 changed createTargetMachine's first parameter from a triple
+        // string to an llvm::Triple. Guard so the same source builds on 18-22.
+#if LLVM_VERSION_MAJOR >= 21
+        llvm::TargetMachine* tm = target->createTargetMachine(
+            llvm::Triple(triple), cpu, features, opt, reloc, cm);
+#else
+        llvm::TargetMachine* tm = target->createTargetMachine(
+            triple, cpu, features, opt, reloc, cm);
+#endif
+        return std::unique_ptr<llvm::TargetMachine>(tm);
+    }
+
+    /**
+     * @brief -j N / --incremental: split the whole program into partitions,
+     *        then optimize and emit them on -j threads, one object each.
+     *
+     * -j partitions with SplitModule; --incremental makes one partition per
+     * source module (see partitionBySource) and reuses the cached object of
+     * every partition whose IR is unchanged. Either way every local is first
+     * externalized so partitions can reference each other, and the symbols no
+     * other partition references are made internal again, so each partition
+     * keeps the whole-program internalization for the code it owns; only
+     * calls across partitions lose inlining. Objects that are not cached are
+     * appended to @p temporaries for the caller to delete after linking.
+     */
+    bool emitPartitionedObjects(llvm::Module& module, const CompilationOptions& options,
+                                const std::string& outputPath, std::vector<std::string>& objects,
+                                std::vector<std::string>& temporaries)
+    {
+        std::set<std::string> locals;
+        for (auto& value : module.global_values())
+            if (value.hasLocalLinkage() && value.hasName())
+                locals.insert(value.getName().str());
+
+        std::vector<std::unique_ptr<llvm::Module>> parts;
+        if (options.incremental)
+            parts = partitionBySource(module);
+        else
+            llvm::SplitModule(module, options.jobs,
+                              [&](std::unique_ptr<llvm::Module> part) { parts.push_back(std::move(part)); },
+                              /*PreserveLocals=*/false);
+
+        // Every partition starts out declaring every symbol. Drop the unused
+        // declarations: they would change a partition's IR (and cache key)
+        // whenever anything is added elsewhere, and an unused hidden one is
+        // still emitted as an undefined symbol that fails the link.
+        std::set<std::string> imported;
+        for (auto& part : parts)
+        {
+            for (auto& function : llvm::make_early_inc_range(*part))
+                if (function.isDeclaration() && function.use_empty())
+                    function.eraseFromParent();
+            for (auto& global : llvm::make_early_inc_range(part->globals()))
+                if (global.isDeclaration() && global.use_empty())
+                    global.eraseFromParent();
+            for (auto& value : part->global_values())
+                if (value.isDeclaration() && value.hasName())
+                    imported.insert(value.getName().str());
+        }
+
+        // LLVMContext is single-threaded: hand each worker bitcode to parse
+        // into a context of its own.
+        const std::string cacheDir =
+            options.incremental ? tocin::compiler::JITObjectCache::defaultDirectory("obj") : "";
+        const std::string key = options.incremental ? codegenKey(options) : "";
+        std::vector<std::string> bitcode(parts.size());
+        std::vector<bool> cached(parts.size(), false);
+        for (size_t i = 0; i < parts.size(); ++i)
+        {
+            for (auto& value : parts[i]->global_values())
+            {
+                const std::string name = value.getName().str();
+                if (!value.isDeclaration() && locals.count(name) && !imported.count(name))
+                {
+                    value.setVisibility(llvm::GlobalValue::DefaultVisibility);
+                    value.setLinkage(llvm::GlobalValue::InternalLinkage);
+                }
+            }
+            llvm::raw_string_ostream out(bitcode[i]);
+            llvm::WriteBitcodeToFile(*parts[i], out);
+            out.flush();
+            if (options.incremental)
+            {
+                llvm::SmallString<256> path(cacheDir);
+                llvm::sys::path::append(
+                    path, tocin::compiler::JITObjectCache::hash(key + bitcode[i]) + ".o");
+                objects.push_back(std::string(path));
+                cached[i] = llvm::sys::fs::exists(path);
+            }
+            else
+            {
+                objects.push_back(outputPath + ".part" + std::to_string(i) + ".o");
+                temporaries.push_back(objects.back());
+            }
+        }
+        parts.clear();
+        if (options.incremental)
+            llvm::sys::fs::create_directories(cacheDir);
+
+        std::vector<std::string> errors(bitcode.size());
+        std::atomic<size_t> next{0};
+        // The calling thread traces into its own profiler; spawned workers
+        // need one each, merged into the same file when it is written.
+        bool tracing = llvm::timeTraceProfilerEnabled();
+        auto worker = [&](bool spawned) {
+            if (spawned && tracing)
+                llvm::timeTraceProfilerInitialize(options.timeTraceGranularity, "tocin");
+            for (size_t i; (i = next++) < bitcode.size();)
+            {
+                if (cached[i])
+                    continue;
+                llvm::LLVMContext context;
+                auto part = llvm::parseBitcodeFile(
+                    llvm::MemoryBufferRef(bitcode[i], objects[i]), context);
+                if (!part)
+                {
+                    errors[i] = llvm::toString(part.takeError());
+                    continue;
+                }
+                if (options.optimize)
+                    optimizeModule(**part, options.optimizationLevel);
+                if (!options.incremental)
+                {
+                    errors[i] = writeObjectFile(**part, objects[i], false);
+                    continue;
+                }
+                // Publish cache entries by rename so a concurrent build never
+                // links a half-written object.
+                std::string temp = objects[i] + ".tmp" +
+                                   std::to_string(llvm::sys::Process::getProcessId());
+                errors[i] = writeObjectFile(**part, temp, false);
+                if (errors[i].empty() && llvm::sys::fs::rename(temp, objects[i]))
+                    errors[i] = "could not write " + objects[i];
+                if (!errors[i].empty())
+                    llvm::sys::fs::remove(temp);
+            }
+            if (spawned && tracing)
+                llvm::timeTraceProfilerFinishThread();
+        };
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < std::min<size_t>(options.jobs, bitcode.size()); ++t)
+            threads.emplace_back(worker, true);
+        worker(false);
+        for (auto& thread : threads)
+            thread.join();
+
+        bool ok = true;
+        for (size_t i = 0; i < errors.size(); ++i)
+        {
+            if (errors[i].empty())
+                continue;
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "Partition " + std::to_string(i) + ": " + errors[i],
+                                     "", 0, 0);
+            ok = false;
+        }
+        if (!ok)
+            for (const auto& object : temporaries)
+                std::remove(object.c_str());
+        return ok;
+    }
+
+    /**
+     * @brief --incremental: one partition per source module.
+     *
+     * Top-level functions and methods belong to the file that declares them
+     * (IRGenerator::functionSources). Everything else (lambdas, thunks,
+     * generic instances, globals and string constants) follows its users when
+     * they all live in one partition. A generic instance used from several
+     * gets a partition of its own, so its cached object survives edits to
+     * every file that uses it; anything else joins the entry file's.
+     * Locals are externalized (hidden) the way SplitModule does it.
+     */
+    std::vector<std::unique_ptr<llvm::Module>> partitionBySource(llvm::Module& module)
+    {
+        std::map<std::string, unsigned> units{{module.getModuleIdentifier(), 0}};
+        std::map<const llvm::GlobalValue*, unsigned> owner;
+        for (auto& function : module)
+        {
+            auto it = functionSources_.find(function.getName().str());
+            if (function.isDeclaration() || it == functionSources_.end())
+                continue;
+            auto unit = units.emplace(it->second, static_cast<unsigned>(units.size())).first;
+            owner[&function] = unit->second;
+        }
+
+        // The partitions a value is used from; false if a user is unassigned.
+        std::function<bool(const llvm::Value*, std::set<unsigned>&)> usedFrom =
+            [&](const llvm::Value* value, std::set<unsigned>& found) {
+                for (const llvm::User* user : value->users())
+                {
+                    const llvm::GlobalValue* holder = nullptr;
+                    if (auto* inst = llvm::dyn_cast<llvm::Instruction>(user))
+                        holder = inst->getFunction();
+                    else if (auto* global = llvm::dyn_cast<llvm::GlobalValue>(user))
+                        holder = global;
+                    else if (!usedFrom(user, found))
+                        return false;
+                    if (!holder)
+                        continue;
+                    auto it = owner.find(holder);
+                    if (it == owner.end())
+                        return false;
+                    found.insert(it->second);
+                }
+                return true;
+            };
+        for (bool changed = true; changed;)
+        {
+            changed = false;
+            for (auto& value : module.global_values())
+            {
+                if (value.isDeclaration() || owner.count(&value))
+                    continue;
+                std::set<unsigned> found;
+                if (value.hasAppendingLinkage())
+                    found.insert(0);
+                else if (!usedFrom(&value, found) || found.empty())
+                    continue;
+                if (found.size() > 1 && genericInstances_.count(value.getName().str()))
+                    owner[&value] = units.emplace("<instance " + value.getName().str() + ">",
+                                                  static_cast<unsigned>(units.size())).first->second;
+                else
+                    owner[&value] = found.size() == 1 ? *found.begin() : 0;
+                changed = true;
             }
         }
 
-        // Reloc model: default PIC for hosted output, but a kernel usually wants
-        // static (no GOT/PLT, loaded at a fixed address).
-        std::optional<llvm::Reloc::Model> reloc = llvm::Reloc::PIC_;
-        if (relocModel_ == "static")             reloc = llvm::Reloc::Static;
-        else if (relocModel_ == "pic")           reloc = llvm::Reloc::PIC_;
-        else if (relocModel_ == "dynamic-no-pic") reloc = llvm::Reloc::DynamicNoPIC;
-
-        // Code model: the "kernel" model is the higher-half convention (kernel
-        // mapped in the top 2GB, sign-extended addressing).
-        std::optional<llvm::CodeModel::Model> cm;
-        if (codeModel_ == "tiny")        cm = llvm::CodeModel::Tiny;
-        else if (codeModel_ == "small")  cm = llvm::CodeModel::Small;
-        else if (codeModel_ == "kernel") cm = llvm::CodeModel::Kernel;
-        else if (codeModel_ == "medium") cm = llvm::CodeModel::Medium;
-        else if (codeModel_ == "large")  cm = llvm::CodeModel::Large;
+        for (auto& value : module.global_values())
+        {
+            if (value.hasLocalLinkage())
+            {
+                value.setLinkage(llvm::GlobalValue::ExternalLinkage);
+                value.setVisibility(llvm::GlobalValue::HiddenVisibility);
+            }
+            if (!value.hasName())
+                value.setName("__tocin_unit_unnamed");
+        }
 
-        llvm::TargetOptions opt;
-        // LLVM 21 changed createTargetMachine's first parameter from a triple
-        // string to an llvm::Triple. Guard so the same source builds on 18-22.
-#if LLVM_VERSION_MAJOR >= 21
-        llvm::TargetMachine* tm = target->createTargetMachine(
-            llvm::Triple(triple), cpu, features, opt, reloc, cm);
-#else
-        llvm::TargetMachine* tm = target->createTargetMachine(
-            triple, cpu, features, opt, reloc, cm);
-#endif
-        return std::unique_ptr<llvm::TargetMachine>(tm);
+        std::vector<std::unique_ptr<llvm::Module>> parts;
+        for (unsigned unit = 0; unit < units.size(); ++unit)
+        {
+            llvm::ValueToValueMapTy map;
+            parts.push_back(llvm::CloneModule(module, map, [&](const llvm::GlobalValue* value) {
+                auto it = owner.find(value);
+                return (it == owner.end() ? 0 : it->second) == unit;
+            }));
+        }
+        return parts;
     }
 
     /**
@@ -895,6 +2729,21 @@ public:
      */
     bool emitObjectFile(llvm::Module& module, const std::string& outputPath, bool asAssembly)
     {
+        std::string error = writeObjectFile(module, outputPath, asAssembly);
+        if (!error.empty())
+        {
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR, error, "", 0, 0);
+            return false;
+        }
+        return true;
+    }
+
+    // The body of emitObjectFile without error reporting, so -j workers can
+    // call it concurrently. Returns the error message, or "" on success.
+    std::string writeObjectFile(llvm::Module& module, const std::string& outputPath,
+                                bool asAssembly)
+    {
+        llvm::TimeTraceScope scope(asAssembly ? "Emit assembly" : "Emit object", outputPath);
         // Honor an explicit --target-triple so cross-compiled objects carry the
         // right triple (previously this always forced the host, silently
         // discarding the requested bare-metal target).
@@ -908,34 +2757,22 @@ public:
 
         auto targetMachine = createConfiguredTargetMachine();
         if (!targetMachine)
-        {
-            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
-                                     "Failed to create target machine for " + triple, "", 0, 0);
-            return false;
-        }
+            return "Failed to create target machine for " + triple;
         module.setDataLayout(targetMachine->createDataLayout());
 
         std::error_code EC;
         llvm::raw_fd_ostream dest(outputPath, EC, llvm::sys::fs::OF_None);
         if (EC)
-        {
-            errorHandler.reportError(error::ErrorCode::I003_READ_ERROR,
-                                     "Could not open output file: " + EC.message(), "", 0, 0);
-            return false;
-        }
+            return "Could not open output file: " + EC.message();
 
         llvm::legacy::PassManager pass;
         auto fileType = asAssembly ? llvm::CodeGenFileType::AssemblyFile
                                    : llvm::CodeGenFileType::ObjectFile;
         if (targetMachine->addPassesToEmitFile(pass, dest, nullptr, fileType))
-        {
-            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
-                                     "Target machine cannot emit this file type", "", 0, 0);
-            return false;
-        }
+            return "Target machine cannot emit this file type";
         pass.run(module);
         dest.flush();
-        return true;
+        return {};
     }
 
     /**
@@ -944,17 +2781,17 @@ public:
     // Result of attempting the self-contained bundled linker.
     enum class BundledLink { Ok, Failed, NotBundled };
 
-    // Link <objPath> -> <exePath> using a vendored ld.lld driven by a data-driven
+    // Link <objects> -> <exePath> using a vendored ld.lld driven by a data-driven
     // recipe shipped next to the compiler (libexec/link/). The recipe is an
     // ld.lld argument list (whitespace/newline separated) with placeholders:
     //   %LINKDIR% -> absolute path of the link/ bundle dir
-    //   %OBJ%     -> the input object
+    //   %OBJ%     -> the input object(s)
     //   %OUT%     -> the output executable
     // Returns NotBundled when no bundle is present (caller falls back to the C
     // driver), Ok on success, or Failed (error reported) when the bundled linker
     // is present but the link fails. Keeping the recipe as data means the link
     // line can be corrected without rebuilding the compiler.
-    BundledLink tryBundledLink(const std::string& objPath, const std::string& exePath)
+    BundledLink tryBundledLink(const std::vector<std::string>& objects, const std::string& exePath)
     {
         namespace fs = std::filesystem;
         std::string dir = tocinExecutableDir();
@@ -982,7 +2819,10 @@ public:
                 args.replace(p, key.size(), val);
         };
         substAll("%LINKDIR%", linkDir.string());
-        substAll("%OBJ%", objPath);
+        std::string objectList;
+        for (const auto& object : objects)
+            objectList += (objectList.empty() ? "" : " ") + object;
+        substAll("%OBJ%", objectList);
         substAll("%OUT%", exePath);
 
         // Pass the (possibly long) argument list via an @response file so command
@@ -1023,15 +2863,34 @@ public:
         return BundledLink::Ok;
     }
 
-    bool linkExecutable(const std::string& objPath, const std::string& exePath)
+    // compiler-rt's InstrProf runtime for --pgo-gen executables: $TOCIN_PROFILE_RT,
+    // else the archive found next to LLVM at configure time. "" if neither.
+    static std::string profileRuntimeLibrary()
+    {
+        if (const char* env = std::getenv("TOCIN_PROFILE_RT"); env && *env)
+            return env;
+#ifdef TOCIN_PROFILE_RT_LIB
+        return TOCIN_PROFILE_RT_LIB;
+#else
+        return {};
+#endif
+    }
+
+    bool linkExecutable(const std::vector<std::string>& objects, const std::string& exePath)
     {
+        llvm::TimeTraceScope scope("Link", exePath);
         // Prefer the self-contained bundled linker (vendored ld.lld + CRT/import
         // libs) so native output needs no external gcc/clang. Fall through to the
-        // C driver only when no bundle is present.
-        switch (tryBundledLink(objPath, exePath)) {
-            case BundledLink::Ok:         return true;
-            case BundledLink::Failed:     return false;
-            case BundledLink::NotBundled: break;
+        // C driver only when no bundle is present. The bundle's recipe has no
+        // slot for the profile runtime, so --pgo-gen always uses the C driver,
+        // as does --profile, which exports the executable's symbols.
+        if (!linkProfileRuntime_ && !exportSymbols_)
+        {
+            switch (tryBundledLink(objects, exePath)) {
+                case BundledLink::Ok:         return true;
+                case BundledLink::Failed:     return false;
+                case BundledLink::NotBundled: break;
+            }
         }
 
         // Pick a C toolchain driver to link with. $CC wins; otherwise probe the
@@ -1062,7 +2921,10 @@ public:
                                      "", 0, 0);
             return false;
         }
-        std::string cmd = cc + " \"" + objPath + "\" -o \"" + exePath + "\"";
+        std::string cmd = cc;
+        for (const auto& object : objects)
+            cmd += " \"" + object + "\"";
+        cmd += " -o \"" + exePath + "\"";
         // Link the Tocin runtime (channels/goroutines) so programs that use
         // concurrency resolve their __tocin_* calls.
 #ifdef TOCIN_RUNTIME_LIB
@@ -1072,7 +2934,36 @@ public:
 #ifdef TOCIN_GC_LIB
         cmd += std::string(" \"") + TOCIN_GC_LIB + "\"";
 #endif
-        cmd += " -lm -lpthread -lstdc++";
+        // Instrumented code registers nothing itself; the profile runtime
+        // finds the counter sections and writes the .profraw at exit. On
+        // Linux the hook object is only pulled in by an explicit -u.
+        if (linkProfileRuntime_) {
+            std::string profileRt = profileRuntimeLibrary();
+            if (profileRt.empty()) {
+                errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                         "--pgo-gen needs compiler-rt's profile runtime "
+                                         "(libclang_rt.profile); set TOCIN_PROFILE_RT to its path, "
+                                         "or collect the profile with --run",
+                                         "", 0, 0);
+                return false;
+            }
+            cmd += " \"" + profileRt + "\"";
+#if defined(__linux__)
+            cmd += " -u__llvm_profile_runtime";
+#endif
+        }
+        // The sampling profiler names native frames with dladdr, which only
+        // sees exported symbols.
+#if !defined(_WIN32)
+        if (exportSymbols_)
+            cmd += " -rdynamic";
+#endif
+        // zlib backs the runtime's WebSocket permessage-deflate and the
+        // profiler's pprof output; libdl its symbolization (glibc < 2.34).
+        cmd += " -lz -lm -lpthread -lstdc++";
+#if defined(__linux__)
+        cmd += " -ldl";
+#endif
         int rc = std::system(cmd.c_str());
         if (rc != 0)
         {
@@ -1085,56 +2976,29 @@ public:
         return true;
     }
 
-    bool compileToWASM(ast::StmtPtr program, const std::string& filename,
-                       const CompilationOptions& options)
+    /**
+     * @brief Link wasm objects into a .wasm module with the WASI toolchain.
+     */
+    bool linkWasm(const std::vector<std::string>& objects, const std::string& wasmPath)
     {
-#ifdef WITH_WASM
-        targets::WASMTargetConfig config;
-        config.optimize = options.optimize;
-        config.enableSIMD = true;
-        config.enableExceptionHandling = true;
-        
-        auto target = std::make_unique<targets::WASMTarget>(config);
-        std::string wasmCode = target->generateWASM(program, errorHandler);
-        
-        if (errorHandler.hasFatalErrors() || wasmCode.empty())
+        llvm::TimeTraceScope scope("Link", wasmPath);
+        std::string error;
+        std::string cmd = wasmTarget_->linkCommand(objects, wasmPath, error);
+        if (cmd.empty())
         {
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR, error, "", 0, 0);
             return false;
         }
-
-        // Optimize WASM if requested
-        if (options.optimize) {
-            wasmCode = target->optimizeWASM(wasmCode);
-        }
-
-        // Validate WASM
-        if (!target->validateWASM(wasmCode, errorHandler)) {
+        int rc = std::system(cmd.c_str());
+        if (rc != 0)
+        {
+            errorHandler.reportError(error::ErrorCode::C002_CODEGEN_ERROR,
+                                     "Linker failed (exit " + std::to_string(rc) +
+                                         "): " + cmd,
+                                     "", 0, 0);
             return false;
         }
-
-        // Write WASM output
-        if (!options.outputFile.empty()) {
-            std::string outputPath = options.outputFile;
-            if (outputPath.find('.') == std::string::npos) {
-                outputPath += ".wasm";
-            }
-
-            std::ofstream outputFile(outputPath);
-            if (!outputFile.is_open()) {
-                errorHandler.reportError(error::ErrorCode::I003_READ_ERROR,
-                                       "Could not open output file: " + outputPath,
-                                       filename, 0, 0);
-                return false;
-            }
-
-            outputFile << wasmCode;
-        }
-
-        return !errorHandler.hasFatalErrors();
-#else
-        (void)program; (void)filename; (void)options;
-        return false;
-#endif
+        return true;
     }
 
     // Package manager methods
@@ -1223,15 +3087,34 @@ private:
     std::string codeModel_;       // --code-model
     std::string relocModel_;      // --reloc
     bool noRedZone_ = false;      // --no-red-zone
+    std::unique_ptr<targets::WASMTarget> wasmTarget_; // --target wasm; null for native
+    bool linkProfileRuntime_ = false; // --pgo-gen native output: link compiler-rt profile
+    bool exportSymbols_ = false;  // --profile native output: -rdynamic, for dladdr
+    bool observeJIT_ = false;     // --profile / --perf-map: JIT on RTDyld with listeners
+    bool perfMap_ = false;        // --perf-map
+    std::string profilePath_;     // --profile under the JIT ("" = off)
+    std::unique_ptr<tocin::compiler::JITObjectCache> jitCache_; // --run object cache (null = off)
+    std::vector<std::string> importedFiles_;  // modules merged by resolveImports
+    std::vector<std::string> stdlibObjects_;  // precompiled stdlib modules to link
+    std::vector<std::string> stdlibBitcode_;  //   and their bitcode, for inlining
+    std::unique_ptr<tocin::compiler::HotReloadSession> hotReload_; // --watch, while running
+    std::unique_ptr<llvm::orc::LLJIT> replJit_;                      // the REPL's session,
+    std::unique_ptr<tocin::compiler::HotReloadSession> replSession_; //   destroyed first
+    std::map<std::string, std::string> functionSources_; // --incremental partitioning
+    std::set<std::string> genericInstances_;             // ditto: monomorphized functions
+    std::set<const ast::VariableStmt *> uniqueOwners_;    // --memory=owned: from the borrow checker
+    std::unique_ptr<llvm::MemoryBuffer> runtimeBitcode_;  // tocin_runtime_inline.bc, once read
+    bool runtimeBitcodeRead_ = false;                     //   (null if missing or unreadable)
+    std::vector<std::string> runtimeBitcodeFunctions_;    // what the last link defined
+    // Parsed imports for every compile() of this compiler (REPL, rebuilds).
+    std::shared_ptr<tocin::compiler::ModuleCache> moduleCache_ =
+        std::make_shared<tocin::compiler::ModuleCache>();
     type_checker::FeatureManager featureManager;
     std::unique_ptr<compiler::MacroSystem> macroSystem;
     std::unique_ptr<runtime::AsyncSystem> asyncSystem;
 #ifdef WITH_DEBUGGER
     std::unique_ptr<debugger::Debugger> debugger;
 #endif
-#ifdef WITH_WASM
-    std::unique_ptr<targets::WASMTarget> wasmTarget;
-#endif
 #ifdef WITH_PACKAGE_MANAGER
     std::unique_ptr<package::PackageManager> packageManager;
 #endif
@@ -1247,7 +3130,114 @@ private:
         return source; // Placeholder
     }
 
-    void optimizeModule(llvm::Module &module, int level)
+    // The runtime bitcode: $TOCIN_RUNTIME_BC, else the file built next to
+    // the runtime at configure time. "" if neither.
+    static std::string runtimeBitcodePath()
+    {
+        if (const char* env = std::getenv("TOCIN_RUNTIME_BC"); env && *env)
+            return env;
+#ifdef TOCIN_RUNTIME_BC
+        return TOCIN_RUNTIME_BC;
+#else
+        return {};
+#endif
+    }
+
+    // Link the runtime functions `module` calls from tocin_runtime_inline.bc
+    // (inline_abi.cpp) into it, with their target-cpu/features attributes
+    // dropped so they inline into code built for any CPU. The external
+    // functions it defines as a result are left in runtimeBitcodeFunctions_. A missing or
+    // unreadable file, or a module for another architecture, links nothing:
+    // the calls stay external, as without the bitcode.
+    void linkRuntimeBitcode(llvm::Module &module)
+    {
+        runtimeBitcodeFunctions_.clear();
+        if (!runtimeBitcodeRead_)
+        {
+            runtimeBitcodeRead_ = true;
+            std::string path = runtimeBitcodePath();
+            if (!path.empty())
+                if (auto buffer = llvm::MemoryBuffer::getFile(path))
+                    runtimeBitcode_ = std::move(*buffer);
+        }
+        if (!runtimeBitcode_)
+            return;
+        auto parsed = llvm::parseBitcodeFile(runtimeBitcode_->getMemBufferRef(), module.getContext());
+        if (!parsed)
+        {
+            llvm::consumeError(parsed.takeError());
+            return;
+        }
+        std::unique_ptr<llvm::Module> runtime = std::move(*parsed);
+        llvm::Triple want(module.getTargetTriple()), have(runtime->getTargetTriple());
+        if (want.getArch() != have.getArch() || want.getOS() != have.getOS())
+            return;
+        runtime->setTargetTriple(module.getTargetTriple());
+        runtime->setDataLayout(module.getDataLayout());
+
+        std::vector<std::string> exported;
+        bool needed = false;
+        for (auto &F : *runtime)
+        {
+            if (F.isDeclaration())
+                continue;
+            F.removeFnAttr("target-cpu");
+            F.removeFnAttr("target-features");
+            F.removeFnAttr("tune-cpu");
+            if (F.hasExternalLinkage())
+            {
+                exported.push_back(F.getName().str());
+                needed = needed || module.getFunction(F.getName());
+            }
+        }
+        if (!needed ||
+            llvm::Linker::linkModules(module, std::move(runtime), llvm::Linker::Flags::LinkOnlyNeeded))
+            return;
+        // Everything pulled in, including what the requested functions call.
+        for (auto &name : exported)
+            if (llvm::Function *F = module.getFunction(name); F && !F->isDeclaration())
+                runtimeBitcodeFunctions_.push_back(std::move(name));
+    }
+
+    // Link the functions `module` calls from each precompiled stdlib
+    // module's bitcode (stdlibBitcode_; see prepareInlineBitcode) as
+    // available_externally: the optimizer may inline them, and calls it
+    // leaves go to the module's object. Unreadable bitcode links nothing.
+    void linkStdlibBitcode(llvm::Module &module)
+    {
+        for (const auto &path : stdlibBitcode_)
+        {
+            auto buffer = llvm::MemoryBuffer::getFile(path);
+            if (!buffer)
+                continue;
+            auto parsed = llvm::parseBitcodeFile((*buffer)->getMemBufferRef(), module.getContext());
+            if (!parsed)
+            {
+                llvm::consumeError(parsed.takeError());
+                continue;
+            }
+            std::unique_ptr<llvm::Module> precompiled = std::move(*parsed);
+            std::vector<std::string> exported;
+            bool needed = false;
+            for (auto &F : *precompiled)
+            {
+                if (F.isDeclaration() || !F.hasExternalLinkage())
+                    continue;
+                exported.push_back(F.getName().str());
+                needed = needed || module.getFunction(F.getName());
+            }
+            if (!needed || llvm::Linker::linkModules(module, std::move(precompiled),
+                                                     llvm::Linker::Flags::LinkOnlyNeeded))
+                continue;
+            for (const auto &name : exported)
+                if (llvm::Function *F = module.getFunction(name); F && !F->isDeclaration())
+                    F->setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+        }
+    }
+
+    void optimizeModule(llvm::Module &module, int level,
+                        tocin::optimization::AdvancedOptimizationPipeline *advanced = nullptr,
+                        tocin::optimization::BoundsCheckStats *boundsChecks = nullptr)
     {
         // A TargetMachine threads host-CPU info (TargetTransformInfo) into the
         // middle-end. Without it the optimizer assumes a baseline CPU, so the
@@ -1271,14 +3261,45 @@ private:
             module.setDataLayout(targetMachine->createDataLayout());
         }
 
-        // Create a function pass manager
-        llvm::PassBuilder passBuilder(targetMachine.get());
+        // Create a function pass manager. With --pgo-gen / --pgo-use the
+        // PGO options make the pipeline itself instrument the module or
+        // annotate it with the profile's block and branch weights.
+        // MergeFunctions folds functions that compile to the same code -
+        // chiefly generic instances for different classes.
+        llvm::PipelineTuningOptions tuning;
+        tuning.MergeFunctions = level >= 2;
+        // --time-trace: a span per pass run, nested in this one.
+        llvm::TimeTraceScope scope("Optimize", module.getModuleIdentifier());
+        llvm::PassInstrumentationCallbacks instrumentation;
+        llvm::TimeProfilingPassesHandler passTimes;
+        if (llvm::timeTraceProfilerEnabled())
+            passTimes.registerCallbacks(instrumentation);
+        llvm::PassBuilder passBuilder(targetMachine.get(), tuning,
+                                      advanced ? advanced->getPGOOptions() : std::nullopt,
+                                      &instrumentation);
+
+        // Array bounds checks the loops no longer need go first, right before
+        // the vectorizers, so interchange and vectorization see the loops
+        // without them.
+        tocin::optimization::registerBoundsCheckElimination(passBuilder, boundsChecks);
+
+        // IPO rewrites the module ahead of the O-pipeline; the loop-nest
+        // passes hook into it right before the vectorizers.
+        if (advanced)
+        {
+            llvm::TimeTraceScope advancedScope("Advanced passes before pipeline");
+            advanced->setTargetMachine(targetMachine.get());
+            advanced->optimizeBeforePipeline(&module);
+            advanced->registerPassBuilderCallbacks(passBuilder);
+        }
+        const bool polyhedralLoops = advanced && advanced->polyhedralEnabled();
 
         // GCC turns the classic i-j-k matmul into a vectorizable kernel with
         // loop interchange at -O3; LLVM ships the pass but keeps it out of the
         // default pipeline. Run it right before the vectorizers at -O3 so
         // column-strided inner loops become contiguous and vectorize.
-        if (level >= 3)
+        // --polyhedral already schedules it (with fusion and unroll-and-jam).
+        if (level >= 3 && !polyhedralLoops)
         {
             passBuilder.registerVectorizerStartEPCallback(
                 [](llvm::FunctionPassManager &FPM, llvm::OptimizationLevel) {
@@ -1324,6 +3345,14 @@ private:
 
         // Run the optimizations
         MPM.run(module, MAM);
+
+        // LTO runs on the fully optimized whole program (internalized above).
+        if (advanced)
+        {
+            llvm::TimeTraceScope advancedScope("Advanced passes after pipeline");
+            advanced->optimizeAfterPipeline(&module);
+            advanced->setTargetMachine(nullptr);
+        }
     }
 };
 
@@ -1336,18 +3365,58 @@ void displayUsage()
               << "       tocin check <file.to>   Typecheck only (no codegen); exit 0 if clean\n"
               << "       tocin new <name>        Scaffold a new project directory\n"
               << "       tocin doc <file.to>     Generate Markdown API docs to stdout\n"
+              << "       tocin precompile [opts] Precompile the stdlib for these options\n"
               << "Options:\n"
               << "  --help, -h             Display this help message\n"
               << "  --version, -V          Print the compiler version and exit\n"
               << "  --dump-ir              Dump LLVM IR to stdout\n"
               << "  --jit, --run           JIT-compile and run the program immediately\n"
+              << "  --lazy-jit             --run, compiling each function on its first call\n"
+              << "  --tiered-jit[=<calls>] --run at -O0, re-optimizing functions called <calls> times\n"
+              << "                         (default 1000) on a background thread\n"
+              << "  --watch                --run, recompiling on save and swapping changed functions\n"
+              << "                         into the running program\n"
+              << "  --no-jit-cache         Always recompile for --run (ignore $TOCIN_CACHE_DIR)\n"
+              << "  --no-runtime-inline    Do not link the runtime's bitcode into optimized modules\n"
+              << "  --no-stdlib-cache      Compile imported stdlib modules from source instead of\n"
+              << "                           their precompiled objects\n"
               << "  -O0, -O1, -O2, -O3     Set optimization level (default: -O2)\n"
+              << "  -j <n>                 Type-check function bodies on <n> threads; optimize and emit\n"
+              << "                           executables in <n> parallel partitions\n"
+              << "                           (-j0 = one per hardware thread; default 1)\n"
+              << "  --incremental          Cache one object per source module; rebuild only changed ones\n"
+              << "  --ipo                  Interprocedural pass (devirtualize, IPSCCP, inline)\n"
+              << "  --polyhedral           Loop fusion, interchange and unroll-and-jam\n"
+              << "  --lto                  Run the whole-program LTO pipeline after -O\n"
+              << "  --pgo-gen[=<file>]     Instrument for PGO; the run writes <file>\n"
+              << "                           (default_%m.profraw, or default.proftext with --run)\n"
+              << "  --pgo-use=<file>       Optimize with an llvm-profdata-merged .profdata\n"
+              << "  --opt-stats            Print advanced-optimization statistics to stderr\n"
+              << "  --time-trace[=<file>]  Write a Chrome trace of compile phases and LLVM passes to\n"
+              << "                           <file> (default <output or input>.time-trace)\n"
+              << "  --time-trace-granularity=<us>\n"
+              << "                         Drop spans shorter than <us> microseconds (default 500)\n"
+              << "  --bounds-check-stats   Report array bounds checks removed or hoisted out of loops\n"
+              << "  --profile[=<file>]     Sample the CPU time of a --run into <file>: folded stacks,\n"
+              << "                           or pprof for *.pb.gz (default profile.folded). With -o,\n"
+              << "                           build for TOCIN_PROFILE=<file> ./app instead\n"
+              << "  --perf-map             List JIT'd functions in /tmp/perf-<pid>.map for perf\n"
               << "  -o <file>              Write output to <file>. Extension selects format:\n"
               << "                           .ll = LLVM IR, .s = assembly, .o = object,\n"
-              << "                           anything else = native executable\n"
-              << "  --target <target>      Set compilation target (native, wasm)\n"
+              << "                           anything else = native executable (.wasm module\n"
+              << "                           with --target wasm)\n"
+              << "  --target <target>      native (default), or wasm: the optimized program through\n"
+              << "                           LLVM's wasm32 backend with SIMD128 and bulk memory,\n"
+              << "                           linked by the WASI SDK's clang ($WASI_SDK_PATH)\n"
+              << "  --wasm-threads         With --target wasm: atomics and a shared memory\n"
               << "  --borrow-check         Enable opt-in ownership / use-after-move checking\n"
+              << "  --memory=<mode>        gc (default) or owned: also free the class instances\n"
+              << "                           --borrow-check proves uniquely owned when their\n"
+              << "                           function returns; the collector keeps the rest\n"
               << "  --native               Tune native output for this CPU (POPCNT/AVX/...); not portable\n"
+              << "  --multiversion[=<l,..>] Also build functions with vectorizable loops for these\n"
+              << "                           x86-64 levels (avx512, avx2, sse4; default avx512,avx2),\n"
+              << "                           picked on the running CPU at the first call\n"
               << "  --permissive           Print type errors but compile anyway (not recommended)\n"
               << "  --freestanding         Emit a no-libc/no-GC object for kernel/bare-metal\n"
               << "  --no-gc                Do not link the garbage collector (alloc -> malloc)\n"
@@ -1363,7 +3432,7 @@ void displayUsage()
               << "  --no-advanced          Disable advanced language features\n"
               << "  --no-macros            Disable macro system\n"
               << "  --no-async             Disable async/await\n"
-              << "  --debug                Enable debugger support\n"
+              << "  --debug                Enable debugger support and tracepoints (TOCIN_TRACE)\n"
               << "  --enable-python        Enable Python FFI (if available)\n"
               << "  --enable-javascript    Enable JavaScript FFI\n"
               << "  --enable-cpp           Enable C++ FFI\n"
@@ -1384,118 +3453,213 @@ void displayUsage()
               << std::endl;
 }
 
+// Net `{` minus `}` outside string literals and comments, to tell when a
+// multi-line REPL input is complete.
+static int replBraceDepth(const std::string &text)
+{
+    int depth = 0;
+    char quote = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        char c = text[i];
+        if (quote)
+        {
+            if (c == '\\')
+                ++i;
+            else if (c == quote)
+                quote = 0;
+        }
+        else if (c == '"' || c == '\'')
+            quote = c;
+        else if (c == '/' && i + 1 < text.size() && text[i + 1] == '/')
+            i = text.find('\n', i) == std::string::npos ? text.size() : text.find('\n', i);
+        else if (c == '{')
+            ++depth;
+        else if (c == '}')
+            --depth;
+    }
+    return depth;
+}
+
+// The identifier at the start of text (after spaces), or "".
+static std::string replLeadingName(const std::string &text)
+{
+    size_t b = text.find_first_not_of(" \t");
+    if (b == std::string::npos)
+        return "";
+    size_t e = b;
+    while (e < text.size() && (std::isalnum((unsigned char)text[e]) || text[e] == '_'))
+        ++e;
+    return text.substr(b, e - b);
+}
+
 /**
  * @brief Enhanced REPL with all new features
+ *
+ * Definitions (functions, types, imports) and top-level `let`s accumulate
+ * as the session's program, a later definition of a name replacing the
+ * earlier one; anything else runs once, as the body of a fresh function.
+ * Each input is compiled with the session so far and loaded into one
+ * tiered JIT session (runReplInput), which compiles only what changed,
+ * keeps global values across inputs and re-optimizes functions that get
+ * hot. A `let` is bound when it is entered: its initializer runs as an
+ * assignment in that input's entry function.
  */
 void runEnhancedRepl(EnhancedCompiler &compiler, error::ErrorHandler &errorHandler)
 {
     std::string line;
     EnhancedCompiler::CompilationOptions options;
-    options.dumpIR = true;
     options.enableFFI = true;
     options.enableConcurrency = true;
     options.enableAdvancedFeatures = true;
     options.enableMacros = true;
     options.enableAsync = true;
-    options.optimize = true;
-    options.optimizationLevel = 2;
+    options.run = true;
+    options.repl = true;
+    options.optimizationLevel = 2; // the tier hot functions are promoted to
 
-    // Initialize REPL state
-    static int replCounter = 0;
-    std::string replState;
+    // The session's program: (key, source) in entry order. A definition's
+    // key is its kind and name, so redefining replaces it in place.
+    std::vector<std::pair<std::string, std::string>> definitions;
+    int replCounter = 0;
+    std::string pending;
 
     std::cout << "Tocin Enhanced REPL (type 'exit' to quit, 'clear' to reset)\n"
               << "Commands: debug, package, async, macro\n> ";
 
     while (std::getline(std::cin, line))
     {
-        if (line == "exit" || line == "quit")
-            break;
-        if (line == "clear")
+        if (pending.empty())
         {
-            errorHandler.clearErrors();
-            replState.clear();
-            replCounter = 0;
-            std::cout << "> ";
-            continue;
-        }
+            if (line == "exit" || line == "quit")
+                break;
+            if (line == "clear")
+            {
+                errorHandler.clearErrors();
+                definitions.clear();
+                compiler.resetRepl();
+                replCounter = 0;
+                std::cout << "> ";
+                continue;
+            }
 
-        // Handle special commands
-        if (line == "debug") {
-            std::cout << "Debugger commands: break, step, continue, variables, stack\n";
-            std::cout << "> ";
-            continue;
-        }
-        if (line == "package") {
-            std::cout << "Package commands: install, uninstall, search, list\n";
-            std::cout << "> ";
-            continue;
-        }
-        if (line == "async") {
-            std::cout << "Async commands: await, future, promise\n";
-            std::cout << "> ";
-            continue;
+            // Handle special commands
+            if (line == "debug") {
+                std::cout << "Debugger commands: break, step, continue, variables, stack\n";
+                std::cout << "> ";
+                continue;
+            }
+            if (line == "package") {
+                std::cout << "Package commands: install, uninstall, search, list\n";
+                std::cout << "> ";
+                continue;
+            }
+            if (line == "async") {
+                std::cout << "Async commands: await, future, promise\n";
+                std::cout << "> ";
+                continue;
+            }
+            if (line == "macro") {
+                std::cout << "Macro commands: define, expand, list\n";
+                std::cout << "> ";
+                continue;
+            }
         }
-        if (line == "macro") {
-            std::cout << "Macro commands: define, expand, list\n";
-            std::cout << "> ";
+
+        // An input with open braces continues on the next line.
+        pending += line + "\n";
+        if (replBraceDepth(pending) > 0)
+        {
+            std::cout << "... ";
             continue;
         }
+        std::string input = pending;
+        pending.clear();
 
         // Trim whitespace
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
-        
-        if (line.empty())
+        input.erase(0, input.find_first_not_of(" \t\r\n"));
+        input.erase(input.find_last_not_of(" \t\r\n") + 1);
+
+        if (input.empty())
         {
             std::cout << "> ";
             continue;
         }
 
-        // Create a proper module for each REPL input
-        std::string moduleSource;
-        
-        // Handle variable declarations and expressions
-        if (line.find("let ") == 0 || line.find("const ") == 0)
-        {
-            // Variable declaration
-            if (line.back() != ';')
-                line += ";";
-            moduleSource = replState + "\n" + line;
-        }
-        else if (line.find("def ") == 0 || line.find("class ") == 0 || 
-                 line.find("trait ") == 0 || line.find("import ") == 0)
+        // Classify the input: a definition (keyed), a `let`, or code to run.
+        std::string head = replLeadingName(input);
+        std::string rest = input.substr(input.find(head) + head.size());
+        std::string key;
+        std::string entryBody;
+        if (head == "let" || head == "const")
         {
-            // Definition or import statement
-            moduleSource = replState + "\n" + line;
+            if (input.back() != ';')
+                input += ";";
+            std::string name = replLeadingName(rest);
+            size_t eq = input.find('=');
+            if (!name.empty() && eq != std::string::npos && input.compare(eq, 2, "==") != 0)
+            {
+                key = "let:" + name;
+                entryBody = name + " = " + input.substr(eq + 1);
+            }
+            else
+            {
+                entryBody = input;  // no simple name to bind: run it as a local
+            }
         }
         else
         {
-            // Expression - wrap in a main function if needed
-            if (line.back() != ';')
-                line += ";";
-            
-            // Create a temporary function to evaluate the expression
-            std::string funcName = "repl_expr_" + std::to_string(replCounter++);
-            moduleSource = replState + "\n" +
-                         "def " + funcName + "() {\n" +
-                         "    " + line + "\n" +
-                         "}\n" +
-                         funcName + "();";
+            // Function qualifiers come before `def`.
+            while (head == "naked" || head == "interrupt" || head == "memoize")
+            {
+                head = replLeadingName(rest);
+                rest = rest.substr(rest.find(head) + head.size());
+            }
+            if (head == "def" || head == "async" || head == "class" || head == "struct" ||
+                head == "trait" || head == "enum" || head == "extern")
+            {
+                if (head == "async" || head == "extern")
+                    rest = rest.substr(rest.find("def") + 3);
+                key = "def:" + replLeadingName(rest);
+            }
+            else if (head == "impl" || head == "import")
+            {
+                key = input;  // identical text is the same definition
+            }
+            else
+            {
+                if (input.back() != ';' && input.back() != '}')
+                    input += ";";
+                entryBody = input;
+            }
         }
 
-        // Compile the current state
-        if (compiler.compile(moduleSource, "<repl>", options))
+        auto next = definitions;
+        if (!key.empty())
         {
-            // Update REPL state with successful compilation
-            replState = moduleSource;
+            auto it = std::find_if(next.begin(), next.end(),
+                                   [&](const auto &d) { return d.first == key; });
+            if (it != next.end())
+                it->second = input;
+            else
+                next.emplace_back(key, input);
         }
-        else
+
+        std::string moduleSource;
+        for (const auto &d : next)
+            moduleSource += d.second + "\n";
+        options.replEntry.clear();
+        if (!entryBody.empty())
         {
-            // Clear errors but keep the previous state
-            errorHandler.clearErrors();
+            options.replEntry = "repl_expr_" + std::to_string(replCounter++);
+            moduleSource += "def " + options.replEntry + "() {\n    " + entryBody + "\n}\n";
         }
 
+        if (compiler.compile(moduleSource, "<repl>", options))
+            definitions = std::move(next);
+        else
+            errorHandler.clearErrors();  // keep the previous state
+
         std::cout << "> ";
     }
 }
@@ -1536,11 +3700,19 @@ int main(int argc, char *argv[])
     // `tocin new name` scaffolds a project directory.
     int argStart = 1;
     bool checkOnly = false;
+    bool precompileOnly = false;
     if (argc >= 2 && std::string(argv[1]) == "check")
     {
         checkOnly = true;
         argStart = 2;
     }
+    else if (argc >= 2 && std::string(argv[1]) == "precompile")
+    {
+        // `tocin precompile [options]`: build every precompilable stdlib
+        // module for the options a later build will use.
+        precompileOnly = true;
+        argStart = 2;
+    }
     else if (argc >= 3 && std::string(argv[1]) == "doc")
     {
         // `tocin doc file.to` — generate Markdown API docs from top-level
@@ -1561,8 +3733,7 @@ int main(int argc, char *argv[])
                 lines.push_back(l);
         }
         lexer::Lexer lx(src, docFile, 4);
-        auto toks = lx.tokenize();
-        parser::Parser ps(toks);
+        parser::Parser ps(lx);
         auto program = ps.parse();
         if (!program || errorHandler.hasFatalErrors())
         {
@@ -1601,36 +3772,36 @@ int main(int argc, char *argv[])
         };
         std::cout << "# " << docFile << "\n\n";
         std::vector<ast::StmtPtr> top;
-        if (auto blk = std::dynamic_pointer_cast<ast::BlockStmt>(program)) top = blk->statements;
+        if (auto *blk = ast::dyn_cast<ast::BlockStmt>(program)) top = blk->statements;
         else top.push_back(program);
         for (auto &s : top)
         {
-            if (auto fn = std::dynamic_pointer_cast<ast::FunctionStmt>(s))
+            if (auto *fn = ast::dyn_cast<ast::FunctionStmt>(s))
             {
                 if (fn->name.rfind("__", 0) == 0)
                     continue;   // internal helpers stay out of the docs
-                std::cout << "### `" << signatureOf(fn.get()) << "`\n\n";
+                std::cout << "### `" << signatureOf(fn) << "`\n\n";
                 std::string d = docAbove(fn->token.line);
                 if (!d.empty()) std::cout << d << "\n\n";
             }
-            else if (auto cls = std::dynamic_pointer_cast<ast::ClassStmt>(s))
+            else if (auto *cls = ast::dyn_cast<ast::ClassStmt>(s))
             {
                 std::cout << "## class `" << cls->name << "`\n\n";
                 std::string d = docAbove(cls->token.line);
                 if (!d.empty()) std::cout << d << "\n\n";
                 for (auto &m : cls->methods)
-                    if (auto mf = std::dynamic_pointer_cast<ast::FunctionStmt>(m))
-                        std::cout << "- `" << signatureOf(mf.get()) << "`\n";
+                    if (auto *mf = ast::dyn_cast<ast::FunctionStmt>(m))
+                        std::cout << "- `" << signatureOf(mf) << "`\n";
                 std::cout << "\n";
             }
-            else if (auto en = std::dynamic_pointer_cast<ast::EnumStmt>(s))
+            else if (auto *en = ast::dyn_cast<ast::EnumStmt>(s))
             {
                 std::cout << "## enum `" << en->name << "`\n\n";
                 for (auto &m : en->members)
                     std::cout << "- `" << m.first << "`\n";
                 std::cout << "\n";
             }
-            else if (auto var = std::dynamic_pointer_cast<ast::VariableStmt>(s))
+            else if (auto *var = ast::dyn_cast<ast::VariableStmt>(s))
             {
                 if (var->isConstant)
                     std::cout << "- const `" << var->name
@@ -1702,6 +3873,40 @@ int main(int argc, char *argv[])
         {
             options.run = true;
         }
+        else if (arg == "-j" || (arg.rfind("-j", 0) == 0 && arg.size() > 2))
+        {
+            std::string count = arg.size() > 2 ? arg.substr(2)
+                                : i + 1 < argc ? std::string(argv[++i]) : std::string();
+            unsigned long jobs = std::strtoul(count.c_str(), nullptr, 10);
+            // -j0: one partition per hardware thread.
+            options.jobs = jobs ? static_cast<unsigned>(jobs)
+                                : std::max(1u, std::thread::hardware_concurrency());
+        }
+        else if (arg == "--incremental")
+        {
+            options.incremental = true;
+        }
+        else if (arg == "--time-trace" || arg.rfind("--time-trace=", 0) == 0)
+        {
+            options.timeTrace = true;
+            if (arg.size() > 13)
+                options.timeTraceFile = arg.substr(13);
+        }
+        else if (arg == "--profile" || arg.rfind("--profile=", 0) == 0)
+        {
+            options.profile = true;
+            if (arg.size() > 10)
+                options.profilePath = arg.substr(10);
+        }
+        else if (arg == "--perf-map")
+        {
+            options.perfMap = true;
+        }
+        else if (arg.rfind("--time-trace-granularity=", 0) == 0)
+        {
+            options.timeTraceGranularity =
+                static_cast<unsigned>(std::strtoul(arg.c_str() + 25, nullptr, 10));
+        }
         else if (arg == "-O0")
         {
             options.optimize = true;
@@ -1722,6 +3927,65 @@ int main(int argc, char *argv[])
             options.optimize = true;
             options.optimizationLevel = 3;
         }
+        else if (arg.rfind("--pgo-gen=", 0) == 0)
+        {
+            options.pgoGen = true;
+            options.pgoGenPath = arg.substr(10);
+            options.optimize = true;
+        }
+        else if (arg == "--ipo" || arg == "--polyhedral" || arg == "--lto" ||
+                 arg == "--pgo-gen" || arg == "--opt-stats")
+        {
+            // Advanced passes run inside optimizeModule, so they imply -O2
+            // unless a level was already chosen.
+            if (arg == "--ipo") options.ipo = true;
+            else if (arg == "--polyhedral") options.polyhedral = true;
+            else if (arg == "--lto") options.lto = true;
+            else if (arg == "--pgo-gen") options.pgoGen = true;
+            else options.optStats = true;
+            options.optimize = true;
+        }
+        else if (arg == "--bounds-check-stats")
+        {
+            // Reports on the optimizer's work, so it implies -O2 as well.
+            options.boundsCheckStats = true;
+            options.optimize = true;
+        }
+        else if (arg.rfind("--pgo-use=", 0) == 0 || (arg == "--pgo-use" && i + 1 < argc))
+        {
+            options.pgoUse = arg == "--pgo-use" ? std::string(argv[++i]) : arg.substr(10);
+            options.optimize = true;
+        }
+        else if (arg == "--lazy-jit")
+        {
+            options.run = true;
+            options.lazyJit = true;
+        }
+        else if (arg == "--tiered-jit" || arg.rfind("--tiered-jit=", 0) == 0)
+        {
+            options.run = true;
+            options.tieredJit = true;
+            if (arg.size() > 13)
+                options.tierThreshold = std::strtoull(arg.c_str() + 13, nullptr, 10);
+        }
+        else if (arg == "--watch")
+        {
+            options.run = true;
+            options.watch = true;
+        }
+        else if (arg == "--no-jit-cache")
+        {
+            options.jitCache = false;
+        }
+        else if (arg == "--no-stdlib-cache")
+        {
+            options.stdlibCache = false;
+        }
+        else if (arg == "--no-runtime-inline")
+        {
+            // Keep runtime helpers as external calls (no bitcode linked in).
+            options.inlineRuntime = false;
+        }
         else if (arg == "-o" && i + 1 < argc)
         {
             options.outputFile = argv[++i];
@@ -1729,6 +3993,12 @@ int main(int argc, char *argv[])
         else if (arg == "--target" && i + 1 < argc)
         {
             options.target = argv[++i];
+            if (options.target == "wasm32")
+                options.target = "wasm";
+        }
+        else if (arg == "--wasm-threads")
+        {
+            options.wasmThreads = true;
         }
         else if (arg == "--no-ffi")
         {
@@ -1742,12 +4012,43 @@ int main(int argc, char *argv[])
         {
             options.borrowCheck = true;
         }
+        else if (arg.rfind("--memory=", 0) == 0)
+        {
+            // owned implies the borrow checker: its results decide the frees.
+            std::string mode = arg.substr(9);
+            if (mode == "owned")
+                options.ownedMemory = options.borrowCheck = true;
+            else if (mode == "gc")
+                options.ownedMemory = false;
+            else
+            {
+                std::cerr << "Unknown memory mode: " << mode << " (expected gc or owned)" << std::endl;
+                return 1;
+            }
+        }
         else if (arg == "--native" || arg == "-march=native" || arg == "-mcpu=native")
         {
             // Tune AOT codegen for the build host (POPCNT/AVX/BMI/...). Faster
             // but the resulting binary may not run on older CPUs.
             options.nativeCpu = true;
         }
+        else if (arg == "--multiversion" || arg.rfind("--multiversion=", 0) == 0)
+        {
+            // Portable fast binaries: loop functions get AVX2/AVX-512 copies
+            // chosen at run time, the baseline copy runs everywhere else.
+            std::string levels = arg.size() > 15 ? arg.substr(15) : "avx512,avx2";
+            options.multiversion.clear();
+            for (llvm::StringRef level : llvm::split(levels, ','))
+            {
+                if (level != "avx512" && level != "avx2" && level != "sse4" && level != "default")
+                {
+                    std::cerr << "Unknown --multiversion level: " << level.str()
+                              << " (expected avx512, avx2, sse4 or default)" << std::endl;
+                    return 1;
+                }
+                options.multiversion.push_back(level.str());
+            }
+        }
         else if ((arg == "--target-triple" || arg == "--triple") && i + 1 < argc)
         {
             // Cross-compile: emit an object for an arbitrary LLVM target triple
@@ -1838,6 +4139,9 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (precompileOnly)
+        return compiler.precompileStdlib(options) ? 0 : 1;
+
     // Check if a filename was provided
     if (filename.empty())
     {
@@ -1861,8 +4165,28 @@ int main(int argc, char *argv[])
 
     options.checkOnly = checkOnly;
 
+    if (options.timeTrace)
+        llvm::timeTraceProfilerInitialize(options.timeTraceGranularity, "tocin");
+
     // Compile the source
-    if (!compiler.compile(source, filename, options))
+    bool compiled;
+    {
+        llvm::TimeTraceScope scope("Compile", filename);
+        compiled = compiler.compile(source, filename, options);
+    }
+    if (options.timeTrace)
+    {
+        // A failed compile is traced too: it shows where the time went
+        // before the errors.
+        std::string fallback = options.outputFile.empty() ? filename : options.outputFile;
+        if (auto error = llvm::timeTraceProfilerWrite(options.timeTraceFile, fallback))
+            errorHandler.reportError(error::ErrorCode::I004_WRITE_ERROR,
+                                     "Could not write time trace: " +
+                                         llvm::toString(std::move(error)));
+        llvm::timeTraceProfilerCleanup();
+    }
+
+    if (!compiled)
     {
         // Summary line so the tally is visible after a wall of diagnostics.
         int ec = errorHandler.errorCount();
@@ -0,0 +1,288 @@
+#include "package_cache.h"
+
+#include "../runtime/concurrency.h"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace package {
+
+namespace {
+
+// Write to a unique sibling and rename over the target: readers see the old
+// file or the whole new one, never a prefix.
+bool writeAtomically(const std::string& target, llvm::StringRef contents)
+{
+    if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(target)))
+        return false;
+    int fd;
+    llvm::SmallString<256> temp;
+    if (llvm::sys::fs::createUniqueFile(target + ".tmp%%%%%%", fd, temp))
+        return false;
+    {
+        llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+        out << contents;
+        out.close();
+        if (out.has_error())
+        {
+            out.clear_error();
+            llvm::sys::fs::remove(temp);
+            return false;
+        }
+    }
+    if (llvm::sys::fs::rename(temp, target))
+    {
+        llvm::sys::fs::remove(temp);
+        return false;
+    }
+    return true;
+}
+
+// Relative, and not escaping the package directory.
+bool safeRelativePath(const std::string& path)
+{
+    if (path.empty() || llvm::sys::path::is_absolute(path))
+        return false;
+    for (auto it = llvm::sys::path::begin(path), end = llvm::sys::path::end(path); it != end; ++it)
+        if (*it == "..")
+            return false;
+    return path.find('\t') == std::string::npos && path.find('\n') == std::string::npos;
+}
+
+} // namespace
+
+PackageCache::PackageCache(std::string root) : root_(std::move(root)) {}
+
+std::string PackageCache::defaultDirectory()
+{
+    llvm::SmallString<256> dir;
+    if (const char* env = std::getenv("TOCIN_CACHE_DIR"); env && *env)
+    {
+        dir = env;
+        llvm::sys::path::append(dir, "packages");
+        return std::string(dir);
+    }
+    if (!llvm::sys::path::cache_directory(dir))
+    {
+        llvm::sys::fs::current_path(dir);
+        llvm::sys::path::append(dir, ".tocin-cache");
+    }
+    llvm::sys::path::append(dir, "tocin", "packages");
+    return std::string(dir);
+}
+
+std::string PackageCache::digest(const std::string& data)
+{
+    auto hash = llvm::SHA256::hash(llvm::arrayRefFromStringRef(data));
+    return llvm::toHex(hash, /*LowerCase=*/true);
+}
+
+std::string PackageCache::blobPath(const std::string& digest) const
+{
+    llvm::SmallString<256> p(root_);
+    llvm::sys::path::append(p, "blobs", digest.substr(0, 2), digest);
+    return std::string(p);
+}
+
+std::string PackageCache::manifestPath(const std::string& name, const Version& version) const
+{
+    llvm::SmallString<256> p(root_);
+    llvm::sys::path::append(p, "packages", name, version.toString() + ".files");
+    return std::string(p);
+}
+
+auto PackageCache::readManifest(const std::string& name, const Version& version) const
+    -> std::optional<std::vector<std::pair<std::string, std::string>>>
+{
+    std::ifstream in(manifestPath(name, version));
+    std::string line;
+    if (!in || !std::getline(in, line) || line != "tocin-package 1")
+        return std::nullopt;
+    std::vector<std::pair<std::string, std::string>> files;   // (digest, path)
+    while (std::getline(in, line))
+    {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos)
+            return std::nullopt;
+        files.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+    }
+    return files;
+}
+
+bool PackageCache::has(const std::string& name, const Version& version) const
+{
+    auto files = readManifest(name, version);
+    if (!files)
+        return false;
+    for (const auto& file : *files)
+        if (!llvm::sys::fs::exists(blobPath(file.first)))
+            return false;
+    return true;
+}
+
+bool PackageCache::add(const std::string& name, const Version& version,
+                       const std::map<std::string, std::string>& files)
+{
+    if (!safeRelativePath(name))
+        return false;
+    std::ostringstream manifest;
+    manifest << "tocin-package 1\n";
+    for (const auto& [path, contents] : files)
+    {
+        if (!safeRelativePath(path))
+            return false;
+        const std::string sha = digest(contents);
+        const std::string blob = blobPath(sha);
+        // Same digest, same bytes: a blob another package stored is reused.
+        if (!llvm::sys::fs::exists(blob))
+        {
+            if (!writeAtomically(blob, contents))
+                return false;
+            // Installs hard-link to the blob; read-only keeps an edit in one
+            // project from changing every other project's copy.
+            llvm::sys::fs::setPermissions(blob, llvm::sys::fs::all_read);
+        }
+        manifest << sha << '\t' << path << '\n';
+    }
+    // The manifest goes last: has() never sees a version whose blobs are missing.
+    return writeAtomically(manifestPath(name, version), manifest.str());
+}
+
+bool PackageCache::install(const std::string& name, const Version& version, const std::string& targetDir) const
+{
+    auto files = readManifest(name, version);
+    if (!files)
+        return false;
+    // Build next to the target and swap it in, so a failed install leaves
+    // the previous version in place.
+    const std::string staging = targetDir + ".installing";
+    llvm::sys::fs::remove_directories(staging);
+    for (const auto& [sha, path] : *files)
+    {
+        llvm::SmallString<256> to(staging);
+        llvm::sys::path::append(to, path);
+        if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(to)))
+            return false;
+        const std::string blob = blobPath(sha);
+        if (llvm::sys::fs::create_hard_link(blob, to) && llvm::sys::fs::copy_file(blob, to))
+        {
+            llvm::sys::fs::remove_directories(staging);
+            return false;
+        }
+    }
+    llvm::sys::fs::remove_directories(targetDir);
+    if (llvm::sys::fs::rename(staging, targetDir))
+    {
+        llvm::sys::fs::remove_directories(staging);
+        return false;
+    }
+    return true;
+}
+
+std::string PackageCache::graphKey(const std::string& lockFile, const std::vector<Dependency>& dependencies)
+{
+    std::vector<std::string> lines;
+    for (const auto& dep : dependencies)
+        lines.push_back(dep.name + "\t" + dep.version + (dep.optional ? "\toptional" : ""));
+    std::sort(lines.begin(), lines.end());
+    std::string data = "tocin-graph 1\n" + lockFile + "\n";
+    for (const auto& line : lines)
+        data += line + "\n";
+    return digest(data);
+}
+
+std::optional<std::map<std::string, Version>> PackageCache::loadGraph(const std::string& key) const
+{
+    llvm::SmallString<256> p(root_);
+    llvm::sys::path::append(p, "graphs", key + ".graph");
+    std::ifstream in(std::string(p.str()));
+    std::string line;
+    if (!in || !std::getline(in, line) || line != "tocin-graph 1")
+        return std::nullopt;
+    std::map<std::string, Version> graph;
+    while (std::getline(in, line))
+    {
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos)
+            return std::nullopt;
+        auto version = Version::parse(line.substr(tab + 1));
+        if (!version)
+            return std::nullopt;
+        graph[line.substr(0, tab)] = *version;
+    }
+    return graph;
+}
+
+bool PackageCache::storeGraph(const std::string& key, const std::map<std::string, Version>& graph) const
+{
+    std::string data = "tocin-graph 1\n";
+    for (const auto& [name, version] : graph)
+        data += name + "\t" + version.toString() + "\n";
+    llvm::SmallString<256> p(root_);
+    llvm::sys::path::append(p, "graphs", key + ".graph");
+    return writeAtomically(std::string(p.str()), data);
+}
+
+InstallReport installResolution(PackageCache& cache, const std::map<std::string, Version>& versions,
+                                const PackageFetcher& fetch, const std::string& modulesDir)
+{
+    struct Outcome {
+        bool downloaded = false;
+        std::string error;
+    };
+    auto installOne = [&](const std::string& name, const Version& version) {
+        Outcome outcome;
+        if (!cache.has(name, version))
+        {
+            std::map<std::string, std::string> files;
+            std::string error;
+            if (!fetch(name, version, files, error))
+            {
+                outcome.error = name + " " + version.toString() + ": " + (error.empty() ? "download failed" : error);
+                return outcome;
+            }
+            if (!cache.add(name, version, files))
+            {
+                outcome.error = name + " " + version.toString() + ": could not write to " + cache.root();
+                return outcome;
+            }
+            outcome.downloaded = true;
+        }
+        llvm::SmallString<256> target(modulesDir);
+        llvm::sys::path::append(target, name);
+        if (!cache.install(name, version, std::string(target.str())))
+            outcome.error = name + " " + version.toString() + ": could not install into " + std::string(target.str());
+        return outcome;
+    };
+
+    InstallReport report;
+    std::vector<std::future<Outcome>> pending;
+    {
+        runtime::ThreadPool pool;
+        for (const auto& [name, version] : versions)
+            pending.push_back(pool.submit([&, name = name, version = version] {
+                tocin::runtime::ExecutorBlockingScope blocking;   // network and disk waits
+                return installOne(name, version);
+            }));
+        tocin::runtime::ExecutorBlockingScope blocking;
+        for (auto& f : pending)
+        {
+            Outcome outcome = f.get();
+            if (!outcome.error.empty())
+                report.errors.push_back(outcome.error);
+            else
+                ++(outcome.downloaded ? report.downloaded : report.linked);
+        }
+    }
+    return report;
+}
+
+} // namespace package
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "version.h"
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace package {
+
+/**
+ * @brief Content-addressed package store shared by every project
+ *
+ * Files are kept once, under the SHA-256 of their contents, and a package
+ * version is a manifest naming the blob of each of its files:
+ *
+ *     <root>/blobs/3f/3fa9...          file contents (read-only)
+ *     <root>/packages/<name>/<v>.files "tocin-package 1", then "<sha>\t<path>"
+ *     <root>/graphs/<key>.graph        resolved dependency graphs
+ *
+ * install() hard-links a package's files into a project (copying only where
+ * links are not possible, e.g. across file systems), so a version every
+ * project on the machine uses is downloaded and stored once. Every file is
+ * written to a temporary name and renamed into place, so concurrent installs
+ * and interrupted downloads never leave a half-written entry.
+ */
+class PackageCache {
+public:
+    explicit PackageCache(std::string root = defaultDirectory());
+
+    // $TOCIN_CACHE_DIR/packages, else the per-user cache directory
+    // (tocin/packages), next to the JIT's object cache.
+    static std::string defaultDirectory();
+    // Lower-case hex SHA-256.
+    static std::string digest(const std::string& data);
+
+    const std::string& root() const { return root_; }
+
+    /**
+     * @brief Whether the package version's manifest and all its blobs are present
+     */
+    bool has(const std::string& name, const Version& version) const;
+
+    /**
+     * @brief Store a package version given as relative path -> contents
+     */
+    bool add(const std::string& name, const Version& version, const std::map<std::string, std::string>& files);
+
+    /**
+     * @brief Materialize a cached package version as @p targetDir
+     *
+     * Whatever was at @p targetDir (an older version) is replaced. False when
+     * the version is not in the cache or a file could not be placed.
+     */
+    bool install(const std::string& name, const Version& version, const std::string& targetDir) const;
+
+    /**
+     * @brief Key of the resolved graph of a project
+     *
+     * Covers the lock file and the manifest's direct dependencies: while
+     * neither changes, the last resolution is still the answer and
+     * `installAll` skips the resolver and the registry entirely.
+     */
+    static std::string graphKey(const std::string& lockFile, const std::vector<Dependency>& dependencies);
+    std::optional<std::map<std::string, Version>> loadGraph(const std::string& key) const;
+    bool storeGraph(const std::string& key, const std::map<std::string, Version>& graph) const;
+
+    std::string blobPath(const std::string& digest) const;
+
+private:
+    std::string manifestPath(const std::string& name, const Version& version) const;
+    std::optional<std::vector<std::pair<std::string, std::string>>> readManifest(const std::string& name,
+                                                                                 const Version& version) const;
+
+    std::string root_;
+};
+
+/**
+ * @brief Downloads one package version: relative path -> contents
+ *
+ * PackageRegistry::downloadPackage unpacked, in practice. Returns false and
+ * sets the error on failure. Called from several threads at once.
+ */
+using PackageFetcher = std::function<bool(const std::string& name, const Version& version,
+                                          std::map<std::string, std::string>& files, std::string& error)>;
+
+struct InstallReport {
+    size_t linked = 0;       // installed straight from the cache
+    size_t downloaded = 0;   // fetched into the cache first
+    std::vector<std::string> errors;
+
+    bool ok() const { return errors.empty(); }
+};
+
+/**
+ * @brief Install every package of a resolution under @p modulesDir/<name>
+ *
+ * Packages missing from the cache are downloaded concurrently on the thread
+ * pool (the downloads are independent once the versions are resolved), each
+ * one linked into place as soon as it has arrived.
+ */
+InstallReport installResolution(PackageCache& cache, const std::map<std::string, Version>& versions,
+                                const PackageFetcher& fetch, const std::string& modulesDir);
+
+} // namespace package
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "../error/error_handler.h"
+#include "package_cache.h"
+#include "resolver.h"
+#include "version.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -9,39 +12,6 @@
 
 namespace package {
 
-/**
- * @brief Package version
- */
-struct Version {
-    int major;
-    int minor;
-    int patch;
-    std::string prerelease;
-    std::string build;
-    
-    Version(int maj = 0, int min = 0, int pat = 0, 
-            const std::string& pre = "", const std::string& bld = "")
-        : major(maj), minor(min), patch(pat), prerelease(pre), build(bld) {}
-    
-    std::string toString() const;
-    bool operator<(const Version& other) const;
-    bool operator==(const Version& other) const;
-};
-
-/**
- * @brief Package dependency
- */
-struct Dependency {
-    std::string name;
-    std::string version;
-    std::string source;
-    bool optional;
-    std::vector<std::string> features;
-    
-    Dependency(const std::string& n, const std::string& v = "")
-        : name(n), version(v), optional(false) {}
-};
-
 /**
  * @brief Package metadata
  */
@@ -113,6 +83,7 @@ public:
     bool downloadPackage(const std::string& name, const std::string& version, const std::string& targetPath);
     
 private:
+    // One request; callers wanting many at once go through a CachingSource.
     std::string makeRequest(const std::string& endpoint);
     bool parsePackageInfo(const std::string& json, PackageInfo& info);
 };
@@ -144,6 +115,12 @@ public:
     
     /**
      * @brief Install all dependencies
+     *
+     * Reuses the resolved graph cached under PackageCache::graphKey while
+     * the lock file and manifest are unchanged; otherwise resolves with
+     * Resolver (locked versions preferred) over a CachingSource on the
+     * registry. Then installResolution() downloads what the global cache
+     * lacks, concurrently, and hard-links every package into the project.
      */
     bool installAll();
     
@@ -0,0 +1,627 @@
+#include "resolver.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace package {
+
+// ---- CachingSource ----
+
+CachingSource::CachingSource(PackageSource& upstream) : upstream_(upstream) {}
+
+CachingSource::~CachingSource() { pool_.stop(); }
+
+size_t CachingSource::fetches() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fetches_;
+}
+
+auto CachingSource::versionsSlot(const std::string& name) -> Slot<std::vector<Version>>
+{
+    std::promise<std::vector<Version>> promise;
+    Slot<std::vector<Version>> slot = promise.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = versions_.find(name);
+        if (found != versions_.end())
+            return found->second;
+        versions_.emplace(name, slot);
+        ++fetches_;
+    }
+    try
+    {
+        promise.set_value(upstream_.versions(name));
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+    }
+    return slot;
+}
+
+auto CachingSource::dependenciesSlot(const std::string& name, const Version& version)
+    -> Slot<std::vector<Dependency>>
+{
+    const std::string key = name + "@" + version.toString();
+    std::promise<std::vector<Dependency>> promise;
+    Slot<std::vector<Dependency>> slot = promise.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = dependencies_.find(key);
+        if (found != dependencies_.end())
+            return found->second;
+        dependencies_.emplace(key, slot);
+        ++fetches_;
+    }
+    try
+    {
+        promise.set_value(upstream_.dependencies(name, version));
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+    }
+    return slot;
+}
+
+std::vector<Version> CachingSource::versions(const std::string& name)
+{
+    tocin::runtime::ExecutorBlockingScope blocking;
+    return versionsSlot(name).get();
+}
+
+std::vector<Dependency> CachingSource::dependencies(const std::string& name, const Version& version)
+{
+    tocin::runtime::ExecutorBlockingScope blocking;
+    return dependenciesSlot(name, version).get();
+}
+
+void CachingSource::prefetch(const std::vector<std::string>& names)
+{
+    for (const auto& name : names)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (versions_.count(name))
+                continue;
+        }
+        pool_.submit([this, name] {
+            // Network waits: let the executor run other work meanwhile.
+            tocin::runtime::ExecutorBlockingScope blocking;
+            try
+            {
+                auto all = versionsSlot(name).get();
+                auto newest = std::max_element(all.begin(), all.end());
+                if (newest != all.end())
+                    dependenciesSlot(name, *newest).get();
+            }
+            catch (...)
+            {
+                // Kept in the slot; the resolver's own request rethrows it.
+            }
+        });
+    }
+}
+
+// ---- Resolver ----
+
+namespace {
+
+// A statement about one package: the versions it allows, and whether it is
+// also true when the package is not selected at all. "a ^1.0" is
+// {[1.0.0, 2.0.0), absent = false}; "not a ^1.0" is its complement,
+// {everything else, absent = true}. With the absent flag every term has a
+// complement, so the solver needs only set operations.
+struct Term {
+    std::string name;
+    VersionSet versions;
+    bool absent = false;
+
+    bool positive() const { return !absent; }
+    bool empty() const { return versions.empty() && !absent; }
+    Term negate() const { return {name, versions.complement(), !absent}; }
+    Term intersect(const Term& other) const
+    {
+        return {name, versions.intersect(other.versions), absent && other.absent};
+    }
+    bool subsetOf(const Term& other) const
+    {
+        return versions.subsetOf(other.versions) && (!absent || other.absent);
+    }
+    bool disjoint(const Term& other) const
+    {
+        return versions.disjoint(other.versions) && !(absent && other.absent);
+    }
+};
+
+enum class Cause { Root, Dependency, NoVersions, Unavailable, Derived };
+
+// A set of terms that must not all hold at once.
+struct Incompatibility {
+    std::vector<Term> terms;
+    Cause cause;
+    int left = -1, right = -1;   // Derived: the two it was resolved from
+    std::string note;            // Unavailable: why
+};
+
+struct Assignment {
+    Term term;
+    int level;
+    int cause;   // -1 for a decision, else the incompatibility it was derived from
+};
+
+enum class Relation { Satisfied, Contradicted, Inconclusive };
+
+class Solver {
+public:
+    Solver(PackageSource& source, const std::string& root, const std::vector<Dependency>& rootDependencies,
+           const std::unordered_map<std::string, Version>& preferred)
+        : source_(source), root_(root), rootDependencies_(rootDependencies), preferred_(preferred)
+    {
+    }
+
+    Resolution run()
+    {
+        Resolution result;
+        index(store({{Term{root_, VersionSet::none(), true}}, Cause::Root}));
+        std::string next = root_;
+        while (true)
+        {
+            if (!propagate(next))
+            {
+                result.error = explain(failure_);
+                break;
+            }
+            if (!choose(next))
+            {
+                result.ok = true;
+                for (const auto& [name, version] : decisions_)
+                    if (name != root_)
+                        result.versions[name] = version;
+                break;
+            }
+        }
+        result.decisions = decisionCount_;
+        result.conflicts = conflictCount_;
+        return result;
+    }
+
+private:
+    // ---- incompatibilities ----
+
+    // Merge terms on the same package and keep the result; index() makes the
+    // solver look at it during propagation.
+    int store(Incompatibility inc)
+    {
+        std::vector<Term> merged;
+        for (auto& term : inc.terms)
+        {
+            auto same = std::find_if(merged.begin(), merged.end(),
+                                     [&](const Term& t) { return t.name == term.name; });
+            if (same != merged.end())
+                *same = same->intersect(term);
+            else
+                merged.push_back(std::move(term));
+        }
+        // The root is always selected, so "root and X" says no more than X.
+        if (inc.cause == Cause::Derived && merged.size() > 1)
+            merged.erase(std::remove_if(merged.begin(), merged.end(),
+                                        [&](const Term& t) { return t.name == root_ && t.positive(); }),
+                         merged.end());
+        inc.terms = std::move(merged);
+        incompatibilities_.push_back(std::move(inc));
+        return static_cast<int>(incompatibilities_.size()) - 1;
+    }
+
+    void index(int id)
+    {
+        for (const auto& term : incompatibilities_[id].terms)
+            byPackage_[term.name].push_back(id);
+    }
+
+    bool isFailure(const Incompatibility& inc) const
+    {
+        return inc.terms.empty() ||
+               (inc.terms.size() == 1 && inc.terms[0].positive() && inc.terms[0].name == root_);
+    }
+
+    // ---- partial solution ----
+
+    Term accumulated(const std::string& name) const
+    {
+        auto found = accumulated_.find(name);
+        return found != accumulated_.end() ? found->second : Term{name, VersionSet::any(), true};
+    }
+
+    void assign(const Term& term, int cause)
+    {
+        assignments_.push_back({term, level_, cause});
+        auto found = accumulated_.find(term.name);
+        if (found != accumulated_.end())
+            found->second = found->second.intersect(term);
+        else
+            accumulated_.emplace(term.name, term);
+    }
+
+    void backtrack(int level)
+    {
+        while (!assignments_.empty() && assignments_.back().level > level)
+        {
+            if (assignments_.back().cause < 0)
+                decisions_.erase(assignments_.back().term.name);
+            assignments_.pop_back();
+        }
+        level_ = level;
+        accumulated_.clear();
+        for (const auto& a : assignments_)
+        {
+            auto found = accumulated_.find(a.term.name);
+            if (found != accumulated_.end())
+                found->second = found->second.intersect(a.term);
+            else
+                accumulated_.emplace(a.term.name, a.term);
+        }
+    }
+
+    Relation relation(const Term& term) const
+    {
+        Term current = accumulated(term.name);
+        if (current.subsetOf(term))
+            return Relation::Satisfied;
+        if (current.disjoint(term))
+            return Relation::Contradicted;
+        return Relation::Inconclusive;
+    }
+
+    // The first assignment after which the solution satisfies @p term.
+    int satisfier(const Term& term) const
+    {
+        Term current{term.name, VersionSet::any(), true};
+        for (size_t i = 0; i < assignments_.size(); ++i)
+        {
+            if (assignments_[i].term.name != term.name)
+                continue;
+            current = current.intersect(assignments_[i].term);
+            if (current.subsetOf(term))
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    // ---- unit propagation ----
+
+    // -1: every term holds (a conflict); -2: nothing follows; otherwise the
+    // index of the one undecided term, whose negation was just derived.
+    int propagateOne(int id)
+    {
+        const auto& terms = incompatibilities_[id].terms;
+        int open = -1;
+        for (size_t k = 0; k < terms.size(); ++k)
+        {
+            Relation r = relation(terms[k]);
+            if (r == Relation::Contradicted)
+                return -2;
+            if (r == Relation::Inconclusive)
+            {
+                if (open != -1)
+                    return -2;
+                open = static_cast<int>(k);
+            }
+        }
+        if (open == -1)
+            return -1;
+        assign(terms[open].negate(), id);
+        return open;
+    }
+
+    bool propagate(const std::string& start)
+    {
+        std::vector<std::string> changed{start};
+        while (!changed.empty())
+        {
+            std::string name = changed.back();
+            changed.pop_back();
+            const std::vector<int> ids = byPackage_[name];   // grows while we go
+            for (auto it = ids.rbegin(); it != ids.rend(); ++it)
+            {
+                int k = propagateOne(*it);
+                if (k == -2)
+                    continue;
+                if (k >= 0)
+                {
+                    changed.push_back(incompatibilities_[*it].terms[k].name);
+                    continue;
+                }
+                int learned = resolveConflict(*it);
+                if (learned < 0)
+                    return false;
+                // After the backjump the learned fact has exactly one open term.
+                k = propagateOne(learned);
+                changed.clear();
+                if (k >= 0)
+                    changed.push_back(incompatibilities_[learned].terms[k].name);
+                break;
+            }
+        }
+        return true;
+    }
+
+    // ---- conflict resolution ----
+
+    int resolveConflict(int id)
+    {
+        ++conflictCount_;
+        bool derived = false;
+        while (true)
+        {
+            const Incompatibility inc = incompatibilities_[id];
+            if (isFailure(inc))
+            {
+                failure_ = id;
+                return -1;
+            }
+
+            // The term satisfied last, and the decision level the rest of
+            // the incompatibility was already satisfied at.
+            int latest = -1;
+            Term latestTerm;
+            Term difference;
+            bool hasDifference = false;
+            int previousLevel = 1;
+            for (const auto& term : inc.terms)
+            {
+                int s = satisfier(term);
+                if (latest == -1 || latest < s)
+                {
+                    if (latest != -1)
+                        previousLevel = std::max(previousLevel, assignments_[latest].level);
+                    latest = s;
+                    latestTerm = term;
+                    hasDifference = false;
+                    if (assignments_[s].cause >= 0)
+                    {
+                        // A derivation may say more than the term needs; the
+                        // surplus must be accounted for separately.
+                        Term rest = assignments_[s].term.intersect(term.negate());
+                        if (!rest.empty())
+                        {
+                            hasDifference = true;
+                            difference = rest;
+                            previousLevel = std::max(previousLevel,
+                                                     assignments_[satisfier(rest.negate())].level);
+                        }
+                    }
+                }
+                else
+                {
+                    previousLevel = std::max(previousLevel, assignments_[s].level);
+                }
+            }
+
+            const Assignment culprit = assignments_[latest];
+            if (culprit.cause < 0 || previousLevel != culprit.level)
+            {
+                if (derived)
+                    index(id);
+                backtrack(previousLevel);
+                return id;
+            }
+
+            // Resolve with the incompatibility the culprit was derived from.
+            Incompatibility next;
+            next.cause = Cause::Derived;
+            next.left = id;
+            next.right = culprit.cause;
+            for (const auto& term : inc.terms)
+                if (term.name != latestTerm.name)
+                    next.terms.push_back(term);
+            for (const auto& term : incompatibilities_[culprit.cause].terms)
+                if (term.name != culprit.term.name)
+                    next.terms.push_back(term);
+            if (hasDifference)
+                next.terms.push_back(difference.negate());
+            id = store(std::move(next));
+            derived = true;
+        }
+    }
+
+    // ---- decisions ----
+
+    const std::vector<Version>& versionsOf(const std::string& name)
+    {
+        auto found = versions_.find(name);
+        if (found != versions_.end())
+            return found->second;
+        std::vector<Version> all = name == root_ ? std::vector<Version>{Version()} : source_.versions(name);
+        std::sort(all.begin(), all.end());
+        all.erase(std::unique(all.begin(), all.end()), all.end());
+        return versions_.emplace(name, std::move(all)).first->second;
+    }
+
+    // The package to decide next (the most constrained: fewest versions
+    // left), and a version for it. False when every package is decided.
+    bool choose(std::string& next)
+    {
+        const std::string* pick = nullptr;
+        size_t fewest = 0;
+        for (const auto& [name, term] : accumulated_)
+        {
+            if (!term.positive() || decisions_.count(name))
+                continue;
+            size_t n = 0;
+            for (const auto& v : versionsOf(name))
+                n += term.versions.contains(v);
+            if (!pick || n < fewest)
+            {
+                pick = &name;
+                fewest = n;
+            }
+        }
+        if (!pick)
+            return false;
+        next = *pick;
+        const Term term = accumulated_.at(next);
+
+        const auto& all = versionsOf(next);
+        const Version* chosen = nullptr;
+        auto preferred = preferred_.find(next);
+        if (preferred != preferred_.end() && term.versions.contains(preferred->second))
+            chosen = &preferred->second;
+        // The newest release, else the newest prerelease.
+        for (auto it = all.rbegin(); it != all.rend() && !chosen; ++it)
+            if (it->prerelease.empty() && term.versions.contains(*it))
+                chosen = &*it;
+        for (auto it = all.rbegin(); it != all.rend() && !chosen; ++it)
+            if (term.versions.contains(*it))
+                chosen = &*it;
+        if (!chosen)
+        {
+            Incompatibility none{{Term{next, term.versions, false}},
+                                 all.empty() ? Cause::Unavailable : Cause::NoVersions};
+            if (all.empty())
+                none.note = next + " doesn't exist";
+            index(store(std::move(none)));
+            return true;
+        }
+        const Version version = *chosen;
+
+        std::vector<Dependency> deps = next == root_ ? rootDependencies_ : source_.dependencies(next, version);
+        std::vector<std::string> names;
+        bool conflict = false;
+        const Term self{next, VersionSet::exactly(version), false};
+        for (const auto& dep : deps)
+        {
+            if (dep.optional)
+                continue;
+            auto allowed = parseConstraint(dep.version);
+            if (!allowed)
+            {
+                Incompatibility bad{{self}, Cause::Unavailable};
+                bad.note = next + " " + version.toString() + " has an invalid constraint \"" + dep.version +
+                           "\" on " + dep.name;
+                index(store(std::move(bad)));
+                conflict = true;
+                continue;
+            }
+            int id = store({{self, Term{dep.name, *allowed, false}.negate()}, Cause::Dependency});
+            index(id);
+            names.push_back(dep.name);
+            bool holds = true;
+            for (const auto& t : incompatibilities_[id].terms)
+                if (t.name != next && relation(t) != Relation::Satisfied)
+                    holds = false;
+            conflict = conflict || holds;
+        }
+        source_.prefetch(names);
+
+        if (!conflict)
+        {
+            ++level_;
+            ++decisionCount_;
+            assign(self, -1);
+            decisions_[next] = version;
+        }
+        return true;
+    }
+
+    // ---- error reporting ----
+
+    std::string text(const Term& term) const
+    {
+        if (!term.positive())
+            return "not " + text(term.negate());
+        if (term.versions.isAny() || term.name == root_)
+            return term.name;
+        return term.name + " " + term.versions.toString();
+    }
+
+    std::string describe(int id) const
+    {
+        const Incompatibility& inc = incompatibilities_[id];
+        if (inc.cause == Cause::Unavailable)
+            return inc.note;
+        if (inc.cause == Cause::NoVersions)
+        {
+            const Term& t = inc.terms[0];
+            return t.versions.isAny() ? "no versions of " + t.name + " exist"
+                                      : "no versions of " + t.name + " match " + t.versions.toString();
+        }
+        if (isFailure(inc))
+            return "version solving failed";
+
+        std::vector<std::string> positives, required;
+        for (const auto& t : inc.terms)
+            (t.positive() ? positives : required).push_back(text(t.positive() ? t : t.negate()));
+        auto join = [](const std::vector<std::string>& parts, const char* sep) {
+            std::string out;
+            for (size_t i = 0; i < parts.size(); ++i)
+                out += (i ? sep : "") + parts[i];
+            return out;
+        };
+        if (positives.empty())
+            return join(required, " or ") + " is required";
+        if (required.empty())
+            return positives.size() == 1 ? positives[0] + " is forbidden"
+                                         : join(positives, " and ") + " are incompatible";
+        const char* verb = inc.cause == Cause::Dependency ? " depends on " : " requires ";
+        return join(positives, " and ") + verb + join(required, " or ");
+    }
+
+    // Every derived fact on the way to @p failure, premises first.
+    std::string explain(int failure) const
+    {
+        std::vector<std::string> lines;
+        std::unordered_map<int, size_t> lineOf;
+        auto ref = [&](int id) {
+            auto found = lineOf.find(id);
+            return describe(id) + (found != lineOf.end() ? " (" + std::to_string(found->second) + ")" : "");
+        };
+        std::function<void(int)> walk = [&](int id) {
+            const Incompatibility& inc = incompatibilities_[id];
+            if (inc.cause != Cause::Derived || lineOf.count(id))
+                return;
+            walk(inc.left);
+            walk(inc.right);
+            std::string line = "Because " + ref(inc.left) + " and " + ref(inc.right) + ", " + describe(id) + ".";
+            lines.push_back(std::to_string(lines.size() + 1) + ". " + line);
+            lineOf[id] = lines.size();
+        };
+        walk(failure);
+        if (lines.empty())
+            return "Because " + describe(failure) + ", version solving failed.";
+        std::string out;
+        for (const auto& line : lines)
+            out += (out.empty() ? "" : "\n") + line;
+        return out;
+    }
+
+    PackageSource& source_;
+    const std::string root_;
+    const std::vector<Dependency>& rootDependencies_;
+    const std::unordered_map<std::string, Version>& preferred_;
+
+    std::vector<Incompatibility> incompatibilities_;
+    std::unordered_map<std::string, std::vector<int>> byPackage_;
+    std::vector<Assignment> assignments_;
+    std::map<std::string, Term> accumulated_;   // ordered: decisions are deterministic
+    std::map<std::string, Version> decisions_;
+    std::unordered_map<std::string, std::vector<Version>> versions_;
+    int level_ = 0;
+    int failure_ = -1;
+    size_t decisionCount_ = 0;
+    size_t conflictCount_ = 0;
+};
+
+} // namespace
+
+Resolver::Resolver(PackageSource& source, std::string rootName) : source_(source), rootName_(std::move(rootName)) {}
+
+void Resolver::prefer(const std::string& name, const Version& version) { preferred_[name] = version; }
+
+Resolution Resolver::resolve(const std::vector<Dependency>& rootDependencies)
+{
+    return Solver(source_, rootName_, rootDependencies, preferred_).run();
+}
+
+} // namespace package
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "../runtime/concurrency.h"
+#include "version.h"
+
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace package {
+
+/**
+ * @brief Where the resolver learns which versions exist and what they need
+ *
+ * The registry behind PackageRegistry, a lock file's recorded graph, or a
+ * test's table. An unknown package has no versions. Both calls may block
+ * (they are usually network requests).
+ */
+class PackageSource {
+public:
+    virtual ~PackageSource() = default;
+
+    virtual std::vector<Version> versions(const std::string& name) = 0;
+    virtual std::vector<Dependency> dependencies(const std::string& name, const Version& version) = 0;
+
+    /**
+     * @brief Hint that these packages will be asked about soon
+     *
+     * The resolver calls it with every dependency of a version it has just
+     * chosen, before it looks at any of them. Must not block.
+     */
+    virtual void prefetch(const std::vector<std::string>& names) { (void)names; }
+};
+
+/**
+ * @brief Memoizing, concurrent front for a slow PackageSource
+ *
+ * Every answer is fetched once. prefetch() starts the version-list fetch of
+ * each name (and the dependency fetch of its newest version, the one the
+ * resolver will usually try first) on the thread pool, so the metadata of a
+ * whole level of the dependency tree arrives in parallel instead of one
+ * request at a time; a later versions()/dependencies() call for a key still
+ * in flight waits for that fetch rather than starting another.
+ */
+class CachingSource : public PackageSource {
+public:
+    explicit CachingSource(PackageSource& upstream);
+    ~CachingSource() override;
+
+    std::vector<Version> versions(const std::string& name) override;
+    std::vector<Dependency> dependencies(const std::string& name, const Version& version) override;
+    void prefetch(const std::vector<std::string>& names) override;
+
+    // Requests that reached the upstream source.
+    size_t fetches() const;
+
+private:
+    template<typename T>
+    using Slot = std::shared_future<T>;
+
+    Slot<std::vector<Version>> versionsSlot(const std::string& name);
+    Slot<std::vector<Dependency>> dependenciesSlot(const std::string& name, const Version& version);
+
+    PackageSource& upstream_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Slot<std::vector<Version>>> versions_;
+    std::unordered_map<std::string, Slot<std::vector<Dependency>>> dependencies_;   // "name@version"
+    size_t fetches_ = 0;
+    runtime::ThreadPool pool_;   // last: drained before the maps go
+};
+
+/**
+ * @brief Outcome of Resolver::resolve
+ */
+struct Resolution {
+    bool ok = false;
+    std::map<std::string, Version> versions;   // every selected package except the root
+    std::string error;                         // why no solution exists, when !ok
+    size_t decisions = 0;
+    size_t conflicts = 0;
+};
+
+/**
+ * @brief PubGrub version solver
+ *
+ * Picks one version per package so that every dependency constraint holds,
+ * preferring the newest versions (or the locked ones). Each time a choice
+ * leads to a conflict, the solver derives the incompatibility that caused it
+ * (for instance "every a >=2.0.0 requires c <1.0.0") and jumps back past the
+ * decision responsible, so a bad combination is ruled out once instead of
+ * being rediscovered under every later choice, and when there is no solution
+ * the chain of derived facts is the error message.
+ *
+ * Reference: N. Weizenbaum, "PubGrub: Next-Generation Version Solving" (2018).
+ */
+class Resolver {
+public:
+    explicit Resolver(PackageSource& source, std::string rootName = "root");
+
+    /**
+     * @brief Prefer @p version of @p name when the constraints allow it
+     *
+     * The lock file's choices: with them re-resolving an unchanged project
+     * decides every package at its locked version without a conflict.
+     */
+    void prefer(const std::string& name, const Version& version);
+
+    Resolution resolve(const std::vector<Dependency>& rootDependencies);
+
+private:
+    PackageSource& source_;
+    std::string rootName_;
+    std::unordered_map<std::string, Version> preferred_;
+};
+
+} // namespace package
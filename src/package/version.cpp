@@ -0,0 +1,399 @@
+#include "version.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+namespace package {
+
+namespace {
+
+bool allDigits(const std::string& s)
+{
+    return !s.empty() && std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isdigit(c); });
+}
+
+std::vector<std::string> split(const std::string& s, char sep)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (size_t i = 0; i <= s.size(); ++i)
+        if (i == s.size() || s[i] == sep)
+        {
+            parts.push_back(s.substr(start, i - start));
+            start = i + 1;
+        }
+    return parts;
+}
+
+// Version::parse, also reporting how many of major.minor.patch were written
+// (for "1.2" meaning 1.2.x in a constraint).
+std::optional<Version> parseFields(std::string text, int& fields)
+{
+    if (!text.empty() && (text[0] == 'v' || text[0] == 'V'))
+        text.erase(0, 1);
+    Version v;
+    size_t plus = text.find('+');
+    if (plus != std::string::npos)
+    {
+        v.build = text.substr(plus + 1);
+        text.resize(plus);
+    }
+    size_t dash = text.find('-');
+    if (dash != std::string::npos)
+    {
+        v.prerelease = text.substr(dash + 1);
+        if (v.prerelease.empty())
+            return std::nullopt;
+        text.resize(dash);
+    }
+    std::vector<std::string> parts = split(text, '.');
+    if (parts.size() > 3)
+        return std::nullopt;
+    int* slots[3] = {&v.major, &v.minor, &v.patch};
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        if (!allDigits(parts[i]) || parts[i].size() > 9)
+            return std::nullopt;
+        *slots[i] = std::atoi(parts[i].c_str());
+    }
+    fields = static_cast<int>(parts.size());
+    return v;
+}
+
+// Semver precedence of two prerelease strings ("" is a release, which is
+// greater than any prerelease).
+int comparePrerelease(const std::string& a, const std::string& b)
+{
+    if (a == b)
+        return 0;
+    if (a.empty())
+        return 1;
+    if (b.empty())
+        return -1;
+    std::vector<std::string> x = split(a, '.'), y = split(b, '.');
+    for (size_t i = 0; i < x.size() && i < y.size(); ++i)
+    {
+        bool nx = allDigits(x[i]), ny = allDigits(y[i]);
+        if (nx && ny)
+        {
+            long long p = std::atoll(x[i].c_str()), q = std::atoll(y[i].c_str());
+            if (p != q)
+                return p < q ? -1 : 1;
+        }
+        else if (nx != ny)
+        {
+            return nx ? -1 : 1;   // numeric identifiers sort first
+        }
+        else if (x[i] != y[i])
+        {
+            return x[i] < y[i] ? -1 : 1;
+        }
+    }
+    return x.size() == y.size() ? 0 : (x.size() < y.size() ? -1 : 1);
+}
+
+VersionSet::Bound before(const Version& v) { return {0, v, false}; }
+VersionSet::Bound after(const Version& v) { return {0, v, true}; }
+VersionSet::Bound minusInf() { return {-1, Version(), false}; }
+VersionSet::Bound plusInf() { return {1, Version(), false}; }
+
+} // namespace
+
+// ---- Version ----
+
+std::optional<Version> Version::parse(const std::string& text)
+{
+    int fields = 0;
+    auto v = parseFields(text, fields);
+    if (!v || fields == 0)
+        return std::nullopt;
+    return v;
+}
+
+std::string Version::toString() const
+{
+    std::string s = std::to_string(major) + "." + std::to_string(minor) + "." + std::to_string(patch);
+    if (!prerelease.empty())
+        s += "-" + prerelease;
+    if (!build.empty())
+        s += "+" + build;
+    return s;
+}
+
+bool Version::operator<(const Version& other) const
+{
+    if (major != other.major)
+        return major < other.major;
+    if (minor != other.minor)
+        return minor < other.minor;
+    if (patch != other.patch)
+        return patch < other.patch;
+    return comparePrerelease(prerelease, other.prerelease) < 0;
+}
+
+bool Version::operator==(const Version& other) const
+{
+    return major == other.major && minor == other.minor && patch == other.patch &&
+           prerelease == other.prerelease;
+}
+
+// ---- VersionSet ----
+
+bool VersionSet::Bound::operator<(const Bound& other) const
+{
+    if (kind != other.kind)
+        return kind < other.kind;
+    if (kind != 0)
+        return false;
+    if (version != other.version)
+        return version < other.version;
+    return !after && other.after;
+}
+
+bool VersionSet::Bound::operator==(const Bound& other) const
+{
+    return !(*this < other) && !(other < *this);
+}
+
+VersionSet VersionSet::any()
+{
+    VersionSet s;
+    s.intervals_.push_back({minusInf(), plusInf()});
+    return s;
+}
+
+VersionSet VersionSet::exactly(const Version& v)
+{
+    VersionSet s;
+    s.intervals_.push_back({before(v), after(v)});
+    return s;
+}
+
+VersionSet VersionSet::atLeast(const Version& v, bool inclusive)
+{
+    VersionSet s;
+    s.intervals_.push_back({inclusive ? before(v) : after(v), plusInf()});
+    return s;
+}
+
+VersionSet VersionSet::below(const Version& v, bool inclusive)
+{
+    VersionSet s;
+    s.intervals_.push_back({minusInf(), inclusive ? after(v) : before(v)});
+    return s;
+}
+
+bool VersionSet::contains(const Version& v) const
+{
+    const Bound lo = before(v), hi = after(v);
+    for (const auto& i : intervals_)
+        if (!(lo < i.low) && !(i.high < hi))
+            return true;
+    return false;
+}
+
+bool VersionSet::isAny() const
+{
+    return intervals_.size() == 1 && intervals_[0].low.kind == -1 && intervals_[0].high.kind == 1;
+}
+
+VersionSet VersionSet::intersect(const VersionSet& other) const
+{
+    VersionSet out;
+    size_t i = 0, j = 0;
+    while (i < intervals_.size() && j < other.intervals_.size())
+    {
+        const Interval &a = intervals_[i], &b = other.intervals_[j];
+        const Bound& lo = a.low < b.low ? b.low : a.low;
+        const Bound& hi = a.high < b.high ? a.high : b.high;
+        if (lo < hi)
+            out.intervals_.push_back({lo, hi});
+        if (a.high < b.high)
+            ++i;
+        else
+            ++j;
+    }
+    return out;
+}
+
+VersionSet VersionSet::unite(const VersionSet& other) const
+{
+    std::vector<Interval> all = intervals_;
+    all.insert(all.end(), other.intervals_.begin(), other.intervals_.end());
+    std::sort(all.begin(), all.end(), [](const Interval& a, const Interval& b) { return a.low < b.low; });
+    VersionSet out;
+    for (const auto& i : all)
+    {
+        if (!out.intervals_.empty() && !(out.intervals_.back().high < i.low))
+        {
+            if (out.intervals_.back().high < i.high)
+                out.intervals_.back().high = i.high;
+        }
+        else
+        {
+            out.intervals_.push_back(i);
+        }
+    }
+    return out;
+}
+
+VersionSet VersionSet::complement() const
+{
+    VersionSet out;
+    Bound prev = minusInf();
+    for (const auto& i : intervals_)
+    {
+        if (prev < i.low)
+            out.intervals_.push_back({prev, i.low});
+        prev = i.high;
+    }
+    if (prev < plusInf())
+        out.intervals_.push_back({prev, plusInf()});
+    return out;
+}
+
+bool VersionSet::operator==(const VersionSet& other) const
+{
+    if (intervals_.size() != other.intervals_.size())
+        return false;
+    for (size_t i = 0; i < intervals_.size(); ++i)
+        if (!(intervals_[i].low == other.intervals_[i].low) || !(intervals_[i].high == other.intervals_[i].high))
+            return false;
+    return true;
+}
+
+std::string VersionSet::toString() const
+{
+    if (intervals_.empty())
+        return "none";
+    std::string out;
+    for (const auto& i : intervals_)
+    {
+        if (!out.empty())
+            out += " || ";
+        if (i.low.kind == 0 && i.high.kind == 0 && !i.low.after && i.high.after &&
+            i.low.version == i.high.version)
+        {
+            out += i.low.version.toString();
+            continue;
+        }
+        std::string part;
+        if (i.low.kind == 0)
+            part += (i.low.after ? ">" : ">=") + i.low.version.toString();
+        if (i.high.kind == 0)
+            part += std::string(part.empty() ? "" : " ") + (i.high.after ? "<=" : "<") + i.high.version.toString();
+        out += part.empty() ? "any" : part;
+    }
+    return out;
+}
+
+// ---- constraints ----
+
+namespace {
+
+// One comparison: an optional operator and a (possibly partial) version.
+std::optional<VersionSet> parseComparison(const std::string& text)
+{
+    if (text == "*" || text == "x" || text == "X")
+        return VersionSet::any();
+    std::string op;
+    for (const char* candidate : {">=", "<=", ">", "<", "=", "^", "~"})
+        if (text.rfind(candidate, 0) == 0)
+        {
+            op = candidate;
+            break;
+        }
+    std::string rest = text.substr(op.size());
+    // 1.2.x / 1.2.* mean 1.2
+    while (rest.size() >= 2 && rest[rest.size() - 2] == '.' &&
+           (rest.back() == 'x' || rest.back() == 'X' || rest.back() == '*'))
+        rest.resize(rest.size() - 2);
+    int fields = 0;
+    auto v = parseFields(rest, fields);
+    if (!v || fields == 0)
+        return std::nullopt;
+
+    // The first version past everything the written fields pin down.
+    auto nextAt = [&](int field) {
+        if (field == 0)
+            return Version(v->major + 1, 0, 0);
+        if (field == 1)
+            return Version(v->major, v->minor + 1, 0);
+        return Version(v->major, v->minor, v->patch + 1);
+    };
+    auto range = [](const Version& lo, const Version& hi) {
+        return VersionSet::atLeast(lo).intersect(VersionSet::below(hi));
+    };
+
+    if (op == ">=")
+        return VersionSet::atLeast(*v);
+    if (op == ">")
+        return fields == 3 ? VersionSet::atLeast(*v, false) : VersionSet::atLeast(nextAt(fields - 1));
+    if (op == "<")
+        return VersionSet::below(*v);
+    if (op == "<=")
+        return fields == 3 ? VersionSet::below(*v, true) : VersionSet::below(nextAt(fields - 1));
+    if (op == "^")
+    {
+        // The left-most non-zero field among those written stays fixed.
+        int field = v->major != 0 || fields == 1 ? 0 : (v->minor != 0 || fields == 2 ? 1 : 2);
+        return range(*v, nextAt(field));
+    }
+    if (op == "~")
+        return range(*v, nextAt(fields >= 2 ? 1 : 0));
+    // bare or "=": exact when complete, otherwise everything it names
+    return fields == 3 ? VersionSet::exactly(*v) : range(*v, nextAt(fields - 1));
+}
+
+} // namespace
+
+std::optional<VersionSet> parseConstraint(const std::string& text)
+{
+    VersionSet result = VersionSet::none();
+    size_t start = 0;
+    bool sawAlternative = false;
+    while (start <= text.size())
+    {
+        size_t bar = text.find("||", start);
+        std::string alt = text.substr(start, bar == std::string::npos ? std::string::npos : bar - start);
+        start = bar == std::string::npos ? text.size() + 1 : bar + 2;
+
+        // Tokens separated by spaces or commas; a lone operator takes the
+        // next token (">= 1.0").
+        std::vector<std::string> tokens;
+        std::string cur;
+        for (char c : alt + " ")
+        {
+            if (c == ' ' || c == ',' || c == '\t')
+            {
+                if (cur.empty())
+                    continue;
+                if (!tokens.empty() && tokens.back().find_first_not_of("<>=^~") == std::string::npos)
+                    tokens.back() += cur;
+                else
+                    tokens.push_back(cur);
+                cur.clear();
+            }
+            else
+            {
+                cur += c;
+            }
+        }
+        VersionSet set = VersionSet::any();
+        for (const auto& token : tokens)
+        {
+            auto part = parseComparison(token);
+            if (!part)
+                return std::nullopt;
+            set = set.intersect(*part);
+        }
+        if (tokens.empty() && sawAlternative)
+            return std::nullopt;   // "a ||" or "|| b"
+        result = result.unite(set);
+        sawAlternative = true;
+    }
+    return result;
+}
+
+} // namespace package
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace package {
+
+/**
+ * @brief Package version
+ *
+ * Ordered as semver: by major, minor and patch, then a prerelease sorts
+ * before the release (1.0.0-rc.1 < 1.0.0) and prereleases compare by their
+ * dot-separated identifiers. Build metadata is kept but never compared.
+ */
+struct Version {
+    int major;
+    int minor;
+    int patch;
+    std::string prerelease;
+    std::string build;
+
+    Version(int maj = 0, int min = 0, int pat = 0,
+            const std::string& pre = "", const std::string& bld = "")
+        : major(maj), minor(min), patch(pat), prerelease(pre), build(bld) {}
+
+    /**
+     * @brief Parse "MAJOR[.MINOR[.PATCH]][-pre][+build]"; missing fields are 0
+     */
+    static std::optional<Version> parse(const std::string& text);
+
+    std::string toString() const;
+    bool operator<(const Version& other) const;
+    bool operator==(const Version& other) const;
+    bool operator!=(const Version& other) const { return !(*this == other); }
+    bool operator<=(const Version& other) const { return !(other < *this); }
+};
+
+/**
+ * @brief Package dependency
+ */
+struct Dependency {
+    std::string name;
+    std::string version;   // constraint, see parseConstraint
+    std::string source;
+    bool optional;
+    std::vector<std::string> features;
+
+    Dependency(const std::string& n, const std::string& v = "")
+        : name(n), version(v), optional(false) {}
+};
+
+/**
+ * @brief A set of versions: a sorted union of disjoint intervals
+ *
+ * Interval ends sit between versions, just before or just after one, so
+ * ">=1.0.0", ">1.0.0", "=1.0.0" and their complements are all exact. The
+ * resolver needs the set algebra (intersection, union, complement); with it,
+ * every constraint and every derived fact about a package is one VersionSet.
+ */
+class VersionSet {
+public:
+    // A position on the version line: -infinity, +infinity, or just before
+    // (after = false) or just after `version`.
+    struct Bound {
+        int kind = 0;   // -1 = -inf, 0 = at version, 1 = +inf
+        Version version;
+        bool after = false;
+
+        bool operator<(const Bound& other) const;
+        bool operator==(const Bound& other) const;
+    };
+    struct Interval {
+        Bound low, high;   // contains v iff low <= before(v) and after(v) <= high
+    };
+
+    static VersionSet any();
+    static VersionSet none() { return VersionSet(); }
+    static VersionSet exactly(const Version& v);
+    static VersionSet atLeast(const Version& v, bool inclusive = true);
+    static VersionSet below(const Version& v, bool inclusive = false);
+
+    bool contains(const Version& v) const;
+    bool empty() const { return intervals_.empty(); }
+    bool isAny() const;
+
+    VersionSet intersect(const VersionSet& other) const;
+    VersionSet unite(const VersionSet& other) const;
+    VersionSet complement() const;
+    VersionSet minus(const VersionSet& other) const { return intersect(other.complement()); }
+    bool subsetOf(const VersionSet& other) const { return minus(other).empty(); }
+    bool disjoint(const VersionSet& other) const { return intersect(other).empty(); }
+
+    bool operator==(const VersionSet& other) const;
+
+    // ">=1.2.0 <2.0.0", "1.4.2", "any", "none", "<1.0.0 || >=2.0.0"
+    std::string toString() const;
+
+private:
+    std::vector<Interval> intervals_;
+};
+
+/**
+ * @brief Parse a dependency constraint into the versions it allows.
+ *
+ * "" and "*" allow any version; "1.2.3" or "=1.2.3" exactly one; "^1.2.3"
+ * up to the next change of the left-most non-zero field (<2.0.0; ^0.2.3 is
+ * <0.3.0); "~1.2.3" patch changes (<1.3.0); ">=", ">", "<=", "<" as written.
+ * Space- or comma-separated parts all apply (">=1.0 <1.5"); "||" joins
+ * alternatives. Returns nullopt on a malformed constraint.
+ */
+std::optional<VersionSet> parseConstraint(const std::string& text);
+
+} // namespace package
@@ -6,7 +6,12 @@ namespace parser
 {
 
     Parser::Parser(const std::vector<lexer::Token> &tokens)
-        : tokens(tokens), current(0) {
+        : ownedSource(std::make_unique<lexer::TokenVectorSource>(tokens)), source(ownedSource.get()), current(0) {
+        errors_.clear();
+    }
+
+    Parser::Parser(lexer::TokenSource &source)
+        : source(&source), current(0) {
         errors_.clear();
     }
 
@@ -15,6 +20,7 @@ namespace parser
         try
         {
             std::vector<ast::StmtPtr> statements;
+            const lexer::Token first = peek();
 
             while (!isAtEnd())
             {
@@ -32,9 +38,8 @@ namespace parser
             }
 
             // Otherwise, create a block statement
-            return std::make_shared<ast::BlockStmt>(
-                tokens.empty() ? lexer::Token(lexer::TokenType::EOF_TOKEN, "", "", 0, 0) : tokens[0],
-                std::move(statements));
+            return ast::make<ast::BlockStmt>(
+                first, std::move(statements));
         }
         catch (const std::exception &e)
         {
@@ -45,42 +50,94 @@ namespace parser
         }
     }
 
+    static bool isFunctionQualifier(std::string_view word)
+    {
+        return word == "naked" || word == "interrupt" || word == "memoize" || word == "target_clones";
+    }
+
+    // ISA levels `target_clones(...)` accepts (see optimization::multiversionFunctions).
+    static bool isCloneTarget(std::string_view name)
+    {
+        return name == "avx512" || name == "avx2" || name == "sse4" || name == "default";
+    }
+
     ast::StmtPtr Parser::declaration()
     {
         try
         {
-            // Bare-metal function qualifiers: `naked` and/or `interrupt`
-            // (contextual keywords, order-independent) may precede `def`. Only
-            // treated as qualifiers when the run of them is actually followed by
-            // `def`, so `naked` and `interrupt` remain usable as identifiers
-            // elsewhere.
-            if (check(lexer::TokenType::IDENTIFIER) &&
-                (peek().value == "naked" || peek().value == "interrupt"))
+            // Function qualifiers: `naked`, `interrupt`, `memoize` and
+            // `target_clones("avx512", "avx2", ...)` (contextual keywords,
+            // order-independent) may precede `def`. Only treated as qualifiers
+            // when the run of them is actually followed by `def`, so the words
+            // remain usable as identifiers elsewhere.
+            if (check(lexer::TokenType::IDENTIFIER) && isFunctionQualifier(peek().value))
             {
-                size_t look = current;
-                while (look < tokens.size() &&
-                       tokens[look].type == lexer::TokenType::IDENTIFIER &&
-                       (tokens[look].value == "naked" || tokens[look].value == "interrupt"))
+                size_t look = 0;
+                while (lookahead(look).type == lexer::TokenType::IDENTIFIER &&
+                       isFunctionQualifier(lookahead(look).value))
+                {
+                    if (lookahead(look).value == "target_clones" &&
+                        lookahead(look + 1).type == lexer::TokenType::LEFT_PAREN)
+                    {
+                        look += 2;
+                        while (lookahead(look).type != lexer::TokenType::RIGHT_PAREN &&
+                               lookahead(look).type != lexer::TokenType::EOF_TOKEN)
+                            ++look;
+                    }
                     ++look;
-                if (look < tokens.size() && tokens[look].type == lexer::TokenType::DEF)
+                }
+                if (lookahead(look).type == lexer::TokenType::DEF)
                 {
-                    bool nakedQ = false, interruptQ = false;
-                    while (check(lexer::TokenType::IDENTIFIER) &&
-                           (peek().value == "naked" || peek().value == "interrupt"))
+                    bool nakedQ = false, interruptQ = false, memoizeQ = false;
+                    std::vector<std::string> clones;
+                    while (check(lexer::TokenType::IDENTIFIER) && isFunctionQualifier(peek().value))
                     {
-                        if (peek().value == "naked") nakedQ = true; else interruptQ = true;
+                        if (peek().value == "naked") nakedQ = true;
+                        else if (peek().value == "interrupt") interruptQ = true;
+                        else if (peek().value == "memoize") memoizeQ = true;
+                        else
+                        {
+                            advance(); // consume 'target_clones'
+                            consume(lexer::TokenType::LEFT_PAREN, "Expected '(' after 'target_clones'");
+                            do
+                            {
+                                lexer::Token level = consume(lexer::TokenType::STRING,
+                                                             "Expected an ISA level string in 'target_clones'");
+                                if (level.type != lexer::TokenType::STRING)
+                                    break;
+                                if (!isCloneTarget(level.value))
+                                    error(level, "Unknown target_clones level '" + std::string(level.value) +
+                                                     "' (expected avx512, avx2, sse4 or default)");
+                                else
+                                    clones.emplace_back(level.value);
+                            } while (match(lexer::TokenType::COMMA));
+                            consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after target_clones levels");
+                            continue;
+                        }
                         advance();
                     }
                     consume(lexer::TokenType::DEF, "Expected 'def' after function qualifier");
                     auto fn = functionDeclaration();
-                    if (auto f = std::dynamic_pointer_cast<ast::FunctionStmt>(fn))
+                    if (auto *f = ast::dyn_cast<ast::FunctionStmt>(fn))
                     {
                         f->isNaked = nakedQ;
                         f->isInterrupt = interruptQ;
+                        f->isMemoize = memoizeQ;
+                        f->targetClones = std::move(clones);
                     }
                     return fn;
                 }
             }
+            // `const def`: a function the compiler may run at compile time.
+            if (check(lexer::TokenType::CONST) && checkNext(lexer::TokenType::DEF))
+            {
+                advance(); // consume 'const'
+                advance(); // consume 'def'
+                auto fn = functionDeclaration();
+                if (auto *f = ast::dyn_cast<ast::FunctionStmt>(fn))
+                    f->isConstFn = true;
+                return fn;
+            }
             if (match(lexer::TokenType::LET) || match(lexer::TokenType::CONST))
             {
                 return varDeclaration();
@@ -150,14 +207,14 @@ namespace parser
             std::vector<std::string> names;
             do
             {
-                names.push_back(consume(lexer::TokenType::IDENTIFIER,
+                names.emplace_back(consume(lexer::TokenType::IDENTIFIER,
                                         "Expected name in tuple pattern").value);
             } while (match(lexer::TokenType::COMMA));
             consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after tuple pattern");
             consume(lexer::TokenType::EQUAL, "Expected '=' in destructuring declaration");
             auto init = expression();
             consume(lexer::TokenType::SEMI_COLON, "Expected ';' after destructuring declaration");
-            return std::make_shared<ast::DestructureStmt>(lp, std::move(names), init, isConstant);
+            return ast::make<ast::DestructureStmt>(lp, std::move(names), init, isConstant);
         }
 
         auto name = consume(lexer::TokenType::IDENTIFIER, "Expected variable name");
@@ -172,7 +229,7 @@ namespace parser
             initializer = expression();
         }
         consume(lexer::TokenType::SEMI_COLON, "Expected ';' after variable declaration");
-        return std::make_shared<ast::VariableStmt>(name, name.value, type, initializer, isConstant);
+        return ast::make<ast::VariableStmt>(name, std::string(name.value), type, initializer, isConstant);
     }
 
     std::vector<ast::TypeParameter> Parser::parseTypeParameters()
@@ -191,7 +248,7 @@ namespace parser
                     auto bt = parseType();
                     if (bt) bound = bt->toString();
                 }
-                typeParams.emplace_back(tpName, tpName.value);
+                typeParams.emplace_back(tpName, std::string(tpName.value));
                 typeParams.back().bound = bound;
             } while (match(lexer::TokenType::COMMA));
             consume(lexer::TokenType::GREATER, "Expected '>' after type parameters");
@@ -220,6 +277,14 @@ namespace parser
         {
             returnType = parseType();
         }
+        if (interface_ && typeParams.empty() && match(lexer::TokenType::SEMI_COLON))
+        {
+            // A prototype; the body is in the precompiled module's object.
+            auto proto = ast::make<ast::FunctionStmt>(name, std::string(name.value), parameters,
+                                                      returnType, nullptr, isAsync);
+            proto->isInterface = true;
+            return proto;
+        }
         consume(lexer::TokenType::LEFT_BRACE, "Expected '{' before function body");
         bool savedSawYield = sawYield;
         sawYield = false;
@@ -228,78 +293,54 @@ namespace parser
         sawYield = savedSawYield;
         if (isGenerator)
         {
-            // Generator: collect yields into a vector and return it as an array.
-            body = desugarGenerator(body, name);
-            // The call yields a sequence; type it as list<int> so `for x in g()`
-            // drives the array path. (Element slots are 64-bit, like all values.)
+            // Generator: the body runs lazily, one `yield` per resume (see
+            // IRGenerator::beginGenerator). The call returns a gen<int> handle;
+            // `for x in g()`, `g.next()` and query chains pull from it.
+            rewriteGeneratorReturns(body, name);
             auto intTok = lexer::Token(lexer::TokenType::IDENTIFIER, "int", name.filename, name.line, name.column);
-            std::vector<ast::TypePtr> targs{std::make_shared<ast::SimpleType>(intTok)};
-            returnType = std::make_shared<ast::GenericType>(name, "list", targs);
+            std::vector<ast::TypePtr> targs{ast::make<ast::SimpleType>(intTok)};
+            returnType = ast::make<ast::GenericType>(name, "gen", targs);
         }
+        std::shared_ptr<ast::FunctionStmt> fn;
         if (!typeParams.empty())
-            return std::make_shared<ast::FunctionStmt>(name, name.value, typeParams,
-                                                       parameters, returnType, body, isAsync);
-        return std::make_shared<ast::FunctionStmt>(name, name.value, parameters, returnType, body, isAsync);
-    }
-
-    // Build a `vecToArray(__gen_acc)` call expression used to finalize a
-    // generator body into a returnable array.
-    ast::ExprPtr Parser::makeVecToArrayCall(const lexer::Token &tok)
-    {
-        auto acc = std::make_shared<ast::VariableExpr>(tok, "__gen_acc");
-        auto conv = std::make_shared<ast::VariableExpr>(tok, "vecToArray");
-        std::vector<ast::ExprPtr> args{acc};
-        return std::make_shared<ast::CallExpr>(tok, conv, args);
+            fn = ast::make<ast::FunctionStmt>(name, std::string(name.value), typeParams,
+                                              parameters, returnType, body, isAsync);
+        else
+            fn = ast::make<ast::FunctionStmt>(name, std::string(name.value), parameters, returnType, body, isAsync);
+        fn->isGenerator = isGenerator;
+        return fn;
     }
 
     // Replace every `return [expr]` in a generator body with
-    // `return vecToArray(__gen_acc)` (the original value, if any, is discarded —
-    // a generator stops at a return rather than producing a scalar). Mutates
-    // ReturnStmt nodes in place; recurses into nested control flow.
+    // `return __gen_done()` (the original value, if any, is discarded — a
+    // generator stops at a return rather than producing a scalar; codegen
+    // branches to the final suspend). Mutates ReturnStmt nodes in place;
+    // recurses into nested control flow.
     void Parser::rewriteGeneratorReturns(const ast::StmtPtr &stmt, const lexer::Token &tok)
     {
         if (!stmt) return;
-        if (auto r = std::dynamic_pointer_cast<ast::ReturnStmt>(stmt))
+        if (auto *r = ast::dyn_cast<ast::ReturnStmt>(stmt))
         {
-            r->value = makeVecToArrayCall(tok);
+            auto done = ast::make<ast::VariableExpr>(tok, "__gen_done");
+            r->value = ast::make<ast::CallExpr>(tok, done, std::vector<ast::ExprPtr>{});
             return;
         }
-        if (auto b = std::dynamic_pointer_cast<ast::BlockStmt>(stmt))
+        if (auto *b = ast::dyn_cast<ast::BlockStmt>(stmt))
         {
             for (auto &s : b->statements) rewriteGeneratorReturns(s, tok);
         }
-        else if (auto i = std::dynamic_pointer_cast<ast::IfStmt>(stmt))
+        else if (auto *i = ast::dyn_cast<ast::IfStmt>(stmt))
         {
             rewriteGeneratorReturns(i->thenBranch, tok);
             for (auto &e : i->elifBranches) rewriteGeneratorReturns(e.second, tok);
             rewriteGeneratorReturns(i->elseBranch, tok);
         }
-        else if (auto w = std::dynamic_pointer_cast<ast::WhileStmt>(stmt))
+        else if (auto *w = ast::dyn_cast<ast::WhileStmt>(stmt))
             rewriteGeneratorReturns(w->body, tok);
-        else if (auto f = std::dynamic_pointer_cast<ast::ForStmt>(stmt))
+        else if (auto *f = ast::dyn_cast<ast::ForStmt>(stmt))
             rewriteGeneratorReturns(f->body, tok);
     }
 
-    // Wrap a generator body: prepend `let __gen_acc = vecNew();`, rewrite any
-    // returns to finalize the array, and append `return vecToArray(__gen_acc);`.
-    ast::StmtPtr Parser::desugarGenerator(const ast::StmtPtr &body, const lexer::Token &tok)
-    {
-        auto block = std::dynamic_pointer_cast<ast::BlockStmt>(body);
-        std::vector<ast::StmtPtr> stmts;
-
-        auto vecNew = std::make_shared<ast::VariableExpr>(tok, "vecNew");
-        auto newCall = std::make_shared<ast::CallExpr>(tok, vecNew, std::vector<ast::ExprPtr>{});
-        stmts.push_back(std::make_shared<ast::VariableStmt>(tok, "__gen_acc", nullptr, newCall, false));
-
-        if (block)
-        {
-            for (auto &s : block->statements) rewriteGeneratorReturns(s, tok);
-            for (auto &s : block->statements) stmts.push_back(s);
-        }
-        stmts.push_back(std::make_shared<ast::ReturnStmt>(tok, makeVecToArrayCall(tok)));
-        return std::make_shared<ast::BlockStmt>(tok, stmts);
-    }
-
     ast::StmtPtr Parser::classDeclaration(bool isMmio)
     {
         auto name = consume(lexer::TokenType::IDENTIFIER, "Expected class name");
@@ -331,8 +372,8 @@ namespace parser
                 if (match(lexer::TokenType::EQUAL))
                     init = expression();
                 match(lexer::TokenType::SEMI_COLON); // optional trailing ';'
-                fields.push_back(std::make_shared<ast::VariableStmt>(
-                    fieldName, fieldName.value, fieldType, init, false));
+                fields.push_back(ast::make<ast::VariableStmt>(
+                    fieldName, std::string(fieldName.value), fieldType, init, false));
             }
             else
             {
@@ -343,11 +384,11 @@ namespace parser
         consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after class body");
         std::shared_ptr<ast::ClassStmt> cls;
         if (!typeParams.empty())
-            cls = std::make_shared<ast::ClassStmt>(name, name.value, typeParams,
+            cls = ast::make<ast::ClassStmt>(name, std::string(name.value), typeParams,
                                                    nullptr, std::vector<ast::TypePtr>{},
                                                    fields, methods);
         else
-            cls = std::make_shared<ast::ClassStmt>(name, name.value, fields, methods);
+            cls = ast::make<ast::ClassStmt>(name, std::string(name.value), fields, methods);
         cls->isMmio = isMmio;
         return cls;
     }
@@ -374,9 +415,9 @@ namespace parser
             body = blockStmt();
         }
         if (!typeParams.empty())
-            return std::make_shared<ast::FunctionStmt>(name, name.value, typeParams,
+            return ast::make<ast::FunctionStmt>(name, std::string(name.value), typeParams,
                                                        parameters, returnType, body, isAsync);
-        return std::make_shared<ast::FunctionStmt>(name, name.value, parameters, returnType, body, isAsync);
+        return ast::make<ast::FunctionStmt>(name, std::string(name.value), parameters, returnType, body, isAsync);
     }
 
     ast::StmtPtr Parser::enumDeclaration()
@@ -400,7 +441,7 @@ namespace parser
                     while (match(lexer::TokenType::COMMA));
                 }
                 consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after enum variant fields");
-                variantFields[member.value] = std::move(fields);
+                variantFields[std::string(member.value)] = std::move(fields);
             }
             else if (match(lexer::TokenType::EQUAL))
             {
@@ -414,7 +455,7 @@ namespace parser
             match(lexer::TokenType::COMMA); // optional separator
         }
         consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after enum body");
-        auto enumStmt = std::make_shared<ast::EnumStmt>(name, name.value, members);
+        auto enumStmt = ast::make<ast::EnumStmt>(name, std::string(name.value), members);
         enumStmt->variantFields = std::move(variantFields);
         return enumStmt;
     }
@@ -424,7 +465,7 @@ namespace parser
         auto name = consume(lexer::TokenType::IDENTIFIER, "Expected trait name");
         parseTypeParameters(); // optional generic params (ignored for now)
         consume(lexer::TokenType::LEFT_BRACE, "Expected '{' before trait body");
-        auto trait = std::make_shared<ast::TraitStmt>(name, name.value);
+        auto trait = ast::make<ast::TraitStmt>(name, std::string(name.value));
         while (!check(lexer::TokenType::RIGHT_BRACE) && !isAtEnd())
         {
             if (match(lexer::TokenType::DEF) || match(lexer::TokenType::ASYNC))
@@ -450,10 +491,10 @@ namespace parser
             typeTok = consume(lexer::TokenType::IDENTIFIER, "Expected type name after 'for'");
         }
         parseTypeParameters(); // optional generic params (ignored for now)
-        ast::TypePtr typePtr = std::make_shared<ast::SimpleType>(
+        ast::TypePtr typePtr = ast::make<ast::SimpleType>(
             lexer::Token(lexer::TokenType::IDENTIFIER, typeTok.value, "", typeTok.line, typeTok.column));
         consume(lexer::TokenType::LEFT_BRACE, "Expected '{' before impl body");
-        auto impl = std::make_shared<ast::ImplStmt>(first, traitName, typePtr);
+        auto impl = ast::make<ast::ImplStmt>(first, traitName, typePtr);
         while (!check(lexer::TokenType::RIGHT_BRACE) && !isAtEnd())
         {
             if (match(lexer::TokenType::DEF) || match(lexer::TokenType::ASYNC))
@@ -474,23 +515,34 @@ namespace parser
         // a label, so require one to follow.
         if (check(lexer::TokenType::IDENTIFIER) && checkNext(lexer::TokenType::COLON))
         {
-            std::string label = peek().value;
+            std::string label(peek().value);
             advance(); // name
             advance(); // ':'
             if (match(lexer::TokenType::WHILE))
             {
                 auto s = whileStmt();
-                if (auto w = std::dynamic_pointer_cast<ast::WhileStmt>(s)) w->label = label;
+                if (auto *w = ast::dyn_cast<ast::WhileStmt>(s)) w->label = label;
                 return s;
             }
             if (match(lexer::TokenType::FOR))
             {
                 auto s = forStmt();
-                if (auto f = std::dynamic_pointer_cast<ast::ForStmt>(s)) f->label = label;
+                if (auto *f = ast::dyn_cast<ast::ForStmt>(s)) f->label = label;
                 return s;
             }
             error(peek(), "A label must be followed by a 'while' or 'for' loop");
         }
+        // `parallel for ...`: `parallel` is contextual, so it stays usable as
+        // an ordinary name everywhere else.
+        if (check(lexer::TokenType::IDENTIFIER) && peek().value == "parallel" &&
+            checkNext(lexer::TokenType::FOR))
+        {
+            advance(); // parallel
+            advance(); // for
+            return forStmt(true);
+        }
+        if (atWithArena())
+            return withArenaStmt();
         if (match(lexer::TokenType::IF))
             return ifStmt();
         if (match(lexer::TokenType::WHILE))
@@ -503,19 +555,17 @@ namespace parser
             return returnStmt();
         if (match(lexer::TokenType::YIELD))
         {
-            // `yield <expr>` in a generator. Desugared to `vecPush(__gen_acc,
-            // <expr>)`; functionDeclaration() wraps the body to create __gen_acc
-            // and return the collected values as an array. Marks the function a
-            // generator via sawYield.
+            // `yield <expr>` in a generator. Desugared to `__gen_yield(<expr>)`,
+            // which codegen lowers to a store into the generator's frame and a
+            // return to the consumer. Marks the function a generator via sawYield.
             lexer::Token kw = previous();
             ast::ExprPtr val = expression();
             match(lexer::TokenType::SEMI_COLON);
             sawYield = true;
-            auto acc = std::make_shared<ast::VariableExpr>(kw, "__gen_acc");
-            auto push = std::make_shared<ast::VariableExpr>(kw, "vecPush");
-            std::vector<ast::ExprPtr> args{acc, val};
-            auto call = std::make_shared<ast::CallExpr>(kw, push, args);
-            return std::make_shared<ast::ExpressionStmt>(kw, call);
+            auto yieldFn = ast::make<ast::VariableExpr>(kw, "__gen_yield");
+            std::vector<ast::ExprPtr> args{val};
+            auto call = ast::make<ast::CallExpr>(kw, yieldFn, args);
+            return ast::make<ast::ExpressionStmt>(kw, call);
         }
         if (match(lexer::TokenType::MATCH))
             return matchStmt();
@@ -537,7 +587,7 @@ namespace parser
             std::string label;
             if (check(lexer::TokenType::IDENTIFIER)) label = advance().value; // break outer;
             match(lexer::TokenType::SEMI_COLON); // optional ';'
-            auto s = std::make_shared<ast::BreakStmt>(kw);
+            auto s = ast::make<ast::BreakStmt>(kw);
             s->targetLabel = label;
             return s;
         }
@@ -547,7 +597,7 @@ namespace parser
             std::string label;
             if (check(lexer::TokenType::IDENTIFIER)) label = advance().value; // continue outer;
             match(lexer::TokenType::SEMI_COLON); // optional ';'
-            auto s = std::make_shared<ast::ContinueStmt>(kw);
+            auto s = ast::make<ast::ContinueStmt>(kw);
             s->targetLabel = label;
             return s;
         }
@@ -556,7 +606,7 @@ namespace parser
         {
             lexer::Token kw = previous();
             ast::StmtPtr body = statement();
-            return std::make_shared<ast::DeferStmt>(kw, body);
+            return ast::make<ast::DeferStmt>(kw, body);
         }
         return expressionStmt();
     }
@@ -599,24 +649,74 @@ namespace parser
         if (!catchBlock && !finallyBlock)
             error(keyword, "'try' must be followed by 'catch' or 'finally'");
 
-        return std::make_shared<ast::TryStmt>(keyword, tryBlock, catchVar,
+        return ast::make<ast::TryStmt>(keyword, tryBlock, catchVar,
                                               catchBlock, finallyBlock);
     }
 
+    // `withArena { ... }` or `withArena(a) { ... }`. Contextual like
+    // `parallel`: only a block (after the optional parenthesized arena) makes
+    // it the statement, so a call `withArena(x);` still parses as a call.
+    bool Parser::atWithArena() const
+    {
+        if (!check(lexer::TokenType::IDENTIFIER) || peek().value != "withArena")
+            return false;
+        if (checkNext(lexer::TokenType::LEFT_BRACE))
+            return true;
+        if (!checkNext(lexer::TokenType::LEFT_PAREN))
+            return false;
+        int depth = 0;
+        for (size_t i = 1; lookahead(i).type != lexer::TokenType::EOF_TOKEN; ++i)
+        {
+            if (lookahead(i).type == lexer::TokenType::LEFT_PAREN)
+                ++depth;
+            else if (lookahead(i).type == lexer::TokenType::RIGHT_PAREN && --depth == 0)
+                return lookahead(i + 1).type == lexer::TokenType::LEFT_BRACE;
+        }
+        return false;
+    }
+
+    // Desugared to
+    //     { __arena_enter(a?); try { body } finally { __arena_exit(); } }
+    // so the region is released on every way out of the block: falling off
+    // the end, return, break/continue, or an exception.
+    ast::StmtPtr Parser::withArenaStmt()
+    {
+        lexer::Token kw = advance(); // withArena
+        std::vector<ast::ExprPtr> arena;
+        if (match(lexer::TokenType::LEFT_PAREN))
+        {
+            arena.push_back(expression());
+            consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after arena");
+        }
+        consume(lexer::TokenType::LEFT_BRACE, "Expected '{' after 'withArena'");
+        ast::StmtPtr body = blockStmt();
+
+        auto runtimeCall = [&](const char *name, std::vector<ast::ExprPtr> args) -> ast::StmtPtr {
+            auto callee = ast::make<ast::VariableExpr>(kw, name);
+            auto call = ast::make<ast::CallExpr>(kw, callee, std::move(args));
+            return ast::make<ast::ExpressionStmt>(kw, call);
+        };
+        std::vector<ast::StmtPtr> exit{runtimeCall("__arena_exit", {})};
+        auto release = ast::make<ast::BlockStmt>(kw, exit);
+        auto guarded = ast::make<ast::TryStmt>(kw, body, "", nullptr, release);
+        std::vector<ast::StmtPtr> block{runtimeCall("__arena_enter", std::move(arena)), guarded};
+        return ast::make<ast::BlockStmt>(kw, block);
+    }
+
     // throw <expr>;
     ast::StmtPtr Parser::throwStmt()
     {
         lexer::Token keyword = previous();
         ast::ExprPtr value = expression();
         consume(lexer::TokenType::SEMI_COLON, "Expected ';' after thrown value");
-        return std::make_shared<ast::ThrowStmt>(keyword, value);
+        return ast::make<ast::ThrowStmt>(keyword, value);
     }
 
     ast::StmtPtr Parser::expressionStmt()
     {
         auto expr = expression();
         consume(lexer::TokenType::SEMI_COLON, "Expected ';' after expression");
-        return std::make_shared<ast::ExpressionStmt>(expr->token, expr);
+        return ast::make<ast::ExpressionStmt>(expr->token, expr);
     }
 
     ast::StmtPtr Parser::ifStmt()
@@ -638,7 +738,7 @@ namespace parser
             consume(lexer::TokenType::LEFT_BRACE, "Expected '{' after else");
             elseBranch = blockStmt();
         }
-        return std::make_shared<ast::IfStmt>(condition->token, condition, thenBranch, elifBranches, elseBranch);
+        return ast::make<ast::IfStmt>(condition->token, condition, thenBranch, elifBranches, elseBranch);
     }
 
     ast::StmtPtr Parser::whileStmt()
@@ -646,10 +746,10 @@ namespace parser
         auto condition = expression();
         consume(lexer::TokenType::LEFT_BRACE, "Expected '{' after while condition");
         auto body = blockStmt();
-        return std::make_shared<ast::WhileStmt>(condition->token, condition, body);
+        return ast::make<ast::WhileStmt>(condition->token, condition, body);
     }
 
-    ast::StmtPtr Parser::forStmt()
+    ast::StmtPtr Parser::forStmt(bool parallel)
     {
         auto variable = consume(lexer::TokenType::IDENTIFIER, "Expected loop variable");
         ast::TypePtr variableType = nullptr;
@@ -665,11 +765,44 @@ namespace parser
         {
             lexer::Token rangeOp = previous();
             auto end = expression();
-            iterable = std::make_shared<ast::BinaryExpr>(iterable->token, iterable, rangeOp, end);
+            iterable = ast::make<ast::BinaryExpr>(iterable->token, iterable, rangeOp, end);
+        }
+        // `parallel for ... reduce(op: acc)`: op is + * & | ^ or min/max.
+        std::string reduceOp, reduceVar;
+        if (parallel && check(lexer::TokenType::IDENTIFIER) && peek().value == "reduce" &&
+            checkNext(lexer::TokenType::LEFT_PAREN))
+        {
+            advance(); // reduce
+            advance(); // (
+            lexer::Token op = advance();
+            switch (op.type)
+            {
+            case lexer::TokenType::PLUS: reduceOp = "+"; break;
+            case lexer::TokenType::STAR: reduceOp = "*"; break;
+            case lexer::TokenType::BITWISE_AND: reduceOp = "&"; break;
+            case lexer::TokenType::BITWISE_OR: reduceOp = "|"; break;
+            case lexer::TokenType::BITWISE_XOR: reduceOp = "^"; break;
+            case lexer::TokenType::IDENTIFIER:
+                if (op.value == "min" || op.value == "max")
+                {
+                    reduceOp = op.value;
+                    break;
+                }
+                [[fallthrough]];
+            default:
+                error(op, "Expected a reduction operator (+, *, &, |, ^, min or max)");
+            }
+            consume(lexer::TokenType::COLON, "Expected ':' after reduction operator");
+            reduceVar = consume(lexer::TokenType::IDENTIFIER, "Expected reduction variable").value;
+            consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after reduction variable");
         }
         consume(lexer::TokenType::LEFT_BRACE, "Expected '{' after for iterable");
         auto body = blockStmt();
-        return std::make_shared<ast::ForStmt>(variable, variable.value, variableType, iterable, body);
+        auto loop = ast::make<ast::ForStmt>(variable, std::string(variable.value), variableType, iterable, body);
+        loop->parallel = parallel;
+        loop->reduceOp = reduceOp;
+        loop->reduceVar = reduceVar;
+        return loop;
     }
 
     ast::StmtPtr Parser::blockStmt()
@@ -680,7 +813,7 @@ namespace parser
             statements.push_back(declaration());
         }
         consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after block");
-        return std::make_shared<ast::BlockStmt>(previous(), statements);
+        return ast::make<ast::BlockStmt>(previous(), statements);
     }
 
     ast::StmtPtr Parser::returnStmt()
@@ -692,7 +825,7 @@ namespace parser
             value = expression();
         }
         consume(lexer::TokenType::SEMI_COLON, "Expected ';' after return value");
-        return std::make_shared<ast::ReturnStmt>(keyword, value);
+        return ast::make<ast::ReturnStmt>(keyword, value);
     }
 
     ast::StmtPtr Parser::importStmt()
@@ -714,11 +847,12 @@ namespace parser
             while (match(lexer::TokenType::DOT))
             {
                 auto part = consume(lexer::TokenType::IDENTIFIER, "Expected name after '.'");
-                path += "/" + part.value;
+                path += '/';
+                path += part.value;
             }
         }
         match(lexer::TokenType::SEMI_COLON); // optional ';'
-        return std::make_shared<ast::ImportStmt>(tok, path);
+        return ast::make<ast::ImportStmt>(tok, path);
     }
 
     ast::StmtPtr Parser::matchStmt()
@@ -750,21 +884,21 @@ namespace parser
                 auto isCtorName = [](const std::string &n) {
                     return !n.empty() && n[0] >= 'A' && n[0] <= 'Z';
                 };
-                if (auto lit = std::dynamic_pointer_cast<ast::LiteralExpr>(pattern))
+                if (auto *lit = ast::dyn_cast<ast::LiteralExpr>(pattern))
                 {
                     if (lit->literalType == ast::LiteralExpr::LiteralType::NIL)
                         ctor = "None"; // `None` lexes as the nil literal
                 }
-                else if (auto call = std::dynamic_pointer_cast<ast::CallExpr>(pattern))
+                else if (auto *call = ast::dyn_cast<ast::CallExpr>(pattern))
                 {
-                    if (auto callee = std::dynamic_pointer_cast<ast::VariableExpr>(call->callee))
+                    if (auto *callee = ast::dyn_cast<ast::VariableExpr>(call->callee))
                     {
                         if (isCtorName(callee->name))
                         {
                             ctor = callee->name;
                             for (const auto &arg : call->arguments)
                             {
-                                if (auto v = std::dynamic_pointer_cast<ast::VariableExpr>(arg))
+                                if (auto *v = ast::dyn_cast<ast::VariableExpr>(arg))
                                     bindList.push_back(v->name);
                                 else
                                     bindList.push_back(""); // non-variable arg: no binding
@@ -774,7 +908,7 @@ namespace parser
                         }
                     }
                 }
-                else if (auto var = std::dynamic_pointer_cast<ast::VariableExpr>(pattern))
+                else if (auto *var = ast::dyn_cast<ast::VariableExpr>(pattern))
                 {
                     // Bare capitalized name: a nullary variant (Empty/None) or a
                     // plain enum constant (Red). Codegen distinguishes them.
@@ -800,7 +934,7 @@ namespace parser
             }
         }
         consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after match");
-        auto stmt = std::make_shared<ast::MatchStmt>(value->token, value, cases, defaultCase);
+        auto stmt = ast::make<ast::MatchStmt>(value->token, value, cases, defaultCase);
         stmt->caseCtor = std::move(ctors);
         stmt->caseBind = std::move(binds);
         stmt->caseBinds = std::move(bindLists);
@@ -821,7 +955,7 @@ namespace parser
         {
             auto op = previous();
             auto right = orExpr();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -838,7 +972,7 @@ namespace parser
             ast::ExprPtr thenE = ternary();
             consume(lexer::TokenType::COLON, "Expected ':' in ternary expression");
             ast::ExprPtr elseE = ternary();
-            return std::make_shared<ast::ConditionalExpr>(q, cond, thenE, elseE);
+            return ast::make<ast::ConditionalExpr>(q, cond, thenE, elseE);
         }
         return cond;
     }
@@ -852,19 +986,19 @@ namespace parser
             lexer::Token equals = previous();
             ast::ExprPtr value = assignment();
 
-            if (auto var = std::dynamic_pointer_cast<ast::VariableExpr>(expr))
+            if (auto *var = ast::dyn_cast<ast::VariableExpr>(expr))
             {
-                return std::make_shared<ast::AssignExpr>(equals, var->name, value);
+                return ast::make<ast::AssignExpr>(equals, var->name, value);
             }
-            else if (auto get = std::dynamic_pointer_cast<ast::GetExpr>(expr))
+            else if (auto *get = ast::dyn_cast<ast::GetExpr>(expr))
             {
-                return std::make_shared<ast::SetExpr>(
+                return ast::make<ast::SetExpr>(
                     equals, get->object, get->name, value);
             }
-            else if (std::dynamic_pointer_cast<ast::IndexExpr>(expr))
+            else if (ast::isa<ast::IndexExpr>(expr))
             {
                 // arr[i] = value -> AssignExpr with the IndexExpr as target.
-                return std::make_shared<ast::AssignExpr>(equals, expr, value);
+                return ast::make<ast::AssignExpr>(equals, expr, value);
             }
 
             errorHandler.reportError(error::ErrorCode::S005_INVALID_ASSIGNMENT_TARGET,
@@ -890,20 +1024,20 @@ namespace parser
             }
             ast::ExprPtr value = assignment();
             ast::ExprPtr combined =
-                std::make_shared<ast::BinaryExpr>(opTok, expr, opTok, value);
+                ast::make<ast::BinaryExpr>(opTok, expr, opTok, value);
 
-            if (auto var = std::dynamic_pointer_cast<ast::VariableExpr>(expr))
+            if (auto *var = ast::dyn_cast<ast::VariableExpr>(expr))
             {
-                return std::make_shared<ast::AssignExpr>(compound, var->name, combined);
+                return ast::make<ast::AssignExpr>(compound, var->name, combined);
             }
-            else if (auto get = std::dynamic_pointer_cast<ast::GetExpr>(expr))
+            else if (auto *get = ast::dyn_cast<ast::GetExpr>(expr))
             {
-                return std::make_shared<ast::SetExpr>(
+                return ast::make<ast::SetExpr>(
                     compound, get->object, get->name, combined);
             }
-            else if (std::dynamic_pointer_cast<ast::IndexExpr>(expr))
+            else if (ast::isa<ast::IndexExpr>(expr))
             {
-                return std::make_shared<ast::AssignExpr>(compound, expr, combined);
+                return ast::make<ast::AssignExpr>(compound, expr, combined);
             }
 
             errorHandler.reportError(error::ErrorCode::S005_INVALID_ASSIGNMENT_TARGET,
@@ -921,7 +1055,7 @@ namespace parser
         {
             auto op = previous();
             auto right = andExpr();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -933,7 +1067,7 @@ namespace parser
         {
             auto op = previous();
             auto right = bitOr();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -946,7 +1080,7 @@ namespace parser
         {
             auto op = previous();
             auto right = bitXor();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -959,7 +1093,7 @@ namespace parser
         {
             auto op = previous();
             auto right = bitAnd();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -972,7 +1106,7 @@ namespace parser
         {
             auto op = previous();
             auto right = equality();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -984,7 +1118,7 @@ namespace parser
         {
             auto op = previous();
             auto right = comparison();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -997,7 +1131,7 @@ namespace parser
         {
             auto op = previous();
             auto right = shift();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -1010,7 +1144,7 @@ namespace parser
         {
             auto op = previous();
             auto right = term();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -1022,7 +1156,7 @@ namespace parser
         {
             auto op = previous();
             auto right = factor();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -1035,7 +1169,7 @@ namespace parser
         {
             auto op = previous();
             auto right = unary();
-            expr = std::make_shared<ast::BinaryExpr>(op, expr, op, right);
+            expr = ast::make<ast::BinaryExpr>(op, expr, op, right);
         }
         return expr;
     }
@@ -1053,7 +1187,7 @@ namespace parser
             ast::ExprPtr right = unary();
             op.type = isMut ? lexer::TokenType::MUTABLE_BORROW
                             : lexer::TokenType::BORROW;
-            return std::make_shared<ast::UnaryExpr>(op, op, right);
+            return ast::make<ast::UnaryExpr>(op, op, right);
         }
         // `move x` explicitly transfers ownership out of `x` (checked by the
         // borrow checker; identity at run time).
@@ -1061,19 +1195,19 @@ namespace parser
         {
             lexer::Token op = previous();
             ast::ExprPtr right = unary();
-            return std::make_shared<ast::UnaryExpr>(op, op, right);
+            return ast::make<ast::UnaryExpr>(op, op, right);
         }
         if (match(lexer::TokenType::BANG) || match(lexer::TokenType::MINUS) ||
             match(lexer::TokenType::BITWISE_NOT))
         {
             lexer::Token op = previous();
             ast::ExprPtr right = unary();
-            return std::make_shared<ast::UnaryExpr>(op, op, right);
+            return ast::make<ast::UnaryExpr>(op, op, right);
         }
         if (match(lexer::TokenType::AWAIT))
         {
             auto expr = unary();
-            return std::make_shared<ast::AwaitExpr>(previous(), expr);
+            return ast::make<ast::AwaitExpr>(previous(), expr);
         }
         if (match(lexer::TokenType::NEW))
         {
@@ -1088,7 +1222,7 @@ namespace parser
         {
             lexer::Token op = previous();
             auto ch = unary();
-            return std::make_shared<ast::ChannelReceiveExpr>(op, ch);
+            return ast::make<ast::ChannelReceiveExpr>(op, ch);
         }
         return call();
     }
@@ -1109,7 +1243,7 @@ namespace parser
                     } while (match(lexer::TokenType::COMMA));
                 }
                 auto paren = consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after arguments");
-                expr = std::make_shared<ast::CallExpr>(paren, expr, arguments);
+                expr = ast::make<ast::CallExpr>(paren, expr, arguments);
             }
             else if (match(lexer::TokenType::DOT))
             {
@@ -1120,28 +1254,32 @@ namespace parser
                     auto idxTok = advance();
                     std::vector<ast::ExprPtr> args{
                         expr,
-                        std::make_shared<ast::LiteralExpr>(
-                            idxTok, idxTok.value, ast::LiteralExpr::LiteralType::INTEGER)};
-                    expr = std::make_shared<ast::CallExpr>(
-                        idxTok, std::make_shared<ast::VariableExpr>(idxTok, "__tupleGet"), args);
+                        ast::make<ast::LiteralExpr>(
+                            idxTok, std::string(idxTok.value), ast::LiteralExpr::LiteralType::INTEGER)};
+                    expr = ast::make<ast::CallExpr>(
+                        idxTok, ast::make<ast::VariableExpr>(idxTok, "__tupleGet"), args);
                 }
                 else
                 {
-                    auto name = consume(lexer::TokenType::IDENTIFIER, "Expected property name after '.'");
-                    expr = std::make_shared<ast::GetExpr>(name, expr, name.value);
+                    // `where`/`select` are keywords elsewhere but name the
+                    // list query operators after a '.'.
+                    auto name = (check(lexer::TokenType::WHERE) || check(lexer::TokenType::SELECT))
+                                    ? advance()
+                                    : consume(lexer::TokenType::IDENTIFIER, "Expected property name after '.'");
+                    expr = ast::make<ast::GetExpr>(name, expr, std::string(name.value));
                 }
             }
             else if (match(lexer::TokenType::SAFE_ACCESS))
             {
                 // a?.b : safe navigation (null base yields null).
                 auto name = consume(lexer::TokenType::IDENTIFIER, "Expected property name after '?.'");
-                expr = std::make_shared<ast::GetExpr>(name, expr, name.value, /*isSafe=*/true);
+                expr = ast::make<ast::GetExpr>(name, expr, std::string(name.value), /*isSafe=*/true);
             }
             else if (match(lexer::TokenType::BANG_BANG))
             {
                 // a!! : force-unwrap (trap if null).
                 lexer::Token op = previous();
-                expr = std::make_shared<ast::UnaryExpr>(op, op, expr);
+                expr = ast::make<ast::UnaryExpr>(op, op, expr);
             }
             else if (match(lexer::TokenType::LEFT_BRACKET))
             {
@@ -1153,19 +1291,19 @@ namespace parser
                     auto hi = expression();
                     auto bracket = consume(lexer::TokenType::RIGHT_BRACKET, "Expected ']' after slice");
                     std::vector<ast::ExprPtr> args{expr, index, hi};
-                    expr = std::make_shared<ast::CallExpr>(
-                        bracket, std::make_shared<ast::VariableExpr>(bracket, "__slice"), args);
+                    expr = ast::make<ast::CallExpr>(
+                        bracket, ast::make<ast::VariableExpr>(bracket, "__slice"), args);
                 }
                 else
                 {
                     auto bracket = consume(lexer::TokenType::RIGHT_BRACKET, "Expected ']' after index");
-                    expr = std::make_shared<ast::IndexExpr>(bracket, expr, index);
+                    expr = ast::make<ast::IndexExpr>(bracket, expr, index);
                 }
             }
             else if (match(lexer::TokenType::CHANNEL_SEND))
             {
                 auto value = expression();
-                expr = std::make_shared<ast::ChannelSendExpr>(previous(), expr, value);
+                expr = ast::make<ast::ChannelSendExpr>(previous(), expr, value);
             }
             else
             {
@@ -1179,48 +1317,41 @@ namespace parser
     {
         if (match(lexer::TokenType::TRUE))
         {
-            return std::make_shared<ast::LiteralExpr>(
+            return ast::make<ast::LiteralExpr>(
                 previous(), "true", ast::LiteralExpr::LiteralType::BOOLEAN);
         }
         if (match(lexer::TokenType::FALSE))
         {
-            return std::make_shared<ast::LiteralExpr>(
+            return ast::make<ast::LiteralExpr>(
                 previous(), "false", ast::LiteralExpr::LiteralType::BOOLEAN);
         }
         if (match(lexer::TokenType::NIL))
         {
-            return std::make_shared<ast::LiteralExpr>(
+            return ast::make<ast::LiteralExpr>(
                 previous(), "None", ast::LiteralExpr::LiteralType::NIL);
         }
         if (match(lexer::TokenType::INT) || match(lexer::TokenType::FLOAT64) ||
             match(lexer::TokenType::FLOAT32))
         {
             auto type = previous().type == lexer::TokenType::INT ? ast::LiteralExpr::LiteralType::INTEGER : ast::LiteralExpr::LiteralType::FLOAT;
-            return std::make_shared<ast::LiteralExpr>(previous(), previous().value, type);
+            return ast::make<ast::LiteralExpr>(previous(), std::string(previous().value), type);
         }
         if (match(lexer::TokenType::STRING))
         {
-            return std::make_shared<ast::LiteralExpr>(
-                previous(), previous().value, ast::LiteralExpr::LiteralType::STRING);
+            return ast::make<ast::LiteralExpr>(
+                previous(), std::string(previous().value), ast::LiteralExpr::LiteralType::STRING);
         }
         if (match(lexer::TokenType::IDENTIFIER))
         {
-            return std::make_shared<ast::VariableExpr>(previous(), previous().value);
+            // `chan<T>(n)` is a channel constructor (`chan` is contextual, so
+            // it stays usable as an ordinary name).
+            if (previous().value == "chan" && atChannelTypeArgsCall())
+                return channelConstructor(previous());
+            return ast::make<ast::VariableExpr>(previous(), std::string(previous().value));
         }
         if (match(lexer::TokenType::CHANNEL))
         {
-            // channel<T>() or channel() -> a new channel handle.
-            lexer::Token tok = previous();
-            if (match(lexer::TokenType::LESS))
-            {
-                parseType();
-                consume(lexer::TokenType::GREATER, "Expected '>' after channel element type");
-            }
-            consume(lexer::TokenType::LEFT_PAREN, "Expected '(' after channel");
-            consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after channel(");
-            return std::make_shared<ast::CallExpr>(
-                tok, std::make_shared<ast::VariableExpr>(tok, "__chan_new"),
-                std::vector<ast::ExprPtr>{});
+            return channelConstructor(previous());
         }
         if (match(lexer::TokenType::LEFT_PAREN))
         {
@@ -1237,11 +1368,11 @@ namespace parser
                     elems.push_back(expression());
                 }
                 consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after tuple");
-                return std::make_shared<ast::CallExpr>(
-                    lp, std::make_shared<ast::VariableExpr>(lp, "__tuple"), elems);
+                return ast::make<ast::CallExpr>(
+                    lp, ast::make<ast::VariableExpr>(lp, "__tuple"), elems);
             }
             consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after expression");
-            return std::make_shared<ast::GroupingExpr>(expr->token, expr);
+            return ast::make<ast::GroupingExpr>(expr->token, expr);
         }
         if (match(lexer::TokenType::LEFT_BRACKET))
         {
@@ -1254,7 +1385,7 @@ namespace parser
                 } while (match(lexer::TokenType::COMMA));
             }
             auto token = consume(lexer::TokenType::RIGHT_BRACKET, "Expected ']' after list");
-            return std::make_shared<ast::ListExpr>(token, elements);
+            return ast::make<ast::ListExpr>(token, elements);
         }
         if (match(lexer::TokenType::LEFT_BRACE))
         {
@@ -1270,7 +1401,7 @@ namespace parser
                 } while (match(lexer::TokenType::COMMA));
             }
             auto token = consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after dictionary");
-            return std::make_shared<ast::DictionaryExpr>(token, entries);
+            return ast::make<ast::DictionaryExpr>(token, entries);
         }
         if (match(lexer::TokenType::LAMBDA))
         {
@@ -1284,11 +1415,11 @@ namespace parser
             }
             else
             {
-                returnType = std::make_shared<ast::SimpleType>(
+                returnType = ast::make<ast::SimpleType>(
                     lexer::Token(lexer::TokenType::NIL, "None", "", 0, 0));
             }
             auto body = expression();
-            return std::make_shared<ast::LambdaExpr>(previous(), parameters, returnType, body);
+            return ast::make<ast::LambdaExpr>(previous(), parameters, returnType, body);
         }
         error(peek(), "Expected expression");
         throw std::runtime_error("Parse error");
@@ -1308,14 +1439,12 @@ namespace parser
         }
         if (check(lexer::TokenType::RIGHT_SHIFT))
         {
-            tokens[current].type = lexer::TokenType::GREATER;
-            tokens[current].value = ">";
+            lookahead(0) = lexer::Token(lexer::TokenType::GREATER, ">", peek().filename, peek().line, peek().column);
             return; // do not advance: the rewritten token is the outer '>'
         }
         if (check(lexer::TokenType::RIGHT_SHIFT_EQUAL))
         {
-            tokens[current].type = lexer::TokenType::GREATER_EQUAL;
-            tokens[current].value = ">=";
+            lookahead(0) = lexer::Token(lexer::TokenType::GREATER_EQUAL, ">=", peek().filename, peek().line, peek().column);
             return;
         }
         consume(lexer::TokenType::GREATER, msg);
@@ -1340,11 +1469,11 @@ namespace parser
             if (match(lexer::TokenType::ARROW))
             {
                 auto returnType = parseType();
-                return std::make_shared<ast::FunctionType>(lp, elemTypes, returnType);
+                return ast::make<ast::FunctionType>(lp, elemTypes, returnType);
             }
             // Tuple type: represented as a generic `tuple<...>` (an opaque heap
             // pointer at the LLVM level).
-            return std::make_shared<ast::GenericType>(lp, "tuple", elemTypes);
+            return ast::make<ast::GenericType>(lp, "tuple", elemTypes);
         }
 
         // Accept the `channel` keyword as a type name (channel<T>).
@@ -1359,7 +1488,7 @@ namespace parser
                 typeArgs.push_back(parseType());
             } while (match(lexer::TokenType::COMMA));
             consumeGenericClose("Expected '>' after type arguments");
-            return std::make_shared<ast::GenericType>(token, token.value, typeArgs);
+            return ast::make<ast::GenericType>(token, std::string(token.value), typeArgs);
         }
         if (match(lexer::TokenType::LEFT_PAREN))
         {
@@ -1374,18 +1503,18 @@ namespace parser
             consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after function type parameters");
             consume(lexer::TokenType::ARROW, "Expected '->' in function type");
             auto returnType = parseType();
-            return std::make_shared<ast::FunctionType>(token, paramTypes, returnType);
+            return ast::make<ast::FunctionType>(token, paramTypes, returnType);
         }
         if (match(lexer::TokenType::OR))
         {
-            std::vector<ast::TypePtr> types = {std::make_shared<ast::SimpleType>(token)};
+            std::vector<ast::TypePtr> types = {ast::make<ast::SimpleType>(token)};
             do
             {
                 types.push_back(parseType());
             } while (match(lexer::TokenType::OR));
-            return std::make_shared<ast::UnionType>(token, types);
+            return ast::make<ast::UnionType>(token, types);
         }
-        return std::make_shared<ast::SimpleType>(token);
+        return ast::make<ast::SimpleType>(token);
     }
 
     std::vector<ast::Parameter> Parser::parseParameters()
@@ -1404,7 +1533,7 @@ namespace parser
                     if (match(lexer::TokenType::COLON))
                         selfType = parseType();
                     else
-                        selfType = std::make_shared<ast::SimpleType>(
+                        selfType = ast::make<ast::SimpleType>(
                             lexer::Token(lexer::TokenType::IDENTIFIER, "Self", "",
                                          selfTok.line, selfTok.column));
                     parameters.emplace_back("self", selfType);
@@ -1417,7 +1546,7 @@ namespace parser
                 {
                     error(peek(), "Failed to parse parameter type");
                     // Create a dummy type to avoid crash
-                    type = std::make_shared<ast::SimpleType>(
+                    type = ast::make<ast::SimpleType>(
                         lexer::Token(lexer::TokenType::IDENTIFIER, "int", "", 0, 0));
                 }
                 // Variadic parameter `name: T...` collects the remaining call
@@ -1426,7 +1555,7 @@ namespace parser
                 if (match(lexer::TokenType::ELLIPSIS))
                 {
                     variadic = true;
-                    type = std::make_shared<ast::GenericType>(
+                    type = ast::make<ast::GenericType>(
                         name, "list", std::vector<ast::TypePtr>{type});
                 }
                 // Optional default value `name: T = expr`. Callers may omit this
@@ -1434,7 +1563,7 @@ namespace parser
                 ast::ExprPtr defVal = nullptr;
                 if (!variadic && match(lexer::TokenType::EQUAL))
                     defVal = expression();
-                parameters.emplace_back(name.value, type);
+                parameters.emplace_back(std::string(name.value), type);
                 parameters.back().isVariadic = variadic;
                 parameters.back().defaultValue = defVal;
             } while (match(lexer::TokenType::COMMA));
@@ -1492,26 +1621,44 @@ namespace parser
 
     bool Parser::checkNext(lexer::TokenType type) const
     {
-        if (current + 1 >= tokens.size())
-            return false;
-        return tokens[current + 1].type == type;
+        return lookahead(1).type == type;
     }
 
     lexer::Token Parser::advance()
     {
         if (!isAtEnd())
+        {
+            lookahead(1); // pull the new peek() before dropping anything
             ++current;
+            while (current > 1)
+            {
+                window.pop_front();
+                --current;
+            }
+        }
         return previous();
     }
 
     lexer::Token Parser::peek() const
     {
-        return tokens[current];
+        return lookahead(0);
     }
 
     lexer::Token Parser::previous() const
     {
-        return tokens[current - 1];
+        return window[current - 1];
+    }
+
+    lexer::Token &Parser::lookahead(size_t k) const
+    {
+        while (window.size() <= current + k)
+        {
+            // Past the end the stream is EOF_TOKEN for good.
+            if (!window.empty() && window.back().type == lexer::TokenType::EOF_TOKEN)
+                return window.back();
+            window.push_back(source->next());
+        }
+        return window[current + k];
     }
 
     bool Parser::isAtEnd() const
@@ -1664,7 +1811,7 @@ namespace parser
                 return nullptr;
             }
             
-            left = std::make_shared<ast::BinaryExpr>(op, left, op, right);
+            left = ast::make<ast::BinaryExpr>(op, left, op, right);
         }
         
         return left;
@@ -1716,17 +1863,17 @@ namespace parser
         {
             ast::ExprPtr size = expression();
             consume(lexer::TokenType::RIGHT_BRACKET, "Expect ']' after array size.");
-            return std::make_shared<ast::NewExpr>(keyword, std::move(expr), std::move(size));
+            return ast::make<ast::NewExpr>(keyword, std::move(expr), std::move(size));
         }
 
-        return std::make_shared<ast::NewExpr>(keyword, std::move(expr), nullptr);
+        return ast::make<ast::NewExpr>(keyword, std::move(expr), nullptr);
     }
 
     ast::ExprPtr Parser::deleteExpr()
     {
         lexer::Token keyword = previous();
         ast::ExprPtr expr = primary();
-        return std::make_shared<ast::DeleteExpr>(keyword, std::move(expr));
+        return ast::make<ast::DeleteExpr>(keyword, std::move(expr));
     }
 
     ast::StmtPtr Parser::goStmt()
@@ -1735,7 +1882,7 @@ namespace parser
         // Accept both `go f(args);` and `go (f(args));`.
         auto expr = expression();
         consume(lexer::TokenType::SEMI_COLON, "Expected ';' after goroutine statement");
-        return std::make_shared<ast::GoStmt>(keyword, expr);
+        return ast::make<ast::GoStmt>(keyword, expr);
     }
 
     ast::StmtPtr Parser::selectStmt()
@@ -1761,7 +1908,7 @@ namespace parser
                 // or CHANNEL_RECEIVE, producing a ChannelReceiveExpr).
                 ast::ExprPtr recv = unary();
                 ast::ExprPtr channel = recv;
-                if (auto cr = std::dynamic_pointer_cast<ast::ChannelReceiveExpr>(recv))
+                if (auto *cr = ast::dyn_cast<ast::ChannelReceiveExpr>(recv))
                     channel = cr->channel;
 
                 consume(lexer::TokenType::COLON, "Expected ':' after select case");
@@ -1784,7 +1931,52 @@ namespace parser
         }
 
         consume(lexer::TokenType::RIGHT_BRACE, "Expected '}' after select statement");
-        return std::make_shared<ast::SelectStmt>(keyword, cases);
+        return ast::make<ast::SelectStmt>(keyword, cases);
+    }
+
+    ast::ExprPtr Parser::channelConstructor(const lexer::Token &tok)
+    {
+        // channel<T>(), channel<T>(cap), channel() -> a new channel handle.
+        // With a capacity the channel is buffered and bounded (0 = rendezvous).
+        if (match(lexer::TokenType::LESS))
+        {
+            parseType();
+            consumeGenericClose("Expected '>' after channel element type");
+        }
+        consume(lexer::TokenType::LEFT_PAREN, "Expected '(' after channel");
+        std::vector<ast::ExprPtr> args;
+        if (!check(lexer::TokenType::RIGHT_PAREN))
+            args.push_back(expression());
+        consume(lexer::TokenType::RIGHT_PAREN, "Expected ')' after channel capacity");
+        return ast::make<ast::CallExpr>(
+            tok, ast::make<ast::VariableExpr>(tok, "__chan_new"), args);
+    }
+
+    bool Parser::atChannelTypeArgsCall() const
+    {
+        // Lookahead for `<` type-args `>` `(` without consuming anything.
+        if (!check(lexer::TokenType::LESS))
+            return false;
+        int depth = 0;
+        for (size_t i = 0;; ++i)
+        {
+            switch (lookahead(i).type)
+            {
+            case lexer::TokenType::LESS: ++depth; break;
+            case lexer::TokenType::GREATER: --depth; break;
+            case lexer::TokenType::RIGHT_SHIFT: depth -= 2; break;
+            case lexer::TokenType::LEFT_PAREN:
+            case lexer::TokenType::RIGHT_PAREN:
+            case lexer::TokenType::LEFT_BRACE:
+            case lexer::TokenType::SEMI_COLON:
+            case lexer::TokenType::EQUAL:
+            case lexer::TokenType::EOF_TOKEN:
+                return false;
+            default: break;
+            }
+            if (depth <= 0)
+                return depth == 0 && lookahead(i + 1).type == lexer::TokenType::LEFT_PAREN;
+        }
     }
 
     ast::ExprPtr Parser::channelSendExpr()
@@ -1793,7 +1985,7 @@ namespace parser
         consume(lexer::TokenType::CHANNEL_SEND, "Expected '<-' for channel send");
         auto value = expression();
         
-        return std::make_shared<ast::ChannelSendExpr>(previous(), channel, value);
+        return ast::make<ast::ChannelSendExpr>(previous(), channel, value);
     }
 
     ast::ExprPtr Parser::channelReceiveExpr()
@@ -1801,7 +1993,7 @@ namespace parser
         auto keyword = previous();
         auto channel = expression();
         
-        return std::make_shared<ast::ChannelReceiveExpr>(keyword, channel);
+        return ast::make<ast::ChannelReceiveExpr>(keyword, channel);
     }
 
 } // namespace parser
@@ -4,6 +4,7 @@
 #include "../ast/ast.h"
 #include "../lexer/lexer.h"
 #include "../error/error_handler.h"
+#include <deque>
 #include <memory>
 #include <vector>
 #include <algorithm>
@@ -21,9 +22,17 @@ namespace parser
     public:
         /**
          * @brief Constructs a parser.
-         * @param tokens The list of tokens to parse.
+         * @param tokens The list of tokens to parse. Not copied: it must
+         *        outlive parse().
          */
         explicit Parser(const std::vector<lexer::Token> &tokens);
+        explicit Parser(std::vector<lexer::Token> &&tokens) = delete;
+
+        /**
+         * @brief Constructs a parser that pulls its tokens from source
+         * (typically a Lexer) as it goes, holding only its lookahead.
+         */
+        explicit Parser(lexer::TokenSource &source);
 
         /**
          * @brief Parses the tokens into an AST.
@@ -31,6 +40,12 @@ namespace parser
          */
         ast::StmtPtr parse();
 
+        /**
+         * @brief Parse a precompiled module's interface (.toi), where a
+         * function may be a `def f(params) -> T;` prototype.
+         */
+        void setInterface(bool on) { interface_ = on; }
+
         /**
          * @brief Improved error recovery context
          */
@@ -58,12 +73,12 @@ namespace parser
 
     private:
         // Set when a `yield` is parsed inside the current function body; turns
-        // that function into a generator (desugared to collect-and-return-array).
+        // that function into a generator (a lazily resumed coroutine).
         bool sawYield = false;
-        // Desugar helpers for generator functions.
-        ast::StmtPtr desugarGenerator(const ast::StmtPtr &body, const lexer::Token &tok);
+        // Interface mode: see setInterface().
+        bool interface_ = false;
+        // Desugar helper for generator functions.
         void rewriteGeneratorReturns(const ast::StmtPtr &stmt, const lexer::Token &tok);
-        ast::ExprPtr makeVecToArrayCall(const lexer::Token &tok);
 
         ast::StmtPtr declaration();
         ast::StmtPtr varDeclaration();
@@ -77,7 +92,7 @@ namespace parser
         ast::StmtPtr expressionStmt();
         ast::StmtPtr ifStmt();
         ast::StmtPtr whileStmt();
-        ast::StmtPtr forStmt();
+        ast::StmtPtr forStmt(bool parallel = false);
         ast::StmtPtr blockStmt();
         ast::StmtPtr returnStmt();
         ast::StmtPtr importStmt();
@@ -86,6 +101,8 @@ namespace parser
         ast::StmtPtr selectStmt();
         ast::StmtPtr tryStmt();
         ast::StmtPtr throwStmt();
+        ast::StmtPtr withArenaStmt();
+        bool atWithArena() const;
         ast::ExprPtr expression();
         ast::ExprPtr assignment();
         ast::ExprPtr ternary();
@@ -107,6 +124,8 @@ namespace parser
         ast::ExprPtr deleteExpr();
         ast::ExprPtr channelSendExpr();
         ast::ExprPtr channelReceiveExpr();
+        ast::ExprPtr channelConstructor(const lexer::Token &tok); // after `channel` / `chan`
+        bool atChannelTypeArgsCall() const;
         ast::TypePtr parseType();
         std::vector<ast::Parameter> parseParameters();
         std::vector<ast::TypeParameter> parseTypeParameters();
@@ -118,12 +137,18 @@ namespace parser
         lexer::Token advance();
         lexer::Token peek() const;
         lexer::Token previous() const;
+        lexer::Token &lookahead(size_t k) const; // k tokens past peek()
         bool isAtEnd() const;
         lexer::Token consume(lexer::TokenType type, const std::string &message);
         void consumeGenericClose(const std::string &message); // close type args, splitting >>
         void error(const lexer::Token &token, const std::string &message);
 
-        std::vector<lexer::Token> tokens;
+        // Tokens are pulled from source on demand. window[current] is peek(),
+        // window[current - 1] previous(); advance() drops older ones, so the
+        // window only ever holds the lookahead in use.
+        std::unique_ptr<lexer::TokenVectorSource> ownedSource;
+        lexer::TokenSource *source;
+        mutable std::deque<lexer::Token> window;
         size_t current;
         error::ErrorHandler errorHandler;
         std::vector<ErrorContext> errors_;
@@ -0,0 +1,469 @@
+// The sampling allocation profiler and heap snapshots. See alloc_profiler.h
+// for what is sampled and how the totals are estimated.
+#include "alloc_profiler.h"
+#include "pprof_writer.h"
+#include "sampling_profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#if defined(__has_include)
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define TOCIN_HAVE_BACKTRACE 1
+#endif
+#endif
+
+#ifdef TOCIN_HAVE_GC
+// Heap walking (gc_mark.h). The enumerators are newer than the rest of the
+// collector API the runtime uses, so they are weak: an older libgc still
+// links, and its snapshots leave the census out.
+extern "C"
+{
+    void GC_gcollect(void);
+    void GC_alloc_lock(void);
+    void GC_alloc_unlock(void);
+    int GC_is_marked(const void *);
+    size_t GC_get_heap_size(void);
+    size_t GC_get_free_bytes(void);
+    size_t GC_get_total_bytes(void);
+    typedef void (*GC_reachable_object_proc)(void *, size_t, void *);
+#ifndef _WIN32
+    __attribute__((weak))
+#endif
+    void GC_enumerate_reachable_objects_inner(GC_reachable_object_proc, void *);
+#ifndef _WIN32
+    __attribute__((weak))
+#endif
+    int GC_get_kind_and_size(const void *, size_t *);
+}
+#endif
+
+namespace tocin {
+namespace runtime {
+
+std::atomic<bool> AllocationProfiler::active_{false};
+
+namespace {
+
+const char *const kKindNames[kAllocKinds] = {"other",  "string", "array",   "map",
+                                            "object", "adt",    "closure", "task"};
+
+struct Countdown {
+    uint64_t generation = ~uint64_t(0);
+    int64_t left = 0;
+    uint64_t rng = 0;
+};
+thread_local Countdown t_countdown;
+
+uint64_t nextRandom(uint64_t &state) {
+    // xorshift64*
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+}
+
+// Bytes until the next sample: exponential with mean `rate`, so samples
+// fall at random points of the byte stream rather than on a stride the
+// program's own allocation pattern could alias with.
+int64_t drawInterval(uint64_t &rng, size_t rate) {
+    if (rate <= 1) return 0;
+    double u = (double)((nextRandom(rng) >> 11) + 1) / 9007199254740992.0; // (0, 1]
+    return (int64_t)(-std::log(u) * (double)rate);
+}
+
+std::string humanBytes(double bytes) {
+    const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    int unit = 0;
+    while (bytes >= 1024 && unit < 4) {
+        bytes /= 1024;
+        ++unit;
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), unit ? "%.1f %s" : "%.0f %s", bytes, units[unit]);
+    return buf;
+}
+
+std::string frameName(uint64_t ret) {
+    // Return addresses: name the call instruction, not what follows it.
+    std::string name = SamplingProfiler::instance().symbolize(ret - 1);
+    std::replace(name.begin(), name.end(), ';', ':');
+    return name;
+}
+
+} // namespace
+
+const char *allocKindName(AllocKind kind) {
+    int k = (int)kind;
+    return k >= 0 && k < kAllocKinds ? kKindNames[k] : "other";
+}
+
+AllocationProfiler &AllocationProfiler::instance() {
+    static AllocationProfiler *profiler = new AllocationProfiler(); // used until exit
+    return *profiler;
+}
+
+bool AllocationProfiler::start(size_t rate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active()) return false;
+    rate_.store(rate ? rate : 1, std::memory_order_relaxed);
+    siteIndex_.clear();
+    sites_.clear();
+    live_.clear();
+    liveCount_.store(0, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_relaxed);
+    active_.store(true, std::memory_order_release);
+    return true;
+}
+
+void AllocationProfiler::stop() { active_.store(false, std::memory_order_release); }
+
+void AllocationProfiler::noteAlloc(void *p, size_t size, AllocKind kind, void *site) {
+    if (!p) return;
+    Countdown &c = t_countdown;
+    uint64_t generation = generation_.load(std::memory_order_relaxed);
+    if (c.generation != generation) {
+        if (!c.rng)
+            c.rng = (uint64_t)(uintptr_t)&c ^
+                    (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count() ^
+                    0x9E3779B97F4A7C15ull;
+        c.generation = generation;
+        c.left = drawInterval(c.rng, rate_.load(std::memory_order_relaxed));
+    }
+    c.left -= (int64_t)size;
+    if (c.left > 0) return;
+    const size_t rate = rate_.load(std::memory_order_relaxed);
+    c.left = drawInterval(c.rng, rate);
+
+    // The stack from the allocator's caller up. backtrace() also returns
+    // the frames inside the runtime; drop everything before `site`.
+    std::vector<uint64_t> stack;
+    stack.reserve(kMaxDepth);
+#ifdef TOCIN_HAVE_BACKTRACE
+    void *frames[kMaxDepth + 8];
+    int n = ::backtrace(frames, (int)(kMaxDepth + 8));
+    int first = 0;
+    while (first < n && frames[first] != site) ++first;
+    if (first < n) {
+        for (int i = first; i < n && stack.size() < kMaxDepth; ++i)
+            stack.push_back((uint64_t)(uintptr_t)frames[i]);
+    }
+#endif
+    if (stack.empty()) stack.push_back((uint64_t)(uintptr_t)site);
+
+    const double weight =
+        rate <= 1 ? 1.0 : 1.0 / (1.0 - std::exp(-(double)size / (double)rate));
+    std::string key(1, (char)kind);
+    key.append(reinterpret_cast<const char *>(stack.data()), stack.size() * sizeof(uint64_t));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, inserted] = siteIndex_.emplace(std::move(key), (uint32_t)sites_.size());
+    if (inserted) {
+        sites_.emplace_back();
+        sites_.back().kind = kind;
+        sites_.back().stack = std::move(stack);
+    }
+    SiteData &s = sites_[it->second];
+    s.samples++;
+    s.allocBytes += (double)size * weight;
+    s.allocObjects += weight;
+    s.liveBytes += (double)size * weight;
+    s.liveObjects += weight;
+    // A block handed out again replaces what was sampled there before.
+    auto old = live_.find((uintptr_t)p);
+    if (old != live_.end()) forget(old);
+    live_[(uintptr_t)p] = {it->second, (uint32_t)std::min<size_t>(size, UINT32_MAX), weight};
+    liveCount_.store(live_.size(), std::memory_order_relaxed);
+}
+
+void AllocationProfiler::forget(std::unordered_map<uintptr_t, Live>::iterator it) {
+    SiteData &s = sites_[it->second.site];
+    s.liveBytes -= (double)it->second.size * it->second.weight;
+    s.liveObjects -= it->second.weight;
+    live_.erase(it);
+}
+
+AllocKind AllocationProfiler::noteFree(void *p) {
+    if (!p || liveCount_.load(std::memory_order_relaxed) == 0) return AllocKind::Other;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = live_.find((uintptr_t)p);
+    if (it == live_.end()) return AllocKind::Other;
+    AllocKind kind = sites_[it->second.site].kind;
+    forget(it);
+    liveCount_.store(live_.size(), std::memory_order_relaxed);
+    return kind;
+}
+
+void AllocationProfiler::noteCollection() {
+#ifdef TOCIN_HAVE_GC
+    if (liveCount_.load(std::memory_order_relaxed) == 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = live_.begin(); it != live_.end();) {
+        auto next = std::next(it);
+        if (!GC_is_marked(reinterpret_cast<const void *>(it->first))) forget(it);
+        it = next;
+    }
+    liveCount_.store(live_.size(), std::memory_order_relaxed);
+#endif
+}
+
+std::vector<AllocationProfiler::Site> AllocationProfiler::sites() const {
+    std::vector<Site> out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out.reserve(sites_.size());
+        for (const SiteData &s : sites_)
+            out.push_back({s.kind, s.stack, s.samples, s.allocBytes, s.allocObjects,
+                           std::max(0.0, s.liveBytes), std::max(0.0, s.liveObjects)});
+    }
+    std::sort(out.begin(), out.end(),
+              [](const Site &a, const Site &b) { return a.allocBytes > b.allocBytes; });
+    return out;
+}
+
+size_t AllocationProfiler::sampleCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    for (const SiteData &s : sites_) n += s.samples;
+    return n;
+}
+
+std::string AllocationProfiler::report(size_t topPerKind) const {
+    std::vector<Site> all = sites();
+    struct Totals {
+        double bytes = 0, objects = 0, liveBytes = 0, liveObjects = 0;
+    } totals[kAllocKinds], sum;
+    size_t samples = 0;
+    for (const Site &s : all) {
+        Totals &t = totals[(int)s.kind];
+        t.bytes += s.allocBytes;
+        t.objects += s.allocObjects;
+        t.liveBytes += s.liveBytes;
+        t.liveObjects += s.liveObjects;
+        samples += s.samples;
+    }
+    for (const Totals &t : totals) {
+        sum.bytes += t.bytes;
+        sum.objects += t.objects;
+        sum.liveBytes += t.liveBytes;
+        sum.liveObjects += t.liveObjects;
+    }
+
+    std::string out;
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "allocation profile: 1 sample per %zu bytes, %zu samples (figures estimated)\n\n",
+                  rate(), samples);
+    out += line;
+    std::snprintf(line, sizeof(line), "%-8s %12s %12s %12s %12s\n", "kind", "allocated", "objects",
+                  "in use", "objects");
+    out += line;
+    auto row = [&](const char *name, const Totals &t) {
+        std::snprintf(line, sizeof(line), "%-8s %12s %12.0f %12s %12.0f\n", name,
+                      humanBytes(t.bytes).c_str(), t.objects, humanBytes(t.liveBytes).c_str(),
+                      t.liveObjects);
+        out += line;
+    };
+    for (int k = 0; k < kAllocKinds; ++k)
+        if (totals[k].objects > 0) row(kKindNames[k], totals[k]);
+    row("total", sum);
+
+    for (int k = 0; k < kAllocKinds; ++k) {
+        if (totals[k].objects <= 0) continue;
+        std::snprintf(line, sizeof(line), "\n%s: top call sites by bytes allocated\n", kKindNames[k]);
+        out += line;
+        size_t shown = 0;
+        for (const Site &s : all) {
+            if ((int)s.kind != k) continue;
+            if (shown++ == topPerKind) break;
+            std::snprintf(line, sizeof(line), "  %s (%.1f%%), %.0f objects, %s in use\n",
+                          humanBytes(s.allocBytes).c_str(),
+                          sum.bytes > 0 ? 100.0 * s.allocBytes / sum.bytes : 0.0, s.allocObjects,
+                          humanBytes(s.liveBytes).c_str());
+            out += line;
+            for (size_t d = 0; d < s.stack.size() && d < 8; ++d) {
+                out += "      ";
+                out += frameName(s.stack[d]);
+                out += '\n';
+            }
+        }
+    }
+    return out;
+}
+
+std::string AllocationProfiler::folded() const {
+    std::map<std::string, double> stacks;
+    std::unordered_map<uint64_t, std::string> names;
+    for (const Site &s : sites()) {
+        std::string key = allocKindName(s.kind);
+        for (size_t d = s.stack.size(); d-- > 0;) {
+            auto it = names.find(s.stack[d]);
+            if (it == names.end()) it = names.emplace(s.stack[d], frameName(s.stack[d])).first;
+            key += ';';
+            key += it->second;
+        }
+        stacks[key] += s.allocBytes;
+    }
+    std::string out;
+    for (const auto &[stack, bytes] : stacks) {
+        out += stack;
+        out += ' ';
+        out += std::to_string((uint64_t)std::llround(bytes));
+        out += '\n';
+    }
+    return out;
+}
+
+std::string AllocationProfiler::pprof() const {
+    // pprof maps a location's address back to the call itself; hand it the
+    // call instruction, as for frames of a CPU profile.
+    PprofBuilder builder([](uint64_t pc) { return SamplingProfiler::instance().symbolize(pc); });
+    builder.addSampleType("alloc_objects", "count");
+    builder.addSampleType("alloc_space", "bytes");
+    builder.addSampleType("inuse_objects", "count");
+    builder.addSampleType("inuse_space", "bytes");
+    for (const Site &s : sites()) {
+        std::vector<uint64_t> pcs;
+        pcs.reserve(s.stack.size());
+        for (uint64_t ret : s.stack) pcs.push_back(ret - 1);
+        builder.addSample(pcs,
+                          {std::llround(s.allocObjects), std::llround(s.allocBytes),
+                           std::llround(s.liveObjects), std::llround(s.liveBytes)},
+                          {{"kind", allocKindName(s.kind)}});
+    }
+    builder.setPeriod("space", "bytes", (int64_t)rate());
+    builder.setDefaultSampleType("alloc_space");
+    return builder.finish();
+}
+
+bool AllocationProfiler::write(const std::string &path) const {
+    std::string data;
+    if (isPprofPath(path)) {
+        if (!gzipProfile(pprof(), data)) {
+            errno = ENOMEM;
+            return false;
+        }
+    } else if (path.size() >= 7 && path.compare(path.size() - 7, 7, ".folded") == 0) {
+        data = folded();
+    } else {
+        data = report();
+    }
+    return writeProfileFile(path, data);
+}
+
+namespace {
+
+#ifdef TOCIN_HAVE_GC
+// What the heap walk counts. Filled under the allocation lock, so it must
+// not allocate: fixed arrays only.
+struct HeapCensus {
+    static constexpr int kKinds = 4;   // GC_I_PTRFREE, GC_I_NORMAL, uncollectable, other
+    static constexpr int kBuckets = 18; // <= 16 B, <= 32 B, ..., > 1 MiB
+    uint64_t objects = 0, bytes = 0;
+    uint64_t kindObjects[kKinds] = {}, kindBytes[kKinds] = {};
+    uint64_t sizeObjects[kBuckets] = {}, sizeBytes[kBuckets] = {};
+};
+
+void countObject(void *obj, size_t bytes, void *data) {
+    auto *census = static_cast<HeapCensus *>(data);
+    census->objects++;
+    census->bytes += bytes;
+    int kind = GC_get_kind_and_size ? GC_get_kind_and_size(obj, nullptr) : 3;
+    if (kind < 0 || kind >= HeapCensus::kKinds) kind = HeapCensus::kKinds - 1;
+    census->kindObjects[kind]++;
+    census->kindBytes[kind] += bytes;
+    int bucket = 0;
+    while (bucket < HeapCensus::kBuckets - 1 && bytes > (size_t(16) << bucket)) ++bucket;
+    census->sizeObjects[bucket]++;
+    census->sizeBytes[bucket] += bytes;
+}
+#endif
+
+} // namespace
+
+std::string AllocationProfiler::heapSnapshot() {
+    std::string out = "tocin heap snapshot\n";
+    char line[256];
+#ifdef TOCIN_HAVE_GC
+    // Marks everything reachable (and, through noteCollection, drops the
+    // sampled objects that are not) ...
+    GC_gcollect();
+    std::snprintf(line, sizeof(line), "heap: %s, %s free, %s allocated since start\n",
+                  humanBytes((double)GC_get_heap_size()).c_str(),
+                  humanBytes((double)GC_get_free_bytes()).c_str(),
+                  humanBytes((double)GC_get_total_bytes()).c_str());
+    out += line;
+    // ... and the walk visits the objects that collection marked.
+    if (GC_enumerate_reachable_objects_inner) {
+        HeapCensus census;
+        GC_alloc_lock();
+        GC_enumerate_reachable_objects_inner(countObject, &census);
+        GC_alloc_unlock();
+        std::snprintf(line, sizeof(line), "reachable: %llu objects, %s\n",
+                      (unsigned long long)census.objects, humanBytes((double)census.bytes).c_str());
+        out += line;
+        const char *kinds[HeapCensus::kKinds] = {"pointer-free", "scanned", "uncollectable", "other"};
+        for (int k = 0; k < HeapCensus::kKinds; ++k) {
+            if (!census.kindObjects[k]) continue;
+            std::snprintf(line, sizeof(line), "  %-14s %12llu objects %12s\n", kinds[k],
+                          (unsigned long long)census.kindObjects[k],
+                          humanBytes((double)census.kindBytes[k]).c_str());
+            out += line;
+        }
+        out += "by size:\n";
+        for (int b = 0; b < HeapCensus::kBuckets; ++b) {
+            if (!census.sizeObjects[b]) continue;
+            std::string bound = b == HeapCensus::kBuckets - 1
+                                    ? "> " + humanBytes((double)(size_t(16) << (b - 1)))
+                                    : "<= " + humanBytes((double)(size_t(16) << b));
+            std::snprintf(line, sizeof(line), "  %-14s %12llu objects %12s\n", bound.c_str(),
+                          (unsigned long long)census.sizeObjects[b],
+                          humanBytes((double)census.sizeBytes[b]).c_str());
+            out += line;
+        }
+    } else {
+        out += "reachable: this libgc cannot enumerate its heap (needs GC_enumerate_reachable_objects_inner)\n";
+    }
+#else
+    out += "heap: built without the collector; only sampled allocations are known\n";
+#endif
+
+    std::vector<Site> live = sites();
+    live.erase(std::remove_if(live.begin(), live.end(), [](const Site &s) { return s.liveObjects <= 0; }),
+               live.end());
+    std::sort(live.begin(), live.end(),
+              [](const Site &a, const Site &b) { return a.liveBytes > b.liveBytes; });
+    if (live.empty()) {
+        out += active() || sampleCount() > 0
+                   ? "\nno sampled allocation is live\n"
+                   : "\nno allocation profile (TOCIN_ALLOC_PROFILE) to attribute live memory to\n";
+        return out;
+    }
+    std::snprintf(line, sizeof(line), "\nlive memory by call site (estimated, 1 sample per %zu bytes):\n",
+                  rate());
+    out += line;
+    for (const Site &s : live) {
+        std::snprintf(line, sizeof(line), "  %s in %.0f %s objects\n", humanBytes(s.liveBytes).c_str(),
+                      s.liveObjects, allocKindName(s.kind));
+        out += line;
+        for (size_t d = 0; d < s.stack.size() && d < 8; ++d) {
+            out += "      ";
+            out += frameName(s.stack[d]);
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+bool AllocationProfiler::writeHeapSnapshot(const std::string &path) {
+    return writeProfileFile(path, heapSnapshot());
+}
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,148 @@
+#ifndef TOCIN_ALLOC_PROFILER_H
+#define TOCIN_ALLOC_PROFILER_H
+
+/**
+ * A sampling allocation profiler and heap snapshots for Tocin's heap.
+ *
+ * Every heap allocation goes through __tocin_alloc, __tocin_alloc_atomic
+ * or __tocin_realloc (and their _tagged forms), so those are the one hook
+ * point. While the profiler runs, each thread counts the bytes it
+ * allocates against a randomized countdown averaging rate() bytes and
+ * samples the allocation that runs it out: one in rate() bytes, so the cost
+ * is independent of the allocation count. A sample records the call stack
+ * (backtrace(), through JIT'd code via its unwind tables) and the kind of
+ * object, which the code generator passes as an AllocKind tag. Sampled
+ * objects stay counted as live until they are freed or, under the
+ * collector, found unreachable at the end of a collection.
+ *
+ * Totals are estimates scaled up from the samples, as in Go's heap
+ * profiles: an allocation of n bytes is sampled with probability
+ * 1 - exp(-n / rate), and each sample counts for its inverse.
+ *
+ * write() emits a per-kind report with the top call sites, folded stacks
+ * (*.folded) or gzipped pprof (*.pb.gz) with alloc and in-use values.
+ * writeHeapSnapshot() collects and walks the Boehm heap: reachable objects
+ * by collector kind and size, plus the live sampled call sites.
+ *
+ * TOCIN_ALLOC_PROFILE=<file> profiles a program from load to exit at
+ * TOCIN_ALLOC_PROFILE_RATE bytes (default 512 KiB), and TOCIN_HEAP_SNAPSHOT
+ * =<file> takes a snapshot at exit; allocProfile(path) and
+ * heapSnapshot(path) write either on demand.
+ *
+ * Allocations inside withArena are released with their arena and are not
+ * sampled.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+// What a heap block is for, as tagged by the code generator
+// (__tocin_alloc_tagged). The values are part of the compiled ABI.
+enum class AllocKind : int32_t {
+    Other = 0, // untagged: runtime buffers, raw alloc()
+    String,    // string bytes
+    Array,     // arrays, slices, variadic packs
+    Map,       // map literals
+    Object,    // class instances and trait objects
+    Adt,       // enum values, Option/Result, tuples, boxed returns
+    Closure,   // closure environments
+    Task,      // argument packs of go and async calls
+};
+constexpr int kAllocKinds = 8;
+
+const char *allocKindName(AllocKind kind);
+
+class AllocationProfiler {
+public:
+    static constexpr size_t kDefaultRate = 512 * 1024;
+    static constexpr size_t kMaxDepth = 32;
+
+    static AllocationProfiler &instance();
+
+    // Checked by the allocator on every allocation.
+    static bool active() { return active_.load(std::memory_order_relaxed); }
+
+    // Start sampling one in `rate` bytes (1 samples every allocation);
+    // false if already running. Earlier samples are discarded.
+    bool start(size_t rate = kDefaultRate);
+    // Stop sampling. Samples, and the liveness of sampled objects, are kept.
+    void stop();
+    size_t rate() const { return rate_.load(std::memory_order_relaxed); }
+
+    // The allocator's hooks. `site` is the allocator's return address, the
+    // frame the recorded stack starts at.
+    void noteAlloc(void *p, size_t size, AllocKind kind, void *site);
+    // p is freed or moved by realloc: the kind it was sampled as, or Other.
+    AllocKind noteFree(void *p);
+    // At the end of a collection, under the allocation lock: forget sampled
+    // objects the collector did not mark.
+    void noteCollection();
+
+    struct Site {
+        AllocKind kind;
+        std::vector<uint64_t> stack; // return addresses, leaf first
+        uint64_t samples;
+        double allocBytes, allocObjects; // estimated, since start()
+        double liveBytes, liveObjects;
+    };
+    // Sampled call sites, most bytes allocated first.
+    std::vector<Site> sites() const;
+    size_t sampleCount() const;
+
+    // Per-kind totals and the top call sites of each kind.
+    std::string report(size_t topPerKind = 5) const;
+    // "kind;root;...;leaf bytes", estimated bytes allocated.
+    std::string folded() const;
+    // An uncompressed pprof Profile (alloc_objects, alloc_space,
+    // inuse_objects, inuse_space; label "kind").
+    std::string pprof() const;
+    // pprof for *.pb.gz / *.pprof, folded for *.folded, else the report;
+    // false and errno set if it cannot be written.
+    bool write(const std::string &path) const;
+
+    // Collect, then walk the collector's heap. Without the collector only
+    // the sampled live call sites are known.
+    std::string heapSnapshot();
+    bool writeHeapSnapshot(const std::string &path);
+
+private:
+    AllocationProfiler() = default;
+
+    struct SiteData {
+        AllocKind kind;
+        std::vector<uint64_t> stack;
+        uint64_t samples = 0;
+        double allocBytes = 0, allocObjects = 0;
+        double liveBytes = 0, liveObjects = 0;
+    };
+    struct Live {
+        uint32_t site;
+        uint32_t size;
+        double weight; // objects this sample stands for
+    };
+
+    void forget(std::unordered_map<uintptr_t, Live>::iterator it);
+
+    static std::atomic<bool> active_;
+    std::atomic<size_t> rate_{kDefaultRate};
+    std::atomic<uint64_t> generation_{0}; // bumped by start(): resets thread countdowns
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, uint32_t> siteIndex_; // kind + stack bytes -> sites_
+    std::vector<SiteData> sites_;
+    std::unordered_map<uintptr_t, Live> live_;
+    std::atomic<size_t> liveCount_{0}; // live_.size(), read without the lock
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_ALLOC_PROFILER_H
@@ -3,6 +3,7 @@
 #include "../ast/ast.h"
 #include "../error/error_handler.h"
 #include "concurrency.h"
+#include "executor.h"
 #include <memory>
 #include <functional>
 #include <future>
@@ -11,6 +12,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <unordered_map>
+#include <unordered_set>
 #include <chrono>
 #include <tuple>
 #include <type_traits>
@@ -46,21 +48,31 @@ struct TaskResult {
 
 /**
  * @brief Async task scheduler
+ *
+ * Has no threads of its own: tasks run as goroutines on the runtime's shared
+ * executor (executor.h) and delayed tasks wait in its timer heap, so async
+ * work, goroutines and parallel loops share one set of workers. The scheduler
+ * only keeps count of what it submitted. Delayed tasks still waiting when it
+ * stops are dropped.
  */
 class AsyncScheduler {
 private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
-    std::mutex queueMutex;
-    std::condition_variable condition;
-    bool stop;
-    size_t maxWorkers;
+    // Shared with tasks and timers in flight, which may outlive the scheduler.
+    struct State {
+        std::mutex mutex;
+        std::condition_variable idle;
+        size_t queued = 0;   // submitted, not yet started
+        size_t running = 0;
+        bool stop = false;
+        std::unordered_set<uint64_t> timers;  // delayed, not yet due
+    };
+    std::shared_ptr<State> state;
     
 public:
-    AsyncScheduler(size_t workerCount = std::thread::hardware_concurrency())
-        : stop(false), maxWorkers(workerCount) {
-        startWorkers();
-    }
+    // The worker count is the executor's (executorThreads()); the argument
+    // is kept for source compatibility.
+    AsyncScheduler(size_t /*workerCount*/ = 0)
+        : state(std::make_shared<State>()) {}
     
     ~AsyncScheduler() {
         stopWorkers();
@@ -93,11 +105,7 @@ public:
             }
         };
         
-        {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            tasks.push(std::move(task));
-        }
-        condition.notify_one();
+        enqueue(state, std::move(task));
         
         return *future;
     }
@@ -129,14 +137,25 @@ public:
             }
         };
         
-        std::thread([this, task = std::move(task), delay]() mutable {
-            std::this_thread::sleep_for(delay);
-            {
-                std::lock_guard<std::mutex> lock(queueMutex);
-                tasks.push(std::move(task));
+        auto st = state;
+        auto id = std::make_shared<uint64_t>(0);
+        {
+            // Held across executorAfter so the timer cannot find its id unset.
+            std::lock_guard<std::mutex> lock(st->mutex);
+            if (st->stop) {
+                return *future;
             }
-            condition.notify_one();
-        }).detach();
+            *id = tocin::runtime::executorAfter(delay, [st, id, task = std::function<void()>(std::move(task))]() mutable {
+                {
+                    std::lock_guard<std::mutex> lock(st->mutex);
+                    if (st->timers.erase(*id) == 0) {
+                        return;
+                    }
+                }
+                enqueue(st, std::move(task));
+            });
+            st->timers.insert(*id);
+        }
         
         return *future;
     }
@@ -145,54 +164,52 @@ public:
      * @brief Wait for all tasks to complete
      */
     void waitForAll() {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        condition.wait(lock, [this] { return tasks.empty(); });
+        tocin::runtime::ExecutorBlockingScope blocking;
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->idle.wait(lock, [this] { return state->queued == 0 && state->running == 0; });
     }
     
     /**
      * @brief Get number of pending tasks
      */
     size_t getPendingTaskCount() {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        return tasks.size();
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->queued;
     }
     
 private:
-    void startWorkers() {
-        for (size_t i = 0; i < maxWorkers; ++i) {
-            workers.emplace_back([this] {
-                while (true) {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(queueMutex);
-                        condition.wait(lock, [this] { return stop || !tasks.empty(); });
-                        if (stop && tasks.empty()) {
-                            return;
-                        }
-                        if (!tasks.empty()) {
-                            task = std::move(tasks.front());
-                            tasks.pop();
-                        }
-                    }
-                    if (task) {
-                        task();
-                    }
-                }
-            });
+    // Run task as a goroutine on the executor, counted in st.
+    static void enqueue(const std::shared_ptr<State>& st, std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(st->mutex);
+            ++st->queued;
         }
+        tocin::runtime::executorSubmit([st, task = std::move(task)]() {
+            {
+                std::lock_guard<std::mutex> lock(st->mutex);
+                --st->queued;
+                ++st->running;
+            }
+            task();
+            std::lock_guard<std::mutex> lock(st->mutex);
+            if (--st->running == 0 && st->queued == 0) {
+                st->idle.notify_all();
+            }
+        });
     }
     
+    // Drop delayed tasks not yet due and wait for the rest to finish.
     void stopWorkers() {
+        std::unordered_set<uint64_t> pending;
         {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            stop = true;
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->stop = true;
+            pending.swap(state->timers);
         }
-        condition.notify_all();
-        for (auto& worker : workers) {
-            if (worker.joinable()) {
-                worker.join();
-            }
+        for (uint64_t id : pending) {
+            tocin::runtime::executorCancelTimer(id);
         }
+        waitForAll();
     }
 };
 
@@ -281,7 +298,7 @@ public:
     /**
      * @brief Initialize the global async system
      */
-    static void initialize(size_t workerCount = std::thread::hardware_concurrency()) {
+    static void initialize(size_t workerCount = 0) {
         std::lock_guard<std::mutex> lock(schedulerMutex);
         if (!globalScheduler) {
             globalScheduler = std::make_shared<AsyncScheduler>(workerCount);
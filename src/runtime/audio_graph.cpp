@@ -0,0 +1,345 @@
+// Audio graph: the portable and SSE2 kernel tables, the dispatch that picks
+// among them and the AVX2 table, the graph itself, and the entry points of
+// the audioGraph* / audioRing* builtins.
+#include "audio_graph_impl.h"
+#include "kernel_support.h"
+#include "spsc_ring.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TOCIN_AUDIO_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+struct Scalar {
+    using Vec = double;
+    using Mask = bool;
+    static constexpr size_t kWidth = 1;
+
+    static Vec splat(double x) { return x; }
+    static Vec load(const double *p) { return *p; }
+    static void store(double *p, Vec v) { *p = v; }
+    static Vec add(Vec a, Vec b) { return a + b; }
+    static Vec sub(Vec a, Vec b) { return a - b; }
+    static Vec mul(Vec a, Vec b) { return a * b; }
+    static Vec min(Vec a, Vec b) { return b < a ? b : a; }
+    static Vec max(Vec a, Vec b) { return b > a ? b : a; }
+    static Mask lt(Vec a, Vec b) { return a < b; }
+    static Mask ge(Vec a, Vec b) { return a >= b; }
+    static Vec select(Mask m, Vec a, Vec b) { return m ? a : b; }
+};
+
+constexpr AudioKernels kScalarKernels = audioTable<Scalar>("scalar");
+
+#ifdef TOCIN_AUDIO_SSE2
+struct Sse2 {
+    using Vec = __m128d;
+    using Mask = __m128d;
+    static constexpr size_t kWidth = 2;
+
+    static Vec splat(double x) { return _mm_set1_pd(x); }
+    static Vec load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, Vec v) { _mm_storeu_pd(p, v); }
+    static Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+    static Vec min(Vec a, Vec b) { return _mm_min_pd(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm_max_pd(a, b); }
+    static Mask lt(Vec a, Vec b) { return _mm_cmplt_pd(a, b); }
+    static Mask ge(Vec a, Vec b) { return _mm_cmpge_pd(a, b); }
+    static Vec select(Mask m, Vec a, Vec b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+};
+
+constexpr AudioKernels kSse2Kernels = audioTable<Sse2>("sse2");
+#endif
+
+bool cpuHasAvx2() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+const AudioKernels *chooseKernels() {
+    auto available = availableAudioKernels();
+    if (const char *forced = std::getenv("TOCIN_AUDIO_KERNELS")) {
+        for (const auto *table : available)
+            if (std::strcmp(table->name, forced) == 0) return table;
+    }
+    return available.back();
+}
+
+} // namespace
+
+std::vector<const AudioKernels *> availableAudioKernels() {
+    std::vector<const AudioKernels *> tables{&kScalarKernels};
+#ifdef TOCIN_AUDIO_SSE2
+    tables.push_back(&kSse2Kernels);
+#endif
+    if (const AudioKernels *avx2 = avx2AudioKernels())
+        if (cpuHasAvx2()) tables.push_back(avx2);
+    return tables;
+}
+
+const AudioKernels &audioKernels() {
+    static const AudioKernels *chosen = chooseKernels();
+    return *chosen;
+}
+
+AudioGraph::AudioGraph(size_t blockSize, double sampleRate)
+    : blockSize_(blockSize ? blockSize : 1), sampleRate_(sampleRate > 0 ? sampleRate : 44100.0) {}
+
+int64_t AudioGraph::addOscillator(Kind kind, double freq, double amp) {
+    if (kind != Kind::Sine && kind != Kind::Square && kind != Kind::Saw) return -1;
+    Node n;
+    n.kind = kind;
+    n.inc = freq / sampleRate_;
+    n.amp = amp;
+    n.out.assign(blockSize_, 0.0);
+    nodes_.push_back(std::move(n));
+    return static_cast<int64_t>(nodes_.size()) - 1;
+}
+
+int64_t AudioGraph::addMix() {
+    Node n;
+    n.kind = Kind::Mix;
+    n.out.assign(blockSize_, 0.0);
+    nodes_.push_back(std::move(n));
+    return static_cast<int64_t>(nodes_.size()) - 1;
+}
+
+int64_t AudioGraph::addLowpass(int64_t input, double a) {
+    if (!valid(input)) return -1;
+    Node n;
+    n.kind = Kind::Lowpass;
+    n.input = input;
+    n.a = std::clamp(a, 0.0, 1.0);
+    n.out.assign(blockSize_, 0.0);
+    nodes_.push_back(std::move(n));
+    return static_cast<int64_t>(nodes_.size()) - 1;
+}
+
+bool AudioGraph::connect(int64_t mix, int64_t input, double level) {
+    if (!valid(mix) || nodes_[mix].kind != Kind::Mix || input < 0 || input >= mix) return false;
+    Node &m = nodes_[mix];
+    for (size_t k = 0; k < m.inputs.size(); ++k)
+        if (m.inputs[k] == input) {
+            m.levels[k] = level;
+            return true;
+        }
+    m.inputs.push_back(input);
+    m.levels.push_back(level);
+    // Buffers never move once allocated (moving a node keeps its vector's
+    // storage), so the mixer can keep plain pointers to its inputs.
+    m.sources.push_back(nodes_[input].out.data());
+    return true;
+}
+
+bool AudioGraph::setGain(int64_t node, double gain) {
+    if (!valid(node)) return false;
+    nodes_[node].stage.gain = gain;
+    return true;
+}
+
+bool AudioGraph::setClip(int64_t node, double limit) {
+    if (!valid(node)) return false;
+    nodes_[node].stage.limit = limit > 0 ? limit : std::numeric_limits<double>::infinity();
+    return true;
+}
+
+bool AudioGraph::setFrequency(int64_t node, double freq) {
+    if (!valid(node)) return false;
+    Kind k = nodes_[node].kind;
+    if (k != Kind::Sine && k != Kind::Square && k != Kind::Saw) return false;
+    nodes_[node].inc = freq / sampleRate_;
+    return true;
+}
+
+void AudioGraph::render(const AudioKernels &k, Node &n, double *out) {
+    size_t len = blockSize_;
+    switch (n.kind) {
+    case Kind::Sine:
+    case Kind::Square:
+    case Kind::Saw:
+        if (n.kind == Kind::Sine)
+            k.sine(out, len, n.phase, n.inc, n.amp, n.stage);
+        else
+            k.ramp(out, len, n.phase, n.inc, n.amp, n.kind == Kind::Square, n.stage);
+        n.phase = audioFrac(n.phase + static_cast<double>(len) * n.inc);
+        break;
+    case Kind::Mix:
+        k.mix(out, n.sources.data(), n.levels.data(), n.sources.size(), len, n.stage);
+        break;
+    case Kind::Lowpass: {
+        // y += a * (x - y) depends on the previous sample, so this one stays
+        // scalar; the stage still rides in the same loop.
+        const double *in = nodes_[n.input].out.data();
+        double y = n.state, lim = n.stage.limit;
+        for (size_t i = 0; i < len; ++i) {
+            y += n.a * (in[i] - y);
+            double v = y * n.stage.gain;
+            out[i] = v < -lim ? -lim : v > lim ? lim : v;
+        }
+        n.state = y;
+        break;
+    }
+    }
+}
+
+void AudioGraph::process(const AudioKernels &k) {
+    for (Node &n : nodes_) render(k, n, n.out.data());
+}
+
+const double *AudioGraph::output() const { return nodes_.empty() ? nullptr : nodes_.back().out.data(); }
+
+void AudioGraph::processInto(const AudioKernels &k, double *out) {
+    if (nodes_.empty()) {
+        std::fill_n(out, blockSize_, 0.0);
+        return;
+    }
+    for (size_t i = 0; i + 1 < nodes_.size(); ++i) render(k, nodes_[i], nodes_[i].out.data());
+    // No node reads the last one, so it renders straight into the caller's
+    // block.
+    render(k, nodes_.back(), out);
+}
+
+} // namespace runtime
+} // namespace tocin
+
+namespace {
+
+using tocin::runtime::AudioGraph;
+using AudioRing = tocin::runtime::SpscBlockRing<double>;
+
+AudioGraph *graphOf(int64_t g) { return reinterpret_cast<AudioGraph *>(g); }
+AudioRing *ringOf(int64_t r) { return reinterpret_cast<AudioRing *>(r); }
+
+double *samplesOf(int64_t *arr) { return reinterpret_cast<double *>(arr + 1); }
+
+// Copy a block to a list<float>, zero-padding or truncating to its length.
+int64_t copyOut(const double *block, size_t blockLen, int64_t *out) {
+    size_t n = lengthOf(out), m = std::min(n, blockLen);
+    if (!n) return 0;
+    std::memcpy(samplesOf(out), block, m * sizeof(double));
+    std::fill(samplesOf(out) + m, samplesOf(out) + n, 0.0);
+    return static_cast<int64_t>(m);
+}
+
+} // namespace
+
+extern "C" {
+
+// audioGraphNew(blockSize, sampleRate): an empty graph rendering
+// blockSize-sample blocks; 0 for a bad size.
+int64_t __tocin_audio_graph_new(int64_t blockSize, double sampleRate) {
+    if (blockSize <= 0 || blockSize > (int64_t(1) << 24)) return 0;
+    return reinterpret_cast<int64_t>(new AudioGraph(static_cast<size_t>(blockSize), sampleRate));
+}
+
+int64_t __tocin_audio_graph_free(int64_t g) {
+    delete graphOf(g);
+    return 0;
+}
+
+// audioGraphOsc(g, kind, freq, amp): kind 0 sine, 1 square, 2 saw.
+int64_t __tocin_audio_graph_osc(int64_t g, int64_t kind, double freq, double amp) {
+    static const AudioGraph::Kind kinds[] = {AudioGraph::Kind::Sine, AudioGraph::Kind::Square,
+                                             AudioGraph::Kind::Saw};
+    if (!g || kind < 0 || kind > 2) return -1;
+    return graphOf(g)->addOscillator(kinds[kind], freq, amp);
+}
+
+int64_t __tocin_audio_graph_mix(int64_t g) { return g ? graphOf(g)->addMix() : -1; }
+
+int64_t __tocin_audio_graph_lowpass(int64_t g, int64_t input, double a) {
+    return g ? graphOf(g)->addLowpass(input, a) : -1;
+}
+
+int64_t __tocin_audio_graph_connect(int64_t g, int64_t mix, int64_t input, double level) {
+    return g && graphOf(g)->connect(mix, input, level) ? 1 : 0;
+}
+
+// audioGraphGain / audioGraphClip / audioGraphSetFreq(g, node, value).
+int64_t __tocin_audio_graph_gain(int64_t g, int64_t node, double gain) {
+    return g && graphOf(g)->setGain(node, gain) ? 1 : 0;
+}
+
+int64_t __tocin_audio_graph_clip(int64_t g, int64_t node, double limit) {
+    return g && graphOf(g)->setClip(node, limit) ? 1 : 0;
+}
+
+int64_t __tocin_audio_graph_set_freq(int64_t g, int64_t node, double freq) {
+    return g && graphOf(g)->setFrequency(node, freq) ? 1 : 0;
+}
+
+// audioGraphProcess(g, out): render one block and copy the output node's
+// samples into out; returns how many were copied.
+int64_t __tocin_audio_graph_process(int64_t g, int64_t *out) {
+    if (!g) return 0;
+    AudioGraph *graph = graphOf(g);
+    graph->process(tocin::runtime::audioKernels());
+    if (!graph->output()) return 0;
+    return copyOut(graph->output(), graph->blockSize(), out);
+}
+
+// audioGraphProcessToRing(g, ring): render one block straight into the
+// ring's next free slot and publish it; 0 (nothing rendered) when the ring
+// is full or its blocks are a different size.
+int64_t __tocin_audio_graph_process_to_ring(int64_t g, int64_t r) {
+    if (!g || !r || ringOf(r)->blockLen() != graphOf(g)->blockSize()) return 0;
+    double *slot = ringOf(r)->writable();
+    if (!slot) return 0;
+    graphOf(g)->processInto(tocin::runtime::audioKernels(), slot);
+    ringOf(r)->publish();
+    return 1;
+}
+
+// audioRingNew(blocks, blockSize): an SPSC ring of `blocks` sample blocks.
+int64_t __tocin_audio_ring_new(int64_t blocks, int64_t blockSize) {
+    if (blocks <= 0 || blockSize <= 0 || blocks > (int64_t(1) << 20) || blockSize > (int64_t(1) << 24)) return 0;
+    return reinterpret_cast<int64_t>(new AudioRing(static_cast<size_t>(blocks), static_cast<size_t>(blockSize)));
+}
+
+int64_t __tocin_audio_ring_free(int64_t r) {
+    delete ringOf(r);
+    return 0;
+}
+
+// audioRingPush(ring, buf): copy buf (zero-padded or truncated to a block)
+// into the ring; 0 when full.
+int64_t __tocin_audio_ring_push(int64_t r, int64_t *buf) {
+    if (!r) return 0;
+    AudioRing *ring = ringOf(r);
+    double *slot = ring->writable();
+    if (!slot) return 0;
+    size_t m = std::min(lengthOf(buf), ring->blockLen());
+    if (m) std::memcpy(slot, samplesOf(buf), m * sizeof(double));
+    std::fill(slot + m, slot + ring->blockLen(), 0.0);
+    ring->publish();
+    return 1;
+}
+
+// audioRingPop(ring, out): move the oldest block into out; 0 when empty.
+int64_t __tocin_audio_ring_pop(int64_t r, int64_t *out) {
+    if (!r) return 0;
+    AudioRing *ring = ringOf(r);
+    const double *block = ring->readable();
+    if (!block) return 0;
+    copyOut(block, ring->blockLen(), out);
+    ring->release();
+    return 1;
+}
+
+int64_t __tocin_audio_ring_size(int64_t r) { return r ? static_cast<int64_t>(ringOf(r)->sizeApprox()) : 0; }
+
+} // extern "C"
@@ -0,0 +1,117 @@
+#ifndef TOCIN_AUDIO_GRAPH_H
+#define TOCIN_AUDIO_GRAPH_H
+
+/**
+ * Block-based DSP graph behind audio.graph's builtins (__tocin_audio_* in
+ * audio_graph.cpp).
+ *
+ * A graph renders fixed-size blocks of float64 samples. Every node owns one
+ * block buffer, allocated when the node is added, so process() never
+ * allocates or locks and may run on a real-time audio thread. Nodes are
+ * oscillators (sine, square, saw), mixers summing earlier nodes at a level
+ * each, and one-pole low-pass filters of an earlier node. Each node also
+ * carries an output stage, gain then clip to [-limit, limit], which its
+ * kernel applies before it stores a sample: a mix, its gain and its clip are
+ * one pass over the block.
+ *
+ * Oscillators never call sin per sample. The sine kernel rotates one phasor
+ * per vector lane by a fixed angle each step, seeded exactly at the start of
+ * every block; square and saw step a phase ramp. As with the other runtime
+ * kernels there is one table per instruction set and audioKernels() picks
+ * the best one the CPU supports: AVX2, then SSE2 on x86-64, otherwise
+ * portable code. TOCIN_AUDIO_KERNELS forces a table by name ("avx2",
+ * "sse2", "scalar").
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+// A node's output stage: min(max(x * gain, -limit), limit).
+struct AudioStage {
+    double gain;
+    double limit;
+};
+
+struct AudioKernels {
+    const char *name;
+    // out[i] = stage(amp * sin(2 pi (phase + i * inc))) for i < n.
+    void (*sine)(double *out, size_t n, double phase, double inc, double amp, AudioStage st);
+    // The ramp p = frac(phase + i * inc): amp * (2p - 1) for a saw, amp
+    // while p < 0.5 and -amp after for a square, then the stage.
+    void (*ramp)(double *out, size_t n, double phase, double inc, double amp, bool square, AudioStage st);
+    // out[i] = stage(sum_k ins[k][i] * levels[k]); silence when count is 0.
+    void (*mix)(double *out, const double *const *ins, const double *levels, size_t count, size_t n,
+                AudioStage st);
+};
+
+// The table the runtime uses.
+const AudioKernels &audioKernels();
+
+// Every table this CPU can run, portable one first.
+std::vector<const AudioKernels *> availableAudioKernels();
+
+// Defined in audio_graph_avx2.cpp, the only file built with AVX2 enabled;
+// nullptr when the compiler cannot target AVX2.
+const AudioKernels *avx2AudioKernels();
+
+class AudioGraph {
+public:
+    enum class Kind { Sine, Square, Saw, Mix, Lowpass };
+
+    AudioGraph(size_t blockSize, double sampleRate);
+
+    size_t blockSize() const { return blockSize_; }
+    size_t nodeCount() const { return nodes_.size(); }
+
+    // Building: each returns the new node's index. Inputs must be earlier
+    // nodes, so index order is an evaluation order; -1 on a bad input.
+    int64_t addOscillator(Kind kind, double freq, double amp);
+    int64_t addMix();
+    int64_t addLowpass(int64_t input, double a);
+    // Feed `input` into `mix` at `level`; an existing edge just takes the
+    // new level. False unless mix is a mixer and input < mix.
+    bool connect(int64_t mix, int64_t input, double level);
+
+    // Parameters; safe between process() calls on the thread running them.
+    bool setGain(int64_t node, double gain);
+    bool setClip(int64_t node, double limit);  // limit <= 0 removes the clip
+    bool setFrequency(int64_t node, double freq);
+
+    // Render one block of every node into its buffer. Allocation-free.
+    void process(const AudioKernels &k);
+    // The last node's block from the latest process(): the graph's output.
+    const double *output() const;
+    // process(), but the last node renders straight into out[0, blockSize)
+    // instead of its own buffer.
+    void processInto(const AudioKernels &k, double *out);
+
+private:
+    struct Node {
+        Kind kind;
+        AudioStage stage{1.0, std::numeric_limits<double>::infinity()};
+        double inc = 0, amp = 0, phase = 0;  // oscillators, phase in cycles
+        double a = 0, state = 0;             // low-pass
+        int64_t input = -1;
+        std::vector<int64_t> inputs;         // mixer
+        std::vector<double> levels;
+        std::vector<const double *> sources;
+        std::vector<double> out;
+    };
+
+    bool valid(int64_t node) const { return node >= 0 && static_cast<size_t>(node) < nodes_.size(); }
+    void render(const AudioKernels &k, Node &n, double *out);
+
+    size_t blockSize_;
+    double sampleRate_;
+    std::vector<Node> nodes_;
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_AUDIO_GRAPH_H
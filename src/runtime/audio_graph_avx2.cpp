@@ -0,0 +1,44 @@
+// The AVX2 audio kernels. This is the only audio file built with -mavx2
+// (see CMakeLists.txt); audioKernels() calls into it only after checking
+// the CPU.
+#include "audio_graph_impl.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#ifdef __AVX2__
+namespace {
+
+struct Avx2 {
+    using Vec = __m256d;
+    using Mask = __m256d;
+    static constexpr size_t kWidth = 4;
+
+    static Vec splat(double x) { return _mm256_set1_pd(x); }
+    static Vec load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, Vec v) { _mm256_storeu_pd(p, v); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    static Vec min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+    static Mask lt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Mask ge(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+    static Vec select(Mask m, Vec a, Vec b) { return _mm256_blendv_pd(b, a, m); }
+};
+
+constexpr AudioKernels kAvx2Kernels = audioTable<Avx2>("avx2");
+
+} // namespace
+
+const AudioKernels *avx2AudioKernels() { return &kAvx2Kernels; }
+#else
+const AudioKernels *avx2AudioKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,152 @@
+#ifndef TOCIN_AUDIO_GRAPH_IMPL_H
+#define TOCIN_AUDIO_GRAPH_IMPL_H
+
+// Block kernels shared by every instruction set, written against a small
+// vector interface over float64 lanes:
+//
+//   Vec Mask                 kWidth doubles / a lane mask of them
+//   splat(x) load(p)         all lanes x / unaligned kWidth lanes at p
+//   store(p, v)              unaligned
+//   add(a, b) sub(a, b) mul(a, b) min(a, b) max(a, b)   lane-wise
+//   lt(a, b) ge(a, b)        lane mask of a < b / a >= b
+//   select(m, a, b)          a where m is set, b elsewhere
+//
+// The portable table runs the same templates with one lane. Like the other
+// *_impl.h kernels this is only included by the kernel files and everything
+// has internal linkage, so code built for AVX2 never ends up shared with the
+// baseline file.
+
+#include "audio_graph.h"
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TOCIN_AUDIO_KERNEL __attribute__((always_inline)) inline
+#else
+#define TOCIN_AUDIO_KERNEL inline
+#endif
+
+namespace tocin {
+namespace runtime {
+namespace {
+
+template <class V> using AVec = typename V::Vec;
+
+constexpr double kAudioTau = 6.283185307179586;
+constexpr size_t kMaxAudioLanes = 8;
+// The oscillators re-seed their lanes this often, so rounding in the
+// recurrences never builds up past a few thousand steps.
+constexpr size_t kAudioSeedSpan = 4096;
+
+TOCIN_AUDIO_KERNEL double audioFrac(double x) { return x - std::floor(x); }
+
+template <class V> TOCIN_AUDIO_KERNEL AVec<V> applyLimit(AVec<V> x, AVec<V> lo, AVec<V> hi) {
+    return V::min(V::max(x, lo), hi);
+}
+
+// The last n < kWidth samples of a block go through a scratch vector.
+template <class V> TOCIN_AUDIO_KERNEL void storeTail(double *out, size_t n, AVec<V> v) {
+    double part[kMaxAudioLanes];
+    V::store(part, v);
+    for (size_t i = 0; i < n; ++i) out[i] = part[i];
+}
+
+// Lane k holds the phasor amp * (cos, sin) of sample k, and every step
+// rotates all lanes by kWidth samples' worth of angle: a complex multiply
+// per vector instead of a sin per sample. The stage's gain is folded into
+// the radius.
+template <class V> void sineChunk(double *out, size_t n, double phase, double inc, double amp, AudioStage st) {
+    constexpr size_t W = V::kWidth;
+    double c0[W], s0[W];
+    double r = amp * st.gain;
+    for (size_t k = 0; k < W; ++k) {
+        double angle = kAudioTau * audioFrac(phase + static_cast<double>(k) * inc);
+        c0[k] = r * std::cos(angle);
+        s0[k] = r * std::sin(angle);
+    }
+    double step = kAudioTau * audioFrac(static_cast<double>(W) * inc);
+    AVec<V> c = V::load(c0), s = V::load(s0);
+    AVec<V> rc = V::splat(std::cos(step)), rs = V::splat(std::sin(step));
+    AVec<V> lo = V::splat(-st.limit), hi = V::splat(st.limit);
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        V::store(out + i, applyLimit<V>(s, lo, hi));
+        AVec<V> nc = V::sub(V::mul(c, rc), V::mul(s, rs));
+        s = V::add(V::mul(s, rc), V::mul(c, rs));
+        c = nc;
+    }
+    if (i < n) storeTail<V>(out + i, n - i, applyLimit<V>(s, lo, hi));
+}
+
+// Lane k steps the ramp of sample k by kWidth samples at a time, wrapping
+// back into [0, 1) with one compare.
+template <class V>
+void rampChunk(double *out, size_t n, double phase, double inc, double amp, bool square, AudioStage st) {
+    constexpr size_t W = V::kWidth;
+    double p0[W];
+    for (size_t k = 0; k < W; ++k) p0[k] = audioFrac(phase + static_cast<double>(k) * inc);
+    double a = amp * st.gain;
+    AVec<V> p = V::load(p0), step = V::splat(audioFrac(static_cast<double>(W) * inc));
+    AVec<V> one = V::splat(1.0), half = V::splat(0.5), pos = V::splat(a), neg = V::splat(-a);
+    AVec<V> slope = V::splat(2.0 * a);
+    AVec<V> lo = V::splat(-st.limit), hi = V::splat(st.limit);
+    size_t i = 0;
+    for (;; i += W) {
+        AVec<V> x = square ? V::select(V::lt(p, half), pos, neg) : V::sub(V::mul(p, slope), pos);
+        x = applyLimit<V>(x, lo, hi);
+        if (i + W > n) {
+            if (i < n) storeTail<V>(out + i, n - i, x);
+            break;
+        }
+        V::store(out + i, x);
+        p = V::add(p, step);
+        p = V::select(V::ge(p, one), V::sub(p, one), p);
+    }
+}
+
+template <class V> void sineSpan(double *out, size_t n, double phase, double inc, double amp, AudioStage st) {
+    for (size_t i = 0; i < n; i += kAudioSeedSpan) {
+        size_t m = n - i < kAudioSeedSpan ? n - i : kAudioSeedSpan;
+        sineChunk<V>(out + i, m, phase + static_cast<double>(i) * inc, inc, amp, st);
+    }
+}
+
+template <class V>
+void rampSpan(double *out, size_t n, double phase, double inc, double amp, bool square, AudioStage st) {
+    for (size_t i = 0; i < n; i += kAudioSeedSpan) {
+        size_t m = n - i < kAudioSeedSpan ? n - i : kAudioSeedSpan;
+        rampChunk<V>(out + i, m, phase + static_cast<double>(i) * inc, inc, amp, square, st);
+    }
+}
+
+// One pass: each output vector sums its inputs, scales and clips in
+// registers before the single store.
+template <class V>
+void mixSpan(double *out, const double *const *ins, const double *levels, size_t count, size_t n,
+             AudioStage st) {
+    constexpr size_t W = V::kWidth;
+    AVec<V> g = V::splat(st.gain), lo = V::splat(-st.limit), hi = V::splat(st.limit);
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        AVec<V> acc = V::splat(0.0);
+        for (size_t k = 0; k < count; ++k) acc = V::add(acc, V::mul(V::load(ins[k] + i), V::splat(levels[k])));
+        V::store(out + i, applyLimit<V>(V::mul(acc, g), lo, hi));
+    }
+    for (; i < n; ++i) {
+        double acc = 0.0;
+        for (size_t k = 0; k < count; ++k) acc += ins[k][i] * levels[k];
+        acc *= st.gain;
+        out[i] = acc < -st.limit ? -st.limit : acc > st.limit ? st.limit : acc;
+    }
+}
+
+template <class V> constexpr AudioKernels audioTable(const char *name) {
+    return AudioKernels{name, &sineSpan<V>, &rampSpan<V>, &mixSpan<V>};
+}
+
+} // namespace
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_AUDIO_GRAPH_IMPL_H
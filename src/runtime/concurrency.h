@@ -1,6 +1,8 @@
 #ifndef TOCIN_CONCURRENCY_H
 #define TOCIN_CONCURRENCY_H
 
+#include <algorithm>
+#include <deque>
 #include <string>
 #include <future>
 #include <thread>
@@ -15,6 +17,9 @@
 #include <chrono>
 #include <optional>
 
+#include "executor.h"
+#include "mpmc_ring.h"
+
 namespace runtime {
 
 // Forward declarations
@@ -25,61 +30,111 @@ class Scheduler;
 
 /**
  * @brief Thread-safe channel implementation for Tocin
+ *
+ * A bounded channel (capacity > 0) keeps its values in a lock-free MPMC ring
+ * (mpmc_ring.h), so send and receive are one CAS each; the mutex is taken
+ * only when the waiter counts say someone is blocked. An unbounded channel
+ * (capacity 0) is a queue under the mutex. A blocked sender or receiver
+ * spins briefly, then parks on an ExecutorWaiter: a goroutine frees its
+ * worker, a plain thread waits on a condition variable. Values are moved
+ * through, so T may be move-only.
  */
 template<typename T>
 class Channel {
 private:
-    std::queue<T> buffer;
+    using Waiter = tocin::runtime::ExecutorWaiter;
+
+    std::unique_ptr<tocin::runtime::MpmcRing<T>> ring;  // bounded; null when unbounded
+    std::deque<T> buffer;                               // unbounded; guarded by mutex
     size_t capacity;
     mutable std::mutex mutex;
-    std::condition_variable not_full;
-    std::condition_variable not_empty;
+    // Blocked parties, guarded by mutex. Each value wakes one receiver and
+    // every selector; each freed slot wakes one sender.
+    std::deque<Waiter*> receivers;
+    std::deque<Waiter*> senders;
+    std::vector<Waiter*> selectors;
+    std::atomic<int> recvWaiting{0};  // receivers + selectors
+    std::atomic<int> sendWaiting{0};
     std::atomic<bool> closed{false};
 
 public:
-    explicit Channel(size_t cap = 0) : capacity(cap) {}
+    explicit Channel(size_t cap = 0) : capacity(cap) {
+        if (cap > 0) {
+            ring = std::make_unique<tocin::runtime::MpmcRing<T>>(cap);
+        }
+    }
 
     using value_type = T;
 
     /**
      * @brief Send a value to the channel
+     *
+     * Blocks while a bounded channel is full; false if the channel is closed.
      */
     bool send(const T& value) {
-        std::unique_lock<std::mutex> lock(mutex);
-        
-        if (closed.load()) {
-            return false;
-        }
-
-        // Wait if buffer is full (for bounded channels)
-        if (capacity > 0) {
-            not_full.wait(lock, [this] { return buffer.size() < capacity || closed.load(); });
-        }
-
-        if (closed.load()) {
-            return false;
-        }
+        return sendValue(value);
+    }
+    bool send(T&& value) {
+        return sendValue(std::move(value));
+    }
 
-        buffer.push(value);
-        not_empty.notify_one();
-        return true;
+    /**
+     * @brief Send without blocking; false if full or closed
+     */
+    bool trySend(const T& value) {
+        return offer(value);
+    }
+    bool trySend(T&& value) {
+        return offer(std::move(value));
     }
 
     /**
      * @brief Receive a value from the channel
+     *
+     * Blocks until a value arrives; nullopt once the channel is closed and
+     * drained.
      */
     std::optional<T> receive() {
-        std::unique_lock<std::mutex> lock(mutex);
-        
-        not_empty.wait(lock, [this] { return !buffer.empty() || closed.load(); });
-        
-        if (buffer.empty() && closed.load()) {
-            return std::nullopt;
+        for (;;) {
+            if (auto value = tryReceive()) {
+                return value;
+            }
+            if (closed.load(std::memory_order_acquire)) {
+                return tryReceive();
+            }
+            tocin::runtime::noteChannelWait(tocin::runtime::ChannelWait::Receive);
+            Waiter w;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                receivers.push_back(&w);
+                recvWaiting.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (readyLocked()) {
+                    w.fire();
+                }
+            }
+            w.wait();
+            unregister(receivers, &w, recvWaiting);
         }
+    }
 
-        T value = buffer.front();
-        buffer.pop();
-        not_full.notify_one();
+    /**
+     * @brief Receive without blocking; nullopt if no value is buffered
+     */
+    std::optional<T> tryReceive() {
+        if (ring) {
+            std::optional<T> value = ring->tryPop();
+            if (value) {
+                slotFreed();
+            }
+            return value;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (buffer.empty()) {
+            return std::nullopt;
+        }
+        std::optional<T> value(std::move(buffer.front()));
+        buffer.pop_front();
         return value;
     }
 
@@ -87,10 +142,11 @@ public:
      * @brief Close the channel
      */
     void close() {
-        std::unique_lock<std::mutex> lock(mutex);
-        closed.store(true);
-        not_empty.notify_all();
-        not_full.notify_all();
+        closed.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Waiter* w : receivers) w->fire();
+        for (Waiter* w : senders) w->fire();
+        for (Waiter* w : selectors) w->fire();
     }
 
     /**
@@ -104,9 +160,120 @@ public:
      * @brief Get current buffer size
      */
     size_t size() const {
+        if (ring) {
+            return ring->sizeApprox();
+        }
         std::lock_guard<std::mutex> lock(mutex);
         return buffer.size();
     }
+
+    /**
+     * @brief Register a Select's waiter, fired by every send and by close()
+     *
+     * Returns true if the channel already had a value or was closed, in
+     * which case the waiter may not be fired for it.
+     */
+    bool addSelector(Waiter* w) {
+        std::lock_guard<std::mutex> lock(mutex);
+        selectors.push_back(w);
+        recvWaiting.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return readyLocked();
+    }
+
+    void removeSelector(Waiter* w) {
+        std::lock_guard<std::mutex> lock(mutex);
+        selectors.erase(std::remove(selectors.begin(), selectors.end(), w), selectors.end());
+        recvWaiting.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+private:
+    template<typename U>
+    bool sendValue(U&& value) {
+        for (;;) {
+            if (offer(std::forward<U>(value))) {
+                return true;
+            }
+            if (closed.load(std::memory_order_acquire)) {
+                return false;
+            }
+            tocin::runtime::noteChannelWait(tocin::runtime::ChannelWait::Send);
+            Waiter w;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                senders.push_back(&w);
+                sendWaiting.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (ring->sizeApprox() < ring->capacity() || closed.load()) {
+                    w.fire();
+                }
+            }
+            w.wait();
+            unregister(senders, &w, sendWaiting);
+        }
+    }
+
+    // Leaves value untouched when it returns false.
+    template<typename U>
+    bool offer(U&& value) {
+        if (closed.load(std::memory_order_acquire)) {
+            return false;
+        }
+        if (!ring) {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffer.push_back(std::forward<U>(value));
+            wakeReceiversLocked();
+            return true;
+        }
+        if (!ring->push(std::forward<U>(value))) {
+            return false;
+        }
+        // Pairs with the fence a receiver makes after counting itself in.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (recvWaiting.load(std::memory_order_seq_cst) != 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            wakeReceiversLocked();
+        }
+        return true;
+    }
+
+    void slotFreed() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sendWaiting.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!senders.empty()) {
+            senders.front()->fire();
+            senders.pop_front();
+        }
+    }
+
+    void wakeReceiversLocked() {
+        if (!receivers.empty()) {
+            receivers.front()->fire();
+            receivers.pop_front();
+        }
+        for (Waiter* w : selectors) {
+            w->fire();
+        }
+    }
+
+    bool readyLocked() const {
+        bool has = ring ? ring->maybeNonEmpty() : !buffer.empty();
+        return has || closed.load();
+    }
+
+    // A woken waiter was already taken off its list; one that fired itself
+    // is still on it.
+    void unregister(std::deque<Waiter*>& list, Waiter* w, std::atomic<int>& count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find(list.begin(), list.end(), w);
+        if (it != list.end()) {
+            list.erase(it);
+        }
+        count.fetch_sub(1, std::memory_order_relaxed);
+    }
 };
 
 /**
@@ -227,6 +394,7 @@ public:
      */
     T get() {
         if (!has_cached) {
+            wait();
             cached_value = future->get();
             has_cached = true;
         }
@@ -242,9 +410,15 @@ public:
 
     /**
      * @brief Wait for the future to complete
+     *
+     * Tasks run on the shared executor, so a task waiting for another hands
+     * its worker to a spare thread rather than holding it.
      */
     void wait() const {
-        future->wait();
+        if (!isReady()) {
+            tocin::runtime::ExecutorBlockingScope blocking;
+            future->wait();
+        }
     }
 
     /**
@@ -252,6 +426,10 @@ public:
      */
     template<typename Rep, typename Period>
     bool waitFor(const std::chrono::duration<Rep, Period>& timeout) const {
+        if (isReady()) {
+            return true;
+        }
+        tocin::runtime::ExecutorBlockingScope blocking;
         return future->wait_for(timeout) == std::future_status::ready;
     }
 };
@@ -273,6 +451,7 @@ public:
      */
     void get() {
         if (!has_cached) {
+            wait();
             future->get();
             has_cached = true;
         }
@@ -286,10 +465,13 @@ public:
     }
 
     /**
-     * @brief Wait for the future
+     * @brief Wait for the future (see Future<T>::wait)
      */
     void wait() const {
-        future->wait();
+        if (!isReady()) {
+            tocin::runtime::ExecutorBlockingScope blocking;
+            future->wait();
+        }
     }
 
     /**
@@ -297,44 +479,34 @@ public:
      */
     template<typename Rep, typename Period>
     bool waitFor(const std::chrono::duration<Rep, Period>& timeout) const {
+        if (isReady()) {
+            return true;
+        }
+        tocin::runtime::ExecutorBlockingScope blocking;
         return future->wait_for(timeout) == std::future_status::ready;
     }
 };
 
 /**
- * @brief Thread pool for managing goroutines
+ * @brief Task pool for managing goroutines
+ *
+ * Not a pool of its own threads: tasks run as goroutines on the shared
+ * executor (executor.h); the pool only counts them, so stop() can wait for
+ * the ones it submitted.
  */
 class ThreadPool {
 private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
     mutable std::mutex queue_mutex;
     std::condition_variable condition;
     std::atomic<bool> should_stop{false};
     std::atomic<size_t> active_threads{0};
+    size_t queued_tasks = 0;   // submitted, not yet started; guarded by queue_mutex
+    size_t pending_tasks = 0;  // submitted, not yet finished; guarded by queue_mutex
 
 public:
-    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
-        for (size_t i = 0; i < threads; ++i) {
-            workers.emplace_back([this] {
-                while (true) {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(queue_mutex);
-                        condition.wait(lock, [this] { return should_stop.load() || !tasks.empty(); });
-                        if (should_stop.load() && tasks.empty()) {
-                            return;
-                        }
-                        task = std::move(tasks.front());
-                        tasks.pop();
-                    }
-                    active_threads++;
-                    task();
-                    active_threads--;
-                }
-            });
-        }
-    }
+    // The thread count is the executor's (executorThreads()); the argument
+    // is kept for source compatibility.
+    explicit ThreadPool(size_t /*threads*/ = 0) {}
 
     /**
      * @brief Submit a task to the thread pool
@@ -353,9 +525,22 @@ public:
             if (should_stop.load()) {
                 throw std::runtime_error("ThreadPool is stopped");
             }
-            tasks.emplace([task]() { (*task)(); });
+            ++queued_tasks;
+            ++pending_tasks;
         }
-        condition.notify_one();
+        tocin::runtime::executorSubmit([this, task]() {
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                --queued_tasks;
+            }
+            active_threads++;
+            (*task)();
+            active_threads--;
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (--pending_tasks == 0) {
+                condition.notify_all();
+            }
+        });
         return res;
     }
 
@@ -371,20 +556,17 @@ public:
      */
     size_t getQueuedTasks() const {
         std::unique_lock<std::mutex> lock(queue_mutex);
-        return tasks.size();
+        return queued_tasks;
     }
 
     /**
-     * @brief Stop the thread pool
+     * @brief Stop the thread pool, waiting for submitted tasks to finish
      */
     void stop() {
         should_stop.store(true);
-        condition.notify_all();
-        for (auto& worker : workers) {
-            if (worker.joinable()) {
-                worker.join();
-            }
-        }
+        tocin::runtime::ExecutorBlockingScope blocking;
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        condition.wait(lock, [this] { return pending_tasks == 0; });
     }
 
     ~ThreadPool() {
@@ -445,44 +627,79 @@ public:
 
 /**
  * @brief Select statement implementation
+ *
+ * Waits on every channel at once with one ExecutorWaiter registered as a
+ * selector on each, so a blocked select parks like a blocked receive.
  */
 template<typename... Channels>
 class Select {
 private:
+    using value_type = typename std::tuple_element_t<0, std::tuple<Channels...>>::value_type;
+
     std::tuple<Channels&...> channels;
-    std::function<void(size_t, typename std::tuple_element_t<0, std::tuple<Channels...>>::value_type)> onReceive;
+    std::function<void(size_t, value_type)> onReceive;
     std::function<void(size_t)> onSend;
 
 public:
     Select(std::tuple<Channels&...> chs, 
-           std::function<void(size_t, typename std::tuple_element_t<0, std::tuple<Channels...>>::value_type)> recv = nullptr,
+           std::function<void(size_t, value_type)> recv = nullptr,
            std::function<void(size_t)> send = nullptr)
         : channels(chs), onReceive(recv), onSend(send) {}
 
     /**
      * @brief Execute the select statement
+     *
+     * Receives from the first channel (in order) holding a value, blocking
+     * until one does; returns its index, or -1 once every channel is closed
+     * and drained.
      */
     int execute() {
-        // Simple implementation - in a real system you'd use proper event handling
-        size_t index = 0;
-        std::apply([this, &index](auto&... ch) {
-            // Try to receive from each channel
-            (tryReceive(ch, index++) || ...);
-        }, channels);
-        return -1; // No channel ready
+        for (;;) {
+            int index = poll();
+            if (index >= 0) {
+                return index;
+            }
+            if (allClosed()) {
+                return poll();
+            }
+            tocin::runtime::noteChannelWait(tocin::runtime::ChannelWait::Select);
+            tocin::runtime::ExecutorWaiter w;
+            bool ready = false;
+            std::apply([&](auto&... ch) { ((ready = ch.addSelector(&w) || ready), ...); }, channels);
+            if (ready) {
+                w.fire();
+            }
+            w.wait();
+            std::apply([&](auto&... ch) { (ch.removeSelector(&w), ...); }, channels);
+        }
+    }
+
+    /**
+     * @brief Like execute(), but -1 at once when no channel has a value
+     */
+    int poll() {
+        int index = -1;
+        size_t i = 0;
+        std::apply([&](auto&... ch) { (tryReceive(ch, i++, index) || ...); }, channels);
+        return index;
     }
 
 private:
     template<typename Channel>
-    bool tryReceive(Channel& ch, size_t idx) {
-        auto value = ch.receive();
-        if (value.has_value()) {
-            if (onReceive) {
-                onReceive(idx, *value);
-            }
-            return true;
+    bool tryReceive(Channel& ch, size_t idx, int& index) {
+        auto value = ch.tryReceive();
+        if (!value.has_value()) {
+            return false;
+        }
+        if (onReceive) {
+            onReceive(idx, std::move(*value));
         }
-        return false;
+        index = static_cast<int>(idx);
+        return true;
+    }
+
+    bool allClosed() {
+        return std::apply([](auto&... ch) { return (ch.isClosed() && ...); }, channels);
     }
 };
 
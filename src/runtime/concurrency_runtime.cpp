@@ -1,36 +1,77 @@
-// Tocin runtime: goroutines (OS threads), channels, and exception handling.
+// Tocin runtime: goroutines (M:N fibers), channels, and exception handling.
 //
 // These symbols are linked into the compiler/runtime and resolved by the JIT
 // from the running process, and linked into native executables via the normal
 // C toolchain. Values flowing through channels are passed as 64-bit slots
 // (ints, bit-cast floats, or pointers), matching the codegen ABI.
+#include <algorithm>
 #include <atomic>
 #include <cctype>
+#include <charconv>
 #include <chrono>
 #include <condition_variable>
 #include <csetjmp>
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <random>
 #include <string>
+#include <string_view>
 #include <thread>
-#include <unordered_map>
 #include <vector>
 
+#include <unwind.h>
+
+#include "file_io.h"
+#include "flat_map.h"
+#include "hash.h"
+#include "http_parser.h"
+#include "json_parser.h"
+#include "kernel_support.h"
+#include "kv_store.h"
+#include "memo_table.h"
+#include "mpmc_ring.h"
+#include "runtime_layout.h"
+#include "websocket.h"
+#include "xoshiro.h"
+#include "executor.h"
+#include "lightweight_scheduler.h"
+#include "numa_topology.h"
+#include "runtime_metrics.h"
+#include "alloc_profiler.h"
+#include "sampling_profiler.h"
+#include "string_kernels.h"
+
 // POSIX sockets for the TCP networking runtime (Linux / macOS / BSD). On other
 // platforms the networking builtins compile to safe error-returning stubs.
 #if defined(__unix__) || defined(__APPLE__) || defined(__linux__)
 #define TOCIN_HAVE_POSIX_NET 1
 #include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/sendfile.h>
+#endif
+#endif
+#ifdef _WIN32
+#include <io.h>
 #endif
 
 // ===========================================================================
@@ -52,6 +93,11 @@ extern "C"
     void *GC_malloc_atomic(size_t);
     void *GC_realloc(void *, size_t);
     void GC_free(void *);
+    // Typed objects (gc_typed.h): a bitmap of the words that may hold
+    // pointers, made once per layout, lets the collector scan only those.
+    // GC_word and GC_descr are size_t wide on every target the runtime has.
+    size_t GC_make_descriptor(const size_t *, size_t);
+    void *GC_malloc_explicitly_typed(size_t, size_t);
     // Throughput tuning: raise the garbage tolerated between collections (lower
     // divisor = collect less often = fewer mark phases) and pre-grow the heap
     // so allocation-heavy code isn't throttled by early collections. Trades
@@ -62,732 +108,4948 @@ extern "C"
     int GC_register_my_thread(void *);   // GC_stack_base *
     int GC_unregister_my_thread(void);
     int GC_get_stack_base(void *);        // GC_stack_base *
+    // Collectable memory that is always scanned: goroutine descriptors hold
+    // the only reference to a not-yet-started goroutine's argument pack.
+    void *GC_malloc_uncollectable(size_t);
+    // Coroutine support (libgc >= 8.0). Goroutines run on fibers, so the stack
+    // a worker thread is executing on changes at every switch: the switch
+    // holds the allocation lock and re-points the thread's stack bottom, and
+    // the stacks of parked fibers are pushed as extra roots.
+    void GC_alloc_lock(void);
+    void GC_alloc_unlock(void);
+    void *GC_get_my_stackbottom(void *); // GC_stack_base *; returns thread handle
+    void GC_set_stackbottom(void *, const void *);
+    typedef void (*GC_push_other_roots_proc)(void);
+    void GC_set_push_other_roots(GC_push_other_roots_proc);
+    GC_push_other_roots_proc GC_get_push_other_roots(void);
+    void GC_push_all_eager(void *, void *);
+    // Runtime metrics: collection start/end events time each pause (the
+    // default collector marks with the world stopped), and the allocator
+    // keeps the byte counts.
+    typedef void (*GC_on_collection_event_proc)(int); // GC_EventType
+    void GC_set_on_collection_event(GC_on_collection_event_proc);
+    size_t GC_get_total_bytes(void);
+    size_t GC_get_heap_size(void);
+    // Pause control for servers (TOCIN_GC_* and gcConfigure): incremental,
+    // generational collection does the marking in steps of at most the time
+    // limit between allocations; a parallel-marking libgc marks with
+    // several threads; a heap limit bounds growth. The markers setter is
+    // newer than the rest (libgc >= 8.2), so it is weak and GC_MARKERS in
+    // the environment does its job on older collectors.
+    void GC_enable_incremental(void);
+    int GC_is_incremental_mode(void);
+    void GC_set_time_limit(unsigned long);
+    void GC_set_max_heap_size(size_t);
+#ifndef _WIN32
+    __attribute__((weak))
+#endif
+    void GC_set_markers_count(unsigned);
 }
 namespace { struct GC_stack_base { void *mem_base; void *reg_base; }; }
 #endif
 
+struct TocinArena; // see "Region allocation" below
+
 namespace
 {
-    struct Channel
+    using tocin::runtime::Fiber;
+    using tocin::runtime::LightweightScheduler;
+
+#ifdef TOCIN_HAVE_GC
+    constexpr int kGcEventStart = 0; // GC_EVENT_START
+    constexpr int kGcEventEnd = 5;   // GC_EVENT_END
+
+    // Written by the collecting thread only, read by runtimeMetrics().
+    std::atomic<uint64_t> g_gcCollections{0};
+    std::atomic<uint64_t> g_gcPauseNs{0};
+    std::atomic<uint64_t> g_gcMaxPauseNs{0};
+    std::atomic<int64_t> g_gcStartNs{0};
+
+    int64_t tocin_gc_now_ns()
     {
-        std::mutex m;
-        std::condition_variable cv;
-        std::deque<int64_t> q;
-    };
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void tocin_gc_on_event(int event)
+    {
+        if (event == kGcEventStart)
+        {
+            g_gcStartNs.store(tocin_gc_now_ns(), std::memory_order_relaxed);
+        }
+        else if (event == kGcEventEnd)
+        {
+            uint64_t pause = (uint64_t)(tocin_gc_now_ns() - g_gcStartNs.load(std::memory_order_relaxed));
+            g_gcPauseNs.fetch_add(pause, std::memory_order_relaxed);
+            if (pause > g_gcMaxPauseNs.load(std::memory_order_relaxed))
+                g_gcMaxPauseNs.store(pause, std::memory_order_relaxed);
+            g_gcCollections.fetch_add(1, std::memory_order_relaxed);
+            // Still under the allocation lock, with this collection's marks.
+            tocin::runtime::AllocationProfiler::instance().noteCollection();
+        }
+    }
 
-    // Track spawned goroutines so the program can wait for them to finish.
-    std::mutex g_threadsMutex;
-    std::vector<std::thread> g_threads;
+    // A count or byte size from the environment, with an optional K, M or
+    // G suffix; `fallback` if unset or malformed.
+    size_t tocin_gc_env(const char *name, size_t fallback)
+    {
+        const char *v = std::getenv(name);
+        if (!v || !*v) return fallback;
+        char *end = nullptr;
+        unsigned long long n = std::strtoull(v, &end, 10);
+        if (end == v) return fallback;
+        switch (*end)
+        {
+        case 'k': case 'K': n <<= 10; break;
+        case 'm': case 'M': n <<= 20; break;
+        case 'g': case 'G': n <<= 30; break;
+        default: break;
+        }
+        return (size_t)n;
+    }
 
-#ifdef TOCIN_HAVE_GC
+    void tocin_gc_set_markers(size_t markers)
+    {
+        if (GC_set_markers_count)
+        {
+            GC_set_markers_count((unsigned)markers);
+            return;
+        }
+#ifndef _WIN32
+        ::setenv("GC_MARKERS", std::to_string(markers).c_str(), 0);
+#endif
+    }
+
+    std::atomic<size_t> g_gcMarkers{0}; // gcConfigure("markers", n) before the first allocation
+    std::atomic<bool> g_gcStarted{false};
     std::once_flag g_gcInit;
     void tocin_gc_ensure_init()
     {
         std::call_once(g_gcInit, [] {
+            GC_set_on_collection_event(tocin_gc_on_event);
+            // Marker threads start in GC_init, so their count goes first.
+            size_t markers = tocin_gc_env("TOCIN_GC_MARKERS", g_gcMarkers.load(std::memory_order_relaxed));
+            if (markers)
+                tocin_gc_set_markers(markers);
             GC_init();
             GC_allow_register_threads();
             // Tune for throughput: collect ~4x less often than the default
             // (divisor 3) and start with a 64 MB heap so short-lived-allocation
             // workloads (string conversion, temporaries) don't stall on early
-            // collections. Overridable via the standard GC_* environment vars.
-            GC_set_free_space_divisor(1);
-            GC_expand_hp((size_t)64 * 1024 * 1024);
+            // collections. TOCIN_GC_FREE_SPACE_DIVISOR and TOCIN_GC_INITIAL_HEAP
+            // override both, and the standard GC_* environment vars still apply.
+            GC_set_free_space_divisor(std::max<size_t>(1, tocin_gc_env("TOCIN_GC_FREE_SPACE_DIVISOR", 1)));
+            GC_expand_hp(tocin_gc_env("TOCIN_GC_INITIAL_HEAP", (size_t)64 * 1024 * 1024));
+            if (size_t limit = tocin_gc_env("TOCIN_GC_MAX_HEAP", 0))
+                GC_set_max_heap_size(limit);
+            // Latency instead: TOCIN_GC_INCREMENTAL=1 marks in steps, of at
+            // most TOCIN_GC_PAUSE_MS each when set.
+            if (tocin_gc_env("TOCIN_GC_INCREMENTAL", 0))
+                GC_enable_incremental();
+            if (size_t ms = tocin_gc_env("TOCIN_GC_PAUSE_MS", 0))
+                GC_set_time_limit((unsigned long)ms);
+            g_gcStarted.store(true, std::memory_order_release);
         });
     }
 #endif
-}
 
-extern "C"
-{
-    // Central allocator used by both the compiler-emitted code and the runtime.
-    void *__tocin_alloc(int64_t size)
+    // Exception-handler state (see "Exception handling" below). Plain threads
+    // keep it thread-local; a goroutine carries its own, because a parked
+    // goroutine may resume on a different worker thread.
+    struct ExcState
     {
-        if (size < 0) size = 0;
-#ifdef TOCIN_HAVE_GC
-        tocin_gc_ensure_init();
-        return GC_malloc((size_t)size);
-#else
-        return std::malloc((size_t)size);
-#endif
+        // Stored as void* (not std::jmp_buf*) so jmp_buf's alignment attributes
+        // are not dropped on a template argument (-Wignored-attributes).
+        std::vector<void *> handlers;
+        int64_t value = 0;
+        bool unwinding = false; // a table-driven throw has not reached its catch yet
+    };
+
+    [[noreturn]] void tocin_uncaught(int64_t value)
+    {
+        std::fprintf(stderr, "Tocin: uncaught exception (value=%lld)\n",
+                     static_cast<long long>(value));
+        std::abort();
     }
-    // Allocate a pointer-free buffer (strings, byte arrays). Same interface as
-    // __tocin_alloc but the GC skips scanning it - meaningfully faster for the
-    // high allocation rates of string-producing builtins.
-    void *__tocin_alloc_atomic(int64_t size)
+
+    // One entry of a `withArena` scope stack (see "Region allocation" below),
+    // per goroutine for the same reason as ExcState.
+    struct ArenaScope
+    {
+        TocinArena *arena;
+        bool owned; // created by the scope; released when it exits
+    };
+
+    struct Goroutine
+    {
+        void (*fn)(void *);
+        void *arg;
+        ExcState exc;
+        std::vector<ArenaScope> arenas;
+        tocin::runtime::RandState rng; // see "Pseudo-random numbers" below
+    };
+
+    // Descriptors are GC-scanned (but never collected) so the argument pack
+    // and any in-flight exception payload stay reachable.
+    Goroutine *tocin_goroutine_new(void (*fn)(void *), void *arg)
     {
-        if (size < 0) size = 0;
 #ifdef TOCIN_HAVE_GC
         tocin_gc_ensure_init();
-        return GC_malloc_atomic((size_t)size);
+        void *mem = GC_malloc_uncollectable(sizeof(Goroutine));
+        if (!mem) std::abort();
+        return new (mem) Goroutine{fn, arg, {}, {}, {}};
 #else
-        return std::malloc((size_t)size);
+        return new Goroutine{fn, arg, {}, {}, {}};
 #endif
     }
-    // Resize a buffer obtained from __tocin_alloc.
-    void *__tocin_realloc(void *p, int64_t size)
+
+    void tocin_goroutine_free(Goroutine *g)
     {
-        if (size < 0) size = 0;
 #ifdef TOCIN_HAVE_GC
-        tocin_gc_ensure_init();
-        return GC_realloc(p, (size_t)size);
+        g->~Goroutine();
+        GC_free(g);
 #else
-        return std::realloc(p, (size_t)size);
+        delete g;
 #endif
     }
-}
 
-extern "C"
-{
-    // Allocate a new channel and return an opaque handle.
-    void *__tocin_chan_new()
+    // The generator of the calling goroutine, or of the thread outside one.
+    thread_local tocin::runtime::RandState g_threadRng;
+
+    tocin::runtime::RandState &tocin_rng()
     {
-        return new Channel();
+        if (Fiber *f = Fiber::current())
+            if (void *g = f->getLocal())
+                return static_cast<Goroutine *>(g)->rng;
+        return g_threadRng;
     }
 
-    // Send a 64-bit value into the channel and wake a waiting receiver.
-    void __tocin_chan_send(void *handle, int64_t value)
+    // Streams for generators nothing seeded, handed out in order of first
+    // use, each 2^192 steps past the last.
+    std::mutex g_rngRootMu;
+    tocin::runtime::Xoshiro256 g_rngRoot = [] {
+        tocin::runtime::Xoshiro256 g;
+        g.seed(0x853c49e6748fea9bULL);
+        return g;
+    }();
+
+    tocin::runtime::RandState &tocin_rng_ready()
     {
-        if (!handle)
-            return;
-        auto *ch = static_cast<Channel *>(handle);
+        tocin::runtime::RandState &r = tocin_rng();
+        if (!r.inUse)
         {
-            std::lock_guard<std::mutex> lock(ch->m);
-            ch->q.push_back(value);
+            std::lock_guard<std::mutex> lock(g_rngRootMu);
+            r.gen = g_rngRoot;
+            g_rngRoot.longJump();
+            r.inUse = true;
         }
-        ch->cv.notify_one();
+        return r;
     }
 
-    // Receive a 64-bit value, blocking until one is available.
-    int64_t __tocin_chan_recv(void *handle)
+    // A goroutine spawned by one whose generator is in use continues its
+    // stream, and the spawner long-jumps past what the child can reach.
+    void tocin_rng_fork(Goroutine *child)
     {
-        if (!handle)
-            return 0;
-        auto *ch = static_cast<Channel *>(handle);
-        std::unique_lock<std::mutex> lock(ch->m);
-        ch->cv.wait(lock, [ch] { return !ch->q.empty(); });
-        int64_t value = ch->q.front();
-        ch->q.pop_front();
-        return value;
+        tocin::runtime::RandState &parent = tocin_rng();
+        if (!parent.inUse) return;
+        child->rng.gen = parent.gen;
+        child->rng.inUse = true;
+        parent.gen.longJump();
     }
 
-    // Non-blocking receive: if a value is available, dequeue it into *out and
-    // return 1; otherwise return 0 without blocking. Used to implement `select`.
-    int8_t __tocin_chan_try_recv(void *handle, int64_t *out)
+#ifdef TOCIN_HAVE_GC
+    // Worker-thread GC state. Only touched from the hook functions below,
+    // which the scheduler calls afresh on whichever thread is switching, so
+    // no TLS address is ever carried across a fiber migration.
+    thread_local void *t_gcThread = nullptr;
+    thread_local GC_stack_base t_gcOwnStack = {nullptr, nullptr};
+    GC_push_other_roots_proc g_gcPrevPushOtherRoots = nullptr;
+
+    void tocin_gc_worker_start()
     {
-        if (!handle || !out)
-            return 0;
-        auto *ch = static_cast<Channel *>(handle);
-        std::lock_guard<std::mutex> lock(ch->m);
-        if (ch->q.empty())
-            return 0;
-        *out = ch->q.front();
-        ch->q.pop_front();
-        return 1;
+        tocin_gc_ensure_init();
+        GC_stack_base sb;
+        if (GC_get_stack_base(&sb) == 0)
+            GC_register_my_thread(&sb);
+        t_gcThread = GC_get_my_stackbottom(&t_gcOwnStack);
     }
-
-    // Briefly sleep to avoid a hot busy-wait in a blocking `select` poll loop.
-    void __tocin_chan_park()
+    void tocin_gc_worker_stop() { GC_unregister_my_thread(); }
+    void tocin_gc_lock_switch() { GC_alloc_lock(); }
+    void tocin_gc_unlock_switch() { GC_alloc_unlock(); }
+    void tocin_gc_set_stack_bottom(void *bottom)
     {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (!t_gcThread) return; // not a registered worker
+        GC_stack_base sb = t_gcOwnStack;
+        if (bottom) sb.mem_base = bottom;
+        GC_set_stackbottom(t_gcThread, &sb);
     }
-
-    void __tocin_join_all();
-
-    // Spawn a goroutine: run fn(arg) on a new OS thread, tracked for joining.
-    void __tocin_go(void (*fn)(void *), void *arg)
+    void tocin_gc_push_fiber_roots()
     {
-        if (!fn)
-            return;
-        // Ensure all goroutines are joined when the program exits.
-        static std::once_flag atexitFlag;
-        std::call_once(atexitFlag, [] { std::atexit(__tocin_join_all); });
-        std::lock_guard<std::mutex> lock(g_threadsMutex);
-#ifdef TOCIN_HAVE_GC
-        // Register the goroutine's stack with the collector so values it holds
-        // are treated as roots and not reclaimed while in use.
-        tocin_gc_ensure_init();
-        g_threads.emplace_back([fn, arg] {
-            GC_stack_base sb;
-            if (GC_get_stack_base(&sb) == 0)
-                GC_register_my_thread(&sb);
-            fn(arg);
-            GC_unregister_my_thread();
-        });
-#else
-        g_threads.emplace_back(fn, arg);
-#endif
+        if (g_gcPrevPushOtherRoots) g_gcPrevPushOtherRoots();
+        LightweightScheduler::instance().forEachSuspendedStack(
+            [](void *lo, void *hi) { GC_push_all_eager(lo, hi); });
     }
+#endif
 
-    // Wait for all spawned goroutines to finish.
-    void __tocin_join_all()
+    std::atomic<bool> g_schedStarted{false};
+
+    size_t tocin_env_size(const char *name, size_t fallback)
     {
-        std::vector<std::thread> threads;
-        {
-            std::lock_guard<std::mutex> lock(g_threadsMutex);
-            threads.swap(g_threads);
-        }
-        for (auto &t : threads)
-            if (t.joinable())
-                t.join();
+        const char *v = std::getenv(name);
+        if (!v || !*v) return fallback;
+        long long n = std::atoll(v);
+        return n > 0 ? (size_t)n : fallback;
     }
 }
 
-// ---------------------------------------------------------------------------
-// Exception handling: setjmp/longjmp-based unwinding.
-//
-// Each `try` allocates a jmp_buf in its own frame, calls setjmp, and registers
-// the buffer with __tocin_try_register. `throw` records a 64-bit value and
-// longjmps back to the most recently registered handler. The handler stack is
-// thread-local so goroutines have independent exception state.
-// ---------------------------------------------------------------------------
+// Attach/detach a runtime-owned OS thread (the parallel-for pool) to the
+// collector, so objects reachable only from its stack survive a collection.
+// No-ops when the runtime is built without GC.
+extern "C" void __tocin_gc_thread_attach()
+{
+#ifdef TOCIN_HAVE_GC
+    tocin_gc_worker_start();
+#endif
+}
+extern "C" void __tocin_gc_thread_detach()
+{
+#ifdef TOCIN_HAVE_GC
+    tocin_gc_worker_stop();
+#endif
+}
+
+extern "C" void __tocin_join_all();
 namespace
 {
-    // Stored as void* (not std::jmp_buf*) so jmp_buf's alignment attributes are
-    // not dropped on a template argument (-Wignored-attributes); cast back at use.
-    thread_local std::vector<void *> g_handlerStack;
-    thread_local int64_t g_excValue = 0;
+    bool tocin_stdout_is_tty(); // see "Standard output"
 }
 
-extern "C"
+namespace
 {
-    // Register a setjmp buffer as the innermost active exception handler.
-    void __tocin_try_register(void *buf)
+    // CPUs this process may run on: the affinity mask (taskset, cpusets),
+    // capped by a cgroup CPU quota (container CPU limits), which
+    // hardware_concurrency() reports neither of.
+    size_t tocin_available_cpus()
     {
-        g_handlerStack.push_back(buf);
+        unsigned hw = std::thread::hardware_concurrency();
+        size_t cpus = hw ? hw : 1;
+#if defined(__linux__)
+        cpu_set_t set;
+        if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+            cpus = (size_t)CPU_COUNT(&set);
+        // cgroup v2: "<quota> <period>" or "max <period>"; v1: two files.
+        long long quota = -1, period = 0;
+        if (FILE *f = std::fopen("/sys/fs/cgroup/cpu.max", "r"))
+        {
+            char q[32] = {0};
+            if (std::fscanf(f, "%31s %lld", q, &period) == 2 && std::strcmp(q, "max") != 0)
+                quota = std::atoll(q);
+            std::fclose(f);
+        }
+        else if (FILE *fq = std::fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r"))
+        {
+            if (std::fscanf(fq, "%lld", &quota) != 1) quota = -1;
+            std::fclose(fq);
+            if (FILE *fp = std::fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r"))
+            {
+                if (std::fscanf(fp, "%lld", &period) != 1) period = 0;
+                std::fclose(fp);
+            }
+        }
+        if (quota > 0 && period > 0)
+            cpus = std::min(cpus, (size_t)std::max(1LL, (quota + period - 1) / period));
+#endif
+        return cpus;
     }
 
-    // Remove the innermost handler (try body completed without throwing).
-    void __tocin_try_pop()
+    // The goroutine scheduler: an M:N fiber pool, started on first use, and
+    // the executor every other concurrent facility runs on (executor.h).
+    // TOCIN_MAX_PROCS sets the worker count (default: one per available CPU)
+    // and TOCIN_GOROUTINE_STACK the per-goroutine stack size in bytes. On a
+    // machine with several NUMA nodes workers are pinned node by node unless
+    // TOCIN_NUMA=0.
+    LightweightScheduler &tocin_sched()
     {
-        if (!g_handlerStack.empty())
-            g_handlerStack.pop_back();
+        static std::once_flag once;
+        LightweightScheduler &s = LightweightScheduler::instance();
+        std::call_once(once, [&s] {
+            s.setMaxWorkers(tocin::runtime::executorThreads());
+            const char *numa = std::getenv("TOCIN_NUMA");
+            if (tocin::runtime::NumaTopology::system().nodes() > 1 && !(numa && std::strcmp(numa, "0") == 0))
+                s.enableNUMAAwareness(true);
+            s.setFiberStackSize(tocin_env_size("TOCIN_GOROUTINE_STACK", 256 * 1024));
+#ifdef TOCIN_HAVE_GC
+            tocin_gc_ensure_init();
+            g_gcPrevPushOtherRoots = GC_get_push_other_roots();
+            GC_set_push_other_roots(tocin_gc_push_fiber_roots);
+            tocin::runtime::SchedulerHooks hooks;
+            hooks.onWorkerStart = tocin_gc_worker_start;
+            hooks.onWorkerStop = tocin_gc_worker_stop;
+            hooks.lockSwitch = tocin_gc_lock_switch;
+            hooks.unlockSwitch = tocin_gc_unlock_switch;
+            hooks.setStackBottom = tocin_gc_set_stack_bottom;
+            s.setHooks(hooks);
+#endif
+            s.start();
+            g_schedStarted.store(true);
+            // Registered after the scheduler singleton is constructed, so all
+            // goroutines are waited for before the scheduler is torn down.
+            std::atexit(__tocin_join_all);
+        });
+        return s;
     }
 
-    // Return the value carried by the most recently thrown exception.
-    int64_t __tocin_exc_value()
+    // Bracket a system call that can block indefinitely. On a goroutine the
+    // worker's slot is handed to a spare thread for the duration, so one slow
+    // client cannot stall every other goroutine; elsewhere it is a no-op.
+    struct BlockingSection
     {
-        return g_excValue;
-    }
+        BlockingSection() { LightweightScheduler::enterBlocking(); }
+        ~BlockingSection() { LightweightScheduler::exitBlocking(); }
+    };
 
-    // Throw: record the value and unwind to the nearest handler via longjmp.
-    // With no active handler the exception is fatal.
-    void __tocin_throw(int64_t value)
+    // A blocked `select`, registered on every channel it waits for. Any send
+    // to one of them fires it; the selector then retries its cases.
+    struct SelectWaiter
     {
-        g_excValue = value;
-        if (g_handlerStack.empty())
-        {
-            std::fprintf(stderr,
-                         "Tocin: uncaught exception (value=%lld)\n",
-                         static_cast<long long>(value));
-            std::abort();
-        }
-        std::jmp_buf *buf = static_cast<std::jmp_buf *>(g_handlerStack.back());
-        g_handlerStack.pop_back();
-        std::longjmp(*buf, 1);
-    }
-}
+        std::mutex m;
+        std::condition_variable cv;   // selector on a plain thread
+        std::shared_ptr<Fiber> fiber; // selector on a goroutine, while parked
+        bool fired = false;
+    };
 
-// ===========================================================================
-// Dynamic collections: growable vector and hashmap behind opaque handles.
-// Elements/keys/values are 64-bit slots (ints stored directly; pointers/
-// strings via ptrtoint round-trip on the codegen side). These leak unless
-// *Free is called.
-// ===========================================================================
-namespace
-{
-    struct TocinMap
+    // Buffered channels hold their values in a lock-free MPMC ring
+    // (mpmc_ring.h).
+    using BoundedRing = tocin::runtime::MpmcRing<int64_t>;
+
+    // A channel is either unbounded (channel(): a deque under `m`) or bounded
+    // (channel(n): `ring`, lock-free on the fast path). Waiters always
+    // register under `m`; the bounded fast path only takes `m` when the
+    // waiter counts say someone is blocked.
+    struct Channel
     {
-        std::unordered_map<int64_t, int64_t> ints;
-        std::unordered_map<std::string, int64_t> strs;
+        std::mutex m;
+        std::condition_variable cv;                 // receivers on plain threads
+        std::deque<int64_t> q;                      // unbounded buffer
+        std::deque<std::shared_ptr<Fiber>> parked;  // receivers on goroutines
+        std::vector<SelectWaiter *> selectors;      // guarded by m
+
+        std::unique_ptr<BoundedRing> ring;          // bounded buffer, or null
+        bool rendezvous = false;                    // channel(0): send waits for its receive
+        std::condition_variable sendCv;             // blocked senders on plain threads
+        std::deque<std::shared_ptr<Fiber>> parkedSenders;
+        std::atomic<int> recvWaiters{0};            // blocked receivers + selectors
+        std::atomic<int> sendWaiters{0};
+        std::atomic<uint64_t> received{0};          // completed bounded receives
     };
-}
 
-extern "C"
-{
-    // ---- vector: std::vector<int64_t> ----
-    void *__tocin_vec_new() { return new std::vector<int64_t>(); }
-    void __tocin_vec_push(void *h, int64_t x)
-    {
-        if (h) static_cast<std::vector<int64_t> *>(h)->push_back(x);
-    }
-    int64_t __tocin_vec_get(void *h, int64_t i)
+    bool tocin_chan_ready(Channel *ch)
     {
-        if (!h) return 0;
-        auto *v = static_cast<std::vector<int64_t> *>(h);
-        if (i < 0 || (size_t)i >= v->size()) return 0;
-        return (*v)[(size_t)i];
-    }
-    void __tocin_vec_set(void *h, int64_t i, int64_t x)
-    {
-        if (!h) return;
-        auto *v = static_cast<std::vector<int64_t> *>(h);
-        if (i < 0 || (size_t)i >= v->size()) return;
-        (*v)[(size_t)i] = x;
+        return ch->ring ? ch->ring->maybeNonEmpty() : !ch->q.empty();
     }
-    int64_t __tocin_vec_len(void *h)
+
+    // Wake a selector. Called with the channel's mutex held, which is what
+    // keeps `w` alive: a selector unregisters under that mutex before it
+    // returns.
+    void tocin_select_fire(SelectWaiter *w)
     {
-        return h ? (int64_t)static_cast<std::vector<int64_t> *>(h)->size() : 0;
+        std::shared_ptr<Fiber> fiber;
+        {
+            std::lock_guard<std::mutex> lock(w->m);
+            if (w->fired)
+                return;
+            w->fired = true;
+            fiber = std::move(w->fiber);
+        }
+        if (fiber)
+            LightweightScheduler::instance().unpark(std::move(fiber));
+        else
+            w->cv.notify_one();
     }
-    int64_t __tocin_vec_pop(void *h)
+
+    // Block the caller until the channel may have changed. A goroutine parks
+    // its fiber (freeing the worker); a plain thread waits on the condvar.
+    void tocin_chan_wait(Channel *ch, std::unique_lock<std::mutex> &lock)
     {
-        if (!h) return 0;
-        auto *v = static_cast<std::vector<int64_t> *>(h);
-        if (v->empty()) return 0;
-        int64_t x = v->back();
-        v->pop_back();
-        return x;
+        tocin::runtime::noteChannelWait(tocin::runtime::ChannelWait::Receive);
+        if (Fiber *self = Fiber::current())
+        {
+            ch->parked.push_back(self->shared_from_this());
+            LightweightScheduler::park(lock);
+        }
+        else
+        {
+            ch->cv.wait(lock);
+        }
     }
-    void __tocin_vec_free(void *h) { delete static_cast<std::vector<int64_t> *>(h); }
 
-    // ---- hashmap: int-keyed + string-keyed entries behind one handle ----
-    void *__tocin_map_new() { return new TocinMap(); }
-    void __tocin_map_put(void *h, int64_t k, int64_t v)
+    // The same for a sender blocked on a full (or rendezvous) channel.
+    void tocin_chan_wait_send(Channel *ch, std::unique_lock<std::mutex> &lock)
     {
-        if (h) static_cast<TocinMap *>(h)->ints[k] = v;
+        tocin::runtime::noteChannelWait(tocin::runtime::ChannelWait::Send);
+        if (Fiber *self = Fiber::current())
+        {
+            ch->parkedSenders.push_back(self->shared_from_this());
+            LightweightScheduler::park(lock);
+        }
+        else
+        {
+            ch->sendCv.wait(lock);
+        }
     }
-    int64_t __tocin_map_get(void *h, int64_t k)
+
+    // Wake up to `n` blocked receivers (one per value made available) and
+    // every selector. Must hold m.
+    void tocin_chan_wake_receivers_locked(Channel *ch, size_t n = 1)
     {
-        if (!h) return 0;
-        auto *m = static_cast<TocinMap *>(h);
-        auto it = m->ints.find(k);
-        return it == m->ints.end() ? 0 : it->second;
+        for (size_t i = 0; i < n && !ch->parked.empty(); ++i)
+        {
+            LightweightScheduler::instance().unpark(std::move(ch->parked.front()));
+            ch->parked.pop_front();
+        }
+        if (n == 1)
+            ch->cv.notify_one();
+        else
+            ch->cv.notify_all();
+        for (SelectWaiter *w : ch->selectors)
+            tocin_select_fire(w);
     }
-    int64_t __tocin_map_has(void *h, int64_t k)
+
+    // After `n` bounded receives: account for them and wake the senders they
+    // unblock. A rendezvous send waits for its own ticket, so wake them all.
+    void tocin_bounded_received(Channel *ch, size_t n = 1)
     {
-        return h && static_cast<TocinMap *>(h)->ints.count(k) ? 1 : 0;
+        ch->received.fetch_add(n, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ch->sendWaiters.load(std::memory_order_seq_cst) == 0)
+            return;
+        std::lock_guard<std::mutex> lock(ch->m);
+        if (ch->rendezvous)
+            n = ch->parkedSenders.size();
+        for (size_t i = 0; i < n && !ch->parkedSenders.empty(); ++i)
+        {
+            LightweightScheduler::instance().unpark(std::move(ch->parkedSenders.front()));
+            ch->parkedSenders.pop_front();
+        }
+        if (n == 1 && !ch->rendezvous)
+            ch->sendCv.notify_one();
+        else
+            ch->sendCv.notify_all();
     }
-    void __tocin_map_put_str(void *h, const char *k, int64_t v)
+
+    void tocin_bounded_send(Channel *ch, int64_t value)
     {
-        if (h && k) static_cast<TocinMap *>(h)->strs[std::string(k)] = v;
+        uint64_t ticket = 0;
+        if (!ch->ring->push(value, &ticket))
+        {
+            std::unique_lock<std::mutex> lock(ch->m);
+            ch->sendWaiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!ch->ring->push(value, &ticket))
+                tocin_chan_wait_send(ch, lock);
+            ch->sendWaiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        // Pairs with the waiter-count increment a receiver makes before its
+        // final re-check, so one side always sees the other.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ch->recvWaiters.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(ch->m);
+            tocin_chan_wake_receivers_locked(ch);
+        }
+        if (ch->rendezvous && ch->received.load(std::memory_order_seq_cst) < ticket)
+        {
+            std::unique_lock<std::mutex> lock(ch->m);
+            ch->sendWaiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (ch->received.load(std::memory_order_seq_cst) < ticket)
+                tocin_chan_wait_send(ch, lock);
+            ch->sendWaiters.fetch_sub(1, std::memory_order_relaxed);
+        }
     }
-    int64_t __tocin_map_get_str(void *h, const char *k)
+
+    int64_t tocin_bounded_recv(Channel *ch)
     {
-        if (!h || !k) return 0;
-        auto *m = static_cast<TocinMap *>(h);
-        auto it = m->strs.find(std::string(k));
-        return it == m->strs.end() ? 0 : it->second;
+        int64_t value = 0;
+        if (!ch->ring->pop(&value))
+        {
+            std::unique_lock<std::mutex> lock(ch->m);
+            ch->recvWaiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!ch->ring->pop(&value))
+                tocin_chan_wait(ch, lock);
+            ch->recvWaiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        tocin_bounded_received(ch);
+        return value;
     }
-    int64_t __tocin_map_has_str(void *h, const char *k)
+
+    // Batched bounded send: push lock-free while there is room and wake the
+    // receivers once for everything pushed. Receivers are woken before
+    // blocking on a full buffer too, or the batch could wait on itself.
+    void tocin_bounded_send_many(Channel *ch, const int64_t *vals, size_t n)
     {
-        return (h && k && static_cast<TocinMap *>(h)->strs.count(std::string(k))) ? 1 : 0;
+        if (ch->rendezvous)
+        {
+            for (size_t i = 0; i < n; ++i)
+                tocin_bounded_send(ch, vals[i]);
+            return;
+        }
+        size_t i = 0;
+        while (i < n)
+        {
+            size_t pushed = 0;
+            uint64_t ticket = 0;
+            while (i < n && ch->ring->push(vals[i], &ticket))
+            {
+                ++i;
+                ++pushed;
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (pushed && ch->recvWaiters.load(std::memory_order_relaxed) > 0)
+            {
+                std::lock_guard<std::mutex> lock(ch->m);
+                tocin_chan_wake_receivers_locked(ch, pushed);
+            }
+            if (i < n)
+            {
+                std::unique_lock<std::mutex> lock(ch->m);
+                ch->sendWaiters.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                while (!ch->ring->push(vals[i], &ticket))
+                    tocin_chan_wait_send(ch, lock);
+                ch->sendWaiters.fetch_sub(1, std::memory_order_relaxed);
+                ++i;
+                // Report the value pushed under the lock with the next run.
+                lock.unlock();
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (ch->recvWaiters.load(std::memory_order_relaxed) > 0)
+                {
+                    std::lock_guard<std::mutex> relock(ch->m);
+                    tocin_chan_wake_receivers_locked(ch);
+                }
+            }
+        }
     }
-    int64_t __tocin_map_len(void *h)
+
+    // Batched bounded receive: wait for one value, then take whatever else is
+    // already buffered, up to `max`.
+    size_t tocin_bounded_recv_many(Channel *ch, int64_t *out, size_t max)
     {
-        if (!h) return 0;
-        auto *m = static_cast<TocinMap *>(h);
-        return (int64_t)(m->ints.size() + m->strs.size());
+        size_t got = 0;
+        while (got < max && ch->ring->pop(&out[got]))
+            ++got;
+        if (got == 0)
+        {
+            std::unique_lock<std::mutex> lock(ch->m);
+            ch->recvWaiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!ch->ring->pop(&out[0]))
+                tocin_chan_wait(ch, lock);
+            ch->recvWaiters.fetch_sub(1, std::memory_order_relaxed);
+            got = 1;
+            lock.unlock();
+            while (got < max && ch->ring->pop(&out[got]))
+                ++got;
+        }
+        tocin_bounded_received(ch, got);
+        return got;
     }
-    void __tocin_map_free(void *h) { delete static_cast<TocinMap *>(h); }
 }
 
-// ===========================================================================
-// String runtime: char*-based, NUL-terminated. Functions returning a string
-// return a fresh malloc'd buffer (never aliasing an input). Out-of-range char
-// access returns -1; substring bounds are clamped; NULL inputs are tolerated.
-// ===========================================================================
-extern "C"
+// ---------------------------------------------------------------------------
+// Region allocation: `withArena { ... }`.
+//
+// An arena is a list of malloc'd chunks carved up by a bump pointer. While a
+// scope is active on the current goroutine (or plain thread), pointer-free
+// allocations (__tocin_alloc_atomic: strings, numeric arrays) come from the
+// innermost arena instead of the GC heap, and the whole region is released at
+// once when the scope exits. Chunks are invisible to the collector, which is
+// why only pointer-free data is placed there: nothing in an arena keeps a GC
+// object alive. Arenas are not thread-safe; a goroutine spawned inside a
+// scope starts with an empty stack and allocates from the heap.
+// ---------------------------------------------------------------------------
+struct TocinArena
+{
+    struct Chunk
+    {
+        Chunk *next;
+        size_t size; // payload bytes; the payload follows the header
+    };
+    Chunk *chunks = nullptr; // newest first; allocation happens in the head
+    char *cur = nullptr;
+    char *end = nullptr;
+};
+
+namespace
 {
-    static char *tocin_str_empty()
+    constexpr size_t kArenaFirstChunk = 64 * 1024;
+    constexpr size_t kArenaMaxChunk = 1024 * 1024;
+    constexpr size_t kArenaPoolMax = 64;
+
+    // Every live chunk, so free/realloc can recognise arena pointers (which
+    // must not reach GC_free/free). g_arenaChunks skips the lookup entirely
+    // in programs that never use an arena.
+    std::mutex g_arenaChunksMu;
+    std::map<const char *, const char *> g_arenaChunkRanges; // start -> end
+    std::atomic<size_t> g_arenaChunks{0};
+
+    // Reset arenas kept for reuse by scoped `withArena { }` blocks, so a
+    // request-per-block server does not malloc a fresh chunk per request.
+    std::mutex g_arenaPoolMu;
+    std::vector<TocinArena *> g_arenaPool;
+
+    thread_local std::vector<ArenaScope> g_threadArenas;
+
+    std::vector<ArenaScope> &tocin_arena_scopes()
+    {
+        if (Fiber *f = Fiber::current())
+            if (void *g = f->getLocal())
+                return static_cast<Goroutine *>(g)->arenas;
+        return g_threadArenas;
+    }
+
+    char *tocin_chunk_payload(TocinArena::Chunk *c)
+    {
+        return reinterpret_cast<char *>(c + 1);
+    }
+
+    void tocin_arena_release_chunk(TocinArena::Chunk *c)
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_arenaChunksMu);
+            g_arenaChunkRanges.erase(tocin_chunk_payload(c));
+        }
+        g_arenaChunks.fetch_sub(1, std::memory_order_relaxed);
+        std::free(c);
+    }
+
+    void tocin_arena_grow(TocinArena *a, size_t need)
+    {
+        size_t size = a->chunks ? std::min(a->chunks->size * 2, kArenaMaxChunk) : kArenaFirstChunk;
+        size = std::max(size, need);
+        auto *c = static_cast<TocinArena::Chunk *>(std::malloc(sizeof(TocinArena::Chunk) + size));
+        if (!c)
+        {
+            std::fprintf(stderr, "Tocin: out of memory (arena chunk of %zu bytes)\n", size);
+            std::abort();
+        }
+        c->next = a->chunks;
+        c->size = size;
+        a->chunks = c;
+        a->cur = tocin_chunk_payload(c);
+        a->end = a->cur + size;
+        {
+            std::lock_guard<std::mutex> lock(g_arenaChunksMu);
+            g_arenaChunkRanges[a->cur] = a->end;
+        }
+        g_arenaChunks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void *tocin_arena_alloc(TocinArena *a, size_t size)
     {
-        char *p = (char *)__tocin_alloc_atomic(1);
-        if (p) p[0] = '\0';
+        size = (size + 15) & ~size_t(15); // malloc alignment
+        if (size == 0) size = 16;
+        if ((size_t)(a->end - a->cur) < size)
+            tocin_arena_grow(a, size);
+        void *p = a->cur;
+        a->cur += size;
         return p;
     }
-    int64_t __tocin_str_len(const char *s) { return s ? (int64_t)std::strlen(s) : 0; }
-    // Materialize n raw bytes as a NUL-terminated string (the back half of the
-    // string-builder pattern: build bytes in a buffer, convert once).
-    char *__tocin_buf_to_str(const char *p, int64_t n)
+
+    // Keep only the newest (largest) chunk: a reused arena usually needs no
+    // allocation at all, and the common single-chunk case is O(1).
+    void tocin_arena_reset(TocinArena *a)
     {
-        if (!p || n < 0) n = 0;
-        char *out = (char *)__tocin_alloc_atomic((size_t)n + 1);
+        if (!a->chunks) return;
+        TocinArena::Chunk *keep = a->chunks;
+        for (TocinArena::Chunk *c = keep->next; c;)
+        {
+            TocinArena::Chunk *next = c->next;
+            tocin_arena_release_chunk(c);
+            c = next;
+        }
+        keep->next = nullptr;
+        a->cur = tocin_chunk_payload(keep);
+        a->end = a->cur + keep->size;
+    }
+
+    void tocin_arena_destroy(TocinArena *a)
+    {
+        for (TocinArena::Chunk *c = a->chunks; c;)
+        {
+            TocinArena::Chunk *next = c->next;
+            tocin_arena_release_chunk(c);
+            c = next;
+        }
+        delete a;
+    }
+
+    // Bytes available from @p p to the end of its arena chunk, or 0 when p is
+    // not arena memory.
+    size_t tocin_arena_extent(const void *p)
+    {
+        if (!p || g_arenaChunks.load(std::memory_order_relaxed) == 0) return 0;
+        const char *cp = static_cast<const char *>(p);
+        std::lock_guard<std::mutex> lock(g_arenaChunksMu);
+        auto it = g_arenaChunkRanges.upper_bound(cp);
+        if (it == g_arenaChunkRanges.begin()) return 0;
+        --it;
+        return cp < it->second ? (size_t)(it->second - cp) : 0;
+    }
+
+    // Resetting or freeing an arena that is still the target of an active
+    // scope would leave the scope allocating into freed memory.
+    void tocin_arena_check_inactive(TocinArena *a, const char *op)
+    {
+        for (const ArenaScope &s : tocin_arena_scopes())
+            if (s.arena == a)
+            {
+                std::fprintf(stderr, "Tocin: %s of an arena inside its own withArena block\n", op);
+                std::abort();
+            }
+    }
+}
+
+#ifndef TOCIN_HAVE_GC
+// ---------------------------------------------------------------------------
+// Size-class pools (non-GC build).
+//
+// Without the collector, ADT boxes, trait objects, closures, tuples and
+// Option/Result records would each be a malloc/free pair on the global heap.
+// Requests up to 256 bytes are instead served from 16 size classes (16-byte
+// steps). Each thread keeps a free list per class; an empty list refills in
+// a batch from the class's central list (or a new 64 KB slab), and a list
+// that grows past kPoolCacheMax hands a batch back, so blocks freed on
+// another thread (a migrated goroutine) circulate. On a NUMA machine there is
+// a central list set per node (of the calling worker, see numa_topology.h),
+// so a refill hands back memory first touched on the same node. Slabs are
+// never returned to the system. Every block carries a 16-byte header naming its class;
+// larger requests get the same header over a plain malloc, so __tocin_free
+// and __tocin_realloc can tell the two apart. (Consequently a __tocin_alloc
+// buffer must not be handed to libc free(), under the GC or not.)
+// ---------------------------------------------------------------------------
+namespace
+{
+    constexpr uint32_t kPoolClasses = 16;
+    constexpr size_t kPoolMaxSize = kPoolClasses * 16;
+    constexpr uint32_t kPoolLarge = kPoolClasses; // class of a plain malloc block
+    constexpr uint32_t kPoolMagic = 0x70c1b10cu;
+    constexpr size_t kPoolSlab = 64 * 1024;
+    constexpr uint32_t kPoolBatch = 32;
+    constexpr uint32_t kPoolCacheMax = 4 * kPoolBatch;
+    constexpr size_t kPoolNodes = 8; // central list sets; higher nodes share by id
+
+    struct PoolHeader
+    {
+        uint32_t sizeClass;
+        uint32_t magic;
+        union
+        {
+            size_t size;      // kPoolLarge: bytes requested
+            PoolHeader *next; // a free pool block: next on its list
+        };
+    };
+    static_assert(sizeof(PoolHeader) == 16, "pool header must keep 16-byte alignment");
+
+    size_t tocin_pool_class_bytes(uint32_t c) { return (size_t)(c + 1) * 16; }
+
+    struct PoolCentral
+    {
+        std::mutex mu;
+        PoolHeader *lists[kPoolClasses] = {};
+    };
+
+    // Never destroyed: threads flush their caches into it on exit, which can
+    // happen during static destruction. Threads off any NUMA node use node 0's.
+    PoolCentral &tocin_pool_central()
+    {
+        static PoolCentral *central = new PoolCentral[kPoolNodes]();
+        int node = tocin::runtime::currentNumaNode();
+        return central[node > 0 ? (size_t)node % kPoolNodes : 0];
+    }
+
+    // Move up to @p n blocks from @p list onto the central list for @p c.
+    void tocin_pool_give_back(uint32_t c, PoolHeader *&list, uint32_t &count, uint32_t n)
+    {
+        if (!list) return;
+        PoolHeader *first = list, *last = list;
+        uint32_t moved = 1;
+        while (moved < n && last->next) { last = last->next; ++moved; }
+        list = last->next;
+        count -= moved;
+        PoolCentral &central = tocin_pool_central();
+        std::lock_guard<std::mutex> lock(central.mu);
+        last->next = central.lists[c];
+        central.lists[c] = first;
+    }
+
+    // Trivially constructible and destructible, so the hot path reads it
+    // without a TLS init guard; PoolCacheFlush (touched on the first refill)
+    // hands the blocks back when the thread exits.
+    struct PoolCache
+    {
+        PoolHeader *lists[kPoolClasses];
+        uint32_t counts[kPoolClasses];
+
+        void refill(uint32_t c);
+    };
+
+    thread_local PoolCache t_poolCache;
+
+    struct PoolCacheFlush
+    {
+        ~PoolCacheFlush()
+        {
+            for (uint32_t c = 0; c < kPoolClasses; ++c)
+                tocin_pool_give_back(c, t_poolCache.lists[c], t_poolCache.counts[c], UINT32_MAX);
+        }
+    };
+
+    thread_local PoolCacheFlush t_poolCacheFlush;
+
+    void PoolCache::refill(uint32_t c)
+    {
+        (void)&t_poolCacheFlush; // registers the exit flush
+        {
+            PoolCentral &central = tocin_pool_central();
+            std::lock_guard<std::mutex> lock(central.mu);
+            for (uint32_t i = 0; i < kPoolBatch && central.lists[c]; ++i)
+            {
+                PoolHeader *h = central.lists[c];
+                central.lists[c] = h->next;
+                h->next = lists[c];
+                lists[c] = h;
+                ++counts[c];
+            }
+        }
+        if (lists[c]) return;
+        const size_t stride = sizeof(PoolHeader) + tocin_pool_class_bytes(c);
+        char *slab = static_cast<char *>(std::malloc(kPoolSlab));
+        if (!slab) return;
+        for (size_t off = 0; off + stride <= kPoolSlab; off += stride)
+        {
+            auto *h = reinterpret_cast<PoolHeader *>(slab + off);
+            h->sizeClass = c;
+            h->magic = kPoolMagic;
+            h->next = lists[c];
+            lists[c] = h;
+            ++counts[c];
+        }
+    }
+
+    void *tocin_pool_alloc(size_t size)
+    {
+        PoolHeader *h;
+        if (size <= kPoolMaxSize)
+        {
+            uint32_t c = size ? (uint32_t)((size - 1) / 16) : 0;
+            PoolCache &cache = t_poolCache;
+            if (!cache.lists[c])
+            {
+                cache.refill(c);
+                if (!cache.lists[c]) return nullptr;
+            }
+            h = cache.lists[c];
+            cache.lists[c] = h->next;
+            --cache.counts[c];
+        }
+        else
+        {
+            h = static_cast<PoolHeader *>(std::malloc(sizeof(PoolHeader) + size));
+            if (!h) return nullptr;
+            h->sizeClass = kPoolLarge;
+            h->magic = kPoolMagic;
+            h->size = size;
+        }
+        return h + 1;
+    }
+
+    // A pointer without our header came from somewhere else (an FFI
+    // library's malloc); release it the way __tocin_free always did.
+    PoolHeader *tocin_pool_header(void *p)
+    {
+        PoolHeader *h = static_cast<PoolHeader *>(p) - 1;
+        return h->magic == kPoolMagic && h->sizeClass <= kPoolLarge ? h : nullptr;
+    }
+
+    void tocin_pool_free(void *p)
+    {
+        PoolHeader *h = tocin_pool_header(p);
+        if (!h)
+        {
+            std::free(p);
+            return;
+        }
+        if (h->sizeClass == kPoolLarge)
+        {
+            h->magic = 0;
+            std::free(h);
+            return;
+        }
+        uint32_t c = h->sizeClass;
+        PoolCache &cache = t_poolCache;
+        h->next = cache.lists[c];
+        cache.lists[c] = h;
+        if (++cache.counts[c] > kPoolCacheMax)
+            tocin_pool_give_back(c, cache.lists[c], cache.counts[c], kPoolBatch);
+    }
+
+    void *tocin_pool_realloc(void *p, size_t size)
+    {
+        if (!p) return tocin_pool_alloc(size);
+        PoolHeader *h = tocin_pool_header(p);
+        if (!h) return std::realloc(p, size);
+        size_t have = h->sizeClass == kPoolLarge ? h->size : tocin_pool_class_bytes(h->sizeClass);
+        if (h->sizeClass != kPoolLarge && size <= have) return p;
+        void *out = tocin_pool_alloc(size);
         if (!out) return nullptr;
-        std::memcpy(out, p, (size_t)n);
-        out[n] = '\0';
+        std::memcpy(out, p, std::min(have, size));
+        tocin_pool_free(p);
+        return out;
+    }
+}
+#endif
+
+namespace
+{
+    using tocin::runtime::AllocKind;
+    using tocin::runtime::AllocationProfiler;
+
+    void *tocin_heap_alloc(int64_t size)
+    {
+        if (size < 0) size = 0;
+#ifdef TOCIN_HAVE_GC
+        tocin_gc_ensure_init();
+        return GC_malloc((size_t)size);
+#else
+        // Zeroed like GC_malloc: recycled pool blocks hold old data.
+        void *p = tocin_pool_alloc((size_t)size);
+        if (p) std::memset(p, 0, (size_t)size);
+        return p;
+#endif
+    }
+
+    // Inside a withArena block it is a bump allocation from the arena, which
+    // the allocation profiler does not see. *fromArena says which.
+    void *tocin_heap_alloc_atomic(int64_t size, bool *fromArena)
+    {
+        if (size < 0) size = 0;
+        std::vector<ArenaScope> &scopes = tocin_arena_scopes();
+        *fromArena = !scopes.empty();
+        if (*fromArena)
+            return tocin_arena_alloc(scopes.back().arena, (size_t)size);
+#ifdef TOCIN_HAVE_GC
+        tocin_gc_ensure_init();
+        return GC_malloc_atomic((size_t)size);
+#else
+        return tocin_pool_alloc((size_t)size);
+#endif
+    }
+
+    // Pointer-free memory that is never an arena's: it may outlive any
+    // withArena scope. Zeroed like everything else from the heap.
+    void *tocin_heap_alloc_pointer_free(int64_t size)
+    {
+        if (size < 0) size = 0;
+#ifdef TOCIN_HAVE_GC
+        tocin_gc_ensure_init();
+        void *p = GC_malloc_atomic((size_t)size);
+        if (p) std::memset(p, 0, (size_t)size);
+        return p;
+#else
+        return tocin_heap_alloc(size);
+#endif
+    }
+
+    // allocCounting(1) turns on exact counts of heap allocations and their
+    // bytes (std.testing's bench reports them per iteration). Off, the cost
+    // is one relaxed load per allocation.
+    std::atomic<bool> g_allocCounting{false};
+    std::atomic<int64_t> g_allocCountObjects{0};
+    std::atomic<int64_t> g_allocCountBytes{0};
+
+    // An allocation profiler sample; `site` is the entry point's return
+    // address, the frame its call stack starts at.
+    inline void tocin_note_alloc(void *p, int64_t size, AllocKind kind, void *site)
+    {
+        if (g_allocCounting.load(std::memory_order_relaxed))
+        {
+            g_allocCountObjects.fetch_add(1, std::memory_order_relaxed);
+            g_allocCountBytes.fetch_add(size < 0 ? 0 : size, std::memory_order_relaxed);
+        }
+        if (AllocationProfiler::active())
+            AllocationProfiler::instance().noteAlloc(p, (size_t)(size < 0 ? 0 : size), kind, site);
+    }
+}
+
+extern "C"
+{
+    // Central allocator used by both the compiler-emitted code and the runtime.
+    void *__tocin_alloc(int64_t size)
+    {
+        void *p = tocin_heap_alloc(size);
+        tocin_note_alloc(p, size, AllocKind::Other, __builtin_return_address(0));
+        return p;
+    }
+    // __tocin_alloc for code that knows what the block is for: `kind` is a
+    // tocin::runtime::AllocKind, recorded by the allocation profiler.
+    void *__tocin_alloc_tagged(int64_t size, int32_t kind)
+    {
+        void *p = tocin_heap_alloc(size);
+        tocin_note_alloc(p, size, (AllocKind)kind, __builtin_return_address(0));
+        return p;
+    }
+    // Allocate a pointer-free buffer (strings, byte arrays). Same interface as
+    // __tocin_alloc but the GC skips scanning it - meaningfully faster for the
+    // high allocation rates of string-producing builtins.
+    // Inside a withArena block it is a bump allocation from the arena.
+    void *__tocin_alloc_atomic(int64_t size)
+    {
+        bool fromArena;
+        void *p = tocin_heap_alloc_atomic(size, &fromArena);
+        if (!fromArena) tocin_note_alloc(p, size, AllocKind::Other, __builtin_return_address(0));
+        return p;
+    }
+    void *__tocin_alloc_atomic_tagged(int64_t size, int32_t kind)
+    {
+        bool fromArena;
+        void *p = tocin_heap_alloc_atomic(size, &fromArena);
+        if (!fromArena) tocin_note_alloc(p, size, (AllocKind)kind, __builtin_return_address(0));
+        return p;
+    }
+    // Blocks the code generator knows the layout of. Pointer-free ones
+    // (float arrays, classes of floats and bools) are never scanned; a mixed
+    // one is scanned only where `layout` says it may hold a pointer. The
+    // layout is a compiler-emitted global, { descriptor (0 until first use),
+    // words described, bitmap words... }, bit i set for word i. Neither comes
+    // from a withArena scope, since the block may outlive it.
+    void *__tocin_alloc_pointer_free(int64_t size, int32_t kind)
+    {
+        void *p = tocin_heap_alloc_pointer_free(size);
+        tocin_note_alloc(p, size, (AllocKind)kind, __builtin_return_address(0));
+        return p;
+    }
+    void *__tocin_alloc_typed(int64_t size, int32_t kind, int64_t *layout)
+    {
+        if (size < 0) size = 0;
+#ifdef TOCIN_HAVE_GC
+        tocin_gc_ensure_init();
+        std::atomic_ref<int64_t> cached(layout[0]);
+        size_t descr = (size_t)cached.load(std::memory_order_acquire);
+        if (!descr)
+        {
+            // Racing threads make the same descriptor; either store will do.
+            descr = GC_make_descriptor(reinterpret_cast<const size_t *>(layout + 2), (size_t)layout[1]);
+            cached.store((int64_t)descr, std::memory_order_release);
+        }
+        void *p = GC_malloc_explicitly_typed((size_t)size, descr);
+#else
+        (void)layout;
+        void *p = tocin_heap_alloc(size);
+#endif
+        tocin_note_alloc(p, size, (AllocKind)kind, __builtin_return_address(0));
+        return p;
+    }
+    // Resize a buffer obtained from __tocin_alloc. An arena buffer is copied
+    // out to the heap (its own size is not recorded, so copy what may be it).
+    void *__tocin_realloc(void *p, int64_t size)
+    {
+        if (size < 0) size = 0;
+        if (size_t extent = tocin_arena_extent(p))
+        {
+            void *out = tocin_heap_alloc(size);
+            std::memcpy(out, p, std::min(extent, (size_t)size));
+            tocin_note_alloc(out, size, AllocKind::Other, __builtin_return_address(0));
+            return out;
+        }
+        // A sampled block keeps its kind when it moves.
+        AllocKind kind = AllocationProfiler::active() ? AllocationProfiler::instance().noteFree(p)
+                                                      : AllocKind::Other;
+#ifdef TOCIN_HAVE_GC
+        tocin_gc_ensure_init();
+        void *out = GC_realloc(p, (size_t)size);
+#else
+        void *out = tocin_pool_realloc(p, (size_t)size);
+#endif
+        tocin_note_alloc(out, size, kind, __builtin_return_address(0));
         return out;
     }
-    int64_t __tocin_str_char_at(const char *s, int64_t i)
+
+    // Explicit deallocation for programs that want to manage memory. Safe to
+    // call under GC (hint to the collector); a no-op-equivalent if already
+    // unreachable. Only free a buffer you own and never use it again.
+    void __tocin_free(void *p)
+    {
+        if (!p || tocin_arena_extent(p)) return; // arena memory goes with its arena
+        AllocationProfiler::instance().noteFree(p);
+#ifdef TOCIN_HAVE_GC
+        GC_free(p);
+#else
+        tocin_pool_free(p);
+#endif
+    }
+
+    // Keep p alive while code the collector cannot see (a Python memoryview,
+    // say) points into it: under GC the pin is a scanned, uncollectable cell
+    // holding p. Pass the result to __tocin_gc_unpin when done. Arena memory
+    // cannot be pinned; it goes with its arena regardless.
+    void *__tocin_gc_pin(void *p)
+    {
+#ifdef TOCIN_HAVE_GC
+        tocin_gc_ensure_init();
+        void **cell = static_cast<void **>(GC_malloc_uncollectable(sizeof(void *)));
+        if (!cell) std::abort();
+        *cell = p;
+        return cell;
+#else
+        return p;
+#endif
+    }
+    void __tocin_gc_unpin(void *pin)
     {
-        if (!s) return -1;
-        int64_t n = (int64_t)std::strlen(s);
-        if (i < 0 || i >= n) return -1;
-        return (int64_t)(unsigned char)s[i];
+#ifdef TOCIN_HAVE_GC
+        GC_free(pin);
+#else
+        (void)pin;
+#endif
     }
-    char *__tocin_str_substring(const char *s, int64_t start, int64_t len)
+
+    // gcConfigure(option, value): retune the collector at run time, as the
+    // TOCIN_GC_* variables do at startup. 1 if applied; 0 for an unknown
+    // option, a value the collector cannot take now (markers once it has
+    // started, turning incremental mode back off) or a build without GC.
+    //   "markers"            marker threads; only before the first allocation
+    //   "incremental"        1: incremental, generational collection
+    //   "pauseMs"            longest incremental step, in ms
+    //   "maxHeap"            heap limit in bytes (0: none)
+    //   "expandHeap"         grow the heap by this many bytes now
+    //   "freeSpaceDivisor"   higher collects more often in a smaller heap
+    int64_t __tocin_gc_configure(const char *option, int64_t value)
+    {
+#ifdef TOCIN_HAVE_GC
+        if (!option || value < 0) return 0;
+        const std::string_view name(option);
+        if (name == "markers")
+        {
+            if (g_gcStarted.load(std::memory_order_acquire) || value == 0) return 0;
+            g_gcMarkers.store((size_t)value, std::memory_order_relaxed);
+            return 1;
+        }
+        tocin_gc_ensure_init();
+        if (name == "incremental")
+        {
+            if (value) GC_enable_incremental();
+            return (GC_is_incremental_mode() != 0) == (value != 0) ? 1 : 0;
+        }
+        if (name == "pauseMs")
+        {
+            if (value == 0) return 0;
+            GC_set_time_limit((unsigned long)value);
+            return 1;
+        }
+        if (name == "maxHeap")
+        {
+            GC_set_max_heap_size((size_t)value);
+            return 1;
+        }
+        if (name == "expandHeap")
+        {
+            GC_expand_hp((size_t)value);
+            return 1;
+        }
+        if (name == "freeSpaceDivisor")
+        {
+            if (value == 0) return 0;
+            GC_set_free_space_divisor((size_t)value);
+            return 1;
+        }
+        return 0;
+#else
+        (void)option;
+        (void)value;
+        return 0;
+#endif
+    }
+
+    // Bracket a foreign call that may hold its thread for long (a Python
+    // call, or the wait for the GIL) so the scheduler brings up a spare
+    // worker meanwhile. No-ops off a goroutine.
+    void __tocin_blocking_enter() { LightweightScheduler::enterBlocking(); }
+    void __tocin_blocking_exit() { LightweightScheduler::exitBlocking(); }
+}
+
+// ---------------------------------------------------------------------------
+// String layout.
+//
+// A Tocin string is a pointer to NUL-terminated bytes, so it can be handed to
+// C as a char*, preceded by a 16-byte header:
+//
+//     [i64 len][i64 cap][len bytes][NUL]
+//
+// len is the byte count, so length, equality and concatenation never rescan.
+// cap is how many bytes fit before the NUL without reallocating, which lets
+// __tocin_str_append grow a string in place; compiled literals carry cap -1
+// ("static": never written or freed), and interned copies cap -2 (see
+// "String interning"). Under the GC the string pointer is an
+// interior pointer of its block, which the collector recognises (interior
+// pointers are on by default). A char* from C must be adopted with
+// __tocin_str_from_c before the runtime sees it as a string.
+// ---------------------------------------------------------------------------
+// TocinStrHeader, tocin_str_header and tocin_str_length are in
+// runtime_layout.h, shared with inline_abi.cpp.
+namespace
+{
+    // A string of @p len bytes (contents left to the caller, terminator
+    // written) with room for @p cap >= len. Inside a withArena block it is
+    // arena memory, like every other pointer-free allocation.
+    char *tocin_str_alloc(size_t len, size_t cap)
+    {
+        auto *h = static_cast<TocinStrHeader *>(__tocin_alloc_atomic_tagged(
+            (int64_t)(sizeof(TocinStrHeader) + cap + 1), (int32_t)tocin::runtime::AllocKind::String));
+        if (!h) return nullptr;
+        h->len = (int64_t)len;
+        h->cap = (int64_t)cap;
+        char *s = reinterpret_cast<char *>(h + 1);
+        s[len] = '\0';
+        return s;
+    }
+
+    // Copy n raw bytes into a fresh exact-size string.
+    char *tocin_str_new(const char *p, size_t n)
+    {
+        char *s = tocin_str_alloc(n, n);
+        if (s && n) std::memcpy(s, p, n);
+        return s;
+    }
+
+    char *tocin_str_empty() { return tocin_str_new("", 0); }
+
+    // Capacity for a growing buffer that must hold @p need bytes and
+    // currently is @p s (nullptr for none): at least double the old one, so
+    // a run of appends is amortized O(total length).
+    size_t tocin_str_grown_cap(const char *s, size_t need)
+    {
+        size_t cap = std::max<size_t>(need, 32);
+        if (s) cap = std::max(cap, 2 * (size_t)tocin_str_header(s)->cap);
+        return cap;
+    }
+
+    // Write the decimal digits of n so that they end at @p end; returns the
+    // first byte. 20 bytes always suffice.
+    char *tocin_format_int(char *end, int64_t n)
+    {
+        char *p = end;
+        uint64_t mag = (n < 0) ? (uint64_t)0 - (uint64_t)n : (uint64_t)n; // handles INT64_MIN
+        do {
+            *--p = (char)('0' + (int)(mag % 10));
+            mag /= 10;
+        } while (mag != 0);
+        if (n < 0) *--p = '-';
+        return p;
+    }
+}
+
+extern "C"
+{
+    // arenaNew(): an empty arena; its first chunk is taken on first use.
+    void *__tocin_arena_new()
+    {
+        return new TocinArena();
+    }
+
+    // arenaFree(a): release the arena and everything allocated from it.
+    void __tocin_arena_free(void *a)
+    {
+        if (!a) return;
+        tocin_arena_check_inactive(static_cast<TocinArena *>(a), "arenaFree");
+        tocin_arena_destroy(static_cast<TocinArena *>(a));
+    }
+
+    // arenaReset(a): invalidate everything allocated from the arena and make
+    // its memory available again.
+    void __tocin_arena_reset(void *a)
+    {
+        if (!a) return;
+        tocin_arena_check_inactive(static_cast<TocinArena *>(a), "arenaReset");
+        tocin_arena_reset(static_cast<TocinArena *>(a));
+    }
+
+    // arenaUsed(a): bytes handed out since creation or the last reset.
+    int64_t __tocin_arena_used(void *a)
+    {
+        auto *arena = static_cast<TocinArena *>(a);
+        if (!arena || !arena->chunks) return 0;
+        int64_t used = arena->cur - tocin_chunk_payload(arena->chunks);
+        for (TocinArena::Chunk *c = arena->chunks->next; c; c = c->next)
+            used += (int64_t)c->size;
+        return used;
+    }
+
+    // Open a withArena scope on @p a, or on a scope-owned arena when a is
+    // null (`withArena { }`), released when the scope exits.
+    void __tocin_arena_enter(void *a)
+    {
+        ArenaScope scope{static_cast<TocinArena *>(a), false};
+        if (!scope.arena)
+        {
+            {
+                std::lock_guard<std::mutex> lock(g_arenaPoolMu);
+                if (!g_arenaPool.empty())
+                {
+                    scope.arena = g_arenaPool.back();
+                    g_arenaPool.pop_back();
+                }
+            }
+            if (!scope.arena) scope.arena = new TocinArena();
+            scope.owned = true;
+        }
+        tocin_arena_scopes().push_back(scope);
+    }
+
+    // Close the innermost withArena scope (emitted in the block's finally).
+    void __tocin_arena_exit()
+    {
+        std::vector<ArenaScope> &scopes = tocin_arena_scopes();
+        if (scopes.empty()) return;
+        ArenaScope scope = scopes.back();
+        scopes.pop_back();
+        if (!scope.owned) return;
+        tocin_arena_reset(scope.arena);
+        {
+            std::lock_guard<std::mutex> lock(g_arenaPoolMu);
+            if (g_arenaPool.size() < kArenaPoolMax)
+            {
+                g_arenaPool.push_back(scope.arena);
+                return;
+            }
+        }
+        tocin_arena_destroy(scope.arena);
+    }
+}
+
+extern "C"
+{
+    // Allocate a new channel and return an opaque handle.
+    void *__tocin_chan_new()
+    {
+        return new Channel();
+    }
+
+    // Allocate a buffered channel holding at most `cap` values; a send to a
+    // full channel blocks (parks, on a goroutine) until a receive makes room.
+    // cap == 0 is a rendezvous channel: each send waits for its receive.
+    // A negative cap gives an unbounded channel, as __tocin_chan_new.
+    void *__tocin_chan_new_cap(int64_t cap)
+    {
+        auto *ch = new Channel();
+        if (cap >= 0)
+        {
+            ch->rendezvous = (cap == 0);
+            ch->ring.reset(new BoundedRing(cap == 0 ? 1 : (size_t)cap));
+        }
+        return ch;
+    }
+
+    // Send a 64-bit value into the channel and wake a waiting receiver.
+    void __tocin_chan_send(void *handle, int64_t value)
+    {
+        if (!handle)
+            return;
+        auto *ch = static_cast<Channel *>(handle);
+        if (ch->ring)
+        {
+            tocin_bounded_send(ch, value);
+            return;
+        }
+        std::shared_ptr<Fiber> waiter;
+        {
+            std::lock_guard<std::mutex> lock(ch->m);
+            ch->q.push_back(value);
+            if (!ch->parked.empty())
+            {
+                waiter = std::move(ch->parked.front());
+                ch->parked.pop_front();
+            }
+            for (SelectWaiter *w : ch->selectors)
+                tocin_select_fire(w);
+        }
+        // A parked receiver is off its stack once it is in `parked`, and
+        // removing it under the lock makes this the only waker.
+        if (waiter)
+            LightweightScheduler::instance().unpark(std::move(waiter));
+        else
+            ch->cv.notify_one();
+    }
+
+    // Receive a 64-bit value, blocking until one is available.
+    int64_t __tocin_chan_recv(void *handle)
+    {
+        if (!handle)
+            return 0;
+        auto *ch = static_cast<Channel *>(handle);
+        if (ch->ring)
+            return tocin_bounded_recv(ch);
+        std::unique_lock<std::mutex> lock(ch->m);
+        while (ch->q.empty())
+            tocin_chan_wait(ch, lock);
+        int64_t value = ch->q.front();
+        ch->q.pop_front();
+        return value;
+    }
+
+    // Non-blocking receive: if a value is available, dequeue it into *out and
+    // return 1; otherwise return 0 without blocking. Used to implement `select`.
+    int8_t __tocin_chan_try_recv(void *handle, int64_t *out)
+    {
+        if (!handle || !out)
+            return 0;
+        auto *ch = static_cast<Channel *>(handle);
+        if (ch->ring)
+        {
+            if (!ch->ring->pop(out))
+                return 0;
+            tocin_bounded_received(ch);
+            return 1;
+        }
+        std::lock_guard<std::mutex> lock(ch->m);
+        if (ch->q.empty())
+            return 0;
+        *out = ch->q.front();
+        ch->q.pop_front();
+        return 1;
+    }
+
+    // Batched send: enqueue all elements of a Tocin array ([i64 len][elems])
+    // with one lock acquisition (unbounded) or lock-free pushes (bounded),
+    // waking receivers once per batch instead of once per element. Returns
+    // the number of values sent.
+    int64_t __tocin_chan_send_many(void *handle, const int64_t *arr)
+    {
+        if (!handle || !arr || arr[0] <= 0)
+            return 0;
+        auto *ch = static_cast<Channel *>(handle);
+        size_t n = (size_t)arr[0];
+        const int64_t *vals = arr + 1;
+        if (ch->ring)
+        {
+            tocin_bounded_send_many(ch, vals, n);
+            return (int64_t)n;
+        }
+        std::lock_guard<std::mutex> lock(ch->m);
+        ch->q.insert(ch->q.end(), vals, vals + n);
+        tocin_chan_wake_receivers_locked(ch, n);
+        return (int64_t)n;
+    }
+
+    // Batched receive into a Tocin array: block until at least one value is
+    // available, then move up to min(max, len(arr)) values with one lock
+    // acquisition. Returns the number received (stored from index 0).
+    int64_t __tocin_chan_recv_into(void *handle, int64_t *arr, int64_t max)
+    {
+        if (!handle || !arr)
+            return 0;
+        if (max > arr[0])
+            max = arr[0];
+        if (max <= 0)
+            return 0;
+        auto *ch = static_cast<Channel *>(handle);
+        int64_t *out = arr + 1;
+        if (ch->ring)
+            return (int64_t)tocin_bounded_recv_many(ch, out, (size_t)max);
+        std::unique_lock<std::mutex> lock(ch->m);
+        while (ch->q.empty())
+            tocin_chan_wait(ch, lock);
+        size_t got = std::min((size_t)max, ch->q.size());
+        std::copy(ch->q.begin(), ch->q.begin() + got, out);
+        ch->q.erase(ch->q.begin(), ch->q.begin() + got);
+        return (int64_t)got;
+    }
+
+    // Multi-channel receive for `select`. Tries chans[0..n) in order and, for
+    // the first with a value, stores it in *out and returns the index. When
+    // none is ready: returns -1 if `block` is 0 (the `default` case),
+    // otherwise waits - parking the goroutine, not its worker - until a send
+    // to any of them, and retries. Null handles never become ready.
+    int64_t __tocin_chan_select(void **chans, int64_t n, int64_t *out, int8_t block)
+    {
+        int64_t scratch = 0;
+        if (!out)
+            out = &scratch;
+        for (;;)
+        {
+            for (int64_t i = 0; i < n; ++i)
+                if (__tocin_chan_try_recv(chans[i], out))
+                    return i;
+            if (!block)
+                return -1;
+
+            // Register on every channel, re-checking each queue under its lock
+            // so a send that raced the scan above is not missed.
+            tocin::runtime::noteChannelWait(tocin::runtime::ChannelWait::Select);
+            SelectWaiter w;
+            for (int64_t i = 0; i < n; ++i)
+            {
+                auto *ch = static_cast<Channel *>(chans[i]);
+                if (!ch)
+                    continue;
+                std::lock_guard<std::mutex> lock(ch->m);
+                ch->selectors.push_back(&w);
+                ch->recvWaiters.fetch_add(1, std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (tocin_chan_ready(ch))
+                    tocin_select_fire(&w);
+            }
+            {
+                std::unique_lock<std::mutex> lock(w.m);
+                while (!w.fired)
+                {
+                    if (Fiber *self = Fiber::current())
+                    {
+                        w.fiber = self->shared_from_this();
+                        LightweightScheduler::park(lock);
+                    }
+                    else
+                    {
+                        w.cv.wait(lock);
+                    }
+                }
+            }
+            for (int64_t i = 0; i < n; ++i)
+            {
+                auto *ch = static_cast<Channel *>(chans[i]);
+                if (!ch)
+                    continue;
+                std::lock_guard<std::mutex> lock(ch->m);
+                auto &sel = ch->selectors;
+                sel.erase(std::remove(sel.begin(), sel.end(), &w), sel.end());
+                ch->recvWaiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Briefly sleep to avoid a hot busy-wait in a blocking poll loop (kept for
+    // IR compiled before `select` lowered to __tocin_chan_select).
+    // On a goroutine only the fiber sleeps; its worker runs other goroutines.
+    void __tocin_chan_park()
+    {
+        LightweightScheduler::sleepFor(std::chrono::milliseconds(1));
+    }
+
+    // Spawn a goroutine: run fn(arg) as a fiber on the M:N scheduler.
+    void __tocin_go(void (*fn)(void *), void *arg)
+    {
+        if (!fn)
+            return;
+        Goroutine *g = tocin_goroutine_new(fn, arg);
+        tocin_rng_fork(g);
+        tocin_sched().go([g] {
+            Fiber::current()->setLocal(g);
+            try
+            {
+                g->fn(g->arg);
+            }
+            catch (...)
+            {
+                // The fiber would swallow a Tocin exception nothing in the
+                // goroutine caught; report it like one thrown on a thread.
+                if (g->exc.unwinding)
+                    tocin_uncaught(g->exc.value);
+                throw;
+            }
+            tocin_goroutine_free(g);
+        });
+    }
+
+}
+
+namespace
+{
+    inline void tocin_cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    void tocin_executor_task(void *p)
+    {
+        std::unique_ptr<std::function<void()>> task(static_cast<std::function<void()> *>(p));
+        (*task)();
+    }
+}
+
+namespace tocin
+{
+namespace runtime
+{
+    size_t executorThreads()
+    {
+        static const size_t n = tocin_env_size("TOCIN_MAX_PROCS", tocin_available_cpus());
+        return n;
+    }
+
+    LightweightScheduler &executor() { return tocin_sched(); }
+
+    // A goroutine like any other (own exception state, waited for at exit).
+    void executorSubmit(std::function<void()> task)
+    {
+        if (task)
+            __tocin_go(tocin_executor_task, new std::function<void()>(std::move(task)));
+    }
+
+    uint64_t executorAfter(std::chrono::steady_clock::duration d, std::function<void()> fn)
+    {
+        return tocin_sched().after(d, std::move(fn));
+    }
+
+    bool executorCancelTimer(uint64_t id) { return tocin_sched().cancelTimer(id); }
+
+    void ExecutorWaiter::wait()
+    {
+        for (int i = 0; i < kSpins; ++i)
+        {
+            if (fired())
+                return;
+            tocin_cpu_relax();
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!fired())
+        {
+            if (Fiber *self = Fiber::current())
+            {
+                fiber_ = self->shared_from_this();
+                LightweightScheduler::park(lock);
+            }
+            else
+            {
+                cv_.wait(lock);
+            }
+        }
+    }
+
+    bool ExecutorWaiter::fire()
+    {
+        if (fired_.exchange(true, std::memory_order_acq_rel))
+            return false;
+        std::shared_ptr<Fiber> fiber;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            fiber = std::move(fiber_);
+            // Notified under the lock: a thread that returns from wait()
+            // may destroy the waiter as soon as it is released.
+            if (!fiber)
+                cv_.notify_one();
+        }
+        if (fiber)
+            LightweightScheduler::instance().unpark(std::move(fiber));
+        return true;
+    }
+
+    ExecutorBlockingScope::ExecutorBlockingScope() { LightweightScheduler::enterBlocking(); }
+    ExecutorBlockingScope::~ExecutorBlockingScope() { LightweightScheduler::exitBlocking(); }
+} // namespace runtime
+} // namespace tocin
+
+extern "C"
+{
+    // Wait for all spawned goroutines to finish. When exit() is called from
+    // inside a goroutine there is nothing to wait for that could ever finish
+    // first (the caller is one of them), so return immediately.
+    void __tocin_join_all()
+    {
+        if (!g_schedStarted.load() || Fiber::current())
+            return;
+        tocin_sched().waitAll();
+        std::fflush(stdout); // what the goroutines printed after main returned
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Exception handling.
+//
+// Hosted code uses table-driven unwinding: a `try` body's calls are LLVM
+// invokes whose unwind edge leads to a landingpad (personality
+// __gxx_personality_v0, a catch-all clause), so entering and leaving a try
+// costs nothing. `throw` raises a TocinException - a foreign exception to
+// the C++ runtime, carrying the 64-bit value - through the Itanium unwinder,
+// and the landing pad takes the value back with __tocin_exc_catch.
+//
+// --freestanding code has no unwinder and keeps the setjmp/longjmp scheme:
+// each `try` allocates a jmp_buf in its own frame, calls setjmp, and
+// registers the buffer with __tocin_try_register; `throw` longjmps back to
+// the most recently registered handler. Each goroutine has its own handler
+// stack (it may resume on another worker thread after parking); code
+// running on a plain thread uses a thread-local one.
+// ---------------------------------------------------------------------------
+namespace
+{
+    thread_local ExcState g_threadExc;
+
+    constexpr _Unwind_Exception_Class kTocinExceptionClass = 0x544F43494E000000ull; // "TOCIN\0\0\0"
+
+    struct TocinException
+    {
+        _Unwind_Exception header;
+        int64_t value;
+    };
+
+    void tocin_delete_exception(_Unwind_Reason_Code, _Unwind_Exception *exc)
+    {
+        delete reinterpret_cast<TocinException *>(exc);
+    }
+
+    ExcState &tocin_exc_state()
+    {
+        if (Fiber *f = Fiber::current())
+            if (void *g = f->getLocal())
+                return static_cast<Goroutine *>(g)->exc;
+        return g_threadExc;
+    }
+}
+
+extern "C"
+{
+    // Register a setjmp buffer as the innermost active exception handler.
+    void __tocin_try_register(void *buf)
+    {
+        tocin_exc_state().handlers.push_back(buf);
+    }
+
+    // Remove the innermost handler (try body completed without throwing).
+    void __tocin_try_pop()
+    {
+        ExcState &st = tocin_exc_state();
+        if (!st.handlers.empty())
+            st.handlers.pop_back();
+    }
+
+    // Return the value carried by the most recently thrown exception.
+    int64_t __tocin_exc_value()
+    {
+        return tocin_exc_state().value;
+    }
+
+    // Throw: record the value and unwind to the nearest landing pad, or, in
+    // freestanding code, longjmp to the nearest registered handler. With no
+    // handler of either kind the exception is fatal.
+    void __tocin_throw(int64_t value)
+    {
+        ExcState &st = tocin_exc_state();
+        st.value = value;
+        if (st.handlers.empty())
+        {
+            auto *exc = new TocinException{};
+            exc->header.exception_class = kTocinExceptionClass;
+            exc->header.exception_cleanup = tocin_delete_exception;
+            exc->value = value;
+            st.unwinding = true;
+            _Unwind_RaiseException(&exc->header); // returns only if nothing catches it
+            st.unwinding = false;
+            delete exc;
+            tocin_uncaught(value);
+        }
+        std::jmp_buf *buf = static_cast<std::jmp_buf *>(st.handlers.back());
+        st.handlers.pop_back();
+        std::longjmp(*buf, 1);
+    }
+
+    // A landing pad caught @p exc: free it and return its value. Anything
+    // else the catch-all clause picked up (a C++ exception crossing Tocin
+    // frames) keeps unwinding.
+    int64_t __tocin_exc_catch(void *exc)
+    {
+        auto *header = static_cast<_Unwind_Exception *>(exc);
+        if (header->exception_class != kTocinExceptionClass)
+            _Unwind_Resume_or_Rethrow(header);
+        ExcState &st = tocin_exc_state();
+        st.value = reinterpret_cast<TocinException *>(header)->value;
+        st.unwinding = false;
+        _Unwind_DeleteException(header);
+        return st.value;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Futures: async tasks.
+//
+// `let x = f(args)` with f an `async def` starts f(args) as a goroutine and
+// binds x to its future; the first read of x awaits it (see
+// IRGenerator::spawnAsyncCall). Results use the 64-bit slot convention of
+// channels. Awaiting a pending future parks a goroutine's fiber, so its
+// worker runs other tasks meanwhile, and blocks a plain thread on a condvar.
+// An exception the task does not catch is rethrown by every await.
+//
+// A future is reference counted: one reference for the task, which drops
+// it on completion, and one for the handle __tocin_async returns.
+// ---------------------------------------------------------------------------
+extern "C" void __tocin_future_release(void *f);
+
+namespace
+{
+    struct Future
+    {
+        enum State : int { Pending, Resolved, Failed };
+
+        std::atomic<int> state{Pending};
+        int64_t value = 0;               // result, or the exception's value
+        std::atomic<int> refs{1};
+        std::mutex m;
+        std::condition_variable cv;      // awaiters on plain threads
+        std::vector<std::shared_ptr<Fiber>> waiters;
+        int64_t (*fn)(void *) = nullptr; // the task, for __tocin_async
+        void *arg = nullptr;
+    };
+
+    // GC-scanned (but never collected) like goroutine descriptors, so a
+    // pointer result and the task's argument pack stay reachable.
+    Future *tocin_future_alloc()
+    {
+#ifdef TOCIN_HAVE_GC
+        tocin_gc_ensure_init();
+        void *mem = GC_malloc_uncollectable(sizeof(Future));
+        if (!mem) std::abort();
+        return new (mem) Future();
+#else
+        return new Future();
+#endif
+    }
+
+    void tocin_future_settle(Future *f, int64_t value, Future::State state)
+    {
+        std::vector<std::shared_ptr<Fiber>> waiters;
+        {
+            std::lock_guard<std::mutex> lock(f->m);
+            if (f->state.load(std::memory_order_relaxed) != Future::Pending)
+                return;
+            f->value = value;
+            f->state.store(state, std::memory_order_release);
+            waiters.swap(f->waiters);
+            f->cv.notify_all();
+        }
+        for (auto &w : waiters)
+            LightweightScheduler::instance().unpark(std::move(w));
+    }
+
+    void tocin_async_run(void *p)
+    {
+        auto *f = static_cast<Future *>(p);
+        int64_t value;
+        try
+        {
+            value = f->fn(f->arg);
+        }
+        catch (...)
+        {
+            // Only a Tocin exception becomes the task's result.
+            ExcState &st = tocin_exc_state();
+            if (!st.unwinding)
+                throw;
+            st.unwinding = false;
+            tocin_future_settle(f, st.value, Future::Failed);
+            __tocin_future_release(f);
+            return;
+        }
+        tocin_future_settle(f, value, Future::Resolved);
+        __tocin_future_release(f);
+    }
+}
+
+extern "C"
+{
+    void *__tocin_future_new()
+    {
+        return tocin_future_alloc();
+    }
+
+    // Complete a future and wake its awaiters; later resolves are ignored.
+    void __tocin_future_resolve(void *f, int64_t value)
+    {
+        tocin_future_settle(static_cast<Future *>(f), value, Future::Resolved);
+    }
+
+    // The future's value, waiting until it has one.
+    int64_t __tocin_future_await(void *p)
+    {
+        auto *f = static_cast<Future *>(p);
+        int state = f->state.load(std::memory_order_acquire);
+        if (state == Future::Pending)
+        {
+            std::unique_lock<std::mutex> lock(f->m);
+            while ((state = f->state.load(std::memory_order_relaxed)) == Future::Pending)
+            {
+                if (Fiber *self = Fiber::current())
+                {
+                    f->waiters.push_back(self->shared_from_this());
+                    LightweightScheduler::park(lock);
+                }
+                else
+                {
+                    f->cv.wait(lock);
+                }
+            }
+        }
+        if (state == Future::Failed)
+            __tocin_throw(f->value);
+        return f->value;
+    }
+
+    void __tocin_future_release(void *p)
+    {
+        auto *f = static_cast<Future *>(p);
+        if (!f || f->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+#ifdef TOCIN_HAVE_GC
+        f->~Future();
+        GC_free(f);
+#else
+        delete f;
+#endif
+    }
+
+    // Run fn(arg) as a goroutine; returns the future of its result.
+    void *__tocin_async(int64_t (*fn)(void *), void *arg)
+    {
+        Future *f = tocin_future_alloc();
+        f->refs.store(2, std::memory_order_relaxed);
+        f->fn = fn;
+        f->arg = arg;
+        __tocin_go(tocin_async_run, f);
+        return f;
+    }
+}
+
+// ===========================================================================
+// Dynamic collections: growable vector and hashmap behind opaque handles.
+// Elements/keys/values are 64-bit slots (ints stored directly; pointers/
+// strings via ptrtoint round-trip on the codegen side). These leak unless
+// *Free is called.
+//
+// A vector is a TocinVec header over one flat buffer of unboxed elements of
+// its kind (i64, i8, i32, f32 or f64). The header layout is part of the ABI:
+// the IR generator reads data/len/cap directly for a vector whose kind it
+// knows, so element access compiles to a bounds check and a load. The
+// __tocin_vec_* calls take and return the 64-bit slot convention, converting
+// to and from the element kind (f32 is widened to a double's bits).
+//
+// A map is two flat open-addressing tables (flat_map.h), one per key kind.
+// A string key is hashed once per call (wyhash, hash.h, with a seed drawn at
+// startup, so a program's input cannot be chosen to collide) and compared
+// by length and bytes; it is copied only when first inserted, since the
+// caller's string may later be freed with its arena.
+//
+// TocinVec, TocinMap and their element access live in runtime_layout.h; the
+// hottest entry points (__tocin_vec_get / _set / _len, __tocin_map_get /
+// _has) are in inline_abi.cpp, which is also built to LLVM bitcode.
+// ===========================================================================
+namespace
+{
+    // Room for at least one more element.
+    void tocin_vec_grow(TocinVec *v)
+    {
+        const int64_t cap = v->cap ? v->cap * 2 : 8;
+        char *data = static_cast<char *>(std::realloc(v->data, (size_t)cap * tocin_vec_elem_size(v->kind)));
+        if (!data) std::abort();
+        v->data = data;
+        v->cap = cap;
+    }
+
+    // Per process; nothing iterates a map, so no order depends on it.
+    uint64_t tocin_map_seed()
+    {
+        static const uint64_t seed = [] {
+            uint64_t s = (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+            s ^= (uint64_t)(uintptr_t)&s;
+            try
+            {
+                std::random_device rd;
+                s ^= ((uint64_t)rd() << 32) | rd();
+            }
+            catch (...)
+            {
+            }
+            return s;
+        }();
+        return seed;
+    }
+
+    uint64_t tocin_str_key_hash(const char *k, size_t n)
+    {
+        return tocin::runtime::wyhash(k, n, tocin_map_seed());
+    }
+
+}
+
+// ---------------------------------------------------------------------------
+// String interning.
+//
+// intern(s) returns the canonical string with s's bytes. That is a literal
+// if one with those bytes was seen first: main() hands the module's
+// literals to __tocin_intern_literals, and intern() enters them on its next
+// call. Otherwise it is a copy that the table makes once and keeps for the
+// life of the process, with cap kStrInterned and its map hash in front of
+// the header.
+//
+// Equal strings intern to one pointer, so __tocin_str_eq settles them
+// without reading the bytes. Two interned copies that differ are told
+// apart the same way.
+//
+// String-keyed maps intern literal keys and keep interned keys as they
+// are. They share such a key instead of copying it, and hash an interned
+// key by reading its stored hash. Other keys are not interned: the table
+// never frees anything, so it must not grow with a program's input.
+// ---------------------------------------------------------------------------
+namespace
+{
+    struct InternSlot
+    {
+        const char *s;
+        size_t len;
+        uint64_t keyHash;
+        uint64_t hash() const { return keyHash; }
+    };
+
+    // Sharded on the top hash bits, so threads interning different strings
+    // rarely meet on a lock.
+    constexpr size_t kInternShards = 16;
+    struct InternShard
+    {
+        std::mutex m;
+        tocin::runtime::FlatTable<InternSlot> table;
+    };
+
+    InternShard *tocin_intern_shards()
+    {
+        static InternShard *shards = new InternShard[kInternShards]; // lives until exit
+        return shards;
+    }
+
+    // Literal tables registered by __tocin_intern_literals, not yet entered.
+    std::mutex g_internLitMu;
+    std::vector<std::pair<const char *const *, size_t>> g_internLits;
+    std::atomic<bool> g_internLitsPending{false};
+
+    bool tocin_str_is_interned(const char *s) { return s && tocin_str_header(s)->cap == kStrInterned; }
+
+    // The map hash of s[0, n): stored in front of an interned string.
+    uint64_t tocin_str_hash_of(const char *s, size_t n)
+    {
+        if (tocin_str_is_interned(s))
+            return reinterpret_cast<const uint64_t *>(tocin_str_header(s))[-1];
+        return tocin_str_key_hash(s, n);
+    }
+
+    // The canonical string for s[0, n) with map hash h. `adopt`, a literal
+    // with those bytes, becomes it if there is none yet; else a copy does.
+    const char *tocin_intern_bytes(const char *s, size_t n, uint64_t h, const char *adopt)
+    {
+        InternShard &shard = tocin_intern_shards()[h >> 60];
+        std::lock_guard<std::mutex> lock(shard.m);
+        auto r = shard.table.findOrInsert(h, [s, n](const InternSlot &e) {
+            return e.len == n && std::memcmp(e.s, s, n) == 0;
+        });
+        if (!r.second)
+            return r.first->s;
+        const char *canon = adopt;
+        if (!canon)
+        {
+            // [u64 hash][header][bytes][NUL]: 16 bytes ahead of the header
+            // keep it as aligned as malloc's block.
+            auto *block = static_cast<char *>(std::malloc(16 + sizeof(TocinStrHeader) + n + 1));
+            if (!block) std::abort();
+            reinterpret_cast<uint64_t *>(block)[1] = h;
+            auto *hdr = reinterpret_cast<TocinStrHeader *>(block + 16);
+            hdr->len = (int64_t)n;
+            hdr->cap = kStrInterned;
+            char *bytes = reinterpret_cast<char *>(hdr + 1);
+            if (n) std::memcpy(bytes, s, n);
+            bytes[n] = '\0';
+            canon = bytes;
+        }
+        *r.first = InternSlot{canon, n, h};
+        return canon;
+    }
+
+    void tocin_intern_drain()
+    {
+        if (!g_internLitsPending.load(std::memory_order_acquire))
+            return;
+        std::vector<std::pair<const char *const *, size_t>> tables;
+        {
+            std::lock_guard<std::mutex> lock(g_internLitMu);
+            tables.swap(g_internLits);
+            g_internLitsPending.store(false, std::memory_order_release);
+        }
+        for (const auto &t : tables)
+            for (size_t i = 0; i < t.second; ++i)
+            {
+                const char *lit = t.first[i];
+                size_t n = tocin_str_length(lit);
+                tocin_intern_bytes(lit, n, tocin_str_key_hash(lit, n), lit);
+            }
+    }
+
+    // intern(s) for a string whose map hash is already known.
+    char *tocin_intern_hashed(const char *s, size_t n, uint64_t h)
+    {
+        if (tocin_str_is_interned(s))
+            return const_cast<char *>(s);
+        tocin_intern_drain();
+        const char *adopt = tocin_str_header(s)->cap == -1 ? s : nullptr;
+        return const_cast<char *>(tocin_intern_bytes(s, n, h, adopt));
+    }
+
+    // Keys are equal when they are one pointer, and unequal when both are
+    // interned copies but not one pointer.
+    TocinStrSlot *tocin_map_find_str(TocinMap *m, const char *k)
+    {
+        const size_t n = tocin_str_length(k);
+        const bool interned = tocin_str_is_interned(k);
+        return m->strs.find(tocin_str_hash_of(k, n), [k, n, interned](const TocinStrSlot &s) {
+            if (s.key == k) return true;
+            if (s.len != n || (interned && tocin_str_is_interned(s.key))) return false;
+            return std::memcmp(s.key, k, n) == 0;
+        });
+    }
+}
+
+extern "C"
+{
+    char *__tocin_intern(const char *s)
+    {
+        if (!s)
+        {
+            tocin_intern_drain();
+            return const_cast<char *>(tocin_intern_bytes("", 0, tocin_str_key_hash("", 0), nullptr));
+        }
+        size_t n = tocin_str_length(s);
+        return tocin_intern_hashed(s, n, tocin_str_hash_of(s, n));
+    }
+
+    // The string literals of a program (main() passes them first thing);
+    // entered into the intern table on its next use, so they cost nothing
+    // in a program that never interns.
+    void __tocin_intern_literals(const char *const *literals, int64_t n)
+    {
+        if (!literals || n <= 0) return;
+        std::lock_guard<std::mutex> lock(g_internLitMu);
+        g_internLits.push_back({literals, (size_t)n});
+        g_internLitsPending.store(true, std::memory_order_release);
+    }
+}
+
+extern "C"
+{
+    // ---- vector: TocinVec of unboxed elements ----
+    void *__tocin_vec_new_of(int64_t kind)
+    {
+        if (kind < kVecI64 || kind > kVecF64) kind = kVecI64;
+        auto *v = static_cast<TocinVec *>(std::calloc(1, sizeof(TocinVec)));
+        if (!v) std::abort();
+        v->kind = kind;
+        return v;
+    }
+    void *__tocin_vec_new() { return __tocin_vec_new_of(kVecI64); }
+    void __tocin_vec_push(void *h, int64_t x)
+    {
+        if (!h) return;
+        auto *v = static_cast<TocinVec *>(h);
+        if (v->len == v->cap) tocin_vec_grow(v);
+        tocin_vec_store(v, v->len++, x);
+    }
+    int64_t __tocin_vec_pop(void *h)
+    {
+        if (!h) return 0;
+        auto *v = static_cast<TocinVec *>(h);
+        if (v->len == 0) return 0;
+        return tocin_vec_load(v, --v->len);
+    }
+    void __tocin_vec_free(void *h)
+    {
+        if (!h) return;
+        std::free(static_cast<TocinVec *>(h)->data);
+        std::free(h);
+    }
+
+    // ---- hashmap: int-keyed + string-keyed entries behind one handle ----
+    void *__tocin_map_new() { return new TocinMap(); }
+    void __tocin_map_put(void *h, int64_t k, int64_t v)
+    {
+        if (!h) return;
+        auto r = static_cast<TocinMap *>(h)->ints.findOrInsert(
+            (uint64_t)__tocin_hash_int(k), [k](const TocinIntSlot &s) { return s.key == k; });
+        r.first->key = k;
+        r.first->value = v;
+    }
+    void __tocin_map_put_str(void *h, const char *k, int64_t v)
+    {
+        if (!h || !k) return;
+        const size_t n = tocin_str_length(k);
+        const uint64_t kh = tocin_str_hash_of(k, n);
+        const bool interned = tocin_str_is_interned(k);
+        auto r = static_cast<TocinMap *>(h)->strs.findOrInsert(kh, [k, n, interned](const TocinStrSlot &s) {
+            if (s.key == k) return true;
+            if (s.len != n || (interned && tocin_str_is_interned(s.key))) return false;
+            return std::memcmp(s.key, k, n) == 0;
+        });
+        if (r.second)
+        {
+            char *key;
+            if (tocin_str_header(k)->cap < 0)
+                key = tocin_intern_hashed(k, n, kh);
+            else
+            {
+                auto *hdr = static_cast<TocinStrHeader *>(std::malloc(sizeof(TocinStrHeader) + n + 1));
+                if (!hdr) std::abort();
+                hdr->len = (int64_t)n;
+                hdr->cap = (int64_t)n;
+                key = reinterpret_cast<char *>(hdr + 1);
+                if (n) std::memcpy(key, k, n);
+                key[n] = '\0';
+            }
+            *r.first = TocinStrSlot{key, n, kh, v};
+        }
+        else
+            r.first->value = v;
+    }
+    int64_t __tocin_map_get_str(void *h, const char *k)
+    {
+        TocinStrSlot *s = h && k ? tocin_map_find_str(static_cast<TocinMap *>(h), k) : nullptr;
+        return s ? s->value : 0;
+    }
+    int64_t __tocin_map_has_str(void *h, const char *k)
+    {
+        return h && k && tocin_map_find_str(static_cast<TocinMap *>(h), k) ? 1 : 0;
+    }
+    // mapReserve(m, n) / mapReserveStr(m, n): room for n int- / string-keyed
+    // entries in total, so a bulk load does not rehash on the way.
+    void __tocin_map_reserve(void *h, int64_t n)
+    {
+        if (h && n > 0) static_cast<TocinMap *>(h)->ints.reserve((size_t)n);
+    }
+    void __tocin_map_reserve_str(void *h, int64_t n)
+    {
+        if (h && n > 0) static_cast<TocinMap *>(h)->strs.reserve((size_t)n);
+    }
+    // Entries of each kind the map holds before it next grows.
+    int64_t __tocin_map_capacity(void *h)
+    {
+        return h ? (int64_t)static_cast<TocinMap *>(h)->ints.capacity() : 0;
+    }
+    int64_t __tocin_map_capacity_str(void *h)
+    {
+        return h ? (int64_t)static_cast<TocinMap *>(h)->strs.capacity() : 0;
+    }
+    int64_t __tocin_map_len(void *h)
+    {
+        if (!h) return 0;
+        auto *m = static_cast<TocinMap *>(h);
+        return (int64_t)(m->ints.size() + m->strs.size());
+    }
+    void __tocin_map_free(void *h) { delete static_cast<TocinMap *>(h); }
+}
+
+// ===========================================================================
+// Memoized functions (`memoize def`). Each one owns a module-level slot the
+// codegen passes in; its table (memo_table.h) is made on first use and kept
+// for the life of the program. The arguments arrive as n 64-bit words
+// (floats by their bits, bools widened), and so does the result.
+// ===========================================================================
+static tocin::runtime::MemoTable *memoTableOf(int64_t *slot)
+{
+    auto *cell = reinterpret_cast<std::atomic<tocin::runtime::MemoTable *> *>(slot);
+    tocin::runtime::MemoTable *t = cell->load(std::memory_order_acquire);
+    if (t) return t;
+    auto *fresh = new tocin::runtime::MemoTable();
+    if (cell->compare_exchange_strong(t, fresh, std::memory_order_acq_rel))
+        return fresh;
+    delete fresh;  // another thread made it first
+    return t;
+}
+
+extern "C"
+{
+    // 1 and the cached result in *out if this argument tuple has one.
+    int64_t __tocin_memo_get(int64_t *slot, const uint64_t *args, int64_t n, uint64_t *out)
+    {
+        if (!slot || n < 0 || (size_t)n > tocin::runtime::MemoTable::kMaxArgs) return 0;
+        return memoTableOf(slot)->get(args, (size_t)n, out) ? 1 : 0;
+    }
+    void __tocin_memo_put(int64_t *slot, const uint64_t *args, int64_t n, uint64_t value)
+    {
+        if (!slot || n < 0 || (size_t)n > tocin::runtime::MemoTable::kMaxArgs) return;
+        memoTableOf(slot)->put(args, (size_t)n, value);
+    }
+}
+
+// ===========================================================================
+// CPU level for multiversioned functions (target_clones / --multiversion),
+// read by each function's resolver on its first call: 0 baseline x86-64,
+// 1 x86-64-v2 (SSE4.2, POPCNT), 2 x86-64-v3 (AVX2, FMA, BMI2, F16C; every
+// such CPU also has the LZCNT and MOVBE the level adds), 3 x86-64-v4
+// (AVX-512 F/BW/CD/DQ/VL). TOCIN_CPU_LEVEL lowers it, so the narrower
+// versions can be run on a wide machine.
+// ===========================================================================
+static int64_t detectCpuLevel()
+{
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (!(__builtin_cpu_supports("popcnt") && __builtin_cpu_supports("sse4.2") &&
+          __builtin_cpu_supports("ssse3")))
+        return 0;
+    if (!(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+          __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2") &&
+          __builtin_cpu_supports("f16c")))
+        return 1;
+    if (!(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+          __builtin_cpu_supports("avx512cd") && __builtin_cpu_supports("avx512dq") &&
+          __builtin_cpu_supports("avx512vl")))
+        return 2;
+    return 3;
+#else
+    return 0;
+#endif
+}
+
+extern "C"
+{
+    int64_t __tocin_cpu_level()
+    {
+        static const int64_t level = [] {
+            int64_t detected = detectCpuLevel();
+            if (const char *env = std::getenv("TOCIN_CPU_LEVEL"); env && *env)
+                return std::min<int64_t>(detected, std::max<int64_t>(0, std::atoll(env)));
+            return detected;
+        }();
+        return level;
+    }
+}
+
+// ===========================================================================
+// String runtime over the length-prefixed layout above. Functions returning a
+// string return a fresh buffer (never aliasing an input), except that
+// __tocin_str_append may extend a string the caller owns. Out-of-range char
+// access returns -1; substring bounds are clamped; NULL inputs are tolerated.
+// Lengths come from the header; searches go through the SIMD kernels in
+// string_kernels.h. Case mapping is ASCII-only.
+// ===========================================================================
+static const tocin::runtime::StringKernels &strKernels()
+{
+    return tocin::runtime::stringKernels();
+}
+
+// Float text. std::to_chars prints the shortest digits that parse back to
+// the same double (Ryu in libstdc++), and std::from_chars parses with the
+// Eisel-Lemire fast path; neither consults the locale.
+namespace
+{
+    // Room for any shortest form: "-2.2250738585072014e-308" is 24 bytes.
+    constexpr size_t kFloatTextMax = 32;
+
+    size_t tocin_format_float(char *out, double d)
+    {
+        auto r = std::to_chars(out, out + kFloatTextMax, d);
+        return (size_t)(r.ptr - out);
+    }
+
+    // Parse a float at the start of [p, end) the way atof reads it: leading
+    // whitespace and a '+' are skipped and trailing text is ignored. Returns
+    // 0.0 when nothing parses; *stop is left after what was consumed.
+    double tocin_parse_float(const char *p, const char *end, const char **stop)
+    {
+        while (p < end && std::isspace((unsigned char)*p)) ++p;
+        const char *start = p;
+        if (p < end && *p == '+' && p + 1 < end && p[1] != '-') ++p;
+        double d = 0.0;
+        auto r = std::from_chars(p, end, d);
+        if (r.ec == std::errc::result_out_of_range)
+        {
+            // from_chars leaves d unset; strtod gives the +-HUGE_VAL / 0.0
+            // atof would. The text is a valid number, so strtod stops at
+            // r.ptr as well.
+            d = std::strtod(p, nullptr);
+        }
+        else if (r.ec != std::errc())
+        {
+            *stop = start;
+            return 0.0;
+        }
+        *stop = r.ptr;
+        return d;
+    }
+}
+
+extern "C"
+{
+    // Adopt a NUL-terminated C string (an extern function's result) as a
+    // Tocin string by copying it behind a header.
+    char *__tocin_str_from_c(const char *s)
+    {
+        if (!s) return tocin_str_empty();
+        return tocin_str_new(s, strKernels().length(s));
+    }
+    // Materialize n raw bytes as a string (the back half of the
+    // string-builder pattern: build bytes in a buffer, convert once).
+    char *__tocin_buf_to_str(const char *p, int64_t n)
+    {
+        if (!p || n < 0) n = 0;
+        return tocin_str_new(p, (size_t)n);
+    }
+    char *__tocin_str_substring(const char *s, int64_t start, int64_t len)
+    {
+        int64_t n = (int64_t)tocin_str_length(s);
+        if (start < 0) start = 0;
+        if (len < 0) len = 0;
+        if (start > n) start = n;
+        if (len > n - start) len = n - start;
+        return tocin_str_new(s ? s + start : "", (size_t)len);
+    }
+    int64_t __tocin_str_eq(const char *a, const char *b)
+    {
+        if (a == b) return 1;
+        if (!a || !b) return 0;
+        size_t n = tocin_str_length(a);
+        if (n != tocin_str_length(b)) return 0;
+        // Each interned copy is the only one with its bytes.
+        if (tocin_str_header(a)->cap == kStrInterned && tocin_str_header(b)->cap == kStrInterned) return 0;
+        return std::memcmp(a, b, n) == 0 ? 1 : 0;
+    }
+    int64_t __tocin_str_cmp(const char *a, const char *b)
+    {
+        if (a == b) return 0;
+        size_t la = tocin_str_length(a), lb = tocin_str_length(b);
+        int r = std::memcmp(a ? a : "", b ? b : "", std::min(la, lb));
+        if (r == 0) return la < lb ? -1 : (la > lb ? 1 : 0);
+        return r < 0 ? -1 : 1;
+    }
+    int64_t __tocin_str_index_of_char(const char *s, int64_t c)
+    {
+        if (!s || (unsigned char)c == 0) return -1;
+        const void *p = std::memchr(s, (unsigned char)c, tocin_str_length(s));
+        return p ? (int64_t)(static_cast<const char *>(p) - s) : -1;
+    }
+    char *__tocin_int_to_str(int64_t n)
+    {
+        // Tight base-10 conversion: write digits back-to-front into a stack
+        // buffer, then one exact-size atomic allocation. This avoids snprintf's
+        // format-string parsing (its cost dominated string-heavy loops) and
+        // uses a non-scanned allocation since the result holds no pointers.
+        char tmp[20];              // enough for -9223372036854775808
+        char *p = tocin_format_int(tmp + sizeof(tmp), n);
+        return tocin_str_new(p, (size_t)(tmp + sizeof(tmp) - p));
+    }
+    int64_t __tocin_str_to_int(const char *s) { return s ? (int64_t)std::atoll(s) : 0; }
+    double __tocin_str_to_float(const char *s)
+    {
+        const char *stop;
+        return s ? tocin_parse_float(s, s + tocin_str_length(s), &stop) : 0.0;
+    }
+    char *__tocin_float_to_str(double d)
+    {
+        char buf[kFloatTextMax];
+        return tocin_str_new(buf, tocin_format_float(buf, d));
+    }
+    // floatsToStr(xs, sep): every element of a float array ([i64 len][f64...])
+    // in shortest round-trip form, joined by sep, in one allocation.
+    char *__tocin_floats_to_str(const void *arr, const char *sep)
+    {
+        const int64_t n = arr ? *static_cast<const int64_t *>(arr) : 0;
+        if (n <= 0) return tocin_str_empty();
+        const double *xs = reinterpret_cast<const double *>(static_cast<const int64_t *>(arr) + 1);
+        const size_t ls = tocin_str_length(sep);
+        char *out = tocin_str_alloc(0, (size_t)n * (kFloatTextMax + ls));
+        if (!out) return nullptr;
+        char *p = out;
+        for (int64_t i = 0; i < n; ++i)
+        {
+            if (i > 0 && ls) { std::memcpy(p, sep, ls); p += ls; }
+            p += tocin_format_float(p, xs[i]);
+        }
+        *p = '\0';
+        tocin_str_header(out)->len = (int64_t)(p - out);
+        return out;
+    }
+    // strToFloats(s, sep): split s on the byte sep and parse each field into a
+    // fresh float array. Fields parse like strToFloat (whitespace around a
+    // number is ignored, an unparseable field is 0.0); "" gives [].
+    void *__tocin_str_to_floats(const char *s, int64_t sep)
+    {
+        const size_t len = tocin_str_length(s);
+        const char c = (char)(unsigned char)sep;
+        size_t n = len ? 1 : 0;
+        for (const char *q = s; len && (q = static_cast<const char *>(std::memchr(q, c, (size_t)(s + len - q))));
+             ++q)
+            ++n;
+        auto *arr = static_cast<int64_t *>(__tocin_alloc_atomic((int64_t)(8 * (n + 1))));
+        if (!arr) return nullptr;
+        arr[0] = (int64_t)n;
+        double *xs = reinterpret_cast<double *>(arr + 1);
+        const char *p = s, *end = s + len;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const char *fieldEnd = static_cast<const char *>(std::memchr(p, c, (size_t)(end - p)));
+            if (!fieldEnd) fieldEnd = end;
+            const char *stop;
+            xs[i] = tocin_parse_float(p, fieldEnd, &stop);
+            p = fieldEnd + 1;
+        }
+        return arr;
+    }
+    char *__tocin_char_to_str(int64_t c)
+    {
+        char ch = (char)(unsigned char)c;
+        return tocin_str_new(&ch, 1);
+    }
+    char *__tocin_str_concat(const char *a, const char *b)
+    {
+        size_t la = tocin_str_length(a), lb = tocin_str_length(b);
+        char *out = tocin_str_alloc(la + lb, la + lb);
+        if (!out) return nullptr;
+        if (la) std::memcpy(out, a, la);
+        if (lb) std::memcpy(out + la, b, lb);
+        return out;
+    }
+    // `s = s + t` on a local the compiler has proven nobody else can see.
+    // An @p owned s (one this function returned earlier) is extended in place
+    // while it has room; otherwise the bytes move to a buffer with at least
+    // double the capacity. t may be s itself.
+    char *__tocin_str_append(char *s, const char *t, int64_t owned)
+    {
+        size_t ls = tocin_str_length(s), lt = tocin_str_length(t);
+        if (owned && s && tocin_str_header(s)->cap >= (int64_t)(ls + lt))
+        {
+            if (lt) std::memmove(s + ls, t, lt);
+            s[ls + lt] = '\0';
+            tocin_str_header(s)->len = (int64_t)(ls + lt);
+            return s;
+        }
+        char *out = tocin_str_alloc(ls + lt, tocin_str_grown_cap(owned ? s : nullptr, ls + lt));
+        if (!out) return nullptr;
+        if (ls) std::memcpy(out, s, ls);
+        if (lt) std::memcpy(out + ls, t, lt);
+        if (owned && s) __tocin_free(tocin_str_header(s));
+        return out;
+    }
+
+    // Case conversion (fresh copies).
+    char *__tocin_str_to_upper(const char *s)
+    {
+        size_t n = tocin_str_length(s);
+        char *out = tocin_str_alloc(n, n);
+        if (!out) return nullptr;
+        if (n) strKernels().toUpper(out, s, n);
+        return out;
+    }
+    char *__tocin_str_to_lower(const char *s)
+    {
+        size_t n = tocin_str_length(s);
+        char *out = tocin_str_alloc(n, n);
+        if (!out) return nullptr;
+        if (n) strKernels().toLower(out, s, n);
+        return out;
+    }
+    // Substring search: index of first occurrence, or -1.
+    int64_t __tocin_str_index_of(const char *s, const char *sub)
+    {
+        if (!s || !sub) return -1;
+        size_t m = tocin_str_length(sub);
+        if (m == 0) return 0;
+        const char *p = strKernels().find(s, tocin_str_length(s), sub, m);
+        return p ? (int64_t)(p - s) : -1;
+    }
+    // strIndexOf(s, sub, from): the first match at or after `from`, so a
+    // scanning loop does not re-search (or copy) what it has passed.
+    int64_t __tocin_str_index_of_from(const char *s, const char *sub, int64_t from)
+    {
+        if (!s || !sub) return -1;
+        size_t n = tocin_str_length(s), m = tocin_str_length(sub);
+        if (from < 0) from = 0;
+        if ((size_t)from > n) return -1;
+        if (m == 0) return from;
+        const char *p = strKernels().find(s + from, n - (size_t)from, sub, m);
+        return p ? (int64_t)(p - s) : -1;
+    }
+    int64_t __tocin_str_contains(const char *s, const char *sub)
+    {
+        return __tocin_str_index_of(s, sub) >= 0 ? 1 : 0;
+    }
+    int64_t __tocin_str_starts_with(const char *s, const char *pre)
+    {
+        if (!s || !pre) return 0;
+        size_t lp = tocin_str_length(pre);
+        return lp <= tocin_str_length(s) && std::memcmp(s, pre, lp) == 0 ? 1 : 0;
+    }
+    int64_t __tocin_str_ends_with(const char *s, const char *suf)
+    {
+        if (!s || !suf) return 0;
+        size_t ls = tocin_str_length(s), lf = tocin_str_length(suf);
+        if (lf > ls) return 0;
+        return std::memcmp(s + (ls - lf), suf, lf) == 0 ? 1 : 0;
+    }
+    // free() of a string: the block starts at its header. Literals are not
+    // heap memory and are left alone.
+    void __tocin_str_free(char *s)
+    {
+        if (!s || tocin_str_header(s)->cap < 0) return;
+        __tocin_free(tocin_str_header(s));
+    }
+}
+
+// ===========================================================================
+// String builders (sbNew / sbAppend* / sbFinish). A builder owns one growing
+// string buffer and formats numbers straight into it; sbFinish hands that
+// buffer over as the result without copying and leaves the builder empty, so
+// a finished string is never written again. The handle is scanned GC memory
+// holding the buffer pointer, and is collected with it.
+// ===========================================================================
+namespace
+{
+    struct TocinStrBuilder
+    {
+        char *buf; // nullptr until the first append
+    };
+
+    // Make room for @p extra more bytes; returns where they go.
+    char *tocin_sb_reserve(TocinStrBuilder *b, size_t extra)
+    {
+        size_t len = tocin_str_length(b->buf);
+        if (!b->buf || (size_t)tocin_str_header(b->buf)->cap < len + extra)
+        {
+            char *out = tocin_str_alloc(len, tocin_str_grown_cap(b->buf, len + extra));
+            if (!out) return nullptr;
+            if (len) std::memcpy(out, b->buf, len);
+            if (b->buf) __tocin_free(tocin_str_header(b->buf));
+            b->buf = out;
+        }
+        return b->buf + len;
+    }
+
+    // Account for @p n bytes written at the reserved position.
+    void tocin_sb_commit(TocinStrBuilder *b, size_t n)
+    {
+        TocinStrHeader *h = tocin_str_header(b->buf);
+        h->len += (int64_t)n;
+        b->buf[h->len] = '\0';
+    }
+}
+
+extern "C"
+{
+    void *__tocin_sb_new()
+    {
+        auto *b = static_cast<TocinStrBuilder *>(__tocin_alloc(sizeof(TocinStrBuilder)));
+        if (b) b->buf = nullptr;
+        return b;
+    }
+    void __tocin_sb_append(void *h, const char *s)
+    {
+        auto *b = static_cast<TocinStrBuilder *>(h);
+        size_t n = tocin_str_length(s);
+        if (!b || n == 0) return;
+        char *at = tocin_sb_reserve(b, n);
+        if (!at) return;
+        std::memcpy(at, s, n);
+        tocin_sb_commit(b, n);
+    }
+    // Same digits as __tocin_int_to_str, with no intermediate string.
+    void __tocin_sb_append_int(void *h, int64_t n)
+    {
+        auto *b = static_cast<TocinStrBuilder *>(h);
+        if (!b) return;
+        char tmp[20];
+        char *p = tocin_format_int(tmp + sizeof(tmp), n);
+        size_t len = (size_t)(tmp + sizeof(tmp) - p);
+        char *at = tocin_sb_reserve(b, len);
+        if (!at) return;
+        std::memcpy(at, p, len);
+        tocin_sb_commit(b, len);
+    }
+    // Same text as __tocin_float_to_str, printed into the buffer.
+    void __tocin_sb_append_float(void *h, double d)
+    {
+        auto *b = static_cast<TocinStrBuilder *>(h);
+        if (!b) return;
+        char *at = tocin_sb_reserve(b, kFloatTextMax);
+        if (!at) return;
+        tocin_sb_commit(b, tocin_format_float(at, d));
+    }
+    int64_t __tocin_sb_len(void *h)
+    {
+        auto *b = static_cast<TocinStrBuilder *>(h);
+        return b ? (int64_t)tocin_str_length(b->buf) : 0;
+    }
+    char *__tocin_sb_finish(void *h)
+    {
+        auto *b = static_cast<TocinStrBuilder *>(h);
+        if (!b || !b->buf) return tocin_str_empty();
+        char *s = b->buf;
+        b->buf = nullptr;
+        return s;
+    }
+}
+
+namespace
+{
+    // The next record from r as a fresh string ("" at the end); a line
+    // also loses the '\r' of a CRLF ending.
+    char *tocin_reader_record(tocin::runtime::FileReader &r, char delim, bool line)
+    {
+        const char *p;
+        size_t n;
+        if (!r.nextRecord(delim, &p, &n)) return tocin_str_empty();
+        if (line && n > 0 && p[n - 1] == '\r') --n;
+        return tocin_str_new(p, n);
+    }
+}
+
+// ===========================================================================
+// File I/O. Paths and contents are Tocin strings (see "String layout");
+// returned strings are fresh and owned by the caller; read errors yield an
+// empty string (use len/strLen safely). Write/append return bytes written, or -1 on error.
+// The system calls live in file_io.cpp (posix, or io_uring with
+// TOCIN_IO_BACKEND=uring), which also keeps appended-to files open.
+// ===========================================================================
+extern "C"
+{
+    char *__tocin_read_file(const char *path)
+    {
+        if (!path) return tocin_str_empty();
+        size_t got = 0;
+        char *buf = tocin::runtime::fileIo().readFile(
+            path, [](size_t size) { return tocin_str_alloc(size, size); }, &got);
+        if (!buf) return tocin_str_empty();
+        buf[got] = '\0';
+        tocin_str_header(buf)->len = (int64_t)got;
+        return buf;
+    }
+    int64_t __tocin_write_file(const char *path, const char *contents)
+    {
+        if (!path || !contents) return -1;
+        return tocin::runtime::fileIo().writeFile(path, contents, tocin_str_length(contents));
+    }
+    int64_t __tocin_append_file(const char *path, const char *contents)
+    {
+        if (!path || !contents) return -1;
+        return tocin::runtime::fileIo().appendFile(path, contents, tocin_str_length(contents));
+    }
+    int64_t __tocin_file_size(const char *path)
+    {
+        if (!path) return -1;
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        return ec ? -1 : (int64_t)size;
+    }
+    // Read-only views of whole files, as plain addresses for loadByte /
+    // loadInt. The pages come straight from the page cache and are neither
+    // copied nor scanned by the GC.
+    int64_t __tocin_mmap_file(const char *path)
+    {
+        if (!path) return 0;
+        size_t len = 0;
+        return (int64_t)(uintptr_t)tocin::runtime::mapFile(path, &len);
+    }
+    int64_t __tocin_mmap_size(int64_t addr)
+    {
+        return tocin::runtime::mappingSize(reinterpret_cast<const void *>((uintptr_t)addr));
+    }
+    int64_t __tocin_munmap_file(int64_t addr)
+    {
+        return tocin::runtime::unmapFile(reinterpret_cast<const void *>((uintptr_t)addr)) ? 0 : -1;
+    }
+    // hint: "normal", "sequential", "random", "willneed" or "dontneed".
+    int64_t __tocin_mmap_advise(int64_t addr, const char *hint)
+    {
+        using tocin::runtime::MapAdvice;
+        static const std::pair<const char *, MapAdvice> kHints[] = {
+            {"normal", MapAdvice::Normal}, {"sequential", MapAdvice::Sequential},
+            {"random", MapAdvice::Random}, {"willneed", MapAdvice::WillNeed},
+            {"dontneed", MapAdvice::DontNeed}};
+        if (!hint) return -1;
+        for (const auto &h : kHints)
+            if (std::strcmp(hint, h.first) == 0)
+                return tocin::runtime::adviseMapping(reinterpret_cast<const void *>((uintptr_t)addr), h.second)
+                           ? 0 : -1;
+        return -1;
+    }
+    // Buffered line and record readers (FileReader in file_io.h). A handle
+    // is the reader's address, 0 when fileOpen failed; every call on 0 acts
+    // as if at the end. One goroutine at a time per handle.
+    int64_t __tocin_file_open(const char *path)
+    {
+        if (!path) return 0;
+        return (int64_t)(uintptr_t)tocin::runtime::FileReader::open(path);
+    }
+    int64_t __tocin_file_close(int64_t h)
+    {
+        delete reinterpret_cast<tocin::runtime::FileReader *>((uintptr_t)h);
+        return 0;
+    }
+    int64_t __tocin_file_eof(int64_t h)
+    {
+        auto *r = reinterpret_cast<tocin::runtime::FileReader *>((uintptr_t)h);
+        return !r || r->atEnd() ? 1 : 0;
+    }
+    char *__tocin_file_read_record(int64_t h, const char *delim)
+    {
+        auto *r = reinterpret_cast<tocin::runtime::FileReader *>((uintptr_t)h);
+        if (!r || !delim || !*delim) return tocin_str_empty();
+        return tocin_reader_record(*r, *delim, false);
+    }
+    char *__tocin_file_read_line(int64_t h)
+    {
+        auto *r = reinterpret_cast<tocin::runtime::FileReader *>((uintptr_t)h);
+        if (!r) return tocin_str_empty();
+        return tocin_reader_record(*r, '\n', true);
+    }
+    int64_t __tocin_file_read_chunk(int64_t h, char *buf, int64_t off, int64_t max)
+    {
+        auto *r = reinterpret_cast<tocin::runtime::FileReader *>((uintptr_t)h);
+        if (!buf || off < 0 || max < 0) return -1;
+        return r ? r->read(buf + off, (size_t)max) : 0;
+    }
+    // Standard input goes through the same buffer, so readLine() on a piped
+    // file is a memchr per line rather than an fgetc per byte.
+    char *__tocin_read_line()
+    {
+        static std::mutex stdinMutex;
+        if (tocin_stdout_is_tty()) std::fflush(stdout); // show the prompt first
+        BlockingSection blocking;
+        std::lock_guard<std::mutex> lock(stdinMutex);
+        return tocin_reader_record(tocin::runtime::FileReader::standardInput(), '\n', true);
+    }
+}
+
+// ===========================================================================
+// Key/value stores (kv_store.h) behind stdlib/database's kv* functions. A
+// handle is the store's address; kvStoreOpen("") is in memory, any other
+// path a durable store in that directory, and 0 means it could not be
+// opened. Keys and values are Tocin strings, copied in and out. Calls that
+// may wait on the disk tell the scheduler, so other goroutines keep running.
+// ===========================================================================
+extern "C"
+{
+    int64_t __tocin_kv_open(const char *path)
+    {
+        std::string dir = path ? std::string(path, tocin_str_length(path)) : std::string();
+        BlockingSection blocking;
+        return (int64_t)(uintptr_t)tocin::runtime::KvStore::open(dir);
+    }
+    int64_t __tocin_kv_put(int64_t h, const char *k, const char *v)
+    {
+        auto *db = reinterpret_cast<tocin::runtime::KvStore *>((uintptr_t)h);
+        if (!db || !k || !v) return -1;
+        std::string_view key(k, tocin_str_length(k)), value(v, tocin_str_length(v));
+        if (!db->durable()) return db->put(key, value) ? 0 : -1;
+        BlockingSection blocking;
+        return db->put(key, value) ? 0 : -1;
+    }
+    char *__tocin_kv_get(int64_t h, const char *k, const char *dflt)
+    {
+        auto *db = reinterpret_cast<tocin::runtime::KvStore *>((uintptr_t)h);
+        size_t len = 0;
+        char *v = db && k ? db->get(std::string_view(k, tocin_str_length(k)),
+                                    [](size_t size) { return tocin_str_alloc(size, size); }, &len)
+                          : nullptr;
+        if (v) return v;
+        return dflt ? tocin_str_new(dflt, tocin_str_length(dflt)) : tocin_str_empty();
+    }
+    int64_t __tocin_kv_has(int64_t h, const char *k)
+    {
+        auto *db = reinterpret_cast<tocin::runtime::KvStore *>((uintptr_t)h);
+        return db && k && db->has(std::string_view(k, tocin_str_length(k))) ? 1 : 0;
+    }
+    // 1 if the key was there.
+    int64_t __tocin_kv_delete(int64_t h, const char *k)
+    {
+        auto *db = reinterpret_cast<tocin::runtime::KvStore *>((uintptr_t)h);
+        if (!db || !k) return 0;
+        std::string_view key(k, tocin_str_length(k));
+        if (!db->durable()) return db->remove(key) ? 1 : 0;
+        BlockingSection blocking;
+        return db->remove(key) ? 1 : 0;
+    }
+    int64_t __tocin_kv_len(int64_t h)
+    {
+        auto *db = reinterpret_cast<tocin::runtime::KvStore *>((uintptr_t)h);
+        return db ? (int64_t)db->size() : 0;
+    }
+    // on = 0: puts return before their record is synced, until kvSync.
+    int64_t __tocin_kv_set_sync(int64_t h, int64_t on)
+    {
+        auto *db = reinterpret_cast<tocin::runtime::KvStore *>((uintptr_t)h);
+        if (!db) return -1;
+        BlockingSection blocking;
+        db->setSync(on != 0);
+        return 0;
+    }
+    int64_t __tocin_kv_sync(int64_t h)
+    {
+        auto *db = reinterpret_cast<tocin::runtime::KvStore *>((uintptr_t)h);
+        if (!db) return -1;
+        BlockingSection blocking;
+        return db->sync() ? 0 : -1;
+    }
+    int64_t __tocin_kv_compact(int64_t h)
+    {
+        auto *db = reinterpret_cast<tocin::runtime::KvStore *>((uintptr_t)h);
+        if (!db) return -1;
+        BlockingSection blocking;
+        return db->compact() ? 0 : -1;
+    }
+    int64_t __tocin_kv_close(int64_t h)
+    {
+        auto *db = reinterpret_cast<tocin::runtime::KvStore *>((uintptr_t)h);
+        BlockingSection blocking;
+        delete db;
+        return 0;
+    }
+}
+
+// ===========================================================================
+// Time. Wall-clock (epoch) and a monotonic clock for measuring durations.
+// ===========================================================================
+extern "C"
+{
+    int64_t __tocin_time_sec()
+    {
+        using namespace std::chrono;
+        return (int64_t)duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+    }
+    int64_t __tocin_time_ms()
+    {
+        using namespace std::chrono;
+        return (int64_t)duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    }
+    int64_t __tocin_mono_nanos()
+    {
+        using namespace std::chrono;
+        return (int64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+    void __tocin_sleep_ms(int64_t ms)
+    {
+        if (ms > 0) LightweightScheduler::sleepFor(std::chrono::milliseconds(ms));
+    }
+    // A channel that receives ms once ms milliseconds have passed: the
+    // timeout case of a select. A timer on the scheduler's heap, not a thread.
+    void *__tocin_chan_after(int64_t ms)
+    {
+        void *ch = __tocin_chan_new_cap(1);
+        tocin_sched().after(std::chrono::milliseconds(ms > 0 ? ms : 0),
+                            [ch, ms] { __tocin_chan_send(ch, ms); });
+        return ch;
+    }
+}
+
+// ===========================================================================
+// Hashing. FNV-1a (64-bit) for strings/bytes and a splitmix64 integer mixer
+// (__tocin_hash_int, in inline_abi.cpp). Stable across runs — suitable for
+// content addressing (a VCS object store), hash tables, and bloom filters.
+//
+// hashFast* / hashSeeded / hashCombine are wyhash (hash.h): the same output
+// for the same input and seed, at several bytes per cycle where FNV-1a takes
+// a multiply per byte. Unseeded is seed 0; a table keyed by untrusted input
+// should hash with a secret seed.
+// ===========================================================================
+extern "C"
+{
+    int64_t __tocin_hash_bytes(const void *p, int64_t n)
+    {
+        const unsigned char *b = (const unsigned char *)p;
+        uint64_t h = 1469598103934665603ULL; // FNV offset basis
+        for (int64_t i = 0; b && i < n; ++i) { h ^= b[i]; h *= 1099511628211ULL; }
+        return (int64_t)h;
+    }
+    int64_t __tocin_hash_str(const char *s)
+    {
+        if (!s) return (int64_t)1469598103934665603ULL;
+        return __tocin_hash_bytes(s, (int64_t)tocin_str_length(s));
+    }
+    int64_t __tocin_hash_seeded(const void *p, int64_t n, int64_t seed)
+    {
+        return (int64_t)tocin::runtime::wyhash(p, p && n > 0 ? (size_t)n : 0, (uint64_t)seed);
+    }
+    int64_t __tocin_hash_str_seeded(const char *s, int64_t seed)
+    {
+        return (int64_t)tocin::runtime::wyhash(s, tocin_str_length(s), (uint64_t)seed);
+    }
+    int64_t __tocin_hash_fast(const void *p, int64_t n) { return __tocin_hash_seeded(p, n, 0); }
+    int64_t __tocin_hash_fast_str(const char *s) { return __tocin_hash_str_seeded(s, 0); }
+    int64_t __tocin_hash_combine(int64_t h, int64_t x)
+    {
+        return (int64_t)tocin::runtime::hashCombine((uint64_t)h, (uint64_t)x);
+    }
+}
+
+// ===========================================================================
+// Pseudo-random numbers: xoshiro256++ (xoshiro.h), one generator per
+// goroutine (tocin_rng above). Deterministic given a seed — good for
+// simulations, sampling, weight init and tests (not cryptography).
+//
+// randInt and randRange compile to the generator step inline, on the words
+// __tocin_rand_state returns; the calls here serve IR that does not. A
+// range is Lemire's multiply-and-reject, so every value in it is equally
+// likely. randFill / randFillFloat fill a list from the four bulk lanes.
+// ===========================================================================
+extern "C"
+{
+    void __tocin_rand_seed(int64_t seed)
+    {
+        tocin::runtime::RandState &r = tocin_rng();
+        r.gen.seed((uint64_t)seed);
+        r.lanesReady = false;
+        r.inUse = true;
+    }
+    // Stable for the caller's lifetime and touching nothing the program
+    // can see, so generated code may call it once per function.
+    uint64_t *__tocin_rand_state() { return tocin_rng_ready().gen.s; }
+    int64_t __tocin_rand_next()
+    {
+        return (int64_t)(tocin_rng_ready().gen.next() >> 1); // non-negative
+    }
+    int64_t __tocin_rand_range(int64_t lo, int64_t hi)
+    {
+        if (hi <= lo) return lo;
+        uint64_t span = (uint64_t)hi - (uint64_t)lo;
+        return (int64_t)((uint64_t)lo + tocin::runtime::boundedDraw(tocin_rng_ready().gen, span));
+    }
+    // randFill(xs, n): the first n elements of a list<int> (at most its
+    // length) set as randInt() would; returns how many.
+    int64_t __tocin_rand_fill(int64_t *xs, int64_t n)
+    {
+        n = xs ? std::min(n, xs[0]) : 0;
+        if (n <= 0) return 0;
+        int64_t *out = xs + 1;
+        tocin_rng_ready().fill((size_t)n, [out](size_t i, uint64_t r) { out[i] = (int64_t)(r >> 1); });
+        return n;
+    }
+    // randFillFloat(xs, n, lo, hi): the same for a list<float>, uniform in
+    // [lo, hi) from the top 53 bits of each draw.
+    int64_t __tocin_rand_fill_float(int64_t *xs, int64_t n, double lo, double hi)
+    {
+        n = xs ? std::min(n, xs[0]) : 0;
+        if (n <= 0) return 0;
+        double *out = reinterpret_cast<double *>(xs + 1);
+        const double scale = (hi - lo) * 0x1.0p-53;
+        tocin_rng_ready().fill((size_t)n, [out, lo, scale](size_t i, uint64_t r) {
+            out[i] = lo + (double)(r >> 11) * scale;
+        });
+        return n;
+    }
+}
+
+// ===========================================================================
+// TCP networking (POSIX sockets). File descriptors are returned as int64.
+// These are the primitives a microservice or client needs; combine with `go`
+// goroutines for a concurrent server. Errors return -1 / empty string.
+//
+// Sockets are non-blocking. A goroutine whose call would block parks on the
+// scheduler's netpoller (epoll / kqueue) and its worker runs other
+// goroutines, so an idle connection costs a small fiber rather than an OS
+// thread. Off a goroutine the call waits in poll(2) instead.
+// ===========================================================================
+#ifdef TOCIN_HAVE_POSIX_NET
+namespace
+{
+    void tocin_net_nonblock(int fd)
+    {
+        int flags = ::fcntl(fd, F_GETFL, 0);
+        if (flags >= 0) ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+        int yes = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+#endif
+    }
+
+    // Wait until fd is ready after EAGAIN; false if it never can be.
+    bool tocin_net_wait(int fd, bool forWrite)
+    {
+        if (LightweightScheduler::waitFd(fd, forWrite)) return true;
+        pollfd p;
+        p.fd = fd;
+        p.events = forWrite ? POLLOUT : POLLIN;
+        p.revents = 0;
+        BlockingSection blocking;
+        return ::poll(&p, 1, -1) >= 0 || errno == EINTR;
+    }
+
+    bool tocin_net_would_block()
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+
+#ifdef MSG_NOSIGNAL
+    // A peer that hung up fails the send with EPIPE instead of killing us.
+    constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+    constexpr int kSendFlags = 0;
+#endif
+
+    // Send all of p[0, len), waiting out a full socket buffer; len or -1.
+    int64_t tocin_net_send_all(int fd, const char *p, size_t len)
+    {
+        size_t sent = 0;
+        while (sent < len)
+        {
+            ssize_t n = ::send(fd, p + sent, len - sent, kSendFlags);
+            if (n > 0) { sent += (size_t)n; continue; }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && tocin_net_would_block() && tocin_net_wait(fd, true)) continue;
+            return -1;
+        }
+        return (int64_t)sent;
+    }
+
+    // tcpRecv's landing buffer: per worker thread rather than on the small
+    // goroutine stack. Not inlined, so a caller that parked in between
+    // cannot reuse another thread's address.
+    constexpr size_t kNetScratch = 65536;
+    __attribute__((noinline)) char *tocin_net_scratch()
+    {
+        static thread_local char buf[kNetScratch];
+        return buf;
+    }
+
+    // One recv into p[0, max), waiting until data or end of stream arrives:
+    // bytes read, 0 at end of stream, -1 on error.
+    ssize_t tocin_net_recv(int fd, char *p, size_t max)
+    {
+        for (;;)
+        {
+            ssize_t n = ::recv(fd, p, max, 0);
+            if (n >= 0) return n;
+            if (errno == EINTR) continue;
+            if (!tocin_net_would_block() || !tocin_net_wait(fd, false)) return -1;
+        }
+    }
+
+    int64_t tocin_net_now_ms()
+    {
+        using namespace std::chrono;
+        return (int64_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Resolved addresses by "host:port", each kept for the TTL (tcpDnsTtl;
+    // 0 turns the cache off) so a client dialling the same service over and
+    // over does not pay a getaddrinfo round trip each time. An entry whose
+    // addresses all refuse is dropped. Numeric hosts skip both.
+    struct DnsEntry
+    {
+        std::vector<sockaddr_in> addrs;
+        int64_t expires;
+    };
+    constexpr size_t kDnsMaxEntries = 1024;
+    std::mutex g_dnsMu;
+    std::map<std::string, DnsEntry> g_dns;
+    std::atomic<int64_t> g_dnsTtlMs{30000};
+
+    std::string tocin_net_key(const char *host, int64_t port)
+    {
+        std::string key(host);
+        key += ':';
+        key += std::to_string((long long)port);
+        return key;
+    }
+
+    // The IPv4 addresses of host:port, from the cache where it may be; false
+    // if the name does not resolve.
+    bool tocin_net_resolve(const char *host, int64_t port, std::vector<sockaddr_in> *out)
+    {
+        out->clear();
+        sockaddr_in a;
+        std::memset(&a, 0, sizeof(a));
+        a.sin_family = AF_INET;
+        a.sin_port = htons((uint16_t)port);
+        if (::inet_pton(AF_INET, host, &a.sin_addr) == 1)
+        {
+            out->push_back(a);
+            return true;
+        }
+        int64_t ttl = g_dnsTtlMs.load(std::memory_order_relaxed);
+        std::string key = tocin_net_key(host, port);
+        if (ttl > 0)
+        {
+            std::lock_guard<std::mutex> lock(g_dnsMu);
+            auto it = g_dns.find(key);
+            if (it != g_dns.end() && it->second.expires > tocin_net_now_ms())
+            {
+                *out = it->second.addrs;
+                return true;
+            }
+        }
+        char portstr[16]; std::snprintf(portstr, sizeof(portstr), "%lld", (long long)port);
+        addrinfo hints; std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET; hints.ai_socktype = SOCK_STREAM;
+        addrinfo *res = nullptr;
+        {
+            BlockingSection blocking; // name lookup has no non-blocking form
+            if (::getaddrinfo(host, portstr, &hints, &res) != 0 || !res) return false;
+        }
+        for (addrinfo *r = res; r; r = r->ai_next)
+            if (r->ai_family == AF_INET && r->ai_addrlen >= sizeof(sockaddr_in))
+                out->push_back(*reinterpret_cast<const sockaddr_in *>(r->ai_addr));
+        ::freeaddrinfo(res);
+        if (out->empty()) return false;
+        if (ttl > 0)
+        {
+            std::lock_guard<std::mutex> lock(g_dnsMu);
+            if (g_dns.size() >= kDnsMaxEntries)
+            {
+                int64_t now = tocin_net_now_ms();
+                for (auto it = g_dns.begin(); it != g_dns.end();)
+                    it = it->second.expires <= now ? g_dns.erase(it) : std::next(it);
+                if (g_dns.size() >= kDnsMaxEntries) g_dns.clear();
+            }
+            g_dns[key] = DnsEntry{*out, tocin_net_now_ms() + ttl};
+        }
+        return true;
+    }
+
+    void tocin_net_forget(const char *host, int64_t port)
+    {
+        std::lock_guard<std::mutex> lock(g_dnsMu);
+        g_dns.erase(tocin_net_key(host, port));
+    }
+}
+
+extern "C"
+{
+    void __tocin_tcp_close(int64_t fd);
+
+    int64_t __tocin_tcp_listen(int64_t port)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        int yes = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in addr; std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons((uint16_t)port);
+        if (::bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0) { ::close(fd); return -1; }
+        if (::listen(fd, SOMAXCONN) < 0) { ::close(fd); return -1; }
+        tocin_net_nonblock(fd);
+        return (int64_t)fd;
+    }
+    int64_t __tocin_tcp_accept(int64_t fd)
+    {
+        for (;;)
+        {
+            int c = ::accept((int)fd, nullptr, nullptr);
+            if (c >= 0) { tocin_net_nonblock(c); return (int64_t)c; }
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (!tocin_net_would_block() || !tocin_net_wait((int)fd, false)) return -1;
+        }
+    }
+    int64_t __tocin_tcp_connect(const char *host, int64_t port)
+    {
+        if (!host) return -1;
+        std::vector<sockaddr_in> addrs;
+        if (!tocin_net_resolve(host, port, &addrs)) return -1;
+        for (const sockaddr_in &addr : addrs)
+        {
+            int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0) return -1;
+            tocin_net_nonblock(fd);
+            int rc = ::connect(fd, (const sockaddr *)&addr, sizeof(addr));
+            if (rc < 0 && errno != EINPROGRESS && errno != EINTR) { ::close(fd); continue; }
+            if (rc < 0)
+            {
+                // Writable once the handshake finishes; SO_ERROR says how.
+                int err = 0;
+                socklen_t len = sizeof(err);
+                bool waited = tocin_net_wait(fd, true);
+                if (!waited || ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0)
+                {
+                    __tocin_tcp_close(fd);
+                    continue;
+                }
+            }
+            return (int64_t)fd;
+        }
+        tocin_net_forget(host, port);
+        return -1;
+    }
+    // Sets how long tcpConnect keeps a resolved name, in milliseconds (0
+    // turns the cache off and empties it); returns the previous TTL.
+    int64_t __tocin_tcp_dns_ttl(int64_t ms)
+    {
+        if (ms < 0) return g_dnsTtlMs.load();
+        int64_t prev = g_dnsTtlMs.exchange(ms);
+        if (ms == 0)
+        {
+            std::lock_guard<std::mutex> lock(g_dnsMu);
+            g_dns.clear();
+        }
+        return prev;
+    }
+    int64_t __tocin_tcp_send(int64_t fd, const char *s)
+    {
+        if (!s) return 0;
+        return tocin_net_send_all((int)fd, s, tocin_str_length(s));
+    }
+    int64_t __tocin_tcp_send_buf(int64_t fd, const char *buf, int64_t off, int64_t n)
+    {
+        if (n <= 0) return 0;
+        if (!buf || off < 0) return -1;
+        return tocin_net_send_all((int)fd, buf + off, (size_t)n);
+    }
+    char *__tocin_tcp_recv(int64_t fd)
+    {
+        for (;;)
+        {
+            // Looked up again after every wait: a parked goroutine may
+            // resume on another worker.
+            char *buf = tocin_net_scratch();
+            ssize_t n = ::recv((int)fd, buf, kNetScratch, 0);
+            if (n > 0) return tocin_str_new(buf, (size_t)n);
+            if (n == 0) return tocin_str_empty();
+            if (errno == EINTR) continue;
+            if (!tocin_net_would_block() || !tocin_net_wait((int)fd, false)) return tocin_str_empty();
+        }
+    }
+    int64_t __tocin_tcp_recv_into(int64_t fd, char *buf, int64_t off, int64_t max)
+    {
+        if (!buf || off < 0 || max <= 0) return -1;
+        return (int64_t)tocin_net_recv((int)fd, buf + off, (size_t)max);
+    }
+    int64_t __tocin_tcp_send_file(int64_t fd, const char *path, int64_t off, int64_t n)
+    {
+        if (!path || off < 0) return -1;
+        int file = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (file < 0) return -1;
+        struct stat st;
+        if (::fstat(file, &st) != 0 || !S_ISREG(st.st_mode) || off > (int64_t)st.st_size)
+        {
+            ::close(file);
+            return -1;
+        }
+        if (n < 0 || n > (int64_t)st.st_size - off) n = (int64_t)st.st_size - off;
+        int64_t sent = 0;
+#if defined(__linux__)
+        // The kernel copies page cache to the socket; the bytes never enter
+        // this process.
+        off_t pos = (off_t)off;
+        while (sent < n)
+        {
+            ssize_t k = ::sendfile((int)fd, file, &pos, (size_t)(n - sent));
+            if (k > 0) { sent += k; continue; }
+            if (k == 0) break; // the file shrank under us
+            if (errno == EINTR) continue;
+            if (tocin_net_would_block() && tocin_net_wait((int)fd, true)) continue;
+            sent = -1;
+            break;
+        }
+#else
+        std::vector<char> chunk(kNetScratch);
+        while (sent < n)
+        {
+            size_t want = (size_t)std::min<int64_t>(n - sent, (int64_t)chunk.size());
+            ssize_t k = ::pread(file, chunk.data(), want, (off_t)(off + sent));
+            if (k < 0 && errno == EINTR) continue;
+            if (k <= 0) break;
+            if (tocin_net_send_all((int)fd, chunk.data(), (size_t)k) < 0) { sent = -1; break; }
+            sent += k;
+        }
+#endif
+        ::close(file);
+        return sent;
+    }
+    void __tocin_tcp_close(int64_t fd)
+    {
+        if (fd < 0) return;
+        if (g_schedStarted.load()) LightweightScheduler::instance().forgetFd((int)fd);
+        ::close((int)fd);
+    }
+#else
+extern "C"
+{
+    int64_t __tocin_tcp_listen(int64_t) { return -1; }
+    int64_t __tocin_tcp_accept(int64_t) { return -1; }
+    int64_t __tocin_tcp_connect(const char *, int64_t) { return -1; }
+    int64_t __tocin_tcp_dns_ttl(int64_t) { return 0; }
+    int64_t __tocin_tcp_send(int64_t, const char *) { return -1; }
+    int64_t __tocin_tcp_send_buf(int64_t, const char *, int64_t, int64_t) { return -1; }
+    char *__tocin_tcp_recv(int64_t) { return tocin_str_empty(); }
+    int64_t __tocin_tcp_recv_into(int64_t, char *, int64_t, int64_t) { return -1; }
+    int64_t __tocin_tcp_send_file(int64_t, const char *, int64_t, int64_t) { return -1; }
+    void __tocin_tcp_close(int64_t) {}
+#endif
+}
+
+// ===========================================================================
+// TCP connection pools. tcpPoolGet hands out an idle connection to
+// host:port when the pool holds one that is still open, newest first, and
+// dials (through the DNS cache) otherwise; tcpPoolPut takes it back, up to
+// maxIdle per host:port, unless the caller says it cannot be reused. A
+// connection idle for longer than idleMs is closed by the next call that
+// touches its host:port, or by tcpPoolReap. The lock is never held across
+// a connect, so goroutines sharing a pool park on the netpoller as usual.
+//
+// Stats record (tcpPoolStats, 4 slots): [0] idle, [1] checked out,
+// [2] connections dialled, [3] reuses.
+// ===========================================================================
+#ifdef TOCIN_HAVE_POSIX_NET
+namespace
+{
+    struct TcpPool
+    {
+        struct Idle
+        {
+            int fd;
+            int64_t since; // tocin_net_now_ms() when it was put back
+        };
+
+        std::mutex mu;
+        size_t maxIdle;
+        int64_t idleMs;
+        std::map<std::string, std::vector<Idle>> idle; // oldest first
+        std::map<int, std::string> active;               // fd -> host:port
+        size_t idleCount = 0;
+        int64_t connects = 0, reuses = 0;
+
+        TcpPool(size_t max, int64_t ms) : maxIdle(max), idleMs(ms) {}
+
+        // Move the connections of `list` idle since before `cutoff` to dead.
+        void expire(std::vector<Idle> &list, int64_t cutoff, std::vector<int> &dead)
+        {
+            size_t n = 0;
+            while (n < list.size() && list[n].since < cutoff) dead.push_back(list[n++].fd);
+            list.erase(list.begin(), list.begin() + (ptrdiff_t)n);
+            idleCount -= n;
+        }
+    };
+
+    // Still open with nothing unread? Data nobody asked for means the
+    // previous exchange was not read to its end, so that counts as dead too.
+    bool tocin_net_reusable(int fd)
+    {
+        char c;
+        ssize_t n = ::recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return n < 0 && tocin_net_would_block();
+    }
+
+    void tocin_net_close_all(const std::vector<int> &fds)
+    {
+        for (int fd : fds) __tocin_tcp_close(fd);
+    }
+}
+
+extern "C"
+{
+    int64_t __tocin_tcp_pool_new(int64_t maxIdle, int64_t idleMs)
+    {
+        if (maxIdle < 0) maxIdle = 0;
+        if (idleMs <= 0) idleMs = INT64_MAX / 2;
+        return (int64_t)(uintptr_t)new TcpPool((size_t)maxIdle, idleMs);
+    }
+    int64_t __tocin_tcp_pool_get(int64_t h, const char *host, int64_t port)
+    {
+        auto *pool = reinterpret_cast<TcpPool *>((uintptr_t)h);
+        if (!pool || !host) return -1;
+        std::string key = tocin_net_key(host, port);
+        std::vector<int> dead;
+        int fd = -1;
+        {
+            std::lock_guard<std::mutex> lock(pool->mu);
+            auto it = pool->idle.find(key);
+            if (it != pool->idle.end())
+            {
+                pool->expire(it->second, tocin_net_now_ms() - pool->idleMs, dead);
+                while (fd < 0 && !it->second.empty())
+                {
+                    int c = it->second.back().fd;
+                    it->second.pop_back();
+                    --pool->idleCount;
+                    if (tocin_net_reusable(c)) fd = c;
+                    else dead.push_back(c);
+                }
+                if (fd >= 0)
+                {
+                    ++pool->reuses;
+                    pool->active[fd] = key;
+                }
+            }
+        }
+        tocin_net_close_all(dead);
+        if (fd >= 0) return fd;
+        int64_t c = __tocin_tcp_connect(host, port);
+        if (c < 0) return -1;
+        std::lock_guard<std::mutex> lock(pool->mu);
+        ++pool->connects;
+        pool->active[(int)c] = std::move(key);
+        return c;
+    }
+    // 1 if the connection went back to the pool, 0 if it was closed
+    // instead (not reusable, the host's idle list full, or gone), -1 if
+    // the pool never handed it out.
+    int64_t __tocin_tcp_pool_put(int64_t h, int64_t fd, int64_t reusable)
+    {
+        auto *pool = reinterpret_cast<TcpPool *>((uintptr_t)h);
+        if (!pool) return -1;
+        bool kept = false;
+        {
+            std::lock_guard<std::mutex> lock(pool->mu);
+            auto it = pool->active.find((int)fd);
+            if (it == pool->active.end()) return -1;
+            if (reusable != 0 && tocin_net_reusable((int)fd))
+            {
+                auto &list = pool->idle[it->second];
+                if (list.size() < pool->maxIdle)
+                {
+                    list.push_back({(int)fd, tocin_net_now_ms()});
+                    ++pool->idleCount;
+                    kept = true;
+                }
+            }
+            pool->active.erase(it);
+        }
+        if (!kept) __tocin_tcp_close(fd);
+        return kept ? 1 : 0;
+    }
+    // Close every connection idle for longer than the pool's idleMs; how many.
+    int64_t __tocin_tcp_pool_reap(int64_t h)
+    {
+        auto *pool = reinterpret_cast<TcpPool *>((uintptr_t)h);
+        if (!pool) return 0;
+        std::vector<int> dead;
+        {
+            std::lock_guard<std::mutex> lock(pool->mu);
+            int64_t cutoff = tocin_net_now_ms() - pool->idleMs;
+            for (auto it = pool->idle.begin(); it != pool->idle.end();)
+            {
+                pool->expire(it->second, cutoff, dead);
+                it = it->second.empty() ? pool->idle.erase(it) : std::next(it);
+            }
+        }
+        tocin_net_close_all(dead);
+        return (int64_t)dead.size();
+    }
+    int64_t __tocin_tcp_pool_stats(int64_t h, int64_t *rec)
+    {
+        auto *pool = reinterpret_cast<TcpPool *>((uintptr_t)h);
+        if (!pool || !rec) return -1;
+        std::lock_guard<std::mutex> lock(pool->mu);
+        rec[0] = (int64_t)pool->idleCount;
+        rec[1] = (int64_t)pool->active.size();
+        rec[2] = pool->connects;
+        rec[3] = pool->reuses;
+        return 0;
+    }
+    // Closes the idle connections and frees the pool. Connections still
+    // checked out stay open; their holders close them with tcpClose.
+    int64_t __tocin_tcp_pool_close(int64_t h)
+    {
+        auto *pool = reinterpret_cast<TcpPool *>((uintptr_t)h);
+        if (!pool) return 0;
+        std::vector<int> dead;
+        for (auto &entry : pool->idle)
+            for (const TcpPool::Idle &c : entry.second) dead.push_back(c.fd);
+        delete pool;
+        tocin_net_close_all(dead);
+        return 0;
+    }
+}
+#else
+extern "C"
+{
+    int64_t __tocin_tcp_pool_new(int64_t, int64_t) { return 0; }
+    int64_t __tocin_tcp_pool_get(int64_t, const char *, int64_t) { return -1; }
+    int64_t __tocin_tcp_pool_put(int64_t, int64_t, int64_t) { return -1; }
+    int64_t __tocin_tcp_pool_reap(int64_t) { return 0; }
+    int64_t __tocin_tcp_pool_stats(int64_t, int64_t *) { return -1; }
+    int64_t __tocin_tcp_pool_close(int64_t) { return 0; }
+}
+#endif
+
+// ===========================================================================
+// Runtime metrics (runtime_metrics.h). Channel contention is striped over
+// cache lines by thread, so two threads blocking at once do not bounce a
+// line; the scheduler and collector keep their own counters.
+//
+// Stats record (runtimeStats, 17 slots): [0] workers, [1] active fibers,
+// [2] completed fibers, [3] fibers stolen, [4] parks, [5] unparks,
+// [6] queued fibers, [7] busy ns, [8] idle ns, [9] receive waits,
+// [10] send waits, [11] select waits, [12] GC collections, [13] GC pause ns,
+// [14] longest GC pause ns, [15] GC heap bytes, [16] bytes allocated.
+// ===========================================================================
+namespace
+{
+    constexpr size_t kWaitStripes = 16;
+    constexpr int64_t kRuntimeStatsSlots = 17;
+
+    struct alignas(64) WaitStripe
+    {
+        std::atomic<uint64_t> waits[3]; // by ChannelWait
+    };
+    WaitStripe g_waitStripes[kWaitStripes];
+    std::atomic<size_t> g_nextWaitStripe{0};
+
+    WaitStripe &tocin_wait_stripe()
+    {
+        static thread_local WaitStripe *stripe =
+            &g_waitStripes[g_nextWaitStripe.fetch_add(1, std::memory_order_relaxed) % kWaitStripes];
+        return *stripe;
+    }
+
+    uint64_t tocin_wait_total(tocin::runtime::ChannelWait kind)
+    {
+        uint64_t n = 0;
+        for (const WaitStripe &s : g_waitStripes)
+            n += s.waits[(int)kind].load(std::memory_order_relaxed);
+        return n;
+    }
+
+    void tocin_metric(std::string &out, const char *name, const char *type, const char *help)
+    {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    void tocin_metric_value(std::string &out, const char *name, const std::string &labels, uint64_t v)
+    {
+        out += name;
+        out += labels;
+        out += ' ';
+        out += std::to_string(v);
+        out += '\n';
+    }
+
+    void tocin_metric_seconds(std::string &out, const char *name, const std::string &labels, uint64_t ns)
+    {
+        char num[32];
+        std::snprintf(num, sizeof(num), "%.9f", (double)ns / 1e9);
+        out += name;
+        out += labels;
+        out += ' ';
+        out += num;
+        out += '\n';
+    }
+}
+
+namespace tocin
+{
+namespace runtime
+{
+    void noteChannelWait(ChannelWait kind)
+    {
+        tocin_wait_stripe().waits[(int)kind].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    RuntimeMetrics runtimeMetrics()
+    {
+        RuntimeMetrics m{};
+        m.scheduler = LightweightScheduler::instance().getStats();
+        m.channelReceiveWaits = tocin_wait_total(ChannelWait::Receive);
+        m.channelSendWaits = tocin_wait_total(ChannelWait::Send);
+        m.selectWaits = tocin_wait_total(ChannelWait::Select);
+#ifdef TOCIN_HAVE_GC
+        tocin_gc_ensure_init();
+        m.gcEnabled = true;
+        m.gcCollections = g_gcCollections.load(std::memory_order_relaxed);
+        m.gcPauseNs = g_gcPauseNs.load(std::memory_order_relaxed);
+        m.gcMaxPauseNs = g_gcMaxPauseNs.load(std::memory_order_relaxed);
+        m.gcHeapBytes = GC_get_heap_size();
+        m.gcAllocatedBytes = GC_get_total_bytes();
+#endif
+        return m;
+    }
+
+    std::string formatMetrics(const RuntimeMetrics &m)
+    {
+        const auto &s = m.scheduler;
+        std::string out;
+        out.reserve(2048 + 512 * s.workers.size());
+        const std::string none;
+
+        tocin_metric(out, "tocin_sched_workers", "gauge", "Scheduler worker threads.");
+        tocin_metric_value(out, "tocin_sched_workers", none, s.totalWorkers);
+        tocin_metric(out, "tocin_sched_fibers_active", "gauge", "Goroutines spawned and not yet finished.");
+        tocin_metric_value(out, "tocin_sched_fibers_active", none, s.activeFibers);
+        tocin_metric(out, "tocin_sched_fibers_completed_total", "counter", "Goroutines finished.");
+        tocin_metric_value(out, "tocin_sched_fibers_completed_total", none, s.completedFibers);
+
+        // Per-worker families: one series per worker.
+        struct Family
+        {
+            const char *name, *type, *help;
+            uint64_t Worker::WorkerStats::*field;
+            bool seconds;
+        };
+        static const Family families[] = {
+            {"tocin_sched_fibers_executed_total", "counter", "Goroutines run to completion by the worker.",
+             &Worker::WorkerStats::fibersExecuted, false},
+            {"tocin_sched_fibers_stolen_total", "counter", "Goroutines other workers stole from the worker.",
+             &Worker::WorkerStats::fibersStolen, false},
+            {"tocin_sched_parks_total", "counter", "Goroutines the worker ran that parked.",
+             &Worker::WorkerStats::parks, false},
+            {"tocin_sched_unparks_total", "counter", "Parked goroutines woken onto the worker.",
+             &Worker::WorkerStats::unparks, false},
+            {"tocin_sched_queue_depth", "gauge", "Goroutines queued on the worker.",
+             &Worker::WorkerStats::queueDepth, false},
+            {"tocin_sched_busy_seconds_total", "counter", "Time the worker spent running goroutines.",
+             &Worker::WorkerStats::busyTimeNs, true},
+            {"tocin_sched_idle_seconds_total", "counter", "Time the worker spent waiting for work.",
+             &Worker::WorkerStats::idleTimeNs, true},
+        };
+        for (const Family &f : families)
+        {
+            tocin_metric(out, f.name, f.type, f.help);
+            for (size_t i = 0; i < s.workers.size(); ++i)
+            {
+                std::string labels = "{worker=\"" + std::to_string(i) + "\"}";
+                uint64_t v = s.workers[i].*f.field;
+                if (f.seconds)
+                    tocin_metric_seconds(out, f.name, labels, v);
+                else
+                    tocin_metric_value(out, f.name, labels, v);
+            }
+        }
+
+        tocin_metric(out, "tocin_channel_waits_total", "counter",
+                     "Channel operations that found nothing to do and waited.");
+        tocin_metric_value(out, "tocin_channel_waits_total", "{op=\"receive\"}", m.channelReceiveWaits);
+        tocin_metric_value(out, "tocin_channel_waits_total", "{op=\"send\"}", m.channelSendWaits);
+        tocin_metric_value(out, "tocin_channel_waits_total", "{op=\"select\"}", m.selectWaits);
+
+        if (m.gcEnabled)
+        {
+            tocin_metric(out, "tocin_gc_collections_total", "counter", "Garbage collections.");
+            tocin_metric_value(out, "tocin_gc_collections_total", none, m.gcCollections);
+            tocin_metric(out, "tocin_gc_pause_seconds_total", "counter", "Time collections held the world stopped.");
+            tocin_metric_seconds(out, "tocin_gc_pause_seconds_total", none, m.gcPauseNs);
+            tocin_metric(out, "tocin_gc_pause_max_seconds", "gauge", "Longest collection pause.");
+            tocin_metric_seconds(out, "tocin_gc_pause_max_seconds", none, m.gcMaxPauseNs);
+            tocin_metric(out, "tocin_gc_heap_bytes", "gauge", "Collected heap size.");
+            tocin_metric_value(out, "tocin_gc_heap_bytes", none, m.gcHeapBytes);
+            tocin_metric(out, "tocin_gc_allocated_bytes_total", "counter", "Bytes allocated from the collected heap.");
+            tocin_metric_value(out, "tocin_gc_allocated_bytes_total", none, m.gcAllocatedBytes);
+        }
+        return out;
+    }
+} // namespace runtime
+} // namespace tocin
+
+#ifdef TOCIN_HAVE_POSIX_NET
+namespace
+{
+    // A scraper gets this long to send its request head.
+    constexpr int kMetricsRecvTimeoutMs = 5000;
+
+    // Answer one scrape on fd and close it. The listening thread is a plain
+    // thread, so waits here are bounded polls rather than parks.
+    void tocin_metrics_answer(int fd)
+    {
+        char buf[4096];
+        size_t got = 0;
+        bool whole = false;
+        while (!whole && got < sizeof(buf))
+        {
+            ssize_t n = ::recv(fd, buf + got, sizeof(buf) - got, 0);
+            if (n > 0)
+            {
+                got += (size_t)n;
+                whole = std::string_view(buf, got).find("\r\n\r\n") != std::string_view::npos;
+                continue;
+            }
+            if (n == 0)
+                break;
+            if (errno == EINTR)
+                continue;
+            pollfd p{fd, POLLIN, 0};
+            if (!tocin_net_would_block() || ::poll(&p, 1, kMetricsRecvTimeoutMs) <= 0)
+                break;
+        }
+        if (whole)
+        {
+            std::string_view head(buf, got);
+            size_t sp = head.find(' ');
+            std::string_view method = head.substr(0, sp);
+            std::string_view target;
+            if (sp != std::string_view::npos)
+            {
+                target = head.substr(sp + 1);
+                target = target.substr(0, target.find_first_of(" ?\r"));
+            }
+            std::string body, status = "200 OK";
+            if (method != "GET" && method != "HEAD")
+                status = "405 Method Not Allowed";
+            else if (target != "/metrics" && target != "/")
+                status = "404 Not Found";
+            else
+                body = tocin::runtime::formatMetrics(tocin::runtime::runtimeMetrics());
+            std::string reply = "HTTP/1.1 " + status +
+                "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: " +
+                std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+            if (method != "HEAD")
+                reply += body;
+            tocin_net_send_all(fd, reply.data(), reply.size());
+        }
+        ::close(fd);
+    }
+}
+
+namespace tocin
+{
+namespace runtime
+{
+    int64_t serveMetrics(int64_t port)
+    {
+        int64_t fd = __tocin_tcp_listen(port);
+        if (fd < 0)
+            return -1;
+        std::thread([fd] {
+            for (;;)
+            {
+                int c = ::accept((int)fd, nullptr, nullptr);
+                if (c >= 0)
+                {
+                    tocin_net_nonblock(c);
+                    tocin_metrics_answer(c);
+                    continue;
+                }
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                pollfd p{(int)fd, POLLIN, 0};
+                if (!tocin_net_would_block() || ::poll(&p, 1, -1) < 0)
+                    return;
+            }
+        }).detach();
+        return fd;
+    }
+} // namespace runtime
+} // namespace tocin
+
+namespace
+{
+    // TOCIN_METRICS_PORT=<port> serves metrics from the start of the program.
+    struct MetricsFromEnv
+    {
+        MetricsFromEnv()
+        {
+            const char *port = std::getenv("TOCIN_METRICS_PORT");
+            if (port && *port && std::atoi(port) > 0)
+                tocin::runtime::serveMetrics(std::atoi(port));
+        }
+    } g_metricsFromEnv;
+}
+#else
+namespace tocin
+{
+namespace runtime
+{
+    int64_t serveMetrics(int64_t) { return -1; }
+} // namespace runtime
+} // namespace tocin
+#endif
+
+extern "C"
+{
+    int64_t __tocin_runtime_stats(int64_t *rec)
+    {
+        if (!rec) return -1;
+        tocin::runtime::RuntimeMetrics m = tocin::runtime::runtimeMetrics();
+        const auto &s = m.scheduler;
+        const uint64_t slots[kRuntimeStatsSlots] = {
+            s.totalWorkers, s.activeFibers, s.completedFibers, s.fibersStolen, s.parks, s.unparks,
+            s.queuedFibers, s.busyTimeNs, s.idleTimeNs, m.channelReceiveWaits, m.channelSendWaits,
+            m.selectWaits, m.gcCollections, m.gcPauseNs, m.gcMaxPauseNs, m.gcHeapBytes, m.gcAllocatedBytes};
+        for (int64_t i = 0; i < kRuntimeStatsSlots; ++i)
+            rec[i] = (int64_t)slots[i];
+        return kRuntimeStatsSlots;
+    }
+    char *__tocin_runtime_metrics()
+    {
+        std::string text = tocin::runtime::formatMetrics(tocin::runtime::runtimeMetrics());
+        return tocin_str_new(text.data(), text.size());
+    }
+    int64_t __tocin_runtime_metrics_serve(int64_t port)
+    {
+        return tocin::runtime::serveMetrics(port);
+    }
+}
+
+// ===========================================================================
+// Sampling profiler (sampling_profiler.h). TOCIN_PROFILE=<file> profiles the
+// whole process at TOCIN_PROFILE_HZ and writes the profile at exit. It lives
+// here, not in sampling_profiler.cpp, so that every program linking the
+// runtime archive has it.
+// ===========================================================================
+namespace
+{
+    std::string g_profilePath;
+
+    void tocin_profile_write_at_exit()
+    {
+        auto &profiler = tocin::runtime::SamplingProfiler::instance();
+        profiler.stop();
+        if (profiler.write(g_profilePath))
+            std::fprintf(stderr, "tocin: profile of %zu samples written to %s\n", profiler.sampleCount(),
+                         g_profilePath.c_str());
+        else
+            std::fprintf(stderr, "tocin: cannot write profile %s: %s\n", g_profilePath.c_str(),
+                         std::strerror(errno));
+    }
+
+    struct ProfileFromEnv
+    {
+        ProfileFromEnv()
+        {
+            const char *path = std::getenv("TOCIN_PROFILE");
+            if (!path || !*path)
+                return;
+            g_profilePath = path;
+            int hz = (int)tocin_env_size("TOCIN_PROFILE_HZ", tocin::runtime::SamplingProfiler::kDefaultHz);
+            if (tocin::runtime::SamplingProfiler::instance().start(hz))
+                std::atexit(tocin_profile_write_at_exit);
+        }
+    } g_profileFromEnv;
+}
+
+// ===========================================================================
+// Allocation profiler (alloc_profiler.h). TOCIN_ALLOC_PROFILE=<file> samples
+// one in TOCIN_ALLOC_PROFILE_RATE bytes from load to exit; TOCIN_HEAP_SNAPSHOT
+// =<file> walks the heap at exit. allocProfile(path) and heapSnapshot(path)
+// write either on demand and return 1, or 0 if the file cannot be written.
+// ===========================================================================
+namespace
+{
+    std::string g_allocProfilePath;
+    std::string g_heapSnapshotPath;
+
+    void tocin_alloc_profile_write_at_exit()
+    {
+        auto &profiler = tocin::runtime::AllocationProfiler::instance();
+        if (!g_heapSnapshotPath.empty())
+        {
+            if (profiler.writeHeapSnapshot(g_heapSnapshotPath))
+                std::fprintf(stderr, "tocin: heap snapshot written to %s\n", g_heapSnapshotPath.c_str());
+            else
+                std::fprintf(stderr, "tocin: cannot write heap snapshot %s: %s\n", g_heapSnapshotPath.c_str(),
+                             std::strerror(errno));
+        }
+        if (g_allocProfilePath.empty())
+            return;
+        profiler.stop();
+        if (profiler.write(g_allocProfilePath))
+            std::fprintf(stderr, "tocin: allocation profile of %zu samples written to %s\n",
+                         profiler.sampleCount(), g_allocProfilePath.c_str());
+        else
+            std::fprintf(stderr, "tocin: cannot write allocation profile %s: %s\n", g_allocProfilePath.c_str(),
+                         std::strerror(errno));
+    }
+
+    struct AllocProfileFromEnv
+    {
+        AllocProfileFromEnv()
+        {
+            const char *path = std::getenv("TOCIN_ALLOC_PROFILE");
+            const char *snapshot = std::getenv("TOCIN_HEAP_SNAPSHOT");
+            if (snapshot && *snapshot)
+                g_heapSnapshotPath = snapshot;
+            if (path && *path)
+            {
+                size_t rate = tocin_env_size("TOCIN_ALLOC_PROFILE_RATE",
+                                             tocin::runtime::AllocationProfiler::kDefaultRate);
+                if (tocin::runtime::AllocationProfiler::instance().start(rate))
+                    g_allocProfilePath = path;
+            }
+            if (!g_allocProfilePath.empty() || !g_heapSnapshotPath.empty())
+                std::atexit(tocin_alloc_profile_write_at_exit);
+        }
+    } g_allocProfileFromEnv;
+}
+
+extern "C"
+{
+    int64_t __tocin_alloc_profile_write(const char *path)
+    {
+        return path && tocin::runtime::AllocationProfiler::instance().write(path) ? 1 : 0;
+    }
+
+    int64_t __tocin_heap_snapshot(const char *path)
+    {
+        return path && tocin::runtime::AllocationProfiler::instance().writeHeapSnapshot(path) ? 1 : 0;
+    }
+
+    // allocCounting(on): start (1) or stop (0) counting; returns the previous
+    // setting. The counts accumulate across on/off periods.
+    int64_t __tocin_alloc_counting(int64_t on)
+    {
+        return g_allocCounting.exchange(on != 0) ? 1 : 0;
+    }
+
+    // allocCounts(rec): rec[0] = allocations counted, rec[1] = their bytes
+    // (withArena bump allocations excluded); returns 2.
+    int64_t __tocin_alloc_counts(int64_t *rec)
+    {
+        if (!rec) return -1;
+        rec[0] = g_allocCountObjects.load(std::memory_order_relaxed);
+        rec[1] = g_allocCountBytes.load(std::memory_order_relaxed);
+        return 2;
+    }
+}
+
+// ===========================================================================
+// HTTP/1.1 requests (see http_parser.h). A parsed request is a record of
+// int64 slots that points into the receive buffer instead of copying out
+// of it:
+//   [0] buffer address   [1..2] method off/len   [3..4] target off/len
+//   [5] minor version    [6..7] body off/len     [8] keep-alive (0/1)
+//   [9] chunked (0/1)    [10] header count       [11] Content-Length or -1
+//   [12] head length     [13 + 4i ..] header i: name off/len, value off/len
+// Offsets are from the buffer address. httpParse fills a caller's record
+// (kHttpRecordBytes, alloc'd) over a caller's buffer and leaves the body
+// empty; an httpConn owns both, reads a whole request (a Content-Length
+// body, or a chunked one decoded in place) and keeps whatever arrived after
+// it for the next call, so pipelined requests cost no extra reads. Its
+// record stays valid until the next httpConnNext. One from
+// httpClientConnNew reads responses into the same layout, except that [1]
+// is the status code and [3..4] the reason phrase.
+// ===========================================================================
+namespace
+{
+    constexpr size_t kHttpRecordSlots = 13 + 4 * tocin::runtime::kHttpMaxHeaders;
+
+    void tocin_http_store(int64_t *rec, const char *buf, const tocin::runtime::HttpMessageHead &h,
+                          int64_t headLen, size_t bodyOff, size_t bodyLen)
+    {
+        rec[0] = (int64_t)(uintptr_t)buf;
+        rec[5] = h.minorVersion;
+        rec[6] = (int64_t)bodyOff; rec[7] = (int64_t)bodyLen;
+        rec[8] = h.keepAlive ? 1 : 0;
+        rec[9] = h.chunked ? 1 : 0;
+        rec[10] = (int64_t)h.headerCount;
+        rec[11] = h.contentLength;
+        rec[12] = headLen;
+        int64_t *hp = rec + 13;
+        for (size_t i = 0; i < h.headerCount; ++i, hp += 4)
+        {
+            hp[0] = (int64_t)h.headers[i].name.off; hp[1] = (int64_t)h.headers[i].name.len;
+            hp[2] = (int64_t)h.headers[i].value.off; hp[3] = (int64_t)h.headers[i].value.len;
+        }
+    }
+
+    void tocin_http_store(int64_t *rec, const char *buf, const tocin::runtime::HttpRequestHead &h,
+                          int64_t headLen, size_t bodyOff, size_t bodyLen)
+    {
+        tocin_http_store(rec, buf, static_cast<const tocin::runtime::HttpMessageHead &>(h), headLen, bodyOff, bodyLen);
+        rec[1] = (int64_t)h.method.off; rec[2] = (int64_t)h.method.len;
+        rec[3] = (int64_t)h.path.off; rec[4] = (int64_t)h.path.len;
+    }
+
+    void tocin_http_store(int64_t *rec, const char *buf, const tocin::runtime::HttpResponseHead &h,
+                          int64_t headLen, size_t bodyOff, size_t bodyLen)
+    {
+        tocin_http_store(rec, buf, static_cast<const tocin::runtime::HttpMessageHead &>(h), headLen, bodyOff, bodyLen);
+        rec[1] = h.status; rec[2] = 0;
+        rec[3] = (int64_t)h.reason.off; rec[4] = (int64_t)h.reason.len;
+    }
+
+#ifdef TOCIN_HAVE_POSIX_NET
+    struct HttpConn
+    {
+        // A head that has not ended by kMaxHead bytes, or a body over
+        // kMaxBody, is refused rather than buffered.
+        static constexpr size_t kInitial = 16 * 1024;
+        static constexpr size_t kMaxHead = 64 * 1024;
+        static constexpr size_t kMaxBody = 64 * 1024 * 1024;
+
+        int fd;
+        bool client; // reads responses rather than requests
+        bool closed = false; // a body that ran to end of stream was the last
+        std::vector<char> buf;
+        size_t start = 0; // first byte of the current message
+        size_t end = 0;   // bytes held
+        size_t next = 0;  // first byte after the current message
+        // httpConnPending parses ahead; httpConnNext reuses that head.
+        size_t peekAt = SIZE_MAX;
+        int64_t peekLen = 0;
+        tocin::runtime::HttpRequestHead head, peek;
+        tocin::runtime::HttpResponseHead resp, peekResp;
+        int64_t rec[kHttpRecordSlots];
+
+        HttpConn(int f, bool isClient) : fd(f), client(isClient), buf(kInitial) {}
+
+        // Read more at `end`, growing the buffer when it is full: false at
+        // end of stream or on an error.
+        bool fill()
+        {
+            if (end == buf.size()) buf.resize(buf.size() * 2);
+            ssize_t n = tocin_net_recv(fd, buf.data() + end, buf.size() - end);
+            if (n <= 0) return false;
+            end += (size_t)n;
+            return true;
+        }
+
+        // Parse the head at `at` into peek/peekResp or head/resp.
+        int64_t parseHead(size_t at, bool ahead)
+        {
+            using namespace tocin::runtime;
+            if (client) return parseHttpResponse(buf.data(), at, end - at, ahead ? &peekResp : &resp);
+            return parseHttpRequest(buf.data(), at, end - at, ahead ? &peek : &head);
+        }
+        const tocin::runtime::HttpMessageHead &message(bool ahead) const
+        {
+            if (client) return ahead ? static_cast<const tocin::runtime::HttpMessageHead &>(peekResp) : resp;
+            return ahead ? static_cast<const tocin::runtime::HttpMessageHead &>(peek) : head;
+        }
+
+        // 1 with a request (or response) in rec, 0 once the peer is gone,
+        // -1 on one that is malformed or over the limits.
+        int64_t nextRequest()
+        {
+            using namespace tocin::runtime;
+            for (;;)
+            {
+                if (closed) return 0;
+                start = next;
+                if (start == end) start = end = next = 0;
+                else if (start > buf.size() / 2)
+                {
+                    // Keep the leftovers of a long pipelined run from growing the buffer.
+                    std::memmove(buf.data(), buf.data() + start, end - start);
+                    end -= start;
+                    start = next = 0;
+                    peekAt = SIZE_MAX;
+                }
+                int64_t headLen = 0;
+                if (peekAt == start)
+                {
+                    if (client) resp = peekResp;
+                    else head = peek;
+                    headLen = peekLen;
+                }
+                for (; headLen == 0;)
+                {
+                    headLen = parseHead(start, false);
+                    if (headLen == kHttpMalformed) return -1;
+                    if (headLen > 0) break;
+                    headLen = 0;
+                    if (end - start >= kMaxHead) return -1;
+                    // Nothing of this message is referenced yet, so its bytes
+                    // can move to the front before reading more.
+                    if (start > 0 && end == buf.size())
+                    {
+                        std::memmove(buf.data(), buf.data() + start, end - start);
+                        end -= start;
+                        start = 0;
+                    }
+                    if (!fill()) return 0;
+                }
+                peekAt = SIZE_MAX;
+                const HttpMessageHead &m = message(false);
+                size_t bodyOff = start + (size_t)headLen, bodyLen = 0;
+                if (client && resp.noBody)
+                {
+                    // Interim answers (100 Continue and the like) come
+                    // before the real one; 101 hands the connection over.
+                    if (resp.status < 200 && resp.status != 101)
+                    {
+                        next = bodyOff;
+                        continue;
+                    }
+                }
+                else if (client && resp.untilClose)
+                {
+                    while (fill())
+                        if (end - bodyOff > kMaxBody) return -1;
+                    bodyLen = end - bodyOff;
+                    closed = true;
+                }
+                else if (m.chunked)
+                {
+                    HttpChunkedDecoder dec;
+                    for (;;)
+                    {
+                        // Decoded bytes collect at bodyOff; undecoded input follows them.
+                        size_t raw = bodyOff + bodyLen, n = end - raw;
+                        int64_t rest = dec.decode(buf.data() + raw, &n);
+                        if (rest == kHttpMalformed) return -1;
+                        bodyLen += n;
+                        if (bodyLen > kMaxBody) return -1;
+                        if (rest >= 0)
+                        {
+                            end = bodyOff + bodyLen + (size_t)rest;
+                            break;
+                        }
+                        end = bodyOff + bodyLen;
+                        if (!fill()) return 0;
+                    }
+                }
+                else if (m.contentLength > 0)
+                {
+                    if ((size_t)m.contentLength > kMaxBody) return -1;
+                    bodyLen = (size_t)m.contentLength;
+                    if (buf.size() < bodyOff + bodyLen) buf.resize(bodyOff + bodyLen);
+                    while (end - bodyOff < bodyLen)
+                        if (!fill()) return 0;
+                }
+                next = bodyOff + bodyLen;
+                if (client) tocin_http_store(rec, buf.data(), resp, headLen, bodyOff, bodyLen);
+                else tocin_http_store(rec, buf.data(), head, headLen, bodyOff, bodyLen);
+                return 1;
+            }
+        }
+
+        // Is the next message already held in full, so that httpConnNext
+        // will not wait on the socket?
+        bool pending()
+        {
+            using namespace tocin::runtime;
+            if (next >= end) return false;
+            if (peekAt != next)
+            {
+                peekLen = parseHead(next, true);
+                if (peekLen <= 0) return false;
+                peekAt = next;
+            }
+            const HttpMessageHead &m = message(true);
+            if (client && (peekResp.untilClose || (peekResp.noBody && peekResp.status < 200))) return false;
+            if (m.chunked) return false;
+            size_t body = m.contentLength > 0 && !(client && peekResp.noBody) ? (size_t)m.contentLength : 0;
+            return end - next - (size_t)peekLen >= body;
+        }
+    };
+#endif
+}
+
+extern "C"
+{
+    int64_t __tocin_http_parse(const char *buf, int64_t off, int64_t len, int64_t *rec)
+    {
+        if (!buf || !rec || off < 0 || len < 0) return -1;
+        tocin::runtime::HttpRequestHead head;
+        int64_t n = tocin::runtime::parseHttpRequest(buf, (size_t)off, (size_t)len, &head);
+        if (n == tocin::runtime::kHttpIncomplete) return 0;
+        if (n < 0) return -1;
+        tocin_http_store(rec, buf, head, n, (size_t)(off + n), 0);
+        return n;
+    }
+    // The value of header `name` (any case) in a request record; "" if absent.
+    char *__tocin_http_header(const int64_t *rec, const char *name)
+    {
+        if (!rec || !name) return tocin_str_empty();
+        const char *buf = reinterpret_cast<const char *>((uintptr_t)rec[0]);
+        size_t nlen = tocin_str_length(name);
+        const int64_t *hp = rec + 13;
+        for (int64_t i = 0; i < rec[10]; ++i, hp += 4)
+        {
+            if ((size_t)hp[1] != nlen) continue;
+            const char *h = buf + hp[0];
+            size_t k = 0;
+            while (k < nlen && std::tolower((unsigned char)h[k]) == std::tolower((unsigned char)name[k])) ++k;
+            if (k == nlen) return tocin_str_new(buf + hp[2], (size_t)hp[3]);
+        }
+        return tocin_str_empty();
+    }
+#ifdef TOCIN_HAVE_POSIX_NET
+    int64_t __tocin_http_conn_new(int64_t fd)
+    {
+        if (fd < 0) return 0;
+        return (int64_t)(uintptr_t)new HttpConn((int)fd, false);
+    }
+    // The client side: httpConnNext reads responses, skipping interim 1xx
+    // ones, and a body with no length runs to the end of the connection.
+    int64_t __tocin_http_client_conn_new(int64_t fd)
+    {
+        if (fd < 0) return 0;
+        return (int64_t)(uintptr_t)new HttpConn((int)fd, true);
+    }
+    int64_t __tocin_http_conn_next(int64_t h)
     {
-        if (!s) return tocin_str_empty();
-        int64_t n = (int64_t)std::strlen(s);
-        if (start < 0) start = 0;
-        if (start > n) start = n;
-        if (len < 0) len = 0;
-        if (start + len > n) len = n - start;
-        char *out = (char *)__tocin_alloc_atomic((size_t)len + 1);
-        if (!out) return nullptr;
-        std::memcpy(out, s + start, (size_t)len);
-        out[len] = '\0';
-        return out;
+        auto *c = reinterpret_cast<HttpConn *>((uintptr_t)h);
+        return c ? c->nextRequest() : 0;
     }
-    int64_t __tocin_str_eq(const char *a, const char *b)
+    int64_t __tocin_http_conn_request(int64_t h)
     {
-        if (a == b) return 1;
-        if (!a || !b) return 0;
-        return std::strcmp(a, b) == 0 ? 1 : 0;
+        auto *c = reinterpret_cast<HttpConn *>((uintptr_t)h);
+        return c ? (int64_t)(uintptr_t)c->rec : 0;
     }
-    int64_t __tocin_str_cmp(const char *a, const char *b)
+    int64_t __tocin_http_conn_pending(int64_t h)
     {
-        if (!a) a = "";
-        if (!b) b = "";
-        int r = std::strcmp(a, b);
-        return r < 0 ? -1 : (r > 0 ? 1 : 0);
+        auto *c = reinterpret_cast<HttpConn *>((uintptr_t)h);
+        return c && c->pending() ? 1 : 0;
     }
-    int64_t __tocin_str_index_of_char(const char *s, int64_t c)
+    // Frees the buffer; the socket stays open for the caller to close.
+    int64_t __tocin_http_conn_free(int64_t h)
     {
-        if (!s) return -1;
-        for (int64_t i = 0; s[i]; ++i)
-            if ((unsigned char)s[i] == (unsigned char)c) return i;
-        return -1;
+        delete reinterpret_cast<HttpConn *>((uintptr_t)h);
+        return 0;
     }
-    char *__tocin_int_to_str(int64_t n)
+#else
+    int64_t __tocin_http_conn_new(int64_t) { return 0; }
+    int64_t __tocin_http_client_conn_new(int64_t) { return 0; }
+    int64_t __tocin_http_conn_next(int64_t) { return 0; }
+    int64_t __tocin_http_conn_request(int64_t) { return 0; }
+    int64_t __tocin_http_conn_pending(int64_t) { return 0; }
+    int64_t __tocin_http_conn_free(int64_t) { return 0; }
+#endif
+}
+
+// ===========================================================================
+// WebSocket frames and connections (see websocket.h). wsParseFrame fills a
+// record of int64 slots for the frame at buf + off and unmasks its payload
+// in place:
+//   [0] FIN  [1] RSV1 (compressed)  [2] opcode  [3] payload offset from buf
+//   [4] payload length  [5] masked
+// A wsConn handle does the rest for one upgraded socket: it reads through
+// the netpoller, reassembles fragmented messages in its receive buffer,
+// inflates permessage-deflate ones, answers pings and echoes a close, and
+// sends each message as one frame built in a reusable buffer. A message
+// stays valid until the next wsConnNext. One goroutine at a time may use a
+// connection.
+// ===========================================================================
+namespace
+{
+#ifdef TOCIN_HAVE_POSIX_NET
+    struct WsConn
     {
-        // Tight base-10 conversion: write digits back-to-front into a stack
-        // buffer, then one exact-size atomic allocation. This avoids snprintf's
-        // format-string parsing (its cost dominated string-heavy loops) and
-        // uses a non-scanned allocation since the result holds no pointers.
-        char tmp[20];              // enough for -9223372036854775808 + NUL
-        char *p = tmp + sizeof(tmp);
-        uint64_t mag = (n < 0) ? (uint64_t)0 - (uint64_t)n : (uint64_t)n; // handles INT64_MIN
-        do {
-            *--p = (char)('0' + (int)(mag % 10));
-            mag /= 10;
-        } while (mag != 0);
-        if (n < 0) *--p = '-';
-        size_t len = (size_t)(tmp + sizeof(tmp) - p);
-        char *out = (char *)__tocin_alloc_atomic(len + 1);
-        if (!out) return nullptr;
-        std::memcpy(out, p, len);
-        out[len] = '\0';
-        return out;
+        enum : int64_t { kClient = 1, kDeflate = 2, kNoContextTakeover = 4 };
+        // Shorter messages are not worth a deflate block.
+        static constexpr size_t kDeflateMin = 64;
+
+        int fd;
+        bool client;
+        bool closed = false;   // nothing more will be read
+        bool sentClose = false; // our close frame is out; only a close may follow
+        tocin::runtime::WsMessageReader reader;
+        std::unique_ptr<tocin::runtime::WsDeflate> deflate;
+        std::vector<char> inflated;
+        std::vector<char> out;
+        const char *data = nullptr;
+        size_t len = 0;
+        uint64_t maskState;
+
+        WsConn(int f, int64_t flags)
+            : fd(f), client((flags & kClient) != 0), reader(!client), out(4096)
+        {
+            if (flags & kDeflate)
+                deflate.reset(new tocin::runtime::WsDeflate((flags & kNoContextTakeover) != 0));
+            maskState = (uint64_t)(uintptr_t)this ^
+                        (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+        }
+
+        uint32_t nextMaskKey()
+        {
+            // splitmix64: a fresh key per frame, as clients must use.
+            uint64_t z = (maskState += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return (uint32_t)(z ^ (z >> 31));
+        }
+
+        // One frame holding p[0, n): the payload (deflated for a large
+        // enough data message) is placed after room for the longest header,
+        // the header written just before it, and the frame sent at once.
+        int64_t send(int opcode, const char *p, size_t n)
+        {
+            using namespace tocin::runtime;
+            if (sentClose) return -1;
+            if (opcode == kWsClose) sentClose = true;
+            size_t used = kWsMaxHeader;
+            bool compressed = deflate && opcode < kWsClose && n >= kDeflateMin;
+            if (compressed)
+            {
+                if (!deflate->compress(p, n, &out, &used)) return -1;
+            }
+            else
+            {
+                if (out.size() < used + n) out.resize(used + n);
+                if (n) std::memcpy(out.data() + used, p, n);
+                used += n;
+            }
+            size_t payload = used - kWsMaxHeader;
+            uint32_t key = client ? nextMaskKey() : 0;
+            if (client) wsMask(out.data() + kWsMaxHeader, payload, key);
+            size_t h = wsHeaderLen(payload, client);
+            char *frame = out.data() + kWsMaxHeader - h;
+            wsWriteHeader(frame, true, compressed, opcode, payload, client, key);
+            return tocin_net_send_all(fd, frame, h + payload) < 0 ? -1 : (int64_t)n;
+        }
+
+        // The next message's opcode (text, binary, close or pong), 0 once
+        // the connection is over, -1 on a protocol error.
+        int64_t next()
+        {
+            using namespace tocin::runtime;
+            if (closed) return 0;
+            for (;;)
+            {
+                WsMessage m;
+                int64_t r = reader.next(&m);
+                if (r == kWsMalformed)
+                {
+                    const char status[2] = {(char)(1002 >> 8), (char)(1002 & 255)}; // protocol error
+                    send(kWsClose, status, 2);
+                    closed = true;
+                    return -1;
+                }
+                if (r == kWsIncomplete)
+                {
+                    size_t avail = 0;
+                    char *p = reader.space(4096, &avail);
+                    ssize_t n = tocin_net_recv(fd, p, avail);
+                    if (n <= 0) { closed = true; return 0; }
+                    reader.commit((size_t)n);
+                    continue;
+                }
+                if (m.opcode == kWsPing)
+                {
+                    if (send(kWsPong, m.data, m.len) < 0) { closed = true; return 0; }
+                    continue;
+                }
+                if (m.opcode == kWsClose)
+                {
+                    // Echo the status code unless this answers our own
+                    // close, then stop reading.
+                    if (!sentClose) send(kWsClose, m.data, m.len >= 2 ? 2 : 0);
+                    closed = true;
+                }
+                if (m.compressed)
+                {
+                    size_t used = 0;
+                    if (!deflate || !deflate->decompress(m.data, m.len, &inflated, &used, 64u << 20))
+                    {
+                        closed = true;
+                        return -1;
+                    }
+                    data = inflated.data();
+                    len = used;
+                }
+                else
+                {
+                    data = m.data;
+                    len = m.len;
+                }
+                return m.opcode;
+            }
+        }
+    };
+#endif
+}
+
+extern "C"
+{
+    // XOR buf[off, off + n) with the 4-byte key (first wire byte key >> 24).
+    int64_t __tocin_ws_mask(char *buf, int64_t off, int64_t n, int64_t key)
+    {
+        if (!buf || off < 0 || n <= 0) return 0;
+        tocin::runtime::wsMask(buf + off, (size_t)n, (uint32_t)key);
+        return 0;
     }
-    int64_t __tocin_str_to_int(const char *s) { return s ? (int64_t)std::atoll(s) : 0; }
-    double __tocin_str_to_float(const char *s) { return s ? std::atof(s) : 0.0; }
-    char *__tocin_float_to_str(double d)
+    // A single FIN frame of src[0, len) at dst, masked with `key` when
+    // `masked` is set; the frame's length.
+    int64_t __tocin_ws_write_frame(char *dst, int64_t opcode, const char *src, int64_t len,
+                                   int64_t masked, int64_t key)
     {
-        char buf[64];
-        int len = std::snprintf(buf, sizeof(buf), "%g", d);
-        if (len < 0) return tocin_str_empty();
-        char *out = (char *)__tocin_alloc_atomic((size_t)len + 1);
-        if (!out) return nullptr;
-        std::memcpy(out, buf, (size_t)len + 1);
-        return out;
+        if (!dst || len < 0 || (len > 0 && !src)) return -1;
+        size_t h = tocin::runtime::wsWriteHeader(dst, true, false, (int)opcode, (uint64_t)len,
+                                                 masked != 0, (uint32_t)key);
+        if (len > 0) std::memmove(dst + h, src, (size_t)len);
+        if (masked) tocin::runtime::wsMask(dst + h, (size_t)len, (uint32_t)key);
+        return (int64_t)h + len;
     }
-    char *__tocin_char_to_str(int64_t c)
+    // The frame at buf[off, off + len): its total length once it is all
+    // there (payload unmasked, rec filled), 0 before, -1 if malformed.
+    int64_t __tocin_ws_parse_frame(char *buf, int64_t off, int64_t len, int64_t *rec)
     {
-        char *out = (char *)__tocin_alloc_atomic(2);
-        if (!out) return nullptr;
-        out[0] = (char)(unsigned char)c;
-        out[1] = '\0';
-        return out;
+        if (!buf || !rec || off < 0 || len < 0) return -1;
+        tocin::runtime::WsFrame f;
+        int64_t h = tocin::runtime::parseWsFrame(buf + off, (size_t)len, &f);
+        if (h == tocin::runtime::kWsMalformed) return -1;
+        if (h < 0 || (uint64_t)(len - h) < f.payloadLen) return 0;
+        if (f.masked) tocin::runtime::wsMask(buf + off + h, (size_t)f.payloadLen, f.key);
+        rec[0] = f.fin; rec[1] = f.rsv1; rec[2] = f.opcode;
+        rec[3] = off + h; rec[4] = (int64_t)f.payloadLen; rec[5] = f.masked;
+        return h + (int64_t)f.payloadLen;
     }
-    char *__tocin_str_concat(const char *a, const char *b)
+#ifdef TOCIN_HAVE_POSIX_NET
+    int64_t __tocin_ws_conn_new(int64_t fd, int64_t flags)
     {
-        if (!a) a = "";
-        if (!b) b = "";
-        size_t la = std::strlen(a), lb = std::strlen(b);
-        char *out = (char *)__tocin_alloc_atomic(la + lb + 1);
-        if (!out) return nullptr;
-        std::memcpy(out, a, la);
-        std::memcpy(out + la, b, lb + 1);
-        return out;
+        if (fd < 0) return 0;
+        return (int64_t)(uintptr_t)new WsConn((int)fd, flags);
     }
-
-    // Case conversion (fresh malloc'd copies).
-    char *__tocin_str_to_upper(const char *s)
+    int64_t __tocin_ws_conn_next(int64_t h)
     {
-        if (!s) return tocin_str_empty();
-        size_t n = std::strlen(s);
-        char *out = (char *)__tocin_alloc_atomic(n + 1);
-        if (!out) return nullptr;
-        for (size_t i = 0; i < n; ++i)
-            out[i] = (char)std::toupper((unsigned char)s[i]);
-        out[n] = '\0';
-        return out;
+        auto *c = reinterpret_cast<WsConn *>((uintptr_t)h);
+        return c ? c->next() : 0;
     }
-    char *__tocin_str_to_lower(const char *s)
+    int64_t __tocin_ws_conn_data(int64_t h)
     {
-        if (!s) return tocin_str_empty();
-        size_t n = std::strlen(s);
-        char *out = (char *)__tocin_alloc_atomic(n + 1);
-        if (!out) return nullptr;
-        for (size_t i = 0; i < n; ++i)
-            out[i] = (char)std::tolower((unsigned char)s[i]);
-        out[n] = '\0';
-        return out;
+        auto *c = reinterpret_cast<WsConn *>((uintptr_t)h);
+        return c ? (int64_t)(uintptr_t)c->data : 0;
     }
-    // Substring search: index of first occurrence, or -1.
-    int64_t __tocin_str_index_of(const char *s, const char *sub)
+    int64_t __tocin_ws_conn_len(int64_t h)
     {
-        if (!s || !sub) return -1;
-        const char *p = std::strstr(s, sub);
-        return p ? (int64_t)(p - s) : -1;
+        auto *c = reinterpret_cast<WsConn *>((uintptr_t)h);
+        return c ? (int64_t)c->len : 0;
     }
-    int64_t __tocin_str_contains(const char *s, const char *sub)
+    char *__tocin_ws_conn_text(int64_t h)
     {
-        return __tocin_str_index_of(s, sub) >= 0 ? 1 : 0;
+        auto *c = reinterpret_cast<WsConn *>((uintptr_t)h);
+        if (!c || !c->data) return tocin_str_empty();
+        return tocin_str_new(c->data, c->len);
     }
-    int64_t __tocin_str_starts_with(const char *s, const char *pre)
+    int64_t __tocin_ws_conn_send(int64_t h, int64_t opcode, const char *buf, int64_t off, int64_t n)
     {
-        if (!s || !pre) return 0;
-        size_t lp = std::strlen(pre);
-        return std::strncmp(s, pre, lp) == 0 ? 1 : 0;
+        auto *c = reinterpret_cast<WsConn *>((uintptr_t)h);
+        if (!c || off < 0 || n < 0 || (n > 0 && !buf)) return -1;
+        return c->send((int)opcode, buf ? buf + off : nullptr, (size_t)n);
     }
-    int64_t __tocin_str_ends_with(const char *s, const char *suf)
+    int64_t __tocin_ws_conn_send_text(int64_t h, const char *s)
     {
-        if (!s || !suf) return 0;
-        size_t ls = std::strlen(s), lf = std::strlen(suf);
-        if (lf > ls) return 0;
-        return std::strcmp(s + (ls - lf), suf) == 0 ? 1 : 0;
+        auto *c = reinterpret_cast<WsConn *>((uintptr_t)h);
+        if (!c) return -1;
+        return c->send(tocin::runtime::kWsText, s ? s : "", s ? tocin_str_length(s) : 0);
     }
-
-    // Explicit deallocation for programs that want to manage memory. Safe to
-    // call under GC (hint to the collector); a no-op-equivalent if already
-    // unreachable. Only free a buffer you own and never use it again.
-    void __tocin_free(void *p)
+    // Frees the buffers; the socket stays open for the caller to close.
+    int64_t __tocin_ws_conn_free(int64_t h)
     {
-        if (!p) return;
-#ifdef TOCIN_HAVE_GC
-        GC_free(p);
+        delete reinterpret_cast<WsConn *>((uintptr_t)h);
+        return 0;
+    }
 #else
-        std::free(p);
+    int64_t __tocin_ws_conn_new(int64_t, int64_t) { return 0; }
+    int64_t __tocin_ws_conn_next(int64_t) { return 0; }
+    int64_t __tocin_ws_conn_data(int64_t) { return 0; }
+    int64_t __tocin_ws_conn_len(int64_t) { return 0; }
+    char *__tocin_ws_conn_text(int64_t) { return tocin_str_empty(); }
+    int64_t __tocin_ws_conn_send(int64_t, int64_t, const char *, int64_t, int64_t) { return -1; }
+    int64_t __tocin_ws_conn_send_text(int64_t, const char *) { return -1; }
+    int64_t __tocin_ws_conn_free(int64_t) { return 0; }
 #endif
-    }
 }
 
 // ===========================================================================
-// File I/O. Strings are NUL-terminated char*. Returned buffers are malloc'd
-// and owned by the caller; read errors yield an empty string (use len/strLen
-// safely). Write/append return bytes written, or -1 on error.
+// JSON documents (see json_parser.h). A document handle is a JsonDocument's
+// address and a value is a tape index within it: the root is 1, and 0 -
+// what every lookup returns for a missing key, index or path - reads as
+// absent everywhere. Accessors walk the tape without building anything;
+// only jsonFastString allocates, for the string it returns. Values stay
+// valid until the document is parsed into again or freed. A jsonStream
+// reads NDJSON (one document per line, blank lines skipped) from a file or
+// a string, parsing each line into the one document it owns.
 // ===========================================================================
-extern "C"
+namespace
 {
-    char *__tocin_read_file(const char *path)
+    using tocin::runtime::JsonDocument;
+
+    JsonDocument *tocin_json_doc(int64_t h) { return reinterpret_cast<JsonDocument *>((uintptr_t)h); }
+
+    // Inline caches for jsonFastGet and jsonFastPointer. A key or path is
+    // almost always a literal, so its address stands for the call site; each
+    // thread keeps, per address, where the key was found relative to its
+    // object (JsonDocument::find's hint). Reading the same fields from
+    // document after document of one shape then costs one guarded key
+    // compare per step instead of a scan. A slot taken over by another key
+    // just starts over.
+    constexpr size_t kJsonCacheSlots = 256;
+    constexpr size_t kJsonPathHints = 8;
+
+    struct JsonFieldCache
     {
-        if (!path) return tocin_str_empty();
-        FILE *f = std::fopen(path, "rb");
-        if (!f) return tocin_str_empty();
-        if (std::fseek(f, 0, SEEK_END) != 0) { std::fclose(f); return tocin_str_empty(); }
-        long sz = std::ftell(f);
-        if (sz < 0) { std::fclose(f); return tocin_str_empty(); }
-        std::rewind(f);
-        char *buf = (char *)__tocin_alloc((size_t)sz + 1);
-        if (!buf) { std::fclose(f); return tocin_str_empty(); }
-        size_t got = std::fread(buf, 1, (size_t)sz, f);
-        std::fclose(f);
-        buf[got] = '\0';
-        return buf;
-    }
-    int64_t __tocin_write_file(const char *path, const char *contents)
+        const char *key;
+        uint32_t hint;
+    };
+    struct JsonPathCache
     {
-        if (!path || !contents) return -1;
-        FILE *f = std::fopen(path, "wb");
-        if (!f) return -1;
-        size_t len = std::strlen(contents);
-        size_t wrote = std::fwrite(contents, 1, len, f);
-        if (std::fclose(f) != 0) return -1;
-        return (wrote == len) ? (int64_t)wrote : -1;
+        const char *path;
+        uint32_t hints[kJsonPathHints];
+    };
+
+    size_t tocin_json_cache_slot(const char *key) { return ((uintptr_t)key >> 4) % kJsonCacheSlots; }
+
+    uint32_t *tocin_json_field_hint(const char *key)
+    {
+        static thread_local JsonFieldCache cache[kJsonCacheSlots];
+        JsonFieldCache &c = cache[tocin_json_cache_slot(key)];
+        if (c.key != key) c = JsonFieldCache{key, 0};
+        return &c.hint;
     }
-    int64_t __tocin_append_file(const char *path, const char *contents)
+
+    uint32_t *tocin_json_path_hints(const char *path)
     {
-        if (!path || !contents) return -1;
-        FILE *f = std::fopen(path, "ab");
-        if (!f) return -1;
-        size_t len = std::strlen(contents);
-        size_t wrote = std::fwrite(contents, 1, len, f);
-        if (std::fclose(f) != 0) return -1;
-        return (wrote == len) ? (int64_t)wrote : -1;
+        static thread_local JsonPathCache cache[kJsonCacheSlots];
+        JsonPathCache &c = cache[tocin_json_cache_slot(path)];
+        if (c.path != path) c = JsonPathCache{path, {}};
+        return c.hints;
     }
-    char *__tocin_read_line()
+
+    struct JsonStream
     {
-        size_t cap = 128, n = 0;
-        char *buf = (char *)__tocin_alloc(cap);
-        if (!buf) return tocin_str_empty();
-        int c;
-        while ((c = std::fgetc(stdin)) != EOF && c != '\n')
+        std::unique_ptr<tocin::runtime::FileReader> file;
+        std::string text;
+        size_t pos = 0;
+        JsonDocument doc;
+
+        bool nextLine(const char **p, size_t *n)
+        {
+            if (file) return file->nextRecord('\n', p, n);
+            if (pos >= text.size()) return false;
+            *p = text.data() + pos;
+            const void *nl = std::memchr(*p, '\n', text.size() - pos);
+            *n = nl ? (size_t)(static_cast<const char *>(nl) - *p) : text.size() - pos;
+            pos += *n + 1;
+            return true;
+        }
+
+        // 1 with the next document parsed, 0 at the end, -1 for a
+        // malformed line (the stream goes on with the next one).
+        int64_t next()
         {
-            if (n + 1 >= cap)
+            const char *p;
+            size_t n;
+            while (nextLine(&p, &n))
             {
-                cap *= 2;
-                char *nb = (char *)__tocin_realloc(buf, cap);
-                if (!nb) { std::free(buf); return tocin_str_empty(); }
-                buf = nb;
+                size_t i = 0;
+                while (i < n && (p[i] == ' ' || p[i] == '\t' || p[i] == '\r')) ++i;
+                if (i == n) continue;
+                return doc.parse(p, n) ? 1 : -1;
             }
-            buf[n++] = (char)c;
+            return 0;
         }
-        buf[n] = '\0';
-        return buf;
-    }
+    };
 }
 
-// Small helper: copy n bytes into a fresh GC-managed, NUL-terminated buffer
-// (__tocin_alloc is defined earlier in this file).
-namespace { char *tocin_dup(const char *s, size_t n) {
-    char *out = (char *)__tocin_alloc(n + 1);
-    if (!out) return nullptr;
-    std::memcpy(out, s, n);
-    out[n] = '\0';
-    return out;
-} }
-
-// ===========================================================================
-// Time. Wall-clock (epoch) and a monotonic clock for measuring durations.
-// ===========================================================================
 extern "C"
 {
-    int64_t __tocin_time_sec()
+    // A new document holding s, or 0 if s is not well-formed JSON.
+    int64_t __tocin_json_parse_fast(const char *s)
     {
-        using namespace std::chrono;
-        return (int64_t)duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+        auto *d = new JsonDocument();
+        if (!s || !d->parse(s, tocin_str_length(s)))
+        {
+            delete d;
+            return 0;
+        }
+        return (int64_t)(uintptr_t)d;
     }
-    int64_t __tocin_time_ms()
+    int64_t __tocin_json_doc_new() { return (int64_t)(uintptr_t)new JsonDocument(); }
+    // Reparse a document from buf[off, off + n), keeping its buffers: the
+    // root (1), or 0 if malformed.
+    int64_t __tocin_json_parse_into(int64_t h, const char *buf, int64_t off, int64_t n)
     {
-        using namespace std::chrono;
-        return (int64_t)duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+        JsonDocument *d = tocin_json_doc(h);
+        if (!d || !buf || off < 0 || n < 0) return 0;
+        return d->parse(buf + off, (size_t)n) ? (int64_t)JsonDocument::kRoot : 0;
     }
-    int64_t __tocin_mono_nanos()
+    int64_t __tocin_json_doc_free(int64_t h)
     {
-        using namespace std::chrono;
-        return (int64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+        delete tocin_json_doc(h);
+        return 0;
     }
-    void __tocin_sleep_ms(int64_t ms)
+    // JSON_NULL .. JSON_OBJECT as in std.json, -1 for an absent value.
+    int64_t __tocin_json_type(int64_t h, int64_t v)
     {
-        if (ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        JsonDocument *d = tocin_json_doc(h);
+        return d && v > 0 ? d->type((size_t)v) : -1;
     }
-}
-
-// ===========================================================================
-// Hashing. FNV-1a (64-bit) for strings/bytes and a splitmix64 integer mixer.
-// Stable across runs — suitable for content addressing (a VCS object store),
-// hash tables, and bloom filters.
-// ===========================================================================
-extern "C"
-{
-    int64_t __tocin_hash_bytes(const void *p, int64_t n)
+    int64_t __tocin_json_len(int64_t h, int64_t v)
     {
-        const unsigned char *b = (const unsigned char *)p;
-        uint64_t h = 1469598103934665603ULL; // FNV offset basis
-        for (int64_t i = 0; b && i < n; ++i) { h ^= b[i]; h *= 1099511628211ULL; }
-        return (int64_t)h;
+        JsonDocument *d = tocin_json_doc(h);
+        return d && v > 0 ? (int64_t)d->length((size_t)v) : 0;
     }
-    int64_t __tocin_hash_str(const char *s)
+    int64_t __tocin_json_first(int64_t h, int64_t v)
     {
-        if (!s) return (int64_t)1469598103934665603ULL;
-        return __tocin_hash_bytes(s, (int64_t)std::strlen(s));
+        JsonDocument *d = tocin_json_doc(h);
+        return d && v > 0 ? (int64_t)d->first((size_t)v) : 0;
     }
-    int64_t __tocin_hash_int(int64_t x)
+    int64_t __tocin_json_next(int64_t h, int64_t v)
     {
-        uint64_t z = (uint64_t)x + 0x9E3779B97F4A7C15ULL;
-        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
-        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
-        return (int64_t)(z ^ (z >> 31));
+        JsonDocument *d = tocin_json_doc(h);
+        return d && v > 0 ? (int64_t)d->next((size_t)v) : 0;
     }
-}
-
-// ===========================================================================
-// Pseudo-random numbers. A per-thread xorshift64* generator. Deterministic
-// given a seed — good for simulations, sampling, and tests (not cryptography).
-// ===========================================================================
-namespace {
-    thread_local uint64_t g_rngState = 0x853c49e6748fea9bULL;
-}
-extern "C"
-{
-    void __tocin_rand_seed(int64_t seed)
+    int64_t __tocin_json_value(int64_t h, int64_t k)
     {
-        g_rngState = (uint64_t)seed ? (uint64_t)seed : 0x853c49e6748fea9bULL;
+        JsonDocument *d = tocin_json_doc(h);
+        return d && k > 0 ? (int64_t)d->value((size_t)k) : 0;
     }
-    int64_t __tocin_rand_next()
+    int64_t __tocin_json_at(int64_t h, int64_t v, int64_t i)
     {
-        uint64_t x = g_rngState;
-        x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
-        g_rngState = x;
-        uint64_t r = x * 0x2545F4914F6CDD1DULL;
-        return (int64_t)(r >> 1); // non-negative
+        JsonDocument *d = tocin_json_doc(h);
+        return d && v > 0 && i >= 0 ? (int64_t)d->at((size_t)v, (size_t)i) : 0;
     }
-    int64_t __tocin_rand_range(int64_t lo, int64_t hi)
+    int64_t __tocin_json_get(int64_t h, int64_t v, const char *key)
     {
-        if (hi <= lo) return lo;
-        uint64_t span = (uint64_t)(hi - lo);
-        return lo + (int64_t)((uint64_t)__tocin_rand_next() % span);
+        JsonDocument *d = tocin_json_doc(h);
+        if (!d || v <= 0 || !key) return 0;
+        return (int64_t)d->find((size_t)v, key, tocin_str_length(key), tocin_json_field_hint(key));
+    }
+    int64_t __tocin_json_pointer(int64_t h, int64_t v, const char *path)
+    {
+        JsonDocument *d = tocin_json_doc(h);
+        if (!d || v <= 0 || !path) return 0;
+        return (int64_t)d->pointer((size_t)v, path, tocin_str_length(path), tocin_json_path_hints(path),
+                                   kJsonPathHints);
+    }
+    int64_t __tocin_json_int(int64_t h, int64_t v)
+    {
+        JsonDocument *d = tocin_json_doc(h);
+        return d && v > 0 ? d->asInt((size_t)v) : 0;
+    }
+    double __tocin_json_float(int64_t h, int64_t v)
+    {
+        JsonDocument *d = tocin_json_doc(h);
+        return d && v > 0 ? d->asFloat((size_t)v) : 0.0;
+    }
+    int64_t __tocin_json_bool(int64_t h, int64_t v)
+    {
+        JsonDocument *d = tocin_json_doc(h);
+        return d && v > 0 && d->asBool((size_t)v) ? 1 : 0;
+    }
+    // A string value or object key as a fresh string; "" for anything else.
+    char *__tocin_json_string(int64_t h, int64_t v)
+    {
+        JsonDocument *d = tocin_json_doc(h);
+        const char *p;
+        size_t n;
+        if (!d || v <= 0 || !d->string((size_t)v, &p, &n)) return tocin_str_empty();
+        return tocin_str_new(p, n);
+    }
+    // Whether a string value or key equals s, compared where it lies.
+    int64_t __tocin_json_str_eq(int64_t h, int64_t v, const char *s)
+    {
+        JsonDocument *d = tocin_json_doc(h);
+        const char *p;
+        size_t n;
+        if (!d || v <= 0 || !s || !d->string((size_t)v, &p, &n)) return 0;
+        return n == tocin_str_length(s) && std::memcmp(p, s, n) == 0 ? 1 : 0;
+    }
+    int64_t __tocin_json_stream_open(const char *path)
+    {
+        tocin::runtime::FileReader *r = path ? tocin::runtime::FileReader::open(path) : nullptr;
+        if (!r) return 0;
+        auto *st = new JsonStream();
+        st->file.reset(r);
+        return (int64_t)(uintptr_t)st;
+    }
+    int64_t __tocin_json_stream_of(const char *text)
+    {
+        auto *st = new JsonStream();
+        if (text) st->text.assign(text, tocin_str_length(text));
+        return (int64_t)(uintptr_t)st;
+    }
+    int64_t __tocin_json_stream_next(int64_t h)
+    {
+        auto *st = reinterpret_cast<JsonStream *>((uintptr_t)h);
+        return st ? st->next() : 0;
+    }
+    // The stream's document, holding the line jsonStreamNext last parsed;
+    // it belongs to the stream.
+    int64_t __tocin_json_stream_doc(int64_t h)
+    {
+        auto *st = reinterpret_cast<JsonStream *>((uintptr_t)h);
+        return st ? (int64_t)(uintptr_t)&st->doc : 0;
+    }
+    int64_t __tocin_json_stream_close(int64_t h)
+    {
+        delete reinterpret_cast<JsonStream *>((uintptr_t)h);
+        return 0;
     }
 }
 
 // ===========================================================================
-// TCP networking (POSIX sockets). File descriptors are returned as int64.
-// These are the primitives a microservice or client needs; combine with `go`
-// goroutines for a concurrent server. Errors return -1 / empty string.
+// Standard output. print/println compile to one __tocin_print_begin ..
+// __tocin_print_end bracket per statement, with a call per literal segment
+// and per argument in between: text is copied and numbers are converted
+// straight into stdout's buffer, with no format string and no per-call
+// locking. The runtime gives stdout a 64 KiB buffer at load, line-buffered
+// on a terminal and written only when full otherwise (and at exit, after
+// __tocin_join_all); being stdio's own buffer, output from C code calling
+// printf stays in order with it. The bracket holds stdout's lock, so
+// statements from different goroutines never interleave; the arguments are
+// evaluated before it is taken.
 // ===========================================================================
+namespace
+{
+    struct TocinStdout
+    {
+        static constexpr size_t kCap = 64 * 1024;
+        bool tty = false;
+        char buf[kCap];
+
+        TocinStdout()
+        {
+#if defined(_WIN32)
+            tty = _isatty(_fileno(stdout)) != 0;
+#elif defined(TOCIN_HAVE_POSIX_NET)
+            tty = ::isatty(STDOUT_FILENO) != 0;
+#endif
+            std::setvbuf(stdout, buf, tty ? _IOLBF : _IOFBF, kCap);
+        }
+    };
+
+    // Before main, so it precedes any output. Never destroyed: stdio writes
+    // the buffer out after static destructors have run.
+    TocinStdout &g_stdout = *new TocinStdout();
+
+    bool tocin_stdout_is_tty() { return g_stdout.tty; }
+
+    void tocin_stdout_append(const char *p, size_t n)
+    {
+#if defined(_WIN32)
+        _fwrite_nolock(p, 1, n, stdout);
+#elif defined(__GLIBC__)
+        fwrite_unlocked(p, 1, n, stdout);
+#else
+        std::fwrite(p, 1, n, stdout); // the lock is recursive
+#endif
+    }
+}
+
 extern "C"
 {
-#ifdef TOCIN_HAVE_POSIX_NET
-    int64_t __tocin_tcp_listen(int64_t port)
+    void __tocin_print_begin()
     {
-        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
-        if (fd < 0) return -1;
-        int yes = 1;
-        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
-        sockaddr_in addr; std::memset(&addr, 0, sizeof(addr));
-        addr.sin_family = AF_INET;
-        addr.sin_addr.s_addr = htonl(INADDR_ANY);
-        addr.sin_port = htons((uint16_t)port);
-        if (::bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0) { ::close(fd); return -1; }
-        if (::listen(fd, 16) < 0) { ::close(fd); return -1; }
-        return (int64_t)fd;
+#if defined(_WIN32)
+        _lock_file(stdout);
+#elif defined(TOCIN_HAVE_POSIX_NET)
+        flockfile(stdout);
+#endif
     }
-    int64_t __tocin_tcp_accept(int64_t fd)
+    void __tocin_print_end()
     {
-        int c = ::accept((int)fd, nullptr, nullptr);
-        return c < 0 ? -1 : (int64_t)c;
+#if defined(_WIN32)
+        _unlock_file(stdout);
+#elif defined(TOCIN_HAVE_POSIX_NET)
+        funlockfile(stdout);
+#endif
     }
-    int64_t __tocin_tcp_connect(const char *host, int64_t port)
+    void __tocin_print_bytes(const char *p, int64_t n)
     {
-        if (!host) return -1;
-        char portstr[16]; std::snprintf(portstr, sizeof(portstr), "%lld", (long long)port);
-        addrinfo hints; std::memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_INET; hints.ai_socktype = SOCK_STREAM;
-        addrinfo *res = nullptr;
-        if (::getaddrinfo(host, portstr, &hints, &res) != 0 || !res) return -1;
-        int fd = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
-        if (fd < 0) { ::freeaddrinfo(res); return -1; }
-        if (::connect(fd, res->ai_addr, res->ai_addrlen) < 0) { ::close(fd); ::freeaddrinfo(res); return -1; }
-        ::freeaddrinfo(res);
-        return (int64_t)fd;
+        if (p && n > 0) tocin_stdout_append(p, (size_t)n);
     }
-    int64_t __tocin_tcp_send(int64_t fd, const char *s)
+    // Any char*, as printf's %s would take it: C strings have no header.
+    void __tocin_print_str(const char *s)
     {
-        if (!s) return 0;
-        size_t len = std::strlen(s), sent = 0;
-        while (sent < len)
-        {
-            ssize_t n = ::send((int)fd, s + sent, len - sent, 0);
-            if (n <= 0) return -1;
-            sent += (size_t)n;
-        }
-        return (int64_t)sent;
+        if (!s) s = "(null)";
+        tocin_stdout_append(s, strKernels().length(s));
     }
-    char *__tocin_tcp_recv(int64_t fd)
+    void __tocin_print_int(int64_t n)
     {
-        char buf[65536];
-        ssize_t n = ::recv((int)fd, buf, sizeof(buf) - 1, 0);
-        if (n <= 0) return tocin_dup("", 0);
-        return tocin_dup(buf, (size_t)n);
+        char tmp[20];
+        char *p = tocin_format_int(tmp + sizeof(tmp), n);
+        tocin_stdout_append(p, (size_t)(tmp + sizeof(tmp) - p));
     }
-    void __tocin_tcp_close(int64_t fd) { if (fd >= 0) ::close((int)fd); }
-#else
-    int64_t __tocin_tcp_listen(int64_t) { return -1; }
-    int64_t __tocin_tcp_accept(int64_t) { return -1; }
-    int64_t __tocin_tcp_connect(const char *, int64_t) { return -1; }
-    int64_t __tocin_tcp_send(int64_t, const char *) { return -1; }
-    char *__tocin_tcp_recv(int64_t) { return tocin_dup("", 0); }
-    void __tocin_tcp_close(int64_t) {}
-#endif
+    // printf's %g: six significant digits, fixed or exponent form, trailing
+    // zeros dropped (std::to_chars with a precision is specified as %g).
+    void __tocin_print_float(double d)
+    {
+        char tmp[kFloatTextMax];
+        auto r = std::to_chars(tmp, tmp + sizeof(tmp), d, std::chars_format::general, 6);
+        tocin_stdout_append(tmp, (size_t)(r.ptr - tmp));
+    }
+    void __tocin_stdout_flush() { std::fflush(stdout); }
 }
 
 // ===========================================================================
@@ -798,7 +5060,7 @@ extern "C"
     char *__tocin_env_get(const char *name)
     {
         const char *v = name ? std::getenv(name) : nullptr;
-        return v ? tocin_dup(v, std::strlen(v)) : tocin_dup("", 0);
+        return __tocin_str_from_c(v);
     }
     void __tocin_sys_exit(int64_t code) { std::exit((int)code); }
 
@@ -0,0 +1,96 @@
+#ifndef TOCIN_EXECUTOR_H
+#define TOCIN_EXECUTOR_H
+
+/**
+ * The one pool of worker threads behind every concurrent facility of the
+ * runtime: goroutines, `async` calls, `parallel for` loops and the
+ * compiler-side Future/Promise schedulers (runtime::ThreadPool,
+ * runtime::AsyncScheduler) all run as fibers on the goroutine scheduler, so
+ * a program that mixes them keeps one thread per core instead of one pool
+ * per facility.
+ *
+ * The pool has executorThreads() workers. A task that blocks its thread
+ * (a system call, a std::future wait) should say so with
+ * ExecutorBlockingScope, so a spare worker keeps the others running in the
+ * meantime; channel operations, sleeps and awaits park only the fiber.
+ *
+ * Implemented in concurrency_runtime.cpp, next to the scheduler's GC hooks.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace tocin {
+namespace runtime {
+
+class Fiber;
+class LightweightScheduler;
+
+// Worker threads the executor runs: TOCIN_MAX_PROCS when set, otherwise the
+// CPUs this process may use (its affinity mask, capped by a cgroup CPU
+// quota), at least 1.
+size_t executorThreads();
+
+// The shared scheduler, configured and started on first use.
+LightweightScheduler& executor();
+
+// Run task as a goroutine on the executor. It may block on channels, sleep
+// and await like any goroutine; the program does not exit before it ends.
+void executorSubmit(std::function<void()> task);
+
+// Run fn on a worker once d has passed, from the scheduler's timer heap
+// (LightweightScheduler::after: fn must be short and must not block). The
+// id is for executorCancelTimer, which is true if fn had not run yet.
+uint64_t executorAfter(std::chrono::steady_clock::duration d, std::function<void()> fn);
+bool executorCancelTimer(uint64_t id);
+
+// Brackets a wait that blocks the calling OS thread. On an executor worker
+// the worker's slot is handed to a spare thread until the scope ends;
+// elsewhere it does nothing.
+class ExecutorBlockingScope {
+public:
+    ExecutorBlockingScope();
+    ~ExecutorBlockingScope();
+    ExecutorBlockingScope(const ExecutorBlockingScope&) = delete;
+    ExecutorBlockingScope& operator=(const ExecutorBlockingScope&) = delete;
+};
+
+// Counts a channel operation that found nothing to do and registered to
+// wait, the contention figure in runtime_metrics.h. Striped by thread.
+enum class ChannelWait { Receive, Send, Select };
+void noteChannelWait(ChannelWait kind);
+
+// One party blocked until another fires it: channels and selects in
+// concurrency.h register these. wait() spins briefly, then parks the fiber
+// when called from a goroutine (its worker runs other goroutines) or waits on
+// a condition variable on a plain thread. fire() may be called from any
+// thread, any number of times; only the first counts until reset(). The
+// waiter must outlive fire(): channels fire under the mutex a waiter
+// unregisters with before it returns.
+class ExecutorWaiter {
+public:
+    void wait();
+    // true if this call fired it.
+    bool fire();
+    bool fired() const { return fired_.load(std::memory_order_acquire); }
+    void reset() { fired_.store(false, std::memory_order_relaxed); }
+
+private:
+    static constexpr int kSpins = 64;
+
+    std::atomic<bool> fired_{false};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::shared_ptr<Fiber> fiber_;  // parked in wait(), guarded by mutex_
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_EXECUTOR_H
@@ -0,0 +1,377 @@
+#include "fiber_context.h"
+#include "numa_topology.h"
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace tocin {
+namespace runtime {
+
+// ============================================================================
+// Context switch
+// ============================================================================
+
+#ifdef TOCIN_FIBER_ASM
+
+#if defined(__APPLE__)
+#define TOCIN_ASM_SYM(name) "_" #name
+#define TOCIN_ASM_FN(name) ".globl " TOCIN_ASM_SYM(name) "\n.p2align 4\n" TOCIN_ASM_SYM(name) ":\n"
+#define TOCIN_ASM_END(name) ""
+#else
+#define TOCIN_ASM_SYM(name) #name
+#define TOCIN_ASM_FN(name) ".globl " #name "\n.type " #name ", %function\n.p2align 4\n" #name ":\n"
+#define TOCIN_ASM_END(name) ".size " #name ", .-" #name "\n"
+#endif
+
+extern "C" void tocin_fiber_start();
+
+#if defined(__x86_64__)
+// System V: rbx, rbp, r12-r15, and the MXCSR / x87 control words. A fresh
+// stack enters tocin_fiber_start with the entry point in r13 and its
+// argument in r12.
+asm(".text\n"
+    TOCIN_ASM_FN(tocin_fiber_switch)
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    TOCIN_ASM_END(tocin_fiber_switch)
+    TOCIN_ASM_FN(tocin_fiber_start)
+    "    movq %r12, %rdi\n"
+    "    callq *%r13\n"
+    "    ud2\n"
+    TOCIN_ASM_END(tocin_fiber_start));
+
+void *fiberContextMake(void *stackTop, void (*entry)(void *), void *arg) {
+    // Ten words: the control words, six registers and the return address
+    // the switch pops, then 16 bytes so that tocin_fiber_start's call
+    // happens on a 16-byte aligned stack.
+    uintptr_t top = reinterpret_cast<uintptr_t>(stackTop) & ~uintptr_t(15);
+    uint64_t *sp = reinterpret_cast<uint64_t *>(top - 80);
+    std::memset(sp, 0, 80);
+    sp[0] = (uint64_t(0x037F) << 32) | 0x1F80;   // x87 CW, MXCSR: the ABI defaults
+    sp[3] = reinterpret_cast<uint64_t>(entry);   // r13
+    sp[4] = reinterpret_cast<uint64_t>(arg);     // r12
+    sp[7] = reinterpret_cast<uint64_t>(&tocin_fiber_start);
+    return sp;
+}
+#elif defined(__aarch64__)
+// AAPCS64: x19-x28, the frame pointer and link register, and d8-d15. A
+// fresh stack "returns" into tocin_fiber_start with the entry point in x19
+// and its argument in x20.
+asm(".text\n"
+    TOCIN_ASM_FN(tocin_fiber_switch)
+    "    sub sp, sp, #160\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x2, sp\n"
+    "    str x2, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #160\n"
+    "    ret\n"
+    TOCIN_ASM_END(tocin_fiber_switch)
+    TOCIN_ASM_FN(tocin_fiber_start)
+    "    mov x0, x20\n"
+    "    blr x19\n"
+    "    brk #0\n"
+    TOCIN_ASM_END(tocin_fiber_start));
+
+void *fiberContextMake(void *stackTop, void (*entry)(void *), void *arg) {
+    uintptr_t top = reinterpret_cast<uintptr_t>(stackTop) & ~uintptr_t(15);
+    uint64_t *sp = reinterpret_cast<uint64_t *>(top - 160);
+    std::memset(sp, 0, 160);
+    sp[0] = reinterpret_cast<uint64_t>(entry);   // x19
+    sp[1] = reinterpret_cast<uint64_t>(arg);     // x20
+    sp[11] = reinterpret_cast<uint64_t>(&tocin_fiber_start);   // x30
+    return sp;
+}
+#endif
+
+#endif // TOCIN_FIBER_ASM
+
+// ============================================================================
+// Stack pool
+// ============================================================================
+
+std::atomic<uint64_t> FiberStackPool::mapped_{0};
+std::atomic<uint64_t> FiberStackPool::reused_{0};
+std::atomic<uint64_t> FiberStackPool::unmapped_{0};
+
+namespace {
+    // Below every stack. More than a page, so that a frame with a few KB of
+    // locals cannot step over it into the next mapping.
+    constexpr size_t kGuardBytes = 16 * 1024;
+
+    size_t guardSize() {
+        size_t page = FiberStackPool::pageSize();
+        return (kGuardBytes + page - 1) / page * page;
+    }
+
+    // Guarded stacks allowed at once. Each costs two mappings, and the rest
+    // of the process (malloc arenas, thread stacks, the JIT) needs mappings
+    // too, so stop at half of the kernel's per-process limit.
+    uint64_t guardedBudget() {
+        static const uint64_t budget = [] {
+            uint64_t maxMaps = 65530;   // Linux default
+            if (FILE *f = std::fopen("/proc/sys/vm/max_map_count", "r")) {
+                unsigned long long v = 0;
+                if (std::fscanf(f, "%llu", &v) == 1 && v > 0) maxMaps = v;
+                std::fclose(f);
+            }
+            return maxMaps / 4;
+        }();
+        return budget;
+    }
+
+    void unmapStack(const FiberStack &stack) {
+        if (!stack.guarded) {
+            std::free(stack.base);
+            return;
+        }
+        size_t guard = guardSize();
+        munmap(static_cast<char *>(stack.base) - guard, stack.size + guard);
+    }
+
+    struct StackCache {
+        std::vector<FiberStack> stacks;
+        ~StackCache();
+    };
+    // Set once this thread's cache is gone, so a fiber destroyed later in
+    // thread teardown unmaps its stack instead of touching a dead vector.
+    thread_local bool t_cacheGone = false;
+    thread_local StackCache t_cache;
+
+    StackCache::~StackCache() {
+        t_cacheGone = true;
+        for (const FiberStack &stack : stacks) unmapStack(stack);
+    }
+}
+
+size_t FiberStackPool::pageSize() {
+    static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return page;
+}
+
+bool FiberStackPool::inGuard(const FiberStack &stack, const void *addr) {
+    if (!stack.guarded) return false;
+    const char *base = static_cast<const char *>(stack.base);
+    const char *p = static_cast<const char *>(addr);
+    return p < base && p >= base - guardSize();
+}
+
+FiberStack FiberStackPool::acquire(size_t size) {
+    size_t page = pageSize();
+    size = (size + page - 1) / page * page;
+
+    if (!t_cacheGone) {
+        std::vector<FiberStack> &cached = t_cache.stacks;
+        // Most recently released first: its top pages are still warm.
+        for (size_t i = cached.size(); i-- > 0;) {
+            if (cached[i].size != size) continue;
+            FiberStack stack = cached[i];
+            cached.erase(cached.begin() + static_cast<std::ptrdiff_t>(i));
+            reused_.fetch_add(1, std::memory_order_relaxed);
+            return stack;
+        }
+    }
+
+    FiberStack stack;
+    stack.size = size;
+    if (mapped_.load(std::memory_order_relaxed) - unmapped_.load(std::memory_order_relaxed)
+            >= guardedBudget()) {
+        // Past the mapping budget: carry on unguarded rather than fail the
+        // spawn (or starve malloc of the mappings it needs).
+        stack.base = std::malloc(size);
+        if (!stack.base) throw std::bad_alloc();
+        return stack;
+    }
+
+    // Address space only: pages are committed as the fiber first touches
+    // them, so a deep default costs nothing until a fiber needs it.
+    size_t guard = guardSize();
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+#ifdef MAP_STACK
+    flags |= MAP_STACK;
+#endif
+    void *region = mmap(nullptr, size + guard, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (region != MAP_FAILED && mprotect(region, guard, PROT_NONE) != 0) {
+        munmap(region, size + guard);
+        region = MAP_FAILED;
+    }
+    if (region == MAP_FAILED) {
+        stack.base = std::malloc(size);
+        if (!stack.base) throw std::bad_alloc();
+        return stack;
+    }
+    stack.base = static_cast<char *>(region) + guard;
+    stack.guarded = true;
+    // Pages are committed on first touch, possibly after the fiber has been
+    // stolen by another node's worker: pin them to the acquirer's node.
+    if (currentNumaNode() >= 0) preferNumaNode(stack.base, size, currentNumaNode());
+    mapped_.fetch_add(1, std::memory_order_relaxed);
+    return stack;
+}
+
+void FiberStackPool::release(FiberStack stack) {
+    if (!stack.base) return;
+    if (stack.guarded && !t_cacheGone && t_cache.stacks.size() < kMaxCached) {
+        t_cache.stacks.push_back(stack);
+        return;
+    }
+    unmapStack(stack);
+    if (stack.guarded) unmapped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+FiberStackPool::Stats FiberStackPool::stats() {
+    Stats s;
+    s.mapped = mapped_.load(std::memory_order_relaxed);
+    s.reused = reused_.load(std::memory_order_relaxed);
+    s.unmapped = unmapped_.load(std::memory_order_relaxed);
+    return s;
+}
+
+// ============================================================================
+// Stack overflow reporting
+// ============================================================================
+
+namespace {
+    FiberStack (*g_currentStack)() = nullptr;
+    struct sigaction g_prevSegv;
+    struct sigaction g_prevBus;
+
+    thread_local void *t_altStack = nullptr;
+    constexpr size_t kAltStackSize = 64 * 1024;
+
+    // Async-signal-safe decimal formatting for the report.
+    size_t formatUnsigned(char *out, uint64_t v) {
+        char digits[24];
+        size_t n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v);
+        for (size_t i = 0; i < n; ++i) out[i] = digits[n - 1 - i];
+        return n;
+    }
+
+    void onFault(int sig, siginfo_t *info, void *uctx) {
+        FiberStack stack = g_currentStack ? g_currentStack() : FiberStack{};
+        if (FiberStackPool::inGuard(stack, info->si_addr)) {
+            char msg[128];
+            const char head[] = "fatal error: goroutine stack overflow (stack size ";
+            size_t n = sizeof head - 1;
+            std::memcpy(msg, head, n);
+            n += formatUnsigned(msg + n, stack.size / 1024);
+            const char tail[] = " KB; raise it with setFiberStackSize)\n";
+            std::memcpy(msg + n, tail, sizeof tail - 1);
+            n += sizeof tail - 1;
+            ssize_t ignored = write(STDERR_FILENO, msg, n);
+            (void)ignored;
+            abort();
+        }
+        // Not ours: hand the fault to whoever had the signal before.
+        const struct sigaction &prev = sig == SIGSEGV ? g_prevSegv : g_prevBus;
+        if (prev.sa_flags & SA_SIGINFO) {
+            if (prev.sa_sigaction) {
+                prev.sa_sigaction(sig, info, uctx);
+                return;
+            }
+        } else if (prev.sa_handler != SIG_DFL && prev.sa_handler != SIG_IGN) {
+            prev.sa_handler(sig);
+            return;
+        }
+        // Default action: reinstate it and let the faulting access repeat.
+        signal(sig, SIG_DFL);
+    }
+}
+
+void FiberStackPool::installOverflowHandler(FiberStack (*current)()) {
+    static std::atomic<bool> installed{false};
+    if (installed.exchange(true)) return;
+    g_currentStack = current;
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof sa);
+    sa.sa_sigaction = onFault;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, &g_prevSegv);
+    sigaction(SIGBUS, &sa, &g_prevBus);
+}
+
+void FiberStackPool::prepareThread() {
+    if (t_altStack) return;
+    void *mem = mmap(nullptr, kAltStackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return;
+    stack_t ss;
+    std::memset(&ss, 0, sizeof ss);
+    ss.ss_sp = mem;
+    ss.ss_size = kAltStackSize;
+    if (sigaltstack(&ss, nullptr) != 0) {
+        munmap(mem, kAltStackSize);
+        return;
+    }
+    t_altStack = mem;
+}
+
+void FiberStackPool::releaseThread() {
+    if (!t_altStack) return;
+    stack_t ss;
+    std::memset(&ss, 0, sizeof ss);
+    ss.ss_flags = SS_DISABLE;
+    sigaltstack(&ss, nullptr);
+    munmap(t_altStack, kAltStackSize);
+    t_altStack = nullptr;
+}
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // !_WIN32
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fiber context switching and fiber stacks.
+ *
+ * On x86-64 and AArch64 (outside Windows) a switch is a few instructions of
+ * assembly: push the callee-saved registers onto the current stack, store
+ * the stack pointer, load the other fiber's and pop its registers. Nothing
+ * else needs saving, since the switch is an ordinary call and the ABI lets
+ * it clobber everything else. ucontext's swapcontext also saves the signal
+ * mask, with a sigprocmask syscall each way; it remains the fallback on
+ * other POSIX targets (TOCIN_FIBER_ASM undefined).
+ *
+ * Stacks come from FiberStackPool: mmap'd with a PROT_NONE guard page below
+ * them, committed lazily by the kernel as the fiber touches them, and
+ * recycled through a per-thread cache when a fiber completes. Running off
+ * the end of a stack faults on the guard page, and installOverflowHandler()
+ * turns that fault into a "goroutine stack overflow" report instead of a
+ * silent write into a neighbour's memory.
+ */
+
+#if !defined(_WIN32) && (defined(__x86_64__) || defined(__aarch64__))
+#define TOCIN_FIBER_ASM 1
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#ifdef TOCIN_FIBER_ASM
+extern "C" {
+// Save the callee-saved registers on the current stack, store its stack
+// pointer in *from, switch to the stack pointer `to` and restore what was
+// saved there. Returns when something switches back to *from.
+void tocin_fiber_switch(void **from, void *to);
+}
+
+// Lay out a fresh stack so that the first switch to the returned stack
+// pointer calls entry(arg). entry must never return.
+void *fiberContextMake(void *stackTop, void (*entry)(void *), void *arg);
+#endif
+
+// A usable stack [base, base + size), with the guard page just below base.
+// (Windows fibers get their stacks from CreateFiber instead.)
+struct FiberStack {
+    void *base = nullptr;
+    size_t size = 0;
+    // False for a heap stack, handed out once the kernel refuses more
+    // mappings (each guarded stack costs two; see vm.max_map_count).
+    bool guarded = false;
+    void *top() const { return static_cast<char *>(base) + size; }
+};
+
+#ifndef _WIN32
+class FiberStackPool {
+public:
+    // Stacks each thread keeps for reuse; beyond that, released ones are unmapped.
+    static constexpr size_t kMaxCached = 64;
+
+    // A stack of at least `size` bytes (rounded up to whole pages): a cached
+    // one of that size if this thread has one, else freshly mapped (or, when
+    // mmap fails, an unguarded heap block). Throws std::bad_alloc if even
+    // that fails.
+    static FiberStack acquire(size_t size);
+    // Return a stack no fiber is running on to this thread's cache.
+    static void release(FiberStack stack);
+
+    static size_t pageSize();
+    // True when addr falls in the guard page below `stack`.
+    static bool inGuard(const FiberStack &stack, const void *addr);
+
+    struct Stats {
+        uint64_t mapped = 0;     // stacks mmap'd
+        uint64_t reused = 0;     // acquires served from a cache
+        uint64_t unmapped = 0;   // stacks returned to the kernel
+    };
+    static Stats stats();
+
+    // Catch faults on a fiber's guard page (process-wide, once) and report
+    // them. `current` returns the stack of the fiber running on the calling
+    // thread, or an empty one. Each thread that runs fibers also needs an
+    // alternate signal stack, since the faulting one is full.
+    static void installOverflowHandler(FiberStack (*current)());
+    static void prepareThread();    // sigaltstack for the calling thread
+    static void releaseThread();    // ... and drop it again
+
+private:
+    static std::atomic<uint64_t> mapped_;
+    static std::atomic<uint64_t> reused_;
+    static std::atomic<uint64_t> unmapped_;
+};
+#endif
+
+} // namespace runtime
+} // namespace tocin
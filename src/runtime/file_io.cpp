@@ -0,0 +1,667 @@
+// File I/O backends: plain system calls, and io_uring chains on Linux. The
+// table in use is picked once by fileIo().
+#include "file_io.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+// Linked opens into the registered file table need both of these (5.18+).
+#if defined(IORING_FEAT_LINKED_FILE) && defined(IORING_FEAT_CQE_SKIP) && \
+    defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define TOCIN_FILE_IO_URING 1
+#endif
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+#ifdef _WIN32
+
+// No descriptor cache here: stdio is all the runtime uses on Windows.
+char *stdioReadFile(const char *path, char *(*alloc)(size_t), size_t *len) {
+    FILE *f = std::fopen(path, "rb");
+    if (!f) return nullptr;
+    long sz = -1;
+    if (std::fseek(f, 0, SEEK_END) == 0) sz = std::ftell(f);
+    std::rewind(f);
+    char *buf = sz < 0 ? nullptr : alloc((size_t)sz);
+    if (buf) *len = std::fread(buf, 1, (size_t)sz, f);
+    std::fclose(f);
+    return buf;
+}
+
+int64_t stdioWrite(const char *path, const char *mode, const char *data, size_t len) {
+    FILE *f = std::fopen(path, mode);
+    if (!f) return -1;
+    size_t wrote = std::fwrite(data, 1, len, f);
+    if (std::fclose(f) != 0) return -1;
+    return wrote == len ? (int64_t)wrote : -1;
+}
+
+int64_t stdioWriteFile(const char *path, const char *data, size_t len) {
+    return stdioWrite(path, "wb", data, len);
+}
+
+int64_t stdioAppendFile(const char *path, const char *data, size_t len) {
+    return stdioWrite(path, "ab", data, len);
+}
+
+int64_t stdioAppendSync(int fd, const char *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        int n = ::_write(fd, data + done, (unsigned)std::min(len - done, size_t(1) << 30));
+        if (n <= 0) return -1;
+        done += (size_t)n;
+    }
+    return ::_commit(fd) == 0 ? (int64_t)len : -1;
+}
+
+constexpr FileIo kPosixFileIo{"posix", stdioReadFile, stdioWriteFile, stdioAppendFile, stdioAppendSync};
+
+#else // !_WIN32
+
+// Appended-to files kept open, most recently used last.
+constexpr size_t kAppendFiles = 16;
+
+bool writeAll(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+int closeRetrying(int fd) {
+    // Linux releases the descriptor even when close reports EINTR.
+    return ::close(fd) == 0 || errno == EINTR ? 0 : -1;
+}
+
+struct AppendFile {
+    AppendFile(int fd, dev_t dev, ino_t ino) : fd(fd), dev(dev), ino(ino) {}
+    AppendFile(const AppendFile &) = delete;
+    AppendFile &operator=(const AppendFile &) = delete;
+    ~AppendFile() { ::close(fd); }
+    int fd;
+    dev_t dev;
+    ino_t ino;
+};
+
+// Shared by both backends. A writer holds its entry by shared_ptr, so an
+// eviction on another thread never closes a descriptor mid-write.
+class AppendFiles {
+public:
+    std::shared_ptr<AppendFile> open(const char *path) {
+        struct stat st;
+        bool exists = ::stat(path, &st) == 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = std::find_if(entries_.begin(), entries_.end(),
+                               [&](const auto &e) { return e.first == path; });
+        if (it != entries_.end()) {
+            if (exists && it->second->dev == st.st_dev && it->second->ino == st.st_ino) {
+                std::rotate(it, it + 1, entries_.end());
+                return entries_.back().second;
+            }
+            entries_.erase(it); // renamed or removed since it was opened
+        }
+        lock.unlock();
+        int fd = ::open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+        if (fd < 0) return nullptr;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return nullptr;
+        }
+        auto file = std::make_shared<AppendFile>(fd, st.st_dev, st.st_ino);
+        lock.lock();
+        // Another thread may have opened the same path meanwhile; the newer
+        // entry wins and the older is closed once its writers finish.
+        it = std::find_if(entries_.begin(), entries_.end(),
+                          [&](const auto &e) { return e.first == path; });
+        if (it != entries_.end()) entries_.erase(it);
+        if (entries_.size() == kAppendFiles) entries_.erase(entries_.begin());
+        entries_.emplace_back(path, file);
+        return file;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::pair<std::string, std::shared_ptr<AppendFile>>> entries_;
+};
+
+AppendFiles &appendFiles() {
+    static AppendFiles *files = new AppendFiles(); // outlives atexit appends
+    return *files;
+}
+
+char *posixReadFile(const char *path, char *(*alloc)(size_t), size_t *len) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    char *buf = ::fstat(fd, &st) == 0 ? alloc((size_t)st.st_size) : nullptr;
+    size_t got = 0;
+    while (buf && got < (size_t)st.st_size) {
+        ssize_t n = ::read(fd, buf + got, (size_t)st.st_size - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    ::close(fd);
+    *len = got;
+    return buf;
+}
+
+int64_t posixWriteFile(const char *path, const char *data, size_t len) {
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) return -1;
+    bool ok = writeAll(fd, data, len);
+    if (closeRetrying(fd) != 0) return -1;
+    return ok ? (int64_t)len : -1;
+}
+
+// One write(2) is already a single system call, so the uring table appends
+// this way too.
+int64_t cachedAppendFile(const char *path, const char *data, size_t len) {
+    auto file = appendFiles().open(path);
+    if (!file) return -1;
+    return writeAll(file->fd, data, len) ? (int64_t)len : -1;
+}
+
+int syncData(int fd) {
+#if defined(__APPLE__)
+    return ::fcntl(fd, F_FULLFSYNC); // fsync alone stops at the drive's cache
+#elif defined(__linux__)
+    return ::fdatasync(fd);
+#else
+    return ::fsync(fd);
+#endif
+}
+
+int64_t posixAppendSync(int fd, const char *data, size_t len) {
+    if (!writeAll(fd, data, len)) return -1;
+    int r;
+    do r = syncData(fd);
+    while (r != 0 && errno == EINTR);
+    return r == 0 ? (int64_t)len : -1;
+}
+
+constexpr FileIo kPosixFileIo{"posix", posixReadFile, posixWriteFile, cachedAppendFile, posixAppendSync};
+
+#ifdef TOCIN_FILE_IO_URING
+
+// Largest single write; the kernel caps one call near 2 GiB.
+constexpr size_t kUringChunk = size_t(1) << 30;
+
+// Files read in one submission, through the ring's scratch buffer.
+constexpr size_t kSmallFile = 64 * 1024;
+
+// A small io_uring used synchronously by one thread: queue a chain of
+// SQEs, submit them and wait for all their completions in one
+// io_uring_enter. Slot 0 of the registered file table holds the file the
+// chain is working on, so the opened file never becomes a descriptor.
+class Ring {
+public:
+    // This thread's ring, or nullptr where io_uring is unusable.
+    static Ring *forThread() {
+        thread_local std::unique_ptr<Ring> ring;
+        thread_local bool tried = false;
+        if (!tried) {
+            tried = true;
+            auto r = std::make_unique<Ring>();
+            if (r->setUp()) ring = std::move(r);
+        }
+        return ring.get();
+    }
+
+    ~Ring() {
+        if (sqes_) munmap(sqes_, sqesLen_);
+        if (cqMap_ && cqMap_ != sqMap_) munmap(cqMap_, cqMapLen_);
+        if (sqMap_) munmap(sqMap_, sqMapLen_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    // A zeroed SQE whose completion lands in results[tag] of run().
+    io_uring_sqe *push(unsigned tag) {
+        unsigned tail = *sqTail_ + queued_;
+        io_uring_sqe *sqe = &sqes_[tail & *sqMask_];
+        std::memset(sqe, 0, sizeof *sqe);
+        sqe->user_data = tag;
+        sqArray_[tail & *sqMask_] = tail & *sqMask_;
+        ++queued_;
+        return sqe;
+    }
+
+    // Submit everything pushed and wait for it; each SQE, cancelled links
+    // included, posts one completion.
+    bool run(int *results) {
+        unsigned n = queued_;
+        __atomic_store_n(sqTail_, *sqTail_ + n, __ATOMIC_RELEASE);
+        queued_ = 0;
+        unsigned toSubmit = n, reaped = 0;
+        while (true) {
+            unsigned head = *cqHead_;
+            unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head, ++reaped) {
+                const io_uring_cqe &cqe = cqes_[head & *cqMask_];
+                results[cqe.user_data] = cqe.res;
+            }
+            __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+            if (reaped >= n) return true;
+            long r = syscall(__NR_io_uring_enter, fd_, toSubmit, n - reaped, IORING_ENTER_GETEVENTS,
+                             nullptr, 0);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            toSubmit -= (unsigned)r;
+        }
+    }
+
+    bool setUp() {
+        io_uring_params p{};
+        fd_ = (int)syscall(__NR_io_uring_setup, kEntries, &p);
+        if (fd_ < 0) return false;
+        const unsigned need = IORING_FEAT_NODROP | IORING_FEAT_LINKED_FILE | IORING_FEAT_CQE_SKIP;
+        if ((p.features & need) != need) return false;
+        sqMapLen_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cqMapLen_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) sqMapLen_ = cqMapLen_ = std::max(sqMapLen_, cqMapLen_);
+        sqMap_ = mapRing(sqMapLen_, IORING_OFF_SQ_RING);
+        cqMap_ = single ? sqMap_ : mapRing(cqMapLen_, IORING_OFF_CQ_RING);
+        sqesLen_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe *>(mapRing(sqesLen_, IORING_OFF_SQES));
+        if (!sqMap_ || !cqMap_ || !sqes_) return false;
+        auto *sq = static_cast<char *>(sqMap_);
+        auto *cq = static_cast<char *>(cqMap_);
+        sqTail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        sqMask_ = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        cqHead_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        cqMask_ = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+        int empty[1] = {-1};
+        return syscall(__NR_io_uring_register, fd_, IORING_REGISTER_FILES, empty, 1) == 0;
+    }
+
+    char *scratch() { return scratch_.get(); }
+
+    // Longest chain queued by the backend: open, read or write, close.
+    static constexpr unsigned kEntries = 4;
+
+private:
+    void *mapRing(size_t len, off_t what) {
+        void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, what);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    int fd_ = -1;
+    void *sqMap_ = nullptr, *cqMap_ = nullptr;
+    size_t sqMapLen_ = 0, cqMapLen_ = 0, sqesLen_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    unsigned *sqTail_ = nullptr, *sqMask_ = nullptr, *sqArray_ = nullptr;
+    unsigned *cqHead_ = nullptr, *cqTail_ = nullptr, *cqMask_ = nullptr;
+    io_uring_cqe *cqes_ = nullptr;
+    unsigned queued_ = 0;
+    std::unique_ptr<char[]> scratch_{new char[kSmallFile]};
+};
+
+// Registered-file slot 0, as opcodes that create a file name it (index + 1).
+constexpr unsigned kSlot = 0;
+
+void pushOpen(Ring &ring, unsigned tag, const char *path, int flags, unsigned char sqeFlags) {
+    io_uring_sqe *sqe = ring.push(tag);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)path;
+    sqe->len = 0666;
+    sqe->open_flags = (uint32_t)flags; // direct descriptors refuse O_CLOEXEC
+    sqe->file_index = kSlot + 1;
+    sqe->flags = sqeFlags;
+}
+
+void pushRw(Ring &ring, unsigned tag, uint8_t op, const char *buf, size_t len, uint64_t off,
+            unsigned char sqeFlags) {
+    io_uring_sqe *sqe = ring.push(tag);
+    sqe->opcode = op;
+    sqe->fd = (int)kSlot;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (uint32_t)len;
+    sqe->off = off;
+    sqe->flags = (unsigned char)(IOSQE_FIXED_FILE | sqeFlags);
+}
+
+void pushClose(Ring &ring, unsigned tag) {
+    io_uring_sqe *sqe = ring.push(tag);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = kSlot + 1;
+}
+
+// One submission: open, read up to kSmallFile bytes into the ring's
+// scratch buffer, close. A file that fills the scratch buffer is read again
+// by the posix path, straight into a buffer of its size.
+char *uringReadFile(const char *path, char *(*alloc)(size_t), size_t *len) {
+    Ring *ring = Ring::forThread();
+    if (!ring) return posixReadFile(path, alloc, len);
+    pushOpen(*ring, 0, path, O_RDONLY, IOSQE_IO_LINK);
+    pushRw(*ring, 1, IORING_OP_READ, ring->scratch(), kSmallFile, 0, IOSQE_IO_HARDLINK);
+    pushClose(*ring, 2);
+    int res[3];
+    if (!ring->run(res) || res[0] < 0) return nullptr;
+    if (res[1] < 0) {
+        char *buf = alloc(0);
+        *len = 0;
+        return buf;
+    }
+    if ((size_t)res[1] == kSmallFile) return posixReadFile(path, alloc, len);
+    char *buf = alloc((size_t)res[1]);
+    if (buf) {
+        std::memcpy(buf, ring->scratch(), (size_t)res[1]);
+        *len = (size_t)res[1];
+    }
+    return buf;
+}
+
+// One submission: open into the slot, write (hard-linked so a failed write
+// still closes), close.
+int64_t uringWriteFile(const char *path, const char *data, size_t len) {
+    Ring *ring = Ring::forThread();
+    if (!ring || len > kUringChunk) return posixWriteFile(path, data, len);
+    pushOpen(*ring, 0, path, O_WRONLY | O_CREAT | O_TRUNC, IOSQE_IO_LINK);
+    pushRw(*ring, 1, IORING_OP_WRITE, data, len, 0, IOSQE_IO_HARDLINK);
+    pushClose(*ring, 2);
+    int res[3];
+    if (!ring->run(res)) return -1;
+    if (res[0] < 0 || res[1] != (int)len || res[2] < 0) return -1;
+    return (int64_t)len;
+}
+
+// One submission: the write, linked to an fdatasync that runs only if it
+// succeeds. Offset -1 writes at the file position, which O_APPEND keeps at
+// the end.
+int64_t uringAppendSync(int fd, const char *data, size_t len) {
+    Ring *ring = Ring::forThread();
+    if (!ring || len > kUringChunk) return posixAppendSync(fd, data, len);
+    io_uring_sqe *write = ring->push(0);
+    write->opcode = IORING_OP_WRITE;
+    write->fd = fd;
+    write->addr = (uint64_t)(uintptr_t)data;
+    write->len = (uint32_t)len;
+    write->off = (uint64_t)-1;
+    write->flags = IOSQE_IO_LINK;
+    io_uring_sqe *sync = ring->push(1);
+    sync->opcode = IORING_OP_FSYNC;
+    sync->fd = fd;
+    sync->fsync_flags = IORING_FSYNC_DATASYNC;
+    int res[2];
+    if (!ring->run(res) || res[0] < 0) return -1;
+    if ((size_t)res[0] != len) { // short write: finish it the plain way
+        return posixAppendSync(fd, data + res[0], len - (size_t)res[0]) < 0 ? -1 : (int64_t)len;
+    }
+    return res[1] == 0 ? (int64_t)len : -1;
+}
+
+constexpr FileIo kUringFileIo{"uring", uringReadFile, uringWriteFile, cachedAppendFile, uringAppendSync};
+
+#endif // TOCIN_FILE_IO_URING
+
+#endif // _WIN32
+
+const FileIo *chooseFileIo() {
+    auto available = availableFileIo();
+    if (const char *forced = std::getenv("TOCIN_IO_BACKEND")) {
+        for (const auto *table : available)
+            if (std::strcmp(table->name, forced) == 0) return table;
+    }
+    return available.front();
+}
+
+} // namespace
+
+std::vector<const FileIo *> availableFileIo() {
+    std::vector<const FileIo *> tables{&kPosixFileIo};
+#ifdef TOCIN_FILE_IO_URING
+    if (Ring::forThread()) tables.push_back(&kUringFileIo);
+#endif
+    return tables;
+}
+
+void closeAppendFiles() {
+#ifndef _WIN32
+    appendFiles().clear();
+#endif
+}
+
+#ifdef _WIN32
+
+// The Windows runtime has no mappings; mmapFile reports failure and callers
+// read the file instead.
+const char *mapFile(const char *, size_t *) { return nullptr; }
+int64_t mappingSize(const void *) { return -1; }
+bool unmapFile(const void *) { return false; }
+bool adviseMapping(const void *, MapAdvice) { return false; }
+
+#else
+
+namespace {
+
+// Live views by start address, so unmapping needs no length.
+struct Mappings {
+    std::mutex mutex;
+    std::map<const void *, size_t> sizes;
+};
+
+Mappings &mappings() {
+    static Mappings *live = new Mappings();
+    return *live;
+}
+
+// What an empty file maps to: mmap refuses zero lengths.
+const char kEmptyView[1] = {0};
+
+} // namespace
+
+const char *mapFile(const char *path, size_t *len) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return nullptr;
+    }
+    size_t size = (size_t)st.st_size;
+    const char *view = kEmptyView;
+    if (size > 0) {
+        void *p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        view = p == MAP_FAILED ? nullptr : static_cast<const char *>(p);
+    }
+    ::close(fd); // the mapping keeps the file open
+    if (!view) return nullptr;
+    if (size > 0) {
+        std::lock_guard<std::mutex> lock(mappings().mutex);
+        mappings().sizes[view] = size;
+    }
+    *len = size;
+    return view;
+}
+
+int64_t mappingSize(const void *addr) {
+    if (addr == kEmptyView) return 0;
+    std::lock_guard<std::mutex> lock(mappings().mutex);
+    auto it = mappings().sizes.find(addr);
+    return it == mappings().sizes.end() ? -1 : (int64_t)it->second;
+}
+
+bool unmapFile(const void *addr) {
+    if (addr == kEmptyView) return true;
+    size_t size;
+    {
+        std::lock_guard<std::mutex> lock(mappings().mutex);
+        auto it = mappings().sizes.find(addr);
+        if (it == mappings().sizes.end()) return false;
+        size = it->second;
+        mappings().sizes.erase(it);
+    }
+    return ::munmap(const_cast<void *>(addr), size) == 0;
+}
+
+bool adviseMapping(const void *addr, MapAdvice advice) {
+    if (addr == kEmptyView) return true;
+    size_t size;
+    {
+        std::lock_guard<std::mutex> lock(mappings().mutex);
+        auto it = mappings().sizes.find(addr);
+        if (it == mappings().sizes.end()) return false;
+        size = it->second;
+    }
+    int hint = MADV_NORMAL;
+    switch (advice) {
+    case MapAdvice::Normal: hint = MADV_NORMAL; break;
+    case MapAdvice::Sequential: hint = MADV_SEQUENTIAL; break;
+    case MapAdvice::Random: hint = MADV_RANDOM; break;
+    case MapAdvice::WillNeed: hint = MADV_WILLNEED; break;
+    case MapAdvice::DontNeed: hint = MADV_DONTNEED; break;
+    }
+    return ::madvise(const_cast<void *>(addr), size, hint) == 0;
+}
+
+#endif // _WIN32
+
+namespace {
+
+#ifdef _WIN32
+int openForReading(const char *path) { return ::_open(path, _O_RDONLY | _O_BINARY); }
+int64_t readSome(int fd, char *dst, size_t max) {
+    return ::_read(fd, dst, (unsigned)std::min(max, size_t(1) << 30));
+}
+void closeReader(int fd) { ::_close(fd); }
+#else
+int openForReading(const char *path) { return ::open(path, O_RDONLY | O_CLOEXEC); }
+int64_t readSome(int fd, char *dst, size_t max) {
+    ssize_t n;
+    do n = ::read(fd, dst, max);
+    while (n < 0 && errno == EINTR);
+    return n;
+}
+void closeReader(int fd) { closeRetrying(fd); }
+#endif
+
+} // namespace
+
+FileReader::FileReader(int fd) : fd_(fd) {}
+
+FileReader::~FileReader() {
+    if (fd_ > 0) closeReader(fd_); // standard input (0) stays open
+}
+
+FileReader *FileReader::open(const char *path) {
+    int fd = openForReading(path);
+    return fd < 0 ? nullptr : new FileReader(fd);
+}
+
+FileReader &FileReader::standardInput() {
+    static FileReader *in = new FileReader(0);
+    return *in;
+}
+
+bool FileReader::fill() {
+    if (eof_) return false;
+    if (buf_.empty()) buf_.resize(kBufferSize);
+    if (start_ > 0) { // slide the unconsumed tail to the front
+        std::memmove(buf_.data(), buf_.data() + start_, end_ - start_);
+        end_ -= start_;
+        start_ = 0;
+    }
+    if (end_ == buf_.size()) buf_.resize(buf_.size() * 2);
+    int64_t n = readSome(fd_, buf_.data() + end_, buf_.size() - end_);
+    if (n <= 0) {
+        eof_ = true;
+        return false;
+    }
+    end_ += (size_t)n;
+    return true;
+}
+
+bool FileReader::atEnd() {
+    return start_ == end_ && !fill();
+}
+
+bool FileReader::nextRecord(char delim, const char **data, size_t *len) {
+    size_t scanned = start_;
+    for (;;) {
+        const void *hit = scanned < end_ ? std::memchr(buf_.data() + scanned, delim, end_ - scanned) : nullptr;
+        if (hit) {
+            size_t at = (size_t)(static_cast<const char *>(hit) - buf_.data());
+            *data = buf_.data() + start_;
+            *len = at - start_;
+            start_ = at + 1;
+            return true;
+        }
+        scanned = end_ - start_; // fill() moves the unscanned tail to the front
+        if (!fill()) break;
+    }
+    if (start_ == end_) return false;
+    *data = buf_.data() + start_;
+    *len = end_ - start_;
+    start_ = end_;
+    return true;
+}
+
+int64_t FileReader::read(char *dst, size_t max) {
+    if (max == 0) return 0;
+    if (start_ == end_) {
+        if (eof_) return 0;
+        if (max >= kBufferSize) {
+            int64_t n = readSome(fd_, dst, max);
+            if (n <= 0) eof_ = true;
+            return n;
+        }
+        if (!fill()) return 0;
+    }
+    size_t n = std::min(max, end_ - start_);
+    std::memcpy(dst, buf_.data() + start_, n);
+    start_ += n;
+    return (int64_t)n;
+}
+
+const FileIo &fileIo() {
+    static const FileIo *chosen = chooseFileIo();
+    return *chosen;
+}
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,121 @@
+#ifndef TOCIN_FILE_IO_H
+#define TOCIN_FILE_IO_H
+
+/**
+ * Whole-file I/O behind __tocin_read_file, __tocin_write_file and
+ * __tocin_append_file (concurrency_runtime.cpp).
+ *
+ * "posix" issues the usual open/read/write/close calls. "uring", on Linux
+ * kernels with io_uring, submits each operation as one linked chain on a
+ * per-thread ring, opening into the ring's registered file table, so a
+ * whole-file write costs one system call; it is chosen by setting
+ * TOCIN_IO_BACKEND=uring and falls back to posix where the ring cannot be
+ * set up (old kernel, seccomp filter).
+ *
+ * Both backends keep the descriptors of recently appended-to files open, so
+ * repeated appends to a log cost a stat and a write instead of an open,
+ * write and close. The stat notices when the path has been renamed or
+ * removed (log rotation) and the next append reopens it.
+ *
+ * appendSync() writes to a descriptor the caller keeps open and returns
+ * once the bytes are durable; the KV store's log (kv_store.h) commits
+ * through it.
+ *
+ * mapFile() and friends back mmapFile/munmapFile/mmapAdvise: read-only
+ * mappings of whole files, for inputs too large to copy into a string.
+ *
+ * FileReader backs readLine, readRecord and readChunk: sequential reads
+ * through one large buffer, refilled in place, with records found by memchr,
+ * so a line costs a scan and a copy instead of a call per byte.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+struct FileIo {
+    const char *name;
+    // The whole file, in a buffer from alloc(size) (which has room for size
+    // bytes, or is nullptr); *len is set to the bytes read. nullptr when the
+    // file cannot be opened or alloc fails.
+    char *(*readFile)(const char *path, char *(*alloc)(size_t size), size_t *len);
+    // Create or truncate path and write data[0, len); len, or -1 on error.
+    int64_t (*writeFile)(const char *path, const char *data, size_t len);
+    // Append data[0, len) to path, creating it; len, or -1 on error.
+    int64_t (*appendFile)(const char *path, const char *data, size_t len);
+    // Write data[0, len) at the end of the open descriptor fd (opened for
+    // appending) and wait until it is on stable storage; len, or -1 on
+    // error. A write-ahead log's commit: with io_uring the write and the
+    // fdatasync go down as one linked submission.
+    int64_t (*appendSync)(int fd, const char *data, size_t len);
+};
+
+// The backend the runtime uses.
+const FileIo &fileIo();
+
+// Every backend usable in this process, posix first.
+std::vector<const FileIo *> availableFileIo();
+
+// Close the cached append descriptors (e.g. before a test removes files).
+void closeAppendFiles();
+
+enum class MapAdvice { Normal, Sequential, Random, WillNeed, DontNeed };
+
+// A private read-only mapping of the whole file at path, or nullptr; *len is
+// set to its size. An empty file yields a valid zero-length view. Mappings
+// are remembered, so the calls below need only the returned address.
+const char *mapFile(const char *path, size_t *len);
+
+// The length of a mapFile() view, or -1 if addr is not one.
+int64_t mappingSize(const void *addr);
+
+// Unmap a mapFile() view; false if addr is not one.
+bool unmapFile(const void *addr);
+
+// madvise over the whole view; false if addr is not one or the hint failed.
+bool adviseMapping(const void *addr, MapAdvice advice);
+
+class FileReader {
+public:
+    static constexpr size_t kBufferSize = size_t(1) << 20;
+
+    // A reader over path, or nullptr if it cannot be opened.
+    static FileReader *open(const char *path);
+    // The process's standard input; never closed.
+    static FileReader &standardInput();
+
+    FileReader(const FileReader &) = delete;
+    FileReader &operator=(const FileReader &) = delete;
+    ~FileReader();
+
+    // True once every byte has been consumed; refills an empty buffer first.
+    bool atEnd();
+
+    // The bytes before the next delim, which is consumed but not included,
+    // or whatever is left before the end. false at the end with nothing
+    // left. The view is valid until the next call on this reader; a record
+    // longer than the buffer grows it.
+    bool nextRecord(char delim, const char **data, size_t *len);
+
+    // Up to max bytes into dst: what is buffered, else one read straight
+    // into dst (large requests skip the buffer). 0 at the end, -1 on error.
+    int64_t read(char *dst, size_t max);
+
+private:
+    explicit FileReader(int fd);
+    // Append what one read returns to the buffer; false at end or error.
+    bool fill();
+
+    int fd_;
+    std::vector<char> buf_;
+    size_t start_ = 0, end_ = 0;
+    bool eof_ = false;
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_FILE_IO_H
@@ -0,0 +1,185 @@
+#ifndef TOCIN_FLAT_MAP_H
+#define TOCIN_FLAT_MAP_H
+
+/**
+ * Open-addressing hash table behind the runtime's map handles
+ * (__tocin_map_* in concurrency_runtime.cpp), laid out like a Swiss table.
+ *
+ * Slots live in one flat array next to an array of control bytes, one per
+ * slot: 0x80 for an empty slot, or the low 7 bits of the key's hash (h2)
+ * for a full one. A lookup starts at the slot picked by the remaining hash
+ * bits (h1) and compares a whole group of control bytes against h2 at once
+ * (16 with SSE2, 8 in a 64-bit word otherwise), so it touches the slots of
+ * real candidates only and stops at the first group with an empty byte.
+ * The first group's control bytes are mirrored past the end so a group read
+ * never wraps. Tables grow by doubling at 7/8 load; the maps have no remove,
+ * so there are no tombstones.
+ *
+ * The table stores only trivially copyable slots; a Slot provides
+ * `uint64_t hash() const` so growing can rehash without the key's owner.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TOCIN_FLAT_MAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+// A group of control bytes, with match results as a bitmask over its slots.
+struct CtrlGroup {
+    static constexpr int8_t kEmpty = -128;
+#ifdef TOCIN_FLAT_MAP_SSE2
+    static constexpr size_t kWidth = 16;
+    static constexpr unsigned kShift = 0; // one mask bit per slot
+
+    explicit CtrlGroup(const int8_t *p) : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))) {}
+    uint64_t match(int8_t h2) const {
+        return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(h2)));
+    }
+    // Only an empty byte has its high bit set.
+    uint64_t matchEmpty() const { return (uint32_t)_mm_movemask_epi8(ctrl_); }
+
+private:
+    __m128i ctrl_;
+#else
+    static constexpr size_t kWidth = 8;
+    static constexpr unsigned kShift = 3; // the high bit of each byte
+
+    explicit CtrlGroup(const int8_t *p) {
+        std::memcpy(&ctrl_, p, sizeof ctrl_);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        ctrl_ = __builtin_bswap64(ctrl_);
+#endif
+    }
+    // May report a false match next to a true one; candidates are always
+    // checked against the key.
+    uint64_t match(int8_t h2) const {
+        constexpr uint64_t lsbs = 0x0101010101010101ull, msbs = 0x8080808080808080ull;
+        uint64_t x = ctrl_ ^ (lsbs * (uint8_t)h2);
+        return (x - lsbs) & ~x & msbs;
+    }
+    uint64_t matchEmpty() const { return ctrl_ & 0x8080808080808080ull; }
+
+private:
+    uint64_t ctrl_;
+#endif
+};
+
+template <typename Slot>
+class FlatTable {
+public:
+    FlatTable() = default;
+    FlatTable(const FlatTable &) = delete;
+    FlatTable &operator=(const FlatTable &) = delete;
+    ~FlatTable() { std::free(ctrl_); }
+
+    size_t size() const { return size_; }
+    // Entries the table holds before it next grows.
+    size_t capacity() const { return size_ + growthLeft_; }
+
+    // The slot whose key satisfies `eq`, or nullptr. `hash` must be the
+    // value Slot::hash() gives for that key.
+    template <typename Eq>
+    Slot *find(uint64_t hash, Eq eq) const {
+        if (!ctrl_) return nullptr;
+        const int8_t h2 = (int8_t)(hash & 0x7f);
+        size_t pos = (size_t)(hash >> 7) & mask_;
+        for (size_t step = CtrlGroup::kWidth;; step += CtrlGroup::kWidth) {
+            CtrlGroup g(ctrl_ + pos);
+            for (uint64_t m = g.match(h2); m; m &= m - 1) {
+                size_t i = (pos + ((size_t)__builtin_ctzll(m) >> CtrlGroup::kShift)) & mask_;
+                if (eq(slots_[i])) return &slots_[i];
+            }
+            if (g.matchEmpty()) return nullptr;
+            pos = (pos + step) & mask_;
+        }
+    }
+
+    // The slot for the key, and whether it was just claimed for it (then the
+    // caller must fill in all of it, consistent with `hash`).
+    template <typename Eq>
+    std::pair<Slot *, bool> findOrInsert(uint64_t hash, Eq eq) {
+        if (Slot *s = find(hash, eq)) return {s, false};
+        if (growthLeft_ == 0) resize(ctrl_ ? 2 * (mask_ + 1) : kMinCapacity);
+        size_t i = claim(hash);
+        ++size_;
+        --growthLeft_;
+        return {&slots_[i], true};
+    }
+
+    // Make room for n entries in total without another rehash.
+    void reserve(size_t n) {
+        if (n <= capacity()) return;
+        size_t cap = kMinCapacity;
+        while (maxLoad(cap) < n) cap *= 2;
+        resize(cap);
+    }
+
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t i = 0; ctrl_ && i <= mask_; ++i)
+            if (ctrl_[i] >= 0) f(slots_[i]);
+    }
+
+private:
+    static constexpr size_t kMinCapacity = 16; // a multiple of every group width
+
+    static size_t maxLoad(size_t cap) { return cap - cap / 8; }
+
+    // First empty slot on the probe sequence of `hash`; marks it full.
+    size_t claim(uint64_t hash) {
+        size_t pos = (size_t)(hash >> 7) & mask_;
+        for (size_t step = CtrlGroup::kWidth;; step += CtrlGroup::kWidth) {
+            uint64_t m = CtrlGroup(ctrl_ + pos).matchEmpty();
+            if (m) {
+                size_t i = (pos + ((size_t)__builtin_ctzll(m) >> CtrlGroup::kShift)) & mask_;
+                setCtrl(i, (int8_t)(hash & 0x7f));
+                return i;
+            }
+            pos = (pos + step) & mask_;
+        }
+    }
+
+    void setCtrl(size_t i, int8_t c) {
+        ctrl_[i] = c;
+        if (i < CtrlGroup::kWidth) ctrl_[mask_ + 1 + i] = c;
+    }
+
+    void resize(size_t cap) {
+        int8_t *oldCtrl = ctrl_;
+        Slot *oldSlots = slots_;
+        const size_t oldCap = oldCtrl ? mask_ + 1 : 0;
+
+        // One block: control bytes (plus the mirrored group), then slots.
+        const size_t ctrlBytes = (cap + CtrlGroup::kWidth + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+        ctrl_ = static_cast<int8_t *>(std::malloc(ctrlBytes + cap * sizeof(Slot)));
+        if (!ctrl_) std::abort();
+        std::memset(ctrl_, CtrlGroup::kEmpty, cap + CtrlGroup::kWidth);
+        slots_ = reinterpret_cast<Slot *>(reinterpret_cast<char *>(ctrl_) + ctrlBytes);
+        mask_ = cap - 1;
+        growthLeft_ = maxLoad(cap) - size_;
+
+        for (size_t i = 0; i < oldCap; ++i)
+            if (oldCtrl[i] >= 0) slots_[claim(oldSlots[i].hash())] = oldSlots[i];
+        std::free(oldCtrl);
+    }
+
+    int8_t *ctrl_ = nullptr;
+    Slot *slots_ = nullptr;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    size_t growthLeft_ = 0;
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_FLAT_MAP_H
@@ -0,0 +1,118 @@
+#ifndef TOCIN_HASH_H
+#define TOCIN_HASH_H
+
+/**
+ * Fast non-cryptographic hashing behind hashFastStr / hashFastBytes,
+ * hashSeeded / hashStrSeeded and hashCombine (__tocin_hash_fast* and
+ * __tocin_hash_combine in concurrency_runtime.cpp), and behind the string
+ * keys of the runtime's maps.
+ *
+ * This is wyhash (final version 4): 16 bytes per step, folded with a
+ * 64x64->128-bit multiply, or three independent 16-byte lanes per 48-byte
+ * block on long input. Keys of up to 16 bytes take two overlapping loads
+ * and one fold, with no loop. The result depends on the seed through every
+ * step, so a seed the caller keeps secret makes colliding keys impossible to
+ * precompute. FNV-1a (__tocin_hash_bytes) stays the stable content hash.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace tocin {
+namespace runtime {
+
+namespace wyhash_detail {
+
+constexpr uint64_t kSecret[4] = {0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull,
+                                 0x4d5a2da51de1aa47ull};
+
+// The 128-bit product of a and b, low half to a and high half to b.
+inline void mum(uint64_t &a, uint64_t &b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)a * b;
+    a = (uint64_t)r;
+    b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    a = lo;
+    b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+inline uint64_t mix(uint64_t a, uint64_t b) {
+    mum(a, b);
+    return a ^ b;
+}
+
+inline uint64_t read8(const uint8_t *p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+inline uint64_t read4(const uint8_t *p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+// 1 to 3 bytes: the first, middle and last.
+inline uint64_t read3(const uint8_t *p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+} // namespace wyhash_detail
+
+inline uint64_t wyhash(const void *key, size_t len, uint64_t seed) {
+    using namespace wyhash_detail;
+    const uint8_t *p = static_cast<const uint8_t *>(key);
+    seed ^= mix(seed ^ kSecret[0], kSecret[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ kSecret[1], read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ kSecret[2], read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ kSecret[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ kSecret[1], read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        // The last 16 bytes, overlapping what came before.
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+    a ^= kSecret[1];
+    b ^= seed;
+    mum(a, b);
+    return mix(a ^ kSecret[0] ^ len, b ^ kSecret[1]);
+}
+
+// Folds x into the running hash h: the 8 bytes of x hashed with h as the
+// seed. Order matters, so combining a then b differs from b then a.
+inline uint64_t hashCombine(uint64_t h, uint64_t x) { return wyhash(&x, sizeof x, h); }
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_HASH_H
@@ -0,0 +1,329 @@
+// HTTP/1.1 request and response heads and chunked bodies, parsed in place.
+#include "http_parser.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TOCIN_HTTP_SSE2 1
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+inline char lower(char c) { return (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c; }
+
+// RFC 9110 tchar: what a method or header name may be made of.
+bool isToken(unsigned char c) {
+    if (c >= '0' && c <= '9') return true;
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') return true;
+    return c != 0 && std::strchr("!#$%&'*+-.^_`|~", c) != nullptr;
+}
+
+// The first byte in [p, end) that cannot be part of a request target (a
+// control byte, space or DEL) or, with `tabOk`, of a header value (a control
+// byte other than tab, or DEL); end if there is none.
+const char *findDelimiter(const char *p, const char *end, bool tabOk) {
+#ifdef TOCIN_HTTP_SSE2
+    const __m128i below = _mm_set1_epi8(tabOk ? 0x20 : 0x21); // first allowed byte
+    const __m128i del = _mm_set1_epi8(0x7f);
+    const __m128i tab = _mm_set1_epi8(0x09);
+    while (end - p >= 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        // max(x, below) == x exactly when x >= below, unsigned.
+        __m128i ok = _mm_cmpeq_epi8(_mm_max_epu8(x, below), x);
+        __m128i stop = _mm_or_si128(_mm_andnot_si128(ok, _mm_set1_epi8(-1)), _mm_cmpeq_epi8(x, del));
+        if (tabOk) stop = _mm_andnot_si128(_mm_cmpeq_epi8(x, tab), stop);
+        int mask = _mm_movemask_epi8(stop);
+        if (mask) return p + __builtin_ctz((unsigned)mask);
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        unsigned char c = (unsigned char)*p;
+        if (c == 0x7f || (c < 0x20 && !(tabOk && c == '\t')) || (!tabOk && c == ' ')) return p;
+    }
+    return end;
+}
+
+// The end of the head that starts at p: just past the blank line, or
+// nullptr if it has not arrived.
+const char *findHeadEnd(const char *p, const char *end) {
+    while (p < end) {
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', (size_t)(end - p)));
+        if (!nl) return nullptr;
+        const char *next = nl + 1;
+        if (next < end && *next == '\n') return next + 1;
+        if (next + 1 < end && next[0] == '\r' && next[1] == '\n') return next + 2;
+        if (next + 1 >= end) return nullptr; // the next line may yet be blank
+        p = next;
+    }
+    return nullptr;
+}
+
+// Consume an optional '\r' then a '\n' at *p; false if the line does not
+// end there.
+bool lineEnd(const char *&p, const char *end) {
+    if (p < end && *p == '\r') ++p;
+    if (p >= end || *p != '\n') return false;
+    ++p;
+    return true;
+}
+
+bool equalsLower(const char *p, size_t n, const char *lowerName) {
+    size_t m = std::strlen(lowerName);
+    if (n != m) return false;
+    for (size_t i = 0; i < n; ++i)
+        if (lower(p[i]) != lowerName[i]) return false;
+    return true;
+}
+
+// Does a comma-separated header value list `token` (case-insensitively)?
+// With `lastOnly`, only its final element counts.
+bool listHas(const char *p, size_t n, const char *token, bool lastOnly) {
+    bool found = false;
+    size_t i = 0;
+    while (i <= n) {
+        size_t j = i;
+        while (j < n && p[j] != ',') ++j;
+        size_t a = i, b = j;
+        while (a < b && (p[a] == ' ' || p[a] == '\t')) ++a;
+        while (b > a && (p[b - 1] == ' ' || p[b - 1] == '\t')) --b;
+        bool match = equalsLower(p + a, b - a, token);
+        if (lastOnly) found = match;
+        else if (match) return true;
+        i = j + 1;
+    }
+    return found;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = lower(c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+} // namespace
+
+bool httpHeaderIs(const char *buf, const HttpHeader &h, const char *name) {
+    return equalsLower(buf + h.name.off, h.name.len, name);
+}
+
+namespace {
+
+// The header lines from p through the blank line, into out; false if one
+// is malformed. Records whether a Transfer-Encoding header was seen and
+// sets out->keepAlive from the version and the Connection header.
+bool parseHeaders(const char *buf, const char *p, const char *end, HttpMessageHead *out, bool *sawEncoding) {
+    bool close = false, keepAlive = false;
+    for (;;) {
+        if (lineEnd(p, end)) break; // the blank line
+        if (out->headerCount == kHttpMaxHeaders) return false;
+        const char *n = p;
+        while (p < end && isToken((unsigned char)*p)) ++p;
+        // No space before the colon, and no obsolete folded lines.
+        if (p == n || p >= end || *p != ':') return false;
+        HttpHeader &h = out->headers[out->headerCount++];
+        h.name = {(size_t)(n - buf), (size_t)(p - n)};
+        ++p;
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        const char *v = p;
+        p = findDelimiter(p, end, true);
+        const char *ve = p;
+        if (!lineEnd(p, end)) return false;
+        while (ve > v && (ve[-1] == ' ' || ve[-1] == '\t')) --ve;
+        h.value = {(size_t)(v - buf), (size_t)(ve - v)};
+
+        size_t vlen = (size_t)(ve - v);
+        if (httpHeaderIs(buf, h, "content-length")) {
+            if (vlen == 0 || vlen > 18) return false;
+            int64_t cl = 0;
+            for (size_t i = 0; i < vlen; ++i) {
+                if (v[i] < '0' || v[i] > '9') return false;
+                cl = cl * 10 + (v[i] - '0');
+            }
+            if (out->contentLength >= 0 && out->contentLength != cl) return false;
+            out->contentLength = cl;
+        } else if (httpHeaderIs(buf, h, "transfer-encoding")) {
+            *sawEncoding = true;
+            out->chunked = listHas(v, vlen, "chunked", true);
+        } else if (httpHeaderIs(buf, h, "connection")) {
+            close = close || listHas(v, vlen, "close", false);
+            keepAlive = keepAlive || listHas(v, vlen, "keep-alive", false);
+        }
+    }
+    out->keepAlive = out->minorVersion >= 1 ? !close : keepAlive && !close;
+    return true;
+}
+
+} // namespace
+
+int64_t parseHttpRequest(const char *buf, size_t off, size_t len, HttpRequestHead *out) {
+    const char *start = buf + off, *end = start + len, *p = start;
+    // A stray empty line before the request line is allowed (RFC 9112 2.2).
+    if (p < end && *p == '\r') ++p;
+    if (p < end && *p == '\n') start = ++p;
+    else p = start;
+    const char *headEnd = findHeadEnd(p, end);
+    if (!headEnd) {
+        // Nothing but a token so far, or a bad first byte: fail early on the latter.
+        if (p < end && !isToken((unsigned char)*p)) return kHttpMalformed;
+        return kHttpIncomplete;
+    }
+    end = headEnd;
+
+    *out = HttpRequestHead();
+    const char *m = p;
+    while (p < end && isToken((unsigned char)*p)) ++p;
+    if (p == m || p >= end || *p != ' ') return kHttpMalformed;
+    out->method = {(size_t)(m - buf), (size_t)(p - m)};
+    ++p;
+    const char *t = p;
+    p = findDelimiter(p, end, false);
+    if (p == t || p >= end || *p != ' ') return kHttpMalformed;
+    out->path = {(size_t)(t - buf), (size_t)(p - t)};
+    ++p;
+    if (end - p < 8 || std::memcmp(p, "HTTP/1.", 7) != 0 || p[7] < '0' || p[7] > '9')
+        return kHttpMalformed;
+    out->minorVersion = p[7] - '0';
+    p += 8;
+    if (!lineEnd(p, end)) return kHttpMalformed;
+
+    bool sawEncoding = false;
+    if (!parseHeaders(buf, p, end, out, &sawEncoding)) return kHttpMalformed;
+    // A body framed two ways, or by an encoding other than chunked, is how
+    // requests get smuggled past proxies; refuse rather than pick one.
+    if (sawEncoding && (!out->chunked || out->contentLength >= 0)) return kHttpMalformed;
+    return (int64_t)(end - (buf + off));
+}
+
+int64_t parseHttpResponse(const char *buf, size_t off, size_t len, HttpResponseHead *out) {
+    const char *start = buf + off, *end = start + len, *p = start;
+    const char *headEnd = findHeadEnd(p, end);
+    if (!headEnd) {
+        size_t have = len < 5 ? len : 5;
+        if (std::memcmp(p, "HTTP/", have) != 0) return kHttpMalformed;
+        return kHttpIncomplete;
+    }
+    end = headEnd;
+
+    *out = HttpResponseHead();
+    if (end - p < 13 || std::memcmp(p, "HTTP/1.", 7) != 0 || p[7] < '0' || p[7] > '9' || p[8] != ' ')
+        return kHttpMalformed;
+    out->minorVersion = p[7] - '0';
+    p += 9;
+    for (int i = 0; i < 3; ++i, ++p) {
+        if (*p < '0' || *p > '9') return kHttpMalformed;
+        out->status = out->status * 10 + (*p - '0');
+    }
+    if (out->status < 100) return kHttpMalformed;
+    // The reason phrase may be empty, and so may the space before it.
+    if (*p == ' ') ++p;
+    const char *r = p;
+    p = findDelimiter(p, end, true);
+    out->reason = {(size_t)(r - buf), (size_t)(p - r)};
+    if (!lineEnd(p, end)) return kHttpMalformed;
+
+    bool sawEncoding = false;
+    if (!parseHeaders(buf, p, end, out, &sawEncoding)) return kHttpMalformed;
+    if (out->status < 200 || out->status == 204 || out->status == 304) {
+        out->noBody = true;
+        out->chunked = false;
+        out->contentLength = -1;
+    } else if (sawEncoding) {
+        out->contentLength = -1;
+        out->untilClose = !out->chunked;
+    } else {
+        out->untilClose = out->contentLength < 0;
+    }
+    if (out->untilClose) out->keepAlive = false;
+    return (int64_t)(end - (buf + off));
+}
+
+int64_t HttpChunkedDecoder::decode(char *buf, size_t *len) {
+    char *dst = buf;
+    const char *src = buf, *end = buf + *len;
+    while (src < end) {
+        switch (state_) {
+        case State::Size: {
+            int d = hexValue(*src);
+            if (d >= 0) {
+                if (++digits_ > 15) return kHttpMalformed;
+                left_ = left_ * 16 + (size_t)d;
+                ++src;
+                break;
+            }
+            if (digits_ == 0) return kHttpMalformed;
+            if (*src == '\r') state_ = State::SizeLf;
+            else if (*src == ';' || *src == ' ' || *src == '\t') state_ = State::SizeExt;
+            else if (*src != '\n') return kHttpMalformed;
+            if (*src == '\n') {
+                state_ = left_ ? State::Data : State::Trailer;
+                lineEmpty_ = true;
+            }
+            ++src;
+            break;
+        }
+        case State::SizeExt:
+            if (*src == '\n') {
+                state_ = left_ ? State::Data : State::Trailer;
+                lineEmpty_ = true;
+            }
+            ++src;
+            break;
+        case State::SizeLf:
+            if (*src != '\n') return kHttpMalformed;
+            state_ = left_ ? State::Data : State::Trailer;
+            lineEmpty_ = true;
+            ++src;
+            break;
+        case State::Data: {
+            size_t n = (size_t)(end - src) < left_ ? (size_t)(end - src) : left_;
+            if (dst != src) std::memmove(dst, src, n);
+            dst += n;
+            src += n;
+            left_ -= n;
+            if (left_ == 0) state_ = State::DataCr;
+            break;
+        }
+        case State::DataCr:
+            if (*src == '\r') state_ = State::DataLf;
+            else if (*src == '\n') { state_ = State::Size; digits_ = 0; }
+            else return kHttpMalformed;
+            ++src;
+            break;
+        case State::DataLf:
+            if (*src != '\n') return kHttpMalformed;
+            state_ = State::Size;
+            digits_ = 0;
+            ++src;
+            break;
+        case State::Trailer:
+        case State::TrailerLine:
+            if (*src == '\n') {
+                ++src;
+                if (lineEmpty_) {
+                    // The body is over; what follows belongs to the next request.
+                    size_t rest = (size_t)(end - src);
+                    if (dst != src) std::memmove(dst, src, rest);
+                    *len = (size_t)(dst - buf);
+                    *this = HttpChunkedDecoder();
+                    return (int64_t)rest;
+                }
+                lineEmpty_ = true;
+                break;
+            }
+            if (*src != '\r') lineEmpty_ = false;
+            ++src;
+            break;
+        }
+    }
+    *len = (size_t)(dst - buf);
+    return kHttpIncomplete;
+}
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,106 @@
+#ifndef TOCIN_HTTP_PARSER_H
+#define TOCIN_HTTP_PARSER_H
+
+/**
+ * Incremental HTTP/1.1 request parsing for the httpParse / httpConn*
+ * builtins (concurrency_runtime.cpp) and web/http's serveParsed, and
+ * response parsing for the client side (httpClientConnNew, net/advanced's
+ * pooled client).
+ *
+ * Nothing is copied: a parsed head is a set of offsets into the caller's
+ * buffer. parseHttpRequest() reports kHttpIncomplete until the whole head
+ * (through the blank line) is in the buffer, so a server calls it again
+ * after each read; several pipelined requests in one buffer are parsed one
+ * after another from the previous head's end. Header lines and the request
+ * target are scanned 16 bytes at a time where SSE2 is available.
+ *
+ * HttpChunkedDecoder undoes Transfer-Encoding: chunked in place, across as
+ * many reads as the body takes.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tocin {
+namespace runtime {
+
+constexpr int64_t kHttpMalformed = -1;
+constexpr int64_t kHttpIncomplete = -2;
+constexpr size_t kHttpMaxHeaders = 64;
+
+// [off, off + len) of the buffer given to the parser.
+struct HttpSpan {
+    size_t off = 0;
+    size_t len = 0;
+};
+
+struct HttpHeader {
+    HttpSpan name;
+    HttpSpan value; // surrounding spaces and tabs trimmed
+};
+
+// What requests and responses have in common.
+struct HttpMessageHead {
+    int minorVersion = 1; // HTTP/1.<minorVersion>
+    size_t headerCount = 0;
+    HttpHeader headers[kHttpMaxHeaders];
+    int64_t contentLength = -1; // -1 without a Content-Length header
+    bool chunked = false;       // Transfer-Encoding ends in "chunked"
+    bool keepAlive = true;      // per version and Connection header
+};
+
+struct HttpRequestHead : HttpMessageHead {
+    HttpSpan method;
+    HttpSpan path; // the request target as sent, query string included
+};
+
+struct HttpResponseHead : HttpMessageHead {
+    int status = 0;
+    HttpSpan reason;
+    // The body runs to the end of the connection: no length was given, or
+    // the transfer coding is not chunked (RFC 9112 6.3). keepAlive is then
+    // false.
+    bool untilClose = false;
+    // 1xx, 204 and 304 responses never have a body, whatever the headers say.
+    bool noBody = false;
+};
+
+// Parse the request head at buf[off, off + len). Returns the head's length
+// (request line, headers and the blank line), kHttpIncomplete when the
+// blank line has not arrived yet, or kHttpMalformed (including more than
+// kHttpMaxHeaders headers and conflicting body framing). Spans in *out are
+// offsets from buf, not from buf + off.
+int64_t parseHttpRequest(const char *buf, size_t off, size_t len, HttpRequestHead *out);
+
+// parseHttpRequest for a response head. A client cannot refuse to read a
+// response framed two ways, so Transfer-Encoding overrides Content-Length
+// here rather than being malformed. The answer to a HEAD request has no
+// body either, which only the caller knows.
+int64_t parseHttpResponse(const char *buf, size_t off, size_t len, HttpResponseHead *out);
+
+// Case-insensitive match of a header name against `name` (lower-case).
+bool httpHeaderIs(const char *buf, const HttpHeader &h, const char *name);
+
+class HttpChunkedDecoder {
+public:
+    // Decode buf[0, *len) in place: the body bytes move to the front and
+    // *len becomes their count. Returns kHttpIncomplete when the body goes
+    // on past the input (call again on the next bytes; the state carries
+    // over, including a chunk-size line split between reads),
+    // kHttpMalformed, or, once the final chunk and trailer are through, the
+    // number of bytes that followed the body, which are moved to sit right
+    // after the decoded bytes.
+    int64_t decode(char *buf, size_t *len);
+
+private:
+    enum class State { Size, SizeExt, SizeLf, Data, DataCr, DataLf, Trailer, TrailerLine };
+    State state_ = State::Size;
+    size_t left_ = 0;    // bytes of the current chunk still to come
+    int digits_ = 0;     // hex digits read of the size line
+    bool lineEmpty_ = true; // no byte yet on the current trailer line
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_HTTP_PARSER_H
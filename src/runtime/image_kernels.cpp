@@ -0,0 +1,380 @@
+// Image kernels: the portable and SSE2 row-kernel tables, the dispatch that
+// picks among them and the AVX2 table, the banded drivers of the filters
+// and resizes, and the img* builtins' entry points.
+#include "image_kernels_impl.h"
+#include "kernel_support.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TOCIN_IMAGE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+constexpr ImageKernels kScalarKernels{"scalar", &addRowScalar, &slideRowScalar, &sobelRowScalar,
+                                      &lerpRowsScalar};
+
+#ifdef TOCIN_IMAGE_SSE2
+// The 16 bytes at p as two vectors of eight u16 lanes.
+inline void widen(const uint8_t *p, __m128i &lo, __m128i &hi) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p), z = _mm_setzero_si128();
+    lo = _mm_unpacklo_epi8(v, z);
+    hi = _mm_unpackhi_epi8(v, z);
+}
+
+void addRowSse2(uint32_t *acc, const uint8_t *row, size_t n) {
+    __m128i z = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i lo, hi;
+        widen(row + i, lo, hi);
+        __m128i *a = (__m128i *)(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi16(lo, z)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, z)));
+        _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi16(hi, z)));
+        _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi16(hi, z)));
+    }
+    addRowScalar(acc + i, row + i, n - i);
+}
+
+// The differences add - sub fit in i16; their sign words extend them to i32.
+void slideRowSse2(uint32_t *acc, const uint8_t *add, const uint8_t *sub, size_t n) {
+    __m128i z = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i alo, ahi, slo, shi;
+        widen(add + i, alo, ahi);
+        widen(sub + i, slo, shi);
+        __m128i dlo = _mm_sub_epi16(alo, slo), dhi = _mm_sub_epi16(ahi, shi);
+        __m128i sgnlo = _mm_cmpgt_epi16(z, dlo), sgnhi = _mm_cmpgt_epi16(z, dhi);
+        __m128i *a = (__m128i *)(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi16(dlo, sgnlo)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(dlo, sgnlo)));
+        _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi16(dhi, sgnhi)));
+        _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi16(dhi, sgnhi)));
+    }
+    slideRowScalar(acc + i, add + i, sub + i, n - i);
+}
+
+inline __m128i load8(const uint8_t *p) {
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), _mm_setzero_si128());
+}
+
+inline __m128i abs16(__m128i v) { return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v)); }
+
+void sobelRowSse2(uint8_t *dst, const uint8_t *a, const uint8_t *r, const uint8_t *b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i tl = load8(a + i - 1), tc = load8(a + i), tr = load8(a + i + 1);
+        __m128i ml = load8(r + i - 1), mr = load8(r + i + 1);
+        __m128i bl = load8(b + i - 1), bc = load8(b + i), br = load8(b + i + 1);
+        __m128i gx = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(tr, br), _mm_add_epi16(mr, mr)),
+                                   _mm_add_epi16(_mm_add_epi16(tl, bl), _mm_add_epi16(ml, ml)));
+        __m128i gy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(bl, br), _mm_add_epi16(bc, bc)),
+                                   _mm_add_epi16(_mm_add_epi16(tl, tr), _mm_add_epi16(tc, tc)));
+        __m128i mag = _mm_add_epi16(abs16(gx), abs16(gy));
+        _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(mag, mag));
+    }
+    sobelRowScalar(dst + i, a + i, r + i, b + i, n - i);
+}
+
+void lerpRowsSse2(uint8_t *dst, const uint16_t *top, const uint16_t *bottom, size_t n, uint32_t fy) {
+    __m128i w0 = _mm_set1_epi16(static_cast<short>(256 - fy)), w1 = _mm_set1_epi16(static_cast<short>(fy));
+    __m128i half = _mm_set1_epi16(128);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i t = _mm_loadu_si128((const __m128i *)(top + i));
+        __m128i bt = _mm_loadu_si128((const __m128i *)(bottom + i));
+        __m128i v = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(t, w0), _mm_mullo_epi16(bt, w1)), half);
+        v = _mm_srli_epi16(v, 8);
+        _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(v, v));
+    }
+    lerpRowsScalar(dst + i, top + i, bottom + i, n - i, fy);
+}
+
+constexpr ImageKernels kSse2Kernels{"sse2", &addRowSse2, &slideRowSse2, &sobelRowSse2, &lerpRowsSse2};
+#endif
+
+bool cpuHasAvx2() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+const ImageKernels *chooseKernels() {
+    auto available = availableImageKernels();
+    if (const char *forced = std::getenv("TOCIN_IMAGE_KERNELS")) {
+        for (const auto *table : available)
+            if (std::strcmp(table->name, forced) == 0) return table;
+    }
+    return available.back();
+}
+
+// Rows per band, and the image size below which the pool hand-off costs
+// more than it saves.
+constexpr int64_t kBandRows = 32;
+constexpr int64_t kParallelPixels = int64_t(1) << 18;
+
+// Run body(rowLo, rowHi) over bands of [0, rows), on the pool once there
+// are `pixels` worth of work. Neighbouring bands handed to one participant
+// arrive as one range.
+template <class F> void forBands(int64_t rows, int64_t pixels, F &body) {
+    struct Ctx {
+        F *body;
+        int64_t rows;
+    } ctx{&body, rows};
+    int64_t bands = (rows + kBandRows - 1) / kBandRows;
+    auto run = [](void *c, int64_t lo, int64_t hi) {
+        auto *x = static_cast<Ctx *>(c);
+        (*x->body)(lo * kBandRows, std::min(hi * kBandRows, x->rows));
+    };
+    if (bands > 1 && pixels >= kParallelPixels)
+        __tocin_parallel_chunks(bands, run, &ctx);
+    else
+        run(&ctx, 0, bands);
+}
+
+const uint8_t *row(GrayImage img, int64_t y) {
+    y = y < 0 ? 0 : y >= img.height ? img.height - 1 : y;
+    return img.pixels + y * img.width;
+}
+
+uint8_t *rowOut(GrayImage img, int64_t y) { return img.pixels + y * img.width; }
+
+bool usable(GrayImage img) { return img.pixels && img.width > 0 && img.height > 0; }
+
+// Sobel of one pixel, clamping its neighbours.
+uint8_t sobelPixel(GrayImage src, const uint8_t *a, const uint8_t *r, const uint8_t *b, int64_t x) {
+    int64_t l = x > 0 ? x - 1 : 0, rt = x + 1 < src.width ? x + 1 : x;
+    int gx = (a[rt] + 2 * r[rt] + b[rt]) - (a[l] + 2 * r[l] + b[l]);
+    int gy = (b[l] + 2 * b[x] + b[rt]) - (a[l] + 2 * a[x] + a[rt]);
+    int mag = sobelAbs(gx) + sobelAbs(gy);
+    return static_cast<uint8_t>(mag > 255 ? 255 : mag);
+}
+
+// Bilinear source coordinate of each destination index: the lower sample
+// and the 8-bit weight of the upper one.
+void bilinearTaps(int64_t srcLen, int64_t dstLen, std::vector<int64_t> &lo, std::vector<int64_t> &hi,
+                  std::vector<uint32_t> &frac) {
+    lo.resize(dstLen);
+    hi.resize(dstLen);
+    frac.resize(dstLen);
+    double scale = static_cast<double>(srcLen) / static_cast<double>(dstLen);
+    for (int64_t i = 0; i < dstLen; ++i) {
+        double s = (static_cast<double>(i) + 0.5) * scale - 0.5;
+        if (s < 0) s = 0;
+        int64_t s0 = static_cast<int64_t>(s);
+        if (s0 >= srcLen - 1) {
+            lo[i] = hi[i] = srcLen - 1;
+            frac[i] = 0;
+            continue;
+        }
+        uint32_t f = static_cast<uint32_t>((s - static_cast<double>(s0)) * 256.0 + 0.5);
+        if (f >= 256) {
+            ++s0;
+            f = 0;
+        }
+        lo[i] = s0;
+        hi[i] = s0 + 1 < srcLen ? s0 + 1 : s0;
+        frac[i] = f;
+    }
+}
+
+// Source span [lo[i], hi[i]) of each destination index under area
+// averaging; at least one sample wide.
+void areaSpans(int64_t srcLen, int64_t dstLen, std::vector<int64_t> &lo, std::vector<int64_t> &hi) {
+    lo.resize(dstLen);
+    hi.resize(dstLen);
+    for (int64_t i = 0; i < dstLen; ++i) {
+        lo[i] = i * srcLen / dstLen;
+        hi[i] = std::max((i + 1) * srcLen / dstLen, lo[i] + 1);
+    }
+}
+
+} // namespace
+
+std::vector<const ImageKernels *> availableImageKernels() {
+    std::vector<const ImageKernels *> tables{&kScalarKernels};
+#ifdef TOCIN_IMAGE_SSE2
+    tables.push_back(&kSse2Kernels);
+#endif
+    if (const ImageKernels *avx2 = avx2ImageKernels())
+        if (cpuHasAvx2()) tables.push_back(avx2);
+    return tables;
+}
+
+const ImageKernels &imageKernels() {
+    static const ImageKernels *chosen = chooseKernels();
+    return *chosen;
+}
+
+void boxBlur(const ImageKernels &k, GrayImage src, GrayImage dst, int64_t radius) {
+    if (!usable(src) || !usable(dst) || src.width != dst.width || src.height != dst.height) return;
+    int64_t w = src.width, r = std::clamp<int64_t>(radius, 0, 4096);
+    if (r == 0) {
+        std::memmove(dst.pixels, src.pixels, static_cast<size_t>(w * src.height));
+        return;
+    }
+    // floor(sum / d) as (sum + 0.5) / d in doubles: never off by one for the
+    // sums a window of bytes can reach.
+    double inv = 1.0 / static_cast<double>((2 * r + 1) * (2 * r + 1));
+    auto band = [&](int64_t lo, int64_t hi) {
+        std::vector<uint32_t> acc(static_cast<size_t>(w), 0);
+        std::vector<uint32_t> padded(static_cast<size_t>(w + 2 * r));
+        for (int64_t j = lo - r; j <= lo + r; ++j) k.addRow(acc.data(), row(src, j), static_cast<size_t>(w));
+        for (int64_t y = lo; y < hi; ++y) {
+            if (y > lo) k.slideRow(acc.data(), row(src, y + r), row(src, y - r - 1), static_cast<size_t>(w));
+            // Edge-clamped copy of the column sums, then one window sum slid
+            // along the row.
+            for (int64_t i = 0; i < r; ++i) {
+                padded[i] = acc[0];
+                padded[w + r + i] = acc[w - 1];
+            }
+            std::memcpy(padded.data() + r, acc.data(), static_cast<size_t>(w) * sizeof(uint32_t));
+            uint64_t sum = 0;
+            for (int64_t i = 0; i < 2 * r; ++i) sum += padded[i];
+            uint8_t *out = rowOut(dst, y);
+            for (int64_t x = 0; x < w; ++x) {
+                sum += padded[x + 2 * r];
+                out[x] = static_cast<uint8_t>((static_cast<double>(sum) + 0.5) * inv);
+                sum -= padded[x];
+            }
+        }
+    };
+    forBands(src.height, w * src.height, band);
+}
+
+void sobel(const ImageKernels &k, GrayImage src, GrayImage dst) {
+    if (!usable(src) || !usable(dst) || src.width != dst.width || src.height != dst.height) return;
+    int64_t w = src.width;
+    auto band = [&](int64_t lo, int64_t hi) {
+        for (int64_t y = lo; y < hi; ++y) {
+            const uint8_t *a = row(src, y - 1), *r = row(src, y), *b = row(src, y + 1);
+            uint8_t *out = rowOut(dst, y);
+            out[0] = sobelPixel(src, a, r, b, 0);
+            if (w > 2) k.sobelRow(out + 1, a + 1, r + 1, b + 1, static_cast<size_t>(w - 2));
+            if (w > 1) out[w - 1] = sobelPixel(src, a, r, b, w - 1);
+        }
+    };
+    forBands(src.height, w * src.height, band);
+}
+
+void resize(const ImageKernels &k, GrayImage src, GrayImage dst, ResizeMode mode) {
+    if (!usable(src) || !usable(dst)) return;
+    int64_t sw = src.width, sh = src.height, dw = dst.width, dh = dst.height;
+    int64_t work = std::max(sw * sh, dw * dh);
+    if (mode == ResizeMode::Bilinear) {
+        std::vector<int64_t> x0, x1, y0, y1;
+        std::vector<uint32_t> fx, fy;
+        bilinearTaps(sw, dw, x0, x1, fx);
+        bilinearTaps(sh, dh, y0, y1, fy);
+        auto band = [&](int64_t lo, int64_t hi) {
+            // The horizontally interpolated source rows, kept while
+            // consecutive destination rows reuse them.
+            std::vector<uint16_t> rows[2] = {std::vector<uint16_t>(dw), std::vector<uint16_t>(dw)};
+            int64_t cached[2] = {-1, -1};
+            auto interpolated = [&](int64_t sy, int64_t other) -> const uint16_t * {
+                for (int s = 0; s < 2; ++s)
+                    if (cached[s] == sy) return rows[s].data();
+                int s = cached[0] == other ? 1 : 0;
+                const uint8_t *in = row(src, sy);
+                uint16_t *h = rows[s].data();
+                for (int64_t x = 0; x < dw; ++x)
+                    h[x] = static_cast<uint16_t>((in[x0[x]] * (256 - fx[x]) + in[x1[x]] * fx[x] + 128) >> 8);
+                cached[s] = sy;
+                return h;
+            };
+            for (int64_t y = lo; y < hi; ++y) {
+                const uint16_t *top = interpolated(y0[y], y1[y]);
+                const uint16_t *bottom = interpolated(y1[y], y0[y]);
+                k.lerpRows(rowOut(dst, y), top, bottom, static_cast<size_t>(dw), fy[y]);
+            }
+        };
+        forBands(dh, work, band);
+        return;
+    }
+    if (mode == ResizeMode::Area) {
+        std::vector<int64_t> xlo, xhi, ylo, yhi;
+        areaSpans(sw, dw, xlo, xhi);
+        areaSpans(sh, dh, ylo, yhi);
+        auto band = [&](int64_t lo, int64_t hi) {
+            std::vector<uint32_t> acc(static_cast<size_t>(sw));
+            for (int64_t y = lo; y < hi; ++y) {
+                std::fill(acc.begin(), acc.end(), 0u);
+                for (int64_t sy = ylo[y]; sy < yhi[y]; ++sy) k.addRow(acc.data(), row(src, sy), static_cast<size_t>(sw));
+                uint64_t rowsIn = static_cast<uint64_t>(yhi[y] - ylo[y]);
+                uint8_t *out = rowOut(dst, y);
+                for (int64_t x = 0; x < dw; ++x) {
+                    uint64_t sum = 0;
+                    for (int64_t sx = xlo[x]; sx < xhi[x]; ++sx) sum += acc[sx];
+                    uint64_t count = rowsIn * static_cast<uint64_t>(xhi[x] - xlo[x]);
+                    out[x] = static_cast<uint8_t>((sum + count / 2) / count);
+                }
+            }
+        };
+        forBands(dh, work, band);
+        return;
+    }
+    std::vector<int64_t> sx(static_cast<size_t>(dw));
+    for (int64_t x = 0; x < dw; ++x) sx[x] = x * sw / dw;
+    auto band = [&](int64_t lo, int64_t hi) {
+        for (int64_t y = lo; y < hi; ++y) {
+            const uint8_t *in = row(src, y * sh / dh);
+            uint8_t *out = rowOut(dst, y);
+            for (int64_t x = 0; x < dw; ++x) out[x] = in[sx[x]];
+        }
+    };
+    forBands(dh, work, band);
+}
+
+} // namespace runtime
+} // namespace tocin
+
+namespace {
+
+// An img builtin's (address, width, height); a non-positive size is empty.
+tocin::runtime::GrayImage image(int64_t img, int64_t width, int64_t height) {
+    if (width <= 0 || height <= 0) return {nullptr, 0, 0};
+    return {reinterpret_cast<uint8_t *>(img), width, height};
+}
+
+} // namespace
+
+extern "C" {
+
+// imgBoxBlur(src, dst, width, height, radius): mean of each pixel's
+// (2 * radius + 1)^2 window.
+int64_t __tocin_img_box_blur(int64_t src, int64_t dst, int64_t width, int64_t height, int64_t radius) {
+    tocin::runtime::boxBlur(tocin::runtime::imageKernels(), image(src, width, height), image(dst, width, height),
+                            radius);
+    return 0;
+}
+
+// imgSobel(src, dst, width, height): Sobel edge magnitude.
+int64_t __tocin_img_sobel(int64_t src, int64_t dst, int64_t width, int64_t height) {
+    tocin::runtime::sobel(tocin::runtime::imageKernels(), image(src, width, height), image(dst, width, height));
+    return 0;
+}
+
+// imgResize(src, sw, sh, dst, dw, dh, mode): mode 0 nearest, 1 bilinear,
+// 2 area; anything else is nearest.
+int64_t __tocin_img_resize(int64_t src, int64_t sw, int64_t sh, int64_t dst, int64_t dw, int64_t dh,
+                           int64_t mode) {
+    auto m = mode == 1   ? tocin::runtime::ResizeMode::Bilinear
+             : mode == 2 ? tocin::runtime::ResizeMode::Area
+                         : tocin::runtime::ResizeMode::Nearest;
+    tocin::runtime::resize(tocin::runtime::imageKernels(), image(src, sw, sh), image(dst, dw, dh), m);
+    return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,81 @@
+#ifndef TOCIN_IMAGE_KERNELS_H
+#define TOCIN_IMAGE_KERNELS_H
+
+/**
+ * Grayscale image kernels behind ml.computer_vision's img* builtins
+ * (__tocin_img_* in image_kernels.cpp).
+ *
+ * An image is width * height bytes, row-major, no padding. Every operation
+ * reads a source image and writes a destination that must not overlap it.
+ * Neighbourhoods clamp at the edges, as getPixel does.
+ *
+ * The filters are separable. The box blur keeps one running sum per column
+ * down the image (add the row entering the window, subtract the row
+ * leaving it), then slides a window sum along each row, so its cost does
+ * not depend on the radius. Work is split into bands of rows: a band's
+ * source rows and its one row of column sums stay in cache, and bands of
+ * large images run in parallel on the parallel_for pool.
+ *
+ * The row kernels are in a table per instruction set and imageKernels()
+ * picks the best one the CPU supports: AVX2, then SSE2 on x86-64, otherwise
+ * portable code. TOCIN_IMAGE_KERNELS forces a table by name ("avx2", "sse2",
+ * "scalar"). Every table computes the same bytes.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+struct ImageKernels {
+    const char *name;
+    // acc[i] += row[i] for i < n.
+    void (*addRow)(uint32_t *acc, const uint8_t *row, size_t n);
+    // acc[i] += add[i] - sub[i]; acc never goes negative.
+    void (*slideRow)(uint32_t *acc, const uint8_t *add, const uint8_t *sub, size_t n);
+    // Sobel magnitude min(|gx| + |gy|, 255) of pixels [0, n) of `row`, whose
+    // neighbours [-1, n] in row, above and below are all readable.
+    void (*sobelRow)(uint8_t *dst, const uint8_t *above, const uint8_t *row, const uint8_t *below,
+                     size_t n);
+    // dst[i] = (top[i] * (256 - fy) + bottom[i] * fy + 128) >> 8, with
+    // top and bottom <= 255 and fy <= 256.
+    void (*lerpRows)(uint8_t *dst, const uint16_t *top, const uint16_t *bottom, size_t n, uint32_t fy);
+};
+
+// The table the runtime uses.
+const ImageKernels &imageKernels();
+
+// Every table this CPU can run, portable one first.
+std::vector<const ImageKernels *> availableImageKernels();
+
+// Defined in image_kernels_avx2.cpp, the only file built with AVX2 enabled;
+// nullptr when the compiler cannot target AVX2.
+const ImageKernels *avx2ImageKernels();
+
+// A width x height grayscale image.
+struct GrayImage {
+    uint8_t *pixels;
+    int64_t width;
+    int64_t height;
+};
+
+// Mean of the (2 * radius + 1)^2 window around each pixel, truncated.
+// Radius 1 is the 3x3 box blur.
+void boxBlur(const ImageKernels &k, GrayImage src, GrayImage dst, int64_t radius);
+
+// Sobel edge magnitude |gx| + |gy|, clamped to 255.
+void sobel(const ImageKernels &k, GrayImage src, GrayImage dst);
+
+enum class ResizeMode { Nearest = 0, Bilinear = 1, Area = 2 };
+
+// Scale all of src into all of dst. Nearest takes pixel (x * sw / dw,
+// y * sh / dh); bilinear samples at pixel centres with 8-bit weights; area
+// averages each destination pixel's footprint (nearest when enlarging).
+void resize(const ImageKernels &k, GrayImage src, GrayImage dst, ResizeMode mode);
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_IMAGE_KERNELS_H
@@ -0,0 +1,86 @@
+// The AVX2 image row kernels. This is the only image file built with -mavx2
+// (see CMakeLists.txt); imageKernels() calls into it only after checking
+// the CPU.
+#include "image_kernels_impl.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#ifdef __AVX2__
+namespace {
+
+inline __m256i widen8(const uint8_t *p) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)); }
+
+void addRowAvx2(uint32_t *acc, const uint8_t *row, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i *a = (__m256i *)(acc + i);
+        _mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a), widen8(row + i)));
+        _mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1), widen8(row + i + 8)));
+    }
+    addRowScalar(acc + i, row + i, n - i);
+}
+
+void slideRowAvx2(uint32_t *acc, const uint8_t *add, const uint8_t *sub, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i *a = (__m256i *)(acc + i);
+        __m256i d0 = _mm256_sub_epi32(widen8(add + i), widen8(sub + i));
+        __m256i d1 = _mm256_sub_epi32(widen8(add + i + 8), widen8(sub + i + 8));
+        _mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a), d0));
+        _mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1), d1));
+    }
+    slideRowScalar(acc + i, add + i, sub + i, n - i);
+}
+
+inline __m256i load16(const uint8_t *p) { return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p)); }
+
+void sobelRowAvx2(uint8_t *dst, const uint8_t *a, const uint8_t *r, const uint8_t *b, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i tl = load16(a + i - 1), tc = load16(a + i), tr = load16(a + i + 1);
+        __m256i ml = load16(r + i - 1), mr = load16(r + i + 1);
+        __m256i bl = load16(b + i - 1), bc = load16(b + i), br = load16(b + i + 1);
+        __m256i gx = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(tr, br), _mm256_add_epi16(mr, mr)),
+                                      _mm256_add_epi16(_mm256_add_epi16(tl, bl), _mm256_add_epi16(ml, ml)));
+        __m256i gy = _mm256_sub_epi16(_mm256_add_epi16(_mm256_add_epi16(bl, br), _mm256_add_epi16(bc, bc)),
+                                      _mm256_add_epi16(_mm256_add_epi16(tl, tr), _mm256_add_epi16(tc, tc)));
+        __m256i mag = _mm256_add_epi16(_mm256_abs_epi16(gx), _mm256_abs_epi16(gy));
+        // The 256-bit pack interleaves halves; packing the two 128-bit
+        // halves keeps the pixels in order.
+        __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(mag), _mm256_extracti128_si256(mag, 1));
+        _mm_storeu_si128((__m128i *)(dst + i), packed);
+    }
+    sobelRowScalar(dst + i, a + i, r + i, b + i, n - i);
+}
+
+void lerpRowsAvx2(uint8_t *dst, const uint16_t *top, const uint16_t *bottom, size_t n, uint32_t fy) {
+    __m256i w0 = _mm256_set1_epi16(static_cast<short>(256 - fy)), w1 = _mm256_set1_epi16(static_cast<short>(fy));
+    __m256i half = _mm256_set1_epi16(128);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i t = _mm256_loadu_si256((const __m256i *)(top + i));
+        __m256i bt = _mm256_loadu_si256((const __m256i *)(bottom + i));
+        __m256i v = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(t, w0), _mm256_mullo_epi16(bt, w1)), half);
+        v = _mm256_srli_epi16(v, 8);
+        __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storeu_si128((__m128i *)(dst + i), packed);
+    }
+    lerpRowsScalar(dst + i, top + i, bottom + i, n - i, fy);
+}
+
+constexpr ImageKernels kAvx2Kernels{"avx2", &addRowAvx2, &slideRowAvx2, &sobelRowAvx2, &lerpRowsAvx2};
+
+} // namespace
+
+const ImageKernels *avx2ImageKernels() { return &kAvx2Kernels; }
+#else
+const ImageKernels *avx2ImageKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
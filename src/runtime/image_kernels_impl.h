@@ -0,0 +1,47 @@
+#ifndef TOCIN_IMAGE_KERNELS_IMPL_H
+#define TOCIN_IMAGE_KERNELS_IMPL_H
+
+// The scalar definitions of the row kernels. The portable table is made of
+// these, and the SIMD tables run them on the pixels left after their last
+// full vector. Like the other *_impl.h kernels this is only included by the
+// kernel files and everything has internal linkage, so code built for AVX2
+// never ends up shared with the baseline file.
+
+#include "image_kernels.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tocin {
+namespace runtime {
+namespace {
+
+inline void addRowScalar(uint32_t *acc, const uint8_t *row, size_t n) {
+    for (size_t i = 0; i < n; ++i) acc[i] += row[i];
+}
+
+inline void slideRowScalar(uint32_t *acc, const uint8_t *add, const uint8_t *sub, size_t n) {
+    for (size_t i = 0; i < n; ++i) acc[i] += static_cast<uint32_t>(add[i]) - sub[i];
+}
+
+inline int sobelAbs(int v) { return v < 0 ? -v : v; }
+
+inline void sobelRowScalar(uint8_t *dst, const uint8_t *a, const uint8_t *r, const uint8_t *b, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        int x = static_cast<int>(i);
+        int gx = (a[x + 1] + 2 * r[x + 1] + b[x + 1]) - (a[x - 1] + 2 * r[x - 1] + b[x - 1]);
+        int gy = (b[x - 1] + 2 * b[x] + b[x + 1]) - (a[x - 1] + 2 * a[x] + a[x + 1]);
+        int mag = sobelAbs(gx) + sobelAbs(gy);
+        dst[i] = static_cast<uint8_t>(mag > 255 ? 255 : mag);
+    }
+}
+
+inline void lerpRowsScalar(uint8_t *dst, const uint16_t *top, const uint16_t *bottom, size_t n, uint32_t fy) {
+    for (size_t i = 0; i < n; ++i) dst[i] = static_cast<uint8_t>((top[i] * (256 - fy) + bottom[i] * fy + 128) >> 8);
+}
+
+} // namespace
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_IMAGE_KERNELS_IMPL_H
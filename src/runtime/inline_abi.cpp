@@ -0,0 +1,62 @@
+// The runtime entry points generated code calls most often, kept in a file
+// of their own so they can be built twice: into tocin_runtime like the rest,
+// and to LLVM bitcode (tocin_runtime_inline.bc, see CMakeLists.txt) that the
+// compiler links into each module before optimizing it. There they inline
+// into loops, get hoisted and vectorized through, and are internalized with
+// the rest of a whole program; anything left uncalled is dropped, and any
+// call that is not inlined still resolves to the copy in the library.
+//
+// Everything here must depend only on the handle layouts in
+// runtime_layout.h: no runtime state, no allocation, no other __tocin_
+// calls except each other.
+#include "runtime_layout.h"
+
+#include <cstdint>
+
+extern "C"
+{
+    int64_t __tocin_vec_get(void *h, int64_t i)
+    {
+        if (!h) return 0;
+        auto *v = static_cast<TocinVec *>(h);
+        if (i < 0 || i >= v->len) return 0;
+        return tocin_vec_load(v, i);
+    }
+    void __tocin_vec_set(void *h, int64_t i, int64_t x)
+    {
+        if (!h) return;
+        auto *v = static_cast<TocinVec *>(h);
+        if (i < 0 || i >= v->len) return;
+        tocin_vec_store(v, i, x);
+    }
+    int64_t __tocin_vec_len(void *h)
+    {
+        return h ? static_cast<TocinVec *>(h)->len : 0;
+    }
+
+    int64_t __tocin_map_get(void *h, int64_t k)
+    {
+        TocinIntSlot *s = h ? tocin_map_find(static_cast<TocinMap *>(h), k) : nullptr;
+        return s ? s->value : 0;
+    }
+    int64_t __tocin_map_has(void *h, int64_t k)
+    {
+        return h && tocin_map_find(static_cast<TocinMap *>(h), k) ? 1 : 0;
+    }
+
+    int64_t __tocin_str_len(const char *s) { return (int64_t)tocin_str_length(s); }
+    int64_t __tocin_str_char_at(const char *s, int64_t i)
+    {
+        if (i < 0 || (size_t)i >= tocin_str_length(s)) return -1;
+        return (int64_t)(unsigned char)s[i];
+    }
+
+    // splitmix64's finalizer.
+    int64_t __tocin_hash_int(int64_t x)
+    {
+        uint64_t z = (uint64_t)x + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return (int64_t)(z ^ (z >> 31));
+    }
+}
@@ -0,0 +1,591 @@
+// JSON structural indexing (stage 1), the tape (stage 2) and its accessors.
+#include "json_parser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TOCIN_JSON_SSE2 1
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+// Tape words: the tag in the top byte, a payload below it.
+//   'r' root: the tape's length       'n' 't' 'f' null, true, false
+//   'l' int64 in the next word        'd' double bits in the next word
+//   '"' string, 'k' object key: the offset of its bytes (in the input, or
+//       in the decoded strings when the next word has kEscaped), and its
+//       length in the low 32 bits of the next word; for a key, bits 32-62
+//       of that word hold the index of the object it belongs to (0 past
+//       kOwnerMax), which is what lets a lookup hint be checked
+//   '[' '{' the index of the matching close in the low 32 bits, the
+//       element or field count (saturated at kCountMax) in bits 32-55
+//   ']' '}' the index of the matching open
+constexpr uint64_t kPayload = (uint64_t(1) << 56) - 1;
+constexpr uint64_t kEscaped = uint64_t(1) << 63;
+constexpr uint64_t kLength = 0xffffffffu;
+constexpr uint64_t kOwnerMax = (uint64_t(1) << 31) - 1;
+constexpr uint32_t kCountMax = 0xffffff;
+
+uint64_t word(char tag, uint64_t payload) { return ((uint64_t)(unsigned char)tag << 56) | payload; }
+
+// The masks of one 64-byte block, bit i for byte i.
+struct Block {
+    uint64_t quote, backslash, op, space, control;
+};
+
+Block classify(const char *p) {
+    Block b{};
+#ifdef TOCIN_JSON_SSE2
+    for (int k = 0; k < 4; ++k) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * k));
+        auto eq = [&](char c) { return _mm_cmpeq_epi8(x, _mm_set1_epi8(c)); };
+        auto bits = [](__m128i m) { return (uint64_t)(uint32_t)_mm_movemask_epi8(m); };
+        // '[' and '{', ']' and '}' differ only in bit 5.
+        __m128i folded = _mm_or_si128(x, _mm_set1_epi8(0x20));
+        __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+            _mm_or_si128(eq(':'), eq(',')));
+        __m128i space = _mm_or_si128(_mm_or_si128(eq(' '), eq('\t')), _mm_or_si128(eq('\n'), eq('\r')));
+        __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(0x1f)), _mm_set1_epi8(0x1f));
+        int shift = 16 * k;
+        b.quote |= bits(eq('"')) << shift;
+        b.backslash |= bits(eq('\\')) << shift;
+        b.op |= bits(op) << shift;
+        b.space |= bits(space) << shift;
+        b.control |= bits(control) << shift;
+    }
+#else
+    for (int i = 0; i < 64; ++i) {
+        unsigned char c = (unsigned char)p[i];
+        uint64_t bit = uint64_t(1) << i;
+        if (c == '"') b.quote |= bit;
+        if (c == '\\') b.backslash |= bit;
+        if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') b.op |= bit;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') b.space |= bit;
+        if (c < 0x20) b.control |= bit;
+    }
+#endif
+    return b;
+}
+
+// Bit i set when an odd number of the bits at or below i are.
+uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// The bytes escaped by a backslash: the one after each run of backslashes
+// of odd length (counting a run carried in from the previous block).
+uint64_t findEscaped(uint64_t backslash, uint64_t *carry) {
+    const uint64_t even = 0x5555555555555555ULL;
+    backslash &= ~*carry;
+    uint64_t followsEscape = (backslash << 1) | *carry;
+    uint64_t oddStarts = backslash & ~even & ~followsEscape;
+    uint64_t evenStarts = oddStarts + backslash;
+    *carry = evenStarts < oddStarts ? 1 : 0;
+    return (even ^ (evenStarts << 1)) & followsEscape;
+}
+
+int ctz(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) { x >>= 1; ++n; }
+    return n;
+#endif
+}
+
+// Whether c may follow a number or literal.
+bool endsScalar(char c) {
+    switch (c) {
+    case ' ': case '\t': case '\n': case '\r': case ',': case ':':
+    case '[': case ']': case '{': case '}':
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool hex4(const char *s, uint32_t *out) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f') v |= (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v |= (uint32_t)(c - 'A' + 10);
+        else return false;
+    }
+    *out = v;
+    return true;
+}
+
+size_t utf8(uint32_t cp, char *o) {
+    if (cp < 0x80) { o[0] = (char)cp; return 1; }
+    if (cp < 0x800) {
+        o[0] = (char)(0xc0 | (cp >> 6));
+        o[1] = (char)(0x80 | (cp & 0x3f));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        o[0] = (char)(0xe0 | (cp >> 12));
+        o[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        o[2] = (char)(0x80 | (cp & 0x3f));
+        return 3;
+    }
+    o[0] = (char)(0xf0 | (cp >> 18));
+    o[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+    o[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+    o[3] = (char)(0x80 | (cp & 0x3f));
+    return 4;
+}
+
+// Decode the escapes of s[0, n) into out, which is never longer; false on
+// an unknown escape or a lone surrogate.
+bool unescape(const char *s, size_t n, char *out, size_t *outLen) {
+    char *o = out;
+    size_t i = 0;
+    while (i < n) {
+        const char *bs = static_cast<const char *>(std::memchr(s + i, '\\', n - i));
+        size_t run = bs ? (size_t)(bs - (s + i)) : n - i;
+        std::memcpy(o, s + i, run);
+        o += run;
+        i += run;
+        if (i == n) break;
+        if (i + 1 >= n) return false;
+        char e = s[i + 1];
+        i += 2;
+        switch (e) {
+        case '"': *o++ = '"'; break;
+        case '\\': *o++ = '\\'; break;
+        case '/': *o++ = '/'; break;
+        case 'b': *o++ = '\b'; break;
+        case 'f': *o++ = '\f'; break;
+        case 'n': *o++ = '\n'; break;
+        case 'r': *o++ = '\r'; break;
+        case 't': *o++ = '\t'; break;
+        case 'u': {
+            uint32_t cp = 0;
+            if (i + 4 > n || !hex4(s + i, &cp)) return false;
+            i += 4;
+            if (cp >= 0xd800 && cp < 0xdc00) {
+                uint32_t lo = 0;
+                if (i + 6 > n || s[i] != '\\' || s[i + 1] != 'u' || !hex4(s + i + 2, &lo) ||
+                    lo < 0xdc00 || lo > 0xdfff)
+                    return false;
+                i += 6;
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+            } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+                return false;
+            }
+            o += utf8(cp, o);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    *outLen = (size_t)(o - out);
+    return true;
+}
+
+} // namespace
+
+bool jsonStructuralIndex(const char *p, size_t n, uint32_t *out, size_t *count, bool *backslashes) {
+    uint64_t escapeCarry = 0, inStringCarry = 0, scalarCarry = 0, badControl = 0, anyBackslash = 0;
+    size_t k = 0;
+    for (size_t base = 0; base < n; base += 64) {
+        Block b = classify(p + base);
+        if (n - base < 64) {
+            // Bytes past the end count as whitespace.
+            uint64_t valid = (uint64_t(1) << (n - base)) - 1;
+            b.quote &= valid;
+            b.backslash &= valid;
+            b.op &= valid;
+            b.control &= valid;
+            b.space |= ~valid;
+        }
+        anyBackslash |= b.backslash;
+        uint64_t quotes = b.quote & ~findEscaped(b.backslash, &escapeCarry);
+        // Set from each opening quote up to (not including) its closing one.
+        uint64_t inString = prefixXor(quotes) ^ inStringCarry;
+        inStringCarry = (uint64_t)((int64_t)inString >> 63);
+        badControl |= b.control & inString;
+        uint64_t scalar = ~(b.op | b.space | b.quote) & ~inString;
+        uint64_t starts = scalar & ~((scalar << 1) | scalarCarry);
+        scalarCarry = scalar >> 63;
+        uint64_t bits = (b.op & ~inString) | quotes | starts;
+        while (bits) {
+            out[k++] = (uint32_t)(base + (size_t)ctz(bits));
+            bits &= bits - 1;
+        }
+    }
+    *count = k;
+    *backslashes = anyBackslash != 0;
+    return inStringCarry == 0 && badControl == 0;
+}
+
+bool JsonDocument::parse(const char *p, size_t n) {
+    tape_.clear();
+    strings_.clear();
+    if (n >= (size_t(1) << 31)) return false;
+    if (input_.size() < n + 64) input_.resize(n + 64);
+    if (n) std::memcpy(input_.data(), p, n);
+    std::memset(input_.data() + n, ' ', 64);
+    if (structurals_.size() < n + 1) structurals_.resize(n + 1);
+    size_t count = 0;
+    if (!jsonStructuralIndex(input_.data(), n, structurals_.data(), &count, &backslashes_) ||
+        !parseTape(count)) {
+        tape_.clear();
+        return false;
+    }
+    return true;
+}
+
+void JsonDocument::closeContainer() {
+    Open o = open_.back();
+    open_.pop_back();
+    size_t close = tape_.size();
+    tape_.push_back(word(o.object ? '}' : ']', o.tape));
+    tape_[o.tape] |= (uint64_t)close | ((uint64_t)std::min(o.count, kCountMax) << 32);
+}
+
+bool JsonDocument::parseTape(size_t count) {
+    const char *in = input_.data();
+    const uint32_t *idx = structurals_.data();
+    open_.clear();
+    tape_.push_back(0); // the root word, once the length is known
+    enum { kValue, kKey, kAfterValue } state = kValue;
+    size_t i = 0;
+    for (;;) {
+        if (state == kAfterValue) {
+            if (open_.empty()) {
+                if (i != count) return false;
+                tape_[0] = word('r', tape_.size());
+                return true;
+            }
+            if (i >= count) return false;
+            char c = in[idx[i++]];
+            bool object = open_.back().object;
+            if (c == ',') state = object ? kKey : kValue;
+            else if (c == (object ? '}' : ']')) closeContainer();
+            else return false;
+            continue;
+        }
+        if (state == kKey) {
+            uint64_t owner = open_.back().tape <= kOwnerMax ? open_.back().tape : 0;
+            if (i + 1 >= count || in[idx[i]] != '"' || !parseString(idx[i], idx[i + 1], 'k', owner << 32))
+                return false;
+            i += 2;
+            if (i >= count || in[idx[i]] != ':') return false;
+            ++i;
+            ++open_.back().count;
+            state = kValue;
+            continue;
+        }
+        if (i >= count) return false;
+        size_t pos = idx[i];
+        char c = in[pos];
+        if (!open_.empty() && !open_.back().object) ++open_.back().count;
+        state = kAfterValue;
+        switch (c) {
+        case '{':
+        case '[': {
+            if (open_.size() >= kMaxDepth) return false;
+            open_.push_back(Open{(uint32_t)tape_.size(), 0, c == '{'});
+            tape_.push_back(word(c, 0));
+            ++i;
+            if (i < count && in[idx[i]] == (c == '{' ? '}' : ']')) {
+                ++i;
+                closeContainer();
+            } else {
+                state = c == '{' ? kKey : kValue;
+            }
+            break;
+        }
+        case '"':
+            if (i + 1 >= count || !parseString(pos, idx[i + 1], '"', 0)) return false;
+            i += 2;
+            break;
+        case 't':
+            if (std::memcmp(in + pos, "true", 4) != 0 || !endsScalar(in[pos + 4])) return false;
+            tape_.push_back(word('t', 0));
+            ++i;
+            break;
+        case 'f':
+            if (std::memcmp(in + pos, "false", 5) != 0 || !endsScalar(in[pos + 5])) return false;
+            tape_.push_back(word('f', 0));
+            ++i;
+            break;
+        case 'n':
+            if (std::memcmp(in + pos, "null", 4) != 0 || !endsScalar(in[pos + 4])) return false;
+            tape_.push_back(word('n', 0));
+            ++i;
+            break;
+        default:
+            if (!parseNumber(pos)) return false;
+            ++i;
+            break;
+        }
+    }
+}
+
+bool JsonDocument::parseString(size_t open, size_t close, uint64_t tag, uint64_t owner) {
+    const char *in = input_.data();
+    if (in[open] != '"' || in[close] != '"') return false;
+    size_t start = open + 1, len = close - start;
+    if (!backslashes_ || !std::memchr(in + start, '\\', len)) {
+        tape_.push_back((tag << 56) | start);
+        tape_.push_back(len | owner);
+        return true;
+    }
+    size_t off = strings_.size();
+    strings_.resize(off + len);
+    size_t got = 0;
+    if (!unescape(in + start, len, strings_.data() + off, &got)) return false;
+    strings_.resize(off + got);
+    tape_.push_back((tag << 56) | off);
+    tape_.push_back(got | owner | kEscaped);
+    return true;
+}
+
+bool JsonDocument::parseNumber(size_t pos) {
+    static const double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    auto digit = [](char c) { return c >= '0' && c <= '9'; };
+    const char *start = input_.data() + pos;
+    const char *s = start;
+    bool negative = *s == '-';
+    if (negative) ++s;
+    if (!digit(*s)) return false;
+    // The first 19 significant digits, which cannot wrap a uint64, and the
+    // power of ten they are scaled by.
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int64_t exp10 = 0;
+    bool truncated = false;
+    auto take = [&](char c, bool fraction) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(c - '0');
+            if (fraction) --exp10;
+        } else {
+            truncated = true;
+            if (!fraction) ++exp10;
+        }
+        ++digits;
+    };
+    if (*s == '0') ++s;
+    else
+        while (digit(*s)) take(*s++, false);
+    bool integral = true;
+    if (*s == '.') {
+        ++s;
+        if (!digit(*s)) return false;
+        while (digit(*s)) take(*s++, true);
+        integral = false;
+    }
+    if (*s == 'e' || *s == 'E') {
+        ++s;
+        bool minus = *s == '-';
+        if (*s == '+' || *s == '-') ++s;
+        if (!digit(*s)) return false;
+        int64_t e = 0;
+        while (digit(*s)) {
+            if (e < 100000) e = e * 10 + (*s - '0');
+            ++s;
+        }
+        exp10 += minus ? -e : e;
+        integral = false;
+    }
+    if (!endsScalar(*s)) return false;
+    if (integral && !truncated &&
+        mantissa <= (uint64_t)std::numeric_limits<int64_t>::max() + (negative ? 1 : 0)) {
+        tape_.push_back(word('l', 0));
+        tape_.push_back(negative ? 0 - mantissa : mantissa);
+        return true;
+    }
+    double d = 0;
+    if (!truncated && mantissa <= (uint64_t(1) << 53) && exp10 >= -22 && exp10 <= 22) {
+        // Both the mantissa and the power of ten are exact doubles, so one
+        // rounding gives the correctly rounded result.
+        d = (double)mantissa;
+        d = exp10 < 0 ? d / kPow10[-exp10] : d * kPow10[exp10];
+        if (negative) d = -d;
+    } else {
+        auto r = std::from_chars(start, s, d);
+        if (r.ec == std::errc::result_out_of_range) d = std::strtod(start, nullptr); // 0 or inf
+        else if (r.ec != std::errc() || r.ptr != s) return false;
+        if (std::isinf(d)) return false;
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &d, 8);
+    tape_.push_back(word('d', 0));
+    tape_.push_back(bits);
+    return true;
+}
+
+// ---- accessors ---------------------------------------------------------------
+
+size_t JsonDocument::skip(size_t v) const {
+    switch (tag(v)) {
+    case '[': case '{': return (size_t)(tape_[v] & 0xffffffffu) + 1;
+    case 'l': case 'd': case '"': case 'k': return v + 2;
+    default: return v + 1;
+    }
+}
+
+int JsonDocument::type(size_t v) const {
+    if (v == 0 || v >= tape_.size()) return -1;
+    switch (tag(v)) {
+    case 'n': return kJsonNull;
+    case 't': case 'f': return kJsonBool;
+    case 'l': case 'd': return kJsonNumber;
+    case '"': case 'k': return kJsonString;
+    case '[': return kJsonArray;
+    case '{': return kJsonObject;
+    default: return -1;
+    }
+}
+
+bool JsonDocument::asBool(size_t v) const { return type(v) == kJsonBool && tag(v) == 't'; }
+
+int64_t JsonDocument::asInt(size_t v) const {
+    if (type(v) != kJsonNumber) return 0;
+    if (tag(v) == 'l') return (int64_t)tape_[v + 1];
+    double d = asFloat(v);
+    if (std::isnan(d)) return 0;
+    if (d >= 9223372036854775807.0) return std::numeric_limits<int64_t>::max();
+    if (d <= -9223372036854775808.0) return std::numeric_limits<int64_t>::min();
+    return (int64_t)d;
+}
+
+double JsonDocument::asFloat(size_t v) const {
+    if (type(v) != kJsonNumber) return 0;
+    if (tag(v) == 'l') return (double)(int64_t)tape_[v + 1];
+    double d;
+    std::memcpy(&d, &tape_[v + 1], 8);
+    return d;
+}
+
+bool JsonDocument::string(size_t v, const char **data, size_t *len) const {
+    if (type(v) != kJsonString) return false;
+    uint64_t off = tape_[v] & kPayload, second = tape_[v + 1];
+    *data = (second & kEscaped ? strings_.data() : input_.data()) + off;
+    *len = (size_t)(second & kLength);
+    return true;
+}
+
+size_t JsonDocument::length(size_t v) const {
+    int t = type(v);
+    if (t != kJsonArray && t != kJsonObject) return 0;
+    size_t n = (size_t)((tape_[v] >> 32) & kCountMax);
+    if (n < kCountMax) return n;
+    n = 0;
+    for (size_t e = first(v); e; e = next(e)) ++n;
+    return n;
+}
+
+size_t JsonDocument::first(size_t v) const {
+    int t = type(v);
+    if (t != kJsonArray && t != kJsonObject) return 0;
+    uint64_t after = tag(v + 1);
+    return after == ']' || after == '}' ? 0 : v + 1;
+}
+
+size_t JsonDocument::next(size_t i) const {
+    if (type(i) < 0) return 0;
+    size_t j = tag(i) == 'k' ? skip(i + 2) : skip(i);
+    if (j >= tape_.size()) return 0;
+    uint64_t t = tag(j);
+    return t == ']' || t == '}' ? 0 : j;
+}
+
+size_t JsonDocument::value(size_t k) const {
+    return k && k < tape_.size() && tag(k) == 'k' ? k + 2 : 0;
+}
+
+size_t JsonDocument::at(size_t v, size_t i) const {
+    if (type(v) != kJsonArray) return 0;
+    size_t e = first(v);
+    for (; e && i; --i) e = next(e);
+    return e;
+}
+
+size_t JsonDocument::find(size_t v, const char *key, size_t n, uint32_t *hint) const {
+    if (type(v) != kJsonObject) return 0;
+    auto matches = [&](size_t k) {
+        const char *d;
+        size_t len;
+        string(k, &d, &len);
+        return len == n && std::memcmp(d, key, n) == 0;
+    };
+    if (hint && *hint) {
+        // Objects of one shape put a key at the same distance from their
+        // start; the owner field rules out a nested object's key.
+        size_t k = v + *hint;
+        if (k + 1 < tape_.size() && tag(k) == 'k' && ((tape_[k + 1] >> 32) & kOwnerMax) == v && matches(k))
+            return k + 2;
+    }
+    for (size_t k = first(v); k; k = next(k)) {
+        if (!matches(k)) continue;
+        if (hint) *hint = k - v <= 0xffffffffu ? (uint32_t)(k - v) : 0;
+        return k + 2;
+    }
+    return 0;
+}
+
+size_t JsonDocument::pointer(size_t v, const char *path, size_t n, uint32_t *hints, size_t nhints) const {
+    size_t pos = 0, step = 0;
+    std::string token;
+    for (; v && pos < n; ++step) {
+        if (path[pos] != '/') return 0;
+        size_t start = ++pos;
+        while (pos < n && path[pos] != '/') ++pos;
+        const char *seg = path + start;
+        size_t len = pos - start;
+        if (std::memchr(seg, '~', len)) {
+            token.clear();
+            for (size_t i = 0; i < len; ++i) {
+                if (seg[i] != '~') { token += seg[i]; continue; }
+                if (i + 1 >= len || (seg[i + 1] != '0' && seg[i + 1] != '1')) return 0;
+                token += seg[++i] == '0' ? '~' : '/';
+            }
+            seg = token.data();
+            len = token.size();
+        }
+        if (type(v) == kJsonObject) {
+            v = find(v, seg, len, step < nhints ? hints + step : nullptr);
+        } else if (type(v) == kJsonArray) {
+            // Decimal without leading zeros.
+            if (len == 0 || len > 18 || (len > 1 && seg[0] == '0')) return 0;
+            size_t i = 0;
+            for (size_t d = 0; d < len; ++d) {
+                if (seg[d] < '0' || seg[d] > '9') return 0;
+                i = i * 10 + (size_t)(seg[d] - '0');
+            }
+            v = at(v, i);
+        } else {
+            return 0;
+        }
+    }
+    return v;
+}
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,112 @@
+#ifndef TOCIN_JSON_PARSER_H
+#define TOCIN_JSON_PARSER_H
+
+/**
+ * The JSON parser behind jsonParseFast and the jsonFast* / jsonStream*
+ * builtins (concurrency_runtime.cpp), alongside the tree-building parser
+ * of stdlib/std/json.to.
+ *
+ * Parsing takes two passes. Stage 1 classifies the input 64 bytes at a
+ * time into bitmasks (quotes, backslashes, structural characters,
+ * whitespace) with SSE2, works out which bytes are inside strings with a
+ * prefix XOR over the unescaped quotes, and writes the offset of every
+ * structural character, quote and scalar start to an index. Stage 2 walks
+ * that index once and writes a tape: a flat array of 64-bit words, one or
+ * two per value, in document order. Numbers are converted once, to an
+ * int64 where they fit and a double otherwise; strings stay where they lie
+ * in the (copied) input, and only those with escapes are decoded, into a
+ * side buffer. Each array and object records where it ends, so accessors
+ * step over a whole subtree in O(1) and a lookup touches only the keys on
+ * its path. Nothing is allocated per value, and a document reused for the
+ * next parse keeps its buffers.
+ *
+ * A value is its tape index: the root is 1 after a successful parse, 0
+ * means "no value". Bytes of 0x80 and above are passed through unchecked.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+// The tags of std.json (JSON_NULL .. JSON_OBJECT), returned by type().
+enum JsonType { kJsonNull = 0, kJsonBool = 1, kJsonNumber = 2, kJsonString = 3, kJsonArray = 4, kJsonObject = 5 };
+
+// Stage 1 alone: the offsets of the structural bytes of p[0, n), which
+// must be followed by 64 readable bytes, written to out (room for n) and
+// counted in *count; *backslashes tells whether any string may hold an
+// escape. false on an unterminated string or a control character inside
+// one.
+bool jsonStructuralIndex(const char *p, size_t n, uint32_t *out, size_t *count, bool *backslashes);
+
+class JsonDocument {
+public:
+    static constexpr size_t kRoot = 1;
+    static constexpr size_t kMaxDepth = 1024;
+
+    // Parse p[0, n), replacing the previous document; false if it is not
+    // exactly one well-formed JSON value (surrounding whitespace aside),
+    // nests deeper than kMaxDepth or is 2 GiB or more.
+    bool parse(const char *p, size_t n);
+    bool ok() const { return tape_.size() > kRoot; }
+
+    // -1 for 0 or an index that is not a value.
+    int type(size_t v) const;
+    bool asBool(size_t v) const;
+    // Numbers either way (a double truncates, saturating); 0 for others.
+    int64_t asInt(size_t v) const;
+    double asFloat(size_t v) const;
+    // The bytes of a string value or an object key, decoded; false for
+    // anything else. Valid until the next parse.
+    bool string(size_t v, const char **data, size_t *len) const;
+
+    // Elements of an array, fields of an object, 0 otherwise.
+    size_t length(size_t v) const;
+    // The first element of an array, the first key of an object, or 0.
+    size_t first(size_t v) const;
+    // The element or key after i in its container, or 0 after the last
+    // (a key steps over its value).
+    size_t next(size_t i) const;
+    // The value of the key at k.
+    size_t value(size_t k) const;
+    // Element i of an array, or 0.
+    size_t at(size_t v, size_t i) const;
+    // The value of the first field named key[0, n) of an object, or 0.
+    // A hint, if given, is where the key was found last time, relative to
+    // its object (0 for unknown): it is checked first, at the cost of one
+    // key compare, and updated when the key turns up elsewhere. That makes
+    // a lookup repeated over documents of one shape O(1), which is what the
+    // per-key caches of the jsonFastGet builtins rely on.
+    size_t find(size_t v, const char *key, size_t n, uint32_t *hint = nullptr) const;
+    // An RFC 6901 pointer ("/a/0/b", with ~0 and ~1 escapes) from v; "" is
+    // v. hints[i], for i < nhints, is the find hint of the i-th step.
+    size_t pointer(size_t v, const char *path, size_t n, uint32_t *hints = nullptr, size_t nhints = 0) const;
+
+private:
+    struct Open {
+        uint32_t tape;  // the container's first word
+        uint32_t count; // elements or fields so far
+        bool object;
+    };
+
+    size_t skip(size_t v) const;
+    uint64_t tag(size_t v) const { return tape_[v] >> 56; }
+    bool parseTape(size_t count);
+    void closeContainer();
+    bool parseString(size_t open, size_t close, uint64_t tag, uint64_t owner);
+    bool parseNumber(size_t pos);
+
+    std::vector<char> input_;           // the text, padded with spaces
+    std::vector<uint32_t> structurals_;
+    std::vector<uint64_t> tape_;
+    std::vector<char> strings_;         // decoded strings that had escapes
+    std::vector<Open> open_;
+    bool backslashes_ = false;          // else no string needs decoding
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_JSON_PARSER_H
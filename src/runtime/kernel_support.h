@@ -0,0 +1,34 @@
+#ifndef TOCIN_KERNEL_SUPPORT_H
+#define TOCIN_KERNEL_SUPPORT_H
+
+// What the runtime kernels (sort, scan, image, linalg, quant, tensor, audio,
+// quantile sketch) share beyond their own *_impl.h: the runtime entry points
+// they call back into, and access to Tocin lists passed to their extern "C"
+// wrappers. Like runtime_layout.h, the helpers have internal linkage.
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+// Array bounds-check failure: report and abort (concurrency_runtime.cpp).
+void __tocin_oob(int64_t idx, int64_t len);
+// The parallel_for worker pool (parallel_runtime.cpp).
+void __tocin_parallel_chunks(int64_t count, void (*fn)(void *, int64_t, int64_t), void *ctx);
+int64_t __tocin_parallel_threads();
+}
+
+namespace {
+
+// Length of a Tocin list (a [len][elements] block); a missing list is empty.
+inline size_t lengthOf(const int64_t *arr) { return arr && arr[0] > 0 ? static_cast<size_t>(arr[0]) : 0; }
+
+// Panic like an out-of-range index unless arr holds [off, off + n).
+inline void requireRange(const int64_t *arr, int64_t off, int64_t n) {
+    int64_t len = static_cast<int64_t>(lengthOf(arr));
+    if (off < 0) __tocin_oob(off, len);
+    if (n > 0 && off + n > len) __tocin_oob(off + n - 1, len);
+}
+
+} // namespace
+
+#endif // TOCIN_KERNEL_SUPPORT_H
@@ -0,0 +1,666 @@
+// The KV engine: memtable, write-ahead log, sorted runs and their
+// compaction. See kv_store.h for the file formats and the crash story.
+#include "kv_store.h"
+
+#include "file_io.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+constexpr uint32_t kDeleted = 0xffffffffu;
+constexpr char kRunMagic[8] = {'T', 'K', 'V', 'R', 'U', 'N', '0', '1'};
+constexpr char kManifestHeader[] = "tocin-kv 1";
+// What a memtable entry costs beyond its bytes: the tree node and strings.
+constexpr size_t kSlotOverhead = 96;
+// Unsynced records are written once this many bytes are buffered.
+constexpr size_t kBufferBytes = size_t(1) << 20;
+
+#ifdef _WIN32
+int openForAppend(const std::string &path, bool truncate) {
+    return ::_open(path.c_str(), _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY | (truncate ? _O_TRUNC : 0),
+                   _S_IREAD | _S_IWRITE);
+}
+void closeFd(int fd) { ::_close(fd); }
+bool syncDir(const std::string &) { return true; } // renames are durable once they return
+bool writeAll(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        int n = ::_write(fd, data, (unsigned)std::min(len, size_t(1) << 30));
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+#else
+int openForAppend(const std::string &path, bool truncate) {
+    return ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0666);
+}
+void closeFd(int fd) { ::close(fd); }
+// A rename or a new file is durable only once its directory is synced.
+bool syncDir(const std::string &dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+bool writeAll(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+#endif
+
+template <typename T>
+void putRaw(std::string &out, T v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof v);
+}
+
+template <typename T>
+T getRaw(const char *p) {
+    T v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+void appendRecord(std::string &out, std::string_view key, std::string_view value, bool dead) {
+    size_t start = out.size();
+    putRaw<uint32_t>(out, 0); // crc, filled in below
+    putRaw<uint32_t>(out, (uint32_t)key.size());
+    putRaw<uint32_t>(out, dead ? kDeleted : (uint32_t)value.size());
+    out.append(key);
+    if (!dead) out.append(value);
+    const auto *body = reinterpret_cast<const Bytef *>(out.data() + start + 4);
+    uint32_t crc = (uint32_t)crc32(0, body, (uInt)(out.size() - start - 4));
+    std::memcpy(&out[start], &crc, 4);
+}
+
+// Write path in full and sync it, replacing whatever was there.
+bool writeDurably(const std::string &path, const std::string &data) {
+    int fd = openForAppend(path, true);
+    if (fd < 0) return false;
+    bool ok = fileIo().appendSync(fd, data.data(), data.size()) >= 0;
+    closeFd(fd);
+    return ok;
+}
+
+bool parseId(const std::string &name, const char *ext, uint64_t *id) {
+    size_t n = std::strlen(ext);
+    if (name.size() <= n || name.compare(name.size() - n, n, ext) != 0) return false;
+    uint64_t v = 0;
+    for (size_t i = 0; i + n < name.size(); ++i) {
+        if (name[i] < '0' || name[i] > '9') return false;
+        v = v * 10 + (uint64_t)(name[i] - '0');
+    }
+    *id = v;
+    return true;
+}
+
+} // namespace
+
+// One sorted run, mapped read-only. Removes its file when it is destroyed
+// after a merge has replaced it.
+class KvStore::Run {
+public:
+    static std::unique_ptr<Run> open(uint64_t id, std::string path) {
+        size_t len = 0;
+        const char *base = mapFile(path.c_str(), &len);
+        if (!base) return nullptr;
+        std::unique_ptr<Run> run(new Run(id, std::move(path), base));
+        const size_t footer = 24;
+        if (len < footer || std::memcmp(base + len - 8, kRunMagic, 8) != 0) return nullptr;
+        run->count_ = getRaw<uint64_t>(base + len - footer);
+        run->index_ = getRaw<uint64_t>(base + len - footer + 8);
+        if (run->index_ > len - footer || (len - footer - run->index_) / 8 != run->count_ ||
+            (len - footer - run->index_) % 8 != 0)
+            return nullptr;
+        return run;
+    }
+
+    ~Run() {
+        unmapFile(base_);
+        if (obsolete) std::remove(path_.c_str());
+    }
+
+    uint64_t id() const { return id_; }
+    size_t count() const { return count_; }
+
+    // Entry i; false (and the run treated as ending there) if it does not
+    // fit inside the entry area.
+    bool entry(size_t i, std::string_view *key, std::string_view *value, bool *dead) const {
+        uint64_t off = getRaw<uint64_t>(base_ + index_ + i * 8);
+        if (off > index_ || index_ - off < 8) return false;
+        uint32_t klen = getRaw<uint32_t>(base_ + off), vlen = getRaw<uint32_t>(base_ + off + 4);
+        *dead = vlen == kDeleted;
+        uint64_t need = (uint64_t)klen + (*dead ? 0 : vlen);
+        if (need > index_ - off - 8) return false;
+        *key = std::string_view(base_ + off + 8, klen);
+        *value = std::string_view(base_ + off + 8 + klen, *dead ? 0 : vlen);
+        return true;
+    }
+
+    Found find(std::string_view key, std::string_view *value) const {
+        size_t lo = 0, hi = count_;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            std::string_view k, v;
+            bool dead;
+            if (!entry(mid, &k, &v, &dead)) return Found::No;
+            int c = k.compare(key);
+            if (c == 0) {
+                *value = v;
+                return dead ? Found::Dead : Found::Live;
+            }
+            if (c < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        return Found::No;
+    }
+
+    bool obsolete = false;
+
+private:
+    Run(uint64_t id, std::string path, const char *base) : id_(id), path_(std::move(path)), base_(base) {}
+
+    uint64_t id_;
+    std::string path_;
+    const char *base_;
+    uint64_t count_ = 0, index_ = 0;
+};
+
+namespace {
+
+// Visit the union of a memtable and runs, newest source first, in key
+// order: f(key, value, dead) once per key, with the newest source's entry.
+template <typename Memtable, typename Run, typename F>
+bool forEachMerged(const Memtable *mem, const std::vector<const Run *> &runs, F f) {
+    struct Cursor {
+        std::string_view key, value;
+        bool dead = false, valid = false;
+    };
+    typename Memtable::const_iterator it;
+    if (mem) it = mem->begin();
+    std::vector<size_t> pos(runs.size(), 0);
+    std::vector<Cursor> cur(runs.size() + 1);
+    auto load = [&](size_t c) {
+        Cursor &k = cur[c];
+        if (c == 0) {
+            k.valid = mem && it != mem->end();
+            if (k.valid) {
+                k.key = it->first;
+                k.value = it->second.value;
+                k.dead = it->second.dead;
+            }
+            return true;
+        }
+        const Run *run = runs[c - 1];
+        if (pos[c - 1] >= run->count()) {
+            k.valid = false;
+            return true;
+        }
+        k.valid = run->entry(pos[c - 1], &k.key, &k.value, &k.dead);
+        return k.valid;
+    };
+    for (size_t c = 0; c < cur.size(); ++c)
+        if (!load(c)) return false;
+    for (;;) {
+        size_t best = cur.size();
+        for (size_t c = 0; c < cur.size(); ++c)
+            if (cur[c].valid && (best == cur.size() || cur[c].key < cur[best].key)) best = c;
+        if (best == cur.size()) return true;
+        const Cursor winner = cur[best];
+        if (!f(winner.key, winner.value, winner.dead)) return false;
+        // Step every source holding this key; the older copies are shadowed.
+        for (size_t c = cur.size(); c-- > 0;) {
+            if (!cur[c].valid || cur[c].key != winner.key) continue;
+            if (c == 0) ++it;
+            else ++pos[c - 1];
+            if (!load(c)) return false;
+        }
+    }
+}
+
+} // namespace
+
+KvStore::KvStore(std::string dir) : dir_(std::move(dir)) {}
+
+KvStore *KvStore::open(const std::string &path) {
+    std::unique_ptr<KvStore> store(new KvStore(path));
+    if (path.empty()) return store.release();
+    if (!store->recover()) return nullptr;
+    store->worker_ = std::thread([s = store.get()] { s->compactor(); });
+    return store.release();
+}
+
+KvStore::~KvStore() {
+    if (!durable()) return;
+    {
+        std::lock_guard<std::shared_mutex> lock(mutex_);
+        stop_ = true;
+    }
+    changed_.notify_all();
+    if (worker_.joinable()) worker_.join();
+    std::lock_guard<std::mutex> log(logMutex_);
+    uint64_t upto;
+    flushBuffer(&upto);
+    if (logFd_ >= 0) closeFd(logFd_);
+}
+
+std::string KvStore::file(uint64_t id, const char *ext) const {
+    char name[32];
+    std::snprintf(name, sizeof name, "/%06llu", (unsigned long long)id);
+    return dir_ + name + ext;
+}
+
+bool KvStore::recover() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+    if (!fs::is_directory(dir_, ec)) return false;
+
+    // The manifest: its log, and its runs newest first.
+    uint64_t firstLog = 0;
+    std::vector<uint64_t> runIds;
+    std::string manifest = dir_ + "/MANIFEST";
+    if (fs::exists(manifest, ec)) {
+        size_t len = 0;
+        char *text = fileIo().readFile(manifest.c_str(), [](size_t n) { return static_cast<char *>(std::malloc(n + 1)); }, &len);
+        if (!text) return false;
+        std::string body(text, len);
+        std::free(text);
+        char word[16];
+        int used = 0;
+        unsigned long long v;
+        if (body.compare(0, sizeof kManifestHeader - 1, kManifestHeader) != 0) return false;
+        const char *p = body.c_str() + sizeof kManifestHeader - 1;
+        if (std::sscanf(p, " log %llu runs%n", &v, &used) != 1 || used == 0) return false;
+        firstLog = v;
+        p += used;
+        while (std::sscanf(p, " %15[0-9]%n", word, &used) == 1) {
+            runIds.push_back(std::strtoull(word, nullptr, 10));
+            p += used;
+        }
+    }
+    for (uint64_t id : runIds) {
+        auto run = Run::open(id, file(id, ".run"));
+        if (!run) return false;
+        nextId_ = std::max(nextId_, id + 1);
+        runs_.push_back(std::move(run));
+    }
+
+    // Newer logs are replayed oldest first; anything the manifest does not
+    // account for is a leftover of an interrupted flush or merge.
+    std::vector<uint64_t> logs;
+    for (const auto &e : fs::directory_iterator(dir_, ec)) {
+        std::string name = e.path().filename().string();
+        uint64_t id;
+        bool stale = false;
+        if (parseId(name, ".wal", &id)) {
+            if (id >= firstLog) logs.push_back(id);
+            else stale = true;
+        } else if (parseId(name, ".run", &id)) {
+            stale = std::find(runIds.begin(), runIds.end(), id) == runIds.end();
+        } else if (parseId(name, ".tmp", &id)) {
+            stale = true;
+        } else {
+            continue;
+        }
+        nextId_ = std::max(nextId_, id + 1);
+        if (stale) fs::remove(e.path(), ec);
+    }
+    if (ec) return false;
+    std::sort(logs.begin(), logs.end());
+    for (uint64_t id : logs) {
+        std::string path = file(id, ".wal");
+        size_t len = 0;
+        char *data = fileIo().readFile(path.c_str(), [](size_t n) { return static_cast<char *>(std::malloc(n + 1)); }, &len);
+        if (!data) return false;
+        // Stop at the first record that was torn by a crash or damaged.
+        for (size_t at = 0; len - at >= 12;) {
+            uint32_t crc = getRaw<uint32_t>(data + at), klen = getRaw<uint32_t>(data + at + 4),
+                     vlen = getRaw<uint32_t>(data + at + 8);
+            bool dead = vlen == kDeleted;
+            uint64_t body = 8 + (uint64_t)klen + (dead ? 0 : vlen);
+            if (body > len - at - 4) break;
+            if ((uint32_t)crc32(0, reinterpret_cast<const Bytef *>(data + at + 4), (uInt)body) != crc) break;
+            Slot &slot = mem_[std::string(data + at + 12, klen)];
+            slot.dead = dead;
+            slot.value.assign(dead ? "" : data + at + 12 + klen, dead ? 0 : vlen);
+            at += 4 + body;
+        }
+        std::free(data);
+    }
+
+    // Fold the replayed writes into a run, so the logs can go and the
+    // store starts on a fresh one.
+    if (!mem_.empty()) {
+        uint64_t id = nextId_++;
+        std::vector<const Run *> none;
+        if (!writeRun(id, &mem_, none, runs_.empty())) return false;
+        auto run = Run::open(id, file(id, ".run"));
+        if (!run) return false;
+        runs_.insert(runs_.begin(), std::move(run));
+        mem_.clear();
+    }
+    logId_ = nextId_++;
+    logFd_ = openForAppend(file(logId_, ".wal"), true);
+    std::vector<uint64_t> ids;
+    for (const auto &r : runs_) ids.push_back(r->id());
+    if (logFd_ < 0 || !writeManifest(logId_, ids)) return false;
+    for (uint64_t id : logs) std::remove(file(id, ".wal").c_str());
+
+    std::vector<const Run *> all;
+    for (const auto &r : runs_) all.push_back(r.get());
+    const Memtable *none = nullptr;
+    return forEachMerged(none, all, [this](std::string_view, std::string_view, bool dead) {
+        live_ += !dead;
+        return true;
+    });
+}
+
+bool KvStore::writeManifest(uint64_t logId, const std::vector<uint64_t> &runIds) {
+    std::string text = std::string(kManifestHeader) + "\nlog " + std::to_string(logId) + "\nruns";
+    for (uint64_t id : runIds) text += " " + std::to_string(id);
+    text += "\n";
+    std::string tmp = dir_ + "/MANIFEST.tmp";
+    if (!writeDurably(tmp, text)) return false;
+    std::error_code ec;
+    std::filesystem::rename(tmp, dir_ + "/MANIFEST", ec);
+    return !ec && syncDir(dir_);
+}
+
+bool KvStore::writeRun(uint64_t id, const Memtable *mem, const std::vector<const Run *> &runs, bool dropDead) {
+    std::string tmp = file(id, ".tmp");
+    int fd = openForAppend(tmp, true);
+    if (fd < 0) return false;
+    std::string out, index;
+    uint64_t written = 0, count = 0;
+    bool ok = forEachMerged(mem, runs, [&](std::string_view key, std::string_view value, bool dead) {
+        if (dead && dropDead) return true;
+        putRaw<uint64_t>(index, written + out.size());
+        ++count;
+        putRaw<uint32_t>(out, (uint32_t)key.size());
+        putRaw<uint32_t>(out, dead ? kDeleted : (uint32_t)value.size());
+        out.append(key);
+        out.append(value);
+        if (out.size() < kBufferBytes) return true;
+        written += out.size();
+        bool wrote = writeAll(fd, out.data(), out.size());
+        out.clear();
+        return wrote;
+    });
+    uint64_t indexOffset = written + out.size();
+    out += index;
+    putRaw<uint64_t>(out, count);
+    putRaw<uint64_t>(out, indexOffset);
+    out.append(kRunMagic, 8);
+    ok = ok && fileIo().appendSync(fd, out.data(), out.size()) >= 0;
+    closeFd(fd);
+    std::error_code ec;
+    if (ok) std::filesystem::rename(tmp, file(id, ".run"), ec);
+    if (!ok || ec) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+KvStore::Found KvStore::find(std::string_view key, std::string_view *value) const {
+    const Memtable *tables[] = {&mem_, imm_.get()};
+    for (const Memtable *m : tables) {
+        if (!m) continue;
+        auto it = m->find(key);
+        if (it != m->end()) {
+            *value = it->second.value;
+            return it->second.dead ? Found::Dead : Found::Live;
+        }
+    }
+    for (const auto &run : runs_) {
+        Found f = run->find(key, value);
+        if (f != Found::No) return f;
+    }
+    return Found::No;
+}
+
+bool KvStore::has(std::string_view key) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::string_view v;
+    return find(key, &v) == Found::Live;
+}
+
+char *KvStore::get(std::string_view key, char *(*alloc)(size_t), size_t *len) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::string_view v;
+    if (find(key, &v) != Found::Live) return nullptr;
+    char *buf = alloc(v.size());
+    if (!buf) return nullptr;
+    std::memcpy(buf, v.data(), v.size());
+    *len = v.size();
+    return buf;
+}
+
+size_t KvStore::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return live_;
+}
+
+bool KvStore::put(std::string_view key, std::string_view value) {
+    bool existed;
+    return write(key, value, false, &existed);
+}
+
+bool KvStore::remove(std::string_view key) {
+    bool existed = false;
+    write(key, std::string_view(), true, &existed);
+    return existed;
+}
+
+bool KvStore::write(std::string_view key, std::string_view value, bool dead, bool *existed) {
+    *existed = false;
+    if (key.size() >= kDeleted || value.size() >= kDeleted) return false;
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::string_view old;
+    *existed = find(key, &old) == Found::Live;
+    if (dead && !*existed) return true; // nothing to delete, nothing to log
+    if (dead) --live_;
+    else live_ += !*existed;
+    if (!durable()) {
+        if (dead) {
+            auto it = mem_.find(key);
+            if (it != mem_.end()) mem_.erase(it);
+        } else {
+            auto it = mem_.find(key);
+            if (it == mem_.end()) mem_.emplace(std::string(key), Slot{std::string(value), false});
+            else it->second.value.assign(value.data(), value.size());
+        }
+        return true;
+    }
+    auto it = mem_.find(key);
+    if (it == mem_.end()) it = mem_.emplace(std::string(key), Slot()).first;
+    it->second.value.assign(value.data(), value.size());
+    it->second.dead = dead;
+    memBytes_ += key.size() + value.size() + kSlotOverhead;
+    appendRecord(buffer_, key, value, dead);
+    uint64_t seq = ++appended_;
+    bool mustCommit = sync_ || buffer_.size() >= kBufferBytes;
+    bool full = memBytes_ >= kMemtableBytes;
+    lock.unlock();
+    bool ok = !mustCommit || commit(seq);
+    if (full) ok = rotate(false) && ok;
+    return ok;
+}
+
+bool KvStore::flushBuffer(uint64_t *upto) {
+    std::string batch;
+    {
+        std::lock_guard<std::shared_mutex> lock(mutex_);
+        batch.swap(buffer_);
+        *upto = appended_;
+    }
+    if (!batch.empty() && fileIo().appendSync(logFd_, batch.data(), batch.size()) < 0) return false;
+    durable_ = *upto;
+    return true;
+}
+
+// Group commit: whoever holds the log lock writes everything buffered, so
+// a writer that was waiting behind it usually finds its record already
+// durable.
+bool KvStore::commit(uint64_t seq) {
+    std::lock_guard<std::mutex> log(logMutex_);
+    if (durable_ >= seq) return true;
+    uint64_t upto;
+    return flushBuffer(&upto);
+}
+
+bool KvStore::sync() {
+    if (!durable()) return true;
+    std::lock_guard<std::mutex> log(logMutex_);
+    uint64_t upto;
+    return flushBuffer(&upto);
+}
+
+void KvStore::setSync(bool on) {
+    {
+        std::lock_guard<std::shared_mutex> lock(mutex_);
+        sync_ = on;
+    }
+    if (on) sync();
+}
+
+// Freeze the memtable behind a fresh log for the compactor. Unless all is
+// set, only when it is still over its budget (another writer may have
+// rotated first) and the previous one has been written out.
+bool KvStore::rotate(bool all) {
+    std::lock_guard<std::mutex> log(logMutex_);
+    uint64_t upto;
+    if (!flushBuffer(&upto)) return false;
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return !imm_ || failed_; });
+    if (failed_) return false;
+    if (!all && memBytes_ < kMemtableBytes) return true;
+    if (!mem_.empty()) {
+        // Records buffered since the flush above are in mem_ too; they go
+        // to the old log before it is closed.
+        if (!buffer_.empty() && fileIo().appendSync(logFd_, buffer_.data(), buffer_.size()) < 0) return false;
+        buffer_.clear();
+        durable_ = appended_;
+        uint64_t id = nextId_++;
+        int fd = openForAppend(file(id, ".wal"), true);
+        if (fd < 0 || !syncDir(dir_)) {
+            if (fd >= 0) closeFd(fd);
+            return false;
+        }
+        closeFd(logFd_);
+        logFd_ = fd;
+        immLog_ = logId_;
+        logId_ = id;
+        imm_.reset(new Memtable(std::move(mem_)));
+        mem_.clear();
+        memBytes_ = 0;
+    }
+    compactAll_ = compactAll_ || all;
+    lock.unlock();
+    changed_.notify_all();
+    return true;
+}
+
+bool KvStore::compact() {
+    if (!durable()) return true;
+    if (!rotate(true)) return false;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return (!imm_ && !compactAll_ && !cleaning_) || failed_; });
+    return !failed_;
+}
+
+// The background thread: write each frozen memtable out as a run, and
+// merge the runs once there are too many (or compact() asks).
+void KvStore::compactor() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (;;) {
+        changed_.wait(lock, [this] { return stop_ || ((imm_ || compactAll_) && !failed_); });
+        if (failed_ || (!imm_ && !compactAll_)) return;
+        const Memtable *imm = imm_.get();
+        bool all = compactAll_ || runs_.size() + 1 > kMaxRuns;
+        uint64_t id = nextId_++, logId = logId_, immLog = immLog_;
+        lock.unlock();
+
+        // Only this thread changes runs_, so it reads them unlocked.
+        std::vector<const Run *> inputs;
+        std::vector<uint64_t> ids;
+        if (all)
+            for (const auto &r : runs_) inputs.push_back(r.get());
+        std::unique_ptr<Run> run;
+        bool ok = true;
+        if (imm || !inputs.empty()) {
+            ok = writeRun(id, imm, inputs, all || runs_.empty());
+            if (ok) run = Run::open(id, file(id, ".run"));
+            ok = ok && run;
+            if (ok) ids.push_back(id);
+        }
+        if (!all)
+            for (const auto &r : runs_) ids.push_back(r->id());
+        ok = ok && writeManifest(logId, ids);
+
+        lock.lock();
+        if (!ok) {
+            // Keep serving what is in memory and on disk; the logs stay, so
+            // a restart loses nothing, but no more work is scheduled.
+            failed_ = true;
+            lock.unlock();
+            changed_.notify_all();
+            return;
+        }
+        std::vector<std::unique_ptr<Run>> old = std::move(runs_);
+        runs_.clear();
+        if (run) runs_.push_back(std::move(run));
+        if (all) {
+            for (auto &r : old) r->obsolete = true;
+        } else {
+            for (auto &r : old) runs_.push_back(std::move(r));
+            old.clear();
+        }
+        bool folded = imm != nullptr;
+        imm_.reset();
+        compactAll_ = false;
+        cleaning_ = true;
+        lock.unlock();
+        changed_.notify_all();
+        // No reader can still be inside them: they were swapped out under
+        // the exclusive lock.
+        if (folded) std::remove(file(immLog, ".wal").c_str());
+        old.clear(); // unmaps merged runs and removes their files
+        lock.lock();
+        cleaning_ = false;
+        changed_.notify_all();
+    }
+}
+
+} // namespace runtime
+} // namespace tocin
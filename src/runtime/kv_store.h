@@ -0,0 +1,146 @@
+#ifndef TOCIN_KV_STORE_H
+#define TOCIN_KV_STORE_H
+
+/**
+ * The string key/value engine behind kvNew/kvOpen/kvPut/kvGet in
+ * stdlib/database/database.to (__tocin_kv_* in concurrency_runtime.cpp).
+ *
+ * Opened without a path, a store is a sorted in-memory table. Opened on a
+ * directory it is a small log-structured merge tree:
+ *
+ *   - Writes go to the memtable and to a write-ahead log (NNNNNN.wal), each
+ *     record [u32 crc][u32 key len][u32 value len][key][value], a value
+ *     length of ~0 marking a delete. A put returns once its record is
+ *     durable. Commits are grouped: one writer at a time writes and syncs
+ *     every record buffered so far (FileIo::appendSync), so concurrent
+ *     writers share one fdatasync instead of queueing for their own.
+ *   - When the memtable passes kMemtableBytes it is frozen and a fresh log
+ *     started; a background thread writes the frozen table out as a sorted
+ *     run (NNNNNN.run) and, once there are more than kMaxRuns, merges every
+ *     run into one, dropping deletes and overwritten values.
+ *   - Runs are written to a temporary name, synced and renamed; MANIFEST,
+ *     replaced the same way, names the live runs (newest first) and the
+ *     oldest log not yet folded into them, so a crash at any point leaves
+ *     either the old state or the new one. Files it does not name are
+ *     removed when the store is next opened.
+ *   - Runs are read through read-only mappings (mapFile): a lookup is a
+ *     binary search over the run's offset index, straight out of the page
+ *     cache, without copying the run or parsing it at open.
+ *
+ * Recovery maps the manifest's runs and replays newer logs in order, up to
+ * the first torn or corrupt record, then writes the replayed entries out as
+ * a run before accepting writes.
+ *
+ * Run file: [u32 key len][u32 value len][key][value]... per entry in key
+ * order, then a u64 offset per entry, then [u64 count][u64 index offset]
+ * [8-byte magic]. Lengths and offsets are the host's byte order.
+ *
+ * Every method may be called from any thread; readers share a lock that
+ * writers hold only to update the memtable.
+ */
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+class KvStore {
+public:
+    static constexpr size_t kMemtableBytes = size_t(4) << 20;
+    static constexpr size_t kMaxRuns = 4;
+
+    // A store over the directory at path (created if missing), or an
+    // in-memory one when path is empty; nullptr if the directory cannot be
+    // created, opened or recovered.
+    static KvStore *open(const std::string &path);
+
+    KvStore(const KvStore &) = delete;
+    KvStore &operator=(const KvStore &) = delete;
+    // Commits what is buffered and waits for compaction to finish.
+    ~KvStore();
+
+    // false if the log could not be written; the memtable has the value
+    // either way.
+    bool put(std::string_view key, std::string_view value);
+    // true if the key was present.
+    bool remove(std::string_view key);
+    bool has(std::string_view key) const;
+    // The value for key in a buffer from alloc(size), or nullptr if absent.
+    char *get(std::string_view key, char *(*alloc)(size_t size), size_t *len) const;
+    // Live keys.
+    size_t size() const;
+
+    // With sync off, put and remove return once the record is buffered (it
+    // is written when the buffer fills, on sync() and on close); on, the
+    // default, they wait until it is durable.
+    void setSync(bool on);
+    // Make every write so far durable; false on an I/O error.
+    bool sync();
+    // Freeze the memtable and merge everything into one run; returns once
+    // that is on disk.
+    bool compact();
+
+    bool durable() const { return !dir_.empty(); }
+
+private:
+    // A deleted key keeps a tombstone until it reaches the oldest run.
+    struct Slot {
+        std::string value;
+        bool dead = false;
+    };
+    using Memtable = std::map<std::string, Slot, std::less<>>;
+    class Run;
+    enum class Found { No, Live, Dead };
+
+    explicit KvStore(std::string dir);
+    bool recover();
+    Found find(std::string_view key, std::string_view *value) const;
+    bool write(std::string_view key, std::string_view value, bool dead, bool *existed);
+    bool commit(uint64_t seq);
+    bool rotate(bool all);
+    bool flushBuffer(uint64_t *upto);
+    void compactor();
+    bool writeRun(uint64_t id, const Memtable *mem, const std::vector<const Run *> &runs, bool dropDead);
+    bool writeManifest(uint64_t logId, const std::vector<uint64_t> &runIds);
+    std::string file(uint64_t id, const char *ext) const;
+
+    const std::string dir_;
+    mutable std::shared_mutex mutex_;      // mem_, imm_, runs_, buffer_, live_
+    std::condition_variable_any changed_;  // imm_ taken or cleared, stop_
+    Memtable mem_;
+    size_t memBytes_ = 0;
+    std::unique_ptr<Memtable> imm_;        // frozen, being written out
+    uint64_t immLog_ = 0;
+    std::vector<std::unique_ptr<Run>> runs_;  // newest first
+    size_t live_ = 0;
+    bool stop_ = false;
+    bool compactAll_ = false;
+    bool cleaning_ = false;                // removing what a job replaced
+    bool failed_ = false;                  // the compactor hit an I/O error
+
+    // Taken before mutex_ by whoever writes the log.
+    std::mutex logMutex_;
+    int logFd_ = -1;
+    uint64_t logId_ = 0;
+    uint64_t nextId_ = 1;
+    std::string buffer_;                   // records not yet written
+    uint64_t appended_ = 0, durable_ = 0;  // record sequence numbers
+    bool sync_ = true;
+
+    std::thread worker_;
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_KV_STORE_H
@@ -1,7 +1,9 @@
 #include "lightweight_scheduler.h"
 #include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <string>
 #include <vector>
 #include <stdexcept>
@@ -9,10 +11,11 @@
 #ifdef _WIN32
 #include <windows.h>
 #else
+#ifndef TOCIN_FIBER_ASM
 #include <ucontext.h>
+#endif
 #include <pthread.h>
 #include <sched.h>
-#include <sys/stat.h>
 #endif
 
 namespace tocin {
@@ -20,90 +23,220 @@ namespace runtime {
 
 // Forward declarations for fiber wrappers
 #ifndef _WIN32
-void fiberWrapper(Fiber* fiber);
+void fiberEntry(void *param);
+#ifndef TOCIN_FIBER_ASM
+static void fiberWrapper(unsigned int lo, unsigned int hi);
+#endif
 #else
-VOID CALLBACK fiberWrapperWindows(PVOID param);
+void __stdcall fiberWrapperWindows(void *param);
 #endif
 
+// ============================================================================
+// Thread-local scheduler state
+//
+// A fiber can park on one worker and be resumed on another, so code running
+// inside a fiber must never hold a pointer to a thread_local across a switch.
+// These accessors are out of line so every read re-derives the address for
+// the thread that is executing *now* (an inlined TLS access is allowed to be
+// cached across the context switch call).
+// ============================================================================
+
+namespace {
+    struct WorkerTls {
+        LightweightScheduler* sched = nullptr;
+        Worker* worker = nullptr;
+    };
+    thread_local Fiber* t_currentFiber = nullptr;
+    thread_local WorkerTls t_worker;
+
+    __attribute__((noinline)) Fiber* tlsCurrentFiber() { return t_currentFiber; }
+    __attribute__((noinline)) void tlsSetCurrentFiber(Fiber* f) { t_currentFiber = f; }
+    __attribute__((noinline)) WorkerTls tlsWorker() { return t_worker; }
+    __attribute__((noinline)) void tlsSetWorker(LightweightScheduler* s, Worker* w) {
+        t_worker.sched = s;
+        t_worker.worker = w;
+    }
+
+#ifndef TOCIN_FIBER_ASM
+    // Slack below the recorded stack pointer that is still scanned, covering
+    // the red zone and the frame of the switch routine itself.
+    constexpr size_t kStackScanSlack = 256;
+#endif
+
+    // How often busy workers check the netpoller for ready sockets.
+    constexpr std::chrono::microseconds kNetPollInterval{100};
+
+    int64_t steadyNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
 // ============================================================================
 // Fiber Implementation
 // ============================================================================
 
-uint64_t Fiber::nextId_ = 1;
+std::atomic<uint64_t> Fiber::nextId_{1};
 
 Fiber::Fiber(FiberFunc func, size_t stackSize, Priority priority)
-    : id_(nextId_++)
+    : id_(nextId_.fetch_add(1, std::memory_order_relaxed))
     , func_(std::move(func))
     , state_(State::Ready)
     , priority_(priority)
-    , stack_(nullptr)
     , stackSize_(stackSize)
     , context_(nullptr) {
-    
-    // Allocate stack
-    stack_ = malloc(stackSize_);
-    if (!stack_) {
-        throw std::bad_alloc();
-    }
-    
+
 #ifndef _WIN32
-    // Initialize context (POSIX)
-    context_ = malloc(sizeof(ucontext_t));
-    ucontext_t* ctx = static_cast<ucontext_t*>(context_);
-    
-    // Get current context
-    if (getcontext(ctx) == -1) {
-        free(stack_);
-        free(context_);
-        throw std::runtime_error("Failed to get context");
-    }
-    
-    // Set up stack
-    ctx->uc_stack.ss_sp = stack_;
-    ctx->uc_stack.ss_size = stackSize_;
-    ctx->uc_stack.ss_flags = 0;
-    ctx->uc_link = nullptr;  // When fiber completes, return to main
-    
-    // Create context with our fiber function
-    // We need a wrapper function that takes no arguments
-    makecontext(ctx, reinterpret_cast<void(*)()>(fiberWrapper), 1, this);
+    // The stack and initial context are set up by prepareStack() on the
+    // first resume.
 #else
-    // Windows fiber implementation
+    // Windows fiber implementation (the OS allocates the stack)
     context_ = CreateFiber(stackSize_, fiberWrapperWindows, this);
     if (!context_) {
-        free(stack_);
         throw std::runtime_error("Failed to create Windows fiber");
     }
 #endif
 }
 
 Fiber::~Fiber() {
-    if (stack_) {
-        free(stack_);
-    }
+#ifndef _WIN32
+    // Never resumed, or destroyed mid-run: a Completed fiber has already
+    // given its stack back.
+    releaseStack();
+#ifndef TOCIN_FIBER_ASM
+    free(context_);
+#endif
+#else
     if (context_) {
-        free(context_);
+        DeleteFiber(context_);
+    }
+#endif
+}
+
+Fiber* Fiber::current() {
+    return tlsCurrentFiber();
+}
+
+FiberStack Fiber::currentStack() {
+    Fiber* f = tlsCurrentFiber();
+    return f ? f->stack_ : FiberStack{};
+}
+
+#ifndef _WIN32
+void Fiber::prepareStack() {
+    stack_ = FiberStackPool::acquire(stackSize_);
+#ifdef TOCIN_FIBER_ASM
+    context_ = fiberContextMake(stack_.top(), fiberEntry, this);
+#else
+    if (!context_) {
+        context_ = malloc(sizeof(ucontext_t));
+        if (!context_) {
+            releaseStack();
+            throw std::bad_alloc();
+        }
+    }
+    ucontext_t* ctx = static_cast<ucontext_t*>(context_);
+    if (getcontext(ctx) == -1) {
+        releaseStack();
+        throw std::runtime_error("Failed to get context");
     }
+    ctx->uc_stack.ss_sp = stack_.base;
+    ctx->uc_stack.ss_size = stack_.size;
+    ctx->uc_stack.ss_flags = 0;
+    ctx->uc_link = nullptr;  // The wrapper switches back explicitly
+
+    // makecontext only passes int arguments, so hand over `this` in halves.
+    uintptr_t self = reinterpret_cast<uintptr_t>(this);
+    makecontext(ctx, reinterpret_cast<void(*)()>(fiberWrapper), 2,
+                static_cast<unsigned int>(self & 0xffffffffu),
+                static_cast<unsigned int>(static_cast<uint64_t>(self) >> 32));
+#endif
 }
 
+void Fiber::releaseStack() {
+    if (!stack_.base) return;
+    FiberStackPool::release(stack_);
+    stack_ = FiberStack{};
+}
+#endif
+
 void Fiber::resume() {
     if (state_ == State::Completed) {
         return;
     }
-    
+
+    const SchedulerHooks* hooks = owner_ ? &owner_->hooks() : nullptr;
+    Fiber* prev = tlsCurrentFiber();
+#ifndef _WIN32
+    if (!stack_.base) prepareStack();
+#endif
     state_ = State::Running;
-    
-    // Execute fiber function
-    if (func_) {
-        func_();
-        complete();
+
+#if defined(TOCIN_FIBER_ASM)
+    // tocin_fiber_switch stores our stack pointer in returnContext_.
+#elif !defined(_WIN32)
+    ucontext_t here;
+    returnContext_ = &here;
+#else
+    returnContext_ = IsThreadAFiber() ? GetCurrentFiber() : ConvertThreadToFiber(nullptr);
+#endif
+
+    if (hooks && hooks->lockSwitch) hooks->lockSwitch();
+    started_ = true;
+    onStack_ = true;
+    if (hooks && hooks->setStackBottom) hooks->setStackBottom(stackTop());
+    tlsSetCurrentFiber(this);
+
+#if defined(TOCIN_FIBER_ASM)
+    tocin_fiber_switch(&returnContext_, context_);
+#elif !defined(_WIN32)
+    swapcontext(&here, static_cast<ucontext_t*>(context_));
+#else
+    SwitchToFiber(context_);
+#endif
+
+    // Back on the resumer's stack; the fiber took the switch lock on its way out.
+    tlsSetCurrentFiber(prev);
+    if (hooks && hooks->unlockSwitch) hooks->unlockSwitch();
+#ifndef _WIN32
+    // Nothing runs on a finished fiber's stack any more: recycle it now
+    // rather than whenever the last reference to the fiber goes.
+    if (state_ == State::Completed) releaseStack();
+#endif
+}
+
+void Fiber::switchOut(State next) {
+    const SchedulerHooks* hooks = owner_ ? &owner_->hooks() : nullptr;
+
+    if (hooks && hooks->lockSwitch) hooks->lockSwitch();
+    volatile char marker = 0;
+    savedSp_ = const_cast<char*>(&marker);
+    onStack_ = false;
+    state_ = next;
+    if (hooks && hooks->setStackBottom) hooks->setStackBottom(nullptr);
+
+#if defined(TOCIN_FIBER_ASM)
+    // For Completed this is one-way: the saved context is never resumed.
+    tocin_fiber_switch(&context_, returnContext_);
+#elif !defined(_WIN32)
+    if (next == State::Completed) {
+        // One-way: nothing will ever switch back onto this stack.
+        setcontext(static_cast<ucontext_t*>(returnContext_));
     }
+    swapcontext(static_cast<ucontext_t*>(context_), static_cast<ucontext_t*>(returnContext_));
+#else
+    SwitchToFiber(returnContext_);
+#endif
+
+    // Resumed, possibly by a different thread than the one we left.
+    if (hooks && hooks->unlockSwitch) hooks->unlockSwitch();
 }
 
 void Fiber::yield() {
-    if (state_ == State::Running) {
-        state_ = State::Suspended;
+    if (tlsCurrentFiber() != this || state_ != State::Running) {
+        return;
     }
+    switchOut(State::Ready);
 }
 
 void Fiber::complete() {
@@ -111,20 +244,44 @@ void Fiber::complete() {
 }
 
 // Static wrapper functions for fiber execution
-#ifndef _WIN32
-void fiberWrapper(Fiber* fiber) {
-    if (fiber && fiber->func_) {
-        fiber->func_();
-        fiber->complete();
+namespace {
+    void runFiberBody(Fiber::FiberFunc& func) {
+        if (!func) return;
+        // Unwinding through the fiber's entry frame is undefined, so an
+        // exception escaping a goroutine is fatal - as on a std::thread.
+        try {
+            func();
+        } catch (...) {
+            std::terminate();
+        }
+        func = nullptr; // release captures while still on the fiber stack
     }
 }
+
+#ifndef _WIN32
+#ifndef TOCIN_FIBER_ASM
+static void fiberWrapper(unsigned int lo, unsigned int hi) {
+    fiberEntry(reinterpret_cast<void*>(
+        static_cast<uintptr_t>((static_cast<uint64_t>(hi) << 32) | lo)));
+}
+#endif
+
+void fiberEntry(void *param) {
+    Fiber* fiber = static_cast<Fiber*>(param);
+    // First entry: finish the switch resume() started.
+    if (fiber->owner_ && fiber->owner_->hooks().unlockSwitch)
+        fiber->owner_->hooks().unlockSwitch();
+    runFiberBody(fiber->func_);
+    fiber->switchOut(Fiber::State::Completed);
+}
 #else
-VOID CALLBACK fiberWrapperWindows(PVOID param) {
+void __stdcall fiberWrapperWindows(void *param) {
     Fiber* fiber = static_cast<Fiber*>(param);
-    if (fiber && fiber->func_) {
-        fiber->func_();
-        fiber->complete();
-    }
+    if (fiber->owner_ && fiber->owner_->hooks().unlockSwitch)
+        fiber->owner_->hooks().unlockSwitch();
+    runFiberBody(fiber->func_);
+    // A Windows fiber must never return; park it Completed until DeleteFiber.
+    fiber->switchOut(Fiber::State::Completed);
 }
 #endif
 
@@ -132,30 +289,74 @@ VOID CALLBACK fiberWrapperWindows(PVOID param) {
 // Worker Implementation
 // ============================================================================
 
-Worker::Worker(size_t id, int numaNode, int cpuAffinity)
+Worker::Worker(size_t id, int numaNode, int cpuAffinity, LightweightScheduler* owner)
     : id_(id)
     , numaNode_(numaNode)
     , cpuAffinity_(cpuAffinity)
+    , owner_(owner)
     , running_(false)
     , stopping_(false) {
-    stats_.fibersExecuted = 0;
-    stats_.fibersStolen = 0;
-    stats_.idleTimeMs = 0;
-    stats_.busyTimeMs = 0;
+}
+
+namespace {
+    // A counter only its owner thread writes: no locked read-modify-write.
+    inline void bumpOwn(std::atomic<uint64_t>& c, uint64_t n = 1) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    inline uint64_t nowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+Worker::WorkerStats Worker::getStats() const {
+    WorkerStats stats;
+    stats.fibersExecuted = own_.fibersExecuted.load(std::memory_order_relaxed);
+    stats.fibersStolen = shared_.fibersStolen.load(std::memory_order_relaxed);
+    stats.parks = own_.parks.load(std::memory_order_relaxed);
+    stats.unparks = shared_.unparks.load(std::memory_order_relaxed);
+    stats.queueDepth = getQueueSize();
+    stats.idleTimeNs = own_.idleNs.load(std::memory_order_relaxed);
+    stats.busyTimeNs = own_.busyNs.load(std::memory_order_relaxed);
+    stats.idleTimeMs = stats.idleTimeNs / 1000000;
+    stats.busyTimeMs = stats.busyTimeNs / 1000000;
+    return stats;
+}
+
+// The run queues store raw pointers; ownership rides in Fiber::queuedRef_
+// while a fiber is queued.
+Fiber* Worker::pinQueued(std::shared_ptr<Fiber> fiber) {
+    Fiber* raw = fiber.get();
+    raw->queuedRef_ = std::move(fiber);
+    return raw;
+}
+
+std::shared_ptr<Fiber> Worker::unpinQueued(Fiber* raw) {
+    return raw ? std::move(raw->queuedRef_) : nullptr;
 }
 
 Worker::~Worker() {
     stop();
     join();
+    // Fibers still queued at teardown are dropped (never run).
+    while (Fiber* raw = queue_.pop()) {
+        unpinQueued(raw);
+    }
 }
 
 void Worker::start() {
     if (running_.load()) {
         return;
     }
-    
+
+    // A retired spare is restarted in place; reap its previous thread first.
+    join();
     running_.store(true);
     stopping_.store(false);
+    if (owner_) {
+        owner_->runningWorkers_.fetch_add(1);
+    }
     thread_ = std::make_unique<std::thread>(&Worker::run, this);
 }
 
@@ -165,24 +366,57 @@ void Worker::stop() {
 
 void Worker::join() {
     if (thread_ && thread_->joinable()) {
-        thread_->join();
+        // exit() from inside a fiber tears the scheduler down on a worker.
+        if (thread_->get_id() == std::this_thread::get_id()) {
+            thread_->detach();
+        } else {
+            thread_->join();
+        }
     }
 }
 
 void Worker::addFiber(std::shared_ptr<Fiber> fiber) {
-    queue_.push(fiber);
+    if (tlsWorker().worker != this) {
+        pushInbox(std::move(fiber));
+        return;
+    }
+    int priority = static_cast<int>(fiber->getPriority());
+    queue_.pushPriority(pinQueued(std::move(fiber)), priority);
+}
+
+void Worker::pushInbox(std::shared_ptr<Fiber> fiber) {
+    std::lock_guard<std::mutex> lock(inboxMutex_);
+    inbox_.push_back(std::move(fiber));
+    inboxSize_.fetch_add(1, std::memory_order_release);
+}
+
+std::shared_ptr<Fiber> Worker::takeInbox() {
+    if (inboxSize_.load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(inboxMutex_);
+    if (inbox_.empty()) {
+        return nullptr;
+    }
+    auto fiber = std::move(inbox_.front());
+    inbox_.pop_front();
+    inboxSize_.fetch_sub(1, std::memory_order_relaxed);
+    return fiber;
 }
 
 std::shared_ptr<Fiber> Worker::stealFiber() {
-    auto fiber = queue_.steal();
+    auto fiber = unpinQueued(queue_.steal());
+    if (!fiber) {
+        fiber = takeInbox();
+    }
     if (fiber) {
-        stats_.fibersStolen++;
+        shared_.fibersStolen.fetch_add(1, std::memory_order_relaxed);
     }
     return fiber;
 }
 
 size_t Worker::getQueueSize() const {
-    return queue_.size();
+    return queue_.size() + inboxSize_.load(std::memory_order_relaxed);
 }
 
 void Worker::setCPUAffinity(int cpu) {
@@ -197,9 +431,12 @@ void Worker::setNUMANode(int node) {
 }
 
 void Worker::applyAffinity() {
+    // From run(), thread_ may not be assigned yet: start() stores it only
+    // once the thread is already running.
+    bool self = tlsWorker().worker == this;
 #ifdef _WIN32
     if (cpuAffinity_ >= 0) {
-        HANDLE thread = thread_->native_handle();
+        HANDLE thread = self ? GetCurrentThread() : thread_->native_handle();
         DWORD_PTR mask = 1ULL << cpuAffinity_;
         SetThreadAffinityMask(thread, mask);
     }
@@ -208,68 +445,134 @@ void Worker::applyAffinity() {
         cpu_set_t cpuset;
         CPU_ZERO(&cpuset);
         CPU_SET(cpuAffinity_, &cpuset);
-        pthread_setaffinity_np(thread_->native_handle(), sizeof(cpu_set_t), &cpuset);
+        pthread_setaffinity_np(self ? pthread_self() : thread_->native_handle(),
+                               sizeof(cpu_set_t), &cpuset);
     }
 #endif
 }
 
 void Worker::run() {
+    tlsSetWorker(owner_, this);
     // Apply CPU affinity if set
     applyAffinity();
-    
-    auto lastActivity = std::chrono::high_resolution_clock::now();
-    bool wasIdle = false;
-    
-    while (running_.load() && !stopping_.load()) {
+#ifndef _WIN32
+    FiberStackPool::prepareThread();
+#endif
+    // Node-local allocation (fiber stacks, pool refills) keys off this.
+    if (owner_ && owner_->numaAware_ && owner_->numNUMANodes_ > 1) {
+        setCurrentNumaNode(numaNode_);
+    }
+    if (owner_ && owner_->hooks().onWorkerStart) {
+        owner_->hooks().onWorkerStart();
+    }
+
+    uint64_t lastActivity = nowNs();
+    bool retired = false;
+
+    while (!stopping_.load()) {
+        if (owner_) {
+            owner_->pollTimers();
+            owner_->pollNetwork();
+        }
+
         auto fiber = getNextFiber();
-        
+
         if (fiber) {
             // Execute fiber
-            auto start = std::chrono::high_resolution_clock::now();
-            fiber->resume();
-            auto end = std::chrono::high_resolution_clock::now();
-            
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            stats_.busyTimeMs += duration.count();
-            
-            if (fiber->isCompleted()) {
-                stats_.fibersExecuted++;
-            } else {
-                // Re-queue if not completed
-                queue_.push(fiber);
-            }
-            
-            wasIdle = false;
+            uint64_t start = nowNs();
+            runFiber(std::move(fiber));
+            uint64_t end = nowNs();
+            bumpOwn(own_.busyNs, end - start);
             lastActivity = end;
+            continue;
+        }
+
+        if (owner_ && owner_->shouldRetire(this)) {
+            retired = true;
+            break;
+        }
+
+        // Idle: sleep until work is queued or the next timer is due.
+        if (owner_) {
+            owner_->waitForWork(std::chrono::milliseconds(10));
         } else {
-            // Idle - track idle time
-            if (!wasIdle) {
-                wasIdle = true;
-                lastActivity = std::chrono::high_resolution_clock::now();
-            }
-            
-            // Brief sleep to avoid spinning
             std::this_thread::sleep_for(std::chrono::microseconds(100));
-            
-            auto now = std::chrono::high_resolution_clock::now();
-            auto idleDuration = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastActivity);
-            stats_.idleTimeMs += idleDuration.count();
-            lastActivity = now;
         }
+
+        uint64_t now = nowNs();
+        bumpOwn(own_.idleNs, now - lastActivity);
+        lastActivity = now;
+    }
+
+    if (owner_ && owner_->hooks().onWorkerStop) {
+        owner_->hooks().onWorkerStop();
+    }
+    tlsSetWorker(nullptr, nullptr);
+#ifndef _WIN32
+    FiberStackPool::releaseThread();
+#endif
+    // shouldRetire() already gave up this worker's running slot.
+    if (owner_ && !retired) {
+        owner_->runningWorkers_.fetch_sub(1);
     }
-    
     running_.store(false);
 }
 
+void Worker::runFiber(std::shared_ptr<Fiber> fiber) {
+    fiber->resume();
+
+    switch (fiber->getState()) {
+    case Fiber::State::Completed:
+        bumpOwn(own_.fibersExecuted);
+        if (owner_) {
+            owner_->fiberCompleted(fiber.get());
+        }
+        break;
+    case Fiber::State::Ready:
+        // Cooperative yield: the inbox is FIFO and only drained once the local
+        // deque is empty, so everything already queued runs first.
+        pushInbox(std::move(fiber));
+        if (owner_) {
+            owner_->notifyWork();
+        }
+        break;
+    case Fiber::State::Suspended: {
+        bumpOwn(own_.parks);
+        // The fiber is now fully off its stack, so it is safe to let a waker
+        // see it. After this point another worker may already be running it.
+        std::mutex* lock = fiber->parkLock_;
+        fiber->parkLock_ = nullptr;
+        if (fiber->sleeping_) {
+            fiber->sleeping_ = false;
+            auto at = fiber->wakeAt_;
+            if (owner_) {
+                owner_->addTimer(at, LightweightScheduler::Timer{std::move(fiber), nullptr});
+            }
+        } else if (lock) {
+            lock->unlock();
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
 std::shared_ptr<Fiber> Worker::getNextFiber() {
-    // Try to get from own queue first
-    auto fiber = queue_.pop();
+    // Own deque first, then work handed to us by other threads.
+    auto fiber = unpinQueued(queue_.pop());
+    if (!fiber) {
+        fiber = takeInbox();
+    }
     if (fiber) {
         return fiber;
     }
-    
-    // If queue is empty, try work stealing is handled by scheduler
-    return nullptr;
+
+    // Otherwise steal from a peer.
+    if (owner_) {
+        fiber = owner_->stealFor(this);
+    }
+    return fiber;
 }
 
 // ============================================================================
@@ -281,13 +584,20 @@ LightweightScheduler::LightweightScheduler()
 }
 
 LightweightScheduler::LightweightScheduler(size_t numWorkers)
-    : nextWorker_(0)
+    : numWorkers_(0)
+    , targetWorkers_(0)
+    , maxThreads_(10000)
+    , runningWorkers_(0)
+    , blockedWorkers_(0)
+    , nextWorker_(0)
     , activeFibers_(0)
     , completedFibers_(0)
     , running_(false)
-    , fiberStackSize_(4096)
+    , fiberStackSize_(Fiber::kDefaultStackSize)
     , numaAware_(false)
-    , numNUMANodes_(0) {
+    , numNUMANodes_(0)
+    , idleWorkers_(0)
+    , pendingTimers_(0) {
     initialize(numWorkers);
 }
 
@@ -299,59 +609,77 @@ void LightweightScheduler::initialize(size_t numWorkers) {
     if (numWorkers == 0) {
         numWorkers = 1;
     }
-    
+    targetWorkers_ = numWorkers;
+    maxThreads_ = std::max(maxThreads_, numWorkers);
+
     // Detect NUMA topology
     detectNUMATopology();
-    
-    workers_.reserve(numWorkers);
-    
-    // If NUMA aware, distribute workers across NUMA nodes
+
+    workers_.clear();
+    workers_.reserve(maxThreads_);
+
+    // If NUMA aware, give each node a block of workers pinned to its CPUs
+    numaNodeWorkers_.assign(numNUMANodes_, {});
     if (numaAware_ && numNUMANodes_ > 0) {
-        size_t workersPerNode = (numWorkers + numNUMANodes_ - 1) / numNUMANodes_;
+        auto placement = NumaTopology::system().placeWorkers(numWorkers);
         for (size_t i = 0; i < numWorkers; ++i) {
-            int numaNode = i / workersPerNode;
-            int cpuAffinity = numaNode * workersPerNode + (i % workersPerNode);
-            workers_.push_back(std::make_unique<Worker>(i, numaNode, cpuAffinity));
+            int numaNode = placement[i].first;
+            int cpuAffinity = placement[i].second;
+            workers_.push_back(std::make_unique<Worker>(i, numaNode, cpuAffinity, this));
+            if (numaNode >= 0 && static_cast<size_t>(numaNode) < numNUMANodes_) {
+                numaNodeWorkers_[numaNode].push_back(i);
+            }
         }
     } else {
         for (size_t i = 0; i < numWorkers; ++i) {
-            workers_.push_back(std::make_unique<Worker>(i, -1, -1));
+            workers_.push_back(std::make_unique<Worker>(i, -1, -1, this));
         }
     }
+    numWorkers_.store(workers_.size(), std::memory_order_release);
 }
 
 void LightweightScheduler::start() {
     if (running_.load()) {
         return;
     }
-    
+
     running_.store(true);
-    
+#ifndef _WIN32
+    FiberStackPool::installOverflowHandler(&Fiber::currentStack);
+#endif
+
     // Start all workers
-    for (auto& worker : workers_) {
-        worker->start();
-    }
-    
-    // Start load balancing thread
-    std::thread([this]() {
-        while (running_.load()) {
-            balanceLoad();
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-    }).detach();
+    std::lock_guard<std::mutex> lock(workersMutex_);
+    for (size_t i = 0; i < workerCount(); ++i) {
+        workers_[i]->start();
+    }
 }
 
 void LightweightScheduler::stop() {
     running_.store(false);
-    
-    // Stop all workers
-    for (auto& worker : workers_) {
-        worker->stop();
+
+    // Spares are only added under workersMutex_ while running_ is set, so the
+    // count read here covers every worker; join without the lock, since a
+    // worker mid-handoff may be waiting for it.
+    size_t n;
+    {
+        std::lock_guard<std::mutex> lock(workersMutex_);
+        n = workerCount();
+
+        // Stop all workers
+        for (size_t i = 0; i < n; ++i) {
+            workers_[i]->stop();
+        }
     }
-    
+    {
+        std::lock_guard<std::mutex> idle(idleMutex_);
+        idleCV_.notify_all();
+    }
+    poller_.wake();
+
     // Wait for workers to finish
-    for (auto& worker : workers_) {
-        worker->join();
+    for (size_t i = 0; i < n; ++i) {
+        workers_[i]->join();
     }
 }
 
@@ -362,39 +690,428 @@ void LightweightScheduler::waitAll() {
     });
 }
 
+uint64_t LightweightScheduler::spawn(std::shared_ptr<Fiber> fiber) {
+    fiber->owner_ = this;
+    uint64_t id = fiber->getId();
+    linkLive(fiber.get());
+    activeFibers_.fetch_add(1);
+    schedule(std::move(fiber));
+    return id;
+}
+
+void LightweightScheduler::schedule(std::shared_ptr<Fiber> fiber) {
+    // Spawns and wake-ups from one of our own workers stay local (the new
+    // fiber likely shares data with the current one); others are placed.
+    WorkerTls tls = tlsWorker();
+    Worker* target = (tls.sched == this && tls.worker)
+        ? tls.worker
+        : workers_[selectWorkerForFiber(fiber->getPriority())].get();
+    if (fiber->getState() == Fiber::State::Suspended) {
+        target->shared_.unparks.fetch_add(1, std::memory_order_relaxed);
+    }
+    target->addFiber(std::move(fiber));
+    notifyWork();
+}
+
+void LightweightScheduler::unpark(std::shared_ptr<Fiber> fiber) {
+    if (!fiber) {
+        return;
+    }
+    LightweightScheduler* owner = fiber->owner_ ? fiber->owner_ : this;
+    owner->schedule(std::move(fiber));
+}
+
+void LightweightScheduler::park(std::unique_lock<std::mutex>& lock) {
+    Fiber* self = Fiber::current();
+    if (!self || !lock.owns_lock()) {
+        return;
+    }
+    std::mutex* m = lock.release();
+    self->parkLock_ = m;
+    // The worker releases `m` once we are off the CPU (Worker::runFiber).
+    self->switchOut(Fiber::State::Suspended);
+    lock = std::unique_lock<std::mutex>(*m);
+}
+
+void LightweightScheduler::sleepFor(std::chrono::nanoseconds d) {
+    Fiber* self = Fiber::current();
+    if (!self) {
+        std::this_thread::sleep_for(d);
+        return;
+    }
+    self->sleeping_ = true;
+    self->wakeAt_ = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(d);
+    self->switchOut(Fiber::State::Suspended);
+}
+
+bool LightweightScheduler::waitFd(int fd, bool forWrite) {
+    Fiber* self = Fiber::current();
+    if (!self || !self->owner_) {
+        return false;
+    }
+    return self->owner_->poller_.wait(fd, forWrite);
+}
+
+void LightweightScheduler::forgetFd(int fd) {
+    std::vector<std::shared_ptr<Fiber>> woken;
+    poller_.forget(fd, woken);
+    for (auto& fiber : woken) {
+        schedule(std::move(fiber));
+    }
+}
+
+void LightweightScheduler::yieldNow() {
+    if (Fiber* self = Fiber::current()) {
+        self->yield();
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+void LightweightScheduler::enterBlocking() {
+    WorkerTls tls = tlsWorker();
+    if (!tls.sched || !Fiber::current()) {
+        return;
+    }
+    tls.sched->blockedWorkers_.fetch_add(1);
+    tls.sched->ensureSpareWorker();
+}
+
+void LightweightScheduler::exitBlocking() {
+    WorkerTls tls = tlsWorker();
+    if (!tls.sched || !Fiber::current()) {
+        return;
+    }
+    tls.sched->blockedWorkers_.fetch_sub(1);
+}
+
+void LightweightScheduler::ensureSpareWorker() {
+    auto unblocked = [this]() {
+        size_t running = runningWorkers_.load();
+        size_t blocked = blockedWorkers_.load();
+        return running > blocked ? running - blocked : 0;
+    };
+    if (!running_.load() || unblocked() >= targetWorkers_) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(workersMutex_);
+    if (!running_.load() || unblocked() >= targetWorkers_) {
+        return;
+    }
+    size_t n = workerCount();
+    // Reuse a retired spare before growing the pool.
+    for (size_t i = targetWorkers_; i < n; ++i) {
+        if (!workers_[i]->isRunning()) {
+            workers_[i]->start();
+            return;
+        }
+    }
+    if (n < maxThreads_) {
+        workers_.push_back(std::make_unique<Worker>(n, -1, -1, this));
+        numWorkers_.store(n + 1, std::memory_order_release);
+        workers_[n]->start();
+    }
+}
+
+bool LightweightScheduler::shouldRetire(const Worker* worker) {
+    if (worker->getId() < targetWorkers_) {
+        return false;
+    }
+    // Give up our running slot only while the pool has a surplus of
+    // unblocked workers; the CAS keeps two idle spares from both leaving.
+    size_t running = runningWorkers_.load();
+    while (running > blockedWorkers_.load() + targetWorkers_) {
+        if (runningWorkers_.compare_exchange_weak(running, running - 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<Fiber> LightweightScheduler::stealFor(const Worker* thief) {
+    size_t n = workerCount();
+    if (n < 2) {
+        return nullptr;
+    }
+    size_t start = nextWorker_.fetch_add(1, std::memory_order_relaxed);
+    // On a NUMA machine, look on the thief's own node before crossing the
+    // interconnect: a remote fiber drags its stack and data along.
+    int node = thief->getNUMANode();
+    bool local = numaAware_ && numNUMANodes_ > 1 && node >= 0;
+    for (int pass = local ? 0 : 1; pass < 2; ++pass) {
+        for (size_t i = 0; i < n; ++i) {
+            Worker* victim = workers_[(start + i) % n].get();
+            if (victim == thief || victim->getQueueSize() == 0) {
+                continue;
+            }
+            if (pass == 0 && victim->getNUMANode() != node) {
+                continue;
+            }
+            if (auto fiber = victim->stealFiber()) {
+                return fiber;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool LightweightScheduler::hasQueuedWork() const {
+    size_t n = workerCount();
+    for (size_t i = 0; i < n; ++i) {
+        if (workers_[i]->getQueueSize() > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LightweightScheduler::waitForWork(std::chrono::milliseconds maxWait) {
+    auto wait = std::chrono::duration_cast<std::chrono::steady_clock::duration>(maxWait);
+    if (pendingTimers_.load() > 0) {
+        std::lock_guard<std::mutex> lock(timerMutex_);
+        if (!timers_.empty()) {
+            auto untilNext = timers_.next() - std::chrono::steady_clock::now();
+            wait = std::max(std::chrono::steady_clock::duration::zero(), std::min(wait, untilNext));
+        }
+    }
+    if (waitForNetwork(wait)) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(idleMutex_);
+    // Publish that we are idle before the final check; notifyWork() pairs
+    // with this (queue write, then idle-count read) so a wakeup is not lost.
+    idleWorkers_.fetch_add(1);
+    if (running_.load() && !hasQueuedWork()) {
+        idleCV_.wait_for(lock, wait);
+    }
+    idleWorkers_.fetch_sub(1);
+}
+
+void LightweightScheduler::notifyWork() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idleWorkers_.load() > 0) {
+        wakeNetworkWaiter();
+        std::lock_guard<std::mutex> lock(idleMutex_);
+        idleCV_.notify_one();
+    }
+}
+
+bool LightweightScheduler::waitForNetwork(std::chrono::steady_clock::duration maxWait) {
+    if (poller_.waiting() == 0) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(netMutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return false; // another worker already sleeps in the poller
+    }
+    // Same handshake as the condvar wait: notifyWork() reads idleWorkers_
+    // after queuing, and seeing us there it also sees netSleeping_.
+    netSleeping_.store(true);
+    idleWorkers_.fetch_add(1);
+    std::vector<std::shared_ptr<Fiber>> ready;
+    if (running_.load() && !hasQueuedWork()) {
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(maxWait).count();
+        poller_.poll(static_cast<int>(ms), ready);
+    }
+    idleWorkers_.fetch_sub(1);
+    netSleeping_.store(false);
+    lastNetPoll_.store(steadyNanos(), std::memory_order_relaxed);
+    lock.unlock();
+    for (auto& fiber : ready) {
+        schedule(std::move(fiber));
+    }
+    return true;
+}
+
+void LightweightScheduler::pollNetwork() {
+    if (poller_.waiting() == 0) {
+        return;
+    }
+    int64_t now = steadyNanos();
+    if (now - lastNetPoll_.load(std::memory_order_relaxed) <
+        std::chrono::nanoseconds(kNetPollInterval).count()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(netMutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    lastNetPoll_.store(now, std::memory_order_relaxed);
+    std::vector<std::shared_ptr<Fiber>> ready;
+    poller_.poll(0, ready);
+    lock.unlock();
+    for (auto& fiber : ready) {
+        schedule(std::move(fiber));
+    }
+}
+
+void LightweightScheduler::wakeNetworkWaiter() {
+    if (netSleeping_.exchange(false)) {
+        poller_.wake();
+    }
+}
+
+uint64_t LightweightScheduler::addTimer(std::chrono::steady_clock::time_point at, Timer timer) {
+    uint64_t id;
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(timerMutex_);
+        earliest = timers_.empty() || at < timers_.next();
+        id = timers_.add(at, std::move(timer));
+        pendingTimers_.store(timers_.size());
+    }
+    // Idle workers sleep until the earliest deadline at the latest, so only
+    // a new earliest one needs to wake them.
+    if (earliest) {
+        wakeNetworkWaiter();
+        std::lock_guard<std::mutex> lock(idleMutex_);
+        idleCV_.notify_one();
+    }
+    return id;
+}
+
+uint64_t LightweightScheduler::after(std::chrono::steady_clock::duration d, std::function<void()> fn) {
+    return addTimer(std::chrono::steady_clock::now() + d, Timer{nullptr, std::move(fn)});
+}
+
+bool LightweightScheduler::cancelTimer(uint64_t id) {
+    std::lock_guard<std::mutex> lock(timerMutex_);
+    bool cancelled = timers_.cancel(id);
+    pendingTimers_.store(timers_.size());
+    return cancelled;
+}
+
+void LightweightScheduler::pollTimers() {
+    if (pendingTimers_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    std::vector<Timer> due;
+    {
+        std::unique_lock<std::mutex> lock(timerMutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return; // another worker is already draining
+        }
+        timers_.popDue(std::chrono::steady_clock::now(), due);
+        pendingTimers_.store(timers_.size());
+    }
+    for (auto& timer : due) {
+        if (timer.fiber) {
+            schedule(std::move(timer.fiber));
+        } else if (timer.fn) {
+            timer.fn();
+        }
+    }
+}
+
+void LightweightScheduler::fiberCompleted(Fiber* fiber) {
+    unlinkLive(fiber);
+    completedFibers_.fetch_add(1);
+    if (activeFibers_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        completionCV_.notify_all();
+    }
+}
+
+void LightweightScheduler::linkLive(Fiber* fiber) {
+    if (hooks_.lockSwitch) hooks_.lockSwitch();
+    {
+        std::lock_guard<std::mutex> lock(liveMutex_);
+        fiber->prevLive_ = nullptr;
+        fiber->nextLive_ = liveHead_;
+        if (liveHead_) liveHead_->prevLive_ = fiber;
+        liveHead_ = fiber;
+    }
+    if (hooks_.unlockSwitch) hooks_.unlockSwitch();
+}
+
+void LightweightScheduler::unlinkLive(Fiber* fiber) {
+    if (hooks_.lockSwitch) hooks_.lockSwitch();
+    {
+        std::lock_guard<std::mutex> lock(liveMutex_);
+        if (fiber->prevLive_) fiber->prevLive_->nextLive_ = fiber->nextLive_;
+        else if (liveHead_ == fiber) liveHead_ = fiber->nextLive_;
+        if (fiber->nextLive_) fiber->nextLive_->prevLive_ = fiber->prevLive_;
+        fiber->prevLive_ = fiber->nextLive_ = nullptr;
+    }
+    if (hooks_.unlockSwitch) hooks_.unlockSwitch();
+}
+
+void LightweightScheduler::forEachSuspendedStack(void (*fn)(void* lo, void* hi)) const {
+    for (Fiber* f = liveHead_; f; f = f->nextLive_) {
+        if (!f->started_ || f->onStack_ || !f->stack_.base || f->isCompleted()) {
+            continue;
+        }
+#ifdef TOCIN_FIBER_ASM
+        // The switch pushed the callee-saved registers right at the saved
+        // stack pointer, so one range covers them and the live frames.
+        fn(f->context_, f->stackTop());
+#else
+        char* base = static_cast<char*>(f->stack_.base);
+        char* top = static_cast<char*>(f->stackTop());
+        char* sp = static_cast<char*>(f->savedSp_);
+        char* lo = (sp && sp - kStackScanSlack > base && sp < top) ? sp - kStackScanSlack : base;
+        fn(lo, top);
+#endif
+#if !defined(_WIN32) && !defined(TOCIN_FIBER_ASM)
+        // Callee-saved registers live in the saved context, not on the stack.
+        fn(f->context_, static_cast<char*>(f->context_) + sizeof(ucontext_t));
+#endif
+    }
+}
+
+void LightweightScheduler::setHooks(const SchedulerHooks& hooks) {
+    if (running_.load()) {
+        return; // Cannot change while running
+    }
+    hooks_ = hooks;
+}
+
 void LightweightScheduler::setMaxWorkers(size_t count) {
     if (running_.load()) {
         return; // Cannot change while running
     }
-    
-    workers_.clear();
+
     initialize(count);
 }
 
 void LightweightScheduler::setFiberStackSize(size_t size) {
-    fiberStackSize_ = std::max(size, size_t(1024)); // Minimum 1KB
+    fiberStackSize_ = std::max(size, size_t(16 * 1024)); // Minimum 16KB
 }
 
 LightweightScheduler::SchedulerStats LightweightScheduler::getStats() const {
-    std::lock_guard<std::mutex> lock(statsMutex_);
-    
+    // Every counter is atomic, so a scrape never holds up completions.
     SchedulerStats stats;
-    stats.totalWorkers = workers_.size();
+    stats.totalWorkers = workerCount();
     stats.activeFibers = activeFibers_.load();
     stats.completedFibers = completedFibers_.load();
     stats.numNUMANodes = numNUMANodes_;
-    
-    uint64_t totalTime = 0;
-    for (const auto& worker : workers_) {
-        auto workerStats = worker->getStats();
-        totalTime += workerStats.busyTimeMs;
-    }
-    
-    stats.totalExecutionTimeMs = totalTime;
-    stats.averageFiberTimeMs = stats.completedFibers > 0 
-        ? static_cast<double>(totalTime) / stats.completedFibers 
+
+    stats.fibersStolen = 0;
+    stats.parks = 0;
+    stats.unparks = 0;
+    stats.queuedFibers = 0;
+    stats.idleTimeNs = 0;
+    stats.busyTimeNs = 0;
+    stats.workers.reserve(stats.totalWorkers);
+    for (size_t i = 0; i < stats.totalWorkers; ++i) {
+        auto workerStats = workers_[i]->getStats();
+        stats.fibersStolen += workerStats.fibersStolen;
+        stats.parks += workerStats.parks;
+        stats.unparks += workerStats.unparks;
+        stats.queuedFibers += workerStats.queueDepth;
+        stats.idleTimeNs += workerStats.idleTimeNs;
+        stats.busyTimeNs += workerStats.busyTimeNs;
+        stats.workers.push_back(workerStats);
+    }
+
+    stats.totalExecutionTimeMs = stats.busyTimeNs / 1000000;
+    stats.averageFiberTimeMs = stats.completedFibers > 0
+        ? static_cast<double>(stats.busyTimeNs) / 1e6 / stats.completedFibers
         : 0.0;
-    
+
     return stats;
 }
 
@@ -403,14 +1120,13 @@ void LightweightScheduler::enableNUMAAwareness(bool enable) {
         return; // Cannot change while running
     }
     numaAware_ = enable;
-    
+
     // Re-initialize workers with NUMA awareness
-    workers_.clear();
-    initialize(std::thread::hardware_concurrency());
+    initialize(targetWorkers_);
 }
 
 void LightweightScheduler::setWorkerAffinity(size_t workerId, int cpu, int numaNode) {
-    if (workerId < workers_.size()) {
+    if (workerId < workerCount()) {
         workers_[workerId]->setCPUAffinity(cpu);
         workers_[workerId]->setNUMANode(numaNode);
     }
@@ -418,44 +1134,31 @@ void LightweightScheduler::setWorkerAffinity(size_t workerId, int cpu, int numaN
 
 void LightweightScheduler::detectNUMATopology() {
 #ifdef __linux__
-    // On Linux, check /sys/devices/system/node for NUMA nodes
-    numNUMANodes_ = 0;
-    for (int i = 0; i < 256; ++i) {
-        std::string path = "/sys/devices/system/node/node" + std::to_string(i);
-        struct stat buffer;
-        if (stat(path.c_str(), &buffer) == 0) {
-            numNUMANodes_ = i + 1;
-        } else {
-            break;
-        }
-    }
-    
-    if (numNUMANodes_ == 0) {
-        numNUMANodes_ = 1; // Default to single node
-    }
+    // CPU lists per node from /sys/devices/system/node
+    numNUMANodes_ = NumaTopology::system().nodes();
 #elif defined(_WIN32)
     // On Windows, use GetLogicalProcessorInformationEx
     DWORD length = 0;
     GetLogicalProcessorInformationEx(RelationNumaNode, nullptr, &length);
     if (length > 0) {
         std::vector<BYTE> buffer(length);
-        if (GetLogicalProcessorInformationEx(RelationNumaNode, 
-            reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), 
+        if (GetLogicalProcessorInformationEx(RelationNumaNode,
+            reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()),
             &length)) {
-            
+
             DWORD offset = 0;
             while (offset < length) {
                 auto info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(
                     buffer.data() + offset);
                 if (info->Relationship == RelationNumaNode) {
-                    numNUMANodes_ = std::max(numNUMANodes_, 
+                    numNUMANodes_ = std::max(numNUMANodes_,
                         static_cast<size_t>(info->NumaNode.NodeNumber + 1));
                 }
                 offset += info->Size;
             }
         }
     }
-    
+
     if (numNUMANodes_ == 0) {
         numNUMANodes_ = 1; // Default to single node
     }
@@ -465,26 +1168,29 @@ void LightweightScheduler::detectNUMATopology() {
 }
 
 size_t LightweightScheduler::selectWorkerForFiber(Fiber::Priority priority) {
+    size_t n = workerCount();
     if (!numaAware_ || numNUMANodes_ <= 1) {
-        // Simple round-robin with load awareness
-        // Find the least loaded worker
+        // Least-loaded running worker; a retired spare would never drain it.
         size_t leastLoaded = 0;
-        size_t minLoad = workers_[0]->getQueueSize();
-        
-        for (size_t i = 1; i < workers_.size(); ++i) {
+        size_t minLoad = SIZE_MAX;
+
+        for (size_t i = 0; i < n; ++i) {
+            if (i >= targetWorkers_ && !workers_[i]->isRunning()) {
+                continue;
+            }
             size_t load = workers_[i]->getQueueSize();
             if (load < minLoad) {
                 minLoad = load;
                 leastLoaded = i;
             }
         }
-        
+
         return leastLoaded;
     }
-    
+
     // NUMA-aware: prefer workers on appropriate NUMA node
     int targetNode = 0;
-    
+
     if (priority == Fiber::Priority::Critical || priority == Fiber::Priority::High) {
         // High-priority tasks go to node 0 (typically the primary node)
         targetNode = 0;
@@ -492,13 +1198,13 @@ size_t LightweightScheduler::selectWorkerForFiber(Fiber::Priority priority) {
         // Distribute other tasks across nodes based on current load
         targetNode = nextWorker_.fetch_add(1) % numNUMANodes_;
     }
-    
+
     // Find the least loaded worker on the target NUMA node
     size_t selectedWorker = 0;
     size_t minLoad = SIZE_MAX;
     bool foundOnNode = false;
-    
-    for (size_t i = 0; i < workers_.size(); ++i) {
+
+    for (size_t i = 0; i < n; ++i) {
         if (workers_[i]->getNUMANode() == targetNode) {
             size_t load = workers_[i]->getQueueSize();
             if (load < minLoad) {
@@ -508,71 +1214,13 @@ size_t LightweightScheduler::selectWorkerForFiber(Fiber::Priority priority) {
             }
         }
     }
-    
+
     if (foundOnNode) {
         return selectedWorker;
     }
-    
-    // Fallback if no worker found on target node
-    return nextWorker_.fetch_add(1) % workers_.size();
-}
 
-void LightweightScheduler::balanceLoad() {
-    // Find busiest and least busy workers
-    if (workers_.size() < 2) {
-        return;
-    }
-    
-    // Improved work stealing: steal multiple tasks and distribute better
-    // Find workers with large queues and idle workers
-    struct WorkerLoad {
-        size_t index;
-        size_t queueSize;
-    };
-    
-    std::vector<WorkerLoad> workerLoads;
-    workerLoads.reserve(workers_.size());
-    
-    for (size_t i = 0; i < workers_.size(); ++i) {
-        workerLoads.push_back({i, workers_[i]->getQueueSize()});
-    }
-    
-    // Sort by queue size
-    std::sort(workerLoads.begin(), workerLoads.end(), 
-              [](const WorkerLoad& a, const WorkerLoad& b) {
-                  return a.queueSize > b.queueSize;
-              });
-    
-    // Steal from busiest to least busy
-    size_t busiestIdx = workerLoads[0].index;
-    size_t idlestIdx = workerLoads[workerLoads.size() - 1].index;
-    
-    // Calculate how many tasks to steal (half the difference, minimum 1, maximum 4)
-    size_t queueDiff = workerLoads[0].queueSize - workerLoads[workerLoads.size() - 1].queueSize;
-    size_t tasksToSteal = std::max(size_t(1), std::min(size_t(4), queueDiff / 2));
-    
-    // Perform work stealing
-    for (size_t i = 0; i < tasksToSteal; ++i) {
-        auto fiber = workers_[busiestIdx]->stealFiber();
-        if (fiber) {
-            workers_[idlestIdx]->addFiber(fiber);
-        } else {
-            break; // No more tasks to steal
-        }
-    }
-    
-    // Also balance between other workers if there's significant imbalance
-    for (size_t i = 0; i < workerLoads.size() / 2 && i < 3; ++i) {
-        size_t busy = workerLoads[i].index;
-        size_t idle = workerLoads[workerLoads.size() - 1 - i].index;
-        
-        if (busy != idle && workerLoads[i].queueSize > workerLoads[workerLoads.size() - 1 - i].queueSize + 2) {
-            auto fiber = workers_[busy]->stealFiber();
-            if (fiber) {
-                workers_[idle]->addFiber(fiber);
-            }
-        }
-    }
+    // Fallback if no worker found on target node
+    return nextWorker_.fetch_add(1) % targetWorkers_;
 }
 
 LightweightScheduler& LightweightScheduler::instance() {
@@ -2,34 +2,69 @@
 
 #include <functional>
 #include <vector>
+#include <deque>
 #include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <memory>
+#include <chrono>
 #include <cstdint>
+#include <type_traits>
+
+#include "fiber_context.h"
+#include "netpoll.h"
+#include "numa_topology.h"
+#include "timer_heap.h"
 
 namespace tocin {
 namespace runtime {
 
+class LightweightScheduler;
+
+/**
+ * @brief Callbacks a host runtime installs to observe worker threads and
+ * fiber stack switches.
+ *
+ * The Tocin runtime uses these to register worker threads with the
+ * conservative GC and to keep the collector's notion of a worker's current
+ * stack in step with the fiber it is running. Every member is optional.
+ */
+struct SchedulerHooks {
+    void (*onWorkerStart)() = nullptr; // on each worker thread, before it runs fibers
+    void (*onWorkerStop)() = nullptr;  // on each worker thread, just before it exits
+    // Bracket every stack switch: lockSwitch() runs on the source stack right
+    // before the switch and unlockSwitch() on the destination stack right
+    // after it, so no collection can observe a half-switched thread.
+    void (*lockSwitch)() = nullptr;
+    void (*unlockSwitch)() = nullptr;
+    // Called between lockSwitch/unlockSwitch with the cool (high) end of the
+    // stack about to become current, or nullptr for the worker's own stack.
+    void (*setStackBottom)(void *stackBottom) = nullptr;
+};
+
 /**
  * @brief Lightweight Fiber/Coroutine implementation
- * 
- * Uses cooperative multitasking with ~4KB stack size instead of
- * OS threads (~1MB stack) to support millions of concurrent goroutines.
+ *
+ * A stackful coroutine with its own small stack (64KB by default instead of
+ * an OS thread's ~8MB). resume() switches onto the fiber's stack; yield()
+ * and park() switch back to whichever thread resumed it, so a suspended
+ * fiber may later continue on a different worker.
  */
-class Fiber {
+class Fiber : public std::enable_shared_from_this<Fiber> {
 public:
     using FiberFunc = std::function<void()>;
-    
+
+    static constexpr size_t kDefaultStackSize = 64 * 1024;
+
     enum class State {
         Ready,      // Ready to run
         Running,    // Currently executing
         Suspended,  // Suspended, waiting for event
         Completed   // Execution finished
     };
-    
+
     enum class Priority {
         Critical = 0,  // Highest priority
         High = 1,
@@ -38,10 +73,12 @@ public:
         Background = 4 // Lowest priority
     };
 
-    explicit Fiber(FiberFunc func, size_t stackSize = 4096, Priority priority = Priority::Normal);
+    explicit Fiber(FiberFunc func, size_t stackSize = kDefaultStackSize, Priority priority = Priority::Normal);
     ~Fiber();
 
-    // Fiber control
+    // Fiber control. resume() runs the fiber on the calling thread until it
+    // yields, parks or completes. yield() (from inside the fiber) returns
+    // control as Ready; the scheduler re-queues it.
     void resume();
     void yield();
     void complete();
@@ -53,121 +90,245 @@ public:
     Priority getPriority() const { return priority_; }
     void setPriority(Priority priority) { priority_ = priority; }
 
+    // One pointer of host-runtime state carried with the fiber across workers
+    // (the Tocin runtime keeps per-goroutine exception state here).
+    void *getLocal() const { return local_; }
+    void setLocal(void *p) { local_ = p; }
+
+    // The fiber currently running on this thread, or nullptr.
+    static Fiber *current();
+
     // Friend declarations for wrapper functions
 #ifndef _WIN32
-    friend void fiberWrapper(Fiber* fiber);
+    friend void fiberEntry(void *param);
 #else
-    friend VOID CALLBACK fiberWrapperWindows(PVOID param);
+    friend void __stdcall fiberWrapperWindows(void *param);
 #endif
+    friend class Worker;
+    friend class LightweightScheduler;
 
 private:
+    // Switch from this fiber back to the thread that resumed it.
+    void switchOut(State next);
+    void *stackTop() const { return stack_.top(); }
+#ifndef _WIN32
+    // Take a pool stack and lay out the first switch onto it. Deferred to
+    // the first resume so that only fibers that run hold a stack (and the
+    // running worker's cache supplies it); returned once Completed.
+    void prepareStack();
+    void releaseStack();
+#endif
+    // Stack of the fiber running on this thread (for the overflow handler).
+    static FiberStack currentStack();
+
     uint64_t id_;
     FiberFunc func_;
     State state_;
     Priority priority_;
-    void* stack_;
+    FiberStack stack_;
     size_t stackSize_;
+    // With TOCIN_FIBER_ASM both are saved stack pointers (the callee-saved
+    // registers sit just above them); otherwise ucontext_t pointers.
     void* context_;
-    
-    static uint64_t nextId_;
+    void* returnContext_ = nullptr; // context of the resumer, valid while running
+    void* local_ = nullptr;
+    LightweightScheduler* owner_ = nullptr;
+
+    // Set by the fiber before it switches out Suspended; consumed by the
+    // worker once the switch is complete (see LightweightScheduler::park).
+    std::mutex* parkLock_ = nullptr;
+    bool sleeping_ = false;
+    // Run queues hold raw pointers; this keeps a queued fiber alive.
+    std::shared_ptr<Fiber> queuedRef_;
+    std::chrono::steady_clock::time_point wakeAt_{};
+
+    // Conservative-root bookkeeping, only mutated under SchedulerHooks::lockSwitch.
+    bool started_ = false;
+    bool onStack_ = false;   // a thread is currently executing on our stack
+    void* savedSp_ = nullptr;
+    Fiber* prevLive_ = nullptr;
+    Fiber* nextLive_ = nullptr;
+
+    static std::atomic<uint64_t> nextId_;
+};
+
+/**
+ * @brief Chase-Lev work-stealing deque
+ *
+ * Lock-free single-owner deque (Chase & Lev 2005, with the C11 orderings of
+ * Le et al. 2013). Only the owning thread may push() and pop(), at the bottom;
+ * any thread may steal() from the top. The ring buffer doubles when full, and
+ * replaced buffers are kept until destruction because a thief may still be
+ * reading one. T must be trivially copyable (a pointer in practice); an empty
+ * result is T().
+ */
+template<typename T>
+class ChaseLevDeque {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "ChaseLevDeque elements must be trivially copyable");
+public:
+    explicit ChaseLevDeque(size_t capacity = 64);
+    ~ChaseLevDeque();
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    void push(T item);
+    T pop();
+    T steal();
+    size_t size() const;
+
+private:
+    struct Ring {
+        explicit Ring(size_t cap) : mask(cap - 1), slots(new std::atomic<T>[cap]) {}
+        ~Ring() { delete[] slots; }
+        size_t capacity() const { return mask + 1; }
+        T get(int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, T v) { slots[i & mask].store(v, std::memory_order_relaxed); }
+
+        size_t mask;
+        std::atomic<T>* slots;
+    };
+
+    Ring* grow(Ring* ring, int64_t bottom, int64_t top);
+
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    std::atomic<Ring*> ring_;
+    std::vector<Ring*> retired_; // owner-only
 };
 
 /**
  * @brief Work-stealing queue for efficient task distribution
- * 
- * Lock-free queue that allows workers to steal tasks from each other
- * for optimal load balancing. Now supports priority-based ordering.
+ *
+ * One Chase-Lev deque per priority level, so a priority push is O(1) and
+ * pop/steal scan at most kLevels bottoms/tops instead of keeping items sorted.
+ * The owner pops newest-first (cache-warm), thieves steal oldest-first; both
+ * drain higher priorities (lower values) before lower ones. Single owner, as
+ * for ChaseLevDeque.
  */
 template<typename T>
 class WorkStealingQueue {
 public:
-    WorkStealingQueue() : bottom_(0), top_(0) {}
-    
+    static constexpr int kLevels = 5;        // Fiber::Priority::Critical..Background
+    static constexpr int kDefaultLevel = 2;  // Fiber::Priority::Normal
+
+    WorkStealingQueue() = default;
+
     // Owner operations (bottom of queue)
-    void push(T item);
+    void push(T item) { pushPriority(item, kDefaultLevel); }
     void pushPriority(T item, int priority); // Priority-aware push
     T pop();
-    
+
     // Thief operations (top of queue)
     T steal();
-    T stealPriority(int minPriority); // Steal with priority filter
-    
-    // Status
-    bool isEmpty() const;
+    T stealPriority(int minPriority); // Steal only priorities <= minPriority
+
+    // Status (approximate while other threads are active)
+    bool isEmpty() const { return size() == 0; }
     size_t size() const;
 
 private:
-    struct PriorityItem {
-        T item;
-        int priority;
-        size_t insertOrder;
-    };
-    
-    std::vector<T> items_;
-    std::vector<PriorityItem> priorityItems_;
-    std::atomic<size_t> bottom_;
-    std::atomic<size_t> top_;
-    std::atomic<size_t> insertCounter_;
-    std::mutex mutex_;
-    bool usePriority_;
+    ChaseLevDeque<T> levels_[kLevels];
 };
 
 /**
  * @brief Worker thread that executes fibers
- * 
+ *
  * Enhanced with CPU affinity and NUMA awareness
  */
 class Worker {
 public:
-    explicit Worker(size_t id, int numaNode = -1, int cpuAffinity = -1);
+    explicit Worker(size_t id, int numaNode = -1, int cpuAffinity = -1,
+                    LightweightScheduler* owner = nullptr);
     ~Worker();
 
     // Worker control
     void start();
     void stop();
     void join();
-    
-    // Task management
+    bool isRunning() const { return running_.load(); }
+
+    // Task management. addFiber may be called from any thread: the worker's
+    // own thread pushes onto its lock-free deque, others go through an inbox.
     void addFiber(std::shared_ptr<Fiber> fiber);
     std::shared_ptr<Fiber> stealFiber();
     size_t getQueueSize() const;
-    
+    size_t getId() const { return id_; }
+
     // NUMA and affinity
     void setCPUAffinity(int cpu);
     void setNUMANode(int node);
     int getNUMANode() const { return numaNode_; }
     int getCPUAffinity() const { return cpuAffinity_; }
-    
-    // Statistics
+
+    // Statistics: a snapshot of the worker's counters, safe to take from any
+    // thread while it runs. fibersStolen counts fibers other workers took
+    // from this one; parks are suspensions of fibers it ran, unparks wake-ups
+    // of suspended fibers queued onto it. queueDepth is the current length.
     struct WorkerStats {
         uint64_t fibersExecuted;
         uint64_t fibersStolen;
+        uint64_t parks;
+        uint64_t unparks;
+        uint64_t queueDepth;
+        uint64_t idleTimeNs;
+        uint64_t busyTimeNs;
         uint64_t idleTimeMs;
         uint64_t busyTimeMs;
     };
-    
-    WorkerStats getStats() const { return stats_; }
+
+    WorkerStats getStats() const;
 
 private:
+    friend class LightweightScheduler;
+
     void run();
+    void runFiber(std::shared_ptr<Fiber> fiber);
     std::shared_ptr<Fiber> getNextFiber();
     void applyAffinity();
-    
+    void pushInbox(std::shared_ptr<Fiber> fiber);
+    static Fiber* pinQueued(std::shared_ptr<Fiber> fiber);
+    static std::shared_ptr<Fiber> unpinQueued(Fiber* raw);
+    std::shared_ptr<Fiber> takeInbox();
+
     size_t id_;
     int numaNode_;
     int cpuAffinity_;
+    LightweightScheduler* owner_;
     std::unique_ptr<std::thread> thread_;
-    WorkStealingQueue<std::shared_ptr<Fiber>> queue_;
+    WorkStealingQueue<Fiber*> queue_;   // owner-only push/pop; see Fiber::queuedRef_
+    // FIFO for pushes from other threads and for yielded fibers; the owner
+    // drains it when its deque is empty and thieves may take from it too.
+    std::mutex inboxMutex_;
+    std::deque<std::shared_ptr<Fiber>> inbox_;
+    std::atomic<size_t> inboxSize_{0};
     std::atomic<bool> running_;
     std::atomic<bool> stopping_;
-    WorkerStats stats_;
+
+    // Counters on their own cache lines, away from the queues. Only this
+    // worker's thread writes the first group, so it bumps them with a plain
+    // load and store; the second is written by thieves and wakers.
+    struct alignas(64) OwnCounters {
+        std::atomic<uint64_t> fibersExecuted{0};
+        std::atomic<uint64_t> parks{0};
+        std::atomic<uint64_t> idleNs{0};
+        std::atomic<uint64_t> busyNs{0};
+    };
+    struct alignas(64) SharedCounters {
+        std::atomic<uint64_t> fibersStolen{0};
+        std::atomic<uint64_t> unparks{0};
+    };
+    OwnCounters own_;
+    SharedCounters shared_;
 };
 
 /**
  * @brief Lightweight Goroutine Scheduler
- * 
- * Fiber-based scheduler supporting millions of concurrent goroutines
- * with work-stealing for optimal load balancing.
+ *
+ * M:N scheduler: many fibers multiplexed onto a fixed pool of worker
+ * threads. Idle workers steal from busy ones; fibers that block on a channel
+ * or timer park without holding their worker, and a fiber that enters a
+ * blocking system call hands its worker's slot to a spare thread.
  * Enhanced with priority-based scheduling and NUMA awareness.
  */
 class LightweightScheduler {
@@ -180,21 +341,73 @@ public:
     void start();
     void stop();
     void waitAll();
-    
+    bool isRunning() const { return running_.load(); }
+
     // Goroutine creation
     template<typename Func, typename... Args>
     uint64_t go(Func&& func, Args&&... args);
-    
+
     template<typename Func, typename... Args>
     uint64_t goWithPriority(Fiber::Priority priority, Func&& func, Args&&... args);
-    
+
+    // Make a parked fiber runnable again (any thread).
+    void unpark(std::shared_ptr<Fiber> fiber);
+
+    // Blocking primitives for code running inside a fiber of *some*
+    // scheduler; callers must check Fiber::current() first.
+    //  - park: atomically release `lock` and suspend until unpark(); the lock
+    //    is re-acquired before returning. Whoever calls unpark() must hold the
+    //    same mutex when it decides to wake the fiber.
+    //  - sleepFor: suspend the fiber (not its worker) for `d`.
+    //  - yieldNow: let other ready fibers run.
+    //  - waitFd: park until a non-blocking fd is readable (or writable),
+    //    then return true so the caller retries its system call; false (at
+    //    once) when not on a fiber or the fd cannot be polled.
+    static void park(std::unique_lock<std::mutex>& lock);
+    static void sleepFor(std::chrono::nanoseconds d);
+    static void yieldNow();
+    static bool waitFd(int fd, bool forWrite);
+
+    // Call before closing an fd a fiber may have waited on; anything still
+    // parked on it is woken.
+    void forgetFd(int fd);
+
+    // Run fn once d has passed, without a thread per timer: sleeping fibers
+    // and these share one deadline heap that workers drain between fibers
+    // and sleep on when idle. Returns an id for cancelTimer(), which is true
+    // if fn had not run yet. fn runs on a worker thread, not a fiber, so it
+    // must be short and must not block (send to a channel, unpark, queue
+    // work). Timers fire only while the scheduler is running.
+    uint64_t after(std::chrono::steady_clock::duration d, std::function<void()> fn);
+    bool cancelTimer(uint64_t id);
+
+    // Bracket a call that can block the OS thread (accept, recv, ...). When
+    // called on a worker, a spare worker is started so the pool keeps running
+    // fibers meanwhile; spares retire once they are surplus. No-op elsewhere.
+    static void enterBlocking();
+    static void exitBlocking();
+
     // Configuration
     void setMaxWorkers(size_t count);
     void setFiberStackSize(size_t size);
+    // Pin workers to CPUs node by node (NumaTopology::system()), steal from
+    // same-node workers first and place fiber stacks and pool memory on the
+    // worker's node. Only honoured before start().
     void enableNUMAAwareness(bool enable);
     void setWorkerAffinity(size_t workerId, int cpu, int numaNode);
-    
+    // Install host hooks; only honoured before start().
+    void setHooks(const SchedulerHooks& hooks);
+    const SchedulerHooks& hooks() const { return hooks_; }
+
+    // Report the live stack range of every started fiber that is not
+    // currently on a CPU, plus its saved register context. Must only be
+    // called while switches are excluded (i.e. under hooks().lockSwitch, as a
+    // stop-the-world collector's root callback is); it takes no locks.
+    void forEachSuspendedStack(void (*fn)(void* lo, void* hi)) const;
+
     // Statistics
+    // Totals over the workers of their WorkerStats, which are also listed
+    // one per worker.
     struct SchedulerStats {
         size_t totalWorkers;
         size_t activeFibers;
@@ -202,20 +415,62 @@ public:
         uint64_t totalExecutionTimeMs;
         double averageFiberTimeMs;
         size_t numNUMANodes;
+        uint64_t fibersStolen;
+        uint64_t parks;
+        uint64_t unparks;
+        uint64_t queuedFibers;
+        uint64_t idleTimeNs;
+        uint64_t busyTimeNs;
+        std::vector<Worker::WorkerStats> workers;
     };
-    
+
     SchedulerStats getStats() const;
-    
+
     // Singleton access
     static LightweightScheduler& instance();
 
 private:
+    friend class Worker;
+
+    // A sleeping fiber to wake, or an after() callback.
+    struct Timer {
+        std::shared_ptr<Fiber> fiber;
+        std::function<void()> fn;
+    };
+
     void initialize(size_t numWorkers);
-    void balanceLoad();
     void detectNUMATopology();
     size_t selectWorkerForFiber(Fiber::Priority priority);
-    
+    uint64_t spawn(std::shared_ptr<Fiber> fiber);
+    void schedule(std::shared_ptr<Fiber> fiber);
+
+    // Worker-side helpers.
+    std::shared_ptr<Fiber> stealFor(const Worker* thief);
+    void waitForWork(std::chrono::milliseconds maxWait);
+    void notifyWork();
+    bool hasQueuedWork() const;
+    void pollTimers();
+    void pollNetwork();
+    bool waitForNetwork(std::chrono::steady_clock::duration maxWait);
+    void wakeNetworkWaiter();
+    uint64_t addTimer(std::chrono::steady_clock::time_point at, Timer timer);
+    void fiberCompleted(Fiber* fiber);
+    bool shouldRetire(const Worker* worker);
+    void ensureSpareWorker();
+    void linkLive(Fiber* fiber);
+    void unlinkLive(Fiber* fiber);
+    size_t workerCount() const { return numWorkers_.load(std::memory_order_acquire); }
+
+    // Slots are reserved up front (maxThreads_) so stealing workers can index
+    // them while spares are appended; only numWorkers_ entries are valid.
     std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> numWorkers_;
+    size_t targetWorkers_;
+    size_t maxThreads_;
+    std::atomic<size_t> runningWorkers_;
+    std::atomic<size_t> blockedWorkers_;
+    std::mutex workersMutex_;
+
     std::atomic<size_t> nextWorker_;
     std::atomic<size_t> activeFibers_;
     std::atomic<size_t> completedFibers_;
@@ -223,8 +478,30 @@ private:
     size_t fiberStackSize_;
     bool numaAware_;
     size_t numNUMANodes_;
-    std::vector<size_t> numaNodeWorkers_; // Workers per NUMA node
-    
+    std::vector<std::vector<size_t>> numaNodeWorkers_; // Worker indices on each NUMA node
+    SchedulerHooks hooks_;
+
+    // Idle workers sleep here until work is queued or a timer is due.
+    std::mutex idleMutex_;
+    std::condition_variable idleCV_;
+    std::atomic<size_t> idleWorkers_;
+
+    std::mutex timerMutex_;
+    std::atomic<size_t> pendingTimers_;  // timers_.size(), read without the lock
+    TimerHeap<Timer> timers_;
+
+    // Fibers parked on sockets. Busy workers poll it without blocking every
+    // kNetPollInterval; one idle worker at a time sleeps in it instead of on
+    // idleCV_ (netSleeping_), and notifyWork() wakes it.
+    NetPoller poller_;
+    std::mutex netMutex_;
+    std::atomic<bool> netSleeping_{false};
+    std::atomic<int64_t> lastNetPoll_{0};
+
+    // Intrusive list of fibers spawned here and not yet completed.
+    std::mutex liveMutex_;
+    Fiber* liveHead_ = nullptr;
+
     mutable std::mutex statsMutex_;
     std::condition_variable completionCV_;
 };
@@ -232,129 +509,137 @@ private:
 // Template implementations
 
 template<typename T>
-void WorkStealingQueue<T>::push(T item) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    items_.push_back(item);
-    bottom_.store(items_.size(), std::memory_order_release);
+ChaseLevDeque<T>::ChaseLevDeque(size_t capacity)
+    : top_(0), bottom_(0) {
+    size_t cap = 1;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+    ring_.store(new Ring(cap), std::memory_order_relaxed);
 }
 
 template<typename T>
-void WorkStealingQueue<T>::pushPriority(T item, int priority) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    size_t order = insertCounter_.fetch_add(1);
-    priorityItems_.push_back({item, priority, order});
-    
-    // Sort by priority (lower value = higher priority), then by insertion order
-    std::sort(priorityItems_.begin(), priorityItems_.end(),
-        [](const PriorityItem& a, const PriorityItem& b) {
-            if (a.priority != b.priority) return a.priority < b.priority;
-            return a.insertOrder < b.insertOrder;
-        });
-    
-    bottom_.store(priorityItems_.size(), std::memory_order_release);
+ChaseLevDeque<T>::~ChaseLevDeque() {
+    delete ring_.load(std::memory_order_relaxed);
+    for (Ring* r : retired_) {
+        delete r;
+    }
 }
 
 template<typename T>
-T WorkStealingQueue<T>::pop() {
-    size_t b = bottom_.load(std::memory_order_acquire) - 1;
-    bottom_.store(b, std::memory_order_release);
-    
-    size_t t = top_.load(std::memory_order_acquire);
-    
-    if (b < t) {
-        // Queue was empty
-        bottom_.store(t, std::memory_order_release);
-        return T();
+typename ChaseLevDeque<T>::Ring* ChaseLevDeque<T>::grow(Ring* ring, int64_t bottom, int64_t top) {
+    Ring* bigger = new Ring(ring->capacity() * 2);
+    for (int64_t i = top; i < bottom; ++i) {
+        bigger->put(i, ring->get(i));
     }
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Try priority items first
-    if (!priorityItems_.empty()) {
-        T item = priorityItems_.back().item;
-        priorityItems_.pop_back();
-        bottom_.store(priorityItems_.size(), std::memory_order_release);
-        return item;
+    retired_.push_back(ring);
+    ring_.store(bigger, std::memory_order_release);
+    return bigger;
+}
+
+template<typename T>
+void ChaseLevDeque<T>::push(T item) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    Ring* ring = ring_.load(std::memory_order_relaxed);
+    if (b - t > static_cast<int64_t>(ring->capacity()) - 1) {
+        ring = grow(ring, b, t);
     }
-    
-    // Fall back to regular items
-    if (b >= items_.size()) {
+    ring->put(b, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+}
+
+template<typename T>
+T ChaseLevDeque<T>::pop() {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Ring* ring = ring_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+        // Empty.
+        bottom_.store(b + 1, std::memory_order_relaxed);
         return T();
     }
-    
-    T item = items_[b];
-    
-    if (b == t) {
-        // Last item - race with steal()
-        if (!top_.compare_exchange_strong(t, t + 1)) {
-            item = T(); // Lost race
+    T item = ring->get(b);
+    if (t == b) {
+        // Last element: race thieves for it.
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            item = T();
         }
-        bottom_.store(t + 1, std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
     }
-    
     return item;
 }
 
 template<typename T>
-T WorkStealingQueue<T>::steal() {
-    size_t t = top_.load(std::memory_order_acquire);
-    size_t b = bottom_.load(std::memory_order_acquire);
-    
+T ChaseLevDeque<T>::steal() {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
     if (t >= b) {
-        return T(); // Queue is empty
-    }
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Steal from priority items first (highest priority)
-    if (!priorityItems_.empty()) {
-        T item = priorityItems_.front().item;
-        priorityItems_.erase(priorityItems_.begin());
-        top_.fetch_add(1);
-        return item;
-    }
-    
-    // Steal from regular items
-    if (t >= items_.size()) {
         return T();
     }
-    
-    T item = items_[t];
-    
-    if (!top_.compare_exchange_strong(t, t + 1)) {
-        return T(); // Lost race
+    Ring* ring = ring_.load(std::memory_order_acquire);
+    T item = ring->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+        return T(); // lost to the owner or another thief
     }
-    
     return item;
 }
 
 template<typename T>
-T WorkStealingQueue<T>::stealPriority(int minPriority) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Find highest priority item that meets minimum priority requirement
-    for (auto it = priorityItems_.begin(); it != priorityItems_.end(); ++it) {
-        if (it->priority <= minPriority) {
-            T item = it->item;
-            priorityItems_.erase(it);
-            top_.fetch_add(1);
+size_t ChaseLevDeque<T>::size() const {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? static_cast<size_t>(b - t) : 0;
+}
+
+template<typename T>
+void WorkStealingQueue<T>::pushPriority(T item, int priority) {
+    if (priority < 0) {
+        priority = 0;
+    } else if (priority >= kLevels) {
+        priority = kLevels - 1;
+    }
+    levels_[priority].push(item);
+}
+
+template<typename T>
+T WorkStealingQueue<T>::pop() {
+    for (auto& level : levels_) {
+        if (T item = level.pop()) {
             return item;
         }
     }
-    
     return T();
 }
 
 template<typename T>
-bool WorkStealingQueue<T>::isEmpty() const {
-    return bottom_.load() <= top_.load();
+T WorkStealingQueue<T>::steal() {
+    return stealPriority(kLevels - 1);
+}
+
+template<typename T>
+T WorkStealingQueue<T>::stealPriority(int minPriority) {
+    for (int i = 0; i <= minPriority && i < kLevels; ++i) {
+        if (T item = levels_[i].steal()) {
+            return item;
+        }
+    }
+    return T();
 }
 
 template<typename T>
 size_t WorkStealingQueue<T>::size() const {
-    size_t b = bottom_.load();
-    size_t t = top_.load();
-    return b > t ? b - t : 0;
+    size_t n = 0;
+    for (const auto& level : levels_) {
+        n += level.size();
+    }
+    return n;
 }
 
 template<typename Func, typename... Args>
@@ -367,7 +652,7 @@ uint64_t LightweightScheduler::goWithPriority(Fiber::Priority priority, Func&& f
     // Create fiber with bound function and priority
     // Use std::bind to avoid C++20 pack init-capture
     auto boundFunc = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
-    
+
     auto fiber = std::make_shared<Fiber>(
         [boundFunc = std::move(boundFunc)]() mutable {
             boundFunc();
@@ -375,14 +660,8 @@ uint64_t LightweightScheduler::goWithPriority(Fiber::Priority priority, Func&& f
         fiberStackSize_,
         priority
     );
-    
-    // Select worker based on priority and NUMA awareness
-    size_t workerIdx = selectWorkerForFiber(priority);
-    workers_[workerIdx]->addFiber(fiber);
-    
-    activeFibers_.fetch_add(1);
-    
-    return fiber->getId();
+
+    return spawn(std::move(fiber));
 }
 
 } // namespace runtime
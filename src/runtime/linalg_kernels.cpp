@@ -0,0 +1,297 @@
+// Matrix kernels: the portable scalar table, the baseline SIMD table of the
+// target (SSE2 on x86-64, NEON on AArch64), the dispatch that picks among
+// them and the AVX2/AVX-512 tables, and the blocked GEMM/GEMV drivers behind
+// the gemmF64/gemvF64 builtins.
+#include "linalg_kernels_impl.h"
+#include "kernel_support.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TOCIN_LINALG_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define TOCIN_LINALG_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+struct Scalar {
+    using Vec = double;
+    static constexpr size_t kWidth = 1;
+    static constexpr size_t kRows = 4;
+
+    static Vec zero() { return 0.0; }
+    static Vec splat(double x) { return x; }
+    static Vec load(const double *p) { return *p; }
+    static void store(double *p, Vec v) { *p = v; }
+    static Vec fma(Vec a, Vec b, Vec acc) { return acc + a * b; }
+    static Vec add(Vec a, Vec b) { return a + b; }
+    static double sum(Vec v) { return v; }
+};
+
+#ifdef TOCIN_LINALG_SSE2
+struct Sse2 {
+    using Vec = __m128d;
+    static constexpr size_t kWidth = 2;
+    static constexpr size_t kRows = 4;
+
+    static Vec zero() { return _mm_setzero_pd(); }
+    static Vec splat(double x) { return _mm_set1_pd(x); }
+    static Vec load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, Vec v) { _mm_storeu_pd(p, v); }
+    // No FMA in the baseline; the separate multiply rounds once more.
+    static Vec fma(Vec a, Vec b, Vec acc) { return _mm_add_pd(acc, _mm_mul_pd(a, b)); }
+    static Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+    static double sum(Vec v) { return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v))); }
+};
+#endif
+
+#ifdef TOCIN_LINALG_NEON
+struct Neon {
+    using Vec = float64x2_t;
+    static constexpr size_t kWidth = 2;
+    static constexpr size_t kRows = 8;  // 32 vector registers
+
+    static Vec zero() { return vdupq_n_f64(0.0); }
+    static Vec splat(double x) { return vdupq_n_f64(x); }
+    static Vec load(const double *p) { return vld1q_f64(p); }
+    static void store(double *p, Vec v) { vst1q_f64(p, v); }
+    static Vec fma(Vec a, Vec b, Vec acc) { return vfmaq_f64(acc, a, b); }
+    static Vec add(Vec a, Vec b) { return vaddq_f64(a, b); }
+    static double sum(Vec v) { return vaddvq_f64(v); }
+};
+#endif
+
+constexpr LinalgKernels kScalarKernels = linalgTable<Scalar>("scalar");
+#ifdef TOCIN_LINALG_SSE2
+constexpr LinalgKernels kSse2Kernels = linalgTable<Sse2>("sse2");
+#endif
+#ifdef TOCIN_LINALG_NEON
+constexpr LinalgKernels kNeonKernels = linalgTable<Neon>("neon");
+#endif
+
+bool cpuHasAvx2Fma() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+bool cpuHasAvx512() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
+}
+
+const LinalgKernels *chooseKernels() {
+    auto available = availableLinalgKernels();
+    if (const char *forced = std::getenv("TOCIN_LINALG_KERNELS")) {
+        for (const auto *table : available)
+            if (std::strcmp(table->name, forced) == 0) return table;
+    }
+    return available.back();
+}
+
+// Panel shape: kKc rows of B (one micro-kernel pass over the depth) by kNc
+// columns, about 1 MiB packed, with C handed out kMc rows at a time.
+constexpr size_t kKc = 256;
+constexpr size_t kNc = 512;
+constexpr size_t kMc = 64;
+// Below this many multiply-adds per panel the pool hand-off costs more than
+// it saves.
+constexpr size_t kParallelWork = size_t(1) << 20;
+
+// Copy b[0, kc) x [0, nc) (leading dimension ldb) into strips of nr columns,
+// zero-padding the last one.
+void packPanel(const double *b, size_t ldb, size_t kc, size_t nc, size_t nr, double *out) {
+    for (size_t j = 0; j < nc; j += nr) {
+        size_t width = nc - j < nr ? nc - j : nr;
+        for (size_t k = 0; k < kc; ++k) {
+            const double *src = b + k * ldb + j;
+            size_t jj = 0;
+            for (; jj < width; ++jj) out[jj] = src[jj];
+            for (; jj < nr; ++jj) out[jj] = 0.0;
+            out += nr;
+        }
+    }
+}
+
+// The same panel of a B stored transposed: element (k, j) is b[j * ldb + k].
+void packPanelTransposed(const double *b, size_t ldb, size_t kc, size_t nc, size_t nr, double *out) {
+    for (size_t j = 0; j < nc; j += nr) {
+        size_t width = nc - j < nr ? nc - j : nr;
+        for (size_t k = 0; k < kc; ++k) {
+            const double *src = b + j * ldb + k;
+            size_t jj = 0;
+            for (; jj < width; ++jj) out[jj] = src[jj * ldb];
+            for (; jj < nr; ++jj) out[jj] = 0.0;
+            out += nr;
+        }
+    }
+}
+
+// Run fn over row blocks [0, blocks) on the pool, or inline for small work.
+void forBlocks(size_t blocks, size_t work, void (*fn)(void *, int64_t, int64_t), void *ctx) {
+    if (blocks > 1 && work >= kParallelWork)
+        __tocin_parallel_chunks(static_cast<int64_t>(blocks), fn, ctx);
+    else
+        fn(ctx, 0, static_cast<int64_t>(blocks));
+}
+
+double *elementsOf(const int64_t *arr) {
+    return reinterpret_cast<double *>(const_cast<int64_t *>(arr) + 1);
+}
+
+} // namespace
+
+std::vector<const LinalgKernels *> availableLinalgKernels() {
+    std::vector<const LinalgKernels *> tables{&kScalarKernels};
+#ifdef TOCIN_LINALG_SSE2
+    tables.push_back(&kSse2Kernels);
+#endif
+#ifdef TOCIN_LINALG_NEON
+    tables.push_back(&kNeonKernels);
+#endif
+    if (const LinalgKernels *avx2 = avx2LinalgKernels())
+        if (cpuHasAvx2Fma()) tables.push_back(avx2);
+    if (const LinalgKernels *avx512 = avx512LinalgKernels())
+        if (cpuHasAvx512()) tables.push_back(avx512);
+    return tables;
+}
+
+const LinalgKernels &linalgKernels() {
+    static const LinalgKernels *chosen = chooseKernels();
+    return *chosen;
+}
+
+void gemm(const LinalgKernels &k, const double *a, const double *b, double *c, size_t r, size_t m,
+          size_t p, bool transB) {
+    if (r == 0 || p == 0) return;
+    if (m == 0) {
+        std::memset(c, 0, r * p * sizeof(double));
+        return;
+    }
+    size_t strips = (kNc + k.nr - 1) / k.nr;
+    std::vector<double> panel(kKc * strips * k.nr);
+
+    struct Step {
+        const LinalgKernels *k;
+        const double *a;
+        const double *panel;
+        double *c;
+        size_t r, m, p, pc, kc, jc, nc;
+    } step{&k, a, panel.data(), c, r, m, p, 0, 0, 0, 0};
+    auto rows = [](void *ctx, int64_t lo, int64_t hi) {
+        auto *s = static_cast<Step *>(ctx);
+        for (int64_t blk = lo; blk < hi; ++blk) {
+            size_t i = static_cast<size_t>(blk) * kMc;
+            size_t n = s->r - i < kMc ? s->r - i : kMc;
+            s->k->gemmBlock(s->a + i * s->m + s->pc, s->m, s->panel, s->kc,
+                            s->c + i * s->p + s->jc, s->p, n, s->nc, s->pc > 0);
+        }
+    };
+
+    size_t blocks = (r + kMc - 1) / kMc;
+    for (size_t jc = 0; jc < p; jc += kNc) {
+        size_t nc = p - jc < kNc ? p - jc : kNc;
+        for (size_t pc = 0; pc < m; pc += kKc) {
+            size_t kc = m - pc < kKc ? m - pc : kKc;
+            if (transB)
+                packPanelTransposed(b + jc * m + pc, m, kc, nc, k.nr, panel.data());
+            else
+                packPanel(b + pc * p + jc, p, kc, nc, k.nr, panel.data());
+            step.pc = pc;
+            step.kc = kc;
+            step.jc = jc;
+            step.nc = nc;
+            forBlocks(blocks, r * kc * nc, rows, &step);
+        }
+    }
+}
+
+void gemv(const LinalgKernels &k, const double *a, const double *x, double *y, size_t r, size_t n) {
+    struct Rows {
+        const LinalgKernels *k;
+        const double *a, *x;
+        double *y;
+        size_t r, n;
+    } rows{&k, a, x, y, r, n};
+    auto run = [](void *ctx, int64_t lo, int64_t hi) {
+        auto *s = static_cast<Rows *>(ctx);
+        size_t end = static_cast<size_t>(hi) * kMc < s->r ? static_cast<size_t>(hi) * kMc : s->r;
+        for (size_t i = static_cast<size_t>(lo) * kMc; i < end; ++i)
+            s->y[i] = s->k->dot(s->a + i * s->n, s->x, s->n);
+    };
+    forBlocks((r + kMc - 1) / kMc, r * n, run, &rows);
+}
+
+} // namespace runtime
+} // namespace tocin
+
+extern "C" {
+
+/**
+ * gemmF64(a, b, dst, r, m, p[, aOff, bOff, dstOff]): dst(r x p) = a(r x m) *
+ * b(m x p) over Tocin lists of floats, row-major, each matrix starting at
+ * its offset. Panics like an index out of range if a list is too short; dst
+ * must not overlap the part of a or b that is read.
+ */
+int64_t __tocin_gemm_f64(const int64_t *a, const int64_t *b, int64_t *dst, int64_t r, int64_t m,
+                         int64_t p, int64_t aOff, int64_t bOff, int64_t dstOff) {
+    if (r <= 0 || m < 0 || p <= 0) return 0;
+    requireRange(a, aOff, r * m);
+    requireRange(b, bOff, m * p);
+    requireRange(dst, dstOff, r * p);
+    tocin::runtime::gemm(tocin::runtime::linalgKernels(), tocin::runtime::elementsOf(a) + aOff,
+                         tocin::runtime::elementsOf(b) + bOff, tocin::runtime::elementsOf(dst) + dstOff,
+                         static_cast<size_t>(r), static_cast<size_t>(m), static_cast<size_t>(p));
+    return 0;
+}
+
+/**
+ * gemmF64NT(a, b, dst, r, m, p[, aOff, bOff, dstOff]): dst(r x p) = a(r x m) *
+ * b^T, with b stored p x m. A batch of input rows times a layer's out x in
+ * weights, without transposing the weights first.
+ */
+int64_t __tocin_gemm_f64_nt(const int64_t *a, const int64_t *b, int64_t *dst, int64_t r, int64_t m,
+                            int64_t p, int64_t aOff, int64_t bOff, int64_t dstOff) {
+    if (r <= 0 || m < 0 || p <= 0) return 0;
+    requireRange(a, aOff, r * m);
+    requireRange(b, bOff, p * m);
+    requireRange(dst, dstOff, r * p);
+    tocin::runtime::gemm(tocin::runtime::linalgKernels(), tocin::runtime::elementsOf(a) + aOff,
+                         tocin::runtime::elementsOf(b) + bOff, tocin::runtime::elementsOf(dst) + dstOff,
+                         static_cast<size_t>(r), static_cast<size_t>(m), static_cast<size_t>(p), true);
+    return 0;
+}
+
+/**
+ * gemvF64(a, x, y, r, c[, xOff, yOff]): y[yOff + i] = sum_j a[i*c + j] * x[xOff + j]
+ * for i < r. y must not overlap the part of a or x that is read.
+ */
+int64_t __tocin_gemv_f64(const int64_t *a, const int64_t *x, int64_t *y, int64_t r, int64_t c,
+                         int64_t xOff, int64_t yOff) {
+    if (r <= 0) return 0;
+    if (c < 0) c = 0;
+    requireRange(a, 0, r * c);
+    requireRange(x, xOff, c);
+    requireRange(y, yOff, r);
+    tocin::runtime::gemv(tocin::runtime::linalgKernels(), tocin::runtime::elementsOf(a),
+                         tocin::runtime::elementsOf(x) + xOff, tocin::runtime::elementsOf(y) + yOff,
+                         static_cast<size_t>(r), static_cast<size_t>(c));
+    return 0;
+}
+
+} // extern "C"
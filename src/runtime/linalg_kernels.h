@@ -0,0 +1,66 @@
+#ifndef TOCIN_LINALG_KERNELS_H
+#define TOCIN_LINALG_KERNELS_H
+
+/**
+ * Dense float64 matrix kernels behind the gemmF64/gemmF64NT/gemvF64
+ * builtins (__tocin_gemm_f64, __tocin_gemm_f64_nt and __tocin_gemv_f64 in
+ * linalg_kernels.cpp).
+ *
+ * gemm() follows the usual blocked layout: B is packed a panel of kKc rows
+ * by kNc columns at a time into strips `nr` columns wide, and the table's
+ * micro-kernel keeps a block of C rows by one strip in registers while it
+ * walks the panel's depth. Row blocks of each panel run in parallel on the
+ * parallel_for pool once there is enough work. A transposed B (a layer's
+ * out x in weights times a batch of inputs) only changes how panels are
+ * packed, so it runs on the same micro-kernels.
+ *
+ * As with the string kernels, every instruction set gets one table and
+ * linalgKernels() picks the best one the CPU supports (AVX-512, then
+ * AVX2 + FMA, then SSE2 on x86-64 or NEON on AArch64, otherwise scalar).
+ * TOCIN_LINALG_KERNELS forces a table by name.
+ */
+
+#include <cstddef>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+struct LinalgKernels {
+    const char *name;
+    // Width of one packed strip of B.
+    size_t nr;
+    // c[i, j] (+)= sum_k a[i, k] * bp[k, j] for i < rows, j < cols, where a
+    // and c are row-major with leading dimensions lda and ldc and bp is kc
+    // rows of B packed into ceil(cols / nr) strips of kc * nr (zero-padded).
+    // Adds to c when `accumulate`, overwrites it otherwise.
+    void (*gemmBlock)(const double *a, size_t lda, const double *bp, size_t kc, double *c,
+                      size_t ldc, size_t rows, size_t cols, bool accumulate);
+    // sum_i a[i] * b[i], summed in vector lanes.
+    double (*dot)(const double *a, const double *b, size_t n);
+};
+
+// The table the runtime uses.
+const LinalgKernels &linalgKernels();
+
+// Every table this CPU can run, portable one first.
+std::vector<const LinalgKernels *> availableLinalgKernels();
+
+// Defined in linalg_kernels_avx2.cpp and linalg_kernels_avx512.cpp, the only
+// files built for those instruction sets; nullptr when the compiler cannot
+// target them.
+const LinalgKernels *avx2LinalgKernels();
+const LinalgKernels *avx512LinalgKernels();
+
+// c(r x p) = a(r x m) * b(m x p), all row-major; c must not overlap a or b.
+// With transB, b is stored p x m and c = a * b^T.
+void gemm(const LinalgKernels &k, const double *a, const double *b, double *c, size_t r, size_t m,
+          size_t p, bool transB = false);
+
+// y(r) = a(r x n) * x(n); y must not overlap a or x.
+void gemv(const LinalgKernels &k, const double *a, const double *x, double *y, size_t r, size_t n);
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_LINALG_KERNELS_H
@@ -0,0 +1,44 @@
+// The AVX2 + FMA matrix kernels. This is the only runtime file built with
+// -mavx2 -mfma (see CMakeLists.txt); linalgKernels() calls into it only
+// after checking the CPU.
+#include "linalg_kernels_impl.h"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#if defined(__AVX2__) && defined(__FMA__)
+namespace {
+
+struct Avx2 {
+    using Vec = __m256d;
+    static constexpr size_t kWidth = 4;
+    // 6 x 2 accumulators, two strip loads and a broadcast: 15 of 16 registers.
+    static constexpr size_t kRows = 6;
+
+    static Vec zero() { return _mm256_setzero_pd(); }
+    static Vec splat(double x) { return _mm256_set1_pd(x); }
+    static Vec load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, Vec v) { _mm256_storeu_pd(p, v); }
+    static Vec fma(Vec a, Vec b, Vec acc) { return _mm256_fmadd_pd(a, b, acc); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static double sum(Vec v) {
+        __m128d lo = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+    }
+};
+
+constexpr LinalgKernels kAvx2Kernels = linalgTable<Avx2>("avx2");
+
+} // namespace
+
+const LinalgKernels *avx2LinalgKernels() { return &kAvx2Kernels; }
+#else
+const LinalgKernels *avx2LinalgKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,41 @@
+// The AVX-512 matrix kernels. This is the only runtime file built with
+// -mavx512f (see CMakeLists.txt); linalgKernels() calls into it only after
+// checking the CPU.
+#include "linalg_kernels_impl.h"
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#ifdef __AVX512F__
+namespace {
+
+struct Avx512 {
+    using Vec = __m512d;
+    static constexpr size_t kWidth = 8;
+    // 8 x 2 accumulators, two strip loads and a broadcast: 19 of 32 registers.
+    static constexpr size_t kRows = 8;
+
+    static Vec zero() { return _mm512_setzero_pd(); }
+    static Vec splat(double x) { return _mm512_set1_pd(x); }
+    static Vec load(const double *p) { return _mm512_loadu_pd(p); }
+    static void store(double *p, Vec v) { _mm512_storeu_pd(p, v); }
+    static Vec fma(Vec a, Vec b, Vec acc) { return _mm512_fmadd_pd(a, b, acc); }
+    static Vec add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+    static double sum(Vec v) { return _mm512_reduce_add_pd(v); }
+};
+
+constexpr LinalgKernels kAvx512Kernels = linalgTable<Avx512>("avx512");
+
+} // namespace
+
+const LinalgKernels *avx512LinalgKernels() { return &kAvx512Kernels; }
+#else
+const LinalgKernels *avx512LinalgKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
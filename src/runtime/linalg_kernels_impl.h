@@ -0,0 +1,133 @@
+#ifndef TOCIN_LINALG_KERNELS_IMPL_H
+#define TOCIN_LINALG_KERNELS_IMPL_H
+
+// Kernel bodies shared by every instruction set, written against a small
+// vector interface:
+//
+//   Vec                      kWidth doubles
+//   kRows                    rows of C one micro-kernel call keeps in registers
+//   zero() splat(x)          all lanes 0 / x
+//   load(p) store(p, v)      unaligned kWidth doubles at p
+//   fma(a, b, acc)           acc + a * b
+//   add(a, b) sum(v)         lane-wise sum / sum of the lanes
+//
+// A micro-kernel tile is kRows rows by two vectors of C, so the packed
+// strips of B are 2 * kWidth wide. Like string_kernels_impl.h this is only
+// included by the kernel files, everything has internal linkage and no
+// standard library template is instantiated, so code built for a wider
+// instruction set never ends up shared with the baseline file.
+
+#include "linalg_kernels.h"
+
+#include <cstddef>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TOCIN_LINALG_KERNEL __attribute__((always_inline)) inline
+#else
+#define TOCIN_LINALG_KERNEL inline
+#endif
+
+namespace tocin {
+namespace runtime {
+namespace {
+
+template <class V> using LVec = typename V::Vec;
+
+// Rows [0, R) of C by one strip: the accumulators live in registers for the
+// whole depth of the panel. A strip narrower than nr (the last one) goes
+// through a scratch tile so only its real columns are written.
+template <class V, size_t R>
+TOCIN_LINALG_KERNEL void tile(const double *a, size_t lda, const double *strip, size_t kc,
+                              double *c, size_t ldc, size_t cols, bool accumulate) {
+    constexpr size_t W = V::kWidth;
+    constexpr size_t NR = 2 * W;
+    LVec<V> acc0[R], acc1[R];
+    for (size_t i = 0; i < R; ++i) {
+        acc0[i] = V::zero();
+        acc1[i] = V::zero();
+    }
+    for (size_t k = 0; k < kc; ++k) {
+        LVec<V> b0 = V::load(strip + k * NR);
+        LVec<V> b1 = V::load(strip + k * NR + W);
+        for (size_t i = 0; i < R; ++i) {
+            LVec<V> ai = V::splat(a[i * lda + k]);
+            acc0[i] = V::fma(ai, b0, acc0[i]);
+            acc1[i] = V::fma(ai, b1, acc1[i]);
+        }
+    }
+    if (cols == NR) {
+        for (size_t i = 0; i < R; ++i) {
+            double *row = c + i * ldc;
+            if (accumulate) {
+                acc0[i] = V::add(acc0[i], V::load(row));
+                acc1[i] = V::add(acc1[i], V::load(row + W));
+            }
+            V::store(row, acc0[i]);
+            V::store(row + W, acc1[i]);
+        }
+        return;
+    }
+    double part[NR];
+    for (size_t i = 0; i < R; ++i) {
+        V::store(part, acc0[i]);
+        V::store(part + W, acc1[i]);
+        double *row = c + i * ldc;
+        for (size_t j = 0; j < cols; ++j) row[j] = accumulate ? row[j] + part[j] : part[j];
+    }
+}
+
+// The rows - i < kRows left below the last full tile.
+template <class V, size_t R>
+TOCIN_LINALG_KERNEL void tailRows(size_t left, const double *a, size_t lda, const double *strip,
+                                  size_t kc, double *c, size_t ldc, size_t cols, bool accumulate) {
+    if constexpr (R > 0) {
+        if (left == R)
+            tile<V, R>(a, lda, strip, kc, c, ldc, cols, accumulate);
+        else
+            tailRows<V, R - 1>(left, a, lda, strip, kc, c, ldc, cols, accumulate);
+    }
+}
+
+template <class V>
+void gemmBlockOf(const double *a, size_t lda, const double *bp, size_t kc, double *c, size_t ldc,
+                 size_t rows, size_t cols, bool accumulate) {
+    constexpr size_t NR = 2 * V::kWidth;
+    constexpr size_t MR = V::kRows;
+    for (size_t j = 0; j < cols; j += NR) {
+        const double *strip = bp + (j / NR) * kc * NR;
+        size_t width = cols - j < NR ? cols - j : NR;
+        size_t i = 0;
+        for (; i + MR <= rows; i += MR)
+            tile<V, MR>(a + i * lda, lda, strip, kc, c + i * ldc + j, ldc, width, accumulate);
+        if (i < rows)
+            tailRows<V, MR - 1>(rows - i, a + i * lda, lda, strip, kc, c + i * ldc + j, ldc, width,
+                                accumulate);
+    }
+}
+
+// Four independent accumulators hide the add latency.
+template <class V> double dotOf(const double *a, const double *b, size_t n) {
+    constexpr size_t W = V::kWidth;
+    LVec<V> s0 = V::zero(), s1 = V::zero(), s2 = V::zero(), s3 = V::zero();
+    size_t i = 0;
+    for (; i + 4 * W <= n; i += 4 * W) {
+        s0 = V::fma(V::load(a + i), V::load(b + i), s0);
+        s1 = V::fma(V::load(a + i + W), V::load(b + i + W), s1);
+        s2 = V::fma(V::load(a + i + 2 * W), V::load(b + i + 2 * W), s2);
+        s3 = V::fma(V::load(a + i + 3 * W), V::load(b + i + 3 * W), s3);
+    }
+    for (; i + W <= n; i += W) s0 = V::fma(V::load(a + i), V::load(b + i), s0);
+    double s = V::sum(V::add(V::add(s0, s1), V::add(s2, s3)));
+    for (; i < n; ++i) s += a[i] * b[i];
+    return s;
+}
+
+template <class V> constexpr LinalgKernels linalgTable(const char *name) {
+    return LinalgKernels{name, 2 * V::kWidth, &gemmBlockOf<V>, &dotOf<V>};
+}
+
+} // namespace
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_LINALG_KERNELS_IMPL_H
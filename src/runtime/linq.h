@@ -2,6 +2,8 @@
 #define TOCIN_LINQ_H
 
 #include <vector>
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -10,6 +12,15 @@
 #include <algorithm>
 #include <numeric>
 #include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+
+// The parallel_for worker pool (src/runtime/parallel_runtime.cpp).
+extern "C" {
+void __tocin_parallel_slot_chunks(int64_t count, void (*fn)(void*, int64_t, int64_t, int64_t), void* ctx);
+int64_t __tocin_parallel_threads();
+}
 
 namespace runtime {
 
@@ -197,21 +208,338 @@ public:
     bool isTake() const { return is_take; }
 };
 
+/**
+ * @brief Distinct/Reverse query node (operators without arguments)
+ */
+class OperatorNode : public QueryNode {
+private:
+    QueryOperator op;
+    std::string name;
+
+public:
+    OperatorNode(QueryOperator o, const std::string& n) : op(o), name(n) {}
+
+    QueryOperator getOperator() const override { return op; }
+    std::string toString() const override { return name + "()"; }
+};
+
+/**
+ * @brief One group of a groupBy: the key and its elements, in source order
+ */
+template<typename K, typename T>
+struct Grouping {
+    K key{};
+    std::vector<T> items;
+};
+
 /**
  * @brief Queryable collection with LINQ support
+ *
+ * Operators are recorded, not run: a query is its source plus a list of
+ * stages, and copying a Queryable to add a stage shares the source instead
+ * of copying it. Results are pulled through a Cursor one element at a time,
+ * each element passing through every stage before the next is read, so
+ * where/select/skip/take/distinct run as one loop with no intermediate
+ * vectors. A take that is used up ends the pull (first(), any() and take(n)
+ * read only as far as they need), and only orderBy/reverse, which need the
+ * whole input, collect what reaches them before the rest of the query runs.
+ *
+ * asParallel() spreads a query over the parallel_for worker pool. The
+ * leading run of where/select stages, which look at one element at a time,
+ * runs on each part of the source, and the parts' results are merged: in
+ * source order by default, or as the workers finish after asUnordered().
+ * Reductions (sum, count, min, max, average, any) merge per-part partial
+ * results instead, and any stops every part once one has found a match. The
+ * stages after the first skip/take/distinct/orderBy/reverse need the whole
+ * sequence, so they run on the calling thread over the merged results.
+ * groupBy and join are hash operators; under asParallel() the groups are
+ * built per part and merged, and the join's table is split into one
+ * partition per worker, built in parallel and probed by the parts.
+ *
+ * where/select/orderBy taking a std::string record the expression for
+ * getQueryNodes() but do nothing when executed; there is no evaluator for
+ * them. The overloads taking a callable run it.
  */
 template<typename T>
 class Queryable {
+public:
+    using Predicate = std::function<bool(const T&)>;
+    using Transform = std::function<T(const T&)>;
+    using Less = std::function<bool(const T&, const T&)>;
+
 private:
-    std::vector<T> data;
+    struct Stage {
+        enum class Kind { Where, Select, Skip, Take, Distinct, Reverse, OrderBy };
+
+        Kind kind;
+        size_t count = 0;   // Skip, Take
+        Predicate pred;     // Where
+        Transform map;      // Select
+        Less less;          // OrderBy
+        // Distinct: makes the stage's filter for one run, since it has to
+        // remember what that run has already seen.
+        std::function<Predicate()> fresh;
+
+        explicit Stage(Kind k) : kind(k) {}
+        bool isBarrier() const { return kind == Kind::Reverse || kind == Kind::OrderBy; }
+    };
+
+    template<typename>
+    friend class Queryable;
+
+    // Parts per worker for an ordered parallel query, and the smallest part
+    // worth handing to the pool.
+    static constexpr size_t kPartsPerThread = 8;
+    static constexpr size_t kMinPartSize = 2048;
+
+    std::shared_ptr<const std::vector<T>> data;
     std::vector<std::shared_ptr<QueryNode>> query_nodes;
+    std::vector<Stage> stages;
+    bool parallel = false;
+    bool ordered = true;
+
+    static std::shared_ptr<const std::vector<T>> emptySource() {
+        static const auto none = std::make_shared<const std::vector<T>>();
+        return none;
+    }
+
+    Queryable<T> with(std::shared_ptr<QueryNode> node, Stage stage) const {
+        Queryable<T> result = *this;
+        result.addQueryNode(std::move(node));
+        result.stages.push_back(std::move(stage));
+        return result;
+    }
 
 public:
-    Queryable() = default;
+    /**
+     * @brief Pull iterator over a query's results
+     *
+     * next() reads source elements until one passes every stage. If the
+     * query has an orderBy or reverse, the constructor runs everything up to
+     * the last one into a buffer, which then becomes the source of the
+     * stages after it. The query must outlive its cursors.
+     */
+    class Cursor {
+    public:
+        explicit Cursor(const Queryable<T>& query) : Cursor(query, query.stages.size()) {}
+
+        bool next(T& out) {
+            const std::vector<T>& items = buffered ? buffer : *source;
+            const size_t stop = std::min(limit, items.size());
+            while (!done && pos < stop) {
+                T item = items[pos++];
+                if (pass(item)) {
+                    out = std::move(item);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        friend class Queryable<T>;
+
+        // Source elements [lo, hi) through the query's first end stages,
+        // which must not include an orderBy or reverse.
+        Cursor(const Queryable<T>& query, size_t end, size_t lo, size_t hi) : Cursor(query, end) {
+            pos = lo;
+            limit = hi;
+        }
+
+        // The query's first end stages.
+        Cursor(const Queryable<T>& query, size_t end) : stages(&query.stages), source(query.data.get()) {
+            size_t barrier = end;
+            for (size_t i = end; i-- > 0;) {
+                if ((*stages)[i].isBarrier()) { barrier = i; break; }
+            }
+            if (barrier < end) {
+                Cursor upstream(query, barrier);
+                T item;
+                while (upstream.next(item)) buffer.push_back(std::move(item));
+                const Stage& stage = (*stages)[barrier];
+                if (stage.kind == Stage::Kind::Reverse)
+                    std::reverse(buffer.begin(), buffer.end());
+                else
+                    std::stable_sort(buffer.begin(), buffer.end(), stage.less);
+                buffered = true;
+                first = barrier + 1;
+            }
+            last = end;
+            remaining.assign(last, 0);
+            filters.resize(last);
+            for (size_t i = first; i < last; ++i) {
+                const Stage& stage = (*stages)[i];
+                remaining[i] = stage.count;
+                if (stage.kind == Stage::Kind::Take && stage.count == 0) done = true;
+                if (stage.kind == Stage::Kind::Distinct) filters[i] = stage.fresh();
+            }
+        }
+
+        bool pass(T& item) {
+            for (size_t i = first; i < last; ++i) {
+                const Stage& stage = (*stages)[i];
+                switch (stage.kind) {
+                    case Stage::Kind::Where:
+                        if (!stage.pred(item)) return false;
+                        break;
+                    case Stage::Kind::Select:
+                        item = stage.map(item);
+                        break;
+                    case Stage::Kind::Skip:
+                        if (remaining[i] > 0) { --remaining[i]; return false; }
+                        break;
+                    case Stage::Kind::Take:
+                        // Nothing gets past a used-up take, so stop reading
+                        // the source, even if a later stage drops this item.
+                        if (--remaining[i] == 0) done = true;
+                        break;
+                    case Stage::Kind::Distinct:
+                        if (!filters[i](item)) return false;
+                        break;
+                    case Stage::Kind::Reverse:
+                    case Stage::Kind::OrderBy:
+                        break; // handled by the constructor
+                }
+            }
+            return true;
+        }
+
+        const std::vector<Stage>* stages;
+        const std::vector<T>* source;
+        std::vector<T> buffer;
+        std::vector<size_t> remaining;
+        std::vector<Predicate> filters;
+        size_t first = 0;
+        size_t last = 0;
+        size_t pos = 0;
+        size_t limit = SIZE_MAX;
+        bool buffered = false;
+        bool done = false;
+    };
+
+private:
+    // The leading where/select stages, which a parallel query runs per part.
+    size_t parallelPrefix() const {
+        size_t n = 0;
+        while (n < stages.size() &&
+               (stages[n].kind == Stage::Kind::Where || stages[n].kind == Stage::Kind::Select))
+            ++n;
+        return n;
+    }
+
+    size_t partitionCount() const {
+        size_t threads = static_cast<size_t>(__tocin_parallel_threads());
+        size_t bySize = data->size() / kMinPartSize;
+        return std::max<size_t>(1, std::min(threads * kPartsPerThread, bySize));
+    }
+
+    // Calls f(slot, lo, hi) over ranges covering [0, count), on the pool if
+    // parallel; slot identifies the worker, below __tocin_parallel_threads().
+    template<typename F>
+    static void forRanges(size_t count, bool parallel, F& f) {
+        if (count == 0) return;
+        if (!parallel) {
+            f(size_t{0}, size_t{0}, count);
+            return;
+        }
+        __tocin_parallel_slot_chunks(static_cast<int64_t>(count), [](void* ctx, int64_t slot, int64_t lo, int64_t hi) {
+            (*static_cast<F*>(ctx))(static_cast<size_t>(slot), static_cast<size_t>(lo), static_cast<size_t>(hi));
+        }, &f);
+    }
+
+    // Calls visit(slot, part, cursor) with cursors over the source through
+    // the first end stages. Ordered runs cut it into `parts` fixed parts, so
+    // the caller can keep their results apart and merge them in order;
+    // unordered runs take ranges as the pool balances them, and part is 0.
+    template<typename Visit>
+    void runPartitions(size_t end, size_t parts, bool inOrder, Visit& visit) const {
+        const size_t n = data->size();
+        auto range = [&](size_t slot, size_t lo, size_t hi) {
+            if (!inOrder) {
+                Cursor c(*this, end, lo, hi);
+                visit(slot, size_t{0}, c);
+                return;
+            }
+            for (size_t part = lo; part < hi; ++part) {
+                Cursor c(*this, end, n * part / parts, n * (part + 1) / parts);
+                visit(slot, part, c);
+            }
+        };
+        forRanges(inOrder ? parts : n, true, range);
+    }
+
+    // The results of the first end stages, run on the pool and merged.
+    std::vector<T> collectParallel(size_t end) const {
+        std::vector<std::vector<T>> pieces(ordered ? partitionCount()
+                                                   : static_cast<size_t>(__tocin_parallel_threads()));
+        auto visit = [&](size_t slot, size_t part, Cursor& c) {
+            std::vector<T>& out = pieces[ordered ? part : slot];
+            T item;
+            while (c.next(item)) out.push_back(std::move(item));
+        };
+        runPartitions(end, pieces.size(), ordered, visit);
+        size_t total = 0;
+        for (const auto& piece : pieces) total += piece.size();
+        std::vector<T> result;
+        result.reserve(total);
+        for (auto& piece : pieces)
+            std::move(piece.begin(), piece.end(), std::back_inserter(result));
+        return result;
+    }
+
+    // A parallel query whose later stages need the whole sequence, as a
+    // sequential query over the merged results of its parallel prefix.
+    Queryable<T> remainder() const {
+        size_t prefix = parallelPrefix();
+        Queryable<T> rest = *this;
+        rest.parallel = false;
+        if (prefix == 0) return rest;
+        rest.data = std::make_shared<const std::vector<T>>(collectParallel(prefix));
+        rest.stages.erase(rest.stages.begin(), rest.stages.begin() + prefix);
+        return rest;
+    }
+
+    // Folds the results into init: step(acc, item) takes one in and returns
+    // false once the answer is known. In parallel each part folds its own
+    // copy of init (so it must be an identity of merge) and the partial
+    // results are merged in part order.
+    template<typename Acc, typename Step, typename Merge>
+    Acc fold(Acc init, Step step, Merge merge) const {
+        if (parallel && parallelPrefix() < stages.size()) return remainder().fold(init, step, merge);
+        if (!parallel) {
+            Acc acc = init;
+            T item;
+            Cursor c(*this);
+            while (c.next(item))
+                if (!step(acc, item)) break;
+            return acc;
+        }
+        struct Partial { Acc acc; }; // not vector<bool>'s packed bits
+        std::vector<Partial> partial(ordered ? partitionCount() : static_cast<size_t>(__tocin_parallel_threads()),
+                                     Partial{init});
+        std::atomic<bool> known{false};
+        auto visit = [&](size_t slot, size_t part, Cursor& c) {
+            Acc& acc = partial[ordered ? part : slot].acc;
+            T item;
+            while (!known.load(std::memory_order_relaxed) && c.next(item)) {
+                if (!step(acc, item)) {
+                    known.store(true, std::memory_order_relaxed);
+                    break;
+                }
+            }
+        };
+        runPartitions(stages.size(), partial.size(), ordered, visit);
+        Acc result = init;
+        for (const Partial& p : partial) result = merge(result, p.acc);
+        return result;
+    }
+
+public:
+    Queryable() : data(emptySource()) {}
     
-    explicit Queryable(const std::vector<T>& items) : data(items) {}
+    explicit Queryable(const std::vector<T>& items) : data(std::make_shared<const std::vector<T>>(items)) {}
     
-    explicit Queryable(std::vector<T>&& items) : data(std::move(items)) {}
+    explicit Queryable(std::vector<T>&& items) : data(std::make_shared<const std::vector<T>>(std::move(items))) {}
 
     /**
      * @brief Add a query node
@@ -223,74 +551,64 @@ public:
     /**
      * @brief Get the underlying data
      */
-    const std::vector<T>& getData() const { return data; }
+    const std::vector<T>& getData() const { return *data; }
 
     /**
      * @brief Get query nodes
      */
     const std::vector<std::shared_ptr<QueryNode>>& getQueryNodes() const { return query_nodes; }
 
+    /**
+     * @brief Start pulling the query's results
+     */
+    Cursor cursor() const { return Cursor(*this); }
+
     /**
      * @brief Execute the query and return results
      */
     std::vector<T> execute() const {
-        std::vector<T> result = data;
-        
-        for (const auto& node : query_nodes) {
-            switch (node->getOperator()) {
-                case QueryOperator::WHERE: {
-                    auto where_node = std::dynamic_pointer_cast<WhereNode>(node);
-                    if (where_node) {
-                        result = applyWhere(result, where_node->getPredicate());
-                    }
-                    break;
-                }
-                case QueryOperator::SELECT: {
-                    auto select_node = std::dynamic_pointer_cast<SelectNode>(node);
-                    if (select_node) {
-                        result = applySelect(result, select_node->getSelector());
-                    }
-                    break;
-                }
-                case QueryOperator::ORDER_BY:
-                case QueryOperator::ORDER_BY_DESCENDING: {
-                    auto order_node = std::dynamic_pointer_cast<OrderByNode>(node);
-                    if (order_node) {
-                        result = applyOrderBy(result, order_node->getKeySelector(), order_node->isDescending());
-                    }
-                    break;
-                }
-                case QueryOperator::TAKE: {
-                    auto take_node = std::dynamic_pointer_cast<TakeSkipNode>(node);
-                    if (take_node && take_node->isTake()) {
-                        result = applyTake(result, take_node->getCount());
-                    }
-                    break;
-                }
-                case QueryOperator::SKIP: {
-                    auto skip_node = std::dynamic_pointer_cast<TakeSkipNode>(node);
-                    if (skip_node && !skip_node->isTake()) {
-                        result = applySkip(result, skip_node->getCount());
-                    }
-                    break;
-                }
-                case QueryOperator::DISTINCT: {
-                    result = applyDistinct(result);
-                    break;
-                }
-                case QueryOperator::REVERSE: {
-                    result = applyReverse(result);
-                    break;
-                }
-                default:
-                    // Other operators would be implemented here
-                    break;
-            }
+        std::vector<T> result;
+        if (stages.empty()) return *data;
+        if (parallel) {
+            if (parallelPrefix() == stages.size()) return collectParallel(stages.size());
+            return remainder().execute();
         }
-        
+        Cursor c(*this);
+        T item;
+        while (c.next(item)) result.push_back(std::move(item));
         return result;
     }
 
+    /**
+     * @brief Parallel execution
+     */
+    Queryable<T> asParallel() const {
+        Queryable<T> result = *this;
+        result.parallel = true;
+        return result;
+    }
+
+    Queryable<T> asSequential() const {
+        Queryable<T> result = *this;
+        result.parallel = false;
+        return result;
+    }
+
+    // Merge parallel results in source order (the default) or as they come.
+    Queryable<T> asOrdered() const {
+        Queryable<T> result = *this;
+        result.ordered = true;
+        return result;
+    }
+
+    Queryable<T> asUnordered() const {
+        Queryable<T> result = *this;
+        result.ordered = false;
+        return result;
+    }
+
+    bool isParallel() const { return parallel; }
+
     /**
      * @brief LINQ methods
      */
@@ -300,6 +618,12 @@ public:
         return result;
     }
 
+    Queryable<T> where(Predicate predicate) const {
+        Stage stage{Stage::Kind::Where};
+        stage.pred = std::move(predicate);
+        return with(std::make_shared<WhereNode>("<function>"), std::move(stage));
+    }
+
     template<typename U>
     Queryable<U> select(const std::string& selector) const {
         Queryable<U> result;
@@ -307,6 +631,23 @@ public:
         return result;
     }
 
+    // A selector returning T is fused into the pipeline; one returning
+    // another type runs the query so far to produce the new source.
+    template<typename F, typename U = std::decay_t<std::invoke_result_t<F&, const T&>>>
+    Queryable<U> select(F selector) const {
+        if constexpr (std::is_same_v<U, T>) {
+            Stage stage{Stage::Kind::Select};
+            stage.map = std::move(selector);
+            return with(std::make_shared<SelectNode>("<function>"), std::move(stage));
+        } else {
+            std::vector<U> mapped;
+            Cursor c(*this);
+            T item;
+            while (c.next(item)) mapped.push_back(selector(item));
+            return Queryable<U>(std::move(mapped));
+        }
+    }
+
     Queryable<T> orderBy(const std::string& key_selector) const {
         Queryable<T> result = *this;
         result.addQueryNode(std::make_shared<OrderByNode>(key_selector, false));
@@ -319,172 +660,258 @@ public:
         return result;
     }
 
+    // Stable, like LINQ's OrderBy.
+    template<typename F, typename = std::enable_if_t<std::is_invocable_v<F&, const T&>>>
+    Queryable<T> orderBy(F key_selector) const {
+        Stage stage{Stage::Kind::OrderBy};
+        stage.less = [key_selector](const T& a, const T& b) { return key_selector(a) < key_selector(b); };
+        return with(std::make_shared<OrderByNode>("<function>", false), std::move(stage));
+    }
+
+    template<typename F, typename = std::enable_if_t<std::is_invocable_v<F&, const T&>>>
+    Queryable<T> orderByDescending(F key_selector) const {
+        Stage stage{Stage::Kind::OrderBy};
+        stage.less = [key_selector](const T& a, const T& b) { return key_selector(b) < key_selector(a); };
+        return with(std::make_shared<OrderByNode>("<function>", true), std::move(stage));
+    }
+
     Queryable<T> take(int count) const {
-        Queryable<T> result = *this;
-        result.addQueryNode(std::make_shared<TakeSkipNode>(count, true));
-        return result;
+        Stage stage{Stage::Kind::Take};
+        stage.count = count > 0 ? static_cast<size_t>(count) : 0;
+        return with(std::make_shared<TakeSkipNode>(count, true), std::move(stage));
     }
 
     Queryable<T> skip(int count) const {
-        Queryable<T> result = *this;
-        result.addQueryNode(std::make_shared<TakeSkipNode>(count, false));
-        return result;
+        Stage stage{Stage::Kind::Skip};
+        stage.count = count > 0 ? static_cast<size_t>(count) : 0;
+        return with(std::make_shared<TakeSkipNode>(count, false), std::move(stage));
     }
 
     Queryable<T> distinct() const {
-        Queryable<T> result = *this;
-        result.addQueryNode(std::make_shared<QueryNode>()); // Placeholder for DISTINCT
-        return result;
+        Stage stage{Stage::Kind::Distinct};
+        stage.fresh = [] {
+            auto seen = std::make_shared<std::unordered_set<T>>();
+            return Predicate([seen](const T& item) { return seen->insert(item).second; });
+        };
+        return with(std::make_shared<OperatorNode>(QueryOperator::DISTINCT, "Distinct"), std::move(stage));
     }
 
     Queryable<T> reverse() const {
-        Queryable<T> result = *this;
-        result.addQueryNode(std::make_shared<QueryNode>()); // Placeholder for REVERSE
+        return with(std::make_shared<OperatorNode>(QueryOperator::REVERSE, "Reverse"),
+                    Stage{Stage::Kind::Reverse});
+    }
+
+    // Groups in order of their keys' first appearance.
+    template<typename F, typename K = std::decay_t<std::invoke_result_t<F&, const T&>>>
+    Queryable<Grouping<K, T>> groupBy(F key_selector) const {
+        using Group = Grouping<K, T>;
+        struct Table {
+            std::unordered_map<K, size_t> index;
+            std::vector<Group> groups;
+
+            std::vector<T>& slot(const K& key) {
+                auto it = index.try_emplace(key, groups.size());
+                if (it.second) groups.push_back(Group{key, {}});
+                return groups[it.first->second].items;
+            }
+        };
+        Table all;
+        if (parallel && parallelPrefix() == stages.size()) {
+            // Each part groups its own elements; merging the parts in order
+            // keeps every group's elements in source order.
+            std::vector<Table> parts(partitionCount());
+            auto visit = [&](size_t, size_t part, Cursor& c) {
+                T item;
+                while (c.next(item)) parts[part].slot(key_selector(item)).push_back(std::move(item));
+            };
+            runPartitions(stages.size(), parts.size(), true, visit);
+            for (Table& part : parts) {
+                for (Group& group : part.groups) {
+                    std::vector<T>& items = all.slot(group.key);
+                    std::move(group.items.begin(), group.items.end(), std::back_inserter(items));
+                }
+            }
+        } else {
+            const Queryable<T> source = parallel ? remainder() : *this;
+            T item;
+            Cursor c(source);
+            while (c.next(item)) all.slot(key_selector(item)).push_back(std::move(item));
+        }
+        Queryable<Group> result(std::move(all.groups));
+        result.parallel = parallel;
+        result.ordered = ordered;
+        result.addQueryNode(std::make_shared<GroupByNode>("<function>"));
+        return result;
+    }
+
+    // Inner equi-join: result_selector(outer, inner) for every pair with
+    // equal keys, in outer order and then inner order.
+    template<typename U, typename FO, typename FI, typename FR,
+             typename K = std::decay_t<std::invoke_result_t<FO&, const T&>>,
+             typename R = std::decay_t<std::invoke_result_t<FR&, const T&, const U&>>>
+    Queryable<R> join(const Queryable<U>& inner, FO outer_key, FI inner_key, FR result_selector) const {
+        // Build: hash the inner side's keys, then fill one table per
+        // partition of the hash space, each from its own share of the keys.
+        const std::vector<U> build = inner.execute();
+        const size_t partitions = parallel ? static_cast<size_t>(__tocin_parallel_threads()) : 1;
+        const bool spread = parallel && build.size() >= kMinPartSize;
+        std::vector<K> keys(build.size());
+        std::vector<size_t> hashes(build.size());
+        auto hashKeys = [&](size_t, size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) {
+                keys[i] = inner_key(build[i]);
+                hashes[i] = std::hash<K>{}(keys[i]);
+            }
+        };
+        forRanges(build.size(), spread, hashKeys);
+        std::vector<std::unordered_map<K, std::vector<size_t>>> tables(partitions);
+        auto fill = [&](size_t, size_t lo, size_t hi) {
+            for (size_t t = lo; t < hi; ++t)
+                for (size_t i = 0; i < build.size(); ++i)
+                    if (hashes[i] % partitions == t) tables[t][keys[i]].push_back(i);
+        };
+        forRanges(partitions, spread, fill);
+
+        auto probe = [&](Cursor& c, std::vector<R>& out) {
+            T item;
+            while (c.next(item)) {
+                K key = outer_key(item);
+                const auto& table = tables[std::hash<K>{}(key) % partitions];
+                auto it = table.find(key);
+                if (it == table.end()) continue;
+                for (size_t i : it->second) out.push_back(result_selector(item, build[i]));
+            }
+        };
+        std::vector<R> joined;
+        if (parallel && parallelPrefix() == stages.size()) {
+            std::vector<std::vector<R>> parts(partitionCount());
+            auto visit = [&](size_t, size_t part, Cursor& c) { probe(c, parts[part]); };
+            runPartitions(stages.size(), parts.size(), true, visit);
+            for (auto& part : parts)
+                std::move(part.begin(), part.end(), std::back_inserter(joined));
+        } else {
+            const Queryable<T> source = parallel ? remainder() : *this;
+            Cursor c(source);
+            probe(c, joined);
+        }
+        Queryable<R> result(std::move(joined));
+        result.parallel = parallel;
+        result.ordered = ordered;
+        result.addQueryNode(std::make_shared<JoinNode>("<query>", "<function>", "<function>", "<function>"));
         return result;
     }
 
     // Aggregation methods
     T first() const {
-        auto result = execute();
-        return result.empty() ? T{} : result.front();
+        T item{};
+        Cursor c(*this);
+        return c.next(item) ? item : T{};
     }
 
     T firstOrDefault() const {
-        auto result = execute();
-        return result.empty() ? T{} : result.front();
+        return first();
+    }
+
+    T first(Predicate predicate) const {
+        return where(std::move(predicate)).first();
     }
 
     T last() const {
-        auto result = execute();
-        return result.empty() ? T{} : result.back();
+        T item{}, result{};
+        Cursor c(*this);
+        while (c.next(item)) result = std::move(item);
+        return result;
     }
 
     T lastOrDefault() const {
-        auto result = execute();
-        return result.empty() ? T{} : result.back();
+        return last();
     }
 
     T single() const {
-        auto result = execute();
-        if (result.size() != 1) {
+        T item{}, extra{};
+        Cursor c(*this);
+        if (!c.next(item) || c.next(extra)) {
             throw std::runtime_error("Sequence contains more than one element");
         }
-        return result.front();
+        return item;
     }
 
     T singleOrDefault() const {
-        auto result = execute();
-        if (result.size() > 1) {
+        T item{}, extra{};
+        Cursor c(*this);
+        if (!c.next(item)) return T{};
+        if (c.next(extra)) {
             throw std::runtime_error("Sequence contains more than one element");
         }
-        return result.empty() ? T{} : result.front();
+        return item;
     }
 
     bool any() const {
-        return !execute().empty();
+        return fold(false, [](bool& found, const T&) { found = true; return false; },
+                    [](bool a, bool b) { return a || b; });
     }
 
     bool any(const std::string& predicate) const {
-        auto result = where(predicate).execute();
-        return !result.empty();
+        return where(predicate).any();
+    }
+
+    bool any(Predicate predicate) const {
+        return where(std::move(predicate)).any();
     }
 
     bool all(const std::string& predicate) const {
-        auto result = where(predicate).execute();
-        return result.size() == execute().size();
+        return where(predicate).count() == count();
+    }
+
+    // Stops at the first element that fails.
+    bool all(Predicate predicate) const {
+        return !where([&predicate](const T& item) { return !predicate(item); }).any();
     }
 
     bool contains(const T& item) const {
-        auto result = execute();
-        return std::find(result.begin(), result.end(), item) != result.end();
+        return where([&item](const T& x) { return x == item; }).any();
     }
 
     int count() const {
-        return static_cast<int>(execute().size());
+        if (stages.empty()) return static_cast<int>(data->size());
+        return fold(0, [](int& n, const T&) { ++n; return true; }, std::plus<int>());
     }
 
     int count(const std::string& predicate) const {
         return where(predicate).count();
     }
 
+    int count(Predicate predicate) const {
+        return where(std::move(predicate)).count();
+    }
+
     // Numeric aggregation methods (for numeric types)
     template<typename U = T>
     typename std::enable_if<std::is_arithmetic<U>::value, U>::type sum() const {
-        auto result = execute();
-        return std::accumulate(result.begin(), result.end(), U{});
+        return fold(U{}, [](U& total, const T& item) { total += item; return true; }, std::plus<U>());
     }
 
     template<typename U = T>
     typename std::enable_if<std::is_arithmetic<U>::value, double>::type average() const {
-        auto result = execute();
-        if (result.empty()) return 0.0;
-        return static_cast<double>(std::accumulate(result.begin(), result.end(), U{})) / result.size();
+        using Acc = std::pair<U, size_t>;
+        Acc acc = fold(Acc{}, [](Acc& a, const T& item) { a.first += item; ++a.second; return true; },
+                       [](const Acc& a, const Acc& b) { return Acc{a.first + b.first, a.second + b.second}; });
+        if (acc.second == 0) return 0.0;
+        return static_cast<double>(acc.first) / acc.second;
     }
 
     template<typename U = T>
     typename std::enable_if<std::is_arithmetic<U>::value, U>::type min() const {
-        auto result = execute();
-        if (result.empty()) return U{};
-        return *std::min_element(result.begin(), result.end());
+        using Acc = std::pair<bool, U>; // (seen any, least so far)
+        auto better = [](const Acc& a, const Acc& b) { return !a.first || (b.first && b.second < a.second) ? b : a; };
+        return fold(Acc{}, [&](Acc& a, const T& item) { a = better(a, Acc{true, item}); return true; }, better).second;
     }
 
     template<typename U = T>
     typename std::enable_if<std::is_arithmetic<U>::value, U>::type max() const {
-        auto result = execute();
-        if (result.empty()) return U{};
-        return *std::max_element(result.begin(), result.end());
-    }
-
-private:
-    // Helper methods for query execution
-    std::vector<T> applyWhere(const std::vector<T>& items, const std::string& predicate) const {
-        // This would be implemented with a predicate evaluator
-        // For now, return the original items
-        return items;
-    }
-
-    template<typename U>
-    std::vector<U> applySelect(const std::vector<T>& items, const std::string& selector) const {
-        // This would be implemented with a selector evaluator
-        // For now, return empty vector
-        return std::vector<U>{};
-    }
-
-    std::vector<T> applyOrderBy(const std::vector<T>& items, const std::string& key_selector, bool descending) const {
-        // This would be implemented with a key selector evaluator
-        // For now, return the original items
-        return items;
-    }
-
-    std::vector<T> applyTake(const std::vector<T>& items, int count) const {
-        std::vector<T> result;
-        result.reserve(std::min(static_cast<size_t>(count), items.size()));
-        std::copy_n(items.begin(), std::min(static_cast<size_t>(count), items.size()), std::back_inserter(result));
-        return result;
-    }
-
-    std::vector<T> applySkip(const std::vector<T>& items, int count) const {
-        if (count >= static_cast<int>(items.size())) {
-            return std::vector<T>{};
-        }
-        return std::vector<T>(items.begin() + count, items.end());
-    }
-
-    std::vector<T> applyDistinct(const std::vector<T>& items) const {
-        std::vector<T> result;
-        std::unordered_set<T> seen;
-        for (const auto& item : items) {
-            if (seen.insert(item).second) {
-                result.push_back(item);
-            }
-        }
-        return result;
-    }
-
-    std::vector<T> applyReverse(const std::vector<T>& items) const {
-        std::vector<T> result = items;
-        std::reverse(result.begin(), result.end());
-        return result;
+        using Acc = std::pair<bool, U>; // (seen any, greatest so far)
+        auto better = [](const Acc& a, const Acc& b) { return !a.first || (b.first && a.second < b.second) ? b : a; };
+        return fold(Acc{}, [&](Acc& a, const T& item) { a = better(a, Acc{true, item}); return true; }, better).second;
     }
 };
 
@@ -499,6 +926,7 @@ private:
 public:
     explicit QueryBuilder(const std::vector<T>& data) : queryable(data) {}
     explicit QueryBuilder(std::vector<T>&& data) : queryable(std::move(data)) {}
+    explicit QueryBuilder(Queryable<T> query) : queryable(std::move(query)) {}
 
     /**
      * @brief Build the query
@@ -515,6 +943,11 @@ public:
         return *this;
     }
 
+    QueryBuilder<T> where(typename Queryable<T>::Predicate predicate) {
+        queryable = queryable.where(std::move(predicate));
+        return *this;
+    }
+
     template<typename U>
     QueryBuilder<U> select(const std::string& selector) {
         return QueryBuilder<U>(queryable.template select<U>(selector));
@@ -602,7 +1035,7 @@ QueryBuilder<T> query(std::vector<T>&& data) {
 /**
  * @brief Range query
  */
-Queryable<int> range(int start, int count) {
+inline Queryable<int> range(int start, int count) {
     std::vector<int> data;
     data.reserve(count);
     for (int i = 0; i < count; ++i) {
@@ -0,0 +1,135 @@
+#ifndef TOCIN_MEMO_TABLE_H
+#define TOCIN_MEMO_TABLE_H
+
+/**
+ * The result cache behind `memoize def` (__tocin_memo_get/put in
+ * concurrency_runtime.cpp): one table per memoized function, keyed on its
+ * argument tuple as 64-bit words.
+ *
+ * The table is a fixed array of small sets (kWays entries each), picked by
+ * the high bits of the tuple's hash, so threads working on different keys
+ * touch different cache lines and never wait on each other. Each entry is
+ * a seqlock: a writer claims it by moving its sequence from even to odd
+ * with a CAS, fills it and publishes it with the next even value; a reader
+ * copies the entry and keeps the copy only if the sequence was even and
+ * unchanged across the copy. Lookups therefore take no lock and write
+ * nothing but the entry's last-use stamp, and a put that finds the entry
+ * it wants busy simply drops its value, which only costs a recomputation.
+ *
+ * Eviction is LRU within a set: the stamp is a table-wide clock that
+ * advances on every put, and a put into a full set replaces the entry used
+ * least recently. Tuples are compared in full, so a hash collision is a
+ * miss, never a wrong result.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace tocin {
+namespace runtime {
+
+class MemoTable {
+public:
+    static constexpr size_t kMaxArgs = 4;
+    static constexpr size_t kWays = 4;
+    static constexpr size_t kSets = 1024;
+
+    // The value stored for args[0, n), if any. n must not exceed kMaxArgs.
+    bool get(const uint64_t *args, size_t n, uint64_t *out) const {
+        uint64_t tag = hash(args, n);
+        const Entry *set = sets_[tag >> kSetShift];
+        for (size_t w = 0; w < kWays; ++w) {
+            const Entry &e = set[w];
+            uint64_t seq = e.seq.load(std::memory_order_acquire);
+            if ((seq & 1) || e.tag.load(std::memory_order_relaxed) != tag)
+                continue;
+            uint64_t copy[kMaxArgs];
+            for (size_t i = 0; i < n; ++i)
+                copy[i] = e.args[i].load(std::memory_order_relaxed);
+            uint64_t value = e.value.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (e.seq.load(std::memory_order_relaxed) != seq || !same(copy, args, n))
+                continue;
+            e.used.store(clock_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            *out = value;
+            return true;
+        }
+        return false;
+    }
+
+    // Store value for args[0, n), replacing the same tuple, an empty entry
+    // or the least recently used one of its set, in that order.
+    void put(const uint64_t *args, size_t n, uint64_t value) {
+        uint64_t tag = hash(args, n);
+        Entry *set = sets_[tag >> kSetShift];
+        Entry *victim = &set[0];
+        for (size_t w = 0; w < kWays; ++w) {
+            Entry &e = set[w];
+            uint64_t t = e.tag.load(std::memory_order_relaxed);
+            if (t == 0) {
+                victim = &e;
+                break;
+            }
+            if (t == tag && same(e.args, args, n)) {
+                victim = &e;
+                break;
+            }
+            if (e.used.load(std::memory_order_relaxed) < victim->used.load(std::memory_order_relaxed))
+                victim = &e;
+        }
+        uint64_t seq = victim->seq.load(std::memory_order_relaxed);
+        if ((seq & 1) || !victim->seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire))
+            return;
+        std::atomic_thread_fence(std::memory_order_release);
+        victim->tag.store(tag, std::memory_order_relaxed);
+        for (size_t i = 0; i < n; ++i)
+            victim->args[i].store(args[i], std::memory_order_relaxed);
+        victim->value.store(value, std::memory_order_relaxed);
+        victim->used.store(clock_.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        victim->seq.store(seq + 2, std::memory_order_release);
+    }
+
+private:
+    static constexpr unsigned kSetShift = 54; // 64 - log2(kSets)
+    static_assert((size_t(1) << (64 - kSetShift)) == kSets, "kSetShift must match kSets");
+
+    struct alignas(64) Entry {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<uint64_t> tag{0};     // the tuple's hash, never 0; 0 if empty
+        std::atomic<uint64_t> args[kMaxArgs] = {};
+        std::atomic<uint64_t> value{0};
+        mutable std::atomic<uint64_t> used{0};
+    };
+
+    // A 64-bit mix of the tuple and its length (the set index comes from
+    // the top bits, so those must be well mixed). The low bit is forced on to
+    // tell a full entry from an empty one.
+    static uint64_t hash(const uint64_t *args, size_t n) {
+        uint64_t h = 0x9e3779b97f4a7c15ull ^ n;
+        for (size_t i = 0; i < n; ++i) {
+            h ^= args[i];
+            h *= 0xbf58476d1ce4e5b9ull;
+            h ^= h >> 31;
+        }
+        h *= 0x94d049bb133111ebull;
+        h ^= h >> 29;
+        return h | 1;
+    }
+
+    template <typename Word>
+    static bool same(const Word *a, const uint64_t *b, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            if ((uint64_t)a[i] != b[i])
+                return false;
+        return true;
+    }
+
+    Entry sets_[kSets][kWays];
+    std::atomic<uint64_t> clock_{0};
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_MEMO_TABLE_H
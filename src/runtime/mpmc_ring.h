@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace tocin {
+namespace runtime {
+
+/**
+ * @brief Fixed-capacity multi-producer/multi-consumer ring
+ *
+ * Vyukov's bounded queue. Position `pos` maps to cell pos % capacity in
+ * turn pos / capacity, and the cell's sequence number says whether it is
+ * free for that turn's push (seq == 2 * turn) or holds its value
+ * (seq == 2 * turn + 1), so push and pop are one CAS on the shared index with
+ * no lock. Counting turns rather than positions keeps the two states apart
+ * even with a single cell, so the bound is exact for any capacity.
+ *
+ * Values are constructed in place and moved out, so T may be move-only. A
+ * push that finds the ring full leaves its argument untouched.
+ *
+ * Backs the runtime's buffered channels (concurrency_runtime.cpp) and the
+ * bounded runtime::Channel<T> in concurrency.h.
+ */
+template <typename T>
+class MpmcRing {
+public:
+    explicit MpmcRing(size_t capacity)
+        : cap_(capacity ? capacity : 1), cells_(new Cell[cap_]) {
+        for (size_t i = 0; i < cap_; ++i) {
+            cells_[i].seq.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpmcRing() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            while (consume([](T&&) {})) {
+            }
+        }
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    // false if full. On success *ticket (when given) is the 1-based position
+    // of the pushed value.
+    template <typename U>
+    bool push(U&& v, uint64_t* ticket = nullptr) {
+        uint64_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells_[pos % cap_];
+            uint64_t turn = 2 * (pos / cap_);
+            uint64_t seq = c.seq.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(seq - turn);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ::new (static_cast<void*>(c.storage)) T(std::forward<U>(v));
+                    c.seq.store(turn + 1, std::memory_order_release);
+                    if (ticket) *ticket = pos + 1;
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // false if empty.
+    bool pop(T* out) {
+        return consume([out](T&& v) { *out = std::move(v); });
+    }
+    std::optional<T> tryPop() {
+        std::optional<T> out;
+        consume([&out](T&& v) { out.emplace(std::move(v)); });
+        return out;
+    }
+
+    // Approximate while other threads are active.
+    bool maybeNonEmpty() const {
+        return tail_.load(std::memory_order_acquire) != head_.load(std::memory_order_acquire);
+    }
+    size_t sizeApprox() const {
+        uint64_t t = tail_.load(std::memory_order_acquire);
+        uint64_t h = head_.load(std::memory_order_acquire);
+        return t > h ? static_cast<size_t>(t - h) : 0;
+    }
+    size_t capacity() const { return cap_; }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // Pop the oldest value into sink(T&&); false if empty.
+    template <typename Sink>
+    bool consume(Sink&& sink) {
+        uint64_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& c = cells_[pos % cap_];
+            uint64_t turn = 2 * (pos / cap_);
+            uint64_t seq = c.seq.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(seq - (turn + 1));
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    T* v = std::launder(reinterpret_cast<T*>(c.storage));
+                    sink(std::move(*v));
+                    v->~T();
+                    c.seq.store(turn + 2, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    const size_t cap_;
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+};
+
+} // namespace runtime
+} // namespace tocin
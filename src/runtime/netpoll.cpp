@@ -0,0 +1,229 @@
+#include "netpoll.h"
+#include "lightweight_scheduler.h"
+
+#include <cerrno>
+#include <cstdint>
+
+#if defined(__linux__)
+#define TOCIN_NETPOLL_EPOLL 1
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+    defined(__OpenBSD__) || defined(__DragonFly__)
+#define TOCIN_NETPOLL_KQUEUE 1
+#include <sys/types.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+    // Events taken from the kernel per poll() call.
+    constexpr int kMaxEvents = 128;
+}
+
+NetPoller::NetPoller() {
+#if defined(TOCIN_NETPOLL_EPOLL)
+    pollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (pollFd_ >= 0 && wakeFd_ >= 0) {
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr; // the wakeup descriptor
+        if (epoll_ctl(pollFd_, EPOLL_CTL_ADD, wakeFd_, &ev) == 0) {
+            return;
+        }
+    }
+#elif defined(TOCIN_NETPOLL_KQUEUE)
+    pollFd_ = kqueue();
+    if (pollFd_ >= 0) {
+        struct kevent ev;
+        EV_SET(&ev, 0, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+        if (kevent(pollFd_, &ev, 1, nullptr, 0, nullptr) == 0) {
+            return;
+        }
+    }
+#endif
+#if defined(TOCIN_NETPOLL_EPOLL) || defined(TOCIN_NETPOLL_KQUEUE)
+    if (pollFd_ >= 0) close(pollFd_);
+    if (wakeFd_ >= 0) close(wakeFd_);
+#endif
+    pollFd_ = wakeFd_ = -1;
+}
+
+NetPoller::~NetPoller() {
+#if defined(TOCIN_NETPOLL_EPOLL) || defined(TOCIN_NETPOLL_KQUEUE)
+    if (pollFd_ >= 0) close(pollFd_);
+    if (wakeFd_ >= 0) close(wakeFd_);
+#endif
+}
+
+bool NetPoller::valid() const {
+    return pollFd_ >= 0;
+}
+
+NetPoller::Desc* NetPoller::descFor(int fd) {
+    std::lock_guard<std::mutex> lock(descsMutex_);
+    if (static_cast<size_t>(fd) >= descs_.size()) {
+        descs_.resize(static_cast<size_t>(fd) + 1);
+    }
+    auto& slot = descs_[static_cast<size_t>(fd)];
+    if (!slot) {
+        slot = std::make_unique<Desc>();
+    }
+    return slot.get();
+}
+
+bool NetPoller::wait(int fd, bool forWrite) {
+    Fiber* self = Fiber::current();
+    if (!self || !valid() || fd < 0) {
+        return false;
+    }
+    Desc* desc = descFor(fd);
+    std::unique_lock<std::mutex> lock(desc->mutex);
+    if (!desc->registered) {
+#if defined(TOCIN_NETPOLL_EPOLL)
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = desc;
+        if (epoll_ctl(pollFd_, EPOLL_CTL_ADD, fd, &ev) != 0 &&
+            (errno != EEXIST || epoll_ctl(pollFd_, EPOLL_CTL_MOD, fd, &ev) != 0)) {
+            return false; // e.g. a regular file, which is always ready
+        }
+#elif defined(TOCIN_NETPOLL_KQUEUE)
+        struct kevent evs[2];
+        EV_SET(&evs[0], fd, EVFILT_READ, EV_ADD | EV_CLEAR, 0, 0, desc);
+        EV_SET(&evs[1], fd, EVFILT_WRITE, EV_ADD | EV_CLEAR, 0, 0, desc);
+        if (kevent(pollFd_, evs, 2, nullptr, 0, nullptr) != 0) {
+            return false;
+        }
+#endif
+        // The registration reports the current state as the first edge.
+        desc->registered = true;
+        desc->readReady = desc->writeReady = false;
+    }
+    bool& pending = forWrite ? desc->writeReady : desc->readReady;
+    if (pending) {
+        pending = false;
+        return true;
+    }
+    (forWrite ? desc->writers : desc->readers).push_back(self->shared_from_this());
+    waiting_.fetch_add(1, std::memory_order_acq_rel);
+    LightweightScheduler::park(lock);
+    return true;
+}
+
+void NetPoller::ready(Desc* desc, bool readable, bool writable,
+                      std::vector<std::shared_ptr<Fiber>>& out) {
+    std::lock_guard<std::mutex> lock(desc->mutex);
+    auto take = [&](std::vector<std::shared_ptr<Fiber>>& waiters, bool& pending) {
+        if (waiters.empty()) {
+            pending = true;
+            return;
+        }
+        waiting_.fetch_sub(waiters.size(), std::memory_order_acq_rel);
+        for (auto& fiber : waiters) {
+            out.push_back(std::move(fiber));
+        }
+        waiters.clear();
+    };
+    if (readable) take(desc->readers, desc->readReady);
+    if (writable) take(desc->writers, desc->writeReady);
+}
+
+void NetPoller::forget(int fd, std::vector<std::shared_ptr<Fiber>>& ready) {
+    if (!valid() || fd < 0) {
+        return;
+    }
+    Desc* desc;
+    {
+        std::lock_guard<std::mutex> lock(descsMutex_);
+        if (static_cast<size_t>(fd) >= descs_.size() || !descs_[static_cast<size_t>(fd)]) {
+            return;
+        }
+        desc = descs_[static_cast<size_t>(fd)].get();
+    }
+    std::lock_guard<std::mutex> lock(desc->mutex);
+    if (!desc->registered) {
+        return;
+    }
+#if defined(TOCIN_NETPOLL_EPOLL)
+    epoll_ctl(pollFd_, EPOLL_CTL_DEL, fd, nullptr);
+#elif defined(TOCIN_NETPOLL_KQUEUE)
+    struct kevent evs[2];
+    EV_SET(&evs[0], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    EV_SET(&evs[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+    kevent(pollFd_, evs, 2, nullptr, 0, nullptr);
+#endif
+    desc->registered = false;
+    desc->readReady = desc->writeReady = false;
+    waiting_.fetch_sub(desc->readers.size() + desc->writers.size(), std::memory_order_acq_rel);
+    for (auto* waiters : {&desc->readers, &desc->writers}) {
+        for (auto& fiber : *waiters) {
+            ready.push_back(std::move(fiber));
+        }
+        waiters->clear();
+    }
+}
+
+void NetPoller::poll(int timeoutMs, std::vector<std::shared_ptr<Fiber>>& ready) {
+    if (!valid()) {
+        return;
+    }
+#if defined(TOCIN_NETPOLL_EPOLL)
+    epoll_event evs[kMaxEvents];
+    int n = epoll_wait(pollFd_, evs, kMaxEvents, timeoutMs);
+    for (int i = 0; i < n; ++i) {
+        auto* desc = static_cast<Desc*>(evs[i].data.ptr);
+        uint32_t e = evs[i].events;
+        if (!desc) {
+            uint64_t count;
+            while (read(wakeFd_, &count, sizeof count) > 0) {
+            }
+            continue;
+        }
+        // Errors and hangups wake both sides: the retried call reports them.
+        bool failed = (e & (EPOLLERR | EPOLLHUP)) != 0;
+        this->ready(desc, failed || (e & (EPOLLIN | EPOLLRDHUP)), failed || (e & EPOLLOUT), ready);
+    }
+#elif defined(TOCIN_NETPOLL_KQUEUE)
+    struct kevent evs[kMaxEvents];
+    timespec ts{timeoutMs / 1000, static_cast<long>(timeoutMs % 1000) * 1000000L};
+    int n = kevent(pollFd_, nullptr, 0, evs, kMaxEvents, timeoutMs < 0 ? nullptr : &ts);
+    for (int i = 0; i < n; ++i) {
+        if (evs[i].filter == EVFILT_USER) {
+            continue;
+        }
+        auto* desc = static_cast<Desc*>(evs[i].udata);
+        bool failed = (evs[i].flags & EV_ERROR) != 0;
+        this->ready(desc, failed || evs[i].filter == EVFILT_READ,
+                    failed || evs[i].filter == EVFILT_WRITE, ready);
+    }
+#else
+    (void)timeoutMs;
+    (void)ready;
+#endif
+}
+
+void NetPoller::wake() {
+#if defined(TOCIN_NETPOLL_EPOLL)
+    if (wakeFd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd_, &one, sizeof one);
+        (void)ignored;
+    }
+#elif defined(TOCIN_NETPOLL_KQUEUE)
+    if (pollFd_ >= 0) {
+        struct kevent ev;
+        EV_SET(&ev, 0, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+        kevent(pollFd_, &ev, 1, nullptr, 0, nullptr);
+    }
+#endif
+}
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+class Fiber;
+
+/**
+ * @brief Readiness poller for non-blocking file descriptors
+ *
+ * The scheduler's netpoller: a fiber whose socket would block parks here
+ * instead of holding its worker, and is handed back to the scheduler once
+ * the descriptor becomes ready. Backed by epoll on Linux and kqueue on
+ * macOS/BSD, with every descriptor registered once, edge-triggered, for both
+ * directions. A readiness edge that arrives while nobody waits is remembered
+ * per direction, so a waiter that registers just after it does not sleep
+ * through it. On other platforms valid() is false and callers block the
+ * thread instead.
+ */
+class NetPoller {
+public:
+    NetPoller();
+    ~NetPoller();
+    NetPoller(const NetPoller&) = delete;
+    NetPoller& operator=(const NetPoller&) = delete;
+
+    bool valid() const;
+
+    // Park the calling fiber until fd is readable (or writable), then return
+    // true; the caller retries its system call, which may still find the
+    // descriptor not ready after a spurious wakeup. Returns false without
+    // parking when fd cannot be polled (not a socket or pipe, no poller).
+    bool wait(int fd, bool forWrite);
+
+    // Drop fd before it is closed; fibers parked on it are returned through
+    // `ready` so their retried call fails on the closed descriptor.
+    void forget(int fd, std::vector<std::shared_ptr<Fiber>>& ready);
+
+    // Append the fibers whose descriptors became ready, waiting up to
+    // timeoutMs (0: do not block). Single caller at a time.
+    void poll(int timeoutMs, std::vector<std::shared_ptr<Fiber>>& ready);
+
+    // Make a poll() that is blocked, or about to block, return.
+    void wake();
+
+    // Fibers currently parked on a descriptor.
+    size_t waiting() const { return waiting_.load(std::memory_order_acquire); }
+
+private:
+    struct Desc {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Fiber>> readers;
+        std::vector<std::shared_ptr<Fiber>> writers;
+        bool readReady = false;
+        bool writeReady = false;
+        bool registered = false;
+    };
+
+    Desc* descFor(int fd);
+    void ready(Desc* desc, bool readable, bool writable, std::vector<std::shared_ptr<Fiber>>& out);
+
+    int pollFd_ = -1;
+    int wakeFd_ = -1; // eventfd (Linux); kqueue uses an EVFILT_USER event
+    std::atomic<size_t> waiting_{0};
+
+    // Indexed by descriptor; entries are never freed while the poller lives,
+    // so the kernel may carry a Desc* as the event's user data.
+    std::mutex descsMutex_;
+    std::vector<std::unique_ptr<Desc>> descs_;
+};
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,156 @@
+#include "numa_topology.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+    thread_local int t_numaNode = -1;
+
+#ifdef __linux__
+    std::vector<int> allowedCpus() {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof set, &set) != 0) return cpus;
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+        return cpus;
+    }
+#endif
+}
+
+std::vector<int> NumaTopology::parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    size_t i = 0;
+    while (i < list.size()) {
+        size_t end = list.find(',', i);
+        if (end == std::string::npos) end = list.size();
+        std::string part = list.substr(i, end - i);
+        i = end + 1;
+        part.erase(std::remove_if(part.begin(), part.end(),
+                                  [](char c) { return c == ' ' || c == '\n'; }),
+                   part.end());
+        if (part.empty()) continue;
+        size_t dash = part.find('-');
+        char *stop = nullptr;
+        long lo = std::strtol(part.c_str(), &stop, 10);
+        long hi = lo;
+        if (dash != std::string::npos) hi = std::strtol(part.c_str() + dash + 1, &stop, 10);
+        if (lo < 0 || hi < lo) continue;
+        for (long c = lo; c <= hi; ++c) cpus.push_back(static_cast<int>(c));
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+NumaTopology NumaTopology::fromSysfs(const std::string &nodeDir,
+                                     const std::vector<int> &allowedCpus) {
+    NumaTopology topo;
+    // Node ids are dense in practice; stop at the first missing one.
+    for (int node = 0; node < 1024; ++node) {
+        std::ifstream in(nodeDir + "/node" + std::to_string(node) + "/cpulist");
+        if (!in) break;
+        std::string list;
+        std::getline(in, list);
+        std::vector<int> cpus = parseCpuList(list);
+        if (!allowedCpus.empty()) {
+            cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&](int c) {
+                return !std::binary_search(allowedCpus.begin(), allowedCpus.end(), c);
+            }), cpus.end());
+        }
+        topo.nodeCpus_.push_back(std::move(cpus));
+    }
+    return topo;
+}
+
+NumaTopology NumaTopology::uniform(size_t cpus) {
+    NumaTopology topo;
+    topo.nodeCpus_.emplace_back();
+    for (size_t c = 0; c < cpus; ++c) topo.nodeCpus_[0].push_back(static_cast<int>(c));
+    return topo;
+}
+
+const NumaTopology &NumaTopology::system() {
+    static const NumaTopology topo = [] {
+#ifdef __linux__
+        NumaTopology t = fromSysfs("/sys/devices/system/node", allowedCpus());
+        if (t.nodeCpus_.empty()) t = uniform(std::max(1u, std::thread::hardware_concurrency()));
+        return t;
+#else
+        return uniform(std::max(1u, std::thread::hardware_concurrency()));
+#endif
+    }();
+    return topo;
+}
+
+const std::vector<int> &NumaTopology::cpusOf(size_t node) const {
+    static const std::vector<int> none;
+    return node < nodeCpus_.size() ? nodeCpus_[node] : none;
+}
+
+int NumaTopology::nodeOfCpu(int cpu) const {
+    for (size_t n = 0; n < nodeCpus_.size(); ++n) {
+        if (std::binary_search(nodeCpus_[n].begin(), nodeCpus_[n].end(), cpu)) {
+            return static_cast<int>(n);
+        }
+    }
+    return -1;
+}
+
+std::vector<std::pair<int, int>> NumaTopology::placeWorkers(size_t workers) const {
+    std::vector<std::pair<int, int>> placement(workers, {-1, -1});
+    size_t total = 0;
+    for (const auto &cpus : nodeCpus_) total += cpus.size();
+    if (total == 0) return placement;
+
+    // Each node takes the block of workers matching its slice of the CPUs:
+    // [workers * before / total, workers * (before + own) / total).
+    size_t before = 0;
+    for (size_t n = 0; n < nodeCpus_.size(); ++n) {
+        const auto &cpus = nodeCpus_[n];
+        size_t first = workers * before / total;
+        before += cpus.size();
+        size_t last = workers * before / total;
+        for (size_t w = first; w < last; ++w) {
+            placement[w] = {static_cast<int>(n), cpus[(w - first) % cpus.size()]};
+        }
+    }
+    return placement;
+}
+
+int currentNumaNode() { return t_numaNode; }
+
+void setCurrentNumaNode(int node) { t_numaNode = node; }
+
+bool preferNumaNode(void *addr, size_t len, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+    constexpr int kMpolPreferred = 1;   // MPOL_PREFERRED, from <linux/mempolicy.h>
+    constexpr size_t kMaskBits = 1024;
+    if (node < 0 || static_cast<size_t>(node) >= kMaskBits) return false;
+    unsigned long mask[kMaskBits / (8 * sizeof(unsigned long))] = {};
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+    // The kernel reads maxnode - 1 bits.
+    return syscall(SYS_mbind, addr, len, kMpolPreferred, mask, kMaskBits + 1, 0) == 0;
+#else
+    (void)addr;
+    (void)len;
+    (void)node;
+    return false;
+#endif
+}
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * NUMA topology and node-local placement.
+ *
+ * On Linux the CPU-to-node map comes from sysfs (node<N>/cpulist under
+ * /sys/devices/system/node), restricted to the CPUs this process may run
+ * on; elsewhere the machine is reported as one node. No libnuma: memory is
+ * steered with the mbind system call, and only as a preference, so a full
+ * node spills over instead of failing.
+ *
+ * The scheduler pins each worker to a CPU of its node and records the node
+ * in a thread-local (currentNumaNode), which the allocators consult: fiber
+ * stacks are bound to the acquiring worker's node, and the size-class pools
+ * keep one central free list per node.
+ */
+
+namespace tocin {
+namespace runtime {
+
+class NumaTopology {
+public:
+    // The machine this process runs on (read once).
+    static const NumaTopology &system();
+    // Topology described by a sysfs-style node directory (for tests and for
+    // the one-time read behind system()). allowedCpus, when non-empty, drops
+    // every CPU not in it.
+    static NumaTopology fromSysfs(const std::string &nodeDir,
+                                  const std::vector<int> &allowedCpus = {});
+    // A single node holding `cpus` CPUs numbered from 0.
+    static NumaTopology uniform(size_t cpus);
+
+    // Node ids run 0..nodes()-1; a node with no usable CPU is still counted
+    // (it has memory) but gets no workers.
+    size_t nodes() const { return nodeCpus_.empty() ? 1 : nodeCpus_.size(); }
+    const std::vector<int> &cpusOf(size_t node) const;
+    // Node of `cpu`, or -1 if unknown.
+    int nodeOfCpu(int cpu) const;
+
+    // (node, cpu) for each of `workers` workers: contiguous blocks per node,
+    // in proportion to the node's CPUs, cycling through a node's CPUs when
+    // there are more workers than CPUs.
+    std::vector<std::pair<int, int>> placeWorkers(size_t workers) const;
+
+    // Parse a kernel CPU list such as "0-3,8,10-11".
+    static std::vector<int> parseCpuList(const std::string &list);
+
+private:
+    std::vector<std::vector<int>> nodeCpus_;
+};
+
+// The NUMA node of the worker running on this thread, or -1 when unknown
+// (not a pinned worker, or a single-node machine).
+int currentNumaNode();
+void setCurrentNumaNode(int node);
+
+// Ask the kernel to place the pages of [addr, addr + len) on `node` when
+// they are first touched. Best effort: false if unsupported or refused.
+bool preferNumaNode(void *addr, size_t len, int node);
+
+} // namespace runtime
+} // namespace tocin
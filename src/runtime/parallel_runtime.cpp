@@ -1,57 +1,372 @@
 /**
  * Parallel Runtime for Tocin Compiler
  * Provides implementation of parallel execution primitives
+ *
+ * Parallel loops run on the runtime's shared executor (executor.h): the
+ * calling thread works on the loop and helper tasks join it on the executor's
+ * workers, the same threads goroutines and async calls use, so mixing them
+ * does not oversubscribe the cores. Each loop is split into one contiguous
+ * slice per participant; a participant takes chunks from the front of its own
+ * slice and, when that runs dry, steals the back half of another
+ * participant's slice, so uneven iterations rebalance without a shared
+ * counter on the hot path. Because the caller can finish the whole loop by
+ * itself, a loop never waits for a helper to be scheduled, which keeps nested
+ * loops deadlock-free even when every worker is busy.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
-#include <thread>
-#include <vector>
+#include <cstdlib>
+#include <cstring>
 #include <functional>
-#include <atomic>
-#include <future>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "executor.h"
+#include "kernel_support.h"
 
 namespace tocin {
 namespace runtime {
 
-// Thread pool for parallel execution
+// How a participant sizes the chunk it takes from its own slice.
+enum class LoopSchedule {
+    Static,   // the whole slice at once; stealing still splits what is left
+    Dynamic,  // fixed-size chunks of chunk_size iterations
+    Guided    // half of what remains, never below chunk_size
+};
+
+// What a parallel loop started from inside another parallel loop does.
+enum class NestedPolicy {
+    Serial,   // run the inner loop on the calling worker
+    Share     // offer the inner loop to idle workers as well
+};
+
+// One participant's share of a loop: iterations [lo, hi). The owner takes from
+// lo, thieves split off the back half.
+struct alignas(64) LoopSlice {
+    std::mutex m;
+    int64_t lo = 0;
+    int64_t hi = 0;
+};
+
+// Runs iterations [lo, hi) of a loop for the participant owning `slot`.
+using ChunkFn = void (*)(void* ctx, size_t slot, int64_t lo, int64_t hi);
+
+// A parallel loop in flight, shared by the caller and its helper tasks. A
+// helper may start after the loop is over; it then finds no slice to take and
+// never touches fn or ctx, which live on the caller's stack.
+struct LoopJob {
+    ChunkFn fn = nullptr;
+    void* ctx = nullptr;
+    LoopSchedule schedule = LoopSchedule::Guided;
+    int64_t chunk = 1;
+    size_t num_slices = 0;
+    std::unique_ptr<LoopSlice[]> slices;
+    std::atomic<size_t> next_slice{1};     // slice 0 belongs to the caller
+    std::atomic<int64_t> remaining{0};     // iterations not yet completed
+    std::atomic<bool> exhausted{false};    // nothing left to hand out
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+};
+
+// Parallel loops over the shared executor
 class ParallelRuntime {
 private:
-    static std::vector<std::thread> thread_pool_;
     static std::atomic<bool> initialized_;
     static std::mutex init_mutex_;
     static size_t num_threads_;
-    
+
+    static std::atomic<LoopSchedule> schedule_;
+    static std::atomic<int64_t> chunk_size_;
+    static std::atomic<NestedPolicy> nested_;
+
+    // Loop nesting depth of the current thread (0 outside any parallel loop).
+    static int& depth() {
+        static thread_local int d = 0;
+        return d;
+    }
+
+    static size_t env_size(const char* name, size_t fallback) {
+        const char* v = std::getenv(name);
+        if (!v || !*v) return fallback;
+        long long n = std::atoll(v);
+        return n > 0 ? static_cast<size_t>(n) : fallback;
+    }
+
+    static void read_env_policy() {
+        if (const char* s = std::getenv("TOCIN_PARALLEL_SCHEDULE")) {
+            if (std::strcmp(s, "static") == 0) schedule_.store(LoopSchedule::Static);
+            else if (std::strcmp(s, "dynamic") == 0) schedule_.store(LoopSchedule::Dynamic);
+            else if (std::strcmp(s, "guided") == 0) schedule_.store(LoopSchedule::Guided);
+        }
+        chunk_size_.store(static_cast<int64_t>(env_size("TOCIN_PARALLEL_CHUNK", 0)));
+        if (const char* s = std::getenv("TOCIN_PARALLEL_NESTED")) {
+            if (std::strcmp(s, "share") == 0) nested_.store(NestedPolicy::Share);
+            else if (std::strcmp(s, "serial") == 0) nested_.store(NestedPolicy::Serial);
+        }
+    }
+
+    // Take the next chunk of slice `s` for its owner.
+    static bool take(LoopJob& job, LoopSlice& s, int64_t& lo, int64_t& hi) {
+        std::lock_guard<std::mutex> lock(s.m);
+        int64_t left = s.hi - s.lo;
+        if (left <= 0) return false;
+        int64_t n = left;
+        if (job.schedule == LoopSchedule::Dynamic)
+            n = std::min(left, job.chunk);
+        else if (job.schedule == LoopSchedule::Guided)
+            n = std::min(left, std::max(job.chunk, (left + 1) / 2));
+        lo = s.lo;
+        hi = s.lo + n;
+        s.lo = hi;
+        return true;
+    }
+
+    // Refill slice `self` with the back half of the next non-empty slice.
+    static bool steal(LoopJob& job, size_t self) {
+        for (size_t k = 1; k < job.num_slices; ++k) {
+            LoopSlice& victim = job.slices[(self + k) % job.num_slices];
+            int64_t lo, hi;
+            {
+                std::lock_guard<std::mutex> lock(victim.m);
+                int64_t left = victim.hi - victim.lo;
+                if (left <= 0) continue;
+                int64_t mid = victim.lo + left / 2;
+                lo = mid;
+                hi = victim.hi;
+                victim.hi = mid;
+            }
+            LoopSlice& mine = job.slices[self];
+            std::lock_guard<std::mutex> lock(mine.m);
+            mine.lo = lo;
+            mine.hi = hi;
+            return true;
+        }
+        return false;
+    }
+
+    // Work on `job` from slice `self` until no iterations are left to claim.
+    static void run(LoopJob& job, size_t self) {
+        ++depth();
+        LoopSlice& mine = job.slices[self];
+        for (;;) {
+            int64_t lo, hi;
+            while (take(job, mine, lo, hi)) {
+                job.fn(job.ctx, self, lo, hi);
+                if (job.remaining.fetch_sub(hi - lo, std::memory_order_acq_rel) == hi - lo) {
+                    std::lock_guard<std::mutex> lock(job.done_mutex);
+                    job.done_cv.notify_all();
+                }
+            }
+            if (!steal(job, self)) break;
+        }
+        job.exhausted.store(true, std::memory_order_release);
+        --depth();
+    }
+
+    // A helper task: take the next unowned slice, if any is left.
+    static void help(const std::shared_ptr<LoopJob>& job) {
+        if (job->exhausted.load(std::memory_order_acquire)) return;
+        size_t self = job->next_slice.fetch_add(1, std::memory_order_acq_rel);
+        if (self < job->num_slices)
+            run(*job, self);
+    }
+
 public:
     static void initialize(size_t num_threads = 0) {
         std::lock_guard<std::mutex> lock(init_mutex_);
         if (initialized_.load()) {
             return;
         }
-        
+
         if (num_threads == 0) {
-            num_threads = std::thread::hardware_concurrency();
-            if (num_threads == 0) num_threads = 4;
+            num_threads = executorThreads();
         }
-        
+
+        static std::once_flag once;
+        std::call_once(once, read_env_policy);
+
         num_threads_ = num_threads;
         initialized_.store(true);
     }
-    
+
+    // Forget the participant count; the executor itself stays up for
+    // goroutines and is stopped at exit.
     static void shutdown() {
         std::lock_guard<std::mutex> lock(init_mutex_);
         initialized_.store(false);
     }
-    
+
     static size_t get_num_threads() {
         return num_threads_;
     }
+
+    static void set_schedule(LoopSchedule schedule, int64_t chunk) {
+        schedule_.store(schedule);
+        chunk_size_.store(chunk > 0 ? chunk : 0);
+    }
+
+    static void set_nested(NestedPolicy policy) {
+        nested_.store(policy);
+    }
+
+    // Initialize if needed and report how many participants a loop started
+    // now may use (the size of any per-participant state).
+    static size_t ready_threads() {
+        if (!initialized_.load()) {
+            initialize();
+        }
+        return num_threads_ ? num_threads_ : 1;
+    }
+
+    /**
+     * Run fn(ctx, slot, lo, hi) over [0, count) with at most `threads`
+     * participants, slot < threads identifying the participant. Returns once
+     * every iteration has completed.
+     */
+    static void parallel_chunks(int64_t count, size_t threads, ChunkFn fn, void* ctx) {
+        bool nested = depth() > 0;
+        // Small ranges, single-threaded pools and (by default) nested loops
+        // are not worth the hand-off.
+        if (threads <= 1 || count < static_cast<int64_t>(threads) * 2 ||
+            (nested && nested_.load() == NestedPolicy::Serial)) {
+            fn(ctx, 0, 0, count);
+            return;
+        }
+
+        auto shared = std::make_shared<LoopJob>();
+        LoopJob& job = *shared;
+        job.fn = fn;
+        job.ctx = ctx;
+        job.schedule = schedule_.load();
+        job.chunk = chunk_size_.load();
+        if (job.chunk <= 0) {
+            // Default grain: enough chunks per thread to absorb imbalance.
+            job.chunk = std::max<int64_t>(1, count / (static_cast<int64_t>(threads) * 8));
+            if (job.schedule == LoopSchedule::Guided) job.chunk = 1;
+        }
+        job.num_slices = threads;
+        job.slices.reset(new LoopSlice[threads]);
+        int64_t base = count / static_cast<int64_t>(threads);
+        int64_t extra = count % static_cast<int64_t>(threads);
+        int64_t at = 0;
+        for (size_t t = 0; t < threads; ++t) {
+            int64_t n = base + (static_cast<int64_t>(t) < extra ? 1 : 0);
+            job.slices[t].lo = at;
+            job.slices[t].hi = at + n;
+            at += n;
+        }
+        job.remaining.store(count);
+
+        // No more helpers than the executor has workers to run them.
+        size_t helpers = std::min(threads - 1, executorThreads());
+        for (size_t h = 0; h < helpers; ++h) {
+            executorSubmit([shared] { help(shared); });
+        }
+
+        run(job, 0);
+
+        // What is left are chunks helpers are running on other workers.
+        if (job.remaining.load(std::memory_order_acquire) != 0) {
+            std::unique_lock<std::mutex> lock(job.done_mutex);
+            job.done_cv.wait(lock, [&] { return job.remaining.load(std::memory_order_acquire) == 0; });
+        }
+    }
+
+    /**
+     * Run body(start + k * step) for k in [0, count) across the pool.
+     */
+    static void parallel_for(int64_t start, int64_t count, int64_t step, void (*body)(int64_t)) {
+        struct Loop { int64_t start, step; void (*body)(int64_t); } loop{start, step, body};
+        parallel_chunks(count, ready_threads(), [](void* ctx, size_t, int64_t lo, int64_t hi) {
+            auto* l = static_cast<Loop*>(ctx);
+            for (int64_t i = lo; i < hi; ++i) {
+                l->body(l->start + i * l->step);
+            }
+        }, &loop);
+    }
+
+    /**
+     * Reduce over [start, end): each participant threads its own accumulator
+     * (starting at the identity of op) through body(env, lo, hi, acc) for the
+     * chunks it runs; the accumulators are then combined pairwise in a tree
+     * and finally with init.
+     */
+    template <typename T>
+    static T parallel_reduce(int64_t start, int64_t end, int64_t op, T init,
+                             T (*body)(void*, int64_t, int64_t, T), void* env) {
+        struct alignas(64) Acc { T value; };
+        size_t threads = ready_threads();
+        std::unique_ptr<Acc[]> acc(new Acc[threads]);
+        for (size_t t = 0; t < threads; ++t) {
+            acc[t].value = reduce_identity<T>(op);
+        }
+        struct Loop { int64_t start; T (*body)(void*, int64_t, int64_t, T); void* env; Acc* acc; }
+            loop{start, body, env, acc.get()};
+        parallel_chunks(end - start, threads, [](void* ctx, size_t slot, int64_t lo, int64_t hi) {
+            auto* l = static_cast<Loop*>(ctx);
+            l->acc[slot].value = l->body(l->env, l->start + lo, l->start + hi, l->acc[slot].value);
+        }, &loop);
+        for (size_t stride = 1; stride < threads; stride *= 2) {
+            for (size_t i = 0; i + stride < threads; i += 2 * stride) {
+                acc[i].value = reduce_combine<T>(op, acc[i].value, acc[i + stride].value);
+            }
+        }
+        return reduce_combine<T>(op, init, acc[0].value);
+    }
+
+    // Reduction operators, numbered as in the C interface below.
+    template <typename T>
+    static T reduce_identity(int64_t op) {
+        switch (op) {
+        case 1: return T(1);
+        case 2: return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                             : std::numeric_limits<T>::max();
+        case 3: return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity()
+                                                             : std::numeric_limits<T>::lowest();
+        case 4: return identity_all_ones<T>();
+        default: return T(0);
+        }
+    }
+
+    template <typename T>
+    static T identity_all_ones() {
+        if constexpr (std::is_integral_v<T>) return ~T(0);
+        else return T(0);
+    }
+
+    template <typename T>
+    static T reduce_combine(int64_t op, T a, T b) {
+        switch (op) {
+        case 1: return a * b;
+        case 2: return b < a ? b : a;
+        case 3: return a < b ? b : a;
+        default: break;
+        }
+        if constexpr (std::is_integral_v<T>) {
+            switch (op) {
+            case 4: return a & b;
+            case 5: return a | b;
+            case 6: return a ^ b;
+            default: break;
+            }
+        }
+        return a + b;
+    }
 };
 
-std::vector<std::thread> ParallelRuntime::thread_pool_;
 std::atomic<bool> ParallelRuntime::initialized_(false);
 std::mutex ParallelRuntime::init_mutex_;
 size_t ParallelRuntime::num_threads_ = 0;
+std::atomic<LoopSchedule> ParallelRuntime::schedule_(LoopSchedule::Guided);
+std::atomic<int64_t> ParallelRuntime::chunk_size_(0);
+std::atomic<NestedPolicy> ParallelRuntime::nested_(NestedPolicy::Serial);
 
 } // namespace runtime
 } // namespace tocin
@@ -66,54 +381,10 @@ extern "C" {
  * @param body Function pointer to loop body, takes index as parameter
  */
 void __tocin_parallel_for(int64_t start, int64_t end, void (*body)(int64_t)) {
-    using namespace tocin::runtime;
-    
-    // Access static members through public interface
-    if (!ParallelRuntime::get_num_threads()) {
-        ParallelRuntime::initialize();
-    }
-    
     if (!body || start >= end) {
         return;
     }
-    
-    size_t num_threads = ParallelRuntime::get_num_threads();
-    int64_t range = end - start;
-    
-    // If range is too small, just execute serially
-    if (range < static_cast<int64_t>(num_threads) * 2) {
-        for (int64_t i = start; i < end; ++i) {
-            body(i);
-        }
-        return;
-    }
-    
-    // Divide work among threads
-    std::vector<std::future<void>> futures;
-    futures.reserve(num_threads);
-    
-    int64_t chunk_size = range / num_threads;
-    int64_t remainder = range % num_threads;
-    
-    for (size_t thread_id = 0; thread_id < num_threads; ++thread_id) {
-        int64_t thread_start = start + thread_id * chunk_size + std::min(static_cast<int64_t>(thread_id), remainder);
-        int64_t thread_end = thread_start + chunk_size + (thread_id < remainder ? 1 : 0);
-        
-        if (thread_start >= end) {
-            break;
-        }
-        
-        futures.push_back(std::async(std::launch::async, [body, thread_start, thread_end]() {
-            for (int64_t i = thread_start; i < thread_end; ++i) {
-                body(i);
-            }
-        }));
-    }
-    
-    // Wait for all threads to complete
-    for (auto& future : futures) {
-        future.wait();
-    }
+    tocin::runtime::ParallelRuntime::parallel_for(start, end - start, 1, body);
 }
 
 /**
@@ -123,13 +394,78 @@ void __tocin_parallel_for_step(int64_t start, int64_t end, int64_t step, void (*
     if (!body || step == 0 || (step > 0 && start >= end) || (step < 0 && start <= end)) {
         return;
     }
-    
+
     int64_t num_iterations = (end - start + step - (step > 0 ? 1 : -1)) / step;
-    
-    // Execute sequentially for stepped loop (can be optimized later)
-    for (int64_t i = 0; i < num_iterations; ++i) {
-        body(start + i * step);
+    tocin::runtime::ParallelRuntime::parallel_for(start, num_iterations, step, body);
+}
+
+/**
+ * Parallel reduction over [start, end) for `parallel for ... reduce(op: acc)`.
+ * @param op 0 = +, 1 = *, 2 = min, 3 = max, 4 = &, 5 = |, 6 = ^
+ * @param init Value of the reduction variable before the loop
+ * @param closure Closure (env-first ABI) computing
+ *        `acc` after running iterations [lo, hi) from the given `acc`
+ * @return init combined with every iteration's contribution
+ */
+int64_t __tocin_parallel_reduce(int64_t start, int64_t end, int64_t op, int64_t init, void* closure) {
+    if (!closure || start >= end) {
+        return init;
+    }
+    auto body = *reinterpret_cast<int64_t (**)(void*, int64_t, int64_t, int64_t)>(closure);
+    return tocin::runtime::ParallelRuntime::parallel_reduce<int64_t>(start, end, op, init, body, closure);
+}
+
+/**
+ * Floating-point parallel reduction; op is + * min or max (0-3).
+ */
+double __tocin_parallel_reduce_f64(int64_t start, int64_t end, int64_t op, double init, void* closure) {
+    if (!closure || start >= end) {
+        return init;
+    }
+    auto body = *reinterpret_cast<double (**)(void*, int64_t, int64_t, double)>(closure);
+    return tocin::runtime::ParallelRuntime::parallel_reduce<double>(start, end, op, init, body, closure);
+}
+
+/**
+ * Run fn(ctx, lo, hi) over chunks of [0, count) across the pool, for runtime
+ * kernels that split their own work (the GEMM in linalg_kernels.cpp).
+ */
+void __tocin_parallel_chunks(int64_t count, void (*fn)(void*, int64_t, int64_t), void* ctx) {
+    if (!fn || count <= 0) {
+        return;
+    }
+    struct Loop { void (*fn)(void*, int64_t, int64_t); void* ctx; } loop{fn, ctx};
+    tocin::runtime::ParallelRuntime::parallel_chunks(
+        count, tocin::runtime::ParallelRuntime::ready_threads(),
+        [](void* c, size_t, int64_t lo, int64_t hi) {
+            auto* l = static_cast<Loop*>(c);
+            l->fn(l->ctx, lo, hi);
+        }, &loop);
+}
+
+/**
+ * Like __tocin_parallel_chunks, but fn also gets the participant's slot, a
+ * number below __tocin_parallel_threads(), for callers that keep one piece of
+ * state per participant (the LINQ layer's unordered merge).
+ */
+void __tocin_parallel_slot_chunks(int64_t count, void (*fn)(void*, int64_t, int64_t, int64_t), void* ctx) {
+    if (!fn || count <= 0) {
+        return;
     }
+    struct Loop { void (*fn)(void*, int64_t, int64_t, int64_t); void* ctx; } loop{fn, ctx};
+    tocin::runtime::ParallelRuntime::parallel_chunks(
+        count, tocin::runtime::ParallelRuntime::ready_threads(),
+        [](void* c, size_t slot, int64_t lo, int64_t hi) {
+            auto* l = static_cast<Loop*>(c);
+            l->fn(l->ctx, static_cast<int64_t>(slot), lo, hi);
+        }, &loop);
+}
+
+/**
+ * Number of participants a parallel loop started now may use.
+ */
+int64_t __tocin_parallel_threads() {
+    return static_cast<int64_t>(tocin::runtime::ParallelRuntime::ready_threads());
 }
 
 /**
@@ -140,7 +476,29 @@ void __tocin_parallel_init(int64_t num_threads) {
 }
 
 /**
- * Shutdown the parallel runtime
+ * Select loop scheduling: 0 = static, 1 = dynamic, 2 = guided (default).
+ * @param chunk Chunk size (dynamic) or minimum chunk (guided); <= 0 picks one
+ */
+void __tocin_parallel_set_schedule(int64_t kind, int64_t chunk) {
+    using tocin::runtime::LoopSchedule;
+    LoopSchedule s = kind == 0 ? LoopSchedule::Static
+                   : kind == 1 ? LoopSchedule::Dynamic
+                               : LoopSchedule::Guided;
+    tocin::runtime::ParallelRuntime::set_schedule(s, chunk);
+}
+
+/**
+ * Select the nested-parallelism policy: 0 = run inner parallel loops serially
+ * on the calling worker (default), 1 = share them with idle workers.
+ */
+void __tocin_parallel_set_nested(int64_t policy) {
+    using tocin::runtime::NestedPolicy;
+    tocin::runtime::ParallelRuntime::set_nested(policy ? NestedPolicy::Share : NestedPolicy::Serial);
+}
+
+/**
+ * Reset the parallel runtime's participant count (the executor keeps
+ * running)
  */
 void __tocin_parallel_shutdown() {
     tocin::runtime::ParallelRuntime::shutdown();
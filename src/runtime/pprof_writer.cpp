@@ -0,0 +1,156 @@
+// A minimal protobuf encoder for the pprof Profile message.
+#include "pprof_writer.h"
+
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+void putVarint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out += (char)(uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out += (char)(uint8_t)v;
+}
+
+void putInt(std::string &out, int field, uint64_t v) {
+    putVarint(out, (uint64_t)field << 3);
+    putVarint(out, v);
+}
+
+void putBytes(std::string &out, int field, const std::string &bytes) {
+    putVarint(out, ((uint64_t)field << 3) | 2);
+    putVarint(out, bytes.size());
+    out += bytes;
+}
+
+template <typename T>
+void putPacked(std::string &out, int field, const std::vector<T> &vs) {
+    std::string packed;
+    for (T v : vs) putVarint(packed, (uint64_t)v);
+    putBytes(out, field, packed);
+}
+
+} // namespace
+
+PprofBuilder::PprofBuilder(std::function<std::string(uint64_t)> symbolize)
+    : symbolize_(std::move(symbolize)) {}
+
+uint64_t PprofBuilder::str(const std::string &s) {
+    auto it = stringIds_.find(s);
+    if (it != stringIds_.end()) return it->second;
+    strings_.push_back(s);
+    return stringIds_[s] = strings_.size() - 1;
+}
+
+uint64_t PprofBuilder::location(uint64_t pc) {
+    auto it = locationIds_.find(pc);
+    if (it != locationIds_.end()) return it->second;
+    std::string name = symbolize_(pc);
+    uint64_t fid;
+    auto f = functionIds_.find(name);
+    if (f != functionIds_.end()) {
+        fid = f->second;
+    } else {
+        fid = functionIds_.size() + 1;
+        functionIds_.emplace(name, fid);
+        std::string fn;
+        putInt(fn, 1, fid);
+        putInt(fn, 2, str(name));
+        putInt(fn, 3, str(name));
+        putBytes(functions_, 5, fn);
+    }
+    uint64_t id = locationIds_.size() + 1;
+    locationIds_.emplace(pc, id);
+    std::string line, loc;
+    putInt(line, 1, fid);
+    putInt(loc, 1, id);
+    putInt(loc, 3, pc);
+    putBytes(loc, 4, line);
+    putBytes(locations_, 4, loc);
+    return id;
+}
+
+void PprofBuilder::addSampleType(const char *type, const char *unit) {
+    std::string vt;
+    putInt(vt, 1, str(type));
+    putInt(vt, 2, str(unit));
+    putBytes(header_, 1, vt);
+}
+
+void PprofBuilder::addSample(const std::vector<uint64_t> &pcs, const std::vector<int64_t> &values,
+                             const std::vector<std::pair<std::string, std::string>> &labels) {
+    std::vector<uint64_t> ids;
+    ids.reserve(pcs.size());
+    for (uint64_t pc : pcs) ids.push_back(location(pc));
+    std::string s;
+    putPacked(s, 1, ids);
+    putPacked(s, 2, values);
+    for (const auto &[key, value] : labels) {
+        std::string label;
+        putInt(label, 1, str(key));
+        putInt(label, 2, str(value));
+        putBytes(s, 3, label);
+    }
+    putBytes(samples_, 2, s);
+}
+
+void PprofBuilder::setPeriod(const char *type, const char *unit, int64_t period) {
+    std::string vt;
+    putInt(vt, 1, str(type));
+    putInt(vt, 2, str(unit));
+    putBytes(trailer_, 11, vt);
+    putInt(trailer_, 12, (uint64_t)period);
+}
+
+void PprofBuilder::setDuration(int64_t nanos) { putInt(trailer_, 10, (uint64_t)nanos); }
+
+void PprofBuilder::setDefaultSampleType(const char *type) { putInt(trailer_, 14, str(type)); }
+
+std::string PprofBuilder::finish() {
+    std::string profile = header_ + samples_ + locations_ + functions_;
+    for (const std::string &s : strings_) putBytes(profile, 6, s);
+    profile += trailer_;
+    return profile;
+}
+
+bool gzipProfile(const std::string &in, std::string &out) {
+    z_stream z;
+    std::memset(&z, 0, sizeof(z));
+    // 16 + window bits asks zlib for a gzip header and trailer.
+    if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    out.resize(deflateBound(&z, (uLong)in.size()));
+    z.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+    z.avail_in = (uInt)in.size();
+    z.next_out = reinterpret_cast<Bytef *>(&out[0]);
+    z.avail_out = (uInt)out.size();
+    int rc = deflate(&z, Z_FINISH);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return rc == Z_STREAM_END;
+}
+
+bool writeProfileFile(const std::string &path, const std::string &data) {
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+bool isPprofPath(const std::string &path) {
+    auto endsWith = [&](const char *suffix) {
+        size_t n = std::strlen(suffix);
+        return path.size() >= n && path.compare(path.size() - n, n, suffix) == 0;
+    };
+    return endsWith(".pb.gz") || endsWith(".pprof");
+}
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,62 @@
+#ifndef TOCIN_PPROF_WRITER_H
+#define TOCIN_PPROF_WRITER_H
+
+/**
+ * Builds pprof Profile messages (github.com/google/pprof, profile.proto)
+ * for the runtime's profilers, without a protobuf dependency.
+ *
+ * Each distinct address gets one Location and each distinct name one
+ * Function, named by the symbolizer the builder is given. finish() returns
+ * the uncompressed message; pprof files are gzipped (gzipProfile).
+ */
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+class PprofBuilder {
+public:
+    explicit PprofBuilder(std::function<std::string(uint64_t)> symbolize);
+
+    // One per value every sample carries, in order.
+    void addSampleType(const char *type, const char *unit);
+    // pcs leaf first; labels are (key, value) string pairs.
+    void addSample(const std::vector<uint64_t> &pcs, const std::vector<int64_t> &values,
+                   const std::vector<std::pair<std::string, std::string>> &labels = {});
+    void setPeriod(const char *type, const char *unit, int64_t period);
+    void setDuration(int64_t nanos);
+    void setDefaultSampleType(const char *type);
+
+    std::string finish();
+
+private:
+    uint64_t str(const std::string &s);
+    uint64_t location(uint64_t pc);
+
+    std::function<std::string(uint64_t)> symbolize_;
+    std::vector<std::string> strings_{""};
+    std::unordered_map<std::string, uint64_t> stringIds_;
+    std::unordered_map<uint64_t, uint64_t> locationIds_;
+    std::unordered_map<std::string, uint64_t> functionIds_;
+    std::string header_, samples_, locations_, functions_, trailer_;
+};
+
+// in as a gzip stream; false if zlib fails.
+bool gzipProfile(const std::string &in, std::string &out);
+
+// data to path; false and errno set if it cannot be written.
+bool writeProfileFile(const std::string &path, const std::string &data);
+
+// Whether a profile path asks for pprof (*.pb.gz, *.pprof) output.
+bool isPprofPath(const std::string &path);
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_PPROF_WRITER_H
@@ -0,0 +1,397 @@
+// Quantized matrices: the format conversions, the portable scalar table,
+// the NEON table on AArch64, the dispatch that picks among them and the
+// AVX2/VNNI tables, and the matrix-vector drivers behind the quantize and
+// qmat* builtins.
+#include "quant_kernels_impl.h"
+#include "kernel_support.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define TOCIN_QUANT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+uint16_t floatToHalf(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof x);
+    uint32_t sign = (x >> 16) & 0x8000u, mant = x & 0x7fffffu;
+    int32_t exp = static_cast<int32_t>((x >> 23) & 0xffu);
+    if (exp == 0xff) return static_cast<uint16_t>(sign | 0x7c00u | (mant ? 0x200u : 0u));
+    int32_t e = exp - 127 + 15;
+    if (e >= 31) return static_cast<uint16_t>(sign | 0x7c00u);
+    if (e <= 0) {
+        // Subnormal half: the implicit bit joins the mantissa, which loses
+        // 14 - e bits.
+        if (e < -10) return static_cast<uint16_t>(sign);
+        mant |= 0x800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - e);
+        uint32_t half = mant >> shift, rem = mant & ((1u << shift) - 1), mid = 1u << (shift - 1);
+        if (rem > mid || (rem == mid && (half & 1u))) ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+    // A carry out of the mantissa bumps the exponent, up to infinity.
+    uint32_t half = (static_cast<uint32_t>(e) << 10) | (mant >> 13), rem = mant & 0x1fffu;
+    if (rem > 0x1000u || (rem == 0x1000u && (half & 1u))) ++half;
+    return static_cast<uint16_t>(sign | half);
+}
+
+float halfToFloat(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+    uint32_t exp = (h >> 10) & 0x1fu, mant = h & 0x3ffu, bits;
+    if (exp == 0) {
+        float f = std::ldexp(static_cast<float>(mant), -24);
+        return sign ? -f : f;
+    }
+    if (exp == 31)
+        bits = sign | 0x7f800000u | (mant << 13);
+    else
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    float f;
+    std::memcpy(&f, &bits, sizeof f);
+    return f;
+}
+
+uint16_t floatToBf16(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof x);
+    if ((x & 0x7fffffffu) > 0x7f800000u) return static_cast<uint16_t>((x >> 16) | 0x40u);  // quiet NaN
+    return static_cast<uint16_t>((x + 0x7fffu + ((x >> 16) & 1u)) >> 16);
+}
+
+float bf16ToFloat(uint16_t h) {
+    uint32_t bits = static_cast<uint32_t>(h) << 16;
+    float f;
+    std::memcpy(&f, &bits, sizeof f);
+    return f;
+}
+
+namespace {
+
+struct Scalar {
+    using IAcc = int32_t;
+    using FAcc = float;
+    static constexpr size_t kI8 = 1;
+    static constexpr size_t kF32 = 1;
+
+    static IAcc izero() { return 0; }
+    static IAcc dotI8(IAcc acc, const int8_t *w, const int8_t *x) { return acc + int32_t(*w) * int32_t(*x); }
+    static int32_t isum(IAcc v) { return v; }
+    static FAcc fzero() { return 0.0f; }
+    static FAcc loadF16(const uint16_t *p) { return halfToFloat(*p); }
+    static FAcc loadBf16(const uint16_t *p) { return bf16ToFloat(*p); }
+    static FAcc loadF(const float *p) { return *p; }
+    static FAcc fma(FAcc a, FAcc b, FAcc acc) { return acc + a * b; }
+    static FAcc fadd(FAcc a, FAcc b) { return a + b; }
+    static float fsum(FAcc v) { return v; }
+};
+
+#ifdef TOCIN_QUANT_NEON
+struct Neon {
+    using IAcc = int32x4_t;
+    using FAcc = float32x4_t;
+    static constexpr size_t kI8 = 16;
+    static constexpr size_t kF32 = 4;
+
+    static IAcc izero() { return vdupq_n_s32(0); }
+    static IAcc dotI8(IAcc acc, const int8_t *w, const int8_t *x) {
+        int8x16_t wv = vld1q_s8(w), xv = vld1q_s8(x);
+#ifdef __ARM_FEATURE_DOTPROD
+        return vdotq_s32(acc, wv, xv);
+#else
+        int16x8_t lo = vmull_s8(vget_low_s8(wv), vget_low_s8(xv));
+        int16x8_t hi = vmull_s8(vget_high_s8(wv), vget_high_s8(xv));
+        return vpadalq_s16(vpadalq_s16(acc, lo), hi);
+#endif
+    }
+    static int32_t isum(IAcc v) { return vaddvq_s32(v); }
+    static FAcc fzero() { return vdupq_n_f32(0.0f); }
+    static FAcc loadF16(const uint16_t *p) { return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p))); }
+    static FAcc loadBf16(const uint16_t *p) {
+        return vreinterpretq_f32_u32(vshll_n_u16(vld1_u16(p), 16));
+    }
+    static FAcc loadF(const float *p) { return vld1q_f32(p); }
+    static FAcc fma(FAcc a, FAcc b, FAcc acc) { return vfmaq_f32(acc, a, b); }
+    static FAcc fadd(FAcc a, FAcc b) { return vaddq_f32(a, b); }
+    static float fsum(FAcc v) { return vaddvq_f32(v); }
+};
+#endif
+
+constexpr QuantKernels kScalarKernels = quantTable<Scalar>("scalar");
+#ifdef TOCIN_QUANT_NEON
+constexpr QuantKernels kNeonKernels = quantTable<Neon>("neon");
+#endif
+
+bool cpuHasAvx2F16c() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+           __builtin_cpu_supports("f16c");
+#else
+    return false;
+#endif
+}
+
+bool cpuHasVnni() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("avx512vnni");
+#else
+    return false;
+#endif
+}
+
+const QuantKernels *chooseKernels() {
+    auto available = availableQuantKernels();
+    if (const char *forced = std::getenv("TOCIN_QUANT_KERNELS")) {
+        for (const auto *table : available)
+            if (std::strcmp(table->name, forced) == 0) return table;
+    }
+    return available.back();
+}
+
+size_t padded(size_t n) { return (n + kQuantPad - 1) / kQuantPad * kQuantPad; }
+
+// Weight rows handed to one pool task, and the multiply-adds below which
+// the hand-off costs more than it saves.
+constexpr size_t kRowBlock = 32;
+constexpr size_t kParallelWork = size_t(1) << 18;
+
+// Symmetric int8: scale = max|v| / 127 and q = round(v / scale), so the
+// largest magnitude maps to +-127 and -128 is never used. Returns the
+// scale, 0 for an all-zero row (whose q is all zero).
+float quantizeRow(const double *v, size_t n, int8_t *q) {
+    double peak = 0.0;
+    for (size_t i = 0; i < n; ++i) peak = std::fmax(peak, std::fabs(v[i]));
+    if (peak == 0.0 || !std::isfinite(peak)) {
+        std::memset(q, 0, n);
+        return 0.0f;
+    }
+    double inv = 127.0 / peak;
+    for (size_t i = 0; i < n; ++i) {
+        long r = std::lround(v[i] * inv);
+        q[i] = static_cast<int8_t>(r > 127 ? 127 : r < -127 ? -127 : r);
+    }
+    return static_cast<float>(peak / 127.0);
+}
+
+// The batch in the form the table's dot kernel reads: int8 rows with a
+// scale each, or float32 rows, padded to the weight stride with zeros.
+struct Inputs {
+    std::vector<int8_t> q;
+    std::vector<float> scales;
+    std::vector<float> f;
+};
+
+void prepareInputs(const QuantMatrix &w, const double *x, size_t n, Inputs &in) {
+    size_t s = w.stride;
+    if (w.format == QuantFormat::Int8) {
+        in.q.assign(n * s, 0);
+        in.scales.resize(n);
+        for (size_t b = 0; b < n; ++b) in.scales[b] = quantizeRow(x + b * w.cols, w.cols, in.q.data() + b * s);
+    } else {
+        in.f.assign(n * s, 0.0f);
+        for (size_t b = 0; b < n; ++b)
+            for (size_t j = 0; j < w.cols; ++j) in.f[b * s + j] = static_cast<float>(x[b * w.cols + j]);
+    }
+}
+
+struct MatMul {
+    const QuantKernels *k;
+    const QuantMatrix *w;
+    const Inputs *in;
+    size_t n;
+    double *y;
+};
+
+// Weight rows [lo * kRowBlock, hi * kRowBlock) against every input: a
+// block of weights stays in cache while the whole batch passes over it.
+void runRows(void *ctx, int64_t lo, int64_t hi) {
+    auto *m = static_cast<MatMul *>(ctx);
+    const QuantMatrix &w = *m->w;
+    size_t s = w.stride;
+    size_t end = static_cast<size_t>(hi) * kRowBlock < w.rows ? static_cast<size_t>(hi) * kRowBlock : w.rows;
+    for (size_t i = static_cast<size_t>(lo) * kRowBlock; i < end; ++i) {
+        for (size_t b = 0; b < m->n; ++b) {
+            double v;
+            if (w.format == QuantFormat::Int8)
+                v = static_cast<double>(m->k->dotI8(w.q.data() + i * s, m->in->q.data() + b * s, s)) *
+                    (static_cast<double>(w.scales[i]) * m->in->scales[b]);
+            else if (w.format == QuantFormat::Fp16)
+                v = m->k->dotF16(w.h.data() + i * s, m->in->f.data() + b * s, s);
+            else
+                v = m->k->dotBf16(w.h.data() + i * s, m->in->f.data() + b * s, s);
+            m->y[b * w.rows + i] = v;
+        }
+    }
+}
+
+} // namespace
+
+std::vector<const QuantKernels *> availableQuantKernels() {
+    std::vector<const QuantKernels *> tables{&kScalarKernels};
+#ifdef TOCIN_QUANT_NEON
+    tables.push_back(&kNeonKernels);
+#endif
+    if (const QuantKernels *avx2 = avx2QuantKernels())
+        if (cpuHasAvx2F16c()) tables.push_back(avx2);
+    if (const QuantKernels *vnni = vnniQuantKernels())
+        if (cpuHasVnni()) tables.push_back(vnni);
+    return tables;
+}
+
+const QuantKernels &quantKernels() {
+    static const QuantKernels *chosen = chooseKernels();
+    return *chosen;
+}
+
+size_t QuantMatrix::bytes() const {
+    return q.size() * sizeof(int8_t) + scales.size() * sizeof(float) + h.size() * sizeof(uint16_t);
+}
+
+bool quantizeMatrix(const double *w, size_t rows, size_t cols, QuantFormat format, QuantMatrix &out) {
+    if (format != QuantFormat::Int8 && format != QuantFormat::Fp16 && format != QuantFormat::Bf16) return false;
+    out = QuantMatrix{};
+    out.format = format;
+    out.rows = rows;
+    out.cols = cols;
+    out.stride = padded(cols);
+    if (format == QuantFormat::Int8) {
+        out.q.assign(rows * out.stride, 0);
+        out.scales.resize(rows);
+        for (size_t i = 0; i < rows; ++i) out.scales[i] = quantizeRow(w + i * cols, cols, out.q.data() + i * out.stride);
+        return true;
+    }
+    out.h.assign(rows * out.stride, 0);
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j) {
+            float f = static_cast<float>(w[i * cols + j]);
+            out.h[i * out.stride + j] = format == QuantFormat::Fp16 ? floatToHalf(f) : floatToBf16(f);
+        }
+    return true;
+}
+
+void dequantizeMatrix(const QuantMatrix &q, double *out) {
+    for (size_t i = 0; i < q.rows; ++i)
+        for (size_t j = 0; j < q.cols; ++j) {
+            size_t at = i * q.stride + j;
+            double v;
+            if (q.format == QuantFormat::Int8)
+                v = static_cast<double>(q.q[at]) * q.scales[i];
+            else if (q.format == QuantFormat::Fp16)
+                v = halfToFloat(q.h[at]);
+            else
+                v = bf16ToFloat(q.h[at]);
+            out[i * q.cols + j] = v;
+        }
+}
+
+void quantMatMul(const QuantKernels &k, const QuantMatrix &w, const double *x, size_t n, double *y) {
+    if (w.rows == 0 || n == 0) return;
+    Inputs in;
+    prepareInputs(w, x, n, in);
+    MatMul m{&k, &w, &in, n, y};
+    size_t blocks = (w.rows + kRowBlock - 1) / kRowBlock;
+    if (blocks > 1 && w.rows * w.stride * n >= kParallelWork)
+        __tocin_parallel_chunks(static_cast<int64_t>(blocks), runRows, &m);
+    else
+        runRows(&m, 0, static_cast<int64_t>(blocks));
+}
+
+void quantMatVec(const QuantKernels &k, const QuantMatrix &w, const double *x, double *y) {
+    quantMatMul(k, w, x, 1, y);
+}
+
+const QuantMatrix *quantMatrixOf(int64_t handle) { return reinterpret_cast<const QuantMatrix *>(handle); }
+
+} // namespace runtime
+} // namespace tocin
+
+// ---- builtins ----
+//
+// A handle is a heap-allocated QuantMatrix, 0 when quantize failed.
+
+namespace {
+
+using tocin::runtime::QuantMatrix;
+
+double *elementsOf(const int64_t *arr) {
+    return reinterpret_cast<double *>(const_cast<int64_t *>(arr) + 1);
+}
+
+const QuantMatrix *unwrap(int64_t h) { return tocin::runtime::quantMatrixOf(h); }
+
+} // namespace
+
+extern "C" {
+
+/**
+ * quantize(w, rows, cols, format): a compact copy of the rows x cols float
+ * matrix at the front of w, in format 0 (int8 with a scale per row), 1
+ * (IEEE half) or 2 (bfloat16). 0 for a bad shape or format.
+ */
+int64_t __tocin_quantize(const int64_t *w, int64_t rows, int64_t cols, int64_t format) {
+    if (rows <= 0 || cols <= 0 || lengthOf(w) < static_cast<size_t>(rows * cols)) return 0;
+    auto *q = new QuantMatrix;
+    if (!tocin::runtime::quantizeMatrix(elementsOf(w), static_cast<size_t>(rows), static_cast<size_t>(cols),
+                                        static_cast<tocin::runtime::QuantFormat>(format), *q)) {
+        delete q;
+        return 0;
+    }
+    return reinterpret_cast<int64_t>(q);
+}
+
+int64_t __tocin_qmat_free(int64_t h) {
+    delete reinterpret_cast<QuantMatrix *>(h);
+    return 0;
+}
+
+int64_t __tocin_qmat_rows(int64_t h) { return h ? static_cast<int64_t>(unwrap(h)->rows) : 0; }
+int64_t __tocin_qmat_cols(int64_t h) { return h ? static_cast<int64_t>(unwrap(h)->cols) : 0; }
+int64_t __tocin_qmat_bytes(int64_t h) { return h ? static_cast<int64_t>(unwrap(h)->bytes()) : 0; }
+
+// qmatDequantize(q, out): write the float matrix q stands for into out;
+// returns rows * cols, or 0 if out is too short.
+int64_t __tocin_qmat_dequantize(int64_t h, int64_t *out) {
+    const QuantMatrix *q = unwrap(h);
+    if (!q) return 0;
+    int64_t n = static_cast<int64_t>(q->rows * q->cols);
+    if (lengthOf(out) < static_cast<size_t>(n)) return 0;
+    tocin::runtime::dequantizeMatrix(*q, elementsOf(out));
+    return n;
+}
+
+/**
+ * qmatVec(q, x, y[, xOff, yOff]): y[yOff + i] = sum_j W[i, j] * x[xOff + j]
+ * for the rows of q. Panics like an index out of range if x or y is too
+ * short.
+ */
+int64_t __tocin_qmat_vec(int64_t h, const int64_t *x, int64_t *y, int64_t xOff, int64_t yOff) {
+    const QuantMatrix *q = unwrap(h);
+    if (!q) return 0;
+    requireRange(x, xOff, static_cast<int64_t>(q->cols));
+    requireRange(y, yOff, static_cast<int64_t>(q->rows));
+    tocin::runtime::quantMatVec(tocin::runtime::quantKernels(), *q, elementsOf(x) + xOff, elementsOf(y) + yOff);
+    return 0;
+}
+
+/**
+ * qmatMul(q, x, y, n[, xOff, yOff]): y(n x rows) = x(n x cols) * W^T, the
+ * quantized counterpart of gemmF64NT for a batch of n inputs.
+ */
+int64_t __tocin_qmat_mul(int64_t h, const int64_t *x, int64_t *y, int64_t n, int64_t xOff, int64_t yOff) {
+    const QuantMatrix *q = unwrap(h);
+    if (!q || n <= 0) return 0;
+    requireRange(x, xOff, n * static_cast<int64_t>(q->cols));
+    requireRange(y, yOff, n * static_cast<int64_t>(q->rows));
+    tocin::runtime::quantMatMul(tocin::runtime::quantKernels(), *q, elementsOf(x) + xOff, static_cast<size_t>(n),
+                                elementsOf(y) + yOff);
+    return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,99 @@
+#ifndef TOCIN_QUANT_KERNELS_H
+#define TOCIN_QUANT_KERNELS_H
+
+/**
+ * Quantized weight matrices for inference, behind the quantize / qmat*
+ * builtins (quant_kernels.cpp) and tensorMatmulQ.
+ *
+ * A QuantMatrix stores an out x in float64 weight matrix in one of three
+ * compact forms: int8 with one float scale per row (4 bytes per 32 weights
+ * of overhead, 8x smaller than float64), or IEEE half / bfloat16 (4x
+ * smaller). Rows are zero-padded to a multiple of kQuantPad so the dot
+ * kernels never need a tail loop.
+ *
+ * quantMatVec() multiplies by a float64 vector. For int8 weights the
+ * vector is quantized too, symmetrically with a single scale, and each row
+ * is an int8 x int8 dot product summed in int32 and rescaled once; for the
+ * 16-bit forms each row is widened to float32 lanes and multiplied against
+ * the vector converted to float32. Rows run in parallel on the
+ * parallel_for pool once there is enough work.
+ *
+ * As with the linalg kernels, every instruction set gets one table and
+ * quantKernels() picks the best one the CPU supports (AVX-512 VNNI, then
+ * AVX2 + F16C, then NEON dot-product on AArch64, otherwise scalar).
+ * TOCIN_QUANT_KERNELS forces a table by name.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+enum class QuantFormat { Int8 = 0, Fp16 = 1, Bf16 = 2 };
+
+// Row padding, in elements: one 512-bit register of int8 lanes.
+constexpr size_t kQuantPad = 64;
+
+struct QuantKernels {
+    const char *name;
+    // sum_i w[i] * x[i] in int32 over n (a multiple of kQuantPad) int8
+    // lanes. Inputs lie in [-127, 127].
+    int32_t (*dotI8)(const int8_t *w, const int8_t *x, size_t n);
+    // sum_i half(w[i]) * x[i] over n (a multiple of kQuantPad) lanes.
+    float (*dotF16)(const uint16_t *w, const float *x, size_t n);
+    // The same for bfloat16 weights.
+    float (*dotBf16)(const uint16_t *w, const float *x, size_t n);
+};
+
+// The table the runtime uses.
+const QuantKernels &quantKernels();
+
+// Every table this CPU can run, portable one first.
+std::vector<const QuantKernels *> availableQuantKernels();
+
+// Defined in quant_kernels_avx2.cpp and quant_kernels_vnni.cpp, the only
+// files built for those instruction sets; nullptr when the compiler cannot
+// target them.
+const QuantKernels *avx2QuantKernels();
+const QuantKernels *vnniQuantKernels();
+
+struct QuantMatrix {
+    QuantFormat format = QuantFormat::Int8;
+    size_t rows = 0, cols = 0;
+    size_t stride = 0;            // cols rounded up to kQuantPad
+    std::vector<int8_t> q;        // int8: rows * stride
+    std::vector<float> scales;    // int8: one per row
+    std::vector<uint16_t> h;      // fp16 / bf16: rows * stride
+
+    // Bytes of weight storage (what the matrix costs in memory).
+    size_t bytes() const;
+};
+
+// Round-to-nearest-even conversions, used by quantize() and the scalar
+// table.
+uint16_t floatToHalf(float f);
+float halfToFloat(uint16_t h);
+uint16_t floatToBf16(float f);
+float bf16ToFloat(uint16_t h);
+
+// Quantize w (rows x cols, row-major); false for an unknown format.
+bool quantizeMatrix(const double *w, size_t rows, size_t cols, QuantFormat format, QuantMatrix &out);
+
+// The float64 matrix q approximates, rows x cols row-major.
+void dequantizeMatrix(const QuantMatrix &q, double *out);
+
+// y(rows) = W * x(cols); y must not overlap x.
+void quantMatVec(const QuantKernels &k, const QuantMatrix &w, const double *x, double *y);
+
+// y(n x rows) = x(n x cols) * W^T, a batch of inputs through the layer.
+void quantMatMul(const QuantKernels &k, const QuantMatrix &w, const double *x, size_t n, double *y);
+
+// The matrix behind a quantize() handle; nullptr for 0.
+const QuantMatrix *quantMatrixOf(int64_t handle);
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_QUANT_KERNELS_H
@@ -0,0 +1,67 @@
+// The AVX2 + F16C quantized kernels. This is the only runtime file built
+// with -mavx2 -mfma -mf16c (see CMakeLists.txt); quantKernels() calls into
+// it only after checking the CPU.
+#include "quant_kernels_impl.h"
+
+#if defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#if defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+namespace {
+
+struct Avx2 {
+    using IAcc = __m256i;
+    using FAcc = __m256;
+    static constexpr size_t kI8 = 32;
+    static constexpr size_t kF32 = 8;
+
+    static IAcc izero() { return _mm256_setzero_si256(); }
+    // maddubs wants unsigned x signed bytes: |w| times x with w's sign.
+    // Both inputs lie in [-127, 127], so a pair sums to at most 2 * 127^2
+    // and the int16 step never saturates.
+    static IAcc dotI8(IAcc acc, const int8_t *w, const int8_t *x) {
+        __m256i wv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w));
+        __m256i xv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x));
+        __m256i pairs = _mm256_maddubs_epi16(_mm256_abs_epi8(wv), _mm256_sign_epi8(xv, wv));
+        return _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, _mm256_set1_epi16(1)));
+    }
+    static int32_t isum(IAcc v) {
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+        return _mm_cvtsi128_si32(s);
+    }
+
+    static FAcc fzero() { return _mm256_setzero_ps(); }
+    static FAcc loadF16(const uint16_t *p) {
+        return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+    }
+    static FAcc loadBf16(const uint16_t *p) {
+        __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+    }
+    static FAcc loadF(const float *p) { return _mm256_loadu_ps(p); }
+    static FAcc fma(FAcc a, FAcc b, FAcc acc) { return _mm256_fmadd_ps(a, b, acc); }
+    static FAcc fadd(FAcc a, FAcc b) { return _mm256_add_ps(a, b); }
+    static float fsum(FAcc v) {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        return _mm_cvtss_f32(_mm_add_ss(s, _mm_movehdup_ps(s)));
+    }
+};
+
+constexpr QuantKernels kAvx2Kernels = quantTable<Avx2>("avx2");
+
+} // namespace
+
+const QuantKernels *avx2QuantKernels() { return &kAvx2Kernels; }
+#else
+const QuantKernels *avx2QuantKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
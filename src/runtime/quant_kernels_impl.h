@@ -0,0 +1,63 @@
+#ifndef TOCIN_QUANT_KERNELS_IMPL_H
+#define TOCIN_QUANT_KERNELS_IMPL_H
+
+// Dot-product bodies shared by every instruction set, written against a
+// small vector interface:
+//
+//   IAcc izero()             int32 accumulator lanes, all 0
+//   kI8                      int8 lanes one dotI8 step consumes
+//   dotI8(acc, w, x)         acc + the kI8-lane products w * x, in int32
+//   isum(acc)                sum of the int32 lanes
+//   FAcc fzero()             float32 lanes, all 0
+//   kF32                     float32 lanes per step
+//   loadF16(p) loadBf16(p)   kF32 16-bit weights widened to float32
+//   loadF(p)                 kF32 floats
+//   fma(a, b, acc) fadd(a, b) fsum(v)
+//
+// Each body keeps two accumulators while it can, so consecutive steps do
+// not wait on each other. Like the other *_impl.h kernels this is only
+// included by the kernel files and everything has internal linkage, so code
+// built for a wider instruction set never ends up shared with the baseline
+// file.
+
+#include "quant_kernels.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tocin {
+namespace runtime {
+namespace {
+
+template <class V> int32_t dotI8Body(const int8_t *w, const int8_t *x, size_t n) {
+    auto a0 = V::izero(), a1 = V::izero();
+    size_t i = 0;
+    for (; i + 2 * V::kI8 <= n; i += 2 * V::kI8) {
+        a0 = V::dotI8(a0, w + i, x + i);
+        a1 = V::dotI8(a1, w + i + V::kI8, x + i + V::kI8);
+    }
+    for (; i < n; i += V::kI8) a0 = V::dotI8(a0, w + i, x + i);
+    return V::isum(a0) + V::isum(a1);
+}
+
+template <class V, bool Bf16> float dot16Body(const uint16_t *w, const float *x, size_t n) {
+    auto a0 = V::fzero(), a1 = V::fzero();
+    auto load = [](const uint16_t *p) { return Bf16 ? V::loadBf16(p) : V::loadF16(p); };
+    size_t i = 0;
+    for (; i + 2 * V::kF32 <= n; i += 2 * V::kF32) {
+        a0 = V::fma(load(w + i), V::loadF(x + i), a0);
+        a1 = V::fma(load(w + i + V::kF32), V::loadF(x + i + V::kF32), a1);
+    }
+    for (; i < n; i += V::kF32) a0 = V::fma(load(w + i), V::loadF(x + i), a0);
+    return V::fsum(V::fadd(a0, a1));
+}
+
+template <class V> constexpr QuantKernels quantTable(const char *name) {
+    return QuantKernels{name, dotI8Body<V>, dot16Body<V, false>, dot16Body<V, true>};
+}
+
+} // namespace
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_QUANT_KERNELS_IMPL_H
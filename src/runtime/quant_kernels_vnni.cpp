@@ -0,0 +1,57 @@
+// The AVX-512 VNNI quantized kernels. This is the only runtime file built
+// with -mavx512f -mavx512bw -mavx512vnni (see CMakeLists.txt);
+// quantKernels() calls into it only after checking the CPU.
+#include "quant_kernels_impl.h"
+
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VNNI__)
+#include <immintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VNNI__)
+namespace {
+
+struct Vnni {
+    using IAcc = __m512i;
+    using FAcc = __m512;
+    static constexpr size_t kI8 = 64;
+    static constexpr size_t kF32 = 16;
+
+    static IAcc izero() { return _mm512_setzero_si512(); }
+    // vpdpbusd multiplies unsigned by signed bytes and sums each group of
+    // four straight into an int32 lane: |w| against x negated where w < 0.
+    static IAcc dotI8(IAcc acc, const int8_t *w, const int8_t *x) {
+        __m512i wv = _mm512_loadu_si512(w);
+        __m512i xv = _mm512_loadu_si512(x);
+        __m512i sx = _mm512_mask_sub_epi8(xv, _mm512_movepi8_mask(wv), _mm512_setzero_si512(), xv);
+        return _mm512_dpbusd_epi32(acc, _mm512_abs_epi8(wv), sx);
+    }
+    static int32_t isum(IAcc v) { return _mm512_reduce_add_epi32(v); }
+
+    static FAcc fzero() { return _mm512_setzero_ps(); }
+    static FAcc loadF16(const uint16_t *p) {
+        return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+    }
+    static FAcc loadBf16(const uint16_t *p) {
+        __m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16));
+    }
+    static FAcc loadF(const float *p) { return _mm512_loadu_ps(p); }
+    static FAcc fma(FAcc a, FAcc b, FAcc acc) { return _mm512_fmadd_ps(a, b, acc); }
+    static FAcc fadd(FAcc a, FAcc b) { return _mm512_add_ps(a, b); }
+    static float fsum(FAcc v) { return _mm512_reduce_add_ps(v); }
+};
+
+constexpr QuantKernels kVnniKernels = quantTable<Vnni>("avx512vnni");
+
+} // namespace
+
+const QuantKernels *vnniQuantKernels() { return &kVnniKernels; }
+#else
+const QuantKernels *vnniQuantKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,210 @@
+// The merging t-digest (see quantile_sketch.h) and the tdigest* builtins.
+#include "quantile_sketch.h"
+#include "kernel_support.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// The scale function and its inverse, for a given compression.
+double scaleK(double q, double compression) { return compression / (2 * kPi) * std::asin(2 * q - 1); }
+double scaleQ(double k, double compression) {
+    double q = (std::sin(std::min(k * 2 * kPi / compression, kPi / 2)) + 1) / 2;
+    return std::min(q, 1.0);
+}
+
+} // namespace
+
+TDigest::TDigest(double compression)
+    : compression_(compression >= 10 ? compression : kDefaultCompression),
+      bufferCap_(static_cast<size_t>(compression_) * 5) {
+    buffer_.reserve(bufferCap_);
+}
+
+void TDigest::add(double x, double weight) {
+    if (std::isnan(x) || !(weight > 0)) return;
+    if (total_ == 0) {
+        min_ = max_ = x;
+    } else {
+        min_ = std::min(min_, x);
+        max_ = std::max(max_, x);
+    }
+    total_ += weight;
+    buffer_.push_back({x, weight});
+    if (buffer_.size() >= bufferCap_) flush();
+}
+
+void TDigest::merge(const TDigest &other) {
+    if (other.total_ == 0) return;
+    if (total_ == 0) {
+        min_ = other.min_;
+        max_ = other.max_;
+    } else {
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+    for (const auto *part : {&other.centroids_, &other.buffer_}) {
+        for (const Centroid &c : *part) {
+            total_ += c.weight;
+            buffer_.push_back(c);
+            if (buffer_.size() >= bufferCap_) flush();
+        }
+    }
+}
+
+void TDigest::flush() {
+    if (buffer_.empty()) return;
+    buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+    std::sort(buffer_.begin(), buffer_.end(),
+              [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; });
+    centroids_.clear();
+
+    // One sweep: grow the current centroid while it stays inside one unit
+    // of k, measured from where it started.
+    Centroid cur = buffer_[0];
+    double before = 0; // weight of the centroids already emitted
+    double limit = total_ * scaleQ(scaleK(0, compression_) + 1, compression_);
+    for (size_t i = 1; i < buffer_.size(); ++i) {
+        const Centroid &c = buffer_[i];
+        if (before + cur.weight + c.weight <= limit) {
+            cur.weight += c.weight;
+            cur.mean += (c.mean - cur.mean) * c.weight / cur.weight;
+        } else {
+            centroids_.push_back(cur);
+            before += cur.weight;
+            limit = total_ * scaleQ(scaleK(before / total_, compression_) + 1, compression_);
+            cur = c;
+        }
+    }
+    centroids_.push_back(cur);
+    buffer_.clear();
+}
+
+size_t TDigest::centroids() {
+    flush();
+    return centroids_.size();
+}
+
+double TDigest::quantile(double q) {
+    flush();
+    if (centroids_.empty()) return 0;
+    const double index = std::clamp(q, 0.0, 1.0) * total_;
+    const Centroid &first = centroids_.front(), &last = centroids_.back();
+    // The outermost unit of weight is the minimum or maximum itself; past
+    // it, out to the first (last) mean, interpolate towards that mean.
+    if (index < 1) return min_;
+    if (first.weight > 1 && index < first.weight / 2)
+        return min_ + (index - 1) / (first.weight / 2 - 1) * (first.mean - min_);
+    if (index > total_ - 1) return max_;
+    if (last.weight > 1 && total_ - index <= last.weight / 2)
+        return max_ - (total_ - index - 1) / (last.weight / 2 - 1) * (max_ - last.mean);
+
+    // Each mean sits at the middle of its centroid's weight. A centroid of
+    // one value owns half a unit either side of it and is returned as is.
+    double cum = first.weight / 2;
+    for (size_t i = 0; i + 1 < centroids_.size(); ++i) {
+        const Centroid &a = centroids_[i], &b = centroids_[i + 1];
+        const double gap = (a.weight + b.weight) / 2;
+        if (index < cum + gap) {
+            double left = 0, right = 0;
+            if (a.weight == 1) {
+                if (index - cum < 0.5) return a.mean;
+                left = 0.5;
+            }
+            if (b.weight == 1) {
+                if (cum + gap - index <= 0.5) return b.mean;
+                right = 0.5;
+            }
+            const double toA = index - cum - left, toB = cum + gap - index - right;
+            return (a.mean * toB + b.mean * toA) / (toA + toB);
+        }
+        cum += gap;
+    }
+    return last.mean;
+}
+
+double TDigest::cdf(double x) {
+    flush();
+    if (centroids_.empty()) return 0;
+    if (x < min_) return 0;
+    if (x > max_) return 1;
+    if (min_ == max_) return 0.5;
+    const size_t n = centroids_.size();
+    const Centroid &first = centroids_[0];
+    if (x < first.mean) {
+        return first.mean > min_ ? (first.weight / 2) * (x - min_) / (first.mean - min_) / total_ : 0;
+    }
+    double cum = first.weight / 2;
+    for (size_t i = 0; i + 1 < n; ++i) {
+        const Centroid &a = centroids_[i], &b = centroids_[i + 1];
+        const double gap = (a.weight + b.weight) / 2;
+        if (x < b.mean) {
+            if (x == a.mean) return cum / total_;
+            return (cum + gap * (x - a.mean) / (b.mean - a.mean)) / total_;
+        }
+        cum += gap;
+    }
+    const Centroid &last = centroids_[n - 1];
+    if (x == last.mean || max_ == last.mean) return cum / total_;
+    return (cum + (total_ - cum) * (x - last.mean) / (max_ - last.mean)) / total_;
+}
+
+} // namespace runtime
+} // namespace tocin
+
+// ---- builtins ----
+//
+// A digest is an int handle; values and quantiles are floats.
+
+namespace {
+
+using tocin::runtime::TDigest;
+
+TDigest *of(int64_t h) { return reinterpret_cast<TDigest *>(h); }
+
+} // namespace
+
+extern "C" {
+
+// tdigestNew(compression): about `compression` centroids; below 10 means
+// the default of 100.
+int64_t __tocin_tdigest_new(int64_t compression) {
+    return reinterpret_cast<int64_t>(new TDigest(static_cast<double>(compression)));
+}
+
+int64_t __tocin_tdigest_free(int64_t td) {
+    delete of(td);
+    return 0;
+}
+
+int64_t __tocin_tdigest_add(int64_t td, double x) {
+    if (td) of(td)->add(x);
+    return 0;
+}
+
+// tdigestAddAll(td, xs): every element of a list<float>.
+int64_t __tocin_tdigest_add_all(int64_t td, int64_t *xs) {
+    size_t n = lengthOf(xs);
+    if (!td) return 0;
+    const double *v = reinterpret_cast<const double *>(xs + 1);
+    for (size_t i = 0; i < n; ++i) of(td)->add(v[i]);
+    return static_cast<int64_t>(n);
+}
+
+// tdigestMerge(into, from): from's values added to into; from is unchanged.
+int64_t __tocin_tdigest_merge(int64_t into, int64_t from) {
+    if (into && from && into != from) of(into)->merge(*of(from));
+    return 0;
+}
+
+double __tocin_tdigest_quantile(int64_t td, double q) { return td ? of(td)->quantile(q) : 0; }
+double __tocin_tdigest_cdf(int64_t td, double x) { return td ? of(td)->cdf(x) : 0; }
+int64_t __tocin_tdigest_count(int64_t td) { return td ? static_cast<int64_t>(of(td)->count()) : 0; }
+
+} // extern "C"
@@ -0,0 +1,75 @@
+#ifndef TOCIN_QUANTILE_SKETCH_H
+#define TOCIN_QUANTILE_SKETCH_H
+
+/**
+ * Streaming quantiles behind the tdigest* builtins (__tocin_tdigest_* in
+ * quantile_sketch.cpp), which math.stats documents next to its exact
+ * quantile().
+ *
+ * TDigest is Dunning's merging t-digest. Values are buffered unsorted; when
+ * the buffer fills, it is sorted together with the current centroids and
+ * swept once, merging neighbours while the merged centroid stays within one
+ * unit of the scale function k(q) = compression / (2 pi) * asin(2q - 1).
+ * That allows about `compression` centroids in all, and makes the ones near
+ * q = 0 and q = 1 small, so p99 and p99.9 keep a relative error far below
+ * the median's. Memory is O(compression) however many values are added.
+ *
+ * Two digests merge by feeding one's centroids to the other, so partitions
+ * digested in parallel combine into the digest of the whole. quantile()
+ * interpolates between centroid means (each centred on its share of the
+ * weight), between the minimum and the first centroid, and between the last
+ * centroid and the maximum. A centroid holding a single value answers with
+ * that value, so with few values every quantile is one of them.
+ *
+ * A digest is not synchronized: each goroutine fills its own and they are
+ * merged afterwards.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+class TDigest {
+public:
+    static constexpr double kDefaultCompression = 100;
+
+    explicit TDigest(double compression = kDefaultCompression);
+
+    void add(double x, double weight = 1);
+    void merge(const TDigest &other);
+
+    // The value below which a fraction q of the weight lies, q clamped to
+    // [0, 1]; 0 when empty.
+    double quantile(double q);
+    // The fraction of the weight below x (half of any weight at x).
+    double cdf(double x);
+
+    double count() const { return total_; }
+    double min() const { return min_; }
+    double max() const { return max_; }
+    // Centroids once the buffer is folded in: O(compression).
+    size_t centroids();
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    void flush();
+
+    double compression_;
+    size_t bufferCap_;
+    std::vector<Centroid> centroids_; // sorted by mean
+    std::vector<Centroid> buffer_;
+    double total_ = 0;  // centroids_ and buffer_
+    double min_ = 0, max_ = 0;
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_QUANTILE_SKETCH_H
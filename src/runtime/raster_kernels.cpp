@@ -0,0 +1,219 @@
+// Raster kernels: the portable table, the SSE2 table on x86-64, the
+// dispatch that picks among them and the AVX2 table, the clipped
+// primitives, and the fb* builtins' entry points.
+#include "raster_kernels_impl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TOCIN_RASTER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+void fillScalar(uint32_t *p, size_t n, uint32_t color) { std::fill_n(p, n, color); }
+
+void blendColorScalar(uint32_t *dst, size_t n, uint32_t color) {
+    if ((color >> 24) == 255) return fillScalar(dst, n, color);
+    if ((color >> 24) == 0) return;
+    for (size_t i = 0; i < n; ++i) dst[i] = blendPixel(color, dst[i]);
+}
+
+void blendScalar(uint32_t *dst, const uint32_t *src, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = blendPixel(src[i], dst[i]);
+}
+
+constexpr RasterKernels kScalarKernels{"scalar", &fillScalar, &blendColorScalar, &blendScalar};
+
+#ifdef TOCIN_RASTER_SSE2
+struct Sse2 {
+    using Vec = __m128i;
+    using Wide = __m128i;
+    static constexpr size_t kPixels = 4;
+
+    static Vec load(const uint32_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+    static void store(uint32_t *p, Vec v) { _mm_storeu_si128((__m128i *)p, v); }
+    static Vec splat(uint32_t c) { return _mm_set1_epi32((int)c); }
+    static Wide lo(Vec v) { return _mm_unpacklo_epi8(v, _mm_setzero_si128()); }
+    static Wide hi(Vec v) { return _mm_unpackhi_epi8(v, _mm_setzero_si128()); }
+    static Vec pack(Wide l, Wide h) { return _mm_packus_epi16(l, h); }
+    static Wide alphas(Wide w) { return _mm_shufflehi_epi16(_mm_shufflelo_epi16(w, 0xff), 0xff); }
+    static Wide opaque(Wide w) { return _mm_or_si128(w, _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0)); }
+    static Wide add(Wide a, Wide b) { return _mm_add_epi16(a, b); }
+    static Wide sub(Wide a, Wide b) { return _mm_sub_epi16(a, b); }
+    static Wide mul(Wide a, Wide b) { return _mm_mullo_epi16(a, b); }
+    static Wide shr8(Wide w) { return _mm_srli_epi16(w, 8); }
+    static Wide wide(int16_t k) { return _mm_set1_epi16(k); }
+};
+
+constexpr RasterKernels kSse2Kernels = rasterTable<Sse2>("sse2");
+#endif
+
+bool cpuHasAvx2() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+const RasterKernels *chooseKernels() {
+    auto available = availableRasterKernels();
+    if (const char *forced = std::getenv("TOCIN_RASTER_KERNELS")) {
+        for (const auto *table : available)
+            if (std::strcmp(table->name, forced) == 0) return table;
+    }
+    return available.back();
+}
+
+// The pixels of fb's rectangle (x, y, w, h) after clipping: columns
+// [x0, x1) of rows [y0, y1). False when nothing is left.
+struct Clip {
+    int64_t x0, y0, x1, y1;
+};
+
+bool clipRect(Framebuffer fb, int64_t x, int64_t y, int64_t w, int64_t h, Clip &c) {
+    if (!fb.pixels || w <= 0 || h <= 0) return false;
+    c.x0 = std::max<int64_t>(x, 0);
+    c.y0 = std::max<int64_t>(y, 0);
+    c.x1 = x > fb.width - w ? fb.width : x + w;
+    c.y1 = y > fb.height - h ? fb.height : y + h;
+    return c.x0 < c.x1 && c.y0 < c.y1;
+}
+
+uint32_t *row(Framebuffer fb, int64_t y) { return fb.pixels + y * fb.width; }
+
+// Largest s with s * s <= v.
+int64_t isqrt(int64_t v) {
+    int64_t s = static_cast<int64_t>(std::sqrt(static_cast<double>(v)));
+    while (s > 0 && s > v / s) --s;
+    while ((s + 1) <= v / (s + 1)) ++s;
+    return s;
+}
+
+// Beyond this r * r overflows; such a disc covers any framebuffer near it.
+constexpr int64_t kMaxRadius = 3037000499;
+
+} // namespace
+
+std::vector<const RasterKernels *> availableRasterKernels() {
+    std::vector<const RasterKernels *> tables{&kScalarKernels};
+#ifdef TOCIN_RASTER_SSE2
+    tables.push_back(&kSse2Kernels);
+#endif
+    if (const RasterKernels *avx2 = avx2RasterKernels())
+        if (cpuHasAvx2()) tables.push_back(avx2);
+    return tables;
+}
+
+const RasterKernels &rasterKernels() {
+    static const RasterKernels *chosen = chooseKernels();
+    return *chosen;
+}
+
+void fillRect(const RasterKernels &k, Framebuffer fb, int64_t x, int64_t y, int64_t w, int64_t h,
+              uint32_t color) {
+    Clip c;
+    if (!clipRect(fb, x, y, w, h, c)) return;
+    if (c.x0 == 0 && c.x1 == fb.width) {  // whole rows: one span
+        k.fill(row(fb, c.y0), static_cast<size_t>((c.y1 - c.y0) * fb.width), color);
+        return;
+    }
+    for (int64_t yy = c.y0; yy < c.y1; ++yy) k.fill(row(fb, yy) + c.x0, static_cast<size_t>(c.x1 - c.x0), color);
+}
+
+void blendRect(const RasterKernels &k, Framebuffer fb, int64_t x, int64_t y, int64_t w, int64_t h,
+               uint32_t color) {
+    Clip c;
+    if (!clipRect(fb, x, y, w, h, c)) return;
+    for (int64_t yy = c.y0; yy < c.y1; ++yy)
+        k.blendColor(row(fb, yy) + c.x0, static_cast<size_t>(c.x1 - c.x0), color);
+}
+
+void fillCircle(const RasterKernels &k, Framebuffer fb, int64_t cx, int64_t cy, int64_t r, uint32_t color) {
+    if (!fb.pixels || r < 0) return;
+    r = std::min(r, kMaxRadius);
+    // A disc this far out misses the framebuffer; past here nothing overflows.
+    if (cx < -r || cy < -r || cx > fb.width + r || cy > fb.height + r) return;
+    int64_t y0 = std::max(cy - r, int64_t(0)), y1 = std::min(cy + r, fb.height - 1);
+    for (int64_t yy = y0; yy <= y1; ++yy) {
+        int64_t dy = yy - cy;
+        int64_t half = isqrt(r * r - dy * dy);
+        int64_t x0 = std::max(cx - half, int64_t(0)), x1 = std::min(cx + half, fb.width - 1);
+        if (x0 <= x1) k.fill(row(fb, yy) + x0, static_cast<size_t>(x1 - x0 + 1), color);
+    }
+}
+
+void blit(const RasterKernels &k, Framebuffer dst, int64_t x, int64_t y, Framebuffer src, bool blended) {
+    Clip c;
+    if (!src.pixels || !clipRect(dst, x, y, src.width, src.height, c)) return;
+    size_t n = static_cast<size_t>(c.x1 - c.x0);
+    for (int64_t yy = c.y0; yy < c.y1; ++yy) {
+        const uint32_t *from = row(src, yy - y) + (c.x0 - x);
+        uint32_t *to = row(dst, yy) + c.x0;
+        if (blended)
+            k.blend(to, from, n);
+        else
+            std::memmove(to, from, n * sizeof(uint32_t));
+    }
+}
+
+} // namespace runtime
+} // namespace tocin
+
+namespace {
+
+// A framebuffer builtin's (address, width, height); negative sizes are empty.
+tocin::runtime::Framebuffer framebuffer(int64_t fb, int64_t width, int64_t height) {
+    if (width <= 0 || height <= 0) return {nullptr, 0, 0};
+    return {reinterpret_cast<uint32_t *>(fb), width, height};
+}
+
+uint32_t color(int64_t c) { return static_cast<uint32_t>(c); }
+
+} // namespace
+
+extern "C" {
+
+// fbFillRect / fbBlendRect(fb, width, height, x, y, w, h, color): fill or
+// blend the clipped rectangle with a packed 0xAABBGGRR color.
+int64_t __tocin_fb_fill_rect(int64_t fb, int64_t width, int64_t height, int64_t x, int64_t y, int64_t w,
+                             int64_t h, int64_t c) {
+    tocin::runtime::fillRect(tocin::runtime::rasterKernels(), framebuffer(fb, width, height), x, y, w, h,
+                             color(c));
+    return 0;
+}
+
+int64_t __tocin_fb_blend_rect(int64_t fb, int64_t width, int64_t height, int64_t x, int64_t y, int64_t w,
+                              int64_t h, int64_t c) {
+    tocin::runtime::blendRect(tocin::runtime::rasterKernels(), framebuffer(fb, width, height), x, y, w, h,
+                              color(c));
+    return 0;
+}
+
+// fbFillCircle(fb, width, height, cx, cy, r, color).
+int64_t __tocin_fb_fill_circle(int64_t fb, int64_t width, int64_t height, int64_t cx, int64_t cy, int64_t r,
+                               int64_t c) {
+    tocin::runtime::fillCircle(tocin::runtime::rasterKernels(), framebuffer(fb, width, height), cx, cy, r,
+                               color(c));
+    return 0;
+}
+
+// fbBlit / fbBlendBlit(dst, width, height, x, y, src, srcWidth, srcHeight):
+// copy or blend all of src with its top-left corner at (x, y).
+int64_t __tocin_fb_blit(int64_t dst, int64_t width, int64_t height, int64_t x, int64_t y, int64_t src,
+                        int64_t srcWidth, int64_t srcHeight, int64_t blended) {
+    tocin::runtime::blit(tocin::runtime::rasterKernels(), framebuffer(dst, width, height), x, y,
+                         framebuffer(src, srcWidth, srcHeight), blended != 0);
+    return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,76 @@
+#ifndef TOCIN_RASTER_KERNELS_H
+#define TOCIN_RASTER_KERNELS_H
+
+/**
+ * Span kernels and clipped primitives behind game.graphics' framebuffer
+ * builtins (__tocin_fb_* in raster_kernels.cpp).
+ *
+ * A framebuffer is width * height RGBA8 pixels, row-major, with R at the
+ * lowest byte address. Read as a little-endian uint32 that is the
+ * 0xAABBGGRR color game.shader's packColor builds. Every primitive clips its
+ * rectangle, circle rows or blit source to the framebuffer once, up front.
+ * The inner loops then run whole unclipped spans through the table.
+ *
+ * As with the other runtime kernels there is one table per instruction set
+ * and rasterKernels() picks the best one the CPU supports: AVX2, then SSE2 on
+ * x86-64, otherwise portable code. TOCIN_RASTER_KERNELS forces a table by
+ * name ("avx2", "sse2", "scalar").
+ *
+ * Blending is straight-alpha source-over:
+ *   out.rgb = (src.rgb * a + dst.rgb * (255 - a)) / 255
+ *   out.a   = (255     * a + dst.a   * (255 - a)) / 255
+ * where a = src.a and each division rounds to nearest. Every table computes
+ * exactly the same bytes.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+struct RasterKernels {
+    const char *name;
+    // p[0, n) = color.
+    void (*fill)(uint32_t *p, size_t n, uint32_t color);
+    // Blend color over dst[0, n).
+    void (*blendColor)(uint32_t *dst, size_t n, uint32_t color);
+    // Blend src[0, n) over dst[0, n).
+    void (*blend)(uint32_t *dst, const uint32_t *src, size_t n);
+};
+
+// The table the runtime uses.
+const RasterKernels &rasterKernels();
+
+// Every table this CPU can run, portable one first.
+std::vector<const RasterKernels *> availableRasterKernels();
+
+// Defined in raster_kernels_avx2.cpp, the only file built with AVX2
+// enabled; nullptr when the compiler cannot target AVX2.
+const RasterKernels *avx2RasterKernels();
+
+// A width x height framebuffer.
+struct Framebuffer {
+    uint32_t *pixels;
+    int64_t width;
+    int64_t height;
+};
+
+// Fill or blend the rectangle (x, y, w, h), clipped.
+void fillRect(const RasterKernels &k, Framebuffer fb, int64_t x, int64_t y, int64_t w, int64_t h,
+              uint32_t color);
+void blendRect(const RasterKernels &k, Framebuffer fb, int64_t x, int64_t y, int64_t w, int64_t h,
+               uint32_t color);
+
+// Fill the disc of pixels with dx*dx + dy*dy <= r*r around (cx, cy), one
+// clipped span per row.
+void fillCircle(const RasterKernels &k, Framebuffer fb, int64_t cx, int64_t cy, int64_t r, uint32_t color);
+
+// Copy (or blend) the whole src image to (x, y) of dst, clipped.
+void blit(const RasterKernels &k, Framebuffer dst, int64_t x, int64_t y, Framebuffer src, bool blended);
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_RASTER_KERNELS_H
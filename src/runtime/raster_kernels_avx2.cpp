@@ -0,0 +1,50 @@
+// The AVX2 raster kernels. This is the only raster file built with -mavx2
+// (see CMakeLists.txt); rasterKernels() calls into it only after checking
+// the CPU.
+#include "raster_kernels_impl.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#ifdef __AVX2__
+namespace {
+
+// The byte unpacks, packs and 16-bit shuffles work within each 128-bit
+// half, so lo/hi/pack pair up the same pixels as in the SSE2 table.
+struct Avx2 {
+    using Vec = __m256i;
+    using Wide = __m256i;
+    static constexpr size_t kPixels = 8;
+
+    static Vec load(const uint32_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+    static void store(uint32_t *p, Vec v) { _mm256_storeu_si256((__m256i *)p, v); }
+    static Vec splat(uint32_t c) { return _mm256_set1_epi32((int)c); }
+    static Wide lo(Vec v) { return _mm256_unpacklo_epi8(v, _mm256_setzero_si256()); }
+    static Wide hi(Vec v) { return _mm256_unpackhi_epi8(v, _mm256_setzero_si256()); }
+    static Vec pack(Wide l, Wide h) { return _mm256_packus_epi16(l, h); }
+    static Wide alphas(Wide w) { return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(w, 0xff), 0xff); }
+    static Wide opaque(Wide w) {
+        return _mm256_or_si256(w, _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0));
+    }
+    static Wide add(Wide a, Wide b) { return _mm256_add_epi16(a, b); }
+    static Wide sub(Wide a, Wide b) { return _mm256_sub_epi16(a, b); }
+    static Wide mul(Wide a, Wide b) { return _mm256_mullo_epi16(a, b); }
+    static Wide shr8(Wide w) { return _mm256_srli_epi16(w, 8); }
+    static Wide wide(int16_t k) { return _mm256_set1_epi16(k); }
+};
+
+constexpr RasterKernels kAvx2Kernels = rasterTable<Avx2>("avx2");
+
+} // namespace
+
+const RasterKernels *avx2RasterKernels() { return &kAvx2Kernels; }
+#else
+const RasterKernels *avx2RasterKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
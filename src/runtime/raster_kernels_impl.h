@@ -0,0 +1,106 @@
+#ifndef TOCIN_RASTER_KERNELS_IMPL_H
+#define TOCIN_RASTER_KERNELS_IMPL_H
+
+// Span kernels shared by the SIMD tables, written against a small vector
+// interface over RGBA8 pixels:
+//
+//   Vec                    kPixels pixels
+//   load(p) store(p, v)    unaligned kPixels pixels at p
+//   splat(c)               every pixel c
+//   Wide                   16-bit lanes, one per byte of half a block
+//   lo(v) hi(v)            the low / high half's bytes, zero-extended
+//   pack(l, h)             the bytes of two halves again (lanes <= 255)
+//   alphas(w)              each pixel's alpha in all four of its lanes
+//   opaque(w)              w with every alpha lane set to 255
+//   add(a, b) sub(a, b) mul(a, b) shr8(w) wide(k)   lane-wise, k in all lanes
+//
+// blendPixel is the scalar definition the tails and the portable table use;
+// blendWide computes the same thing lane-wise. Like the other *_impl.h
+// kernels this is only included by the kernel files and everything has
+// internal linkage, so code built for AVX2 never ends up shared with the
+// baseline file.
+
+#include "raster_kernels.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TOCIN_RASTER_KERNEL __attribute__((always_inline)) inline
+#else
+#define TOCIN_RASTER_KERNEL inline
+#endif
+
+namespace tocin {
+namespace runtime {
+namespace {
+
+// round(v / 255) for v in [0, 255 * 255], without a division.
+TOCIN_RASTER_KERNEL uint32_t div255(uint32_t v) {
+    v += 128;
+    return (v + (v >> 8)) >> 8;
+}
+
+TOCIN_RASTER_KERNEL uint32_t blendPixel(uint32_t s, uint32_t d) {
+    uint32_t a = s >> 24, ia = 255 - a;
+    uint32_t r = div255((s & 255) * a + (d & 255) * ia);
+    uint32_t g = div255((s >> 8 & 255) * a + (d >> 8 & 255) * ia);
+    uint32_t b = div255((s >> 16 & 255) * a + (d >> 16 & 255) * ia);
+    uint32_t o = div255(255 * a + (d >> 24) * ia);
+    return r | g << 8 | b << 16 | o << 24;
+}
+
+template <class V> using RVec = typename V::Vec;
+template <class V> using RWide = typename V::Wide;
+
+template <class V> TOCIN_RASTER_KERNEL RWide<V> blendWide(RWide<V> s, RWide<V> d) {
+    RWide<V> a = V::alphas(s);
+    RWide<V> x = V::add(V::add(V::mul(V::opaque(s), a), V::mul(d, V::sub(V::wide(255), a))), V::wide(128));
+    return V::shr8(V::add(x, V::shr8(x)));
+}
+
+template <class V> TOCIN_RASTER_KERNEL RVec<V> blendBlock(RVec<V> s, RVec<V> d) {
+    return V::pack(blendWide<V>(V::lo(s), V::lo(d)), blendWide<V>(V::hi(s), V::hi(d)));
+}
+
+template <class V> void fillSpan(uint32_t *p, size_t n, uint32_t color) {
+    constexpr size_t W = V::kPixels;
+    RVec<V> c = V::splat(color);
+    size_t i = 0;
+    for (; i + 4 * W <= n; i += 4 * W) {
+        V::store(p + i, c);
+        V::store(p + i + W, c);
+        V::store(p + i + 2 * W, c);
+        V::store(p + i + 3 * W, c);
+    }
+    for (; i + W <= n; i += W) V::store(p + i, c);
+    for (; i < n; ++i) p[i] = color;
+}
+
+// Opaque and fully transparent colors skip the arithmetic.
+template <class V> void blendColorSpan(uint32_t *dst, size_t n, uint32_t color) {
+    if ((color >> 24) == 255) return fillSpan<V>(dst, n, color);
+    if ((color >> 24) == 0) return;
+    constexpr size_t W = V::kPixels;
+    RVec<V> c = V::splat(color);
+    size_t i = 0;
+    for (; i + W <= n; i += W) V::store(dst + i, blendBlock<V>(c, V::load(dst + i)));
+    for (; i < n; ++i) dst[i] = blendPixel(color, dst[i]);
+}
+
+template <class V> void blendSpan(uint32_t *dst, const uint32_t *src, size_t n) {
+    constexpr size_t W = V::kPixels;
+    size_t i = 0;
+    for (; i + W <= n; i += W) V::store(dst + i, blendBlock<V>(V::load(src + i), V::load(dst + i)));
+    for (; i < n; ++i) dst[i] = blendPixel(src[i], dst[i]);
+}
+
+template <class V> constexpr RasterKernels rasterTable(const char *name) {
+    return RasterKernels{name, &fillSpan<V>, &blendColorSpan<V>, &blendSpan<V>};
+}
+
+} // namespace
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_RASTER_KERNELS_IMPL_H
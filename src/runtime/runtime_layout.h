@@ -0,0 +1,143 @@
+#ifndef TOCIN_RUNTIME_LAYOUT_H
+#define TOCIN_RUNTIME_LAYOUT_H
+
+// Layouts of the runtime's string, vector and map handles, and the element
+// access the hot entry points need. Shared by concurrency_runtime.cpp and
+// inline_abi.cpp; the second is also built to LLVM bitcode and linked into
+// generated modules, so everything here is plain C++ with no runtime state.
+// Like the *_impl.h kernels, everything has internal linkage.
+//
+// A Tocin string points at its bytes, preceded by [i64 len][i64 cap] (see
+// the string layout notes in concurrency_runtime.cpp). A vector is a
+// TocinVec header over one flat buffer of unboxed elements of its kind; a
+// map is two FlatTables, one per key kind.
+
+#include "flat_map.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" int64_t __tocin_hash_int(int64_t x);
+
+namespace
+{
+    struct TocinStrHeader
+    {
+        int64_t len;
+        int64_t cap;
+    };
+    static_assert(sizeof(TocinStrHeader) == 16, "string header must keep 16-byte alignment");
+
+    inline TocinStrHeader *tocin_str_header(const char *s)
+    {
+        return reinterpret_cast<TocinStrHeader *>(const_cast<char *>(s)) - 1;
+    }
+
+    inline size_t tocin_str_length(const char *s) { return s ? (size_t)tocin_str_header(s)->len : 0; }
+
+    // cap of a string made by the intern table (__tocin_intern): immortal and
+    // read-only like a literal (cap -1), and the only such string with its
+    // bytes, so two of them are equal exactly when they are one pointer.
+    // Its map hash is stored in the 8 bytes before the header.
+    constexpr int64_t kStrInterned = -2;
+
+    enum TocinVecKind : int64_t
+    {
+        kVecI64 = 0,
+        kVecI8 = 1,
+        kVecI32 = 2,
+        kVecF32 = 3,
+        kVecF64 = 4,
+    };
+
+    struct TocinVec
+    {
+        char *data;
+        int64_t len;
+        int64_t cap;  // in elements
+        int64_t kind; // TocinVecKind
+    };
+    static_assert(offsetof(TocinVec, data) == 0 && offsetof(TocinVec, len) == 8 &&
+                      offsetof(TocinVec, cap) == 16 && offsetof(TocinVec, kind) == 24,
+                  "TocinVec layout is read inline by generated code");
+
+    inline size_t tocin_vec_elem_size(int64_t kind)
+    {
+        switch (kind)
+        {
+        case kVecI8: return 1;
+        case kVecI32:
+        case kVecF32: return 4;
+        default: return 8;
+        }
+    }
+
+    inline int64_t tocin_vec_load(const TocinVec *v, int64_t i)
+    {
+        const char *p = v->data + (size_t)i * tocin_vec_elem_size(v->kind);
+        switch (v->kind)
+        {
+        case kVecI8: return *reinterpret_cast<const int8_t *>(p);
+        case kVecI32: { int32_t x; std::memcpy(&x, p, 4); return x; }
+        case kVecF32:
+        {
+            float f; std::memcpy(&f, p, 4);
+            double d = f; int64_t x; std::memcpy(&x, &d, 8); return x;
+        }
+        default: { int64_t x; std::memcpy(&x, p, 8); return x; }
+        }
+    }
+
+    inline void tocin_vec_store(TocinVec *v, int64_t i, int64_t x)
+    {
+        char *p = v->data + (size_t)i * tocin_vec_elem_size(v->kind);
+        switch (v->kind)
+        {
+        case kVecI8: *reinterpret_cast<int8_t *>(p) = (int8_t)x; break;
+        case kVecI32: { int32_t y = (int32_t)x; std::memcpy(p, &y, 4); break; }
+        case kVecF32:
+        {
+            double d; std::memcpy(&d, &x, 8);
+            float f = (float)d; std::memcpy(p, &f, 4); break;
+        }
+        default: std::memcpy(p, &x, 8); break;
+        }
+    }
+
+    struct TocinIntSlot
+    {
+        int64_t key;
+        int64_t value;
+        uint64_t hash() const { return (uint64_t)__tocin_hash_int(key); }
+    };
+
+    struct TocinStrSlot
+    {
+        char *key; // a shared literal or interned string, or the map's own copy (cap >= 0)
+        size_t len;
+        uint64_t keyHash;
+        int64_t value;
+        uint64_t hash() const { return keyHash; }
+    };
+
+    struct TocinMap
+    {
+        tocin::runtime::FlatTable<TocinIntSlot> ints;
+        tocin::runtime::FlatTable<TocinStrSlot> strs;
+        ~TocinMap()
+        {
+            strs.forEach([](const TocinStrSlot &s) {
+                if (tocin_str_header(s.key)->cap >= 0) std::free(tocin_str_header(s.key));
+            });
+        }
+    };
+
+    inline TocinIntSlot *tocin_map_find(TocinMap *m, int64_t k)
+    {
+        return m->ints.find((uint64_t)__tocin_hash_int(k), [k](const TocinIntSlot &s) { return s.key == k; });
+    }
+} // namespace
+
+#endif // TOCIN_RUNTIME_LAYOUT_H
@@ -0,0 +1,64 @@
+#ifndef TOCIN_RUNTIME_METRICS_H
+#define TOCIN_RUNTIME_METRICS_H
+
+/**
+ * Scheduler and runtime health counters for production monitoring.
+ *
+ * Everything here is read from counters the runtime keeps anyway: the
+ * workers' own cache-line-padded atomics (Worker::WorkerStats), the
+ * channel-contention stripes bumped on the slow path of a blocked send,
+ * receive or select (noteChannelWait in executor.h), and the collector's
+ * pause timings and byte counts. Taking a snapshot takes no scheduler lock,
+ * so scraping a busy program does not slow it down.
+ *
+ * runtimeStats(rec) and runtimeMetrics() expose them to Tocin code;
+ * serveMetrics() (or TOCIN_METRICS_PORT) answers Prometheus scrapes.
+ *
+ * Implemented in concurrency_runtime.cpp, next to the TCP primitives.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "lightweight_scheduler.h"
+
+namespace tocin {
+namespace runtime {
+
+struct RuntimeMetrics {
+    LightweightScheduler::SchedulerStats scheduler;
+
+    // Channel operations that had to wait, by kind (ChannelWait).
+    uint64_t channelReceiveWaits;
+    uint64_t channelSendWaits;
+    uint64_t selectWaits;
+
+    // Boehm collector figures; all zero when built without TOCIN_HAVE_GC.
+    bool gcEnabled;
+    uint64_t gcCollections;
+    uint64_t gcPauseNs;       // total time collections held the world stopped
+    uint64_t gcMaxPauseNs;
+    uint64_t gcHeapBytes;
+    uint64_t gcAllocatedBytes; // since start
+};
+
+// A snapshot of the shared scheduler and the runtime counters. Does not
+// start the scheduler: before the first goroutine it reports no workers.
+RuntimeMetrics runtimeMetrics();
+
+// The snapshot in the Prometheus text exposition format (version 0.0.4),
+// one tocin_* family per counter, per-worker series labelled worker="i".
+std::string formatMetrics(const RuntimeMetrics& metrics);
+
+// Answer HTTP GETs of /metrics (and /) with formatMetrics(runtimeMetrics())
+// on a background thread, listening on port on all interfaces. The thread
+// is not an executor worker, so it keeps answering while every worker is
+// busy or stuck. Returns the listening socket, or -1. Setting
+// TOCIN_METRICS_PORT starts it when the runtime loads.
+int64_t serveMetrics(int64_t port);
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_RUNTIME_METRICS_H
@@ -0,0 +1,320 @@
+// The SIGPROF sampler, its symbolizer and the folded / pprof writers. See
+// sampling_profiler.h for what is sampled and how it is named.
+#include "sampling_profiler.h"
+#include "pprof_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#ifndef _WIN32
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+constexpr uint64_t kPageMask = ~uint64_t(4095);
+// A frame's caller lives at most this far up the stack.
+constexpr uint64_t kMaxFrameSize = uint64_t(1) << 24;
+
+std::atomic<int> g_inHandler{0};
+
+#ifndef _WIN32
+void onSigprof(int, siginfo_t *, void *context) {
+    // Counted before the check, so stop() cannot miss a handler in flight.
+    g_inHandler.fetch_add(1, std::memory_order_seq_cst);
+    SamplingProfiler &profiler = SamplingProfiler::instance();
+    if (!profiler.running()) {
+        g_inHandler.fetch_sub(1, std::memory_order_release);
+        return;
+    }
+    int savedErrno = errno;
+    uint64_t pc = 0, fp = 0, sp = 0;
+    auto *uc = static_cast<ucontext_t *>(context);
+#if defined(__linux__) && defined(__x86_64__)
+    pc = (uint64_t)uc->uc_mcontext.gregs[REG_RIP];
+    fp = (uint64_t)uc->uc_mcontext.gregs[REG_RBP];
+    sp = (uint64_t)uc->uc_mcontext.gregs[REG_RSP];
+#elif defined(__linux__) && defined(__aarch64__)
+    pc = (uint64_t)uc->uc_mcontext.pc;
+    fp = (uint64_t)uc->uc_mcontext.regs[29];
+    sp = (uint64_t)uc->uc_mcontext.sp;
+#elif defined(__APPLE__) && defined(__x86_64__)
+    pc = (uint64_t)uc->uc_mcontext->__ss.__rip;
+    fp = (uint64_t)uc->uc_mcontext->__ss.__rbp;
+    sp = (uint64_t)uc->uc_mcontext->__ss.__rsp;
+#elif defined(__APPLE__) && defined(__aarch64__)
+    pc = (uint64_t)uc->uc_mcontext->__ss.__pc;
+    fp = (uint64_t)uc->uc_mcontext->__ss.__fp;
+    sp = (uint64_t)uc->uc_mcontext->__ss.__sp;
+#else
+    (void)uc;
+#endif
+    if (pc) profiler.record(pc, fp, sp);
+    errno = savedErrno;
+    g_inHandler.fetch_sub(1, std::memory_order_release);
+}
+#endif
+
+std::string demangle(const char *name) {
+#ifndef _WIN32
+    int status = 0;
+    char *out = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status == 0 && out) {
+        std::string s(out);
+        std::free(out);
+        return s;
+    }
+#endif
+    return name;
+}
+
+std::string hexAddress(uint64_t v) {
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)v);
+    return buf;
+}
+
+} // namespace
+
+SamplingProfiler &SamplingProfiler::instance() {
+    static SamplingProfiler profiler;
+    return profiler;
+}
+
+bool SamplingProfiler::start(int hz, size_t maxSamples) {
+#ifdef _WIN32
+    (void)hz;
+    (void)maxSamples;
+    return false;
+#else
+    if (running() || hz <= 0 || maxSamples == 0) return false;
+    if (probe_[0] < 0) {
+        if (::pipe(probe_) != 0) return false;
+        for (int fd : probe_) {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+    // Installed once and left in place: a SIGPROF still in flight after
+    // stop() must not meet the default action, which kills the process.
+    static bool installed = false;
+    if (!installed) {
+        struct sigaction sa;
+        std::memset(&sa, 0, sizeof(sa));
+        sa.sa_sigaction = onSigprof;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        if (::sigaction(SIGPROF, &sa, nullptr) != 0) return false;
+        installed = true;
+    }
+    if (capacity_ != maxSamples) {
+        samples_.reset(new Sample[maxSamples]);
+        capacity_ = maxSamples;
+    }
+    for (size_t i = 0; i < capacity_; ++i) samples_[i].depth = 0;
+    next_.store(0, std::memory_order_relaxed);
+    dropped_.store(0, std::memory_order_relaxed);
+    hz_ = hz;
+    running_.store(true, std::memory_order_release);
+
+    itimerval timer;
+    std::memset(&timer, 0, sizeof(timer));
+    long usec = std::max(1L, 1000000L / hz);
+    timer.it_interval.tv_sec = usec / 1000000;
+    timer.it_interval.tv_usec = usec % 1000000;
+    timer.it_value = timer.it_interval;
+    if (::setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        running_.store(false, std::memory_order_release);
+        return false;
+    }
+    return true;
+#endif
+}
+
+void SamplingProfiler::stop() {
+#ifndef _WIN32
+    if (!running()) return;
+    itimerval off;
+    std::memset(&off, 0, sizeof(off));
+    ::setitimer(ITIMER_PROF, &off, nullptr);
+    running_.store(false, std::memory_order_release);
+    // Let handlers already past the running() check finish their sample.
+    while (g_inHandler.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+#endif
+}
+
+// One byte through the probe pipe: the kernel reports EFAULT instead of
+// the read faulting. Pages already probed on this walk are not probed again.
+bool SamplingProfiler::readable(uint64_t addr, uint64_t &lastPage) const {
+#ifdef _WIN32
+    (void)addr;
+    (void)lastPage;
+    return false;
+#else
+    for (uint64_t page : {addr & kPageMask, (addr + 15) & kPageMask}) {
+        if (page == lastPage) continue;
+        if (::write(probe_[1], reinterpret_cast<const void *>(page), 1) != 1) return false;
+        char sink;
+        (void)::read(probe_[0], &sink, 1);
+        lastPage = page;
+    }
+    return true;
+#endif
+}
+
+void SamplingProfiler::record(uint64_t pc, uint64_t fp, uint64_t sp) {
+    size_t index = next_.fetch_add(1, std::memory_order_relaxed);
+    if (index >= capacity_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Sample &sample = samples_[index];
+    sample.pcs[0] = pc;
+    uint32_t depth = 1;
+    uint64_t lastPage = ~uint64_t(0);
+    // Each frame record is {caller's frame pointer, return address}, and
+    // callers sit higher on the stack.
+    while (depth < kMaxDepth && fp && (fp & 7) == 0 && fp >= sp && readable(fp, lastPage)) {
+        const uint64_t *frame = reinterpret_cast<const uint64_t *>(fp);
+        uint64_t caller = frame[0], ret = frame[1];
+        if (ret == 0) break;
+        sample.pcs[depth++] = ret - 1; // inside the call, not after it
+        if (caller <= fp || caller - fp > kMaxFrameSize) break;
+        fp = caller;
+    }
+    sample.depth = depth;
+    std::atomic_signal_fence(std::memory_order_release);
+}
+
+size_t SamplingProfiler::sampleCount() const {
+    return std::min(next_.load(std::memory_order_relaxed), capacity_);
+}
+
+void SamplingProfiler::addSymbol(uint64_t start, uint64_t size, std::string name) {
+    if (size == 0) return;
+    std::lock_guard<std::mutex> lock(symbolsMutex_);
+    uint64_t end = start + size;
+    // Drop what the new range covers, trimming partial overlaps.
+    std::vector<Symbol> kept;
+    kept.reserve(symbols_.size() + 1);
+    for (Symbol &s : symbols_) {
+        if (s.end <= start || s.start >= end) {
+            kept.push_back(std::move(s));
+            continue;
+        }
+        if (s.start < start) kept.push_back({s.start, start, s.name});
+        if (s.end > end) kept.push_back({end, s.end, s.name});
+    }
+    kept.push_back({start, end, std::move(name)});
+    std::sort(kept.begin(), kept.end(), [](const Symbol &a, const Symbol &b) { return a.start < b.start; });
+    symbols_ = std::move(kept);
+}
+
+void SamplingProfiler::removeSymbols(uint64_t start, uint64_t end) {
+    std::lock_guard<std::mutex> lock(symbolsMutex_);
+    symbols_.erase(std::remove_if(symbols_.begin(), symbols_.end(),
+                                  [&](const Symbol &s) { return s.start >= start && s.end <= end; }),
+                   symbols_.end());
+}
+
+std::string SamplingProfiler::symbolize(uint64_t pc) const {
+    {
+        std::lock_guard<std::mutex> lock(symbolsMutex_);
+        auto it = std::upper_bound(symbols_.begin(), symbols_.end(), pc,
+                                   [](uint64_t v, const Symbol &s) { return v < s.start; });
+        if (it != symbols_.begin() && pc < std::prev(it)->end) return std::prev(it)->name;
+    }
+#ifndef _WIN32
+    Dl_info info;
+    if (::dladdr(reinterpret_cast<void *>(pc), &info)) {
+        if (info.dli_sname) return demangle(info.dli_sname);
+        if (info.dli_fname) {
+            const char *base = std::strrchr(info.dli_fname, '/');
+            return std::string(base ? base + 1 : info.dli_fname) + "+" +
+                   hexAddress(pc - (uint64_t)info.dli_fbase);
+        }
+    }
+#endif
+    return hexAddress(pc);
+}
+
+std::string SamplingProfiler::folded() const {
+    std::unordered_map<uint64_t, std::string> names;
+    auto name = [&](uint64_t pc) -> const std::string & {
+        auto it = names.find(pc);
+        if (it == names.end()) {
+            std::string n = symbolize(pc);
+            std::replace(n.begin(), n.end(), ';', ':');
+            it = names.emplace(pc, std::move(n)).first;
+        }
+        return it->second;
+    };
+    std::map<std::string, uint64_t> stacks;
+    for (size_t i = 0, n = sampleCount(); i < n; ++i) {
+        const Sample &sample = samples_[i];
+        if (sample.depth == 0) continue;
+        std::string key;
+        for (uint32_t d = sample.depth; d-- > 0;) {
+            if (!key.empty()) key += ';';
+            key += name(sample.pcs[d]);
+        }
+        stacks[key]++;
+    }
+    std::string out;
+    for (const auto &[stack, count] : stacks) {
+        out += stack;
+        out += ' ';
+        out += std::to_string(count);
+        out += '\n';
+    }
+    return out;
+}
+
+std::string SamplingProfiler::pprof() const {
+    const int64_t period = 1000000000ll / hz_;
+    PprofBuilder builder([this](uint64_t pc) { return symbolize(pc); });
+    builder.addSampleType("samples", "count");
+    builder.addSampleType("cpu", "nanoseconds");
+    std::map<std::vector<uint64_t>, int64_t> stacks;
+    for (size_t i = 0, n = sampleCount(); i < n; ++i) {
+        const Sample &sample = samples_[i];
+        if (sample.depth == 0) continue;
+        stacks[std::vector<uint64_t>(sample.pcs, sample.pcs + sample.depth)]++;
+    }
+    for (const auto &[pcs, count] : stacks) builder.addSample(pcs, {count, count * period});
+    builder.setDuration((int64_t)sampleCount() * period); // in CPU time
+    builder.setPeriod("cpu", "nanoseconds", period);
+    return builder.finish();
+}
+
+bool SamplingProfiler::write(const std::string &path) const {
+    std::string data;
+    if (isPprofPath(path)) {
+        if (!gzipProfile(pprof(), data)) {
+            errno = ENOMEM;
+            return false;
+        }
+    } else {
+        data = folded();
+    }
+    return writeProfileFile(path, data);
+}
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,112 @@
+#ifndef TOCIN_SAMPLING_PROFILER_H
+#define TOCIN_SAMPLING_PROFILER_H
+
+/**
+ * A SIGPROF-driven sampling CPU profiler for compiled Tocin programs.
+ *
+ * start() arms ITIMER_PROF, so the kernel interrupts whichever thread is
+ * burning CPU `hz` times a second. The handler records the interrupted PC
+ * and walks the frame-pointer chain above it into a preallocated sample
+ * buffer. It takes no locks and does not allocate; a frame address is
+ * probed with a system call before it is read whenever the walk enters a
+ * new page, so a broken chain ends the walk instead of faulting.
+ * Code built without frame pointers still shows up as the leaf. The driver
+ * builds for --profile with frame pointers on.
+ *
+ * Addresses are symbolized when the profile is written: first against the
+ * ranges the JIT reported through addSymbol() (jit_symbols.h registers
+ * every function of every object it loads), then with dladdr for native
+ * code. An executable must export its symbols (-rdynamic) for those names to
+ * resolve; otherwise its frames print as module+offset.
+ *
+ * write() emits folded stacks ("main;loop;work 42", for flamegraph.pl and
+ * speedscope) or, for a path ending in .pb.gz or .pprof, a gzipped pprof
+ * profile (`go tool pprof`).
+ *
+ * TOCIN_PROFILE=<file> profiles a native binary from load to exit, at
+ * TOCIN_PROFILE_HZ samples a second (default 100).
+ *
+ * POSIX only; elsewhere start() returns false.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+class SamplingProfiler {
+public:
+    static constexpr int kDefaultHz = 100;
+    static constexpr size_t kMaxDepth = 64;
+    static constexpr size_t kDefaultMaxSamples = size_t(1) << 15;
+
+    // The process's profiler (SIGPROF has one handler per process).
+    static SamplingProfiler &instance();
+
+    // Start sampling; false if already running or the timer cannot be set.
+    // Samples beyond maxSamples are counted in dropped() and not kept.
+    bool start(int hz = kDefaultHz, size_t maxSamples = kDefaultMaxSamples);
+    // Stop sampling. Samples stay until the next start().
+    void stop();
+    bool running() const { return running_.load(std::memory_order_acquire); }
+
+    // Name the code in [start, start + size). Later registrations of the
+    // same range win; removeSymbols() forgets a range (code being freed).
+    void addSymbol(uint64_t start, uint64_t size, std::string name);
+    void removeSymbols(uint64_t start, uint64_t end);
+
+    size_t sampleCount() const;
+    size_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    int hz() const { return hz_; }
+
+    // Folded stacks, root first, one line per distinct stack.
+    std::string folded() const;
+    // An uncompressed pprof Profile message.
+    std::string pprof() const;
+    // Either format to path (pprof for *.pb.gz / *.pprof, gzipped); false
+    // and errno set if it cannot be written.
+    bool write(const std::string &path) const;
+
+    // The name for pc: a registered symbol, a dynamic symbol, module+0x...,
+    // or the bare address.
+    std::string symbolize(uint64_t pc) const;
+
+    // Called from the SIGPROF handler.
+    void record(uint64_t pc, uint64_t fp, uint64_t sp);
+
+private:
+    SamplingProfiler() = default;
+
+    struct Sample {
+        uint32_t depth;
+        uint64_t pcs[kMaxDepth]; // leaf first
+    };
+    struct Symbol {
+        uint64_t start, end;
+        std::string name;
+    };
+
+    bool readable(uint64_t addr, uint64_t &lastPage) const;
+
+    std::atomic<bool> running_{false};
+    int hz_ = kDefaultHz;
+    std::unique_ptr<Sample[]> samples_;
+    size_t capacity_ = 0;
+    std::atomic<size_t> next_{0};
+    std::atomic<size_t> dropped_{0};
+    int probe_[2] = {-1, -1}; // pipe used to probe frame addresses
+
+    mutable std::mutex symbolsMutex_;
+    std::vector<Symbol> symbols_; // sorted by start, non-overlapping
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_SAMPLING_PROFILER_H
@@ -0,0 +1,206 @@
+// Scan kernels: the portable scalar table, the NEON table on AArch64, the
+// dispatch that picks among them and the AVX2/AVX-512 tables, the
+// branchless lower bound, and the i64* builtins' entry points.
+#include "scan_kernels_impl.h"
+#include "kernel_support.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define TOCIN_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+struct Scalar {
+    using Vec = int64_t;
+    static constexpr size_t kWidth = 1;
+
+    static Vec splat(int64_t x) { return x; }
+    static Vec load(const int64_t *p) { return *p; }
+    static Vec add(Vec a, Vec b) { return (int64_t)((uint64_t)a + (uint64_t)b); }
+    static Vec min(Vec a, Vec b) { return a < b ? a : b; }
+    static Vec max(Vec a, Vec b) { return a > b ? a : b; }
+    static unsigned eq(Vec a, Vec b) { return a == b; }
+    static unsigned gt(Vec a, Vec b) { return a > b; }
+    static int64_t sum(Vec v) { return v; }
+    static int64_t hmin(Vec v) { return v; }
+    static int64_t hmax(Vec v) { return v; }
+};
+
+#ifdef TOCIN_SCAN_NEON
+struct Neon {
+    using Vec = int64x2_t;
+    static constexpr size_t kWidth = 2;
+
+    static Vec splat(int64_t x) { return vdupq_n_s64(x); }
+    static Vec load(const int64_t *p) { return vld1q_s64(p); }
+    static Vec add(Vec a, Vec b) { return vaddq_s64(a, b); }
+    static Vec min(Vec a, Vec b) { return vbslq_s64(vcgtq_s64(a, b), b, a); }
+    static Vec max(Vec a, Vec b) { return vbslq_s64(vcgtq_s64(a, b), a, b); }
+    static unsigned bits(uint64x2_t m) {
+        return (unsigned)(vgetq_lane_u64(m, 0) & 1) | (unsigned)(vgetq_lane_u64(m, 1) & 1) << 1;
+    }
+    static unsigned eq(Vec a, Vec b) { return bits(vceqq_s64(a, b)); }
+    static unsigned gt(Vec a, Vec b) { return bits(vcgtq_s64(a, b)); }
+    static int64_t sum(Vec v) { return vaddvq_s64(v); }
+    static int64_t hmin(Vec v) {
+        int64_t a = vgetq_lane_s64(v, 0), b = vgetq_lane_s64(v, 1);
+        return a < b ? a : b;
+    }
+    static int64_t hmax(Vec v) {
+        int64_t a = vgetq_lane_s64(v, 0), b = vgetq_lane_s64(v, 1);
+        return a > b ? a : b;
+    }
+};
+#endif
+
+constexpr ScanKernels kScalarKernels = scanTable<Scalar>("scalar");
+#ifdef TOCIN_SCAN_NEON
+constexpr ScanKernels kNeonKernels = scanTable<Neon>("neon");
+#endif
+
+bool cpuHasAvx2() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+bool cpuHasAvx512() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
+}
+
+const ScanKernels *chooseKernels() {
+    auto available = availableScanKernels();
+    if (const char *forced = std::getenv("TOCIN_SCAN_KERNELS")) {
+        for (const auto *table : available)
+            if (std::strcmp(table->name, forced) == 0) return table;
+    }
+    return available.back();
+}
+
+// The binary search stops once this many candidates are left and counts
+// the smaller ones with the table instead.
+constexpr size_t kLowerBoundWindow = 32;
+
+} // namespace
+
+std::vector<const ScanKernels *> availableScanKernels() {
+    std::vector<const ScanKernels *> tables{&kScalarKernels};
+#ifdef TOCIN_SCAN_NEON
+    tables.push_back(&kNeonKernels);
+#endif
+    if (const ScanKernels *avx2 = avx2ScanKernels())
+        if (cpuHasAvx2()) tables.push_back(avx2);
+    if (const ScanKernels *avx512 = avx512ScanKernels())
+        if (cpuHasAvx512()) tables.push_back(avx512);
+    return tables;
+}
+
+const ScanKernels &scanKernels() {
+    static const ScanKernels *chosen = chooseKernels();
+    return *chosen;
+}
+
+// The answer stays in [base, base + len]: everything before base is < t and
+// everything from base + len on is >= t. Halving picks the new base with a
+// conditional move, and both possible next probes are prefetched.
+size_t lowerBound(const ScanKernels &k, const int64_t *a, size_t n, int64_t t) {
+    const int64_t *base = a;
+    size_t len = n;
+    while (len > kLowerBoundWindow) {
+        size_t half = len / 2;
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(base + half / 2);
+        __builtin_prefetch(base + half + half / 2);
+#endif
+        base = base[half] < t ? base + half : base;
+        len -= half;
+    }
+    return (size_t)(base - a) + k.countLess(base, len, t);
+}
+
+} // namespace runtime
+} // namespace tocin
+
+namespace {
+
+// A find result as a Tocin index: -1 when nothing matched.
+int64_t indexOrNone(size_t i, size_t n) { return i == n ? -1 : static_cast<int64_t>(i); }
+
+} // namespace
+
+extern "C" {
+
+// i64Sum(xs): wrapping sum of a list<int>.
+int64_t __tocin_i64_sum(const int64_t *xs) {
+    size_t n = lengthOf(xs);
+    return n ? tocin::runtime::scanKernels().sum(xs + 1, n) : 0;
+}
+
+// i64ArgMin / i64ArgMax(xs): index of the first smallest / largest element,
+// -1 for an empty list.
+int64_t __tocin_i64_argmin(const int64_t *xs) {
+    size_t n = lengthOf(xs);
+    if (n == 0) return -1;
+    const auto &k = tocin::runtime::scanKernels();
+    return indexOrNone(k.findEq(xs + 1, n, k.min(xs + 1, n)), n);
+}
+
+int64_t __tocin_i64_argmax(const int64_t *xs) {
+    size_t n = lengthOf(xs);
+    if (n == 0) return -1;
+    const auto &k = tocin::runtime::scanKernels();
+    return indexOrNone(k.findEq(xs + 1, n, k.max(xs + 1, n)), n);
+}
+
+// i64CountEq / i64CountGt(xs, t): how many elements are == t / > t.
+int64_t __tocin_i64_count_eq(const int64_t *xs, int64_t t) {
+    size_t n = lengthOf(xs);
+    return n ? static_cast<int64_t>(tocin::runtime::scanKernels().countEq(xs + 1, n, t)) : 0;
+}
+
+int64_t __tocin_i64_count_gt(const int64_t *xs, int64_t t) {
+    size_t n = lengthOf(xs);
+    return n ? static_cast<int64_t>(tocin::runtime::scanKernels().countGreater(xs + 1, n, t)) : 0;
+}
+
+// i64FindEq / i64FindGt / i64FindLe(xs, t): index of the first element
+// == t / > t / <= t, or -1.
+int64_t __tocin_i64_find_eq(const int64_t *xs, int64_t t) {
+    size_t n = lengthOf(xs);
+    return n ? indexOrNone(tocin::runtime::scanKernels().findEq(xs + 1, n, t), n) : -1;
+}
+
+int64_t __tocin_i64_find_gt(const int64_t *xs, int64_t t) {
+    size_t n = lengthOf(xs);
+    return n ? indexOrNone(tocin::runtime::scanKernels().findGreater(xs + 1, n, t), n) : -1;
+}
+
+int64_t __tocin_i64_find_le(const int64_t *xs, int64_t t) {
+    size_t n = lengthOf(xs);
+    return n ? indexOrNone(tocin::runtime::scanKernels().findNotGreater(xs + 1, n, t), n) : -1;
+}
+
+// i64LowerBound(xs, t): first index of an ascending list<int> whose element
+// is >= t, or len(xs).
+int64_t __tocin_i64_lower_bound(const int64_t *xs, int64_t t) {
+    size_t n = lengthOf(xs);
+    return n ? static_cast<int64_t>(tocin::runtime::lowerBound(tocin::runtime::scanKernels(), xs + 1, n, t))
+             : 0;
+}
+
+} // extern "C"
@@ -0,0 +1,63 @@
+#ifndef TOCIN_SCAN_KERNELS_H
+#define TOCIN_SCAN_KERNELS_H
+
+/**
+ * Vectorized reductions and searches over int64 arrays behind the i64*
+ * builtins (__tocin_i64_* in scan_kernels.cpp), which data.algorithms'
+ * intSum/argMin/argMax/countEq/linearSearch/binarySearch and std.linq's
+ * reductions and predicates call.
+ *
+ * As with the string and matrix kernels, every instruction set gets one
+ * table and scanKernels() picks the best one the CPU supports (AVX-512,
+ * then AVX2, NEON on AArch64, otherwise unrolled scalar code; SSE2 has no
+ * 64-bit compare). TOCIN_SCAN_KERNELS forces a table by name.
+ *
+ * Searches compare a block of lanes at a time and stop at the first block
+ * with a match, so an early hit costs no more than the scalar loop. Sums
+ * wrap on overflow like Tocin's `+`.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+struct ScanKernels {
+    const char *name;
+    // Wrapping sum of a[0, n).
+    int64_t (*sum)(const int64_t *a, size_t n);
+    // Smallest / largest element of a[0, n), n >= 1.
+    int64_t (*min)(const int64_t *a, size_t n);
+    int64_t (*max)(const int64_t *a, size_t n);
+    // Number of elements == t, > t, < t.
+    size_t (*countEq)(const int64_t *a, size_t n, int64_t t);
+    size_t (*countGreater)(const int64_t *a, size_t n, int64_t t);
+    size_t (*countLess)(const int64_t *a, size_t n, int64_t t);
+    // Index of the first element == t, > t, <= t; n if there is none.
+    size_t (*findEq)(const int64_t *a, size_t n, int64_t t);
+    size_t (*findGreater)(const int64_t *a, size_t n, int64_t t);
+    size_t (*findNotGreater)(const int64_t *a, size_t n, int64_t t);
+};
+
+// The table the runtime uses.
+const ScanKernels &scanKernels();
+
+// Every table this CPU can run, portable one first.
+std::vector<const ScanKernels *> availableScanKernels();
+
+// Defined in scan_kernels_avx2.cpp and scan_kernels_avx512.cpp, the only
+// files built for those instruction sets; nullptr when the compiler cannot
+// target them.
+const ScanKernels *avx2ScanKernels();
+const ScanKernels *avx512ScanKernels();
+
+// First index of a[0, n) (ascending) whose element is >= t, or n: a
+// branchless binary search down to a window the table's countLess finishes.
+size_t lowerBound(const ScanKernels &k, const int64_t *a, size_t n, int64_t t);
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_SCAN_KERNELS_H
@@ -0,0 +1,60 @@
+// The AVX2 scan kernels. This is the only runtime file built with -mavx2
+// (see CMakeLists.txt); scanKernels() calls into it only after checking the
+// CPU.
+#include "scan_kernels_impl.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#ifdef __AVX2__
+namespace {
+
+struct Avx2 {
+    using Vec = __m256i;
+    static constexpr size_t kWidth = 4;
+
+    static Vec splat(int64_t x) { return _mm256_set1_epi64x(x); }
+    static Vec load(const int64_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_epi64(a, b); }
+    // No 64-bit min/max before AVX-512: select on the compare.
+    static Vec min(Vec a, Vec b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+    static Vec max(Vec a, Vec b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+    static unsigned bits(Vec m) { return (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(m)); }
+    static unsigned eq(Vec a, Vec b) { return bits(_mm256_cmpeq_epi64(a, b)); }
+    static unsigned gt(Vec a, Vec b) { return bits(_mm256_cmpgt_epi64(a, b)); }
+    static int64_t sum(Vec v) {
+        __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        return _mm_cvtsi128_si64(_mm_add_epi64(s, _mm_unpackhi_epi64(s, s)));
+    }
+    static int64_t lane(Vec v, int i) {
+        alignas(32) int64_t out[4];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(out), v);
+        return out[i];
+    }
+    static int64_t hmin(Vec v) {
+        int64_t a = lane(v, 0) < lane(v, 1) ? lane(v, 0) : lane(v, 1);
+        int64_t b = lane(v, 2) < lane(v, 3) ? lane(v, 2) : lane(v, 3);
+        return a < b ? a : b;
+    }
+    static int64_t hmax(Vec v) {
+        int64_t a = lane(v, 0) > lane(v, 1) ? lane(v, 0) : lane(v, 1);
+        int64_t b = lane(v, 2) > lane(v, 3) ? lane(v, 2) : lane(v, 3);
+        return a > b ? a : b;
+    }
+};
+
+constexpr ScanKernels kAvx2Kernels = scanTable<Avx2>("avx2");
+
+} // namespace
+
+const ScanKernels *avx2ScanKernels() { return &kAvx2Kernels; }
+#else
+const ScanKernels *avx2ScanKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,43 @@
+// The AVX-512 scan kernels. This is the only runtime file built with
+// -mavx512f (see CMakeLists.txt); scanKernels() calls into it only after
+// checking the CPU.
+#include "scan_kernels_impl.h"
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#ifdef __AVX512F__
+namespace {
+
+struct Avx512 {
+    using Vec = __m512i;
+    static constexpr size_t kWidth = 8;
+
+    static Vec splat(int64_t x) { return _mm512_set1_epi64(x); }
+    static Vec load(const int64_t *p) { return _mm512_loadu_si512(p); }
+    static Vec add(Vec a, Vec b) { return _mm512_add_epi64(a, b); }
+    static Vec min(Vec a, Vec b) { return _mm512_min_epi64(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm512_max_epi64(a, b); }
+    // Compares produce the lane mask directly.
+    static unsigned eq(Vec a, Vec b) { return (unsigned)_mm512_cmpeq_epi64_mask(a, b); }
+    static unsigned gt(Vec a, Vec b) { return (unsigned)_mm512_cmpgt_epi64_mask(a, b); }
+    static int64_t sum(Vec v) { return _mm512_reduce_add_epi64(v); }
+    static int64_t hmin(Vec v) { return _mm512_reduce_min_epi64(v); }
+    static int64_t hmax(Vec v) { return _mm512_reduce_max_epi64(v); }
+};
+
+constexpr ScanKernels kAvx512Kernels = scanTable<Avx512>("avx512");
+
+} // namespace
+
+const ScanKernels *avx512ScanKernels() { return &kAvx512Kernels; }
+#else
+const ScanKernels *avx512ScanKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
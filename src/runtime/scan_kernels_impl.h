@@ -0,0 +1,168 @@
+#ifndef TOCIN_SCAN_KERNELS_IMPL_H
+#define TOCIN_SCAN_KERNELS_IMPL_H
+
+// Kernel bodies shared by every instruction set, written against a small
+// vector interface over int64 lanes:
+//
+//   Vec                      kWidth int64 lanes
+//   splat(x) load(p)         all lanes x / unaligned kWidth lanes at p
+//   add(a, b)                lane-wise wrapping sum
+//   min(a, b) max(a, b)      lane-wise signed min / max
+//   eq(a, b) gt(a, b)        lane mask of a == b / a > b, lane 0 in bit 0
+//   sum(v) hmin(v) hmax(v)   reductions of the lanes
+//
+// Like linalg_kernels_impl.h this is only included by the kernel files,
+// everything has internal linkage and no standard library template is
+// instantiated, so code built for a wider instruction set never ends up
+// shared with the baseline file.
+
+#include "scan_kernels.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TOCIN_SCAN_KERNEL __attribute__((always_inline)) inline
+#else
+#define TOCIN_SCAN_KERNEL inline
+#endif
+
+namespace tocin {
+namespace runtime {
+namespace {
+
+template <class V> using SVec = typename V::Vec;
+
+TOCIN_SCAN_KERNEL unsigned scanCountTrailingZeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+TOCIN_SCAN_KERNEL unsigned scanPopCount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    unsigned n = 0;
+    for (; x; x &= x - 1) ++n;
+    return n;
+#endif
+}
+
+// The predicates, as a lane mask of one block and as a scalar test.
+struct IsEq {
+    template <class V> static TOCIN_SCAN_KERNEL unsigned mask(SVec<V> x, SVec<V> t) { return V::eq(x, t); }
+    static bool test(int64_t x, int64_t t) { return x == t; }
+};
+struct IsGreater {
+    template <class V> static TOCIN_SCAN_KERNEL unsigned mask(SVec<V> x, SVec<V> t) { return V::gt(x, t); }
+    static bool test(int64_t x, int64_t t) { return x > t; }
+};
+struct IsLess {
+    template <class V> static TOCIN_SCAN_KERNEL unsigned mask(SVec<V> x, SVec<V> t) { return V::gt(t, x); }
+    static bool test(int64_t x, int64_t t) { return x < t; }
+};
+struct IsNotGreater {
+    template <class V> static TOCIN_SCAN_KERNEL unsigned mask(SVec<V> x, SVec<V> t) {
+        return ~V::gt(x, t) & ((1u << V::kWidth) - 1);
+    }
+    static bool test(int64_t x, int64_t t) { return x <= t; }
+};
+
+// Four independent accumulators hide the add latency.
+template <class V> int64_t sumOf(const int64_t *a, size_t n) {
+    constexpr size_t W = V::kWidth;
+    SVec<V> s0 = V::splat(0), s1 = s0, s2 = s0, s3 = s0;
+    size_t i = 0;
+    for (; i + 4 * W <= n; i += 4 * W) {
+        s0 = V::add(s0, V::load(a + i));
+        s1 = V::add(s1, V::load(a + i + W));
+        s2 = V::add(s2, V::load(a + i + 2 * W));
+        s3 = V::add(s3, V::load(a + i + 3 * W));
+    }
+    for (; i + W <= n; i += W) s0 = V::add(s0, V::load(a + i));
+    uint64_t s = (uint64_t)V::sum(V::add(V::add(s0, s1), V::add(s2, s3)));
+    for (; i < n; ++i) s += (uint64_t)a[i];
+    return (int64_t)s;
+}
+
+template <class V, bool kMax> int64_t extremeOf(const int64_t *a, size_t n) {
+    constexpr size_t W = V::kWidth;
+    size_t i = 0;
+    int64_t best = a[0];
+    if (n >= W) {
+        SVec<V> m0 = V::load(a), m1 = m0;
+        for (i = W; i + 2 * W <= n; i += 2 * W) {
+            m0 = kMax ? V::max(m0, V::load(a + i)) : V::min(m0, V::load(a + i));
+            m1 = kMax ? V::max(m1, V::load(a + i + W)) : V::min(m1, V::load(a + i + W));
+        }
+        for (; i + W <= n; i += W) m0 = kMax ? V::max(m0, V::load(a + i)) : V::min(m0, V::load(a + i));
+        best = kMax ? V::hmax(V::max(m0, m1)) : V::hmin(V::min(m0, m1));
+    }
+    for (; i < n; ++i)
+        if (kMax ? a[i] > best : a[i] < best) best = a[i];
+    return best;
+}
+
+template <class V> int64_t minOf(const int64_t *a, size_t n) { return extremeOf<V, false>(a, n); }
+template <class V> int64_t maxOf(const int64_t *a, size_t n) { return extremeOf<V, true>(a, n); }
+
+template <class V, class P> size_t countOf(const int64_t *a, size_t n, int64_t t) {
+    constexpr size_t W = V::kWidth;
+    SVec<V> tv = V::splat(t);
+    size_t c0 = 0, c1 = 0, i = 0;
+    for (; i + 2 * W <= n; i += 2 * W) {
+        c0 += scanPopCount(P::template mask<V>(V::load(a + i), tv));
+        c1 += scanPopCount(P::template mask<V>(V::load(a + i + W), tv));
+    }
+    for (; i + W <= n; i += W) c0 += scanPopCount(P::template mask<V>(V::load(a + i), tv));
+    for (; i < n; ++i) c0 += P::test(a[i], t);
+    return c0 + c1;
+}
+
+// Four blocks are compared before one branch on their combined mask.
+template <class V, class P> size_t findOf(const int64_t *a, size_t n, int64_t t) {
+    constexpr size_t W = V::kWidth;
+    SVec<V> tv = V::splat(t);
+    size_t i = 0;
+    for (; i + 4 * W <= n; i += 4 * W) {
+        uint64_t m = (uint64_t)P::template mask<V>(V::load(a + i), tv) |
+                     (uint64_t)P::template mask<V>(V::load(a + i + W), tv) << W |
+                     (uint64_t)P::template mask<V>(V::load(a + i + 2 * W), tv) << (2 * W) |
+                     (uint64_t)P::template mask<V>(V::load(a + i + 3 * W), tv) << (3 * W);
+        if (m) return i + scanCountTrailingZeros(m);
+    }
+    for (; i + W <= n; i += W) {
+        unsigned m = P::template mask<V>(V::load(a + i), tv);
+        if (m) return i + scanCountTrailingZeros(m);
+    }
+    for (; i < n; ++i)
+        if (P::test(a[i], t)) return i;
+    return n;
+}
+
+template <class V> constexpr ScanKernels scanTable(const char *name) {
+    return ScanKernels{name,
+                       &sumOf<V>,
+                       &minOf<V>,
+                       &maxOf<V>,
+                       &countOf<V, IsEq>,
+                       &countOf<V, IsGreater>,
+                       &countOf<V, IsLess>,
+                       &findOf<V, IsEq>,
+                       &findOf<V, IsGreater>,
+                       &findOf<V, IsNotGreater>};
+}
+
+} // namespace
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_SCAN_KERNELS_IMPL_H
@@ -0,0 +1,568 @@
+// pdqsort, radix, natural merge and sample sorts over 8-byte elements, and
+// the extern "C" entry points the sort builtins call. See sort_kernels.h.
+#include "sort_kernels.h"
+#include "kernel_support.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+constexpr size_t kInsertionSortMax = 24;
+constexpr size_t kNintherMin = 128;
+constexpr size_t kPartialInsertionMoves = 8;
+constexpr size_t kMinRun = 32;
+constexpr size_t kRadixMin = 64;
+// Sample elements drawn per bucket, and the most splitters (bucket ids fit
+// in 16 bits).
+constexpr size_t kOversample = 16;
+constexpr size_t kMaxSplitters = 255;
+
+struct IntLess {
+    bool operator()(int64_t a, int64_t b) const { return a < b; }
+};
+
+// A strict weak order with every NaN equal and after +inf.
+struct FloatLess {
+    bool operator()(double a, double b) const { return a < b || (b != b && a == a); }
+};
+
+struct StringLess {
+    bool operator()(const char *a, const char *b) const {
+        return std::strcmp(a ? a : "", b ? b : "") < 0;
+    }
+};
+
+// ---- pdqsort ------------------------------------------------------------------
+
+template <class T, class Less> void insertionSort(T *a, size_t n, Less less) {
+    for (size_t i = 1; i < n; ++i) {
+        T v = a[i];
+        size_t j = i;
+        for (; j > 0 && less(v, a[j - 1]); --j) a[j] = a[j - 1];
+        a[j] = v;
+    }
+}
+
+// a[-1] is no greater than any element, so the scan needs no bound.
+template <class T, class Less> void unguardedInsertionSort(T *a, size_t n, Less less) {
+    for (size_t i = 1; i < n; ++i) {
+        T v = a[i];
+        T *p = a + i;
+        for (; less(v, p[-1]); --p) *p = p[-1];
+        *p = v;
+    }
+}
+
+// Insertion sort that gives up after moving kPartialInsertionMoves elements;
+// true if it finished.
+template <class T, class Less> bool partialInsertionSort(T *a, size_t n, Less less) {
+    size_t moves = 0;
+    for (size_t i = 1; i < n; ++i) {
+        T v = a[i];
+        size_t j = i;
+        for (; j > 0 && less(v, a[j - 1]); --j) a[j] = a[j - 1];
+        a[j] = v;
+        moves += i - j;
+        if (moves > kPartialInsertionMoves) return i + 1 == n;
+    }
+    return true;
+}
+
+template <class T, class Less> void sort2(T *a, T *b, Less less) {
+    if (less(*b, *a)) std::swap(*a, *b);
+}
+
+template <class T, class Less> void sort3(T *a, T *b, T *c, Less less) {
+    sort2(a, b, less);
+    sort2(b, c, less);
+    sort2(a, b, less);
+}
+
+// Partition around the pivot a[0]: smaller elements to its left, the rest
+// to its right. Needs an element >= the pivot after it (the median-of-3
+// leaves one at the end). Returns the pivot's place and whether no element
+// had to move.
+template <class T, class Less> std::pair<T *, bool> partitionRight(T *begin, T *end, Less less) {
+    T pivot = *begin;
+    T *first = begin, *last = end;
+    while (less(*++first, pivot)) {}
+    if (first - 1 == begin)
+        while (first < last && !less(*--last, pivot)) {}
+    else
+        while (!less(*--last, pivot)) {}
+    bool already = first >= last;
+    while (first < last) {
+        std::swap(*first, *last);
+        while (less(*++first, pivot)) {}
+        while (!less(*--last, pivot)) {}
+    }
+    T *pivotPos = first - 1;
+    *begin = *pivotPos;
+    *pivotPos = pivot;
+    return {pivotPos, already};
+}
+
+// Elements equal to the pivot a[0] to its left, greater ones to its right;
+// used when the pivot equals the element before the range, so everything
+// left of the returned place is done.
+template <class T, class Less> T *partitionLeft(T *begin, T *end, Less less) {
+    T pivot = *begin;
+    T *first = begin, *last = end;
+    while (less(pivot, *--last)) {}
+    if (last + 1 == end)
+        while (first < last && !less(pivot, *++first)) {}
+    else
+        while (!less(pivot, *++first)) {}
+    while (first < last) {
+        std::swap(*first, *last);
+        while (less(pivot, *--last)) {}
+        while (!less(pivot, *++first)) {}
+    }
+    *begin = *last;
+    *last = pivot;
+    return last;
+}
+
+template <class T, class Less>
+void pdqsortLoop(T *begin, T *end, Less less, int badAllowed, bool leftmost) {
+    for (;;) {
+        size_t size = end - begin;
+        if (size < kInsertionSortMax) {
+            if (leftmost)
+                insertionSort(begin, size, less);
+            else
+                unguardedInsertionSort(begin, size, less);
+            return;
+        }
+
+        size_t s2 = size / 2;
+        if (size > kNintherMin) {
+            sort3(begin, begin + s2, end - 1, less);
+            sort3(begin + 1, begin + (s2 - 1), end - 2, less);
+            sort3(begin + 2, begin + (s2 + 1), end - 3, less);
+            sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), less);
+            std::swap(*begin, *(begin + s2));
+        } else {
+            sort3(begin + s2, begin, end - 1, less);
+        }
+
+        // A pivot equal to the previous one: that run is in place already.
+        if (!leftmost && !less(begin[-1], *begin)) {
+            begin = partitionLeft(begin, end, less) + 1;
+            continue;
+        }
+
+        auto [pivotPos, already] = partitionRight(begin, end, less);
+        size_t lSize = pivotPos - begin;
+        size_t rSize = end - (pivotPos + 1);
+        if (lSize < size / 8 || rSize < size / 8) {
+            if (--badAllowed == 0) {
+                std::make_heap(begin, end, less);
+                std::sort_heap(begin, end, less);
+                return;
+            }
+            // Break the pattern that made the pivot bad.
+            if (lSize >= kInsertionSortMax) {
+                std::swap(begin[0], begin[lSize / 4]);
+                std::swap(pivotPos[-1], pivotPos[-(ptrdiff_t)(lSize / 4)]);
+                if (lSize > kNintherMin) {
+                    std::swap(begin[1], begin[lSize / 4 + 1]);
+                    std::swap(begin[2], begin[lSize / 4 + 2]);
+                    std::swap(pivotPos[-2], pivotPos[-(ptrdiff_t)(lSize / 4 + 1)]);
+                    std::swap(pivotPos[-3], pivotPos[-(ptrdiff_t)(lSize / 4 + 2)]);
+                }
+            }
+            if (rSize >= kInsertionSortMax) {
+                std::swap(pivotPos[1], pivotPos[1 + rSize / 4]);
+                std::swap(end[-1], end[-(ptrdiff_t)(rSize / 4)]);
+                if (rSize > kNintherMin) {
+                    std::swap(pivotPos[2], pivotPos[2 + rSize / 4]);
+                    std::swap(pivotPos[3], pivotPos[3 + rSize / 4]);
+                    std::swap(end[-2], end[-(ptrdiff_t)(1 + rSize / 4)]);
+                    std::swap(end[-3], end[-(ptrdiff_t)(2 + rSize / 4)]);
+                }
+            }
+        } else if (already && partialInsertionSort(begin, lSize, less) &&
+                   partialInsertionSort(pivotPos + 1, rSize, less)) {
+            return;
+        }
+
+        pdqsortLoop(begin, pivotPos, less, badAllowed, leftmost);
+        begin = pivotPos + 1;
+        leftmost = false;
+    }
+}
+
+template <class T, class Less> void pdqsortImpl(T *a, size_t n, Less less) {
+    if (n < 2) return;
+    int log2 = 0;
+    for (size_t m = n; m > 1; m >>= 1) ++log2;
+    pdqsortLoop(a, a + n, less, log2, true);
+}
+
+// ---- radix sorts ----------------------------------------------------------------
+
+// Keys whose unsigned order is the order of the values.
+uint64_t intKey(int64_t v) { return static_cast<uint64_t>(v) ^ (uint64_t(1) << 63); }
+
+uint64_t floatKey(double v) {
+    uint64_t bits;
+    if (v != v)
+        bits = 0x7ff8000000000000ull; // every NaN alike, after +inf
+    else if (v == 0.0)
+        bits = 0; // -0.0 == 0.0, as FloatLess has it
+    else
+        std::memcpy(&bits, &v, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits ^ (uint64_t(1) << 63);
+}
+
+// Stable LSD passes over the bytes of key(rec), one counting pass for all
+// eight histograms. A byte shared by every key needs no pass.
+template <class Rec, class KeyOf> void radixPasses(Rec *a, size_t n, KeyOf key) {
+    std::vector<size_t> counts(8 * 256, 0);
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t k = key(a[i]);
+        for (int b = 0; b < 8; ++b) counts[b * 256 + ((k >> (8 * b)) & 255)]++;
+    }
+    std::vector<Rec> buf(n);
+    Rec *from = a, *to = buf.data();
+    uint64_t first = key(a[0]);
+    for (int b = 0; b < 8; ++b) {
+        size_t *c = &counts[b * 256];
+        if (c[(first >> (8 * b)) & 255] == n) continue;
+        size_t sum = 0;
+        for (int d = 0; d < 256; ++d) {
+            size_t t = c[d];
+            c[d] = sum;
+            sum += t;
+        }
+        for (size_t i = 0; i < n; ++i) to[c[(key(from[i]) >> (8 * b)) & 255]++] = from[i];
+        std::swap(from, to);
+    }
+    if (from != a) std::memcpy(a, from, n * sizeof(Rec));
+}
+
+struct KeyedIndex {
+    uint64_t key;
+    uint64_t index;
+};
+
+// Move row perm[i] of values and keys to row i. Follows each cycle with one
+// element in hand, so every value stays in values or a local throughout:
+// the collector never sees a pointer only a runtime buffer holds.
+template <class K> void applyPermutation(int64_t *values, K *keys, std::vector<uint64_t> &perm) {
+    for (size_t i = 0; i < perm.size(); ++i) {
+        if (perm[i] == i) continue;
+        int64_t value = values[i];
+        K key = keys[i];
+        size_t j = i;
+        for (;;) {
+            size_t src = perm[j];
+            perm[j] = j;
+            if (src == i) {
+                values[j] = value;
+                keys[j] = key;
+                break;
+            }
+            values[j] = values[src];
+            keys[j] = keys[src];
+            j = src;
+        }
+    }
+}
+
+template <class K, class KeyOf> void sortByKeysImpl(int64_t *values, K *keys, size_t n, KeyOf keyOf) {
+    if (n < 2) return;
+    std::vector<KeyedIndex> recs(n);
+    for (size_t i = 0; i < n; ++i) recs[i] = {keyOf(keys[i]), i};
+    radixPasses(recs.data(), n, [](const KeyedIndex &r) { return r.key; });
+    std::vector<uint64_t> perm(n);
+    for (size_t i = 0; i < n; ++i) perm[i] = recs[i].index;
+    applyPermutation(values, keys, perm);
+}
+
+// ---- natural merge sort -------------------------------------------------------
+
+// Merge the sorted runs a[lo, mid) and a[mid, hi), left first on ties.
+template <class T, class Less>
+void mergeRuns(T *a, size_t lo, size_t mid, size_t hi, T *buf, Less less) {
+    if (!less(a[mid], a[mid - 1])) return;
+    std::copy(a + lo, a + mid, buf);
+    size_t i = 0, nl = mid - lo, j = mid, k = lo;
+    while (i < nl && j < hi) a[k++] = less(a[j], buf[i]) ? a[j++] : buf[i++];
+    while (i < nl) a[k++] = buf[i++];
+}
+
+template <class T, class Less> void naturalMergeSort(T *a, size_t n, Less less) {
+    if (n < 2) return;
+    std::vector<size_t> bounds{0};
+    for (size_t i = 0; i < n;) {
+        size_t j = i + 1;
+        if (j < n && less(a[j], a[j - 1])) {
+            while (j < n && less(a[j], a[j - 1])) ++j;
+            std::reverse(a + i, a + j); // strictly descending, so still stable
+        } else {
+            while (j < n && !less(a[j], a[j - 1])) ++j;
+        }
+        if (j - i < kMinRun) {
+            j = std::min(n, i + kMinRun);
+            insertionSort(a + i, j - i, less);
+        }
+        bounds.push_back(j);
+        i = j;
+    }
+    if (bounds.size() == 2) return;
+    std::vector<T> buf(n);
+    while (bounds.size() > 2) {
+        std::vector<size_t> next{0};
+        size_t r = 0;
+        for (; r + 2 < bounds.size(); r += 2) {
+            mergeRuns(a, bounds[r], bounds[r + 1], bounds[r + 2], buf.data(), less);
+            next.push_back(bounds[r + 2]);
+        }
+        if (r + 1 < bounds.size()) next.push_back(bounds.back());
+        bounds.swap(next);
+    }
+}
+
+// ---- sample sort --------------------------------------------------------------
+
+template <class T, class Less> struct SampleSort {
+    T *a;
+    size_t n;
+    Less less;
+    std::vector<T> splitters;
+    size_t buckets = 0;
+    size_t chunks = 0, chunkLen = 0;
+    std::vector<uint16_t> bucketOf;
+    std::vector<size_t> offsets; // chunk-major: offsets[c * buckets + b]
+    std::vector<size_t> starts;  // buckets + 1 bounds in buf
+    std::vector<T> buf;
+
+    // Bucket 2i holds elements between splitters i-1 and i, bucket 2i + 1
+    // the ones equal to splitter i.
+    uint16_t classify(T v) const {
+        size_t i = std::lower_bound(splitters.begin(), splitters.end(), v, less) - splitters.begin();
+        if (i < splitters.size() && !less(v, splitters[i])) return static_cast<uint16_t>(2 * i + 1);
+        return static_cast<uint16_t>(2 * i);
+    }
+
+    static void count(void *ctx, int64_t lo, int64_t hi) {
+        auto *s = static_cast<SampleSort *>(ctx);
+        for (int64_t c = lo; c < hi; ++c) {
+            size_t *counts = &s->offsets[c * s->buckets];
+            size_t end = std::min(s->n, (c + 1) * s->chunkLen);
+            for (size_t i = c * s->chunkLen; i < end; ++i) counts[s->bucketOf[i] = s->classify(s->a[i])]++;
+        }
+    }
+
+    static void scatter(void *ctx, int64_t lo, int64_t hi) {
+        auto *s = static_cast<SampleSort *>(ctx);
+        for (int64_t c = lo; c < hi; ++c) {
+            size_t *next = &s->offsets[c * s->buckets];
+            size_t end = std::min(s->n, (c + 1) * s->chunkLen);
+            for (size_t i = c * s->chunkLen; i < end; ++i) s->buf[next[s->bucketOf[i]]++] = s->a[i];
+        }
+    }
+
+    static void finish(void *ctx, int64_t lo, int64_t hi) {
+        auto *s = static_cast<SampleSort *>(ctx);
+        for (int64_t b = lo; b < hi; ++b) {
+            size_t begin = s->starts[b], len = s->starts[b + 1] - begin;
+            if ((b & 1) == 0) pdqsortImpl(s->buf.data() + begin, len, s->less);
+            std::copy(s->buf.data() + begin, s->buf.data() + begin + len, s->a + begin);
+        }
+    }
+
+    void run(size_t ways, size_t threads) {
+        // A fixed-seed xorshift sample: deterministic output placement, and
+        // no pattern in the input lines up with it.
+        size_t sampleSize = std::min(n, ways * kOversample);
+        std::vector<T> sample(sampleSize);
+        uint64_t x = 0x9e3779b97f4a7c15ull ^ n;
+        for (size_t i = 0; i < sampleSize; ++i) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            sample[i] = a[x % n];
+        }
+        pdqsortImpl(sample.data(), sampleSize, less);
+        for (size_t i = 1; i < ways; ++i) {
+            T v = sample[i * sampleSize / ways];
+            if (splitters.empty() || less(splitters.back(), v)) splitters.push_back(v);
+        }
+        buckets = 2 * splitters.size() + 1;
+
+        chunks = std::max<size_t>(1, std::min(n / 4096, threads * 4));
+        chunkLen = (n + chunks - 1) / chunks;
+        bucketOf.resize(n);
+        offsets.assign(chunks * buckets, 0);
+        __tocin_parallel_chunks(static_cast<int64_t>(chunks), &count, this);
+
+        starts.assign(buckets + 1, 0);
+        size_t sum = 0;
+        for (size_t b = 0; b < buckets; ++b) {
+            starts[b] = sum;
+            for (size_t c = 0; c < chunks; ++c) {
+                size_t t = offsets[c * buckets + b];
+                offsets[c * buckets + b] = sum;
+                sum += t;
+            }
+        }
+        starts[buckets] = sum;
+
+        buf.resize(n);
+        __tocin_parallel_chunks(static_cast<int64_t>(chunks), &scatter, this);
+        __tocin_parallel_chunks(static_cast<int64_t>(buckets), &finish, this);
+    }
+};
+
+template <class T, class Less> void sampleSortImpl(T *a, size_t n, size_t ways, Less less) {
+    ways = std::min(ways, kMaxSplitters + 1);
+    if (n < 2 * kInsertionSortMax || ways < 2) {
+        pdqsortImpl(a, n, less);
+        return;
+    }
+    size_t threads = static_cast<size_t>(std::max<int64_t>(1, __tocin_parallel_threads()));
+    SampleSort<T, Less> s{a, n, less};
+    s.run(ways, threads);
+}
+
+template <class T, class Less> void parallelSortImpl(T *a, size_t n, Less less) {
+    int64_t threads = __tocin_parallel_threads();
+    if (n < kParallelSortMin || threads <= 1) {
+        pdqsortImpl(a, n, less);
+        return;
+    }
+    sampleSortImpl(a, n, static_cast<size_t>(threads) * 8, less);
+}
+
+} // namespace
+
+void pdqsort(int64_t *a, size_t n) { pdqsortImpl(a, n, IntLess{}); }
+void pdqsort(double *a, size_t n) { pdqsortImpl(a, n, FloatLess{}); }
+void pdqsort(const char **a, size_t n) { pdqsortImpl(a, n, StringLess{}); }
+
+void radixSort(int64_t *a, size_t n) {
+    if (n < kRadixMin) {
+        insertionSort(a, n, IntLess{});
+        return;
+    }
+    radixPasses(a, n, [](int64_t v) { return intKey(v); });
+}
+
+void stableSort(int64_t *a, size_t n) { naturalMergeSort(a, n, IntLess{}); }
+void stableSort(double *a, size_t n) { naturalMergeSort(a, n, FloatLess{}); }
+
+void sortByKeys(int64_t *values, int64_t *keys, size_t n) { sortByKeysImpl(values, keys, n, intKey); }
+void sortByKeys(int64_t *values, double *keys, size_t n) { sortByKeysImpl(values, keys, n, floatKey); }
+
+void select(int64_t *a, size_t n, size_t k) { std::nth_element(a, a + k, a + n, IntLess{}); }
+void select(double *a, size_t n, size_t k) { std::nth_element(a, a + k, a + n, FloatLess{}); }
+
+void parallelSort(int64_t *a, size_t n) { parallelSortImpl(a, n, IntLess{}); }
+void parallelSort(double *a, size_t n) { parallelSortImpl(a, n, FloatLess{}); }
+
+void sampleSort(int64_t *a, size_t n, size_t ways) { sampleSortImpl(a, n, ways, IntLess{}); }
+void sampleSort(double *a, size_t n, size_t ways) { sampleSortImpl(a, n, ways, FloatLess{}); }
+
+} // namespace runtime
+} // namespace tocin
+
+namespace {
+
+template <class T> T *elementsOf(int64_t *arr) { return reinterpret_cast<T *>(arr + 1); }
+
+} // namespace
+
+extern "C" {
+
+/**
+ * sortI64 / sortF64 / sortStr(xs): sort a list<int>, list<float> or
+ * list<string> in place (unstable, pdqsort).
+ */
+int64_t __tocin_sort_ints(int64_t *xs) {
+    if (size_t n = lengthOf(xs)) tocin::runtime::pdqsort(elementsOf<int64_t>(xs), n);
+    return 0;
+}
+
+int64_t __tocin_sort_floats(int64_t *xs) {
+    if (size_t n = lengthOf(xs)) tocin::runtime::pdqsort(elementsOf<double>(xs), n);
+    return 0;
+}
+
+int64_t __tocin_sort_strings(int64_t *xs) {
+    if (size_t n = lengthOf(xs)) tocin::runtime::pdqsort(elementsOf<const char *>(xs), n);
+    return 0;
+}
+
+// radixSortI64(xs): LSD radix sort of a list<int> in place.
+int64_t __tocin_radix_sort_ints(int64_t *xs) {
+    if (size_t n = lengthOf(xs)) tocin::runtime::radixSort(elementsOf<int64_t>(xs), n);
+    return 0;
+}
+
+// stableSortI64 / stableSortF64(xs): natural merge sort in place.
+int64_t __tocin_stable_sort_ints(int64_t *xs) {
+    if (size_t n = lengthOf(xs)) tocin::runtime::stableSort(elementsOf<int64_t>(xs), n);
+    return 0;
+}
+
+int64_t __tocin_stable_sort_floats(int64_t *xs) {
+    if (size_t n = lengthOf(xs)) tocin::runtime::stableSort(elementsOf<double>(xs), n);
+    return 0;
+}
+
+/**
+ * sortByI64Keys / sortByF64Keys(values, keys): reorder values by ascending
+ * keys, stably, and keys with them. Panics like an index out of range if
+ * keys is shorter than values.
+ */
+int64_t __tocin_sort_by_keys(int64_t *values, int64_t *keys, int64_t floatKeys) {
+    size_t n = lengthOf(values);
+    if (n == 0) return 0;
+    if (lengthOf(keys) < n) __tocin_oob(static_cast<int64_t>(n) - 1, static_cast<int64_t>(lengthOf(keys)));
+    if (floatKeys)
+        tocin::runtime::sortByKeys(elementsOf<int64_t>(values), elementsOf<double>(keys), n);
+    else
+        tocin::runtime::sortByKeys(elementsOf<int64_t>(values), elementsOf<int64_t>(keys), n);
+    return 0;
+}
+
+/**
+ * selectI64 / selectF64(xs, k): partially sort xs in place so xs[k] is the
+ * element a full sort would put at k, with none greater before it and none
+ * less after it. Panics like an index out of range if k is not in xs.
+ */
+int64_t __tocin_select_ints(int64_t *xs, int64_t k) {
+    size_t n = lengthOf(xs);
+    if (k < 0 || static_cast<size_t>(k) >= n) __tocin_oob(k, static_cast<int64_t>(n));
+    tocin::runtime::select(elementsOf<int64_t>(xs), n, static_cast<size_t>(k));
+    return 0;
+}
+
+int64_t __tocin_select_floats(int64_t *xs, int64_t k) {
+    size_t n = lengthOf(xs);
+    if (k < 0 || static_cast<size_t>(k) >= n) __tocin_oob(k, static_cast<int64_t>(n));
+    tocin::runtime::select(elementsOf<double>(xs), n, static_cast<size_t>(k));
+    return 0;
+}
+
+// parallelSortI64 / parallelSortF64(xs): sample sort on the parallel pool.
+int64_t __tocin_parallel_sort_ints(int64_t *xs) {
+    if (size_t n = lengthOf(xs)) tocin::runtime::parallelSort(elementsOf<int64_t>(xs), n);
+    return 0;
+}
+
+int64_t __tocin_parallel_sort_floats(int64_t *xs) {
+    if (size_t n = lengthOf(xs)) tocin::runtime::parallelSort(elementsOf<double>(xs), n);
+    return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,78 @@
+#ifndef TOCIN_SORT_KERNELS_H
+#define TOCIN_SORT_KERNELS_H
+
+/**
+ * Sorting kernels behind the sort builtins of stdlib/data/algorithms.to
+ * (the __tocin_*sort* entry points at the end of sort_kernels.cpp).
+ *
+ * pdqsort() is Orson Peters' pattern-defeating quicksort: insertion sort
+ * below 24 elements, median-of-3 (ninther above 128) pivots, a partition
+ * that puts runs of elements equal to the previous pivot aside in one pass,
+ * a bounded partial insertion sort when a partition found its input already
+ * in order, and a heapsort fallback after log2(n) badly unbalanced
+ * partitions. It is unstable and O(n log n) worst case; sorted, reversed
+ * and few-distinct inputs run in close to linear time.
+ *
+ * radixSort() is an LSD radix sort on the eight bytes of each key, skipping
+ * the passes whose byte is the same in every key (so small ranges pay for
+ * their significant bytes only). stableSort() is a natural merge sort in the
+ * manner of timsort: ascending and strictly descending runs are found (the
+ * latter reversed), short runs are extended to kMinRun with insertion sort,
+ * and neighbouring runs are merged pairwise until one is left.
+ *
+ * sortByKeys() reorders values by a parallel key array with a stable radix
+ * sort of (key, index) pairs, so no comparator is called per element.
+ *
+ * parallelSort() is a sample sort: splitters drawn from a sorted sample
+ * classify the input into buckets on the parallel_for pool, duplicate
+ * splitters get buckets of their own that need no sorting, and the other
+ * buckets are sorted with pdqsort concurrently. Below kParallelSortMin
+ * elements, or on one worker, it is pdqsort.
+ *
+ * select() is selection without a full sort (introselect, as
+ * std::nth_element): quickselect partitions that fall back to a heap-based
+ * selection when they stop shrinking, O(n) on average and O(n log n) at
+ * worst.
+ *
+ * Floats sort NaNs last; strings compare bytewise, like strCmp.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tocin {
+namespace runtime {
+
+constexpr size_t kParallelSortMin = size_t(1) << 16;
+
+void pdqsort(int64_t *a, size_t n);
+void pdqsort(double *a, size_t n);
+void pdqsort(const char **a, size_t n);
+
+void radixSort(int64_t *a, size_t n);
+
+void stableSort(int64_t *a, size_t n);
+void stableSort(double *a, size_t n);
+
+// Reorder values[0, n) by keys[0, n) ascending, stably, and keys with them.
+// Values are opaque 8-byte slots, so any element type can be carried.
+void sortByKeys(int64_t *values, int64_t *keys, size_t n);
+void sortByKeys(int64_t *values, double *keys, size_t n);
+
+// Reorder a[0, n) so a[k] holds what a sort would put there, nothing
+// before it is greater and nothing after it is less. k < n.
+void select(int64_t *a, size_t n, size_t k);
+void select(double *a, size_t n, size_t k);
+
+void parallelSort(int64_t *a, size_t n);
+void parallelSort(double *a, size_t n);
+
+// parallelSort's sample sort with `ways` - 1 splitters whatever the input
+// size or pool; parallelSort uses eight per worker.
+void sampleSort(int64_t *a, size_t n, size_t ways);
+void sampleSort(double *a, size_t n, size_t ways);
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_SORT_KERNELS_H
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace tocin {
+namespace runtime {
+
+/**
+ * @brief Single-producer/single-consumer ring of fixed-size blocks
+ *
+ * `blocks` slots of `blockLen` elements, allocated once. The producer fills
+ * writable() in place and publish()es it; the consumer reads readable() in
+ * place and release()s it. Neither side locks, allocates or copies: each
+ * index is written by one thread only (release) and read by the other
+ * (acquire), and each side keeps a cached copy of the other's index so it
+ * only touches the shared cache line when the ring looks full or empty.
+ *
+ * Hands rendered blocks from an audio graph (audio_graph.h) to the thread
+ * that feeds the audio device. Exactly one thread may produce and one
+ * consume at a time.
+ */
+template <typename T>
+class SpscBlockRing {
+public:
+    SpscBlockRing(size_t blocks, size_t blockLen)
+        : blocks_(blocks ? blocks : 1), blockLen_(blockLen ? blockLen : 1),
+          data_(new T[blocks_ * blockLen_]()) {}
+
+    SpscBlockRing(const SpscBlockRing&) = delete;
+    SpscBlockRing& operator=(const SpscBlockRing&) = delete;
+
+    // Producer: the next free block, or nullptr when the ring is full.
+    T* writable() {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ == blocks_) {
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            if (tail - cachedHead_ == blocks_) return nullptr;
+        }
+        return block(tail);
+    }
+
+    // Producer: hand the block writable() returned to the consumer.
+    void publish() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer: the oldest published block, or nullptr when empty.
+    const T* readable() {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (head == cachedTail_) return nullptr;
+        }
+        return block(head);
+    }
+
+    // Consumer: give the block readable() returned back to the producer.
+    void release() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Published blocks not yet released; approximate while both sides run.
+    size_t sizeApprox() const {
+        uint64_t t = tail_.load(std::memory_order_acquire);
+        uint64_t h = head_.load(std::memory_order_acquire);
+        return t > h ? static_cast<size_t>(t - h) : 0;
+    }
+    size_t capacity() const { return blocks_; }
+    size_t blockLen() const { return blockLen_; }
+
+private:
+    T* block(uint64_t pos) const { return data_.get() + (pos % blocks_) * blockLen_; }
+
+    const size_t blocks_;
+    const size_t blockLen_;
+    std::unique_ptr<T[]> data_;
+    // Consumer side: its index and its view of the producer's.
+    alignas(64) std::atomic<uint64_t> head_{0};
+    uint64_t cachedTail_ = 0;
+    // Producer side.
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    uint64_t cachedHead_ = 0;
+};
+
+} // namespace runtime
+} // namespace tocin
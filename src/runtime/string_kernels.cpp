@@ -0,0 +1,173 @@
+// String scanning kernels: the portable SWAR table, the baseline SIMD table
+// of the target (SSE2 on x86-64, NEON on AArch64), and the dispatch that
+// picks among them and the AVX2 table in string_kernels_avx2.cpp.
+#include "string_kernels_impl.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TOCIN_STRING_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define TOCIN_STRING_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+const char *searchFallback(const char *hay, size_t n, const char *needle, size_t m) {
+    const char *end = hay + n;
+    const char *at = std::search(hay, end, std::boyer_moore_searcher<const char *>(needle, needle + m));
+    return at == end ? nullptr : at;
+}
+
+namespace {
+
+// Eight bytes per 64-bit word. Compare results keep the high bit of each
+// byte, so bits() is the identity.
+struct Swar {
+    using Vec = uint64_t;
+    static constexpr size_t kWidth = 8;
+    static constexpr unsigned kBits = 8;
+    static constexpr uint64_t kAllBits = 0x8080808080808080ull;
+    static constexpr uint64_t kLow7 = 0x7f7f7f7f7f7f7f7full;
+    static constexpr uint64_t kOnes = 0x0101010101010101ull;
+
+    static TOCIN_KERNEL Vec load(const char *p) {
+        Vec v;
+        std::memcpy(&v, p, sizeof v);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap64(v);
+#endif
+        return v;
+    }
+    static TOCIN_KERNEL Vec loadAligned(const char *p) { return load(p); }
+    static TOCIN_KERNEL void store(char *p, Vec v) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = __builtin_bswap64(v);
+#endif
+        std::memcpy(p, &v, sizeof v);
+    }
+    static Vec splat(char c) { return kOnes * (unsigned char)c; }
+    // High bit of every nonzero byte, exactly (no borrow between bytes).
+    static Vec nonzero(Vec x) { return (((x & kLow7) + kLow7) | x) & kAllBits; }
+    static Vec eq(Vec a, Vec b) { return nonzero(a ^ b) ^ kAllBits; }
+    static Vec both(Vec a, Vec b) { return a & b; }
+    static Vec either(Vec a, Vec b) { return a | b; }
+    static Vec diff(Vec a, Vec b) { return a ^ b; }
+    static Vec meet(Vec a, Vec b) { return nonzero(a) & nonzero(b); }
+    static uint64_t bits(Vec v) { return v; }
+    static Vec flipCase(Vec x, char lo) {
+        const Vec low7 = x & kLow7;
+        const Vec atLeastLo = low7 + kOnes * (0x80 - lo);
+        const Vec pastHi = low7 + kOnes * (0x80 - (lo + 26));
+        const Vec inRange = (atLeastLo ^ pastHi) & ~x & kAllBits;
+        return x ^ (inRange >> 2);
+    }
+};
+
+#ifdef TOCIN_STRING_SSE2
+struct Sse2 {
+    using Vec = __m128i;
+    static constexpr size_t kWidth = 16;
+    static constexpr unsigned kBits = 1;
+    static constexpr uint64_t kAllBits = 0xffff;
+
+    static TOCIN_KERNEL Vec load(const char *p) { return _mm_loadu_si128((const __m128i *)p); }
+    static TOCIN_KERNEL Vec loadAligned(const char *p) { return _mm_load_si128((const __m128i *)p); }
+    static TOCIN_KERNEL void store(char *p, Vec v) { _mm_storeu_si128((__m128i *)p, v); }
+    static Vec splat(char c) { return _mm_set1_epi8(c); }
+    static Vec eq(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+    static Vec both(Vec a, Vec b) { return _mm_and_si128(a, b); }
+    static Vec either(Vec a, Vec b) { return _mm_or_si128(a, b); }
+    static Vec diff(Vec a, Vec b) { return _mm_xor_si128(a, b); }
+    static Vec meet(Vec a, Vec b) { return _mm_min_epu8(a, b); }
+    static uint64_t bits(Vec v) { return (uint32_t)_mm_movemask_epi8(v); }
+    // Signed compare on x - (lo + 128) puts lo..lo+25 at the bottom.
+    static Vec flipCase(Vec x, char lo) {
+        Vec shifted = _mm_sub_epi8(x, _mm_set1_epi8((char)(lo + 128)));
+        Vec inRange = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(-128 + 26)));
+        return _mm_xor_si128(x, _mm_and_si128(inRange, _mm_set1_epi8(0x20)));
+    }
+};
+#endif
+
+#ifdef TOCIN_STRING_NEON
+// NEON has no movemask; narrowing each 16-bit lane by 4 leaves four bits
+// per byte in a 64-bit value.
+struct Neon {
+    using Vec = uint8x16_t;
+    static constexpr size_t kWidth = 16;
+    static constexpr unsigned kBits = 4;
+    static constexpr uint64_t kAllBits = ~uint64_t(0);
+
+    static TOCIN_KERNEL Vec load(const char *p) { return vld1q_u8((const uint8_t *)p); }
+    static TOCIN_KERNEL Vec loadAligned(const char *p) { return load(p); }
+    static TOCIN_KERNEL void store(char *p, Vec v) { vst1q_u8((uint8_t *)p, v); }
+    static Vec splat(char c) { return vdupq_n_u8((uint8_t)c); }
+    static Vec eq(Vec a, Vec b) { return vceqq_u8(a, b); }
+    static Vec both(Vec a, Vec b) { return vandq_u8(a, b); }
+    static Vec either(Vec a, Vec b) { return vorrq_u8(a, b); }
+    static Vec diff(Vec a, Vec b) { return veorq_u8(a, b); }
+    static Vec meet(Vec a, Vec b) { return vminq_u8(a, b); }
+    static uint64_t bits(Vec v) {
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+    }
+    static Vec flipCase(Vec x, char lo) {
+        Vec inRange = vcltq_u8(vsubq_u8(x, vdupq_n_u8((uint8_t)lo)), vdupq_n_u8(26));
+        return veorq_u8(x, vandq_u8(inRange, vdupq_n_u8(0x20)));
+    }
+};
+#endif
+
+constexpr StringKernels kSwarKernels = kernelTable<Swar>("swar");
+#ifdef TOCIN_STRING_SSE2
+constexpr StringKernels kSse2Kernels = kernelTable<Sse2>("sse2");
+#endif
+#ifdef TOCIN_STRING_NEON
+constexpr StringKernels kNeonKernels = kernelTable<Neon>("neon");
+#endif
+
+bool cpuHasAvx2() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+const StringKernels *chooseKernels() {
+    auto available = availableStringKernels();
+    if (const char *forced = std::getenv("TOCIN_STRING_KERNELS")) {
+        for (const auto *table : available)
+            if (std::strcmp(table->name, forced) == 0) return table;
+    }
+    return available.back();
+}
+
+} // namespace
+
+std::vector<const StringKernels *> availableStringKernels() {
+    std::vector<const StringKernels *> tables{&kSwarKernels};
+#ifdef TOCIN_STRING_SSE2
+    tables.push_back(&kSse2Kernels);
+#endif
+#ifdef TOCIN_STRING_NEON
+    tables.push_back(&kNeonKernels);
+#endif
+    if (const StringKernels *avx2 = avx2StringKernels())
+        if (cpuHasAvx2()) tables.push_back(avx2);
+    return tables;
+}
+
+const StringKernels &stringKernels() {
+    static const StringKernels *chosen = chooseKernels();
+    return *chosen;
+}
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,53 @@
+#ifndef TOCIN_STRING_KERNELS_H
+#define TOCIN_STRING_KERNELS_H
+
+/**
+ * Vectorized scanning kernels behind the string runtime
+ * (__tocin_str_* in concurrency_runtime.cpp).
+ *
+ * Each instruction set gets one table of kernels; stringKernels() picks the
+ * best one the CPU supports on first use (AVX2, then SSE2 on x86-64, NEON on
+ * AArch64, otherwise word-at-a-time SWAR). Setting TOCIN_STRING_KERNELS to a
+ * table name ("avx2", "sse2", "neon", "swar") forces that table when the CPU
+ * supports it, which is how the benchmark compares them.
+ *
+ * Kernels that scan a NUL-terminated string read whole aligned blocks, so
+ * they may look at bytes past the terminator but never past the end of the
+ * page holding it.
+ */
+
+#include <cstddef>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+struct StringKernels {
+    const char *name;
+    // strlen.
+    size_t (*length)(const char *s);
+    // First `c` in s before its terminator, or nullptr. c == 0 never matches.
+    const char *(*findByte)(const char *s, unsigned char c);
+    // First occurrence of needle[0, m) in hay[0, n), or nullptr. m >= 1.
+    const char *(*find)(const char *hay, size_t n, const char *needle, size_t m);
+    // strcmp(a, b) == 0.
+    bool (*equal)(const char *a, const char *b);
+    // ASCII case mapping of n bytes; other bytes are copied unchanged.
+    void (*toUpper)(char *out, const char *s, size_t n);
+    void (*toLower)(char *out, const char *s, size_t n);
+};
+
+// The table the runtime uses.
+const StringKernels &stringKernels();
+
+// Every table this CPU can run, portable one first.
+std::vector<const StringKernels *> availableStringKernels();
+
+// Defined in string_kernels_avx2.cpp, which is the only file built with
+// AVX2 enabled; nullptr when the compiler cannot target AVX2.
+const StringKernels *avx2StringKernels();
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_STRING_KERNELS_H
@@ -0,0 +1,50 @@
+// The AVX2 string kernels. This is the only runtime file built with -mavx2
+// (see CMakeLists.txt); stringKernels() calls into it only after checking
+// the CPU.
+#include "string_kernels_impl.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace tocin {
+namespace runtime {
+
+#ifdef __AVX2__
+namespace {
+
+struct Avx2 {
+    using Vec = __m256i;
+    static constexpr size_t kWidth = 32;
+    static constexpr unsigned kBits = 1;
+    static constexpr uint64_t kAllBits = 0xffffffffull;
+
+    static TOCIN_KERNEL Vec load(const char *p) { return _mm256_loadu_si256((const __m256i *)p); }
+    static TOCIN_KERNEL Vec loadAligned(const char *p) { return _mm256_load_si256((const __m256i *)p); }
+    static TOCIN_KERNEL void store(char *p, Vec v) { _mm256_storeu_si256((__m256i *)p, v); }
+    static Vec splat(char c) { return _mm256_set1_epi8(c); }
+    static Vec eq(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+    static Vec both(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+    static Vec either(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+    static Vec diff(Vec a, Vec b) { return _mm256_xor_si256(a, b); }
+    static Vec meet(Vec a, Vec b) { return _mm256_min_epu8(a, b); }
+    static uint64_t bits(Vec v) { return (uint32_t)_mm256_movemask_epi8(v); }
+    // Same range trick as SSE2: AVX2 only has a signed greater-than.
+    static Vec flipCase(Vec x, char lo) {
+        Vec shifted = _mm256_sub_epi8(x, _mm256_set1_epi8((char)(lo + 128)));
+        Vec inRange = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(-128 + 26)), shifted);
+        return _mm256_xor_si256(x, _mm256_and_si256(inRange, _mm256_set1_epi8(0x20)));
+    }
+};
+
+constexpr StringKernels kAvx2Kernels = kernelTable<Avx2>("avx2");
+
+} // namespace
+
+const StringKernels *avx2StringKernels() { return &kAvx2Kernels; }
+#else
+const StringKernels *avx2StringKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
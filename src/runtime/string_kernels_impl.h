@@ -0,0 +1,268 @@
+#ifndef TOCIN_STRING_KERNELS_IMPL_H
+#define TOCIN_STRING_KERNELS_IMPL_H
+
+// Kernel bodies shared by every instruction set, written against a small
+// vector interface:
+//
+//   Vec                     one block of kWidth bytes
+//   loadAligned(p) load(p)   block at p (the first needs p % kWidth == 0)
+//   store(p, v)              unaligned store
+//   splat(c)                 every byte c
+//   eq(a, b) both(a, b) either(a, b) diff(a, b)  (diff is a ^ b)
+//   meet(a, b)               zero exactly in the bytes where a or b is zero
+//   bits(v)                  per-byte mask of a compare result, kBits bits
+//                            per byte, byte 0 in the low bits
+//   flipCase(v, lo)          v with the 0x20 bit flipped in bytes lo..lo+25
+//
+// Only included by string_kernels.cpp and string_kernels_avx2.cpp, and
+// everything here has internal linkage: the AVX2 file is compiled with
+// -mavx2, and a shared inline definition could hand AVX2 code to a CPU
+// without it. For the same reason nothing here instantiates a standard
+// library template; the one search that needs a real algorithm calls
+// searchFallback() in the baseline file.
+
+#include "string_kernels.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TOCIN_KERNEL __attribute__((no_sanitize_address)) inline
+#else
+#define TOCIN_KERNEL inline
+#endif
+
+namespace tocin {
+namespace runtime {
+
+// Linear-time substring search (std::boyer_moore_searcher), for needles the
+// block filter keeps matching without finding.
+const char *searchFallback(const char *hay, size_t n, const char *needle, size_t m);
+
+namespace {
+
+// A block load never crosses a page, so reading past a terminator is safe
+// as long as the block ends on the page that holds it.
+constexpr uintptr_t kPageSize = 4096;
+
+inline unsigned countTrailingZeros(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+template <class I, size_t kBytes> inline bool blockFitsPage(const char *p) {
+    return ((uintptr_t)p & (kPageSize - 1)) <= kPageSize - kBytes;
+}
+
+template <class I> inline size_t firstByte(uint64_t mask) {
+    return countTrailingZeros(mask) / I::kBits;
+}
+
+template <class I> inline uint64_t dropFirstByte(uint64_t mask) {
+    const uint64_t byte = (uint64_t(1) << I::kBits) - 1;
+    return mask & ~(byte << (firstByte<I>(mask) * I::kBits));
+}
+
+template <class I> using Vec = typename I::Vec;
+
+template <class I> TOCIN_KERNEL bool anySet(Vec<I> v0, Vec<I> v1, Vec<I> v2, Vec<I> v3) {
+    return I::bits(I::either(I::either(v0, v1), I::either(v2, v3))) != 0;
+}
+
+// Offset, within four consecutive blocks, of the first byte set in their
+// compare results; the caller knows there is one.
+template <class I> TOCIN_KERNEL size_t firstInGroup(Vec<I> v0, Vec<I> v1, Vec<I> v2, Vec<I> v3) {
+    uint64_t mask;
+    if ((mask = I::bits(v0))) return firstByte<I>(mask);
+    if ((mask = I::bits(v1))) return I::kWidth + firstByte<I>(mask);
+    if ((mask = I::bits(v2))) return 2 * I::kWidth + firstByte<I>(mask);
+    return 3 * I::kWidth + firstByte<I>(I::bits(v3));
+}
+
+// The scans of NUL-terminated strings read aligned blocks one at a time up
+// to a boundary of four blocks, then four at a time; an aligned group never
+// crosses a page either. Each scan maps a block to one whose zero bytes are
+// the bytes it stops at, so a group is tested with meet() and one compare.
+template <class I> TOCIN_KERNEL size_t lengthOf(const char *s) {
+    constexpr size_t kGroup = 4 * I::kWidth;
+    const auto zero = I::splat(0);
+    const uintptr_t offset = (uintptr_t)s & (I::kWidth - 1);
+    const char *p = s - offset;
+    uint64_t mask = I::bits(I::eq(I::loadAligned(p), zero)) >> (offset * I::kBits);
+    if (mask) return firstByte<I>(mask);
+    for (p += I::kWidth; (uintptr_t)p & (kGroup - 1); p += I::kWidth) {
+        mask = I::bits(I::eq(I::loadAligned(p), zero));
+        if (mask) return (size_t)(p - s) + firstByte<I>(mask);
+    }
+    for (;; p += kGroup) {
+        auto v0 = I::loadAligned(p), v1 = I::loadAligned(p + I::kWidth);
+        auto v2 = I::loadAligned(p + 2 * I::kWidth), v3 = I::loadAligned(p + 3 * I::kWidth);
+        if (I::bits(I::eq(I::meet(I::meet(v0, v1), I::meet(v2, v3)), zero)))
+            return (size_t)(p - s) + firstInGroup<I>(I::eq(v0, zero), I::eq(v1, zero),
+                                                     I::eq(v2, zero), I::eq(v3, zero));
+    }
+}
+
+// Zero where the block holds `want` or the terminator.
+template <class I> TOCIN_KERNEL Vec<I> byteOrEnd(const char *block, Vec<I> want) {
+    auto v = I::loadAligned(block);
+    return I::meet(I::diff(v, want), v);
+}
+
+template <class I> TOCIN_KERNEL const char *findByteIn(const char *s, unsigned char c) {
+    if (c == 0) return nullptr;
+    constexpr size_t kGroup = 4 * I::kWidth;
+    const auto want = I::splat((char)c), zero = I::splat(0);
+    const uintptr_t offset = (uintptr_t)s & (I::kWidth - 1);
+    const char *p = s - offset;
+    const char *at = nullptr;
+    uint64_t mask = I::bits(I::eq(byteOrEnd<I>(p, want), zero)) >> (offset * I::kBits);
+    if (mask) {
+        at = s + firstByte<I>(mask);
+    } else {
+        for (p += I::kWidth; (uintptr_t)p & (kGroup - 1); p += I::kWidth) {
+            mask = I::bits(I::eq(byteOrEnd<I>(p, want), zero));
+            if (mask) {
+                at = p + firstByte<I>(mask);
+                break;
+            }
+        }
+        for (; !at; p += kGroup) {
+            auto h0 = byteOrEnd<I>(p, want), h1 = byteOrEnd<I>(p + I::kWidth, want);
+            auto h2 = byteOrEnd<I>(p + 2 * I::kWidth, want), h3 = byteOrEnd<I>(p + 3 * I::kWidth, want);
+            if (I::bits(I::eq(I::meet(I::meet(h0, h1), I::meet(h2, h3)), zero)))
+                at = p + firstInGroup<I>(I::eq(h0, zero), I::eq(h1, zero), I::eq(h2, zero), I::eq(h3, zero));
+        }
+    }
+    return *at ? at : nullptr;
+}
+
+// Zero where a and b differ or a ends.
+template <class I> TOCIN_KERNEL Vec<I> differOrEnd(const char *a, const char *b) {
+    auto va = I::load(a);
+    return I::meet(va, I::eq(va, I::load(b)));
+}
+
+// The two strings are rarely aligned alike, so this uses unaligned loads
+// and checks that they stay on the page.
+template <class I> TOCIN_KERNEL bool equalStrings(const char *a, const char *b) {
+    if (a == b) return true;
+    constexpr size_t kGroup = 4 * I::kWidth;
+    const auto zero = I::splat(0);
+    for (;;) {
+        if (blockFitsPage<I, kGroup>(a) && blockFitsPage<I, kGroup>(b)) {
+            auto d0 = differOrEnd<I>(a, b), d1 = differOrEnd<I>(a + I::kWidth, b + I::kWidth);
+            auto d2 = differOrEnd<I>(a + 2 * I::kWidth, b + 2 * I::kWidth);
+            auto d3 = differOrEnd<I>(a + 3 * I::kWidth, b + 3 * I::kWidth);
+            if (I::bits(I::eq(I::meet(I::meet(d0, d1), I::meet(d2, d3)), zero))) {
+                size_t i = firstInGroup<I>(I::eq(d0, zero), I::eq(d1, zero), I::eq(d2, zero), I::eq(d3, zero));
+                return a[i] == b[i];
+            }
+            a += kGroup;
+            b += kGroup;
+        } else if (blockFitsPage<I, I::kWidth>(a) && blockFitsPage<I, I::kWidth>(b)) {
+            if (uint64_t mask = I::bits(I::eq(differOrEnd<I>(a, b), zero))) {
+                size_t i = firstByte<I>(mask);
+                return a[i] == b[i];
+            }
+            a += I::kWidth;
+            b += I::kWidth;
+        } else {
+            // Near the end of a page: go bytewise up to the next block.
+            for (size_t i = 0; i < I::kWidth; ++i, ++a, ++b) {
+                if (*a != *b) return false;
+                if (!*a) return true;
+            }
+        }
+    }
+}
+
+template <class I> TOCIN_KERNEL Vec<I> candidates(const char *at, size_t m, Vec<I> first, Vec<I> last) {
+    return I::both(I::eq(I::load(at), first), I::eq(I::load(at + m - 1), last));
+}
+
+// Block filter on the needle's first and last bytes (every candidate is
+// then checked with memcmp). The haystack length is known, so this never
+// reads past it and needs no page checks. Once the false candidates outnumber the
+// blocks scanned, the rest of the search is handed to searchFallback so a
+// hostile needle cannot make the search quadratic.
+template <class I>
+inline const char *findIn(const char *hay, size_t n, const char *needle, size_t m) {
+    if (m > n) return nullptr;
+    if (m == 1) return (const char *)std::memchr(hay, needle[0], n);
+    constexpr size_t kGroup = 4 * I::kWidth;
+    const auto first = I::splat(needle[0]), last = I::splat(needle[m - 1]);
+    size_t i = 0, misses = 0;
+    // Verifies the candidates of the block at `base`.
+    const char *found = nullptr;
+    bool giveUp = false;
+    auto check = [&](size_t base, uint64_t mask) {
+        while (mask) {
+            const char *at = hay + base + firstByte<I>(mask);
+            if (std::memcmp(at + 1, needle + 1, m - 2) == 0) {
+                found = at;
+                return;
+            }
+            if (++misses > 16 + base / I::kWidth) {
+                giveUp = true;
+                return;
+            }
+            mask = dropFirstByte<I>(mask);
+        }
+    };
+    for (; i + m - 1 + kGroup <= n; i += kGroup) {
+        auto c0 = candidates<I>(hay + i, m, first, last);
+        auto c1 = candidates<I>(hay + i + I::kWidth, m, first, last);
+        auto c2 = candidates<I>(hay + i + 2 * I::kWidth, m, first, last);
+        auto c3 = candidates<I>(hay + i + 3 * I::kWidth, m, first, last);
+        if (!anySet<I>(c0, c1, c2, c3)) continue;
+        const Vec<I> group[4] = {c0, c1, c2, c3};
+        for (size_t k = 0; k < 4 && !found && !giveUp; ++k) check(i + k * I::kWidth, I::bits(group[k]));
+        if (found) return found;
+        if (giveUp) return searchFallback(hay + i, n - i, needle, m);
+    }
+    for (; i + m - 1 + I::kWidth <= n; i += I::kWidth) {
+        check(i, I::bits(candidates<I>(hay + i, m, first, last)));
+        if (found) return found;
+        if (giveUp) return searchFallback(hay + i, n - i, needle, m);
+    }
+    for (; i + m <= n; ++i)
+        if (hay[i] == needle[0] && std::memcmp(hay + i + 1, needle + 1, m - 1) == 0) return hay + i;
+    return nullptr;
+}
+
+template <class I> TOCIN_KERNEL void mapCase(char *out, const char *s, size_t n, char lo) {
+    size_t i = 0;
+    for (; i + I::kWidth <= n; i += I::kWidth) I::store(out + i, I::flipCase(I::load(s + i), lo));
+    for (; i < n; ++i) {
+        unsigned char c = (unsigned char)s[i];
+        out[i] = (char)((unsigned char)(c - lo) < 26 ? c ^ 0x20 : c);
+    }
+}
+
+template <class I> TOCIN_KERNEL void upperOf(char *out, const char *s, size_t n) {
+    mapCase<I>(out, s, n, 'a');
+}
+
+template <class I> TOCIN_KERNEL void lowerOf(char *out, const char *s, size_t n) {
+    mapCase<I>(out, s, n, 'A');
+}
+
+template <class I> constexpr StringKernels kernelTable(const char *name) {
+    return StringKernels{name,          &lengthOf<I>,   &findByteIn<I>, &findIn<I>,
+                         &equalStrings<I>, &upperOf<I>, &lowerOf<I>};
+}
+
+} // namespace
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_STRING_KERNELS_IMPL_H
@@ -0,0 +1,294 @@
+// WaitGroup, Mutex, RWLock and Once: the slow paths, where a caller queues
+// an ExecutorWaiter, and the builtins over them. See sync.h.
+//
+// A waiter is fired under the primitive's mutex and takes that mutex once
+// more after it wakes, so it cannot return (and free the waiter on its
+// stack) while fire() is still running.
+#include "sync.h"
+
+#include "executor.h"
+
+extern "C" void __tocin_panic(const char *msg, const char *loc);
+
+namespace tocin {
+namespace runtime {
+
+namespace {
+
+// Retries before a contended lock queues: long enough to ride out a short
+// critical section on another core, short next to a park.
+constexpr int kSpins = 100;
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Wait on w, queued under `lock`, until it is fired with the lock held.
+void park(ExecutorWaiter &w, std::unique_lock<std::mutex> &lock) {
+    lock.unlock();
+    w.wait();
+    lock.lock();
+}
+
+} // namespace
+
+// ---- WaitGroup ----
+
+void WaitGroup::add(int64_t n) {
+    int64_t now = count_.fetch_add(n, std::memory_order_acq_rel) + n;
+    if (now < 0) __tocin_panic("negative WaitGroup counter", "");
+    if (now != 0) return;
+    std::lock_guard<std::mutex> lock(m_);
+    for (ExecutorWaiter *w : waiters_) w->fire();
+    waiters_.clear();
+}
+
+void WaitGroup::wait() {
+    if (count() == 0) return;
+    std::unique_lock<std::mutex> lock(m_);
+    if (count() == 0) return;
+    ExecutorWaiter w;
+    waiters_.push_back(&w);
+    park(w, lock);
+}
+
+// ---- Mutex ----
+
+void Mutex::lockSlow() {
+    for (int i = 0; i < kSpins; ++i) {
+        int s = state_.load(std::memory_order_relaxed);
+        if (s & kWaiters) break;
+        if (!(s & kLocked) &&
+            state_.compare_exchange_weak(s, s | kLocked, std::memory_order_acquire, std::memory_order_relaxed))
+            return;
+        cpuRelax();
+    }
+    std::unique_lock<std::mutex> lock(m_);
+    // With the queue bit set, unlock() takes m_ and hands the lock over; an
+    // unlocked word never has it, so finding the lock free means taking it.
+    for (int s = state_.load(std::memory_order_relaxed);;) {
+        if (!(s & kLocked)) {
+            if (state_.compare_exchange_weak(s, s | kLocked, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+        } else if ((s & kWaiters) ||
+                   state_.compare_exchange_weak(s, s | kWaiters, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    ExecutorWaiter w;
+    waiters_.push_back(&w);
+    park(w, lock);
+    // unlockSlow() left kLocked set for us.
+}
+
+void Mutex::unlockSlow() {
+    std::lock_guard<std::mutex> lock(m_);
+    if (waiters_.empty()) {
+        state_.store(0, std::memory_order_release);
+        return;
+    }
+    ExecutorWaiter *next = waiters_.front();
+    waiters_.pop_front();
+    if (waiters_.empty()) state_.store(kLocked, std::memory_order_relaxed);
+    next->fire();
+}
+
+// ---- RWLock ----
+
+struct RWLock::Waiter {
+    ExecutorWaiter ready;
+    bool writer;
+};
+
+void RWLock::enqueueLocked(Waiter &w, std::unique_lock<std::mutex> &lock) {
+    waiters_.push_back(&w);
+    park(w.ready, lock);
+    // dispatchLocked() counted us in before firing.
+}
+
+void RWLock::readLockSlow() {
+    std::unique_lock<std::mutex> lock(m_);
+    for (int64_t s = state_.load(std::memory_order_relaxed);;) {
+        if (!(s & (kWriter | kWaiting))) {
+            if (state_.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+        } else if ((s & kWaiting) ||
+                   state_.compare_exchange_weak(s, s | kWaiting, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    Waiter w{{}, false};
+    enqueueLocked(w, lock);
+}
+
+void RWLock::lockSlow() {
+    for (int i = 0; i < kSpins; ++i) {
+        int64_t free = 0;
+        if (state_.compare_exchange_weak(free, kWriter, std::memory_order_acquire, std::memory_order_relaxed))
+            return;
+        if (free & kWaiting) break;
+        cpuRelax();
+    }
+    std::unique_lock<std::mutex> lock(m_);
+    for (int64_t s = state_.load(std::memory_order_relaxed);;) {
+        if (s == 0) {
+            if (state_.compare_exchange_weak(s, kWriter, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+        } else if ((s & kWaiting) ||
+                   state_.compare_exchange_weak(s, s | kWaiting, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    Waiter w{{}, true};
+    enqueueLocked(w, lock);
+}
+
+void RWLock::unlockSlow() {
+    std::lock_guard<std::mutex> lock(m_);
+    state_.fetch_and(~kWriter, std::memory_order_release);
+    dispatchLocked();
+}
+
+void RWLock::wake() {
+    std::lock_guard<std::mutex> lock(m_);
+    dispatchLocked();
+}
+
+// Admit the next writer, or the readers queued ahead of it. While kWaiting
+// is set the fast paths all fail, so only this (under m_) and readers
+// leaving change the word.
+void RWLock::dispatchLocked() {
+    while (!waiters_.empty()) {
+        int64_t s = state_.load(std::memory_order_acquire);
+        if (s & kWriter) return;
+        Waiter *w = waiters_.front();
+        if (w->writer && (s & kReaders)) return; // the last reader out dispatches again
+        waiters_.pop_front();
+        state_.fetch_add(w->writer ? kWriter : 1, std::memory_order_acquire);
+        if (waiters_.empty()) state_.fetch_and(~kWaiting, std::memory_order_relaxed);
+        w->ready.fire();
+        if (w->writer) return;
+    }
+    state_.fetch_and(~kWaiting, std::memory_order_relaxed);
+}
+
+// ---- Once ----
+
+void Once::callSlow(const std::function<void()> &fn) {
+    std::unique_lock<std::mutex> lock(m_);
+    if (state_.load(std::memory_order_relaxed) == kRunning) {
+        ExecutorWaiter w;
+        waiters_.push_back(&w);
+        park(w, lock);
+        return;
+    }
+    if (state_.load(std::memory_order_relaxed) == kDone) return;
+    state_.store(kRunning, std::memory_order_relaxed);
+    lock.unlock();
+
+    auto finish = [this] {
+        std::lock_guard<std::mutex> relock(m_);
+        state_.store(kDone, std::memory_order_release);
+        for (ExecutorWaiter *w : waiters_) w->fire();
+        waiters_.clear();
+    };
+    try {
+        fn();
+    } catch (...) {
+        finish();
+        throw;
+    }
+    finish();
+}
+
+} // namespace runtime
+} // namespace tocin
+
+// ---- builtins ----
+//
+// A handle is a heap-allocated primitive; syncFree frees any of them. The
+// caller must be done with it: nothing may be waiting on it or hold it.
+
+namespace {
+
+using namespace tocin::runtime;
+
+template <class T> int64_t make() { return reinterpret_cast<int64_t>(static_cast<SyncObject *>(new T())); }
+template <class T> T *of(int64_t h) { return static_cast<T *>(reinterpret_cast<SyncObject *>(h)); }
+
+} // namespace
+
+extern "C" {
+
+int64_t __tocin_sync_free(int64_t h) {
+    delete reinterpret_cast<SyncObject *>(h);
+    return 0;
+}
+
+// waitGroupNew() / waitGroupAdd(wg, n) / waitGroupDone(wg) / waitGroupWait(wg).
+int64_t __tocin_wg_new() { return make<WaitGroup>(); }
+int64_t __tocin_wg_add(int64_t wg, int64_t n) {
+    if (wg) of<WaitGroup>(wg)->add(n);
+    return 0;
+}
+int64_t __tocin_wg_done(int64_t wg) {
+    if (wg) of<WaitGroup>(wg)->done();
+    return 0;
+}
+int64_t __tocin_wg_wait(int64_t wg) {
+    if (wg) of<WaitGroup>(wg)->wait();
+    return 0;
+}
+
+// mutexNew() / mutexLock(m) / mutexUnlock(m); mutexTryLock(m) is 1 if it
+// took the lock.
+int64_t __tocin_mutex_new() { return make<Mutex>(); }
+int64_t __tocin_mutex_lock(int64_t m) {
+    if (m) of<Mutex>(m)->lock();
+    return 0;
+}
+int64_t __tocin_mutex_try_lock(int64_t m) { return m && of<Mutex>(m)->tryLock() ? 1 : 0; }
+int64_t __tocin_mutex_unlock(int64_t m) {
+    if (m) of<Mutex>(m)->unlock();
+    return 0;
+}
+
+// rwlockNew() / rwlockRLock / rwlockRUnlock / rwlockLock / rwlockUnlock.
+int64_t __tocin_rwlock_new() { return make<RWLock>(); }
+int64_t __tocin_rwlock_rlock(int64_t l) {
+    if (l) of<RWLock>(l)->readLock();
+    return 0;
+}
+int64_t __tocin_rwlock_runlock(int64_t l) {
+    if (l) of<RWLock>(l)->readUnlock();
+    return 0;
+}
+int64_t __tocin_rwlock_lock(int64_t l) {
+    if (l) of<RWLock>(l)->lock();
+    return 0;
+}
+int64_t __tocin_rwlock_unlock(int64_t l) {
+    if (l) of<RWLock>(l)->unlock();
+    return 0;
+}
+
+// onceNew() / onceDo(o, f): f is a closure taking no arguments (env-first
+// ABI, its result ignored). 1 if this call ran it.
+int64_t __tocin_once_new() { return make<Once>(); }
+int64_t __tocin_once_do(int64_t o, void *closure) {
+    if (!o || !closure) return 0;
+    Once *once = of<Once>(o);
+    if (once->done()) return 0;
+    bool ran = false;
+    once->call([&] {
+        ran = true;
+        (*reinterpret_cast<void (**)(void *)>(closure))(closure);
+    });
+    return ran ? 1 : 0;
+}
+
+} // extern "C"
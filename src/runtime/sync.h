@@ -0,0 +1,164 @@
+#ifndef TOCIN_SYNC_H
+#define TOCIN_SYNC_H
+
+/**
+ * Goroutine-aware synchronization: the WaitGroup, Mutex, RWLock and Once
+ * behind the waitGroup*, mutex*, rwlock* and once* builtins
+ * (__tocin_wg_*, __tocin_mutex_*, __tocin_rwlock_*, __tocin_once_* in
+ * sync.cpp).
+ *
+ * Each primitive is one atomic word on the uncontended path: locking a free
+ * Mutex, read-locking an RWLock no writer holds or waits for, and calling a
+ * Once that has run are a compare-and-swap or a load, with no system call.
+ * A caller that has to wait spins briefly and then queues an
+ * ExecutorWaiter (executor.h), which parks a goroutine's fiber, so its
+ * worker runs other goroutines, and blocks a plain thread on a condition
+ * variable.
+ *
+ * Waiters are served in order by handing the primitive over: Mutex::unlock
+ * passes the lock straight to the oldest waiter, and RWLock::unlock admits
+ * either the next writer or every reader queued before it. Once a writer
+ * waits, new readers queue behind it, so a stream of readers cannot starve
+ * writers. A Mutex or RWLock may be unlocked by a goroutine other than the
+ * one that locked it.
+ *
+ * Every method may be called from any thread or goroutine.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+class ExecutorWaiter;
+
+// The common base of the primitives, so one handle type frees any of them.
+class SyncObject {
+public:
+    virtual ~SyncObject() = default;
+};
+
+// Counts outstanding work; wait() returns once the count is back to zero.
+class WaitGroup : public SyncObject {
+public:
+    // Adds n (which may be negative) to the count. The count going below
+    // zero is a fatal error, as a done() without its add() is.
+    void add(int64_t n);
+    void done() { add(-1); }
+    void wait();
+    int64_t count() const { return count_.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<int64_t> count_{0};
+    std::mutex m_;
+    std::vector<ExecutorWaiter*> waiters_;
+};
+
+class Mutex : public SyncObject {
+public:
+    void lock() {
+        int free = 0;
+        if (!state_.compare_exchange_strong(free, kLocked, std::memory_order_acquire, std::memory_order_relaxed))
+            lockSlow();
+    }
+    bool tryLock() {
+        int free = 0;
+        return state_.compare_exchange_strong(free, kLocked, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+    void unlock() {
+        int held = kLocked;
+        if (!state_.compare_exchange_strong(held, 0, std::memory_order_release, std::memory_order_relaxed))
+            unlockSlow();
+    }
+    bool locked() const { return state_.load(std::memory_order_relaxed) & kLocked; }
+
+private:
+    static constexpr int kLocked = 1;
+    static constexpr int kWaiters = 2; // the queue is not empty
+
+    void lockSlow();
+    void unlockSlow();
+
+    std::atomic<int> state_{0};
+    std::mutex m_;                       // guards waiters_
+    std::deque<ExecutorWaiter*> waiters_;
+};
+
+// Many readers or one writer.
+class RWLock : public SyncObject {
+public:
+    void readLock() {
+        int64_t s = state_.load(std::memory_order_relaxed);
+        while (!(s & (kWriter | kWaiting)))
+            if (state_.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+        readLockSlow();
+    }
+    void readUnlock() {
+        // The last reader out hands the lock to whoever queued meanwhile.
+        if (state_.fetch_sub(1, std::memory_order_acq_rel) - 1 == kWaiting)
+            wake();
+    }
+    void lock() {
+        int64_t free = 0;
+        if (!state_.compare_exchange_strong(free, kWriter, std::memory_order_acquire, std::memory_order_relaxed))
+            lockSlow();
+    }
+    void unlock() {
+        int64_t held = kWriter;
+        if (!state_.compare_exchange_strong(held, 0, std::memory_order_release, std::memory_order_relaxed))
+            unlockSlow();
+    }
+    int64_t readers() const { return state_.load(std::memory_order_relaxed) & kReaders; }
+
+private:
+    // state_: the reader count in the low 32 bits, then a writer-holds bit
+    // and a somebody-is-queued bit.
+    static constexpr int64_t kReaders = (int64_t(1) << 32) - 1;
+    static constexpr int64_t kWriter = int64_t(1) << 32;
+    static constexpr int64_t kWaiting = int64_t(1) << 33;
+
+    struct Waiter;
+    void readLockSlow();
+    void lockSlow();
+    void unlockSlow();
+    void wake();
+    void dispatchLocked();
+    void enqueueLocked(Waiter& w, std::unique_lock<std::mutex>& lock);
+
+    std::atomic<int64_t> state_{0};
+    std::mutex m_;                       // guards waiters_
+    std::deque<Waiter*> waiters_;
+};
+
+// Runs a function once, however many goroutines ask at the same time.
+class Once : public SyncObject {
+public:
+    // Runs fn unless a call already has; callers that arrive while it is
+    // running wait for it to finish. An exception fn throws counts as
+    // finishing: it propagates to this caller and fn is not run again.
+    void call(const std::function<void()>& fn) {
+        if (state_.load(std::memory_order_acquire) != kDone)
+            callSlow(fn);
+    }
+    bool done() const { return state_.load(std::memory_order_acquire) == kDone; }
+
+private:
+    enum : int { kIdle, kRunning, kDone };
+
+    void callSlow(const std::function<void()>& fn);
+
+    std::atomic<int> state_{kIdle};
+    std::mutex m_;
+    std::vector<ExecutorWaiter*> waiters_;
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_SYNC_H
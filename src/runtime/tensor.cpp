@@ -0,0 +1,864 @@
+// Tensors: the storage pool, views, the lazy expression graph and the
+// chunked evaluator that runs it, the baseline kernel table and the
+// dispatch that picks among it and the AVX2 table, and the tensor*
+// builtins' entry points.
+#include "tensor_impl.h"
+#include "kernel_support.h"
+
+#include "linalg_kernels.h"
+#include "quant_kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+
+namespace tocin {
+namespace runtime {
+
+// A node of a lazy elementwise expression. Leaves hold a view of stored
+// elements, so an expression keeps its inputs' storage alive.
+struct TensorExpr {
+    enum class Kind { Leaf, Const, Unary, Binary };
+    Kind kind = Kind::Leaf;
+    int op = 0;
+    double value = 0;
+    Tensor leaf;
+    std::shared_ptr<const TensorExpr> a, b;
+    TensorShape shape;
+    int nodes = 1;
+};
+
+namespace {
+
+constexpr TensorKernels kScalarKernels{"scalar", &binaryLoops, &unaryLoops, &sumLoop};
+
+bool cpuHasAvx2() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+const TensorKernels *chooseKernels() {
+    auto available = availableTensorKernels();
+    if (const char *forced = std::getenv("TOCIN_TENSOR_KERNELS")) {
+        for (const auto *table : available)
+            if (std::strcmp(table->name, forced) == 0) return table;
+    }
+    return available.back();
+}
+
+// ---- storage pool ----
+
+// Power-of-two size classes from 64 doubles; blocks past the cap on cached
+// bytes go back to the system.
+constexpr int kMinClass = 6;
+constexpr int kClasses = 40;
+constexpr uint64_t kMaxCachedBytes = uint64_t(256) << 20;
+
+class StoragePool {
+  public:
+    double *acquire(size_t n, size_t &capacity) {
+        int c = kMinClass;
+        while ((size_t(1) << c) < n && c < kClasses - 1) ++c;
+        capacity = size_t(1) << c;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (!free_[c].empty()) {
+                double *p = free_[c].back();
+                free_[c].pop_back();
+                cached_ -= capacity * sizeof(double);
+                ++reused_;
+                return p;
+            }
+            ++fresh_;
+        }
+        void *p = std::aligned_alloc(64, capacity * sizeof(double));
+        if (!p) throw std::bad_alloc();
+        return static_cast<double *>(p);
+    }
+
+    void release(double *p, size_t capacity) {
+        int c = kMinClass;
+        while ((size_t(1) << c) < capacity) ++c;
+        uint64_t bytes = capacity * sizeof(double);
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (cached_ + bytes <= kMaxCachedBytes) {
+                free_[c].push_back(p);
+                cached_ += bytes;
+                return;
+            }
+        }
+        std::free(p);
+    }
+
+    TensorPoolStats stats() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return {cached_, reused_, fresh_};
+    }
+
+  private:
+    std::mutex mu_;
+    std::vector<double *> free_[kClasses];
+    uint64_t cached_ = 0, reused_ = 0, fresh_ = 0;
+};
+
+StoragePool &pool() {
+    static StoragePool *p = new StoragePool();  // outlives static tensors
+    return *p;
+}
+
+// ---- shapes and views ----
+
+void setContiguousStrides(Tensor &t) {
+    int64_t s = 1;
+    for (int d = t.shape.ndim - 1; d >= 0; --d) {
+        t.strides[d] = s;
+        s *= t.shape.dims[d];
+    }
+}
+
+// Uninitialized contiguous storage for `shape`.
+Tensor allocate(const TensorShape &shape) {
+    Tensor t;
+    t.shape = shape;
+    setContiguousStrides(t);
+    t.storage = std::make_shared<TensorStorage>(static_cast<size_t>(shape.numel()));
+    return t;
+}
+
+bool broadcastShapes(const TensorShape &a, const TensorShape &b, TensorShape &out) {
+    out.ndim = std::max(a.ndim, b.ndim);
+    for (int d = 0; d < out.ndim; ++d) {
+        int da = d - (out.ndim - a.ndim), db = d - (out.ndim - b.ndim);
+        int64_t x = da >= 0 ? a.dims[da] : 1, y = db >= 0 ? b.dims[db] : 1;
+        if (x != y && x != 1 && y != 1) return false;
+        out.dims[d] = x == 1 ? y : x;
+    }
+    return true;
+}
+
+// Expressions bigger than this are evaluated into storage before they grow
+// further, which bounds the chunk buffers of one evaluation.
+constexpr int kMaxFusedNodes = 32;
+
+std::shared_ptr<const TensorExpr> exprOf(Tensor &t) {
+    if (t.lazy() && t.expr->nodes >= kMaxFusedNodes) materialize(tensorKernels(), t);
+    if (t.lazy()) return t.expr;
+    auto e = std::make_shared<TensorExpr>();
+    e->kind = TensorExpr::Kind::Leaf;
+    e->leaf = t;
+    e->shape = t.shape;
+    return e;
+}
+
+std::shared_ptr<const TensorExpr> constExpr(double v) {
+    auto e = std::make_shared<TensorExpr>();
+    e->kind = TensorExpr::Kind::Const;
+    e->value = v;
+    e->shape.ndim = 1;
+    e->shape.dims[0] = 1;
+    return e;
+}
+
+Tensor lazyResult(std::shared_ptr<TensorExpr> e) {
+    Tensor t;
+    t.shape = e->shape;
+    t.expr = std::move(e);
+    return t;
+}
+
+// ---- evaluation ----
+
+// An expression flattened into values in dependency order. Inputs are
+// stored views read through broadcast strides; ops read earlier values.
+struct Program {
+    struct Value {
+        TensorExpr::Kind kind;
+        int op = 0;
+        int a = -1, b = -1;  // operand values
+        double constant = 0;
+        int input = -1;      // index into inputs
+    };
+    std::vector<Value> values;
+    std::vector<const Tensor *> inputs;
+    std::unordered_map<const TensorExpr *, int> seen;
+
+    int add(const TensorExpr *e) {
+        auto it = seen.find(e);
+        if (it != seen.end()) return it->second;
+        Value v;
+        v.kind = e->kind;
+        v.op = e->op;
+        switch (e->kind) {
+        case TensorExpr::Kind::Leaf:
+            v.input = static_cast<int>(inputs.size());
+            inputs.push_back(&e->leaf);
+            break;
+        case TensorExpr::Kind::Const:
+            v.constant = e->value;
+            break;
+        case TensorExpr::Kind::Unary:
+            v.a = add(e->a.get());
+            break;
+        case TensorExpr::Kind::Binary:
+            v.a = add(e->a.get());
+            v.b = add(e->b.get());
+            break;
+        }
+        values.push_back(v);
+        return seen[e] = static_cast<int>(values.size()) - 1;
+    }
+};
+
+// The iteration space of one evaluation after dropping size-1 dimensions
+// and merging the ones every operand walks contiguously; at least one
+// dimension.
+struct Layout {
+    int ndim = 0;
+    int64_t dims[kTensorMaxDims] = {};
+    int64_t out[kTensorMaxDims] = {};
+    std::vector<std::array<int64_t, kTensorMaxDims>> in;
+};
+
+// Strides of `t` read as `shape` (0 along broadcast dimensions).
+std::array<int64_t, kTensorMaxDims> broadcastStrides(const Tensor &t, const TensorShape &shape) {
+    std::array<int64_t, kTensorMaxDims> s{};
+    for (int d = 0; d < shape.ndim; ++d) {
+        int td = d - (shape.ndim - t.shape.ndim);
+        s[d] = td >= 0 && t.shape.dims[td] != 1 ? t.strides[td] : 0;
+    }
+    return s;
+}
+
+Layout makeLayout(const Program &p, const TensorShape &shape, const int64_t *outStrides) {
+    size_t n = p.inputs.size();
+    std::vector<std::array<int64_t, kTensorMaxDims>> in(n);
+    for (size_t i = 0; i < n; ++i) in[i] = broadcastStrides(*p.inputs[i], shape);
+    Layout l;
+    l.in.resize(n);
+    // Walk outward from the innermost dimension, growing the current group
+    // while every operand's stride continues it.
+    for (int d = shape.ndim - 1; d >= 0; --d) {
+        int64_t size = shape.dims[d];
+        if (size == 1) continue;
+        int g = l.ndim - 1;
+        bool merge = g >= 0 && outStrides[d] == l.out[g] * l.dims[g];
+        for (size_t i = 0; merge && i < n; ++i) merge = in[i][d] == l.in[i][g] * l.dims[g];
+        if (merge) {
+            l.dims[g] *= size;
+            continue;
+        }
+        l.dims[l.ndim] = size;
+        l.out[l.ndim] = outStrides[d];
+        for (size_t i = 0; i < n; ++i) l.in[i][l.ndim] = in[i][d];
+        ++l.ndim;
+    }
+    if (l.ndim == 0) {
+        l.ndim = 1;
+        l.dims[0] = 1;
+        l.out[0] = 0;
+        for (auto &s : l.in) s[0] = 0;
+    }
+    // Built innermost first; store outermost first.
+    std::reverse(l.dims, l.dims + l.ndim);
+    std::reverse(l.out, l.out + l.ndim);
+    for (auto &s : l.in) std::reverse(s.begin(), s.begin() + l.ndim);
+    return l;
+}
+
+// Chunks handed out together, and the element count below which the pool
+// hand-off costs more than it saves.
+constexpr int64_t kBlockChunks = 16;
+constexpr int64_t kParallelElements = int64_t(1) << 16;
+
+struct Evaluation {
+    const TensorKernels *k;
+    const Program *p;
+    Layout layout;
+    double *out = nullptr;           // stores into out, or
+    std::vector<double> *partials;   // sums one partial per block
+    int64_t inner = 0, chunksPerRow = 0, chunks = 0;
+
+    void run(int64_t blockLo, int64_t blockHi) {
+        const auto &values = p->values;
+        size_t nv = values.size();
+        std::vector<double> scratch(nv * kTensorChunk);
+        std::vector<const double *> ptr(nv);
+        for (size_t v = 0; v < nv; ++v)
+            if (values[v].kind == TensorExpr::Kind::Const)
+                std::fill_n(&scratch[v * kTensorChunk], kTensorChunk, values[v].constant);
+        int nd = layout.ndim;
+        int64_t outInner = layout.out[nd - 1];
+        std::vector<int64_t> inOff(p->inputs.size());
+        for (int64_t block = blockLo; block < blockHi; ++block) {
+            double partial = 0;
+            for (int64_t c = block * kBlockChunks; c < std::min((block + 1) * kBlockChunks, chunks); ++c) {
+                int64_t row = c / chunksPerRow, start = (c % chunksPerRow) * int64_t(kTensorChunk);
+                size_t len = static_cast<size_t>(std::min<int64_t>(kTensorChunk, inner - start));
+                int64_t outOff = start * outInner;
+                for (size_t i = 0; i < inOff.size(); ++i) inOff[i] = start * layout.in[i][nd - 1];
+                for (int d = nd - 2; d >= 0; --d) {
+                    int64_t idx = row % layout.dims[d];
+                    row /= layout.dims[d];
+                    outOff += idx * layout.out[d];
+                    for (size_t i = 0; i < inOff.size(); ++i) inOff[i] += idx * layout.in[i][d];
+                }
+                double *direct = out && outInner == 1 ? out + outOff : nullptr;
+                for (size_t v = 0; v < nv; ++v) {
+                    const auto &val = values[v];
+                    double *buf = &scratch[v * kTensorChunk];
+                    switch (val.kind) {
+                    case TensorExpr::Kind::Leaf: {
+                        const Tensor &t = *p->inputs[val.input];
+                        const double *src = t.storage->data + t.offset + inOff[val.input];
+                        int64_t st = layout.in[val.input][nd - 1];
+                        if (st == 1) {
+                            ptr[v] = src;
+                        } else {
+                            for (size_t i = 0; i < len; ++i) buf[i] = src[i * st];
+                            ptr[v] = buf;
+                        }
+                        break;
+                    }
+                    case TensorExpr::Kind::Const:
+                        ptr[v] = buf;
+                        break;
+                    case TensorExpr::Kind::Unary:
+                    case TensorExpr::Kind::Binary: {
+                        double *dst = v + 1 == nv && direct ? direct : buf;
+                        if (val.kind == TensorExpr::Kind::Unary)
+                            k->unary(val.op, dst, ptr[val.a], len);
+                        else
+                            k->binary(val.op, dst, ptr[val.a], ptr[val.b], len);
+                        ptr[v] = dst;
+                        break;
+                    }
+                    }
+                }
+                const double *result = ptr[nv - 1];
+                if (!out) {
+                    partial += k->sum(result, len);
+                } else if (result != direct) {
+                    double *dst = out + outOff;
+                    if (direct)
+                        std::memmove(dst, result, len * sizeof(double));
+                    else
+                        for (size_t i = 0; i < len; ++i) dst[i * outInner] = result[i];
+                }
+            }
+            if (!out) (*partials)[block] = partial;
+        }
+    }
+};
+
+void runBlocks(void *ctx, int64_t lo, int64_t hi) { static_cast<Evaluation *>(ctx)->run(lo, hi); }
+
+// Store e, read as `shape`, through (out, outStrides), or sum it when out
+// is null.
+double evaluate(const TensorKernels &k, const TensorExpr &e, const TensorShape &shape, double *out,
+                const int64_t *outStrides) {
+    int64_t n = shape.numel();
+    if (n == 0) return 0;
+    Program p;
+    p.add(&e);
+    int64_t zeros[kTensorMaxDims] = {};
+    Evaluation ev;
+    ev.k = &k;
+    ev.p = &p;
+    ev.layout = makeLayout(p, shape, outStrides ? outStrides : zeros);
+    ev.out = out;
+    ev.inner = ev.layout.dims[ev.layout.ndim - 1];
+    ev.chunksPerRow = (ev.inner + int64_t(kTensorChunk) - 1) / int64_t(kTensorChunk);
+    ev.chunks = n / ev.inner * ev.chunksPerRow;
+    int64_t blocks = (ev.chunks + kBlockChunks - 1) / kBlockChunks;
+    std::vector<double> partials(out ? 0 : blocks);
+    ev.partials = &partials;
+    if (blocks > 1 && n >= kParallelElements)
+        __tocin_parallel_chunks(blocks, &runBlocks, &ev);
+    else
+        ev.run(0, blocks);
+    double sum = 0;
+    for (double s : partials) sum += s;
+    return sum;
+}
+
+// True when some leaf of e reads dst's storage other than element for
+// element, so storing into dst while evaluating could change what is read.
+bool readsAcross(const TensorExpr &e, const Tensor &dst) {
+    if (e.kind == TensorExpr::Kind::Leaf) {
+        if (e.leaf.storage != dst.storage) return false;
+        auto s = broadcastStrides(e.leaf, dst.shape);
+        if (e.leaf.offset != dst.offset) return true;
+        for (int d = 0; d < dst.shape.ndim; ++d)
+            if (dst.shape.dims[d] != 1 && s[d] != dst.strides[d]) return true;
+        return false;
+    }
+    return (e.a && readsAcross(*e.a, dst)) || (e.b && readsAcross(*e.b, dst));
+}
+
+} // namespace
+
+// ---- public API ----
+
+int64_t TensorShape::numel() const {
+    int64_t n = 1;
+    for (int d = 0; d < ndim; ++d) n *= dims[d];
+    return n;
+}
+
+bool TensorShape::operator==(const TensorShape &o) const {
+    if (ndim != o.ndim) return false;
+    for (int d = 0; d < ndim; ++d)
+        if (dims[d] != o.dims[d]) return false;
+    return true;
+}
+
+TensorStorage::TensorStorage(size_t n) { data = pool().acquire(n, capacity); }
+
+TensorStorage::~TensorStorage() { pool().release(data, capacity); }
+
+bool Tensor::contiguous() const {
+    if (lazy()) return false;
+    int64_t s = 1;
+    for (int d = shape.ndim - 1; d >= 0; --d) {
+        if (shape.dims[d] != 1 && strides[d] != s) return false;
+        s *= shape.dims[d];
+    }
+    return true;
+}
+
+TensorPoolStats tensorPoolStats() { return pool().stats(); }
+
+std::vector<const TensorKernels *> availableTensorKernels() {
+    std::vector<const TensorKernels *> tables{&kScalarKernels};
+    if (const TensorKernels *avx2 = avx2TensorKernels())
+        if (cpuHasAvx2()) tables.push_back(avx2);
+    return tables;
+}
+
+const TensorKernels &tensorKernels() {
+    static const TensorKernels *chosen = chooseKernels();
+    return *chosen;
+}
+
+bool makeTensorShape(const int64_t *dims, int64_t n, TensorShape &shape) {
+    if (n < 1 || n > kTensorMaxDims) return false;
+    shape.ndim = static_cast<int>(n);
+    for (int d = 0; d < shape.ndim; ++d) {
+        if (dims[d] < 0) return false;
+        shape.dims[d] = dims[d];
+    }
+    return true;
+}
+
+Tensor tensorZeros(const TensorShape &shape) {
+    Tensor t = allocate(shape);
+    std::fill_n(t.data(), static_cast<size_t>(shape.numel()), 0.0);
+    return t;
+}
+
+void materialize(const TensorKernels &k, Tensor &t) {
+    if (!t.lazy()) return;
+    Tensor out = allocate(t.shape);
+    evaluate(k, *t.expr, t.shape, out.data(), out.strides);
+    t = out;
+}
+
+bool tensorBinary(TensorBinaryOp op, Tensor &a, Tensor &b, Tensor &out) {
+    TensorShape shape;
+    if (!broadcastShapes(a.shape, b.shape, shape)) return false;
+    auto e = std::make_shared<TensorExpr>();
+    e->kind = TensorExpr::Kind::Binary;
+    e->op = static_cast<int>(op);
+    e->a = exprOf(a);
+    e->b = exprOf(b);
+    e->shape = shape;
+    e->nodes = e->a->nodes + e->b->nodes + 1;
+    out = lazyResult(std::move(e));
+    return true;
+}
+
+void tensorUnary(TensorUnaryOp op, Tensor &a, Tensor &out) {
+    auto e = std::make_shared<TensorExpr>();
+    e->kind = TensorExpr::Kind::Unary;
+    e->op = static_cast<int>(op);
+    e->a = exprOf(a);
+    e->shape = a.shape;
+    e->nodes = e->a->nodes + 1;
+    out = lazyResult(std::move(e));
+}
+
+void tensorScalar(TensorBinaryOp op, Tensor &a, double s, Tensor &out) {
+    auto e = std::make_shared<TensorExpr>();
+    e->kind = TensorExpr::Kind::Binary;
+    e->op = static_cast<int>(op);
+    e->a = exprOf(a);
+    e->b = constExpr(s);
+    e->shape = a.shape;
+    e->nodes = e->a->nodes + 2;
+    out = lazyResult(std::move(e));
+}
+
+bool tensorAssign(const TensorKernels &k, Tensor &dst, Tensor &src) {
+    TensorShape shape;
+    if (!broadcastShapes(dst.shape, src.shape, shape) || !(shape == dst.shape)) return false;
+    if (dst.lazy()) dst = allocate(dst.shape);  // every element is about to be written
+    auto e = exprOf(src);
+    if (readsAcross(*e, dst)) {
+        Tensor tmp = allocate(src.shape);
+        evaluate(k, *e, src.shape, tmp.data(), tmp.strides);
+        e = exprOf(tmp);
+    }
+    evaluate(k, *e, dst.shape, dst.data(), dst.strides);
+    return true;
+}
+
+double tensorSum(const TensorKernels &k, Tensor &t) { return evaluate(k, *exprOf(t), t.shape, nullptr, nullptr); }
+
+Tensor tensorContiguous(const TensorKernels &k, Tensor &t) {
+    materialize(k, t);
+    if (t.contiguous()) return t;
+    Tensor out = allocate(t.shape);
+    evaluate(k, *exprOf(t), t.shape, out.data(), out.strides);
+    return out;
+}
+
+bool tensorReshape(const TensorKernels &k, Tensor &t, const TensorShape &shape, Tensor &out) {
+    if (shape.numel() != t.shape.numel()) return false;
+    out = tensorContiguous(k, t);
+    out.shape = shape;
+    setContiguousStrides(out);
+    return true;
+}
+
+bool tensorSlice(const TensorKernels &k, Tensor &t, int dim, int64_t start, int64_t stop, int64_t step,
+                 Tensor &out) {
+    if (dim < 0 || dim >= t.shape.ndim || step < 1) return false;
+    materialize(k, t);
+    int64_t n = t.shape.dims[dim];
+    if (start < 0) start += n;
+    if (stop < 0) stop += n;
+    start = std::clamp<int64_t>(start, 0, n);
+    stop = std::clamp<int64_t>(stop, 0, n);
+    out = t;
+    out.offset += start * t.strides[dim];
+    out.shape.dims[dim] = stop > start ? (stop - start + step - 1) / step : 0;
+    out.strides[dim] *= step;
+    return true;
+}
+
+bool tensorTranspose(const TensorKernels &k, Tensor &t, int d0, int d1, Tensor &out) {
+    if (d0 < 0 || d1 < 0 || d0 >= t.shape.ndim || d1 >= t.shape.ndim) return false;
+    materialize(k, t);
+    out = t;
+    std::swap(out.shape.dims[d0], out.shape.dims[d1]);
+    std::swap(out.strides[d0], out.strides[d1]);
+    return true;
+}
+
+bool tensorMatmul(const TensorKernels &k, Tensor &a, Tensor &b, Tensor &out) {
+    if (a.shape.ndim != 2 || b.shape.ndim != 2 || a.shape.dims[1] != b.shape.dims[0]) return false;
+    Tensor ca = tensorContiguous(k, a), cb = tensorContiguous(k, b);
+    int64_t r = a.shape.dims[0], m = a.shape.dims[1], p = b.shape.dims[1];
+    TensorShape shape;
+    shape.ndim = 2;
+    shape.dims[0] = r;
+    shape.dims[1] = p;
+    if (m == 0) {
+        out = tensorZeros(shape);
+        return true;
+    }
+    out = allocate(shape);
+    if (r > 0 && p > 0)
+        gemm(linalgKernels(), ca.data(), cb.data(), out.data(), static_cast<size_t>(r), static_cast<size_t>(m),
+             static_cast<size_t>(p));
+    return true;
+}
+
+bool tensorMatmulQuant(const TensorKernels &k, Tensor &a, const QuantMatrix &w, Tensor &out) {
+    int64_t cols = static_cast<int64_t>(w.cols), rows = static_cast<int64_t>(w.rows);
+    if (a.shape.ndim < 1 || a.shape.ndim > 2 || a.shape.dims[a.shape.ndim - 1] != cols) return false;
+    Tensor ca = tensorContiguous(k, a);
+    int64_t r = a.shape.ndim == 2 ? a.shape.dims[0] : 1;
+    TensorShape shape = a.shape;
+    shape.dims[shape.ndim - 1] = rows;
+    out = allocate(shape);
+    if (r > 0 && rows > 0) quantMatMul(quantKernels(), w, ca.data(), static_cast<size_t>(r), out.data());
+    return true;
+}
+
+double *tensorElement(const TensorKernels &k, Tensor &t, int64_t index) {
+    if (index < 0 || index >= t.shape.numel()) return nullptr;
+    materialize(k, t);
+    int64_t off = t.offset;
+    for (int d = t.shape.ndim - 1; d >= 0; --d) {
+        off += index % t.shape.dims[d] * t.strides[d];
+        index /= t.shape.dims[d];
+    }
+    return t.storage->data + off;
+}
+
+} // namespace runtime
+} // namespace tocin
+
+// ---- builtins ----
+//
+// A handle is a heap-allocated Tensor, 0 when an operation failed. Every
+// handle is also on a stack of live handles so tensorRelease(mark) can free
+// the temporaries a step created since tensorMark(); tensorKeep takes a
+// handle off that stack.
+
+namespace {
+
+using tocin::runtime::Tensor;
+
+struct Handle {
+    Tensor t;
+    int64_t slot;  // index on the live stack, -1 once kept
+};
+
+std::mutex liveMu;
+std::vector<Handle *> live;
+
+int64_t wrap(Tensor t) {
+    auto *h = new Handle{std::move(t), -1};
+    std::lock_guard<std::mutex> lock(liveMu);
+    h->slot = static_cast<int64_t>(live.size());
+    live.push_back(h);
+    return reinterpret_cast<int64_t>(h);
+}
+
+Tensor *unwrap(int64_t h) { return h ? &reinterpret_cast<Handle *>(h)->t : nullptr; }
+
+// Take h off the live stack (the caller holds liveMu).
+void untrack(Handle *h) {
+    if (h->slot < 0) return;
+    live[h->slot] = nullptr;
+    h->slot = -1;
+    while (!live.empty() && !live.back()) live.pop_back();
+}
+
+const tocin::runtime::TensorKernels &kernels() { return tocin::runtime::tensorKernels(); }
+
+bool shapeOf(const int64_t *list, tocin::runtime::TensorShape &shape) {
+    return list && tocin::runtime::makeTensorShape(list + 1, static_cast<int64_t>(lengthOf(list)), shape);
+}
+
+} // namespace
+
+extern "C" {
+
+// tensorNew(shape): zeros of shape (a list of 1 to 8 dimensions).
+int64_t __tocin_tensor_new(const int64_t *shape) {
+    tocin::runtime::TensorShape s;
+    if (!shapeOf(shape, s)) return 0;
+    return wrap(tocin::runtime::tensorZeros(s));
+}
+
+// tensorFromList(data, shape): a copy of the first numel floats of data.
+int64_t __tocin_tensor_from_list(const int64_t *data, const int64_t *shape) {
+    tocin::runtime::TensorShape s;
+    if (!shapeOf(shape, s) || lengthOf(data) < static_cast<size_t>(s.numel())) return 0;
+    Tensor t = tocin::runtime::tensorZeros(s);
+    std::memcpy(t.data(), data + 1, static_cast<size_t>(s.numel()) * sizeof(double));
+    return wrap(std::move(t));
+}
+
+// tensorToList(t, out): copy up to len(out) elements, row-major; returns
+// how many.
+int64_t __tocin_tensor_to_list(int64_t h, int64_t *out) {
+    Tensor *t = unwrap(h);
+    if (!t || !out) return 0;
+    int64_t n = std::min(t->shape.numel(), static_cast<int64_t>(lengthOf(out)));
+    Tensor c = tocin::runtime::tensorContiguous(kernels(), *t);
+    if (n > 0) std::memcpy(out + 1, c.data(), static_cast<size_t>(n) * sizeof(double));
+    return n;
+}
+
+int64_t __tocin_tensor_free(int64_t h) {
+    if (!h) return 0;
+    auto *handle = reinterpret_cast<Handle *>(h);
+    {
+        std::lock_guard<std::mutex> lock(liveMu);
+        untrack(handle);
+    }
+    delete handle;
+    return 1;
+}
+
+// tensorMark(): the live-stack position tensorRelease returns to.
+int64_t __tocin_tensor_mark() {
+    std::lock_guard<std::mutex> lock(liveMu);
+    return static_cast<int64_t>(live.size());
+}
+
+// tensorRelease(mark): free every handle created since mark and not kept;
+// returns how many.
+int64_t __tocin_tensor_release(int64_t mark) {
+    std::vector<Handle *> doomed;
+    {
+        std::lock_guard<std::mutex> lock(liveMu);
+        if (mark < 0) mark = 0;
+        for (size_t i = static_cast<size_t>(mark); i < live.size(); ++i)
+            if (live[i]) doomed.push_back(live[i]);
+        if (static_cast<size_t>(mark) < live.size()) live.resize(static_cast<size_t>(mark));
+        while (!live.empty() && !live.back()) live.pop_back();
+    }
+    for (Handle *h : doomed) delete h;
+    return static_cast<int64_t>(doomed.size());
+}
+
+int64_t __tocin_tensor_keep(int64_t h) {
+    if (!h) return 0;
+    std::lock_guard<std::mutex> lock(liveMu);
+    untrack(reinterpret_cast<Handle *>(h));
+    return h;
+}
+
+int64_t __tocin_tensor_rank(int64_t h) {
+    Tensor *t = unwrap(h);
+    return t ? t->shape.ndim : 0;
+}
+
+int64_t __tocin_tensor_dim(int64_t h, int64_t d) {
+    Tensor *t = unwrap(h);
+    return t && d >= 0 && d < t->shape.ndim ? t->shape.dims[d] : 0;
+}
+
+int64_t __tocin_tensor_numel(int64_t h) {
+    Tensor *t = unwrap(h);
+    return t ? t->shape.numel() : 0;
+}
+
+// tensorGet(t, i) / tensorSet(t, i, v): element i in row-major order;
+// panics like a list index out of range.
+double __tocin_tensor_get(int64_t h, int64_t i) {
+    Tensor *t = unwrap(h);
+    if (!t) return 0.0;
+    double *p = tocin::runtime::tensorElement(kernels(), *t, i);
+    if (!p) __tocin_oob(i, t->shape.numel());
+    return *p;
+}
+
+int64_t __tocin_tensor_set(int64_t h, int64_t i, double v) {
+    Tensor *t = unwrap(h);
+    if (!t) return 0;
+    double *p = tocin::runtime::tensorElement(kernels(), *t, i);
+    if (!p) __tocin_oob(i, t->shape.numel());
+    *p = v;
+    return 1;
+}
+
+int64_t __tocin_tensor_reshape(int64_t h, const int64_t *shape) {
+    Tensor *t = unwrap(h);
+    tocin::runtime::TensorShape s;
+    Tensor out;
+    if (!t || !shapeOf(shape, s) || !tocin::runtime::tensorReshape(kernels(), *t, s, out)) return 0;
+    return wrap(std::move(out));
+}
+
+int64_t __tocin_tensor_slice(int64_t h, int64_t dim, int64_t start, int64_t stop, int64_t step) {
+    Tensor *t = unwrap(h);
+    Tensor out;
+    if (!t || !tocin::runtime::tensorSlice(kernels(), *t, static_cast<int>(dim), start, stop, step, out))
+        return 0;
+    return wrap(std::move(out));
+}
+
+int64_t __tocin_tensor_transpose(int64_t h, int64_t d0, int64_t d1) {
+    Tensor *t = unwrap(h);
+    Tensor out;
+    if (!t || !tocin::runtime::tensorTranspose(kernels(), *t, static_cast<int>(d0), static_cast<int>(d1), out))
+        return 0;
+    return wrap(std::move(out));
+}
+
+int64_t __tocin_tensor_contiguous(int64_t h) {
+    Tensor *t = unwrap(h);
+    return t ? wrap(tocin::runtime::tensorContiguous(kernels(), *t)) : 0;
+}
+
+int64_t __tocin_tensor_binary(int64_t op, int64_t a, int64_t b) {
+    Tensor *x = unwrap(a), *y = unwrap(b);
+    Tensor out;
+    if (!x || !y || op < 0 || op >= tocin::runtime::kTensorBinaryOps ||
+        !tocin::runtime::tensorBinary(static_cast<tocin::runtime::TensorBinaryOp>(op), *x, *y, out))
+        return 0;
+    return wrap(std::move(out));
+}
+
+int64_t __tocin_tensor_unary(int64_t op, int64_t a) {
+    Tensor *x = unwrap(a);
+    if (!x || op < 0 || op >= tocin::runtime::kTensorUnaryOps) return 0;
+    Tensor out;
+    tocin::runtime::tensorUnary(static_cast<tocin::runtime::TensorUnaryOp>(op), *x, out);
+    return wrap(std::move(out));
+}
+
+// tensorScalarOp(op, t, s): t op s with a binary op code.
+int64_t __tocin_tensor_scalar(int64_t op, int64_t a, double s) {
+    Tensor *x = unwrap(a);
+    if (!x || op < 0 || op >= tocin::runtime::kTensorBinaryOps) return 0;
+    Tensor out;
+    tocin::runtime::tensorScalar(static_cast<tocin::runtime::TensorBinaryOp>(op), *x, s, out);
+    return wrap(std::move(out));
+}
+
+// tensorEval(t): compute a lazy t into its own storage; returns t.
+int64_t __tocin_tensor_eval(int64_t h) {
+    Tensor *t = unwrap(h);
+    if (!t) return 0;
+    tocin::runtime::materialize(kernels(), *t);
+    return h;
+}
+
+int64_t __tocin_tensor_assign(int64_t dst, int64_t src) {
+    Tensor *d = unwrap(dst), *s = unwrap(src);
+    return d && s && tocin::runtime::tensorAssign(kernels(), *d, *s) ? 1 : 0;
+}
+
+int64_t __tocin_tensor_fill(int64_t h, double v) {
+    Tensor *t = unwrap(h);
+    if (!t) return 0;
+    Tensor one = tocin::runtime::tensorZeros(tocin::runtime::TensorShape{1, {1}});
+    one.data()[0] = v;
+    return tocin::runtime::tensorAssign(kernels(), *t, one) ? 1 : 0;
+}
+
+int64_t __tocin_tensor_matmul(int64_t a, int64_t b) {
+    Tensor *x = unwrap(a), *y = unwrap(b);
+    Tensor out;
+    if (!x || !y || !tocin::runtime::tensorMatmul(kernels(), *x, *y, out)) return 0;
+    return wrap(std::move(out));
+}
+
+// tensorMatmulQ(a, q): a * W^T for a quantize() handle q, the tensor form of
+// qmatMul.
+int64_t __tocin_tensor_matmul_q(int64_t a, int64_t q) {
+    Tensor *x = unwrap(a);
+    const tocin::runtime::QuantMatrix *w = tocin::runtime::quantMatrixOf(q);
+    Tensor out;
+    if (!x || !w || !tocin::runtime::tensorMatmulQuant(kernels(), *x, *w, out)) return 0;
+    return wrap(std::move(out));
+}
+
+double __tocin_tensor_sum(int64_t h) {
+    Tensor *t = unwrap(h);
+    return t ? tocin::runtime::tensorSum(kernels(), *t) : 0.0;
+}
+
+// tensorPoolStat(which): 0 bytes cached for reuse, 1 allocations served
+// from the pool, 2 allocations that went to the system.
+int64_t __tocin_tensor_pool_stat(int64_t which) {
+    auto s = tocin::runtime::tensorPoolStats();
+    return static_cast<int64_t>(which == 0 ? s.cachedBytes : which == 1 ? s.reused : which == 2 ? s.fresh : 0);
+}
+
+} // extern "C"
@@ -0,0 +1,171 @@
+#ifndef TOCIN_TENSOR_H
+#define TOCIN_TENSOR_H
+
+/**
+ * Float64 tensors behind ml.tensor's tensor* builtins (__tocin_tensor_* in
+ * tensor.cpp).
+ *
+ * A Tensor is a shape, strides in elements and an offset into a shared,
+ * reference-counted storage block, so reshape (of a contiguous tensor),
+ * slice and transpose are views that copy nothing. Storage comes from a
+ * size-class pool: a freed block is kept for the next tensor of that size,
+ * so a training loop that builds the same temporaries every step stops
+ * allocating after the first one.
+ *
+ * Elementwise operations are lazy. tensorBinary / tensorUnary /
+ * tensorScalarOp only record an expression node, with the result shape
+ * broadcast numpy-style; nothing is computed until the result is read,
+ * reshaped, assigned or summed. Evaluation compiles the expression into a
+ * short program and runs it a chunk of kTensorChunk elements at a time, so
+ * every input is read once, intermediates live in L1-sized buffers, and the
+ * output is written once, instead of one full pass and one full buffer per
+ * operation. A lazy result reads its inputs when it is evaluated, not when
+ * it was built.
+ *
+ * The chunk loops are in a table per instruction set and tensorKernels()
+ * picks the best one the CPU supports. The "scalar" table is the plain
+ * loops built for the baseline target (which the compiler vectorizes for
+ * SSE2 on x86-64); "avx2" is the same loops built with -mavx2.
+ * TOCIN_TENSOR_KERNELS forces a table by name.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+constexpr int kTensorMaxDims = 8;
+constexpr size_t kTensorChunk = 256;
+
+// The op codes of tensorBinary / tensorScalarOp and tensorUnary.
+enum class TensorBinaryOp { Add = 0, Sub = 1, Mul = 2, Div = 3, Max = 4, Min = 5 };
+enum class TensorUnaryOp {
+    Neg = 0,
+    Abs = 1,
+    Sqrt = 2,
+    Exp = 3,
+    Log = 4,
+    Sigmoid = 5,
+    Relu = 6,
+    Tanh = 7,
+    SigmoidGrad = 8,  // y * (1 - y), for y = sigmoid(x)
+    ReluGrad = 9,     // 1 where x > 0, else 0
+    Square = 10,
+};
+constexpr int kTensorBinaryOps = 6;
+constexpr int kTensorUnaryOps = 11;
+
+struct TensorKernels {
+    const char *name;
+    // dst[i] = a[i] op b[i] for i < n; dst may be a or b.
+    void (*binary)(int op, double *dst, const double *a, const double *b, size_t n);
+    // dst[i] = op(a[i]); dst may be a.
+    void (*unary)(int op, double *dst, const double *a, size_t n);
+    // sum_i a[i], summed in eight lanes.
+    double (*sum)(const double *a, size_t n);
+};
+
+// The table the runtime uses.
+const TensorKernels &tensorKernels();
+
+// Every table this CPU can run, portable one first.
+std::vector<const TensorKernels *> availableTensorKernels();
+
+// Defined in tensor_avx2.cpp, the only tensor file built with AVX2 enabled;
+// nullptr when the compiler cannot target AVX2.
+const TensorKernels *avx2TensorKernels();
+
+struct TensorShape {
+    int ndim = 0;
+    int64_t dims[kTensorMaxDims] = {};
+
+    int64_t numel() const;
+    bool operator==(const TensorShape &o) const;
+};
+
+// A pooled block of doubles; returns itself to the pool when the last
+// tensor or expression using it goes away.
+struct TensorStorage {
+    double *data;
+    size_t capacity;
+
+    explicit TensorStorage(size_t n);
+    ~TensorStorage();
+    TensorStorage(const TensorStorage &) = delete;
+    TensorStorage &operator=(const TensorStorage &) = delete;
+};
+
+struct TensorExpr;
+
+struct Tensor {
+    TensorShape shape;
+    int64_t strides[kTensorMaxDims] = {};
+    int64_t offset = 0;
+    std::shared_ptr<TensorStorage> storage;  // null while lazy
+    std::shared_ptr<const TensorExpr> expr;  // non-null while lazy
+
+    bool lazy() const { return expr != nullptr; }
+    // Row-major with no gaps (after evaluation).
+    bool contiguous() const;
+    double *data() const { return storage->data + offset; }
+};
+
+// Size-class counters of the storage pool.
+struct TensorPoolStats {
+    uint64_t cachedBytes;  // held for reuse
+    uint64_t reused;       // allocations served from the pool
+    uint64_t fresh;        // allocations that went to the system
+};
+TensorPoolStats tensorPoolStats();
+
+// Fill `shape` from a list of n dimensions; false unless 1 <= n <= 8 and
+// no dimension is negative.
+bool makeTensorShape(const int64_t *dims, int64_t n, TensorShape &shape);
+
+// A new contiguous tensor, zeroed.
+Tensor tensorZeros(const TensorShape &shape);
+
+// Compute a lazy tensor into new contiguous storage; no-op otherwise.
+void materialize(const TensorKernels &k, Tensor &t);
+
+// Recorded elementwise results. False when the shapes do not broadcast.
+bool tensorBinary(TensorBinaryOp op, Tensor &a, Tensor &b, Tensor &out);
+void tensorUnary(TensorUnaryOp op, Tensor &a, Tensor &out);
+void tensorScalar(TensorBinaryOp op, Tensor &a, double s, Tensor &out);
+
+// Evaluate src, broadcast to dst's shape, into dst's elements (dst may be a
+// view, and src may read dst). False when the shapes do not broadcast.
+bool tensorAssign(const TensorKernels &k, Tensor &dst, Tensor &src);
+
+// Sum of every element; a lazy tensor is summed without being stored.
+double tensorSum(const TensorKernels &k, Tensor &t);
+
+// Views. reshape copies only when t is not contiguous; false when the
+// element counts differ, a dimension is out of range or step < 1.
+bool tensorReshape(const TensorKernels &k, Tensor &t, const TensorShape &shape, Tensor &out);
+bool tensorSlice(const TensorKernels &k, Tensor &t, int dim, int64_t start, int64_t stop, int64_t step,
+                 Tensor &out);
+bool tensorTranspose(const TensorKernels &k, Tensor &t, int d0, int d1, Tensor &out);
+
+// A contiguous copy, or t itself when it already is one.
+Tensor tensorContiguous(const TensorKernels &k, Tensor &t);
+
+// out(r x p) = a(r x m) * b(m x p) on the gemmF64 kernels.
+bool tensorMatmul(const TensorKernels &k, Tensor &a, Tensor &b, Tensor &out);
+
+struct QuantMatrix;
+
+// out(r x rows) = a(r x cols) * W^T for quantized weights W (rows x cols),
+// on the quantize() kernels; a 1-D a of cols gives a 1-D out of rows.
+bool tensorMatmulQuant(const TensorKernels &k, Tensor &a, const QuantMatrix &w, Tensor &out);
+
+// Element `index` in row-major order of the logical shape.
+double *tensorElement(const TensorKernels &k, Tensor &t, int64_t index);
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_TENSOR_H
@@ -0,0 +1,22 @@
+// The AVX2 tensor kernels: the loops of tensor_impl.h built with -mavx2.
+// This is the only tensor file built for AVX2 (see CMakeLists.txt);
+// tensorKernels() calls into it only after checking the CPU.
+#include "tensor_impl.h"
+
+namespace tocin {
+namespace runtime {
+
+#ifdef __AVX2__
+namespace {
+
+constexpr TensorKernels kAvx2Kernels{"avx2", &binaryLoops, &unaryLoops, &sumLoop};
+
+} // namespace
+
+const TensorKernels *avx2TensorKernels() { return &kAvx2Kernels; }
+#else
+const TensorKernels *avx2TensorKernels() { return nullptr; }
+#endif
+
+} // namespace runtime
+} // namespace tocin
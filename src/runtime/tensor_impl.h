@@ -0,0 +1,96 @@
+#ifndef TOCIN_TENSOR_IMPL_H
+#define TOCIN_TENSOR_IMPL_H
+
+// The chunk loops of the tensor kernel tables. tensor.cpp builds them for
+// the baseline target and tensor_avx2.cpp with -mavx2; each loop is simple
+// enough for the compiler to vectorize for whichever it is. Like the other
+// *_impl.h kernels this is only included by the kernel files and everything
+// has internal linkage, so code built for AVX2 never ends up shared with
+// the baseline file.
+
+#include "tensor.h"
+
+#include <cmath>
+#include <cstddef>
+
+namespace tocin {
+namespace runtime {
+namespace {
+
+void binaryLoops(int op, double *dst, const double *a, const double *b, size_t n) {
+    switch (static_cast<TensorBinaryOp>(op)) {
+    case TensorBinaryOp::Add:
+        for (size_t i = 0; i < n; ++i) dst[i] = a[i] + b[i];
+        break;
+    case TensorBinaryOp::Sub:
+        for (size_t i = 0; i < n; ++i) dst[i] = a[i] - b[i];
+        break;
+    case TensorBinaryOp::Mul:
+        for (size_t i = 0; i < n; ++i) dst[i] = a[i] * b[i];
+        break;
+    case TensorBinaryOp::Div:
+        for (size_t i = 0; i < n; ++i) dst[i] = a[i] / b[i];
+        break;
+    case TensorBinaryOp::Max:
+        for (size_t i = 0; i < n; ++i) dst[i] = a[i] > b[i] ? a[i] : b[i];
+        break;
+    case TensorBinaryOp::Min:
+        for (size_t i = 0; i < n; ++i) dst[i] = a[i] < b[i] ? a[i] : b[i];
+        break;
+    }
+}
+
+void unaryLoops(int op, double *dst, const double *a, size_t n) {
+    switch (static_cast<TensorUnaryOp>(op)) {
+    case TensorUnaryOp::Neg:
+        for (size_t i = 0; i < n; ++i) dst[i] = -a[i];
+        break;
+    case TensorUnaryOp::Abs:
+        for (size_t i = 0; i < n; ++i) dst[i] = std::fabs(a[i]);
+        break;
+    case TensorUnaryOp::Sqrt:
+        for (size_t i = 0; i < n; ++i) dst[i] = std::sqrt(a[i]);
+        break;
+    case TensorUnaryOp::Exp:
+        for (size_t i = 0; i < n; ++i) dst[i] = std::exp(a[i]);
+        break;
+    case TensorUnaryOp::Log:
+        for (size_t i = 0; i < n; ++i) dst[i] = std::log(a[i]);
+        break;
+    case TensorUnaryOp::Sigmoid:
+        for (size_t i = 0; i < n; ++i) dst[i] = 1.0 / (1.0 + std::exp(-a[i]));
+        break;
+    case TensorUnaryOp::Relu:
+        for (size_t i = 0; i < n; ++i) dst[i] = a[i] > 0.0 ? a[i] : 0.0;
+        break;
+    case TensorUnaryOp::Tanh:
+        for (size_t i = 0; i < n; ++i) dst[i] = std::tanh(a[i]);
+        break;
+    case TensorUnaryOp::SigmoidGrad:
+        for (size_t i = 0; i < n; ++i) dst[i] = a[i] * (1.0 - a[i]);
+        break;
+    case TensorUnaryOp::ReluGrad:
+        for (size_t i = 0; i < n; ++i) dst[i] = a[i] > 0.0 ? 1.0 : 0.0;
+        break;
+    case TensorUnaryOp::Square:
+        for (size_t i = 0; i < n; ++i) dst[i] = a[i] * a[i];
+        break;
+    }
+}
+
+// Eight partial sums, added pairwise at the end, so the order is the same
+// for every table.
+double sumLoop(const double *a, size_t n) {
+    double s[8] = {};
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        for (size_t j = 0; j < 8; ++j) s[j] += a[i + j];
+    for (size_t j = 0; i < n; ++i, ++j) s[j] += a[i];
+    return ((s[0] + s[4]) + (s[1] + s[5])) + ((s[2] + s[6]) + (s[3] + s[7]));
+}
+
+} // namespace
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_TENSOR_IMPL_H
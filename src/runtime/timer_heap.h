@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+/**
+ * @brief Deadline-ordered queue of pending timers
+ *
+ * A binary min-heap keyed by deadline, with ids for cancellation. Timers
+ * due at the same instant fire in the order they were added. Cancelling
+ * only forgets the id; the entry stays in the heap and is skipped when it
+ * comes due, and once cancelled entries outnumber live ones the heap is
+ * rebuilt without them, so retry and timeout patterns that cancel most of
+ * their timers keep it small. Not thread-safe: the owner locks around it.
+ *
+ * Holds the goroutine scheduler's sleeping fibers and after() callbacks,
+ * which AsyncScheduler::delay and afterMs go through.
+ */
+template <typename Payload>
+class TimerHeap {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // The id of a new timer firing at `at`; never 0.
+    uint64_t add(Clock::time_point at, Payload payload) {
+        uint64_t id = nextId_++;
+        heap_.push_back(Entry{at, id, std::move(payload)});
+        std::push_heap(heap_.begin(), heap_.end(), Later());
+        live_.insert(id);
+        return id;
+    }
+
+    // true if the timer was pending (and now will not fire).
+    bool cancel(uint64_t id) {
+        if (live_.erase(id) == 0) {
+            return false;
+        }
+        if (heap_.size() > kCompactAt && heap_.size() > 2 * live_.size()) {
+            compact();
+        }
+        return true;
+    }
+
+    bool empty() const { return live_.empty(); }
+    size_t size() const { return live_.size(); }
+
+    // The earliest deadline still queued (possibly a cancelled timer's),
+    // Clock::time_point::max() when there is none.
+    Clock::time_point next() const {
+        return heap_.empty() ? Clock::time_point::max() : heap_.front().at;
+    }
+
+    // Append the payload of every live timer due by `now`, earliest first.
+    void popDue(Clock::time_point now, std::vector<Payload>& due) {
+        while (!heap_.empty() && heap_.front().at <= now) {
+            std::pop_heap(heap_.begin(), heap_.end(), Later());
+            Entry e = std::move(heap_.back());
+            heap_.pop_back();
+            if (live_.erase(e.id)) {
+                due.push_back(std::move(e.payload));
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kCompactAt = 1024;
+
+    struct Entry {
+        Clock::time_point at;
+        uint64_t id;
+        Payload payload;
+    };
+    // std::push_heap keeps the greatest element first; invert for a min-heap.
+    struct Later {
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.at != b.at ? a.at > b.at : a.id > b.id;
+        }
+    };
+
+    void compact() {
+        heap_.erase(std::remove_if(heap_.begin(), heap_.end(),
+                                   [this](const Entry& e) { return live_.count(e.id) == 0; }),
+                    heap_.end());
+        std::make_heap(heap_.begin(), heap_.end(), Later());
+    }
+
+    std::vector<Entry> heap_;
+    std::unordered_set<uint64_t> live_;
+    uint64_t nextId_ = 1;
+};
+
+} // namespace runtime
+} // namespace tocin
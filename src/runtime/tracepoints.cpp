@@ -0,0 +1,724 @@
+#include "tracepoints.h"
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace tocin {
+namespace runtime {
+
+// ===========================================================================
+// Conditions: a small expression language over a site's locals, parsed once
+// per probe into a node array and evaluated at every hit.
+// ===========================================================================
+namespace {
+
+struct Value {
+    enum Kind { Missing, Int, Float, Str } kind = Missing;
+    int64_t i = 0;
+    double f = 0;
+    std::string s;
+
+    static Value ofInt(int64_t v) { Value r; r.kind = Int; r.i = v; return r; }
+    static Value ofFloat(double v) { Value r; r.kind = Float; r.f = v; return r; }
+    static Value ofStr(std::string v) { Value r; r.kind = Str; r.s = std::move(v); return r; }
+
+    double num() const { return kind == Float ? f : double(i); }
+    bool truthy() const
+    {
+        switch (kind) {
+        case Int: return i != 0;
+        case Float: return f != 0;
+        case Str: return !s.empty();
+        default: return false;
+        }
+    }
+};
+
+struct Token {
+    enum Kind { End, Number, String, Name, Op } kind = End;
+    std::string text;
+};
+
+// Tokens of the text after the location: names, numbers, "strings" and
+// operators (two-character ones first).
+bool tokenize(const std::string &text, std::vector<Token> &out, std::string &error)
+{
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (std::isspace((unsigned char)c)) { ++i; continue; }
+        Token t;
+        if (std::isdigit((unsigned char)c) || (c == '.' && i + 1 < text.size() && std::isdigit((unsigned char)text[i + 1]))) {
+            size_t j = i;
+            while (j < text.size() && (std::isalnum((unsigned char)text[j]) || text[j] == '.')) ++j;
+            t = {Token::Number, text.substr(i, j - i)};
+            i = j;
+        } else if (std::isalpha((unsigned char)c) || c == '_') {
+            size_t j = i;
+            while (j < text.size() && (std::isalnum((unsigned char)text[j]) || text[j] == '_')) ++j;
+            t = {Token::Name, text.substr(i, j - i)};
+            i = j;
+        } else if (c == '"') {
+            std::string s;
+            size_t j = i + 1;
+            for (; j < text.size() && text[j] != '"'; ++j) {
+                if (text[j] == '\\' && j + 1 < text.size()) ++j;
+                s += text[j];
+            }
+            if (j >= text.size()) { error = "unterminated string"; return false; }
+            t = {Token::String, s};
+            i = j + 1;
+        } else {
+            static const char *ops[] = {"&&", "||", "==", "!=", "<=", ">=", "+", "-", "*", "/", "%",
+                                        "<", ">", "!", "(", ")"};
+            bool matched = false;
+            for (const char *op : ops)
+                if (text.compare(i, std::strlen(op), op) == 0) {
+                    t = {Token::Op, op};
+                    i += std::strlen(op);
+                    matched = true;
+                    break;
+                }
+            if (!matched) { error = std::string("unexpected '") + c + "'"; return false; }
+        }
+        out.push_back(std::move(t));
+    }
+    return true;
+}
+
+// A node: a literal, a variable, `hits`, or an operator over earlier nodes.
+struct Node {
+    std::string op;   // "int", "float", "str", "var", "hits", "neg", "!", or a binary operator
+    Value literal;
+    std::string name;
+    int a = -1, b = -1;
+};
+
+class Parser {
+public:
+    Parser(const std::vector<Token> &tokens, size_t &pos, std::vector<Node> &nodes)
+        : t_(tokens), pos_(pos), nodes_(nodes) {}
+
+    int parse(std::string &error)
+    {
+        int root = binary(0, error);
+        return error.empty() ? root : -1;
+    }
+
+private:
+    const Token &peek() const
+    {
+        static const Token end;
+        return pos_ < t_.size() ? t_[pos_] : end;
+    }
+    bool isOp(const char *op) const { return peek().kind == Token::Op && peek().text == op; }
+    int add(Node n) { nodes_.push_back(std::move(n)); return int(nodes_.size()) - 1; }
+
+    static int precedence(const std::string &op)
+    {
+        if (op == "||") return 1;
+        if (op == "&&") return 2;
+        if (op == "==" || op == "!=") return 3;
+        if (op == "<" || op == "<=" || op == ">" || op == ">=") return 4;
+        if (op == "+" || op == "-") return 5;
+        if (op == "*" || op == "/" || op == "%") return 6;
+        return -1;
+    }
+
+    int binary(int minPrec, std::string &error)
+    {
+        int lhs = unary(error);
+        while (error.empty() && peek().kind == Token::Op) {
+            std::string op = peek().text;
+            int prec = precedence(op);
+            if (prec < 0 || prec < minPrec) break;
+            ++pos_;
+            int rhs = binary(prec + 1, error);
+            Node n;
+            n.op = op;
+            n.a = lhs;
+            n.b = rhs;
+            lhs = add(std::move(n));
+        }
+        return lhs;
+    }
+
+    int unary(std::string &error)
+    {
+        if (isOp("!") || isOp("-")) {
+            std::string op = peek().text == "-" ? "neg" : "!";
+            ++pos_;
+            Node n;
+            n.op = op;
+            n.a = unary(error);
+            return add(std::move(n));
+        }
+        if (isOp("(")) {
+            ++pos_;
+            int inner = binary(0, error);
+            if (!isOp(")")) {
+                if (error.empty()) error = "expected ')'";
+                return -1;
+            }
+            ++pos_;
+            return inner;
+        }
+        const Token tok = peek();
+        Node n;
+        switch (tok.kind) {
+        case Token::Number: {
+            char *end = nullptr;
+            if (tok.text.find_first_of(".eE") == std::string::npos) {
+                n.op = "int";
+                n.literal = Value::ofInt(std::strtoll(tok.text.c_str(), &end, 0));
+            } else {
+                n.op = "float";
+                n.literal = Value::ofFloat(std::strtod(tok.text.c_str(), &end));
+            }
+            if (*end) { error = "bad number '" + tok.text + "'"; return -1; }
+            break;
+        }
+        case Token::String:
+            n.op = "str";
+            n.literal = Value::ofStr(tok.text);
+            break;
+        case Token::Name:
+            if (tok.text == "true" || tok.text == "false") {
+                n.op = "int";
+                n.literal = Value::ofInt(tok.text == "true");
+            } else {
+                n.op = tok.text == "hits" ? "hits" : "var";
+                n.name = tok.text;
+            }
+            break;
+        default:
+            error = tok.kind == Token::End ? "expected an expression" : "unexpected '" + tok.text + "'";
+            return -1;
+        }
+        ++pos_;
+        return add(std::move(n));
+    }
+
+    const std::vector<Token> &t_;
+    size_t &pos_;
+    std::vector<Node> &nodes_;
+};
+
+using Lookup = std::function<Value(const std::string &)>;
+
+Value evaluate(const std::vector<Node> &nodes, int at, const Lookup &lookup, uint64_t hits)
+{
+    const Node &n = nodes[at];
+    if (n.op == "int" || n.op == "float" || n.op == "str") return n.literal;
+    if (n.op == "var") return lookup(n.name);
+    if (n.op == "hits") return Value::ofInt(int64_t(hits));
+    if (n.op == "&&" || n.op == "||") {
+        Value a = evaluate(nodes, n.a, lookup, hits);
+        if (a.kind == Value::Missing) return a;
+        if (a.truthy() == (n.op == "||")) return Value::ofInt(a.truthy());
+        Value b = evaluate(nodes, n.b, lookup, hits);
+        return b.kind == Value::Missing ? b : Value::ofInt(b.truthy());
+    }
+    Value a = evaluate(nodes, n.a, lookup, hits);
+    if (a.kind == Value::Missing) return a;
+    if (n.op == "!") return Value::ofInt(!a.truthy());
+    if (n.op == "neg") {
+        if (a.kind == Value::Int) return Value::ofInt(-a.i);
+        if (a.kind == Value::Float) return Value::ofFloat(-a.f);
+        return Value();
+    }
+    Value b = evaluate(nodes, n.b, lookup, hits);
+    if (b.kind == Value::Missing) return b;
+    const std::string &op = n.op;
+
+    if (a.kind == Value::Str || b.kind == Value::Str) {
+        if (a.kind != b.kind) return op == "!=" ? Value::ofInt(1) : op == "==" ? Value::ofInt(0) : Value();
+        int c = a.s.compare(b.s);
+        if (op == "==") return Value::ofInt(c == 0);
+        if (op == "!=") return Value::ofInt(c != 0);
+        if (op == "<") return Value::ofInt(c < 0);
+        if (op == "<=") return Value::ofInt(c <= 0);
+        if (op == ">") return Value::ofInt(c > 0);
+        if (op == ">=") return Value::ofInt(c >= 0);
+        if (op == "+") return Value::ofStr(a.s + b.s);
+        return Value();
+    }
+    if (a.kind == Value::Int && b.kind == Value::Int) {
+        int64_t x = a.i, y = b.i;
+        if (op == "+") return Value::ofInt(int64_t(uint64_t(x) + uint64_t(y)));
+        if (op == "-") return Value::ofInt(int64_t(uint64_t(x) - uint64_t(y)));
+        if (op == "*") return Value::ofInt(int64_t(uint64_t(x) * uint64_t(y)));
+        if (op == "/" || op == "%") {
+            if (y == 0 || (x == INT64_MIN && y == -1)) return Value();
+            return Value::ofInt(op == "/" ? x / y : x % y);
+        }
+    } else {
+        double x = a.num(), y = b.num();
+        if (op == "+") return Value::ofFloat(x + y);
+        if (op == "-") return Value::ofFloat(x - y);
+        if (op == "*") return Value::ofFloat(x * y);
+        if (op == "/") return Value::ofFloat(x / y);
+        if (op == "%") return Value();
+    }
+    double x = a.num(), y = b.num();
+    bool exact = a.kind == Value::Int && b.kind == Value::Int;
+    if (op == "==") return Value::ofInt(exact ? a.i == b.i : x == y);
+    if (op == "!=") return Value::ofInt(exact ? a.i != b.i : x != y);
+    if (op == "<") return Value::ofInt(exact ? a.i < b.i : x < y);
+    if (op == "<=") return Value::ofInt(exact ? a.i <= b.i : x <= y);
+    if (op == ">") return Value::ofInt(exact ? a.i > b.i : x > y);
+    if (op == ">=") return Value::ofInt(exact ? a.i >= b.i : x >= y);
+    return Value();
+}
+
+// A local's value, by its type tag (see TracepointSite::locals).
+Value valueOf(char tag, int64_t raw)
+{
+    switch (tag) {
+    case 'f': {
+        double d;
+        std::memcpy(&d, &raw, sizeof d);
+        return Value::ofFloat(d);
+    }
+    case 's': {
+        const char *s = reinterpret_cast<const char *>(static_cast<intptr_t>(raw));
+        return s ? Value::ofStr(s) : Value();
+    }
+    default:
+        return Value::ofInt(raw);
+    }
+}
+
+std::string format(char tag, int64_t raw)
+{
+    char buf[64];
+    switch (tag) {
+    case 'f': {
+        double d;
+        std::memcpy(&d, &raw, sizeof d);
+        std::snprintf(buf, sizeof buf, "%g", d);
+        return buf;
+    }
+    case 'b':
+        return raw ? "true" : "false";
+    case 's': {
+        const char *s = reinterpret_cast<const char *>(static_cast<intptr_t>(raw));
+        return s ? "\"" + std::string(s) + "\"" : "nil";
+    }
+    case 'p':
+        if (!raw) return "nil";
+        std::snprintf(buf, sizeof buf, "0x%llx", (unsigned long long)raw);
+        return buf;
+    default:
+        return std::to_string(raw);
+    }
+}
+
+std::vector<std::pair<char, std::string>> parseLocals(const char *spec)
+{
+    std::vector<std::pair<char, std::string>> locals;
+    if (!spec) return locals;
+    std::string s(spec);
+    size_t start = 0;
+    while (start < s.size()) {
+        size_t comma = s.find(',', start);
+        if (comma == std::string::npos) comma = s.size();
+        if (comma - start > 2 && s[start + 1] == ':')
+            locals.emplace_back(s[start], s.substr(start + 2, comma - start - 2));
+        start = comma + 1;
+    }
+    return locals;
+}
+
+bool debuggerAttached()
+{
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.rfind("TracerPid:", 0) == 0) return std::atoi(line.c_str() + 10) != 0;
+#endif
+    return false;
+}
+
+std::string where(const TracepointSite *site)
+{
+    return std::string(site->file ? site->file : "?") + ":" + std::to_string(site->line);
+}
+
+} // namespace
+
+struct Tracepoints::Probe {
+    int id = 0;
+    std::string spec;
+    std::string file;
+    int line = 0;
+    std::vector<Node> nodes;
+    int condition = -1;                  // root node, -1 = always
+    bool breaks = false;
+    bool hasMessage = false;
+    std::vector<std::pair<bool, std::string>> message;   // (is a {name}, text)
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> fired{0};
+    size_t sites = 0;
+};
+
+namespace {
+
+// "file:line [if <condition>] [log ["message"] | break]"
+std::shared_ptr<Tracepoints::Probe> parseProbe(const std::string &spec, std::string &error)
+{
+    auto probe = std::make_shared<Tracepoints::Probe>();
+    size_t begin = spec.find_first_not_of(" \t\r");
+    size_t end = spec.find_first_of(" \t\r", begin);
+    std::string location = begin == std::string::npos ? "" : spec.substr(begin, end - begin);
+    size_t colon = location.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == location.size() ||
+        location.find_first_not_of("0123456789", colon + 1) != std::string::npos) {
+        error = "expected <file>:<line>, got '" + location + "'";
+        return nullptr;
+    }
+    probe->file = location.substr(0, colon);
+    probe->line = std::atoi(location.c_str() + colon + 1);
+    probe->spec = spec.substr(begin, spec.find_last_not_of(" \t\r") + 1 - begin);
+
+    std::vector<Token> tokens;
+    if (!tokenize(end == std::string::npos ? "" : spec.substr(end), tokens, error)) return nullptr;
+    size_t pos = 0;
+    auto keyword = [&](const char *word) {
+        return pos < tokens.size() && tokens[pos].kind == Token::Name && tokens[pos].text == word;
+    };
+    if (keyword("if")) {
+        ++pos;
+        probe->condition = Parser(tokens, pos, probe->nodes).parse(error);
+        if (probe->condition < 0) return nullptr;
+    }
+    if (keyword("break")) {
+        ++pos;
+        probe->breaks = true;
+    } else if (keyword("log")) {
+        ++pos;
+        if (pos < tokens.size() && tokens[pos].kind == Token::String) {
+            probe->hasMessage = true;
+            const std::string &text = tokens[pos++].text;
+            size_t i = 0;
+            while (i < text.size()) {
+                size_t open = text.find('{', i), close = open == std::string::npos ? open : text.find('}', open);
+                if (close == std::string::npos) {
+                    probe->message.emplace_back(false, text.substr(i));
+                    break;
+                }
+                probe->message.emplace_back(false, text.substr(i, open - i));
+                probe->message.emplace_back(true, text.substr(open + 1, close - open - 1));
+                i = close + 1;
+            }
+        }
+    }
+    if (pos < tokens.size()) {
+        error = "unexpected '" + tokens[pos].text + "' in '" + probe->spec + "'";
+        return nullptr;
+    }
+    return probe;
+}
+
+bool covers(const Tracepoints::Probe &probe, const TracepointSite *site)
+{
+    if (site->line != probe.line || !site->file) return false;
+    std::string file(site->file);
+    if (file.size() < probe.file.size() ||
+        file.compare(file.size() - probe.file.size(), probe.file.size(), probe.file) != 0)
+        return false;
+    size_t at = file.size() - probe.file.size();
+    return at == 0 || file[at - 1] == '/' || file[at - 1] == '\\';
+}
+
+std::vector<std::string> splitSpecs(const std::string &specs)
+{
+    std::vector<std::string> out;
+    std::string current;
+    bool quoted = false;
+    for (char c : specs + "\n") {
+        if (c == '"') quoted = !quoted;
+        if (!quoted && (c == ';' || c == '\n')) {
+            size_t first = current.find_first_not_of(" \t\r");
+            if (first != std::string::npos && current[first] != '#') out.push_back(current);
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+Tracepoints &Tracepoints::instance()
+{
+    static Tracepoints *tracepoints = new Tracepoints();   // never destroyed: probes may fire during exit
+    return *tracepoints;
+}
+
+Tracepoints::Tracepoints()
+{
+    std::string error;
+    if (const char *specs = std::getenv("TOCIN_TRACE"); specs && *specs && !configure(specs, error))
+        std::fprintf(stderr, "tocin: TOCIN_TRACE: %s\n", error.c_str());
+    if (const char *path = std::getenv("TOCIN_TRACE_CONTROL"); path && *path)
+        watchControlFile(path);
+}
+
+void Tracepoints::rearm()
+{
+    covered_.clear();
+    for (auto &probe : probes_) probe->sites = 0;
+    for (TracepointSite *site : sites_) {
+        Covered covered;
+        for (auto &probe : probes_)
+            if (covers(*probe, site)) {
+                covered.probes.push_back(probe);
+                ++probe->sites;
+            }
+        const bool on = !covered.probes.empty();
+        if (on) {
+            covered.locals = parseLocals(site->locals);
+            covered_.emplace(site, std::move(covered));
+        }
+        std::atomic_ref<uint8_t>(site->enabled).store(on ? 1 : 0, std::memory_order_relaxed);
+    }
+}
+
+void Tracepoints::registerSites(TracepointSite *const *sites, int64_t count)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    sites_.insert(sites_.end(), sites, sites + count);
+    rearm();
+}
+
+int Tracepoints::add(const std::string &spec, std::string &error)
+{
+    auto probe = parseProbe(spec, error);
+    if (!probe) return -1;
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    probe->id = nextId_++;
+    probes_.push_back(probe);
+    rearm();
+    return probe->id;
+}
+
+bool Tracepoints::remove(int id)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (auto it = probes_.begin(); it != probes_.end(); ++it)
+        if ((*it)->id == id) {
+            probes_.erase(it);
+            rearm();
+            return true;
+        }
+    return false;
+}
+
+bool Tracepoints::configure(const std::string &specs, std::string &error)
+{
+    std::vector<std::shared_ptr<Probe>> parsed;
+    for (const auto &spec : splitSpecs(specs)) {
+        auto probe = parseProbe(spec, error);
+        if (!probe) return false;
+        parsed.push_back(std::move(probe));
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (auto &probe : parsed) probe->id = nextId_++;
+    probes_ = std::move(parsed);
+    rearm();
+    return true;
+}
+
+void Tracepoints::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    probes_.clear();
+    rearm();
+}
+
+std::vector<Tracepoints::ProbeInfo> Tracepoints::probes() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::vector<ProbeInfo> out;
+    for (const auto &probe : probes_)
+        out.push_back({probe->id, probe->spec, probe->hits.load(), probe->fired.load(), probe->sites});
+    return out;
+}
+
+size_t Tracepoints::siteCount() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return sites_.size();
+}
+
+void Tracepoints::setLogSink(std::function<void(const std::string &)> sink)
+{
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    sink_ = std::move(sink);
+}
+
+void Tracepoints::setBreakHandler(std::function<void(const TracepointHit &)> handler)
+{
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    breakHandler_ = std::move(handler);
+}
+
+void Tracepoints::log(const std::string &line)
+{
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    if (sink_) {
+        sink_(line);
+        return;
+    }
+    static FILE *out = [] {
+        const char *path = std::getenv("TOCIN_TRACE_LOG");
+        FILE *f = path && *path ? std::fopen(path, "a") : nullptr;
+        return f ? f : stderr;
+    }();
+    std::fprintf(out, "%s\n", line.c_str());
+    std::fflush(out);
+}
+
+void Tracepoints::hit(TracepointSite *site, const int64_t *values)
+{
+    // Copy what this site needs and let go of the lock: a break handler may
+    // hold the thread for as long as a user looks at it, and must be able to
+    // change the probes meanwhile.
+    Covered covered;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto found = covered_.find(site);
+        if (found == covered_.end()) return;
+        covered = found->second;
+    }
+    const auto &locals = covered.locals;
+    Lookup lookup = [&](const std::string &name) {
+        for (size_t i = 0; i < locals.size(); ++i)
+            if (locals[i].second == name) return valueOf(locals[i].first, values[i]);
+        return Value();
+    };
+
+    for (const auto &probe : covered.probes) {
+        uint64_t hits = probe->hits.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (probe->condition >= 0 && !evaluate(probe->nodes, probe->condition, lookup, hits).truthy())
+            continue;
+        probe->fired.fetch_add(1, std::memory_order_relaxed);
+
+        std::string text = "trace: " + where(site);
+        if (probe->hasMessage) {
+            text += ": ";
+            for (const auto &[isName, piece] : probe->message) {
+                if (!isName) {
+                    text += piece;
+                } else if (piece == "hits") {
+                    text += std::to_string(hits);
+                } else {
+                    size_t i = 0;
+                    while (i < locals.size() && locals[i].second != piece) ++i;
+                    text += i < locals.size() ? format(locals[i].first, values[i]) : "{" + piece + "}";
+                }
+            }
+        } else {
+            text += std::string(" ") + (site->function ? site->function : "?") + ":";
+            for (size_t i = 0; i < locals.size(); ++i)
+                text += " " + locals[i].second + "=" + format(locals[i].first, values[i]);
+        }
+
+        if (!probe->breaks) {
+            log(text);
+            continue;
+        }
+        std::function<void(const TracepointHit &)> handler;
+        {
+            std::lock_guard<std::mutex> lock(outputMutex_);
+            handler = breakHandler_;
+        }
+        if (handler) {
+            TracepointHit event{site, probe->spec, hits, {}};
+            for (size_t i = 0; i < locals.size(); ++i)
+                event.locals.emplace_back(locals[i].second, format(locals[i].first, values[i]));
+            handler(event);
+        } else {
+            log(text + " [break]");
+#ifdef SIGTRAP
+            if (debuggerAttached()) std::raise(SIGTRAP);
+#endif
+        }
+    }
+}
+
+void Tracepoints::watchControlFile(const std::string &path)
+{
+    if (watching_.exchange(true)) return;
+    int ms = 250;
+    if (const char *env = std::getenv("TOCIN_TRACE_POLL_MS"); env && std::atoi(env) > 0) ms = std::atoi(env);
+    std::thread([this, path, ms] {
+        namespace fs = std::filesystem;
+        fs::file_time_type seen{};
+        bool present = false;
+        while (true) {
+            std::error_code ec;
+            auto stamp = fs::last_write_time(path, ec);
+            if (!ec && (!present || stamp != seen)) {
+                std::ifstream in(path);
+                std::stringstream contents;
+                contents << in.rdbuf();
+                std::string error;
+                if (configure(contents.str(), error))
+                    log("trace: " + path + ": " + std::to_string(probes().size()) + " probe(s)");
+                else
+                    log("trace: " + path + ": " + error);
+                seen = stamp;
+                present = true;
+            } else if (ec && present) {
+                clear();   // the control file was removed: probes off
+                present = false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        }
+    }).detach();
+}
+
+} // namespace runtime
+} // namespace tocin
+
+extern "C" {
+
+void __tocin_tracepoints_register(tocin::runtime::TracepointSite *const *sites, int64_t count)
+{
+    tocin::runtime::Tracepoints::instance().registerSites(sites, count);
+}
+
+void __tocin_tracepoint(tocin::runtime::TracepointSite *site, const int64_t *values)
+{
+    tocin::runtime::Tracepoints::instance().hit(site, values);
+}
+
+int64_t __tocin_trace_probe(const char *spec)
+{
+    if (!spec) return -1;
+    std::string error;
+    auto &tracepoints = tocin::runtime::Tracepoints::instance();
+    int id = tracepoints.add(spec, error);
+    if (id < 0) std::fprintf(stderr, "tocin: traceProbe: %s\n", error.c_str());
+    return id;
+}
+
+int64_t __tocin_trace_remove(int64_t id)
+{
+    return tocin::runtime::Tracepoints::instance().remove(static_cast<int>(id)) ? 1 : 0;
+}
+
+} // extern "C"
@@ -0,0 +1,138 @@
+#ifndef TOCIN_TRACEPOINTS_H
+#define TOCIN_TRACEPOINTS_H
+
+/**
+ * Tracepoints: logging probes and conditional breakpoints that are switched
+ * on and off in a running program.
+ *
+ * Under --debug the compiler puts a probe site at every statement boundary
+ * (the first statement of each line). A site is a TracepointSite global; its
+ * code is a relaxed load of the site's `enabled` byte and a branch, weighted
+ * never-taken, to a cold block that stores the function's scalar locals and
+ * calls __tocin_tracepoint. With nothing armed, a site costs that load and a
+ * predicted branch; nothing on the hot path is rewritten, so it is safe in
+ * JIT'd and AOT code alike and arming a site takes effect in loops that are
+ * already running (the load is atomic, so it is never hoisted out of them).
+ *
+ * A probe is a spec naming a line:
+ *
+ *     server.to:42                          log the locals at line 42
+ *     server.to:42 log "slow: n={n} t={t}"   log a message ({hits}: the count)
+ *     server.to:42 if n > 1000 && t >= 0.5   ... only when the condition holds
+ *     server.to:42 if hits % 100 == 0 break  stop at every 100th hit
+ *
+ * The file matches any site whose path ends in it. A condition is evaluated
+ * in-process, over the site's locals (ints, floats, bools, strings) with
+ * arithmetic, comparisons, && || ! and parentheses; a probe whose condition
+ * names a variable the site does not have never fires there. `break` hands
+ * the hit to the break handler (a debugger front end); without one it logs
+ * and raises SIGTRAP if a native debugger is attached.
+ *
+ * Probes come from TOCIN_TRACE (specs separated by ';' or newlines) at
+ * startup, from the file named by TOCIN_TRACE_CONTROL, which is re-read
+ * whenever it changes (so a live service can be probed by editing a file),
+ * from the traceProbe/traceRemove builtins, and from LLVMDebugger. Log
+ * lines go to stderr, or to the file named by TOCIN_TRACE_LOG.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+// One probe site, as the compiler emits it (IRGenerator::emitTracepoint):
+// { i8, i32, i32, ptr, ptr, ptr }.
+struct TracepointSite {
+    uint8_t enabled;        // read by the site's code; 1 when a probe covers it
+    int32_t line;
+    int32_t column;
+    const char *file;
+    const char *function;
+    const char *locals;     // "i:count,f:ratio,s:name,b:done,p:node": the values array, in order
+};
+
+// What a break handler is given.
+struct TracepointHit {
+    const TracepointSite *site;
+    std::string probe;                                         // the spec that fired
+    uint64_t hits;                                             // of that probe, this one included
+    std::vector<std::pair<std::string, std::string>> locals;   // name, formatted value
+};
+
+class Tracepoints {
+public:
+    static Tracepoints &instance();
+
+    // Called by each module's main() before anything else: its sites
+    // become visible to probes, and those already installed arm them.
+    void registerSites(TracepointSite *const *sites, int64_t count);
+
+    // Install a probe; its id, or -1 with @p error set when the spec does
+    // not parse. A probe may cover no site yet (its module may load later).
+    int add(const std::string &spec, std::string &error);
+    bool remove(int id);
+    // Replace every probe with @p specs (';' or newline separated). On a
+    // parse error nothing changes.
+    bool configure(const std::string &specs, std::string &error);
+    void clear();
+
+    struct ProbeInfo {
+        int id;
+        std::string spec;
+        uint64_t hits;     // times a covered site was reached
+        uint64_t fired;    // ... and the condition held
+        size_t sites;      // sites it covers
+    };
+    std::vector<ProbeInfo> probes() const;
+    size_t siteCount() const;
+
+    // Where log lines go; null restores stderr (or TOCIN_TRACE_LOG).
+    void setLogSink(std::function<void(const std::string &)> sink);
+    // Who handles `break`; null restores the default (log, SIGTRAP under a
+    // debugger). Called on the thread that hit the probe, which waits for it.
+    void setBreakHandler(std::function<void(const TracepointHit &)> handler);
+
+    // The slow path of an armed site.
+    void hit(TracepointSite *site, const int64_t *values);
+
+    // Poll TOCIN_TRACE_CONTROL from a background thread (started once).
+    void watchControlFile(const std::string &path);
+
+    struct Probe;
+    // A covered site: its locals (type tag, name) and the probes on it.
+    struct Covered {
+        std::vector<std::pair<char, std::string>> locals;
+        std::vector<std::shared_ptr<Probe>> probes;
+    };
+
+private:
+    Tracepoints();
+
+    void rearm();   // recompute every site's enabled byte; under mutex_ (exclusive)
+    void log(const std::string &line);
+
+    mutable std::shared_mutex mutex_;
+    std::vector<TracepointSite *> sites_;
+    std::vector<std::shared_ptr<Probe>> probes_;
+    // Site -> the probes covering it, rebuilt by rearm().
+    std::unordered_map<const TracepointSite *, Covered> covered_;
+    int nextId_ = 1;
+
+    std::mutex outputMutex_;
+    std::function<void(const std::string &)> sink_;
+    std::function<void(const TracepointHit &)> breakHandler_;
+    std::atomic<bool> watching_{false};
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_TRACEPOINTS_H
@@ -0,0 +1,277 @@
+// WebSocket frames, masking, message reassembly and permessage-deflate.
+#include "websocket.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <zlib.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TOCIN_WS_SSE2 1
+#endif
+
+namespace tocin {
+namespace runtime {
+
+void wsMask(char *p, size_t n, uint32_t key, size_t phase) {
+    // The key as it lies in memory, rotated so byte 0 masks p[0].
+    unsigned char k[4] = {(unsigned char)(key >> 24), (unsigned char)(key >> 16),
+                          (unsigned char)(key >> 8), (unsigned char)key};
+    unsigned char r[4];
+    for (int i = 0; i < 4; ++i) r[i] = k[(phase + (size_t)i) & 3];
+    uint32_t k4;
+    std::memcpy(&k4, r, 4);
+    size_t i = 0;
+#ifdef TOCIN_WS_SSE2
+    const __m128i k16 = _mm_set1_epi32((int)k4);
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i), _mm_xor_si128(x, k16));
+    }
+#endif
+    const uint64_t k8 = (uint64_t)k4 | ((uint64_t)k4 << 32);
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x;
+        std::memcpy(&x, p + i, 8);
+        x ^= k8;
+        std::memcpy(p + i, &x, 8);
+    }
+    for (; i < n; ++i) p[i] = (char)(p[i] ^ r[i & 3]);
+}
+
+size_t wsHeaderLen(uint64_t payloadLen, bool masked) {
+    size_t n = payloadLen > 65535 ? 10 : payloadLen > 125 ? 4 : 2;
+    return masked ? n + 4 : n;
+}
+
+size_t wsWriteHeader(char *dst, bool fin, bool rsv1, int opcode, uint64_t payloadLen,
+                     bool masked, uint32_t key) {
+    unsigned char *d = reinterpret_cast<unsigned char *>(dst);
+    d[0] = (unsigned char)((fin ? 0x80 : 0) | (rsv1 ? 0x40 : 0) | (opcode & 15));
+    unsigned char maskBit = masked ? 0x80 : 0;
+    size_t pos;
+    if (payloadLen > 65535) {
+        d[1] = maskBit | 127;
+        for (int i = 0; i < 8; ++i) d[2 + i] = (unsigned char)(payloadLen >> (56 - 8 * i));
+        pos = 10;
+    } else if (payloadLen > 125) {
+        d[1] = maskBit | 126;
+        d[2] = (unsigned char)(payloadLen >> 8);
+        d[3] = (unsigned char)payloadLen;
+        pos = 4;
+    } else {
+        d[1] = (unsigned char)(maskBit | payloadLen);
+        pos = 2;
+    }
+    if (masked) {
+        d[pos] = (unsigned char)(key >> 24);
+        d[pos + 1] = (unsigned char)(key >> 16);
+        d[pos + 2] = (unsigned char)(key >> 8);
+        d[pos + 3] = (unsigned char)key;
+        pos += 4;
+    }
+    return pos;
+}
+
+int64_t parseWsFrame(const char *p, size_t len, WsFrame *out) {
+    const unsigned char *d = reinterpret_cast<const unsigned char *>(p);
+    if (len < 2) return kWsIncomplete;
+    if (d[0] & 0x30) return kWsMalformed; // RSV2, RSV3: no extension of ours
+    WsFrame f;
+    f.fin = (d[0] & 0x80) != 0;
+    f.rsv1 = (d[0] & 0x40) != 0;
+    f.opcode = d[0] & 15;
+    f.masked = (d[1] & 0x80) != 0;
+    if (f.opcode > kWsBinary && (f.opcode < kWsClose || f.opcode > kWsPong)) return kWsMalformed;
+    uint64_t n = d[1] & 127;
+    size_t pos = 2;
+    if (n == 126) {
+        if (len < 4) return kWsIncomplete;
+        n = ((uint64_t)d[2] << 8) | d[3];
+        pos = 4;
+    } else if (n == 127) {
+        if (len < 10) return kWsIncomplete;
+        if (d[2] & 0x80) return kWsMalformed;
+        n = 0;
+        for (int i = 0; i < 8; ++i) n = (n << 8) | d[2 + i];
+        pos = 10;
+    }
+    if (f.opcode >= kWsClose && (!f.fin || n > 125 || f.rsv1)) return kWsMalformed;
+    if (f.masked) {
+        if (len < pos + 4) return kWsIncomplete;
+        f.key = ((uint32_t)d[pos] << 24) | ((uint32_t)d[pos + 1] << 16) |
+                ((uint32_t)d[pos + 2] << 8) | d[pos + 3];
+        pos += 4;
+    }
+    f.headerLen = pos;
+    f.payloadLen = n;
+    *out = f;
+    return (int64_t)pos;
+}
+
+// ---- permessage-deflate ------------------------------------------------------
+
+struct WsDeflate::Streams {
+    z_stream def;
+    z_stream inf;
+    bool defReady = false;
+    bool infReady = false;
+};
+
+namespace {
+
+const unsigned char kSyncTail[4] = {0x00, 0x00, 0xff, 0xff};
+
+// Make room for at least `min` more bytes after `used`.
+void reserveOut(std::vector<char> *out, size_t used, size_t min) {
+    if (out->size() - used < min) out->resize(std::max(out->size() * 2, used + min));
+}
+
+} // namespace
+
+WsDeflate::WsDeflate(bool noContextTakeover)
+    : z_(new Streams()), noContextTakeover_(noContextTakeover) {}
+
+WsDeflate::~WsDeflate() {
+    if (z_->defReady) deflateEnd(&z_->def);
+    if (z_->infReady) inflateEnd(&z_->inf);
+    delete z_;
+}
+
+bool WsDeflate::compress(const char *src, size_t n, std::vector<char> *out, size_t *used) {
+    z_stream &s = z_->def;
+    if (!z_->defReady) {
+        std::memset(&s, 0, sizeof(s));
+        // Level 1: dashboards send many small frames, where the faster
+        // match search costs little ratio.
+        if (deflateInit2(&s, 1, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+        z_->defReady = true;
+    }
+    size_t start = *used;
+    s.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(src));
+    s.avail_in = (uInt)n;
+    reserveOut(out, *used, deflateBound(&s, (uLong)n) + 16);
+    for (;;) {
+        s.next_out = reinterpret_cast<Bytef *>(out->data() + *used);
+        s.avail_out = (uInt)(out->size() - *used);
+        int rc = deflate(&s, Z_SYNC_FLUSH);
+        *used = out->size() - s.avail_out;
+        if (rc != Z_OK && rc != Z_BUF_ERROR) return false;
+        if (s.avail_out != 0) break; // everything is flushed
+        reserveOut(out, *used, 4096);
+    }
+    if (*used == start) {
+        // Nothing pending to flush (an empty message after a full one):
+        // send the bare header of an empty stored block, which is what the
+        // receiver's 00 00 ff ff completes.
+        (*out)[(*used)++] = 0;
+        return true;
+    }
+    // The sync flush ends in an empty stored block, 00 00 ff ff, which the
+    // receiver puts back.
+    if (*used - start < 4 || std::memcmp(out->data() + *used - 4, kSyncTail, 4) != 0) return false;
+    *used -= 4;
+    if (noContextTakeover_) deflateReset(&s);
+    return true;
+}
+
+bool WsDeflate::decompress(const char *src, size_t n, std::vector<char> *out, size_t *used,
+                           size_t maxLen) {
+    z_stream &s = z_->inf;
+    if (!z_->infReady) {
+        std::memset(&s, 0, sizeof(s));
+        if (inflateInit2(&s, -15) != Z_OK) return false;
+        z_->infReady = true;
+    }
+    size_t start = *used;
+    const Bytef *inputs[2] = {reinterpret_cast<const Bytef *>(src), kSyncTail};
+    const size_t sizes[2] = {n, 4};
+    bool ended = false;
+    for (int part = 0; part < 2 && !ended; ++part) {
+        s.next_in = const_cast<Bytef *>(inputs[part]);
+        s.avail_in = (uInt)sizes[part];
+        for (;;) {
+            reserveOut(out, *used, std::max<size_t>(4096, sizes[part] * 2));
+            s.next_out = reinterpret_cast<Bytef *>(out->data() + *used);
+            s.avail_out = (uInt)(out->size() - *used);
+            int rc = inflate(&s, Z_SYNC_FLUSH);
+            *used = out->size() - s.avail_out;
+            if (*used - start > maxLen) return false;
+            if (rc == Z_STREAM_END) {
+                // The peer closed its stream with a final block; the next
+                // message starts a new one.
+                inflateReset(&s);
+                ended = true;
+                break;
+            }
+            if (rc == Z_BUF_ERROR && s.avail_in == 0) break; // nothing left to flush
+            if (rc != Z_OK) return false;
+            if (s.avail_in == 0 && s.avail_out != 0) break;
+        }
+    }
+    if (noContextTakeover_ && !ended) inflateReset(&s);
+    return true;
+}
+
+// ---- message reassembly ------------------------------------------------------
+
+WsMessageReader::WsMessageReader(bool expectMasked, size_t maxMessage)
+    : buf_(16 * 1024), expectMasked_(expectMasked), maxMessage_(maxMessage) {}
+
+char *WsMessageReader::space(size_t min, size_t *avail) {
+    // Keep only the open message and the unparsed bytes, moved to the front.
+    size_t keep = msgOpcode_ ? msgLen_ : 0;
+    if (msgOpcode_ && msgStart_ > 0) std::memmove(buf_.data(), buf_.data() + msgStart_, msgLen_);
+    msgStart_ = 0;
+    if (pos_ > keep) {
+        std::memmove(buf_.data() + keep, buf_.data() + pos_, end_ - pos_);
+        end_ -= pos_ - keep;
+        pos_ = keep;
+    }
+    if (buf_.size() - end_ < min) buf_.resize(std::max(buf_.size() * 2, end_ + min));
+    *avail = buf_.size() - end_;
+    return buf_.data() + end_;
+}
+
+int64_t WsMessageReader::next(WsMessage *out) {
+    for (;;) {
+        WsFrame f;
+        int64_t h = parseWsFrame(buf_.data() + pos_, end_ - pos_, &f);
+        if (h < 0) return h;
+        if (f.masked != expectMasked_) return kWsMalformed;
+        if (f.payloadLen > maxMessage_ || msgLen_ + f.payloadLen > maxMessage_) return kWsMalformed;
+        if (end_ - pos_ - (size_t)h < f.payloadLen) return kWsIncomplete;
+        char *payload = buf_.data() + pos_ + h;
+        size_t n = (size_t)f.payloadLen;
+        if (f.masked) wsMask(payload, n, f.key);
+        if (f.opcode >= kWsClose) {
+            pos_ += (size_t)h + n;
+            *out = WsMessage{f.opcode, payload, n, false};
+            return 1;
+        }
+        if (f.opcode == kWsContinuation) {
+            if (!msgOpcode_ || f.rsv1) return kWsMalformed;
+        } else {
+            if (msgOpcode_) return kWsMalformed; // a new message inside a fragmented one
+            msgOpcode_ = f.opcode;
+            msgCompressed_ = f.rsv1;
+            msgStart_ = pos_;
+            msgLen_ = 0;
+        }
+        // Slide this fragment down against the ones before it.
+        char *dst = buf_.data() + msgStart_ + msgLen_;
+        if (dst != payload) std::memmove(dst, payload, n);
+        msgLen_ += n;
+        pos_ += (size_t)h + n;
+        if (f.fin) {
+            *out = WsMessage{msgOpcode_, buf_.data() + msgStart_, msgLen_, msgCompressed_};
+            msgOpcode_ = 0;
+            msgLen_ = 0;
+            return 1;
+        }
+    }
+}
+
+} // namespace runtime
+} // namespace tocin
@@ -0,0 +1,118 @@
+#ifndef TOCIN_WEBSOCKET_H
+#define TOCIN_WEBSOCKET_H
+
+/**
+ * RFC 6455 framing for the ws* builtins (concurrency_runtime.cpp) and
+ * stdlib/web/websocket.to, with RFC 7692 permessage-deflate.
+ *
+ * Frames are encoded and decoded in place: wsMask XORs a payload where it
+ * lies, 16 bytes at a time with SSE2 (8 otherwise), and WsMessageReader
+ * assembles messages inside its own receive buffer, unmasking each
+ * fragment and moving it up against the previous one rather than copying
+ * it out. After the buffers have grown to the traffic's size, reading and
+ * writing frames allocates nothing.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tocin {
+namespace runtime {
+
+constexpr int64_t kWsMalformed = -1;
+constexpr int64_t kWsIncomplete = -2;
+constexpr size_t kWsMaxHeader = 14;
+
+enum WsOpcode { kWsContinuation = 0, kWsText = 1, kWsBinary = 2, kWsClose = 8, kWsPing = 9, kWsPong = 10 };
+
+// XOR p[0, n) with the masking key, whose first wire byte is key >> 24.
+// `phase` is how many payload bytes came before p (for a payload masked in
+// pieces).
+void wsMask(char *p, size_t n, uint32_t key, size_t phase = 0);
+
+size_t wsHeaderLen(uint64_t payloadLen, bool masked);
+
+// Write a frame header for a payload of payloadLen bytes; returns its
+// length (at most kWsMaxHeader).
+size_t wsWriteHeader(char *dst, bool fin, bool rsv1, int opcode, uint64_t payloadLen,
+                     bool masked, uint32_t key);
+
+struct WsFrame {
+    bool fin = true;
+    bool rsv1 = false; // set on the first frame of a compressed message
+    int opcode = 0;
+    bool masked = false;
+    uint32_t key = 0;
+    size_t headerLen = 0;
+    uint64_t payloadLen = 0;
+};
+
+// Parse the frame header at p[0, len): its length, kWsIncomplete, or
+// kWsMalformed (RSV2/RSV3 set, an unknown opcode, a fragmented or long
+// control frame, or a length with its top bit set).
+int64_t parseWsFrame(const char *p, size_t len, WsFrame *out);
+
+// permessage-deflate: raw deflate, each message ended by a sync flush
+// whose trailing 00 00 ff ff is left off the wire.
+class WsDeflate {
+public:
+    explicit WsDeflate(bool noContextTakeover = false);
+    ~WsDeflate();
+    WsDeflate(const WsDeflate &) = delete;
+    WsDeflate &operator=(const WsDeflate &) = delete;
+
+    // Write the compressed form of src[0, n) at (*out)[*used], growing
+    // *out as needed (it is never shrunk, so it doubles as capacity), and
+    // advance *used past it.
+    bool compress(const char *src, size_t n, std::vector<char> *out, size_t *used);
+    // The same for inflating a received message; false on corrupt input or
+    // once the output would pass maxLen bytes.
+    bool decompress(const char *src, size_t n, std::vector<char> *out, size_t *used, size_t maxLen);
+
+private:
+    struct Streams;
+    Streams *z_;
+    bool noContextTakeover_;
+};
+
+struct WsMessage {
+    int opcode = 0;          // text, binary, close, ping or pong
+    const char *data = nullptr;
+    size_t len = 0;
+    bool compressed = false; // RSV1 was set: data is still deflated
+};
+
+// Reassembles messages from the bytes of one connection. Control frames
+// arriving between the fragments of a message are returned as they come;
+// the message goes on being assembled around them.
+class WsMessageReader {
+public:
+    // `expectMasked`: a server requires masked frames, a client unmasked ones.
+    explicit WsMessageReader(bool expectMasked, size_t maxMessage = 64u << 20);
+
+    // Room for at least `min` more received bytes; commit() what was read.
+    char *space(size_t min, size_t *avail);
+    void commit(size_t n) { end_ += n; }
+
+    // kWsIncomplete until a whole message (or control frame) is buffered,
+    // then 1 with *out pointing into the buffer until the next call;
+    // kWsMalformed on a protocol violation or an over-long message.
+    int64_t next(WsMessage *out);
+
+private:
+    std::vector<char> buf_;
+    size_t end_ = 0;      // bytes held
+    size_t pos_ = 0;      // the next frame to parse
+    size_t msgStart_ = 0; // the message being assembled, contiguous from here
+    size_t msgLen_ = 0;
+    int msgOpcode_ = 0;   // 0 when no fragmented message is open
+    bool msgCompressed_ = false;
+    bool expectMasked_;
+    size_t maxMessage_;
+};
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_WEBSOCKET_H
@@ -0,0 +1,161 @@
+#ifndef TOCIN_XOSHIRO_H
+#define TOCIN_XOSHIRO_H
+
+/**
+ * xoshiro256++ (Blackman and Vigna), the generator behind randSeed, randInt,
+ * randRange, randFill and randFillFloat (__tocin_rand_* in
+ * concurrency_runtime.cpp).
+ *
+ * Every goroutine and thread has a RandState of its own. Single draws come
+ * from `gen`; randInt and randRange run its step inline in generated code,
+ * on the words __tocin_rand_state returns. Bulk fills use four more
+ * generators, each 2^128 steps ahead of the one before, stepped side by
+ * side: the state is stored word-major, so one step is the same adds,
+ * shifts and xors across four lanes, which compile to vector instructions.
+ *
+ * jump() advances a generator 2^128 steps and longJump() 2^192. A new
+ * goroutine takes its parent's generator and the parent long-jumps past
+ * it, so every stream is disjoint from the others and, given a seed, the
+ * same on every run.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tocin {
+namespace runtime {
+
+inline uint64_t rotl64(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+struct Xoshiro256 {
+    uint64_t s[4];
+
+    uint64_t next() {
+        const uint64_t result = rotl64(s[0] + s[3], 23) + s[0];
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl64(s[3], 45);
+        return result;
+    }
+
+    // The state splitmix64 expands from x, as the xoshiro authors advise;
+    // never all zero.
+    void seed(uint64_t x) {
+        for (uint64_t &w : s) {
+            uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            w = z ^ (z >> 31);
+        }
+    }
+
+    void jump() {
+        static constexpr uint64_t kJump[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                              0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+        advance(kJump);
+    }
+    void longJump() {
+        static constexpr uint64_t kLongJump[4] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                                                  0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+        advance(kLongJump);
+    }
+
+private:
+    void advance(const uint64_t (&poly)[4]) {
+        uint64_t t[4] = {0, 0, 0, 0};
+        for (uint64_t word : poly)
+            for (int b = 0; b < 64; ++b) {
+                if (word & (uint64_t(1) << b))
+                    for (int i = 0; i < 4; ++i) t[i] ^= s[i];
+                next();
+            }
+        for (int i = 0; i < 4; ++i) s[i] = t[i];
+    }
+};
+
+struct RandState {
+    Xoshiro256 gen;              // first: generated code steps gen.s in place
+    uint64_t lanes[4][4];        // [word][lane], valid once lanesReady
+    bool lanesReady = false;
+    bool inUse = false;          // seeded, or handed a stream
+
+    // Starts the bulk lanes at 1, 2, 3 and 4 jumps past gen, and moves gen
+    // to 5 jumps, past all four.
+    void startLanes() {
+        for (int l = 0; l < 4; ++l) {
+            gen.jump();
+            for (int w = 0; w < 4; ++w) lanes[w][l] = gen.s[w];
+        }
+        gen.jump();
+        lanesReady = true;
+    }
+
+    // Calls emit(i, r) for i in [0, n) with r a 64-bit output of the lanes.
+    template <class Emit>
+    void fill(size_t n, Emit emit) {
+        if (!lanesReady) startLanes();
+        uint64_t s0[4], s1[4], s2[4], s3[4];
+        for (int l = 0; l < 4; ++l) {
+            s0[l] = lanes[0][l];
+            s1[l] = lanes[1][l];
+            s2[l] = lanes[2][l];
+            s3[l] = lanes[3][l];
+        }
+        for (size_t i = 0; i < n; i += 4) {
+            uint64_t r[4];
+            for (int l = 0; l < 4; ++l) {
+                r[l] = rotl64(s0[l] + s3[l], 23) + s0[l];
+                const uint64_t t = s1[l] << 17;
+                s2[l] ^= s0[l];
+                s3[l] ^= s1[l];
+                s1[l] ^= s2[l];
+                s0[l] ^= s3[l];
+                s2[l] ^= t;
+                s3[l] = rotl64(s3[l], 45);
+            }
+            if (i + 4 <= n) {
+                for (int l = 0; l < 4; ++l) emit(i + l, r[l]);
+            } else {
+                for (size_t l = 0; i + l < n; ++l) emit(i + l, r[l]);
+            }
+        }
+        for (int l = 0; l < 4; ++l) {
+            lanes[0][l] = s0[l];
+            lanes[1][l] = s1[l];
+            lanes[2][l] = s2[l];
+            lanes[3][l] = s3[l];
+        }
+    }
+};
+
+// Lemire's nearly-divisionless bounded draw: uniform in [0, span), with a
+// division only when the first multiply lands in the biased sliver.
+inline uint64_t boundedDraw(Xoshiro256 &g, uint64_t span) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t m = (__uint128_t)g.next() * span;
+    uint64_t low = (uint64_t)m;
+    if (low < span) {
+        const uint64_t threshold = (0 - span) % span;
+        while (low < threshold) {
+            m = (__uint128_t)g.next() * span;
+            low = (uint64_t)m;
+        }
+    }
+    return (uint64_t)(m >> 64);
+#else
+    const uint64_t threshold = (0 - span) % span;
+    for (;;) {
+        uint64_t r = g.next();
+        if (r >= threshold) return r % span;
+    }
+#endif
+}
+
+} // namespace runtime
+} // namespace tocin
+
+#endif // TOCIN_XOSHIRO_H
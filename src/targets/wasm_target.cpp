@@ -0,0 +1,115 @@
+#include "wasm_target.h"
+
+#include <cstdlib>
+
+#ifdef TOCIN_HAVE_WASM_BACKEND
+extern "C" {
+void LLVMInitializeWebAssemblyTargetInfo();
+void LLVMInitializeWebAssemblyTarget();
+void LLVMInitializeWebAssemblyTargetMC();
+void LLVMInitializeWebAssemblyAsmPrinter();
+}
+#endif
+
+namespace targets {
+
+namespace {
+
+std::string env(const char* name)
+{
+    const char* value = std::getenv(name);
+    return value ? value : "";
+}
+
+std::string quoted(const std::string& s) { return "\"" + s + "\""; }
+
+} // namespace
+
+WASMTarget::WASMTarget(const WASMTargetConfig& cfg) : config_(cfg) {}
+
+bool WASMTarget::initializeBackend()
+{
+#ifdef TOCIN_HAVE_WASM_BACKEND
+    static const bool initialized = [] {
+        LLVMInitializeWebAssemblyTargetInfo();
+        LLVMInitializeWebAssemblyTarget();
+        LLVMInitializeWebAssemblyTargetMC();
+        LLVMInitializeWebAssemblyAsmPrinter();
+        return true;
+    }();
+    return initialized;
+#else
+    return false;
+#endif
+}
+
+bool WASMTarget::isWasmTriple(const std::string& triple)
+{
+    return triple.rfind("wasm32", 0) == 0 || triple.rfind("wasm64", 0) == 0;
+}
+
+std::string WASMTarget::triple() const
+{
+    // The object format is the same with threads; only the link (shared
+    // memory, the wasi-threads libc) differs.
+    return "wasm32-unknown-wasi";
+}
+
+std::string WASMTarget::features() const
+{
+    // sign-ext, nontrapping-fptoint and mutable-globals are in every engine
+    // that has SIMD128; they shorten integer narrowing and float-to-int.
+    std::string f = "+sign-ext,+nontrapping-fptoint,+mutable-globals";
+    if (config_.enableSIMD)
+        f += ",+simd128";
+    if (config_.enableBulkMemory || config_.enableThreads)
+        f += ",+bulk-memory";
+    if (config_.enableThreads)
+        f += ",+atomics";
+    return f;
+}
+
+std::string WASMTarget::linkCommand(const std::vector<std::string>& objects, const std::string& output,
+                                    std::string& error) const
+{
+    const std::string sdk = env("WASI_SDK_PATH");
+    std::string driver = !sdk.empty() ? sdk + "/bin/clang" : "clang";
+#if defined(_WIN32)
+    const char* devnull = "NUL";
+#else
+    const char* devnull = "/dev/null";
+#endif
+    if (std::system((quoted(driver) + " --version >" + devnull + " 2>&1").c_str()) != 0)
+    {
+        error = "No clang found to link WebAssembly. Install the WASI SDK and set WASI_SDK_PATH, "
+                "or put a clang with the WebAssembly target and a WASI sysroot on PATH. "
+                "(Tip: -o <file>.o writes the wasm object without linking.)";
+        return "";
+    }
+    std::string sysroot = env("WASI_SYSROOT");
+    if (sysroot.empty() && !sdk.empty())
+        sysroot = sdk + "/share/wasi-sysroot";
+
+    std::string cmd = quoted(driver);
+    cmd += config_.enableThreads ? " --target=wasm32-wasi-threads -pthread" : " --target=wasm32-wasi";
+    if (!sysroot.empty())
+        cmd += " --sysroot=" + quoted(sysroot);
+    for (const auto& object : objects)
+        cmd += " " + quoted(object);
+    cmd += " -o " + quoted(output);
+
+    const std::string runtime = env("TOCIN_WASM_RUNTIME");
+    if (!runtime.empty())
+        cmd += " " + quoted(runtime);
+    else
+        cmd += " -Wl,--allow-undefined";  // __tocin_* imported from "env"
+
+    const uint64_t page = 65536;
+    cmd += " -Wl,--initial-memory=" + std::to_string(config_.initialPages * page);
+    cmd += " -Wl,--max-memory=" + std::to_string(config_.maxPages * page);
+    if (config_.enableThreads)
+        cmd += " -Wl,--import-memory,--shared-memory";
+    return cmd;
+}
+
+} // namespace targets
@@ -1,88 +1,78 @@
 #pragma once
 
-#include "../ast/ast.h"
-#include "../error/error_handler.h"
-#include <memory>
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <unordered_map>
 
 namespace targets {
 
 /**
  * @brief WebAssembly target configuration
+ *
+ * SIMD128 lets the loop vectorizer and the SLP vectorizer emit v128 code;
+ * bulk memory turns memcpy/memset (list slices and copies, string
+ * concatenation, zeroed allocations) into single memory.copy/memory.fill
+ * instructions instead of byte loops. With threads the code uses atomics and
+ * is linked against a shared memory, for a runtime built with wasi-threads.
  */
 struct WASMTargetConfig {
-    bool optimize;
-    bool enableSIMD;
-    bool enableThreads;
-    bool enableExceptionHandling;
-    bool enableGarbageCollection;
-    std::string importMemory;
-    std::string exportMemory;
-    int memorySize;
-    int maxMemorySize;
-    
-    WASMTargetConfig()
-        : optimize(true), enableSIMD(true), enableThreads(false),
-          enableExceptionHandling(true), enableGarbageCollection(true),
-          memorySize(256), maxMemorySize(65536) {}
+    bool enableSIMD = true;
+    bool enableBulkMemory = true;
+    bool enableThreads = false;
+    uint32_t initialPages = 256;   // 64 KiB pages: 16 MiB
+    uint32_t maxPages = 65536;     // 4 GiB, the wasm32 limit
 };
 
 /**
- * @brief WebAssembly target
+ * @brief WebAssembly target (`--target wasm`)
+ *
+ * The program goes through the same IRGenerator and optimization pipeline as
+ * a native build; only the triple, features and final link differ. The
+ * LLVM wasm32 backend writes a relocatable object, which the WASI toolchain's
+ * clang links into a `.wasm` command module (WASI `_start` calls main).
  */
 class WASMTarget {
-private:
-    WASMTargetConfig config;
-    std::unordered_map<std::string, std::string> imports;
-    std::unordered_map<std::string, std::string> exports;
-    std::vector<std::string> functions;
-    std::vector<std::string> globals;
-    std::vector<std::string> memories;
-    std::vector<std::string> tables;
-    
 public:
-    WASMTarget(const WASMTargetConfig& cfg = WASMTargetConfig());
-    ~WASMTarget();
-    
-    /**
-     * @brief Generate WebAssembly code from AST
-     */
-    std::string generateWASM(ast::StmtPtr ast, error::ErrorHandler& errorHandler);
-    
+    explicit WASMTarget(const WASMTargetConfig& cfg = WASMTargetConfig());
+
     /**
-     * @brief Add import
+     * @brief Register LLVM's WebAssembly backend. False when this LLVM was
+     *        built without it.
      */
-    void addImport(const std::string& module, const std::string& name, const std::string& signature);
-    
+    static bool initializeBackend();
+
     /**
-     * @brief Add export
+     * @brief Whether an LLVM triple names a WebAssembly target
      */
-    void addExport(const std::string& name, const std::string& signature);
-    
+    static bool isWasmTriple(const std::string& triple);
+
     /**
-     * @brief Generate WASM module
+     * @brief LLVM triple for code generation
      */
-    std::string generateModule();
-    
+    std::string triple() const;
+
     /**
-     * @brief Optimize WASM code
+     * @brief Target features for code generation (e.g. +simd128,+bulk-memory)
      */
-    std::string optimizeWASM(const std::string& wasmCode);
-    
+    std::string features() const;
+
     /**
-     * @brief Validate WASM code
+     * @brief Command linking @p objects into @p output.
+     *
+     * The link driver is $WASI_SDK_PATH/bin/clang, else clang on PATH; the
+     * sysroot is $WASI_SYSROOT, else the SDK's. The runtime archive named by
+     * $TOCIN_WASM_RUNTIME (tocin_runtime built with the WASI SDK) is linked
+     * when set; otherwise the runtime's __tocin_* entry points stay imports
+     * for the embedder to provide. Returns "" and sets @p error when no
+     * driver can be found.
      */
-    bool validateWASM(const std::string& wasmCode, error::ErrorHandler& errorHandler);
-    
+    std::string linkCommand(const std::vector<std::string>& objects, const std::string& output,
+                            std::string& error) const;
+
+    const WASMTargetConfig& config() const { return config_; }
+
 private:
-    std::string generateFunction(ast::FunctionStmt* func);
-    std::string generateExpression(ast::ExprPtr expr);
-    std::string generateStatement(ast::StmtPtr stmt);
-    std::string generateType(ast::TypePtr type);
-    std::string generateLocalVariables(const std::vector<ast::Parameter>& params);
-    std::string generateInstructions(ast::StmtPtr stmt);
+    WASMTargetConfig config_;
 };
 
-} // namespace targets 
\ No newline at end of file
+} // namespace targets
@@ -16,6 +16,14 @@ namespace type_checker
         return !sawError;
     }
 
+    std::set<const ast::VariableStmt *> BorrowChecker::uniqueOwners() const
+    {
+        std::set<const ast::VariableStmt *> out;
+        for (const ast::VariableStmt *v : ownerDecls)
+            if (!movedDecls.count(v)) out.insert(v);
+        return out;
+    }
+
     void BorrowChecker::collectClasses(const ast::StmtPtr &stmt)
     {
         if (!stmt) return;
@@ -38,9 +46,13 @@ namespace type_checker
         return type && ownedClasses.count(type->toString()) > 0;
     }
 
-    void BorrowChecker::declareOwned(const std::string &name)
+    void BorrowChecker::declareOwned(const std::string &name, const ast::VariableStmt *decl)
     {
-        if (!scopes.empty()) scopes.back()[name] = VarInfo{};
+        if (scopes.empty()) return;
+        VarInfo info;
+        info.decl = decl;
+        scopes.back()[name] = info;
+        if (decl) ownerDecls.insert(decl);
     }
 
     BorrowChecker::VarInfo *BorrowChecker::find(const std::string &name)
@@ -220,7 +232,7 @@ namespace type_checker
             }
             bool owned = isOwnedDecl(vs.get());
             consume(vs->initializer);      // RHS: move a bare owned source, else read
-            if (owned) declareOwned(vs->name);
+            if (owned) declareOwned(vs->name, vs.get());
             return;
         }
         if (auto es = asS<ast::ExpressionStmt>(stmt))
@@ -301,6 +313,7 @@ namespace type_checker
                     errBorrow("cannot move '" + v->name + "' while it is borrowed",
                               v->token);
                 st->state = State::Moved;
+                if (st->decl) movedDecls.insert(st->decl);
             }
             return; // bare var: either moved (owned) or an untracked copy
         }
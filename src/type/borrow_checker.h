@@ -16,10 +16,13 @@
 //   `&x` is live you cannot mutably borrow, move, or mutate `x` (B002). Borrows
 //   are released when the borrowing binding leaves scope (lexical lifetimes).
 //
-// The pass never changes codegen; it only reports diagnostics.
+// The pass only reports diagnostics. What it learns is offered to codegen:
+// uniqueOwners() lists the owned bindings it never saw moved out, which
+// `--memory=owned` frees when their function returns (ir_generator.h).
 
 #include "../ast/ast.h"
 #include "../error/error_handler.h"
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -36,6 +39,10 @@ namespace type_checker
         // Returns true if no ownership errors were found.
         bool check(const ast::StmtPtr &program);
 
+        // After check(): the `let` bindings of owned values that no analyzed
+        // path moves out of (by assignment, argument, return or `move`).
+        std::set<const ast::VariableStmt *> uniqueOwners() const;
+
     private:
         enum class State { Owned, Moved };
 
@@ -47,6 +54,7 @@ namespace type_checker
             bool mut = false;        // a live &mut borrow OF this variable exists
             std::string borrowOf;    // if this var is a reference, the var it borrows
             bool borrowMut = false;  // ... and whether that borrow is mutable
+            const ast::VariableStmt *decl = nullptr; // the `let` that bound it, if any
         };
         using ScopeMap = std::unordered_map<std::string, VarInfo>;
         using Snapshot = std::vector<ScopeMap>;
@@ -55,6 +63,8 @@ namespace type_checker
         std::unordered_set<std::string> ownedClasses; // class/struct type names
         std::vector<ScopeMap> scopes;                 // stack of owned-local states
         bool sawError = false;
+        std::unordered_set<const ast::VariableStmt *> ownerDecls; // every owned `let`
+        std::unordered_set<const ast::VariableStmt *> movedDecls; // ... moved out of on some path
 
         // Pre-pass: gather class/struct names (the set of owned types).
         void collectClasses(const ast::StmtPtr &stmt);
@@ -64,7 +74,7 @@ namespace type_checker
         // Scope + state helpers.
         void pushScope() { scopes.emplace_back(); }
         void popScope();                              // releases borrows held here
-        void declareOwned(const std::string &name);
+        void declareOwned(const std::string &name, const ast::VariableStmt *decl = nullptr);
         VarInfo *find(const std::string &name);       // nearest scope entry, or null
 
         // Recursive analysis.
@@ -20,25 +20,43 @@ namespace type_checker
         static const std::unordered_map<std::string, std::set<int>> table = {
             // I/O and process
             {"print", {}}, {"println", {}}, {"printf", {}}, {"input", {}},
-            {"readLine", {0}}, {"readFile", {1}}, {"writeFile", {2}}, {"appendFile", {2}},
-            {"envGet", {1}}, {"sysExit", {1}}, {"sleepMs", {1}},
+            {"readLine", {0, 1}}, {"readFile", {1}}, {"writeFile", {2}}, {"appendFile", {2}}, {"fileSize", {1}},
+            {"mmapFile", {1}}, {"mmapSize", {1}}, {"munmapFile", {1}}, {"mmapAdvise", {2}},
+            {"fileOpen", {1}}, {"fileClose", {1}}, {"fileEof", {1}}, {"readRecord", {2}}, {"readChunk", {4}},
+            {"kvStoreOpen", {1}}, {"kvStorePut", {3}}, {"kvStoreGet", {3}}, {"kvStoreHas", {2}},
+            {"kvStoreDelete", {2}}, {"kvStoreLen", {1}}, {"kvStoreSetSync", {2}}, {"kvStoreSync", {1}},
+            {"kvStoreCompact", {1}}, {"kvStoreClose", {1}},
+            {"envGet", {1}}, {"sysExit", {1}}, {"sleepMs", {1}}, {"afterMs", {1}},
+            // scheduler and runtime health
+            {"runtimeStats", {1}}, {"runtimeMetrics", {0}}, {"runtimeMetricsServe", {1}},
+            {"allocProfile", {1}}, {"heapSnapshot", {1}}, {"gcConfigure", {2}},
+            {"allocCounting", {1}}, {"allocCounts", {1}},
+            {"traceProbe", {1}}, {"traceRemove", {1}},
             // time
-            {"timeMs", {0}}, {"timeSec", {0}}, {"monoNanos", {0}},
+            {"timeMs", {0}}, {"timeSec", {0}}, {"monoNanos", {0}}, {"blackBox", {1}},
             // conversions
             {"intToStr", {1}}, {"strToInt", {1}}, {"floatToStr", {1}}, {"strToFloat", {1}},
             {"intToFloat", {1}}, {"floatToInt", {1}}, {"charToStr", {1}},
+            {"floatBits", {1}}, {"floatFromBits", {1}},
+            {"floatsToStr", {2}}, {"strToFloats", {2}},
             {"str", {}}, {"int", {}}, {"float", {}}, {"bool", {}},
             // strings
             {"strLen", {1}}, {"strEq", {2}}, {"strCmp", {2}}, {"strContains", {2}},
-            {"strIndexOf", {2}}, {"substring", {3}}, {"charAt", {2}}, {"indexOfChar", {2}},
+            {"strIndexOf", {2, 3}}, {"substring", {3}}, {"charAt", {2}}, {"indexOfChar", {2}},
             {"startsWith", {2}}, {"endsWith", {2}}, {"toLower", {1}}, {"toUpper", {1}},
+            {"intern", {1}},
             {"toLowerChar", {1}}, {"toUpperChar", {1}},
+            {"sbNew", {0}}, {"sbAppend", {2}}, {"sbAppendInt", {2}}, {"sbAppendFloat", {2}},
+            {"sbLen", {1}}, {"sbFinish", {1}},
             {"isDigit", {1}}, {"isAlpha", {1}}, {"isAlnum", {1}}, {"isSpace", {1}},
             {"isLower", {1}}, {"isUpper", {1}},
             {"len", {1}},
             // hashing / random
             {"hashInt", {1}}, {"hashStr", {1}}, {"hashBytes", {2}},
+            {"hashFastStr", {1}}, {"hashFastBytes", {2}}, {"hashStrSeeded", {2}}, {"hashSeeded", {3}},
+            {"hashCombine", {2}},
             {"randSeed", {1}}, {"randInt", {0}}, {"randRange", {2}},
+            {"randFill", {2}}, {"randFillFloat", {4}},
             // math (unary libm set + intrinsic-lowered subset)
             {"sqrt", {1}}, {"sin", {1}}, {"cos", {1}}, {"tan", {1}},
             {"asin", {1}}, {"acos", {1}}, {"atan", {1}},
@@ -58,6 +76,9 @@ namespace type_checker
             {"volatileStore8", {3}}, {"volatileStore16", {3}},
             {"volatileStore32", {3}}, {"volatileStore64", {3}},
             {"fence", {0}},
+            // sequentially consistent atomics on the word at p+off
+            {"atomicLoad", {2}}, {"atomicStore", {3}}, {"atomicAdd", {3}}, {"atomicSwap", {3}},
+            {"atomicCas", {4}},
             // inline assembly: asm(template) or asm(template, constraints, ...)
             {"asm", {}},
             // module-level (top-level) inline assembly: emitted verbatim into the
@@ -67,15 +88,90 @@ namespace type_checker
             // growable vector runtime
             {"vecNew", {0}}, {"vecPush", {2}}, {"vecGet", {2}}, {"vecSet", {3}},
             {"vecLen", {1}}, {"vecPop", {1}}, {"vecFree", {1}}, {"vecToArray", {1}},
+            {"vecNewI8", {0}}, {"vecNewI32", {0}}, {"vecNewF32", {0}}, {"vecNewF64", {0}},
             // hashmap runtime
             {"mapNew", {0}}, {"mapPut", {3}}, {"mapGet", {2}}, {"mapHas", {2}},
             {"mapPutStr", {3}}, {"mapGetStr", {2}}, {"mapHasStr", {2}},
             {"mapLen", {1}}, {"mapFree", {1}},
+            {"mapReserve", {2}}, {"mapReserveStr", {2}}, {"mapCapacity", {1}}, {"mapCapacityStr", {1}},
+            // arenas; __arena_enter/__arena_exit come from the `withArena` desugaring
+            {"arenaNew", {0}}, {"arenaFree", {1}}, {"arenaReset", {1}}, {"arenaUsed", {1}},
+            {"__arena_enter", {0, 1}}, {"__arena_exit", {0}},
             // networking
             {"tcpListen", {1}}, {"tcpAccept", {1}}, {"tcpConnect", {2}},
             {"tcpSend", {2}}, {"tcpRecv", {1}}, {"tcpClose", {1}},
+            {"tcpSendBuf", {4}}, {"tcpRecvInto", {4}}, {"tcpSendFile", {2, 4}},
+            // client connection pools and the DNS cache behind tcpConnect
+            {"tcpDnsTtl", {1}}, {"tcpPoolNew", {2}}, {"tcpPoolGet", {3}}, {"tcpPoolPut", {3}},
+            {"tcpPoolReap", {1}}, {"tcpPoolStats", {2}}, {"tcpPoolClose", {1}},
+            // HTTP/1.1 request (and client-side response) parsing over a receive buffer
+            {"httpParse", {4}}, {"httpHeader", {2}}, {"httpConnNew", {1}}, {"httpConnNext", {1}},
+            {"httpConnRequest", {1}}, {"httpConnPending", {1}}, {"httpConnFree", {1}},
+            {"httpClientConnNew", {1}},
+            // WebSocket frames and connections
+            {"wsMask", {4}}, {"wsWriteFrame", {6}}, {"wsParseFrame", {4}}, {"wsConnNew", {2}},
+            {"wsConnNext", {1}}, {"wsConnData", {1}}, {"wsConnLen", {1}}, {"wsConnText", {1}},
+            {"wsConnSend", {5}}, {"wsConnSendText", {2}}, {"wsConnFree", {1}},
+            // JSON tapes with on-demand access, and NDJSON streams
+            {"jsonParseFast", {1}}, {"jsonDocNew", {0}}, {"jsonParseInto", {4}}, {"jsonDocFree", {1}},
+            {"jsonFastType", {2}}, {"jsonFastLen", {2}}, {"jsonFastFirst", {2}}, {"jsonFastNext", {2}},
+            {"jsonFastValue", {2}}, {"jsonFastAt", {3}}, {"jsonFastGet", {3}}, {"jsonFastPointer", {3}},
+            {"jsonFastInt", {2}}, {"jsonFastFloat", {2}}, {"jsonFastBool", {2}}, {"jsonFastString", {2}},
+            {"jsonFastStrEq", {3}}, {"jsonStreamOpen", {1}}, {"jsonStreamOf", {1}}, {"jsonStreamNext", {1}},
+            {"jsonStreamDoc", {1}}, {"jsonStreamClose", {1}},
             // Option/Result constructors and concurrency
-            {"Some", {1}}, {"Ok", {1}}, {"Err", {1}}, {"__chan_new", {}},
+            {"Some", {1}}, {"Ok", {1}}, {"Err", {1}}, {"__chan_new", {0, 1}},
+            // batched channel send/receive over [len][elems] arrays
+            {"chanSendMany", {2}}, {"chanRecvInto", {3}},
+            // goroutine-aware WaitGroup, Mutex, RWLock and Once handles
+            {"waitGroupNew", {0}}, {"waitGroupAdd", {2}}, {"waitGroupDone", {1}}, {"waitGroupWait", {1}},
+            {"mutexNew", {0}}, {"mutexLock", {1}}, {"mutexUnlock", {1}}, {"mutexTryLock", {1}},
+            {"rwlockNew", {0}}, {"rwlockRLock", {1}}, {"rwlockRUnlock", {1}}, {"rwlockLock", {1}},
+            {"rwlockUnlock", {1}}, {"onceNew", {0}}, {"onceDo", {2}}, {"syncFree", {1}},
+            // blocked float64 GEMM / GEMV over row-major list<float>
+            {"gemmF64", {6, 9}}, {"gemmF64NT", {6, 9}}, {"gemvF64", {5, 7}},
+            // in-place sorts of list<int> / list<float> / list<string>
+            {"sortI64", {1}}, {"sortF64", {1}}, {"sortStr", {1}}, {"radixSortI64", {1}},
+            {"stableSortI64", {1}}, {"stableSortF64", {1}}, {"parallelSortI64", {1}},
+            {"parallelSortF64", {1}}, {"sortByI64Keys", {2}}, {"sortByF64Keys", {2}},
+            {"selectI64", {2}}, {"selectF64", {2}},
+            // streaming quantiles (t-digest handles)
+            {"tdigestNew", {1}}, {"tdigestFree", {1}}, {"tdigestAdd", {2}}, {"tdigestAddAll", {2}},
+            {"tdigestMerge", {2}}, {"tdigestQuantile", {2}}, {"tdigestCdf", {2}}, {"tdigestCount", {1}},
+            // SIMD reductions and searches over list<int>
+            {"i64Sum", {1}}, {"i64ArgMin", {1}}, {"i64ArgMax", {1}}, {"i64CountEq", {2}},
+            {"i64CountGt", {2}}, {"i64FindEq", {2}}, {"i64FindGt", {2}}, {"i64FindLe", {2}},
+            {"i64LowerBound", {2}},
+            // framebuffer spans (game.graphics)
+            {"fbFillRect", {8}}, {"fbBlendRect", {8}}, {"fbFillCircle", {7}}, {"fbBlit", {8}},
+            {"fbBlendBlit", {8}},
+            // block audio graph and SPSC block ring (audio.graph)
+            {"audioGraphNew", {2}}, {"audioGraphFree", {1}}, {"audioGraphOsc", {4}}, {"audioGraphMix", {1}},
+            {"audioGraphLowpass", {3}}, {"audioGraphConnect", {4}}, {"audioGraphGain", {3}},
+            {"audioGraphClip", {3}}, {"audioGraphSetFreq", {3}}, {"audioGraphProcess", {2}},
+            {"audioGraphProcessToRing", {2}}, {"audioRingNew", {2}}, {"audioRingFree", {1}},
+            {"audioRingPush", {2}}, {"audioRingPop", {2}}, {"audioRingSize", {1}},
+            // grayscale image filters and resizes (ml.computer_vision)
+            {"imgBoxBlur", {5}}, {"imgSobel", {4}}, {"imgResize", {7}},
+            // strided, pooled, lazily fused tensors (ml.tensor)
+            {"tensorNew", {1}}, {"tensorFromList", {2}}, {"tensorToList", {2}}, {"tensorFree", {1}},
+            {"tensorMark", {0}}, {"tensorRelease", {1}}, {"tensorKeep", {1}}, {"tensorRank", {1}},
+            {"tensorDim", {2}}, {"tensorNumel", {1}}, {"tensorGet", {2}}, {"tensorSet", {3}},
+            {"tensorReshape", {2}}, {"tensorSlice", {5}}, {"tensorTranspose", {3}}, {"tensorContiguous", {1}},
+            {"tensorBinary", {3}}, {"tensorUnary", {2}}, {"tensorScalarOp", {3}}, {"tensorEval", {1}},
+            {"tensorAssign", {2}}, {"tensorFill", {2}}, {"tensorMatmul", {2}}, {"tensorSum", {1}},
+            {"tensorPoolStat", {1}}, {"tensorMatmulQ", {2}},
+            // int8 / fp16 / bf16 quantized weight matrices (ml.quant)
+            {"quantize", {4}}, {"qmatVec", {3, 5}}, {"qmatMul", {4, 6}}, {"qmatDequantize", {2}},
+            {"qmatRows", {1}}, {"qmatCols", {1}}, {"qmatBytes", {1}}, {"qmatFree", {1}},
+            // SIMD vectors: T(x) splats, T(a, b, ...) takes one value per lane
+            {"f64x2", {}}, {"f64x4", {}}, {"f32x4", {}}, {"f32x8", {}},
+            {"i64x2", {}}, {"i64x4", {}}, {"i32x4", {}}, {"i32x8", {}},
+            {"f64x2Load", {2}}, {"f64x4Load", {2}}, {"f32x4Load", {2}}, {"f32x8Load", {2}},
+            {"i64x2Load", {2}}, {"i64x4Load", {2}}, {"i32x4Load", {2}}, {"i32x8Load", {2}},
+            {"simdStore", {3}}, {"simdSum", {1}}, {"simdMin", {1}}, {"simdMax", {1}},
+            {"simdAny", {1}}, {"simdAll", {1}}, {"simdSelect", {3}}, {"simdShuffle", {}},
+            {"simdFma", {3}},
         };
         return table;
     }
@@ -68,7 +68,7 @@ bool NullSafetyChecker::isNullCheck(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check for null check expressions (x == null, x != null)
-    if (auto binaryExpr = std::dynamic_pointer_cast<ast::BinaryExpr>(expr)) {
+    if (auto *binaryExpr = ast::dyn_cast<ast::BinaryExpr>(expr)) {
         if (binaryExpr->op.type == lexer::TokenType::EQUAL || 
             binaryExpr->op.type == lexer::TokenType::NOT_EQUAL) {
             
@@ -87,12 +87,12 @@ bool NullSafetyChecker::isSafeCall(ast::ExprPtr expr) {
     
     // Check for safe call expressions (x?.method())
     // The AST has no explicit safe-call flag; return false.
-    if (std::dynamic_pointer_cast<ast::CallExpr>(expr)) {
+    if (ast::isa<ast::CallExpr>(expr)) {
         return false;
     }
     
     // Check for safe property access (x?.property)
-    if (std::dynamic_pointer_cast<ast::GetExpr>(expr)) {
+    if (ast::isa<ast::GetExpr>(expr)) {
         return false;
     }
     
@@ -103,7 +103,7 @@ bool NullSafetyChecker::isElvisOperator(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check for Elvis operator expressions (x ?: defaultValue)
-    if (auto binaryExpr = std::dynamic_pointer_cast<ast::BinaryExpr>(expr)) {
+    if (auto *binaryExpr = ast::dyn_cast<ast::BinaryExpr>(expr)) {
         if (binaryExpr->op.type == lexer::TokenType::ELVIS) {
             return true;
         }
@@ -129,7 +129,7 @@ ast::TypePtr NullSafetyChecker::makeNullable(ast::TypePtr type) {
     std::string typeStr = type->toString();
     if (isNullableType(type)) return type;
     
-    return std::make_shared<ast::SimpleType>(
+    return ast::make<ast::SimpleType>(
         lexer::Token(lexer::TokenType::IDENTIFIER, typeStr + "?", "", 0, 0));
 }
 
@@ -145,7 +145,7 @@ ast::TypePtr NullSafetyChecker::makeNonNull(ast::TypePtr type) {
         typeStr = typeStr.substr(0, pos);
     }
     
-    return std::make_shared<ast::SimpleType>(
+    return ast::make<ast::SimpleType>(
         lexer::Token(lexer::TokenType::IDENTIFIER, typeStr, "", 0, 0));
 }
 
@@ -170,7 +170,7 @@ bool NullSafetyChecker::checkSafeCall(ast::ExprPtr expr) {
     }
     
     // Check for unsafe call on nullable variable
-    if (auto callExpr = std::dynamic_pointer_cast<ast::CallExpr>(expr)) {
+    if (auto *callExpr = ast::dyn_cast<ast::CallExpr>(expr)) {
         if (callExpr->callee) {
             std::string varName = getVariableName(callExpr->callee);
             if (!varName.empty() && nullableVariables_.count(varName) > 0) {
@@ -183,7 +183,7 @@ bool NullSafetyChecker::checkSafeCall(ast::ExprPtr expr) {
     }
     
     // Check member access
-    if (auto getExpr = std::dynamic_pointer_cast<ast::GetExpr>(expr)) {
+    if (auto *getExpr = ast::dyn_cast<ast::GetExpr>(expr)) {
         if (getExpr->object) {
             std::string varName = getVariableName(getExpr->object);
             if (!varName.empty() && nullableVariables_.count(varName) > 0) {
@@ -251,7 +251,7 @@ bool NullSafetyChecker::analyzeNullFlow(ast::StmtPtr stmt) {
     // Check if statement assigns or uses nullable values
     
     // Handle variable declarations with null assignment
-    if (auto varDecl = std::dynamic_pointer_cast<ast::VariableStmt>(stmt)) {
+    if (auto *varDecl = ast::dyn_cast<ast::VariableStmt>(stmt)) {
         if (varDecl->initializer && isNullLiteral(varDecl->initializer)) {
             nullableVariables_[varDecl->name] = true;
             definitelyNull_.insert(varDecl->name);
@@ -263,7 +263,7 @@ bool NullSafetyChecker::analyzeNullFlow(ast::StmtPtr stmt) {
     }
     
     // Handle if statements with null checks
-    if (auto ifStmt = std::dynamic_pointer_cast<ast::IfStmt>(stmt)) {
+    if (auto *ifStmt = ast::dyn_cast<ast::IfStmt>(stmt)) {
         if (ifStmt->condition && isNullCheck(ifStmt->condition)) {
             // Track variables guarded by null check
             std::string varName = getVariableName(ifStmt->condition);
@@ -348,14 +348,14 @@ bool NullSafetyChecker::checkStatementNullSafety(ast::StmtPtr stmt) {
     // Check different statement types for null safety violations
     
     // Check expression statements
-    if (auto exprStmt = std::dynamic_pointer_cast<ast::ExpressionStmt>(stmt)) {
+    if (auto *exprStmt = ast::dyn_cast<ast::ExpressionStmt>(stmt)) {
         if (exprStmt->expression) {
             return checkExpressionNullSafety(exprStmt->expression);
         }
     }
     
     // Check return statements
-    if (auto returnStmt = std::dynamic_pointer_cast<ast::ReturnStmt>(stmt)) {
+    if (auto *returnStmt = ast::dyn_cast<ast::ReturnStmt>(stmt)) {
         if (returnStmt->value) {
             std::string varName = getVariableName(returnStmt->value);
             if (!varName.empty() && nullableVariables_.count(varName) > 0) {
@@ -378,12 +378,12 @@ std::string NullSafetyChecker::getVariableName(ast::ExprPtr expr) {
     if (!expr) return "";
     
     // Extract variable name from expression
-    if (auto varExpr = std::dynamic_pointer_cast<ast::VariableExpr>(expr)) {
+    if (auto *varExpr = ast::dyn_cast<ast::VariableExpr>(expr)) {
         return varExpr->name;
     }
     
     // Check for property access (obj.prop)
-    if (auto getExpr = std::dynamic_pointer_cast<ast::GetExpr>(expr)) {
+    if (auto *getExpr = ast::dyn_cast<ast::GetExpr>(expr)) {
         return getVariableName(getExpr->object);
     }
     
@@ -396,12 +396,12 @@ bool NullSafetyChecker::isVariableExpression(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check if expression is a variable reference
-    if (std::dynamic_pointer_cast<ast::VariableExpr>(expr)) {
+    if (ast::isa<ast::VariableExpr>(expr)) {
         return true;
     }
     
     // Check for property access
-    if (std::dynamic_pointer_cast<ast::GetExpr>(expr)) {
+    if (ast::isa<ast::GetExpr>(expr)) {
         return true;
     }
     
@@ -414,7 +414,7 @@ bool NullSafetyChecker::isNullLiteral(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check if the expression is a null literal
-    if (auto literalExpr = std::dynamic_pointer_cast<ast::LiteralExpr>(expr)) {
+    if (auto *literalExpr = ast::dyn_cast<ast::LiteralExpr>(expr)) {
         return literalExpr->value == "null" || literalExpr->value == "nil";
     }
     
@@ -425,17 +425,17 @@ bool NullSafetyChecker::isNotNullLiteral(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check if the expression is definitely not a null literal
-    if (auto literalExpr = std::dynamic_pointer_cast<ast::LiteralExpr>(expr)) {
+    if (auto *literalExpr = ast::dyn_cast<ast::LiteralExpr>(expr)) {
         return literalExpr->value != "null" && literalExpr->value != "nil";
     }
     
     // Check for other non-null expressions
-    if (std::dynamic_pointer_cast<ast::VariableExpr>(expr)) {
+    if (ast::isa<ast::VariableExpr>(expr)) {
         // Variables are generally not null unless explicitly set to null
         return true;
     }
     
-    if (std::dynamic_pointer_cast<ast::CallExpr>(expr)) {
+    if (ast::isa<ast::CallExpr>(expr)) {
         // Function calls are generally not null unless they return nullable types
         return true;
     }
@@ -485,7 +485,7 @@ ast::TypePtr NullSafetyUtils::makeNullable(ast::TypePtr type) {
     std::string typeStr = type->toString();
     if (isNullableType(type)) return type;
     
-    return std::make_shared<ast::SimpleType>(
+    return ast::make<ast::SimpleType>(
         lexer::Token(lexer::TokenType::IDENTIFIER, typeStr + "?", "", 0, 0));
 }
 
@@ -501,7 +501,7 @@ ast::TypePtr NullSafetyUtils::makeNonNull(ast::TypePtr type) {
         typeStr = typeStr.substr(0, pos);
     }
     
-    return std::make_shared<ast::SimpleType>(
+    return ast::make<ast::SimpleType>(
         lexer::Token(lexer::TokenType::IDENTIFIER, typeStr, "", 0, 0));
 }
 
@@ -515,7 +515,7 @@ bool NullSafetyUtils::isNullLiteral(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check if the expression is a null literal
-    if (auto literalExpr = dynamic_cast<ast::LiteralExpr*>(expr.get())) {
+    if (auto literalExpr = ast::dyn_cast<ast::LiteralExpr>(expr.get())) {
         return literalExpr->value == "null" || literalExpr->value == "nil";
     }
     
@@ -526,17 +526,17 @@ bool NullSafetyUtils::isNotNullLiteral(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check if the expression is definitely not a null literal
-    if (auto literalExpr = dynamic_cast<ast::LiteralExpr*>(expr.get())) {
+    if (auto literalExpr = ast::dyn_cast<ast::LiteralExpr>(expr.get())) {
         return literalExpr->value != "null" && literalExpr->value != "nil";
     }
     
     // Check for other non-null expressions
-    if (auto varExpr = dynamic_cast<ast::VariableExpr*>(expr.get())) {
+    if (auto varExpr = ast::dyn_cast<ast::VariableExpr>(expr.get())) {
         // Variables are generally not null unless explicitly set to null
         return true;
     }
     
-    if (auto callExpr = dynamic_cast<ast::CallExpr*>(expr.get())) {
+    if (auto callExpr = ast::dyn_cast<ast::CallExpr>(expr.get())) {
         // Function calls are generally not null unless they return nullable types
         return true;
     }
@@ -548,7 +548,7 @@ bool NullSafetyUtils::isNullCheck(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check for null check expressions (x == null, x != null)
-    if (auto binaryExpr = dynamic_cast<ast::BinaryExpr*>(expr.get())) {
+    if (auto binaryExpr = ast::dyn_cast<ast::BinaryExpr>(expr.get())) {
         if (binaryExpr->op.type == lexer::TokenType::EQUAL || 
             binaryExpr->op.type == lexer::TokenType::NOT_EQUAL) {
             
@@ -566,12 +566,12 @@ bool NullSafetyUtils::isSafeCall(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check for safe call expressions (x?.method())
-    if (dynamic_cast<ast::CallExpr*>(expr.get())) {
+    if (ast::dyn_cast<ast::CallExpr>(expr.get())) {
         return false;
     }
     
     // Check for safe property access (x?.property)
-    if (dynamic_cast<ast::GetExpr*>(expr.get())) {
+    if (ast::dyn_cast<ast::GetExpr>(expr.get())) {
         return false;
     }
     
@@ -677,7 +677,7 @@ bool NullSafetyFlowAnalyzer::analyzeFlow(ast::StmtPtr stmt) {
         // Analyze control flow for null safety
         
         // Handle variable declarations
-        if (auto varDecl = std::dynamic_pointer_cast<ast::VariableStmt>(stmt)) {
+        if (auto *varDecl = ast::dyn_cast<ast::VariableStmt>(stmt)) {
             addVariable(varDecl->name);
             if (varDecl->initializer) {
                 if (NullSafetyUtils::isNullLiteral(varDecl->initializer)) {
@@ -691,7 +691,7 @@ bool NullSafetyFlowAnalyzer::analyzeFlow(ast::StmtPtr stmt) {
         }
         
         // Handle if statements with null checks
-        if (auto ifStmt = std::dynamic_pointer_cast<ast::IfStmt>(stmt)) {
+        if (auto *ifStmt = ast::dyn_cast<ast::IfStmt>(stmt)) {
             if (ifStmt->condition) {
                 analyzeConditionalFlow(ifStmt->condition, ifStmt->thenBranch, ifStmt->elseBranch);
             }
@@ -723,7 +723,7 @@ bool NullSafetyFlowAnalyzer::analyzeConditionalFlow(ast::ExprPtr condition, ast:
         if (!condition) return true;
         
         // Check if condition is a null check (x == null or x != null)
-        if (auto binaryExpr = std::dynamic_pointer_cast<ast::BinaryExpr>(condition)) {
+        if (auto *binaryExpr = ast::dyn_cast<ast::BinaryExpr>(condition)) {
             bool isNullCheck = false;
             bool isNullEqual = false;
             std::string varName;
@@ -853,12 +853,12 @@ std::string NullSafetyFlowAnalyzer::getVariableName(ast::ExprPtr expr) {
     if (!expr) return "";
     
     // Extract variable name from expression
-    if (auto varExpr = std::dynamic_pointer_cast<ast::VariableExpr>(expr)) {
+    if (auto *varExpr = ast::dyn_cast<ast::VariableExpr>(expr)) {
         return varExpr->name;
     }
     
     // Check for property access (obj.prop)
-    if (auto getExpr = std::dynamic_pointer_cast<ast::GetExpr>(expr)) {
+    if (auto *getExpr = ast::dyn_cast<ast::GetExpr>(expr)) {
         return getVariableName(getExpr->object);
     }
     
@@ -320,12 +320,12 @@ std::string OwnershipChecker::getVariableName(ast::ExprPtr expr) {
     if (!expr) return "";
     
     // Extract variable name from expression
-    if (auto varExpr = std::dynamic_pointer_cast<ast::VariableExpr>(expr)) {
+    if (auto *varExpr = ast::dyn_cast<ast::VariableExpr>(expr)) {
         return varExpr->name;
     }
     
     // Check for property access (obj.prop)
-    if (auto getExpr = std::dynamic_pointer_cast<ast::GetExpr>(expr)) {
+    if (auto *getExpr = ast::dyn_cast<ast::GetExpr>(expr)) {
         return getVariableName(getExpr->object);
     }
     
@@ -338,12 +338,12 @@ bool OwnershipChecker::isVariableExpression(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check if expression is a variable reference
-    if (std::dynamic_pointer_cast<ast::VariableExpr>(expr)) {
+    if (ast::isa<ast::VariableExpr>(expr)) {
         return true;
     }
     
     // Check for property access
-    if (std::dynamic_pointer_cast<ast::GetExpr>(expr)) {
+    if (ast::isa<ast::GetExpr>(expr)) {
         return true;
     }
     
@@ -356,7 +356,7 @@ bool OwnershipChecker::isAssignmentExpression(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check if expression is an assignment
-    if (std::dynamic_pointer_cast<ast::AssignExpr>(expr)) {
+    if (ast::isa<ast::AssignExpr>(expr)) {
         return true;
     }
     
@@ -367,7 +367,7 @@ bool OwnershipChecker::isFunctionCall(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check if expression is a function call
-    if (std::dynamic_pointer_cast<ast::CallExpr>(expr)) {
+    if (ast::isa<ast::CallExpr>(expr)) {
         return true;
     }
     
@@ -394,7 +394,7 @@ bool OwnershipUtils::isMoveExpression(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check for move expressions (move x)
-    if (auto unaryExpr = std::dynamic_pointer_cast<ast::UnaryExpr>(expr)) {
+    if (auto *unaryExpr = ast::dyn_cast<ast::UnaryExpr>(expr)) {
         if (unaryExpr->op.type == lexer::TokenType::MOVE) {
             return true;
         }
@@ -407,7 +407,7 @@ bool OwnershipUtils::isBorrowExpression(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check for borrow expressions (&x, &mut x)
-    if (auto unaryExpr = std::dynamic_pointer_cast<ast::UnaryExpr>(expr)) {
+    if (auto *unaryExpr = ast::dyn_cast<ast::UnaryExpr>(expr)) {
         if (unaryExpr->op.type == lexer::TokenType::BORROW || 
             unaryExpr->op.type == lexer::TokenType::MUTABLE_BORROW) {
             return true;
@@ -421,7 +421,7 @@ bool OwnershipUtils::isMutableBorrowExpression(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check for mutable borrow expressions (&mut x)
-    if (auto unaryExpr = std::dynamic_pointer_cast<ast::UnaryExpr>(expr)) {
+    if (auto *unaryExpr = ast::dyn_cast<ast::UnaryExpr>(expr)) {
         if (unaryExpr->op.type == lexer::TokenType::MUTABLE_BORROW) {
             return true;
         }
@@ -434,7 +434,7 @@ bool OwnershipUtils::isImmutableBorrowExpression(ast::ExprPtr expr) {
     if (!expr) return false;
     
     // Check for immutable borrow expressions (&x)
-    if (auto unaryExpr = std::dynamic_pointer_cast<ast::UnaryExpr>(expr)) {
+    if (auto *unaryExpr = ast::dyn_cast<ast::UnaryExpr>(expr)) {
         if (unaryExpr->op.type == lexer::TokenType::BORROW) {
             return true;
         }
@@ -498,7 +498,7 @@ ast::TypePtr OwnershipUtils::makeOwnedType(ast::TypePtr type) {
         typeStr = typeStr.substr(typeStr.find(" ") + 1);
     }
     
-    return std::make_shared<ast::SimpleType>(
+    return ast::make<ast::SimpleType>(
         lexer::Token(lexer::TokenType::IDENTIFIER, typeStr, "", 0, 0));
 }
 
@@ -514,7 +514,7 @@ ast::TypePtr OwnershipUtils::makeBorrowedType(ast::TypePtr type, bool isMutable)
         typeStr = "&" + typeStr;
     }
     
-    return std::make_shared<ast::SimpleType>(
+    return ast::make<ast::SimpleType>(
         lexer::Token(lexer::TokenType::IDENTIFIER, typeStr, "", 0, 0));
 }
 
@@ -1,5 +1,11 @@
 #include "type_checker.h"
+#include "../lexer/symbol_table.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include "builtin_names.h"
 #include "result_option.h"
@@ -9,66 +15,131 @@ namespace type_checker
     // ---------------------------------------------------------------------------
     // Environment
     // ---------------------------------------------------------------------------
-    void Environment::define(const std::string &name, ast::TypePtr type, bool isConstant)
+    void Environment::pushScope()
     {
-        variables_[name] = std::make_pair(type, isConstant);
+        marks_.push_back(undo_.size());
     }
 
-    ast::TypePtr Environment::lookup(const std::string &name) const
+    void Environment::popScope()
     {
-        auto it = variables_.find(name);
-        if (it != variables_.end())
+        if (marks_.empty())
+            return;
+        const uint32_t d = depth();
+        for (size_t i = undo_.size(); i > marks_.back(); --i)
         {
-            return it->second.first;
+            auto it = bindings_.find(undo_[i - 1]);
+            if (it->second.back().depth == d)
+                it->second.pop_back();
         }
-        if (parent_)
+        undo_.resize(marks_.back());
+        marks_.pop_back();
+    }
+
+    void Environment::define(const std::string &name, ast::TypePtr type, bool isConstant)
+    {
+        const uint32_t id = lexer::SymbolTable::intern(name).id;
+        auto &stack = bindings_[id];
+        ++generation_;
+        if (!stack.empty() && stack.back().depth == depth())
         {
-            return parent_->lookup(name);
+            stack.back() = Binding{std::move(type), isConstant, depth()};
+            return;
         }
-        return nullptr;
+        stack.push_back(Binding{std::move(type), isConstant, depth()});
+        if (!atGlobalScope())
+            undo_.push_back(id);
+    }
+
+    void Environment::defineGlobal(const std::string &name, ast::TypePtr type, bool isConstant)
+    {
+        auto &stack = bindings_[lexer::SymbolTable::intern(name).id];
+        ++generation_;
+        if (!stack.empty() && stack.front().depth == 0)
+            stack.front() = Binding{std::move(type), isConstant, 0};
+        else
+            stack.insert(stack.begin(), Binding{std::move(type), isConstant, 0});
+    }
+
+    const Environment::Binding *Environment::find(const std::string &name) const
+    {
+        auto it = bindings_.find(lexer::SymbolTable::intern(name).id);
+        if (it == bindings_.end() || it->second.empty())
+            return globals_ ? globals_->find(name) : nullptr;
+        return &it->second.back();
+    }
+
+    ast::TypePtr Environment::lookup(const std::string &name) const
+    {
+        const Binding *b = find(name);
+        return b ? b->type : nullptr;
+    }
+
+    ast::TypePtr Environment::lookupGlobal(const std::string &name) const
+    {
+        auto it = bindings_.find(lexer::SymbolTable::intern(name).id);
+        if (it == bindings_.end() || it->second.empty() || it->second.front().depth != 0)
+            return globals_ ? globals_->lookupGlobal(name) : nullptr;
+        return it->second.front().type;
     }
 
     bool Environment::assign(const std::string &name, ast::TypePtr type)
     {
-        auto it = variables_.find(name);
-        if (it != variables_.end())
-        {
-            // Keep the original declared type; assignment doesn't change a
-            // variable's static type here. We simply confirm it exists.
-            (void)type;
-            return true;
-        }
-        if (parent_)
-        {
-            return parent_->assign(name, type);
-        }
-        return false;
+        // Keep the original declared type; assignment doesn't change a
+        // variable's static type here. We simply confirm it exists.
+        (void)type;
+        return find(name) != nullptr;
     }
 
     void Environment::collectNames(std::vector<std::string> &out) const
     {
-        for (const auto &kv : variables_)
-            out.push_back(kv.first);
-        if (parent_)
-            parent_->collectNames(out);
+        for (const auto &kv : bindings_)
+            if (!kv.second.empty())
+                out.emplace_back(lexer::SymbolTable::text(kv.first));
+        if (globals_)
+            globals_->collectNames(out);
     }
 
     bool Environment::isConstant(const std::string &name) const
     {
-        auto it = variables_.find(name);
-        if (it != variables_.end())
-            return it->second.second;
-        if (parent_)
-            return parent_->isConstant(name);
-        return false;
+        const Binding *b = find(name);
+        return b && b->isConstant;
     }
 
     // ---------------------------------------------------------------------------
     // Small type helpers
     // ---------------------------------------------------------------------------
+
+    // SIMD vector types are named f64x4, i32x8, ... and comparisons on them give
+    // maskN. Returns the lane count of such a type, or 0.
+    static int simdLanes(const ast::TypePtr &t, bool *isMask = nullptr)
+    {
+        if (!t || !std::dynamic_pointer_cast<ast::SimpleType>(t))
+            return 0;
+        static const std::unordered_map<std::string, int> lanes = {
+            {"f64x2", 2}, {"f64x4", 4}, {"f32x4", 4}, {"f32x8", 8},
+            {"i64x2", 2}, {"i64x4", 4}, {"i32x4", 4}, {"i32x8", 8},
+            {"mask2", 2}, {"mask4", 4}, {"mask8", 8},
+        };
+        auto it = lanes.find(t->toString());
+        if (it == lanes.end())
+            return 0;
+        if (isMask)
+            *isMask = t->toString()[0] == 'm';
+        return it->second;
+    }
+
+    static ast::TypePtr makeSimple(const std::string &name)
+    {
+        return ast::make<ast::SimpleType>(
+            lexer::Token(lexer::TokenType::IDENTIFIER, name, "", 0, 0));
+    }
+
     ast::TypePtr TypeChecker::makeBasic(ast::TypeKind kind) const
     {
-        return std::make_shared<ast::BasicType>(kind);
+        ast::TypePtr &basic = basicTypes_[static_cast<size_t>(kind)];
+        if (!basic)
+            basic = ast::make<ast::BasicType>(kind);
+        return basic;
     }
 
     bool TypeChecker::isUnknown(ast::TypePtr type) const
@@ -120,25 +191,26 @@ namespace type_checker
         return k == ast::TypeKind::INT || k == ast::TypeKind::FLOAT;
     }
 
-    // Structural equality usable for BasicType (whose equals() is identity-based).
-    bool TypeChecker::sameType(ast::TypePtr a, ast::TypePtr b) const
+    const ast::Type *TypeChecker::intern(const ast::TypePtr &type) const
     {
-        if (!a || !b)
-            return false;
-        a = canonicalize(a);
-        b = canonicalize(b);
-
-        auto ab = std::dynamic_pointer_cast<ast::BasicType>(a);
-        auto bb = std::dynamic_pointer_cast<ast::BasicType>(b);
-        if (ab && bb)
-            return ab->getKind() == bb->getKind();
+        if (!type)
+            return nullptr;
+        auto it = internedTypes_.find(type.get());
+        if (it != internedTypes_.end())
+            return it->second.second;
+        // The spelling identifies a type: structurally equal types print the
+        // same, and SimpleType/ClassType names compare by name.
+        ast::TypePtr c = canonicalize(type);
+        const ast::Type *id = typesBySpelling_.emplace(c->toString(), c.get()).first->second;
+        if (c != type)
+            internedTypes_.emplace(c.get(), std::make_pair(c, id));
+        internedTypes_.emplace(type.get(), std::make_pair(type, id));
+        return id;
+    }
 
-        // Fall back to the AST's structural equals() for non-basic types
-        // (GenericType, FunctionType, etc. override it correctly).
-        if (a->equals(b))
-            return true;
-        // Last resort: compare string forms (covers SimpleType/ClassType names).
-        return a->toString() == b->toString();
+    bool TypeChecker::sameType(ast::TypePtr a, ast::TypePtr b) const
+    {
+        return a && b && intern(a) == intern(b);
     }
 
     bool TypeChecker::isUnannotatedReturn(ast::TypePtr returnType) const
@@ -171,7 +243,7 @@ namespace type_checker
         ast::TypePtr ret = (isUnannotatedReturn(fn->returnType) || fn->isGeneric())
                                ? makeBasic(ast::TypeKind::UNKNOWN)
                                : canonicalize(fn->returnType);
-        return std::make_shared<ast::FunctionType>(fn->token, std::move(paramTypes), ret, fn->isAsync);
+        return ast::make<ast::FunctionType>(fn->token, std::move(paramTypes), ret, fn->isAsync);
     }
 
     // Remove stale static consts; use ast::OptionType/ResultType toString instead
@@ -197,7 +269,7 @@ namespace type_checker
                 }
                 else
                 {
-                    errorHandler_.reportError(error::ErrorCode::T001_TYPE_MISMATCH,
+                    errorHandler_->reportError(error::ErrorCode::T001_TYPE_MISMATCH,
                                               "Array literal has inconsistent element types",
                                               std::string(expr->token.filename), expr->token.line, expr->token.column,
                                               error::ErrorSeverity::ERROR);
@@ -209,12 +281,12 @@ namespace type_checker
         if (elementType == nullptr)
         {
             // Empty array, default to int for now
-            elementType = std::make_shared<ast::SimpleType>(
+            elementType = ast::make<ast::SimpleType>(
                 lexer::Token(lexer::TokenType::IDENTIFIER, "int", "", 0, 0));
         }
 
         // Create an array type with the determined element type
-        currentType_ = std::make_shared<ast::GenericType>(
+        currentType_ = ast::make<ast::GenericType>(
             expr->token,
             "array",
             std::vector<ast::TypePtr>{elementType});
@@ -227,6 +299,16 @@ namespace type_checker
         if (expr->object) { expr->object->accept(*this); objType = currentType_; }
         if (expr->index) expr->index->accept(*this);
 
+        // v[k] on a SIMD value reads one lane.
+        bool isMask = false;
+        if (simdLanes(objType, &isMask))
+        {
+            currentType_ = makeBasic(isMask ? ast::TypeKind::BOOL
+                                     : objType->toString()[0] == 'f' ? ast::TypeKind::FLOAT
+                                                                     : ast::TypeKind::INT);
+            return;
+        }
+
         // If the object is a known array/list, the result is its element type;
         // otherwise stay permissive (UNKNOWN) so codegen handles it.
         if (auto generic = std::dynamic_pointer_cast<ast::GenericType>(objType))
@@ -238,7 +320,7 @@ namespace type_checker
                 return;
             }
         }
-        currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::UNKNOWN);
+        currentType_ = ast::make<ast::BasicType>(ast::TypeKind::UNKNOWN);
     }
 
     void TypeChecker::registerEnum(ast::EnumStmt *stmt)
@@ -246,10 +328,10 @@ namespace type_checker
         // Register the enum's name so it resolves as an identifier/type, then
         // its members. Idempotent: called from pass-1 hoisting (so forward
         // references to variants resolve) and again from visitEnumStmt.
-        auto enumType = std::make_shared<ast::SimpleType>(
+        auto enumType = ast::make<ast::SimpleType>(
             lexer::Token(lexer::TokenType::IDENTIFIER, stmt->name, "", 0, 0));
-        if (globalEnv_ && !globalEnv_->lookup(stmt->name))
-            globalEnv_->define(stmt->name, enumType, true);
+        if (!environment_.lookupGlobal(stmt->name))
+            environment_.defineGlobal(stmt->name, enumType, true);
 
         if (stmt->isAlgebraic())
         {
@@ -257,16 +339,16 @@ namespace type_checker
             // Bare nullary variants (e.g. Empty) are usable as values; variants
             // with payloads are constructed via a call, so register a permissive
             // constructor symbol for them too.
-            std::unordered_set<std::string> &variants = adtEnumVariants_[stmt->name];
+            std::unordered_set<std::string> &variants = decls_->adtEnumVariants[stmt->name];
             for (const auto &m : stmt->members)
             {
                 variants.insert(m.first);
-                adtVariantEnum_[m.first] = stmt->name;
+                decls_->adtVariantEnum[m.first] = stmt->name;
                 auto fit = stmt->variantFields.find(m.first);
                 if (fit != stmt->variantFields.end())
-                    adtVariantFields_[m.first] = fit->second;
-                if (environment_) environment_->define(m.first, enumType, true);
-                if (globalEnv_) globalEnv_->define(m.first, enumType, true);
+                    decls_->adtVariantFields[m.first] = fit->second;
+                environment_.define(m.first, enumType, true);
+                environment_.defineGlobal(m.first, enumType, true);
             }
             return;
         }
@@ -275,8 +357,8 @@ namespace type_checker
         auto intType = makeBasic(ast::TypeKind::INT);
         for (const auto &m : stmt->members)
         {
-            if (environment_) environment_->define(m.first, intType, true);
-            if (globalEnv_) globalEnv_->define(m.first, intType, true);
+            environment_.define(m.first, intType, true);
+            environment_.defineGlobal(m.first, intType, true);
         }
     }
 
@@ -300,8 +382,8 @@ namespace type_checker
         if (stmt->catchBlock)
         {
             pushScope();
-            if (environment_ && !stmt->catchVar.empty())
-                environment_->define(stmt->catchVar, makeBasic(ast::TypeKind::INT), true);
+            if (!stmt->catchVar.empty())
+                environment_.define(stmt->catchVar, makeBasic(ast::TypeKind::INT), true);
             stmt->catchBlock->accept(*this);
             popScope();
         }
@@ -351,8 +433,7 @@ namespace type_checker
         auto intType = makeBasic(ast::TypeKind::INT);
         for (const auto &n : stmt->names)
         {
-            if (environment_) environment_->define(n, intType, stmt->isConst);
-            if (globalEnv_ && environment_ == globalEnv_) globalEnv_->define(n, intType, stmt->isConst);
+            environment_.define(n, intType, stmt->isConst);
         }
         currentType_ = nullptr;
     }
@@ -367,7 +448,7 @@ namespace type_checker
     void TypeChecker::visitGoExpr(void *expr)
     {
         (void)expr;
-        currentType_ = std::make_shared<ast::SimpleType>(lexer::Token(lexer::TokenType::IDENTIFIER, "void", "", 0, 0));
+        currentType_ = ast::make<ast::SimpleType>(lexer::Token(lexer::TokenType::IDENTIFIER, "void", "", 0, 0));
     }
 
     void TypeChecker::visitRuntimeChannelSendExpr(void *expr)
@@ -393,7 +474,7 @@ namespace type_checker
                 if (channelType && valueType) {
                     auto elementType = getChannelElementType(channelType);
                     if (elementType && !typesCompatible(valueType, elementType)) {
-                        errorHandler_.reportError(error::ErrorCode::T001_TYPE_MISMATCH,
+                        errorHandler_->reportError(error::ErrorCode::T001_TYPE_MISMATCH,
                                                 "Cannot send value of type " + valueType->toString() + 
                                                 " to channel of type " + channelType->toString());
                     }
@@ -402,7 +483,7 @@ namespace type_checker
         }
         
         // Channel send returns void
-        currentType_ = std::make_shared<ast::SimpleType>(
+        currentType_ = ast::make<ast::SimpleType>(
             lexer::Token(lexer::TokenType::IDENTIFIER, "void", "", 0, 0));
     }
 
@@ -448,7 +529,7 @@ namespace type_checker
         }
         
         // Select statement returns void
-        currentType_ = std::make_shared<ast::SimpleType>(
+        currentType_ = ast::make<ast::SimpleType>(
             lexer::Token(lexer::TokenType::IDENTIFIER, "void", "", 0, 0));
     }
 
@@ -460,7 +541,7 @@ namespace type_checker
         if (expr->value) expr->value->accept(*this);
         
         // Channel send returns void
-        currentType_ = std::make_shared<ast::SimpleType>(
+        currentType_ = ast::make<ast::SimpleType>(
             lexer::Token(lexer::TokenType::IDENTIFIER, "void", "", 0, 0));
     }
 
@@ -491,8 +572,8 @@ namespace type_checker
             pushScope();
             if (!c.isDefault && c.channel)
                 c.channel->accept(*this);
-            if (environment_ && !c.bindName.empty())
-                environment_->define(c.bindName, makeBasic(ast::TypeKind::INT), false);
+            if (!c.bindName.empty())
+                environment_.define(c.bindName, makeBasic(ast::TypeKind::INT), false);
             if (c.body)
                 c.body->accept(*this);
             popScope();
@@ -510,18 +591,26 @@ namespace type_checker
             return true;
         }
 
-        // Canonicalize named primitives so e.g. SimpleType("int") unifies with
-        // BasicType(INT).
-        from = canonicalize(from);
-        to = canonicalize(to);
-
-        // Same type is always assignable (use structural comparison since
-        // BasicType::equals is identity-based).
-        if (sameType(from, to))
+        // Same type is always assignable. Interning unifies named primitives
+        // with BasicType, e.g. SimpleType("int") with BasicType(INT).
+        const auto key = std::make_pair(intern(from), intern(to));
+        if (key.first == key.second)
         {
             return true;
         }
+        auto cached = assignable_.find(key);
+        if (cached != assignable_.end())
+        {
+            return cached->second;
+        }
+        const bool result = isConvertible(canonicalize(from), canonicalize(to));
+        assignable_.emplace(key, result);
+        return result;
+    }
 
+    // isAssignable for two distinct, known types.
+    bool TypeChecker::isConvertible(ast::TypePtr from, ast::TypePtr to)
+    {
         // Handle basic type conversions
         if (auto fromBasic = std::dynamic_pointer_cast<ast::BasicType>(from))
         {
@@ -533,6 +622,13 @@ namespace type_checker
                     return true;
                 }
             }
+            // A scalar is splatted into every lane of a SIMD vector (not a mask).
+            bool toMask = false;
+            if (simdLanes(to, &toMask) && !toMask &&
+                (fromBasic->getKind() == ast::TypeKind::INT || fromBasic->getKind() == ast::TypeKind::FLOAT))
+            {
+                return true;
+            }
         }
 
         // Handle generic types
@@ -563,13 +659,21 @@ namespace type_checker
 
     // Constructor for TypeChecker
     TypeChecker::TypeChecker(error::ErrorHandler &errorHandler, tocin::compiler::CompilationContext &context, FeatureManager *featureManager)
-        : errorHandler_(errorHandler), compilationContext_(context), featureManager_(featureManager)
+        : errorHandler_(&errorHandler), compilationContext_(context), featureManager_(featureManager)
     {
-        globalEnv_ = std::make_shared<Environment>();
-        environment_ = globalEnv_;
         registerBuiltins();
     }
 
+    // A worker of a parallel check: shares the parent's declarations and
+    // resolves globals through a snapshot of its global scope.
+    TypeChecker::TypeChecker(const TypeChecker &parent, error::ErrorHandler &diagnostics,
+                             std::shared_ptr<const Environment> globals)
+        : environment_(std::move(globals)), errorHandler_(&diagnostics),
+          compilationContext_(parent.compilationContext_), featureManager_(parent.featureManager_),
+          currentModuleName_(parent.currentModuleName_), checkDepth_(1), decls_(parent.decls_)
+    {
+    }
+
     void TypeChecker::registerBuiltins()
     {
         // Register every compiler builtin (the full registry shared with codegen)
@@ -578,13 +682,13 @@ namespace type_checker
         // registry resolve, everything else is an error.
         lexer::Token tok(lexer::TokenType::IDENTIFIER, "", "", 0, 0);
         auto builtinFn = [&]() {
-            return std::make_shared<ast::FunctionType>(
+            return ast::make<ast::FunctionType>(
                 tok, std::vector<ast::TypePtr>{}, makeBasic(ast::TypeKind::UNKNOWN), false);
         };
         for (const auto &entry : builtinArities())
         {
-            if (!globalEnv_->lookup(entry.first))
-                globalEnv_->define(entry.first, builtinFn(), false);
+            if (!environment_.lookupGlobal(entry.first))
+                environment_.defineGlobal(entry.first, builtinFn(), false);
         }
     }
 
@@ -593,47 +697,47 @@ namespace type_checker
     {
         if (!stmt)
             return;
-        if (auto fn = dynamic_cast<ast::FunctionStmt *>(stmt))
+        if (auto fn = ast::dyn_cast<ast::FunctionStmt>(stmt))
         {
-            globalEnv_->define(fn->name, functionTypeOf(fn), true);
+            environment_.defineGlobal(fn->name, functionTypeOf(fn), true);
             if (!fn->parameters.empty() && fn->parameters.back().isVariadic)
-                variadicFns_.insert(fn->name);
+                decls_->variadicFns.insert(fn->name);
             // Minimum required args = params with no default (defaults are
             // trailing). Callers may omit the defaulted ones.
             size_t minArgs = 0;
             for (const auto &p : fn->parameters)
                 if (!p.defaultValue) minArgs++;
-            fnMinArgs_[fn->name] = minArgs;
+            decls_->fnMinArgs[fn->name] = minArgs;
         }
-        else if (auto cls = dynamic_cast<ast::ClassStmt *>(stmt))
+        else if (auto cls = ast::dyn_cast<ast::ClassStmt>(stmt))
         {
             // Register the class name as a class type so references resolve and
             // constructor-style calls don't error.
-            globalEnv_->define(cls->name,
-                               std::make_shared<ast::ClassType>(cls->token, cls->name), true);
+            environment_.defineGlobal(cls->name,
+                                      ast::make<ast::ClassType>(cls->token, cls->name), true);
         }
-        else if (auto en = dynamic_cast<ast::EnumStmt *>(stmt))
+        else if (auto en = ast::dyn_cast<ast::EnumStmt>(stmt))
         {
             // Enum members/variants must resolve even when used before the enum
             // declaration in program order.
             registerEnum(en);
         }
-        else if (auto mod = dynamic_cast<ast::ModuleStmt *>(stmt))
+        else if (auto mod = ast::dyn_cast<ast::ModuleStmt>(stmt))
         {
             // `module m { ... }`: the module name is legal in identifier position
             // (qualified access `m.f(...)`), and its members are global.
-            knownModules_.insert(mod->name);
+            decls_->knownModules.insert(mod->name);
             // Dotted module names (module net.http) make each prefix legal too.
             std::string prefix;
             for (char c : mod->name)
             {
-                if (c == '.') { knownModules_.insert(prefix); }
+                if (c == '.') { decls_->knownModules.insert(prefix); }
                 prefix += c;
             }
             for (auto &s : mod->body)
                 hoistDeclaration(s.get());
         }
-        else if (auto imp = dynamic_cast<ast::ImportStmt *>(stmt))
+        else if (auto imp = ast::dyn_cast<ast::ImportStmt>(stmt))
         {
             // Imports are merged before checking, but an unresolved import can
             // survive to this point; keep its name legal so the (already
@@ -641,11 +745,11 @@ namespace type_checker
             std::string prefix;
             for (char c : imp->moduleName)
             {
-                if (c == '.') { knownModules_.insert(prefix); }
+                if (c == '.') { decls_->knownModules.insert(prefix); }
                 prefix += c;
             }
             if (!prefix.empty())
-                knownModules_.insert(prefix);
+                decls_->knownModules.insert(prefix);
         }
     }
 
@@ -654,12 +758,12 @@ namespace type_checker
     {
         // PASS 1: hoist top-level function/class names so forward and
         // mutually-recursive references resolve during body checking.
-        if (auto block = dynamic_cast<ast::BlockStmt *>(root))
+        if (auto block = ast::dyn_cast<ast::BlockStmt>(root))
         {
             for (auto &s : block->statements)
                 hoistDeclaration(s.get());
         }
-        else if (auto mod = dynamic_cast<ast::ModuleStmt *>(root))
+        else if (auto mod = ast::dyn_cast<ast::ModuleStmt>(root))
         {
             for (auto &s : mod->body)
                 hoistDeclaration(s.get());
@@ -673,9 +777,143 @@ namespace type_checker
 
         // PASS 2: check bodies. Mark that the next block/module is the program
         // root so its direct children live in the global scope.
+        std::vector<Segment> segments;
+        error::ErrorHandler *out = errorHandler_;
+        if (jobs_ > 1)
+            segments_ = &segments;
+        std::exception_ptr failure;
         atProgramRoot_ = true;
-        root->accept(*this);
+        try
+        {
+            root->accept(*this);
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+        }
         atProgramRoot_ = false;
+        segments_ = nullptr;
+        errorHandler_ = out;
+        checkDeferred(segments);
+        if (failure)
+            std::rethrow_exception(failure);
+    }
+
+    // A body that declares an enum or a module changes what later statements
+    // see, so it has to be checked in order.
+    static bool declaresGlobals(const ast::Statement *stmt)
+    {
+        if (!stmt)
+            return false;
+        if (ast::isa<ast::EnumStmt>(stmt) || ast::isa<ast::ModuleStmt>(stmt))
+            return true;
+        auto any = [](const std::vector<ast::StmtPtr> &stmts) {
+            for (const auto &s : stmts)
+                if (declaresGlobals(s.get()))
+                    return true;
+            return false;
+        };
+        if (auto block = ast::dyn_cast<ast::BlockStmt>(stmt))
+            return any(block->statements);
+        if (auto ifStmt = ast::dyn_cast<ast::IfStmt>(stmt))
+        {
+            for (const auto &elif : ifStmt->elifBranches)
+                if (declaresGlobals(elif.second.get()))
+                    return true;
+            return declaresGlobals(ifStmt->thenBranch.get()) ||
+                   declaresGlobals(ifStmt->elseBranch.get());
+        }
+        if (auto whileStmt = ast::dyn_cast<ast::WhileStmt>(stmt))
+            return declaresGlobals(whileStmt->body.get());
+        if (auto forStmt = ast::dyn_cast<ast::ForStmt>(stmt))
+            return declaresGlobals(forStmt->body.get());
+        if (auto fn = ast::dyn_cast<ast::FunctionStmt>(stmt))
+            return declaresGlobals(fn->body.get());
+        if (auto cls = ast::dyn_cast<ast::ClassStmt>(stmt))
+            return any(cls->methods);
+        if (auto tryStmt = ast::dyn_cast<ast::TryStmt>(stmt))
+            return declaresGlobals(tryStmt->tryBlock.get()) ||
+                   declaresGlobals(tryStmt->catchBlock.get()) ||
+                   declaresGlobals(tryStmt->finallyBlock.get());
+        if (auto match = ast::dyn_cast<ast::MatchStmt>(stmt))
+        {
+            for (const auto &c : match->cases)
+                if (declaresGlobals(c.second.get()))
+                    return true;
+            return declaresGlobals(match->defaultCase.get());
+        }
+        if (auto select = ast::dyn_cast<ast::SelectStmt>(stmt))
+        {
+            for (const auto &c : select->cases)
+                if (declaresGlobals(c.body.get()))
+                    return true;
+            return false;
+        }
+        if (auto defer = ast::dyn_cast<ast::DeferStmt>(stmt))
+            return declaresGlobals(defer->body.get());
+        return false;
+    }
+
+    void TypeChecker::checkTopLevel(ast::Statement *stmt)
+    {
+        if (!segments_ || !environment_.atGlobalScope())
+        {
+            stmt->accept(*this);
+            return;
+        }
+        auto *fn = ast::dyn_cast<ast::FunctionStmt>(stmt);
+        const bool deferred = fn && !declaresGlobals(fn->body.get());
+        if (deferred || segments_->empty() || segments_->back().fn)
+        {
+            auto buffer = std::make_unique<error::ErrorHandler>(errorHandler_->filename());
+            buffer->setBuffered(true);
+            std::shared_ptr<const Environment> globals;
+            if (deferred)
+            {
+                // Consecutive functions with no global definition between
+                // them share one snapshot.
+                if (!globalsSnapshot_ || globalsSnapshot_->generation() != environment_.generation())
+                    globalsSnapshot_ = std::make_shared<const Environment>(environment_);
+                globals = globalsSnapshot_;
+            }
+            segments_->push_back(Segment{deferred ? fn : nullptr, std::move(globals), std::move(buffer)});
+        }
+        if (deferred)
+            return;
+        errorHandler_ = segments_->back().diagnostics.get();
+        stmt->accept(*this);
+    }
+
+    void TypeChecker::checkDeferred(std::vector<Segment> &segments)
+    {
+        std::vector<Segment *> deferred;
+        for (auto &segment : segments)
+            if (segment.fn)
+                deferred.push_back(&segment);
+        std::atomic<size_t> next{0};
+        auto worker = [&] {
+            for (size_t i; (i = next.fetch_add(1)) < deferred.size();)
+            {
+                TypeChecker checker(*this, *deferred[i]->diagnostics, deferred[i]->globals);
+                try
+                {
+                    deferred[i]->fn->accept(checker);
+                }
+                catch (const std::exception &)
+                {
+                    // As in check(): stop checking this body, report nothing.
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < std::min<size_t>(jobs_, deferred.size()); ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto &thread : threads)
+            thread.join();
+
+        for (auto &segment : segments)
+            segment.diagnostics->replay(*errorHandler_);
     }
 
     // Check method for type checking statements
@@ -716,23 +954,23 @@ namespace type_checker
         switch (expr->literalType)
         {
         case ast::LiteralExpr::LiteralType::INTEGER:
-            currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::INT);
+            currentType_ = ast::make<ast::BasicType>(ast::TypeKind::INT);
             break;
         case ast::LiteralExpr::LiteralType::FLOAT:
-            currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::FLOAT);
+            currentType_ = ast::make<ast::BasicType>(ast::TypeKind::FLOAT);
             break;
         case ast::LiteralExpr::LiteralType::BOOLEAN:
-            currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::BOOL);
+            currentType_ = ast::make<ast::BasicType>(ast::TypeKind::BOOL);
             break;
         case ast::LiteralExpr::LiteralType::STRING:
-            currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::STRING);
+            currentType_ = ast::make<ast::BasicType>(ast::TypeKind::STRING);
             break;
         case ast::LiteralExpr::LiteralType::NIL:
             // nil's type is unknown here; stay permissive.
-            currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::UNKNOWN);
+            currentType_ = ast::make<ast::BasicType>(ast::TypeKind::UNKNOWN);
             break;
         default:
-            currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::UNKNOWN);
+            currentType_ = ast::make<ast::BasicType>(ast::TypeKind::UNKNOWN);
             break;
         }
     }
@@ -775,25 +1013,25 @@ namespace type_checker
 
         // Confirm the target exists (for simple variable assignments). We don't
         // error on unknown targets to stay permissive.
-        if (expr->isVariableAssignment() && environment_)
+        if (expr->isVariableAssignment())
         {
             // A `const` binding may not be reassigned. Fatal: this is a
             // correctness guarantee, not a style hint.
-            if (environment_->isConstant(expr->name))
+            if (environment_.isConstant(expr->name))
             {
-                errorHandler_.reportError(
+                errorHandler_->reportError(
                     error::ErrorCode::T013_INVALID_ASSIGNMENT,
                     "Cannot assign to constant '" + expr->name +
                         "' (declared with `const`). Use `let` for a mutable binding.",
                     std::string(expr->token.filename), expr->token.line,
                     expr->token.column, error::ErrorSeverity::FATAL);
             }
-            if (!environment_->assign(expr->name, valueType))
+            if (!environment_.assign(expr->name, valueType))
             {
                 // Assignment does not auto-declare in Tocin (codegen requires an
                 // existing slot); report it here, with a location, instead of
                 // letting codegen fail later with a location-less error.
-                errorHandler_.reportError(
+                errorHandler_->reportError(
                     error::ErrorCode::T002_UNDEFINED_VARIABLE,
                     "Assignment to undeclared variable '" + expr->name +
                         "'. Declare it first: `let " + expr->name + " = ...;`",
@@ -820,21 +1058,23 @@ namespace type_checker
             expr->callee->accept(*this);
             calleeType = currentType_;
         }
+        std::vector<ast::TypePtr> argTypes;
         for (auto &arg : expr->arguments)
         {
             if (arg)
                 arg->accept(*this);
+            argTypes.push_back(arg ? currentType_ : nullptr);
         }
 
         // Algebraic-enum variant constructor: Circle(r)/Rect(w, h) builds a value
         // of the enum. It is not a function, so adopt the enum type and return
         // before the not-callable diagnostic below.
-        if (auto var = std::dynamic_pointer_cast<ast::VariableExpr>(expr->callee))
+        if (auto *var = ast::dyn_cast<ast::VariableExpr>(expr->callee))
         {
-            auto av = adtVariantEnum_.find(var->name);
-            if (av != adtVariantEnum_.end())
+            auto av = decls_->adtVariantEnum.find(var->name);
+            if (av != decls_->adtVariantEnum.end())
             {
-                currentType_ = std::make_shared<ast::SimpleType>(
+                currentType_ = ast::make<ast::SimpleType>(
                     lexer::Token(lexer::TokenType::IDENTIFIER, av->second, "", 0, 0));
                 return;
             }
@@ -852,14 +1092,14 @@ namespace type_checker
                     std::string counts;
                     for (int c : allowed)
                         counts += (counts.empty() ? "" : " or ") + std::to_string(c);
-                    errorHandler_.reportError(
+                    errorHandler_->reportError(
                         error::ErrorCode::T007_INVALID_FUNCTION_CALL,
                         "Builtin '" + var->name + "' expects " + counts +
                             " argument(s), got " + std::to_string(expr->arguments.size()),
                         std::string(expr->token.filename), expr->token.line,
                         expr->token.column, error::ErrorSeverity::ERROR);
                 }
-                currentType_ = makeBasic(ast::TypeKind::UNKNOWN);
+                currentType_ = simdBuiltinType(var->name, argTypes);
                 return;
             }
         }
@@ -874,18 +1114,18 @@ namespace type_checker
             size_t nArgs = expr->arguments.size();
             bool variadic = false;
             std::string calleeName;
-            if (auto var = std::dynamic_pointer_cast<ast::VariableExpr>(expr->callee))
+            if (auto *var = ast::dyn_cast<ast::VariableExpr>(expr->callee))
             {
                 calleeName = var->name;
-                variadic = variadicFns_.count(var->name) > 0;
+                variadic = decls_->variadicFns.count(var->name) > 0;
             }
             // Defaulted trailing params make some args optional: accept any
             // count in [minArgs, nParams] (or >= minArgs for variadic).
             size_t minArgs = nParams;
             if (!calleeName.empty())
             {
-                auto mit = fnMinArgs_.find(calleeName);
-                if (mit != fnMinArgs_.end()) minArgs = mit->second;
+                auto mit = decls_->fnMinArgs.find(calleeName);
+                if (mit != decls_->fnMinArgs.end()) minArgs = mit->second;
             }
             bool arityOk = variadic ? (nArgs + 1 >= minArgs)
                                     : (nArgs >= minArgs && nArgs <= nParams);
@@ -896,7 +1136,7 @@ namespace type_checker
                                            : (minArgs == nParams
                                                   ? std::to_string(nParams)
                                                   : std::to_string(minArgs) + " to " + std::to_string(nParams));
-                errorHandler_.reportError(
+                errorHandler_->reportError(
                     error::ErrorCode::T007_INVALID_FUNCTION_CALL,
                     "Function " +
                         (calleeName.empty() ? "" : "'" + calleeName + "' ") +
@@ -916,9 +1156,9 @@ namespace type_checker
             !std::dynamic_pointer_cast<ast::ClassType>(calleeType))
         {
             // Only report when we have a precise callee identity (a bare name).
-            if (auto var = std::dynamic_pointer_cast<ast::VariableExpr>(expr->callee))
+            if (auto *var = ast::dyn_cast<ast::VariableExpr>(expr->callee))
             {
-                errorHandler_.reportError(
+                errorHandler_->reportError(
                     error::ErrorCode::T007_INVALID_FUNCTION_CALL,
                     "Cannot call '" + var->name + "' of type " + calleeType->toString() +
                         " because it is not a function",
@@ -936,27 +1176,27 @@ namespace type_checker
         if (expr->object) expr->object->accept(*this);
         // Field/method types are not tracked symbolically yet; stay permissive
         // by reporting UNKNOWN so member access never triggers false errors.
-        currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::UNKNOWN);
+        currentType_ = ast::make<ast::BasicType>(ast::TypeKind::UNKNOWN);
     }
 
     void TypeChecker::visitSetExpr(ast::SetExpr *expr)
     {
         if (expr->object) expr->object->accept(*this);
         if (expr->value) expr->value->accept(*this);
-        currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::UNKNOWN);
+        currentType_ = ast::make<ast::BasicType>(ast::TypeKind::UNKNOWN);
     }
 
     void TypeChecker::visitListExpr(ast::ListExpr *expr)
     {
         // For now, return a generic list type
-        currentType_ = std::make_shared<ast::GenericType>(
+        currentType_ = ast::make<ast::GenericType>(
             expr->token, "List", std::vector<ast::TypePtr>{});
     }
 
     void TypeChecker::visitDictionaryExpr(ast::DictionaryExpr *expr)
     {
         // For now, return a generic dictionary type
-        currentType_ = std::make_shared<ast::GenericType>(
+        currentType_ = ast::make<ast::GenericType>(
             expr->token, "Dict", std::vector<ast::TypePtr>{});
     }
 
@@ -975,7 +1215,7 @@ namespace type_checker
         else
             ret = canonicalize(expr->returnType);
 
-        currentType_ = std::make_shared<ast::FunctionType>(
+        currentType_ = ast::make<ast::FunctionType>(
             expr->token, std::move(paramTypes), ret, false);
     }
 
@@ -983,13 +1223,13 @@ namespace type_checker
     {
         if (expr->getExpr()) expr->getExpr()->accept(*this);
         // Delete expressions return void
-        currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::VOID);
+        currentType_ = ast::make<ast::BasicType>(ast::TypeKind::VOID);
     }
 
     void TypeChecker::visitStringInterpolationExpr(ast::StringInterpolationExpr *expr)
     {
         // String interpolation returns a string
-        currentType_ = std::make_shared<ast::BasicType>(ast::TypeKind::STRING);
+        currentType_ = ast::make<ast::BasicType>(ast::TypeKind::STRING);
     }
 
     void TypeChecker::visitVariableStmt(ast::VariableStmt *stmt)
@@ -1019,7 +1259,7 @@ namespace type_checker
             if (!listAnnot && initType && !isUnknown(initType) && !isUnknown(varType) &&
                 !isAssignable(initType, varType))
             {
-                errorHandler_.reportError(
+                errorHandler_->reportError(
                     error::ErrorCode::T001_TYPE_MISMATCH,
                     "Cannot initialize variable '" + stmt->name + "' of type " +
                         varType->toString() + " with value of type " + initType->toString(),
@@ -1036,8 +1276,7 @@ namespace type_checker
             varType = makeBasic(ast::TypeKind::UNKNOWN);
         }
 
-        if (environment_)
-            environment_->define(stmt->name, varType, stmt->isConstant);
+        environment_.define(stmt->name, varType, stmt->isConstant);
 
         currentType_ = nullptr;
     }
@@ -1089,13 +1328,10 @@ namespace type_checker
         if (stmt->iterable) stmt->iterable->accept(*this);
         // Introduce the loop variable in a fresh scope for the body.
         pushScope();
-        if (environment_)
-        {
-            ast::TypePtr loopVarType = stmt->variableType
-                                           ? canonicalize(stmt->variableType)
-                                           : makeBasic(ast::TypeKind::UNKNOWN);
-            environment_->define(stmt->variable, loopVarType, false);
-        }
+        ast::TypePtr loopVarType = stmt->variableType
+                                       ? canonicalize(stmt->variableType)
+                                       : makeBasic(ast::TypeKind::UNKNOWN);
+        environment_.define(stmt->variable, loopVarType, false);
         if (stmt->body) stmt->body->accept(*this);
         popScope();
         // For statements don't have a type
@@ -1106,9 +1342,9 @@ namespace type_checker
     {
         // Ensure the function name is visible (it normally is via hoisting, but
         // nested/local functions are hoisted here).
-        if (environment_ && !environment_->lookup(stmt->name))
+        if (!environment_.lookup(stmt->name))
         {
-            environment_->define(stmt->name, functionTypeOf(stmt), true);
+            environment_.define(stmt->name, functionTypeOf(stmt), true);
         }
 
         // A function body is never the "program root" block, even when this
@@ -1147,8 +1383,7 @@ namespace type_checker
 
         for (const auto &param : stmt->parameters)
         {
-            if (environment_)
-                environment_->define(param.name, resolveParamType(param.type), false);
+            environment_.define(param.name, resolveParamType(param.type), false);
         }
 
         // Determine the declared return type (if any) and set up inference.
@@ -1256,7 +1491,7 @@ namespace type_checker
             {
                 if (!isUnknown(valueType) && !isAssignable(valueType, expectedReturnType_))
                 {
-                    errorHandler_.reportError(
+                    errorHandler_->reportError(
                         error::ErrorCode::T014_INVALID_RETURN_TYPE,
                         "Return value of type " + canonicalize(valueType)->toString() +
                             " does not match declared return type " +
@@ -1271,7 +1506,7 @@ namespace type_checker
                 auto expBasic = std::dynamic_pointer_cast<ast::BasicType>(expectedReturnType_);
                 if (!(expBasic && expBasic->getKind() == ast::TypeKind::VOID))
                 {
-                    errorHandler_.reportError(
+                    errorHandler_->reportError(
                         error::ErrorCode::T014_INVALID_RETURN_TYPE,
                         "Missing return value in function declared to return " +
                             expectedReturnType_->toString(),
@@ -1287,10 +1522,10 @@ namespace type_checker
     void TypeChecker::visitClassStmt(ast::ClassStmt *stmt)
     {
         // Make the class name available as a type.
-        if (environment_ && !environment_->lookup(stmt->name))
+        if (!environment_.lookup(stmt->name))
         {
-            environment_->define(stmt->name,
-                                 std::make_shared<ast::ClassType>(stmt->token, stmt->name), true);
+            environment_.define(stmt->name,
+                                ast::make<ast::ClassType>(stmt->token, stmt->name), true);
         }
 
         // Check field declarations and methods within a class scope. For a
@@ -1306,15 +1541,12 @@ namespace type_checker
         // fields, and sibling methods - including ones declared further down.
         // Bind the receiver and pre-hoist every method name so those references
         // resolve under strict identifier checking.
-        auto selfType = std::make_shared<ast::ClassType>(stmt->token, stmt->name);
-        if (environment_)
-        {
-            environment_->define("self", selfType, true);
-            environment_->define("this", selfType, true);
-            for (auto &method : stmt->methods)
-                if (auto *fs = dynamic_cast<ast::FunctionStmt *>(method.get()))
-                    environment_->define(fs->name, functionTypeOf(fs), true);
-        }
+        auto selfType = ast::make<ast::ClassType>(stmt->token, stmt->name);
+        environment_.define("self", selfType, true);
+        environment_.define("this", selfType, true);
+        for (auto &method : stmt->methods)
+            if (auto *fs = ast::dyn_cast<ast::FunctionStmt>(method.get()))
+                environment_.define(fs->name, functionTypeOf(fs), true);
         for (auto &field : stmt->fields)
         {
             if (field)
@@ -1360,14 +1592,24 @@ namespace type_checker
         case lexer::TokenType::LESS_EQUAL:
         case lexer::TokenType::GREATER:
         case lexer::TokenType::GREATER_EQUAL:
-            currentType_ = makeBasic(ast::TypeKind::BOOL);
+            // Lane-wise on SIMD values: one mask lane per compared lane.
+            if (int n = std::max(simdLanes(leftType), simdLanes(rightType)))
+                currentType_ = makeSimple("mask" + std::to_string(n));
+            else
+                currentType_ = makeBasic(ast::TypeKind::BOOL);
             return;
 
         // Logical -> bool
         case lexer::TokenType::AND:
         case lexer::TokenType::OR:
-            currentType_ = makeBasic(ast::TypeKind::BOOL);
+        {
+            bool mask = false;
+            if (simdLanes(leftType, &mask) && mask)
+                currentType_ = leftType;
+            else
+                currentType_ = makeBasic(ast::TypeKind::BOOL);
             return;
+        }
 
         default:
             break;
@@ -1384,6 +1626,26 @@ namespace type_checker
 
         if (isArithmetic)
         {
+            // SIMD arithmetic is lane-wise; a scalar operand is splatted, two
+            // vector operands must have the same shape.
+            int lLanes = simdLanes(leftType), rLanes = simdLanes(rightType);
+            if (lLanes || rLanes)
+            {
+                if (lLanes && rLanes && leftType->toString() != rightType->toString())
+                {
+                    errorHandler_->reportError(
+                        error::ErrorCode::T001_TYPE_MISMATCH,
+                        "Operator '" + std::string(expr->op.value) + "' cannot be applied to operands of type " +
+                            leftType->toString() + " and " + rightType->toString(),
+                        std::string(expr->token.filename), expr->token.line, expr->token.column,
+                        error::ErrorSeverity::ERROR);
+                    currentType_ = makeBasic(ast::TypeKind::UNKNOWN);
+                    return;
+                }
+                currentType_ = lLanes ? leftType : rightType;
+                return;
+            }
+
             // String concatenation with '+': if either operand is a string and
             // the other is a string or unknown (e.g. a builtin like intToStr
             // whose return type the checker sees as UNKNOWN), the result is a
@@ -1413,9 +1675,9 @@ namespace type_checker
             {
                 if (!lNum || !rNum)
                 {
-                    errorHandler_.reportError(
+                    errorHandler_->reportError(
                         error::ErrorCode::T006_INVALID_OPERATOR_FOR_TYPE,
-                        "Operator '" + expr->op.value + "' cannot be applied to operands of type " +
+                        "Operator '" + std::string(expr->op.value) + "' cannot be applied to operands of type " +
                             leftType->toString() + " and " + rightType->toString(),
                         std::string(expr->token.filename), expr->token.line, expr->token.column,
                         error::ErrorSeverity::ERROR);
@@ -1486,9 +1748,7 @@ namespace type_checker
     void TypeChecker::visitVariableExpr(ast::VariableExpr *expr)
     {
         // Look up the variable/function in the current scope chain.
-        ast::TypePtr type;
-        if (environment_)
-            type = environment_->lookup(expr->name);
+        ast::TypePtr type = environment_.lookup(expr->name);
         if (type)
         {
             currentType_ = type;
@@ -1501,8 +1761,8 @@ namespace type_checker
         // prefix is reserved for compiler-synthesized helpers - the parser
         // desugars tuples/slices/generators into __tuple/__tupleGet/__slice/
         // __gen_acc calls, which are resolved by codegen, not user scope.
-        if (isBuiltinName(expr->name) || adtVariantEnum_.count(expr->name) ||
-            knownModules_.count(expr->name) ||
+        if (isBuiltinName(expr->name) || decls_->adtVariantEnum.count(expr->name) ||
+            decls_->knownModules.count(expr->name) ||
             expr->name.rfind("__", 0) == 0 ||
             expr->name == "self" || expr->name == "this" || expr->name == "_")
         {
@@ -1516,7 +1776,7 @@ namespace type_checker
         // into a precise compile-time error. `--permissive` downgrades this to
         // a non-blocking diagnostic (the driver gates on hasErrors()).
         std::string suggestion = suggestName(expr->name);
-        errorHandler_.reportError(
+        errorHandler_->reportError(
             error::ErrorCode::T002_UNDEFINED_VARIABLE,
             "Use of undeclared identifier '" + expr->name + "'" +
                 (suggestion.empty() ? "" : ". Did you mean '" + suggestion + "'?"),
@@ -1525,6 +1785,34 @@ namespace type_checker
         currentType_ = makeBasic(ast::TypeKind::UNKNOWN);
     }
 
+    ast::TypePtr TypeChecker::simdBuiltinType(const std::string &name,
+                                              const std::vector<ast::TypePtr> &args) const
+    {
+        // Constructors and loads name their result; the lane-wise helpers
+        // return their vector operand's type and the reductions a scalar.
+        auto arg = [&](size_t i) {
+            return i < args.size() && args[i] ? canonicalize(args[i]) : makeBasic(ast::TypeKind::UNKNOWN);
+        };
+        std::string shape = name.size() > 4 && name.compare(name.size() - 4, 4, "Load") == 0
+                                ? name.substr(0, name.size() - 4)
+                                : name;
+        if (simdLanes(makeSimple(shape)))
+            return makeSimple(shape);
+        if (name == "simdSelect")
+            return simdLanes(arg(1)) ? arg(1) : arg(2);
+        if (name == "simdShuffle" || name == "simdFma")
+            return arg(0);
+        if (name == "simdSum" || name == "simdMin" || name == "simdMax")
+        {
+            if (!simdLanes(arg(0)))
+                return makeBasic(ast::TypeKind::UNKNOWN);
+            return makeBasic(arg(0)->toString()[0] == 'f' ? ast::TypeKind::FLOAT : ast::TypeKind::INT);
+        }
+        if (name == "simdAny" || name == "simdAll")
+            return makeBasic(ast::TypeKind::BOOL);
+        return makeBasic(ast::TypeKind::UNKNOWN);
+    }
+
     // Bounded Levenshtein distance (early-exit above `maxD`). Small inputs only.
     static int editDistance(const std::string &a, const std::string &b, int maxD)
     {
@@ -1556,13 +1844,12 @@ namespace type_checker
         // enum variants. Threshold: 1 edit for short names, 2 for length >= 5 —
         // tight enough to avoid absurd suggestions.
         std::vector<std::string> candidates;
-        if (environment_)
-            environment_->collectNames(candidates);
+        environment_.collectNames(candidates);
         for (const auto &kv : builtinArities())
             candidates.push_back(kv.first);
-        for (const auto &m : knownModules_)
+        for (const auto &m : decls_->knownModules)
             candidates.push_back(m);
-        for (const auto &kv : adtVariantEnum_)
+        for (const auto &kv : decls_->adtVariantEnum)
             candidates.push_back(kv.first);
 
         const int maxD = name.size() >= 5 ? 2 : 1;
@@ -1601,7 +1888,9 @@ namespace type_checker
 
         for (auto &statement : stmt->statements)
         {
-            if (statement)
+            if (statement && isRoot)
+                checkTopLevel(statement.get());
+            else if (statement)
                 statement->accept(*this);
         }
 
@@ -1628,18 +1917,18 @@ namespace type_checker
         for (size_t i = 0; i < stmt->cases.size(); ++i)
         {
             pushScope();
-            if (i < stmt->caseBinds.size() && environment_)
+            if (i < stmt->caseBinds.size())
             {
                 const std::string &ctor = i < stmt->caseCtor.size() ? stmt->caseCtor[i] : "";
-                auto ff = adtVariantFields_.find(ctor);
+                auto ff = decls_->adtVariantFields.find(ctor);
                 const std::vector<std::string> &binds = stmt->caseBinds[i];
                 for (size_t fi = 0; fi < binds.size(); ++fi)
                 {
                     if (binds[fi].empty()) continue;
                     ast::TypePtr bt = intType;
-                    if (ff != adtVariantFields_.end() && fi < ff->second.size() && ff->second[fi])
+                    if (ff != decls_->adtVariantFields.end() && fi < ff->second.size() && ff->second[fi])
                         bt = ff->second[fi];
-                    environment_->define(binds[fi], bt, false);
+                    environment_.define(binds[fi], bt, false);
                 }
             }
             if (stmt->cases[i].second)
@@ -1662,8 +1951,8 @@ namespace type_checker
             std::string enumName;
             for (const auto &c : stmt->caseCtor)
             {
-                auto it = adtVariantEnum_.find(c);
-                if (it != adtVariantEnum_.end()) { enumName = it->second; break; }
+                auto it = decls_->adtVariantEnum.find(c);
+                if (it != decls_->adtVariantEnum.end()) { enumName = it->second; break; }
             }
             if (!enumName.empty())
             {
@@ -1671,7 +1960,7 @@ namespace type_checker
                 for (const auto &c : stmt->caseCtor)
                     if (!c.empty()) covered.insert(c);
                 std::vector<std::string> missing;
-                for (const auto &v : adtEnumVariants_[enumName])
+                for (const auto &v : decls_->adtEnumVariants.at(enumName))
                     if (!covered.count(v)) missing.push_back(v);
                 if (!missing.empty())
                 {
@@ -1680,7 +1969,7 @@ namespace type_checker
                         list += (i ? ", " : "") + missing[i];
                     // Fatal: a non-exhaustive match can fall through to garbage,
                     // so abort compilation rather than emit unsafe code.
-                    errorHandler_.reportError(
+                    errorHandler_->reportError(
                         error::ErrorCode::P001_NON_EXHAUSTIVE_PATTERNS,
                         "Non-exhaustive match on enum '" + enumName +
                             "': missing variant(s) " + list +
@@ -1724,7 +2013,7 @@ namespace type_checker
         for (auto &statement : stmt->body)
         {
             if (statement)
-                statement->accept(*this);
+                checkTopLevel(statement.get());
         }
 
         currentType_ = nullptr;
@@ -1746,7 +2035,7 @@ namespace type_checker
     bool TypeChecker::canRunAsGoroutine(ast::ExprPtr expr) {
         // Check if an expression can be run as a goroutine
         // For now, allow any function call
-        if (auto callExpr = std::dynamic_pointer_cast<ast::CallExpr>(expr)) {
+        if (auto *callExpr = ast::dyn_cast<ast::CallExpr>(expr)) {
             // Type check the function call
             callExpr->accept(*this);
             
@@ -1774,7 +2063,7 @@ namespace type_checker
         }
         
         // Type check the function call with arguments
-        if (auto callExpr = std::dynamic_pointer_cast<ast::CallExpr>(function)) {
+        if (auto *callExpr = ast::dyn_cast<ast::CallExpr>(function)) {
             // Verify argument types match function signature
             // This would be done during normal function call type checking
             return true;
@@ -1788,15 +2077,12 @@ namespace type_checker
         // trait's other methods resolve (the receiver's concrete type is only
         // known at impl time, so it stays UNKNOWN).
         pushScope();
-        if (environment_)
-        {
-            auto selfType = makeBasic(ast::TypeKind::UNKNOWN);
-            environment_->define("self", selfType, true);
-            environment_->define("this", selfType, true);
-            for (const auto &method : stmt->methods)
-                if (method)
-                    environment_->define(method->name, functionTypeOf(method.get()), true);
-        }
+        auto selfType = makeBasic(ast::TypeKind::UNKNOWN);
+        environment_.define("self", selfType, true);
+        environment_.define("this", selfType, true);
+        for (const auto &method : stmt->methods)
+            if (method)
+                environment_.define(method->name, functionTypeOf(method.get()), true);
         for (const auto& method : stmt->methods) {
             if (method) {
                 method->accept(*this);
@@ -1812,15 +2098,12 @@ namespace type_checker
         // Check method implementations with the receiver and sibling methods in
         // scope, mirroring visitClassStmt.
         pushScope();
-        if (environment_)
-        {
-            auto selfType = makeBasic(ast::TypeKind::UNKNOWN);
-            environment_->define("self", selfType, true);
-            environment_->define("this", selfType, true);
-            for (const auto &method : stmt->methods)
-                if (method)
-                    environment_->define(method->name, functionTypeOf(method.get()), true);
-        }
+        auto selfType = makeBasic(ast::TypeKind::UNKNOWN);
+        environment_.define("self", selfType, true);
+        environment_.define("this", selfType, true);
+        for (const auto &method : stmt->methods)
+            if (method)
+                environment_.define(method->name, functionTypeOf(method.get()), true);
         for (const auto& method : stmt->methods) {
             if (method) {
                 method->accept(*this);
@@ -1847,7 +2130,7 @@ namespace type_checker
 
     bool TypeChecker::typesCompatible(ast::TypePtr type1, ast::TypePtr type2) {
         if (!type1 || !type2) return false;
-        if (type1->equals(type2)) return true;
+        if (intern(type1) == intern(type2)) return true;
         return isAssignable(type1, type2) || isAssignable(type2, type1);
     }
 
@@ -1856,15 +2139,12 @@ namespace type_checker
     // ---------------------------------------------------------------------------
     void TypeChecker::pushScope()
     {
-        environment_ = std::make_shared<Environment>(environment_);
+        environment_.pushScope();
     }
 
     void TypeChecker::popScope()
     {
-        if (environment_ && environment_->getParent())
-        {
-            environment_ = environment_->getParent();
-        }
+        environment_.popScope();
     }
 
     ast::TypePtr TypeChecker::resolveType(ast::TypePtr type)
@@ -4,10 +4,12 @@
 #include "../ast/ast.h"
 #include "../error/error_handler.h"
 #include "feature_integration.h"
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 // Forward declaration to break circular dependency
 namespace tocin {
@@ -20,36 +22,66 @@ namespace type_checker
 {
 
     /**
-     * @brief Environment for tracking variable and function types in a scope.
+     * @brief The variable and function types visible at a point in the program.
+     *
+     * One table for the whole check rather than a chain of per-block maps:
+     * each name (interned, keyed by its SymbolTable id) maps to the stack of
+     * its live bindings, innermost last, and every binding made in an open
+     * scope is noted in an undo log. Entering a block only records the log's
+     * length; leaving it pops the bindings logged since. A lookup is one hash
+     * probe however deeply the blocks nest.
      */
     class Environment
     {
     public:
         Environment() = default;
-        explicit Environment(std::shared_ptr<Environment> parent) : parent_(parent) {}
+        // A table over `globals`: names it doesn't bind resolve there. The
+        // workers of a parallel check start from a snapshot of the global scope.
+        explicit Environment(std::shared_ptr<const Environment> globals) : globals_(std::move(globals)) {}
 
+        void pushScope();
+        // Leaves the innermost scope; the outermost (global) one never closes.
+        void popScope();
+        bool atGlobalScope() const { return marks_.empty(); }
+
+        // Bind `name` in the innermost scope, replacing a binding made there.
         void define(const std::string &name, ast::TypePtr type, bool isConstant);
+        // Bind `name` in the global scope, beneath any inner shadowing binding.
+        void defineGlobal(const std::string &name, ast::TypePtr type, bool isConstant);
         ast::TypePtr lookup(const std::string &name) const;
+        ast::TypePtr lookupGlobal(const std::string &name) const;
         bool assign(const std::string &name, ast::TypePtr type);
-        // Append every name visible from this scope (walking the parent chain)
-        // into `out` — used for "did you mean ...?" typo suggestions.
+        // Append every visible name into `out` — used for "did you mean ...?"
+        // typo suggestions.
         void collectNames(std::vector<std::string> &out) const;
-        // True if `name` resolves (through the scope chain) to a `const` binding.
+        // True if `name` resolves to a `const` binding.
         bool isConstant(const std::string &name) const;
-
-        // Add a getter for parent
-        std::shared_ptr<Environment> getParent() const { return parent_; }
+        // Bumped by every definition, so an unchanged table can be shared.
+        uint64_t generation() const { return generation_; }
 
         // Module support
         void setModule(const std::string &moduleName) { currentModule = moduleName; }
-        std::string getModule() const { return currentModule; }
+        const std::string &getModule() const { return currentModule; }
         void addExport(const std::string &name) { exportedSymbols.insert(name); }
         bool isExported(const std::string &name) const { return exportedSymbols.count(name) > 0; }
-        std::unordered_set<std::string> getExportedSymbols() const { return exportedSymbols; }
+        const std::unordered_set<std::string> &getExportedSymbols() const { return exportedSymbols; }
 
     private:
-        std::unordered_map<std::string, std::pair<ast::TypePtr, bool>> variables_;
-        std::shared_ptr<Environment> parent_;
+        struct Binding
+        {
+            ast::TypePtr type;
+            bool isConstant;
+            uint32_t depth;
+        };
+
+        const Binding *find(const std::string &name) const;
+        uint32_t depth() const { return static_cast<uint32_t>(marks_.size()); }
+
+        std::unordered_map<uint32_t, std::vector<Binding>> bindings_; // by interned name
+        std::vector<uint32_t> undo_;  // names bound in open scopes, in order
+        std::vector<size_t> marks_;   // undo_.size() at each open scope's entry
+        std::shared_ptr<const Environment> globals_;
+        uint64_t generation_ = 0;
         std::string currentModule;
         std::unordered_set<std::string> exportedSymbols;
     };
@@ -71,6 +103,15 @@ namespace type_checker
          */
         ast::TypePtr check(ast::StmtPtr stmt);
 
+        /**
+         * @brief Check top-level function bodies on up to `jobs` threads.
+         *
+         * Signatures are hoisted first, so each body depends only on the
+         * global scope as it stands at the function. Diagnostics are
+         * reported in the same order as a sequential check.
+         */
+        void setJobs(unsigned jobs) { jobs_ = jobs ? jobs : 1; }
+
         void visitBinaryExpr(ast::BinaryExpr *expr) override;
         void visitGroupingExpr(ast::GroupingExpr *expr) override;
         void visitLiteralExpr(ast::LiteralExpr *expr) override;
@@ -128,9 +169,8 @@ namespace type_checker
 
     private:
         ast::TypePtr currentType_;
-        std::shared_ptr<Environment> environment_;
-        std::shared_ptr<Environment> globalEnv_;
-        error::ErrorHandler &errorHandler_;
+        Environment environment_;
+        error::ErrorHandler *errorHandler_;
         tocin::compiler::CompilationContext &compilationContext_;
         FeatureManager *featureManager_;
         bool inAsyncContext_ = false;
@@ -140,6 +180,7 @@ namespace type_checker
         void pushScope();
         void popScope();
         bool isAssignable(ast::TypePtr from, ast::TypePtr to);
+        bool isConvertible(ast::TypePtr from, ast::TypePtr to);
         bool isMovableType(ast::TypePtr type);
         ast::TypePtr getChannelElementType(ast::TypePtr channelType);
         bool typesCompatible(ast::TypePtr type1, ast::TypePtr type2);
@@ -149,17 +190,24 @@ namespace type_checker
         // --- Real type-checker helpers (added) ---
         // Entry point that performs two-pass checking over the program root.
         void checkProgram(ast::Statement *root);
-        // Pass 1: hoist a top-level declaration (function/class) into globalEnv_.
+        // Pass 1: hoist a top-level declaration (function/class) into the global scope.
         void hoistDeclaration(ast::Statement *stmt);
-        // Convenience: build a BasicType shared_ptr.
+        // The checker's one BasicType of `kind` (shared, so compare by pointer).
         ast::TypePtr makeBasic(ast::TypeKind kind) const;
         // Map a declared/annotated type to its canonical BasicType when it names a
         // primitive (int/float/bool/string/void); otherwise returns the input.
         ast::TypePtr canonicalize(ast::TypePtr type) const;
         // Is this type a numeric (int or float) primitive?
         bool isNumeric(ast::TypePtr type) const;
-        // Structural type equality that is correct for BasicType (whose built-in
-        // equals() is pointer-identity only). Canonicalizes named primitives.
+        // Result type of a SIMD builtin call (f64x4(...), simdSum, ...), else UNKNOWN.
+        ast::TypePtr simdBuiltinType(const std::string &name,
+                                     const std::vector<ast::TypePtr> &args) const;
+        // The interned instance of a type: one per spelling after canonicalize
+        // (named primitives unify with BasicType), so two types are the same
+        // exactly when their interned pointers are equal.
+        const ast::Type *intern(const ast::TypePtr &type) const;
+        // Type equality that is correct for BasicType (whose built-in equals()
+        // is pointer-identity only): compares interned pointers.
         bool sameType(ast::TypePtr a, ast::TypePtr b) const;
         // Convenience: the BasicType kind of a (canonicalized) type, or UNKNOWN.
         ast::TypeKind kindOf(ast::TypePtr type) const;
@@ -178,6 +226,40 @@ namespace type_checker
         // True while checking inside a function whose return type was explicitly
         // annotated (so we can flag clear mismatches).
         bool returnTypeIsExplicit_ = false;
+        // Type interning (see intern()). Each type pointer seen is mapped to its
+        // interned instance once; the source is kept alive so its address is
+        // never reused for a different type. isAssignable results are cached
+        // per interned pair.
+        struct TypePairHash
+        {
+            size_t operator()(const std::pair<const ast::Type *, const ast::Type *> &p) const
+            {
+                return std::hash<const void *>()(p.first) * 31 + std::hash<const void *>()(p.second);
+            }
+        };
+        mutable ast::TypePtr basicTypes_[static_cast<size_t>(ast::TypeKind::UNKNOWN) + 1];
+        mutable std::unordered_map<std::string, const ast::Type *> typesBySpelling_;
+        mutable std::unordered_map<const ast::Type *, std::pair<ast::TypePtr, const ast::Type *>> internedTypes_;
+        std::unordered_map<std::pair<const ast::Type *, const ast::Type *>, bool, TypePairHash> assignable_;
+        // Parallel checking (setJobs). While the root is walked, each top-level
+        // function is deferred with a snapshot of the global scope, and the
+        // other top-level statements are checked in place; every segment
+        // reports into its own buffer. Deferred bodies are then checked on
+        // worker threads and the buffers replayed in source order.
+        struct Segment
+        {
+            ast::FunctionStmt *fn; // null: a run of statements checked in place
+            std::shared_ptr<const Environment> globals;
+            std::unique_ptr<error::ErrorHandler> diagnostics;
+        };
+        TypeChecker(const TypeChecker &parent, error::ErrorHandler &diagnostics,
+                    std::shared_ptr<const Environment> globals);
+        // Check a direct child of the program root (or of a top-level module).
+        void checkTopLevel(ast::Statement *stmt);
+        void checkDeferred(std::vector<Segment> &segments);
+        unsigned jobs_ = 1;
+        std::vector<Segment> *segments_ = nullptr;
+        std::shared_ptr<const Environment> globalsSnapshot_;
         // Depth guard so we only treat the outermost statement as the program root.
         int checkDepth_ = 0;
         // True only while visiting the program-root block/module so its direct
@@ -187,18 +269,25 @@ namespace type_checker
         // treat these as abstract types and check permissively.
         std::unordered_set<std::string> classTypeParams_;
 
-        // Algebraic-enum tracking for exhaustiveness checking. Populated in
-        // visitEnumStmt for enums that have at least one payload-carrying variant.
-        std::unordered_map<std::string, std::string> adtVariantEnum_;                  // variant name -> enum name
-        std::unordered_map<std::string, std::unordered_set<std::string>> adtEnumVariants_; // enum name -> variant set
-        std::unordered_map<std::string, std::vector<ast::TypePtr>> adtVariantFields_;  // variant name -> payload field types
-
-        // Names that are legal in identifier position but are not ordinary
-        // variables: declared module names (module M { } / import m.sub) and
-        // functions with a trailing variadic parameter (arity-checked loosely).
-        std::unordered_set<std::string> knownModules_;
-        std::unordered_set<std::string> variadicFns_;
-        std::unordered_map<std::string, size_t> fnMinArgs_;   // fn name -> required (non-default) arg count
+        // What is known about the program's declarations beyond their types.
+        // Filled while hoisting and by enum declarations; the workers of a
+        // parallel check share their parent's (read-only by then).
+        struct Declarations
+        {
+            // Algebraic-enum tracking for exhaustiveness checking. Populated in
+            // visitEnumStmt for enums that have at least one payload-carrying variant.
+            std::unordered_map<std::string, std::string> adtVariantEnum;                  // variant name -> enum name
+            std::unordered_map<std::string, std::unordered_set<std::string>> adtEnumVariants; // enum name -> variant set
+            std::unordered_map<std::string, std::vector<ast::TypePtr>> adtVariantFields;  // variant name -> payload field types
+
+            // Names that are legal in identifier position but are not ordinary
+            // variables: declared module names (module M { } / import m.sub) and
+            // functions with a trailing variadic parameter (arity-checked loosely).
+            std::unordered_set<std::string> knownModules;
+            std::unordered_set<std::string> variadicFns;
+            std::unordered_map<std::string, size_t> fnMinArgs;   // fn name -> required (non-default) arg count
+        };
+        std::shared_ptr<Declarations> decls_ = std::make_shared<Declarations>();
         // Register an enum's members/variants (shared by pass-1 hoisting and
         // visitEnumStmt so forward references to variants resolve).
         void registerEnum(ast::EnumStmt *stmt);
@@ -5,6 +5,10 @@
 #include <map>
 #include <atomic>
 #include <mutex>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iterator>
 
 namespace tocin {
 namespace v8_integration {
@@ -35,6 +39,9 @@ bool V8Runtime::initialize() {
     v8::Isolate::CreateParams create_params;
     create_params.array_buffer_allocator = 
         v8::ArrayBuffer::Allocator::NewDefaultAllocator();
+    if (snapshotBlob_.data) {
+        create_params.snapshot_blob = &snapshotBlob_;
+    }
     isolate_ = v8::Isolate::New(create_params);
 
     if (!isolate_) {
@@ -65,6 +72,11 @@ void V8Runtime::shutdown() {
         return;
     }
 
+    scriptCache_.clear();
+    for (auto& entry : moduleCache_) {
+        entry.second.Reset();
+    }
+    moduleCache_.clear();
     context_.Reset();
     
     if (isolate_) {
@@ -79,7 +91,95 @@ void V8Runtime::shutdown() {
 #endif
 }
 
+bool V8Runtime::setStartupSnapshot(const std::string& snapshotPath) {
+#ifdef WITH_V8
+    if (initialized_) {
+        setError("Startup snapshot must be set before initialize()");
+        return false;
+    }
+    std::ifstream file(snapshotPath, std::ios::binary);
+    if (!file.is_open()) {
+        setError("Failed to open snapshot: " + snapshotPath);
+        return false;
+    }
+    snapshotData_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    snapshotBlob_.data = snapshotData_.data();
+    snapshotBlob_.raw_size = static_cast<int>(snapshotData_.size());
+    clearError();
+    return true;
+#else
+    setError("V8 support not enabled");
+    return false;
+#endif
+}
+
+bool V8Runtime::createSnapshot(const std::string& setupCode, const std::string& snapshotPath) {
+#ifdef WITH_V8
+    if (!initialized_) {
+        setError("V8 runtime not initialized");
+        return false;
+    }
+
+    v8::StartupData blob{nullptr, 0};
+    bool setupFailed = false;
+    {
+        v8::SnapshotCreator creator;
+        v8::Isolate* isolate = creator.GetIsolate();
+        {
+            v8::HandleScope handle_scope(isolate);
+            v8::Local<v8::Context> context = v8::Context::New(isolate);
+            v8::Context::Scope context_scope(context);
+            v8::TryCatch try_catch(isolate);
+
+            v8::Local<v8::String> source =
+                v8::String::NewFromUtf8(isolate, setupCode.c_str()).ToLocalChecked();
+            v8::Local<v8::Script> script;
+            v8::Local<v8::Value> result;
+            if (!v8::Script::Compile(context, source).ToLocal(&script) ||
+                !script->Run(context).ToLocal(&result)) {
+                v8::String::Utf8Value error(isolate, try_catch.Exception());
+                setError(std::string("Snapshot setup error: ") + *error);
+                setupFailed = true;
+            }
+            creator.SetDefaultContext(context);
+        }
+        // A SnapshotCreator must produce its blob before it is destroyed,
+        // even when the setup code failed; that blob is then discarded.
+        // Keep compiled functions so the snapshot's code need not be
+        // compiled again on first call.
+        blob = creator.CreateBlob(setupFailed
+                                      ? v8::SnapshotCreator::FunctionCodeHandling::kClear
+                                      : v8::SnapshotCreator::FunctionCodeHandling::kKeep);
+    }
+    if (setupFailed) {
+        delete[] blob.data;
+        return false;
+    }
+    if (!blob.data) {
+        setError("Failed to create snapshot");
+        return false;
+    }
+
+    std::ofstream file(snapshotPath, std::ios::binary | std::ios::trunc);
+    bool written = static_cast<bool>(file.write(blob.data, blob.raw_size));
+    delete[] blob.data;
+    if (!written) {
+        setError("Failed to write snapshot: " + snapshotPath);
+        return false;
+    }
+    clearError();
+    return true;
+#else
+    setError("V8 support not enabled");
+    return false;
+#endif
+}
+
 ffi::FFIValue V8Runtime::executeCode(const std::string& code) {
+    return executeScript(code, false);
+}
+
+ffi::FFIValue V8Runtime::executeScript(const std::string& code, bool diskCache) {
 #ifdef WITH_V8
     if (!initialized_) {
         setError("V8 runtime not initialized");
@@ -93,16 +193,14 @@ ffi::FFIValue V8Runtime::executeCode(const std::string& code) {
 
     v8::TryCatch try_catch(isolate_);
 
-    // Compile the code
-    v8::Local<v8::String> source = 
-        v8::String::NewFromUtf8(isolate_, code.c_str()).ToLocalChecked();
-    
-    v8::Local<v8::Script> script;
-    if (!v8::Script::Compile(context, source).ToLocal(&script)) {
+    // Compile the code, or reuse the compilation of the same source
+    v8::Local<v8::UnboundScript> unbound;
+    if (!compileCached(code, diskCache).ToLocal(&unbound)) {
         v8::String::Utf8Value error(isolate_, try_catch.Exception());
         setError(std::string("Compilation error: ") + *error);
         return ffi::FFIValue();
     }
+    v8::Local<v8::Script> script = unbound->BindToCurrentContext();
 
     // Execute the script
     v8::Local<v8::Value> result;
@@ -196,7 +294,7 @@ bool V8Runtime::loadModule(const std::string& modulePath) {
     // Wrap in module pattern
     std::string wrappedCode = "(function(exports, module) {\n" + code + "\n})(exports, module);";
     
-    auto result = executeCode(wrappedCode);
+    auto result = executeScript(wrappedCode, true);
     return !hasError();
 #else
     setError("V8 support not enabled");
@@ -237,10 +335,14 @@ bool V8Runtime::loadESModule(const std::string& modulePath, const std::string& m
         v8::String::NewFromUtf8(isolate_, modulePath.c_str()).ToLocalChecked(),
         0, 0, false, -1, v8::Local<v8::Value>(), false, false, true);
     
-    // Compile module
-    v8::ScriptCompiler::Source scriptSource(source, origin);
-    v8::MaybeLocal<v8::Module> maybeModule = 
-        v8::ScriptCompiler::CompileModule(isolate_, &scriptSource);
+    // Compile module, from the code cache when there is a usable one
+    std::string cachePath = codeCachePath(sourceCode);
+    std::unique_ptr<v8::ScriptCompiler::CachedData> cached = readCodeCache(cachePath);
+    bool consumeCache = cached != nullptr;
+    v8::ScriptCompiler::Source scriptSource(source, origin, cached.release());
+    v8::MaybeLocal<v8::Module> maybeModule = v8::ScriptCompiler::CompileModule(
+        isolate_, &scriptSource,
+        consumeCache ? v8::ScriptCompiler::kConsumeCodeCache : v8::ScriptCompiler::kNoCompileOptions);
     
     if (maybeModule.IsEmpty()) {
         v8::String::Utf8Value error(isolate_, try_catch.Exception());
@@ -249,6 +351,13 @@ bool V8Runtime::loadESModule(const std::string& modulePath, const std::string& m
     }
     
     v8::Local<v8::Module> module = maybeModule.ToLocalChecked();
+    // No cache yet, or V8 rejected it (another V8 version or flags): write
+    // a fresh one for next time.
+    if (!cachePath.empty() && (!consumeCache || scriptSource.GetCachedData()->rejected)) {
+        std::unique_ptr<v8::ScriptCompiler::CachedData> fresh(
+            v8::ScriptCompiler::CreateCodeCache(module->GetUnboundModuleScript()));
+        writeCodeCache(cachePath, fresh.get());
+    }
     
     // Instantiate module
     if (!module->InstantiateModule(context, ResolveModuleCallback).FromMaybe(false)) {
@@ -637,6 +746,86 @@ v8::Local<v8::Context> V8Runtime::getContext() {
     return context_.Get(isolate_);
 }
 
+v8::MaybeLocal<v8::UnboundScript> V8Runtime::compileCached(const std::string& code, bool diskCache) {
+    auto it = scriptCache_.find(code);
+    if (it != scriptCache_.end()) {
+        return it->second.Get(isolate_);
+    }
+
+    v8::Local<v8::String> source;
+    if (!v8::String::NewFromUtf8(isolate_, code.data(), v8::NewStringType::kNormal,
+                                 static_cast<int>(code.size())).ToLocal(&source)) {
+        return {};
+    }
+    std::string cachePath = diskCache ? codeCachePath(code) : "";
+    std::unique_ptr<v8::ScriptCompiler::CachedData> cached = readCodeCache(cachePath);
+    bool consumeCache = cached != nullptr;
+    v8::ScriptCompiler::Source scriptSource(source, cached.release());
+    v8::Local<v8::UnboundScript> unbound;
+    if (!v8::ScriptCompiler::CompileUnboundScript(
+             isolate_, &scriptSource,
+             consumeCache ? v8::ScriptCompiler::kConsumeCodeCache : v8::ScriptCompiler::kNoCompileOptions)
+             .ToLocal(&unbound)) {
+        return {};
+    }
+    if (!cachePath.empty() && (!consumeCache || scriptSource.GetCachedData()->rejected)) {
+        std::unique_ptr<v8::ScriptCompiler::CachedData> fresh(v8::ScriptCompiler::CreateCodeCache(unbound));
+        writeCodeCache(cachePath, fresh.get());
+    }
+
+    // Generated one-off sources would otherwise grow the cache without
+    // bound; start over rather than track recency.
+    if (scriptCache_.size() >= kScriptCacheLimit) {
+        scriptCache_.clear();
+    }
+    scriptCache_[code].Reset(isolate_, unbound);
+    return unbound;
+}
+
+std::string V8Runtime::codeCachePath(const std::string& source) const {
+    if (codeCacheDir_.empty()) {
+        return "";
+    }
+    // The size keeps a hash collision from matching; V8 also checks the
+    // source hash stored in the cache and rejects a mismatch.
+    char name[64];
+    std::snprintf(name, sizeof name, "/%016zx-%zu.v8cache", std::hash<std::string>{}(source), source.size());
+    return codeCacheDir_ + name;
+}
+
+std::unique_ptr<v8::ScriptCompiler::CachedData> V8Runtime::readCodeCache(const std::string& path) const {
+    if (path.empty()) {
+        return nullptr;
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.empty()) {
+        return nullptr;
+    }
+    auto* data = new uint8_t[bytes.size()];
+    std::memcpy(data, bytes.data(), bytes.size());
+    return std::make_unique<v8::ScriptCompiler::CachedData>(
+        data, static_cast<int>(bytes.size()), v8::ScriptCompiler::CachedData::BufferOwned);
+}
+
+void V8Runtime::writeCodeCache(const std::string& path, const v8::ScriptCompiler::CachedData* data) const {
+    if (!data || data->length <= 0) {
+        return;
+    }
+    // Written aside and renamed so a concurrent load never reads half a file.
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(data->data), data->length)) {
+            return;
+        }
+    }
+    std::rename(tmp.c_str(), path.c_str());
+}
+
 std::string V8Runtime::generatePromiseId() {
     return "promise_" + std::to_string(promiseIdCounter_.fetch_add(1));
 }
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <unordered_map>
 #include "../ffi/ffi_value.h"
 
 #ifdef WITH_V8
@@ -29,7 +30,23 @@ public:
     bool initialize();
     void shutdown();
 
-    // Code execution
+    // Start the isolate from a snapshot written by createSnapshot instead
+    // of an empty heap, so whatever its setup code defined is there without
+    // running it again. Call before initialize().
+    bool setStartupSnapshot(const std::string& snapshotPath);
+    // Run setupCode in a fresh context and write the resulting heap to
+    // snapshotPath as a startup snapshot. Needs an initialized runtime (for
+    // the platform); the snapshot is built in a separate isolate.
+    bool createSnapshot(const std::string& setupCode, const std::string& snapshotPath);
+
+    // Module loads keep V8 code cache data in this directory, one file per
+    // distinct source, and compile from it on later loads, here or in
+    // another process. Empty (the default) disables the disk cache.
+    void setCodeCacheDirectory(const std::string& directory) { codeCacheDir_ = directory; }
+
+    // Code execution. Compiled scripts are cached per source text (up to
+    // kScriptCacheLimit), so evaluating the same code again only runs it.
+    static constexpr size_t kScriptCacheLimit = 256;
     ffi::FFIValue executeCode(const std::string& code);
     ffi::FFIValue evaluateExpression(const std::string& expression);
 
@@ -78,6 +95,13 @@ private:
     v8::Isolate* isolate_;
     v8::Persistent<v8::Context> context_;
     
+    // Compiled scripts by source text, unbound so they survive context use
+    std::unordered_map<std::string, v8::Global<v8::UnboundScript>> scriptCache_;
+
+    // Startup snapshot (setStartupSnapshot); the blob must outlive the isolate
+    std::string snapshotData_;
+    v8::StartupData snapshotBlob_{nullptr, 0};
+
     // Module cache
     std::map<std::string, v8::Persistent<v8::Module>> moduleCache_;
     std::map<std::string, std::string> modulePathMap_;
@@ -89,6 +113,13 @@ private:
     
     // Helper methods
     v8::Local<v8::Context> getContext();
+    // The compiled script for code from scriptCache_, compiling it on a
+    // miss; diskCache also reads and writes the code cache directory.
+    v8::MaybeLocal<v8::UnboundScript> compileCached(const std::string& code, bool diskCache);
+    // The code cache file for source, or "" with no cache directory.
+    std::string codeCachePath(const std::string& source) const;
+    std::unique_ptr<v8::ScriptCompiler::CachedData> readCodeCache(const std::string& path) const;
+    void writeCodeCache(const std::string& path, const v8::ScriptCompiler::CachedData* data) const;
     std::string generatePromiseId();
     
     // Module resolution callback
@@ -99,11 +130,14 @@ private:
         v8::Local<v8::Module> referrer);
 #endif
 
+    ffi::FFIValue executeScript(const std::string& code, bool diskCache);
+
     // These are always available
     void setError(const std::string& error);
     void clearError();
 
     std::string lastError_;
+    std::string codeCacheDir_;
     bool initialized_;
 };
 
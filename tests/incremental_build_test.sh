@@ -0,0 +1,81 @@
+#!/usr/bin/env bash
+#
+# incremental_build_test.sh — regression test for --incremental: an executable
+# is emitted as one cached object per source module, and a rebuild after
+# editing one module recompiles that module's partition only.
+#
+# These link executables rather than JIT-run, so they live outside the --run
+# suites. Verification counts the partition objects in a private
+# TOCIN_CACHE_DIR and runs the linked program.
+set -u
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+TOCIN="${TOCIN:-$ROOT/build/tocin}"
+TMP="$(mktemp -d)"
+trap 'rm -rf "$TMP"' EXIT
+export TOCIN_CACHE_DIR="$TMP/cache"
+fail=0
+pass() { echo "PASS  $1"; }
+bad()  { echo "FAIL  $1"; fail=1; }
+objects() { find "$TOCIN_CACHE_DIR/obj" -name '*.o' 2>/dev/null | sort; }
+
+mkdir -p "$TMP/src"
+cat > "$TMP/src/a.to" <<'EOF'
+def twice(n: int) -> int { return n * 2; }
+EOF
+cat > "$TMP/src/b.to" <<'EOF'
+def offset(n: int) -> int { return n + 1; }
+EOF
+cat > "$TMP/src/main.to" <<'EOF'
+import a;
+import b;
+def main() -> int { return twice(10) + offset(10); }
+EOF
+
+# --- 1. Cold build: one object per module ------------------------------------
+if "$TOCIN" "$TMP/src/main.to" --incremental -o "$TMP/app" 2>"$TMP/cold.err"; then
+    "$TMP/app"; got=$?
+    objects > "$TMP/cold.list"
+    count=$(wc -l < "$TMP/cold.list")
+    if [ "$got" -ne 31 ]; then
+        bad "cold build: program returned $got (want 31)"
+    elif [ "$count" -lt 3 ]; then
+        bad "cold build: $count partition objects cached (want one per module)"
+    else
+        pass "cold build caches $count partition objects"
+    fi
+else
+    bad "cold build: compilation failed"; cat "$TMP/cold.err"
+fi
+
+# --- 2. Unchanged rebuild: every partition is a cache hit --------------------
+if "$TOCIN" "$TMP/src/main.to" --incremental -o "$TMP/app" 2>"$TMP/warm.err"; then
+    objects > "$TMP/warm.list"
+    if cmp -s "$TMP/cold.list" "$TMP/warm.list"; then
+        pass "unchanged rebuild recompiles nothing"
+    else
+        bad "unchanged rebuild wrote new partition objects"
+    fi
+else
+    bad "unchanged rebuild: compilation failed"; cat "$TMP/warm.err"
+fi
+
+# --- 3. Edit one module: only its partition is recompiled --------------------
+cat > "$TMP/src/b.to" <<'EOF'
+def offset(n: int) -> int { return n + 5; }
+EOF
+if "$TOCIN" "$TMP/src/main.to" --incremental -o "$TMP/app" 2>"$TMP/edit.err"; then
+    "$TMP/app"; got=$?
+    objects > "$TMP/edit.list"
+    added=$(comm -13 "$TMP/warm.list" "$TMP/edit.list" | wc -l)
+    if [ "$got" -ne 35 ]; then
+        bad "edited build: program returned $got (want 35)"
+    elif [ "$added" -ne 1 ]; then
+        bad "editing b.to recompiled $added partitions (want 1)"
+    else
+        pass "editing b.to recompiles its partition only"
+    fi
+else
+    bad "edited build: compilation failed"; cat "$TMP/edit.err"
+fi
+
+exit $fail
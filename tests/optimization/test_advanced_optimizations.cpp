@@ -64,3 +64,20 @@ TEST_CASE(optimization_pipeline) {
     auto stats = pipeline.getStats();
     ASSERT_GE(stats.optimizationTimeMs, 0.0);
 }
+
+TEST_CASE(multiversion_target_clones) {
+    auto module = createTestModule();
+    module->setTargetTriple("x86_64-unknown-linux-gnu");
+    llvm::Function* add = module->getFunction("add");
+    add->addFnAttr("tocin-target-clones", "avx512,avx2,default");
+    ASSERT_EQ(multiversionFunctions(*module), 1u);
+    // add is now the stub; its body lives on in one version per level.
+    ASSERT_TRUE(module->getFunction("add.default") != nullptr);
+    llvm::Function* avx2 = module->getFunction("add.avx2");
+    ASSERT_TRUE(avx2 != nullptr);
+    ASSERT_TRUE(avx2->getFnAttribute("target-cpu").getValueAsString() == "x86-64-v3");
+    ASSERT_TRUE(module->getFunction("add.avx512") != nullptr);
+    ASSERT_TRUE(module->getNamedGlobal("add.dispatch") != nullptr);
+    ASSERT_FALSE(add->hasFnAttribute("tocin-target-clones"));
+    ASSERT_TRUE(add->hasExternalLinkage());
+}
@@ -9,6 +9,11 @@
 # Pass criteria per file: exit code 0, unless it declares `// expect: N`
 # (then exit must equal N). std.testing's testSummary() already returns
 # nonzero on any failed check, so those files self-report.
+#
+# A file that declares `// stdlib-cache: warm` is compiled twice against one
+# fresh stdlib cache (with the --run object cache off, so the second run
+# compiles again). The first compile precompiles its stdlib imports; the
+# second must load their interfaces (.toi) and precompile nothing.
 set -u
 ROOT="$(cd "$(dirname "$0")/.." && pwd)"
 TOCIN="${TOCIN:-$ROOT/build/tocin}"
@@ -21,7 +26,18 @@ for t in "$DIR"/*.to; do
   name="$(basename "$t")"
   want="$(grep -m1 -oE '// *expect: *[0-9]+' "$t" | grep -oE '[0-9]+' || true)"
   [ -n "$want" ] || want=0
-  out="$("$TOCIN" "$t" --run 2>&1)"; got=$?
+  if grep -q '^// *stdlib-cache: *warm' "$t"; then
+    cache="$(mktemp -d)"
+    TOCIN_CACHE_DIR="$cache" "$TOCIN" "$t" --run --no-jit-cache >/dev/null 2>&1
+    out="$(TOCIN_CACHE_DIR="$cache" "$TOCIN" "$t" --run --no-jit-cache \
+             --time-trace="$cache/warm.json" --time-trace-granularity=0 2>&1)"; got=$?
+    if grep -q '"Precompile module"' "$cache/warm.json" || ! grep -q '\.toi"' "$cache/warm.json"; then
+      out="$out"$'\n'"second compile missed the stdlib cache"; got=255
+    fi
+    rm -rf "$cache"
+  else
+    out="$("$TOCIN" "$t" --run 2>&1)"; got=$?
+  fi
   if [ "$got" -eq "$want" ]; then
     echo "PASS  $name  ($(printf '%s\n' "$out" | tail -1))"
   else
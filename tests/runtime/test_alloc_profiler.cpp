@@ -0,0 +1,171 @@
+// Allocation Profiler Tests for Tocin Compiler
+//
+// alloc_profiler.h: sampling through the runtime's allocator entry points,
+// kind tags, liveness after __tocin_free and the report, folded, pprof and
+// heap snapshot outputs.
+
+#include "runtime/alloc_profiler.h"
+
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+extern "C" void *__tocin_alloc(int64_t size);
+extern "C" void *__tocin_alloc_tagged(int64_t size, int32_t kind);
+extern "C" void *__tocin_alloc_atomic_tagged(int64_t size, int32_t kind);
+extern "C" void *__tocin_realloc(void *p, int64_t size);
+extern "C" void __tocin_free(void *p);
+
+using namespace tocin::runtime;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static bool contains(const std::string& text, const char* needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+static std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static double bytesOf(AllocKind kind, bool live) {
+    double total = 0;
+    for (const auto& s : AllocationProfiler::instance().sites())
+        if (s.kind == kind) total += live ? s.liveBytes : s.allocBytes;
+    return total;
+}
+
+__attribute__((noinline)) static void* makeClosure() {
+    return __tocin_alloc_tagged(48, (int32_t)AllocKind::Closure);
+}
+
+TEST(rate_one_samples_every_allocation_by_kind) {
+    auto& profiler = AllocationProfiler::instance();
+    ASSERT_TRUE(profiler.start(1));
+    ASSERT_TRUE(AllocationProfiler::active());
+    ASSERT_TRUE(!profiler.start(1)); // one profile at a time
+    std::vector<void*> blocks;
+    for (int i = 0; i < 10; ++i) blocks.push_back(makeClosure());
+    blocks.push_back(__tocin_alloc_atomic_tagged(100, (int32_t)AllocKind::String));
+    blocks.push_back(__tocin_alloc(64));
+    profiler.stop();
+    void* unsampled = __tocin_alloc_tagged(1000, (int32_t)AllocKind::Array);
+
+    ASSERT_EQ(profiler.sampleCount(), (size_t)12);
+    ASSERT_EQ(bytesOf(AllocKind::Closure, false), 480.0);
+    ASSERT_EQ(bytesOf(AllocKind::String, false), 100.0);
+    ASSERT_EQ(bytesOf(AllocKind::Other, false), 64.0);
+    ASSERT_EQ(bytesOf(AllocKind::Array, false), 0.0);
+    // The ten closures come from one call site, and lead the list.
+    auto sites = profiler.sites();
+    ASSERT_EQ(sites[0].kind, AllocKind::Closure);
+    ASSERT_EQ(sites[0].samples, (uint64_t)10);
+    ASSERT_TRUE(!sites[0].stack.empty());
+
+    // Freed blocks leave the in-use figures, even after stop().
+    for (int i = 0; i < 4; ++i) __tocin_free(blocks[i]);
+    ASSERT_EQ(bytesOf(AllocKind::Closure, true), 288.0);
+    ASSERT_EQ(bytesOf(AllocKind::Closure, false), 480.0);
+    __tocin_free(unsampled);
+}
+
+TEST(realloc_keeps_the_kind) {
+    auto& profiler = AllocationProfiler::instance();
+    ASSERT_TRUE(profiler.start(1));
+    void* p = __tocin_alloc_tagged(32, (int32_t)AllocKind::Array);
+    p = __tocin_realloc(p, 4096);
+    profiler.stop();
+    ASSERT_EQ(bytesOf(AllocKind::Array, true), 4096.0);
+    ASSERT_EQ(bytesOf(AllocKind::Array, false), 32.0 + 4096.0);
+    __tocin_free(p);
+    ASSERT_EQ(bytesOf(AllocKind::Array, true), 0.0);
+}
+
+TEST(sparse_sampling_estimates_totals) {
+    // 20000 blocks of 256 bytes at one sample per 4 KiB: about 1250
+    // samples, which scale back to about 5 MB.
+    auto& profiler = AllocationProfiler::instance();
+    ASSERT_TRUE(profiler.start(4096));
+    std::vector<void*> blocks;
+    for (int i = 0; i < 20000; ++i) blocks.push_back(__tocin_alloc_tagged(256, (int32_t)AllocKind::Object));
+    profiler.stop();
+    ASSERT_TRUE(profiler.sampleCount() > 800 && profiler.sampleCount() < 1800);
+    double estimate = bytesOf(AllocKind::Object, false);
+    ASSERT_TRUE(estimate > 0.8 * 20000 * 256 && estimate < 1.2 * 20000 * 256);
+    for (void* b : blocks) __tocin_free(b);
+}
+
+TEST(writes_report_folded_pprof_and_snapshot) {
+    auto& profiler = AllocationProfiler::instance();
+    ASSERT_TRUE(profiler.start(1));
+    std::vector<void*> blocks;
+    for (int i = 0; i < 5; ++i) blocks.push_back(makeClosure());
+    blocks.push_back(__tocin_alloc_atomic_tagged(100, (int32_t)AllocKind::String));
+    profiler.stop();
+
+    std::string report = profiler.report();
+    ASSERT_TRUE(contains(report, "6 samples"));
+    ASSERT_TRUE(contains(report, "closure"));
+    ASSERT_TRUE(contains(report, "string: top call sites"));
+
+    // Every folded line is "kind;frame;... bytes", rooted at the kind.
+    std::string folded = profiler.folded();
+    ASSERT_TRUE(folded.rfind("closure;", 0) == 0 || contains(folded, "\nclosure;"));
+    ASSERT_TRUE(contains(folded, "string;"));
+    ASSERT_TRUE(contains(folded, " 240\n"));
+
+    const std::string text = "tocin_test_alloc.txt";
+    ASSERT_TRUE(profiler.write(text));
+    ASSERT_EQ(readFile(text), report);
+    std::remove(text.c_str());
+
+    const std::string pprof = "tocin_test_alloc.pb.gz";
+    ASSERT_TRUE(profiler.write(pprof));
+    std::string bytes = readFile(pprof);
+    ASSERT_TRUE(bytes.size() > 18);
+    ASSERT_EQ((unsigned char)bytes[0], 0x1f);
+    ASSERT_EQ((unsigned char)bytes[1], 0x8b);
+    std::remove(pprof.c_str());
+    std::string message = profiler.pprof();
+    ASSERT_TRUE(contains(message, "alloc_space"));
+    ASSERT_TRUE(contains(message, "inuse_objects"));
+    ASSERT_TRUE(contains(message, "kind"));
+
+    std::string snapshot = profiler.heapSnapshot();
+    ASSERT_TRUE(contains(snapshot, "tocin heap snapshot"));
+    ASSERT_TRUE(contains(snapshot, "closure objects"));
+    ASSERT_TRUE(!profiler.writeHeapSnapshot("/nonexistent-dir/heap.txt"));
+    for (void* b : blocks) __tocin_free(b);
+}
+
+int main() {
+    std::cout << "=== Allocation Profiler Tests ===\n\n";
+
+    RUN_TEST(rate_one_samples_every_allocation_by_kind);
+    RUN_TEST(realloc_keeps_the_kind);
+    RUN_TEST(sparse_sampling_estimates_totals);
+    RUN_TEST(writes_report_folded_pprof_and_snapshot);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
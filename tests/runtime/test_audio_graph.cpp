@@ -0,0 +1,252 @@
+// Audio Graph Tests for Tocin Compiler
+//
+// Every kernel table the CPU supports is checked against direct formulas
+// (sin per sample, the ramp from its phase) on block lengths around the
+// vector widths and across the oscillators' re-seeding span. The graph is
+// checked block by block against the same formulas, and process() against
+// a counting operator new. The SPSC ring runs one producer and one consumer
+// thread over a small ring.
+
+#include "runtime/audio_graph.h"
+#include "runtime/spsc_ring.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+extern "C" {
+int64_t __tocin_audio_graph_new(int64_t blockSize, double sampleRate);
+int64_t __tocin_audio_graph_free(int64_t g);
+int64_t __tocin_audio_graph_osc(int64_t g, int64_t kind, double freq, double amp);
+int64_t __tocin_audio_graph_mix(int64_t g);
+int64_t __tocin_audio_graph_connect(int64_t g, int64_t mix, int64_t input, double level);
+int64_t __tocin_audio_graph_clip(int64_t g, int64_t node, double limit);
+int64_t __tocin_audio_graph_process(int64_t g, int64_t *out);
+int64_t __tocin_audio_graph_process_to_ring(int64_t g, int64_t r);
+int64_t __tocin_audio_ring_new(int64_t blocks, int64_t blockSize);
+int64_t __tocin_audio_ring_free(int64_t r);
+int64_t __tocin_audio_ring_push(int64_t r, int64_t *buf);
+int64_t __tocin_audio_ring_pop(int64_t r, int64_t *out);
+int64_t __tocin_audio_ring_size(int64_t r);
+}
+
+using tocin::runtime::AudioGraph;
+using tocin::runtime::AudioKernels;
+using tocin::runtime::AudioStage;
+
+static std::atomic<long> allocations{0};
+
+void *operator new(size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+static const AudioKernels *kernels = nullptr;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " (" << (kernels ? kernels->name : "-") \
+                  << ") at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+#define ASSERT_NEAR(a, b, eps) ASSERT_TRUE(std::fabs((a) - (b)) <= (eps))
+
+static const double kTau = 6.283185307179586;
+static const double kInf = INFINITY;
+
+static double stage(double x, AudioStage st) {
+    x *= st.gain;
+    return x < -st.limit ? -st.limit : x > st.limit ? st.limit : x;
+}
+
+static double frac(double x) { return x - std::floor(x); }
+
+TEST(oscillators_match_formulas) {
+    const size_t lengths[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 31, 64, 257, 4095, 4097, 10000};
+    const double freqs[] = {440.0, 1000.3, 17.0, 30000.0};
+    for (size_t n : lengths)
+        for (double f : freqs)
+            for (AudioStage st : {AudioStage{1.0, kInf}, AudioStage{2.5, 0.6}}) {
+                double inc = f / 48000.0, phase = 0.3;
+                std::vector<double> out(n + 1, 7.0);
+                kernels->sine(out.data(), n, phase, inc, 0.8, st);
+                for (size_t i = 0; i < n; ++i)
+                    ASSERT_NEAR(out[i], stage(0.8 * std::sin(kTau * (phase + i * inc)), st), 1e-9);
+                ASSERT_EQ(out[n], 7.0);
+
+                for (bool square : {false, true}) {
+                    kernels->ramp(out.data(), n, phase, inc, 0.8, square, st);
+                    for (size_t i = 0; i < n; ++i) {
+                        double p = frac(phase + i * inc);
+                        // The recurrence may land on the other side of an edge.
+                        if (std::fabs(p - 0.5) < 1e-9 || p < 1e-9 || p > 1 - 1e-9) continue;
+                        double want = square ? (p < 0.5 ? 0.8 : -0.8) : 0.8 * (2 * p - 1);
+                        ASSERT_NEAR(out[i], stage(want, st), 1e-9);
+                    }
+                    ASSERT_EQ(out[n], 7.0);
+                }
+            }
+}
+
+TEST(mix_sums_scales_and_clips) {
+    std::vector<double> a(70), b(70), c(70);
+    for (size_t i = 0; i < 70; ++i) {
+        a[i] = std::sin(i * 0.1);
+        b[i] = std::cos(i * 0.37);
+        c[i] = (i % 7) * 0.25 - 0.5;
+    }
+    const double *ins[] = {a.data(), b.data(), c.data()};
+    const double levels[] = {0.5, -1.5, 2.0};
+    for (size_t n = 0; n <= 70; ++n)
+        for (size_t count = 0; count <= 3; ++count) {
+            std::vector<double> out(n + 1, 7.0);
+            AudioStage st{0.75, count == 2 ? 0.9 : kInf};
+            kernels->mix(out.data(), ins, levels, count, n, st);
+            for (size_t i = 0; i < n; ++i) {
+                double sum = 0;
+                for (size_t k = 0; k < count; ++k) sum += ins[k][i] * levels[k];
+                ASSERT_NEAR(out[i], stage(sum, st), 1e-12);
+            }
+            ASSERT_EQ(out[n], 7.0);
+        }
+}
+
+TEST(graph_renders_continuous_blocks) {
+    AudioGraph g(100, 48000.0);
+    int64_t sine = g.addOscillator(AudioGraph::Kind::Sine, 440.0, 1.0);
+    int64_t saw = g.addOscillator(AudioGraph::Kind::Saw, 110.0, 0.5);
+    int64_t mix = g.addMix();
+    ASSERT_TRUE(g.connect(mix, sine, 0.5));
+    ASSERT_TRUE(g.connect(mix, saw, 1.0));
+    ASSERT_TRUE(g.connect(mix, sine, 0.25));  // just a new level
+    ASSERT_TRUE(!g.connect(mix, mix, 1.0));
+    ASSERT_TRUE(!g.connect(sine, saw, 1.0));
+    ASSERT_TRUE(g.setGain(mix, 2.0));
+    ASSERT_TRUE(g.setClip(mix, 0.7));
+    int64_t lp = g.addLowpass(mix, 0.2);
+    ASSERT_EQ(lp, 3);
+    ASSERT_EQ(g.addLowpass(9, 0.2), -1);
+
+    double y = 0;
+    for (int block = 0; block < 5; ++block) {
+        long before = allocations.load();
+        g.process(*kernels);
+        ASSERT_EQ(allocations.load(), before);
+        for (size_t i = 0; i < 100; ++i) {
+            double t = block * 100.0 + i;
+            double s = std::sin(kTau * 440.0 * t / 48000.0);
+            double p = frac(110.0 * t / 48000.0);  // only 0 lands on an edge
+            double m = stage(0.25 * s + 0.5 * (2 * p - 1), AudioStage{2.0, 0.7});
+            y += 0.2 * (m - y);
+            ASSERT_NEAR(g.output()[i], y, 1e-9);
+        }
+    }
+
+    // Changing the frequency keeps the phase: no click at the block edge.
+    AudioGraph h(64, 1000.0);
+    int64_t o = h.addOscillator(AudioGraph::Kind::Sine, 10.0, 1.0);
+    h.process(*kernels);
+    ASSERT_TRUE(h.setFrequency(o, 20.0));
+    ASSERT_TRUE(!h.setFrequency(9, 20.0));
+    std::vector<double> out(64);
+    h.processInto(*kernels, out.data());
+    ASSERT_NEAR(out[0], std::sin(kTau * 10.0 * 64 / 1000.0), 1e-9);
+    ASSERT_NEAR(out[1], std::sin(kTau * (10.0 * 64 / 1000.0 + 20.0 / 1000.0)), 1e-9);
+}
+
+TEST(ring_hands_blocks_between_threads) {
+    tocin::runtime::SpscBlockRing<double> ring(4, 16);
+    ASSERT_TRUE(ring.readable() == nullptr);
+    const int kBlocks = 20000;
+    std::thread producer([&] {
+        for (int b = 0; b < kBlocks; ++b) {
+            double *slot;
+            while (!(slot = ring.writable())) std::this_thread::yield();
+            for (int i = 0; i < 16; ++i) slot[i] = b * 16 + i;
+            ring.publish();
+        }
+    });
+    bool ordered = true;
+    for (int b = 0; b < kBlocks; ++b) {
+        const double *block;
+        while (!(block = ring.readable())) std::this_thread::yield();
+        for (int i = 0; i < 16; ++i) ordered = ordered && block[i] == b * 16 + i;
+        ring.release();
+    }
+    producer.join();
+    ASSERT_TRUE(ordered);
+    ASSERT_EQ(ring.sizeApprox(), 0u);
+}
+
+TEST(entry_points) {
+    // A [len][elements] list of 8 floats.
+    std::vector<int64_t> list(9, 0);
+    list[0] = 8;
+    auto *samples = reinterpret_cast<double *>(list.data() + 1);
+
+    ASSERT_EQ(__tocin_audio_graph_new(0, 48000.0), 0);
+    int64_t g = __tocin_audio_graph_new(8, 8.0);
+    ASSERT_EQ(__tocin_audio_graph_osc(g, 3, 1.0, 1.0), -1);
+    int64_t sq = __tocin_audio_graph_osc(g, 1, 1.0, 1.0);  // one cycle every 8 samples
+    int64_t mix = __tocin_audio_graph_mix(g);
+    ASSERT_EQ(__tocin_audio_graph_connect(g, mix, sq, 3.0), 1);
+    ASSERT_EQ(__tocin_audio_graph_clip(g, mix, 2.0), 1);
+    ASSERT_EQ(__tocin_audio_graph_process(g, list.data()), 8);
+    for (int i = 0; i < 8; ++i) ASSERT_EQ(samples[i], i < 4 ? 2.0 : -2.0);
+
+    int64_t r = __tocin_audio_ring_new(2, 8);
+    ASSERT_EQ(__tocin_audio_graph_process_to_ring(g, r), 1);
+    ASSERT_EQ(__tocin_audio_graph_process_to_ring(g, r), 1);
+    ASSERT_EQ(__tocin_audio_graph_process_to_ring(g, r), 0);  // full
+    ASSERT_EQ(__tocin_audio_ring_size(r), 2);
+    ASSERT_EQ(__tocin_audio_ring_pop(r, list.data()), 1);
+    ASSERT_EQ(samples[0], 2.0);
+    ASSERT_EQ(samples[7], -2.0);
+    list[0] = 3;  // a short block is zero-padded
+    samples[0] = 0.5;
+    __tocin_audio_ring_pop(r, nullptr);
+    ASSERT_EQ(__tocin_audio_ring_push(r, list.data()), 1);
+    list[0] = 8;
+    ASSERT_EQ(__tocin_audio_ring_pop(r, list.data()), 1);
+    ASSERT_EQ(samples[0], 0.5);
+    ASSERT_EQ(samples[7], 0.0);
+    ASSERT_EQ(__tocin_audio_ring_pop(r, list.data()), 0);
+    __tocin_audio_ring_free(r);
+    __tocin_audio_graph_free(g);
+}
+
+int main() {
+    std::cout << "=== Audio Graph Tests ===\n\n";
+
+    for (const AudioKernels *k : tocin::runtime::availableAudioKernels()) {
+        kernels = k;
+        std::cout << "[" << k->name << "]\n";
+        RUN_TEST(oscillators_match_formulas);
+        RUN_TEST(mix_sums_scales_and_clips);
+        RUN_TEST(graph_renders_continuous_blocks);
+    }
+    kernels = &tocin::runtime::audioKernels();
+    RUN_TEST(ring_hands_blocks_between_threads);
+    RUN_TEST(entry_points);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
@@ -0,0 +1,211 @@
+// Channel Tests for Tocin Compiler
+//
+// runtime::Channel<T> and Select from concurrency.h over the lock-free ring
+// in mpmc_ring.h: FIFO order and the capacity bound, move-only values,
+// producers and consumers racing on plain threads, receivers parked on
+// goroutines without holding their workers, and selects that wake on any of
+// their channels.
+
+#include "runtime/concurrency.h"
+#include "runtime/mpmc_ring.h"
+
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+extern "C" void __tocin_join_all();
+
+using runtime::Channel;
+using runtime::Select;
+using tocin::runtime::MpmcRing;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+TEST(ring_is_bounded_and_fifo) {
+    MpmcRing<int64_t> ring(3);
+    uint64_t ticket = 0;
+    ASSERT_TRUE(ring.push(int64_t(1), &ticket));
+    ASSERT_EQ(ticket, 1u);
+    ASSERT_TRUE(ring.push(int64_t(2)));
+    ASSERT_TRUE(ring.push(int64_t(3), &ticket));
+    ASSERT_EQ(ticket, 3u);
+    ASSERT_TRUE(!ring.push(int64_t(4)));   // exactly three slots
+    int64_t v = 0;
+    ASSERT_TRUE(ring.pop(&v));
+    ASSERT_EQ(v, 1);
+    ASSERT_TRUE(ring.push(int64_t(4)));    // wraps around
+    for (int64_t want : {2, 3, 4}) {
+        ASSERT_TRUE(ring.pop(&v));
+        ASSERT_EQ(v, want);
+    }
+    ASSERT_TRUE(!ring.pop(&v));
+    ASSERT_TRUE(!ring.maybeNonEmpty());
+}
+
+TEST(ring_destroys_what_it_still_holds) {
+    auto counted = std::make_shared<int>(0);
+    {
+        MpmcRing<std::shared_ptr<int>> ring(4);
+        ring.push(counted);
+        ring.push(counted);
+        ASSERT_EQ(counted.use_count(), 3);
+        std::shared_ptr<int> full = counted;
+        ASSERT_TRUE(ring.push(std::move(full)));
+        ASSERT_TRUE(ring.push(counted));
+        std::shared_ptr<int> rejected = counted;
+        ASSERT_TRUE(!ring.push(std::move(rejected)));
+        ASSERT_TRUE(rejected != nullptr);   // a failed push leaves it alone
+    }
+    ASSERT_EQ(counted.use_count(), 1);
+}
+
+TEST(bounded_channel_blocks_when_full) {
+    Channel<int> ch(2);
+    ASSERT_TRUE(ch.trySend(1));
+    ASSERT_TRUE(ch.trySend(2));
+    ASSERT_TRUE(!ch.trySend(3));
+    ASSERT_EQ(ch.size(), 2u);
+
+    std::atomic<bool> sent{false};
+    std::thread sender([&] {
+        ASSERT_TRUE(ch.send(3));   // waits for a slot
+        sent = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_TRUE(!sent.load());
+    ASSERT_EQ(*ch.receive(), 1);
+    sender.join();
+    ASSERT_TRUE(sent.load());
+    ASSERT_EQ(*ch.receive(), 2);
+    ASSERT_EQ(*ch.receive(), 3);
+    ASSERT_TRUE(!ch.tryReceive().has_value());
+}
+
+TEST(move_only_values) {
+    for (size_t cap : {size_t(0), size_t(4)}) {
+        Channel<std::unique_ptr<int>> ch(cap);
+        for (int i = 0; i < 4; ++i) ASSERT_TRUE(ch.send(std::make_unique<int>(i)));
+        for (int i = 0; i < 4; ++i) {
+            auto v = ch.receive();
+            ASSERT_TRUE(v && *v && **v == i);
+        }
+    }
+}
+
+TEST(close_wakes_and_drains) {
+    for (size_t cap : {size_t(0), size_t(8)}) {
+        Channel<int> ch(cap);
+        ch.send(7);
+        std::thread receiver([&] {
+            ASSERT_EQ(*ch.receive(), 7);
+            ASSERT_TRUE(!ch.receive().has_value());   // woken by close
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ch.close();
+        receiver.join();
+        ASSERT_TRUE(!ch.send(8));
+    }
+}
+
+TEST(producers_and_consumers_race) {
+    for (size_t cap : {size_t(0), size_t(1), size_t(64)}) {
+        Channel<int64_t> ch(cap);
+        const int kProducers = 4, kConsumers = 4, kPer = 20000;
+        std::atomic<int64_t> sum{0}, count{0};
+        std::vector<std::thread> threads;
+        for (int p = 0; p < kProducers; ++p) {
+            threads.emplace_back([&, p] {
+                for (int i = 0; i < kPer; ++i) ch.send(int64_t(p) * kPer + i);
+            });
+        }
+        for (int c = 0; c < kConsumers; ++c) {
+            threads.emplace_back([&] {
+                while (auto v = ch.receive()) {
+                    sum += *v;
+                    count++;
+                }
+            });
+        }
+        for (int p = 0; p < kProducers; ++p) threads[p].join();
+        ch.close();
+        for (size_t t = kProducers; t < threads.size(); ++t) threads[t].join();
+        const int64_t n = int64_t(kProducers) * kPer;
+        ASSERT_EQ(count.load(), n);
+        ASSERT_EQ(sum.load(), n * (n - 1) / 2);
+    }
+}
+
+TEST(receivers_park_their_goroutines) {
+    // More blocked receivers than workers: had they held their threads,
+    // the sending goroutine would never run.
+    Channel<int> ch(4);
+    std::atomic<int> got{0};
+    for (int i = 0; i < 16; ++i) {
+        tocin::runtime::executorSubmit([&] { got += *ch.receive(); });
+    }
+    tocin::runtime::executorSubmit([&] {
+        for (int i = 1; i <= 16; ++i) ch.send(i);
+    });
+    __tocin_join_all();
+    ASSERT_EQ(got.load(), 16 * 17 / 2);
+}
+
+TEST(select_takes_whichever_is_ready) {
+    Channel<int> a(4), b(0);
+    int from = -1, value = 0;
+    Select<Channel<int>, Channel<int>> sel(std::tie(a, b), [&](size_t i, int v) { from = int(i); value = v; });
+    ASSERT_EQ(sel.poll(), -1);
+    b.send(5);
+    ASSERT_EQ(sel.execute(), 1);
+    ASSERT_EQ(from, 1);
+    ASSERT_EQ(value, 5);
+
+    std::thread sender([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        a.send(9);
+    });
+    ASSERT_EQ(sel.execute(), 0);   // parked until the send
+    ASSERT_EQ(value, 9);
+    sender.join();
+
+    a.close();
+    b.close();
+    ASSERT_EQ(sel.execute(), -1);
+}
+
+int main() {
+    std::cout << "=== Channel Tests ===\n\n";
+
+    // Two workers, so parked goroutines visibly free theirs.
+    setenv("TOCIN_MAX_PROCS", "2", 1);
+
+    RUN_TEST(ring_is_bounded_and_fifo);
+    RUN_TEST(ring_destroys_what_it_still_holds);
+    RUN_TEST(bounded_channel_blocks_when_full);
+    RUN_TEST(move_only_values);
+    RUN_TEST(close_wakes_and_drains);
+    RUN_TEST(producers_and_consumers_race);
+    RUN_TEST(receivers_park_their_goroutines);
+    RUN_TEST(select_takes_whichever_is_ready);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
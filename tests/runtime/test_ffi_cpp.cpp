@@ -0,0 +1,122 @@
+// C++ FFI Tests for Tocin Compiler
+//
+// CppFFIImpl (src/ffi/ffi_cpp.h) calling into libc and libm: function
+// handles prepared once per signature, boxed and unboxed calls through
+// them, and callFunction reusing the cached call interface with string
+// arguments that stay valid for the whole call.
+
+#include "ffi/ffi_cpp.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using ffi::CppFFIImpl;
+using ffi::FFIValue;
+using CType = CppFFIImpl::CType;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static const char* kLibc = "libc.so.6";
+static const char* kLibm = "libm.so.6";
+
+static void setUp(CppFFIImpl& ffi) {
+    ASSERT_TRUE(ffi.initialize());
+    ASSERT_TRUE(ffi.loadLibrary(kLibc));
+    ASSERT_TRUE(ffi.loadLibrary(kLibm));
+    for (const char* fn : {"strlen", "abs", "labs", "strcmp"}) ASSERT_TRUE(ffi.registerFunction(kLibc, fn));
+    ASSERT_TRUE(ffi.registerFunction(kLibm, "pow"));
+}
+
+TEST(handles_are_prepared_once) {
+    CppFFIImpl ffi;
+    setUp(ffi);
+    auto pow = ffi.getFunctionHandle("pow", CType::Double, {CType::Double, CType::Double});
+    ASSERT_TRUE(pow != nullptr);
+    ASSERT_EQ(ffi.getFunctionHandle("pow", CType::Double, {CType::Double, CType::Double}), pow);
+    // Another signature for the same symbol is a different interface.
+    ASSERT_TRUE(ffi.getFunctionHandle("pow", CType::Double, {CType::Double}) != pow);
+    ASSERT_TRUE(ffi.getFunctionHandle("missing", CType::Void, {}) == nullptr);
+    ASSERT_TRUE(ffi.getFunctionHandle("abs", CType::Int32, {CType::Void}) == nullptr);
+    ffi.finalize();
+}
+
+TEST(call_handle_converts_by_signature) {
+    CppFFIImpl ffi;
+    setUp(ffi);
+    auto pow = ffi.getFunctionHandle("pow", CType::Double, {CType::Double, CType::Double});
+    auto abs = ffi.getFunctionHandle("abs", CType::Int32, {CType::Int32});
+    auto labs = ffi.getFunctionHandle("labs", CType::Int64, {CType::Int64});
+    auto strlen = ffi.getFunctionHandle("strlen", CType::Int64, {CType::Pointer});
+    auto strcmp = ffi.getFunctionHandle("strcmp", CType::Int32, {CType::Pointer, CType::Pointer});
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(ffi.callHandle(pow, {FFIValue(2.0), FFIValue(10.0)}).asDouble() == 1024.0);
+        ASSERT_EQ(ffi.callHandle(abs, {FFIValue(int64_t(-i))}).asInt64(), i);
+        ASSERT_EQ(ffi.callHandle(labs, {FFIValue(-(int64_t(1) << 40) - i)}).asInt64(), (int64_t(1) << 40) + i);
+        std::string s(i % 17, 'x');
+        ASSERT_EQ(ffi.callHandle(strlen, {FFIValue(s)}).asInt64(), i % 17);
+    }
+    // Negative int results come back sign-extended.
+    ASSERT_TRUE(ffi.callHandle(strcmp, {FFIValue(std::string("a")), FFIValue(std::string("b"))}).asInt64() < 0);
+    // The wrong number of arguments is refused rather than called.
+    ASSERT_TRUE(ffi.callHandle(abs, {}).isUndefined());
+    ASSERT_TRUE(ffi.hasError());
+    ffi.finalize();
+}
+
+TEST(raw_calls_skip_boxing) {
+    CppFFIImpl ffi;
+    setUp(ffi);
+    auto strlen = ffi.getFunctionHandle("strlen", CType::Int64, {CType::Pointer});
+    auto abs = ffi.getFunctionHandle("abs", CType::Int32, {CType::Int32});
+    const char* word = "tocin";
+    void* strlenArgs[] = {&word};
+    int64_t n = 0;
+    ffi.callHandleRaw(strlen, strlenArgs, &n);
+    ASSERT_EQ(n, 5);
+    int32_t x = -42;
+    void* absArgs[] = {&x};
+    ffi.callHandleRaw(abs, absArgs, &n);
+    ASSERT_EQ(n, 42);
+    ffi.finalize();
+}
+
+TEST(call_function_keeps_string_arguments_alive) {
+    CppFFIImpl ffi;
+    setUp(ffi);
+    // callFunction reads every result as a pointer: strcmp's 0 for equal
+    // strings comes back as no value, strlen's length as the pointer bits.
+    std::vector<FFIValue> args;
+    for (int i = 0; i < 8; ++i) args.push_back(FFIValue(std::string(100 + i, 'a' + i)));
+    FFIValue same = ffi.callFunction("strcmp", {args[3], FFIValue(std::string(103, 'd'))});
+    ASSERT_TRUE(same.isUndefined());
+    FFIValue len = ffi.callFunction("strlen", {args[7]});
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(len.asPointer()), 107u);
+    ffi.finalize();
+}
+
+int main() {
+    std::cout << "Running C++ FFI tests...\n";
+    RUN_TEST(handles_are_prepared_once);
+    RUN_TEST(call_handle_converts_by_signature);
+    RUN_TEST(raw_calls_skip_boxing);
+    RUN_TEST(call_function_keeps_string_arguments_alive);
+    std::cout << "All C++ FFI tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,194 @@
+// Python FFI Tests for Tocin Compiler
+//
+// PythonFFIImpl (src/ffi/ffi_python.h) buffer sharing: a Tocin array shared
+// as a memoryview is the array's own memory in both directions and stays
+// usable after the FFIValue is released while Python still holds it;
+// buffers coming back are the original array when they are a whole shared
+// view and a single copy otherwise; element types are checked. Then calls
+// from many threads at once, with the GIL free between calls and during a
+// sleeping call, and the subinterpreter pool where Python is 3.12+.
+
+#include "ffi/ffi_python.h"
+
+#include <Python.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using ffi::FFIValue;
+using ffi::PythonFFIImpl;
+using Element = PythonFFIImpl::ArrayElement;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static PythonFFIImpl py;
+
+// [i64 len][elems], the layout of a Tocin numeric array.
+template <typename T>
+static int64_t* makeArray(const std::vector<T>& xs) {
+    auto* a = static_cast<int64_t*>(std::malloc(8 * (xs.size() + 1)));
+    a[0] = static_cast<int64_t>(xs.size());
+    std::memcpy(a + 1, xs.data(), 8 * xs.size());
+    return a;
+}
+
+TEST(shared_array_is_the_same_memory) {
+    int64_t* a = makeArray<int64_t>({1, 2, 3, 4});
+    FFIValue view = py.shareArray(a, Element::Int64);
+    ASSERT_TRUE(view.isPointer());
+    py.executeCode("def bump(v):\n    v[1] = 20\n    return sum(v)\n");
+    ASSERT_EQ(py.callFunction("bump", {view}).asInt64(), 28);
+    ASSERT_EQ(a[2], 20);          // Python's write landed in the array
+    a[4] = 40;
+    ASSERT_EQ(py.callFunction("bump", {view}).asInt64(), 64);
+
+    // Whole views come back as the array itself; slices are copied.
+    ASSERT_TRUE(py.toTocinArray(view, Element::Int64) == a);
+    ASSERT_TRUE(py.toTocinArray(view, Element::Float64) == nullptr);
+    py.executeCode("def tail(v):\n    return v[2:]\n");
+    FFIValue tail = py.callFunction("tail", {view});
+    auto* t = static_cast<int64_t*>(py.toTocinArray(tail, Element::Int64));
+    ASSERT_TRUE(t && t != a && t[0] == 2 && t[1] == 3 && t[2] == 40);
+    std::free(t);
+    py.releaseObject(tail);
+    py.releaseObject(view);
+    std::free(a);
+}
+
+TEST(views_outlive_the_ffi_value) {
+    int64_t* a = makeArray<double>({0.5, 1.5, 2.5});
+    FFIValue view = py.shareArray(a, Element::Float64);
+    py.executeCode("kept = []\ndef keep(v):\n    kept.append(v)\n");
+    py.callFunction("keep", {view});
+    py.releaseObject(view);
+    // Python's reference still pins the array and reads it in place.
+    ASSERT_TRUE(py.eval("kept[0].format").asString() == "d");
+    ASSERT_TRUE(py.eval("sum(kept[0])").asDouble() == 4.5);
+    ASSERT_EQ(py.eval("kept[0].tolist()[2]").asDouble(), 2.5);
+    py.executeCode("kept.clear()\n");
+    std::free(a);
+}
+
+TEST(foreign_buffers_by_reference_and_copied) {
+    py.executeCode("import array\nxs = array.array('d', [i * 0.25 for i in range(1000)])\n"
+                   "ids = array.array('q', range(10))\nraw = b'12345678'\n");
+    FFIValue xs = py.getVariable("xs");
+    ASSERT_TRUE(xs.isPointer());
+    PythonFFIImpl::BufferRef ref;
+    ASSERT_TRUE(py.borrowBuffer(xs, Element::Float64, &ref));
+    ASSERT_EQ(ref.length, 1000);
+    ASSERT_TRUE(!ref.readonly);
+    const double* d = static_cast<const double*>(ref.data);
+    ASSERT_TRUE(d[999] == 249.75);
+    // While borrowed the exporter refuses to resize under us.
+    py.executeCode("try:\n    xs.append(1.0)\n    grew = True\nexcept BufferError:\n    grew = False\n");
+    ASSERT_TRUE(!py.eval("grew").asBoolean());
+    py.releaseBuffer(&ref);
+    ASSERT_TRUE(ref.data == nullptr);
+
+    auto* copy = static_cast<int64_t*>(py.toTocinArray(xs, Element::Float64));
+    ASSERT_TRUE(copy && copy[0] == 1000);
+    double last;
+    std::memcpy(&last, copy + 1000, 8);
+    ASSERT_TRUE(last == 249.75);
+    std::free(copy);
+
+    FFIValue ids = py.getVariable("ids");
+    ASSERT_TRUE(py.toTocinArray(ids, Element::Float64) == nullptr);
+    auto* i = static_cast<int64_t*>(py.toTocinArray(ids, Element::Int64));
+    ASSERT_TRUE(i && i[0] == 10 && i[10] == 9);
+    std::free(i);
+    // Bytes are not 8-byte elements.
+    FFIValue raw = py.getVariable("raw");
+    ASSERT_TRUE(!py.borrowBuffer(raw, Element::Int64, &ref));
+    py.releaseObject(raw);
+    py.releaseObject(ids);
+    py.releaseObject(xs);
+}
+
+TEST(threads_call_in_concurrently) {
+    py.executeCode("import time\ndef twice(x):\n    return x * 2\n"
+                   "def nap(s):\n    time.sleep(s)\n    return 'rested'\n");
+    ASSERT_TRUE(!PyGILState_Check());   // nobody holds the GIL between calls
+    std::atomic<int> wrong{0};
+    std::vector<std::thread> pool;
+    for (int t = 0; t < 8; ++t)
+        pool.emplace_back([&, t] {
+            for (int i = 0; i < 200; ++i)
+                if (py.callFunction("twice", {FFIValue(int64_t(t * 1000 + i))}).asInt64() != 2 * (t * 1000 + i))
+                    wrong.fetch_add(1);
+        });
+    for (auto& th : pool) th.join();
+    ASSERT_EQ(wrong.load(), 0);
+
+    // A sleeping call gives the GIL up, so other calls go on meanwhile.
+    auto start = std::chrono::steady_clock::now();
+    std::thread sleeper([] { ASSERT_TRUE(py.callFunction("nap", {FFIValue(0.3)}).asString() == "rested"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(py.callFunction("twice", {FFIValue(int64_t(21))}).asInt64(), 42);
+    ASSERT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(250));
+    sleeper.join();
+}
+
+TEST(interpreter_pool_runs_calls_in_parallel) {
+    if (!py.startInterpreterPool(4)) {
+        ASSERT_TRUE(PY_VERSION_HEX < 0x030C0000);
+        ASSERT_TRUE(py.callInPool("anything", {}).isUndefined());
+        std::cout << " (no per-interpreter GIL before Python 3.12)";
+        return;
+    }
+    ASSERT_EQ(py.interpreterPoolSize(), 4u);
+    ASSERT_TRUE(py.executeInPool("def spin(n):\n    total = 0\n    for i in range(n):\n        total += i\n"
+                                 "    return total\n"
+                                 "def pair(a, b):\n    return [a, b]\n"));
+    // The pool's interpreters do not see __main__ of the main one.
+    ASSERT_TRUE(py.callInPool("twice", {FFIValue(int64_t(1))}).isUndefined());
+    std::atomic<int> wrong{0};
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 8; ++t)
+        callers.emplace_back([&, t] {
+            for (int i = 0; i < 5; ++i) {
+                int64_t n = 20000 + t * 100 + i;
+                if (py.callInPool("spin", {FFIValue(n)}).asInt64() != n * (n - 1) / 2) wrong.fetch_add(1);
+            }
+        });
+    for (auto& th : callers) th.join();
+    ASSERT_EQ(wrong.load(), 0);
+    FFIValue pair = py.callInPool("pair", {FFIValue(std::string("a")), FFIValue(2.5)});
+    ASSERT_TRUE(pair.isArray() && pair.asArray().size() == 2 && pair.asArray()[0].asString() == "a");
+    py.stopInterpreterPool();
+    ASSERT_EQ(py.interpreterPoolSize(), 0u);
+}
+
+int main() {
+    std::cout << "Running Python FFI tests...\n";
+    py.initialize();
+    RUN_TEST(shared_array_is_the_same_memory);
+    RUN_TEST(views_outlive_the_ffi_value);
+    RUN_TEST(foreign_buffers_by_reference_and_copied);
+    RUN_TEST(threads_call_in_concurrently);
+    RUN_TEST(interpreter_pool_runs_calls_in_parallel);
+    std::cout << "All Python FFI tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,232 @@
+// File I/O Tests for Tocin Compiler
+//
+// Every FileIo backend available here (posix, and io_uring on Linux) run
+// through the same cases: whole-file round trips of empty, binary and
+// multi-megabyte contents, truncation, missing paths, and appends that keep
+// their descriptor open across writes, truncation, rotation and removal,
+// and synced appends to a caller's descriptor.
+// FileReader then reads back what each backend wrote, a record at a time.
+
+#include "runtime/file_io.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TEST(name) void test_##name(const tocin::runtime::FileIo& io)
+#define RUN_TEST(test) do { \
+    for (const auto* io : tocin::runtime::availableFileIo()) { \
+        std::cout << "Running test: " #test " [" << io->name << "]..."; \
+        test_##test(*io); \
+        tocin::runtime::closeAppendFiles(); \
+        std::cout << " PASSED\n"; \
+    } \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static std::string path(const char* name) {
+    return std::string("tocin_file_io_") + name + ".tmp";
+}
+
+static char* allocBytes(size_t size) {
+    return static_cast<char*>(std::malloc(size + 1));
+}
+
+static bool readBack(const tocin::runtime::FileIo& io, const std::string& p, std::string& out) {
+    size_t len = 0;
+    char* buf = io.readFile(p.c_str(), allocBytes, &len);
+    if (!buf) return false;
+    out.assign(buf, len);
+    std::free(buf);
+    return true;
+}
+
+static int64_t write(const tocin::runtime::FileIo& io, const std::string& p, const std::string& s) {
+    return io.writeFile(p.c_str(), s.data(), s.size());
+}
+
+static int64_t append(const tocin::runtime::FileIo& io, const std::string& p, const std::string& s) {
+    return io.appendFile(p.c_str(), s.data(), s.size());
+}
+
+TEST(round_trip_contents) {
+    std::string p = path("round_trip"), got;
+    ASSERT_EQ(write(io, p, ""), 0);
+    ASSERT_TRUE(readBack(io, p, got));
+    ASSERT_EQ(got, "");
+    std::string binary("a\0b\r\n\xff", 6);
+    ASSERT_EQ(write(io, p, binary), 6);
+    ASSERT_TRUE(readBack(io, p, got));
+    ASSERT_EQ(got, binary);
+    std::string big(3 << 20, 'x');
+    for (size_t i = 0; i < big.size(); i += 4093) big[i] = (char)('a' + i % 26);
+    ASSERT_EQ(write(io, p, big), (int64_t)big.size());
+    ASSERT_TRUE(readBack(io, p, got));
+    ASSERT_TRUE(got == big);
+    // Writing truncates what was there.
+    ASSERT_EQ(write(io, p, "short"), 5);
+    ASSERT_TRUE(readBack(io, p, got));
+    ASSERT_EQ(got, "short");
+    std::remove(p.c_str());
+}
+
+TEST(missing_paths_fail) {
+    std::string got;
+    ASSERT_TRUE(!readBack(io, "tocin_no_such_dir/x.tmp", got));
+    ASSERT_EQ(write(io, "tocin_no_such_dir/x.tmp", "x"), -1);
+    ASSERT_EQ(append(io, "tocin_no_such_dir/x.tmp", "x"), -1);
+}
+
+TEST(appends_accumulate) {
+    std::string p = path("append"), got, want;
+    std::remove(p.c_str());
+    for (int i = 0; i < 1000; ++i) {
+        std::string line = "line " + std::to_string(i) + "\n";
+        ASSERT_EQ(append(io, p, line), (int64_t)line.size());
+        want += line;
+    }
+    ASSERT_TRUE(readBack(io, p, got));
+    ASSERT_TRUE(got == want);
+    // Truncating keeps the cached descriptor appending at the new end.
+    ASSERT_EQ(write(io, p, "head\n"), 5);
+    ASSERT_EQ(append(io, p, "tail\n"), 5);
+    ASSERT_TRUE(readBack(io, p, got));
+    ASSERT_EQ(got, "head\ntail\n");
+    std::remove(p.c_str());
+}
+
+TEST(appends_follow_rotation) {
+    std::string p = path("rotate"), rotated = path("rotate_1"), got;
+    std::remove(p.c_str());
+    ASSERT_EQ(append(io, p, "old\n"), 4);
+    ASSERT_EQ(std::rename(p.c_str(), rotated.c_str()), 0);
+    ASSERT_EQ(append(io, p, "new\n"), 4);
+    ASSERT_TRUE(readBack(io, rotated, got));
+    ASSERT_EQ(got, "old\n");
+    ASSERT_TRUE(readBack(io, p, got));
+    ASSERT_EQ(got, "new\n");
+    // Removed files are recreated rather than appended to in limbo.
+    std::remove(p.c_str());
+    ASSERT_EQ(append(io, p, "again\n"), 6);
+    ASSERT_TRUE(readBack(io, p, got));
+    ASSERT_EQ(got, "again\n");
+    std::remove(p.c_str());
+    std::remove(rotated.c_str());
+}
+
+TEST(synced_appends_land_in_order) {
+    std::string p = path("sync"), got, want;
+    std::remove(p.c_str());
+    int fd = ::open(p.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0666);
+    ASSERT_TRUE(fd >= 0);
+    for (int i = 0; i < 50; ++i) {
+        std::string rec(1 + i * 37, (char)('a' + i % 26));
+        ASSERT_EQ(io.appendSync(fd, rec.data(), rec.size()), (int64_t)rec.size());
+        want += rec;
+    }
+    ASSERT_EQ(io.appendSync(fd, "", 0), 0);
+    ASSERT_TRUE(readBack(io, p, got));
+    ASSERT_TRUE(got == want);
+    ::close(fd);
+    ASSERT_EQ(io.appendSync(fd, "x", 1), -1); // closed descriptor
+    std::remove(p.c_str());
+}
+
+TEST(many_files_and_threads) {
+    // More paths than the descriptor cache holds, from several threads.
+    const int files = 40, threads = 4, rounds = 50;
+    for (int f = 0; f < files; ++f) std::remove(path(("many_" + std::to_string(f)).c_str()).c_str());
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+        pool.emplace_back([&io, t] {
+            for (int r = 0; r < rounds; ++r)
+                for (int f = 0; f < files; ++f)
+                    ASSERT_EQ(append(io, path(("many_" + std::to_string(f)).c_str()), std::string(1, (char)('a' + t))), 1);
+        });
+    }
+    for (auto& th : pool) th.join();
+    for (int f = 0; f < files; ++f) {
+        std::string p = path(("many_" + std::to_string(f)).c_str()), got;
+        ASSERT_TRUE(readBack(io, p, got));
+        ASSERT_EQ(got.size(), (size_t)(threads * rounds));
+        for (int t = 0; t < threads; ++t) {
+            size_t n = 0;
+            for (char c : got) n += c == (char)('a' + t);
+            ASSERT_EQ(n, (size_t)rounds);
+        }
+        std::remove(p.c_str());
+    }
+}
+
+TEST(reader_records_cross_refills) {
+    // Lines of every length up to a few buffers' worth, so records start
+    // and end on both sides of each refill.
+    using tocin::runtime::FileReader;
+    std::string p = path("reader"), all;
+    std::vector<size_t> lens;
+    for (size_t n = 1; all.size() < 3 * FileReader::kBufferSize; n = n * 3 / 2 + 7) {
+        lens.push_back(n % 5 == 0 ? 0 : n);
+        all += std::string(lens.back(), (char)('a' + lens.size() % 26)) + "\n";
+    }
+    all += "last";
+    ASSERT_EQ(write(io, p, all), (int64_t)all.size());
+    FileReader* r = FileReader::open(p.c_str());
+    ASSERT_TRUE(r != nullptr);
+    const char* data;
+    size_t len;
+    for (size_t i = 0; i < lens.size(); ++i) {
+        ASSERT_TRUE(r->nextRecord('\n', &data, &len));
+        ASSERT_EQ(len, lens[i]);
+        ASSERT_TRUE(len == 0 || (data[0] == data[len - 1] && data[0] == (char)('a' + (i + 1) % 26)));
+    }
+    ASSERT_TRUE(r->nextRecord('\n', &data, &len));
+    ASSERT_EQ(std::string(data, len), "last");
+    ASSERT_TRUE(r->atEnd());
+    ASSERT_TRUE(!r->nextRecord('\n', &data, &len));
+    delete r;
+    // Chunks see the same bytes, whether served from the buffer or not.
+    r = FileReader::open(p.c_str());
+    std::string got, chunk(2 * FileReader::kBufferSize, '\0');
+    int64_t n = r->read(&chunk[0], 10);
+    while (n > 0) {
+        got.append(chunk.data(), (size_t)n);
+        n = r->read(&chunk[0], got.size() % 2 ? chunk.size() : 4099);
+    }
+    ASSERT_EQ(n, 0);
+    ASSERT_TRUE(got == all);
+    delete r;
+    ASSERT_TRUE(FileReader::open("tocin_no_such_dir/x.tmp") == nullptr);
+    std::remove(p.c_str());
+}
+
+int main() {
+    std::cout << "=== File I/O Tests ===\n\n";
+    std::cout << "Backend in use: " << tocin::runtime::fileIo().name << "\n\n";
+
+    RUN_TEST(round_trip_contents);
+    RUN_TEST(missing_paths_fail);
+    RUN_TEST(appends_accumulate);
+    RUN_TEST(appends_follow_rotation);
+    RUN_TEST(synced_appends_land_in_order);
+    RUN_TEST(many_files_and_threads);
+    RUN_TEST(reader_records_cross_refills);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
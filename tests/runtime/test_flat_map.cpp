@@ -0,0 +1,327 @@
+// Flat Map Tests for Tocin Compiler
+//
+// The open-addressing table behind the runtime's map handles, checked
+// against std::unordered_map through the __tocin_map_* entry points: growth
+// across many rehashes, keys that collide in their low bits, string keys
+// compared by length (embedded NULs included) and reserve/capacity. Also the
+// wyhash behind string keys and the hashFast* / hashSeeded / hashCombine
+// builtins: every length and bit position reaching the result, and seeds.
+// And the intern table: one pointer per string, literals adopted as that
+// pointer, and maps sharing interned keys instead of copying them.
+
+#include "runtime/flat_map.h"
+#include "runtime/hash.h"
+
+#include <iostream>
+#include <bitset>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+void* __tocin_map_new();
+void __tocin_map_put(void* h, int64_t k, int64_t v);
+int64_t __tocin_map_get(void* h, int64_t k);
+int64_t __tocin_map_has(void* h, int64_t k);
+void __tocin_map_put_str(void* h, const char* k, int64_t v);
+int64_t __tocin_map_get_str(void* h, const char* k);
+int64_t __tocin_map_has_str(void* h, const char* k);
+int64_t __tocin_map_len(void* h);
+void __tocin_map_free(void* h);
+void __tocin_map_reserve(void* h, int64_t n);
+void __tocin_map_reserve_str(void* h, int64_t n);
+int64_t __tocin_map_capacity(void* h);
+int64_t __tocin_map_capacity_str(void* h);
+char* __tocin_buf_to_str(const char* p, int64_t n);
+int64_t __tocin_hash_fast(const void* p, int64_t n);
+int64_t __tocin_hash_fast_str(const char* s);
+int64_t __tocin_hash_seeded(const void* p, int64_t n, int64_t seed);
+int64_t __tocin_hash_str_seeded(const char* s, int64_t seed);
+int64_t __tocin_hash_combine(int64_t h, int64_t x);
+char* __tocin_intern(const char* s);
+void __tocin_intern_literals(const char* const* literals, int64_t n);
+int64_t __tocin_str_eq(const char* a, const char* b);
+int64_t __tocin_str_len(const char* s);
+void __tocin_str_free(char* s);
+}
+
+using tocin::runtime::wyhash;
+
+static char* S(const std::string& s) { return __tocin_buf_to_str(s.data(), (int64_t)s.size()); }
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+TEST(int_keys_match_unordered_map) {
+    std::mt19937_64 rng(5);
+    void* m = __tocin_map_new();
+    std::unordered_map<int64_t, int64_t> want;
+    for (int i = 0; i < 200000; ++i) {
+        // Small keys overwrite often; multiples of 2^20 share their low bits.
+        int64_t k = (i % 3 == 0) ? (int64_t)(rng() % 5000) : (int64_t)(rng() % 4096) << 20;
+        if (i % 7 == 0) k = -k;
+        int64_t v = (int64_t)rng();
+        __tocin_map_put(m, k, v);
+        want[k] = v;
+    }
+    ASSERT_EQ(__tocin_map_len(m), (int64_t)want.size());
+    for (const auto& kv : want) {
+        ASSERT_EQ(__tocin_map_has(m, kv.first), 1);
+        ASSERT_EQ(__tocin_map_get(m, kv.first), kv.second);
+    }
+    for (int i = 0; i < 10000; ++i) {
+        int64_t k = (int64_t)rng() | 1; // odd, and beyond the small range above
+        if (k >= 0 && k < 5000) continue;
+        ASSERT_EQ(__tocin_map_has(m, k), (int64_t)want.count(k));
+    }
+    ASSERT_EQ(__tocin_map_get(m, 123456789), 0);
+    __tocin_map_free(m);
+}
+
+TEST(string_keys_compare_by_length) {
+    void* m = __tocin_map_new();
+    __tocin_map_put_str(m, S("ab"), 1);
+    __tocin_map_put_str(m, S(std::string("ab\0c", 4)), 2);
+    __tocin_map_put_str(m, S(""), 3);
+    __tocin_map_put(m, 0, 4); // the int namespace is separate
+    ASSERT_EQ(__tocin_map_get_str(m, S("ab")), 1);
+    ASSERT_EQ(__tocin_map_get_str(m, S(std::string("ab\0c", 4))), 2);
+    ASSERT_EQ(__tocin_map_get_str(m, S("")), 3);
+    ASSERT_EQ(__tocin_map_has_str(m, S("a")), 0);
+    ASSERT_EQ(__tocin_map_len(m), 4);
+
+    std::unordered_map<std::string, int64_t> want;
+    for (int i = 0; i < 50000; ++i) {
+        std::string k = "key:" + std::to_string(i * 7 % 20011);
+        __tocin_map_put_str(m, S(k), i);
+        want[k] = i;
+    }
+    for (const auto& kv : want) ASSERT_EQ(__tocin_map_get_str(m, S(kv.first)), kv.second);
+    ASSERT_EQ(__tocin_map_len(m), (int64_t)want.size() + 4);
+    __tocin_map_free(m);
+}
+
+TEST(long_keys_differing_late) {
+    // Past 48 bytes the hash runs its three-lane loop; these keys differ
+    // only in their last few bytes.
+    void* m = __tocin_map_new();
+    const std::string prefix(200, 'x');
+    for (int i = 0; i < 5000; ++i) __tocin_map_put_str(m, S(prefix + std::to_string(i)), i);
+    for (int i = 0; i < 5000; ++i) ASSERT_EQ(__tocin_map_get_str(m, S(prefix + std::to_string(i))), i);
+    ASSERT_EQ(__tocin_map_has_str(m, S(prefix)), 0);
+    __tocin_map_free(m);
+}
+
+TEST(keys_outlive_the_callers_string) {
+    void* m = __tocin_map_new();
+    std::vector<char> buf{'k', '1'};
+    char* k = S(std::string(buf.begin(), buf.end()));
+    __tocin_map_put_str(m, k, 7);
+    k[1] = '2'; // the map holds its own copy
+    ASSERT_EQ(__tocin_map_get_str(m, S("k1")), 7);
+    ASSERT_EQ(__tocin_map_has_str(m, S("k2")), 0);
+    __tocin_map_free(m);
+}
+
+TEST(reserve_avoids_growth) {
+    void* m = __tocin_map_new();
+    ASSERT_EQ(__tocin_map_capacity(m), 0);
+    __tocin_map_reserve(m, 1000);
+    int64_t cap = __tocin_map_capacity(m);
+    ASSERT_TRUE(cap >= 1000);
+    for (int64_t i = 0; i < 1000; ++i) __tocin_map_put(m, i, i);
+    ASSERT_EQ(__tocin_map_capacity(m), cap);
+    __tocin_map_put(m, -1, 0);
+    for (int64_t i = 1001; i < cap; ++i) __tocin_map_put(m, i, i);
+    ASSERT_EQ(__tocin_map_capacity(m), cap);
+    __tocin_map_put(m, cap, 0); // one past: the table doubles
+    ASSERT_TRUE(__tocin_map_capacity(m) > cap);
+    ASSERT_EQ(__tocin_map_capacity_str(m), 0);
+    __tocin_map_reserve_str(m, 10);
+    ASSERT_TRUE(__tocin_map_capacity_str(m) >= 10);
+    for (int64_t i = 0; i <= cap; ++i) ASSERT_EQ(__tocin_map_has(m, i), i == 1000 ? 0 : 1);
+    __tocin_map_free(m);
+}
+
+TEST(table_probes_full_groups) {
+    // Every key lands in the same group with the same h2, so lookups must
+    // walk past full groups to later ones.
+    struct Slot {
+        uint64_t key;
+        uint64_t hash() const { return 0x55; }
+    };
+    tocin::runtime::FlatTable<Slot> t;
+    for (uint64_t i = 0; i < 300; ++i) {
+        auto r = t.findOrInsert(0x55, [i](const Slot& s) { return s.key == i; });
+        ASSERT_TRUE(r.second);
+        r.first->key = i;
+    }
+    for (uint64_t i = 0; i < 300; ++i)
+        ASSERT_TRUE(t.find(0x55, [i](const Slot& s) { return s.key == i; }) != nullptr);
+    ASSERT_TRUE(t.find(0x55, [](const Slot& s) { return s.key == 999; }) == nullptr);
+    uint64_t sum = 0;
+    t.forEach([&](const Slot& s) { sum += s.key; });
+    ASSERT_EQ(sum, 299u * 300 / 2);
+    ASSERT_EQ(t.size(), 300u);
+}
+
+TEST(fast_hash_sees_every_length_and_bit) {
+    // wyhash final 4's published test vectors.
+    ASSERT_EQ(wyhash("", 0, 0), 0x93228a4de0eec5a2ull);
+    ASSERT_EQ(wyhash("a", 1, 1), 0xc5bac3db178713c4ull);
+    ASSERT_EQ(wyhash("abc", 3, 2), 0xa97f2f7b1d9b3314ull);
+    ASSERT_EQ(wyhash("message digest", 14, 3), 0x786d1f1df3801df4ull);
+
+    std::vector<unsigned char> buf(300, 0);
+    std::set<uint64_t> seen;
+    for (size_t n = 0; n <= buf.size(); ++n) seen.insert(wyhash(buf.data(), n, 0));
+    ASSERT_EQ(seen.size(), buf.size() + 1); // zero bytes still count
+
+    // Flipping any one bit of a key changes about half the output bits.
+    for (size_t n : {3, 8, 13, 16, 40, 64, 200}) {
+        std::mt19937_64 rng(n);
+        for (auto& b : buf) b = (unsigned char)rng();
+        const uint64_t base = wyhash(buf.data(), n, 0);
+        size_t flipped = 0;
+        for (size_t bit = 0; bit < n * 8; ++bit) {
+            buf[bit / 8] ^= (unsigned char)(1u << (bit % 8));
+            uint64_t h = wyhash(buf.data(), n, 0);
+            buf[bit / 8] ^= (unsigned char)(1u << (bit % 8));
+            ASSERT_TRUE(h != base);
+            flipped += std::bitset<64>(h ^ base).count();
+        }
+        double mean = (double)flipped / (double)(n * 8);
+        ASSERT_TRUE(mean > 26 && mean < 38);
+    }
+}
+
+TEST(seeds_and_combine) {
+    const std::string k = "the quick brown fox jumps over the lazy dog";
+    char* s = S(k);
+    ASSERT_EQ(__tocin_hash_fast_str(s), __tocin_hash_fast(k.data(), (int64_t)k.size()));
+    ASSERT_EQ(__tocin_hash_fast(k.data(), (int64_t)k.size()), __tocin_hash_seeded(k.data(), (int64_t)k.size(), 0));
+    ASSERT_EQ(__tocin_hash_str_seeded(s, 42), __tocin_hash_seeded(k.data(), (int64_t)k.size(), 42));
+    ASSERT_TRUE(__tocin_hash_str_seeded(s, 1) != __tocin_hash_str_seeded(s, 2));
+    ASSERT_EQ(__tocin_hash_fast_str(nullptr), __tocin_hash_fast(nullptr, 0));
+
+    const int64_t a = __tocin_hash_fast_str(S("a")), b = __tocin_hash_fast_str(S("b"));
+    ASSERT_TRUE(__tocin_hash_combine(a, b) != __tocin_hash_combine(b, a));
+    ASSERT_TRUE(__tocin_hash_combine(0, 0) != 0);
+    std::set<int64_t> seen;
+    for (int64_t x = 0; x < 10000; ++x) seen.insert(__tocin_hash_combine(a, x));
+    ASSERT_EQ(seen.size(), 10000u);
+}
+
+// What the compiler emits for a string literal: the header, cap -1, then
+// the bytes.
+struct alignas(16) Literal {
+    int64_t len;
+    int64_t cap;
+    char bytes[32];
+};
+
+TEST(interned_strings_share_one_pointer) {
+    char* a = S("interned-key");
+    char* b = S("interned-key");
+    char* ia = __tocin_intern(a);
+    ASSERT_TRUE(ia != a);
+    ASSERT_TRUE(__tocin_intern(b) == ia);
+    ASSERT_TRUE(__tocin_intern(ia) == ia);
+    __tocin_str_free(a);
+    __tocin_str_free(b);
+    __tocin_str_free(ia); // never freed: the table keeps it
+    ASSERT_EQ(std::string(ia), "interned-key");
+    ASSERT_EQ(__tocin_str_len(ia), 12);
+
+    char* other = __tocin_intern(S("interned-kez"));
+    ASSERT_EQ(__tocin_str_eq(ia, other), 0);
+    ASSERT_EQ(__tocin_str_eq(ia, S("interned-key")), 1);
+    ASSERT_EQ(__tocin_str_len(__tocin_intern(nullptr)), 0);
+
+    // Threads interning the same strings all get the same pointers.
+    std::vector<std::vector<char*>> got(4);
+    std::vector<std::thread> threads;
+    for (auto& g : got)
+        threads.emplace_back([&g] {
+            for (int i = 0; i < 1000; ++i) g.push_back(__tocin_intern(S("t" + std::to_string(i))));
+        });
+    for (auto& t : threads) t.join();
+    for (auto& g : got) ASSERT_TRUE(g == got[0]);
+}
+
+TEST(literals_are_their_own_interned_copy) {
+    static const Literal registered = {12, -1, "lit-register"};
+    static const Literal asKey = {10, -1, "lit-mapkey"};
+    const char* table[] = {registered.bytes};
+    __tocin_intern_literals(table, 1);
+    ASSERT_TRUE(__tocin_intern(S("lit-register")) == registered.bytes);
+
+    // A literal map key is interned too, so the map holds no copy of it.
+    void* m = __tocin_map_new();
+    __tocin_map_put_str(m, asKey.bytes, 7);
+    ASSERT_TRUE(__tocin_intern(S("lit-mapkey")) == asKey.bytes);
+    ASSERT_EQ(__tocin_map_get_str(m, S("lit-mapkey")), 7);
+    ASSERT_EQ(__tocin_map_get_str(m, asKey.bytes), 7);
+    ASSERT_EQ(__tocin_map_has_str(m, __tocin_intern(S("lit-mapkez"))), 0);
+    __tocin_map_free(m);
+    ASSERT_EQ(std::string(asKey.bytes), "lit-mapkey");
+}
+
+TEST(maps_share_interned_keys) {
+    void* m = __tocin_map_new();
+    std::vector<char*> keys;
+    for (int i = 0; i < 500; ++i) {
+        keys.push_back(__tocin_intern(S("key" + std::to_string(i))));
+        __tocin_map_put_str(m, keys.back(), i);
+    }
+    // Plain strings with the same bytes find them, and overwrite in place.
+    for (int i = 0; i < 500; ++i) {
+        ASSERT_EQ(__tocin_map_get_str(m, keys[i]), i);
+        ASSERT_EQ(__tocin_map_get_str(m, S("key" + std::to_string(i))), i);
+    }
+    __tocin_map_put_str(m, S("key7"), 70);
+    ASSERT_EQ(__tocin_map_get_str(m, keys[7]), 70);
+    ASSERT_EQ(__tocin_map_len(m), 500);
+    ASSERT_EQ(__tocin_map_has_str(m, __tocin_intern(S("key500"))), 0);
+    __tocin_map_free(m);
+    // The map left the shared keys alone.
+    ASSERT_TRUE(__tocin_intern(S("key499")) == keys[499]);
+    ASSERT_EQ(std::string(keys[499]), "key499");
+}
+
+int main() {
+    std::cout << "=== Flat Map Tests ===\n\n";
+
+    RUN_TEST(int_keys_match_unordered_map);
+    RUN_TEST(string_keys_compare_by_length);
+    RUN_TEST(long_keys_differing_late);
+    RUN_TEST(keys_outlive_the_callers_string);
+    RUN_TEST(reserve_avoids_growth);
+    RUN_TEST(table_probes_full_groups);
+    RUN_TEST(fast_hash_sees_every_length_and_bit);
+    RUN_TEST(seeds_and_combine);
+    RUN_TEST(interned_strings_share_one_pointer);
+    RUN_TEST(literals_are_their_own_interned_copy);
+    RUN_TEST(maps_share_interned_keys);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
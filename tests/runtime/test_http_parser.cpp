@@ -0,0 +1,276 @@
+// HTTP Parser Tests for Tocin Compiler
+//
+// The request-head parser and chunked decoder behind httpParse and the
+// httpConn* builtins: heads fed one byte at a time, pipelined requests in a
+// single buffer, header values long enough to take the 16-byte scan,
+// keep-alive per version and Connection header, malformed and smuggling-prone
+// framing, chunked bodies split across reads at every offset, and the
+// response heads the pooled client reads.
+
+#include "runtime/http_parser.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace tocin::runtime;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static std::string span(const std::string& buf, HttpSpan s) { return buf.substr(s.off, s.len); }
+
+static int64_t parse(const std::string& buf, HttpRequestHead& head, size_t off = 0) {
+    return parseHttpRequest(buf.data(), off, buf.size() - off, &head);
+}
+
+static std::string header(const std::string& buf, const HttpMessageHead& head, const char* name) {
+    for (size_t i = 0; i < head.headerCount; ++i)
+        if (httpHeaderIs(buf.data(), head.headers[i], name)) return span(buf, head.headers[i].value);
+    return "<none>";
+}
+
+TEST(simple_get) {
+    std::string req = "GET /index.html?q=1 HTTP/1.1\r\nHost: example.com\r\nAccept:  */*  \r\n\r\n";
+    HttpRequestHead head;
+    ASSERT_EQ(parse(req, head), (int64_t)req.size());
+    ASSERT_EQ(span(req, head.method), "GET");
+    ASSERT_EQ(span(req, head.path), "/index.html?q=1");
+    ASSERT_EQ(head.minorVersion, 1);
+    ASSERT_EQ(head.headerCount, 2u);
+    ASSERT_EQ(header(req, head, "host"), "example.com");
+    ASSERT_EQ(header(req, head, "accept"), "*/*");
+    ASSERT_EQ(head.contentLength, -1);
+    ASSERT_TRUE(!head.chunked);
+    ASSERT_TRUE(head.keepAlive);
+}
+
+TEST(incomplete_until_the_blank_line) {
+    std::string req = "POST /submit HTTP/1.1\r\nContent-Length: 5\r\nX-Long: "
+                      + std::string(300, 'v') + "\r\n\r\nhello";
+    size_t headLen = req.size() - 5;
+    HttpRequestHead head;
+    for (size_t n = 0; n < headLen; ++n)
+        ASSERT_EQ(parseHttpRequest(req.data(), 0, n, &head), kHttpIncomplete);
+    ASSERT_EQ(parseHttpRequest(req.data(), 0, headLen, &head), (int64_t)headLen);
+    ASSERT_EQ(head.contentLength, 5);
+    ASSERT_EQ(header(req, head, "x-long").size(), 300u);
+}
+
+TEST(bare_lf_and_leading_blank_line) {
+    std::string req = "\r\nGET / HTTP/1.0\nConnection: Keep-Alive\n\n";
+    HttpRequestHead head;
+    ASSERT_EQ(parse(req, head), (int64_t)req.size());
+    ASSERT_EQ(span(req, head.path), "/");
+    ASSERT_EQ(head.minorVersion, 0);
+    ASSERT_TRUE(head.keepAlive);
+}
+
+TEST(pipelined_requests) {
+    std::string one = "GET /a HTTP/1.1\r\nHost: h\r\n\r\n";
+    std::string two = "GET /b HTTP/1.1\r\nConnection: close\r\n\r\n";
+    std::string buf = one + two + "GET /c HT";
+    HttpRequestHead head;
+    int64_t n = parse(buf, head);
+    ASSERT_EQ(n, (int64_t)one.size());
+    ASSERT_EQ(span(buf, head.path), "/a");
+    int64_t m = parse(buf, head, (size_t)n);
+    ASSERT_EQ(m, (int64_t)two.size());
+    ASSERT_EQ(span(buf, head.path), "/b");
+    ASSERT_TRUE(!head.keepAlive);
+    ASSERT_EQ(parse(buf, head, (size_t)(n + m)), kHttpIncomplete);
+}
+
+TEST(keep_alive_rules) {
+    HttpRequestHead head;
+    std::string a = "GET / HTTP/1.0\r\n\r\n";
+    ASSERT_TRUE(parse(a, head) > 0 && !head.keepAlive);
+    std::string b = "GET / HTTP/1.1\r\nConnection: upgrade, CLOSE\r\n\r\n";
+    ASSERT_TRUE(parse(b, head) > 0 && !head.keepAlive);
+    std::string c = "GET / HTTP/1.1\r\nConnection: keep-alive\r\n\r\n";
+    ASSERT_TRUE(parse(c, head) > 0 && head.keepAlive);
+}
+
+TEST(framing) {
+    HttpRequestHead head;
+    std::string chunked = "POST / HTTP/1.1\r\nTransfer-Encoding: gzip, Chunked\r\n\r\n";
+    ASSERT_TRUE(parse(chunked, head) > 0 && head.chunked);
+    std::string both = "POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n";
+    ASSERT_EQ(parse(both, head), kHttpMalformed);
+    std::string notLast = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n";
+    ASSERT_EQ(parse(notLast, head), kHttpMalformed);
+    std::string twice = "POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 4\r\n\r\n";
+    ASSERT_EQ(parse(twice, head), kHttpMalformed);
+    std::string same = "POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 3\r\n\r\n";
+    ASSERT_TRUE(parse(same, head) > 0 && head.contentLength == 3);
+    std::string sign = "POST / HTTP/1.1\r\nContent-Length: +3\r\n\r\n";
+    ASSERT_EQ(parse(sign, head), kHttpMalformed);
+}
+
+TEST(malformed_heads) {
+    const char* bad[] = {
+        "GET  / HTTP/1.1\r\n\r\n",          // empty target
+        "GET /\x01 HTTP/1.1\r\n\r\n",       // control byte in the target
+        "GET / HTTP/2.0\r\n\r\n",
+        "GET / HTTP/1.1\r\nHost : h\r\n\r\n", // space before the colon
+        "GET / HTTP/1.1\r\nA: b\r\n folded\r\n\r\n",
+        "GET / HTTP/1.1\r\nA: b\x7f\r\n\r\n",
+        "GET / HTTP/1.1\r\n: v\r\n\r\n",
+        "G(ET / HTTP/1.1\r\n\r\n",
+    };
+    for (const char* s : bad) {
+        HttpRequestHead head;
+        std::string req(s);
+        ASSERT_EQ(parse(req, head), kHttpMalformed);
+    }
+    // A first byte that cannot start a method fails before the head is in.
+    HttpRequestHead head;
+    std::string early = "\x16\x03\x01";
+    ASSERT_EQ(parse(early, head), kHttpMalformed);
+}
+
+TEST(header_limit) {
+    std::string req = "GET / HTTP/1.1\r\n";
+    for (size_t i = 0; i < kHttpMaxHeaders; ++i) req += "H" + std::to_string(i) + ": v\r\n";
+    HttpRequestHead head;
+    std::string ok = req + "\r\n";
+    ASSERT_EQ(parse(ok, head), (int64_t)ok.size());
+    ASSERT_EQ(head.headerCount, kHttpMaxHeaders);
+    std::string over = req + "One-More: v\r\n\r\n";
+    ASSERT_EQ(parse(over, head), kHttpMalformed);
+}
+
+TEST(tab_in_values_and_obs_text) {
+    std::string req = "GET / HTTP/1.1\r\nX: a\tb \xc3\xa9" + std::string(40, 'z') + "\t\r\n\r\n";
+    HttpRequestHead head;
+    ASSERT_EQ(parse(req, head), (int64_t)req.size());
+    ASSERT_EQ(header(req, head, "x"), "a\tb \xc3\xa9" + std::string(40, 'z'));
+}
+
+static const std::string kChunked =
+    "5\r\nhello\r\n7;ext=1\r\n, world\r\n0\r\nTrailer: x\r\n\r\nGET /next";
+
+TEST(chunked_whole) {
+    std::string buf = kChunked;
+    size_t len = buf.size();
+    HttpChunkedDecoder d;
+    int64_t rest = d.decode(&buf[0], &len);
+    ASSERT_EQ(rest, 9);
+    ASSERT_EQ(buf.substr(0, len), "hello, world");
+    ASSERT_EQ(buf.substr(len, 9), "GET /next");
+}
+
+TEST(chunked_split_everywhere) {
+    for (size_t cut = 0; cut <= kChunked.size(); ++cut) {
+        std::string a = kChunked.substr(0, cut), b = kChunked.substr(cut);
+        HttpChunkedDecoder d;
+        size_t alen = a.size();
+        int64_t r = d.decode(&a[0], &alen);
+        std::string body = a.substr(0, alen), rest;
+        if (r == kHttpIncomplete) {
+            size_t blen = b.size();
+            r = d.decode(&b[0], &blen);
+            body += b.substr(0, blen);
+            rest = b.substr(blen, r < 0 ? 0 : (size_t)r);
+        } else {
+            rest = a.substr(alen, (size_t)r) + b;
+        }
+        ASSERT_EQ(body, "hello, world");
+        ASSERT_EQ(rest, "GET /next");
+    }
+}
+
+TEST(chunked_malformed) {
+    const char* bad[] = {"zz\r\n", "5\r\nhelloX", "\r\n", "10000000000000000\r\n"};
+    for (const char* s : bad) {
+        std::string buf(s);
+        size_t len = buf.size();
+        HttpChunkedDecoder d;
+        ASSERT_EQ(d.decode(&buf[0], &len), kHttpMalformed);
+    }
+}
+
+TEST(response_heads) {
+    std::string r = "HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\nServer: t\r\n\r\nnot found";
+    HttpResponseHead head;
+    ASSERT_EQ(parseHttpResponse(r.data(), 0, r.size(), &head), (int64_t)r.size() - 9);
+    ASSERT_EQ(head.status, 404);
+    ASSERT_EQ(span(r, head.reason), "Not Found");
+    ASSERT_EQ(head.contentLength, 9);
+    ASSERT_EQ(header(r, head, "server"), "t");
+    ASSERT_TRUE(head.keepAlive && !head.untilClose && !head.noBody);
+
+    // Incomplete until the blank line, at every prefix.
+    for (size_t n = 0; n < r.size() - 9; ++n)
+        ASSERT_EQ(parseHttpResponse(r.data(), 0, n, &head), kHttpIncomplete);
+
+    std::string empty = "HTTP/1.1 200\r\n\r\n";
+    ASSERT_EQ(parseHttpResponse(empty.data(), 0, empty.size(), &head), (int64_t)empty.size());
+    ASSERT_EQ(head.status, 200);
+    ASSERT_EQ(head.reason.len, 0u);
+    ASSERT_TRUE(head.untilClose && !head.keepAlive);
+
+    for (const char* bad : {"HTTP/2 200 OK\r\n\r\n", "HTTP/1.1 20 OK\r\n\r\n", "HTTP/1.1 abc OK\r\n\r\n",
+                            "HTTP/1.1 099 x\r\n\r\n", "SSH-2.0\r\n\r\n", "XTTP"}) {
+        std::string b = bad;
+        ASSERT_EQ(parseHttpResponse(b.data(), 0, b.size(), &head), kHttpMalformed);
+    }
+}
+
+TEST(response_framing) {
+    HttpResponseHead head;
+    auto parseResp = [&](const std::string& r) { return parseHttpResponse(r.data(), 0, r.size(), &head); };
+    // Transfer-Encoding wins over Content-Length instead of failing.
+    ASSERT_TRUE(parseResp("HTTP/1.1 200 OK\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n") > 0);
+    ASSERT_TRUE(head.chunked && head.contentLength == -1 && head.keepAlive);
+    ASSERT_TRUE(parseResp("HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip\r\n\r\n") > 0);
+    ASSERT_TRUE(head.untilClose && !head.keepAlive);
+    for (const char* none : {"HTTP/1.1 204 No Content\r\nContent-Length: 5\r\n\r\n",
+                             "HTTP/1.1 304 Not Modified\r\nTransfer-Encoding: chunked\r\n\r\n",
+                             "HTTP/1.1 100 Continue\r\n\r\n"}) {
+        ASSERT_TRUE(parseResp(none) > 0);
+        ASSERT_TRUE(head.noBody && !head.chunked && head.contentLength == -1 && !head.untilClose);
+    }
+    ASSERT_TRUE(parseResp("HTTP/1.0 200 OK\r\nContent-Length: 0\r\nConnection: keep-alive\r\n\r\n") > 0);
+    ASSERT_TRUE(head.keepAlive && head.minorVersion == 0);
+    ASSERT_TRUE(parseResp("HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: close\r\n\r\n") > 0);
+    ASSERT_TRUE(!head.keepAlive);
+    ASSERT_EQ(parseResp("HTTP/1.1 200 OK\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n"), kHttpMalformed);
+}
+
+int main() {
+    std::cout << "=== HTTP Parser Tests ===\n\n";
+
+    RUN_TEST(simple_get);
+    RUN_TEST(incomplete_until_the_blank_line);
+    RUN_TEST(bare_lf_and_leading_blank_line);
+    RUN_TEST(pipelined_requests);
+    RUN_TEST(keep_alive_rules);
+    RUN_TEST(framing);
+    RUN_TEST(malformed_heads);
+    RUN_TEST(header_limit);
+    RUN_TEST(tab_in_values_and_obs_text);
+    RUN_TEST(chunked_whole);
+    RUN_TEST(chunked_split_everywhere);
+    RUN_TEST(chunked_malformed);
+    RUN_TEST(response_heads);
+    RUN_TEST(response_framing);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
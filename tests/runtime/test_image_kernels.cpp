@@ -0,0 +1,227 @@
+// Image Kernel Tests for Tocin Compiler
+//
+// Every kernel table the CPU supports is checked row kernel by row kernel
+// against the scalar formulas on lengths around the vector widths, and the
+// filters and resizes against per-pixel references written the way
+// ml.computer_vision used to compute them: the window sum over clamped
+// coordinates, Sobel from getPixel, nearest from x * sw / dw. Images large
+// enough to be split over the parallel pool are included.
+
+#include "runtime/image_kernels.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+extern "C" {
+int64_t __tocin_img_box_blur(int64_t src, int64_t dst, int64_t width, int64_t height, int64_t radius);
+int64_t __tocin_img_sobel(int64_t src, int64_t dst, int64_t width, int64_t height);
+int64_t __tocin_img_resize(int64_t src, int64_t sw, int64_t sh, int64_t dst, int64_t dw, int64_t dh,
+                           int64_t mode);
+}
+
+using tocin::runtime::GrayImage;
+using tocin::runtime::ImageKernels;
+using tocin::runtime::ResizeMode;
+
+static const ImageKernels *kernels = nullptr;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " (" << (kernels ? kernels->name : "-") \
+                  << ") at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static std::vector<uint8_t> noise(size_t n, uint32_t seed) {
+    std::vector<uint8_t> v(n);
+    for (auto &b : v) {
+        seed = seed * 1664525u + 1013904223u;
+        b = static_cast<uint8_t>(seed >> 24);
+    }
+    return v;
+}
+
+static int64_t clampi(int64_t v, int64_t hi) { return v < 0 ? 0 : v > hi ? hi : v; }
+
+static uint8_t at(const std::vector<uint8_t> &img, int64_t w, int64_t h, int64_t x, int64_t y) {
+    return img[clampi(y, h - 1) * w + clampi(x, w - 1)];
+}
+
+TEST(row_kernels_match_scalar) {
+    const size_t lengths[] = {0, 1, 2, 7, 8, 9, 15, 16, 17, 31, 33, 100};
+    for (size_t n : lengths) {
+        auto a = noise(n + 2, 1), b = noise(n + 2, 2), c = noise(n + 2, 3);
+        std::vector<uint32_t> acc(n + 1, 1000), want(n + 1, 1000);
+        kernels->addRow(acc.data(), a.data(), n);
+        for (size_t i = 0; i < n; ++i) want[i] += a[i];
+        ASSERT_TRUE(acc == want);
+        kernels->slideRow(acc.data(), b.data(), a.data(), n);
+        for (size_t i = 0; i < n; ++i) want[i] += b[i] - a[i];
+        ASSERT_TRUE(acc == want);
+
+        std::vector<uint8_t> out(n + 1, 7);
+        kernels->sobelRow(out.data(), a.data() + 1, b.data() + 1, c.data() + 1, n);
+        for (size_t i = 0; i < n; ++i) {
+            int gx = (a[i + 2] + 2 * b[i + 2] + c[i + 2]) - (a[i] + 2 * b[i] + c[i]);
+            int gy = (c[i] + 2 * c[i + 1] + c[i + 2]) - (a[i] + 2 * a[i + 1] + a[i + 2]);
+            int mag = std::abs(gx) + std::abs(gy);
+            ASSERT_EQ(out[i], mag > 255 ? 255 : mag);
+        }
+        ASSERT_EQ(out[n], 7);
+
+        std::vector<uint16_t> top(n), bottom(n);
+        for (size_t i = 0; i < n; ++i) {
+            top[i] = a[i];
+            bottom[i] = b[i];
+        }
+        for (uint32_t fy : {0u, 1u, 77u, 128u, 255u, 256u}) {
+            out.assign(n + 1, 7);
+            kernels->lerpRows(out.data(), top.data(), bottom.data(), n, fy);
+            for (size_t i = 0; i < n; ++i) ASSERT_EQ(out[i], (a[i] * (256 - fy) + b[i] * fy + 128) >> 8);
+            ASSERT_EQ(out[n], 7);
+        }
+    }
+}
+
+TEST(box_blur_matches_window_mean) {
+    const int64_t sizes[][2] = {{1, 1}, {1, 9}, {9, 1}, {5, 4}, {37, 23}, {700, 600}};
+    for (auto &s : sizes) {
+        int64_t w = s[0], h = s[1];
+        auto src = noise(w * h, 11);
+        for (int64_t r : {0, 1, 2, 5, 40}) {
+            if (w * h > 10000 && r > 2) continue;  // the reference is O(r^2) a pixel
+            std::vector<uint8_t> dst(w * h, 0);
+            boxBlur(*kernels, {src.data(), w, h}, {dst.data(), w, h}, r);
+            for (int64_t y = 0; y < h; ++y)
+                for (int64_t x = 0; x < w; ++x) {
+                    int64_t sum = 0;
+                    for (int64_t dy = -r; dy <= r; ++dy)
+                        for (int64_t dx = -r; dx <= r; ++dx) sum += at(src, w, h, x + dx, y + dy);
+                    ASSERT_EQ(dst[y * w + x], sum / ((2 * r + 1) * (2 * r + 1)));
+                }
+        }
+    }
+}
+
+TEST(sobel_matches_get_pixel) {
+    const int64_t sizes[][2] = {{1, 1}, {2, 3}, {3, 2}, {19, 17}, {33, 5}, {640, 480}};
+    for (auto &s : sizes) {
+        int64_t w = s[0], h = s[1];
+        auto src = noise(w * h, 5);
+        std::vector<uint8_t> dst(w * h, 0);
+        sobel(*kernels, {src.data(), w, h}, {dst.data(), w, h});
+        for (int64_t y = 0; y < h; ++y)
+            for (int64_t x = 0; x < w; ++x) {
+                auto p = [&](int64_t dx, int64_t dy) { return int(at(src, w, h, x + dx, y + dy)); };
+                int gx = -p(-1, -1) - 2 * p(-1, 0) - p(-1, 1) + p(1, -1) + 2 * p(1, 0) + p(1, 1);
+                int gy = -p(-1, -1) - 2 * p(0, -1) - p(1, -1) + p(-1, 1) + 2 * p(0, 1) + p(1, 1);
+                int mag = std::abs(gx) + std::abs(gy);
+                ASSERT_EQ(dst[y * w + x], mag > 255 ? 255 : mag);
+            }
+    }
+}
+
+TEST(resizes) {
+    const int64_t shapes[][4] = {{1, 1, 3, 2}, {8, 8, 4, 4}, {5, 7, 13, 3}, {64, 48, 17, 31},
+                                 {640, 360, 1280, 720}, {1280, 720, 640, 360}};
+    for (auto &s : shapes) {
+        int64_t sw = s[0], sh = s[1], dw = s[2], dh = s[3];
+        auto src = noise(sw * sh, 9);
+        std::vector<uint8_t> dst(dw * dh);
+        GrayImage in{src.data(), sw, sh}, out{dst.data(), dw, dh};
+
+        resize(*kernels, in, out, ResizeMode::Nearest);
+        for (int64_t y = 0; y < dh; ++y)
+            for (int64_t x = 0; x < dw; ++x) ASSERT_EQ(dst[y * dw + x], src[(y * sh / dh) * sw + x * sw / dw]);
+
+        resize(*kernels, in, out, ResizeMode::Area);
+        for (int64_t y = 0; y < dh; ++y)
+            for (int64_t x = 0; x < dw; ++x) {
+                int64_t y0 = y * sh / dh, y1 = std::max((y + 1) * sh / dh, y0 + 1);
+                int64_t x0 = x * sw / dw, x1 = std::max((x + 1) * sw / dw, x0 + 1);
+                int64_t sum = 0, count = (y1 - y0) * (x1 - x0);
+                for (int64_t sy = y0; sy < y1; ++sy)
+                    for (int64_t sx = x0; sx < x1; ++sx) sum += src[sy * sw + sx];
+                ASSERT_EQ(dst[y * dw + x], (sum + count / 2) / count);
+            }
+
+        // Bilinear within one level of the exact pixel-centre interpolation.
+        resize(*kernels, in, out, ResizeMode::Bilinear);
+        for (int64_t y = 0; y < dh; ++y)
+            for (int64_t x = 0; x < dw; ++x) {
+                double fx = std::max((x + 0.5) * sw / dw - 0.5, 0.0), fy = std::max((y + 0.5) * sh / dh - 0.5, 0.0);
+                int64_t x0 = std::min<int64_t>(int64_t(fx), sw - 1), y0 = std::min<int64_t>(int64_t(fy), sh - 1);
+                int64_t x1 = std::min(x0 + 1, sw - 1), y1 = std::min(y0 + 1, sh - 1);
+                double ax = x0 == sw - 1 ? 0 : fx - x0, ay = y0 == sh - 1 ? 0 : fy - y0;
+                double top = src[y0 * sw + x0] * (1 - ax) + src[y0 * sw + x1] * ax;
+                double bottom = src[y1 * sw + x0] * (1 - ax) + src[y1 * sw + x1] * ax;
+                double want = top * (1 - ay) + bottom * ay;
+                double got = dst[y * dw + x];
+                ASSERT_TRUE(got >= want - 1.5 && got <= want + 1.5);
+            }
+    }
+
+    // A flat image stays flat under every mode.
+    std::vector<uint8_t> flat(30 * 20, 200), out(7 * 11);
+    for (auto mode : {ResizeMode::Nearest, ResizeMode::Bilinear, ResizeMode::Area}) {
+        resize(*kernels, {flat.data(), 30, 20}, {out.data(), 7, 11}, mode);
+        for (uint8_t b : out) ASSERT_EQ(b, 200);
+    }
+}
+
+TEST(entry_points) {
+    auto src = noise(12 * 10, 3);
+    std::vector<uint8_t> a(12 * 10), b(12 * 10);
+    auto addr = [](std::vector<uint8_t> &v) { return reinterpret_cast<int64_t>(v.data()); };
+    __tocin_img_box_blur(addr(src), addr(a), 12, 10, 1);
+    boxBlur(*kernels, {src.data(), 12, 10}, {b.data(), 12, 10}, 1);
+    ASSERT_TRUE(a == b);
+    __tocin_img_sobel(addr(src), addr(a), 12, 10);
+    sobel(*kernels, {src.data(), 12, 10}, {b.data(), 12, 10});
+    ASSERT_TRUE(a == b);
+    std::vector<uint8_t> small(6 * 5, 0), want(6 * 5);
+    __tocin_img_resize(addr(src), 12, 10, addr(small), 6, 5, 2);
+    resize(*kernels, {src.data(), 12, 10}, {want.data(), 6, 5}, ResizeMode::Area);
+    ASSERT_TRUE(small == want);
+    __tocin_img_resize(addr(src), 12, 10, addr(small), 6, 5, 9);  // unknown mode: nearest
+    ASSERT_EQ(small[6 + 1], src[2 * 12 + 2]);
+
+    // Empty or mismatched images are left alone.
+    a.assign(a.size(), 9);
+    __tocin_img_box_blur(addr(src), addr(a), 0, 10, 1);
+    __tocin_img_sobel(addr(src), addr(a), 12, -1);
+    __tocin_img_resize(0, 12, 10, addr(a), 12, 10, 0);
+    for (uint8_t v : a) ASSERT_EQ(v, 9);
+    boxBlur(*kernels, {src.data(), 12, 10}, {a.data(), 10, 12}, 1);
+    for (uint8_t v : a) ASSERT_EQ(v, 9);
+}
+
+int main() {
+    std::cout << "=== Image Kernel Tests ===\n\n";
+
+    for (const ImageKernels *k : tocin::runtime::availableImageKernels()) {
+        kernels = k;
+        std::cout << "[" << k->name << "]\n";
+        RUN_TEST(row_kernels_match_scalar);
+        RUN_TEST(box_blur_matches_window_mean);
+        RUN_TEST(sobel_matches_get_pixel);
+        RUN_TEST(resizes);
+    }
+    kernels = &tocin::runtime::imageKernels();
+    RUN_TEST(entry_points);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
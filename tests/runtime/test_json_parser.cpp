@@ -0,0 +1,293 @@
+// JSON Parser Tests for Tocin Compiler
+//
+// The tape parser behind jsonParseFast and the jsonFast* builtins: the
+// structural index against a byte-at-a-time reference (backslash runs and
+// strings crossing 64-byte blocks at every offset), numbers at the int64
+// boundaries and beyond, escapes and surrogate pairs, rejected documents,
+// navigation and JSON pointers, lookup hints across documents of one and
+// of different shapes, the nesting limit, counts past the tape's
+// saturation point, and a document reused across parses.
+
+#include "runtime/json_parser.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace tocin::runtime;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+// Quotes, operators outside strings and the first byte of each scalar, one
+// byte at a time; false for an unterminated string.
+static bool referenceIndex(const std::string& s, std::vector<uint32_t>* out) {
+    out->clear();
+    bool inString = false, escaped = false, inScalar = false;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (inString) {
+            if (escaped) escaped = false;
+            else if (c == '\\') escaped = true;
+            else if (c == '"') { inString = false; out->push_back((uint32_t)i); }
+            continue;
+        }
+        bool op = std::strchr("{}[]:,", c) && c;
+        bool space = c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        if (c == '"') { inString = true; inScalar = false; out->push_back((uint32_t)i); continue; }
+        if (op) out->push_back((uint32_t)i);
+        bool scalar = !op && !space;
+        if (scalar && !inScalar) out->push_back((uint32_t)i);
+        inScalar = scalar;
+    }
+    return !inString;
+}
+
+static std::vector<uint32_t> index(const std::string& s, bool* ok) {
+    std::string padded = s + std::string(64, 'x'); // junk past the end is ignored
+    std::vector<uint32_t> out(s.size() + 1);
+    size_t n = 0;
+    bool backslashes = false;
+    *ok = jsonStructuralIndex(padded.data(), s.size(), out.data(), &n, &backslashes);
+    ASSERT_EQ(backslashes, s.find('\\') != std::string::npos);
+    out.resize(n);
+    return out;
+}
+
+TEST(index_matches_reference) {
+    const char* pieces[] = {"{\"a\":", "[1,2,3]", "\"x\\\"y\"", "\"\\\\\"", "\"\\\\\\\\\\\"q\"", " true ",
+                            "-12.5e3", ",", "\"}{][:,\"", "null", "\t\n", "\"long string with spaces\""};
+    uint64_t seed = 12345;
+    for (int round = 0; round < 3000; ++round) {
+        std::string s;
+        size_t pad = (size_t)round % 67;
+        s.append(pad, ' ');
+        int parts = 1 + round % 40;
+        for (int p = 0; p < parts; ++p) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            s += pieces[(seed >> 33) % (sizeof(pieces) / sizeof(pieces[0]))];
+        }
+        std::vector<uint32_t> want;
+        bool refOk = referenceIndex(s, &want);
+        bool ok = false;
+        std::vector<uint32_t> got = index(s, &ok);
+        ASSERT_EQ(ok, refOk);
+        if (ok) ASSERT_EQ(got, want);
+    }
+    // Backslash runs of every length ending at every block offset.
+    for (size_t run = 1; run < 70; ++run)
+        for (size_t lead = 0; lead < 66; ++lead) {
+            std::string s = std::string(lead, ' ') + "\"" + std::string(run, '\\') + "\"";
+            if (run % 2 == 1) s += "\"";
+            std::vector<uint32_t> want;
+            bool refOk = referenceIndex(s, &want);
+            bool ok = false;
+            ASSERT_TRUE(refOk);
+            ASSERT_EQ(index(s, &ok), want);
+            ASSERT_TRUE(ok);
+        }
+    bool ok = true;
+    index("\"unterminated", &ok);
+    ASSERT_TRUE(!ok);
+    index("\"tab\tinside\"", &ok);
+    ASSERT_TRUE(!ok);
+}
+
+static std::string str(const JsonDocument& d, size_t v) {
+    const char* p = nullptr;
+    size_t n = 0;
+    if (!d.string(v, &p, &n)) return "<not a string>";
+    return std::string(p, n);
+}
+
+static bool parses(const std::string& s) {
+    JsonDocument d;
+    return d.parse(s.data(), s.size());
+}
+
+TEST(scalars_and_numbers) {
+    JsonDocument d;
+    ASSERT_TRUE(d.parse("  42 ", 5));
+    ASSERT_EQ(d.type(JsonDocument::kRoot), kJsonNumber);
+    ASSERT_EQ(d.asInt(JsonDocument::kRoot), 42);
+    std::string s = "[0,-0,9223372036854775807,-9223372036854775808,9223372036854775808,"
+                    "12345678901234567890123,3.25,-1e3,2E-2,1e-400,true,false,null]";
+    ASSERT_TRUE(d.parse(s.data(), s.size()));
+    size_t a = JsonDocument::kRoot;
+    ASSERT_EQ(d.length(a), 13u);
+    ASSERT_EQ(d.asInt(d.at(a, 0)), 0);
+    ASSERT_EQ(d.asInt(d.at(a, 2)), INT64_MAX);
+    ASSERT_EQ(d.asInt(d.at(a, 3)), INT64_MIN);
+    ASSERT_EQ(d.asFloat(d.at(a, 4)), 9223372036854775808.0); // past int64: a double
+    ASSERT_EQ(d.asInt(d.at(a, 4)), INT64_MAX);
+    ASSERT_TRUE(d.asFloat(d.at(a, 5)) > 1.2e22);
+    ASSERT_EQ(d.asFloat(d.at(a, 6)), 3.25);
+    ASSERT_EQ(d.asInt(d.at(a, 6)), 3);
+    ASSERT_EQ(d.asFloat(d.at(a, 7)), -1000.0);
+    ASSERT_EQ(d.asFloat(d.at(a, 8)), 0.02);
+    ASSERT_EQ(d.asFloat(d.at(a, 9)), 0.0);
+    ASSERT_EQ(d.type(d.at(a, 10)), kJsonBool);
+    ASSERT_TRUE(d.asBool(d.at(a, 10)));
+    ASSERT_TRUE(!d.asBool(d.at(a, 11)));
+    ASSERT_EQ(d.type(d.at(a, 12)), kJsonNull);
+    ASSERT_EQ(d.at(a, 13), 0u);
+    ASSERT_EQ(d.type(0), -1);
+}
+
+TEST(strings_and_escapes) {
+    JsonDocument d;
+    std::string s = "{\"plain\":\"abc\",\"esc\":\"q\\\"b\\\\s\\/n\\nt\\t\",\"uni\":\"\\u00e9\\u20ac\\ud83d\\ude00\","
+                    "\"k\\u0065y\":1,\"raw\":\"caf\xc3\xa9\"}";
+    ASSERT_TRUE(d.parse(s.data(), s.size()));
+    size_t o = JsonDocument::kRoot;
+    ASSERT_EQ(str(d, d.find(o, "plain", 5)), "abc");
+    ASSERT_EQ(str(d, d.find(o, "esc", 3)), "q\"b\\s/n\nt\t");
+    ASSERT_EQ(str(d, d.find(o, "uni", 3)), "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+    ASSERT_EQ(d.asInt(d.find(o, "key", 3)), 1); // keys are compared decoded
+    ASSERT_EQ(str(d, d.find(o, "raw", 3)), "caf\xc3\xa9");
+    ASSERT_EQ(str(d, d.first(o)), "plain");
+    for (const char* bad : {"\"\\x\"", "\"\\u12\"", "\"\\ud800\"", "\"\\udc00\"", "\"\\ud800\\u0041\""})
+        ASSERT_TRUE(!parses(bad));
+}
+
+TEST(rejects_malformed) {
+    const char* bad[] = {"", "   ", "{", "}", "[1,]", "[,1]", "{\"a\"}", "{\"a\":}", "{\"a\" 1}", "{1:2}",
+                         "[1 2]", "tru", "truex", "nul", "01", "1.", ".5", "+1", "-", "1e", "1e+",
+                         "[1]]", "[1] [2]", "\"a\"\"b\"", "{\"a\":1,}", "1e400", "--1", "[\x01]", "[\"a\"b]",
+                         "NaN", "[true false]", "{\"a\":1 \"b\":2}"};
+    for (const char* s : bad) {
+        if (parses(s)) std::cerr << "\naccepted: " << s << "\n";
+        ASSERT_TRUE(!parses(s));
+    }
+    const char* good[] = {"0", "-0.0e-0", "\"\"", "[]", "{}", "[[]]", " {\"a\" : [ 1 , { } ] } ", "[1,\"x\",null]"};
+    for (const char* s : good) ASSERT_TRUE(parses(s));
+}
+
+TEST(navigation_and_pointers) {
+    JsonDocument d;
+    std::string s = "{\"users\":[{\"name\":\"ada\",\"tags\":[\"x\",\"y\"]},{\"name\":\"bo\",\"age\":7}],"
+                    "\"a/b\":1,\"m~n\":2,\"empty\":{},\"n\":null}";
+    ASSERT_TRUE(d.parse(s.data(), s.size()));
+    size_t root = JsonDocument::kRoot;
+    ASSERT_EQ(d.length(root), 5u);
+    size_t users = d.find(root, "users", 5);
+    ASSERT_EQ(d.type(users), kJsonArray);
+    ASSERT_EQ(d.length(users), 2u);
+    std::vector<std::string> keys;
+    for (size_t k = d.first(root); k; k = d.next(k)) keys.push_back(str(d, k));
+    ASSERT_EQ(keys.size(), 5u);
+    ASSERT_EQ(keys[1], "a/b");
+    ASSERT_EQ(d.asInt(d.value(d.next(d.first(root)))), 1);
+    std::vector<std::string> names;
+    for (size_t u = d.first(users); u; u = d.next(u)) names.push_back(str(d, d.find(u, "name", 4)));
+    ASSERT_EQ(names.size(), 2u);
+    ASSERT_EQ(names[1], "bo");
+    auto ptr = [&](const char* p) { return d.pointer(root, p, std::strlen(p)); };
+    ASSERT_EQ(str(d, ptr("/users/0/tags/1")), "y");
+    ASSERT_EQ(d.asInt(ptr("/users/1/age")), 7);
+    ASSERT_EQ(d.asInt(ptr("/a~1b")), 1);
+    ASSERT_EQ(d.asInt(ptr("/m~0n")), 2);
+    ASSERT_EQ(ptr(""), root);
+    ASSERT_EQ(ptr("/users/2"), 0u);
+    ASSERT_EQ(ptr("/users/01"), 0u);
+    ASSERT_EQ(ptr("/n/x"), 0u);
+    ASSERT_EQ(ptr("users"), 0u);
+    ASSERT_EQ(d.first(ptr("/empty")), 0u);
+    ASSERT_EQ(d.length(ptr("/empty")), 0u);
+    ASSERT_EQ(d.find(users, "name", 4), 0u); // not an object
+    ASSERT_EQ(d.next(root), 0u);
+}
+
+TEST(lookup_hints) {
+    JsonDocument d;
+    uint32_t hint = 0;
+    size_t root = JsonDocument::kRoot;
+    auto get = [&](const std::string& s) {
+        ASSERT_TRUE(d.parse(s.data(), s.size()));
+        return d.asInt(d.find(root, "id", 2, &hint));
+    };
+    ASSERT_EQ(get("{\"a\":null,\"id\":5}"), 5);
+    uint32_t learned = hint;
+    ASSERT_TRUE(learned != 0);
+    ASSERT_EQ(get("{\"a\":true,\"id\":6}"), 6);   // same shape: the hint holds
+    ASSERT_EQ(hint, learned);
+    // A nested object's "id" exactly at the hinted distance is not the root's.
+    ASSERT_EQ(get("{\"a\":{\"id\":9},\"id\":7}"), 7);
+    ASSERT_EQ(get("{\"a\":null,\"b\":1,\"id\":8}"), 8);  // another key at the hint
+    ASSERT_EQ(get("{\"b\":{\"id\":3}}"), 0);   // only nested: absent
+    ASSERT_EQ(get("{\"id\":4,\"a\":1}"), 4);
+    uint32_t hints[2] = {0, 0};
+    std::string p = "/u/id";
+    for (int64_t i = 0; i < 3; ++i) {
+        std::string s = "{\"x\":" + std::to_string(i) + ",\"u\":{\"n\":\"q\",\"id\":" + std::to_string(i) + "}}";
+        ASSERT_TRUE(d.parse(s.data(), s.size()));
+        ASSERT_EQ(d.asInt(d.pointer(root, p.data(), p.size(), hints, 2)), i);
+    }
+    ASSERT_TRUE(hints[0] != 0 && hints[1] != 0);
+}
+
+TEST(nesting_limit) {
+    std::string ok(JsonDocument::kMaxDepth, '[');
+    ok += std::string(JsonDocument::kMaxDepth, ']');
+    ASSERT_TRUE(parses(ok));
+    std::string deep(JsonDocument::kMaxDepth + 1, '[');
+    deep += std::string(JsonDocument::kMaxDepth + 1, ']');
+    ASSERT_TRUE(!parses(deep));
+}
+
+TEST(saturated_counts) {
+    const size_t n = 0xffffff + 5;
+    std::string s = "[";
+    s.reserve(2 * n + 2);
+    for (size_t i = 0; i < n; ++i) s += i ? ",7" : "7";
+    s += "]";
+    JsonDocument d;
+    ASSERT_TRUE(d.parse(s.data(), s.size()));
+    ASSERT_EQ(d.length(JsonDocument::kRoot), n);
+}
+
+TEST(document_reuse) {
+    JsonDocument d;
+    std::string a = "{\"id\":1,\"s\":\"one\\n\"}", b = "[\"two\",2]";
+    ASSERT_TRUE(d.parse(a.data(), a.size()));
+    ASSERT_EQ(str(d, d.find(JsonDocument::kRoot, "s", 1)), "one\n");
+    ASSERT_TRUE(!d.parse("[1,", 3));
+    ASSERT_TRUE(!d.ok());
+    ASSERT_EQ(d.type(JsonDocument::kRoot), -1);
+    ASSERT_TRUE(d.parse(b.data(), b.size()));
+    ASSERT_EQ(str(d, d.at(JsonDocument::kRoot, 0)), "two");
+    ASSERT_EQ(d.find(JsonDocument::kRoot, "id", 2), 0u);
+}
+
+int main() {
+    std::cout << "=== JSON Parser Tests ===\n\n";
+
+    RUN_TEST(index_matches_reference);
+    RUN_TEST(scalars_and_numbers);
+    RUN_TEST(strings_and_escapes);
+    RUN_TEST(rejects_malformed);
+    RUN_TEST(navigation_and_pointers);
+    RUN_TEST(lookup_hints);
+    RUN_TEST(nesting_limit);
+    RUN_TEST(saturated_counts);
+    RUN_TEST(document_reuse);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
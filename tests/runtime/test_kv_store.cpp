@@ -0,0 +1,231 @@
+// KV Store Tests for Tocin Compiler
+//
+// KvStore (src/runtime/kv_store.h) in memory and on disk: round trips,
+// deletes and sizes; reopening after a clean close and after a simulated
+// crash (the directory copied while the store is live), including a torn
+// final log record; memtable flushes and run merges, with readers running
+// alongside; and concurrent writers sharing group commits.
+
+#include "runtime/kv_store.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using tocin::runtime::KvStore;
+namespace fs = std::filesystem;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static std::string dir(const char* name) {
+    std::string d = std::string("tocin_kv_store_") + name + ".tmp";
+    fs::remove_all(d);
+    return d;
+}
+
+static char* allocBytes(size_t size) {
+    return static_cast<char*>(std::malloc(size + 1));
+}
+
+// The value for key, or "<none>".
+static std::string get(const KvStore& db, const std::string& key) {
+    size_t len = 0;
+    char* buf = db.get(key, allocBytes, &len);
+    if (!buf) return "<none>";
+    std::string v(buf, len);
+    std::free(buf);
+    return v;
+}
+
+static std::string key(int i) { return "key" + std::to_string(i); }
+
+static std::string value(int i, int version) {
+    return "v" + std::to_string(version) + ":" + std::string((size_t)(i % 50), (char)('a' + i % 26));
+}
+
+static size_t filesWithExt(const std::string& d, const char* ext) {
+    size_t n = 0;
+    for (const auto& e : fs::directory_iterator(d)) n += e.path().extension() == ext;
+    return n;
+}
+
+TEST(in_memory_store) {
+    KvStore* db = KvStore::open("");
+    ASSERT_TRUE(db && !db->durable());
+    ASSERT_TRUE(db->put("a", "1") && db->put("b", "") && db->put("a", "2"));
+    ASSERT_EQ(get(*db, "a"), "2");
+    ASSERT_EQ(get(*db, "b"), "");
+    ASSERT_EQ(get(*db, "c"), "<none>");
+    ASSERT_EQ(db->size(), 2u);
+    ASSERT_TRUE(db->remove("a") && !db->remove("a") && !db->has("a") && db->has("b"));
+    ASSERT_EQ(db->size(), 1u);
+    std::string binary("k\0ey", 4);
+    ASSERT_TRUE(db->put(binary, std::string("\0\xff", 2)));
+    ASSERT_EQ(get(*db, binary), std::string("\0\xff", 2));
+    ASSERT_TRUE(db->sync() && db->compact());
+    delete db;
+}
+
+TEST(reopen_after_close) {
+    std::string d = dir("reopen");
+    KvStore* db = KvStore::open(d);
+    ASSERT_TRUE(db && db->durable());
+    for (int i = 0; i < 1000; ++i) ASSERT_TRUE(db->put(key(i), value(i, 1)));
+    for (int i = 0; i < 1000; i += 3) ASSERT_TRUE(db->remove(key(i)));
+    ASSERT_TRUE(db->put(key(1), value(1, 2)));
+    ASSERT_EQ(db->size(), 666u);
+    delete db;
+
+    db = KvStore::open(d);
+    ASSERT_TRUE(db != nullptr);
+    ASSERT_EQ(db->size(), 666u);
+    for (int i = 0; i < 1000; ++i)
+        ASSERT_EQ(get(*db, key(i)), i % 3 == 0 ? "<none>" : value(i, i == 1 ? 2 : 1));
+    // Deletes of keys that live in a run are tombstones until a merge.
+    ASSERT_TRUE(db->remove(key(2)) && !db->remove(key(3)));
+    ASSERT_EQ(db->size(), 665u);
+    delete db;
+    db = KvStore::open(d);
+    ASSERT_EQ(get(*db, key(2)), "<none>");
+    ASSERT_EQ(db->size(), 665u);
+    delete db;
+    fs::remove_all(d);
+}
+
+TEST(recover_after_crash) {
+    std::string d = dir("crash"), copy = dir("crash_copy");
+    KvStore* db = KvStore::open(d);
+    for (int i = 0; i < 200; ++i) ASSERT_TRUE(db->put(key(i), value(i, 1)));
+    ASSERT_TRUE(db->remove(key(7)));
+    // Every put has returned, so all of it is in the log: what a crash
+    // right now would leave behind.
+    fs::copy(d, copy);
+    delete db;
+
+    // A torn record at the end (a write cut short) is dropped, and the
+    // records before it survive.
+    fs::path log;
+    for (const auto& e : fs::directory_iterator(copy))
+        if (e.path().extension() == ".wal" && fs::file_size(e.path()) > 0) log = e.path();
+    ASSERT_TRUE(!log.empty());
+    {
+        std::ofstream out(log, std::ios::binary | std::ios::app);
+        out.write("\x12\x34\x56\x78\x05\x00\x00\x00\x09\x00\x00\x00ke", 14);
+    }
+    db = KvStore::open(copy);
+    ASSERT_TRUE(db != nullptr);
+    ASSERT_EQ(db->size(), 199u);
+    ASSERT_EQ(get(*db, key(7)), "<none>");
+    ASSERT_EQ(get(*db, key(199)), value(199, 1));
+    // The replayed log became a run and a fresh log was started.
+    ASSERT_EQ(filesWithExt(copy, ".run"), 1u);
+    ASSERT_TRUE(db->put("after", "crash"));
+    delete db;
+    db = KvStore::open(copy);
+    ASSERT_EQ(get(*db, "after"), "crash");
+    ASSERT_EQ(db->size(), 200u);
+    delete db;
+
+    // A damaged manifest is refused rather than read as an empty store.
+    {
+        std::ofstream out(copy + "/MANIFEST", std::ios::binary | std::ios::trunc);
+        out << "garbage";
+    }
+    ASSERT_TRUE(KvStore::open(copy) == nullptr);
+    fs::remove_all(d);
+    fs::remove_all(copy);
+}
+
+TEST(flush_and_merge_runs) {
+    std::string d = dir("merge");
+    KvStore* db = KvStore::open(d);
+    db->setSync(false);
+    // Enough data for several memtables, rewriting earlier keys, so runs
+    // are flushed in the background and merged once there are too many.
+    const int keys = 6000, rounds = 5;
+    const std::string pad(1000, 'p');
+    std::atomic<bool> done{false};
+    std::atomic<int> misses{0};
+    ASSERT_TRUE(db->put(key(0), "r"));
+    std::thread reader([&] {
+        // Key 0 exists from the start and is only ever overwritten.
+        while (!done.load())
+            if (get(*db, key(0)).compare(0, 1, "r") != 0) misses.fetch_add(1);
+    });
+    for (int r = 0; r < rounds; ++r)
+        for (int i = 0; i < keys; ++i)
+            ASSERT_TRUE(db->put(key(i), "r" + std::to_string(r) + pad));
+    for (int i = 0; i < keys; i += 2) ASSERT_TRUE(db->remove(key(i + 1)));
+    done = true;
+    reader.join();
+    ASSERT_EQ(misses.load(), 0);
+    ASSERT_EQ(db->size(), (size_t)keys / 2);
+    ASSERT_TRUE(db->sync());
+    ASSERT_TRUE(filesWithExt(d, ".run") >= 1u);
+    ASSERT_TRUE(filesWithExt(d, ".run") <= KvStore::kMaxRuns);
+
+    ASSERT_TRUE(db->compact());
+    ASSERT_EQ(filesWithExt(d, ".run"), 1u);
+    ASSERT_EQ(db->size(), (size_t)keys / 2);
+    delete db;
+
+    db = KvStore::open(d);
+    ASSERT_EQ(db->size(), (size_t)keys / 2);
+    for (int i = 0; i < keys; ++i)
+        ASSERT_EQ(get(*db, key(i)), i % 2 ? "<none>" : "r" + std::to_string(rounds - 1) + pad);
+    delete db;
+    fs::remove_all(d);
+}
+
+TEST(concurrent_writers_group_commit) {
+    std::string d = dir("group");
+    KvStore* db = KvStore::open(d);
+    const int threads = 4, each = 100;
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t)
+        pool.emplace_back([db, t] {
+            for (int i = 0; i < each; ++i)
+                ASSERT_TRUE(db->put("t" + std::to_string(t) + "/" + key(i), value(i, t)));
+        });
+    for (auto& th : pool) th.join();
+    ASSERT_EQ(db->size(), (size_t)(threads * each));
+    delete db;
+    db = KvStore::open(d);
+    for (int t = 0; t < threads; ++t)
+        for (int i = 0; i < each; ++i)
+            ASSERT_EQ(get(*db, "t" + std::to_string(t) + "/" + key(i)), value(i, t));
+    delete db;
+    fs::remove_all(d);
+}
+
+int main() {
+    std::cout << "Running KV store tests...\n";
+    RUN_TEST(in_memory_store);
+    RUN_TEST(reopen_after_close);
+    RUN_TEST(recover_after_crash);
+    RUN_TEST(flush_and_merge_runs);
+    RUN_TEST(concurrent_writers_group_commit);
+    std::cout << "All KV store tests passed!\n";
+    return 0;
+}
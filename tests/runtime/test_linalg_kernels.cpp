@@ -0,0 +1,181 @@
+// Matrix Kernel Tests for Tocin Compiler
+//
+// Every kernel table the CPU supports is checked against a naive triple loop
+// on shapes around the micro-kernel tile, the packed panel and the parallel
+// row block. The runtime entry points take Tocin lists ([len][elements]),
+// built here by hand.
+
+#include "runtime/linalg_kernels.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+extern "C" {
+int64_t __tocin_gemm_f64(const int64_t* a, const int64_t* b, int64_t* dst, int64_t r, int64_t m,
+                         int64_t p, int64_t aOff, int64_t bOff, int64_t dstOff);
+int64_t __tocin_gemm_f64_nt(const int64_t* a, const int64_t* b, int64_t* dst, int64_t r, int64_t m,
+                            int64_t p, int64_t aOff, int64_t bOff, int64_t dstOff);
+int64_t __tocin_gemv_f64(const int64_t* a, const int64_t* x, int64_t* y, int64_t r, int64_t c,
+                         int64_t xOff, int64_t yOff);
+void __tocin_parallel_init(int64_t num_threads);
+}
+
+using tocin::runtime::LinalgKernels;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " (" << kernels->name << ")\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+static const LinalgKernels* kernels = &tocin::runtime::linalgKernels();
+
+static std::vector<double> randomMatrix(std::mt19937& rng, size_t n) {
+    std::uniform_real_distribution<double> d(-1.0, 1.0);
+    std::vector<double> m(n);
+    for (double& x : m) x = d(rng);
+    return m;
+}
+
+static std::vector<double> naiveGemm(const std::vector<double>& a, const std::vector<double>& b,
+                                     size_t r, size_t m, size_t p) {
+    std::vector<double> c(r * p, 0.0);
+    for (size_t i = 0; i < r; ++i)
+        for (size_t k = 0; k < m; ++k)
+            for (size_t j = 0; j < p; ++j) c[i * p + j] += a[i * m + k] * b[k * p + j];
+    return c;
+}
+
+// Entries are sums of m products of values in [-1, 1]; allow for rounding
+// in a different summation order.
+static bool close(const std::vector<double>& got, const std::vector<double>& want, size_t m) {
+    double tol = 1e-13 * static_cast<double>(m + 1);
+    for (size_t i = 0; i < want.size(); ++i)
+        if (std::fabs(got[i] - want[i]) > tol) return false;
+    return true;
+}
+
+// A Tocin list of floats: the length word, then the elements.
+static std::vector<int64_t> list(const std::vector<double>& xs) {
+    std::vector<int64_t> arr(xs.size() + 1);
+    arr[0] = static_cast<int64_t>(xs.size());
+    std::memcpy(arr.data() + 1, xs.data(), xs.size() * sizeof(double));
+    return arr;
+}
+
+static double at(const std::vector<int64_t>& arr, size_t i) {
+    double x;
+    std::memcpy(&x, arr.data() + 1 + i, sizeof x);
+    return x;
+}
+
+TEST(gemm_matches_naive_on_edge_shapes) {
+    std::mt19937 rng(11);
+    // Around the tile (up to 8 rows x 16 columns), the panel (256 deep, 512
+    // wide) and the 64-row block.
+    const size_t shapes[][3] = {{1, 1, 1},   {1, 7, 1},     {3, 5, 2},    {4, 4, 8},
+                                {5, 9, 17},  {8, 16, 16},   {9, 3, 33},   {13, 255, 7},
+                                {64, 256, 16}, {65, 257, 31}, {70, 300, 530}, {2, 600, 3}};
+    for (const auto& s : shapes) {
+        size_t r = s[0], m = s[1], p = s[2];
+        auto a = randomMatrix(rng, r * m), b = randomMatrix(rng, m * p);
+        std::vector<double> c(r * p, 123.0);
+        tocin::runtime::gemm(*kernels, a.data(), b.data(), c.data(), r, m, p);
+        ASSERT_TRUE(close(c, naiveGemm(a, b, r, m, p), m));
+    }
+}
+
+TEST(gemm_with_empty_depth_zeroes_the_result) {
+    std::vector<double> c(6, 5.0);
+    tocin::runtime::gemm(*kernels, nullptr, nullptr, c.data(), 2, 0, 3);
+    for (double x : c) ASSERT_TRUE(x == 0.0);
+}
+
+TEST(dot_matches_naive) {
+    std::mt19937 rng(3);
+    for (size_t n = 0; n < 100; ++n) {
+        auto a = randomMatrix(rng, n), b = randomMatrix(rng, n);
+        double want = 0.0;
+        for (size_t i = 0; i < n; ++i) want += a[i] * b[i];
+        ASSERT_TRUE(std::fabs(kernels->dot(a.data(), b.data(), n) - want) < 1e-13 * (n + 1));
+    }
+}
+
+// Large enough that every panel is split across the pool.
+TEST(parallel_gemm_matches_naive) {
+    std::mt19937 rng(5);
+    size_t r = 200, m = 300, p = 150;
+    auto a = randomMatrix(rng, r * m), b = randomMatrix(rng, m * p);
+    std::vector<double> c(r * p);
+    tocin::runtime::gemm(*kernels, a.data(), b.data(), c.data(), r, m, p);
+    ASSERT_TRUE(close(c, naiveGemm(a, b, r, m, p), m));
+}
+
+// b stored transposed; shapes cross the strip width, the panel depth and
+// the panel width.
+TEST(transposed_gemm_matches_naive) {
+    std::mt19937 rng(9);
+    const size_t shapes[][3] = {{1, 1, 1}, {7, 5, 9}, {33, 257, 17}, {70, 40, 515}};
+    for (const auto& s : shapes) {
+        size_t r = s[0], m = s[1], p = s[2];
+        auto a = randomMatrix(rng, r * m), bt = randomMatrix(rng, p * m);
+        std::vector<double> b(m * p);
+        for (size_t k = 0; k < m; ++k)
+            for (size_t j = 0; j < p; ++j) b[k * p + j] = bt[j * m + k];
+        std::vector<double> c(r * p);
+        tocin::runtime::gemm(*kernels, a.data(), bt.data(), c.data(), r, m, p, true);
+        ASSERT_TRUE(close(c, naiveGemm(a, b, r, m, p), m));
+    }
+}
+
+TEST(entry_points_take_lists) {
+    auto a = list({1, 2, 3, 4, 5, 6});  // 2 x 3
+    auto b = list({1, 0, 0, 1, 1, 1});  // 3 x 2
+    auto c = list({0, 0, 0, 0});
+    __tocin_gemm_f64(a.data(), b.data(), c.data(), 2, 3, 2, 0, 0, 0);
+    ASSERT_TRUE(at(c, 0) == 4 && at(c, 1) == 5 && at(c, 2) == 10 && at(c, 3) == 11);
+
+    // Row 1 of a (offset 3) times b^T = rows of bt, into c[2, 4).
+    auto bt = list({1, 0, 1, 0, 1, 1});  // 2 x 3, b^T
+    __tocin_gemm_f64_nt(a.data(), bt.data(), c.data(), 1, 3, 2, 3, 0, 2);
+    ASSERT_TRUE(at(c, 0) == 4 && at(c, 1) == 5 && at(c, 2) == 10 && at(c, 3) == 11);
+
+    // Rows of a against x[1, 4), into y[2, 4).
+    auto x = list({9, 1, 1, 1});
+    auto y = list({7, 7, 0, 0});
+    __tocin_gemv_f64(a.data(), x.data(), y.data(), 2, 3, 1, 2);
+    ASSERT_TRUE(at(y, 0) == 7 && at(y, 1) == 7 && at(y, 2) == 6 && at(y, 3) == 15);
+}
+
+int main() {
+    std::cout << "=== Matrix Kernel Tests ===\n\n";
+
+    __tocin_parallel_init(4);
+    for (const LinalgKernels* table : tocin::runtime::availableLinalgKernels()) {
+        kernels = table;
+        std::cout << "-- " << table->name << "\n";
+        RUN_TEST(gemm_matches_naive_on_edge_shapes);
+        RUN_TEST(gemm_with_empty_depth_zeroes_the_result);
+        RUN_TEST(dot_matches_naive);
+        RUN_TEST(parallel_gemm_matches_naive);
+        RUN_TEST(transposed_gemm_matches_naive);
+    }
+    kernels = &tocin::runtime::linalgKernels();
+    RUN_TEST(entry_points_take_lists);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
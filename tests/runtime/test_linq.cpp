@@ -0,0 +1,230 @@
+// LINQ Pipeline Tests for Tocin Compiler
+//
+// Queryable<T> (src/runtime/linq.h) runs a query as one pull loop. Checks
+// that results match the stage-by-stage meaning of each operator, and, by
+// counting predicate calls, that take/first/any/all stop reading the source
+// as soon as the answer is known. The parallel tests run the same queries
+// under asParallel() on a four-worker pool and compare.
+
+#include "runtime/linq.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+extern "C" void __tocin_parallel_init(int64_t threads);
+
+using runtime::Queryable;
+namespace linq = runtime::linq;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+TEST(chain_matches_plain_loop) {
+    // The query from benchmarks/benchmark_runtime_linq.to.
+    long long want = 0;
+    for (int x = 1; x <= 100000; ++x) {
+        if (x % 2 != 0) continue;
+        int y = x * 3;
+        if (y % 5 != 0) continue;
+        want += y / 2;
+    }
+    long long got = linq::range(1, 100000)
+        .where([](const int& x) { return x % 2 == 0; })
+        .select([](const int& x) { return x * 3; })
+        .where([](const int& x) { return x % 5 == 0; })
+        .select([](const int& x) { return x / 2; })
+        .select([](const int& x) { return (long long)x; })
+        .sum();
+    ASSERT_EQ(got, want);
+}
+
+TEST(take_stops_reading_the_source) {
+    int tested = 0;
+    auto q = linq::range(0, 1000000)
+        .where([&](const int& x) { ++tested; return x % 3 == 0; })
+        .select([](const int& x) { return x + 1; })
+        .take(4);
+    std::vector<int> got = q.execute();
+    ASSERT_EQ(got, (std::vector<int>{1, 4, 7, 10}));
+    ASSERT_EQ(tested, 10);   // 0..9; 9 is the fourth match
+    ASSERT_TRUE(linq::range(0, 10).take(0).execute().empty());
+}
+
+TEST(first_any_all_short_circuit) {
+    int tested = 0;
+    auto q = linq::range(0, 1000000).where([&](const int& x) { ++tested; return x > 41; });
+    ASSERT_EQ(q.first(), 42);
+    ASSERT_EQ(tested, 43);
+
+    tested = 0;
+    ASSERT_TRUE(q.any());
+    ASSERT_EQ(tested, 43);
+
+    int checked = 0;
+    ASSERT_TRUE(!linq::range(0, 1000000).all([&](const int& x) { ++checked; return x < 5; }));
+    ASSERT_EQ(checked, 6);
+    ASSERT_TRUE(linq::range(0, 100).contains(7));
+    ASSERT_EQ(linq::range(0, 100).first([](const int& x) { return x * x > 50; }), 8);
+}
+
+TEST(skip_take_and_distinct) {
+    std::vector<int> xs = {5, 1, 5, 2, 1, 3, 2, 4, 3, 6};
+    auto q = linq::from(xs).distinct();
+    ASSERT_EQ(q.execute(), (std::vector<int>{5, 1, 2, 3, 4, 6}));
+    ASSERT_EQ(q.skip(2).take(3).execute(), (std::vector<int>{2, 3, 4}));
+    // Each run starts with an empty seen-set.
+    ASSERT_EQ(q.count(), 6);
+    ASSERT_EQ(q.count(), 6);
+    ASSERT_EQ(linq::from(xs).skip(100).count(), 0);
+    ASSERT_EQ(linq::from(xs).take(3).skip(1).execute(), (std::vector<int>{1, 5}));
+}
+
+TEST(order_and_reverse_collect_their_input) {
+    std::vector<std::string> words = {"pear", "fig", "apple", "kiwi", "banana", "date"};
+    auto byLength = linq::from(words).orderBy([](const std::string& w) { return w.size(); });
+    // Stable: equal lengths keep their input order.
+    ASSERT_EQ(byLength.execute(),
+              (std::vector<std::string>{"fig", "pear", "kiwi", "date", "apple", "banana"}));
+    ASSERT_EQ(byLength.reverse().take(2).execute(), (std::vector<std::string>{"banana", "apple"}));
+    ASSERT_EQ(linq::range(0, 10)
+                  .where([](const int& x) { return x % 2 == 1; })
+                  .orderByDescending([](const int& x) { return x; })
+                  .skip(1)
+                  .first(),
+              7);
+}
+
+TEST(source_is_shared_and_aggregates) {
+    auto base = linq::range(1, 10);
+    auto evens = base.where([](const int& x) { return x % 2 == 0; });
+    ASSERT_EQ(&base.getData(), &evens.getData());
+    ASSERT_EQ(base.count(), 10);
+    ASSERT_EQ(evens.sum(), 30);
+    ASSERT_EQ(evens.min(), 2);
+    ASSERT_EQ(evens.max(), 10);
+    ASSERT_EQ(evens.last(), 10);
+    ASSERT_TRUE(evens.average() == 6.0);
+    ASSERT_EQ(evens.skip(4).single(), 10);
+    ASSERT_EQ(evens.take(0).singleOrDefault(), 0);
+    ASSERT_EQ(evens.getQueryNodes().size(), 1u);
+
+    auto labels = evens.select([](const int& x) { return std::to_string(x); });
+    ASSERT_EQ(labels.execute(), (std::vector<std::string>{"2", "4", "6", "8", "10"}));
+
+    auto c = evens.cursor();
+    int x = 0;
+    ASSERT_TRUE(c.next(x) && x == 2);
+    ASSERT_TRUE(c.next(x) && x == 4);
+}
+
+TEST(parallel_matches_sequential) {
+    auto q = linq::range(0, 200000)
+        .where([](const int& x) { return x % 3 != 0; })
+        .select([](const int& x) { return x * 7 % 1000; });
+    auto p = q.asParallel();
+    ASSERT_TRUE(p.isParallel() && !p.asSequential().isParallel());
+    ASSERT_EQ(p.execute(), q.execute());
+    ASSERT_EQ(p.count(), q.count());
+    ASSERT_EQ(p.select([](const int& x) { return (long long)x; }).sum(),
+              q.select([](const int& x) { return (long long)x; }).sum());
+    ASSERT_EQ(p.min(), q.min());
+    ASSERT_EQ(p.max(), q.max());
+    ASSERT_TRUE(p.average() == q.average());
+    ASSERT_EQ(p.first(), q.first());
+    ASSERT_EQ(p.last(), q.last());
+    // Stages after the per-element prefix run over the merged results.
+    ASSERT_EQ(p.skip(10).take(5).execute(), q.skip(10).take(5).execute());
+    ASSERT_EQ(p.distinct().count(), q.distinct().count());
+    ASSERT_EQ(p.orderByDescending([](const int& x) { return x; }).take(3).execute(),
+              (std::vector<int>{999, 999, 999}));
+
+    std::vector<int> unordered = p.asUnordered().execute();
+    std::vector<int> ordered = q.execute();
+    std::sort(unordered.begin(), unordered.end());
+    std::sort(ordered.begin(), ordered.end());
+    ASSERT_EQ(unordered, ordered);
+    ASSERT_EQ(p.asUnordered().count(), q.count());
+}
+
+TEST(parallel_any_stops_every_part) {
+    std::atomic<int> tested{0};
+    auto q = linq::range(0, 4000000).asParallel()
+        .where([&](const int& x) { tested.fetch_add(1, std::memory_order_relaxed); return x == 5; });
+    ASSERT_TRUE(q.any());
+    ASSERT_TRUE(tested.load() < 4000000);
+    ASSERT_TRUE(!linq::range(0, 100000).asParallel().any([](const int& x) { return x < 0; }));
+    ASSERT_TRUE(linq::range(0, 100000).asParallel().all([](const int& x) { return x >= 0; }));
+}
+
+TEST(group_by_keeps_first_appearance_order) {
+    auto mod = [](const int& x) { return x % 7; };
+    for (bool parallel : {false, true}) {
+        auto source = linq::range(0, 50000);
+        if (parallel) source = source.asParallel();
+        auto groups = source.where([](const int& x) { return x % 2 == 0; }).groupBy(mod).execute();
+        ASSERT_EQ(groups.size(), 7u);
+        for (size_t k = 0; k < groups.size(); ++k) {
+            ASSERT_EQ(groups[k].key, static_cast<int>(k * 2 % 7)); // first evens: 0, 2, 4, 6, 8, 10, 12
+            ASSERT_TRUE(std::is_sorted(groups[k].items.begin(), groups[k].items.end()));
+            for (int x : groups[k].items) ASSERT_EQ(mod(x), groups[k].key);
+        }
+        size_t total = 0;
+        for (const auto& g : groups) total += g.items.size();
+        ASSERT_EQ(total, 25000u);
+    }
+}
+
+TEST(join_pairs_equal_keys_in_outer_order) {
+    std::vector<std::pair<int, std::string>> names = {{1, "one"}, {2, "two"}, {3, "three"}, {2, "deux"}};
+    auto inner = linq::from(names);
+    auto key = [](const std::pair<int, std::string>& p) { return p.first; };
+    auto self = [](const int& x) { return x; };
+    auto label = [](const int& x, const std::pair<int, std::string>& p) { return std::to_string(x) + p.second; };
+    ASSERT_EQ(linq::from(std::vector<int>{2, 5, 1, 2}).join(inner, self, key, label).execute(),
+              (std::vector<std::string>{"2two", "2deux", "1one", "2two", "2deux"}));
+
+    std::vector<std::pair<int, int>> squares;
+    for (int i = 0; i < 30000; ++i) squares.push_back({i, i * i % 1000});
+    auto sq = linq::from(squares);
+    auto first = [](const std::pair<int, int>& p) { return p.first; };
+    auto mul = [](const int& x, const std::pair<int, int>& p) { return (long long)x * 1000 + p.second; };
+    auto outer = linq::range(0, 100000).select([](const int& x) { return x * 13 % 40000; });
+    ASSERT_EQ(outer.asParallel().join(sq.asParallel(), self, first, mul).execute(),
+              outer.join(sq, self, first, mul).execute());
+}
+
+int main() {
+    std::cout << "Running LINQ pipeline tests...\n";
+    __tocin_parallel_init(4);
+    RUN_TEST(chain_matches_plain_loop);
+    RUN_TEST(take_stops_reading_the_source);
+    RUN_TEST(first_any_all_short_circuit);
+    RUN_TEST(skip_take_and_distinct);
+    RUN_TEST(order_and_reverse_collect_their_input);
+    RUN_TEST(source_is_shared_and_aggregates);
+    RUN_TEST(parallel_matches_sequential);
+    RUN_TEST(parallel_any_stops_every_part);
+    RUN_TEST(group_by_keeps_first_appearance_order);
+    RUN_TEST(join_pairs_equal_keys_in_outer_order);
+    std::cout << "All LINQ pipeline tests passed!\n";
+    return 0;
+}
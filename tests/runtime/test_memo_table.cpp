@@ -0,0 +1,139 @@
+// Memo Table Tests for Tocin Compiler
+//
+// The result cache behind `memoize def`: exact hits and misses for tuples
+// that differ in one word or only in length, LRU replacement within a set,
+// and readers racing writers that store a value derived from the key, so a
+// torn entry would show up as a wrong result.
+
+#include "runtime/memo_table.h"
+
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+extern "C" {
+int64_t __tocin_memo_get(int64_t* slot, const uint64_t* args, int64_t n, uint64_t* out);
+void __tocin_memo_put(int64_t* slot, const uint64_t* args, int64_t n, uint64_t value);
+}
+
+using tocin::runtime::MemoTable;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+TEST(tuples_hit_exactly) {
+    auto t = std::make_unique<MemoTable>();
+    uint64_t a[] = {1, 2, 3};
+    uint64_t b[] = {1, 2, 4};
+    uint64_t out = 0;
+    ASSERT_TRUE(!t->get(a, 3, &out));
+    t->put(a, 3, 42);
+    ASSERT_TRUE(t->get(a, 3, &out));
+    ASSERT_EQ(out, 42u);
+    ASSERT_TRUE(!t->get(b, 3, &out));
+    ASSERT_TRUE(!t->get(a, 2, &out));   // a prefix is another tuple
+    t->put(a, 3, 43);                   // the same tuple is overwritten
+    ASSERT_TRUE(t->get(a, 3, &out));
+    ASSERT_EQ(out, 43u);
+    ASSERT_TRUE(!t->get(nullptr, 0, &out));
+    t->put(nullptr, 0, 7);
+    ASSERT_TRUE(t->get(nullptr, 0, &out));
+    ASSERT_EQ(out, 7u);
+}
+
+TEST(full_table_keeps_recent_entries) {
+    auto t = std::make_unique<MemoTable>();
+    const uint64_t cap = MemoTable::kSets * MemoTable::kWays;
+    uint64_t out = 0;
+    // Far more keys than entries: every hit must still be the right value,
+    // and the most recent puts must have survived.
+    for (uint64_t k = 0; k < cap * 4; ++k)
+        t->put(&k, 1, k * 3);
+    size_t recent = 0;
+    for (uint64_t k = cap * 4 - 64; k < cap * 4; ++k)
+        if (t->get(&k, 1, &out)) {
+            ASSERT_EQ(out, k * 3);
+            ++recent;
+        }
+    ASSERT_EQ(recent, 64u);
+    size_t kept = 0;
+    for (uint64_t k = 0; k < cap * 4; ++k)
+        if (t->get(&k, 1, &out)) {
+            ASSERT_EQ(out, k * 3);
+            ++kept;
+        }
+    ASSERT_TRUE(kept <= cap);
+    ASSERT_TRUE(kept > cap / 2);
+}
+
+TEST(lookups_refresh_their_entry) {
+    auto t = std::make_unique<MemoTable>();
+    const uint64_t cap = MemoTable::kSets * MemoTable::kWays;
+    uint64_t hot = 12345;
+    uint64_t out = 0;
+    t->put(&hot, 1, 1);
+    // Keep reading the hot key while the table turns over several times; a
+    // used entry is never its set's least recent one for long.
+    for (uint64_t k = 1; k <= cap * 4; ++k) {
+        uint64_t key = k << 20;
+        t->put(&key, 1, k);
+        ASSERT_TRUE(t->get(&hot, 1, &out));
+        ASSERT_EQ(out, 1u);
+    }
+}
+
+TEST(concurrent_readers_never_see_torn_entries) {
+    int64_t slot = 0;
+    std::atomic<bool> bad{false};
+    std::vector<std::thread> threads;
+    for (int id = 0; id < 8; ++id) {
+        threads.emplace_back([&, id] {
+            uint64_t key[2];
+            uint64_t out = 0;
+            for (uint64_t i = 0; i < 200000; ++i) {
+                key[0] = (i * 7 + (uint64_t)id) % 6000;  // overlapping keys across threads
+                key[1] = ~key[0];
+                if (__tocin_memo_get(&slot, key, 2, &out)) {
+                    if (out != key[0] * 0x9e3779b97f4a7c15ull) bad = true;
+                } else {
+                    __tocin_memo_put(&slot, key, 2, key[0] * 0x9e3779b97f4a7c15ull);
+                }
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    ASSERT_TRUE(!bad);
+    ASSERT_TRUE(slot != 0);   // made on first use
+    uint64_t key[5] = {};
+    uint64_t out = 0;
+    ASSERT_EQ(__tocin_memo_get(&slot, key, 5, &out), 0);   // wider than a table key
+}
+
+int main() {
+    std::cout << "=== Memo Table Tests ===\n\n";
+
+    RUN_TEST(tuples_hit_exactly);
+    RUN_TEST(full_table_keeps_recent_entries);
+    RUN_TEST(lookups_refresh_their_entry);
+    RUN_TEST(concurrent_readers_never_see_torn_entries);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
@@ -0,0 +1,405 @@
+// Package Resolver Tests for Tocin Compiler
+//
+// Version constraints and their set algebra; the PubGrub resolver on graphs
+// that need backjumping, on unsatisfiable ones (with the explanation), and
+// against brute force on random registries; the concurrent caching source;
+// and the content-addressed package cache with its hard-linked installs and
+// resolved-graph cache.
+
+#include "package/package_cache.h"
+#include "package/resolver.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace package;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static Version v(const char* text) { return *Version::parse(text); }
+
+static bool allows(const char* constraint, const char* version) {
+    return parseConstraint(constraint)->contains(v(version));
+}
+
+// A registry in memory: name -> version -> dependencies.
+class TableSource : public PackageSource {
+public:
+    std::map<std::string, std::map<std::string, std::vector<Dependency>>> table;
+    std::atomic<int> requests{0};
+    int delayMs = 0;
+
+    void add(const std::string& name, const char* version, std::vector<Dependency> deps = {}) {
+        table[name][v(version).toString()] = std::move(deps);
+    }
+
+    std::vector<Version> versions(const std::string& name) override {
+        ++requests;
+        if (delayMs) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        std::vector<Version> out;
+        auto found = table.find(name);
+        if (found != table.end())
+            for (const auto& entry : found->second) out.push_back(v(entry.first.c_str()));
+        return out;
+    }
+
+    std::vector<Dependency> dependencies(const std::string& name, const Version& version) override {
+        ++requests;
+        if (delayMs) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        return table.at(name).at(version.toString());
+    }
+};
+
+static Dependency dep(const char* name, const char* constraint) { return Dependency(name, constraint); }
+
+TEST(versions_order_as_semver) {
+    ASSERT_TRUE(v("1.0.0-alpha") < v("1.0.0-alpha.1"));
+    ASSERT_TRUE(v("1.0.0-alpha.1") < v("1.0.0-alpha.beta"));
+    ASSERT_TRUE(v("1.0.0-beta.2") < v("1.0.0-beta.11"));
+    ASSERT_TRUE(v("1.0.0-rc.1") < v("1.0.0"));
+    ASSERT_TRUE(v("1.9.0") < v("1.10.0"));
+    ASSERT_EQ(v("v1.2"), v("1.2.0"));
+    ASSERT_EQ(v("1.2.3+build.5"), v("1.2.3"));
+    ASSERT_EQ(v("1.2.3-rc.1+b").toString(), "1.2.3-rc.1+b");
+    ASSERT_TRUE(!Version::parse("1.2.3.4"));
+    ASSERT_TRUE(!Version::parse("1.x"));
+    ASSERT_TRUE(!Version::parse(""));
+    ASSERT_TRUE(!Version::parse("1.0.0-"));
+}
+
+TEST(constraints_parse_to_version_sets) {
+    ASSERT_TRUE(allows("^1.2.3", "1.9.0") && !allows("^1.2.3", "2.0.0") && !allows("^1.2.3", "1.2.2"));
+    ASSERT_TRUE(allows("^0.2.3", "0.2.9") && !allows("^0.2.3", "0.3.0"));
+    ASSERT_TRUE(allows("^0.0.3", "0.0.3") && !allows("^0.0.3", "0.0.4"));
+    ASSERT_TRUE(allows("~1.2.3", "1.2.9") && !allows("~1.2.3", "1.3.0"));
+    ASSERT_TRUE(allows("1.2", "1.2.7") && !allows("1.2", "1.3.0"));
+    ASSERT_TRUE(allows("1.2.x", "1.2.7") && !allows("1.2.x", "1.3.0"));
+    ASSERT_TRUE(allows(">= 1.0, <1.5", "1.4.9") && !allows(">= 1.0, <1.5", "1.5.0"));
+    ASSERT_TRUE(allows(">1.2", "1.3.0") && !allows(">1.2", "1.2.9"));
+    ASSERT_TRUE(allows("<=1.2", "1.2.9") && !allows("<=1.2", "1.3.0"));
+    ASSERT_TRUE(allows("1.x || >=3", "3.1.0") && allows("1.x || >=3", "1.0.0") && !allows("1.x || >=3", "2.0.0"));
+    ASSERT_TRUE(parseConstraint("")->isAny() && parseConstraint("*")->isAny());
+    ASSERT_EQ(parseConstraint("^1.2")->toString(), ">=1.2.0 <2.0.0");
+    ASSERT_EQ(parseConstraint("=1.2.3")->toString(), "1.2.3");
+    for (const char* bad : {"^", "abc", ">=1.0 ||", "1.2.3.4", "~>1"})
+        ASSERT_TRUE(!parseConstraint(bad));
+}
+
+TEST(version_sets_form_an_algebra) {
+    VersionSet a = *parseConstraint(">=1.0 <2.0"), b = *parseConstraint(">=1.5 <3.0");
+    ASSERT_EQ(a.intersect(b).toString(), ">=1.5.0 <2.0.0");
+    ASSERT_EQ(a.unite(b).toString(), ">=1.0.0 <3.0.0");
+    ASSERT_EQ(a.complement().toString(), "<1.0.0 || >=2.0.0");
+    ASSERT_EQ(a.complement().complement(), a);
+    ASSERT_TRUE(a.unite(a.complement()).isAny());
+    ASSERT_TRUE(a.intersect(a.complement()).empty());
+    ASSERT_TRUE(a.minus(b) == *parseConstraint(">=1.0 <1.5"));
+    ASSERT_TRUE(VersionSet::exactly(v("1.2.0")).subsetOf(a) && !b.subsetOf(a));
+    // Excluding a single version leaves both sides of it.
+    VersionSet hole = a.minus(VersionSet::exactly(v("1.2.0")));
+    ASSERT_TRUE(hole.contains(v("1.1.9")) && !hole.contains(v("1.2.0")) && hole.contains(v("1.2.1")));
+    ASSERT_TRUE(hole.contains(v("1.2.0-rc.1")) && !hole.contains(v("2.0.0")));
+    ASSERT_EQ(VersionSet::none().toString(), "none");
+}
+
+TEST(resolves_to_the_newest_compatible_versions) {
+    TableSource src;
+    src.add("a", "1.0.0", {dep("b", "^1.0")});
+    src.add("a", "1.1.0", {dep("b", "^1.1")});
+    src.add("a", "2.0.0", {dep("b", "^2.0")});
+    src.add("b", "1.0.0");
+    src.add("b", "1.1.0");
+    src.add("b", "1.2.0-beta");
+    src.add("b", "2.0.0");
+    Resolution r = Resolver(src).resolve({dep("a", "^1.0")});
+    ASSERT_TRUE(r.ok);
+    ASSERT_EQ(r.versions.size(), 2u);
+    ASSERT_EQ(r.versions["a"], v("1.1.0"));
+    ASSERT_EQ(r.versions["b"], v("1.1.0"));   // releases before prereleases
+    ASSERT_EQ(r.conflicts, 0u);
+}
+
+TEST(backjumps_past_the_decision_that_caused_a_conflict) {
+    // From the PubGrub documentation: foo 1.1.0 leads (through left and
+    // right) to shared 1.0.0, which needs target 1.x against the root's 2.x;
+    // the solver learns that foo 1.1.0 cannot work and settles on foo 1.0.0.
+    TableSource src;
+    src.add("foo", "1.0.0");
+    src.add("foo", "1.1.0", {dep("left", "^1.0.0"), dep("right", "^1.0.0")});
+    src.add("left", "1.0.0", {dep("shared", ">=1.0.0")});
+    src.add("right", "1.0.0", {dep("shared", "<2.0.0")});
+    src.add("shared", "2.0.0");
+    src.add("shared", "1.0.0", {dep("target", "^1.0.0")});
+    src.add("target", "2.0.0");
+    src.add("target", "1.0.0");
+    Resolution r = Resolver(src).resolve({dep("foo", "^1.0.0"), dep("target", "^2.0.0")});
+    ASSERT_TRUE(r.ok);
+    ASSERT_EQ(r.versions.size(), 2u);
+    ASSERT_EQ(r.versions["foo"], v("1.0.0"));
+    ASSERT_EQ(r.versions["target"], v("2.0.0"));
+    ASSERT_TRUE(r.conflicts >= 1);
+}
+
+TEST(explains_why_there_is_no_solution) {
+    TableSource src;
+    src.add("foo", "1.0.0", {dep("baz", "^1.0")});
+    src.add("bar", "1.0.0", {dep("baz", "^2.0")});
+    src.add("baz", "1.0.0");
+    src.add("baz", "2.0.0");
+    Resolution r = Resolver(src, "app").resolve({dep("foo", "^1.0"), dep("bar", "^1.0")});
+    ASSERT_TRUE(!r.ok);
+    ASSERT_TRUE(r.error.find("foo") != std::string::npos);
+    ASSERT_TRUE(r.error.find("bar") != std::string::npos);
+    ASSERT_TRUE(r.error.find("version solving failed") != std::string::npos);
+
+    Resolution missing = Resolver(src, "app").resolve({dep("foo", "^1.0"), dep("nope", "^1.0")});
+    ASSERT_TRUE(!missing.ok);
+    ASSERT_TRUE(missing.error.find("nope doesn't exist") != std::string::npos);
+
+    src.add("odd", "1.0.0", {dep("baz", "~>1")});
+    Resolution invalid = Resolver(src, "app").resolve({dep("odd", "*")});
+    ASSERT_TRUE(!invalid.ok);
+    ASSERT_TRUE(invalid.error.find("invalid constraint") != std::string::npos);
+}
+
+TEST(prefers_locked_versions) {
+    TableSource src;
+    for (const char* ver : {"1.0.0", "1.1.0", "1.2.0"}) src.add("a", ver);
+    Resolver resolver(src);
+    resolver.prefer("a", v("1.1.0"));
+    ASSERT_EQ(resolver.resolve({dep("a", "^1.0")}).versions["a"], v("1.1.0"));
+    // A lock the manifest no longer allows is ignored.
+    ASSERT_EQ(resolver.resolve({dep("a", ">=1.2")}).versions["a"], v("1.2.0"));
+}
+
+// Every package absent or at one of its versions, exhaustively.
+static bool bruteForce(TableSource& src, const std::vector<Dependency>& root) {
+    std::vector<std::string> names;
+    for (const auto& entry : src.table) names.push_back(entry.first);
+    std::map<std::string, std::string> pick;
+    std::function<bool(size_t)> rec = [&](size_t i) -> bool {
+        if (i == names.size()) {
+            auto ok = [&](const std::vector<Dependency>& deps) {
+                for (const auto& d : deps) {
+                    auto it = pick.find(d.name);
+                    if (it == pick.end() || !parseConstraint(d.version)->contains(v(it->second.c_str()))) return false;
+                }
+                return true;
+            };
+            if (!ok(root)) return false;
+            for (const auto& [name, ver] : pick)
+                if (!ok(src.table[name][ver])) return false;
+            return true;
+        }
+        if (rec(i + 1)) return true;
+        for (const auto& entry : src.table[names[i]]) {
+            pick[names[i]] = entry.first;
+            if (rec(i + 1)) return true;
+            pick.erase(names[i]);
+        }
+        return false;
+    };
+    return rec(0);
+}
+
+TEST(agrees_with_brute_force_on_random_registries) {
+    std::mt19937 g(7);
+    const char* constraints[] = {"^1.0", "^2.0", ">=1.1", "<2.0", "1.0.0", "~2.1", "*", ">=3.0"};
+    const char* versions[] = {"1.0.0", "1.1.0", "2.0.0", "2.1.0"};
+    int solved = 0;
+    for (int round = 0; round < 300; ++round) {
+        TableSource src;
+        const int packages = 5;
+        for (int p = 0; p < packages; ++p)
+            for (const char* ver : versions) {
+                if (g() % 4 == 0) continue;
+                std::vector<Dependency> deps;
+                for (int q = 0; q < packages; ++q)
+                    if (q != p && g() % 4 == 0)
+                        deps.push_back(dep(std::string(1, char('a' + q)).c_str(), constraints[g() % 8]));
+                src.add(std::string(1, char('a' + p)), ver, deps);
+            }
+        std::vector<Dependency> root = {dep("a", constraints[g() % 8]), dep("b", constraints[g() % 8])};
+        Resolution r = Resolver(src).resolve(root);
+        ASSERT_EQ(r.ok, bruteForce(src, root));
+        if (!r.ok) {
+            ASSERT_TRUE(!r.error.empty());
+            continue;
+        }
+        ++solved;
+        auto holds = [&](const std::vector<Dependency>& deps) {
+            for (const auto& d : deps) {
+                auto it = r.versions.find(d.name);
+                ASSERT_TRUE(it != r.versions.end());
+                ASSERT_TRUE(parseConstraint(d.version)->contains(it->second));
+            }
+        };
+        holds(root);
+        for (const auto& [name, ver] : r.versions) holds(src.table[name][ver.toString()]);
+    }
+    ASSERT_TRUE(solved > 30 && solved < 290);
+}
+
+TEST(caching_source_fetches_each_answer_once_and_in_parallel) {
+    TableSource slow;
+    slow.delayMs = 50;
+    std::vector<Dependency> wide;
+    for (int i = 0; i < 16; ++i) {
+        std::string name = "p" + std::to_string(i);
+        slow.add(name, "1.0.0");
+        wide.push_back(Dependency(name, "^1.0"));
+    }
+    slow.add("top", "1.0.0", wide);
+
+    CachingSource cached(slow);
+    auto start = std::chrono::steady_clock::now();
+    Resolution r = Resolver(cached).resolve({dep("top", "*")});
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_TRUE(r.ok);
+    ASSERT_EQ(r.versions.size(), 17u);
+    // 34 requests of 50 ms one after another would take 1.7 s.
+    ASSERT_TRUE(seconds < 1.0);
+    ASSERT_EQ(slow.requests.load(), 34);
+    ASSERT_EQ(cached.fetches(), 34u);
+
+    Resolution again = Resolver(cached).resolve({dep("top", "*")});
+    ASSERT_EQ(again.versions, r.versions);
+    ASSERT_EQ(slow.requests.load(), 34);
+}
+
+static std::string tempDir() {
+    llvm::SmallString<128> dir;
+    ASSERT_TRUE(!llvm::sys::fs::createUniqueDirectory("tocin-pkg-test", dir));
+    return std::string(dir.str());
+}
+
+static std::string join(const std::string& dir, const std::string& rest) {
+    llvm::SmallString<256> p(dir);
+    llvm::sys::path::append(p, rest);
+    return std::string(p.str());
+}
+
+static std::string readFile(const std::string& path) {
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    return buffer ? (*buffer)->getBuffer().str() : "<missing>";
+}
+
+TEST(cache_stores_by_content_and_links_installs) {
+    std::string base = tempDir();
+    PackageCache cache(join(base, "cache"));
+    ASSERT_TRUE(!cache.has("json", v("1.0.0")));
+    ASSERT_TRUE(cache.add("json", v("1.0.0"), {{"src/json.to", "def parse() {}"}, {"LICENSE", "MIT"}}));
+    ASSERT_TRUE(cache.add("yaml", v("2.0.0"), {{"yaml.to", "def load() {}"}, {"LICENSE", "MIT"}}));
+    ASSERT_TRUE(cache.has("json", v("1.0.0")) && !cache.has("json", v("1.0.1")));
+    ASSERT_TRUE(!cache.add("evil", v("1.0.0"), {{"../escape", "x"}}));
+
+    // Both LICENSE files are one blob.
+    ASSERT_TRUE(llvm::sys::fs::exists(cache.blobPath(PackageCache::digest("MIT"))));
+    std::string a = join(base, "project_a/json"), b = join(base, "project_b/json");
+    ASSERT_TRUE(cache.install("json", v("1.0.0"), a));
+    ASSERT_TRUE(cache.install("json", v("1.0.0"), b));
+    ASSERT_EQ(readFile(join(a, "src/json.to")), "def parse() {}");
+    ASSERT_TRUE(llvm::sys::fs::equivalent(join(a, "LICENSE"), join(b, "LICENSE")));
+    ASSERT_TRUE(!cache.install("json", v("9.0.0"), a));
+    ASSERT_EQ(readFile(join(a, "LICENSE")), "MIT");   // a failed install keeps the old one
+
+    // The resolved graph, keyed by the lock file and the direct dependencies.
+    std::string key = PackageCache::graphKey("json 1.0.0\n", {dep("json", "^1.0")});
+    ASSERT_TRUE(key != PackageCache::graphKey("json 1.0.1\n", {dep("json", "^1.0")}));
+    ASSERT_TRUE(key != PackageCache::graphKey("json 1.0.0\n", {dep("json", "^1.1")}));
+    ASSERT_TRUE(!cache.loadGraph(key));
+    std::map<std::string, Version> graph = {{"json", v("1.0.0")}, {"yaml", v("2.0.0-rc.1")}};
+    ASSERT_TRUE(cache.storeGraph(key, graph));
+    ASSERT_TRUE(cache.loadGraph(key) == graph);
+
+    llvm::sys::fs::remove_directories(base);
+}
+
+TEST(installs_a_resolution_with_concurrent_downloads) {
+    std::string base = tempDir();
+    PackageCache cache(join(base, "cache"));
+    ASSERT_TRUE(cache.add("have", v("1.0.0"), {{"have.to", "cached"}}));
+
+    std::atomic<int> inFlight{0}, maxInFlight{0}, calls{0};
+    PackageFetcher fetch = [&](const std::string& name, const Version& version,
+                               std::map<std::string, std::string>& files, std::string& error) {
+        ++calls;
+        int now = ++inFlight;
+        for (int seen = maxInFlight.load(); now > seen && !maxInFlight.compare_exchange_weak(seen, now);) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        --inFlight;
+        if (name == "broken") {
+            error = "404";
+            return false;
+        }
+        files[name + ".to"] = name + " " + version.toString();
+        return true;
+    };
+    std::map<std::string, Version> versions = {{"have", v("1.0.0")}, {"broken", v("1.0.0")}};
+    for (int i = 0; i < 8; ++i) versions["dl" + std::to_string(i)] = v("0.1.0");
+
+    std::string modules = join(base, "modules");
+    InstallReport report = installResolution(cache, versions, fetch, modules);
+    ASSERT_EQ(report.linked, 1u);
+    ASSERT_EQ(report.downloaded, 8u);
+    ASSERT_EQ(report.errors.size(), 1u);
+    ASSERT_TRUE(report.errors[0].find("broken 1.0.0: 404") != std::string::npos);
+    ASSERT_EQ(calls.load(), 9);
+    ASSERT_TRUE(maxInFlight.load() > 1);
+    ASSERT_EQ(readFile(join(modules, "dl3/dl3.to")), "dl3 0.1.0");
+    ASSERT_EQ(readFile(join(modules, "have/have.to")), "cached");
+
+    // Everything but the broken one is cached now.
+    versions.erase("broken");
+    calls = 0;
+    report = installResolution(cache, versions, fetch, modules);
+    ASSERT_TRUE(report.ok());
+    ASSERT_EQ(report.linked, 9u);
+    ASSERT_EQ(calls.load(), 0);
+
+    llvm::sys::fs::remove_directories(base);
+}
+
+int main() {
+    std::cout << "=== Package Resolver Tests ===\n\n";
+
+    RUN_TEST(versions_order_as_semver);
+    RUN_TEST(constraints_parse_to_version_sets);
+    RUN_TEST(version_sets_form_an_algebra);
+    RUN_TEST(resolves_to_the_newest_compatible_versions);
+    RUN_TEST(backjumps_past_the_decision_that_caused_a_conflict);
+    RUN_TEST(explains_why_there_is_no_solution);
+    RUN_TEST(prefers_locked_versions);
+    RUN_TEST(agrees_with_brute_force_on_random_registries);
+    RUN_TEST(caching_source_fetches_each_answer_once_and_in_parallel);
+    RUN_TEST(cache_stores_by_content_and_links_installs);
+    RUN_TEST(installs_a_resolution_with_concurrent_downloads);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
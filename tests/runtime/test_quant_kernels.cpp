@@ -0,0 +1,218 @@
+// Quantized Kernel Tests for Tocin Compiler
+//
+// The half / bfloat16 conversions are checked on their edge values, and
+// every kernel table the CPU supports against the scalar one: int8 dots
+// must agree exactly, float dots to rounding, and the matrix drivers with
+// a float64 product to the error each format allows. The runtime entry
+// points take Tocin lists ([len][elements]), built here by hand.
+
+#include "runtime/quant_kernels.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+extern "C" {
+int64_t __tocin_quantize(const int64_t* w, int64_t rows, int64_t cols, int64_t format);
+int64_t __tocin_qmat_free(int64_t h);
+int64_t __tocin_qmat_rows(int64_t h);
+int64_t __tocin_qmat_cols(int64_t h);
+int64_t __tocin_qmat_bytes(int64_t h);
+int64_t __tocin_qmat_dequantize(int64_t h, int64_t* out);
+int64_t __tocin_qmat_vec(int64_t h, const int64_t* x, int64_t* y, int64_t xOff, int64_t yOff);
+int64_t __tocin_qmat_mul(int64_t h, const int64_t* x, int64_t* y, int64_t n, int64_t xOff, int64_t yOff);
+void __tocin_parallel_init(int64_t num_threads);
+}
+
+using tocin::runtime::QuantFormat;
+using tocin::runtime::QuantKernels;
+using tocin::runtime::QuantMatrix;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " (" << kernels->name << ")\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+static const QuantKernels* kernels = &tocin::runtime::quantKernels();
+
+static std::vector<double> randomMatrix(std::mt19937& rng, size_t n) {
+    std::uniform_real_distribution<double> d(-1.0, 1.0);
+    std::vector<double> m(n);
+    for (double& x : m) x = d(rng);
+    return m;
+}
+
+static std::vector<double> naiveMatMulNT(const std::vector<double>& x, const std::vector<double>& w,
+                                         size_t n, size_t rows, size_t cols) {
+    std::vector<double> y(n * rows, 0.0);
+    for (size_t b = 0; b < n; ++b)
+        for (size_t i = 0; i < rows; ++i)
+            for (size_t j = 0; j < cols; ++j) y[b * rows + i] += x[b * cols + j] * w[i * cols + j];
+    return y;
+}
+
+// Largest error relative to the largest magnitude of the result.
+static double relativeError(const std::vector<double>& got, const std::vector<double>& want) {
+    double err = 0.0, peak = 1e-300;
+    for (size_t i = 0; i < want.size(); ++i) {
+        err = std::fmax(err, std::fabs(got[i] - want[i]));
+        peak = std::fmax(peak, std::fabs(want[i]));
+    }
+    return err / peak;
+}
+
+static std::vector<int64_t> list(const std::vector<double>& xs) {
+    std::vector<int64_t> arr(xs.size() + 1);
+    arr[0] = static_cast<int64_t>(xs.size());
+    std::memcpy(arr.data() + 1, xs.data(), xs.size() * sizeof(double));
+    return arr;
+}
+
+static double at(const std::vector<int64_t>& arr, size_t i) {
+    double x;
+    std::memcpy(&x, arr.data() + 1 + i, sizeof x);
+    return x;
+}
+
+TEST(half_conversions_round_to_nearest_even) {
+    using tocin::runtime::floatToHalf;
+    using tocin::runtime::halfToFloat;
+    ASSERT_TRUE(floatToHalf(1.0f) == 0x3c00 && floatToHalf(-2.0f) == 0xc000);
+    ASSERT_TRUE(floatToHalf(65504.0f) == 0x7bff && floatToHalf(1e6f) == 0x7c00);
+    ASSERT_TRUE(floatToHalf(std::ldexp(1.0f, -24)) == 0x0001);  // smallest subnormal
+    ASSERT_TRUE(floatToHalf(std::ldexp(1.0f, -26)) == 0x0000);
+    // 1 + 2^-11 is halfway between 1 and the next half: ties go to even.
+    ASSERT_TRUE(floatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3c00);
+    ASSERT_TRUE(floatToHalf(1.0f + 3 * std::ldexp(1.0f, -11)) == 0x3c02);
+    ASSERT_TRUE(std::isnan(halfToFloat(floatToHalf(NAN))));
+    // Every finite half survives the round trip.
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+        if ((h & 0x7c00) == 0x7c00) continue;
+        ASSERT_TRUE(floatToHalf(halfToFloat(static_cast<uint16_t>(h))) == h);
+    }
+    ASSERT_TRUE(tocin::runtime::floatToBf16(1.0f) == 0x3f80);
+    ASSERT_TRUE(tocin::runtime::bf16ToFloat(tocin::runtime::floatToBf16(3.0f)) == 3.0f);
+    ASSERT_TRUE(tocin::runtime::floatToBf16(1.0f + std::ldexp(1.0f, -8)) == 0x3f80);
+}
+
+TEST(dots_match_scalar) {
+    const QuantKernels* scalar = tocin::runtime::availableQuantKernels().front();
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> byte(-127, 127);
+    std::uniform_real_distribution<float> real(-1.0f, 1.0f);
+    for (size_t n : {size_t(64), size_t(128), size_t(192), size_t(1024)}) {
+        std::vector<int8_t> w(n), x(n);
+        std::vector<uint16_t> h(n);
+        std::vector<float> f(n);
+        for (size_t i = 0; i < n; ++i) {
+            w[i] = static_cast<int8_t>(byte(rng));
+            x[i] = static_cast<int8_t>(byte(rng));
+            h[i] = tocin::runtime::floatToHalf(real(rng));
+            f[i] = real(rng);
+        }
+        // Extremes: every lane at +-127 still sums exactly.
+        if (n == 1024)
+            for (size_t i = 0; i < n; ++i) w[i] = x[i] = static_cast<int8_t>(i % 2 ? 127 : -127);
+        ASSERT_TRUE(kernels->dotI8(w.data(), x.data(), n) == scalar->dotI8(w.data(), x.data(), n));
+        float want = scalar->dotF16(h.data(), f.data(), n);
+        ASSERT_TRUE(std::fabs(kernels->dotF16(h.data(), f.data(), n) - want) < 1e-4f * n);
+        want = scalar->dotBf16(h.data(), f.data(), n);
+        ASSERT_TRUE(std::fabs(kernels->dotBf16(h.data(), f.data(), n) - want) < 1e-4f * n);
+    }
+}
+
+// Shapes cross the row padding, the row block and the parallel threshold.
+TEST(matmul_matches_float64) {
+    std::mt19937 rng(11);
+    const size_t shapes[][3] = {{1, 1, 1}, {1, 7, 65}, {5, 33, 100}, {3, 300, 513}};
+    const struct { QuantFormat format; double tol; } formats[] = {
+        {QuantFormat::Int8, 3e-2}, {QuantFormat::Fp16, 2e-3}, {QuantFormat::Bf16, 2e-2}};
+    for (const auto& s : shapes) {
+        size_t n = s[0], rows = s[1], cols = s[2];
+        auto w = randomMatrix(rng, rows * cols), x = randomMatrix(rng, n * cols);
+        auto want = naiveMatMulNT(x, w, n, rows, cols);
+        for (const auto& f : formats) {
+            QuantMatrix q;
+            ASSERT_TRUE(tocin::runtime::quantizeMatrix(w.data(), rows, cols, f.format, q));
+            std::vector<double> y(n * rows);
+            tocin::runtime::quantMatMul(*kernels, q, x.data(), n, y.data());
+            ASSERT_TRUE(relativeError(y, want) < f.tol);
+            std::vector<double> y0(rows);
+            tocin::runtime::quantMatVec(*kernels, q, x.data(), y0.data());
+            for (size_t i = 0; i < rows; ++i) ASSERT_TRUE(y0[i] == y[i]);
+        }
+    }
+}
+
+TEST(zero_rows_and_inputs_give_zero) {
+    std::vector<double> w(2 * 5, 0.0), x(5, 0.0), y(2, 9.0);
+    w[7] = 0.5;
+    QuantMatrix q;
+    ASSERT_TRUE(tocin::runtime::quantizeMatrix(w.data(), 2, 5, QuantFormat::Int8, q));
+    ASSERT_TRUE(q.scales[0] == 0.0f);
+    tocin::runtime::quantMatVec(*kernels, q, x.data(), y.data());
+    ASSERT_TRUE(y[0] == 0.0 && y[1] == 0.0);
+}
+
+TEST(entry_points_take_lists) {
+    auto w = list({1, 2, 3, -4, 0.5, 6});  // 2 x 3
+    int64_t q = __tocin_quantize(w.data(), 2, 3, 1);
+    ASSERT_TRUE(q != 0);
+    ASSERT_TRUE(__tocin_qmat_rows(q) == 2 && __tocin_qmat_cols(q) == 3);
+    ASSERT_TRUE(__tocin_qmat_bytes(q) == 2 * 64 * 2);
+    auto back = list({0, 0, 0, 0, 0, 0});
+    ASSERT_TRUE(__tocin_qmat_dequantize(q, back.data()) == 6);
+    for (size_t i = 0; i < 6; ++i) ASSERT_TRUE(at(back, i) == at(w, i));
+
+    // x[1, 4) into y[2, 4); the values are exact in half precision.
+    auto x = list({9, 1, 1, 1});
+    auto y = list({7, 7, 0, 0});
+    __tocin_qmat_vec(q, x.data(), y.data(), 1, 2);
+    ASSERT_TRUE(at(y, 0) == 7 && at(y, 1) == 7 && at(y, 2) == 6 && at(y, 3) == 2.5);
+
+    // Two inputs at once: rows of xs against both weight rows.
+    auto xs = list({1, 0, 0, 0, 0, 1});
+    auto ys = list({0, 0, 0, 0});
+    __tocin_qmat_mul(q, xs.data(), ys.data(), 2, 0, 0);
+    ASSERT_TRUE(at(ys, 0) == 1 && at(ys, 1) == -4 && at(ys, 2) == 3 && at(ys, 3) == 6);
+    __tocin_qmat_free(q);
+
+    ASSERT_TRUE(__tocin_quantize(w.data(), 2, 3, 7) == 0);
+    ASSERT_TRUE(__tocin_quantize(w.data(), 3, 3, 0) == 0);  // too short
+
+    int64_t q8 = __tocin_quantize(w.data(), 2, 3, 0);
+    ASSERT_TRUE(__tocin_qmat_bytes(q8) == 2 * 64 + 2 * 4);
+    __tocin_qmat_free(q8);
+}
+
+int main() {
+    std::cout << "=== Quantized Kernel Tests ===\n\n";
+
+    __tocin_parallel_init(4);
+    RUN_TEST(half_conversions_round_to_nearest_even);
+    for (const QuantKernels* table : tocin::runtime::availableQuantKernels()) {
+        kernels = table;
+        std::cout << "-- " << table->name << "\n";
+        RUN_TEST(dots_match_scalar);
+        RUN_TEST(matmul_matches_float64);
+        RUN_TEST(zero_rows_and_inputs_give_zero);
+    }
+    kernels = &tocin::runtime::quantKernels();
+    RUN_TEST(entry_points_take_lists);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
@@ -0,0 +1,196 @@
+// Quantile Sketch Tests for Tocin Compiler
+//
+// The t-digest from quantile_sketch.h against exact quantiles of sorted
+// data, in the middle and the tails; merged partitions against one digest of
+// everything; small inputs answered exactly; cdf; and the selectF64 kernel
+// math.stats builds its exact quantile on.
+
+#include "runtime/quantile_sketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+extern "C" {
+int64_t __tocin_tdigest_new(int64_t compression);
+int64_t __tocin_tdigest_free(int64_t td);
+int64_t __tocin_tdigest_add(int64_t td, double x);
+int64_t __tocin_tdigest_add_all(int64_t td, int64_t* xs);
+int64_t __tocin_tdigest_merge(int64_t into, int64_t from);
+double __tocin_tdigest_quantile(int64_t td, double q);
+double __tocin_tdigest_cdf(int64_t td, double x);
+int64_t __tocin_tdigest_count(int64_t td);
+int64_t __tocin_select_floats(int64_t* xs, int64_t k);
+int64_t __tocin_select_ints(int64_t* xs, int64_t k);
+}
+
+using tocin::runtime::TDigest;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+// The type-7 (linear) quantile of sorted values, as math.stats computes it.
+static double exact(const std::vector<double>& sorted, double q) {
+    double h = q * (sorted.size() - 1);
+    size_t lo = static_cast<size_t>(h);
+    if (lo + 1 >= sorted.size()) return sorted.back();
+    return sorted[lo] + (h - lo) * (sorted[lo + 1] - sorted[lo]);
+}
+
+// Where x ranks in sorted, as a fraction: how far off a quantile is.
+static double rankOf(const std::vector<double>& sorted, double x) {
+    return double(std::lower_bound(sorted.begin(), sorted.end(), x) - sorted.begin()) / sorted.size();
+}
+
+static std::vector<double> lognormal(size_t n, unsigned seed) {
+    std::mt19937_64 g(seed);
+    std::lognormal_distribution<double> d(0, 1.5);
+    std::vector<double> xs(n);
+    for (auto& x : xs) x = d(g);
+    return xs;
+}
+
+TEST(tracks_exact_quantiles) {
+    auto xs = lognormal(200000, 1);
+    TDigest td;
+    for (double x : xs) td.add(x);
+    std::sort(xs.begin(), xs.end());
+    ASSERT_EQ(td.count(), 200000.0);
+    ASSERT_TRUE(td.centroids() < 200);
+    ASSERT_EQ(td.quantile(0), xs.front());
+    ASSERT_EQ(td.quantile(1), xs.back());
+    for (double q : {0.5, 0.9}) ASSERT_TRUE(std::fabs(rankOf(xs, td.quantile(q)) - q) < 0.005);
+    // The tails are tighter still, relative to what is left beyond them.
+    for (double q : {0.01, 0.99, 0.999})
+        ASSERT_TRUE(std::fabs(rankOf(xs, td.quantile(q)) - q) < 0.25 * std::min(q, 1 - q));
+    ASSERT_TRUE(std::fabs(td.quantile(0.99) / exact(xs, 0.99) - 1) < 0.02);
+}
+
+TEST(merged_partitions_match_the_whole) {
+    auto xs = lognormal(100000, 2);
+    TDigest whole, merged;
+    std::vector<TDigest> parts(8);
+    for (size_t i = 0; i < xs.size(); ++i) {
+        whole.add(xs[i]);
+        parts[i % parts.size()].add(xs[i]);
+    }
+    for (auto& p : parts) merged.merge(p);
+    std::sort(xs.begin(), xs.end());
+    ASSERT_EQ(merged.count(), whole.count());
+    ASSERT_EQ(merged.min(), xs.front());
+    ASSERT_EQ(merged.max(), xs.back());
+    for (double q : {0.01, 0.25, 0.5, 0.75, 0.99}) {
+        ASSERT_TRUE(std::fabs(rankOf(xs, merged.quantile(q)) - q) < 0.01);
+        ASSERT_TRUE(std::fabs(rankOf(xs, whole.quantile(q)) - rankOf(xs, merged.quantile(q))) < 0.01);
+    }
+}
+
+TEST(small_inputs_are_exact) {
+    TDigest td;
+    ASSERT_EQ(td.quantile(0.5), 0.0);
+    ASSERT_EQ(td.cdf(1), 0.0);
+    for (double x : {5.0, 1.0, 3.0}) td.add(x);
+    ASSERT_EQ(td.quantile(0), 1.0);
+    ASSERT_EQ(td.quantile(0.5), 3.0);
+    ASSERT_EQ(td.quantile(1), 5.0);
+    td.add(std::nan(""));
+    ASSERT_EQ(td.count(), 3.0);
+
+    TDigest one;
+    one.add(42);
+    ASSERT_EQ(one.quantile(0.3), 42.0);
+    ASSERT_EQ(one.cdf(42), 0.5);
+}
+
+TEST(cdf_inverts_quantile) {
+    auto xs = lognormal(50000, 3);
+    TDigest td;
+    for (double x : xs) td.add(x);
+    ASSERT_EQ(td.cdf(-1), 0.0);
+    ASSERT_EQ(td.cdf(1e300), 1.0);
+    for (double q : {0.05, 0.5, 0.95}) ASSERT_TRUE(std::fabs(td.cdf(td.quantile(q)) - q) < 0.01);
+    double last = 0;
+    for (double x = 0; x < 20; x += 0.25) {
+        double c = td.cdf(x);
+        ASSERT_TRUE(c >= last);
+        last = c;
+    }
+}
+
+TEST(builtins_take_lists) {
+    int64_t a = __tocin_tdigest_new(0), b = __tocin_tdigest_new(200);
+    std::vector<int64_t> list(1 + 1000);
+    list[0] = 1000;
+    for (int i = 0; i < 1000; ++i) {
+        double v = i + 1;
+        std::memcpy(&list[1 + i], &v, sizeof v);
+    }
+    ASSERT_EQ(__tocin_tdigest_add_all(a, list.data()), 1000);
+    ASSERT_EQ(__tocin_tdigest_add_all(a, nullptr), 0);
+    for (int i = 1001; i <= 2000; ++i) __tocin_tdigest_add(b, i);
+    __tocin_tdigest_merge(a, b);
+    __tocin_tdigest_merge(a, a); // ignored
+    ASSERT_EQ(__tocin_tdigest_count(a), 2000);
+    ASSERT_EQ(__tocin_tdigest_count(b), 1000);
+    ASSERT_TRUE(std::fabs(__tocin_tdigest_quantile(a, 0.5) - 1000.5) < 10);
+    ASSERT_TRUE(std::fabs(__tocin_tdigest_cdf(a, 500) - 0.25) < 0.01);
+    ASSERT_EQ(__tocin_tdigest_quantile(0, 0.5), 0.0);
+    __tocin_tdigest_free(a);
+    __tocin_tdigest_free(b);
+}
+
+TEST(select_places_the_kth) {
+    std::mt19937_64 g(4);
+    std::vector<double> xs(10001);
+    for (auto& x : xs) x = std::uniform_real_distribution<double>(-1, 1)(g);
+    xs[17] = std::nan("");
+    std::vector<int64_t> list(1 + xs.size());
+    list[0] = static_cast<int64_t>(xs.size());
+    std::memcpy(&list[1], xs.data(), xs.size() * sizeof(double));
+    auto sorted = xs;
+    std::sort(sorted.begin(), sorted.end(), [](double a, double b) { return !std::isnan(a) && (std::isnan(b) || a < b); });
+    for (int64_t k : {0, 5000, 9999}) {
+        __tocin_select_floats(list.data(), k);
+        const double* v = reinterpret_cast<const double*>(&list[1]);
+        ASSERT_EQ(v[k], sorted[k]);
+        for (int64_t i = 0; i < k; ++i) ASSERT_TRUE(v[i] <= v[k]);
+    }
+    __tocin_select_floats(list.data(), 10000);
+    ASSERT_TRUE(std::isnan(reinterpret_cast<const double*>(&list[1])[10000]));
+
+    std::vector<int64_t> ints = {5, 9, -3, 7, 0, 2};
+    __tocin_select_ints(ints.data(), 2); // the length is 5: [9, -3, 7, 0, 2]
+    ASSERT_EQ(ints[1 + 2], 2);
+}
+
+int main() {
+    std::cout << "=== Quantile Sketch Tests ===\n\n";
+
+    RUN_TEST(tracks_exact_quantiles);
+    RUN_TEST(merged_partitions_match_the_whole);
+    RUN_TEST(small_inputs_are_exact);
+    RUN_TEST(cdf_inverts_quantile);
+    RUN_TEST(builtins_take_lists);
+    RUN_TEST(select_places_the_kth);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Random Number Tests for Tocin Compiler
+//
+// xoshiro256++ from xoshiro.h against its published outputs, the bulk
+// lanes, Lemire's range reduction staying unbiased where a modulo is not,
+// randFill / randFillFloat over lists, and goroutines getting streams of
+// their own that a seed reproduces.
+
+#include "runtime/xoshiro.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+extern "C" {
+void __tocin_rand_seed(int64_t seed);
+int64_t __tocin_rand_next();
+int64_t __tocin_rand_range(int64_t lo, int64_t hi);
+uint64_t* __tocin_rand_state();
+int64_t __tocin_rand_fill(int64_t* xs, int64_t n);
+int64_t __tocin_rand_fill_float(int64_t* xs, int64_t n, double lo, double hi);
+void __tocin_go(void (*fn)(void*), void* arg);
+void __tocin_join_all();
+}
+
+using tocin::runtime::RandState;
+using tocin::runtime::Xoshiro256;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+// A list<int> / list<float>: the length, then the elements.
+static std::vector<int64_t> list(int64_t n) {
+    std::vector<int64_t> xs(n + 1, 0);
+    xs[0] = n;
+    return xs;
+}
+
+TEST(matches_reference_outputs) {
+    Xoshiro256 g{{1, 2, 3, 4}};
+    const uint64_t want[] = {41943041ULL, 58720359ULL, 3588806011781223ULL, 3591011842654386ULL,
+                             9228616714210784205ULL, 9973669472204895162ULL, 14011001112246962877ULL,
+                             12406186145184390807ULL, 15849039046786891736ULL, 10450023813501588000ULL};
+    for (uint64_t w : want) ASSERT_EQ(g.next(), w);
+}
+
+TEST(jumps_and_lanes_are_distinct) {
+    Xoshiro256 a;
+    a.seed(7);
+    Xoshiro256 b = a, c = a;
+    b.jump();
+    c.longJump();
+    std::set<uint64_t> seen;
+    for (int i = 0; i < 1000; ++i) {
+        seen.insert(a.next());
+        seen.insert(b.next());
+        seen.insert(c.next());
+    }
+    ASSERT_EQ(seen.size(), 3000u);
+
+    // Two fills of 8 continue where one of 16 would.
+    RandState one, two;
+    one.gen.seed(9);
+    two.gen.seed(9);
+    std::vector<uint64_t> whole(16), parts(16);
+    one.fill(16, [&](size_t i, uint64_t r) { whole[i] = r; });
+    two.fill(8, [&](size_t i, uint64_t r) { parts[i] = r; });
+    two.fill(8, [&](size_t i, uint64_t r) { parts[8 + i] = r; });
+    ASSERT_TRUE(whole == parts);
+    ASSERT_EQ(std::set<uint64_t>(whole.begin(), whole.end()).size(), 16u);
+}
+
+TEST(seed_reproduces_every_form) {
+    auto draw = [] {
+        std::vector<int64_t> out;
+        for (int i = 0; i < 20; ++i) out.push_back(__tocin_rand_next());
+        for (int i = 0; i < 20; ++i) out.push_back(__tocin_rand_range(-5, 5));
+        auto xs = list(37);
+        __tocin_rand_fill(xs.data(), 37);
+        out.insert(out.end(), xs.begin(), xs.end());
+        out.push_back(__tocin_rand_next());
+        return out;
+    };
+    __tocin_rand_seed(42);
+    auto first = draw();
+    __tocin_rand_seed(42);
+    ASSERT_TRUE(draw() == first);
+    __tocin_rand_seed(43);
+    ASSERT_TRUE(draw() != first);
+    for (int64_t x : first) ASSERT_TRUE(x >= -5);
+}
+
+TEST(ranges_are_unbiased) {
+    __tocin_rand_seed(1);
+    int counts[6] = {0};
+    const int kDraws = 600000;
+    for (int i = 0; i < kDraws; ++i) {
+        int64_t v = __tocin_rand_range(10, 16);
+        ASSERT_TRUE(v >= 10 && v < 16);
+        ++counts[v - 10];
+    }
+    for (int c : counts) ASSERT_TRUE(std::abs(c - kDraws / 6) < 1500);
+
+    // A span of 3 * 2^62: a modulo returns below 2^62 half the time, a
+    // uniform draw a third of it.
+    Xoshiro256 g;
+    g.seed(3);
+    const uint64_t span = 3ULL << 62;
+    int low = 0;
+    for (int i = 0; i < 300000; ++i) low += tocin::runtime::boundedDraw(g, span) < (1ULL << 62);
+    ASSERT_TRUE(std::abs(low - 100000) < 1500);
+
+    ASSERT_EQ(__tocin_rand_range(5, 5), 5);
+    ASSERT_EQ(__tocin_rand_range(5, 2), 5);
+    for (int i = 0; i < 1000; ++i) {
+        int64_t v = __tocin_rand_range(INT64_MIN, INT64_MAX);
+        ASSERT_TRUE(v != INT64_MAX);
+    }
+}
+
+TEST(fills_lists) {
+    __tocin_rand_seed(5);
+    auto xs = list(1001);
+    ASSERT_EQ(__tocin_rand_fill(xs.data(), 5000), 1001); // clamped to the length
+    std::set<int64_t> distinct(xs.begin() + 1, xs.end());
+    ASSERT_EQ(distinct.size(), 1001u);
+    for (size_t i = 1; i < xs.size(); ++i) ASSERT_TRUE(xs[i] >= 0);
+
+    auto fs = list(100003);
+    ASSERT_EQ(__tocin_rand_fill_float(fs.data(), 100003, -0.5, 0.5), 100003);
+    const double* f = reinterpret_cast<const double*>(fs.data() + 1);
+    double sum = 0;
+    for (int i = 0; i < 100003; ++i) {
+        ASSERT_TRUE(f[i] >= -0.5 && f[i] < 0.5);
+        sum += f[i];
+    }
+    ASSERT_TRUE(std::fabs(sum / 100003) < 0.01);
+
+    auto part = list(10);
+    ASSERT_EQ(__tocin_rand_fill(part.data(), 3), 3);
+    ASSERT_EQ(part[4], 0);
+    ASSERT_EQ(__tocin_rand_fill(part.data(), 0), 0);
+    ASSERT_EQ(__tocin_rand_fill(nullptr, 3), 0);
+}
+
+struct Stream {
+    std::vector<int64_t> values;
+};
+
+static void drawStream(void* arg) {
+    auto* s = static_cast<Stream*>(arg);
+    uint64_t* st = __tocin_rand_state();
+    ASSERT_TRUE(st != nullptr);
+    for (int i = 0; i < 200; ++i) s->values.push_back(__tocin_rand_next());
+}
+
+TEST(goroutines_get_their_own_streams) {
+    auto run = [] {
+        __tocin_rand_seed(11);
+        std::vector<Stream> streams(4);
+        for (auto& s : streams) __tocin_go(drawStream, &s);
+        __tocin_join_all();
+        Stream parent;
+        drawStream(&parent);
+        streams.push_back(parent);
+        return streams;
+    };
+    auto a = run();
+    std::set<int64_t> all;
+    for (const auto& s : a) all.insert(s.values.begin(), s.values.end());
+    ASSERT_EQ(all.size(), 5u * 200);
+    auto b = run(); // the same seed, spawned in the same order
+    for (size_t i = 0; i < a.size(); ++i) ASSERT_TRUE(a[i].values == b[i].values);
+}
+
+int main() {
+    std::cout << "=== Random Number Tests ===\n\n";
+
+    RUN_TEST(matches_reference_outputs);
+    RUN_TEST(jumps_and_lanes_are_distinct);
+    RUN_TEST(seed_reproduces_every_form);
+    RUN_TEST(ranges_are_unbiased);
+    RUN_TEST(fills_lists);
+    RUN_TEST(goroutines_get_their_own_streams);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
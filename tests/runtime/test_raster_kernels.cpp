@@ -0,0 +1,203 @@
+// Raster Kernel Tests for Tocin Compiler
+//
+// Every kernel table the CPU supports is checked against a per-pixel
+// reference on span lengths around the vector widths, and the clipped
+// primitives against naive per-pixel loops with shapes hanging off every
+// edge of the framebuffer. The fb* entry points take a framebuffer address
+// and its size the way game.graphics passes them.
+
+#include "runtime/raster_kernels.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+extern "C" {
+int64_t __tocin_fb_fill_rect(int64_t fb, int64_t width, int64_t height, int64_t x, int64_t y, int64_t w,
+                             int64_t h, int64_t c);
+int64_t __tocin_fb_blend_rect(int64_t fb, int64_t width, int64_t height, int64_t x, int64_t y, int64_t w,
+                              int64_t h, int64_t c);
+int64_t __tocin_fb_fill_circle(int64_t fb, int64_t width, int64_t height, int64_t cx, int64_t cy, int64_t r,
+                               int64_t c);
+int64_t __tocin_fb_blit(int64_t dst, int64_t width, int64_t height, int64_t x, int64_t y, int64_t src,
+                        int64_t srcWidth, int64_t srcHeight, int64_t blended);
+}
+
+using tocin::runtime::Framebuffer;
+using tocin::runtime::RasterKernels;
+
+static const RasterKernels* kernels = nullptr;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " (" << (kernels ? kernels->name : "-") \
+                  << ") at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+// Source-over with a = src alpha, each channel rounded to nearest.
+static uint32_t referenceBlend(uint32_t s, uint32_t d) {
+    uint32_t a = s >> 24, out = 0;
+    for (int ch = 0; ch < 4; ++ch) {
+        uint32_t sc = ch == 3 ? 255 : (s >> (8 * ch)) & 255, dc = (d >> (8 * ch)) & 255;
+        uint32_t v = sc * a + dc * (255 - a);
+        out |= ((2 * v + 255) / 510) << (8 * ch);
+    }
+    return out;
+}
+
+static std::vector<uint32_t> randomPixels(size_t n, std::mt19937& rng) {
+    std::vector<uint32_t> v(n);
+    for (auto& p : v) {
+        p = rng();
+        // Plenty of the special alphas.
+        if (rng() % 4 == 0) p = (p & 0xffffff) | (rng() % 2 ? 0xff000000u : 0u);
+    }
+    return v;
+}
+
+TEST(spans_match_reference) {
+    std::mt19937 rng(1);
+    for (size_t n = 0; n <= 70; ++n) {
+        for (int round = 0; round < 8; ++round) {
+            std::vector<uint32_t> dst = randomPixels(n + 2, rng), src = randomPixels(n, rng);
+            uint32_t color = randomPixels(1, rng)[0];
+
+            std::vector<uint32_t> got = dst;
+            kernels->fill(got.data() + 1, n, color);
+            for (size_t i = 0; i < n; ++i) ASSERT_EQ(got[i + 1], color);
+            ASSERT_EQ(got[0], dst[0]);
+            ASSERT_EQ(got[n + 1], dst[n + 1]);
+
+            got = dst;
+            kernels->blendColor(got.data() + 1, n, color);
+            for (size_t i = 0; i < n; ++i) ASSERT_EQ(got[i + 1], referenceBlend(color, dst[i + 1]));
+            ASSERT_EQ(got[n + 1], dst[n + 1]);
+
+            got = dst;
+            kernels->blend(got.data() + 1, src.data(), n);
+            for (size_t i = 0; i < n; ++i) ASSERT_EQ(got[i + 1], referenceBlend(src[i], dst[i + 1]));
+            ASSERT_EQ(got[n + 1], dst[n + 1]);
+        }
+    }
+    // Every alpha against every channel value of one destination.
+    for (uint32_t a = 0; a < 256; ++a) {
+        std::vector<uint32_t> dst(256), src(256);
+        for (uint32_t c = 0; c < 256; ++c) {
+            dst[c] = c * 0x01010101u;
+            src[c] = a << 24 | (255 - c) * 0x010101u;
+        }
+        std::vector<uint32_t> got = dst;
+        kernels->blend(got.data(), src.data(), 256);
+        for (uint32_t c = 0; c < 256; ++c) ASSERT_EQ(got[c], referenceBlend(src[c], dst[c]));
+    }
+}
+
+TEST(primitives_clip_like_per_pixel_loops) {
+    const int64_t W = 37, H = 23;
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int64_t> coord(-30, 60), size(-3, 50);
+    for (int round = 0; round < 300; ++round) {
+        std::vector<uint32_t> base = randomPixels(W * H, rng);
+        Framebuffer fb{nullptr, W, H};
+        uint32_t color = rng();
+        int64_t x = coord(rng), y = coord(rng), w = size(rng), h = size(rng);
+
+        std::vector<uint32_t> got = base, want = base;
+        fb.pixels = got.data();
+        tocin::runtime::fillRect(*kernels, fb, x, y, w, h, color);
+        for (int64_t yy = y; yy < y + h; ++yy)
+            for (int64_t xx = x; xx < x + w; ++xx)
+                if (xx >= 0 && yy >= 0 && xx < W && yy < H) want[yy * W + xx] = color;
+        ASSERT_TRUE(got == want);
+
+        got = base;
+        want = base;
+        fb.pixels = got.data();
+        tocin::runtime::blendRect(*kernels, fb, x, y, w, h, color);
+        for (int64_t yy = y; yy < y + h; ++yy)
+            for (int64_t xx = x; xx < x + w; ++xx)
+                if (xx >= 0 && yy >= 0 && xx < W && yy < H) want[yy * W + xx] = referenceBlend(color, base[yy * W + xx]);
+        ASSERT_TRUE(got == want);
+
+        int64_t r = size(rng) / 2;
+        got = base;
+        want = base;
+        fb.pixels = got.data();
+        tocin::runtime::fillCircle(*kernels, fb, x, y, r, color);
+        for (int64_t dy = -r; dy <= r; ++dy)
+            for (int64_t dx = -r; dx <= r; ++dx)
+                if (dx * dx + dy * dy <= r * r && x + dx >= 0 && y + dy >= 0 && x + dx < W && y + dy < H)
+                    want[(y + dy) * W + x + dx] = color;
+        ASSERT_TRUE(got == want);
+
+        int64_t sw = 1 + rng() % 20, sh = 1 + rng() % 20;
+        std::vector<uint32_t> sprite = randomPixels(sw * sh, rng);
+        for (bool blended : {false, true}) {
+            got = base;
+            want = base;
+            fb.pixels = got.data();
+            tocin::runtime::blit(*kernels, fb, x, y, Framebuffer{sprite.data(), sw, sh}, blended);
+            for (int64_t sy = 0; sy < sh; ++sy)
+                for (int64_t sx = 0; sx < sw; ++sx) {
+                    int64_t xx = x + sx, yy = y + sy;
+                    if (xx < 0 || yy < 0 || xx >= W || yy >= H) continue;
+                    uint32_t s = sprite[sy * sw + sx];
+                    want[yy * W + xx] = blended ? referenceBlend(s, base[yy * W + xx]) : s;
+                }
+            ASSERT_TRUE(got == want);
+        }
+    }
+}
+
+TEST(entry_points_take_addresses) {
+    std::vector<uint32_t> fb(8 * 4, 0);
+    auto addr = reinterpret_cast<int64_t>(fb.data());
+    ASSERT_EQ(__tocin_fb_fill_rect(addr, 8, 4, 0, 0, 8, 4, 0xff000000), 0);  // clear
+    __tocin_fb_fill_rect(addr, 8, 4, 6, 2, 10, 10, 0xff0000ff);
+    ASSERT_EQ(fb[2 * 8 + 7], 0xff0000ffu);
+    ASSERT_EQ(fb[2 * 8 + 5], 0xff000000u);
+    __tocin_fb_blend_rect(addr, 8, 4, 0, 0, 1, 1, 0x80ffffff);
+    ASSERT_EQ(fb[0], 0xff808080u);
+    __tocin_fb_fill_circle(addr, 8, 4, 1, 1, 1, 0xff00ff00);
+    ASSERT_EQ(fb[1 * 8 + 2], 0xff00ff00u);
+    ASSERT_EQ(fb[2 * 8 + 2], 0xff000000u);
+    uint32_t sprite[2] = {0x11223344, 0x00ffffff};
+    __tocin_fb_blit(addr, 8, 4, 7, 3, reinterpret_cast<int64_t>(sprite), 2, 1, 0);
+    ASSERT_EQ(fb[3 * 8 + 7], 0x11223344u);
+    __tocin_fb_blit(addr, 8, 4, -1, 0, reinterpret_cast<int64_t>(sprite), 2, 1, 1);
+    ASSERT_EQ(fb[0], 0xff808080u);  // a fully transparent pixel leaves dst alone
+    // Empty framebuffers and huge shapes are clipped, not written.
+    __tocin_fb_fill_rect(addr, 0, 4, 0, 0, 8, 4, 0);
+    __tocin_fb_fill_circle(addr, 8, 4, INT64_MAX, INT64_MIN, INT64_MAX, 0);
+    __tocin_fb_fill_rect(addr, 8, 4, INT64_MAX, 0, INT64_MAX, 1, 0);
+    ASSERT_EQ(fb[3 * 8 + 7], 0x11223344u);
+}
+
+int main() {
+    std::cout << "=== Raster Kernel Tests ===\n\n";
+
+    for (const RasterKernels* k : tocin::runtime::availableRasterKernels()) {
+        kernels = k;
+        std::cout << "[" << k->name << "]\n";
+        RUN_TEST(spans_match_reference);
+        RUN_TEST(primitives_clip_like_per_pixel_loops);
+    }
+    kernels = &tocin::runtime::rasterKernels();
+    RUN_TEST(entry_points_take_addresses);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
@@ -0,0 +1,156 @@
+// Runtime Metrics Tests for Tocin Compiler
+//
+// runtime_metrics.h: the runtimeStats record, channel contention counted
+// on the blocking path only, the Prometheus text rendering and the scrape
+// endpoint answering over a real socket.
+
+#include "runtime/concurrency.h"
+#include "runtime/runtime_metrics.h"
+
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+extern "C" void __tocin_join_all();
+extern "C" int64_t __tocin_runtime_stats(int64_t* rec);
+
+using namespace tocin::runtime;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static bool contains(const std::string& text, const char* needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+TEST(stats_record_follows_the_scheduler) {
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 32; ++i) {
+        executorSubmit([&] { ran++; });
+    }
+    __tocin_join_all();
+    ASSERT_EQ(ran.load(), 32);
+
+    int64_t rec[17];
+    ASSERT_EQ(__tocin_runtime_stats(rec), 17);
+    ASSERT_EQ(rec[0], 2);            // TOCIN_MAX_PROCS workers
+    ASSERT_EQ(rec[1], 0);            // nothing still running
+    ASSERT_TRUE(rec[2] >= 32);       // completed
+    ASSERT_TRUE(rec[7] > 0);         // busy ns
+    ASSERT_EQ(__tocin_runtime_stats(nullptr), -1);
+}
+
+TEST(only_blocked_channel_operations_count) {
+    RuntimeMetrics before = runtimeMetrics();
+    runtime::Channel<int> ch(4);
+    ch.send(1);
+    ASSERT_EQ(*ch.receive(), 1);     // fast paths: no waits
+    RuntimeMetrics mid = runtimeMetrics();
+    ASSERT_EQ(mid.channelReceiveWaits, before.channelReceiveWaits);
+    ASSERT_EQ(mid.channelSendWaits, before.channelSendWaits);
+
+    std::thread receiver([&] { ASSERT_EQ(*ch.receive(), 2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ch.send(2);
+    receiver.join();
+    RuntimeMetrics after = runtimeMetrics();
+    ASSERT_TRUE(after.channelReceiveWaits > mid.channelReceiveWaits);
+    ASSERT_EQ(after.channelSendWaits, mid.channelSendWaits);
+}
+
+TEST(prometheus_text_has_every_family) {
+    std::string text = formatMetrics(runtimeMetrics());
+    ASSERT_TRUE(contains(text, "# TYPE tocin_sched_workers gauge\ntocin_sched_workers 2\n"));
+    ASSERT_TRUE(contains(text, "# TYPE tocin_sched_fibers_completed_total counter\n"));
+    ASSERT_TRUE(contains(text, "tocin_sched_fibers_executed_total{worker=\"0\"} "));
+    ASSERT_TRUE(contains(text, "tocin_sched_fibers_stolen_total{worker=\"1\"} "));
+    ASSERT_TRUE(contains(text, "tocin_sched_parks_total{worker=\"0\"} "));
+    ASSERT_TRUE(contains(text, "tocin_sched_unparks_total{worker=\"0\"} "));
+    ASSERT_TRUE(contains(text, "tocin_sched_queue_depth{worker=\"1\"} 0\n"));
+    ASSERT_TRUE(contains(text, "tocin_sched_busy_seconds_total{worker=\"0\"} 0."));
+    ASSERT_TRUE(contains(text, "tocin_channel_waits_total{op=\"select\"} "));
+    ASSERT_TRUE(text.back() == '\n');
+}
+
+#ifndef _WIN32
+// One HTTP exchange with the endpoint on 127.0.0.1:port.
+static std::string scrape(int port, const std::string& request) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_TRUE(fd >= 0);
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_TRUE(::connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+    ASSERT_TRUE(::send(fd, request.data(), request.size(), 0) == (ssize_t)request.size());
+    std::string reply;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0) {
+        reply.append(buf, (size_t)n);
+    }
+    ::close(fd);
+    return reply;
+}
+
+TEST(endpoint_answers_scrapes) {
+    int port = 0;
+    int64_t fd = -1;
+    for (port = 39100; port < 39200 && fd < 0; ++port) {
+        fd = serveMetrics(port);
+    }
+    --port;
+    ASSERT_TRUE(fd >= 0);
+
+    std::string reply = scrape(port, "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n");
+    ASSERT_TRUE(contains(reply, "HTTP/1.1 200 OK\r\n"));
+    ASSERT_TRUE(contains(reply, "Content-Type: text/plain; version=0.0.4"));
+    ASSERT_TRUE(contains(reply, "\r\n\r\n# HELP tocin_sched_workers"));
+
+    ASSERT_TRUE(contains(scrape(port, "GET /other HTTP/1.1\r\n\r\n"), "404 Not Found"));
+    ASSERT_TRUE(contains(scrape(port, "POST /metrics HTTP/1.1\r\n\r\n"), "405 Method Not Allowed"));
+    std::string head = scrape(port, "HEAD /metrics HTTP/1.1\r\n\r\n");
+    ASSERT_TRUE(contains(head, "200 OK") && !contains(head, "# HELP"));
+}
+#endif
+
+int main() {
+    std::cout << "=== Runtime Metrics Tests ===\n\n";
+
+    setenv("TOCIN_MAX_PROCS", "2", 1);
+
+    RUN_TEST(stats_record_follows_the_scheduler);
+    RUN_TEST(only_blocked_channel_operations_count);
+    RUN_TEST(prometheus_text_has_every_family);
+#ifndef _WIN32
+    RUN_TEST(endpoint_answers_scrapes);
+#endif
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
@@ -0,0 +1,157 @@
+// Sampling Profiler Tests for Tocin Compiler
+//
+// sampling_profiler.h: SIGPROF samples of a CPU-bound loop, names from
+// registered ranges, and the folded and gzipped pprof outputs.
+
+#include "runtime/sampling_profiler.h"
+
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <time.h>
+
+using namespace tocin::runtime;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static bool contains(const std::string& text, const char* needle) {
+    return text.find(needle) != std::string::npos;
+}
+
+static volatile uint64_t sink;
+
+static int64_t cpuNanos() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Burn `ms` of this process's CPU time. ITIMER_PROF counts CPU, not wall,
+// time, so on a busy machine a wall-clock deadline would yield few samples.
+__attribute__((noinline)) static void spin(int ms) {
+    const int64_t until = cpuNanos() + (int64_t)ms * 1000000;
+    uint64_t x = 1;
+    while (cpuNanos() < until) {
+        for (int i = 0; i < 10000; ++i) x = x * 6364136223846793005ull + 1442695040888963407ull;
+    }
+    sink = x;
+}
+
+static std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+TEST(registered_ranges_name_addresses) {
+    auto& profiler = SamplingProfiler::instance();
+    profiler.addSymbol(0x10000, 0x100, "jit_fn");
+    ASSERT_EQ(profiler.symbolize(0x10000), "jit_fn");
+    ASSERT_EQ(profiler.symbolize(0x100ff), "jit_fn");
+    ASSERT_TRUE(profiler.symbolize(0x10100) != "jit_fn");
+
+    // A later registration over part of the range wins there only.
+    profiler.addSymbol(0x10080, 0x40, "recompiled");
+    ASSERT_EQ(profiler.symbolize(0x10090), "recompiled");
+    ASSERT_EQ(profiler.symbolize(0x10010), "jit_fn");
+    ASSERT_EQ(profiler.symbolize(0x100f0), "jit_fn");
+
+    profiler.removeSymbols(0x10000, 0x10100);
+    ASSERT_TRUE(profiler.symbolize(0x10010) != "jit_fn");
+    ASSERT_TRUE(profiler.symbolize(0x10090) != "recompiled");
+}
+
+TEST(samples_a_busy_loop) {
+    auto& profiler = SamplingProfiler::instance();
+    // Name the loop by hand, as the JIT listener would: the test binary
+    // exports no symbols for dladdr.
+    auto start = reinterpret_cast<uint64_t>(&spin);
+    profiler.addSymbol(start, 256, "spin_loop");
+
+    ASSERT_TRUE(profiler.start(500));
+    ASSERT_TRUE(profiler.running());
+    ASSERT_TRUE(!profiler.start(500)); // one profile at a time
+    spin(400);
+    profiler.stop();
+    ASSERT_TRUE(!profiler.running());
+
+    // 400 ms at 500 Hz is ~200 samples; timer slack costs a few.
+    ASSERT_TRUE(profiler.sampleCount() >= 50);
+    std::string folded = profiler.folded();
+    ASSERT_TRUE(contains(folded, "spin_loop"));
+    // Every line is "frame;frame;... count".
+    size_t total = 0, pos = 0;
+    while (pos < folded.size()) {
+        size_t eol = folded.find('\n', pos);
+        ASSERT_TRUE(eol != std::string::npos);
+        std::string line = folded.substr(pos, eol - pos);
+        size_t space = line.rfind(' ');
+        ASSERT_TRUE(space != std::string::npos && space > 0);
+        total += std::strtoull(line.c_str() + space + 1, nullptr, 10);
+        pos = eol + 1;
+    }
+    ASSERT_EQ(total, profiler.sampleCount());
+
+    // Samples survive stop() and go with the next start().
+    ASSERT_TRUE(profiler.start(500));
+    profiler.stop();
+    ASSERT_TRUE(profiler.sampleCount() < 50);
+    profiler.removeSymbols(start, start + 256);
+}
+
+TEST(writes_folded_and_pprof) {
+    auto& profiler = SamplingProfiler::instance();
+    ASSERT_TRUE(profiler.start(500));
+    spin(200);
+    profiler.stop();
+    ASSERT_TRUE(profiler.sampleCount() > 0);
+
+    const std::string folded = "tocin_test_profile.folded";
+    ASSERT_TRUE(profiler.write(folded));
+    ASSERT_EQ(readFile(folded), profiler.folded());
+    std::remove(folded.c_str());
+
+    // pprof: a gzip stream (magic 1f 8b) wrapping the Profile message.
+    const std::string pprof = "tocin_test_profile.pb.gz";
+    ASSERT_TRUE(profiler.write(pprof));
+    std::string bytes = readFile(pprof);
+    ASSERT_TRUE(bytes.size() > 18);
+    ASSERT_EQ((unsigned char)bytes[0], 0x1f);
+    ASSERT_EQ((unsigned char)bytes[1], 0x8b);
+    std::remove(pprof.c_str());
+
+    std::string message = profiler.pprof();
+    ASSERT_TRUE(contains(message, "samples"));
+    ASSERT_TRUE(contains(message, "cpu"));
+    ASSERT_TRUE(contains(message, "nanoseconds"));
+}
+
+int main() {
+    std::cout << "=== Sampling Profiler Tests ===\n\n";
+
+    RUN_TEST(registered_ranges_name_addresses);
+#ifndef _WIN32
+    RUN_TEST(samples_a_busy_loop);
+    RUN_TEST(writes_folded_and_pprof);
+#endif
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Scan Kernel Tests for Tocin Compiler
+//
+// Every kernel table the CPU supports is checked against scalar loops on
+// lengths around the vector width and the four-block unroll, with matches
+// placed at every position, and the lower bound against std::lower_bound.
+// The runtime entry points take Tocin lists ([len][elements]), built here
+// by hand.
+
+#include "runtime/scan_kernels.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+extern "C" {
+int64_t __tocin_i64_sum(const int64_t* xs);
+int64_t __tocin_i64_argmin(const int64_t* xs);
+int64_t __tocin_i64_argmax(const int64_t* xs);
+int64_t __tocin_i64_count_eq(const int64_t* xs, int64_t t);
+int64_t __tocin_i64_count_gt(const int64_t* xs, int64_t t);
+int64_t __tocin_i64_find_eq(const int64_t* xs, int64_t t);
+int64_t __tocin_i64_find_gt(const int64_t* xs, int64_t t);
+int64_t __tocin_i64_find_le(const int64_t* xs, int64_t t);
+int64_t __tocin_i64_lower_bound(const int64_t* xs, int64_t t);
+}
+
+using tocin::runtime::ScanKernels;
+
+static const ScanKernels* kernels = nullptr;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " (" << (kernels ? kernels->name : "-") \
+                  << ") at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static std::vector<int64_t> randomInts(size_t n, int64_t range, std::mt19937_64& rng) {
+    std::vector<int64_t> v(n);
+    for (auto& x : v) x = static_cast<int64_t>(rng() % (2 * range + 1)) - range;
+    return v;
+}
+
+TEST(reductions_match_scalar) {
+    std::mt19937_64 rng(1);
+    for (size_t n = 1; n <= 70; ++n) {
+        std::vector<int64_t> v = randomInts(n, 1000, rng);
+        uint64_t sum = 0;
+        for (int64_t x : v) sum += static_cast<uint64_t>(x);
+        ASSERT_EQ(kernels->sum(v.data(), n), static_cast<int64_t>(sum));
+        ASSERT_EQ(kernels->min(v.data(), n), *std::min_element(v.begin(), v.end()));
+        ASSERT_EQ(kernels->max(v.data(), n), *std::max_element(v.begin(), v.end()));
+        for (int64_t t : {-1000, -3, 0, 7, 1000}) {
+            ASSERT_EQ(kernels->countEq(v.data(), n, t), (size_t)std::count(v.begin(), v.end(), t));
+            ASSERT_EQ(kernels->countGreater(v.data(), n, t),
+                      (size_t)std::count_if(v.begin(), v.end(), [&](int64_t x) { return x > t; }));
+            ASSERT_EQ(kernels->countLess(v.data(), n, t),
+                      (size_t)std::count_if(v.begin(), v.end(), [&](int64_t x) { return x < t; }));
+        }
+    }
+    // Extremes and wrap-around.
+    std::vector<int64_t> edge(37, INT64_MAX);
+    edge[20] = INT64_MIN;
+    ASSERT_EQ(kernels->min(edge.data(), edge.size()), INT64_MIN);
+    ASSERT_EQ(kernels->max(edge.data(), edge.size()), INT64_MAX);
+    ASSERT_EQ(kernels->sum(edge.data(), 2), -2);
+}
+
+TEST(finds_stop_at_the_first_match) {
+    for (size_t n = 1; n <= 70; ++n) {
+        std::vector<int64_t> v(n, 5);
+        ASSERT_EQ(kernels->findEq(v.data(), n, 6), n);
+        ASSERT_EQ(kernels->findGreater(v.data(), n, 5), n);
+        ASSERT_EQ(kernels->findNotGreater(v.data(), n, 4), n);
+        for (size_t at = 0; at < n; ++at) {
+            v[at] = 9;
+            if (at + 1 < n) v[n - 1] = 9; // a later match must not win
+            ASSERT_EQ(kernels->findEq(v.data(), n, 9), at);
+            ASSERT_EQ(kernels->findGreater(v.data(), n, 5), at);
+            v[at] = 1;
+            if (at + 1 < n) v[n - 1] = 1;
+            ASSERT_EQ(kernels->findNotGreater(v.data(), n, 4), at);
+            std::fill(v.begin(), v.end(), 5);
+        }
+    }
+}
+
+TEST(lower_bound_matches_std) {
+    std::mt19937_64 rng(2);
+    for (size_t n : {1, 2, 31, 32, 33, 100, 1000, 65537}) {
+        std::vector<int64_t> v = randomInts(n, 500, rng);
+        std::sort(v.begin(), v.end());
+        for (int64_t t = -502; t <= 502; t += 3) {
+            size_t want = std::lower_bound(v.begin(), v.end(), t) - v.begin();
+            ASSERT_EQ(tocin::runtime::lowerBound(*kernels, v.data(), n, t), want);
+        }
+    }
+}
+
+TEST(entry_points_take_lists) {
+    std::vector<int64_t> list = {6, 4, -2, 9, -2, 9, 0};
+    ASSERT_EQ(__tocin_i64_sum(list.data()), 18);
+    ASSERT_EQ(__tocin_i64_argmin(list.data()), 1);
+    ASSERT_EQ(__tocin_i64_argmax(list.data()), 2);
+    ASSERT_EQ(__tocin_i64_count_eq(list.data(), 9), 2);
+    ASSERT_EQ(__tocin_i64_count_gt(list.data(), 0), 3);
+    ASSERT_EQ(__tocin_i64_find_eq(list.data(), -2), 1);
+    ASSERT_EQ(__tocin_i64_find_eq(list.data(), 5), -1);
+    ASSERT_EQ(__tocin_i64_find_gt(list.data(), 4), 2);
+    ASSERT_EQ(__tocin_i64_find_le(list.data(), -2), 1);
+    ASSERT_EQ(__tocin_i64_find_le(list.data(), -3), -1);
+
+    std::vector<int64_t> sorted = {5, 1, 3, 3, 7, 9};
+    ASSERT_EQ(__tocin_i64_lower_bound(sorted.data(), 3), 1);
+    ASSERT_EQ(__tocin_i64_lower_bound(sorted.data(), 10), 5);
+
+    int64_t empty[1] = {0};
+    ASSERT_EQ(__tocin_i64_sum(empty), 0);
+    ASSERT_EQ(__tocin_i64_argmax(empty), -1);
+    ASSERT_EQ(__tocin_i64_find_eq(nullptr, 1), -1);
+    ASSERT_EQ(__tocin_i64_lower_bound(empty, 1), 0);
+}
+
+int main() {
+    std::cout << "=== Scan Kernel Tests ===\n\n";
+
+    for (const ScanKernels* k : tocin::runtime::availableScanKernels()) {
+        kernels = k;
+        std::cout << "[" << k->name << "]\n";
+        RUN_TEST(reductions_match_scalar);
+        RUN_TEST(finds_stop_at_the_first_match);
+        RUN_TEST(lower_bound_matches_std);
+    }
+    kernels = &tocin::runtime::scanKernels();
+    RUN_TEST(entry_points_take_lists);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
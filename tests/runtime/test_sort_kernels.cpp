@@ -0,0 +1,236 @@
+// Sort Kernel Tests for Tocin Compiler
+//
+// Each sort is checked against std::sort / std::stable_sort on random,
+// sorted, reversed, organ-pipe and few-distinct inputs at sizes around the
+// insertion-sort cutoff, the radix and merge-run thresholds and the
+// parallel sample sort. The extern "C" entry points take Tocin lists
+// ([len][elements]), built here by hand.
+
+#include "runtime/sort_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" {
+int64_t __tocin_sort_ints(int64_t* xs);
+int64_t __tocin_sort_floats(int64_t* xs);
+int64_t __tocin_sort_strings(int64_t* xs);
+int64_t __tocin_radix_sort_ints(int64_t* xs);
+int64_t __tocin_stable_sort_floats(int64_t* xs);
+int64_t __tocin_sort_by_keys(int64_t* values, int64_t* keys, int64_t floatKeys);
+int64_t __tocin_parallel_sort_ints(int64_t* xs);
+void __tocin_parallel_init(int64_t num_threads);
+}
+
+using namespace tocin::runtime;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static const size_t kSizes[] = {0, 1, 2, 23, 24, 25, 63, 64, 129, 1000, 5000, 70000};
+
+// Inputs of length n in the shapes that trip up quicksorts.
+static std::vector<int64_t> makeInts(size_t n, int shape, std::mt19937_64& rng) {
+    std::vector<int64_t> v(n);
+    for (size_t i = 0; i < n; ++i) {
+        switch (shape) {
+        case 0: v[i] = static_cast<int64_t>(rng()); break;
+        case 1: v[i] = static_cast<int64_t>(i) - 500; break;
+        case 2: v[i] = static_cast<int64_t>(n - i); break;
+        case 3: v[i] = static_cast<int64_t>(i < n / 2 ? i : n - i); break;
+        default: v[i] = static_cast<int64_t>(rng() % 4) - 2; break;
+        }
+    }
+    return v;
+}
+
+static std::vector<int64_t> asList(const std::vector<int64_t>& v) {
+    std::vector<int64_t> list(v.size() + 1);
+    list[0] = static_cast<int64_t>(v.size());
+    std::copy(v.begin(), v.end(), list.begin() + 1);
+    return list;
+}
+
+TEST(int_sorts_match_std_sort) {
+    std::mt19937_64 rng(1);
+    for (size_t n : kSizes) {
+        for (int shape = 0; shape < 5; ++shape) {
+            std::vector<int64_t> input = makeInts(n, shape, rng);
+            std::vector<int64_t> expected = input;
+            std::sort(expected.begin(), expected.end());
+
+            std::vector<int64_t> v = input;
+            pdqsort(v.data(), n);
+            ASSERT_TRUE(v == expected);
+            v = input;
+            radixSort(v.data(), n);
+            ASSERT_TRUE(v == expected);
+            v = input;
+            stableSort(v.data(), n);
+            ASSERT_TRUE(v == expected);
+            v = input;
+            parallelSort(v.data(), n);
+            ASSERT_TRUE(v == expected);
+        }
+    }
+}
+
+TEST(float_sorts_put_nans_last) {
+    std::mt19937_64 rng(2);
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    for (size_t n : {size_t(3), size_t(100), size_t(3000)}) {
+        std::vector<double> v(n);
+        for (size_t i = 0; i < n; ++i) v[i] = i % 17 == 0 ? NAN : dist(rng);
+        v[1] = -INFINITY;
+        v[2] = INFINITY;
+        std::vector<double> stable = v;
+        pdqsort(v.data(), n);
+        stableSort(stable.data(), n);
+        size_t nans = (n + 16) / 17;
+        for (const std::vector<double>* s : {&v, &stable}) {
+            for (size_t i = 0; i < n; ++i) {
+                if (i >= n - nans) {
+                    ASSERT_TRUE(std::isnan((*s)[i]));
+                } else {
+                    ASSERT_TRUE(!std::isnan((*s)[i]));
+                    if (i > 0) ASSERT_TRUE((*s)[i - 1] <= (*s)[i]);
+                }
+            }
+        }
+        ASSERT_EQ(v[0], -INFINITY);
+    }
+}
+
+TEST(stable_sort_keeps_equal_elements_in_order) {
+    // -0.0 and 0.0 compare equal: their order must survive.
+    std::vector<double> v;
+    for (int i = 0; i < 200; ++i) v.push_back(i % 2 ? -0.0 : 0.0);
+    for (int i = 0; i < 200; ++i) v.push_back(1.0 - i * 0.01);
+    std::vector<double> expected = v;
+    std::stable_sort(expected.begin(), expected.end());
+    stableSort(v.data(), v.size());
+    for (size_t i = 0; i < v.size(); ++i) {
+        ASSERT_EQ(v[i], expected[i]);
+        ASSERT_EQ(std::signbit(v[i]), std::signbit(expected[i]));
+    }
+}
+
+TEST(sort_by_keys_is_stable) {
+    std::mt19937_64 rng(3);
+    for (size_t n : {size_t(1), size_t(50), size_t(4000)}) {
+        std::vector<int64_t> keys(n), values(n);
+        for (size_t i = 0; i < n; ++i) {
+            keys[i] = static_cast<int64_t>(rng() % 64) - 32;
+            values[i] = static_cast<int64_t>(i);
+        }
+        std::vector<size_t> order(n);
+        for (size_t i = 0; i < n; ++i) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+        std::vector<int64_t> sortedKeys = keys;
+        sortByKeys(values.data(), keys.data(), n);
+        for (size_t i = 0; i < n; ++i) {
+            ASSERT_EQ(values[i], static_cast<int64_t>(order[i]));
+            ASSERT_EQ(keys[i], sortedKeys[order[i]]);
+        }
+    }
+
+    std::vector<double> fkeys = {2.5, -1.0, NAN, 2.5, -7.25, 0.0};
+    std::vector<int64_t> values = {0, 1, 2, 3, 4, 5};
+    sortByKeys(values.data(), fkeys.data(), values.size());
+    ASSERT_TRUE(values == std::vector<int64_t>({4, 1, 5, 0, 3, 2}));
+    ASSERT_EQ(fkeys[0], -7.25);
+    ASSERT_TRUE(std::isnan(fkeys[5]));
+}
+
+TEST(sample_sort_matches_std_sort) {
+    std::mt19937_64 rng(4);
+    for (size_t ways : {2, 7, 64, 4096}) {
+        for (int shape = 0; shape < 5; ++shape) {
+            std::vector<int64_t> v = makeInts(100000, shape, rng);
+            std::vector<int64_t> expected = v;
+            std::sort(expected.begin(), expected.end());
+            sampleSort(v.data(), v.size(), ways);
+            ASSERT_TRUE(v == expected);
+        }
+    }
+    std::vector<double> f(50000);
+    for (size_t i = 0; i < f.size(); ++i) f[i] = i % 1000 == 0 ? NAN : static_cast<double>(rng() % 1000);
+    sampleSort(f.data(), f.size(), 32);
+    for (size_t i = 1; i < f.size() - 50; ++i) ASSERT_TRUE(f[i - 1] <= f[i]);
+    for (size_t i = f.size() - 50; i < f.size(); ++i) ASSERT_TRUE(std::isnan(f[i]));
+}
+
+TEST(entry_points_take_lists) {
+    std::mt19937_64 rng(5);
+    std::vector<int64_t> input = makeInts(3000, 0, rng);
+    std::vector<int64_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+    for (auto fn : {__tocin_sort_ints, __tocin_radix_sort_ints, __tocin_parallel_sort_ints}) {
+        std::vector<int64_t> list = asList(input);
+        ASSERT_EQ(fn(list.data()), 0);
+        ASSERT_TRUE(std::equal(expected.begin(), expected.end(), list.begin() + 1));
+    }
+    ASSERT_EQ(__tocin_sort_ints(nullptr), 0);
+
+    int64_t floats[4] = {3};
+    double fv[3] = {2.0, NAN, -1.0};
+    std::memcpy(floats + 1, fv, sizeof(fv));
+    __tocin_sort_floats(floats);
+    std::memcpy(fv, floats + 1, sizeof(fv));
+    ASSERT_EQ(fv[0], -1.0);
+    ASSERT_EQ(fv[1], 2.0);
+    ASSERT_TRUE(std::isnan(fv[2]));
+    std::memcpy(floats + 1, fv, sizeof(fv));
+    __tocin_stable_sort_floats(floats);
+
+    const char* words[] = {"pear", "apple", "", "apples", "Zebra"};
+    int64_t strings[6] = {5};
+    for (int i = 0; i < 5; ++i) strings[i + 1] = reinterpret_cast<int64_t>(words[i]);
+    __tocin_sort_strings(strings);
+    const char* sorted[] = {"", "Zebra", "apple", "apples", "pear"};
+    for (int i = 0; i < 5; ++i) ASSERT_EQ(std::string(reinterpret_cast<const char*>(strings[i + 1])), sorted[i]);
+
+    int64_t values[4] = {3, 10, 20, 30};
+    int64_t keys[4] = {3, 9, -4, 0};
+    __tocin_sort_by_keys(values, keys, 0);
+    ASSERT_EQ(values[1], 20);
+    ASSERT_EQ(values[2], 30);
+    ASSERT_EQ(values[3], 10);
+    ASSERT_EQ(keys[1], -4);
+}
+
+int main() {
+    std::cout << "=== Sort Kernel Tests ===\n\n";
+    // Enough workers for the parallel paths even on a single-core machine.
+    __tocin_parallel_init(4);
+
+    RUN_TEST(int_sorts_match_std_sort);
+    RUN_TEST(float_sorts_put_nans_last);
+    RUN_TEST(stable_sort_keeps_equal_elements_in_order);
+    RUN_TEST(sort_by_keys_is_stable);
+    RUN_TEST(sample_sort_matches_std_sort);
+    RUN_TEST(entry_points_take_lists);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
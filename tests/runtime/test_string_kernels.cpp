@@ -0,0 +1,302 @@
+// String Kernel Tests for Tocin Compiler
+//
+// Every kernel table the CPU supports is checked against the C library on
+// all alignments, and the block-reading scans are run on strings that end
+// at an unmapped page. The runtime entry points take length-prefixed
+// strings, built here with __tocin_str_from_c.
+
+#include "runtime/string_kernels.h"
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define HAVE_MMAN 1
+#endif
+
+extern "C" {
+int64_t __tocin_str_len(const char* s);
+int64_t __tocin_str_eq(const char* a, const char* b);
+int64_t __tocin_str_index_of(const char* s, const char* sub);
+int64_t __tocin_str_index_of_char(const char* s, int64_t c);
+int64_t __tocin_str_char_at(const char* s, int64_t i);
+char* __tocin_str_substring(const char* s, int64_t start, int64_t len);
+char* __tocin_str_to_upper(const char* s);
+char* __tocin_str_concat(const char* a, const char* b);
+char* __tocin_str_append(char* s, const char* t, int64_t owned);
+char* __tocin_str_from_c(const char* s);
+char* __tocin_buf_to_str(const char* p, int64_t n);
+void* __tocin_sb_new();
+void __tocin_sb_append(void* b, const char* s);
+void __tocin_sb_append_int(void* b, int64_t n);
+void __tocin_sb_append_float(void* b, double d);
+int64_t __tocin_sb_len(void* b);
+char* __tocin_sb_finish(void* b);
+char* __tocin_float_to_str(double d);
+double __tocin_str_to_float(const char* s);
+char* __tocin_floats_to_str(const void* arr, const char* sep);
+void* __tocin_str_to_floats(const char* s, int64_t sep);
+}
+
+static char* S(const char* s) { return __tocin_str_from_c(s); }
+
+using tocin::runtime::StringKernels;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " (" << kernels->name << ")\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static const StringKernels* kernels = &tocin::runtime::stringKernels();
+
+static char upperRef(char c) { return (c >= 'a' && c <= 'z') ? (char)(c - 32) : c; }
+static char lowerRef(char c) { return (c >= 'A' && c <= 'Z') ? (char)(c + 32) : c; }
+
+// Letters of both cases, punctuation next to the letter ranges and bytes
+// with the high bit set, never NUL.
+static char randomByte(std::mt19937& rng) {
+    static const char pool[] = "azAZmM@[`{~ 09\x80\xc3\xff\xe1\xc1\xfb";
+    return pool[rng() % (sizeof pool - 1)];
+}
+
+TEST(matches_libc_on_every_alignment) {
+    std::mt19937 rng(7);
+    std::vector<char> buffer(512), copy(512), out(512);
+    for (size_t offset = 0; offset < 64; ++offset) {
+        for (size_t n = 0; n < 200; n += (n < 40 ? 1 : 7)) {
+            char* s = buffer.data() + offset;
+            for (size_t i = 0; i < n; ++i) s[i] = randomByte(rng);
+            s[n] = '\0';
+            ASSERT_EQ(kernels->length(s), n);
+
+            for (unsigned char c : {(unsigned char)'a', (unsigned char)'Z', (unsigned char)0xff,
+                                    (unsigned char)'#', (unsigned char)0}) {
+                const char* want = c ? std::strchr(s, c) : nullptr;
+                ASSERT_EQ(kernels->findByte(s, c), want);
+            }
+
+            char* t = copy.data() + (offset * 7) % 64;
+            std::memcpy(t, s, n + 1);
+            ASSERT_TRUE(kernels->equal(s, t));
+            if (n > 0) {
+                size_t at = rng() % n;
+                t[at] ^= 1;
+                ASSERT_TRUE(!kernels->equal(s, t));
+                t[at] ^= 1;
+                t[n - 1] = '\0'; // a prefix is not equal either
+                ASSERT_TRUE(!kernels->equal(s, t));
+                ASSERT_TRUE(!kernels->equal(t, s));
+            }
+
+            kernels->toUpper(out.data(), s, n);
+            for (size_t i = 0; i < n; ++i) ASSERT_EQ(out[i], upperRef(s[i]));
+            kernels->toLower(out.data(), s, n);
+            for (size_t i = 0; i < n; ++i) ASSERT_EQ(out[i], lowerRef(s[i]));
+        }
+    }
+}
+
+TEST(find_matches_std_string) {
+    std::mt19937 rng(11);
+    for (int round = 0; round < 3000; ++round) {
+        size_t n = rng() % 300, m = 1 + rng() % 12;
+        std::string hay, needle;
+        for (size_t i = 0; i < n; ++i) hay += "ab"[rng() % 2];
+        for (size_t i = 0; i < m; ++i) needle += "ab"[rng() % 2];
+        const char* got = kernels->find(hay.data(), hay.size(), needle.data(), needle.size());
+        size_t want = hay.find(needle);
+        ASSERT_EQ(got ? (size_t)(got - hay.data()) : std::string::npos, want);
+    }
+}
+
+TEST(find_stays_linear_on_repetitive_input) {
+    // Every position matches the needle's first and last byte, so the block
+    // filter has to hand over to the fallback; the match is at the end.
+    std::string needle(1000, 'a');
+    needle[500] = 'b';
+    std::string hay = std::string(1 << 20, 'a') + needle;
+    const char* got = kernels->find(hay.data(), hay.size(), needle.data(), needle.size());
+    ASSERT_EQ(got, hay.data() + hay.size() - needle.size());
+    needle[500] = 'c';
+    ASSERT_EQ(kernels->find(hay.data(), hay.size(), needle.data(), needle.size()), nullptr);
+}
+
+TEST(scans_stop_at_unmapped_page) {
+#ifdef HAVE_MMAN
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char* base = (char*)mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_TRUE(base != MAP_FAILED);
+    ASSERT_EQ(mprotect(base + page, page, PROT_NONE), 0);
+    char* other = (char*)std::malloc(page);
+    for (size_t n = 0; n < 100; ++n) {
+        // The terminator is the last readable byte.
+        char* s = base + page - n - 1;
+        std::memset(s, 'x', n);
+        s[n] = '\0';
+        ASSERT_EQ(kernels->length(s), n);
+        ASSERT_EQ(kernels->findByte(s, 'y'), nullptr);
+        std::memcpy(other, s, n + 1);
+        ASSERT_TRUE(kernels->equal(s, other));
+        ASSERT_TRUE(kernels->equal(other, s));
+    }
+    std::free(other);
+    munmap(base, 2 * page);
+#endif
+}
+
+TEST(runtime_entry_points) {
+    ASSERT_EQ(__tocin_str_len(S("hello")), 5);
+    ASSERT_EQ(__tocin_str_len(nullptr), 0);
+    ASSERT_EQ(__tocin_str_eq(S("json"), S("json")), 1);
+    ASSERT_EQ(__tocin_str_eq(S("json"), S("jso")), 0);
+    ASSERT_EQ(__tocin_str_index_of(S("GET /index.html HTTP/1.1"), S("HTTP")), 16);
+    ASSERT_EQ(__tocin_str_index_of(S("abc"), S("")), 0);
+    ASSERT_EQ(__tocin_str_index_of(S("abc"), S("abcd")), -1);
+    ASSERT_EQ(__tocin_str_index_of_char(S("key: value"), ':'), 3);
+    ASSERT_EQ(__tocin_str_index_of_char(S("key"), 0), -1);
+    ASSERT_EQ(__tocin_str_index_of_char(S("key"), 'y' + 256), 2);
+    ASSERT_EQ(__tocin_str_char_at(S("abc"), 2), 'c');
+    ASSERT_EQ(__tocin_str_char_at(S("abc"), 3), -1);
+    ASSERT_EQ(__tocin_str_char_at(S("abc"), -1), -1);
+    ASSERT_EQ(std::strcmp(__tocin_str_substring(S("abcdef"), 2, 3), "cde"), 0);
+    ASSERT_EQ(std::strcmp(__tocin_str_substring(S("abcdef"), 4, 100), "ef"), 0);
+    ASSERT_EQ(std::strcmp(__tocin_str_substring(S("abc"), 9, 2), ""), 0);
+    ASSERT_EQ(std::strcmp(__tocin_str_to_upper(S("Content-Type: \xc3\xa9t\xc3\xa9")),
+                          "CONTENT-TYPE: \xc3\xa9T\xc3\xa9"), 0);
+    char* kv = __tocin_str_concat(S("key"), S("=value"));
+    ASSERT_EQ(std::strcmp(kv, "key=value"), 0);
+    ASSERT_EQ(__tocin_str_len(kv), 9);
+}
+
+TEST(lengths_come_from_the_header) {
+    // Bytes after an embedded NUL still count, and a search can find them.
+    char* s = __tocin_buf_to_str("ab\0cd", 5);
+    ASSERT_EQ(__tocin_str_len(s), 5);
+    ASSERT_EQ(__tocin_str_index_of(s, S("cd")), 3);
+    ASSERT_EQ(__tocin_str_char_at(s, 4), 'd');
+    ASSERT_EQ(__tocin_str_eq(s, S("ab")), 0);
+}
+
+TEST(append_grows_in_place) {
+    // Not owned: the input is copied, never written.
+    char* lit = S("x");
+    char* s = __tocin_str_append(lit, S("y"), 0);
+    ASSERT_TRUE(s != lit);
+    ASSERT_EQ(std::strcmp(lit, "x"), 0);
+    // Owned: later appends reuse the buffer until it fills, and the buffer
+    // grows geometrically, so 1000 appends move it only a few times.
+    std::string want = "xy";
+    int moves = 0;
+    for (int i = 0; i < 1000; ++i) {
+        char* next = __tocin_str_append(s, S("abc"), 1);
+        if (next != s) ++moves;
+        s = next;
+        want += "abc";
+    }
+    ASSERT_EQ(std::strcmp(s, want.c_str()), 0);
+    ASSERT_EQ(__tocin_str_len(s), (int64_t)want.size());
+    ASSERT_TRUE(moves < 12);
+    // s + s.
+    char* d = __tocin_str_append(S("ab"), S(""), 0);
+    d = __tocin_str_append(d, d, 1);
+    d = __tocin_str_append(d, d, 1);
+    ASSERT_EQ(std::strcmp(d, "abababab"), 0);
+    ASSERT_EQ(__tocin_str_len(d), 8);
+}
+
+TEST(builder_formats_into_its_buffer) {
+    void* sb = __tocin_sb_new();
+    std::string want;
+    for (int64_t i = -50; i < 2000; ++i) {
+        __tocin_sb_append_int(sb, i * 7919);
+        __tocin_sb_append(sb, S(";"));
+        want += std::to_string(i * 7919) + ";";
+    }
+    __tocin_sb_append_int(sb, INT64_MIN);
+    __tocin_sb_append_float(sb, 0.125);
+    want += "-9223372036854775808" "0.125";
+    ASSERT_EQ(__tocin_sb_len(sb), (int64_t)want.size());
+    char* s = __tocin_sb_finish(sb);
+    ASSERT_EQ(std::strcmp(s, want.c_str()), 0);
+    ASSERT_EQ(__tocin_str_len(s), (int64_t)want.size());
+    // Finishing empties the builder; the handed-over string is left alone.
+    ASSERT_EQ(__tocin_sb_len(sb), 0);
+    __tocin_sb_append(sb, S("next"));
+    ASSERT_EQ(std::strcmp(__tocin_sb_finish(sb), "next"), 0);
+    ASSERT_EQ(std::strcmp(s, want.c_str()), 0);
+    ASSERT_EQ(__tocin_str_len(__tocin_sb_finish(sb)), 0);
+}
+
+TEST(floats_round_trip) {
+    // Shortest text that parses back to the same bits.
+    std::mt19937_64 rng(3);
+    for (int i = 0; i < 100000; ++i) {
+        uint64_t bits = rng();
+        double d;
+        std::memcpy(&d, &bits, sizeof d);
+        if (d != d) continue; // NaN payloads do not survive text
+        double back = __tocin_str_to_float(__tocin_float_to_str(d));
+        ASSERT_EQ(std::memcmp(&back, &d, sizeof d), 0);
+    }
+    ASSERT_EQ(std::strcmp(__tocin_float_to_str(0.1 + 0.2), "0.30000000000000004"), 0);
+    ASSERT_EQ(std::strcmp(__tocin_float_to_str(15.0), "15"), 0);
+    // atof-style leniency: leading space and '+', trailing text, junk -> 0.
+    ASSERT_EQ(__tocin_str_to_float(S("  +2.5kg")), 2.5);
+    ASSERT_EQ(__tocin_str_to_float(S("x")), 0.0);
+    ASSERT_TRUE(__tocin_str_to_float(S("1e999")) > 1e308);
+
+    std::vector<int64_t> arr(4);
+    arr[0] = 3;
+    const double xs[] = {0.5, -1e-7, 3.0};
+    std::memcpy(&arr[1], xs, sizeof xs);
+    char* text = __tocin_floats_to_str(arr.data(), S(", "));
+    ASSERT_EQ(std::strcmp(text, "0.5, -1e-07, 3"), 0);
+    ASSERT_EQ(__tocin_str_len(text), 14);
+    const int64_t* parsed = static_cast<const int64_t*>(__tocin_str_to_floats(text, ','));
+    ASSERT_EQ(parsed[0], 3);
+    ASSERT_EQ(std::memcmp(parsed + 1, xs, sizeof xs), 0);
+    parsed = static_cast<const int64_t*>(__tocin_str_to_floats(S("1,,x,"), ','));
+    ASSERT_EQ(parsed[0], 4);
+    ASSERT_EQ(std::memcmp(parsed + 1, std::vector<double>{1, 0, 0, 0}.data(), 4 * sizeof(double)), 0);
+    ASSERT_EQ(*static_cast<const int64_t*>(__tocin_str_to_floats(S(""), ',')), 0);
+}
+
+int main() {
+    std::cout << "=== String Kernel Tests ===\n\n";
+
+    for (const StringKernels* table : tocin::runtime::availableStringKernels()) {
+        kernels = table;
+        std::cout << "-- " << table->name << "\n";
+        RUN_TEST(matches_libc_on_every_alignment);
+        RUN_TEST(find_matches_std_string);
+        RUN_TEST(find_stays_linear_on_repetitive_input);
+        RUN_TEST(scans_stop_at_unmapped_page);
+    }
+    kernels = &tocin::runtime::stringKernels();
+    RUN_TEST(runtime_entry_points);
+    RUN_TEST(lengths_come_from_the_header);
+    RUN_TEST(append_grows_in_place);
+    RUN_TEST(builder_formats_into_its_buffer);
+    RUN_TEST(floats_round_trip);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
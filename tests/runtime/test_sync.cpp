@@ -0,0 +1,235 @@
+// Sync Tests for Tocin Compiler
+//
+// WaitGroup, Mutex, RWLock and Once from sync.h: mutual exclusion between
+// goroutines and plain threads, waiters parked without holding their
+// workers, readers sharing an RWLock that writers take alone, and a Once
+// that runs its function exactly once.
+
+#include "runtime/executor.h"
+#include "runtime/sync.h"
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+extern "C" void __tocin_join_all();
+
+using tocin::runtime::executorSubmit;
+using tocin::runtime::Mutex;
+using tocin::runtime::Once;
+using tocin::runtime::RWLock;
+using tocin::runtime::WaitGroup;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+// Spin (on a plain thread) until flag is set, for at most five seconds.
+static bool waitFor(const std::atomic<bool>& flag) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!flag.load()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+TEST(wait_group_waits_for_every_goroutine) {
+    WaitGroup wg;
+    std::atomic<int> done{0};
+    wg.add(64);
+    for (int i = 0; i < 64; ++i) {
+        executorSubmit([&] {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            ++done;
+            wg.done();
+        });
+    }
+    wg.wait();
+    ASSERT_EQ(done.load(), 64);
+    ASSERT_EQ(wg.count(), 0);
+    wg.wait();   // already zero: returns at once
+    __tocin_join_all();
+}
+
+TEST(mutex_excludes_goroutines_and_threads) {
+    Mutex m;
+    int64_t counter = 0;   // deliberately not atomic
+    const int kGoroutines = 8, kThreads = 2, kEach = 20000;
+    for (int g = 0; g < kGoroutines; ++g) {
+        executorSubmit([&] {
+            for (int i = 0; i < kEach; ++i) {
+                m.lock();
+                ++counter;
+                m.unlock();
+            }
+        });
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < kEach; ++i) {
+                m.lock();
+                ++counter;
+                m.unlock();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    __tocin_join_all();
+    ASSERT_EQ(counter, int64_t(kGoroutines + kThreads) * kEach);
+    ASSERT_TRUE(!m.locked());
+    ASSERT_TRUE(m.tryLock());
+    ASSERT_TRUE(!m.tryLock());
+    m.unlock();
+}
+
+TEST(blocked_lockers_park_their_goroutines) {
+    // More blocked lockers than workers: had they held their threads, the
+    // goroutine that sets `ran` would never run and the lock never be freed.
+    Mutex m;
+    std::atomic<int> got{0};
+    std::atomic<bool> ran{false};
+    m.lock();
+    for (int i = 0; i < 16; ++i) {
+        executorSubmit([&] {
+            m.lock();
+            ++got;
+            m.unlock();
+        });
+    }
+    executorSubmit([&] { ran = true; });
+    ASSERT_TRUE(waitFor(ran));
+    ASSERT_EQ(got.load(), 0);
+    m.unlock();
+    __tocin_join_all();
+    ASSERT_EQ(got.load(), 16);
+}
+
+TEST(readers_share_and_writers_exclude) {
+    RWLock l;
+    int64_t a = 0, b = 0;   // a writer keeps them equal
+    std::atomic<bool> torn{false};
+    for (int w = 0; w < 2; ++w) {
+        executorSubmit([&] {
+            for (int i = 0; i < 2000; ++i) {
+                l.lock();
+                ++a;
+                ++b;
+                l.unlock();
+            }
+        });
+    }
+    for (int r = 0; r < 8; ++r) {
+        executorSubmit([&] {
+            for (int i = 0; i < 5000; ++i) {
+                l.readLock();
+                if (a != b) torn = true;
+                l.readUnlock();
+            }
+        });
+    }
+    __tocin_join_all();
+    ASSERT_TRUE(!torn.load());
+    ASSERT_EQ(a, 4000);
+    ASSERT_EQ(b, 4000);
+    ASSERT_EQ(l.readers(), 0);
+
+    // Two readers at once, on two threads.
+    l.readLock();
+    std::atomic<bool> second{false};
+    std::thread reader([&] {
+        l.readLock();
+        second = true;
+        l.readUnlock();
+    });
+    ASSERT_TRUE(waitFor(second));
+    reader.join();
+    l.readUnlock();
+}
+
+TEST(writer_waits_for_readers) {
+    RWLock l;
+    std::atomic<bool> wrote{false};
+    l.readLock();
+    std::thread writer([&] {
+        l.lock();
+        wrote = true;
+        l.unlock();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_TRUE(!wrote.load());
+    l.readUnlock();
+    writer.join();
+    ASSERT_TRUE(wrote.load());
+    l.lock();   // free again
+    l.unlock();
+}
+
+TEST(once_runs_its_function_once) {
+    Once once;
+    std::atomic<int> runs{0};
+    std::atomic<int> sawDone{0};
+    for (int i = 0; i < 32; ++i) {
+        executorSubmit([&] {
+            once.call([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                ++runs;
+            });
+            if (once.done()) ++sawDone;   // every caller returns after it ran
+        });
+    }
+    __tocin_join_all();
+    ASSERT_EQ(runs.load(), 1);
+    ASSERT_EQ(sawDone.load(), 32);
+}
+
+TEST(once_counts_a_throw_as_done) {
+    Once once;
+    bool threw = false;
+    try {
+        once.call([] { throw std::runtime_error("init failed"); });
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    ASSERT_TRUE(once.done());
+    int runs = 0;
+    once.call([&] { ++runs; });
+    ASSERT_EQ(runs, 0);
+}
+
+int main() {
+    std::cout << "=== Sync Tests ===\n\n";
+
+    // Two workers, so parked goroutines visibly free theirs.
+    setenv("TOCIN_MAX_PROCS", "2", 1);
+
+    RUN_TEST(wait_group_waits_for_every_goroutine);
+    RUN_TEST(mutex_excludes_goroutines_and_threads);
+    RUN_TEST(blocked_lockers_park_their_goroutines);
+    RUN_TEST(readers_share_and_writers_exclude);
+    RUN_TEST(writer_waits_for_readers);
+    RUN_TEST(once_runs_its_function_once);
+    RUN_TEST(once_counts_a_throw_as_done);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
@@ -0,0 +1,342 @@
+// Tensor Tests for Tocin Compiler
+//
+// Every kernel table the CPU supports is checked against the direct
+// formulas, then used to evaluate fused expressions over broadcasts,
+// transposed and sliced views and a tensor large enough to be split over
+// the parallel pool, each compared with a per-element reference. Views are
+// checked to share storage, assignments to read their own destination
+// safely, and the pool to hand freed blocks back out. The builtins are
+// checked through their handles, marks and Tocin lists.
+
+#include "runtime/quant_kernels.h"
+#include "runtime/tensor.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+extern "C" {
+int64_t __tocin_tensor_new(const int64_t *shape);
+int64_t __tocin_tensor_from_list(const int64_t *data, const int64_t *shape);
+int64_t __tocin_tensor_to_list(int64_t t, int64_t *out);
+int64_t __tocin_tensor_free(int64_t t);
+int64_t __tocin_tensor_mark();
+int64_t __tocin_tensor_release(int64_t mark);
+int64_t __tocin_tensor_keep(int64_t t);
+int64_t __tocin_tensor_dim(int64_t t, int64_t d);
+int64_t __tocin_tensor_numel(int64_t t);
+double __tocin_tensor_get(int64_t t, int64_t i);
+int64_t __tocin_tensor_set(int64_t t, int64_t i, double v);
+int64_t __tocin_tensor_transpose(int64_t t, int64_t d0, int64_t d1);
+int64_t __tocin_tensor_binary(int64_t op, int64_t a, int64_t b);
+int64_t __tocin_tensor_unary(int64_t op, int64_t a);
+int64_t __tocin_tensor_scalar(int64_t op, int64_t a, double s);
+int64_t __tocin_tensor_assign(int64_t dst, int64_t src);
+int64_t __tocin_tensor_matmul(int64_t a, int64_t b);
+double __tocin_tensor_sum(int64_t t);
+int64_t __tocin_tensor_pool_stat(int64_t which);
+}
+
+using namespace tocin::runtime;
+
+static const TensorKernels *kernels = nullptr;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " (" << (kernels ? kernels->name : "-") \
+                  << ") at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+#define ASSERT_NEAR(a, b, eps) ASSERT_TRUE(std::fabs((a) - (b)) <= (eps))
+
+static TensorShape shapeOf(std::initializer_list<int64_t> dims) {
+    TensorShape s;
+    std::vector<int64_t> v(dims);
+    makeTensorShape(v.data(), static_cast<int64_t>(v.size()), s);
+    return s;
+}
+
+// A tensor of shape whose element i (row-major) is f(i).
+static Tensor filled(TensorShape shape, const std::function<double(int64_t)> &f) {
+    Tensor t = tensorZeros(shape);
+    for (int64_t i = 0; i < shape.numel(); ++i) t.data()[i] = f(i);
+    return t;
+}
+
+static double at(Tensor &t, int64_t i) { return *tensorElement(*kernels, t, i); }
+
+TEST(kernels_match_formulas) {
+    std::vector<double> a(300), b(300), out(301);
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = std::sin(i * 0.37) * 3;
+        b[i] = std::cos(i * 0.11) + 1.5;
+    }
+    for (size_t n : {0, 1, 3, 8, 9, 255, 300}) {
+        for (int op = 0; op < kTensorBinaryOps; ++op) {
+            out[n] = 7;
+            kernels->binary(op, out.data(), a.data(), b.data(), n);
+            for (size_t i = 0; i < n; ++i) {
+                double x = a[i], y = b[i];
+                double want = op == 0 ? x + y : op == 1 ? x - y : op == 2 ? x * y : op == 3 ? x / y
+                            : op == 4 ? std::max(x, y) : std::min(x, y);
+                ASSERT_EQ(out[i], want);
+            }
+            ASSERT_EQ(out[n], 7);
+        }
+        for (int op = 0; op < kTensorUnaryOps; ++op) {
+            kernels->unary(op, out.data(), b.data(), n);
+            for (size_t i = 0; i < n; ++i) {
+                double x = b[i];
+                double want[] = {-x, std::fabs(x), std::sqrt(x), std::exp(x), std::log(x), 1 / (1 + std::exp(-x)),
+                                 x > 0 ? x : 0, std::tanh(x), x * (1 - x), x > 0 ? 1.0 : 0.0, x * x};
+                ASSERT_NEAR(out[i], want[op], 1e-12 * (1 + std::fabs(want[op])));
+            }
+        }
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) sum += a[i];
+        ASSERT_NEAR(kernels->sum(a.data(), n), sum, 1e-9);
+    }
+}
+
+TEST(views_share_storage) {
+    Tensor t = filled(shapeOf({3, 4}), [](int64_t i) { return double(i); });
+    Tensor tt, row, reshaped, col;
+    ASSERT_TRUE(tensorTranspose(*kernels, t, 0, 1, tt));
+    ASSERT_EQ(tt.shape.dims[0], 4);
+    ASSERT_EQ(at(tt, 1), 4.0);  // tt[0][1] = t[1][0]
+    ASSERT_TRUE(tensorSlice(*kernels, t, 0, 1, 2, 1, row));
+    ASSERT_TRUE(row.storage == t.storage);
+    *tensorElement(*kernels, row, 2) = 100;
+    ASSERT_EQ(t.data()[6], 100.0);
+    ASSERT_TRUE(tensorReshape(*kernels, t, shapeOf({2, 6}), reshaped));
+    ASSERT_TRUE(reshaped.storage == t.storage);
+    ASSERT_TRUE(!tensorReshape(*kernels, t, shapeOf({5}), reshaped));
+
+    // A strided view reshapes through a copy.
+    ASSERT_TRUE(tensorSlice(*kernels, t, 1, 1, 4, 2, col));  // columns 1 and 3
+    ASSERT_EQ(col.shape.dims[1], 2);
+    ASSERT_TRUE(tensorReshape(*kernels, col, shapeOf({6}), reshaped));
+    ASSERT_TRUE(reshaped.storage != t.storage);
+    const double want[] = {1, 3, 5, 7, 9, 11};
+    for (int i = 0; i < 6; ++i) ASSERT_EQ(at(reshaped, i), want[i]);
+    Tensor tail;
+    ASSERT_TRUE(tensorSlice(*kernels, t, 1, -1, 100, 1, tail));  // the last column
+    ASSERT_EQ(tail.shape.numel(), 3);
+    ASSERT_EQ(at(tail, 2), 11.0);
+    ASSERT_TRUE(!tensorSlice(*kernels, t, 2, 0, 1, 1, tail));
+    ASSERT_TRUE(!tensorSlice(*kernels, t, 0, 0, 1, 0, tail));
+}
+
+TEST(fused_expressions_match_elementwise) {
+    const int64_t sizes[][2] = {{1, 1}, {3, 5}, {7, 300}, {300, 1000}};
+    for (auto &sz : sizes) {
+        int64_t r = sz[0], c = sz[1];
+        Tensor x = filled(shapeOf({r, c}), [](int64_t i) { return std::sin(i * 0.01); });
+        Tensor bias = filled(shapeOf({c}), [](int64_t i) { return 0.1 * i; });
+        Tensor col = filled(shapeOf({r, 1}), [](int64_t i) { return 1.0 + i; });
+        // The transpose of x's transpose: a strided view with x's elements.
+        Tensor xt = filled(shapeOf({c, r}), [&](int64_t i) { return x.data()[(i % r) * c + i / r]; });
+        Tensor back;
+        tensorTranspose(*kernels, xt, 0, 1, back);
+        ASSERT_TRUE(r == 1 || c == 1 || !back.contiguous());
+
+        // sigmoid(back * col + bias) - relu(x) / 2
+        Tensor m, s, sg, rl, half, res;
+        ASSERT_TRUE(tensorBinary(TensorBinaryOp::Mul, back, col, m));
+        ASSERT_TRUE(tensorBinary(TensorBinaryOp::Add, m, bias, s));
+        tensorUnary(TensorUnaryOp::Sigmoid, s, sg);
+        tensorUnary(TensorUnaryOp::Relu, x, rl);
+        tensorScalar(TensorBinaryOp::Div, rl, 2.0, half);
+        ASSERT_TRUE(tensorBinary(TensorBinaryOp::Sub, sg, half, res));
+        ASSERT_TRUE(res.lazy() && m.lazy());
+        ASSERT_EQ(res.shape.dims[0], r);
+
+        double sum = 0;
+        std::vector<double> want(r * c);
+        for (int64_t i = 0; i < r; ++i)
+            for (int64_t j = 0; j < c; ++j) {
+                double v = x.data()[i * c + j];
+                want[i * c + j] = 1 / (1 + std::exp(-(v * (1.0 + i) + 0.1 * j))) - (v > 0 ? v : 0) / 2;
+                sum += want[i * c + j];
+            }
+        // Summing a lazy tensor leaves it lazy.
+        ASSERT_NEAR(tensorSum(*kernels, res), sum, 1e-9 * (1 + std::fabs(sum)));
+        ASSERT_TRUE(res.lazy());
+        materialize(*kernels, res);
+        ASSERT_TRUE(!res.lazy() && res.contiguous());
+        for (int64_t i = 0; i < r * c; ++i) ASSERT_NEAR(res.data()[i], want[i], 1e-12);
+
+        // Evaluated straight into a transposed destination.
+        Tensor dst = tensorZeros(shapeOf({c, r})), dstT;
+        tensorTranspose(*kernels, dst, 0, 1, dstT);
+        ASSERT_TRUE(tensorAssign(*kernels, dstT, s));
+        for (int64_t i = 0; i < r; ++i)
+            for (int64_t j = 0; j < c; ++j)
+                ASSERT_NEAR(dst.data()[j * r + i], x.data()[i * c + j] * (1.0 + i) + 0.1 * j, 1e-12);
+    }
+    Tensor a = tensorZeros(shapeOf({2, 3})), b = tensorZeros(shapeOf({3, 2})), out;
+    ASSERT_TRUE(!tensorBinary(TensorBinaryOp::Add, a, b, out));
+}
+
+TEST(assign_reads_its_destination) {
+    // w -= 0.5 * g, in place.
+    Tensor w = filled(shapeOf({4, 70}), [](int64_t i) { return double(i); });
+    Tensor g = filled(shapeOf({4, 70}), [](int64_t i) { return 2.0 * i; });
+    Tensor step, upd;
+    tensorScalar(TensorBinaryOp::Mul, g, 0.5, step);
+    tensorBinary(TensorBinaryOp::Sub, w, step, upd);
+    ASSERT_TRUE(tensorAssign(*kernels, w, upd));
+    for (int64_t i = 0; i < 280; ++i) ASSERT_EQ(w.data()[i], 0.0);
+
+    // m = m^T reads elements the store has already replaced unless the
+    // evaluation goes through a temporary.
+    Tensor m = filled(shapeOf({40, 40}), [](int64_t i) { return double(i); }), mt;
+    tensorTranspose(*kernels, m, 0, 1, mt);
+    ASSERT_TRUE(tensorAssign(*kernels, m, mt));
+    for (int64_t i = 0; i < 40; ++i)
+        for (int64_t j = 0; j < 40; ++j) ASSERT_EQ(m.data()[i * 40 + j], double(j * 40 + i));
+
+    // Rows broadcast into a matrix; a lazy result reads its inputs late.
+    Tensor row = filled(shapeOf({3}), [](int64_t i) { return i + 1.0; }), mat = tensorZeros(shapeOf({2, 3}));
+    Tensor doubled;
+    tensorScalar(TensorBinaryOp::Mul, row, 2.0, doubled);
+    row.data()[0] = 10;
+    ASSERT_TRUE(tensorAssign(*kernels, mat, doubled));
+    ASSERT_EQ(mat.data()[3], 20.0);
+    ASSERT_EQ(mat.data()[5], 6.0);
+    ASSERT_TRUE(!tensorAssign(*kernels, row, mat));
+}
+
+TEST(matmul_matches_naive) {
+    Tensor a = filled(shapeOf({5, 7}), [](int64_t i) { return std::sin(i * 0.5); });
+    Tensor b = filled(shapeOf({9, 7}), [](int64_t i) { return std::cos(i * 0.3); });
+    Tensor bt, c;
+    tensorTranspose(*kernels, b, 0, 1, bt);
+    ASSERT_TRUE(tensorMatmul(*kernels, a, bt, c));
+    ASSERT_EQ(c.shape.dims[1], 9);
+    for (int i = 0; i < 5; ++i)
+        for (int j = 0; j < 9; ++j) {
+            double s = 0;
+            for (int k = 0; k < 7; ++k) s += a.data()[i * 7 + k] * b.data()[j * 7 + k];
+            ASSERT_NEAR(c.data()[i * 9 + j], s, 1e-12);
+        }
+    ASSERT_TRUE(!tensorMatmul(*kernels, a, b, c));
+}
+
+// Half-precision weights through a transposed view of the input.
+TEST(quantized_matmul_matches_naive) {
+    Tensor a = filled(shapeOf({7, 5}), [](int64_t i) { return std::sin(i * 0.5); });
+    Tensor b = filled(shapeOf({9, 7}), [](int64_t i) { return std::cos(i * 0.3); });
+    tocin::runtime::QuantMatrix w;
+    ASSERT_TRUE(tocin::runtime::quantizeMatrix(b.data(), 9, 7, tocin::runtime::QuantFormat::Fp16, w));
+    Tensor at, c;
+    tensorTranspose(*kernels, a, 0, 1, at);
+    ASSERT_TRUE(tensorMatmulQuant(*kernels, at, w, c));
+    ASSERT_EQ(c.shape.dims[0], 5);
+    ASSERT_EQ(c.shape.dims[1], 9);
+    for (int i = 0; i < 5; ++i)
+        for (int j = 0; j < 9; ++j) {
+            double s = 0;
+            for (int k = 0; k < 7; ++k) s += a.data()[k * 5 + i] * b.data()[j * 7 + k];
+            ASSERT_NEAR(c.data()[i * 9 + j], s, 1e-2);
+        }
+    ASSERT_TRUE(!tensorMatmulQuant(*kernels, a, w, c));
+}
+
+TEST(tables_sum_identically) {
+    Tensor t = filled(shapeOf({1000, 37}), [](int64_t i) { return std::sin(i * 0.001) * 1e3; });
+    double first = 0;
+    bool seen = false;
+    for (const TensorKernels *k : availableTensorKernels()) {
+        double s = tensorSum(*k, t);
+        if (seen) ASSERT_EQ(s, first);
+        first = s;
+        seen = true;
+    }
+}
+
+TEST(pool_reuses_blocks) {
+    Tensor t = tensorZeros(shapeOf({1000, 3}));
+    auto before = tensorPoolStats();
+    t = Tensor();
+    auto freed = tensorPoolStats();
+    ASSERT_EQ(freed.cachedBytes, before.cachedBytes + 4096 * sizeof(double));
+    Tensor again = tensorZeros(shapeOf({3, 999}));  // the same size class
+    ASSERT_EQ(tensorPoolStats().reused, freed.reused + 1);
+}
+
+TEST(entry_points) {
+    std::vector<int64_t> shape{2, 2, 3};
+    std::vector<int64_t> data{6, 0, 0, 0, 0, 0, 0};
+    auto *vals = reinterpret_cast<double *>(data.data() + 1);
+    for (int i = 0; i < 6; ++i) vals[i] = i + 1;
+
+    int64_t mark = __tocin_tensor_mark();
+    int64_t t = __tocin_tensor_from_list(data.data(), shape.data());
+    ASSERT_TRUE(t != 0);
+    ASSERT_EQ(__tocin_tensor_dim(t, 1), 3);
+    ASSERT_EQ(__tocin_tensor_dim(t, 2), 0);
+    int64_t tt = __tocin_tensor_transpose(t, 0, 1);
+    ASSERT_EQ(__tocin_tensor_get(tt, 1), 4.0);
+    int64_t e = __tocin_tensor_unary(10, __tocin_tensor_scalar(0, t, 1.0));  // (t + 1)^2
+    ASSERT_EQ(__tocin_tensor_sum(e), 4.0 + 9 + 16 + 25 + 36 + 49);
+    ASSERT_EQ(__tocin_tensor_binary(0, t, tt), 0);  // 2x3 + 3x2
+    ASSERT_EQ(__tocin_tensor_binary(9, t, t), 0);   // no such op
+    int64_t p = __tocin_tensor_keep(__tocin_tensor_matmul(t, tt));
+    ASSERT_EQ(__tocin_tensor_get(p, 3), 16.0 + 25 + 36);
+    ASSERT_EQ(__tocin_tensor_assign(t, e), 1);
+    ASSERT_EQ(__tocin_tensor_set(t, 0, -1.0), 1);
+    std::vector<int64_t> out{4, 0, 0, 0, 0};
+    ASSERT_EQ(__tocin_tensor_to_list(tt, out.data()), 4);  // transposed, truncated to the list
+    auto *o = reinterpret_cast<double *>(out.data() + 1);
+    ASSERT_EQ(o[0], -1.0);
+    ASSERT_EQ(o[1], 25.0);
+    ASSERT_EQ(o[2], 9.0);
+    ASSERT_EQ(__tocin_tensor_release(mark), 4);  // t, tt, the +1 and e, not p
+    ASSERT_EQ(__tocin_tensor_numel(p), 4);
+    __tocin_tensor_free(p);
+    ASSERT_EQ(__tocin_tensor_release(mark), 0);
+
+    std::vector<int64_t> bad{0};
+    ASSERT_EQ(__tocin_tensor_new(bad.data()), 0);
+    shape = {1, -2};
+    ASSERT_EQ(__tocin_tensor_new(shape.data()), 0);
+    shape = {1, 7};
+    ASSERT_EQ(__tocin_tensor_from_list(data.data(), shape.data()), 0);  // 6 floats for 7
+    ASSERT_TRUE(__tocin_tensor_pool_stat(2) > 0);
+}
+
+int main() {
+    std::cout << "=== Tensor Tests ===\n\n";
+
+    for (const TensorKernels *k : availableTensorKernels()) {
+        kernels = k;
+        std::cout << "[" << k->name << "]\n";
+        RUN_TEST(kernels_match_formulas);
+        RUN_TEST(views_share_storage);
+        RUN_TEST(fused_expressions_match_elementwise);
+        RUN_TEST(assign_reads_its_destination);
+        RUN_TEST(matmul_matches_naive);
+        RUN_TEST(quantized_matmul_matches_naive);
+    }
+    kernels = &tensorKernels();
+    RUN_TEST(tables_sum_identically);
+    RUN_TEST(pool_reuses_blocks);
+    RUN_TEST(entry_points);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
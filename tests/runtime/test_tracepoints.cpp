@@ -0,0 +1,224 @@
+// Tracepoint Tests for Tocin Compiler
+//
+// Tracepoints (src/runtime/tracepoints.h) arm probe sites the compiler emits
+// under --debug. The sites here are built by hand, laid out as the compiler
+// lays them out, and hit the way a site's cold block hits them: checks that
+// probes arm exactly the sites they name, that conditions see the locals,
+// and that log messages, break handlers and configure/remove behave.
+
+#include "runtime/tracepoints.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using tocin::runtime::TracepointHit;
+using tocin::runtime::Tracepoints;
+using tocin::runtime::TracepointSite;
+
+extern "C" {
+void __tocin_tracepoints_register(TracepointSite *const *sites, int64_t count);
+void __tocin_tracepoint(TracepointSite *site, const int64_t *values);
+int64_t __tocin_trace_probe(const char *spec);
+int64_t __tocin_trace_remove(int64_t id);
+}
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+namespace {
+
+TracepointSite loopSite{0, 12, 5, "/work/app/server.to", "handle", "i:n,f:ratio,s:name,b:done"};
+TracepointSite otherLine{0, 13, 5, "/work/app/server.to", "handle", "i:n"};
+TracepointSite otherFile{0, 12, 5, "/work/app/myserver.to", "main", "i:n"};
+
+std::vector<std::string> logged;
+
+int64_t bits(double d)
+{
+    int64_t raw;
+    std::memcpy(&raw, &d, sizeof raw);
+    return raw;
+}
+
+void hitLoop(int64_t n, double ratio, const char *name, bool done)
+{
+    int64_t values[] = {n, bits(ratio), (int64_t)(intptr_t)name, done};
+    if (loopSite.enabled) __tocin_tracepoint(&loopSite, values);
+}
+
+void reset()
+{
+    Tracepoints::instance().clear();
+    logged.clear();
+}
+
+} // namespace
+
+TEST(probes_arm_only_the_sites_they_name) {
+    reset();
+    ASSERT_EQ(loopSite.enabled, 0);
+    int id = (int)__tocin_trace_probe("server.to:12");
+    ASSERT_TRUE(id > 0);
+    ASSERT_EQ(loopSite.enabled, 1);
+    ASSERT_EQ(otherLine.enabled, 0);
+    ASSERT_EQ(otherFile.enabled, 0);   // "myserver.to" does not end in "/server.to"
+    auto probes = Tracepoints::instance().probes();
+    ASSERT_EQ(probes.size(), 1u);
+    ASSERT_EQ(probes[0].sites, 1u);
+
+    ASSERT_EQ(__tocin_trace_remove(id), 1);
+    ASSERT_EQ(loopSite.enabled, 0);
+    ASSERT_EQ(__tocin_trace_remove(id), 0);
+}
+
+TEST(default_log_line_shows_the_locals) {
+    reset();
+    __tocin_trace_probe("app/server.to:12");
+    hitLoop(7, 0.5, "bob", true);
+    ASSERT_EQ(logged.size(), 1u);
+    ASSERT_EQ(logged[0], "trace: /work/app/server.to:12 handle: n=7 ratio=0.5 name=\"bob\" done=true");
+}
+
+TEST(conditions_filter_hits) {
+    reset();
+    __tocin_trace_probe("server.to:12 if n > 10 && ratio < 1.0 && name == \"bob\"");
+    hitLoop(5, 0.5, "bob", false);
+    hitLoop(50, 2.0, "bob", false);
+    hitLoop(50, 0.5, "eve", false);
+    hitLoop(50, 0.5, "bob", false);
+    ASSERT_EQ(logged.size(), 1u);
+    auto probes = Tracepoints::instance().probes();
+    ASSERT_EQ(probes[0].hits, 4u);
+    ASSERT_EQ(probes[0].fired, 1u);
+}
+
+TEST(conditions_on_hits_and_arithmetic) {
+    reset();
+    __tocin_trace_probe("server.to:12 if hits % 3 == 0 log \"every third: {hits} n={n}\"");
+    for (int i = 1; i <= 9; ++i) hitLoop(i * 2, 0, "x", false);
+    ASSERT_EQ(logged.size(), 3u);
+    ASSERT_EQ(logged[0], "trace: /work/app/server.to:12: every third: 3 n=6");
+    ASSERT_EQ(logged[2], "trace: /work/app/server.to:12: every third: 9 n=18");
+
+    reset();
+    __tocin_trace_probe("server.to:12 if (n + 1) * 2 == 10 || !done");
+    hitLoop(4, 0, "x", true);    // (4+1)*2 == 10
+    hitLoop(3, 0, "x", true);    // neither
+    hitLoop(3, 0, "x", false);   // !done
+    ASSERT_EQ(logged.size(), 2u);
+}
+
+TEST(missing_variables_and_bad_arithmetic_never_fire) {
+    reset();
+    __tocin_trace_probe("server.to:12 if nosuch > 0");
+    __tocin_trace_probe("server.to:12 if 1 / (n - n) == 0");
+    hitLoop(1, 0, "x", false);
+    ASSERT_EQ(logged.size(), 0u);
+}
+
+TEST(bad_specs_are_rejected) {
+    reset();
+    std::string error;
+    auto &tp = Tracepoints::instance();
+    ASSERT_EQ(tp.add("server.to", error), -1);
+    ASSERT_TRUE(!error.empty());
+    error.clear();
+    ASSERT_EQ(tp.add("server.to:12 if (n > ", error), -1);
+    ASSERT_TRUE(!error.empty());
+    error.clear();
+    ASSERT_EQ(tp.add("server.to:12 log \"unterminated", error), -1);
+    error.clear();
+    ASSERT_EQ(tp.add("server.to:12 break now", error), -1);
+    ASSERT_TRUE(tp.probes().empty());
+    ASSERT_EQ(loopSite.enabled, 0);
+}
+
+TEST(break_goes_to_the_handler) {
+    reset();
+    std::vector<TracepointHit> hits;
+    Tracepoints::instance().setBreakHandler([&](const TracepointHit &hit) { hits.push_back(hit); });
+    __tocin_trace_probe("server.to:12 if n == 2 break");
+    hitLoop(1, 0, "a", false);
+    hitLoop(2, 0.25, "b", false);
+    Tracepoints::instance().setBreakHandler(nullptr);
+    ASSERT_EQ(hits.size(), 1u);
+    ASSERT_EQ(hits[0].site, &loopSite);
+    ASSERT_EQ(hits[0].hits, 2u);
+    ASSERT_EQ(hits[0].probe, "server.to:12 if n == 2 break");
+    ASSERT_EQ(hits[0].locals.size(), 4u);
+    ASSERT_EQ(hits[0].locals[1].first, "ratio");
+    ASSERT_EQ(hits[0].locals[1].second, "0.25");
+    ASSERT_EQ(logged.size(), 0u);
+}
+
+TEST(configure_replaces_every_probe) {
+    reset();
+    __tocin_trace_probe("server.to:12");
+    std::string error;
+    auto &tp = Tracepoints::instance();
+    ASSERT_TRUE(tp.configure("# comment\nserver.to:13\nmyserver.to:12 log \"a; b\"", error));
+    ASSERT_EQ(tp.probes().size(), 2u);
+    ASSERT_EQ(loopSite.enabled, 0);
+    ASSERT_EQ(otherLine.enabled, 1);
+    ASSERT_EQ(otherFile.enabled, 1);
+
+    // A bad line leaves the previous probes in place.
+    ASSERT_TRUE(!tp.configure("server.to:12; server.to:", error));
+    ASSERT_EQ(tp.probes().size(), 2u);
+    ASSERT_EQ(otherLine.enabled, 1);
+
+    int64_t n = 1;
+    __tocin_tracepoint(&otherFile, &n);
+    ASSERT_EQ(logged.size(), 1u);
+    ASSERT_EQ(logged[0], "trace: /work/app/myserver.to:12: a; b");
+}
+
+TEST(probes_installed_first_arm_sites_registered_later) {
+    reset();
+    static TracepointSite late{0, 3, 1, "lib/late.to", "f", ""};
+    static TracepointSite *table[] = {&late};
+    __tocin_trace_probe("late.to:3");
+    ASSERT_EQ(late.enabled, 0);
+    __tocin_tracepoints_register(table, 1);
+    ASSERT_EQ(late.enabled, 1);
+    __tocin_tracepoint(&late, nullptr);
+    ASSERT_EQ(logged.size(), 1u);
+    ASSERT_EQ(logged[0], "trace: lib/late.to:3 f:");
+}
+
+int main()
+{
+    static TracepointSite *sites[] = {&loopSite, &otherLine, &otherFile};
+    __tocin_tracepoints_register(sites, 3);
+    Tracepoints::instance().setLogSink([](const std::string &line) { logged.push_back(line); });
+
+    RUN_TEST(probes_arm_only_the_sites_they_name);
+    RUN_TEST(default_log_line_shows_the_locals);
+    RUN_TEST(conditions_filter_hits);
+    RUN_TEST(conditions_on_hits_and_arithmetic);
+    RUN_TEST(missing_variables_and_bad_arithmetic_never_fire);
+    RUN_TEST(bad_specs_are_rejected);
+    RUN_TEST(break_goes_to_the_handler);
+    RUN_TEST(configure_replaces_every_probe);
+    RUN_TEST(probes_installed_first_arm_sites_registered_later);
+
+    std::cout << "All tracepoint tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,66 @@
+// V8 Runtime Tests for Tocin Compiler
+//
+// V8Runtime (src/v8_integration/v8_runtime.h) startup snapshots: setup code
+// that throws makes createSnapshot fail cleanly with the script's error and
+// leaves the runtime usable, and setup code that runs writes a snapshot.
+// V8 cannot be initialized again in a process once shut down, so loading
+// the snapshot back is left to the compiler's own use of it.
+
+#include "v8_integration/v8_runtime.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using tocin::v8_integration::V8Runtime;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static V8Runtime js;
+
+static const char* kSnapshotPath = "tocin_v8_runtime_snapshot.tmp";
+
+TEST(failing_setup_code_is_reported) {
+    ASSERT_TRUE(!js.createSnapshot("throw new Error('setup broke');", kSnapshotPath));
+    ASSERT_TRUE(js.getLastError().find("setup broke") != std::string::npos);
+    ASSERT_TRUE(!std::ifstream(kSnapshotPath).good());
+    ASSERT_TRUE(!js.createSnapshot("function (", kSnapshotPath));
+    ASSERT_TRUE(js.getLastError().find("Snapshot setup error") != std::string::npos);
+    // The runtime's own isolate is untouched.
+    ASSERT_EQ(js.executeCode("'still ' + 'running'").asString(), "still running");
+}
+
+TEST(setup_code_is_snapshotted) {
+    ASSERT_TRUE(js.createSnapshot("var answer = 6 * 7;", kSnapshotPath));
+    ASSERT_TRUE(!js.hasError());
+    std::ifstream file(kSnapshotPath, std::ios::binary | std::ios::ate);
+    ASSERT_TRUE(file.good() && file.tellg() > 0);
+    std::remove(kSnapshotPath);
+}
+
+int main() {
+    std::cout << "Running V8 runtime tests...\n";
+    std::remove(kSnapshotPath);
+    ASSERT_TRUE(js.initialize());
+    RUN_TEST(failing_setup_code_is_reported);
+    RUN_TEST(setup_code_is_snapshotted);
+    js.shutdown();
+    std::cout << "All V8 runtime tests passed!\n";
+    return 0;
+}
@@ -0,0 +1,226 @@
+// WebSocket Tests for Tocin Compiler
+//
+// The frame codec behind the ws* builtins: masking against a byte-at-a-time
+// reference at every length and phase, headers in all three length forms,
+// protocol violations, fragmented messages with control frames between
+// their fragments fed in pieces of every size, and permessage-deflate round
+// trips with and without context takeover.
+
+#include "runtime/websocket.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace tocin::runtime;
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << " at line " << __LINE__ << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+static const uint32_t kKey = 0x37fa213d;
+
+// A frame as a client would send it (masked) or a server (not).
+static std::string frame(int opcode, const std::string& payload, bool fin = true,
+                         bool masked = true, bool rsv1 = false) {
+    std::string out(kWsMaxHeader + payload.size(), '\0');
+    size_t h = wsWriteHeader(&out[0], fin, rsv1, opcode, payload.size(), masked, kKey);
+    std::memcpy(&out[h], payload.data(), payload.size());
+    if (masked) wsMask(&out[h], payload.size(), kKey);
+    out.resize(h + payload.size());
+    return out;
+}
+
+// Feed `wire` to a reader `step` bytes at a time, collecting what it returns.
+static std::vector<std::pair<int, std::string>> readAll(const std::string& wire, size_t step,
+                                                        int64_t* last = nullptr) {
+    WsMessageReader r(true);
+    std::vector<std::pair<int, std::string>> got;
+    size_t fed = 0;
+    for (;;) {
+        WsMessage m;
+        int64_t rc = r.next(&m);
+        if (rc == 1) {
+            got.emplace_back(m.opcode, std::string(m.data, m.len));
+            continue;
+        }
+        if (rc == kWsMalformed || fed == wire.size()) {
+            if (last) *last = rc;
+            return got;
+        }
+        size_t avail = 0;
+        char* p = r.space(step, &avail);
+        size_t n = std::min(step, wire.size() - fed);
+        std::memcpy(p, wire.data() + fed, n);
+        r.commit(n);
+        fed += n;
+    }
+}
+
+TEST(mask_matches_reference) {
+    const unsigned char k[4] = {0x37, 0xfa, 0x21, 0x3d};
+    for (size_t n = 0; n < 80; ++n) {
+        for (size_t phase = 0; phase < 4; ++phase) {
+            std::string s(n, '\0');
+            for (size_t i = 0; i < n; ++i) s[i] = (char)(i * 31 + 7);
+            std::string ref = s;
+            for (size_t i = 0; i < n; ++i) ref[i] = (char)(ref[i] ^ k[(phase + i) & 3]);
+            wsMask(&s[0], n, kKey, phase);
+            ASSERT_EQ(s, ref);
+        }
+    }
+}
+
+TEST(header_length_forms) {
+    for (uint64_t n : {0ull, 125ull, 126ull, 65535ull, 65536ull, 5000000000ull}) {
+        for (bool masked : {false, true}) {
+            char buf[kWsMaxHeader];
+            size_t h = wsWriteHeader(buf, true, false, kWsBinary, n, masked, kKey);
+            ASSERT_EQ(h, wsHeaderLen(n, masked));
+            WsFrame f;
+            ASSERT_EQ(parseWsFrame(buf, h, &f), (int64_t)h);
+            ASSERT_EQ(f.payloadLen, n);
+            ASSERT_EQ(f.masked, masked);
+            ASSERT_EQ(f.opcode, kWsBinary);
+            if (masked) ASSERT_EQ(f.key, kKey);
+            for (size_t cut = 0; cut < h; ++cut) ASSERT_EQ(parseWsFrame(buf, cut, &f), kWsIncomplete);
+        }
+    }
+}
+
+TEST(protocol_violations) {
+    WsFrame f;
+    std::string rsv2 = frame(kWsText, "x");
+    rsv2[0] = (char)(rsv2[0] | 0x20);
+    ASSERT_EQ(parseWsFrame(rsv2.data(), rsv2.size(), &f), kWsMalformed);
+    std::string op3 = frame(3, "x");
+    ASSERT_EQ(parseWsFrame(op3.data(), op3.size(), &f), kWsMalformed);
+    std::string fragPing = frame(kWsPing, "x", false);
+    ASSERT_EQ(parseWsFrame(fragPing.data(), fragPing.size(), &f), kWsMalformed);
+    std::string longPing = frame(kWsPing, std::string(126, 'p'));
+    ASSERT_EQ(parseWsFrame(longPing.data(), longPing.size(), &f), kWsMalformed);
+
+    int64_t last = 0;
+    readAll(frame(kWsText, "hi", true, false), 64, &last); // a server needs masked frames
+    ASSERT_EQ(last, kWsMalformed);
+    readAll(frame(kWsContinuation, "orphan"), 64, &last);
+    ASSERT_EQ(last, kWsMalformed);
+    readAll(frame(kWsText, "a", false) + frame(kWsText, "b"), 64, &last);
+    ASSERT_EQ(last, kWsMalformed);
+}
+
+TEST(fragments_around_control_frames) {
+    std::string big(70000, 'z');
+    std::string wire = frame(kWsText, "hello ", false) + frame(kWsPing, "p1") +
+                       frame(kWsContinuation, "wide ", false) + frame(kWsContinuation, "world") +
+                       frame(kWsBinary, big) + frame(kWsClose, "\x03\xe8");
+    for (size_t step : {1u, 2u, 3u, 7u, 64u, 4096u, 200000u}) {
+        int64_t last = 0;
+        auto got = readAll(wire, step, &last);
+        ASSERT_EQ(last, kWsIncomplete);
+        ASSERT_EQ(got.size(), 4u);
+        ASSERT_EQ(got[0].first, kWsPing);
+        ASSERT_EQ(got[0].second, "p1");
+        ASSERT_EQ(got[1].first, kWsText);
+        ASSERT_EQ(got[1].second, "hello wide world");
+        ASSERT_EQ(got[2].first, kWsBinary);
+        ASSERT_EQ(got[2].second, big);
+        ASSERT_EQ(got[3].first, kWsClose);
+        ASSERT_EQ(got[3].second, "\x03\xe8");
+    }
+}
+
+TEST(message_limit) {
+    WsMessageReader r(true, 1000);
+    std::string wire = frame(kWsBinary, std::string(600, 'a'), false) +
+                       frame(kWsContinuation, std::string(600, 'b'));
+    size_t avail = 0;
+    char* p = r.space(wire.size(), &avail);
+    std::memcpy(p, wire.data(), wire.size());
+    r.commit(wire.size());
+    WsMessage m;
+    ASSERT_EQ(r.next(&m), kWsMalformed);
+}
+
+static std::string roundTrip(WsDeflate& tx, WsDeflate& rx, const std::string& msg) {
+    std::vector<char> packed, unpacked;
+    size_t a = 0, b = 0;
+    ASSERT_TRUE(tx.compress(msg.data(), msg.size(), &packed, &a));
+    ASSERT_TRUE(rx.decompress(packed.data(), a, &unpacked, &b, 1u << 20));
+    return std::string(unpacked.data(), b);
+}
+
+TEST(deflate_round_trips) {
+    for (bool noTakeover : {false, true}) {
+        WsDeflate tx(noTakeover), rx(noTakeover);
+        std::string tick = "{\"series\":\"cpu\",\"host\":\"web-01\",\"value\":";
+        for (int i = 0; i < 200; ++i) {
+            std::string msg = tick + std::to_string(i * 37 % 1000) + "}";
+            ASSERT_EQ(roundTrip(tx, rx, msg), msg);
+        }
+        ASSERT_EQ(roundTrip(tx, rx, ""), "");
+        std::string large;
+        for (int i = 0; i < 20000; ++i) large += std::to_string(i * 7919 % 104729) + ",";
+        ASSERT_EQ(roundTrip(tx, rx, large), large);
+    }
+    // With context takeover, a repeated message shrinks to a back-reference.
+    WsDeflate tx, rx;
+    std::string msg(300, 'q');
+    msg += "{\"k\":1}";
+    std::vector<char> out;
+    size_t first = 0;
+    ASSERT_TRUE(tx.compress(msg.data(), msg.size(), &out, &first));
+    size_t second = first;
+    ASSERT_TRUE(tx.compress(msg.data(), msg.size(), &out, &second));
+    ASSERT_TRUE(second - first < first);
+    std::vector<char> back;
+    size_t got = 0;
+    ASSERT_TRUE(rx.decompress(out.data(), first, &back, &got, 1u << 20));
+    ASSERT_TRUE(rx.decompress(out.data() + first, second - first, &back, &got, 1u << 20));
+    ASSERT_EQ(std::string(back.data(), got), msg + msg);
+
+    std::vector<char> sink;
+    size_t used = 0;
+    const char junk[] = "\xff\xff\xff\xff\xff";
+    ASSERT_TRUE(!rx.decompress(junk, 5, &sink, &used, 1u << 20));
+}
+
+TEST(deflate_output_limit) {
+    WsDeflate tx, rx;
+    std::string msg(100000, 'a');
+    std::vector<char> packed, unpacked;
+    size_t a = 0, b = 0;
+    ASSERT_TRUE(tx.compress(msg.data(), msg.size(), &packed, &a));
+    ASSERT_TRUE(a < 1000);
+    ASSERT_TRUE(!rx.decompress(packed.data(), a, &unpacked, &b, 50000));
+}
+
+int main() {
+    std::cout << "=== WebSocket Tests ===\n\n";
+
+    RUN_TEST(mask_matches_reference);
+    RUN_TEST(header_length_forms);
+    RUN_TEST(protocol_violations);
+    RUN_TEST(fragments_around_control_frames);
+    RUN_TEST(message_limit);
+    RUN_TEST(deflate_round_trips);
+    RUN_TEST(deflate_output_limit);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
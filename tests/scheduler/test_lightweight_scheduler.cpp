@@ -3,8 +3,24 @@
 #include "../../src/runtime/lightweight_scheduler.h"
 #include <iostream>
 #include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <string>
 #include <chrono>
+#include <deque>
+#include <mutex>
 #include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 using namespace tocin::runtime;
 
@@ -54,11 +70,588 @@ TEST(multiple_goroutines) {
     scheduler.stop();
 }
 
+TEST(hundred_thousand_goroutines) {
+    LightweightScheduler scheduler(4);
+    scheduler.setFiberStackSize(16 * 1024);
+    scheduler.start();
+    std::atomic<int> counter{0};
+    for (int i = 0; i < 100000; i++) {
+        scheduler.go([&counter]() {
+            LightweightScheduler::yieldNow();
+            counter++;
+        });
+    }
+    scheduler.waitAll();
+    ASSERT_EQ(counter.load(), 100000);
+    scheduler.stop();
+}
+
+TEST(park_and_unpark) {
+    LightweightScheduler scheduler(2);
+    scheduler.start();
+    std::mutex m;
+    std::shared_ptr<Fiber> parked;
+    std::atomic<bool> woke{false};
+    scheduler.go([&]() {
+        std::unique_lock<std::mutex> lock(m);
+        parked = Fiber::current()->shared_from_this();
+        LightweightScheduler::park(lock);
+        ASSERT_TRUE(lock.owns_lock());
+        woke = true;
+    });
+    std::shared_ptr<Fiber> f;
+    while (!f) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> lock(m);
+        f = std::move(parked);
+    }
+    ASSERT_TRUE(!woke.load());
+    scheduler.unpark(f);
+    scheduler.waitAll();
+    ASSERT_TRUE(woke.load());
+    scheduler.stop();
+}
+
+TEST(worker_stats_count_parks_and_time) {
+    LightweightScheduler scheduler(2);
+    scheduler.start();
+    for (int i = 0; i < 8; ++i) {
+        scheduler.go([] { LightweightScheduler::sleepFor(std::chrono::milliseconds(2)); });
+    }
+    scheduler.waitAll();
+    // Idle time is added when a worker wakes from its (at most 10 ms) wait.
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    auto stats = scheduler.getStats();
+    ASSERT_EQ(stats.workers.size(), 2u);
+    uint64_t executed = 0;
+    for (const auto& w : stats.workers) {
+        executed += w.fibersExecuted;
+        ASSERT_EQ(w.busyTimeMs, w.busyTimeNs / 1000000);
+    }
+    ASSERT_EQ(executed, 8u);
+    ASSERT_EQ(stats.parks, 8u);     // each sleep parks once
+    ASSERT_EQ(stats.unparks, 8u);   // and its timer wakes it
+    ASSERT_EQ(stats.queuedFibers, 0u);
+    ASSERT_TRUE(stats.busyTimeNs > 0);
+    ASSERT_TRUE(stats.idleTimeNs > 0);
+    scheduler.stop();
+}
+
+TEST(sleep_frees_worker) {
+    // With a single worker, a sleeping goroutine must not stop another one
+    // from running in the meantime.
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    std::atomic<int> order{0};
+    std::atomic<int> sleeperSaw{-1};
+    scheduler.go([&]() {
+        LightweightScheduler::sleepFor(std::chrono::milliseconds(50));
+        sleeperSaw = order.load();
+    });
+    scheduler.go([&]() { order++; });
+    scheduler.waitAll();
+    ASSERT_EQ(sleeperSaw.load(), 1);
+    scheduler.stop();
+}
+
+TEST(timer_heap_order_and_cancel) {
+    using Clock = std::chrono::steady_clock;
+    TimerHeap<int> heap;
+    auto t0 = Clock::now();
+    heap.add(t0 + std::chrono::milliseconds(30), 3);
+    uint64_t gone = heap.add(t0 + std::chrono::milliseconds(10), -1);
+    heap.add(t0 + std::chrono::milliseconds(20), 1);
+    heap.add(t0 + std::chrono::milliseconds(20), 2);  // same deadline: FIFO
+    ASSERT_TRUE(heap.cancel(gone));
+    ASSERT_TRUE(!heap.cancel(gone));
+    ASSERT_EQ(heap.size(), 3u);
+    std::vector<int> due;
+    heap.popDue(t0 + std::chrono::milliseconds(25), due);
+    ASSERT_EQ(due, (std::vector<int>{1, 2}));
+    heap.popDue(t0 + std::chrono::milliseconds(30), due);
+    ASSERT_EQ(due, (std::vector<int>{1, 2, 3}));
+    ASSERT_TRUE(heap.empty());
+
+    // Mostly-cancelled timeouts do not accumulate.
+    std::vector<uint64_t> ids;
+    for (int i = 0; i < 100000; ++i) {
+        ids.push_back(heap.add(t0 + std::chrono::seconds(60 + i % 7), i));
+    }
+    for (int i = 0; i < 100000; ++i) {
+        if (i % 100 != 0) ASSERT_TRUE(heap.cancel(ids[i]));
+    }
+    ASSERT_EQ(heap.size(), 1000u);
+    due.clear();
+    heap.popDue(t0 + std::chrono::seconds(120), due);
+    ASSERT_EQ(due.size(), 1000u);
+}
+
+TEST(after_runs_callbacks_on_workers) {
+    // Many timers, half of them cancelled, served by two workers and no
+    // thread per timer.
+    LightweightScheduler scheduler(2);
+    scheduler.start();
+    const int n = 20000;
+    std::atomic<int> fired{0};
+    std::vector<uint64_t> ids;
+    for (int i = 0; i < n; ++i) {
+        ids.push_back(scheduler.after(std::chrono::milliseconds(5 + i % 40), [&] { fired++; }));
+    }
+    int cancelled = 0;
+    for (int i = 0; i < n; i += 2) {
+        cancelled += scheduler.cancelTimer(ids[i]);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (fired.load() + cancelled < n && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_EQ(fired.load() + cancelled, n);
+    ASSERT_TRUE(cancelled > 0);
+    ASSERT_TRUE(!scheduler.cancelTimer(ids[1]));  // already ran
+    ASSERT_EQ(scheduler.getStats().totalWorkers, 2u);
+
+    // A timer wakes a parked fiber: the callback-plus-park shape of a
+    // select timeout.
+    std::mutex m;
+    std::shared_ptr<Fiber> parked;
+    bool timedOut = false;
+    scheduler.go([&]() {
+        std::unique_lock<std::mutex> lock(m);
+        parked = Fiber::current()->shared_from_this();
+        scheduler.after(std::chrono::milliseconds(10), [&] {
+            std::lock_guard<std::mutex> g(m);
+            timedOut = true;
+            scheduler.unpark(std::move(parked));
+        });
+        while (!timedOut) LightweightScheduler::park(lock);
+    });
+    scheduler.waitAll();
+    ASSERT_TRUE(timedOut);
+    scheduler.stop();
+}
+
+TEST(chase_lev_owner_lifo_thief_fifo) {
+    ChaseLevDeque<uintptr_t> dq(2);   // tiny ring: forces growth
+    for (uintptr_t i = 1; i <= 100; i++) {
+        dq.push(i);
+    }
+    ASSERT_EQ(dq.size(), 100u);
+    ASSERT_EQ(dq.steal(), 1u);
+    ASSERT_EQ(dq.pop(), 100u);
+    ASSERT_EQ(dq.size(), 98u);
+    while (dq.pop()) {
+    }
+    ASSERT_EQ(dq.steal(), 0u);
+    ASSERT_EQ(dq.size(), 0u);
+}
+
+TEST(priority_levels) {
+    WorkStealingQueue<uintptr_t> q;
+    q.pushPriority(30, static_cast<int>(Fiber::Priority::Low));
+    q.push(20);
+    q.pushPriority(10, static_cast<int>(Fiber::Priority::Critical));
+    ASSERT_EQ(q.size(), 3u);
+    ASSERT_EQ(q.stealPriority(static_cast<int>(Fiber::Priority::High)), 10u);
+    ASSERT_EQ(q.stealPriority(static_cast<int>(Fiber::Priority::High)), 0u);
+    ASSERT_EQ(q.pop(), 20u);
+    ASSERT_EQ(q.steal(), 30u);
+    ASSERT_TRUE(q.isEmpty());
+}
+
+// Contention benchmark: one owner pushing and popping while several thieves
+// steal. Checks every item is taken exactly once and reports throughput
+// against a mutex-guarded deque doing the same work.
+template <typename Queue>
+static double run_contention(Queue& q, int items, int thieves) {
+    std::vector<std::atomic<int>> seen(items + 1);
+    for (auto& s : seen) {
+        s = 0;
+    }
+    std::atomic<bool> done{false};
+    std::atomic<int> taken{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < thieves; t++) {
+        pool.emplace_back([&]() {
+            while (!done.load() || q.size() > 0) {
+                if (uintptr_t v = q.steal()) {
+                    seen[v]++;
+                    taken++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int i = 1; i <= items; i++) {
+        q.push(static_cast<uintptr_t>(i));
+        if (i % 2 == 0) {
+            if (uintptr_t v = q.pop()) {
+                seen[v]++;
+                taken++;
+            }
+        }
+    }
+    while (uintptr_t v = q.pop()) {
+        seen[v]++;
+        taken++;
+    }
+    done = true;
+    for (auto& t : pool) {
+        t.join();
+    }
+    auto secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_EQ(taken.load(), items);
+    for (int i = 1; i <= items; i++) {
+        ASSERT_EQ(seen[i].load(), 1);
+    }
+    return items / secs / 1e6;
+}
+
+struct MutexDeque {
+    std::mutex m;
+    std::deque<uintptr_t> d;
+    void push(uintptr_t v) { std::lock_guard<std::mutex> l(m); d.push_back(v); }
+    uintptr_t pop() {
+        std::lock_guard<std::mutex> l(m);
+        if (d.empty()) return 0;
+        uintptr_t v = d.back();
+        d.pop_back();
+        return v;
+    }
+    uintptr_t steal() {
+        std::lock_guard<std::mutex> l(m);
+        if (d.empty()) return 0;
+        uintptr_t v = d.front();
+        d.pop_front();
+        return v;
+    }
+    size_t size() { std::lock_guard<std::mutex> l(m); return d.size(); }
+};
+
+TEST(queue_contention_benchmark) {
+    const int items = 200000;
+    const int thieves = 3;
+    WorkStealingQueue<uintptr_t> lockFree;
+    MutexDeque locked;
+    double lf = run_contention(lockFree, items, thieves);
+    double mx = run_contention(locked, items, thieves);
+    std::cout << " [chase-lev " << lf << " Mops/s, mutex " << mx << " Mops/s]";
+}
+
+TEST(fan_out_spawn) {
+    // Goroutines spawning goroutines exercises the owner push path.
+    LightweightScheduler scheduler(4);
+    scheduler.setFiberStackSize(16 * 1024);
+    scheduler.start();
+    std::atomic<int> counter{0};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 100; i++) {
+        scheduler.go([&]() {
+            for (int j = 0; j < 1000; j++) {
+                scheduler.go([&counter]() { counter++; });
+            }
+        });
+    }
+    scheduler.waitAll();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    ASSERT_EQ(counter.load(), 100000);
+    std::cout << " [" << ms << " ms]";
+    scheduler.stop();
+}
+
+#ifndef _WIN32
+// A non-blocking socket pair; [0] is read by the tests, [1] written.
+static void nonBlockingPair(int fds[2]) {
+    ASSERT_TRUE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+    }
+}
+
+// Read one byte the way the runtime's socket builtins do.
+static char readByte(int fd) {
+    char c = 0;
+    for (;;) {
+        ssize_t n = read(fd, &c, 1);
+        if (n == 1) return c;
+        ASSERT_TRUE(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+        ASSERT_TRUE(LightweightScheduler::waitFd(fd, false));
+    }
+}
+
+TEST(socket_wait_frees_worker) {
+    // With a single worker, a goroutine parked on a socket must not stop the
+    // goroutine that writes to it from running.
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    int fds[2];
+    nonBlockingPair(fds);
+    std::atomic<char> got{0};
+    scheduler.go([&]() { got = readByte(fds[0]); });
+    scheduler.go([&]() {
+        LightweightScheduler::sleepFor(std::chrono::milliseconds(20));
+        ASSERT_TRUE(write(fds[1], "x", 1) == 1);
+    });
+    scheduler.waitAll();
+    ASSERT_EQ(got.load(), 'x');
+    // Not a fiber: the caller has to block the thread itself.
+    ASSERT_TRUE(!LightweightScheduler::waitFd(fds[0], false));
+    scheduler.forgetFd(fds[0]);
+    close(fds[0]);
+    close(fds[1]);
+    scheduler.stop();
+}
+
+TEST(hundreds_of_parked_sockets) {
+    // Two descriptors each, well inside the usual 1024 open-file limit.
+    const int n = 400;
+    LightweightScheduler scheduler(2);
+    scheduler.setFiberStackSize(16 * 1024);
+    scheduler.start();
+    std::vector<int> fds(2 * n);
+    for (int i = 0; i < n; i++) {
+        nonBlockingPair(&fds[2 * i]);
+    }
+    std::atomic<int> received{0};
+    for (int i = 0; i < n; i++) {
+        int fd = fds[2 * i];
+        scheduler.go([&received, fd]() {
+            if (readByte(fd) == 'y') received++;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(received.load(), 0);
+    for (int i = 0; i < n; i++) {
+        ASSERT_TRUE(write(fds[2 * i + 1], "y", 1) == 1);
+    }
+    scheduler.waitAll();
+    ASSERT_EQ(received.load(), n);
+    ASSERT_TRUE(scheduler.getStats().totalWorkers == 2);
+    for (int i = 0; i < n; i++) {
+        scheduler.forgetFd(fds[2 * i]);
+    }
+    for (int fd : fds) {
+        close(fd);
+    }
+    scheduler.stop();
+}
+
+TEST(forget_wakes_parked_socket) {
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    int fds[2];
+    nonBlockingPair(fds);
+    std::atomic<bool> woke{false};
+    scheduler.go([&]() {
+        ASSERT_TRUE(LightweightScheduler::waitFd(fds[0], false));
+        woke = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_TRUE(!woke.load());
+    scheduler.forgetFd(fds[0]);
+    scheduler.waitAll();
+    ASSERT_TRUE(woke.load());
+    close(fds[0]);
+    close(fds[1]);
+    scheduler.stop();
+}
+#endif
+
+TEST(fiber_preserves_registers_across_switches) {
+    // Live integer and floating-point values must survive every switch out
+    // and back, whichever registers the compiler keeps them in.
+    auto work = [](bool yielding) {
+        double acc = 1.0;
+        uint64_t h = 1469598103934665603ULL;
+        for (int i = 0; i < 1000; i++) {
+            acc = acc * 1.000001 + i * 0.5;
+            h = (h ^ static_cast<uint64_t>(i)) * 1099511628211ULL;
+            if (yielding) Fiber::current()->yield();
+        }
+        return acc + static_cast<double>(h % 1000003);
+    };
+    double expected = work(false);
+    double got = 0;
+    auto fiber = std::make_shared<Fiber>([&]() { got = work(true); });
+    int resumes = 0;
+    while (!fiber->isCompleted()) {
+        fiber->resume();
+        resumes++;
+    }
+    ASSERT_EQ(resumes, 1001);
+    ASSERT_TRUE(got == expected);
+}
+
+TEST(context_switch_cost) {
+    const int switches = 1000000;
+    auto fiber = std::make_shared<Fiber>([]() {
+        for (int i = 0; i < switches; i++) Fiber::current()->yield();
+    });
+    auto start = std::chrono::steady_clock::now();
+    while (!fiber->isCompleted()) fiber->resume();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    // One resume/yield round trip is two switches.
+    std::cout << " [" << static_cast<double>(ns) / (2.0 * switches) << " ns/switch]";
+}
+
+#ifndef _WIN32
+TEST(fiber_stack_pool_recycles) {
+    // An odd size, so the stacks earlier tests left in this thread's cache
+    // do not match.
+    const size_t size = 72 * 1024;
+    auto before = FiberStackPool::stats();
+    FiberStack a = FiberStackPool::acquire(size);
+    ASSERT_TRUE(a.base != nullptr);
+    ASSERT_EQ(a.size, size);
+    if (a.guarded) {
+        // The page just below the stack is the guard, the base is not.
+        ASSERT_TRUE(FiberStackPool::inGuard(a, static_cast<char*>(a.base) - 1));
+        ASSERT_TRUE(!FiberStackPool::inGuard(a, a.base));
+    }
+    static_cast<char*>(a.top())[-1] = 1;
+    FiberStackPool::release(a);
+    FiberStack b = FiberStackPool::acquire(size);
+    ASSERT_TRUE(b.base == a.base);
+    FiberStackPool::release(b);
+    auto after = FiberStackPool::stats();
+    ASSERT_EQ(after.reused - before.reused, 1u);
+
+    // Completed goroutines hand their stacks back for the next spawn.
+    LightweightScheduler scheduler(1);
+    scheduler.start();
+    std::atomic<int> counter{0};
+    for (int i = 0; i < 1000; i++) {
+        scheduler.go([&counter]() { counter++; });
+    }
+    scheduler.waitAll();
+    ASSERT_EQ(counter.load(), 1000);
+    scheduler.stop();
+    auto end = FiberStackPool::stats();
+    ASSERT_TRUE(end.mapped - after.mapped < 100);
+}
+
+namespace {
+    int recurse(int depth) {
+        volatile char frame[512];
+        frame[0] = static_cast<char>(depth);
+        return recurse(depth + 1) + frame[0];
+    }
+}
+
+TEST(stack_overflow_is_reported) {
+    // Running off a fiber stack must hit the guard page and abort with a
+    // report, not scribble over the neighbouring allocation.
+    pid_t pid = fork();
+    ASSERT_TRUE(pid >= 0);
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) dup2(devnull, STDERR_FILENO);
+        LightweightScheduler scheduler(1);
+        scheduler.start();
+        scheduler.go([]() { recurse(0); });
+        scheduler.waitAll();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    ASSERT_TRUE(WIFSIGNALED(status));
+    ASSERT_EQ(WTERMSIG(status), SIGABRT);
+}
+#endif
+
+TEST(numa_cpu_lists_and_placement) {
+    ASSERT_TRUE((NumaTopology::parseCpuList("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    ASSERT_TRUE(NumaTopology::parseCpuList("").empty());
+
+    auto placement = NumaTopology::uniform(2).placeWorkers(3);
+    ASSERT_EQ(placement.size(), size_t(3));
+    ASSERT_EQ(placement[0].first, 0);
+    ASSERT_EQ(placement[2].second, 0);   // more workers than CPUs: wrap around
+}
+
+#ifndef _WIN32
+TEST(numa_topology_from_sysfs) {
+    // A dual-socket layout with interleaved CPU numbering, as on most
+    // two-socket servers, plus a memory-only node.
+    char dir[] = "/tmp/tocin_numa_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    const char* lists[] = {"0-3,8-11\n", "4-7,12-15\n", "\n"};
+    for (int n = 0; n < 3; n++) {
+        std::string node = std::string(dir) + "/node" + std::to_string(n);
+        mkdir(node.c_str(), 0700);
+        std::ofstream(node + "/cpulist") << lists[n];
+    }
+    NumaTopology topo = NumaTopology::fromSysfs(dir);
+    ASSERT_EQ(topo.nodes(), size_t(3));
+    ASSERT_EQ(topo.nodeOfCpu(9), 0);
+    ASSERT_EQ(topo.nodeOfCpu(12), 1);
+    ASSERT_EQ(topo.nodeOfCpu(99), -1);
+
+    // Four workers: two per socket, each pinned to a CPU of its own node.
+    auto placement = topo.placeWorkers(4);
+    for (size_t w = 0; w < placement.size(); w++) {
+        ASSERT_EQ(placement[w].first, w < 2 ? 0 : 1);
+        ASSERT_EQ(topo.nodeOfCpu(placement[w].second), placement[w].first);
+    }
+
+    // CPUs outside the affinity mask are dropped.
+    NumaTopology restricted = NumaTopology::fromSysfs(dir, {0, 1, 4});
+    ASSERT_EQ(restricted.cpusOf(0).size(), size_t(2));
+    ASSERT_EQ(restricted.cpusOf(1).size(), size_t(1));
+    ASSERT_EQ(restricted.placeWorkers(3)[2].first, 1);
+
+    std::system((std::string("rm -rf ") + dir).c_str());
+}
+#endif
+
+TEST(numa_aware_scheduler_runs) {
+    LightweightScheduler scheduler(2);
+    scheduler.enableNUMAAwareness(true);
+    ASSERT_EQ(scheduler.getStats().totalWorkers, size_t(2));
+    ASSERT_EQ(scheduler.getStats().numNUMANodes, NumaTopology::system().nodes());
+    scheduler.start();
+    std::atomic<int> counter{0};
+    for (int i = 0; i < 1000; i++) {
+        scheduler.go([&counter]() {
+            LightweightScheduler::yieldNow();
+            counter++;
+        });
+    }
+    scheduler.waitAll();
+    ASSERT_EQ(counter.load(), 1000);
+    scheduler.stop();
+}
+
 int main() {
     std::cout << "=== Lightweight Scheduler Tests ===\n\n";
     RUN_TEST(scheduler_init);
     RUN_TEST(single_goroutine);
     RUN_TEST(multiple_goroutines);
+    RUN_TEST(hundred_thousand_goroutines);
+    RUN_TEST(park_and_unpark);
+    RUN_TEST(worker_stats_count_parks_and_time);
+    RUN_TEST(sleep_frees_worker);
+    RUN_TEST(timer_heap_order_and_cancel);
+    RUN_TEST(after_runs_callbacks_on_workers);
+    RUN_TEST(chase_lev_owner_lifo_thief_fifo);
+    RUN_TEST(priority_levels);
+    RUN_TEST(queue_contention_benchmark);
+    RUN_TEST(fan_out_spawn);
+    RUN_TEST(fiber_preserves_registers_across_switches);
+    RUN_TEST(context_switch_cost);
+    RUN_TEST(numa_cpu_lists_and_placement);
+    RUN_TEST(numa_aware_scheduler_runs);
+#ifndef _WIN32
+    RUN_TEST(numa_topology_from_sysfs);
+    RUN_TEST(fiber_stack_pool_recycles);
+    RUN_TEST(stack_overflow_is_reported);
+    RUN_TEST(socket_wait_frees_worker);
+    RUN_TEST(hundreds_of_parked_sockets);
+    RUN_TEST(forget_wakes_parked_socket);
+#endif
     std::cout << "\n=== All tests passed! ===\n";
     return 0;
 }
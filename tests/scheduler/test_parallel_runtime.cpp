@@ -0,0 +1,288 @@
+// Parallel Runtime Tests for Tocin Compiler
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+extern "C" {
+void __tocin_parallel_for(int64_t start, int64_t end, void (*body)(int64_t));
+void __tocin_parallel_for_step(int64_t start, int64_t end, int64_t step, void (*body)(int64_t));
+void __tocin_parallel_init(int64_t num_threads);
+void __tocin_parallel_set_schedule(int64_t kind, int64_t chunk);
+void __tocin_parallel_set_nested(int64_t policy);
+void __tocin_parallel_shutdown();
+int64_t __tocin_parallel_threads();
+void __tocin_go(void (*fn)(void*), void* arg);
+void __tocin_join_all();
+int64_t __tocin_parallel_reduce(int64_t start, int64_t end, int64_t op, int64_t init, void* closure);
+double __tocin_parallel_reduce_f64(int64_t start, int64_t end, int64_t op, double init, void* closure);
+}
+
+#define TEST(name) void test_##name()
+#define RUN_TEST(name) do { \
+    std::cout << "Running test: " #name "..."; \
+    test_##name(); \
+    std::cout << " PASSED\n"; \
+} while(0)
+
+#define ASSERT_TRUE(expr) do { \
+    if (!(expr)) { \
+        std::cerr << "Assertion failed: " #expr << "\n"; \
+        exit(1); \
+    } \
+} while(0)
+
+#define ASSERT_EQ(a, b) ASSERT_TRUE((a) == (b))
+
+// Loop bodies are plain C function pointers, so they report through globals.
+static std::atomic<int64_t> g_sum{0};
+static std::atomic<int64_t> g_calls{0};
+static std::vector<std::atomic<int>> g_hits(100000);
+static std::mutex g_threads_mutex;
+static std::set<std::thread::id> g_threads;
+
+static void reset() {
+    g_sum = 0;
+    g_calls = 0;
+    for (auto& h : g_hits) h = 0;
+}
+
+static void sum_body(int64_t i) {
+    g_sum += i;
+    g_calls++;
+}
+
+static void hit_body(int64_t i) {
+    g_hits[i]++;
+}
+
+static void thread_body(int64_t) {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    std::lock_guard<std::mutex> lock(g_threads_mutex);
+    g_threads.insert(std::this_thread::get_id());
+}
+
+// Iteration cost grows with i, so a static split would leave the last thread
+// with most of the work.
+static void uneven_body(int64_t i) {
+    volatile int64_t x = 0;
+    for (int64_t k = 0; k < i; ++k) x = x + k;
+    g_calls++;
+}
+
+static void inner_body(int64_t i) {
+    g_sum += i;
+}
+
+static void outer_body(int64_t) {
+    __tocin_parallel_for(0, 100, inner_body);
+    g_calls++;
+}
+
+// Reductions take a closure in the generated-code layout: the function pointer
+// at offset 0, captured values after it.
+struct IntClosure {
+    int64_t (*fn)(void*, int64_t, int64_t, int64_t);
+    const int64_t* data;
+};
+struct FloatClosure {
+    double (*fn)(void*, int64_t, int64_t, double);
+    const double* data;
+};
+
+static std::vector<int64_t> g_ints;
+static std::vector<double> g_floats;
+
+static int64_t sum_chunk(void* env, int64_t lo, int64_t hi, int64_t acc) {
+    auto* c = static_cast<IntClosure*>(env);
+    for (int64_t i = lo; i < hi; ++i) acc += c->data[i];
+    return acc;
+}
+static int64_t max_chunk(void* env, int64_t lo, int64_t hi, int64_t acc) {
+    auto* c = static_cast<IntClosure*>(env);
+    for (int64_t i = lo; i < hi; ++i) acc = std::max(acc, c->data[i]);
+    return acc;
+}
+static int64_t xor_chunk(void* env, int64_t lo, int64_t hi, int64_t acc) {
+    auto* c = static_cast<IntClosure*>(env);
+    for (int64_t i = lo; i < hi; ++i) acc ^= c->data[i];
+    return acc;
+}
+static double dot_chunk(void* env, int64_t lo, int64_t hi, double acc) {
+    auto* c = static_cast<FloatClosure*>(env);
+    for (int64_t i = lo; i < hi; ++i) acc += c->data[i] * c->data[i];
+    return acc;
+}
+static double min_chunk(void* env, int64_t lo, int64_t hi, double acc) {
+    auto* c = static_cast<FloatClosure*>(env);
+    for (int64_t i = lo; i < hi; ++i) acc = std::min(acc, c->data[i]);
+    return acc;
+}
+
+TEST(every_index_once) {
+    reset();
+    __tocin_parallel_for(0, 100000, hit_body);
+    for (auto& h : g_hits) ASSERT_EQ(h.load(), 1);
+}
+
+TEST(sum_matches) {
+    reset();
+    __tocin_parallel_for(10, 10010, sum_body);
+    ASSERT_EQ(g_calls.load(), 10000);
+    ASSERT_EQ(g_sum.load(), (10 + 10009) * 10000 / 2);
+}
+
+TEST(empty_and_tiny_ranges) {
+    reset();
+    __tocin_parallel_for(5, 5, sum_body);
+    __tocin_parallel_for(7, 3, sum_body);
+    ASSERT_EQ(g_calls.load(), 0);
+    __tocin_parallel_for(0, 3, sum_body);
+    ASSERT_EQ(g_calls.load(), 3);
+}
+
+TEST(step_positive_and_negative) {
+    reset();
+    __tocin_parallel_for_step(0, 1000, 3, sum_body);
+    int64_t expect = 0, n = 0;
+    for (int64_t i = 0; i < 1000; i += 3) { expect += i; n++; }
+    ASSERT_EQ(g_calls.load(), n);
+    ASSERT_EQ(g_sum.load(), expect);
+
+    reset();
+    __tocin_parallel_for_step(1000, 0, -7, sum_body);
+    expect = 0; n = 0;
+    for (int64_t i = 1000; i > 0; i -= 7) { expect += i; n++; }
+    ASSERT_EQ(g_calls.load(), n);
+    ASSERT_EQ(g_sum.load(), expect);
+}
+
+TEST(schedules) {
+    for (int kind = 0; kind < 3; ++kind) {
+        for (int64_t chunk : {0, 1, 64}) {
+            reset();
+            __tocin_parallel_set_schedule(kind, chunk);
+            __tocin_parallel_for(0, 100000, hit_body);
+            for (auto& h : g_hits) ASSERT_EQ(h.load(), 1);
+        }
+    }
+    __tocin_parallel_set_schedule(2, 0);
+}
+
+TEST(uneven_iterations) {
+    reset();
+    __tocin_parallel_for(0, 4000, uneven_body);
+    ASSERT_EQ(g_calls.load(), 4000);
+}
+
+TEST(pool_is_persistent) {
+    // Many loops in a row reuse the executor's four workers (plus the calling
+    // thread) instead of spawning threads.
+    g_threads.clear();
+    for (int r = 0; r < 20; ++r)
+        __tocin_parallel_for(0, 64, thread_body);
+    ASSERT_TRUE(g_threads.size() <= 5);
+}
+
+static void loop_goroutine(void*) {
+    __tocin_parallel_for(0, 64, thread_body);
+    g_calls++;
+}
+
+TEST(shares_workers_with_goroutines) {
+    // Loops started from goroutines run on the same workers as the
+    // goroutines themselves, and finish even when every worker is inside one.
+    g_threads.clear();
+    reset();
+    for (int g = 0; g < 16; ++g)
+        __tocin_go(loop_goroutine, nullptr);
+    __tocin_join_all();
+    ASSERT_EQ(g_calls.load(), 16);
+    ASSERT_TRUE(g_threads.size() <= 4);
+}
+
+TEST(nested_policies) {
+    for (int policy = 0; policy < 2; ++policy) {
+        reset();
+        __tocin_parallel_set_nested(policy);
+        __tocin_parallel_for(0, 64, outer_body);
+        ASSERT_EQ(g_calls.load(), 64);
+        ASSERT_EQ(g_sum.load(), 64 * (99 * 100 / 2));
+    }
+    __tocin_parallel_set_nested(0);
+}
+
+TEST(reduce_int) {
+    g_ints.resize(100000);
+    int64_t sum = 0, mx = INT64_MIN, x = 0;
+    for (size_t i = 0; i < g_ints.size(); ++i) {
+        g_ints[i] = static_cast<int64_t>((i * 7919) % 10007) - 5000;
+        sum += g_ints[i];
+        mx = std::max(mx, g_ints[i]);
+        x ^= g_ints[i];
+    }
+    IntClosure s{sum_chunk, g_ints.data()};
+    ASSERT_EQ(__tocin_parallel_reduce(0, 100000, 0, 5, &s), sum + 5);
+    ASSERT_EQ(__tocin_parallel_reduce(10, 10, 0, 5, &s), 5);
+    IntClosure m{max_chunk, g_ints.data()};
+    ASSERT_EQ(__tocin_parallel_reduce(0, 100000, 3, INT64_MIN, &m), mx);
+    IntClosure z{xor_chunk, g_ints.data()};
+    ASSERT_EQ(__tocin_parallel_reduce(0, 100000, 6, 0, &z), x);
+    // A short range runs as a single chunk on the caller.
+    ASSERT_EQ(__tocin_parallel_reduce(0, 3, 0, 0, &s), g_ints[0] + g_ints[1] + g_ints[2]);
+}
+
+TEST(reduce_float) {
+    g_floats.resize(4096);
+    double dot = 0, mn = 1e300;
+    for (size_t i = 0; i < g_floats.size(); ++i) {
+        g_floats[i] = 0.25 * static_cast<double>(i % 97) - 3.0;
+        dot += g_floats[i] * g_floats[i];
+        mn = std::min(mn, g_floats[i]);
+    }
+    FloatClosure d{dot_chunk, g_floats.data()};
+    double got = __tocin_parallel_reduce_f64(0, 4096, 0, 0.0, &d);
+    ASSERT_TRUE(got > dot - 1e-6 && got < dot + 1e-6);
+    FloatClosure m{min_chunk, g_floats.data()};
+    ASSERT_EQ(__tocin_parallel_reduce_f64(0, 4096, 2, 0.0, &m), mn);
+}
+
+TEST(reinitialize_after_shutdown) {
+    __tocin_parallel_shutdown();
+    reset();
+    __tocin_parallel_for(0, 1000, sum_body);
+    ASSERT_EQ(g_calls.load(), 1000);
+}
+
+int main() {
+    std::cout << "=== Parallel Runtime Tests ===\n\n";
+
+    // A fixed executor size keeps the tests meaningful on single-core
+    // machines and the thread-count bounds exact on large ones.
+    setenv("TOCIN_MAX_PROCS", "4", 1);
+    __tocin_parallel_init(4);
+    ASSERT_EQ(__tocin_parallel_threads(), 4);
+
+    RUN_TEST(every_index_once);
+    RUN_TEST(sum_matches);
+    RUN_TEST(empty_and_tiny_ranges);
+    RUN_TEST(step_positive_and_negative);
+    RUN_TEST(schedules);
+    RUN_TEST(uneven_iterations);
+    RUN_TEST(pool_is_persistent);
+    RUN_TEST(shares_workers_with_goroutines);
+    RUN_TEST(nested_policies);
+    RUN_TEST(reduce_int);
+    RUN_TEST(reduce_float);
+    RUN_TEST(reinitialize_after_shutdown);
+
+    std::cout << "\n=== All tests passed! ===\n";
+    return 0;
+}
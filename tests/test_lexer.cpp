@@ -101,3 +101,38 @@ TEST(Lexer, TracksLineNumbers) {
     ASSERT_TRUE(c != nullptr);
     ASSERT_EQ(3, c->line);
 }
+
+TEST(Lexer, EqualNamesShareASymbol) {
+    Lexer lex("count = count + total", "test.to");
+    auto toks = lex.tokenize();
+    ASSERT_TRUE(toks.size() >= 5);
+    ASSERT_EQ(toks[0].symbol, toks[2].symbol);
+    ASSERT_TRUE(toks[0].symbol != toks[4].symbol);
+    ASSERT_EQ(std::string("count"), SymbolTable::text(toks[0].symbol));
+}
+
+TEST(Lexer, KeywordsNeedTheExactSpelling) {
+    // Neighbours of keywords in the perfect hash must stay identifiers.
+    Lexer lex("while where wh whilex instanceof lambda_ import", "test.to");
+    auto toks = lex.tokenize();
+    ASSERT_EQ(1, countType(toks, TokenType::WHILE));
+    ASSERT_EQ(1, countType(toks, TokenType::WHERE));
+    ASSERT_EQ(1, countType(toks, TokenType::INSTANCEOF));
+    ASSERT_EQ(1, countType(toks, TokenType::IMPORT));
+    ASSERT_EQ(3, countType(toks, TokenType::IDENTIFIER));
+}
+
+TEST(Lexer, TokensOutliveTheirSource) {
+    std::vector<Token> toks;
+    {
+        std::string source = "let greeting = \"a\\tb\" + \"plain\"";
+        Lexer lex(source, "test.to");
+        toks = lex.tokenize();
+        source.assign(source.size(), '#');
+    }
+    ASSERT_EQ(std::string("greeting"), toks[1].value);
+    const Token *s = firstOf(toks, TokenType::STRING);
+    ASSERT_TRUE(s != nullptr);
+    ASSERT_EQ(std::string("a\tb"), s->value);
+    ASSERT_EQ(std::string("plain"), toks[5].value);
+}
@@ -67,3 +67,37 @@ TEST(Macro, SourceWithoutMacrosIsUnchanged) {
     ASSERT_TRUE(!err);
     ASSERT_TRUE(s.find("def main ( ) { return 1 + 2 ; }") != std::string::npos);
 }
+
+TEST(Macro, RepeatedInvocationKeepsItsOwnPosition) {
+    Lexer lex("macro square(x) { x * x }\nlet a = square!(2);\nlet b = square!(2);", "test.to");
+    auto toks = lex.tokenize();
+    error::ErrorHandler eh("test.to");
+    auto out = compiler::expandMacroTokens(toks, eh);
+    ASSERT_TRUE(!eh.hasErrors());
+    // The second expansion is replayed from the first, but its tokens must
+    // still point at line 3.
+    std::vector<int> lines;
+    for (const auto &t : out)
+        if (t.type == TokenType::INT)
+            lines.push_back(t.line);
+    ASSERT_EQ(size_t(4), lines.size());
+    ASSERT_EQ(2, lines[0]);
+    ASSERT_EQ(3, lines[3]);
+}
+
+TEST(Macro, RecursiveMacroIsAnError) {
+    bool err = false;
+    expandToString("macro forever(x) { forever!(x) }\nlet q = forever!(1);", err);
+    ASSERT_TRUE(err);
+}
+
+TEST(Macro, ExponentialExpansionIsAnError) {
+    std::string src = "macro m0(x) { x }\n";
+    for (int i = 1; i <= 40; ++i)
+        src += "macro m" + std::to_string(i) + "(x) { m" + std::to_string(i - 1) +
+               "!(x) + m" + std::to_string(i - 1) + "!(x) }\n";
+    src += "let q = m40!(1);";
+    bool err = false;
+    expandToString(src, err);
+    ASSERT_TRUE(err);
+}
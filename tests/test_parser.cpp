@@ -157,3 +157,175 @@ TEST(Parser, ParsesGenericClassWithMultipleTypeParameters) {
     ASSERT_TRUE(cls->isGeneric());
     ASSERT_EQ(size_t(2), cls->typeParameters.size());
 }
+
+// Initializer of the first `let` in the body of the first function.
+static ast::ExprPtr firstLetInit(const ast::StmtPtr &root) {
+    auto fn = std::dynamic_pointer_cast<ast::FunctionStmt>(topLevel(root)[0]);
+    auto body = std::dynamic_pointer_cast<ast::BlockStmt>(fn->body);
+    auto var = std::dynamic_pointer_cast<ast::VariableStmt>(body->statements[0]);
+    return var ? var->initializer : nullptr;
+}
+
+TEST(Parser, ParsesBoundedChannelConstructor) {
+    for (const char *src : {"def m() { let c = channel<int>(8); }",
+                            "def m() { let c = chan<int>(8); }",
+                            "def m() { let c = chan<channel<int>>(0); }"}) {
+        auto call = std::dynamic_pointer_cast<ast::CallExpr>(firstLetInit(parseProgram(src)));
+        ASSERT_TRUE(call != nullptr);
+        auto callee = std::dynamic_pointer_cast<ast::VariableExpr>(call->callee);
+        ASSERT_TRUE(callee != nullptr);
+        ASSERT_EQ(std::string("__chan_new"), callee->name);
+        ASSERT_EQ(size_t(1), call->arguments.size());
+    }
+    auto unbounded = std::dynamic_pointer_cast<ast::CallExpr>(
+        firstLetInit(parseProgram("def m() { let c = channel<int>(); }")));
+    ASSERT_TRUE(unbounded != nullptr);
+    ASSERT_EQ(size_t(0), unbounded->arguments.size());
+}
+
+TEST(Parser, ChanIsStillAnOrdinaryName) {
+    auto init = firstLetInit(parseProgram("def m(chan: int) { let b = chan < 3; }"));
+    ASSERT_TRUE(std::dynamic_pointer_cast<ast::BinaryExpr>(init) != nullptr);
+}
+
+TEST(Parser, ParsesParallelForReduce) {
+    auto root = parseProgram(
+        "def m(xs: list<int>, n: int) -> int { let s = 0; "
+        "parallel for i in 0..n reduce(+: s) { s = s + xs[i]; } return s; }");
+    auto fn = std::dynamic_pointer_cast<ast::FunctionStmt>(topLevel(root)[0]);
+    auto body = std::dynamic_pointer_cast<ast::BlockStmt>(fn->body);
+    auto loop = std::dynamic_pointer_cast<ast::ForStmt>(body->statements[1]);
+    ASSERT_TRUE(loop != nullptr);
+    ASSERT_TRUE(loop->parallel);
+    ASSERT_EQ(std::string("+"), loop->reduceOp);
+    ASSERT_EQ(std::string("s"), loop->reduceVar);
+
+    for (const char *op : {"*", "&", "|", "^", "min", "max"}) {
+        std::string src = std::string("def m() { let a = 1; parallel for i in 0..9 reduce(") + op +
+                          ": a) { a = a; } }";
+        auto r = parseProgram(src);
+        auto f = std::dynamic_pointer_cast<ast::FunctionStmt>(topLevel(r)[0]);
+        auto b = std::dynamic_pointer_cast<ast::BlockStmt>(f->body);
+        auto l = std::dynamic_pointer_cast<ast::ForStmt>(b->statements[1]);
+        ASSERT_TRUE(l != nullptr);
+        ASSERT_EQ(std::string(op), l->reduceOp);
+    }
+
+    auto plain = parseProgram("def m() { parallel for i in 0..9 { print(i); } }");
+    auto pf = std::dynamic_pointer_cast<ast::FunctionStmt>(topLevel(plain)[0]);
+    auto pb = std::dynamic_pointer_cast<ast::BlockStmt>(pf->body);
+    auto pl = std::dynamic_pointer_cast<ast::ForStmt>(pb->statements[0]);
+    ASSERT_TRUE(pl != nullptr);
+    ASSERT_TRUE(pl->parallel);
+    ASSERT_TRUE(pl->reduceOp.empty());
+}
+
+TEST(Parser, ParallelIsStillAnOrdinaryName) {
+    auto init = firstLetInit(parseProgram("def m(parallel: int) { let b = parallel + 1; }"));
+    ASSERT_TRUE(std::dynamic_pointer_cast<ast::BinaryExpr>(init) != nullptr);
+}
+
+TEST(Parser, PullsTokensStraightFromTheLexer) {
+    // Exercises the lookahead that scans ahead of peek(): qualifier runs,
+    // withArena(...) { and split `>>` in nested generics.
+    const std::string src =
+        "memoize def fib(n: int) -> int { if n < 2 { return n; } return fib(n - 1) + fib(n - 2); }\n"
+        "def g(a: int) -> int { let m: List<List<int>> = [[a]]; "
+        "withArena(4096) { print(a); } return a; }\n";
+    Lexer lex(src, "test.to");
+    Parser streaming(lex);
+    auto pulled = topLevel(streaming.parse());
+    auto materialized = topLevel(parseProgram(src));
+    ASSERT_EQ(size_t(2), pulled.size());
+    ASSERT_EQ(materialized.size(), pulled.size());
+    auto fib = std::dynamic_pointer_cast<ast::FunctionStmt>(pulled[0]);
+    ASSERT_TRUE(fib != nullptr && fib->isMemoize);
+    auto g = std::dynamic_pointer_cast<ast::FunctionStmt>(pulled[1]);
+    ASSERT_TRUE(g != nullptr);
+    ASSERT_EQ(std::string("g"), g->name);
+    ASSERT_TRUE(streaming.getErrors().empty());
+}
+
+TEST(Parser, ArenaOutlivesItsScopeWhileNodesRemain) {
+    ast::StmtPtr root;
+    std::weak_ptr<ast::Arena> weak;
+    {
+        auto arena = ast::Arena::create();
+        weak = arena;
+        ast::ArenaScope scope(arena);
+        root = parseProgram("def f(a: int) -> int { return a + 1; }\n");
+        ASSERT_TRUE(arena->bytes() > 0);
+    }
+    // The owner's handle is gone, but the nodes still hold the blocks.
+    ASSERT_TRUE(weak.expired());
+    auto defs = topLevel(root);
+    ASSERT_EQ(size_t(1), defs.size());
+    auto f = std::dynamic_pointer_cast<ast::FunctionStmt>(defs[0]);
+    ASSERT_TRUE(f != nullptr);
+    ASSERT_EQ(std::string("f"), f->name);
+}
+
+TEST(Parser, NodeKindsDriveIsaAndDynCast) {
+    auto defs = topLevel(parseProgram("def f(a: int) -> int { return a + 1; }\nlet x: int = 2;\n"));
+    ASSERT_EQ(size_t(2), defs.size());
+    ASSERT_TRUE(ast::isa<ast::FunctionStmt>(defs[0]));
+    ASSERT_TRUE(ast::isa<ast::Statement>(defs[0]));
+    ASSERT_FALSE(ast::isa<ast::VariableStmt>(defs[0]));
+    auto *var = ast::dyn_cast<ast::VariableStmt>(defs[1]);
+    ASSERT_TRUE(var != nullptr);
+    ASSERT_TRUE(ast::isa<ast::Expression>(var->initializer));
+    ASSERT_TRUE(ast::isa<ast::LiteralExpr>(var->initializer));
+    ASSERT_TRUE(ast::dyn_cast<ast::CallExpr>(var->initializer) == nullptr);
+    ASSERT_TRUE(ast::dyn_pointer_cast<ast::FunctionStmt>(defs[0]) == defs[0]);
+    ast::StmtPtr none;
+    ASSERT_FALSE(ast::isa<ast::BlockStmt>(none));
+}
+
+// Parse with `parser` in interface mode, as a precompiled module's .toi is.
+static ast::StmtPtr parseInterface(Parser &parser) {
+    parser.setInterface(true);
+    return parser.parse();
+}
+
+TEST(Parser, InterfaceModeAcceptsBodylessPrototypes) {
+    const std::string src =
+        "import std.math;\n"
+        "const LIMIT: int = 8;\n"
+        "def add(a: int, b: int) -> int;\n"
+        "def log(msg: string);\n"
+        "def twice(a: int) -> int { return add(a, a); }\n";
+    Lexer lex(src, "m.toi");
+    Parser parser(lex);
+    auto defs = topLevel(parseInterface(parser));
+    ASSERT_TRUE(parser.getErrors().empty());
+    ASSERT_EQ(size_t(5), defs.size());
+    auto *add = ast::dyn_cast<ast::FunctionStmt>(defs[2]);
+    ASSERT_TRUE(add != nullptr);
+    ASSERT_TRUE(add->isInterface);
+    ASSERT_TRUE(add->body == nullptr);
+    ASSERT_EQ(size_t(2), add->parameters.size());
+    ASSERT_TRUE(add->returnType != nullptr);
+    auto *log = ast::dyn_cast<ast::FunctionStmt>(defs[3]);
+    ASSERT_TRUE(log != nullptr && log->isInterface && log->returnType == nullptr);
+    // A function the interface keeps as source parses as usual.
+    auto *twice = ast::dyn_cast<ast::FunctionStmt>(defs[4]);
+    ASSERT_TRUE(twice != nullptr && !twice->isInterface && twice->body != nullptr);
+}
+
+TEST(Parser, RejectsBodylessPrototypesOutsideInterfaceMode) {
+    Lexer lex("def add(a: int, b: int) -> int;\n", "m.to");
+    Parser parser(lex);
+    auto defs = topLevel(parser.parse());
+    ASSERT_FALSE(parser.getErrors().empty());
+    for (const auto &d : defs)
+        if (auto *fn = ast::dyn_cast<ast::FunctionStmt>(d))
+            ASSERT_FALSE(fn->isInterface);
+}
+
+TEST(Parser, InterfaceModeStillRequiresGenericBodies) {
+    // A generic is instantiated by each importer, so it has no prototype.
+    Lexer lex("def id<T>(x: T) -> T;\n", "m.toi");
+    Parser parser(lex);
+    parseInterface(parser);
+    ASSERT_FALSE(parser.getErrors().empty());
+}
@@ -0,0 +1,145 @@
+#include "test_framework.h"
+#include "../src/lexer/lexer.h"
+#include "../src/parser/parser.h"
+#include "../src/type/type_checker.h"
+#include "../src/compiler/compilation_context.h"
+#include "../src/compiler/stdlib_cache.h"
+#include "../src/error/error_handler.h"
+
+// A module's top-level statements; one statement parses to itself alone.
+static std::vector<ast::StmtPtr> topLevel(const ast::StmtPtr &program) {
+    if (auto *block = ast::dyn_cast<ast::BlockStmt>(program.get()))
+        return block->statements;
+    if (program) return {program};
+    return {};
+}
+
+// Parse and type-check a module the way the precompiler does, then build its
+// interface. The checker fills in inferred return types, which decide
+// whether an unannotated function keeps its body.
+static tocin::compiler::ModuleInterface interfaceOf(const std::string &src) {
+    lexer::Lexer lex(src, "m.to");
+    parser::Parser parser(lex);
+    auto program = parser.parse();
+    if (!parser.getErrors().empty())
+        return {};
+    const std::vector<ast::StmtPtr> statements = topLevel(program);
+    if (!tocin::compiler::isPrecompilable(src, statements))
+        return {};
+    error::ErrorHandler eh("m.to");
+    tocin::compiler::CompilationContext ctx("m.to");
+    type_checker::TypeChecker checker(eh, ctx);
+    checker.check(program);
+    return tocin::compiler::makeInterface(src, statements, "m.to");
+}
+
+static bool contains(const std::string &text, const std::string &part) {
+    return text.find(part) != std::string::npos;
+}
+
+TEST_SUITE(StdlibCache)
+
+TEST(StdlibCache, PrototypesPlainFunctions) {
+    auto iface = interfaceOf(
+        "const LIMIT: int = 8;\n"
+        "def add(a: int, b: int) -> int {\n"
+        "    return a + b;\n"
+        "}\n"
+        "def log(msg: string) {\n"
+        "    print(msg);\n"
+        "}\n");
+    ASSERT_TRUE(contains(iface.text, "const LIMIT: int = 8;\n"));
+    ASSERT_TRUE(contains(iface.text, "def add(a: int, b: int) -> int;\n"));
+    ASSERT_TRUE(contains(iface.text, "def log(msg: string);\n"));
+    ASSERT_FALSE(contains(iface.text, "return a + b;"));
+    ASSERT_EQ(size_t(2), iface.exported.size());
+    ASSERT_TRUE(iface.exported.count("add") == 1 && iface.exported.count("log") == 1);
+}
+
+TEST(StdlibCache, KeepsGenericAndConstBodies) {
+    auto iface = interfaceOf(
+        "def id<T>(x: T) -> T {\n"
+        "    return x;\n"
+        "}\n"
+        "const def square(n: int) -> int {\n"
+        "    return n * n;\n"
+        "}\n");
+    ASSERT_TRUE(contains(iface.text, "return x;"));
+    ASSERT_TRUE(contains(iface.text, "return n * n;"));
+    ASSERT_TRUE(iface.exported.empty());
+}
+
+TEST(StdlibCache, KeepsValueReturningBodies) {
+    // Option, Result and tuple results return by value, which a prototype
+    // cannot say.
+    auto iface = interfaceOf(
+        "def find(n: int) -> Option {\n"
+        "    if n > 0 { return Some(n); }\n"
+        "    return None;\n"
+        "}\n"
+        "def check(n: int) -> Result {\n"
+        "    if n > 0 { return Ok(n); }\n"
+        "    return Err(n);\n"
+        "}\n"
+        "def divmod(a: int, b: int) -> (int, int) {\n"
+        "    return (a / b, a % b);\n"
+        "}\n"
+        "def plain(a: int) -> int {\n"
+        "    return a;\n"
+        "}\n");
+    ASSERT_TRUE(contains(iface.text, "return Some(n);"));
+    ASSERT_TRUE(contains(iface.text, "return Err(n);"));
+    ASSERT_TRUE(contains(iface.text, "return (a / b, a % b);"));
+    ASSERT_TRUE(contains(iface.text, "def plain(a: int) -> int;\n"));
+    ASSERT_EQ(size_t(1), iface.exported.size());
+}
+
+TEST(StdlibCache, KeepsBodiesWithInferredReturnTypes) {
+    auto iface = interfaceOf(
+        "def next(a: int) {\n"
+        "    return a + 1;\n"
+        "}\n"
+        "def touch(a: int) {\n"
+        "    print(a);\n"
+        "}\n");
+    // The checker inferred int for next(); only inference knows it.
+    ASSERT_TRUE(contains(iface.text, "return a + 1;"));
+    ASSERT_TRUE(iface.exported.count("next") == 0);
+    ASSERT_TRUE(contains(iface.text, "def touch(a: int);\n"));
+    ASSERT_TRUE(iface.exported.count("touch") == 1);
+}
+
+TEST(StdlibCache, SignatureEndsAtTheBodyBrace) {
+    // A `{` in a comment or string is not the body, and a comment before the
+    // body is dropped so that the prototype's `;` is not commented out.
+    auto iface = interfaceOf(
+        "def open(a: int) -> int // returns { a }\n"
+        "{\n"
+        "    return a;\n"
+        "}\n"
+        "def tag(s: string) -> string /* { */ {\n"
+        "    return \"{\" + s + \"}\";\n"
+        "}\n"
+        "def brace() -> string {\n"
+        "    return \"{\";\n"
+        "}\n");
+    ASSERT_TRUE(contains(iface.text, "def open(a: int) -> int;\n"));
+    ASSERT_TRUE(contains(iface.text, "def tag(s: string) -> string;\n"));
+    ASSERT_TRUE(contains(iface.text, "def brace() -> string;\n"));
+    ASSERT_FALSE(contains(iface.text, "return"));
+    ASSERT_EQ(size_t(3), iface.exported.size());
+}
+
+TEST(StdlibCache, OnlyPlainModulesArePrecompilable) {
+    auto precompilable = [](const std::string &src) {
+        lexer::Lexer lex(src, "m.to");
+        parser::Parser parser(lex);
+        auto program = parser.parse();
+        return parser.getErrors().empty() && tocin::compiler::isPrecompilable(src, topLevel(program));
+    };
+    ASSERT_TRUE(precompilable("def f(a: int) -> int {\n    return a;\n}\n"));
+    ASSERT_FALSE(precompilable("let counter: int = 0;\ndef f() -> int {\n    return counter;\n}\n"));
+    ASSERT_FALSE(precompilable("class P {\n    x: int;\n}\n"));
+    ASSERT_FALSE(precompilable("def gen(n: int) -> int {\n    yield n;\n}\n"));
+    ASSERT_FALSE(precompilable("def f() -> int { return 1; } def g() -> int { return 2; }\n"));
+}
@@ -24,6 +24,26 @@ static bool checkSource(const std::string &src)
     return eh.hasErrors();
 }
 
+// The diagnostics of checking `src` on `jobs` threads, as "line:col message".
+static std::vector<std::string> diagnostics(const std::string &src, unsigned jobs)
+{
+    lexer::Lexer lex(src, "test.to");
+    auto toks = lex.tokenize();
+    parser::Parser parser(toks);
+    auto program = parser.parse();
+    error::ErrorHandler eh("test.to");
+    std::vector<std::string> out;
+    if (!program)
+        return out;
+    tocin::compiler::CompilationContext ctx("test.to");
+    type_checker::TypeChecker checker(eh, ctx);
+    checker.setJobs(jobs);
+    checker.check(program);
+    for (const auto &e : eh.getErrors())
+        out.push_back(std::to_string(e.line) + ":" + std::to_string(e.column) + " " + e.message);
+    return out;
+}
+
 TEST_SUITE(TypeChecker)
 
 TEST(TypeChecker, ValidProgramHasNoErrors) {
@@ -103,3 +123,35 @@ TEST(TypeChecker, StringTimesIntIsAnError) {
         "    return 0;\n"
         "}\n"));
 }
+
+TEST(TypeChecker, BlockBindingsEndWithTheBlock) {
+    ASSERT_TRUE(checkSource(
+        "def main() -> int {\n"
+        "    if (true) { let inner = 1; }\n"
+        "    return inner;\n"   // out of scope after the block
+        "}\n"));
+}
+
+TEST(TypeChecker, LeavingABlockRestoresTheShadowedBinding) {
+    ASSERT_TRUE(!checkSource(
+        "def main() -> int {\n"
+        "    let x = 1;\n"
+        "    if (true) { let x = \"shadow\"; }\n"
+        "    return x;\n"       // the outer int again
+        "}\n"));
+}
+
+TEST(TypeChecker, ParallelCheckMatchesSequential) {
+    // Errors in several bodies and in between them; `late` is declared after
+    // f, so only g may use it.
+    const std::string src =
+        "def f() -> int { return late + missing1; }\n"
+        "let late = 1;\n"
+        "let bad = nowhere;\n"
+        "def g() -> int { return late + missing2; }\n"
+        "def h() -> int { return \"text\"; }\n"
+        "def main() -> int { return f() + g() + h(); }\n";
+    auto sequential = diagnostics(src, 1);
+    ASSERT_TRUE(sequential.size() == 5);
+    ASSERT_TRUE(diagnostics(src, 4) == sequential);
+}